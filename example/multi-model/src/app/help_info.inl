@@ -1,16 +1,37 @@
       std::cout<< "Error: no config!!!\n";
-      std::cout<< "Usage: ipu_multi_models.exe  <path to models_config.json>\n\n";
+      std::cout<< "Usage: ipu_multi_models.exe  <path to models_config.json>\n";
+      std::cout<< "       ipu_multi_models.exe  --build-cache <path to models_config.json>   compiles the models into the session_cache and exits.\n\n";
       std::cout<< "Examples of model_config.json is located in the config folder of the repository.\n";
       std::cout<< "The meaning of the fields in the models_config.json file:\n";
       std::cout<< "    split_channel_matrix_size         If set to 1, your screen will be splited to 1x1 uniformly; if set to 2,your screen will be split to 2x2 uniformly; and so on.\n";
       std::cout<< "    height                            Window sreen height\n";
       std::cout<< "    width                             Window sreen width\n";
-      std::cout<< "    thread_num                        How many thread to feed data to IPU.\n";
+      std::cout<< "    display_fps                       Optional, in screen; how many times per second the screen is redrawn from the latest frames. Default 0, on every frame.\n";
+      std::cout<< "    headless                          Optional, in screen; true shows no window and prints the frames per second the gui receives, for benchmarking.\n";
+      std::cout<< "    opencl                            Optional, in screen; true scales the channels into the screen on the GPU with OpenCL when available.\n";
+      std::cout<< "    trace                             Optional, at top level; enables per stage latency tracing, printed at exit. {\"chrome_trace_file\": \"trace.json\", \"max_frames\": 10000} also writes the first frames as a Chrome trace.\n";
+      std::cout<< "    npu_scheduler                     Optional, at top level; {\"max_concurrent_runs\": n} lets n model runs on the NPU at a time, shared by priority, and drops frames at decode when a model falls behind.\n";
+      std::cout<< "    priority                          Optional, in model; with npu_scheduler, the models of higher priority run first. Default 0.\n";
+      std::cout<< "    target_fps                        Optional, in model; with npu_scheduler, the frames decoded for the model per second at most. Default 0, no limit.\n";
+      std::cout<< "    thread_num                        How many thread to feed data to IPU. Optional in a stage of a cascade, default the thread_num of the pipeline.\n";
+      std::cout<< "    model                             A model, or an array of models run one after the other on each frame, e.g. a detection on the NPU feeding a classification on the iGPU; the stages run concurrently.\n";
+      std::cout<< "    engine                            Optional, in model or onnx_config; \"npu\" (VitisAI), \"igpu\" (DirectML) or \"cpu\". Default \"npu\". The utilization of each engine is printed at exit.\n";
+      std::cout<< "    dml_device_id                     Optional, in onnx_config; the DirectML adapter of the \"igpu\" engine. Default 0.\n";
       std::cout<< "    onnx_model_path                   Your onnx model for the program to find.\n";
+      std::cout<< "    batch_size                        Optional, in model; the most frames of a channel a model thread runs in one onnx session call. Default 1.\n";
+      std::cout<< "    batch_timeout_ms                  Optional, in model; how long a model thread waits for more frames to fill a batch. Default 0, only the frames already decoded.\n";
+      std::cout<< "    max_in_flight                     Optional, in model; how many runs a model thread keeps in flight with the onnx RunAsync, the frames are forwarded as their run completes. Needs onnx_x other than 1. Default 0, a thread waits for each run.\n";
+      std::cout<< "    tiling                            Optional, in the config of segmentation; true splits the frames larger than the model input into tiles of its size run in one batch, the model batch size must be dynamic. Default false.\n";
+      std::cout<< "    tile_overlap                      Optional, with tiling; the least overlap of the tiles in pixels. Default 64.\n";
+      std::cout<< "    tile_skip_diff                    Optional, with tiling; a tile whose mean absolute difference to its last run is below it (gray levels) is not run again. Default 0, all the tiles run.\n";
       std::cout<< "    video_file_path                   Your video file for the program to consume; you can set it to string \"0\" for defuatl camera;\n";
+      std::cout<< "    video_cache                       Optional, in decode; true decodes a video file once into memory instead of streaming it with the hardware decoder. Default false.\n";
+      std::cout<< "    motion_gate                       Optional, in decode; {\"diff_threshold\": 2.0, \"keyframe_interval\": 30} runs the models only on the frames whose mean absolute difference (gray levels, on a thumbnail) to the last frame they ran on is at least diff_threshold, the other frames show its result. At most keyframe_interval frames in a row are skipped.\n";
       std::cout<< "    confidence_threshold              Bewteen [0,1];The larger the value, the higher the model accuracy;only for model: yolov8 and yolovx\n";
       std::cout<< "    onnx_x                            Sets the number of threads used to parallelize the execution within nodes, A value of 0 means ORT will pick a default. Must >=0.\n";
       std::cout<< "    onnx_y                            Sets the number of threads used to parallelize the execution of the graph (across nodes), A value of 0 means ORT will pick a default.Must >=0.\n";
+      std::cout<< "    onnx_global_thread_pool           Optional, at top level; {\"onnx_x\": n, \"onnx_y\": m} makes all the sessions share one thread pool of that size, and their own onnx_x and onnx_y are ignored.\n";
+      std::cout<< "    session_cache                     Optional, at top level; {\"cache_dir\": \"cache\", \"require_cache\": true} keeps the models compiled by VitisAI in cache_dir, keyed by a hash of the model and vaip config. With require_cache a model not in the cache fails at startup instead of being compiled.\n";
       std::cout<< "    onnx_disable_spinning_between_run Disallow thread from spinning during runs to reduce cpu usage.\n";
       std::cout<< "    onnx_disable_spinning             Disable spinning entirely for thread owned by onnxruntime intra-op thread pool.\n";
       std::cout<< "    intra_op_thread_affinities        Not support now;\n";
@@ -3,6 +3,7 @@
 #include "mobile_net_v2/model.hpp"
 #include "processing/executor.hpp"
 #include "processing/pipeline.hpp"
+#include "processing/pipeline_tracer.hpp"
 #include "resnet50/model.hpp"
 #include "retinaface/model.hpp"
 #include "segmentation/model.hpp"
@@ -16,8 +17,54 @@ std::string read_all(const std::string& file_path) {
   return ss.str();
 }
 
-void start(const Config& config) {
+void init_sessions(const Config& config, bool build_cache) {
   SessionManager::get_instance().set_singleton(true);
+  if (config.contains("onnx_global_thread_pool")) {
+    CONFIG_GET(config, Config, thread_pool_config, "onnx_global_thread_pool")
+    CONFIG_GET(thread_pool_config, int, onnx_x, "onnx_x")
+    CONFIG_GET(thread_pool_config, int, onnx_y, "onnx_y")
+    SessionManager::get_instance().set_global_thread_pool(onnx_x, onnx_y);
+  }
+  if (config.contains("session_cache")) {
+    CONFIG_GET(config, Config, cache_config, "session_cache")
+    CONFIG_GET(cache_config, std::string, cache_dir, "cache_dir")
+    bool require_cache = false;
+    if (cache_config.contains("require_cache")) {
+      CONFIG_GET(cache_config, bool, require_cache_flag, "require_cache")
+      require_cache = require_cache_flag;
+    }
+    SessionManager::get_instance().set_session_cache(
+        cache_dir, require_cache && !build_cache);
+  } else {
+    CHECK_WITH_INFO(!build_cache, "--build-cache needs a session_cache")
+  }
+}
+
+// Creates the session of every model stage once, which compiles the ones
+// missing from the session cache, and exits without running the pipelines
+void build_cache(const Config& config) {
+  init_sessions(config, true);
+  CONFIG_GET_ARRAY(config, Config, pipeline_configs, "pipelines");
+  for (auto& pipeline_config_pair : pipeline_configs.items()) {
+    for (auto& stage_config :
+         get_stage_configs(pipeline_config_pair.value())) {
+      ModelTask model_task;
+      model_task.init(stage_config);
+    }
+  }
+  PRINT("Session cache built")
+}
+
+void start(const Config& config) {
+  init_sessions(config, false);
+  if (config.contains("npu_scheduler")) {
+    CONFIG_GET(config, Config, scheduler_config, "npu_scheduler")
+    NpuScheduler::instance().init(scheduler_config);
+  }
+  if (config.contains("trace")) {
+    CONFIG_GET(config, Config, trace_config, "trace")
+    PipelineTracer::instance().init(trace_config);
+  }
   std::vector<std::shared_ptr<AsyncTask>> tasks;
   auto gui_task = std::make_shared<GuiTask>();
   int split_channel_matrix_size_square{0};
@@ -48,6 +95,16 @@ void start(const Config& config) {
   PRINT("Running ... \nClose window to stop ")
   tjread_executor.run(tasks);
   tjread_executor.wait();
+  if (NpuScheduler::instance().enabled()) {
+    std::cout << NpuScheduler::instance().summary();
+  }
+  if (!EngineMonitor::instance().empty()) {
+    std::cout << EngineMonitor::instance().summary();
+  }
+  if (PipelineTracer::instance().enabled()) {
+    std::cout << PipelineTracer::instance().summary();
+    PipelineTracer::instance().write_chrome_trace();
+  }
 }
 
 int main(int argc, char* argv[]) {
@@ -57,13 +114,21 @@ int main(int argc, char* argv[]) {
 #include "help_info.inl"
       return 0;
     }
-    std::string config_path = argv[1];
+    bool build_cache_only = std::string(argv[1]) == "--build-cache";
+    if (build_cache_only) {
+      CHECK_WITH_INFO(argc > 2, "--build-cache <path to models_config.json>")
+    }
+    std::string config_path = argv[build_cache_only ? 2 : 1];
     CHECK_WITH_INFO(is_file(config_path), config_path)
     CHECK_WITH_INFO(check_extension(config_path, ".json"), config_path)
     auto config_content = read_all(config_path);
     auto config = Config::parse(config_content);
     CONFIG_GET_ARRAY(config, Config, pipelines_config, "pipelines")
     CHECK_WITH_INFO(!pipelines_config.empty(), "pipeline config size zero!!!")
+    if (build_cache_only) {
+      build_cache(config);
+      return 0;
+    }
     start(config);
   } catch (MyExceptoin& e) {
     std::cout << "DemoExcption: " << e.what() << "\n";
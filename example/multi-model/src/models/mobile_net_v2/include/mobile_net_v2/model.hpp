@@ -3,6 +3,7 @@
 #include <opencv2/imgproc.hpp>
 
 #include "onnx/onnx.hpp"
+#include "processing/image_preprocess.hpp"
 namespace onnx_mobile_net_v2 {
 std::pair<int, int> find_black_border(const cv::Mat& image) {
   int height_pad = 0, width_pad = 0;
@@ -27,17 +28,6 @@ std::pair<int, int> find_black_border(const cv::Mat& image) {
   return std::make_pair(height_pad, width_pad);
 }
 
-static void set_input_image(const cv::Mat& image, float* data) {
-  for (int c = 0; c < 3; c++) {
-    for (int h = 0; h < image.rows; h++) {
-      for (int w = 0; w < image.cols; w++) {
-        auto c_t = c;  // abs(c - 2);  // BRG to RGB
-        auto image_data = float(image.at<cv::Vec3b>(h, w)[c_t]) / 128.0f - 1.0f;
-        data[h * image.cols * 3 + w * 3 + c] = (float)image_data;
-      }
-    }
-  }
-}
 static std::vector<std::pair<int, float>> topk(float* score, size_t size,
                                                int K) {
   auto indices = std::vector<int>(size);
@@ -118,8 +108,10 @@ class MobileNetV2 : public Model {
     for (auto index = 0; index < batch_size; ++index) {
       auto resize_image =
           onnx_mobile_net_v2::preprocess_one(images[index], size);
-      onnx_mobile_net_v2::set_input_image(
-          resize_image, input_data_0.data() + batch_element_size * index);
+      // image / 128 - 1
+      set_input_image_hwc(resize_image,
+                          input_data_0.data() + batch_element_size * index,
+                          128.0f, 1.0f / 128.0f);
     }
   }
   std::vector<Image> postprocess(const std::vector<Image>& images) override {
@@ -3,6 +3,7 @@
 #include <opencv2/imgproc.hpp>
 
 #include "onnx/onnx.hpp"
+#include "processing/image_preprocess.hpp"
 namespace onnx_resnet50 {
 
 cv::Mat croppedImage(const cv::Mat& image, int height, int width) {
@@ -13,22 +14,6 @@ cv::Mat croppedImage(const cv::Mat& image, int height, int width) {
   cropped_img = image(box).clone();
   return cropped_img;
 }
-//(image_data - mean) * scale, BRG2RGB and hwc2chw
-static void set_input_image(const cv::Mat& image, float* data) {
-  static float mean[3] = {103.53f, 116.28f, 123.675f};
-  static float scales[3] = {0.017429f, 0.017507f, 0.01712475f};
-  for (int c = 0; c < 3; c++) {
-    for (int h = 0; h < image.rows; h++) {
-      for (int w = 0; w < image.cols; w++) {
-        auto c_t = abs(c - 2);  // BRG to RGB
-        auto image_data =
-            (image.at<cv::Vec3b>(h, w)[c_t] - mean[c_t]) * scales[c_t];
-        data[c * image.rows * image.cols + h * image.cols + w] =
-            (float)image_data;
-      }
-    }
-  }
-}
 
 static std::vector<float> softmax(float* data, int64_t size) {
   auto output = std::vector<float>(size);
@@ -102,7 +87,10 @@ Image show_reusult(Image& image, const Result& result) {
 }  // namespace onnx_resnet50
 class Resnet50 : public Model {
  public:
-  Resnet50() {}
+  Resnet50() {
+    means_ = std::vector<float>{103.53f, 116.28f, 123.675f};
+    scales_ = std::vector<float>{0.017429f, 0.017507f, 0.01712475f};
+  }
   virtual ~Resnet50() {}
   void preprocess(const std::vector<Image>& images) override {
     std::vector<float>& input_data_0 = session_->get_input(0);
@@ -120,8 +108,10 @@ class Resnet50 : public Model {
     auto size = cv::Size((int)width, (int)height);
     for (auto index = 0; index < batch_size; ++index) {
       auto resize_image = onnx_resnet50::preprocess_one(images[index], size);
-      onnx_resnet50::set_input_image(
-          resize_image, input_data_0.data() + batch_element_size * index);
+      // BGR->RGB
+      set_input_image_chw(resize_image,
+                          input_data_0.data() + batch_element_size * index,
+                          means_, scales_, true);
     }
   }
   std::vector<Image> postprocess(const std::vector<Image>& images) override {
@@ -149,5 +139,9 @@ class Resnet50 : public Model {
     }
     return image_results;
   }
+
+ private:
+  std::vector<float> means_;
+  std::vector<float> scales_;
 };
 REGISTER_MODEL(resnet50, Resnet50)
\ No newline at end of file
@@ -3,222 +3,128 @@
 #include <opencv2/imgproc.hpp>
 
 #include "onnx/onnx.hpp"
+#include "processing/image_preprocess.hpp"
+#include "util/nms.hpp"
 namespace retinaface {
 struct Result {
   struct Face {
-    std::vector<float> bbox;  // x, y, width, height
+    std::vector<float> bbox;  // x1, y1, x2, y2
     float score;
+    std::vector<float> landmarks;  // x, y of 5 points, empty without them
   };
   std::vector<Face> faces;
 };
 
-struct SelectedOutput {
-  float score;
-  int index;
-  std::vector<float> box;
-  std::vector<float> box_decoded;
-  friend inline bool operator<(const SelectedOutput& lhs,
-                               const SelectedOutput& rhs) {
-    return lhs.score < rhs.score;
-  }
-
-  friend inline bool operator>(const SelectedOutput& lhs,
-                               const SelectedOutput& rhs) {
-    return lhs.score > rhs.score;
-  }
+// The prior boxes of an input size as a struct of arrays : centers and sizes,
+// normalized to the input
+struct Priors {
+  int width{0};
+  int height{0};
+  std::vector<float> cx;
+  std::vector<float> cy;
+  std::vector<float> w;
+  std::vector<float> h;
+  std::size_t size() const { return cx.size(); }
 };
-std::vector<std::vector<float>> generate_anchors() {
-  int width = 320;
-  int height = 320;
-  std::vector<std::vector<int>> min_sizes{{16, 32}, {64, 128}, {256, 512}};
-  std::vector<int> steps{8, 16, 32};
-  std::vector<std::vector<int>> feat_maps;
-  int anchor_cnt = 0;
-  for (auto k = 0u; k < min_sizes.size(); ++k) {
-    feat_maps.emplace_back(
-        std::vector<int>{int(std::ceil(((float)height) / steps[k])),
-                         int(std::ceil(((float)width) / steps[k]))});
-    anchor_cnt += feat_maps[k][0] * feat_maps[k][1] *
-                  static_cast<int>(min_sizes[k].size());
+
+Priors generate_priors(int width, int height) {
+  static const int min_sizes[3][2] = {{16, 32}, {64, 128}, {256, 512}};
+  static const int steps[3] = {8, 16, 32};
+  Priors priors;
+  priors.width = width;
+  priors.height = height;
+  std::size_t count = 0;
+  for (auto k = 0; k < 3; ++k) {
+    count += std::size_t(std::ceil((float)height / steps[k])) *
+             std::size_t(std::ceil((float)width / steps[k])) * 2;
   }
-  // std::cout << "anchor_cnt:" << anchor_cnt;
-  std::vector<std::vector<float>> anchors(anchor_cnt,
-                                          std::vector<float>(4, 0.f));
-  auto index = 0;
-  for (auto k = 0u; k < min_sizes.size(); ++k) {
+  priors.cx.reserve(count);
+  priors.cy.reserve(count);
+  priors.w.reserve(count);
+  priors.h.reserve(count);
+  for (auto k = 0; k < 3; ++k) {
+    auto rows = int(std::ceil((float)height / steps[k]));
+    auto cols = int(std::ceil((float)width / steps[k]));
     auto x_step = ((float)steps[k]) / width;
     auto y_step = ((float)steps[k]) / height;
     auto x_start = 0.5f * x_step;
     auto y_start = 0.5f * y_step;
-    for (auto i = 0; i < feat_maps[k][0]; ++i) {
-      for (auto j = 0; j < feat_maps[k][1]; ++j) {
+    for (auto i = 0; i < rows; ++i) {
+      for (auto j = 0; j < cols; ++j) {
         for (auto min_size : min_sizes[k]) {
-          auto s_kx = (float)min_size / width;
-          auto s_ky = (float)min_size / height;
-          anchors[index][0] = x_start + j * x_step;
-          anchors[index][1] = y_start + i * y_step;
-          anchors[index][2] = s_kx;
-          anchors[index][3] = s_ky;
-          index++;
+          priors.cx.push_back(x_start + j * x_step);
+          priors.cy.push_back(y_start + i * y_step);
+          priors.w.push_back((float)min_size / width);
+          priors.h.push_back((float)min_size / height);
         }
       }
     }
   }
-  return anchors;
-}
-
-void decode(const float* src, const float* anchor, float* dst) {
-  std::vector<float> variance{0.1f, 0.2f};
-  dst[0] = anchor[0] + variance[0] * anchor[2] * src[0];
-  dst[1] = anchor[1] + variance[0] * anchor[3] * src[1];
-  dst[2] = anchor[2] * std::exp(src[2] * variance[1]);
-  dst[3] = anchor[3] * std::exp(src[3] * variance[1]);
-  dst[0] -= dst[2] / 2;
-  dst[1] -= dst[3] / 2;
-  dst[2] += dst[0];
-  dst[3] += dst[1];
-}
-std::vector<std::vector<SelectedOutput>> select(
-    float* loc_ptr, float* conf_ptr, const std::vector<int64_t>& conf_shape,
-    int64_t batch_size, float score_thresh) {
-  auto batch = batch_size;
-  auto feat_map_size = conf_shape[1];
-
-  auto conf_last_dim = conf_shape[2];
-  static auto loc_last_dim = 4;
-  std::vector<std::vector<SelectedOutput>> batch_result(batch);
-  for (auto b = 0; b < batch; ++b) {
-    auto& result = batch_result[b];
-    result.reserve(200);
-    auto cur_conf_ptr = conf_ptr + b * feat_map_size * conf_last_dim;
-    auto cur_loc_ptr = loc_ptr + b * feat_map_size * loc_last_dim;
-    for (auto i = 0; i < feat_map_size; ++i) {
-      if (cur_conf_ptr[i * conf_last_dim + 1] > score_thresh) {
-        auto index = i;
-        auto score = cur_conf_ptr[i * conf_last_dim + 1];
-        auto box = std::vector<float>(cur_loc_ptr + i * loc_last_dim,
-                                      cur_loc_ptr + (i + 1) * loc_last_dim);
-
-        auto select = SelectedOutput{score, index, box, box};
-        result.emplace_back(select);
-      }
-    }
-  }
-  return batch_result;
+  return priors;
 }
 
-std::vector<SelectedOutput> topK(const std::vector<SelectedOutput>& input,
-                                 int k) {
-  // assert(k >= 0);
-  int size = (int)input.size();
-  int num = std::min(size, k);
-  std::vector<SelectedOutput> result(input.begin(), input.begin() + num);
-  std::make_heap(result.begin(), result.begin() + num, std::greater<>());
-  for (auto i = num; i < size; ++i) {
-    if (input[i] > result[0]) {
-      std::pop_heap(result.begin(), result.end(), std::greater<>());
-      result[num - 1] = input[i];
+// Decodes the faces of a frame in a single sweep : the priors whose face
+// score is over score_thresh are gathered first, only the max_num best of
+// them are kept, then their boxes (x1, y1, x2, y2, normalized) and their 5
+// landmarks when landms is not null are decoded with no dependency between
+// the candidates. exp() is only computed for the candidates, not for each
+// prior.
+void decode_faces(const Priors& priors, const float* loc, const float* conf,
+                  int conf_dim, const float* landms, float score_thresh,
+                  std::size_t max_num, std::vector<int>& selected,
+                  vitis::ai::NmsBoxes& boxes, std::vector<float>& landmarks) {
+  static const float variance[2] = {0.1f, 0.2f};
+  auto n = priors.size();
+  selected.clear();
+  for (std::size_t i = 0; i < n; ++i) {
+    if (conf[i * conf_dim + 1] > score_thresh) {
+      selected.push_back((int)i);
     }
   }
-
-  for (auto i = 0; i < num; ++i) {
-    std::pop_heap(result.begin(), result.begin() + num - i, std::greater<>());
+  if (selected.size() > max_num) {
+    std::nth_element(selected.begin(), selected.begin() + max_num,
+                     selected.end(), [&](int l, int r) {
+                       return conf[l * conf_dim + 1] > conf[r * conf_dim + 1];
+                     });
+    selected.resize(max_num);
   }
-  // std::stable_sort(result.begin(), result.end(), compare);
-  return result;
-}
-
-static float overlap(float x1, float w1, float x2, float w2) {
-  float left = std::max(x1 - w1 / 2.0f, x2 - w2 / 2.0f);
-  float right = std::min(x1 + w1 / 2.0f, x2 + w2 / 2.0f);
-  return right - left;
-}
-
-float cal_iou_xywh(std::vector<float>& box, std::vector<float>& truth) {
-  float w = overlap(box[0], box[2], truth[0], truth[2]);
-  float h = overlap(box[1], box[3], truth[1], truth[3]);
-  if (w < 0 || h < 0) return 0;
-
-  float inter_area = w * h;
-  float union_area = box[2] * box[3] + truth[2] * truth[3] - inter_area;
-  return inter_area * 1.0f / union_area;
-}
-
-float cal_iou_xyxy(std::vector<float>& box, std::vector<float>& truth) {
-  float box_w = box[2] - box[0];
-  float box_h = box[3] - box[1];
-  float truth_w = truth[2] - truth[0];
-  float truth_h = truth[3] - truth[1];
-  float w = overlap(box[0], box_w, truth[0], truth_w);
-  float h = overlap(box[1], box_h, truth[1], truth_h);
-  if (w < 0 || h < 0) return 0;
-
-  float inter_area = w * h;
-  float union_area = box_w * box_h + truth_w * truth_h - inter_area;
-  return inter_area * 1.0f / union_area;
-}
-
-float cal_iou_yxyx(std::vector<float> box, std::vector<float> truth) {
-  float box_h = box[2] - box[0];
-  float box_w = box[3] - box[1];
-  float truth_h = truth[2] - truth[0];
-  float truth_w = truth[3] - truth[1];
-  float h = overlap(box[0], box_h, truth[0], truth_h);
-  float w = overlap(box[1], box_w, truth[1], truth_w);
-  if (w < 0 || h < 0) return 0;
-
-  float inter_area = w * h;
-  float union_area = box_w * box_h + truth_w * truth_h - inter_area;
-  return inter_area * 1.0f / union_area;
-}
-
-std::vector<SelectedOutput> nms(std::vector<SelectedOutput>& candidates,
-                                float nms_thresh, float score_thresh,
-                                int max_output_num, bool need_sort) {
-  std::vector<SelectedOutput> result;
-  auto compare = [](const SelectedOutput& l, const SelectedOutput& r) {
-    return l.score >= r.score;
-  };
 
-  // Todo: sort
-  if (need_sort) {
-    std::stable_sort(candidates.begin(), candidates.end(), compare);
+  auto m = selected.size();
+  boxes.x1.resize(m);
+  boxes.y1.resize(m);
+  boxes.x2.resize(m);
+  boxes.y2.resize(m);
+  boxes.score.resize(m);
+  boxes.label.assign(m, 0);
+  const int* index = selected.data();
+  for (std::size_t k = 0; k < m; ++k) {
+    auto i = index[k];
+    const float* l = loc + i * 4;
+    auto pw = priors.w[i];
+    auto ph = priors.h[i];
+    auto cx = priors.cx[i] + variance[0] * pw * l[0];
+    auto cy = priors.cy[i] + variance[0] * ph * l[1];
+    auto w = pw * std::exp(l[2] * variance[1]);
+    auto h = ph * std::exp(l[3] * variance[1]);
+    boxes.x1[k] = cx - w / 2;
+    boxes.y1[k] = cy - h / 2;
+    boxes.x2[k] = cx + w / 2;
+    boxes.y2[k] = cy + h / 2;
+    boxes.score[k] = conf[i * conf_dim + 1];
   }
 
-  // nms;
-  auto size = candidates.size();
-  std::vector<bool> exist_box(size, true);
-  for (size_t i = 0; i < size; ++i) {
-    if (!exist_box[i]) {
-      continue;
-    }
-    if (candidates[i].score < score_thresh) {
-      exist_box[i] = false;
-      continue;
-    }
-    result.push_back(candidates[i]);
-    for (size_t j = i + 1; j < size; ++j) {
-      if (!exist_box[j]) {
-        continue;
-      }
-      if (candidates[j].score < score_thresh) {
-        exist_box[j] = false;
-        continue;
-      }
-      float overlap = 0.0;
-      overlap =
-          cal_iou_xyxy(candidates[i].box_decoded, candidates[j].box_decoded);
-      if (overlap >= nms_thresh) {
-        exist_box[j] = false;
-      }
+  landmarks.resize(landms ? m * 10 : 0);
+  for (std::size_t k = 0; landms && k < m; ++k) {
+    auto i = index[k];
+    const float* l = landms + i * 10;
+    float* dst = landmarks.data() + k * 10;
+    for (auto p = 0; p < 5; ++p) {
+      dst[2 * p] = priors.cx[i] + l[2 * p] * variance[0] * priors.w[i];
+      dst[2 * p + 1] = priors.cy[i] + l[2 * p + 1] * variance[0] * priors.h[i];
     }
   }
-
-  if (result.size() > (unsigned int)max_output_num) {
-    result.resize(max_output_num);
-  }
-  return result;
 }
+
 cv::Mat preprocess_one(const cv::Mat& image, cv::Size size) {
   cv::Mat resized_image;
   if (image.size() != size) {
@@ -228,27 +134,6 @@ cv::Mat preprocess_one(const cv::Mat& image, cv::Size size) {
   }
   return resized_image;
 }
-void set_input_image_internal(const cv::Mat& image, float* data,
-                              const std::vector<float>& mean,
-                              const std::vector<float>& scale, bool btrans) {
-  // BGR->RGB (maybe) and HWC->CHW
-  for (int c = 0; c < 3; c++) {
-    for (int h = 0; h < image.rows; h++) {
-      for (int w = 0; w < image.cols; w++) {
-        auto c_t = btrans ? abs(c - 2) : c;
-        auto image_data =
-            (image.at<cv::Vec3b>(h, w)[c_t] - mean[c_t]) * scale[c_t];
-        data[c * image.rows * image.cols + h * image.cols + w] =
-            (float)image_data;
-      }
-    }
-  }
-}
-void set_input_image_bgr(const cv::Mat& image, float* data,
-                         const std::vector<float>& mean,
-                         const std::vector<float>& scale) {
-  return set_input_image_internal(image, data, mean, scale, false);
-}
 Image show_reusult(Image& image, const Result& result) {
   for (auto i = 0u; i < result.faces.size(); ++i) {
     auto& face = result.faces[i];
@@ -258,6 +143,12 @@ Image show_reusult(Image& image, const Result& result) {
     int h = static_cast<int>((face.bbox[3] - face.bbox[1]) * image.rows);
     cv::rectangle(image, cv::Point(x, y), cv::Point(x + w, y + h),
                   cv::Scalar(0, 255, 255), 2, 1, 0);
+    for (auto p = 0u; p + 1 < face.landmarks.size(); p += 2) {
+      cv::circle(image,
+                 cv::Point(static_cast<int>(face.landmarks[p] * image.cols),
+                           static_cast<int>(face.landmarks[p + 1] * image.rows)),
+                 2, cv::Scalar(0, 255, 0), -1);
+    }
   }
   cv::putText(image, std::string("RETINAFACE"), cv::Point(20, image.rows - 10),
               cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 255, 255), 1, 1);
@@ -267,7 +158,6 @@ Image show_reusult(Image& image, const Result& result) {
 class Retinaface : public Model {
  public:
   Retinaface() {
-    anchors_ = retinaface::generate_anchors();
     means_ = std::vector<float>{104.0f, 117.0f, 123.0f};
     scales_ = std::vector<float>{1, 1, 1};
   }
@@ -288,44 +178,70 @@ class Retinaface : public Model {
     auto size = cv::Size((int)width, (int)height);
     for (auto index = 0; index < batch_size; ++index) {
       auto resize_image = retinaface::preprocess_one(images[index], size);
-      retinaface::set_input_image_bgr(
+      set_input_image_chw(
           resize_image, input_data_0.data() + batch_element_size * index,
-          means_, scales_);
+          means_, scales_, false);
     }
   }
   std::vector<Image> postprocess(const std::vector<Image>& images) override {
-    static int pre_nms_num = 1000;
+    static std::size_t pre_nms_num = 1000;
     static auto nms_thresh = 0.2f;
-    static int max_output_num = 200;
+    static std::size_t max_output_num = 200;
     static auto score_thresh = 0.048f;
 
     auto ouput_shape_conf = session_->get_output_shape_from_tensor(1);
     auto batch_size = images.size();
-    std::vector<retinaface::Result> batch_results(batch_size);
-    auto loc_ptr = session_->get_output(0);
-    auto conf_ptr = session_->get_output(1);
-    // 1. select all scores over score_thresh
-    auto batch_selected = retinaface::select(
-        loc_ptr, conf_ptr, ouput_shape_conf, batch_size, score_thresh);
+    const auto& input_shape = session_->get_input_shape(0);
+    if (priors_.width != input_shape[3] || priors_.height != input_shape[2]) {
+      priors_ = retinaface::generate_priors((int)input_shape[3],
+                                            (int)input_shape[2]);
+    }
+    auto num_priors = ouput_shape_conf[1];
+    auto conf_dim = (int)ouput_shape_conf[2];
+    CHECK_WITH_INFO(num_priors == (int64_t)priors_.size(),
+                    "retinaface : " + std::to_string(num_priors) +
+                        " outputs for " + std::to_string(priors_.size()) +
+                        " priors");
+    auto outputs = session_->get_outputs();
+    auto loc_ptr = outputs[0];
+    auto conf_ptr = outputs[1];
+    // the landmarks output, [batch, priors, 10], of the models that have it
+    float* landms_ptr = nullptr;
+    if (outputs.size() > 2 &&
+        session_->get_output_shape_from_tensor(2).back() == 10) {
+      landms_ptr = outputs[2];
+    }
 
-    for (auto b = 0; b < batch_size; ++b) {
-      // 2. topk
-      auto topk_selected = topK(batch_selected[b], pre_nms_num);
-      // 3. decode
-      for (auto i = 0u; i < topk_selected.size(); ++i) {
-        auto index = topk_selected[i].index;
-        // 3.1 decode box
-        retinaface::decode(topk_selected[i].box.data(), anchors_[index].data(),
-                           topk_selected[i].box_decoded.data());
-      }
-      // 4. nms
-      auto nms_result = retinaface::nms(topk_selected, nms_thresh, score_thresh,
-                                        max_output_num, false);
-      //  5. make result
-      batch_results[b].faces.resize(nms_result.size());
-      for (auto i = 0u; i < nms_result.size(); ++i) {
-        batch_results[b].faces[i].score = nms_result[i].score;
-        batch_results[b].faces[i].bbox = nms_result[i].box_decoded;
+    // 1. decode the best faces over score_thresh of each frame
+    frame_boxes_.resize(batch_size);
+    frame_landmarks_.resize(batch_size);
+    std::vector<const vitis::ai::NmsBoxes*> frames;
+    for (auto b = 0u; b < batch_size; ++b) {
+      retinaface::decode_faces(
+          priors_, loc_ptr + b * num_priors * 4,
+          conf_ptr + b * num_priors * conf_dim,
+          landms_ptr ? landms_ptr + b * num_priors * 10 : nullptr,
+          score_thresh, pre_nms_num, selected_, frame_boxes_[b],
+          frame_landmarks_[b]);
+      frames.push_back(&frame_boxes_[b]);
+    }
+    // 2. nms, the frames of the batch at once
+    nms_.run_batch(frames, nms_thresh, max_output_num, keeps_);
+    // 3. make result
+    std::vector<retinaface::Result> batch_results(batch_size);
+    for (auto b = 0u; b < batch_size; ++b) {
+      const auto& boxes = frame_boxes_[b];
+      const auto& landmarks = frame_landmarks_[b];
+      auto& faces = batch_results[b].faces;
+      faces.resize(keeps_[b].size());
+      for (auto i = 0u; i < keeps_[b].size(); ++i) {
+        auto k = keeps_[b][i];
+        faces[i].score = boxes.score[k];
+        faces[i].bbox = {boxes.x1[k], boxes.y1[k], boxes.x2[k], boxes.y2[k]};
+        if (!landmarks.empty()) {
+          faces[i].landmarks.assign(landmarks.begin() + k * 10,
+                                    landmarks.begin() + (k + 1) * 10);
+        }
       }
     }
 
@@ -342,6 +258,12 @@ class Retinaface : public Model {
  private:
   std::vector<float> means_;
   std::vector<float> scales_;
-  std::vector<std::vector<float>> anchors_;
+  retinaface::Priors priors_;
+  // work buffers of postprocess, kept between the frames
+  std::vector<int> selected_;
+  std::vector<vitis::ai::NmsBoxes> frame_boxes_;
+  std::vector<std::vector<float>> frame_landmarks_;
+  std::vector<std::vector<std::size_t>> keeps_;
+  vitis::ai::Nms nms_;
 };
 REGISTER_MODEL(retinaface, Retinaface)
\ No newline at end of file
@@ -1,29 +1,68 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
 #include "onnx/onnx.hpp"
+#include "processing/image_preprocess.hpp"
 namespace segmentation {
+// Index of the largest of the c channels of each of the g pixels of a CHW
+// output, the first one on ties like std::max_element. The channel planes
+// are read in turn over chunks of pixels whose running max stays in cache,
+// there is no dependency between the pixels of the inner loop, which the
+// compiler vectorizes.
 template <class T>
-void max_index_c(T* d, int c, int g, uint8_t* results) {
-  for (int i = 0; i < g; ++i) {
-    auto it = std::max_element(d, d + c);
-    results[i] = it - d;
-    d += c;
-  }
-}
-template <typename T>
-std::vector<T> permute(const T* input, size_t C, size_t H, size_t W) {
-  std::vector<T> output(C * H * W);
-  for (auto c = 0u; c < C; c++) {
-    for (auto h = 0u; h < H; h++) {
-      for (auto w = 0u; w < W; w++) {
-        output[h * W * C + w * C + c] = input[c * H * W + h * W + w];
+void max_index_c(const T* d, int c, int g, uint8_t* results) {
+  constexpr int CHUNK = 1024;
+  T best[CHUNK];
+  for (int p = 0; p < g; p += CHUNK) {
+    const int n = std::min(CHUNK, g - p);
+    uint8_t* labels = results + p;
+    std::copy(d + p, d + p + n, best);
+    std::fill(labels, labels + n, uint8_t(0));
+    for (int ch = 1; ch < c; ++ch) {
+      const T* x = d + (size_t)ch * g + p;
+      for (int i = 0; i < n; ++i) {
+        const bool greater = x[i] > best[i];
+        best[i] = greater ? x[i] : best[i];
+        labels[i] = greater ? uint8_t(ch) : labels[i];
       }
     }
   }
-  return output;
+}
+
+// Origins of the tiles of size tile covering [0, len), overlapping by at
+// least overlap, spread evenly with the last one on the end
+static std::vector<int> tile_origins(int len, int tile, int overlap) {
+  if (len <= tile) {
+    return {0};
+  }
+  int step = std::max(tile - overlap, 1);
+  int n = std::max((len - overlap + step - 1) / step, 2);
+  std::vector<int> origins(n);
+  for (int i = 0; i < n; i++) {
+    origins[i] = (int)((int64_t)i * (len - tile) / (n - 1));
+  }
+  return origins;
+}
+// The part of [origins[i], origins[i] + tile) a tile writes the labels of,
+// the overlaps are split in their middle
+static std::pair<int, int> tile_owned(const std::vector<int>& origins, int i,
+                                      int tile, int len) {
+  int begin = i == 0 ? 0 : (origins[i] + origins[i - 1] + tile) / 2;
+  int end = i + 1 == (int)origins.size()
+                ? len
+                : (origins[i + 1] + origins[i] + tile) / 2;
+  return {begin, end};
+}
+static cv::Rect scale_rect(const cv::Rect& r, float fx, float fy) {
+  int x0 = (int)std::lround(r.x * fx);
+  int y0 = (int)std::lround(r.y * fy);
+  int x1 = (int)std::lround((r.x + r.width) * fx);
+  int y1 = (int)std::lround((r.y + r.height) * fy);
+  return cv::Rect(x0, y0, x1 - x0, y1 - y0);
 }
 
 static int calculate_product(const std::vector<int64_t>& v) {
@@ -31,27 +70,6 @@ static int calculate_product(const std::vector<int64_t>& v) {
   for (auto& i : v) total *= (int)i;
   return total;
 }
-void set_input_image_internal(const cv::Mat& image, float* data,
-                              const std::vector<float>& mean,
-                              const std::vector<float>& scale, bool btrans) {
-  // BGR->RGB (maybe) and HWC->CHW
-  for (int c = 0; c < 3; c++) {
-    for (int h = 0; h < image.rows; h++) {
-      for (int w = 0; w < image.cols; w++) {
-        auto c_t = btrans ? abs(c - 2) : c;
-        auto image_data =
-            (image.at<cv::Vec3b>(h, w)[c_t] - mean[c_t]) * scale[c_t];
-        data[c * image.rows * image.cols + h * image.cols + w] =
-            (float)image_data;
-      }
-    }
-  }
-}
-void set_input_image_rgb(const cv::Mat& image, float* data,
-                         const std::vector<float>& mean,
-                         const std::vector<float>& scale) {
-  return set_input_image_internal(image, data, mean, scale, true);
-}
 struct Result {
   /// Width of input image.
   int width;
@@ -60,15 +78,35 @@ struct Result {
   /// Segmentation result. The cv::Mat type is CV_8UC1 or CV_8UC3.
   cv::Mat segmentation;
 };
+// Blends the labels scaled to the image size over the image in one pass : a
+// label above 1 is drawn with the top color of the JET map, the others with
+// its bottom one, each pixel takes the label of its nearest label pixel.
 Image show_reusult(Image& image, const Result& result) {
-  cv::Mat resized_seg;
-  cv::resize(result.segmentation, resized_seg, image.size());
-  cv::Mat thresholded_seg;
-  cv::threshold(resized_seg, thresholded_seg, 1, 255, cv::THRESH_BINARY);
-  cv::Mat colored_seg;
-  cv::applyColorMap(thresholded_seg, colored_seg, cv::COLORMAP_JET);
-  cv::Mat mixed_image;
-  cv::addWeighted(image, 0.5, colored_seg, 0.5, 0.0, mixed_image);
+  static const std::array<cv::Vec3b, 2> colors = [] {
+    cv::Mat ramp = (cv::Mat_<uint8_t>(1, 2) << 0, 255);
+    cv::Mat colored;
+    cv::applyColorMap(ramp, colored, cv::COLORMAP_JET);
+    return std::array<cv::Vec3b, 2>{colored.at<cv::Vec3b>(0, 0),
+                                    colored.at<cv::Vec3b>(0, 1)};
+  }();
+  const cv::Mat& seg = result.segmentation;
+  std::vector<int> label_x(image.cols);
+  for (int x = 0; x < image.cols; ++x) {
+    label_x[x] = std::min(seg.cols - 1, x * seg.cols / image.cols);
+  }
+  cv::Mat mixed_image(image.size(), CV_8UC3);
+  for (int y = 0; y < image.rows; ++y) {
+    const uint8_t* labels =
+        seg.ptr<uint8_t>(std::min(seg.rows - 1, y * seg.rows / image.rows));
+    const cv::Vec3b* in = image.ptr<cv::Vec3b>(y);
+    cv::Vec3b* out = mixed_image.ptr<cv::Vec3b>(y);
+    for (int x = 0; x < image.cols; ++x) {
+      const cv::Vec3b& color = colors[labels[label_x[x]] > 1];
+      for (int k = 0; k < 3; ++k) {
+        out[x][k] = uint8_t((in[x][k] + color[k] + 1) >> 1);
+      }
+    }
+  }
   cv::putText(mixed_image, std::string("SEGMENTATION"),
               cv::Point(20, image.rows - 10), cv::FONT_HERSHEY_SIMPLEX, 0.5,
               cv::Scalar(0, 255, 255), 1, 1);
@@ -82,7 +120,71 @@ class Segmentation : public Model {
     scales_ = std::vector<float>{0.017429f, 0.017507f, 0.01712475f};
   }
   virtual ~Segmentation() {}
+  // With "tiling", the frames larger than the model input are split into
+  // tiles of the input size at full resolution, overlapping by at least
+  // "tile_overlap" pixels, instead of being resized down to it. The tiles
+  // of a batch of frames run in one session run, the labels of the tiles
+  // are stitched, each pixel of an overlap from the tile it is nearest the
+  // center of. With "tile_skip_diff", a tile whose mean absolute difference
+  // to its last run is below it (in gray levels) keeps its labels. The
+  // frames at index i of the batches are compared, the tiles of a model
+  // thread are those of the frames it runs.
+  void init(const Config& config) override {
+    Model::init(config);
+    if (config.contains("tiling")) {
+      CONFIG_GET(config, bool, tiling, "tiling")
+      tiling_ = tiling;
+    }
+    if (config.contains("tile_overlap")) {
+      CONFIG_GET(config, int, tile_overlap, "tile_overlap")
+      CHECK(tile_overlap >= 0)
+      tile_overlap_ = tile_overlap;
+    }
+    if (config.contains("tile_skip_diff")) {
+      CONFIG_GET(config, int, tile_skip_diff, "tile_skip_diff")
+      CHECK(tile_skip_diff >= 0)
+      tile_skip_diff_ = tile_skip_diff;
+    }
+    // the tiles of a frame are in the batch dimension
+    CHECK_WITH_INFO(!tiling_ || max_batch_size() == 0,
+                    "tiling needs a model with a dynamic batch size")
+    const auto& input_shape_0 = session_->get_input_shape(0);
+    tile_overlap_ = std::min(
+        tile_overlap_, (int)std::min(input_shape_0[2], input_shape_0[3]) / 2);
+  }
+  Image run(const Image& image) override {
+    if (!tiling_) {
+      return Model::run(image);
+    }
+    return run(std::vector<Image>{image})[0];
+  }
+  std::vector<Image> run(const std::vector<Image>& images) override {
+    if (!tiling_) {
+      return Model::run(images);
+    }
+    preprocess(images);
+    // all the tiles may be unchanged
+    if (!tile_ids_.empty()) {
+      session_->convert_inputs();
+      session_->run();
+    }
+    return postprocess(images);
+  }
+  // The tiles to run are kept from preprocess to postprocess, a tiled run
+  // is not left in flight
+  void run_async(const std::vector<Image>& images,
+                 std::function<void(std::vector<Image>)> done) override {
+    if (!tiling_) {
+      Model::run_async(images, std::move(done));
+      return;
+    }
+    done(run(images));
+  }
   void preprocess(const std::vector<Image>& images) override {
+    if (tiling_) {
+      preprocess_tiles(images);
+      return;
+    }
     std::vector<float>& input_data_0 = session_->get_input(0);
     std::vector<int64_t>& input_shape_0 = session_->get_input_shape(0);
     int batch_size = images.size();
@@ -99,12 +201,15 @@ class Segmentation : public Model {
     cv::Mat resize_image;
     for (auto index = 0; index < batch_size; ++index) {
       cv::resize(images[index], resize_image, size);
-      segmentation::set_input_image_rgb(
+      set_input_image_chw(
           resize_image, input_data_0.data() + index * batch_element_size,
-          means_, scales_);
+          means_, scales_, true);
     }
   }
   std::vector<Image> postprocess(const std::vector<Image>& images) override {
+    if (tiling_) {
+      return postprocess_tiles(images);
+    }
     auto output_shape_0 = session_->get_output_shape_from_tensor(0);
     auto batch_size = images.size();
     auto output_0_ptr = session_->get_output(0);
@@ -116,10 +221,10 @@ class Segmentation : public Model {
     auto ow = output_shape_0[3];
     std::vector<segmentation::Result> results;
     for (auto i = 0u; i < batch_size; ++i) {
-      auto hwc = segmentation::permute(
-          output_0_ptr + i * output_0_batch_number_elements, oc, oh, ow);
       cv::Mat result(oh, ow, CV_8UC1);
-      segmentation::max_index_c(hwc.data(), oc, oh * ow, result.data);
+      segmentation::max_index_c(
+          output_0_ptr + i * output_0_batch_number_elements, (int)oc,
+          (int)(oh * ow), result.data);
       results.emplace_back(segmentation::Result{(int)ow, (int)oh, result});
     }
     std::vector<Image> image_results;
@@ -132,7 +237,149 @@ class Segmentation : public Model {
   }
 
  private:
+  struct Tile {
+    cv::Rect rect;
+    // the part of rect the tile writes the labels of
+    cv::Rect owned;
+    // quarter scale pixels of the last run of the tile
+    cv::Mat thumb;
+  };
+  struct Channel {
+    cv::Size size;
+    std::vector<Tile> tiles;
+    // labels of the frame, at the output over input scale of the model
+    cv::Mat labels;
+  };
+
+  void preprocess_tiles(const std::vector<Image>& images) {
+    std::vector<int64_t>& input_shape_0 = session_->get_input_shape(0);
+    const int height = (int)input_shape_0[2];
+    const int width = (int)input_shape_0[3];
+    if (channels_.size() < images.size()) {
+      channels_.resize(images.size());
+    }
+    tile_ids_.clear();
+    for (size_t i = 0; i < images.size(); ++i) {
+      const auto& image = images[i];
+      auto& channel = channels_[i];
+      if (channel.size != image.size()) {
+        channel = Channel{};
+        channel.size = image.size();
+        auto xs = segmentation::tile_origins(image.cols, width, tile_overlap_);
+        auto ys =
+            segmentation::tile_origins(image.rows, height, tile_overlap_);
+        for (int y = 0; y < (int)ys.size(); ++y) {
+          auto [oy0, oy1] = segmentation::tile_owned(ys, y, height, image.rows);
+          for (int x = 0; x < (int)xs.size(); ++x) {
+            auto [ox0, ox1] =
+                segmentation::tile_owned(xs, x, width, image.cols);
+            Tile tile;
+            tile.rect = cv::Rect(xs[x], ys[y], std::min(width, image.cols),
+                                 std::min(height, image.rows));
+            tile.owned = cv::Rect(ox0, oy0, ox1 - ox0, oy1 - oy0);
+            channel.tiles.push_back(tile);
+          }
+        }
+      }
+      cv::Mat thumb;
+      if (tile_skip_diff_ > 0) {
+        cv::resize(image, thumb, cv::Size(), 0.25, 0.25, cv::INTER_AREA);
+      }
+      for (size_t t = 0; t < channel.tiles.size(); ++t) {
+        auto& tile = channel.tiles[t];
+        if (tile_skip_diff_ > 0) {
+          cv::Rect r(tile.rect.x / 4, tile.rect.y / 4, tile.rect.width / 4,
+                     tile.rect.height / 4);
+          r &= cv::Rect(0, 0, thumb.cols, thumb.rows);
+          cv::Mat tile_thumb = thumb(r);
+          if (!tile.thumb.empty() && !channel.labels.empty() &&
+              cv::norm(tile_thumb, tile.thumb, cv::NORM_L1) <
+                  (double)tile_skip_diff_ * tile_thumb.total() *
+                      tile_thumb.channels()) {
+            continue;
+          }
+          tile.thumb = tile_thumb.clone();
+        }
+        tile_ids_.emplace_back(i, t);
+      }
+    }
+
+    std::vector<float>& input_data_0 = session_->get_input(0);
+    input_shape_0[0] = (int64_t)tile_ids_.size();
+    const auto batch_element_size = (size_t)input_shape_0[1] * height * width;
+    input_data_0.resize(tile_ids_.size() * batch_element_size);
+    cv::Mat resize_image;
+    for (size_t k = 0; k < tile_ids_.size(); ++k) {
+      const auto [i, t] = tile_ids_[k];
+      cv::Mat tile_image = images[i](channels_[i].tiles[t].rect);
+      if (tile_image.size() != cv::Size(width, height)) {
+        cv::resize(tile_image, resize_image, cv::Size(width, height));
+        tile_image = resize_image;
+      }
+      set_input_image_chw(tile_image,
+                          input_data_0.data() + k * batch_element_size, means_,
+                          scales_, true);
+    }
+  }
+
+  std::vector<Image> postprocess_tiles(const std::vector<Image>& images) {
+    // a channel without labels yet has all its tiles in the run
+    if (!tile_ids_.empty()) {
+      stitch_tiles(images);
+    }
+    std::vector<Image> image_results;
+    for (size_t i = 0; i < images.size(); ++i) {
+      const auto& labels = channels_[i].labels;
+      auto image = images[i];
+      image_results.push_back(segmentation::show_reusult(
+          image, segmentation::Result{labels.cols, labels.rows, labels}));
+    }
+    return image_results;
+  }
+  void stitch_tiles(const std::vector<Image>& images) {
+    auto output_shape_0 = session_->get_output_shape_from_tensor(0);
+    const auto& input_shape_0 = session_->get_input_shape(0);
+    const int oc = (int)output_shape_0[1];
+    const int oh = (int)output_shape_0[2];
+    const int ow = (int)output_shape_0[3];
+    const float fx = (float)ow / (float)input_shape_0[3];
+    const float fy = (float)oh / (float)input_shape_0[2];
+    for (size_t i = 0; i < images.size(); ++i) {
+      auto& channel = channels_[i];
+      if (channel.labels.empty()) {
+        channel.labels = cv::Mat(
+            (int)std::lround(images[i].rows * fy),
+            (int)std::lround(images[i].cols * fx), CV_8UC1, cv::Scalar(0));
+      }
+    }
+    const float* output_0_ptr = session_->get_output(0);
+    cv::Mat tile_labels(oh, ow, CV_8UC1);
+    cv::Mat resized_labels;
+    for (size_t k = 0; k < tile_ids_.size(); ++k) {
+      auto& channel = channels_[tile_ids_[k].first];
+      const auto& tile = channel.tiles[tile_ids_[k].second];
+      segmentation::max_index_c(output_0_ptr + k * (size_t)oc * oh * ow, oc,
+                                oh * ow, tile_labels.data);
+      auto rect = segmentation::scale_rect(tile.rect, fx, fy);
+      auto owned = segmentation::scale_rect(tile.owned, fx, fy);
+      const cv::Mat* labels = &tile_labels;
+      if (rect.size() != tile_labels.size()) {
+        cv::resize(tile_labels, resized_labels, rect.size(), 0, 0,
+                   cv::INTER_NEAREST);
+        labels = &resized_labels;
+      }
+      owned &= cv::Rect(0, 0, channel.labels.cols, channel.labels.rows);
+      (*labels)(owned - rect.tl()).copyTo(channel.labels(owned));
+    }
+  }
+
   std::vector<float> means_;
   std::vector<float> scales_;
+  bool tiling_{false};
+  int tile_overlap_{64};
+  int tile_skip_diff_{0};
+  std::vector<Channel> channels_;
+  // frame and tile index of the tiles of the batch of the run
+  std::vector<std::pair<size_t, size_t>> tile_ids_;
 };
 REGISTER_MODEL(segmentation, Segmentation)
\ No newline at end of file
@@ -4,64 +4,16 @@
 #include <opencv2/imgproc.hpp>
 
 #include "onnx/onnx.hpp"
+#include "processing/image_preprocess.hpp"
+#include "util/nms.hpp"
 namespace yolovx {
 
-static float overlap(float x1, float w1, float x2, float w2) {
-  float left = (float)std::max(x1 - w1 / 2.0, x2 - w2 / 2.0);
-  float right = (float)std::min(x1 + w1 / 2.0, x2 + w2 / 2.0);
-  return right - left;
+static float letterbox_scale(const cv::Mat& im, int w, int h) {
+  return std::min((float)w / (float)im.cols, (float)h / (float)im.rows);
 }
-
-static float cal_iou(const std::vector<float>& box,
-                     const std::vector<float>& truth) {
-  float w = overlap(box[0], box[2], truth[0], truth[2]);
-  float h = overlap(box[1], box[3], truth[1], truth[3]);
-  if (w < 0 || h < 0) return 0;
-
-  float inter_area = w * h;
-  float union_area = box[2] * box[3] + truth[2] * truth[3] - inter_area;
-  return (float)(inter_area * 1.0 / union_area);
-}
-
-static void applyNMS(const std::vector<std::vector<float>>& boxes,
-                     const std::vector<float>& scores, const float nms,
-                     const float conf, std::vector<size_t>& res) {
-  const size_t count = boxes.size();
-  std::vector<std::pair<float, size_t>> order;
-  for (size_t i = 0; i < count; ++i) {
-    order.push_back({scores[i], i});
-  }
-  sort(order.begin(), order.end(),
-       [](const std::pair<float, size_t>& ls,
-          const std::pair<float, size_t>& rs) { return ls.first > rs.first; });
-  std::vector<size_t> ordered;
-  transform(order.begin(), order.end(), back_inserter(ordered),
-            [](auto& km) { return km.second; });
-  std::vector<bool> exist_box(count, true);
-
-  for (size_t _i = 0; _i < count; ++_i) {
-    size_t i = ordered[_i];
-    if (!exist_box[i]) continue;
-    if (scores[i] < conf) {
-      exist_box[i] = false;
-      continue;
-    }
-    /* add a box as result */
-    res.push_back(i);
-    // cout << "nms push "<< i<<endl;
-    for (size_t _j = _i + 1; _j < count; ++_j) {
-      size_t j = ordered[_j];
-      if (!exist_box[j]) continue;
-      float ovr = 0.0;
-      ovr = cal_iou(boxes[j], boxes[i]);
-      if (ovr >= nms) exist_box[j] = false;
-    }
-  }
-}
-
 static void letterbox(const cv::Mat& im, int w, int h, cv::Mat& om,
                       float& scale) {
-  scale = std::min((float)w / (float)im.cols, (float)h / (float)im.rows);
+  scale = letterbox_scale(im, w, h);
   cv::Mat img_res;
   if (im.size() != cv::Size(w, h)) {
     cv::resize(im, img_res, cv::Size(im.cols * scale, im.rows * scale), 0, 0,
@@ -89,27 +41,6 @@ cv::Mat preprocess_one(const cv::Mat& image, cv::Size size) {
   }
   return resized_image;
 }
-void set_input_image_internal(const cv::Mat& image, float* data,
-                              const std::vector<float>& mean,
-                              const std::vector<float>& scale, bool btrans) {
-  // BGR->RGB (maybe) and HWC->CHW
-  for (int c = 0; c < 3; c++) {
-    for (int h = 0; h < image.rows; h++) {
-      for (int w = 0; w < image.cols; w++) {
-        auto c_t = btrans ? abs(c - 2) : c;
-        auto image_data =
-            (image.at<cv::Vec3b>(h, w)[c_t] - mean[c_t]) * scale[c_t];
-        data[c * image.rows * image.cols + h * image.cols + w] =
-            (float)image_data;
-      }
-    }
-  }
-}
-void set_input_image_bgr(const cv::Mat& image, float* data,
-                         const std::vector<float>& mean,
-                         const std::vector<float>& scale) {
-  return set_input_image_internal(image, data, mean, scale, false);
-}
 // return value
 struct Result {
   /**
@@ -243,27 +174,39 @@ class Yolovx : public Model {
       cv::Mat resized_image;
       float& scale = scales[index];
       yolovx::letterbox(images[index], width, height, resized_image, scale);
-      yolovx::set_input_image_bgr(
-          resized_image, input_data_0.data() + batch_size * index,
-          std::vector<float>{0, 0, 0}, std::vector<float>{1, 1, 1});
+      set_input_image_chw(
+          resized_image, input_data_0.data() + batch_element_size * index,
+          std::vector<float>{0, 0, 0}, std::vector<float>{1, 1, 1}, false);
     }
   }
   std::vector<Image> postprocess(const std::vector<Image>& images) override {
     auto batch_size = images.size();
-    std::vector<yolovx::Result> results;
+    // the scales of preprocess may be those of the next run already when
+    // the runs are in flight, see Model::run_async
+    const auto& input_shape_0 = session_->get_input_shape(0);
+    scales.resize(batch_size);
+    for (auto index = 0; index < batch_size; ++index) {
+      scales[index] = yolovx::letterbox_scale(
+          images[index], (int)input_shape_0[3], (int)input_shape_0[2]);
+    }
+    frame_boxes_.resize(batch_size);
+    std::vector<const vitis::ai::NmsBoxes*> frames;
     for (auto index = 0; index < batch_size; ++index) {
-      results.emplace_back(postprocess_one(index));
+      decode_one(index, frame_boxes_[index]);
+      frames.push_back(&frame_boxes_[index]);
     }
+    /* Apply the computation for NMS, the frames of the batch at once */
+    nms_.run_batch(frames, nms_thresh, max_nms_num, keeps_);
     std::vector<Image> image_results;
     for (auto index = 0; index < batch_size; ++index) {
-      auto result = results[index];
+      auto result = make_result(index, frame_boxes_[index], keeps_[index]);
       auto image = images[index];
       image_results.push_back(yolovx::show_reusult(image, result));
     }
     return image_results;
   }
-  yolovx::Result postprocess_one(int idx) {
-    std::vector<std::vector<float>> boxes;
+  void decode_one(int idx, vitis::ai::NmsBoxes& boxes) {
+    boxes.clear();
 
     int conf_box = 5 + num_classes;
 
@@ -278,7 +221,6 @@ class Yolovx : public Model {
       //               << ", stride=" << stride[i] << ", conf=" << conf_thresh
       //               << ", idx=" << idx << endl;
       //   }
-      boxes.reserve(boxes.size() + ha * wa);
       float* output_ptr = session_->get_output(i);
 #define POS(C) ((C) * ha * wa + h * wa + w)
       for (int h = 0; h < ha; ++h) {
@@ -287,21 +229,18 @@ class Yolovx : public Model {
             float score =
                 output_ptr[POS(c * conf_box + 4) + idx * ca * ha * wa];
             if (score < conf_desigmoid) continue;
-            std::vector<float> box(6);
-            std::vector<float> out(4);
+            float out[4];
             for (int index = 0; index < 4; index++) {
               out[index] =
                   output_ptr[POS(c * conf_box + index) + idx * ca * ha * wa];
             }
-            box[0] = (w + out[0]) * stride[i];
-            box[1] = (h + out[1]) * stride[i];
-            box[2] = exp(out[2]) * stride[i];
-            box[3] = exp(out[3]) * stride[i];
+            float box_w = exp(out[2]) * stride[i];
+            float box_h = exp(out[3]) * stride[i];
+            float x1 = (w + out[0]) * stride[i] - box_w * 0.5f;
+            float y1 = (h + out[1]) * stride[i] - box_h * 0.5f;
             float obj_score = yolovx::sigmoid(score);
             auto conf_class_desigmoid = -logf(obj_score / conf_thresh - 1.0f);
             int max_p = -1;
-            box[0] = box[0] - box[2] * 0.5;
-            box[1] = box[1] - box[3] * 0.5;
             for (int p = 0; p < num_classes; p++) {
               float cls_score =
                   output_ptr[POS(c * conf_box + 5 + p) + idx * ca * ha * wa];
@@ -310,44 +249,29 @@ class Yolovx : public Model {
               conf_class_desigmoid = cls_score;
             }
             if (max_p != -1) {
-              box[4] = max_p;
-              box[5] = obj_score * yolovx::sigmoid(conf_class_desigmoid);
-              boxes.push_back(box);
+              boxes.push_back(
+                  x1, y1, x1 + box_w, y1 + box_h, max_p,
+                  obj_score * yolovx::sigmoid(conf_class_desigmoid));
             }
           }
         }
       }
+#undef POS
     }
-    /* Apply the computation for NMS */
-    std::vector<std::vector<std::vector<float>>> boxes_for_nms(num_classes);
-    std::vector<std::vector<float>> scores(num_classes);
-
-    for (const auto& box : boxes) {
-      boxes_for_nms[box[4]].push_back(box);
-      scores[box[4]].push_back(box[5]);
-    }
-
-    std::vector<std::vector<float>> res;
-    for (auto i = 0; i < num_classes; i++) {
-      std::vector<size_t> result_k;
-      yolovx::applyNMS(boxes_for_nms[i], scores[i], nms_thresh, conf_thresh,
-                       result_k);
-      res.reserve(res.size() + result_k.size());
-      transform(result_k.begin(), result_k.end(), back_inserter(res),
-                [&](auto& k) { return boxes_for_nms[i][k]; });
-    }
-
+  }
+  yolovx::Result make_result(int idx, const vitis::ai::NmsBoxes& boxes,
+                             const std::vector<std::size_t>& keep) {
     std::vector<yolovx::Result::BoundingBox> results;
-    for (const auto& r : res) {
-      if (r[5] > conf_thresh) {
+    for (auto k : keep) {
+      if (boxes.score[k] > conf_thresh) {
         yolovx::Result::BoundingBox result;
-        result.score = r[5];
-        result.label = r[4];
+        result.score = boxes.score[k];
+        result.label = boxes.label[k];
         result.box.resize(4);
-        result.box[0] = r[0] / scales[idx];
-        result.box[1] = r[1] / scales[idx];
-        result.box[2] = result.box[0] + r[2] / scales[idx];
-        result.box[3] = result.box[1] + r[3] / scales[idx];
+        result.box[0] = boxes.x1[k] / scales[idx];
+        result.box[1] = boxes.y1[k] / scales[idx];
+        result.box[2] = boxes.x2[k] / scales[idx];
+        result.box[3] = boxes.y2[k] / scales[idx];
         results.push_back(result);
       }
     }
@@ -361,8 +285,13 @@ class Yolovx : public Model {
   float conf_thresh{0.f};
   float conf_desigmoid{0.f};
   float nms_thresh{0.65f};
+  std::size_t max_nms_num{300};
   int num_classes{80};
   int anchor_cnt{1};
+  // reused by the frames
+  std::vector<vitis::ai::NmsBoxes> frame_boxes_;
+  vitis::ai::Nms nms_;
+  std::vector<std::vector<std::size_t>> keeps_;
   std::vector<std::vector<int64_t>> output_shapes_;
 };
 REGISTER_MODEL(yolovx, Yolovx)
\ No newline at end of file
@@ -2,10 +2,16 @@
 #include <onnxruntime_cxx_api.h>
 #include <onnxruntime_session_options_config_keys.h>
 
+#include <chrono>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <sstream>
 #include <string>
 #if _WIN32
+#include <dml_provider_factory.h>
+
 #include <codecvt>
 #include <locale>
 using convert_t = std::codecvt_utf8<wchar_t>;
@@ -15,7 +21,9 @@ inline std::wstring_convert<convert_t, wchar_t> strconverter;
 #include <functional>
 #include <iostream>
 
+#include "processing/engine_monitor.hpp"
 #include "processing/sync_image_to_image_model.hpp"
+#include "session_cache.hpp"
 #include "util/check.hpp"
 #include "util/config.hpp"
 #include "util/fs.hpp"
@@ -28,19 +36,24 @@ class SessionManager {
   }
   struct SessionInfo {
     std::string model_name_;
-    Ort::Env env_;
     Ort::SessionOptions session_options_;
     std::shared_ptr<Ort::Session> session_;
   };
+  // Sessions of all the models are created on one env. A singleton session is
+  // shared by the ModelTask threads of the model, which call Run on it
+  // concurrently with their own IoBinding.
+  // A model placed on several engines has a session per engine.
   Ort::Session* get(const std::string& model_name, const Config& config) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::string engine_key = model_name + "#" + engine_of(config);
     if (is_singleton_) {
-      auto iter = sessions_.find(model_name);
+      auto iter = sessions_.find(engine_key);
       if (iter == sessions_.end()) {
-        sessions_[model_name] = build_session(model_name, config);
+        sessions_[engine_key] = build_session(model_name, config);
       }
-      return sessions_[model_name].session_.get();
+      return sessions_[engine_key].session_.get();
     } else {
-      std::string model_key = model_name + "@" + std::to_string(model_counter);
+      std::string model_key = engine_key + "@" + std::to_string(model_counter);
       sessions_[model_key] = build_session(model_name, config);
       model_counter++;
       return sessions_[model_key].session_.get();
@@ -49,14 +62,29 @@ class SessionManager {
   SessionInfo build_session(const std::string& model_name,
                             const Config& config) {
     SessionInfo session_info;
-    session_info.env_ = Ort::Env(ORT_LOGGING_LEVEL_WARNING, model_name.c_str());
     session_info.session_options_ = Ort::SessionOptions();
     auto& session_options_ = session_info.session_options_;
     auto options = std::unordered_map<std::string, std::string>({});
 
-    if (!config.contains("using_onnx_ep")) {
-      // CONFIG_GET(config, bool, using_onnx_ep, "using_onnx_ep")
-      // if (!using_onnx_ep) {
+    auto engine = engine_of(config);
+    std::string cache_state;
+    if (engine == "igpu") {
+      PRINT("Using DirectML")
+      const OrtDmlApi* dml_api = nullptr;
+      Ort::ThrowOnError(Ort::GetApi().GetExecutionProviderApi(
+          "DML", ORT_API_VERSION, reinterpret_cast<const void**>(&dml_api)));
+      int dml_device_id = 0;
+      if (config.contains("dml_device_id")) {
+        CONFIG_GET(config, int, device_id, "dml_device_id")
+        CHECK(device_id >= 0)
+        dml_device_id = device_id;
+      }
+      // DML does not support memory patterns nor parallel execution
+      session_options_.DisableMemPattern();
+      session_options_.SetExecutionMode(ExecutionMode::ORT_SEQUENTIAL);
+      Ort::ThrowOnError(dml_api->SessionOptionsAppendExecutionProvider_DML(
+          session_options_, dml_device_id));
+    } else if (engine == "npu") {
       PRINT("Using VitisAI")
       if (config.contains("vaip_config")) {
         CONFIG_GET(config, std::string, vaip_config_path, "vaip_config")
@@ -68,19 +96,40 @@ class SessionManager {
         options["config_file"] = "../bin/vaip_config.json";
         CHECK(is_file("../bin/vaip_config.json"))
       }
+      if (!cache_dir_.empty()) {
+        SessionCacheKey key;
+        key.add_file(model_name);
+        key.add_file(options["config_file"]);
+        key.add_string(Ort::GetVersionString());
+        auto cache_key = key.str(model_name);
+        bool cache_warm = is_session_cache_warm(cache_dir_, cache_key);
+        CHECK_WITH_INFO(cache_warm || !require_cache_,
+                        "no cache " + cache_key + " in " + cache_dir_ +
+                            " for " + model_name +
+                            ", build it first with --build-cache")
+        options["cacheDir"] = cache_dir_;
+        options["cacheKey"] = cache_key;
+        cache_state = cache_warm ? " (cache hit " : " (cache miss ";
+        cache_state += cache_key + ")";
+      }
       session_options_.AppendExecutionProvider_VitisAI(options);
     }
-    {
-      CONFIG_GET(config, int, onnx_x, "onnx_x")
-      CHECK(onnx_x >= 0)
-      PRINT("Setting intra_op_num_threads to " << onnx_x);
-      session_options_.SetIntraOpNumThreads(onnx_x);
-    }
-    {
-      CONFIG_GET(config, int, onnx_y, "onnx_y")
-      CHECK(onnx_y >= 0)
-      PRINT("Setting inter_op_num_threads to " << onnx_y);
-      session_options_.SetInterOpNumThreads(onnx_y);
+    if (global_thread_pool_) {
+      PRINT("Using the global thread pool, ignoring onnx_x and onnx_y");
+      session_options_.DisablePerSessionThreads();
+    } else {
+      {
+        CONFIG_GET(config, int, onnx_x, "onnx_x")
+        CHECK(onnx_x >= 0)
+        PRINT("Setting intra_op_num_threads to " << onnx_x);
+        session_options_.SetIntraOpNumThreads(onnx_x);
+      }
+      {
+        CONFIG_GET(config, int, onnx_y, "onnx_y")
+        CHECK(onnx_y >= 0)
+        PRINT("Setting inter_op_num_threads to " << onnx_y);
+        session_options_.SetInterOpNumThreads(onnx_y);
+      }
     }
     if (config.contains("onnx_disable_spinning")) {
       PRINT("Disabling intra-op thread spinning entirely");
@@ -102,17 +151,70 @@ class SessionManager {
           intra_op_thread_affinities.c_str());
     }
     auto model_name_basic = strconverter.from_bytes(model_name);
-    session_info.session_.reset(new Ort::Session(
-        session_info.env_, model_name_basic.c_str(), session_options_));
+    auto start = std::chrono::steady_clock::now();
+    session_info.session_.reset(
+        new Ort::Session(env(), model_name_basic.c_str(), session_options_));
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+    PRINT("Session of " << model_name << " created in " << ms << " ms"
+                        << cache_state)
     return session_info;
   }
 
   void set_singleton(bool flag) { is_singleton_ = flag; }
 
+  // The VitisAI EP keeps the compiled models in cache_dir, under a key of
+  // the model and its vaip config. With require_cache a model missing from
+  // the cache is an error instead of being compiled at startup, the cache
+  // is built beforehand with --build-cache.
+  void set_session_cache(const std::string& cache_dir, bool require_cache) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    CHECK(!cache_dir.empty())
+    std::filesystem::create_directories(cache_dir);
+    cache_dir_ = absolute(cache_dir);
+    require_cache_ = require_cache;
+    PRINT("Session cache in " << cache_dir_
+                              << (require_cache_ ? ", required" : ""))
+  }
+
+  // Must be called before the first session is created. The sessions then
+  // run on the thread pools of the env instead of creating their own.
+  void set_global_thread_pool(int intra_op_num_threads,
+                              int inter_op_num_threads) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    CHECK_WITH_INFO(env_ == nullptr, "env already created")
+    CHECK(intra_op_num_threads >= 0)
+    CHECK(inter_op_num_threads >= 0)
+    PRINT("Setting global thread pool to " << intra_op_num_threads << " intra "
+                                           << inter_op_num_threads
+                                           << " inter op threads");
+    Ort::ThreadingOptions threading_options;
+    threading_options.SetGlobalIntraOpNumThreads(intra_op_num_threads);
+    threading_options.SetGlobalInterOpNumThreads(inter_op_num_threads);
+    env_ = std::make_unique<Ort::Env>(
+        threading_options, ORT_LOGGING_LEVEL_WARNING, "npu_multi_models");
+    global_thread_pool_ = true;
+  }
+
  private:
   SessionManager() {}
+  // Caller should hold mtx_
+  Ort::Env& env() {
+    if (env_ == nullptr) {
+      env_ = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING,
+                                        "npu_multi_models");
+    }
+    return *env_;
+  }
+  std::mutex mtx_;
   bool is_singleton_{false};
+  bool global_thread_pool_{false};
+  std::string cache_dir_;
+  bool require_cache_{false};
   int model_counter{0};
+  // declared before the sessions, which are destroyed first
+  std::unique_ptr<Ort::Env> env_;
   std::map<std::string, SessionInfo> sessions_;
 };
 std::vector<std::vector<int64_t>> get_input_shapes(Ort::Session* session) {
@@ -186,9 +288,16 @@ class SessionHelper {
         SessionManager::get_instance().get(onnx_model_path, session_config);
     input_shapes_ = get_input_shapes(session_);
     output_shapes_ = get_output_shapes(session_);
+    // a dynamic batch dimension is negative
+    max_batch_size_ = input_shapes_[0][0] > 0 ? int(input_shapes_[0][0]) : 0;
     input_tensor_values_.resize(input_shapes_.size());
     get_input_names(session_, input_names_ptr_, input_node_names_);
     get_output_names(session_, output_names_ptr_, output_node_names_);
+    io_binding_ = std::make_unique<Ort::IoBinding>(*session_);
+    for (size_t i = 0; i < input_shapes_.size(); i++) {
+      input_tensors_.emplace_back(nullptr);
+    }
+    bound_inputs_.resize(input_shapes_.size());
     PRINT("ONNX file: " << onnx_model_path)
     std::cout << this->summary_to_string();
   }
@@ -196,6 +305,8 @@ class SessionHelper {
   std::vector<int64_t>& get_input_shape(int index) {
     return input_shapes_[index];
   }
+  // Batch size of the model, 0 if it is dynamic
+  int get_max_batch_size() const { return max_batch_size_; }
   std::vector<float>& get_input(int index) {
     return input_tensor_values_[index];
   }
@@ -209,33 +320,96 @@ class SessionHelper {
     return output_tensors_[index].GetTensorTypeAndShapeInfo().GetShape();
   }
   void run() {
-    output_tensors_ =
-        session_->Run(Ort::RunOptions{nullptr}, input_node_names_.data(),
-                      input_tensors_.data(), input_tensors_.size(),
-                      output_node_names_.data(), output_node_names_.size());
+    session_->Run(Ort::RunOptions{nullptr}, *io_binding_);
+    if (dynamic_outputs_) {
+      output_tensors_ = io_binding_->GetOutputValues();
+    }
   }
+  // A run in flight with RunAsync. It owns the inputs it was given, its
+  // outputs are allocated by ORT.
+  struct AsyncRun {
+    std::vector<std::vector<float>> input_values;
+    std::vector<std::vector<int64_t>> input_shapes;
+    std::vector<Ort::Value> input_tensors;
+    std::vector<Ort::Value> output_tensors;
+    std::string error;
+    std::function<void(std::unique_ptr<AsyncRun>)> done;
+  };
+  // Runs the current inputs without waiting for the outputs. The input
+  // buffers are handed over to the run, so the next inputs can be prepared
+  // while it is in flight. done is called on an ORT thread once the run is
+  // over, use_outputs() then makes its outputs those of get_output().
+  // RunAsync needs an intra op thread pool, onnx_x must not be 1.
+  void run_async(std::function<void(std::unique_ptr<AsyncRun>)> done) {
+    std::unique_ptr<AsyncRun> run;
+    {
+      std::lock_guard<std::mutex> lock(async_mtx_);
+      if (!free_runs_.empty()) {
+        run = std::move(free_runs_.back());
+        free_runs_.pop_back();
+      }
+    }
+    if (!run) {
+      run = std::make_unique<AsyncRun>();
+      run->input_values.resize(input_shapes_.size());
+    }
+    // the buffers of a previous run come back, without reallocation
+    run->input_values.swap(input_tensor_values_);
+    run->input_shapes = input_shapes_;
+    run->input_tensors.clear();
+    for (size_t i = 0; i < input_shapes_.size(); i++) {
+      auto& data = run->input_values[i];
+      auto& shape = run->input_shapes[i];
+      run->input_tensors.push_back(Ort::Value::CreateTensor<float>(
+          memory_info_, data.data(), data.size(), shape.data(), shape.size()));
+    }
+    run->output_tensors.clear();
+    for (size_t i = 0; i < output_shapes_.size(); i++) {
+      run->output_tensors.emplace_back(nullptr);
+    }
+    run->error.clear();
+    run->done = std::move(done);
+    // owned by on_run_async_done once the run is started
+    session_->RunAsync(Ort::RunOptions{nullptr}, input_node_names_.data(),
+                       run->input_tensors.data(), run->input_tensors.size(),
+                       output_node_names_.data(), run->output_tensors.data(),
+                       run->output_tensors.size(), on_run_async_done,
+                       run.get());
+    run.release();
+  }
+  // The outputs and input shapes of get_output() and get_input_shape() are
+  // those of the run until the next run, the run is recycled. Callers
+  // serialize this with the preparation of the inputs.
+  void use_outputs(std::unique_ptr<AsyncRun> run) {
+    output_tensors_ = std::move(run->output_tensors);
+    input_shapes_ = run->input_shapes;
+    // the outputs bound for run() were replaced
+    bound_batch_size_ = -1;
+    run->input_tensors.clear();
+    run->done = nullptr;
+    std::lock_guard<std::mutex> lock(async_mtx_);
+    free_runs_.push_back(std::move(run));
+  }
+  // Tensors and their bindings are only rebuilt when the input buffers or
+  // shapes change, a frame of the same size does no ORT allocation.
   void convert_inputs() {
     size_t input_arg_num = input_shapes_.size();
-    if (!input_tensors_.empty()) {
-      for (size_t index = 0; index < input_arg_num; index++) {
-        Ort::MemoryInfo info =
-            Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-        std::vector<int64_t> input_shape = input_shapes_[index];
-        std::vector<float>& data = input_tensor_values_[index];
-        input_tensors_[index] = Ort::Value::CreateTensor<float>(
-            info, data.data(), data.size(), input_shape.data(),
-            input_shape.size());
-      }
-    } else {
-      for (size_t index = 0; index < input_arg_num; index++) {
-        Ort::MemoryInfo info =
-            Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-        std::vector<int64_t> input_shape = input_shapes_[index];
-        std::vector<float>& data = input_tensor_values_[index];
-        input_tensors_.push_back(Ort::Value::CreateTensor<float>(
-            info, data.data(), data.size(), input_shape.data(),
-            input_shape.size()));
+    for (size_t index = 0; index < input_arg_num; index++) {
+      std::vector<int64_t>& input_shape = input_shapes_[index];
+      std::vector<float>& data = input_tensor_values_[index];
+      if (bound_inputs_[index].data == data.data() &&
+          bound_inputs_[index].size == data.size() &&
+          bound_inputs_[index].shape == input_shape) {
+        continue;
       }
+      input_tensors_[index] = Ort::Value::CreateTensor<float>(
+          memory_info_, data.data(), data.size(), input_shape.data(),
+          input_shape.size());
+      io_binding_->BindInput(input_node_names_[index], input_tensors_[index]);
+      bound_inputs_[index] = {data.data(), data.size(), input_shape};
+    }
+    if (input_shapes_[0][0] != bound_batch_size_) {
+      bind_outputs(input_shapes_[0][0]);
     }
   }
   std::vector<float*> get_outputs() {
@@ -252,6 +426,48 @@ class SessionHelper {
     // PRINT("size " << output_tensors_.size() << " " << output_shapes_.size())
     return output_tensors_[index].GetTensorMutableData<float>();
   }
+  // Outputs are preallocated for a batch when their shape is only dynamic
+  // in the batch dimension, otherwise ORT allocates them at each run.
+  void bind_outputs(int64_t batch_size) {
+    io_binding_->ClearBoundOutputs();
+    dynamic_outputs_ = false;
+    std::vector<std::vector<int64_t>> shapes = output_shapes_;
+    for (auto& shape : shapes) {
+      if (!shape.empty() && shape[0] < 0) {
+        shape[0] = batch_size;
+      }
+      for (auto dim : shape) {
+        dynamic_outputs_ = dynamic_outputs_ || dim < 0;
+      }
+    }
+    output_tensors_.clear();
+    output_tensor_values_.resize(shapes.size());
+    for (size_t i = 0; i < shapes.size(); i++) {
+      if (dynamic_outputs_) {
+        io_binding_->BindOutput(output_node_names_[i], memory_info_);
+        continue;
+      }
+      int64_t size = std::accumulate(shapes[i].begin(), shapes[i].end(),
+                                     int64_t{1}, std::multiplies<int64_t>());
+      auto& data = output_tensor_values_[i];
+      data.resize(size_t(size));
+      output_tensors_.push_back(Ort::Value::CreateTensor<float>(
+          memory_info_, data.data(), data.size(), shapes[i].data(),
+          shapes[i].size()));
+      io_binding_->BindOutput(output_node_names_[i], output_tensors_[i]);
+    }
+    bound_batch_size_ = batch_size;
+  }
+  static void on_run_async_done(void* user_data, OrtValue** outputs,
+                                size_t num_outputs, OrtStatusPtr status) {
+    std::unique_ptr<AsyncRun> run{static_cast<AsyncRun*>(user_data)};
+    Ort::Status run_status{status};
+    if (!run_status.IsOK()) {
+      run->error = run_status.GetErrorMessage();
+    }
+    auto done = std::move(run->done);
+    done(std::move(run));
+  }
   std::string summary_to_string() {
     std::stringstream ss;
     CHECK(input_node_names_.size() == input_shapes_.size());
@@ -281,6 +497,21 @@ class SessionHelper {
   std::vector<const char*> input_node_names_;
   std::vector<Ort::AllocatedStringPtr> output_names_ptr_;
   std::vector<const char*> output_node_names_;
+  int max_batch_size_{0};
+  struct BoundInput {
+    const float* data{nullptr};
+    size_t size{0};
+    std::vector<int64_t> shape;
+  };
+  Ort::MemoryInfo memory_info_{
+      Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)};
+  std::unique_ptr<Ort::IoBinding> io_binding_;
+  std::vector<BoundInput> bound_inputs_;
+  std::vector<std::vector<float>> output_tensor_values_;
+  int64_t bound_batch_size_{-1};
+  bool dynamic_outputs_{false};
+  std::mutex async_mtx_;
+  std::vector<std::unique_ptr<AsyncRun>> free_runs_;
 };
 class Model : public SyncImageToImageModel {
  public:
@@ -298,9 +529,41 @@ class Model : public SyncImageToImageModel {
     auto result = postprocess(images);
     return result[0];
   }
+  std::vector<Image> run(const std::vector<Image>& images) override {
+    preprocess(images);
+    session_->convert_inputs();
+    session_->run();
+    return postprocess(images);
+  }
+  // The inputs are prepared and the outputs read under mtx_, the inference
+  // itself runs outside of it, so a run can be in flight while the next
+  // one is prepared. A failed run passes its images through.
+  void run_async(const std::vector<Image>& images,
+                 std::function<void(std::vector<Image>)> done) override {
+    std::lock_guard<std::mutex> lock(mtx_);
+    preprocess(images);
+    session_->run_async(
+        [this, images, done = std::move(done)](
+            std::unique_ptr<SessionHelper::AsyncRun> run) {
+          std::vector<Image> results = images;
+          {
+            std::lock_guard<std::mutex> lock(mtx_);
+            auto error = run->error;
+            session_->use_outputs(std::move(run));
+            if (error.empty()) {
+              results = postprocess(images);
+            } else {
+              PRINT("onnx run failed: " << error)
+            }
+          }
+          done(std::move(results));
+        });
+  }
+  int max_batch_size() const override { return session_->get_max_batch_size(); }
 
  protected:
   virtual void preprocess(const std::vector<Image>& input) = 0;
   virtual std::vector<Image> postprocess(const std::vector<Image>& input) = 0;
   std::unique_ptr<SessionHelper> session_{nullptr};
+  std::mutex mtx_;
 };
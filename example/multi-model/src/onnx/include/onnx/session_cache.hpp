@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "util/check.hpp"
+// Key of the compiled VitisAI EP artifacts of a model, under the cache dir
+// of the SessionManager.
+//
+// The key hashes the bytes of the model and of its vaip config, plus the
+// session options the compilation depends on, so a cache built for another
+// model or config is never picked up: a changed model gets a new key and is
+// compiled again instead of running stale artifacts.
+class SessionCacheKey {
+ public:
+  void add_file(const std::string& file_path) {
+    std::ifstream f{file_path, std::ios::binary};
+    CHECK_WITH_INFO(f.good(), file_path)
+    std::vector<char> buffer(1 << 20);
+    while (f) {
+      f.read(buffer.data(), buffer.size());
+      add(buffer.data(), size_t(f.gcount()));
+    }
+  }
+  void add_string(const std::string& value) {
+    add(value.data(), value.size());
+    // separator, "ab" + "c" differs from "a" + "bc"
+    add("", 1);
+  }
+  // <model file stem>_<16 hex digits>
+  std::string str(const std::string& model_path) const {
+    std::stringstream ss;
+    ss << std::filesystem::path{model_path}.stem().string() << "_" << std::hex
+       << std::setw(16) << std::setfill('0') << hash_;
+    return ss.str();
+  }
+
+ private:
+  // FNV-1a
+  void add(const char* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      hash_ ^= uint8_t(data[i]);
+      hash_ *= 0x100000001b3ull;
+    }
+  }
+  uint64_t hash_{0xcbf29ce484222325ull};
+};
+
+// The EP writes the artifacts of a key in <cache_dir>/<key>
+inline bool is_session_cache_warm(const std::string& cache_dir,
+                                  const std::string& cache_key) {
+  auto dir = std::filesystem::path{cache_dir} / cache_key;
+  return std::filesystem::is_directory(dir) &&
+         !std::filesystem::is_empty(dir);
+}
@@ -6,11 +6,15 @@
 #include <map>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include "frame_info.hpp"
 #include "global.hpp"
+#include "motion_gate.hpp"
+#include "npu_scheduler.hpp"
 #include "queue.hpp"
 #include "task.hpp"
+#include "util/frame_pool.hpp"
 #include "util/fs.hpp"
 
 bool is_camera(const std::string& file) {
@@ -135,6 +139,19 @@ class DecodeTask : public AsyncTask {
   virtual ~DecodeTask() {}
   std::string video_file_;
   std::shared_ptr<BoundedFrameQueue> output_queue_{nullptr};
+  int npu_slot_{-1};
+  // only the frames that changed go to the models when set
+  std::unique_ptr<MotionGate> motion_gate_;
+
+ protected:
+  // false when the frame should be dropped, see NpuScheduler
+  bool admit() {
+    return NpuScheduler::instance().admit(
+        npu_slot_, output_queue_->size() >= output_queue_->capacity());
+  }
+  void gate(FrameInfo& frame) {
+    frame.reuse = motion_gate_ && !motion_gate_->changed(frame.mat);
+  }
 };
 class DecodeCameraTask : public DecodeTask {
  public:
@@ -149,16 +166,30 @@ class DecodeCameraTask : public DecodeTask {
     open_stream();
   }
   void run() override {
-    FrameInfo frameinfo{0, ++frame_id_};
+    auto buffer = pool_.acquire();
+    if (buffer == nullptr) {
+      // all the frames are in flight
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      return;
+    }
+    FrameInfo frameinfo{0, 0};
+    trace_stamp(frameinfo.trace, Stage::DECODE);
     auto& cap = *video_stream_.get();
-    cv::Mat image;
+    cv::Mat& image = *buffer;
     cap.read(image);
     auto video_ended = image.empty();
     if (video_ended) {
       open_stream();
       return;
     }
+    // the camera is read anyway, so that the next frame is a new one
+    if (!admit()) {
+      return;
+    }
+    frameinfo.frame_id = ++frame_id_;
     frameinfo.mat = image;
+    gate(frameinfo);
+    trace_stamp(frameinfo.trace, Stage::QUEUE, (int)output_queue_->size());
     while (!output_queue_->push(frameinfo, std::chrono::milliseconds(500))) {
       if (g_is_stopped()) {
         return;
@@ -179,6 +210,7 @@ class DecodeCameraTask : public DecodeTask {
   }
   unsigned long frame_id_{0};
   std::unique_ptr<cv::VideoCapture> video_stream_{};
+  vitis::ai::FramePool pool_{(size_t)GLOBAL_DECODE_FRAME_POOL_SIZE};
 };
 // template <typename T>
 // class Generator {
@@ -307,11 +339,20 @@ class DecodeVideoTask : public DecodeTask {
     images_ = video_cache.get_ref(video_file_);
   }
   void run() override {
+    // the video goes on while frames are dropped
+    auto position = ++position_;
+    if (!admit()) {
+      std::this_thread::sleep_for(GLOBAL_DECODE_TASK_SLEEP_DURATION);
+      return;
+    }
     // channel_id set in sort work
     FrameInfo frameinfo{0, ++frame_id_};
+    trace_stamp(frameinfo.trace, Stage::DECODE);
     cv::Mat image;
-    images_->operator[](frame_id_ % images_->size()).copyTo(image);
+    images_->operator[](position % images_->size()).copyTo(image);
     frameinfo.mat = image;
+    gate(frameinfo);
+    trace_stamp(frameinfo.trace, Stage::QUEUE, (int)output_queue_->size());
     while (!output_queue_->push(frameinfo, std::chrono::milliseconds(500))) {
       if (g_is_stopped()) {
         return;
@@ -322,8 +363,81 @@ class DecodeVideoTask : public DecodeTask {
 
  private:
   unsigned long frame_id_{0};
+  unsigned long position_{0};
   std::vector<cv::Mat>* images_;
 };
+// Decodes the video file frame by frame instead of caching all of it, with
+// the hardware decoder of the OpenCV backend when it has one (D3D11VA on
+// Windows, VAAPI on Linux). Frames are decoded into a FramePool and go to
+// the models without a copy.
+class DecodeStreamTask : public DecodeTask {
+ public:
+  DecodeStreamTask() {}
+  virtual ~DecodeStreamTask() {}
+  void init(const Config& config) override {
+    output_queue_ =
+        std::make_shared<BoundedFrameQueue>(GLOBAL_BOUNDED_QUEUE_CAPACITY);
+    CONFIG_GET(config, std::string, video_file, "video_file_path")
+    CHECK_WITH_INFO(is_file(video_file), video_file)
+    video_file_ = absolute(video_file);
+    CHECK_WITH_INFO(!is_camera(video_file), video_file)
+    open_stream();
+    auto acceleration =
+        (int)video_stream_->get(cv::CAP_PROP_HW_ACCELERATION);
+    PRINT("Hardware acceleration: "
+          << (acceleration == cv::VIDEO_ACCELERATION_NONE ? "none"
+                                                           : "enabled"))
+  }
+  void run() override {
+    if (!admit()) {
+      // skipped without being converted and copied to a buffer
+      if (!video_stream_->grab()) {
+        open_stream();
+      }
+      std::this_thread::sleep_for(GLOBAL_DECODE_TASK_SLEEP_DURATION);
+      return;
+    }
+    auto buffer = pool_.acquire();
+    if (buffer == nullptr) {
+      // all the frames are in flight
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      return;
+    }
+    // channel_id set in sort work
+    FrameInfo frameinfo{0, 0};
+    trace_stamp(frameinfo.trace, Stage::DECODE);
+    if (!video_stream_->read(*buffer)) {
+      // start over at the end of the file
+      open_stream();
+      return;
+    }
+    frameinfo.frame_id = ++frame_id_;
+    frameinfo.mat = *buffer;
+    gate(frameinfo);
+    trace_stamp(frameinfo.trace, Stage::QUEUE, (int)output_queue_->size());
+    while (!output_queue_->push(frameinfo, std::chrono::milliseconds(500))) {
+      if (g_is_stopped()) {
+        return;
+      }
+    }
+    std::this_thread::sleep_for(GLOBAL_DECODE_TASK_SLEEP_DURATION);
+  }
+
+ private:
+  void open_stream() {
+    video_stream_ = std::make_unique<cv::VideoCapture>(
+        video_file_, cv::CAP_ANY,
+        std::vector<int>{cv::CAP_PROP_HW_ACCELERATION,
+                         cv::VIDEO_ACCELERATION_ANY});
+    if (!video_stream_->isOpened()) {
+      PRINT("can't open: " << video_file_);
+      g_stop();
+    }
+  }
+  unsigned long frame_id_{0};
+  std::unique_ptr<cv::VideoCapture> video_stream_{};
+  vitis::ai::FramePool pool_{(size_t)GLOBAL_DECODE_FRAME_POOL_SIZE};
+};
 namespace image_list_helper {
 std::pair<int, int> cal_max_height_and_width(std::vector<cv::Mat>& images) {
   int fold_height{0};
@@ -391,12 +505,21 @@ class DecodeImageListTask : public DecodeTask {
     images_ = video_cache.get_ref(video_file_);
   }
   void run() override {
+    // the images go on while frames are dropped
+    auto position = ++position_;
+    if (!admit()) {
+      std::this_thread::sleep_for(GLOBAL_DECODE_TASK_SLEEP_DURATION);
+      return;
+    }
     // channel_id set in sort work
     FrameInfo frameinfo{0, ++frame_id_};
+    trace_stamp(frameinfo.trace, Stage::DECODE);
     cv::Mat image;
-    images_->operator[]((frame_id_ / repeat_frame_per_image_) % images_->size())
+    images_->operator[]((position / repeat_frame_per_image_) % images_->size())
         .copyTo(image);
     frameinfo.mat = image;
+    gate(frameinfo);
+    trace_stamp(frameinfo.trace, Stage::QUEUE, (int)output_queue_->size());
     while (!output_queue_->push(frameinfo, std::chrono::milliseconds(500))) {
       if (g_is_stopped()) {
         return;
@@ -407,10 +530,14 @@ class DecodeImageListTask : public DecodeTask {
 
  private:
   unsigned long frame_id_{0};
+  unsigned long position_{0};
   int repeat_frame_per_image_{10};
   std::vector<cv::Mat>* images_{nullptr};
 };
-std::shared_ptr<DecodeTask> make_decode_task(const std::string& file) {
+// video_cache decodes a video file once into memory, to loop over the first
+// GLOBAL_VIDEO_FILE_MAX_FRAME_COUNT frames without decoding them again
+std::shared_ptr<DecodeTask> make_decode_task(const std::string& file,
+                                             bool video_cache = false) {
   PRINT("Decoding file: " << absolute(file))
   if (is_camera(file)) {
     PRINT("Building camera decode task")
@@ -420,9 +547,13 @@ std::shared_ptr<DecodeTask> make_decode_task(const std::string& file) {
     PRINT("Building image list decode task")
     return std::dynamic_pointer_cast<DecodeTask>(
         std::make_shared<DecodeImageListTask>());
-  } else {
+  } else if (video_cache) {
     PRINT("Building video decode task")
     return std::dynamic_pointer_cast<DecodeTask>(
         std::make_shared<DecodeVideoTask>());
+  } else {
+    PRINT("Building video stream decode task")
+    return std::dynamic_pointer_cast<DecodeTask>(
+        std::make_shared<DecodeStreamTask>());
   }
 }
\ No newline at end of file
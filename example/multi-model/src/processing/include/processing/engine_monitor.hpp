@@ -0,0 +1,120 @@
+#pragma once
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include "util/check.hpp"
+#include "util/config.hpp"
+
+// Engine a model session runs on, from its onnx_config: "npu" (VitisAI, the
+// default), "igpu" (DirectML) or "cpu". using_onnx_ep is the former
+// spelling of "cpu".
+inline std::string engine_of(const Config& config) {
+  if (config.contains("engine")) {
+    CONFIG_GET(config, std::string, engine, "engine")
+    CHECK_WITH_INFO(engine == "npu" || engine == "igpu" || engine == "cpu",
+                    "engine: " + engine)
+    return engine;
+  }
+  return config.contains("using_onnx_ep") ? "cpu" : "npu";
+}
+
+// Busy time of the engines the model stages run on.
+//
+// An engine is busy while at least one run of a model placed on it is in
+// flight, the runs overlapping on an engine are counted once. Utilization
+// is the busy time over the time since the first run of any engine, so the
+// engines of a cascade can be compared over the same window.
+class EngineMonitor {
+ public:
+  static EngineMonitor& instance() {
+    static EngineMonitor instance{};
+    return instance;
+  }
+
+  // Holds a run on the engine for its lifetime
+  class Run {
+   public:
+    explicit Run(const std::string& engine)
+        : engine_{engine}, start_{instance().begin(engine_)} {}
+    ~Run() { instance().end(engine_, start_); }
+    Run(const Run&) = delete;
+    Run& operator=(const Run&) = delete;
+
+   private:
+    const std::string& engine_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  bool empty() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return engines_.empty();
+  }
+
+  std::string summary() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto now = std::chrono::steady_clock::now();
+    double window_ms = std::chrono::duration<double, std::milli>(now - epoch_)
+                           .count();
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    for (auto& [name, engine] : engines_) {
+      auto busy = engine.busy;
+      if (engine.running > 0) {
+        busy += now - engine.busy_since;
+      }
+      double busy_ms = std::chrono::duration<double, std::milli>(busy).count();
+      double run_ms =
+          std::chrono::duration<double, std::milli>(engine.run_time).count();
+      ss << "engine " << name << ": "
+         << (window_ms > 0 ? 100 * busy_ms / window_ms : 0.0)
+         << "% utilization, " << engine.runs << " runs, "
+         << (engine.runs > 0 ? run_ms / engine.runs : 0.0)
+         << " ms per run, " << (busy_ms > 0 ? run_ms / busy_ms : 0.0)
+         << " runs in flight when busy\n";
+    }
+    return ss.str();
+  }
+
+ private:
+  EngineMonitor() {}
+  using Clock = std::chrono::steady_clock;
+  struct EngineState {
+    int running{0};
+    size_t runs{0};
+    Clock::time_point busy_since{};
+    Clock::duration busy{0};
+    // sum of the run times, larger than busy when runs overlap
+    Clock::duration run_time{0};
+  };
+
+  Clock::time_point begin(const std::string& engine) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto now = Clock::now();
+    if (engines_.empty()) {
+      epoch_ = now;
+    }
+    auto& state = engines_[engine];
+    if (state.running++ == 0) {
+      state.busy_since = now;
+    }
+    state.runs++;
+    return now;
+  }
+  void end(const std::string& engine, Clock::time_point start) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto now = Clock::now();
+    auto& state = engines_[engine];
+    state.run_time += now - start;
+    if (--state.running == 0) {
+      state.busy += now - state.busy_since;
+    }
+  }
+
+  std::mutex mtx_;
+  Clock::time_point epoch_{};
+  std::map<std::string, EngineState> engines_;
+};
@@ -4,6 +4,8 @@
 #include <opencv2/imgproc.hpp>
 #include <opencv2/video.hpp>
 #include <sstream>
+
+#include "frame_trace.hpp"
 // A struct that can storage data and info for each frame
 struct FrameInfo {
   int channel_id;
@@ -12,6 +14,10 @@ struct FrameInfo {
   // float max_fps;
   float fps;
   // std::string channel_name;
+  FrameTrace trace;
+  // the models pass the frame through, the sort task shows the result of
+  // the last frame that ran instead, see MotionGate
+  bool reuse{false};
 };
 
 std::string to_string(const FrameInfo& frame_info) {
@@ -0,0 +1,54 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+// The stages a frame goes through, in order
+enum class Stage : int {
+  DECODE,       // decode task starts reading the frame
+  QUEUE,        // pushed to the model tasks
+  MODEL_START,  // popped by a model task
+  MODEL_END,    // pushed to the sort task
+  SORT,         // pushed to the gui
+  DISPLAY,      // drawn on the screen
+  COUNT
+};
+constexpr int STAGE_COUNT = static_cast<int>(Stage::COUNT);
+
+inline const char* stage_name(int stage) {
+  static const char* names[STAGE_COUNT] = {
+      "decode", "queue", "model_start", "model_end", "sort", "display"};
+  return names[stage];
+}
+
+// Per frame timestamps, in microseconds since the tracer started, 0 for
+// the stages not reached yet. depth is the size of the queue the frame was
+// pushed to at that stage, -1 if there is none.
+struct FrameTrace {
+  std::array<int64_t, STAGE_COUNT> us{};
+  std::array<int, STAGE_COUNT> depth{-1, -1, -1, -1, -1, -1};
+};
+
+inline std::atomic<bool>& g_trace_enabled() {
+  static std::atomic<bool> enabled{false};
+  return enabled;
+}
+inline std::chrono::steady_clock::time_point g_trace_epoch() {
+  static auto epoch = std::chrono::steady_clock::now();
+  return epoch;
+}
+inline int64_t trace_now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - g_trace_epoch())
+             .count();
+}
+// No op unless tracing is enabled
+inline void trace_stamp(FrameTrace& trace, Stage stage, int depth = -1) {
+  if (!g_trace_enabled().load(std::memory_order_relaxed)) {
+    return;
+  }
+  // 0 means not reached
+  trace.us[static_cast<int>(stage)] = std::max<int64_t>(trace_now_us(), 1);
+  trace.depth[static_cast<int>(stage)] = depth;
+}
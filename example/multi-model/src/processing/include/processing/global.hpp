@@ -15,4 +15,6 @@ static int GLOBAL_BOUNDED_QUEUE_CAPACITY{10};
 static std::vector<cv::Rect> GLOBAL_LAYOUTS;
 static std::string GLOBAL_APP_NAME{"demo"};
 static int GLOBAL_VIDEO_FILE_MAX_FRAME_COUNT{500};
+// decoded frames of a stream in flight at most
+static int GLOBAL_DECODE_FRAME_POOL_SIZE{64};
 static std::chrono::milliseconds GLOBAL_DECODE_TASK_SLEEP_DURATION{10};
\ No newline at end of file
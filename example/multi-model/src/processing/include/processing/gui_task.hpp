@@ -1,11 +1,14 @@
 #pragma once
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <opencv2/core/ocl.hpp>
 
 #include "frame_info.hpp"
 #include "global.hpp"
+#include "pipeline_tracer.hpp"
 #include "queue.hpp"
 #include "task.hpp"
 struct FrameCache {
@@ -34,59 +37,132 @@ class GuiTask : public AsyncTask {
     for (auto& layout : layouts_) {
       PRINT("\t"<<layout)
     }
+    if (config.contains("display_fps")) {
+      CONFIG_GET(config, int32_t, display_fps, "display_fps")
+      CHECK(display_fps >= 0)
+      if (display_fps > 0) {
+        display_interval_ = std::chrono::milliseconds(1000 / display_fps);
+      }
+    }
+    if (config.contains("headless")) {
+      CONFIG_GET(config, bool, headless, "headless")
+      headless_ = headless;
+    }
+    if (config.contains("opencl")) {
+      CONFIG_GET(config, bool, opencl, "opencl")
+      use_opencl_ = opencl && cv::ocl::haveOpenCL();
+      cv::ocl::setUseOpenCL(use_opencl_);
+      if (use_opencl_) {
+        gui_show_image_.copyTo(gui_show_umat_);
+      }
+      PRINT("GUI compositing with OpenCL: " << use_opencl_)
+    }
   }
+  // Frames are taken as they come, the screen is only composed every
+  // display_interval_ from the latest frame of the channels that changed.
   void run() override {
+    auto rel_time = std::chrono::milliseconds(500);
+    if (any_dirty_) {
+      rel_time = std::clamp(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              next_display_ - std::chrono::steady_clock::now()),
+          std::chrono::milliseconds(0), rel_time);
+    }
     FrameInfo frame_info;
-    if (!input_queue_->pop(frame_info, std::chrono::milliseconds(500))) {
+    if (input_queue_->pop(frame_info, rel_time)) {
+      inactive_counter_ = 0;
+      update(frame_info);
+      drain_queue();
+    } else if (!any_dirty_) {
       inactive_counter_++;
       if (inactive_counter_ > 10) {
         PRINT("gui is starvatting!!")
       }
       return;
     }
-    inactive_counter_ = 0;
-
-    frames_[frame_info.channel_id].frame_info = frame_info;
-    frames_[frame_info.channel_id].dirty = true;
-    drain_queue();
-    bool any_dirty{false};
-    for (auto& f : frames_) {
-      if (f.second.dirty) {
-        auto& layout = layouts_[f.second.frame_info.channel_id];
-        auto x = layout.tl().x;
-        auto y = layout.tl().y;
-        auto w = layout.width;
-        auto h = layout.height;
-        cv::Mat mat_resize;
-        cv::resize(f.second.frame_info.mat, mat_resize, cv::Size(w, h));
-        mat_resize.copyTo(gui_show_image_(layout));
-      }
-      f.second.dirty = false;
-      any_dirty = true;
+    auto now = std::chrono::steady_clock::now();
+    if (!any_dirty_ || now < next_display_) {
+      return;
     }
-    if (any_dirty) {
-      cv::imshow(GLOBAL_APP_NAME, gui_show_image_);
-      auto key = cv::waitKey(1);
-      if (key == 27) {
-        return;
-      }
+    next_display_ = now + display_interval_;
+    if (headless_) {
+      record_headless(now);
+    } else {
+      show();
     }
-    drain_queue();
   }
   std::shared_ptr<BoundedFrameQueue> input_queue_{nullptr};
 
  private:
+  void update(const FrameInfo& frame_info) {
+    if (frame_info.mat.empty()) {
+      PRINT("Got empty mat")
+      return;
+    }
+    auto& cache = frames_[frame_info.channel_id];
+    if (cache.dirty) {
+      PipelineTracer::instance().drop(cache.frame_info);
+    }
+    cache.frame_info = frame_info;
+    cache.dirty = true;
+    any_dirty_ = true;
+    received_counter_++;
+  }
   void drain_queue() {
     FrameInfo frame_info;
-
-    while (!input_queue_->empty()) {
-      input_queue_->pop(frame_info);
-      if (frame_info.mat.empty()) {
-        PRINT("Got empty mat")
-        return;
+    while (input_queue_->try_pop(frame_info)) {
+      update(frame_info);
+    }
+  }
+  // Only the channels that changed are resized, straight into their part of
+  // the screen
+  void show() {
+    for (auto& f : frames_) {
+      if (!f.second.dirty) {
+        continue;
+      }
+      auto& layout = layouts_[f.second.frame_info.channel_id];
+      if (use_opencl_) {
+        auto dst = gui_show_umat_(layout);
+        cv::resize(f.second.frame_info.mat.getUMat(cv::ACCESS_READ), dst,
+                   layout.size());
+      } else {
+        auto dst = gui_show_image_(layout);
+        cv::resize(f.second.frame_info.mat, dst, layout.size());
       }
-      frames_[frame_info.channel_id].frame_info = frame_info;
-      frames_[frame_info.channel_id].dirty = true;
+      f.second.dirty = false;
+      finish(f.second.frame_info);
+    }
+    any_dirty_ = false;
+    if (use_opencl_) {
+      cv::imshow(GLOBAL_APP_NAME, gui_show_umat_);
+    } else {
+      cv::imshow(GLOBAL_APP_NAME, gui_show_image_);
+    }
+    auto key = cv::waitKey(1);
+    if (key == 27) {
+      return;
+    }
+  }
+  void finish(FrameInfo& frame_info) {
+    trace_stamp(frame_info.trace, Stage::DISPLAY);
+    PipelineTracer::instance().finish(frame_info);
+  }
+  // No window, the frames received per second are printed instead
+  void record_headless(const std::chrono::steady_clock::time_point& now) {
+    for (auto& f : frames_) {
+      if (f.second.dirty) {
+        f.second.dirty = false;
+        finish(f.second.frame_info);
+      }
+    }
+    any_dirty_ = false;
+    if (now - headless_start_ >= std::chrono::seconds(5)) {
+      auto seconds = std::chrono::duration<float>(now - headless_start_);
+      PRINT("gui received " << received_counter_ / seconds.count()
+                            << " frames/s")
+      received_counter_ = 0;
+      headless_start_ = now;
     }
   }
   std::vector<cv::Rect> cal_gui_layout(size_t height, size_t width,
@@ -111,5 +187,15 @@ class GuiTask : public AsyncTask {
   std::unique_ptr<cv::VideoWriter> video_writer_{nullptr};
   int inactive_counter_{0};
   cv::Mat gui_show_image_;
+  cv::UMat gui_show_umat_;
   std::vector<cv::Rect> layouts_;
+  bool any_dirty_{false};
+  bool headless_{false};
+  bool use_opencl_{false};
+  // 0 shows the frames as they come
+  std::chrono::milliseconds display_interval_{0};
+  std::chrono::steady_clock::time_point next_display_{};
+  std::chrono::steady_clock::time_point headless_start_{
+      std::chrono::steady_clock::now()};
+  int received_counter_{0};
 };
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "util/check.hpp"
+// Input tensors of the models from 8 bit BGR images.
+//
+// Both use the vectorized cv::split and cv::Mat::convertTo row loops instead
+// of a per pixel image.at<>(), and write to the tensor buffer in place.
+
+// (image - mean) * scale and HWC->CHW, to a channel * rows * cols buffer.
+// mean and scale are indexed by the channel of image. With swap_rb the
+// output channel c is image channel 2 - c, i.e. BGR->RGB.
+inline void set_input_image_chw(const cv::Mat& image, float* data,
+                                const std::vector<float>& mean,
+                                const std::vector<float>& scale,
+                                bool swap_rb) {
+  CHECK(image.type() == CV_8UC3)
+  CHECK(mean.size() == 3 && scale.size() == 3)
+  // reused by the next frames of the thread
+  thread_local cv::Mat planes[3];
+  cv::split(image, planes);
+  auto plane_size = (size_t)image.rows * image.cols;
+  for (int c = 0; c < 3; c++) {
+    auto c_t = swap_rb ? 2 - c : c;
+    cv::Mat output(image.rows, image.cols, CV_32FC1, data + c * plane_size);
+    planes[c_t].convertTo(output, CV_32F, scale[c_t], -mean[c_t] * scale[c_t]);
+  }
+}
+
+// (image - mean) * scale, to a rows * cols * channel buffer.
+inline void set_input_image_hwc(const cv::Mat& image, float* data, float mean,
+                                float scale) {
+  CHECK(image.type() == CV_8UC3)
+  cv::Mat output(image.rows, image.cols, CV_32FC3, data);
+  image.convertTo(output, CV_32F, scale, -mean * scale);
+}
@@ -1,45 +1,201 @@
 #pragma once
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
+#include "engine_monitor.hpp"
 #include "frame_info.hpp"
 #include "global.hpp"
+#include "npu_scheduler.hpp"
 #include "queue.hpp"
 #include "sync_image_to_image_model.hpp"
 #include "task.hpp"
 class ModelTask : public AsyncTask {
  public:
   ModelTask() {}
-  virtual ~ModelTask() {}
+  virtual ~ModelTask() {
+    // the runs in flight push to output_queue_ and use this task
+    std::unique_lock<std::mutex> lock(in_flight_mtx_);
+    in_flight_cv_.wait(lock, [this]() { return in_flight_ == 0; });
+  }
   void init(const Config& config) override {
     CONFIG_GET(config, std::string, model_type, "type")
     model_ = ModelRegister::instance().build(model_type);
     CONFIG_GET(config, Config, model_config, "config")
+    // the engine of the stage overrides the one of its onnx_config
+    if (config.contains("engine")) {
+      CONFIG_GET(config, std::string, engine, "engine")
+      CHECK(model_config.contains("onnx_config"))
+      model_config["onnx_config"]["engine"] = engine;
+    }
+    if (model_config.contains("onnx_config")) {
+      engine_ = engine_of(model_config["onnx_config"]);
+    }
     model_->init(model_config);
+    if (config.contains("batch_size")) {
+      CONFIG_GET(config, int, batch_size, "batch_size")
+      CHECK(batch_size >= 1)
+      batch_size_ = batch_size;
+    }
+    if (model_->max_batch_size() > 0) {
+      batch_size_ = std::min(batch_size_, model_->max_batch_size());
+    }
+    if (config.contains("batch_timeout_ms")) {
+      CONFIG_GET(config, int, batch_timeout_ms, "batch_timeout_ms")
+      CHECK(batch_timeout_ms >= 0)
+      batch_timeout_ = std::chrono::milliseconds(batch_timeout_ms);
+    }
+    if (config.contains("max_in_flight")) {
+      CONFIG_GET(config, int, max_in_flight, "max_in_flight")
+      CHECK(max_in_flight >= 0)
+      max_in_flight_ = max_in_flight;
+    }
   }
   void run() override {
     FrameInfo frame;
     // PRINT("model input size"<<input_queue_->size())
-    if (!input_queue_->pop(frame, std::chrono::milliseconds(500))) {
+    if (!pop(frame, std::chrono::milliseconds(500))) {
       return;
     }
-    if (model_) {
-      frame.mat = model_->run(frame.mat);
+    if (frame.reuse) {
+      pass_through(frame);
+      return;
     }
-    // PRINT("model push"<<output_queue_->size())
-    while (!output_queue_->push(frame, std::chrono::milliseconds(500))) {
-      if (g_is_stopped()) {
-        return;
+    // wait up to batch_timeout_ after the first frame to fill the batch
+    std::vector<FrameInfo> frames;
+    frames.reserve(batch_size_);
+    frames.push_back(std::move(frame));
+    auto deadline = std::chrono::steady_clock::now() + batch_timeout_;
+    while ((int)frames.size() < batch_size_) {
+      auto rel_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      if (!pop_more(frame, std::max(rel_time, std::chrono::milliseconds(0)))) {
+        break;
+      }
+      if (frame.reuse) {
+        pass_through(frame);
+        continue;
+      }
+      frames.push_back(std::move(frame));
+    }
+    // the trace of a cascade spans from its first stage to its last
+    if (!stage_input_queue_) {
+      for (auto& f : frames) {
+        trace_stamp(f.trace, Stage::MODEL_START);
+      }
+    }
+    if (model_ && max_in_flight_ > 0) {
+      run_async(std::move(frames));
+      return;
+    }
+    if (model_) {
+      std::vector<Image> images;
+      images.reserve(frames.size());
+      for (const auto& f : frames) {
+        images.push_back(f.mat);
+      }
+      std::vector<Image> results;
+      {
+        NpuScheduler::Run npu_run{npu_slot_};
+        EngineMonitor::Run engine_run{engine_};
+        results = model_->run(images);
+      }
+      for (size_t i = 0; i < frames.size(); ++i) {
+        frames[i].mat = results[i];
       }
     }
+    // PRINT("model push"<<output_queue_->size())
+    push(frames);
     return;
   }
 
  public:
-  std::shared_ptr<BoundedFrameQueue> output_queue_;
+  const std::string& engine() const { return engine_; }
+  std::shared_ptr<SortedFrameQueue> output_queue_;
+  // the first stage of a pipeline reads the decode queue, the next stages
+  // of a cascade read the reordered output of the previous stage
   std::shared_ptr<BoundedFrameQueue> input_queue_;
+  std::shared_ptr<SortedFrameQueue> stage_input_queue_;
+  int npu_slot_{-1};
 
  private:
+  void push(std::vector<FrameInfo>& frames) {
+    for (auto& f : frames) {
+      trace_stamp(f.trace, Stage::MODEL_END, (int)output_queue_->size());
+      while (!output_queue_->push(f.frame_id, f,
+                                  std::chrono::milliseconds(500))) {
+        if (g_is_stopped()) {
+          return;
+        }
+      }
+    }
+  }
+  // A frame the result of the last frame that ran is reused for, see
+  // MotionGate. The output queue is sorted, it may go ahead of the batch.
+  void pass_through(FrameInfo& frame) {
+    std::vector<FrameInfo> frames{std::move(frame)};
+    if (!stage_input_queue_) {
+      trace_stamp(frames[0].trace, Stage::MODEL_START);
+    }
+    push(frames);
+  }
+  // Up to max_in_flight_ runs of the task are in flight, the thread goes
+  // back to batching the next frames once a run is started and the frames
+  // are pushed on completion of their run. The sort task restores the
+  // order of the frames completing out of order.
+  void run_async(std::vector<FrameInfo> frames) {
+    {
+      std::unique_lock<std::mutex> lock(in_flight_mtx_);
+      in_flight_cv_.wait(lock,
+                         [this]() { return in_flight_ < max_in_flight_; });
+      in_flight_++;
+    }
+    std::vector<Image> images;
+    images.reserve(frames.size());
+    for (const auto& f : frames) {
+      images.push_back(f.mat);
+    }
+    // the run holds the NPU and its engine until it completes
+    auto npu_run = std::make_shared<NpuScheduler::Run>(npu_slot_);
+    auto engine_run = std::make_shared<EngineMonitor::Run>(engine_);
+    auto pending = std::make_shared<std::vector<FrameInfo>>(std::move(frames));
+    model_->run_async(images, [this, pending, npu_run, engine_run](
+                                  std::vector<Image> results) mutable {
+      npu_run.reset();
+      engine_run.reset();
+      for (size_t i = 0; i < pending->size(); ++i) {
+        (*pending)[i].mat = results[i];
+      }
+      push(*pending);
+      {
+        std::lock_guard<std::mutex> lock(in_flight_mtx_);
+        in_flight_--;
+      }
+      in_flight_cv_.notify_all();
+    });
+  }
+  bool pop(FrameInfo& frame, const std::chrono::milliseconds& rel_time) {
+    return stage_input_queue_ ? stage_input_queue_->pop(frame, rel_time)
+                              : input_queue_->pop(frame, rel_time);
+  }
+  // The previous stage is followed in frame order, the next frame of a batch
+  // is only taken if it is there already, a late one is not skipped
+  bool pop_more(FrameInfo& frame, const std::chrono::milliseconds& rel_time) {
+    return stage_input_queue_ ? stage_input_queue_->try_pop(frame)
+                              : input_queue_->pop(frame, rel_time);
+  }
+
   std::unique_ptr<SyncImageToImageModel> model_;
+  int batch_size_{1};
+  std::chrono::milliseconds batch_timeout_{0};
+  std::string engine_{"npu"};
+  // 0 runs the model on the task thread
+  int max_in_flight_{0};
+  int in_flight_{0};
+  std::mutex in_flight_mtx_;
+  std::condition_variable in_flight_cv_;
 };
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+#include <algorithm>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "util/check.hpp"
+#include "util/config.hpp"
+// Decides at decode which frames of a channel the models run on.
+//
+// Frames are compared on a gray thumbnail 160 pixels wide. A
+// frame whose mean absolute difference to the last frame the models ran
+// on is below diff_threshold (in gray levels) is marked for reuse: the
+// model tasks pass it through and the sort task shows the result of that
+// last frame instead. The reference is only updated by the frames that
+// run, so a slow change adds up until it is seen. At most
+// keyframe_interval frames in a row are reused.
+class MotionGate {
+ public:
+  explicit MotionGate(const Config& config) {
+    if (config.contains("diff_threshold")) {
+      CONFIG_GET(config, float, diff_threshold, "diff_threshold")
+      CHECK(diff_threshold >= 0.0f)
+      diff_threshold_ = diff_threshold;
+    }
+    if (config.contains("keyframe_interval")) {
+      CONFIG_GET(config, int, keyframe_interval, "keyframe_interval")
+      CHECK(keyframe_interval >= 0)
+      keyframe_interval_ = keyframe_interval;
+    }
+    PRINT("Motion gate: diff threshold "
+          << diff_threshold_ << ", keyframe interval " << keyframe_interval_)
+  }
+
+  // false when the models can reuse the result of the last frame that ran
+  bool changed(const cv::Mat& frame) {
+    const double scale =
+        std::min(1.0, (double)THUMBNAIL_WIDTH / std::max(frame.cols, 1));
+    cv::resize(frame, resized_, cv::Size(), scale, scale, cv::INTER_AREA);
+    if (resized_.channels() == 3) {
+      cv::cvtColor(resized_, thumbnail_, cv::COLOR_BGR2GRAY);
+    } else {
+      thumbnail_ = resized_;
+    }
+    bool run = reference_.empty() || reference_.size() != thumbnail_.size() ||
+               reused_ >= keyframe_interval_;
+    if (!run) {
+      double diff = cv::norm(thumbnail_, reference_, cv::NORM_L1) /
+                    (double)thumbnail_.total();
+      run = diff >= diff_threshold_;
+    }
+    if (run) {
+      thumbnail_.copyTo(reference_);
+      reused_ = 0;
+    } else {
+      reused_++;
+    }
+    return run;
+  }
+
+ private:
+  static constexpr int THUMBNAIL_WIDTH = 160;
+  float diff_threshold_{2.0f};
+  int keyframe_interval_{30};
+  int reused_{0};
+  cv::Mat resized_;
+  cv::Mat thumbnail_;
+  cv::Mat reference_;
+};
@@ -0,0 +1,162 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "util/check.hpp"
+#include "util/config.hpp"
+// Arbitrates the NPU between the models of the process.
+//
+// At most max_concurrent_runs model runs are on the NPU at a time, the model
+// task threads of all the pipelines wait in acquire() for their turn. A
+// free run goes to the waiting model of highest priority, then to the one
+// with the fewest runs relative to its target fps. The decode tasks ask
+// admit() before each frame, so the frames over the target fps of a model,
+// or arriving while its queue is full, are dropped before they are decoded
+// instead of piling up in the queues.
+//
+// Without an "npu_scheduler" config every call is a no op.
+class NpuScheduler {
+ public:
+  static NpuScheduler& instance() {
+    static NpuScheduler instance{};
+    return instance;
+  }
+  void init(const Config& config) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    CONFIG_GET(config, int, max_concurrent_runs, "max_concurrent_runs")
+    CHECK(max_concurrent_runs >= 1)
+    max_concurrent_runs_ = max_concurrent_runs;
+    enabled_ = true;
+    PRINT("NPU scheduler: " << max_concurrent_runs_ << " concurrent runs")
+  }
+  bool enabled() const { return enabled_; }
+
+  // target_fps 0 means as fast as the NPU allows
+  int add_model(const std::string& name, int priority, int target_fps) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    CHECK(target_fps >= 0)
+    ModelState model;
+    model.name = name;
+    model.priority = priority;
+    if (target_fps > 0) {
+      model.frame_interval = std::chrono::microseconds(1000000 / target_fps);
+    }
+    model.weight = target_fps > 0 ? target_fps : 1;
+    models_.push_back(model);
+    return (int)models_.size() - 1;
+  }
+
+  // Whether the decode task should read the next frame for the model
+  bool admit(int slot, bool queue_full) {
+    if (!enabled_ || slot < 0) {
+      return true;
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto& model = models_[slot];
+    auto now = std::chrono::steady_clock::now();
+    if (queue_full || now < model.next_frame) {
+      model.dropped++;
+      return false;
+    }
+    // no burst after a stall
+    model.next_frame = std::max(model.next_frame + model.frame_interval, now);
+    model.admitted++;
+    return true;
+  }
+
+  // Holds a run of the model on the NPU for its lifetime
+  class Run {
+   public:
+    explicit Run(int slot) : slot_{slot} { instance().acquire(slot_); }
+    ~Run() { instance().release(slot_); }
+    Run(const Run&) = delete;
+    Run& operator=(const Run&) = delete;
+
+   private:
+    int slot_;
+  };
+
+  std::string summary() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::stringstream ss;
+    for (auto& model : models_) {
+      ss << "npu scheduler " << model.name << ": " << model.runs
+         << " runs, " << model.admitted << " frames decoded, "
+         << model.dropped << " dropped at decode\n";
+    }
+    return ss.str();
+  }
+
+ private:
+  NpuScheduler() {}
+  struct ModelState {
+    std::string name;
+    int priority{0};
+    int weight{1};
+    std::chrono::microseconds frame_interval{0};
+    std::chrono::steady_clock::time_point next_frame{};
+    int waiting{0};
+    size_t runs{0};
+    size_t admitted{0};
+    size_t dropped{0};
+  };
+
+  void acquire(int slot) {
+    if (!enabled_ || slot < 0) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(mtx_);
+    models_[slot].waiting++;
+    cond_.wait(lock, [this, slot]() {
+      return running_ < max_concurrent_runs_ && pick() == slot;
+    });
+    models_[slot].waiting--;
+    models_[slot].runs++;
+    running_++;
+  }
+  void release(int slot) {
+    if (!enabled_ || slot < 0) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      running_--;
+    }
+    // the next model to run is not known to the waiting threads
+    cond_.notify_all();
+  }
+  // Caller should hold mtx_
+  int pick() const {
+    int best = -1;
+    for (int i = 0; i < (int)models_.size(); i++) {
+      const auto& m = models_[i];
+      if (m.waiting == 0) {
+        continue;
+      }
+      if (best < 0) {
+        best = i;
+        continue;
+      }
+      const auto& b = models_[best];
+      // runs / weight compared without dividing
+      if (m.priority > b.priority ||
+          (m.priority == b.priority &&
+           m.runs * (size_t)b.weight < b.runs * (size_t)m.weight)) {
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  std::mutex mtx_;
+  std::condition_variable cond_;
+  bool enabled_{false};
+  int max_concurrent_runs_{1};
+  int running_{0};
+  std::vector<ModelState> models_;
+};
@@ -6,15 +6,41 @@
 #include "model_task.hpp"
 #include "sort_task.hpp"
 #include "util/config.hpp"
+// "model" of a pipeline is a stage or a cascade of stages, e.g. a detection
+// on the NPU feeding a classification on the iGPU
+std::vector<Config> get_stage_configs(const Config& config) {
+  CHECK_WITH_INFO(config.contains("model"), "model")
+  std::vector<Config> stage_configs;
+  if (config["model"].is_array()) {
+    for (auto& stage_config : config["model"]) {
+      stage_configs.push_back(stage_config);
+    }
+  } else {
+    CONFIG_GET(config, Config, model_config, "model")
+    stage_configs.push_back(model_config);
+  }
+  CHECK(!stage_configs.empty())
+  return stage_configs;
+}
 std::vector<std::shared_ptr<AsyncTask>> create_model_pipeline(
     const Config& config, std::shared_ptr<GuiTask>& gui_task) {
   std::vector<std::shared_ptr<AsyncTask>> tasks;
   CONFIG_GET(config, Config, decode_config, "decode")
   CONFIG_GET(decode_config, std::string, decode_file, "video_file_path")
-  auto decode_task = make_decode_task(decode_file);
+  bool video_cache = false;
+  if (decode_config.contains("video_cache")) {
+    CONFIG_GET(decode_config, bool, video_cache_flag, "video_cache")
+    video_cache = video_cache_flag;
+  }
+  auto decode_task = make_decode_task(decode_file, video_cache);
   // auto decode_task = std::make_shared<DecodeTask>();
   // CONFIG_GET(config, Config, decode_config, "decode")
   decode_task->init(decode_config);
+  if (decode_config.contains("motion_gate")) {
+    CONFIG_GET(decode_config, Config, motion_gate_config, "motion_gate")
+    decode_task->motion_gate_ =
+        std::make_unique<MotionGate>(motion_gate_config);
+  }
   {
     auto async_task = std::dynamic_pointer_cast<AsyncTask>(decode_task);
     CHECK(async_task != nullptr)
@@ -25,21 +51,70 @@ std::vector<std::shared_ptr<AsyncTask>> create_model_pipeline(
   CONFIG_GET(config, Config, sort_config, "sort")
   sort_task->init(sort_config);
   sort_task->output_queue_ = gui_task->input_queue_;
+  sort_task->motion_gated_ = decode_task->motion_gate_ != nullptr;
   PRINT("Building sort task finished!!")
   CONFIG_GET(config, int, model_thread_num, "thread_num")
   PRINT("Need model task num: " << model_thread_num)
-  CONFIG_GET(config, Config, model_config, "model")
-  for (int i = 0; i < model_thread_num; i++) {
-    auto model_task = std::make_shared<ModelTask>();
-    model_task->init(model_config);
-    model_task->input_queue_ = decode_task->output_queue_;
-    model_task->output_queue_ = sort_task->input_queue_;
-    {
-      auto async_task = std::dynamic_pointer_cast<AsyncTask>(model_task);
-      CHECK(async_task != nullptr)
-      tasks.push_back(async_task);
+  // The frames are passed from stage to stage in host memory and the stages
+  // of a cascade run concurrently on different frames.
+  auto stage_configs = get_stage_configs(config);
+  std::shared_ptr<SortedFrameQueue> stage_input_queue;
+  for (size_t stage = 0; stage < stage_configs.size(); stage++) {
+    auto& model_config = stage_configs[stage];
+    CONFIG_GET(model_config, std::string, model_type, "type")
+    int stage_thread_num = model_thread_num;
+    if (model_config.contains("thread_num")) {
+      CONFIG_GET(model_config, int, thread_num, "thread_num")
+      CHECK(thread_num >= 1)
+      stage_thread_num = thread_num;
+    }
+    // the last stage feeds the sort task, the others the next stage
+    auto stage_output_queue =
+        stage + 1 == stage_configs.size()
+            ? sort_task->input_queue_
+            // decode numbers the frames from 1
+            : std::make_shared<SortedFrameQueue>(GLOBAL_BOUNDED_QUEUE_CAPACITY,
+                                                 1);
+    int npu_slot = -1;
+    for (int i = 0; i < stage_thread_num; i++) {
+      auto model_task = std::make_shared<ModelTask>();
+      model_task->init(model_config);
+      // only the runs on the NPU are arbitrated
+      if (i == 0 && NpuScheduler::instance().enabled() &&
+          model_task->engine() == "npu") {
+        int priority = 0;
+        if (model_config.contains("priority")) {
+          CONFIG_GET(model_config, int, model_priority, "priority")
+          priority = model_priority;
+        }
+        int target_fps = 0;
+        if (model_config.contains("target_fps")) {
+          CONFIG_GET(model_config, int, model_target_fps, "target_fps")
+          target_fps = model_target_fps;
+        }
+        npu_slot = NpuScheduler::instance().add_model(model_type, priority,
+                                                      target_fps);
+        if (stage == 0) {
+          decode_task->npu_slot_ = npu_slot;
+        }
+      }
+      model_task->npu_slot_ = npu_slot;
+      if (stage == 0) {
+        model_task->input_queue_ = decode_task->output_queue_;
+      } else {
+        model_task->stage_input_queue_ = stage_input_queue;
+      }
+      model_task->output_queue_ = stage_output_queue;
+      {
+        auto async_task = std::dynamic_pointer_cast<AsyncTask>(model_task);
+        CHECK(async_task != nullptr)
+        tasks.push_back(async_task);
+      }
+      PRINT("Building model task " << i << " of stage " << stage << " ("
+                                   << model_type << " on "
+                                   << model_task->engine() << ") finished!!")
     }
-    PRINT("Building model task " << i << " finished!!")
+    stage_input_queue = stage_output_queue;
   }
   {
     auto async_task = std::dynamic_pointer_cast<AsyncTask>(sort_task);
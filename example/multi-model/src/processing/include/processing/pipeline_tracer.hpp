@@ -0,0 +1,198 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "frame_info.hpp"
+#include "frame_trace.hpp"
+#include "util/check.hpp"
+#include "util/config.hpp"
+// Collects the stage timestamps of the frames reaching the screen.
+//
+// The latency between consecutive stages is kept per channel in log2
+// histograms of microseconds, along with the depth of the queues the frames
+// went through. The first max_frames frames are kept as well, to be written
+// as a Chrome trace (chrome://tracing, ui.perfetto.dev) : one async span per
+// stage of each frame and one counter per queue, under the channel pid.
+class PipelineTracer {
+ public:
+  static PipelineTracer& instance() {
+    static PipelineTracer instance{};
+    return instance;
+  }
+  void init(const Config& config) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (config.contains("chrome_trace_file")) {
+      CONFIG_GET(config, std::string, chrome_trace_file, "chrome_trace_file")
+      chrome_trace_file_ = chrome_trace_file;
+    }
+    if (config.contains("max_frames")) {
+      CONFIG_GET(config, int, max_frames, "max_frames")
+      CHECK(max_frames >= 0)
+      max_frames_ = (size_t)max_frames;
+    }
+    g_trace_epoch();
+    g_trace_enabled().store(true);
+    PRINT("Tracing pipeline stages")
+  }
+  bool enabled() const { return g_trace_enabled().load(); }
+
+  // A frame drawn on the screen
+  void finish(const FrameInfo& frame) {
+    if (!enabled()) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto& channel = channels_[frame.channel_id];
+    channel.frames++;
+    const auto& t = frame.trace;
+    for (int s = 1; s < STAGE_COUNT; s++) {
+      if (t.us[s - 1] != 0 && t.us[s] != 0) {
+        channel.latency[s].add(t.us[s] - t.us[s - 1]);
+      }
+      if (t.depth[s] >= 0) {
+        channel.depth_sum[s] += t.depth[s];
+        channel.depth_count[s]++;
+        channel.depth_max[s] = std::max(channel.depth_max[s], t.depth[s]);
+      }
+    }
+    auto first = (int)Stage::DECODE;
+    auto last = (int)Stage::DISPLAY;
+    if (t.us[first] != 0 && t.us[last] != 0) {
+      channel.total.add(t.us[last] - t.us[first]);
+    }
+    if (records_.size() < max_frames_) {
+      records_.push_back({frame.channel_id, frame.frame_id, t});
+    }
+  }
+  // A frame replaced by a newer one of its channel before it was drawn
+  void drop(const FrameInfo& frame) {
+    if (!enabled()) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    channels_[frame.channel_id].dropped++;
+  }
+
+  std::string summary() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::stringstream ss;
+    for (auto& [id, channel] : channels_) {
+      ss << "channel " << id << ": " << channel.frames << " frames shown, "
+         << channel.dropped << " dropped\n";
+      for (int s = 1; s < STAGE_COUNT; s++) {
+        auto& h = channel.latency[s];
+        if (h.count == 0) {
+          continue;
+        }
+        ss << "  " << stage_name(s - 1) << " -> " << stage_name(s)
+           << ": p50 " << h.percentile(0.5) << " us, p99 "
+           << h.percentile(0.99) << " us";
+        if (channel.depth_count[s] != 0) {
+          ss << ", queue depth avg "
+             << channel.depth_sum[s] / (double)channel.depth_count[s]
+             << " max " << channel.depth_max[s];
+        }
+        ss << "\n";
+      }
+      if (channel.total.count != 0) {
+        ss << "  total: p50 " << channel.total.percentile(0.5)
+           << " us, p99 " << channel.total.percentile(0.99) << " us\n";
+      }
+    }
+    return ss.str();
+  }
+
+  void write_chrome_trace() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (chrome_trace_file_.empty()) {
+      return;
+    }
+    auto events = Config::array();
+    for (auto& r : records_) {
+      for (int s = 1; s < STAGE_COUNT; s++) {
+        if (r.trace.us[s - 1] == 0 || r.trace.us[s] == 0) {
+          continue;
+        }
+        // spans of different frames overlap, so they are async events
+        for (auto ph : {"b", "e"}) {
+          events.push_back(
+              {{"name", std::string(stage_name(s - 1)) + " -> " +
+                            stage_name(s)},
+               {"cat", "frame"},
+               {"ph", ph},
+               {"id", std::to_string(r.channel_id) + ":" +
+                          std::to_string(r.frame_id)},
+               {"pid", r.channel_id},
+               {"tid", 0},
+               {"ts", ph[0] == 'b' ? r.trace.us[s - 1] : r.trace.us[s]},
+               {"args", {{"frame_id", r.frame_id}}}});
+        }
+        if (r.trace.depth[s] >= 0) {
+          events.push_back(
+              {{"name", std::string("queue depth at ") + stage_name(s)},
+               {"ph", "C"},
+               {"pid", r.channel_id},
+               {"ts", r.trace.us[s]},
+               {"args", {{"depth", r.trace.depth[s]}}}});
+        }
+      }
+    }
+    std::ofstream ofs{chrome_trace_file_};
+    ofs << Config{{"traceEvents", events}}.dump();
+    PRINT("Chrome trace of " << records_.size() << " frames written to "
+                             << chrome_trace_file_)
+  }
+
+ private:
+  PipelineTracer() {}
+  struct Histogram {
+    // bucket i counts the values in [2^(i-1), 2^i)
+    std::array<size_t, 40> buckets{};
+    size_t count{0};
+    void add(int64_t value) {
+      int i = 0;
+      while (i + 1 < (int)buckets.size() && (int64_t{1} << i) <= value) {
+        i++;
+      }
+      buckets[i]++;
+      count++;
+    }
+    // upper bound of the bucket holding the percentile
+    int64_t percentile(double p) const {
+      size_t target = (size_t)(p * (double)(count - 1));
+      size_t acc = 0;
+      for (size_t i = 0; i < buckets.size(); i++) {
+        acc += buckets[i];
+        if (acc > target) {
+          return int64_t{1} << i;
+        }
+      }
+      return int64_t{1} << (buckets.size() - 1);
+    }
+  };
+  struct ChannelStats {
+    size_t frames{0};
+    size_t dropped{0};
+    std::array<Histogram, STAGE_COUNT> latency{};
+    Histogram total{};
+    std::array<int64_t, STAGE_COUNT> depth_sum{};
+    std::array<size_t, STAGE_COUNT> depth_count{};
+    std::array<int, STAGE_COUNT> depth_max{};
+  };
+  struct Record {
+    int channel_id;
+    unsigned long frame_id;
+    FrameTrace trace;
+  };
+  std::mutex mtx_;
+  std::string chrome_trace_file_;
+  size_t max_frames_{10000};
+  std::map<int, ChannelStats> channels_;
+  std::vector<Record> records_;
+};
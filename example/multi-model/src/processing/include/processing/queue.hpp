@@ -1,4 +1,9 @@
 #pragma once
 #include "util/bounded_queue.hpp"
+#include "util/reorder_buffer.hpp"
+#include "util/ring_queue.hpp"
 #include "frame_info.hpp"
-using BoundedFrameQueue = vitis::ai::BoundedQueue<FrameInfo>;
\ No newline at end of file
+// decode -> model tasks and sort tasks -> gui, lock free
+using BoundedFrameQueue = vitis::ai::RingQueue<FrameInfo>;
+// model tasks -> sort, put back in frame id order
+using SortedFrameQueue = vitis::ai::ReorderBuffer<FrameInfo>;
\ No newline at end of file
@@ -13,26 +13,28 @@ struct SortTask : public AsyncTask {
   SortTask() {}
   virtual ~SortTask() {}
   void init(const Config& config) override {
+    // decode numbers the frames from 1
     input_queue_ =
-        std::make_shared<BoundedFrameQueue>(GLOBAL_BOUNDED_QUEUE_CAPACITY);
+        std::make_shared<SortedFrameQueue>(GLOBAL_BOUNDED_QUEUE_CAPACITY, 1);
     CONFIG_GET(config, int, channel_matrix_id, "channel_matrix_id")
     channel_id_ = channel_matrix_id;
   }
   void run() override {
     FrameInfo frame;
-    frame_id_++;
-    auto frame_id = frame_id_;
-
-    auto cond =
-        std::function<bool(const FrameInfo&)>{[frame_id](const FrameInfo& f) {
-          // sorted by frame id
-          return f.frame_id <= frame_id;
-        }};
     // PRINT("sort pop"<<input_queue_->size())
-    if (!input_queue_->pop(frame, cond, std::chrono::milliseconds(500))) {
+    if (!input_queue_->pop(frame, std::chrono::milliseconds(500))) {
       return;
     }
     frame.channel_id = channel_id_;
+    // the frames are in order here, a reused frame shows the result of the
+    // last frame that ran, the decode buffer of which may be reused since
+    if (motion_gated_) {
+      if (frame.reuse && !last_result_.empty()) {
+        frame.mat = last_result_.clone();
+      } else {
+        last_result_ = frame.mat.clone();
+      }
+    }
     fps_recorder.record();
     int fps = fps_recorder.fps();
     frame.fps = fps;
@@ -44,6 +46,7 @@ struct SortTask : public AsyncTask {
                   cv::Scalar(20, 20, 180), 2, 1);
     }
     // PRINT("sort push"<<output_queue_->size())
+    trace_stamp(frame.trace, Stage::SORT, (int)output_queue_->size());
     while (!output_queue_->push(frame, std::chrono::milliseconds(500))) {
       if (g_is_stopped()) {
         return;
@@ -53,10 +56,13 @@ struct SortTask : public AsyncTask {
 
  public:
   std::shared_ptr<BoundedFrameQueue> output_queue_{};
-  std::shared_ptr<BoundedFrameQueue> input_queue_{};
+  std::shared_ptr<SortedFrameQueue> input_queue_{};
+  // the decode task of the channel has a MotionGate
+  bool motion_gated_{false};
 
  private:
   int channel_id_{0};
-  unsigned long frame_id_{0};
   FpsRecorder fps_recorder{10};
+  // the result of the last frame that ran
+  cv::Mat last_result_;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <opencv2/core.hpp>
+#include <functional>
 #include <string>
 #include <vector>
 #include <thread>
@@ -28,6 +29,25 @@ class SyncImageToImageModel {
     // return postprocess();
     return image;
   }
+  // One result per image, in the same order
+  virtual std::vector<Image> run(const std::vector<Image>& images) {
+    std::vector<Image> results;
+    results.reserve(images.size());
+    for (const auto& image : images) {
+      results.push_back(run(image));
+    }
+    return results;
+  }
+  // Runs images without blocking on the inference, done gets the results
+  // of run(images), possibly on another thread. Several runs may be in
+  // flight, done is called once per run, not necessarily in order.
+  // The default runs synchronously.
+  virtual void run_async(const std::vector<Image>& images,
+                         std::function<void(std::vector<Image>)> done) {
+    done(run(images));
+  }
+  // Largest batch run accepts, 0 means no limit
+  virtual int max_batch_size() const { return 0; }
   // std::vector<OrtValue> inputs_;
   // std::vector<OrtValue> output_;
 };
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2022-2023 Advanced Micro Devices Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <opencv2/core.hpp>
+
+namespace vitis {
+namespace ai {
+/**
+ * A bounded pool of frame buffers for a decoder.
+ *
+ * The frames pass through the queues as cv::Mat headers sharing the pooled
+ * buffer, so a stage hands a frame on without a copy and the reference
+ * count is the handle: a buffer is free again once no cv::Mat but the
+ * pool's own references it, i.e. when the last stage retires the frame.
+ * Decoding into a free buffer of the same size and type reuses its memory,
+ * so a steady state pipeline allocates no frame.
+ *
+ * Not thread safe, a pool belongs to its decoder thread.
+ */
+class FramePool {
+ public:
+  explicit FramePool(std::size_t capacity) : capacity_(capacity) {}
+  FramePool(const FramePool&) = delete;
+  FramePool& operator=(const FramePool&) = delete;
+
+  /**
+   * Return a buffer no frame in flight references, to decode into, or
+   * nullptr when all of them are in flight.
+   */
+  cv::Mat* acquire() {
+    for (auto& buffer : buffers_) {
+      if (buffer.u == nullptr || CV_XADD(&buffer.u->refcount, 0) == 1) {
+        return &buffer;
+      }
+    }
+    if (buffers_.size() < capacity_) {
+      buffers_.emplace_back();
+      return &buffers_.back();
+    }
+    return nullptr;
+  }
+
+  std::size_t capacity() const { return capacity_; }
+
+  /**
+   * Return the number of buffers still referenced downstream.
+   */
+  std::size_t in_flight() const {
+    std::size_t n = 0;
+    for (const auto& buffer : buffers_) {
+      if (buffer.u != nullptr && CV_XADD(&buffer.u->refcount, 0) > 1) {
+        n++;
+      }
+    }
+    return n;
+  }
+
+ private:
+  std::size_t capacity_;
+  // a deque keeps the buffers in place as the pool grows
+  std::deque<cv::Mat> buffers_;
+};
+}  // namespace ai
+}  // namespace vitis
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2022-2023 Advanced Micro Devices Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace vitis {
+namespace ai {
+/**
+ * Puts values pushed out of order by several producers back in id order.
+ *
+ * A value with id i is stored in slot i % window, so push and pop are O(1).
+ * Only the ids in [next_id(), next_id() + window) are buffered, a push past
+ * the window blocks until the consumer catches up. When the next id does not
+ * show up within the timeout of pop, it is skipped and the buffered value with
+ * the lowest id is returned, a value pushed later for a skipped id is dropped.
+ */
+template <typename T>
+class ReorderBuffer {
+ public:
+  explicit ReorderBuffer(std::size_t window, std::size_t first_id = 0)
+      : slots_(window), next_id_(first_id) {}
+  ReorderBuffer(const ReorderBuffer&) = delete;
+  ReorderBuffer& operator=(const ReorderBuffer&) = delete;
+
+  /**
+   * Return the number of ids buffered at most.
+   */
+  std::size_t window() const { return slots_.size(); }
+
+  /**
+   * Return the id of the value the next pop waits for.
+   */
+  std::size_t next_id() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return next_id_;
+  }
+
+  /**
+   * Return the number of values buffered.
+   */
+  std::size_t size() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return size_;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  /**
+   * Return the number of ids skipped by pop so far.
+   */
+  std::size_t skipped() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return skipped_;
+  }
+
+  /**
+   * Store the value with the given id.
+   * This will fail and return false if id is still out of the window after
+   * rel_time. A value for an id already popped or skipped is dropped.
+   */
+  bool push(std::size_t id, const T& new_value,
+            const std::chrono::milliseconds& rel_time) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!cond_not_full_.wait_for(lock, rel_time, [this, id]() {
+          return id < next_id_ + slots_.size();
+        })) {
+      return false;
+    }
+    if (id < next_id_) {
+      return true;
+    }
+    auto& slot = slots_[id % slots_.size()];
+    if (!slot.full) {
+      slot.value = new_value;
+      slot.full = true;
+      ++size_;
+    }
+    if (id == next_id_) {
+      cond_not_empty_.notify_one();
+    }
+    return true;
+  }
+
+  /**
+   * Return the value with the next id and remove it.
+   * If it is not pushed within rel_time, the missing ids are skipped up to
+   * the lowest one buffered. This will fail and return false if nothing at
+   * all is buffered after rel_time.
+   */
+  bool pop(T& value, const std::chrono::milliseconds& rel_time) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!cond_not_empty_.wait_for(lock, rel_time,
+                                  [this]() { return head().full; })) {
+      if (size_ == 0) {
+        return false;
+      }
+      while (!head().full) {
+        ++next_id_;
+        ++skipped_;
+      }
+    }
+    take(value);
+    return true;
+  }
+
+  /**
+   * Return the value with the next id and remove it if it is buffered.
+   * Unlike pop, this never skips ids and returns false right away otherwise.
+   */
+  bool try_pop(T& value) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!head().full) {
+      return false;
+    }
+    take(value);
+    return true;
+  }
+
+ private:
+  struct Slot {
+    bool full = false;
+    T value;
+  };
+
+  Slot& head() { return slots_[next_id_ % slots_.size()]; }
+
+  // Caller should hold mtx_ and the head should be full
+  void take(T& value) {
+    auto& slot = head();
+    value = std::move(slot.value);
+    slot.full = false;
+    --size_;
+    ++next_id_;
+    // producers wait for different ids
+    cond_not_full_.notify_all();
+    // another consumer may be waiting for the next id, pushed already
+    if (head().full) {
+      cond_not_empty_.notify_one();
+    }
+  }
+
+  std::vector<Slot> slots_;
+  std::size_t next_id_;
+  std::size_t size_{0};
+  std::size_t skipped_{0};
+  mutable std::mutex mtx_;
+  std::condition_variable cond_not_full_;
+  std::condition_variable cond_not_empty_;
+};
+}  // namespace ai
+}  // namespace vitis
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2022-2023 Advanced Micro Devices Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace vitis {
+namespace ai {
+/**
+ * A bounded multi producer / multi consumer queue on a ring buffer.
+ *
+ * Push and pop are lock free while the queue is neither full nor empty, each
+ * cell has a sequence number telling whether it is ready for the next push or
+ * the next pop (D. Vyukov's bounded MPMC queue). A push on a full queue or a
+ * pop on an empty one spins for a short while and then sleeps on a condition
+ * variable, which is only notified when a thread is sleeping.
+ *
+ * Same blocking interface as BoundedQueue, without pop with a condition.
+ * The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class RingQueue {
+ public:
+  explicit RingQueue(std::size_t capacity)
+      : capacity_(round_up_pow2(capacity)),
+        mask_(capacity_ - 1),
+        cells_(new Cell[capacity_]) {
+    for (std::size_t i = 0; i < capacity_; ++i) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+  RingQueue(const RingQueue&) = delete;
+  RingQueue& operator=(const RingQueue&) = delete;
+
+  /**
+   * Return the maxium size of the queue.
+   */
+  std::size_t capacity() const { return capacity_; }
+
+  /**
+   * Return the size of the queue, only a hint while other threads push or
+   * pop.
+   */
+  std::size_t size() const {
+    auto tail = tail_.load(std::memory_order_acquire);
+    auto head = head_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  /**
+   * Copy the value to the end of this queue.
+   * Return false without waiting if the queue is full.
+   */
+  bool try_push(const T& new_value) {
+    auto pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto& cell = cells_[pos & mask_];
+      auto seq = cell.seq.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          cell.value = new_value;
+          cell.seq.store(pos + 1, std::memory_order_release);
+          wake(pop_waiters_, cond_not_empty_);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * Return the first element in the queue and remove it from the queue.
+   * Return false without waiting if the queue is empty.
+   */
+  bool try_pop(T& value) {
+    auto pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto& cell = cells_[pos & mask_];
+      auto seq = cell.seq.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          value = std::move(cell.value);
+          cell.seq.store(pos + capacity_, std::memory_order_release);
+          wake(push_waiters_, cond_not_full_);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * Copy the value to the end of this queue.
+   * This is blocking.
+   */
+  void push(const T& new_value) {
+    while (!push(new_value, std::chrono::milliseconds(1000))) {
+    }
+  }
+
+  /**
+   * Copy the value to the end of this queue.
+   * This will fail and return false if blocked for more than rel_time.
+   */
+  bool push(const T& new_value, const std::chrono::milliseconds& rel_time) {
+    return wait(
+        push_waiters_, cond_not_full_, rel_time,
+        [&]() { return try_push(new_value); },
+        [this]() { return size() < capacity_; });
+  }
+
+  /**
+   * Return the first element in the queue and remove it from the queue.
+   * This is blocking.
+   */
+  void pop(T& value) {
+    while (!pop(value, std::chrono::milliseconds(1000))) {
+    }
+  }
+
+  /**
+   * Return the first element in the queue and remove it from the queue.
+   * This will fail and return false if blocked for more than rel_time.
+   */
+  bool pop(T& value, const std::chrono::milliseconds& rel_time) {
+    return wait(
+        pop_waiters_, cond_not_empty_, rel_time,
+        [&]() { return try_pop(value); }, [this]() { return !empty(); });
+  }
+
+ private:
+  static constexpr int SPIN_COUNT = 64;
+
+  struct Cell {
+    std::atomic<std::size_t> seq;
+    T value;
+  };
+
+  static std::size_t round_up_pow2(std::size_t n) {
+    std::size_t p = 2;
+    while (p < n) {
+      p <<= 1;
+    }
+    return p;
+  }
+
+  // op is retried outside of the lock, since it notifies the other side
+  template <typename Op, typename Ready>
+  bool wait(std::atomic<int>& waiters, std::condition_variable& cond,
+            const std::chrono::milliseconds& rel_time, Op op, Ready ready) {
+    auto deadline = std::chrono::steady_clock::now() + rel_time;
+    for (;;) {
+      for (int i = 0; i < SPIN_COUNT; ++i) {
+        if (op()) {
+          return true;
+        }
+        std::this_thread::yield();
+      }
+      bool timeout = false;
+      {
+        std::unique_lock<std::mutex> lock(mtx_);
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        // pairs with the fence in wake : either ready() sees the other
+        // thread's update, or the other thread sees this waiter
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        timeout = !cond.wait_until(lock, deadline, ready);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+      }
+      if (op()) {
+        return true;
+      }
+      if (timeout) {
+        return false;
+      }
+    }
+  }
+
+  void wake(std::atomic<int>& waiters, std::condition_variable& cond) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) > 0) {
+      // taking the lock orders the notify after the waiter's check
+      { std::lock_guard<std::mutex> lock(mtx_); }
+      cond.notify_one();
+    }
+  }
+
+  const std::size_t capacity_;
+  const std::size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::atomic<int> push_waiters_{0};
+  std::atomic<int> pop_waiters_{0};
+  std::mutex mtx_;
+  std::condition_variable cond_not_full_;
+  std::condition_variable cond_not_empty_;
+};
+}  // namespace ai
+}  // namespace vitis
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <op_fuser/fusion_rt.hpp>
+#include <xrt_context/xrt_context.hpp>
+
+namespace OpsFusion {
+
+// Shape specializations (buckets) of one model, e.g. one metadata per
+// sequence length, with a FusionRuntime per bucket on one hw_context.
+// The buckets share their input/output/scratch BOs, they are those of the
+// bucket with the largest ones (see FusionRuntime::share_data_bos), and
+// their const & super instr BOs where the contents are identical
+// (DDConfig::share_const_bo is set for all the buckets). execute() runs the
+// bucket of the input shapes, one bucket at a time.
+class BucketedFusionRuntime {
+public:
+  // Uses hw context 0 of the xclbin's context pool.
+  BucketedFusionRuntime(const std::string &xclbin,
+                        const std::string &kernel_name_prefix = "DPU");
+  BucketedFusionRuntime(xrt::hw_context *ctx,
+                        const std::string &kernel_name_prefix = "DPU");
+  BucketedFusionRuntime(const BucketedFusionRuntime &) = delete;
+  BucketedFusionRuntime &operator=(const BucketedFusionRuntime &) = delete;
+
+  // All the buckets have the same number of inputs and outputs, with the
+  // same dtypes. Input shapes of two buckets must differ.
+  void init(const std::vector<Metadata> &buckets,
+            const std::string &base_dir = "", const DDConfig &cfg = {});
+
+  // Executes the bucket whose input shapes are those of inputs.
+  void execute(const std::vector<Tensor> &inputs,
+               const std::vector<Tensor> &outputs);
+
+  // Bucket with the fewest input elements whose input shapes are at least
+  // input_shapes in every dim, i.e. the bucket to pad inputs of these shapes
+  // to. Throws if no bucket fits.
+  size_t
+  find_bucket(const std::vector<std::vector<size_t>> &input_shapes) const;
+  const std::vector<std::vector<size_t>> &
+  get_input_shapes(size_t bucket_idx) const;
+
+  size_t get_num_buckets() const;
+  FusionRuntime &get_runtime(size_t bucket_idx);
+
+private:
+  struct Bucket {
+    std::unique_ptr<FusionRuntime> rt;
+    std::vector<std::vector<size_t>> input_shapes;
+  };
+
+  std::shared_ptr<ryzenai::dynamic_dispatch::xrt_context> xrt_ctx_;
+  xrt::hw_context *ctx_;
+  std::string kernel_name_prefix_;
+  std::vector<Bucket> buckets_;
+  std::mutex execute_mutex_;
+};
+
+} // namespace OpsFusion
@@ -7,6 +7,7 @@
 #include <utility>
 
 #include "fuse_types.hpp"
+#include "meta_bin.hpp"
 #include <ops/op_builder.hpp>
 #include <ops/op_interface.hpp>
 #include <utils/meta_utils.hpp>
@@ -164,7 +165,8 @@ static Metadata load_meta_json(const std::string &meta_json) {
         offset_info.at("shape").template get<std::vector<size_t>>(),
         offset_info.at("size_in_bytes").template get<size_t>(),
         json_get<std::string>(offset_info, "file_name", ""),
-        json_get<size_t>(offset_info, "file_size", 0)};
+        json_get<size_t>(offset_info, "file_size", 0),
+        json_get<size_t>(offset_info, "file_offset", 0)};
   }
 
   if (data.find("aux_info") != data.end()) {
@@ -175,6 +177,12 @@ static Metadata load_meta_json(const std::string &meta_json) {
   return meta;
 }
 
+// Loads either a binary meta (see meta_bin.hpp) or a meta.json
+static Metadata load_meta(const std::string &meta_file) {
+  return is_meta_bin(meta_file) ? load_meta_bin(meta_file)
+                                : load_meta_json(meta_file);
+}
+
 static txn_vec_t generate_fused_ops(const Metadata &meta,
                                     const std::pair<size_t, size_t> &op_range) {
   RYZENAI_LOG_TRACE("Get ops txn ...");
@@ -188,7 +196,7 @@ static txn_vec_t generate_fused_ops(const Metadata &meta,
     const auto &op_info = meta.op_list.at(ind);
     RYZENAI_LOG_TRACE(
         OpsFusion::dod_format("Get ops txn for op:{}", op_info.name));
-    auto op = OpBuilder::create(op_info.name, op_info, meta.tensor_map);
+    auto op = OpBuilder::get_or_create(op_info, meta.tensor_map);
 
     auto const_buffers = MetaUtils::load_op_const_buffers(meta, op_info);
     std::map<std::string, void *> const_buf_ptrs;
@@ -51,18 +51,27 @@ struct Metadata {
     size_t size_in_bytes; // Final size as per the kernel's reqs.
     std::string file_name;
     size_t file_size;
+    // Offset of the data in file_name, non zero for the consts of a packed
+    // const archive, see tools/pack_consts.py
+    size_t file_offset = 0;
   };
 
   struct Span {
     size_t offset;
     size_t size;
   };
+  struct TensorView {
+    std::string base_name; // Tensor holding the data, can be a view itself
+    size_t offset;         // Offset in the base tensor
+  };
 
   std::vector<OpInfo> op_list;
   std::map<std::string, TensorInfo>
       fused_tensors; // fused_tensor.name --> TensorInfo
   std::map<std::string, OffsetInfo>
       tensor_map;                              // onnxtensor.name --> OffsetInfo
+  std::map<std::string, TensorView>
+      tensor_views; // onnxtensor.name --> TensorView, not in fused_tensors
   std::map<std::string, Span> super_instr_map; // op.name --> Op's super buffer
   std::map<std::string, Span> const_map;       // op.name --> Op's const buffer
   std::set<std::string>
@@ -79,12 +88,69 @@ struct Metadata {
   std::vector<Partition> partitions;
 };
 
-static const std::set<std::string> CONTROL_OPS{"PM_LOAD", "RECORD_TIMER"};
+// Device memory footprint of a Metadata, see MetaUtils::get_memory_report()
+struct MemoryReport {
+  struct Buffer {
+    std::string name; // fused tensor : in, out, scratch, const, super_instr
+    size_t size = 0;
+    size_t num_tensors = 0;
+    // sum of the sizes of the packed tensors, or of the op spans for const &
+    // super_instr
+    size_t tensor_size = 0;
+    // leading max_tensor_padding_sz of in, out & scratch
+    size_t padding_size = 0;
+  };
+  struct LiveRange {
+    std::string name;
+    size_t size = 0;
+    size_t offset = 0; // in the scratch buffer
+    // index of the first & last op in Metadata::op_list accessing the tensor
+    size_t first_op = 0;
+    size_t last_op = 0;
+  };
+  struct PassStep {
+    std::string pass;
+    size_t num_ops = 0;
+    std::map<std::string, size_t> buffer_sizes; // fused tensor --> size
+  };
+
+  size_t num_ops = 0;
+  std::vector<Buffer> buffers;
+  size_t total_size = 0;
+  size_t padding_size = 0;
+  // internal scratch pad of the ops, allocated after the scratch buffer
+  size_t op_scratch_pad_size = 0;
+  // largest sum of the sizes of the scratch tensors live at one op, the
+  // scratch buffer can't be smaller
+  size_t peak_live_size = 0;
+  size_t peak_live_op = 0;
+  std::vector<LiveRange> live_ranges; // scratch tensors, by first op
+  // buffer sizes after each pass of FusionRuntime, empty if the runtime was
+  // loaded from a compiled model
+  std::vector<PassStep> passes;
+};
+
+static const std::set<std::string> CONTROL_OPS{
+    "PM_LOAD", "RECORD_TIMER", "PERF_COUNTER_START", "PERF_COUNTER_READ"};
 
 static constexpr uint32_t CONTROL_PDI_ID = 0xFF;
 
+// Op run on the CPU by FusionRuntime with a registered kernel, see
+// ops/host_op/host_op.hpp. Its pseudo PDI id puts the host ops in partitions
+// of their own, between the NPU partitions.
+static const std::string HOST_OP_TYPE = "HOST_OP";
+static constexpr uint32_t HOST_PDI_ID = 0xFE;
+
+static inline bool is_host_partition(const Partition &partition) {
+  return partition.pdi_id == HOST_PDI_ID;
+}
+
 uint8_t static inline get_pdi_id(const OpPDIMap &op_pdi_map,
                                  const std::string &op_type) {
+  if (op_type == OpsFusion::HOST_OP_TYPE) {
+    return OpsFusion::HOST_PDI_ID;
+  }
+
   if (op_pdi_map.op_to_pdi_id_map.empty()) {
     return 0;
   }
@@ -1,31 +1,170 @@
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include <op_fuser/fuse_ops.hpp>
 #include <ops/op_interface.hpp>
+#include <utils/latency_histogram.hpp>
+#include <utils/npu_memory.hpp>
+#include <utils/utils.hpp>
 
 namespace OpsFusion {
 struct Metadata;
+struct CompiledModel;
+class CompiledCache;
 
 struct DDConfig {
   uint32_t profile =
       0; // pass profile level. 0 - None, 1 - subgraph, 2 - subgraph+PDI
-         // partition, 3 - subgraph + PDI partition + ops
+         // partition, 3 - subgraph + PDI partition + ops, 4 - level 3 +
+         // AIE core active/stall counters of each op
   bool pm_swap = false;
   bool optimize_scratch = true;
   // use fused transaction, but run each op serially
   bool eager_mode = false;
+  // in eager_mode, number of ops queued on the NPU at once. 1 waits for
+  // each op before starting the next one.
+  uint32_t eager_pipeline_depth = 4;
+  // number of input/output BO sets used by submit()/wait()
+  uint32_t num_async_slots = 2;
+  // directory for compiled model artifacts. If set, init() loads
+  // the post-pass metadata, fused transactions and const/super instr
+  // BO images from here instead of regenerating them. Can also be set
+  // with DD_CACHE_DIR env variable.
+  std::string cache_dir;
+  // share the const & super instr BOs with other FusionRuntimes on the same
+  // hw_context whose BOs have identical contents, e.g. same model loaded
+  // twice
+  bool share_const_bo = true;
+  // reorder independent ops to reduce PDI switches and PM swaps, based on
+  // the costs below. Costs can be measured with profile level 2.
+  bool reorder_ops = true;
+  double pdi_switch_cost_us = 100;
+  double pm_swap_cost_us = 50;
+  // remove ops which only place tensors next to each other, e.g. concat of
+  // single rows, and access their tensors as views of one another instead
+  bool fold_view_ops = true;
+  // rewrite op sequences into the fused ops of DD, e.g. MLADFADD
+  // followed by MLADFRMSNORM into MLADFADDRMSNORM
+  bool fuse_op_patterns = true;
+  // drop the output quantize of a *_qdq op & the input dequantize of the
+  // *_qdq ops reading it, the tensor between them is kept in bfloat16
+  bool fold_qdq_pairs = true;
+  // remove ops whose outputs are neither graph outputs nor consumed by
+  // another op
+  bool eliminate_dead_ops = true;
+  // drop DMA BD writes rewriting the values the BDs already have and merge
+  // contiguous BD writes in the fused transaction of each partition
+  bool optimize_txns = false;
+  // number of input sets run by one execute(), e.g. 2 for the conditional
+  // & unconditional passes of classifier-free guidance. Each op is followed
+  // by its copies for the other sets, in the same partitions, & the copies
+  // share its consts. Inputs/outputs are those of set 0, then of set 1 etc.
+  uint32_t batch_size = 1;
+  // QoS set on the hw context of the runtime by init(), with
+  // xrt::hw_context::update_qos(). Keys are those of xrt::hw_context, e.g.
+  // "priority", "latency", "gops", "fps", so that an interactive model is
+  // scheduled ahead of background ones sharing the NPU. It applies to all
+  // the users of the context: lease one per model with the pool of
+  // xrt_context::configure_pool(). Empty keeps the QoS of the context.
+  std::map<std::string, uint32_t> qos;
+  // if set, the first execute() after init() writes a replay bundle of the
+  // execution to this directory, see FusionRuntime::init_capture(). Can also
+  // be set with DD_CAPTURE_DIR env variable.
+  std::string capture_dir;
+  // when the instructions of a graph don't fit in the instr BO heap, keep the
+  // partitions too large for a static instr BO whole & stream their
+  // instructions through the static instr BOs in pages, queued back to back
+  // on the NPU. false splits such partitions in two until they fit instead.
+  bool page_instrs = true;
+};
+
+// Counters of the static instruction BO ring, which is used when
+// instructions of a graph don't fit in the instr BO heap.
+struct InstrPrefetchStats {
+  // number of instruction pages written to the ring, a page is the whole
+  // partition unless it is too large for a ring slot, see
+  // DDConfig::page_instrs
+  uint64_t num_uploads = 0;
+  // number of times a partition finished before instructions of the next
+  // partition were uploaded, i.e. NPU waited on instruction upload
+  uint64_t num_stalls = 0;
+  // number of times a page was uploaded after the previous pages of its
+  // partition were done, i.e. the partition ran longer than the ring
+  uint64_t num_page_stalls = 0;
+  // total time spent writing instructions to the ring
+  int64_t upload_time_ns = 0;
+};
+
+// Timestamp written by a RECORD_TIMER op on the device, in AIE cycles.
+// Timers are inserted for DDConfig::profile >= 1.
+struct TimerRecord {
+  uint32_t id;
+  uint64_t cycles;
+};
+
+// Device latency of a subgraph, PDI partition or op, between its start and
+// end timers
+struct DeviceOpTime {
+  std::string name;
+  // op type, "pdi_partition" or "subgraph"
+  std::string type;
+  // shapes/dtypes of the op args, e.g. "1x64_64x64", "uint16_uint8"
+  std::string shape;
+  std::string dtype;
+  uint64_t num_runs = 0;
+  double mean_cycles = 0;
+  uint64_t min_cycles = 0;
+  uint64_t max_cycles = 0;
+};
+
+// Reads "<timer id> <cycles>" lines, one per executed RECORD_TIMER op, as
+// dumped by the NPU firmware or aiesim (aiesimulator_output/record_timer.txt)
+std::vector<TimerRecord> read_timer_records(const std::string &file);
+
+// Execution captured with DDConfig::capture_dir : the inputs it ran on, the
+// outputs it produced and the latency stats of the runtime after it, see
+// FusionRuntime::get_latency_stats()
+struct CaptureRecord {
+  struct TensorData {
+    std::vector<size_t> shape;
+    std::string dtype;
+    std::vector<uint8_t> data;
+  };
+  std::vector<TensorData> inputs;
+  std::vector<TensorData> outputs;
+  std::map<std::string, LatencyStats> latency;
+  // DDConfig::profile of the captured runtime, the RECORD_TIMER ops it
+  // inserted are part of the bundle
+  uint32_t profile = 0;
 };
 
 class FusionRuntime {
 public:
+  using RequestHandle = uint64_t;
+
+  // hw context is leased from the pool of the xclbin, see
+  // xrt_context::configure_pool()
   FusionRuntime(const std::string &xclbin,
                 const std::string &kernel_name_prefix = "DPU");
   FusionRuntime(xrt::hw_context *ctx,
                 const std::string &kernel_name_prefix = "DPU");
+  // Runtime init() with the metadata of meta_file (see load_meta()). The hw
+  // context is created while the metadata is parsed, both are in the
+  // startup timeline.
+  static std::unique_ptr<FusionRuntime>
+  create(const std::string &xclbin, const std::string &meta_file,
+         const std::string &base_dir = "", const DDConfig &cfg = {},
+         const std::string &kernel_name_prefix = "DPU");
   ~FusionRuntime();
   // Do not allow copying or assignment
   // to prevent instruction BO for hw_context to grow
@@ -33,10 +172,123 @@ public:
   FusionRuntime &operator=(const FusionRuntime &) = delete;
   void execute(const std::vector<Tensor> &inputs,
                const std::vector<Tensor> &outputs);
+
+  // Asynchronous execution.
+  // submit() copies inputs to a free input/output BO set and queues the
+  // request for execution on the NPU, so that copying inputs of the next
+  // request overlaps execution of the current one.
+  // wait() blocks until the request is done and copies results to the
+  // outputs passed to submit(). Output tensors must stay valid until then.
+  // At most DDConfig::num_async_slots requests can be in flight; submit()
+  // blocks until a slot is released by wait().
+  RequestHandle submit(const std::vector<Tensor> &inputs,
+                       const std::vector<Tensor> &outputs);
+  void wait(RequestHandle handle);
+
+  // Zero-copy IO.
+  // Tensors returned by get_input_views()/get_output_views() point directly
+  // into the packed input/output BOs. Fill the input views and pass the views
+  // to execute(); copies are skipped and only the BO syncs are done.
+  // Views are valid until the next init() or bind_io_buffers().
+  std::vector<Tensor> get_input_views();
+  std::vector<Tensor> get_output_views();
+
+  // Use caller-owned host memory as packed input/output buffers (XRT
+  // user-pointer BOs). Buffers should be 4KB aligned, at least
+  // get_input_buffer_size()/get_output_buffer_size() bytes and must outlive
+  // the runtime. Binding is dropped by the next init().
+  void bind_io_buffers(void *input_buf, size_t input_size, void *output_buf,
+                       size_t output_size);
+  size_t get_input_buffer_size() const;
+  size_t get_output_buffer_size() const;
+
+  // Chained runtimes, e.g. the DD subgraphs of one model.
+  // link_inputs() makes the input BO of this runtime a sub-BO of the output
+  // BO of producer, output_idx[i] being the output of producer which is
+  // input i of this runtime. The producer then writes these inputs in place:
+  // execute() of either runtime neither copies nor syncs them. Pass
+  // get_input_views() as inputs of this runtime and producer's
+  // get_output_views() as its outputs; other producer outputs, e.g. read by
+  // CPU ops, are still synced and can be read in place from the views.
+  // All the inputs have to be outputs of producer, at the same offsets
+  // relative to each other (e.g. a single input), and both runtimes have to
+  // be on the same hw context. Otherwise nothing is linked and false is
+  // returned; producer's output views can still be passed as inputs, with
+  // one copy. The producer's execute() must be done before this one starts.
+  // Links are dropped by init() and bind_io_buffers() of either runtime,
+  // submit() doesn't use them.
+  bool link_inputs(FusionRuntime &producer,
+                   const std::vector<size_t> &output_idx);
+
+  // Runtimes which never run at the same time, e.g. the shape buckets of
+  // BucketedFusionRuntime. share_data_bos() replaces the input, output and
+  // scratch BOs of this runtime by those of owner, once they are at least as
+  // large, and frees its own. The views of both runtimes are then the same
+  // memory. Nothing is shared and false is returned if the runtimes are on
+  // different hw contexts, owner's BOs are too small or the IO BOs of this
+  // runtime are user buffers or linked. Sharing is dropped by init() of this
+  // runtime, and by init() of owner if it reallocates its BOs.
+  // The runtimes must not execute or submit concurrently.
+  bool share_data_bos(FusionRuntime &owner);
+
+  // HOST_OP nodes of meta, see ops/host_op/host_op.hpp, run in host
+  // partitions between the NPU partitions, on the mapped in/out/scratch BOs.
+  // The NPU partition after a host partition runs at the same time as the
+  // host ops when none of their tensors are in the same memory.
+  // Steps of init() which don't depend on each other run in parallel, e.g.
+  // the const files are read while the passes run.
   void init(const Metadata &meta, const std::string &base_dir = "",
             const DDConfig &cfg = {});
+
+  // Steps of the last init() or init_capture(), in the order they were
+  // started. Times are relative to the start of init(), or of create().
+  std::vector<Utils::TaskTime> get_startup_timeline() const;
+  // Text chart of the startup timeline, one row per step
+  std::string get_startup_report(size_t width = 64) const;
+
+  // Replay of an execution captured with DDConfig::capture_dir, e.g. to
+  // bisect a perf regression without the application (see dd_replay). The
+  // bundle holds the post-pass metadata, fused transactions and const &
+  // super instr BO images, so neither the original metadata nor the const
+  // files are needed. The passes options of cfg are ignored, the profile
+  // level is the captured one. HOST_OP kernels must be registered by the
+  // replaying process. Returns the captured execution, execute() its inputs
+  // to replay it.
+  CaptureRecord init_capture(const std::string &capture_dir,
+                             const DDConfig &cfg = {});
+
+  // Replace data of const tensors (keyed by tensor name in
+  // Metadata::tensor_map), e.g. to swap adapter weights. Shapes and dtypes
+  // must match with the metadata. Only the const/super instr buffers of ops
+  // using these tensors are regenerated, transactions are reused.
+  // Data is copied and kept until the next init().
+  void update_consts(const std::map<std::string, Tensor> &const_tensors);
   std::vector<std::vector<uint8_t>> get_txns();
+  // Accumulated over all executions since init()
+  InstrPrefetchStats get_instr_prefetch_stats();
+
+  // Latency histograms, accumulated over all executions since init().
+  // Keys are "execute", "input_copy", "input_sync", "xrt_exec",
+  // "output_sync", "output_copy" and "pdi_partition_<idx>" for each
+  // partition. Partitions with a single op (e.g. eager_mode) are also
+  // reported as "op/<op name>". Safe to call while other threads execute.
+  std::map<std::string, LatencyStats> get_latency_stats() const;
+  void reset_latency_stats();
+  // Maps the timestamps of the RECORD_TIMER ops of this runtime back to the
+  // timed subgraph/partitions/ops, in the order of their start timers.
+  // records are in execution order and can span several runs, records of
+  // other runtimes are skipped. Runs missing a start or end are dropped.
+  std::vector<DeviceOpTime>
+  get_device_op_times(const std::vector<TimerRecord> &records) const;
   const Metadata &get_meta() const;
+  // Device memory footprint of the model & live ranges of its scratch
+  // tensors, with the buffer sizes after each pass of init(), see
+  // MetaUtils::to_json() to export it
+  MemoryReport get_memory_report() const;
+  // BOs of this runtime, see npu_memory for the whole process
+  ryzenai::dynamic_dispatch::npu_memory_usage get_npu_memory_usage() const {
+    return mem_account_.get_usage();
+  }
 
   // Unpack internal buffers of RT
   // This is useful for debugging after the execution.
@@ -47,10 +299,55 @@ public:
 
 private:
   void load_const(const Metadata &meta);
+  void load_op_const(const Metadata &meta, const Metadata::OpInfo &op_info,
+                     void *const_bo_ptr);
+  void load_op_const(const Metadata &meta, const Metadata::OpInfo &op_info,
+                     OpInterface *op, void *const_bo_ptr);
   void fill_super_instr(const Metadata &meta);
+  void fill_op_super_instr(const Metadata &meta,
+                           const Metadata::OpInfo &op_info,
+                           void *super_bo_ptr);
+  void share_const_bo();
+  void unshare_const_bo();
+  xrt::bo copy_bo(xrt::bo &bo, size_t size, const std::string &account_slot);
+  std::map<std::string, void *>
+  get_op_const_buffers(const Metadata &meta, const Metadata::OpInfo &op_info);
+  const Utils::MappedFile &get_const_file(const std::string &file_name);
   void setup_xrt_run(const Metadata &meta);
   void split_outputs(const std::vector<Tensor> &outputs, const Metadata &meta);
   void merge_inputs(const std::vector<Tensor> &inputs, const Metadata &meta);
+  void write_inputs(const std::vector<Tensor> &inputs, const Metadata &meta,
+                    xrt::bo &input_bo);
+  void read_outputs(const std::vector<Tensor> &outputs, const Metadata &meta,
+                    xrt::bo &output_bo);
+  void run_partitions(const Metadata &meta, xrt::bo &input_bo,
+                      xrt::bo &output_bo);
+  void run_partitions_pipelined(const Metadata &meta, xrt::bo &input_bo,
+                                xrt::bo &output_bo);
+  [[noreturn]] void throw_partition_error(size_t i, uint8_t pdi_id,
+                                          const std::exception &e);
+  void setup_host_ops(const Metadata &meta);
+  void run_host_partition(size_t i, xrt::bo &input_bo, xrt::bo &output_bo);
+  void allocate_async_slots();
+  void async_worker_loop();
+  void stop_async_worker();
+  void reset_state(const Metadata &meta, const DDConfig &cfg);
+  void init_bos(const CompiledModel *model);
+  // Tasks of init_bos(), model is read once the tasks run. The tasks start
+  // after deps, the const loading also after const_deps. Returns the last
+  // tasks.
+  std::vector<Utils::TaskGraph::TaskId> add_init_bos_tasks(
+      Utils::TaskGraph &graph, const CompiledModel *const &model,
+      const std::vector<Utils::TaskGraph::TaskId> &deps,
+      const std::vector<Utils::TaskGraph::TaskId> &const_deps);
+  void run_passes();
+  void reset_latency_histograms(const Metadata &meta);
+  void write_capture(const std::vector<Tensor> &inputs,
+                     const std::vector<Tensor> &outputs);
+  std::unique_ptr<CompiledCache>
+  open_compiled_cache(const Metadata &meta, const std::string &base_dir);
+  void load_compiled_images(const Metadata &meta, const CompiledModel &model);
+  void save_compiled_model(const Metadata &meta, const CompiledCache &cache);
   std::vector<std::vector<uint8_t>> generate_fused_txns(const Metadata &meta);
   bool check_context_instr_size(
       const std::vector<std::vector<uint8_t>> &fused_instr_vec,
@@ -58,6 +355,7 @@ private:
   bool check_partition_instr_size(
       const std::vector<std::vector<uint8_t>> &fused_instr_vec,
       const size_t partition_limit);
+  void generate_instr_pages(const Metadata &meta, size_t page_limit);
   bool
   allocate_instr_bos(const std::vector<std::vector<uint8_t>> &fused_instr_vec);
   void
@@ -66,12 +364,66 @@ private:
   void initialize_inputs(const Metadata &meta);
 
 private:
+  struct AsyncSlot {
+    enum class State { FREE, FILLING, QUEUED, DONE };
+    State state = State::FREE;
+    // handle of the request that owns / will next own this slot
+    RequestHandle turn = 0;
+    xrt::bo input_bo;
+    xrt::bo output_bo;
+    std::vector<Tensor> outputs;
+    std::exception_ptr error;
+  };
+
+  // Tensor of a host op, in the BO of parent_name (in, out or scratch)
+  struct HostTensor {
+    std::string parent_name;
+    size_t offset;
+    size_t size;
+  };
+
+  struct HostOp {
+    std::string name;
+    std::unique_ptr<OpInterface> op;
+    std::vector<HostTensor> input_bufs;
+    std::vector<HostTensor> output_bufs;
+    // data set to the mapped BOs on every run
+    std::vector<Tensor> inputs;
+    std::vector<Tensor> outputs;
+  };
+
+  struct HostPartition {
+    std::vector<HostOp> ops;
+    // the next partition has no tensor in the memory of the host ops, it is
+    // started before them
+    bool overlap_next = false;
+  };
+
+  struct LatencyHistograms {
+    LatencyHistogram execute;
+    LatencyHistogram input_copy;
+    LatencyHistogram input_sync;
+    LatencyHistogram xrt_exec;
+    LatencyHistogram output_sync;
+    LatencyHistogram output_copy;
+    std::vector<std::unique_ptr<LatencyHistogram>> partitions;
+    // op name for single op partitions, empty otherwise
+    std::vector<std::string> partition_ops;
+  };
+
   static std::once_flag logger_flag_;
 
   // External Context
   xrt::hw_context ctx_;
   std::vector<xrt::kernel> kernels_;
   std::vector<xrt::run> runs_;
+  // eager mode only, one run per partition, see run_partitions_pipelined()
+  std::vector<xrt::run> partition_runs_;
+  // use_instr_sw_cache_ only, [pdi_id][slot] run of each static instr BO, so
+  // that the pages of a partition are queued on the NPU together
+  std::vector<std::vector<xrt::run>> slot_runs_;
+  // one per partition, ops are empty for NPU partitions
+  std::vector<HostPartition> host_partitions_;
 
   Metadata meta_;
   std::vector<xrt::bo> instr_bos_;
@@ -79,7 +431,13 @@ private:
   xrt::bo output_bo_;
   xrt::bo scratch_bo_;
   xrt::bo const_bo_;
+  // set if const_bo_ is from the shared const BO pool, read-only
+  std::shared_ptr<xrt::bo> shared_const_bo_;
   xrt::bo super_instr_bo_;
+  // same for super_instr_bo_
+  std::shared_ptr<xrt::bo> shared_super_instr_bo_;
+  // BOs above, one slot per BO (or group of BOs)
+  ryzenai::dynamic_dispatch::npu_memory_account mem_account_{"FusionRuntime"};
 
   // Config
   DDConfig cfg_;
@@ -94,6 +452,15 @@ private:
   // TODO: can we only keep fused_instr_vec_ ??
   std::vector<std::vector<uint8_t>> txns_;
   std::vector<std::vector<uint8_t>> fused_instr_vec_;
+  // use_instr_sw_cache_ only, NPU partitions in the pages of instructions
+  // run one after the other from the static instr BOs, in run order
+  struct InstrPage {
+    size_t partition;
+    // empty if the page is the whole partition, i.e.
+    // fused_instr_vec_[partition]
+    std::vector<uint8_t> instr;
+  };
+  std::vector<InstrPage> instr_pages_;
 
   // Timers
   int64_t input_copy_time_{0};
@@ -101,11 +468,47 @@ private:
   int64_t output_copy_time_{0};
   int64_t output_sync_time_{0};
   int64_t xrt_exec_time_{0};
+  InstrPrefetchStats instr_prefetch_stats_;
+  // Buffer sizes after each pass of run_passes()
+  std::vector<MemoryReport::PassStep> pass_steps_;
+  // steps of the last init() in steady clock ns, reported relative to
+  // startup_start_ns_
+  std::vector<Utils::TaskTime> startup_timeline_;
+  int64_t startup_start_ns_{0};
+  // Replaced as a whole on init(), accessed with std::atomic_load/store
+  std::shared_ptr<LatencyHistograms> latency_hists_ =
+      std::make_shared<LatencyHistograms>();
 
   // make copying to input BO, from output BO thread safe
   std::mutex execute_mutex_;
   // Fallback to dynamically updating instr bo
   bool use_instr_sw_cache_;
+  // const data set by update_consts(), tensor name --> data
+  std::map<std::string, std::vector<char>> const_overrides_;
+  // const files mapped while the consts are loaded, file name --> map.
+  // The consts of a packed archive are all read from one map.
+  std::map<std::string, std::unique_ptr<Utils::MappedFile>> const_files_;
+  std::mutex const_files_mutex_;
+  // input_bo_/output_bo_ are created from user memory
+  bool user_io_bufs_{false};
+  // input_bo_ is a sub-BO of the output BO of producer, see link_inputs()
+  bool linked_inputs_{false};
+  // outputs read in place by the runtimes linked to this one, not synced
+  std::vector<bool> linked_outputs_;
+  // input_bo_/output_bo_/scratch_bo_ are those of another runtime, see
+  // share_data_bos()
+  bool shared_data_bos_{false};
+  // next execute() writes a replay bundle, see DDConfig::capture_dir
+  bool capture_pending_{false};
+
+  // State for submit()/wait()
+  std::vector<AsyncSlot> async_slots_;
+  std::deque<size_t> async_queue_; // slots ready to run on NPU
+  RequestHandle next_handle_{0};
+  std::mutex async_mutex_;
+  std::condition_variable async_cv_;
+  std::thread async_worker_;
+  bool stop_async_worker_{false};
 };
 
 } // namespace OpsFusion
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <op_fuser/fusion_rt.hpp>
+
+namespace OpsFusion {
+
+struct SchedulerConfig {
+  // number of FusionRuntime instances serving the queue
+  uint32_t num_runtimes = 1;
+  // max number of requests dispatched to a runtime in one batch
+  uint32_t max_batch_size = 4;
+  // how long the oldest queued request may wait for a batch to fill up
+  std::chrono::microseconds max_queue_delay{0};
+};
+
+// Request scheduler in front of a pool of FusionRuntimes, all initialized
+// with the same Metadata.
+// Client threads enqueue() requests into a shared queue. Each runtime has a
+// dispatcher thread which takes up to max_batch_size requests from the queue
+// and pipelines them through FusionRuntime::submit()/wait(), so copying IO of
+// one request overlaps execution of the previous one.
+// Create one scheduler per model.
+class FusionScheduler {
+public:
+  // All runtimes share the hw_context created for xclbin.
+  FusionScheduler(const std::string &xclbin, const Metadata &meta,
+                  const std::string &base_dir = "",
+                  const DDConfig &dd_cfg = {},
+                  const SchedulerConfig &sched_cfg = {},
+                  const std::string &kernel_name_prefix = "DPU");
+  // One runtime per hw_context. SchedulerConfig::num_runtimes is ignored.
+  FusionScheduler(const std::vector<xrt::hw_context *> &ctxs,
+                  const Metadata &meta, const std::string &base_dir = "",
+                  const DDConfig &dd_cfg = {},
+                  const SchedulerConfig &sched_cfg = {},
+                  const std::string &kernel_name_prefix = "DPU");
+  ~FusionScheduler();
+  FusionScheduler(const FusionScheduler &) = delete;
+  FusionScheduler &operator=(const FusionScheduler &) = delete;
+
+  // Queue a request. Input and output tensors must stay valid until the
+  // returned future is ready. Errors are reported through the future.
+  std::future<void> enqueue(const std::vector<Tensor> &inputs,
+                            const std::vector<Tensor> &outputs);
+  // enqueue() and wait for the result
+  void execute(const std::vector<Tensor> &inputs,
+               const std::vector<Tensor> &outputs);
+
+  size_t get_num_runtimes() const;
+  size_t get_queue_size();
+
+private:
+  struct Request {
+    std::vector<Tensor> inputs;
+    std::vector<Tensor> outputs;
+    std::promise<void> done;
+    std::chrono::steady_clock::time_point enqueue_time;
+  };
+
+  void init_runtimes(const Metadata &meta, const std::string &base_dir);
+  void start_dispatchers();
+  void dispatcher_loop(size_t rt_idx);
+  std::vector<Request> take_batch();
+  void run_batch(FusionRuntime &rt, std::vector<Request> &batch);
+
+  DDConfig dd_cfg_;
+  SchedulerConfig sched_cfg_;
+  std::vector<std::unique_ptr<FusionRuntime>> runtimes_;
+  std::vector<std::thread> dispatchers_;
+
+  std::deque<Request> queue_;
+  std::mutex queue_mutex_;
+  std::condition_variable queue_cv_;
+  bool stop_ = false;
+};
+
+} // namespace OpsFusion
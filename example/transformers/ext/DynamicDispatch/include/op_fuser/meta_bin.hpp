@@ -0,0 +1,362 @@
+#pragma once
+
+#include <any>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "fuse_types.hpp"
+#include <ops/op_interface.hpp>
+#include <utils/logging.hpp>
+#include <utils/tfuncs.hpp>
+#include <utils/utils.hpp>
+
+// Binary metadata, the compact alternative to the meta.json emitted by vaip.
+// Loading it is a single pass over a mapped file, there is nothing to
+// tokenize and the attributes are stored as native int/float arrays, so
+// graphs with thousands of ops load without any JSON DOM. meta.json stays
+// the readable format for debugging, load_meta() accepts both.
+//
+// Layout, little endian :
+//   header      : magic "DDMETA\0\0", version u32, num strings u32
+//   strings     : num strings x (size u32, chars), referenced by index below
+//   op_list     : count u32, per op : name, type, args, attrs
+//                 attr : name, kind u32 (META_ATTR_*), count u32, values
+//   fused_tensors, tensor_map, aux_info : count u32, then the fields of
+//                 Metadata in declaration order
+// Strings are u32 indices into the string table, sizes are u64 and lists
+// are prefixed with their u32 count.
+
+namespace OpsFusion {
+
+static constexpr char META_BIN_MAGIC[8] = {'D', 'D', 'M', 'E',
+                                           'T', 'A', 0,   0};
+static constexpr uint32_t META_BIN_VERSION = 1;
+
+enum MetaAttrKind : uint32_t {
+  META_ATTR_FLOAT = 0,
+  META_ATTR_INT = 1,
+  META_ATTR_STR = 2,
+};
+
+class MetaBinWriter {
+public:
+  std::vector<uint8_t> write(const Metadata &meta) {
+    put_u32(static_cast<uint32_t>(meta.op_list.size()));
+    for (const auto &op_info : meta.op_list) {
+      put_str(op_info.name);
+      put_str(op_info.type);
+      put_strs(op_info.args);
+      put_u32(static_cast<uint32_t>(op_info.attr.size()));
+      for (const auto &[name, value] : op_info.attr) {
+        put_str(name);
+        put_attr(op_info.name, name, value);
+      }
+    }
+
+    put_u32(static_cast<uint32_t>(meta.fused_tensors.size()));
+    for (const auto &[name, tinfo] : meta.fused_tensors) {
+      put_str(name);
+      put_u64(tinfo.size);
+      put_u64(tinfo.arg_idx);
+      put_strs(tinfo.packed_tensors);
+    }
+
+    put_u32(static_cast<uint32_t>(meta.tensor_map.size()));
+    for (const auto &[name, off_info] : meta.tensor_map) {
+      put_str(name);
+      put_str(off_info.parent_name);
+      put_u64(off_info.offset);
+      put_u64(off_info.arg_idx);
+      put_str(off_info.dtype);
+      put_u64s(off_info.shape);
+      put_u64(off_info.size_in_bytes);
+      put_str(off_info.file_name);
+      put_u64(off_info.file_size);
+      put_u64(off_info.file_offset);
+    }
+
+    put_u32(static_cast<uint32_t>(meta.aux_info.size()));
+    for (const auto &[name, value] : meta.aux_info) {
+      DOD_THROW_IF(value.type() != typeid(std::map<std::string, Tensor>),
+                   OpsFusion::dod_format(
+                       "MetaBin : Can't serialize aux_info {}", name));
+      const auto &tensors =
+          std::any_cast<const std::map<std::string, Tensor> &>(value);
+      put_str(name);
+      put_u32(static_cast<uint32_t>(tensors.size()));
+      for (const auto &[tensor_name, tensor] : tensors) {
+        put_str(tensor_name);
+        put_str(tensor.dtype);
+        put_u64s(tensor.shape);
+      }
+    }
+
+    // The string table is only complete now, it goes before the body
+    std::vector<uint8_t> body;
+    std::swap(body, body_);
+    body_.insert(body_.end(), META_BIN_MAGIC,
+                 META_BIN_MAGIC + sizeof(META_BIN_MAGIC));
+    put_u32(META_BIN_VERSION);
+    put_u32(static_cast<uint32_t>(strings_.size()));
+    for (const auto &s : strings_) {
+      put_u32(static_cast<uint32_t>(s.size()));
+      body_.insert(body_.end(), s.begin(), s.end());
+    }
+    body_.insert(body_.end(), body.begin(), body.end());
+    return std::move(body_);
+  }
+
+private:
+  template <typename T> void put(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+    body_.insert(body_.end(), bytes, bytes + sizeof(T));
+  }
+  void put_u32(uint32_t value) { put(value); }
+  void put_u64(uint64_t value) { put(value); }
+
+  void put_str(const std::string &s) {
+    auto [it, inserted] =
+        string_ids_.emplace(s, static_cast<uint32_t>(strings_.size()));
+    if (inserted) {
+      strings_.push_back(s);
+    }
+    put_u32(it->second);
+  }
+
+  void put_strs(const std::vector<std::string> &strs) {
+    put_u32(static_cast<uint32_t>(strs.size()));
+    for (const auto &s : strs) {
+      put_str(s);
+    }
+  }
+
+  void put_u64s(const std::vector<size_t> &values) {
+    put_u32(static_cast<uint32_t>(values.size()));
+    for (auto v : values) {
+      put_u64(v);
+    }
+  }
+
+  void put_attr(const std::string &op_name, const std::string &name,
+                const std::any &value) {
+    if (value.type() == typeid(std::vector<float>)) {
+      const auto &values = std::any_cast<const std::vector<float> &>(value);
+      put_u32(META_ATTR_FLOAT);
+      put_u32(static_cast<uint32_t>(values.size()));
+      for (auto v : values) {
+        put(v);
+      }
+    } else if (value.type() == typeid(std::vector<int>)) {
+      const auto &values = std::any_cast<const std::vector<int> &>(value);
+      put_u32(META_ATTR_INT);
+      put_u32(static_cast<uint32_t>(values.size()));
+      for (auto v : values) {
+        put(static_cast<int32_t>(v));
+      }
+    } else if (value.type() == typeid(std::vector<std::string>)) {
+      put_u32(META_ATTR_STR);
+      put_strs(std::any_cast<const std::vector<std::string> &>(value));
+    } else {
+      DOD_THROW(OpsFusion::dod_format(
+          "MetaBin : Can't serialize attribute {} of op {}", name, op_name));
+    }
+  }
+
+  std::vector<uint8_t> body_;
+  std::vector<std::string> strings_;
+  std::map<std::string, uint32_t> string_ids_;
+};
+
+class MetaBinReader {
+public:
+  MetaBinReader(const char *data, size_t size)
+      : ptr_(data), end_(data + size) {}
+
+  Metadata read() {
+    char magic[sizeof(META_BIN_MAGIC)];
+    get_bytes(magic, sizeof(magic));
+    DOD_THROW_IF(memcmp(magic, META_BIN_MAGIC, sizeof(magic)) != 0,
+                 OpsFusion::dod_format("MetaBin : Invalid magic"));
+    const auto version = get<uint32_t>();
+    DOD_THROW_IF(version != META_BIN_VERSION,
+                 OpsFusion::dod_format("MetaBin : Unsupported version {}",
+                                       version));
+    const auto num_strings = get<uint32_t>();
+    strings_.reserve(num_strings);
+    for (uint32_t i = 0; i < num_strings; ++i) {
+      const auto size = get<uint32_t>();
+      check(size);
+      strings_.emplace_back(ptr_, size);
+      ptr_ += size;
+    }
+
+    Metadata meta;
+    const auto num_ops = get<uint32_t>();
+    meta.op_list.resize(num_ops);
+    for (auto &op_info : meta.op_list) {
+      op_info.name = get_str();
+      op_info.type = get_str();
+      op_info.args = get_strs();
+      const auto num_attrs = get<uint32_t>();
+      for (uint32_t i = 0; i < num_attrs; ++i) {
+        auto name = get_str();
+        op_info.attr[std::move(name)] = get_attr();
+      }
+    }
+
+    const auto num_fused_tensors = get<uint32_t>();
+    for (uint32_t i = 0; i < num_fused_tensors; ++i) {
+      auto &tinfo = meta.fused_tensors[get_str()];
+      tinfo.size = get<uint64_t>();
+      tinfo.arg_idx = get<uint64_t>();
+      tinfo.packed_tensors = get_strs();
+    }
+
+    const auto num_tensors = get<uint32_t>();
+    for (uint32_t i = 0; i < num_tensors; ++i) {
+      auto &off_info = meta.tensor_map[get_str()];
+      off_info.parent_name = get_str();
+      off_info.offset = get<uint64_t>();
+      off_info.arg_idx = get<uint64_t>();
+      off_info.dtype = get_str();
+      off_info.shape = get_u64s();
+      off_info.size_in_bytes = get<uint64_t>();
+      off_info.file_name = get_str();
+      off_info.file_size = get<uint64_t>();
+      off_info.file_offset = get<uint64_t>();
+    }
+
+    const auto num_aux_info = get<uint32_t>();
+    for (uint32_t i = 0; i < num_aux_info; ++i) {
+      auto name = get_str();
+      std::map<std::string, Tensor> tensors;
+      const auto count = get<uint32_t>();
+      for (uint32_t j = 0; j < count; ++j) {
+        auto &tensor = tensors[get_str()];
+        tensor.data = nullptr;
+        tensor.dtype = get_str();
+        tensor.shape = get_u64s();
+      }
+      meta.aux_info[std::move(name)] = std::any(std::move(tensors));
+    }
+
+    DOD_THROW_IF(ptr_ != end_,
+                 OpsFusion::dod_format("MetaBin : {} trailing bytes",
+                                       static_cast<size_t>(end_ - ptr_)));
+    return meta;
+  }
+
+private:
+  void check(size_t size) const {
+    DOD_THROW_IF(size > static_cast<size_t>(end_ - ptr_),
+                 OpsFusion::dod_format("MetaBin : Truncated data"));
+  }
+
+  void get_bytes(void *dst, size_t size) {
+    check(size);
+    memcpy(dst, ptr_, size);
+    ptr_ += size;
+  }
+
+  template <typename T> T get() {
+    T value;
+    get_bytes(&value, sizeof(T));
+    return value;
+  }
+
+  std::string get_str() {
+    const auto idx = get<uint32_t>();
+    DOD_THROW_IF(idx >= strings_.size(),
+                 OpsFusion::dod_format("MetaBin : Invalid string index {}",
+                                       idx));
+    return std::string(strings_[idx]);
+  }
+
+  std::vector<std::string> get_strs() {
+    std::vector<std::string> res(get<uint32_t>());
+    for (auto &s : res) {
+      s = get_str();
+    }
+    return res;
+  }
+
+  std::vector<size_t> get_u64s() {
+    const auto count = get<uint32_t>();
+    check(static_cast<size_t>(count) * sizeof(uint64_t));
+    std::vector<size_t> res(count);
+    for (auto &v : res) {
+      v = static_cast<size_t>(get<uint64_t>());
+    }
+    return res;
+  }
+
+  template <typename T> std::vector<T> get_array() {
+    const auto count = get<uint32_t>();
+    check(static_cast<size_t>(count) * sizeof(T));
+    std::vector<T> res(count);
+    memcpy(res.data(), ptr_, count * sizeof(T));
+    ptr_ += count * sizeof(T);
+    return res;
+  }
+
+  std::any get_attr() {
+    const auto kind = get<uint32_t>();
+    switch (kind) {
+    case META_ATTR_FLOAT:
+      return get_array<float>();
+    case META_ATTR_INT: {
+      auto values = get_array<int32_t>();
+      return std::vector<int>(values.begin(), values.end());
+    }
+    case META_ATTR_STR:
+      return get_strs();
+    }
+    DOD_THROW(
+        OpsFusion::dod_format("MetaBin : Unknown attribute kind {}", kind));
+  }
+
+  const char *ptr_;
+  const char *end_;
+  std::vector<std::string_view> strings_;
+};
+
+static void save_meta_bin(const Metadata &meta, const std::string &meta_bin) {
+  auto data = MetaBinWriter().write(meta);
+  std::ofstream ofs(meta_bin, std::ios::binary);
+  DOD_ASSERT(ofs.is_open(),
+             OpsFusion::dod_format("Couldn't open {} for writing", meta_bin));
+  ofs.write(reinterpret_cast<const char *>(data.data()), data.size());
+  DOD_ASSERT(ofs.good(),
+             OpsFusion::dod_format("Failed to write {}", meta_bin));
+}
+
+static bool is_meta_bin(const std::string &meta_file) {
+  std::ifstream ifs(meta_file, std::ios::binary);
+  char magic[sizeof(META_BIN_MAGIC)] = {};
+  ifs.read(magic, sizeof(magic));
+  return ifs.gcount() == sizeof(magic) &&
+         memcmp(magic, META_BIN_MAGIC, sizeof(magic)) == 0;
+}
+
+static Metadata load_meta_bin(const std::string &meta_bin) {
+  RYZENAI_LOG_TRACE(
+      OpsFusion::dod_format("Loading the binary meta {} ...", meta_bin));
+  Utils::MappedFile file(meta_bin);
+  Metadata meta;
+  try {
+    meta = MetaBinReader(file.data(), file.size()).read();
+  } catch (std::exception &e) {
+    DOD_THROW(OpsFusion::dod_format("Failed to load {} (Detail: {})",
+                                    meta_bin, e.what()));
+  }
+  meta.json_path = meta_bin;
+  RYZENAI_LOG_TRACE("Loading the binary meta ... DONE");
+  return meta;
+}
+
+} // namespace OpsFusion
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <op_fuser/fusion_rt.hpp>
+#include <xrt_context/xrt_context.hpp>
+
+namespace OpsFusion {
+
+// Runs the independent subgraphs of a model concurrently, each with a
+// FusionRuntime on its own hw_context, e.g. hw contexts on different column
+// sets. Subgraphs only share graph inputs, branches merging back into a
+// common op stay in one subgraph (see split_independent_subgraphs).
+// Inputs/outputs are passed in the order of the whole model, like for
+// FusionRuntime::execute().
+class ParallelFusionRuntime {
+public:
+  // Uses hw contexts [0, num_contexts) of the xclbin's context pool.
+  ParallelFusionRuntime(const std::string &xclbin, size_t num_contexts,
+                        const std::string &kernel_name_prefix = "DPU");
+  // At most one subgraph per hw_context.
+  ParallelFusionRuntime(const std::vector<xrt::hw_context *> &ctxs,
+                        const std::string &kernel_name_prefix = "DPU");
+  ParallelFusionRuntime(const ParallelFusionRuntime &) = delete;
+  ParallelFusionRuntime &operator=(const ParallelFusionRuntime &) = delete;
+
+  void init(const Metadata &meta, const std::string &base_dir = "",
+            const DDConfig &cfg = {});
+
+  // Submits all the subgraphs, then waits for all of them.
+  void execute(const std::vector<Tensor> &inputs,
+               const std::vector<Tensor> &outputs);
+
+  size_t get_num_subgraphs() const;
+  const FusionRuntime &get_runtime(size_t subgraph_idx) const;
+
+private:
+  struct Subgraph {
+    std::unique_ptr<FusionRuntime> rt;
+    // index of each input/output of the subgraph in those of the model
+    std::vector<size_t> input_ids;
+    std::vector<size_t> output_ids;
+  };
+
+  std::vector<std::shared_ptr<ryzenai::dynamic_dispatch::xrt_context>>
+      xrt_ctxs_;
+  std::vector<xrt::hw_context *> ctxs_;
+  std::string kernel_name_prefix_;
+  size_t num_inputs_ = 0;
+  size_t num_outputs_ = 0;
+  std::vector<Subgraph> subgraphs_;
+  std::mutex execute_mutex_;
+};
+
+} // namespace OpsFusion
@@ -92,6 +92,24 @@ public:
                std::vector<Tensor> &output) override;
   void execute(std::vector<xrt::bo> &input,
                std::vector<xrt::bo> &output) override;
+  /*
+   * Start the kernel on the given BOs without waiting for it. Runs of the
+   * same hw context complete in submission order, so ops chained through
+   * their BOs can be submitted back to back and waited for once.
+   */
+  xrt::run submit(std::vector<xrt::bo> &input, std::vector<xrt::bo> &output);
+  /*
+   * Write the [B, R, C] view at view.data into bo as the dense [B * R, C]
+   * operand the kernel reads, and sync what was written. strides are the
+   * batch and row strides of the view in elements, its rows are
+   * contiguous, so a slice of a KV cache allocated for the max sequence
+   * length is read in place. The first cached_rows rows of every batch are
+   * already in bo from a previous call: appending to the cache only writes
+   * the new rows.
+   */
+  static void write_strided(xrt::bo &bo, const Tensor &view,
+                            const std::vector<size_t> &strides,
+                            size_t cached_rows = 0);
   void debug(bool enable);
   std::vector<xrt::bo> allocate_inputs();
   std::vector<xrt::bo> allocate_outputs();
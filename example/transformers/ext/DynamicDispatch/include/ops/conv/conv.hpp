@@ -7,7 +7,30 @@
 namespace ryzenai {
 template <typename InT, typename WtT, typename OutT>
 class conv : public OpInterface {
-  using WtsListType = std::vector<std::vector<std::vector<std::vector<WtT>>>>;
+  /* weights in Co Ci Ky Kx order */
+  struct WtsTensor {
+    int64_t Co, Ci, Ky, Kx;
+    std::vector<WtT> data;
+    WtsTensor(int64_t Co, int64_t Ci, int64_t Ky, int64_t Kx, WtT val = 0)
+        : Co(Co), Ci(Ci), Ky(Ky), Kx(Kx), data(Co * Ci * Ky * Kx, val) {}
+    WtT &at(int64_t o, int64_t i, int64_t y, int64_t x) {
+      return data[((o * Ci + i) * Ky + y) * Kx + x];
+    }
+    const WtT &at(int64_t o, int64_t i, int64_t y, int64_t x) const {
+      return data[((o * Ci + i) * Ky + y) * Kx + x];
+    }
+  };
+  /* one subvolume of the weights, [o_begin, o_begin + Cout) x
+   * [i_begin, i_begin + Cin) of WtsTensor */
+  struct WtsTile {
+    int64_t o_begin;
+    int64_t Cout;
+    int64_t i_begin;
+    int64_t Cin;
+    std::vector<int32_t> qdq;
+    /* byte offset of the formatted weights in the const buffer */
+    size_t offset = 0;
+  };
 
 private:
   std::map<std::string, std::string> xclbin_a_header;
@@ -99,25 +122,30 @@ private:
   std::vector<int32_t> qdq_header(int64_t *qdq, int32_t ofm_height,
                                   int32_t ofm_width, int32_t ofm_depth_start,
                                   int32_t ofm_depth_end);
-  int64_t
-  ConcatenateWeightParams(void *dest, const std::vector<WtsListType> &wts_list,
-                          const std::vector<std::vector<int32_t>> &qdq_list,
-                          /* uint8_t *lp, */ int ifm_depth, int cstride,
-                          int ksize_x, int ksize_y);
+  int64_t ConcatenateWeightParams(void *dest, const WtsTensor &wts,
+                                  std::vector<WtsTile> &tiles, int cstride);
   /* Concat weight params for convA16W16 */
-  int64_t
-  ConcatenateWeightParams(void *dest, const std::vector<WtsListType> &wts_list,
-                          const std::vector<uint8_t> &conv_lp,
-                          const std::vector<std::vector<int32_t>> &qdq_list,
-                          /* uint8_t *lp, */ int ifm_depth, int cstride,
-                          int ksize_x, int ksize_y);
-  WtsListType TransformWts(const WtsListType &wts, uint8_t ksize_x,
-                           uint8_t ksize_y, uint8_t wts_zp);
-  WtsListType TransformWtsWithZp(const WtsListType &wtsOld);
-  int64_t ConcatenateWeightParams_dwc(
-      void *dest, const std::vector<WtsListType> &wts_list,
-      const std::vector<std::vector<int32_t>> &qdq_list, int ifm_depth,
-      int cstride, int ksize_x, int ksize_y);
+  int64_t ConcatenateWeightParams(void *dest, const WtsTensor &wts,
+                                  std::vector<WtsTile> &tiles,
+                                  const std::vector<uint8_t> &conv_lp,
+                                  int cstride);
+  int64_t ConcatenateWeightParams_dwc(void *dest, const WtsTensor &wts,
+                                      std::vector<WtsTile> &tiles,
+                                      int ifm_depth, int cstride, int ksize_x,
+                                      int ksize_y);
+  /* number of weights of a formatted tile */
+  static size_t TileWtsSize(const WtsTile &tile, int istride, int ksize_x,
+                            int ksize_y);
+  /* formats the weights of all tiles in parallel, over blocks of 8 output
+   * channels. For conv every istride input channels are interleaved, for dwc
+   * (i_inner == 1) only the first of them is taken. */
+  void FormatWtsTiles(void *dest, const WtsTensor &wts,
+                      const std::vector<WtsTile> &tiles, int istride,
+                      int i_inner, int ksize_x, int ksize_y);
+  WtsTensor TransformWts(const WtsTensor &wts, uint8_t ksize_x,
+                         uint8_t ksize_y, uint8_t wts_zp);
+  WtsTensor TransformWtsWithZp(const WtsTensor &wtsOld);
+  WtsTensor ReadWts(const Tensor &weights);
   void WriteToFile(void *src, uint64_t length);
   void initialize_const_params_conv(void *dest,
                                     const std::vector<Tensor> &const_params);
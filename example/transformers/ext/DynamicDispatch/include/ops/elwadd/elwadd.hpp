@@ -114,6 +114,8 @@ public:
   std::vector<OpArgMap>
   get_buffer_reqs(std::vector<Tensor> &input, std::vector<Tensor> &output,
                   const std::map<std::string, std::any> &attr = {}) override;
+  /* size of the qdq params in the const buffer */
+  static size_t get_const_params_bo_size();
 };
 
 } // namespace ryzenai
@@ -20,6 +20,8 @@ private:
   /*Kernel shape selected in runtime*/
   /* actual M x K of matrix A */
   int64_t operand_shape_[2];
+  /* [M, N] a broadcast const RHS is expanded to, set by get_buffer_reqs */
+  std::vector<size_t> bcast_shape_;
 
   /* xrt context handle */
   // xrt_context *xrt_ctx_;
@@ -75,6 +77,7 @@ public:
                std::vector<xrt::bo> &output) override;
 
   void debug(bool enable);
+  OpExecTimes get_exec_times() const override;
   std::vector<xrt::bo> get_inputs() {
     std::vector<xrt::bo> inputs = {a_bo_, b_bo_};
     return inputs;
@@ -91,6 +94,9 @@ public:
   get_super_kernel_params(std::vector<Tensor> &input,
                           std::vector<Tensor> &output,
                           const std::map<std::string, std::any> &attr = {});
+  void
+  initialize_const_params(void *dest, const std::vector<Tensor> &const_params,
+                          const std::map<std::string, std::any> &attr = {});
   std::vector<OpArgMap>
   get_buffer_reqs(std::vector<Tensor> &input, std::vector<Tensor> &output,
                   const std::map<std::string, std::any> &attr = {}) override;
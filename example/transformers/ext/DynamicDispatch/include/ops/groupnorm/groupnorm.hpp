@@ -111,6 +111,8 @@ public:
   std::vector<OpArgMap>
   get_buffer_reqs(std::vector<Tensor> &input, std::vector<Tensor> &output,
                   const std::map<std::string, std::any> &attr = {}) override;
+  /* size of gamma, beta & qdq params in the const buffer */
+  static size_t get_const_params_bo_size(size_t gamma_dim, size_t beta_dim);
 };
 
 } // namespace ryzenai
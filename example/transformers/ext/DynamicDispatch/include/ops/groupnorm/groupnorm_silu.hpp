@@ -0,0 +1,63 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <ops/groupnorm/groupnorm.hpp>
+#include <ops/op_interface.hpp>
+#include <ops/ops_common.hpp>
+#include <ops/silu_qdq/silu_qdq.hpp>
+
+namespace ryzenai {
+
+/*
+ * GroupNorm followed by SiLU, as in the ResNet blocks of diffusion UNets.
+ * Runs the groupnorm & silu transactions back to back as a single op, the
+ * bf16 groupnorm output stays in the op's internal scratch pad instead of
+ * being a tensor of the graph.
+ *
+ * onnx args : [input, gamma, beta, groupnorm qdq_params, silu qdq_params,
+ *              output]
+ */
+template <typename InT, typename WtT, typename OutT>
+class groupnorm_silu : public OpInterface {
+private:
+  std::unique_ptr<groupnorm<InT, WtT, uint16_t>> gpn_;
+  std::unique_ptr<silu_qdq<uint16_t, uint16_t, OutT>> silu_;
+
+  struct sub_op_reqs_t {
+    size_t input_size = 0;
+    size_t const_size = 0;
+    size_t output_size = 0;
+    size_t super_kernel_size = 0;
+  };
+
+  // split the args of this op into the args of groupnorm/silu
+  std::vector<Tensor> get_gpn_tensors(const std::vector<Tensor> &tensors,
+                                      const Tensor &mid) const;
+  std::vector<Tensor> get_silu_tensors(const std::vector<Tensor> &tensors,
+                                       const Tensor &mid) const;
+  Tensor get_mid_tensor(const std::vector<Tensor> &tensors) const;
+  sub_op_reqs_t get_sub_op_reqs(OpInterface &op, std::vector<Tensor> &tensors);
+
+public:
+  groupnorm_silu(const std::string &a_dtype, const std::string &c_dtype,
+                 bool load_xrt, const std::map<std::string, std::any> &attr);
+  void
+  initialize_const_params(void *dest, const std::vector<Tensor> &const_params,
+                          const std::map<std::string, std::any> &attr = {});
+  const std::vector<uint8_t> get_transaction_bin(
+      std::vector<Tensor> &input, std::vector<Tensor> &output,
+      const std::map<std::string, std::any> &attr = {}) override;
+  const std::vector<uint8_t> get_super_kernel_params(
+      std::vector<Tensor> &input, std::vector<Tensor> &output,
+      const std::map<std::string, std::any> &attr = {}) override;
+  std::vector<OpArgMap>
+  get_buffer_reqs(std::vector<Tensor> &input, std::vector<Tensor> &output,
+                  const std::map<std::string, std::any> &attr = {}) override;
+};
+
+} // namespace ryzenai
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <functional>
+
+#include <ops/op_interface.hpp>
+
+namespace ryzenai {
+
+// CPU kernel of a HOST_OP. The tensors point into the mapped BOs of the
+// FusionRuntime running the op, inputs and outputs in the order of the args.
+using host_kernel_t = std::function<void(
+    const std::vector<Tensor> &inputs, std::vector<Tensor> &outputs,
+    const std::map<std::string, std::any> &attr)>;
+
+// Kernels are looked up by name, register them before the init() of a
+// FusionRuntime running them. Registering a name again replaces the kernel
+// for the runtimes initialized from then on.
+void register_host_kernel(const std::string &name, host_kernel_t kernel);
+bool is_host_kernel_registered(const std::string &name);
+
+// Op of the graph that DD can't run on the NPU. It is run on the CPU by
+// FusionRuntime between the NPU partitions, so the graph stays in one
+// runtime. Its args are tensors of the in/out/scratch buffers, consts are not
+// supported.
+// attrs:
+//   "kernel"     : name of the registered kernel
+//   "num_inputs" : the first num_inputs args are inputs, the others outputs.
+//                  By default, all the args but the last one are inputs.
+class host_op : public OpInterface {
+public:
+  host_op(const std::map<std::string, std::any> &attr);
+  std::vector<OpArgMap>
+  get_buffer_reqs(std::vector<Tensor> &input, std::vector<Tensor> &output,
+                  const std::map<std::string, std::any> &attr) override;
+  const std::map<std::string, std::any> &get_attr() const override {
+    return attr_;
+  }
+  void execute(std::vector<Tensor> &input,
+               std::vector<Tensor> &output) override;
+
+private:
+  std::map<std::string, std::any> attr_;
+  host_kernel_t kernel_;
+};
+
+} // namespace ryzenai
@@ -0,0 +1,64 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <ops/elwadd/elwadd.hpp>
+#include <ops/layernorm/layernorm.hpp>
+#include <ops/op_interface.hpp>
+#include <ops/ops_common.hpp>
+
+namespace ryzenai {
+
+/*
+ * Residual add followed by LayerNorm, as in every BERT/ViT encoder layer.
+ * Runs the elwadd & layernorm transactions back to back as a single op, the
+ * bf16 sum is written to the op's internal scratch pad and read from there.
+ * If the sum is also needed in the graph, e.g. as the next residual, it is
+ * passed as an optional last arg and written there instead.
+ *
+ * onnx args : [input_a, input_b, add qdq_params, gamma, beta,
+ *              layernorm qdq_params, output, sum (optional)]
+ */
+template <typename InT, typename WtT, typename OutT>
+class add_layernorm : public OpInterface {
+private:
+  std::unique_ptr<elw_add<InT, WtT, uint16_t>> add_;
+  std::unique_ptr<layernorm<int16_t, int16_t, OutT>> lrn_;
+
+  struct sub_op_reqs_t {
+    std::vector<OpArgMap> inputs;
+    size_t const_size = 0;
+    size_t output_size = 0;
+    size_t super_kernel_size = 0;
+  };
+
+  // split the args of this op into the args of elwadd/layernorm
+  std::vector<Tensor> get_add_tensors(const std::vector<Tensor> &tensors,
+                                      const Tensor &sum) const;
+  std::vector<Tensor> get_lrn_tensors(const std::vector<Tensor> &tensors,
+                                      const Tensor &sum) const;
+  Tensor get_sum_tensor(const std::vector<Tensor> &tensors) const;
+  sub_op_reqs_t get_sub_op_reqs(OpInterface &op, std::vector<Tensor> &tensors);
+
+public:
+  add_layernorm(const std::string &a_dtype, const std::string &c_dtype,
+                bool load_xrt, const std::map<std::string, std::any> &attr);
+  void
+  initialize_const_params(void *dest, const std::vector<Tensor> &const_params,
+                          const std::map<std::string, std::any> &attr = {});
+  const std::vector<uint8_t> get_transaction_bin(
+      std::vector<Tensor> &input, std::vector<Tensor> &output,
+      const std::map<std::string, std::any> &attr = {}) override;
+  const std::vector<uint8_t> get_super_kernel_params(
+      std::vector<Tensor> &input, std::vector<Tensor> &output,
+      const std::map<std::string, std::any> &attr = {}) override;
+  std::vector<OpArgMap>
+  get_buffer_reqs(std::vector<Tensor> &input, std::vector<Tensor> &output,
+                  const std::map<std::string, std::any> &attr = {}) override;
+};
+
+} // namespace ryzenai
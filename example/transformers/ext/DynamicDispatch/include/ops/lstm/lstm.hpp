@@ -41,6 +41,10 @@ private:
   xrt::bo constBo_;
   /* XRT BO for tiled output matrix */
   xrt::bo ofmBo_;
+  /* second IFM/OFM BO pair, so that execute_stream can upload the next chunk
+   * while the current one runs */
+  xrt::bo ifmBoNext_;
+  xrt::bo ofmBoNext_;
   /* size for input activation dtype*/
 
   int ifmDtypeSize_;
@@ -86,6 +90,11 @@ public:
   initialize_const_params(const std::vector<Tensor> &const_params,
                           const std::map<std::string, std::any> &attr = {});
   void execute(const std::vector<Tensor> &input, std::vector<Tensor> &output);
+  /* Run a sequence of chunks of the same shape, input.at(i) -> output.at(i).
+   * The next chunk is uploaded and the previous output is read back while
+   * the current chunk runs. */
+  void execute_stream(const std::vector<Tensor> &input,
+                      std::vector<Tensor> &output);
   void debug(bool enable);
   const std::vector<uint8_t> get_transaction_bin(
       std::vector<Tensor> &input, std::vector<Tensor> &output,
@@ -54,6 +54,12 @@ private:
   std::string operand_dtype_;
   std::string txn_fname_prefix_;
   std::string param_fname_prefix_;
+  /* BxMxK the padding of the BOs is set up for */
+  std::tuple<int, int, int> staged_shape_{0, 0, 0};
+  /* mask BO holds the causal mask of staged_shape_ */
+  bool causal_mask_staged_ = false;
+  /* bfloat16 -inf */
+  static constexpr MaskT MASK_NEG_INF = 0xFF80;
 
   /*
    * Utility function that setups the instruction registry with transaction
@@ -65,6 +71,16 @@ private:
    * execution.
    */
   bool isSupportedShape(const Tensor &operand);
+  /*
+   * Utility function that checks if an operand fits in the kernel shape, a
+   * shorter sequence or fewer heads run padded to it.
+   */
+  bool fitsKernelShape(const Tensor &operand);
+  /*
+   * Writes the M rows of the mask to the mask BO, the causal mask if mask
+   * is null, and masks out the columns from K to the kernel width.
+   */
+  void stage_mask(const MaskT *mask, int M, int K);
 
   std::string get_instr_key(std::string prefix, int batch, int m, int k);
 
@@ -74,7 +90,10 @@ public:
                std::vector<Tensor> &output) override;
   void execute(std::vector<xrt::bo> &input,
                std::vector<xrt::bo> &output) override;
+  /* Start the kernel without waiting for it, see bmm::submit */
+  xrt::run submit(std::vector<xrt::bo> &input, std::vector<xrt::bo> &output);
   void debug(bool enable);
+  OpExecTimes get_exec_times() const override;
   std::vector<xrt::bo> get_inputs();
   const std::vector<uint8_t> get_transaction_bin(
       std::vector<Tensor> &input, std::vector<Tensor> &output,
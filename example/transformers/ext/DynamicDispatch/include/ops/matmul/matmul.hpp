@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include <ops/op_interface.hpp>
 #include <ops/ops_common.hpp>
 
@@ -74,10 +76,29 @@ private:
   std::string txn_fname_prefix_;
   std::string param_fname_prefix_;
 
+  /* kernel of a padded shape, with its instruction & param BO keys */
+  struct kernel_entry {
+    std::array<int64_t, 3> shape; // M, K, N
+    std::string instr_key;
+    std::string param_key;
+  };
+  /* sorted by raw shape, index of the padded shape in default_shapes_ */
+  std::vector<std::pair<std::array<int64_t, 3>, size_t>> raw_shape_lut_;
+  /* sorted by padded shape */
+  std::vector<kernel_entry> kernel_lut_;
+
+  /* overlay variants, e.g. "4x4" for the gemm_4x4_* txns */
+  static const std::vector<std::string> overlay_variants_;
+
   void set_kernel_shapes();
   void setup_instr_registry();
+  std::string select_overlay_variant(int num_cols);
   std::string get_instr_key(std::string prefix, int m, int k, int n);
+  void build_shape_luts();
+  const kernel_entry &find_kernel(int64_t M, int64_t K, int64_t N) const;
   std::tuple<int, int, int> map_padded_shape(int M, int K, int N);
+  std::tuple<int, int, std::vector<int>> get_m_tiles(int M, int K, int N,
+                                                        int max_m);
 
 public:
   matmul(const std::string &a_dtype, const std::string &b_dtype,
@@ -91,6 +112,7 @@ public:
                           const std::map<std::string, std::any> &attr = {});
   void execute(const std::vector<Tensor> &input, std::vector<Tensor> &output);
   void debug(bool enable);
+  OpExecTimes get_exec_times() const override;
   void set_params(const std::string &model_name,
                   std::vector<size_t> input_shape);
   const std::vector<uint8_t> get_transaction_bin(
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <ops/op_interface.hpp>
+#include <ops/ops_common.hpp>
+
+namespace ryzenai {
+
+/*
+ * matmul_a16w4_mladf offloads uint16 x uint4 group quantized matrix
+ * multiplications to AIE. It is the int4 weight variant of
+ * matmul_a16w8_mladf: same subvolume tiling, with two weights per byte and
+ * the qdq coefficients of every quantization group of a subvolume stored
+ * after its weights, so a w4 graph reads half of the a16w8 weight bytes.
+ */
+template <typename InT, typename WtT, typename OutT>
+class matmul_a16w4_mladf : public OpInterface {
+private:
+  std::string DPU_DIR;
+  std::map<std::string, std::string> txnbin_a_header;
+  std::map<std::string, std::string> txnbin_b_header;
+  std::map<std::string, std::string> txnbin_acc_header;
+  std::map<std::string, std::vector<matrix_shapes>> default_shapes_;
+
+  /* M x K dimension of base matmul being offloaded to AIE */
+  int64_t kernel_x_shape_[2];
+  /* K x N dimension of base matmul being offloaded to AIE */
+  int64_t kernel_y_shape_[2];
+  /* M x N dimension of base matmul being offloaded to AIE */
+  int64_t kernel_z_shape_[2];
+  /*Kernel shape selected in runtime*/
+  int64_t kernel_x_rows;
+  /* Max Kernel M size supported for a given model*/
+  int KERNEL_M_MAX;
+  /* actual param shape of matmul */
+  int64_t param_shape_[1];
+  /* actual M x K of matrix A */
+  int64_t a_shape_[2];
+  /* actual M x N of matrix A */
+  int64_t c_shape_[2];
+  /* actual K x N of matrix A */
+  int64_t w_shape_[2];
+  /* rows of K sharing a scale and zero point */
+  int group_size_;
+  static std::once_flag instr_reg_flag_;
+  /* XRT BO for tiled param */
+  xrt::bo param_bo_;
+  /* XRT BO for tiled activation matrix */
+  xrt::bo a_bo_;
+  /* XRT BO for tiled weight matrix */
+  xrt::bo b_bo_;
+  /* XRT BO for tiled output matrix */
+  xrt::bo c_bo_;
+  /* size for param dtype*/
+  int param_dtype_size_;
+  /* size for input activation dtype*/
+  int a_dtype_size_;
+  /* size for output activation dtype*/
+  int c_dtype_size_;
+  /* variables to store profile data */
+  int64_t param_copy_time_;
+  int64_t param_sync_time_;
+  int64_t a_copy_time_;
+  int64_t a_sync_time_;
+  int64_t b_copy_time_;
+  int64_t b_format_time_;
+  int64_t b_sync_time_;
+  int64_t c_copy_time_;
+  int64_t c_sync_time_;
+  int64_t run_aie_time_;
+  int64_t num_run_aie_;
+  static std::once_flag logger_flag_;
+  uint64_t matmul_mladf_id_;
+  static uint64_t matmul_mladf_count;
+  /* debug flag */
+  bool debug_ = false;
+  /*xclbin and mc_code selection variables*/
+  std::string a_dtype_;
+  std::string b_dtype_;
+  std::string c_dtype_;
+  std::string txn_fname_prefix_;
+
+  std::vector<uint8_t> kernel_params_;
+
+  /* Utility function to set the kernel shape based on the weights dimensions
+   */
+  void set_kernel_shapes();
+
+  /*
+   * Utility function that setups the instruction registry with transaction
+   * binaries.
+   */
+  void setup_instr_registry();
+
+  std::string get_instr_key(std::string prefix, int m, int k, int n);
+  /* Smallest supported M of the K x N weights that fits M rows */
+  int map_padded_shape(int M, int K, int N);
+  /* Size of the formatted weights and qdq coefficients */
+  static size_t get_wts_size(int K, int N, int group_size);
+
+public:
+  /*
+   * matmul_a16w4_mladf class constructor
+   *
+   * NOTE: the activation is padded to the smallest supported M that fits
+   * its rows, the rows past the actual M are not copied back.
+   */
+  matmul_a16w4_mladf(const std::string &a_dtype, const std::string &b_dtype,
+                     const std::string &c_dtype, bool load_xrt);
+  void execute(const std::vector<Tensor> &input, std::vector<Tensor> &output);
+  void debug(bool enable);
+  void set_params(const std::string &model_name,
+                  std::vector<size_t> input_shape);
+  const std::vector<uint8_t> get_transaction_bin(
+      std::vector<Tensor> &input, std::vector<Tensor> &output,
+      const std::map<std::string, std::any> &attr = {}) override;
+  std::vector<OpArgMap>
+  get_buffer_reqs(std::vector<Tensor> &input, std::vector<Tensor> &output,
+                  const std::map<std::string, std::any> &attr = {}) override;
+  void initialize_wts(void *dest, const std::vector<Tensor> &const_params,
+                      const std::map<std::string, std::any> &attr = {});
+  void
+  initialize_const_params(const std::vector<Tensor> &const_params,
+                          const std::map<std::string, std::any> &attr = {});
+  void
+  initialize_const_params(void *dest, const std::vector<Tensor> &const_params,
+                          const std::map<std::string, std::any> &attr = {});
+  const std::vector<uint8_t>
+  get_super_kernel_params(std::vector<Tensor> &input,
+                          std::vector<Tensor> &output,
+                          const std::map<std::string, std::any> &attr = {});
+};
+
+} // namespace ryzenai
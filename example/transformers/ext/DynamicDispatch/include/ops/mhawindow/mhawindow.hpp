@@ -72,6 +72,10 @@ private:
   int c_dtype_size_;
   std::string txn_fname_prefix_;
   std::string param_fname_prefix_;
+  /* side of the attention windows, 0 if the input is already partitioned */
+  size_t window_size_ = 0;
+  /* cyclic shift of the shifted window blocks */
+  size_t shift_size_ = 0;
 
   /*
    * Utility function that setups the instruction registry with transaction
@@ -82,6 +86,15 @@ private:
   std::string get_instr_key(std::string prefix, std::vector<size_t> &mat);
 
 public:
+  /*
+   * NOTE: with the "window_size" (and "shift_size") attrs of
+   * initialize_const_params(), execute() takes QKV in image order,
+   * [1, H * W, 3 * C], and returns the output in image order, set_params()
+   * still takes the [#windows, tokens, 3 * C] shape of the kernel. The
+   * cyclic shift & window partition are done while copying QKV to the
+   * input BO, the window reverse while copying out of the output BO, so
+   * a Swin block needs no roll/partition/reverse ops around the attention.
+   */
   mhawindow(const std::string &a_dtype, const std::string &b_dtype,
             const std::string &c_dtype, bool load_xrt = true);
   void debug(bool enable);
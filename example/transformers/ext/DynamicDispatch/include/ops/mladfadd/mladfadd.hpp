@@ -20,6 +20,8 @@ private:
   /*Kernel shape selected in runtime*/
   /* actual M x K of matrix A */
   int64_t operand_shape_[2];
+  /* [M, N] a broadcast const RHS is expanded to, set by get_buffer_reqs */
+  std::vector<size_t> bcast_shape_;
 
   /* xrt context handle */
   // xrt_context *xrt_ctx_;
@@ -71,6 +73,7 @@ public:
   mladf_add(const std::string &operand_dtype, bool load_xrt);
   void execute(const std::vector<Tensor> &input, std::vector<Tensor> &output);
   void debug(bool enable);
+  OpExecTimes get_exec_times() const override;
 
   const std::vector<uint8_t> get_transaction_bin(
       std::vector<Tensor> &input, std::vector<Tensor> &output,
@@ -79,6 +82,9 @@ public:
   get_super_kernel_params(std::vector<Tensor> &input,
                           std::vector<Tensor> &output,
                           const std::map<std::string, std::any> &attr = {});
+  void
+  initialize_const_params(void *dest, const std::vector<Tensor> &const_params,
+                          const std::map<std::string, std::any> &attr = {});
   std::vector<OpArgMap>
   get_buffer_reqs(std::vector<Tensor> &input, std::vector<Tensor> &output,
                   const std::map<std::string, std::any> &attr = {}) override;
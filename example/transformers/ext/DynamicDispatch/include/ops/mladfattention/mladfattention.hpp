@@ -0,0 +1,86 @@
+#pragma once
+
+#include <ops/bmm/bmm.hpp>
+#include <ops/maskedsoftmax/maskedsoftmax.hpp>
+#include <ops/mladfmatmulbias/mladfmatmulbias.hpp>
+#include <ops/mladfmharope/mladfmharope.hpp>
+#include <ops/op_interface.hpp>
+#include <ops/ops_common.hpp>
+
+namespace ryzenai {
+
+/*
+ * mladf_attention is a class to offload the attention block of a decoder
+ * layer to AIE : Q/K/V projection, rotary embedding of Q & K, and
+ * softmax(Q x K^T + mask) x V. Stages run back to back on BOs that stay on
+ * device; the host only reorders heads b/w the projection and attention
+ * layouts. this class uses lite runtime stack to interface with XRT
+ *
+ * inputs  : [x (1 x M x E), trig (2 x M x D), mask (1 x M x M)]
+ * consts  : [wts, bias, scales, zeros] of the Q, K & V projections
+ * outputs : [attention output (1 x M x E)], E = NUM_HEADS x HEAD_DIM
+ */
+template <typename InT, typename WtT, typename OutT>
+class mladf_attention : public OpInterface {
+private:
+  using proj_t = mladfmatmulbias<InT, WtT, OutT, OutT>;
+  using rope_t = mha_rope<uint16_t, uint16_t, uint16_t>;
+  using bmm_t = bmm<uint16_t, uint16_t, uint16_t>;
+  using softmax_t = masked_softmax<uint16_t, uint16_t, uint16_t>;
+
+  proj_t q_proj_;
+  proj_t k_proj_;
+  proj_t v_proj_;
+  rope_t rope_;
+  /* Q x K^T */
+  bmm_t bmm1_;
+  /* P x V */
+  bmm_t bmm2_;
+  softmax_t softmax_;
+
+  std::vector<xrt::bo> bmm1_inputs_;
+  std::vector<xrt::bo> bmm1_outputs_;
+  std::vector<xrt::bo> bmm2_inputs_;
+  std::vector<xrt::bo> bmm2_outputs_;
+  xrt::bo mask_bo_;
+
+  /* variables to store profile data */
+  int64_t a_copy_time_;
+  int64_t host_reorder_time_;
+  int64_t c_copy_time_;
+  int64_t run_aie_time_;
+  int64_t num_run_aie_;
+  static std::once_flag logger_flag_;
+  uint64_t mladf_attention_id_;
+  static uint64_t mladf_attention_count;
+  /* debug flag */
+  bool debug_ = false;
+  bool load_xrt_;
+  std::string a_dtype_;
+
+  void run_projection(proj_t &proj, xrt::bo &x_bo, int64_t M);
+
+public:
+  static constexpr size_t NUM_HEADS = 32;
+  static constexpr size_t HEAD_DIM = 128;
+  /* sequence length supported by the bmm and softmax kernels */
+  static constexpr size_t SEQ_LEN = 2048;
+
+  mladf_attention(const std::string &a_dtype, const std::string &b_dtype,
+                  bool load_xrt);
+  void
+  initialize_const_params(const std::vector<Tensor> &const_params,
+                          const std::map<std::string, std::any> &attr = {});
+  void execute(std::vector<Tensor> &input,
+               std::vector<Tensor> &output) override;
+  void debug(bool enable);
+
+  const std::vector<uint8_t> get_transaction_bin(
+      std::vector<Tensor> &input, std::vector<Tensor> &output,
+      const std::map<std::string, std::any> &attr = {}) override;
+  std::vector<OpArgMap>
+  get_buffer_reqs(std::vector<Tensor> &input, std::vector<Tensor> &output,
+                  const std::map<std::string, std::any> &attr = {}) override;
+};
+
+} // namespace ryzenai
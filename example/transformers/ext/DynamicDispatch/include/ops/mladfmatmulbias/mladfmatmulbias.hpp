@@ -88,6 +88,22 @@ private:
   std::string txn_fname_prefix_;
   bool initialized_;
   void setup_instr_registry();
+  /* size of the formatted BO of one kernel shaped weight block */
+  int get_weight_block_size(int group_size) const;
+  void format_weight_tile(WtT *bo_map, int64_t rb, int64_t cb, int group_size,
+                          const int8_t *weights, const int8_t *zeros,
+                          const float *scales, const float *bias) const;
+  /* empty if the weight cache is disabled */
+  std::string get_weight_cache_path(const std::vector<Tensor> &const_params,
+                                    int group_size, size_t num_tiles) const;
+  bool load_weight_cache(
+      const std::string &path,
+      const std::vector<std::tuple<int64_t, int64_t, WtT *>> &tiles,
+      int block_size) const;
+  void save_weight_cache(
+      const std::string &path,
+      const std::vector<std::tuple<int64_t, int64_t, WtT *>> &tiles,
+      int block_size) const;
   std::string
   get_instr_key(std::string prefix, int m, int k, int n,
                 int grp_size = 0 /* additional arg for group size*/);
@@ -35,6 +35,26 @@ private:
   /* size for activation dtype*/
   int operand_dtype_size_;
 
+  /*
+   * sin/cos matrices generated on host once per (max_seq_len, head_dim, base)
+   * and shared by all instances, e.g. all layers of a model. The kernel reads
+   * [2, M, head_dim], so a BO per M holds the rows of the current positions
+   * and is only refilled when the position offset changes.
+   */
+  struct trig_table {
+    /* [2, max_seq_len, head_dim] : cos then sin */
+    std::vector<TrigT> host;
+    /* M --> (BO of [2, M, head_dim], position offset it holds) */
+    std::map<int64_t, std::pair<xrt::bo, int64_t>> kernel_bos;
+  };
+  static std::map<std::tuple<size_t, int64_t, float>, trig_table>
+      trig_tables_;
+  static std::mutex trig_tables_mutex_;
+  /* 0 : trig matrices are the 2nd input of execute() */
+  size_t trig_max_seq_len_ = 0;
+  float trig_base_ = 10000.0f;
+  int64_t trig_pos_offset_ = 0;
+
   /* variables to store profile data */
   int64_t a_copy_time_;
   int64_t a_sync_time_;
@@ -65,13 +85,32 @@ private:
    * execution.
    */
   bool isSupportedShape(const Tensor &operand);
+  /*
+   * Utility function that returns the cached trig BO for positions
+   * [trig_pos_offset_, trig_pos_offset_ + M), filling it if needed.
+   */
+  xrt::bo get_trig_bo(int64_t M, int64_t K, int64_t &copy_time,
+                      int64_t &sync_time);
 
   std::string get_instr_key(std::string prefix, int batch, int m, int k);
 
 public:
   mha_rope(const std::string &operand_dtype, bool load_xrt);
   void execute(const std::vector<Tensor> &input, std::vector<Tensor> &output);
+  void execute(std::vector<xrt::bo> &input,
+               std::vector<xrt::bo> &output) override;
   void debug(bool enable);
+  OpExecTimes get_exec_times() const override;
+  std::vector<xrt::bo> get_inputs() { return {a_bo_, b_bo_}; }
+  std::vector<xrt::bo> get_outputs() { return {c_bo_}; }
+  void set_kernel_shape(const std::vector<size_t> &shape);
+  /*
+   * Use precomputed trig matrices instead of the 2nd input of execute(),
+   * for positions [0, max_seq_len) and theta = base ^ (-2i / head_dim).
+   */
+  void set_trig_table(size_t max_seq_len, float base = 10000.0f);
+  /* position of the first row of the activation */
+  void set_position_offset(int64_t pos_offset);
 
   const std::vector<uint8_t> get_transaction_bin(
       std::vector<Tensor> &input, std::vector<Tensor> &output,
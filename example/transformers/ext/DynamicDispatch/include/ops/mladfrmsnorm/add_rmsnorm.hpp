@@ -0,0 +1,48 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <ops/mladfadd/mladfadd.hpp>
+#include <ops/mladfrmsnorm/mladfrmsnorm.hpp>
+#include <ops/op_interface.hpp>
+#include <ops/ops_common.hpp>
+
+namespace ryzenai {
+
+/*
+ * Residual add followed by RMSNorm, as in the decoder layers of llama.
+ * Runs the mladfadd & mladfrmsnorm transactions back to back as a single op,
+ * the sum is written to the op's internal scratch pad and read from there.
+ * If the sum is also needed in the graph, e.g. as the next residual, it is
+ * passed as an optional last arg and written there instead.
+ *
+ * onnx args : [input_a, input_b, rmsnorm weights, output, sum (optional)]
+ */
+template <typename LhsT, typename WtsT, typename OutT>
+class add_rms_norm : public OpInterface {
+private:
+  std::unique_ptr<mladf_add<LhsT, LhsT, LhsT>> add_;
+  std::unique_ptr<rms_norm<LhsT, WtsT, OutT>> rms_;
+
+  // split the args of this op into the args of add/rmsnorm
+  std::vector<Tensor> get_add_tensors(const std::vector<Tensor> &tensors,
+                                      const Tensor &sum) const;
+  std::vector<Tensor> get_rms_tensors(const std::vector<Tensor> &tensors,
+                                      const Tensor &sum) const;
+  Tensor get_sum_tensor(const std::vector<Tensor> &tensors) const;
+
+public:
+  add_rms_norm(const std::string &operand_dtype, bool load_xrt);
+  const std::vector<uint8_t> get_transaction_bin(
+      std::vector<Tensor> &input, std::vector<Tensor> &output,
+      const std::map<std::string, std::any> &attr = {}) override;
+  std::vector<OpArgMap>
+  get_buffer_reqs(std::vector<Tensor> &input, std::vector<Tensor> &output,
+                  const std::map<std::string, std::any> &attr = {}) override;
+};
+
+} // namespace ryzenai
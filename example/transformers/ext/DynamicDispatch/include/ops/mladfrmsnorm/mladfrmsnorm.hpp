@@ -72,6 +72,7 @@ public:
   rms_norm(const std::string &operand_dtype, bool load_xrt);
   void execute(const std::vector<Tensor> &input, std::vector<Tensor> &output);
   void debug(bool enable);
+  OpExecTimes get_exec_times() const override;
 
   const std::vector<uint8_t> get_transaction_bin(
       std::vector<Tensor> &input, std::vector<Tensor> &output,
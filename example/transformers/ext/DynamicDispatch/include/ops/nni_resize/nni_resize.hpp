@@ -58,6 +58,28 @@ private:
   std::string get_instr_key(std::string prefix, int h, int w, int c);
   std::tuple<int, int, int> map_padded_shape(int H, int W, int C);
 
+  /*
+   * The AIE kernel is a fixed 2x nearest neighbour upsample of one of the
+   * supported H x W x C shapes. Larger inputs are split into row slabs of a
+   * supported kernel, contiguous in HWC for both input and output, and
+   * power of 2 scales run the 2x kernel repeatedly through the scratch pad.
+   */
+  struct resize_pass_t {
+    /* H x W x C of the input to this pass */
+    std::tuple<int, int, int> in_shape;
+    /* padded kernel shape selected for the row slabs of this pass */
+    std::tuple<int, int, int> kernel_shape;
+    int num_tiles;
+    size_t tile_in_size;
+    size_t tile_out_size;
+    /* offset of the kernel's layer params in the super kernel params */
+    size_t param_offset;
+  };
+  std::tuple<int, int, int> find_kernel_tile(int H, int W, int C);
+  std::vector<resize_pass_t>
+  get_resize_passes(const std::vector<Tensor> &tensors);
+  std::vector<uint8_t> load_txn_str(const std::string &key);
+
 public:
   nni_resize(const std::string &a_dtype, const std::string &c_dtype,
              bool load_xrt, const std::map<std::string, std::any> &attr);
@@ -19,9 +19,37 @@ public:
   create(const std::string &op_name, const Metadata::OpInfo &op_info,
          const std::map<std::string, Metadata::OffsetInfo> &tensor_map);
 
+  // Op instance of op_info from the OpCacheScope of the calling thread,
+  // created on first use. Without a scope, a new instance.
+  static std::shared_ptr<OpInterface>
+  get_or_create(const Metadata::OpInfo &op_info,
+                const std::map<std::string, Metadata::OffsetInfo> &tensor_map);
+
   static bool is_supported(const std::string &op_type,
                            const std::vector<std::string> &types,
                            const std::map<std::string, std::any> &attr);
 };
 
+// While alive, OpBuilder::get_or_create() on this thread reuses the op
+// instances by op name, e.g. over the passes & init phases of
+// FusionRuntime::init(). An op whose type, arg dtypes or attribute names
+// were changed by a pass gets a new instance. Scopes can be nested, the
+// innermost one is used.
+class OpCacheScope {
+public:
+  OpCacheScope();
+  ~OpCacheScope();
+  OpCacheScope(const OpCacheScope &) = delete;
+  OpCacheScope &operator=(const OpCacheScope &) = delete;
+
+private:
+  friend class OpBuilder;
+  struct Entry {
+    std::string signature;
+    std::shared_ptr<OpInterface> op;
+  };
+  std::map<std::string, Entry> ops_;
+  OpCacheScope *prev_;
+};
+
 } // namespace OpsFusion
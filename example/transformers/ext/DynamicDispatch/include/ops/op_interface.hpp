@@ -35,6 +35,20 @@ struct OpArgMap {
   size_t padding_offset = 0;
 };
 
+// Tensor of an op which is only a byte range of another tensor of the same op
+struct OpTensorView {
+  size_t base_arg_idx; // onnx_arg_idx of the tensor holding the data
+  size_t view_arg_idx; // onnx_arg_idx of the tensor aliasing it
+  size_t offset;       // of the view in the base, in bytes
+};
+
+// Time spent in the phases of the last execute() of an op, in ns
+struct OpExecTimes {
+  int64_t copy = 0; // host buffers <-> BOs
+  int64_t sync = 0; // BO syncs to/from device
+  int64_t run_aie = 0;
+};
+
 class OpInterface {
 public:
   OpInterface() {}
@@ -73,6 +87,15 @@ public:
     return {};
   }
 
+  // If the op only moves data in a way that its inputs/outputs can be placed as
+  // views into one another, return the views. The op is then removed from the
+  // graph, see fold_view_ops_pass.
+  virtual std::vector<OpTensorView>
+  get_tensor_views(std::vector<Tensor> &input, std::vector<Tensor> &output,
+                   const std::map<std::string, std::any> &attr = {}) {
+    return {};
+  }
+
   virtual const std::map<std::string, std::any> &get_attr() const {
     static const std::map<std::string, std::any> empty_map;
     return empty_map;
@@ -84,6 +107,9 @@ public:
   virtual void execute(std::vector<xrt::bo> &input,
                        std::vector<xrt::bo> &output) {}
 
+  // Breakdown of the last execute(), zeros if the op doesn't collect it
+  virtual OpExecTimes get_exec_times() const { return {}; }
+
   static void set_dod_base_dir(const std::string &dir);
 
   static std::string get_dod_base_dir();
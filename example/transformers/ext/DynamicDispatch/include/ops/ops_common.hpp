@@ -69,6 +69,8 @@ const std::string MLADF_4x2_GEMM_A16W8_XCLBIN_PATH =
     "/xclbin/stx/mladf_4x2_gemm_a16w8_qdq.xclbin";
 const std::string MLADF_4x2_GEMM_A16W16_XCLBIN_PATH =
     "/xclbin/stx/mladf_4x2_gemm_a16w16_qdq.xclbin";
+const std::string MLADF_4x2_GEMM_A16W4_XCLBIN_PATH =
+    "/xclbin/stx/mladf_4x2_gemm_a16w4_qdq.xclbin";
 const std::string BMM_A16W16_XCLBIN_PATH =
     "/xclbin/stx/2x4x4_bmm_model_a16w16.xclbin";
 const std::string XCOM_4x4_XCLBIN_PATH = "/xclbin/stx/4x4_dpu.xclbin";
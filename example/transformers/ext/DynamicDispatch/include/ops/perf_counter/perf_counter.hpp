@@ -0,0 +1,50 @@
+#pragma once
+
+#include <ops/op_interface.hpp>
+
+namespace ryzenai {
+
+/*
+ * Control op for AIE performance counters, inserted around ops at profile
+ * level 4. PERF_COUNTER_START programs & resets the counters,
+ * PERF_COUNTER_READ dumps them with a read registers op like the timestamps
+ * of RECORD_TIMER.
+ * Core tiles count active/stall cycles, configured like the FAL
+ * XAieActiveCycles/XAieStallCycles/XAieStallOccurrences profile classes.
+ * Shim tiles count the cycles their DDR read (MM2S 0) & write (S2MM 0) DMA
+ * channels have a task running, to get the achieved DDR bandwidth of an op.
+ */
+class perf_counter : public OpInterface {
+public:
+  enum class core_counter_type : uint8_t {
+    ACTIVE_CYCLES = 0,
+    STALL_CYCLES = 1,
+    STALL_OCCURRENCES = 2,
+  };
+  static constexpr uint8_t NUM_CORE_COUNTERS = 3;
+  enum class shim_counter_type : uint8_t {
+    MM2S_ACTIVE_CYCLES = 0,
+    S2MM_ACTIVE_CYCLES = 1,
+  };
+  static constexpr uint8_t NUM_SHIM_COUNTERS = 2;
+
+  struct counter_reg_t {
+    uint8_t col;
+    uint8_t row;
+    std::string name;
+    // in the format of the register offsets of a txn
+    uint64_t regoff;
+  };
+  // Counters in the order they are dumped by PERF_COUNTER_READ
+  static std::vector<counter_reg_t> get_dumped_counters();
+
+  perf_counter(bool start);
+  const std::vector<uint8_t>
+  get_transaction_bin(std::vector<Tensor> &input, std::vector<Tensor> &output,
+                      const std::map<std::string, std::any> &attr) override;
+
+private:
+  bool start_;
+};
+
+} // namespace ryzenai
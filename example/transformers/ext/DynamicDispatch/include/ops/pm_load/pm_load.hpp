@@ -12,6 +12,8 @@ struct overlay_pm_meta {
   };
   uint8_t num_cols;
   std::vector<pkt_switch_meta> pkt_sw_meta_;
+  // PM images resident at once, the core program memory holds one ELF
+  uint8_t num_pm_slots = 1;
 };
 
 struct op_xclbin_meta {
@@ -23,12 +25,18 @@ class pm_load : public OpInterface {
 private:
   static const std::map<std::string, overlay_pm_meta> overlay_meta_;
   static const std::map<std::string, op_xclbin_meta> op_xclbin_meta_;
-  const std::vector<uint8_t>
+  const std::vector<uint8_t> &
   get_pm_bin(const std::map<std::string, std::any> &attr);
+  const std::vector<uint8_t> &get_pm_bin(const std::string &op_name,
+                                         const std::string &dtype);
 
 public:
   pm_load(bool load_xrt = false);
+  // PM and instruction BOs of an op are created on the first call and kept
+  // for the hw context, later calls only run the load
   void execute(std::string op_name, std::string dtype);
+  // Creates the BOs of execute() ahead of the first run
+  void preload(const std::string &op_name, const std::string &dtype);
   const std::vector<uint8_t>
   get_transaction_bin(std::vector<Tensor> &input, std::vector<Tensor> &output,
                       const std::map<std::string, std::any> &attr) override;
@@ -70,6 +70,7 @@ public:
                std::vector<xrt::bo> &output) override;
 
   void debug(bool enable);
+  OpExecTimes get_exec_times() const override;
   std::vector<xrt::bo> get_inputs() {
     std::vector<xrt::bo> inputs = {a_bo_};
     return inputs;
@@ -79,6 +79,9 @@ public:
   std::vector<OpArgMap>
   get_buffer_reqs(std::vector<Tensor> &input, std::vector<Tensor> &output,
                   const std::map<std::string, std::any> &attr = {}) override;
+  std::vector<OpTensorView>
+  get_tensor_views(std::vector<Tensor> &input, std::vector<Tensor> &output,
+                   const std::map<std::string, std::any> &attr = {}) override;
 };
 
 } // namespace ryzenai
@@ -107,6 +107,9 @@ private:
   bool bias_en_;
   /* Have relu as activation function */
   bool relu_en_;
+  /* Activation applied in the kernel's prelu epilogue: "", "Relu" or
+   * "LeakyRelu" */
+  std::string activation_;
 
   // QDQ related params
   int32_t zeropoint;
@@ -176,7 +179,7 @@ private:
 public:
   conv2d(const std::string &a_dtype, const std::string &b_dtype,
          const std::string &bias_dtype, const std::string &c_dtype,
-         bool load_xrt);
+         bool load_xrt, const std::string &activation = "");
   std::vector<OpArgMap>
   get_buffer_reqs(std::vector<Tensor> &input, std::vector<Tensor> &output,
                   const std::map<std::string, std::any> &attr = {}) override;
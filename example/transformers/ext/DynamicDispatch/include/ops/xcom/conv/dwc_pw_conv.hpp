@@ -0,0 +1,79 @@
+#pragma once
+
+#include <memory>
+
+#include <ops/op_interface.hpp>
+#include <ops/ops_common.hpp>
+#include <ops/xcom/conv/conv.hpp>
+
+namespace ryzenai {
+
+namespace xcom {
+
+/*
+ * depthwise conv followed by a 1x1 pointwise conv, e.g. the depthwise
+ * separable blocks of MobileNet. Runs the transactions of both convs back to
+ * back as a single op. The depthwise output stays in the op's internal scratch
+ * pad, so it is neither a tensor of the graph nor copied in between.
+ *
+ * onnx args:
+ *  [0]      activation
+ *  [1, 10]  act scale/zp, dwc weight/scale/zp, dwc bias/scale/zp,
+ *           dwc output scale/zp, i.e. the args of the depthwise conv2d
+ *  [11, 18] pointwise weight/scale/zp, bias/scale/zp, output scale/zp
+ *  [19]     output
+ *
+ * attrs: input_shape, dwc_output_shape, output_shape in [NCHW] format, and
+ * kernel_shape, strides of the depthwise conv.
+ */
+template <typename InT, typename WtT, typename BiasT, typename OutT>
+class dwc_pw_conv2d : public OpInterface {
+private:
+  std::unique_ptr<conv2d<InT, WtT, BiasT, OutT, true>> dwc_;
+  std::unique_ptr<conv2d<InT, WtT, BiasT, OutT, false>> pw_;
+
+  struct sub_op_reqs_t {
+    OpArgMap input;
+    size_t const_size = 0;
+    size_t output_size = 0;
+  };
+
+  std::map<std::string, std::any>
+  get_dwc_attr(const std::map<std::string, std::any> &attr) const;
+  std::map<std::string, std::any>
+  get_pw_attr(const std::map<std::string, std::any> &attr) const;
+  // split the args of this op into the args of the depthwise/pointwise conv
+  std::vector<Tensor> get_dwc_tensors(const std::vector<Tensor> &tensors,
+                                      const Tensor &mid) const;
+  std::vector<Tensor> get_pw_tensors(const std::vector<Tensor> &tensors,
+                                     const Tensor &mid) const;
+  Tensor get_mid_tensor(const std::map<std::string, std::any> &attr) const;
+  sub_op_reqs_t get_sub_op_reqs(OpInterface &op, std::vector<Tensor> &tensors,
+                                const std::map<std::string, std::any> &attr);
+  // size of the depthwise output in the internal scratch pad, including the
+  // padding in front which the pointwise conv expects
+  size_t get_mid_size(const sub_op_reqs_t &dwc_reqs,
+                      const sub_op_reqs_t &pw_reqs) const;
+
+  std::string c_dtype_;
+
+public:
+  dwc_pw_conv2d(const std::string &a_dtype, const std::string &b_dtype,
+                const std::string &bias_dtype, const std::string &c_dtype,
+                bool load_xrt);
+  std::vector<OpArgMap>
+  get_buffer_reqs(std::vector<Tensor> &input, std::vector<Tensor> &output,
+                  const std::map<std::string, std::any> &attr = {}) override;
+
+  void initialize_const_params(
+      void *dest, const std::vector<Tensor> &const_params,
+      const std::map<std::string, std::any> &attr = {}) override;
+
+  const std::vector<uint8_t> get_transaction_bin(
+      std::vector<Tensor> &input, std::vector<Tensor> &output,
+      const std::map<std::string, std::any> &attr = {}) override;
+};
+
+} // namespace xcom
+
+} // namespace ryzenai
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace OpsFusion {
+
+// Binary event tracer for the execute hot path.
+// Events are fixed size records (name id, arg, thread, start & duration)
+// written to a lock-free ring buffer. A background thread drains the ring
+// and writes the events to a Chrome trace JSON file, which can be opened in
+// Perfetto (ui.perfetto.dev) or chrome://tracing.
+// Tracing is enabled at runtime with DD_TRACE_FILE=<path> or enable(). When
+// it is disabled, record() is a single relaxed atomic load.
+// If the drain thread falls behind by more than RING_SIZE events, the
+// oldest events are dropped and counted in get_num_dropped().
+class EventTracer {
+public:
+  static constexpr size_t RING_SIZE = 1 << 16; // Events
+
+  static EventTracer &get_instance();
+
+  EventTracer(const EventTracer &) = delete;
+  EventTracer &operator=(const EventTracer &) = delete;
+  ~EventTracer();
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Returns the id of an event name, to be used with record(). Takes a lock,
+  // call it outside of the hot path and keep the id.
+  uint32_t get_name_id(const std::string &name);
+
+  // Timestamps are steady_clock nanoseconds. arg is shown in the event
+  // details, e.g. the partition index.
+  void record(uint32_t name_id, int64_t start_ns, int64_t end_ns,
+              uint32_t arg = 0) {
+    if (!enabled()) {
+      return;
+    }
+    push(name_id, start_ns, end_ns, arg);
+  }
+
+  // Starts writing the events to trace_file, flushing a previous one
+  void enable(const std::string &trace_file);
+  // Drains the ring and completes the trace file
+  void disable();
+  uint64_t get_num_dropped() const {
+    return num_dropped_.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Slot {
+    // position + 1 of the event in the slot, 0 if not written yet
+    std::atomic<uint64_t> seq{0};
+    std::atomic<int64_t> start_ns{0};
+    std::atomic<int64_t> dur_ns{0};
+    std::atomic<uint64_t> id_arg{0}; // name id << 32 | arg
+    std::atomic<uint64_t> tid{0};
+  };
+
+  EventTracer();
+  void push(uint32_t name_id, int64_t start_ns, int64_t end_ns, uint32_t arg);
+  void drain_loop();
+  // Caller should hold file_mutex_
+  void drain();
+  void stop_drain_thread();
+
+  std::atomic<bool> enabled_{false};
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> num_dropped_{0};
+  std::array<Slot, RING_SIZE> ring_;
+  uint64_t tail_ = 0;
+
+  std::mutex names_mutex_;
+  std::vector<std::string> names_;
+
+  std::mutex file_mutex_;
+  std::ofstream file_;
+  bool first_event_ = true;
+
+  std::mutex drain_mutex_;
+  std::condition_variable drain_cv_;
+  std::thread drain_thread_;
+  bool stop_drain_ = false;
+};
+
+} // namespace OpsFusion
@@ -8,8 +8,13 @@
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <list>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <utils/npu_memory.hpp>
 #include <utils/txn_container.hpp>
+#include <utils/utils.hpp>
 // XRT headers
 #include "xrt/xrt_bo.h"
 #include "xrt/xrt_device.h"
@@ -25,92 +30,156 @@
 #include <xrt_context/xrt_context.hpp>
 namespace ryzenai::dynamic_dispatch {
 
+// Registry of instruction & layer param BOs of ops, keyed by transaction name.
+// Keys are only registered by add_instructions()/add_layer_params(), BOs are
+// created on first get_instr_bo()/get_param_bo() in the hw context set at
+// registration time. At most max_instr_bos instruction BOs stay resident,
+// least recently used ones are freed first. 0 means no limit, it can be set
+// with DD_MAX_INSTR_BOS env variable.
 class instruction_registry {
 private:
   Transaction &txn = Transaction::getInstance();
 
-public:
-  std::shared_ptr<xrt_context> xrt_ctx_;
-  std::map<std::string, std::pair<bool, xrt::bo>> instr_map_;
-  std::map<std::string, std::pair<bool, xrt::bo>> params_map_;
-
-  void insert_to_instruction_map(std::pair<std::string, bool> instr) {
-    std::string txn_string = txn.get_txn_str(instr.first);
-    std::istringstream txn_bin(txn_string, std::ios::binary);
-    if (txn_bin.fail()) {
-      throw std::runtime_error("Failed to open txn binary file: ");
+  struct bo_entry {
+    bool flag = false;
+    std::shared_ptr<xrt_context> ctx;
+    std::optional<xrt::bo> bo;
+    // position in instr_lru_, valid only if bo is set
+    std::list<std::string>::iterator lru_iter;
+  };
+
+  std::map<std::string, bo_entry> instr_map_;
+  std::map<std::string, bo_entry> params_map_;
+  // resident instruction BOs, most recently used first
+  std::list<std::string> instr_lru_;
+  size_t max_instr_bos_ = static_cast<size_t>(
+      std::stoull(Utils::get_env_var("DD_MAX_INSTR_BOS", "0")));
+  std::mutex mutex_;
+  // resident BOs, one slot per key
+  npu_memory_account mem_account_{"instruction_registry"};
+
+  xrt::bo create_instr_bo(const std::string &key, xrt_context &ctx) {
+    std::vector<uint8_t> txn_bin;
+    txn.get_txn_bin(key, txn_bin);
+    if (txn_bin.size() < sizeof(XAie_TxnHeader)) {
+      throw std::runtime_error("Failed to open txn binary file: " + key);
     }
 
-    std::vector<char> prm_buffer(txn_string.begin(), txn_string.end());
-    XAie_TxnHeader *hdr = new XAie_TxnHeader();
-    txn_bin.read((char *)hdr, sizeof(XAie_TxnHeader));
-    uint8_t *ptr = new uint8_t[hdr->TxnSize];
-    std::memcpy(ptr, hdr, sizeof(XAie_TxnHeader));
-    uint8_t *txn_ptr = ptr + sizeof(*hdr);
-    txn_bin.read((char *)txn_ptr, hdr->TxnSize - sizeof(XAie_TxnHeader));
-
     aiectrl::op_buf instr_buf;
-    instr_buf.addOP(aiectrl::transaction_op(ptr));
+    instr_buf.addOP(aiectrl::transaction_op(txn_bin.data()));
     size_t instr_bo_words = instr_buf.ibuf_.size();
+    mem_account_.reserve("instr/" + key, instr_bo_words);
     xrt::bo instr_bo =
-        xrt::bo(xrt_ctx_->get_context(), instr_bo_words,
-                xrt::bo::flags::cacheable, xrt_ctx_->get_kernel().group_id(1));
+        xrt::bo(ctx.get_context(), instr_bo_words, xrt::bo::flags::cacheable,
+                ctx.get_kernel().group_id(1));
     instr_bo.write(instr_buf.ibuf_.data());
     instr_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
 
-    RYZENAI_LOG_TRACE("[INSTR_REG] instr_bo created and saved: " + instr.first);
-
-    instr_map_.insert({instr.first, std::make_pair(instr.second, instr_bo)});
-
-    delete[] ptr;
-    delete hdr;
+    RYZENAI_LOG_TRACE("[INSTR_REG] instr_bo created and saved: " + key);
+    return instr_bo;
   }
 
-  void insert_to_layer_params_map(std::pair<std::string, bool> params) {
-
-    std::string layer_params = txn.get_txn_str(params.first);
-    std::vector<char> prm_buffer(layer_params.begin(), layer_params.end());
-    size_t prm_size = prm_buffer.size();
-    xrt::bo param_bo =
-        xrt::bo(xrt_ctx_->get_context(), prm_size, xrt::bo::flags::host_only,
-                xrt_ctx_->get_kernel().group_id(8));
-    param_bo.write(prm_buffer.data());
+  xrt::bo create_param_bo(const std::string &key, xrt_context &ctx) {
+    // layer params are written straight into the BO
+    xrt::bo param_bo;
+    txn.read_txn(key, [this, &key, &param_bo, &ctx](size_t prm_size) {
+      mem_account_.reserve("param/" + key, prm_size);
+      param_bo =
+          xrt::bo(ctx.get_context(), prm_size, xrt::bo::flags::host_only,
+                  ctx.get_kernel().group_id(8));
+      return param_bo.map();
+    });
     param_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
 
-    RYZENAI_LOG_TRACE("[INSTR_REG] instr_bo created and saved: " +
-                      params.first);
+    RYZENAI_LOG_TRACE("[INSTR_REG] param_bo created and saved: " + key);
+    return param_bo;
+  }
+
+  void register_key(std::map<std::string, bo_entry> &bo_map,
+                    const std::pair<std::string, bool> &key) {
+    if (xrt_ctx_ == nullptr) {
+      throw std::runtime_error(
+          "[INSTR_REG] setup_hw_ctx() should be called before adding: " +
+          key.first);
+    }
+    bo_entry entry;
+    entry.flag = key.second;
+    entry.ctx = xrt_ctx_;
+    // Same as before, first registration of a key wins
+    bo_map.insert({key.first, std::move(entry)});
+  }
 
-    params_map_.insert({params.first, std::make_pair(params.second, param_bo)});
+  // Caller should hold mutex_
+  void evict_instr_bos(size_t max_bos) {
+    while (max_bos != 0 && instr_lru_.size() > max_bos) {
+      auto &entry = instr_map_.at(instr_lru_.back());
+      RYZENAI_LOG_TRACE("[INSTR_REG] instr_bo evicted: " + instr_lru_.back());
+      // BOs returned earlier stay valid, callers hold a reference
+      entry.bo.reset();
+      mem_account_.release("instr/" + instr_lru_.back());
+      instr_lru_.pop_back();
+    }
   }
 
+public:
+  std::shared_ptr<xrt_context> xrt_ctx_;
+
   void setup_hw_ctx(std::shared_ptr<xrt_context> ctx) { xrt_ctx_ = ctx; }
 
   void add_instructions(vector<std::pair<std::string, bool>> instr) {
+    std::lock_guard<std::mutex> guard(mutex_);
     for (auto &i : instr) {
-      insert_to_instruction_map(i);
+      register_key(instr_map_, i);
     }
   }
 
   void add_layer_params(vector<std::pair<std::string, bool>> params) {
+    std::lock_guard<std::mutex> guard(mutex_);
     for (auto &i : params) {
-      insert_to_layer_params_map(i);
+      register_key(params_map_, i);
     }
   }
 
-  std::pair<bool, xrt::bo> get_instr_bo(std::string key) {
+  std::pair<bool, xrt::bo> get_instr_bo(const std::string &key) {
+    std::lock_guard<std::mutex> guard(mutex_);
     auto val = instr_map_.find(key);
     if (val == instr_map_.end()) {
       throw runtime_error("Failed to get instruction buffer for key: " + key);
     }
-    return val->second;
+    auto &entry = val->second;
+    if (entry.bo) {
+      instr_lru_.splice(instr_lru_.begin(), instr_lru_, entry.lru_iter);
+    } else {
+      entry.bo = create_instr_bo(key, *entry.ctx);
+      instr_lru_.push_front(key);
+      entry.lru_iter = instr_lru_.begin();
+      evict_instr_bos(max_instr_bos_);
+    }
+    return std::make_pair(entry.flag, *entry.bo);
   }
 
-  std::pair<bool, xrt::bo> get_param_bo(std::string key) {
+  std::pair<bool, xrt::bo> get_param_bo(const std::string &key) {
+    std::lock_guard<std::mutex> guard(mutex_);
     auto val = params_map_.find(key);
     if (val == params_map_.end()) {
       throw runtime_error("Failed to get instruction buffer for key: " + key);
     }
-    return val->second;
+    auto &entry = val->second;
+    if (!entry.bo) {
+      entry.bo = create_param_bo(key, *entry.ctx);
+    }
+    return std::make_pair(entry.flag, *entry.bo);
+  }
+
+  void set_max_instr_bos(size_t max_bos) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    max_instr_bos_ = max_bos;
+    evict_instr_bos(max_instr_bos_);
+  }
+
+  size_t get_num_resident_instr_bos() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return instr_lru_.size();
   }
 };
 
@@ -0,0 +1,265 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <utils/npu_memory.hpp>
+#include <xrt_context/xrt_context.hpp>
+
+namespace ryzenai {
+namespace dynamic_dispatch {
+
+// Token slots of a sequence inside one block
+struct kv_span {
+  size_t block_id;
+  size_t slot;
+  size_t num_tokens;
+};
+
+// Bookkeeping of a paged KV cache : blocks of block_tokens token slots are
+// handed out to sequences on demand, and go back to a free list when the
+// sequence is released, truncated or its oldest blocks are evicted.
+// Not thread safe, kv_cache serializes the calls.
+class kv_block_allocator {
+public:
+  kv_block_allocator(size_t block_tokens, size_t max_blocks)
+      : block_tokens_(block_tokens), max_blocks_(max_blocks) {
+    if (block_tokens_ == 0) {
+      throw std::invalid_argument("kv cache : block_tokens must be > 0");
+    }
+  }
+
+  // Room for num_tokens more tokens of the sequence, blocks are allocated as
+  // needed. Throws if the cache is out of blocks, the sequence is unchanged.
+  std::vector<kv_span> append(uint64_t seq_id, size_t num_tokens) {
+    auto &seq = seqs_[seq_id];
+    const size_t capacity = seq.blocks.size() * block_tokens_;
+    const size_t needed = seq.num_tokens + num_tokens;
+    const size_t new_blocks =
+        needed > capacity ? (needed - capacity + block_tokens_ - 1) /
+                                block_tokens_
+                          : 0;
+    if (new_blocks > get_num_free_blocks()) {
+      if (seq.blocks.empty()) {
+        seqs_.erase(seq_id);
+      }
+      throw std::runtime_error("kv cache : out of blocks");
+    }
+    for (size_t i = 0; i < new_blocks; ++i) {
+      seq.blocks.push_back(allocate_block());
+    }
+
+    std::vector<kv_span> spans;
+    size_t pos = seq.num_tokens;
+    while (pos < needed) {
+      const size_t slot = pos % block_tokens_;
+      const size_t count = std::min(block_tokens_ - slot, needed - pos);
+      spans.push_back({seq.blocks.at(pos / block_tokens_), slot, count});
+      pos += count;
+    }
+    seq.num_tokens = needed;
+    return spans;
+  }
+
+  // Slots of tokens [start, start + num_tokens) of the sequence
+  std::vector<kv_span> get_spans(uint64_t seq_id, size_t start,
+                                 size_t num_tokens) const {
+    const auto &seq = get_seq(seq_id);
+    if (start + num_tokens > seq.num_tokens) {
+      throw std::out_of_range("kv cache : token range out of the sequence");
+    }
+    std::vector<kv_span> spans;
+    size_t pos = start;
+    while (pos < start + num_tokens) {
+      const size_t slot = pos % block_tokens_;
+      const size_t count =
+          std::min(block_tokens_ - slot, start + num_tokens - pos);
+      spans.push_back({seq.blocks.at(pos / block_tokens_), slot, count});
+      pos += count;
+    }
+    return spans;
+  }
+
+  void release(uint64_t seq_id) {
+    auto iter = seqs_.find(seq_id);
+    if (iter == seqs_.end()) {
+      return;
+    }
+    for (auto block_id : iter->second.blocks) {
+      free_blocks_.push_back(block_id);
+    }
+    seqs_.erase(iter);
+  }
+
+  // Keep the first num_tokens tokens of the sequence
+  void truncate(uint64_t seq_id, size_t num_tokens) {
+    auto &seq = get_seq(seq_id);
+    if (num_tokens >= seq.num_tokens) {
+      return;
+    }
+    const size_t keep_blocks =
+        (num_tokens + block_tokens_ - 1) / block_tokens_;
+    while (seq.blocks.size() > keep_blocks) {
+      free_blocks_.push_back(seq.blocks.back());
+      seq.blocks.pop_back();
+    }
+    seq.num_tokens = num_tokens;
+  }
+
+  // Drop the oldest num_blocks blocks of the sequence, e.g. for a sliding
+  // window. Returns the number of tokens evicted.
+  size_t evict_oldest_blocks(uint64_t seq_id, size_t num_blocks) {
+    auto &seq = get_seq(seq_id);
+    num_blocks = std::min(num_blocks, seq.blocks.size());
+    const size_t num_evicted =
+        std::min(num_blocks * block_tokens_, seq.num_tokens);
+    for (size_t i = 0; i < num_blocks; ++i) {
+      free_blocks_.push_back(seq.blocks.at(i));
+    }
+    seq.blocks.erase(seq.blocks.begin(), seq.blocks.begin() + num_blocks);
+    seq.num_tokens -= num_evicted;
+    return num_evicted;
+  }
+
+  const std::vector<size_t> &get_block_table(uint64_t seq_id) const {
+    return get_seq(seq_id).blocks;
+  }
+  size_t get_num_tokens(uint64_t seq_id) const {
+    auto iter = seqs_.find(seq_id);
+    return iter == seqs_.end() ? 0 : iter->second.num_tokens;
+  }
+  size_t get_num_free_blocks() const {
+    return free_blocks_.size() + (max_blocks_ - next_block_);
+  }
+  // Blocks handed out so far, i.e. the storage the cache has to back
+  size_t get_num_allocated_blocks() const { return next_block_; }
+  size_t get_block_tokens() const { return block_tokens_; }
+  size_t get_max_blocks() const { return max_blocks_; }
+
+private:
+  struct seq_info {
+    std::vector<size_t> blocks;
+    size_t num_tokens = 0;
+  };
+
+  // Reuse freed blocks first, so that storage only grows when needed
+  size_t allocate_block() {
+    if (!free_blocks_.empty()) {
+      auto block_id = free_blocks_.back();
+      free_blocks_.pop_back();
+      return block_id;
+    }
+    return next_block_++;
+  }
+
+  const seq_info &get_seq(uint64_t seq_id) const {
+    auto iter = seqs_.find(seq_id);
+    if (iter == seqs_.end()) {
+      throw std::out_of_range("kv cache : unknown sequence " +
+                              std::to_string(seq_id));
+    }
+    return iter->second;
+  }
+  seq_info &get_seq(uint64_t seq_id) {
+    return const_cast<seq_info &>(
+        static_cast<const kv_block_allocator *>(this)->get_seq(seq_id));
+  }
+
+  size_t block_tokens_;
+  size_t max_blocks_;
+  size_t next_block_ = 0;
+  std::vector<size_t> free_blocks_;
+  std::unordered_map<uint64_t, seq_info> seqs_;
+};
+
+struct kv_cache_config {
+  size_t num_layers = 1;
+  size_t num_heads = 32;
+  size_t head_dim = 128;
+  size_t dtype_size = 2;
+  // token slots per block
+  size_t block_tokens = 64;
+  size_t max_blocks = 1024;
+  // blocks backed by one BO, BOs are created as the cache grows
+  size_t blocks_per_bo = 16;
+};
+
+// Paged KV cache resident in device BOs.
+// A block holds K and V of block_tokens tokens of all heads, for each layer.
+// Layout of K (and V) in a block is [num_heads, block_tokens, head_dim].
+// The block table of a sequence is shared by all layers.
+//
+// Decode step :
+//   auto pos = cache.append_tokens(seq_id, 1);
+//   for each layer : cache.write(seq_id, layer, pos, 1, k, v);
+// Only the new tokens are copied and synced to device.
+class kv_cache {
+public:
+  kv_cache(std::shared_ptr<xrt_context> ctx, const kv_cache_config &cfg);
+
+  // Reserve num_tokens more tokens for the sequence, returns the position
+  // of the first new token.
+  size_t append_tokens(uint64_t seq_id, size_t num_tokens);
+
+  // Copy K & V of tokens [pos, pos + num_tokens) of one layer to the cache
+  // and sync them to device. k & v are [num_heads, num_tokens, head_dim].
+  void write(uint64_t seq_id, size_t layer, size_t pos, size_t num_tokens,
+             const void *k, const void *v);
+
+  void release(uint64_t seq_id);
+  void truncate(uint64_t seq_id, size_t num_tokens);
+  size_t evict_oldest_blocks(uint64_t seq_id, size_t num_blocks);
+
+  size_t get_num_tokens(uint64_t seq_id) const;
+  std::vector<size_t> get_block_table(uint64_t seq_id) const;
+
+  // Device address of K (or V) of a block of a layer, the way attention ops
+  // take a block table as input. Add DDR_AIE_ADDR_OFFSET for kernel args.
+  uint64_t get_block_address(size_t layer, size_t block_id,
+                             bool value) const;
+  std::vector<uint64_t> get_block_addresses(uint64_t seq_id, size_t layer,
+                                            bool value) const;
+
+  // Device side copy of the K & V of a sequence, for ops which need them
+  // contiguous : dst is [num_heads, num_tokens, head_dim] at dst_offset.
+  void gather(uint64_t seq_id, size_t layer, xrt::bo &k_dst, xrt::bo &v_dst,
+              size_t dst_offset = 0) const;
+
+  size_t get_block_bytes() const { return block_bytes_; }
+  size_t get_num_free_blocks() const;
+
+private:
+  size_t get_head_bytes(size_t num_tokens) const {
+    return num_tokens * cfg_.head_dim * cfg_.dtype_size;
+  }
+  // K is at the offset, V follows it
+  size_t get_bo_offset(size_t block_id) const {
+    return (block_id % cfg_.blocks_per_bo) * 2 * block_bytes_;
+  }
+  const xrt::bo &get_bo(size_t layer, size_t block_id) const {
+    return bos_.at(layer).at(block_id / cfg_.blocks_per_bo);
+  }
+  void grow_bos();
+
+  std::shared_ptr<xrt_context> ctx_;
+  kv_cache_config cfg_;
+  size_t block_bytes_;
+  kv_block_allocator allocator_;
+  // layer --> BOs, each backing blocks_per_bo blocks
+  std::vector<std::vector<xrt::bo>> bos_;
+  npu_memory_account mem_account_{"kv_cache"};
+  mutable std::mutex mutex_;
+};
+
+} // namespace dynamic_dispatch
+} // namespace ryzenai
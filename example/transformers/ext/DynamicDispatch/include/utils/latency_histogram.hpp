@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace OpsFusion {
+
+// Summary of a LatencyHistogram. All values are in nanoseconds.
+struct LatencyStats {
+  uint64_t count = 0;
+  int64_t min_ns = 0;
+  int64_t max_ns = 0;
+  double mean_ns = 0;
+  int64_t p50_ns = 0;
+  int64_t p99_ns = 0;
+  int64_t p999_ns = 0;
+};
+
+// Lock-free latency histogram with log-linear buckets, in the spirit of
+// HdrHistogram. Every power of 2 range is split in SUB_BUCKET_COUNT / 2
+// linear buckets, so reported percentiles are within ~1/16 of the
+// recorded value. record() can be called concurrently with get_stats().
+class LatencyHistogram {
+public:
+  static constexpr uint32_t SUB_BUCKET_BITS = 5;
+  static constexpr uint64_t SUB_BUCKET_COUNT = 1ULL << SUB_BUCKET_BITS;
+  static constexpr uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+  static constexpr size_t NUM_BUCKETS =
+      (64 - SUB_BUCKET_BITS) * SUB_BUCKET_HALF + SUB_BUCKET_COUNT;
+
+  LatencyHistogram() { reset(); }
+  LatencyHistogram(const LatencyHistogram &) = delete;
+  LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+  void record(int64_t value_ns) {
+    const uint64_t value = value_ns > 0 ? static_cast<uint64_t>(value_ns) : 0;
+    buckets_[get_bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t curr_min = min_.load(std::memory_order_relaxed);
+    while (value < curr_min &&
+           !min_.compare_exchange_weak(curr_min, value,
+                                       std::memory_order_relaxed)) {
+    }
+    uint64_t curr_max = max_.load(std::memory_order_relaxed);
+    while (value > curr_max &&
+           !max_.compare_exchange_weak(curr_max, value,
+                                       std::memory_order_relaxed)) {
+    }
+  }
+
+  // Not atomic w.r.t. concurrent record()
+  void reset() {
+    for (auto &bucket : buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+  LatencyStats get_stats() const {
+    LatencyStats stats;
+    std::array<uint64_t, NUM_BUCKETS> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+      counts[i] = buckets_[i].load(std::memory_order_relaxed);
+      total += counts[i];
+    }
+    if (total == 0) {
+      return stats;
+    }
+
+    stats.count = total;
+    stats.min_ns = static_cast<int64_t>(min_.load(std::memory_order_relaxed));
+    stats.max_ns = static_cast<int64_t>(max_.load(std::memory_order_relaxed));
+    stats.mean_ns =
+        static_cast<double>(sum_.load(std::memory_order_relaxed)) /
+        static_cast<double>(count_.load(std::memory_order_relaxed));
+    stats.p50_ns = get_percentile(counts, total, 50.0, stats.max_ns);
+    stats.p99_ns = get_percentile(counts, total, 99.0, stats.max_ns);
+    stats.p999_ns = get_percentile(counts, total, 99.9, stats.max_ns);
+    return stats;
+  }
+
+private:
+  static size_t get_bucket_index(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+      return static_cast<size_t>(value);
+    }
+    uint32_t msb = 63;
+    while (!(value >> msb)) {
+      --msb;
+    }
+    const uint32_t shift = msb - (SUB_BUCKET_BITS - 1);
+    return static_cast<size_t>(shift * SUB_BUCKET_HALF + (value >> shift));
+  }
+
+  // Largest value that maps to the bucket
+  static uint64_t get_bucket_max(size_t idx) {
+    if (idx < SUB_BUCKET_COUNT) {
+      return idx;
+    }
+    const uint64_t shift = idx / SUB_BUCKET_HALF - 1;
+    const uint64_t sub_bucket = idx - shift * SUB_BUCKET_HALF;
+    return ((sub_bucket + 1) << shift) - 1;
+  }
+
+  static int64_t
+  get_percentile(const std::array<uint64_t, NUM_BUCKETS> &counts,
+                 uint64_t total, double percentile, int64_t max_ns) {
+    uint64_t target = static_cast<uint64_t>(
+        std::ceil(percentile / 100.0 * static_cast<double>(total)));
+    target = std::max<uint64_t>(1, std::min(target, total));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+      cumulative += counts[i];
+      if (cumulative >= target) {
+        return std::min(static_cast<int64_t>(get_bucket_max(i)), max_ns);
+      }
+    }
+    return max_ns;
+  }
+
+  std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets_;
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> min_;
+  std::atomic<uint64_t> max_;
+};
+
+} // namespace OpsFusion
@@ -0,0 +1,64 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <xrt_context/xrt_context.hpp>
+
+namespace ryzenai {
+namespace dynamic_dispatch {
+
+// BOs held by one account
+struct npu_memory_usage {
+  uint64_t id = 0;
+  std::string owner;
+  size_t num_bos = 0;
+  size_t bytes = 0;
+};
+
+// Process wide accounting of the BOs allocated by DynamicDispatch.
+//
+// Each user (FusionRuntime, instruction registry, kv cache ...) holds an
+// npu_memory_account and reserves the size of a group of BOs, a slot, before
+// creating them. Reserving a slot again replaces its previous size, so a BO
+// reallocated with a new size is only counted once.
+//
+// The budget caps the bytes reserved by all the accounts of the process, 0
+// means no limit. It can be set with DD_NPU_MEMORY_BUDGET_MB env variable.
+// A reserve over budget throws before anything is allocated, the message
+// lists the largest accounts.
+class DYNAMIC_DISPATCH_API npu_memory {
+public:
+  static void set_budget(size_t bytes);
+  static size_t get_budget();
+  static size_t get_total_bytes();
+  // Largest accounts first
+  static std::vector<npu_memory_usage> get_usage();
+  // One line per account, for logs and error messages
+  static std::string get_report(size_t max_accounts = 8);
+};
+
+class DYNAMIC_DISPATCH_API npu_memory_account {
+public:
+  explicit npu_memory_account(const std::string &owner);
+  ~npu_memory_account();
+  npu_memory_account(const npu_memory_account &) = delete;
+  npu_memory_account &operator=(const npu_memory_account &) = delete;
+
+  // Set slot to num_bos BOs of bytes in total. Throws if the budget would
+  // be exceeded, the slot keeps its previous size then.
+  void reserve(const std::string &slot, size_t bytes, size_t num_bos = 1);
+  void release(const std::string &slot);
+  npu_memory_usage get_usage() const;
+
+private:
+  uint64_t id_;
+};
+
+} // namespace dynamic_dispatch
+} // namespace ryzenai
@@ -3,6 +3,8 @@
 #ifndef TRANSACTION_H
 #define TRANSACTION_H
 
+#include <cstring>
+#include <functional>
 #include <map>
 #include <mutex>
 #include <string>
@@ -19,6 +21,26 @@ public:
   std::string get_txn_str(std::string);
   Transaction();
 
+  // Copy a txn/param binary into the buffer returned by get_dst(size), which
+  // should have room for size bytes. If DD_TXN_PACKAGE env variable points
+  // to a transaction package containing the key, the binary is decompressed
+  // from the mapped package straight into the buffer. Otherwise it's copied
+  // from get_txn_str().
+  void read_txn(const std::string &key,
+                const std::function<void *(size_t)> &get_dst);
+
+  // Same as GetBinData(get_txn_str(key), outVector), without the copies
+  template <typename T>
+  void get_txn_bin(const std::string &key, std::vector<T> &outVector) {
+    size_t dataLen = 0;
+    read_txn(key, [&outVector, &dataLen](size_t size) -> void * {
+      dataLen = size;
+      outVector.resize((size + sizeof(T) - 1) / sizeof(T));
+      return outVector.data();
+    });
+    outVector.resize(dataLen / sizeof(T));
+  }
+
   template <typename T>
   void GetBinData(const std::string &binaryData, std::vector<T> &outVector,
                   bool append = false) {
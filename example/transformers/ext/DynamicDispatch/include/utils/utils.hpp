@@ -7,7 +7,9 @@
 
 #include <cmath>
 #include <fstream>
+#include <functional>
 #include <map>
+#include <string>
 #include <vector>
 
 #ifdef _WIN32
@@ -49,6 +51,78 @@ std::vector<std::string> split_string(const std::string &msg,
 /// @brief Remove all whitespaces in a string
 std::string remove_whitespaces(std::string x);
 
+/// @brief Number of host worker threads, DD_NUM_THREADS env variable or
+/// the hardware concurrency
+size_t get_num_threads();
+
+/// @brief Run fn(i) for i in [0, n) over get_num_threads() threads.
+/// The first exception thrown by fn is rethrown once all workers are done.
+/// Nested calls, from within fn, run serially on the calling worker.
+void parallel_for(size_t n, const std::function<void(size_t)> &fn);
+
+/// @brief Start & end of a task run by TaskGraph::run(), in steady_clock
+/// nanoseconds
+struct TaskTime {
+  std::string name;
+  int64_t start_ns = 0;
+  int64_t end_ns = 0;
+  // 0 for the thread calling TaskGraph::run(), 1.. for its workers
+  size_t thread = 0;
+};
+
+/// @brief Tasks run in parallel once the tasks they depend on are done.
+/// Tasks added with on_caller run on the thread calling run(), e.g. those
+/// using thread local state like OpsFusion::OpCacheScope. The others run on
+/// up to get_num_threads() - 1 workers, or on the calling thread when it is
+/// idle.
+class TaskGraph {
+public:
+  using TaskId = size_t;
+
+  /// @brief Adds a task, deps are tasks added before it
+  TaskId add(const std::string &name, std::function<void()> fn,
+             const std::vector<TaskId> &deps = {}, bool on_caller = false);
+
+  /// @brief Runs all the tasks, returns their times in the order they were
+  /// added. The first exception thrown by a task is rethrown once the
+  /// running tasks are done, the tasks not started by then are skipped.
+  std::vector<TaskTime> run();
+
+private:
+  struct Task {
+    std::string name;
+    std::function<void()> fn;
+    std::vector<TaskId> deps;
+    bool on_caller;
+  };
+  std::vector<Task> tasks_;
+};
+
+/// @brief Copy on write memory map of a whole file. Writes through data()
+/// are private to the process, the file is never modified.
+/// Throws if the file can't be opened or mapped, an empty file has a null
+/// data().
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &filename);
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  char *data() const { return data_; }
+  size_t size() const { return size_; }
+  // Hint the OS to read the whole file ahead, e.g. a packed const archive
+  void prefetch() const;
+
+private:
+  char *data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#endif
+};
+
 } // namespace Utils
 
 #endif // __UTILS_H_
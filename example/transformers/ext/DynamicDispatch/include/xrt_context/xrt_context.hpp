@@ -28,9 +28,16 @@
 #define DYNAMIC_DISPATCH_API
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 // XRT headers
 #include "xrt/xrt_bo.h"
@@ -46,39 +53,137 @@ namespace ryzenai {
 namespace dynamic_dispatch {
 class xrt_context {
 private:
-  static DYNAMIC_DISPATCH_API
-      std::unordered_map<std::string, std::shared_ptr<xrt_context>>
-          ctx_map_;
+  // hw contexts of one xclbin, context 0 is the one shared by ops
+  struct context_pool {
+    std::vector<std::shared_ptr<xrt_context>> contexts;
+    // contexts handed out by lease()
+    size_t num_leased = 1;
+    size_t next_lease = 0;
+    xrt::hw_context::qos_type qos;
+    // the device refused a new context, the pool has all it can get
+    bool exhausted = false;
+  };
+
+  static DYNAMIC_DISPATCH_API std::unordered_map<std::string, context_pool>
+      ctx_map_;
   static DYNAMIC_DISPATCH_API std::mutex xrt_ctx_mutex_;
   xrt::device device_;
   xrt::xclbin xclbin_;
   xrt::hw_context context_;
   xrt::kernel kernel_;
-  xrt_context(const std::string &xclbin_fname) {
+  xrt_context(const std::string &xclbin_fname,
+              const xrt::hw_context::qos_type &qos) {
     unsigned int device_index = 0;
     device_ = xrt::device(device_index);
     xclbin_ = xrt::xclbin(xclbin_fname);
     device_.register_xclbin(xclbin_);
     RYZENAI_LOG_TRACE("Creating new context with xclbin: " + xclbin_fname);
-    context_ = xrt::hw_context(device_, xclbin_.get_uuid());
+    context_ = create_hw_context(device_, xclbin_, qos, get_wait_ms());
+    kernel_ = xrt::kernel(context_, NPU_KERNEL_NAME);
+  }
+  // One more hw context on the device & xclbin of first
+  xrt_context(const xrt_context &first, const xrt::hw_context::qos_type &qos)
+      : device_(first.device_), xclbin_(first.xclbin_) {
+    RYZENAI_LOG_TRACE("Creating additional context with xclbin uuid: " +
+                      xclbin_.get_uuid().to_string());
+    context_ = create_hw_context(device_, xclbin_, qos, 0);
     kernel_ = xrt::kernel(context_, NPU_KERNEL_NAME);
   }
 
+  // Time to wait for a hw context when the device has none left, e.g. held
+  // by other apps, before failing. Set with DD_HW_CONTEXT_WAIT_MS, 0 by
+  // default.
+  static int64_t get_wait_ms() {
+    const char *env = std::getenv("DD_HW_CONTEXT_WAIT_MS");
+    return env != nullptr ? std::max<int64_t>(std::atoll(env), 0) : 0;
+  }
+
+  static xrt::hw_context
+  create_hw_context(const xrt::device &device, const xrt::xclbin &xclbin,
+                    const xrt::hw_context::qos_type &qos, int64_t wait_ms) {
+    const auto start = std::chrono::steady_clock::now();
+    while (true) {
+      try {
+        return qos.empty() ? xrt::hw_context(device, xclbin.get_uuid())
+                           : xrt::hw_context(device, xclbin.get_uuid(), qos);
+      } catch (const std::exception &e) {
+        const auto waited =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count();
+        if (waited >= wait_ms) {
+          throw;
+        }
+        RYZENAI_LOG_TRACE(std::string("Waiting for a free hw context: ") +
+                          e.what());
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      }
+    }
+  }
+
+  // Caller should hold xrt_ctx_mutex_
+  static std::shared_ptr<xrt_context>
+  get_pool_context(context_pool &pool, const std::string &xclbin,
+                   size_t ctx_idx) {
+    if (pool.contexts.empty()) {
+      RYZENAI_LOG_TRACE("Context not found in map, creating new one");
+      pool.contexts.emplace_back(new xrt_context(xclbin, pool.qos));
+    }
+    while (pool.contexts.size() <= ctx_idx && !pool.exhausted) {
+      try {
+        pool.contexts.emplace_back(
+            new xrt_context(*pool.contexts.front(), pool.qos));
+      } catch (const std::exception &e) {
+        // e.g. the other apps on the NPU hold the other column partitions
+        RYZENAI_LOG_TRACE("No more hw contexts, sharing the " +
+                          std::to_string(pool.contexts.size()) +
+                          " of the pool: " + e.what());
+        pool.exhausted = true;
+      }
+    }
+    return pool.contexts.at(ctx_idx % pool.contexts.size());
+  }
+
 public:
   xrt_context() {}
   static std::shared_ptr<xrt_context> get_instance(const std::string &xclbin) {
-    RYZENAI_LOG_TRACE("Getting context with xclbin: " + xclbin);
+    return get_instance(xclbin, 0);
+  }
+
+  // Context ctx_idx of the pool of the xclbin, created if needed. Once the
+  // device has no context left for the pool, the contexts created so far
+  // are shared: ctx_idx is taken modulo their number.
+  static std::shared_ptr<xrt_context> get_instance(const std::string &xclbin,
+                                                   size_t ctx_idx) {
+    RYZENAI_LOG_TRACE("Getting context " + std::to_string(ctx_idx) +
+                      " with xclbin: " + xclbin);
     std::lock_guard<std::mutex> guard(xrt_ctx_mutex_);
-    if (ctx_map_.find(xclbin) != ctx_map_.end()) {
-      RYZENAI_LOG_TRACE("Context found in map");
-      auto ctx = ctx_map_[xclbin];
-      return ctx;
-    } else {
-      RYZENAI_LOG_TRACE("Context not found in map, creating new one");
-      auto ctx = std::make_shared<xrt_context>(xrt_context(xclbin));
-      ctx_map_[xclbin] = ctx;
-      return ctx;
-    }
+    return get_pool_context(ctx_map_[xclbin], xclbin, ctx_idx);
+  }
+
+  // Set the number of hw contexts lease() hands out for the xclbin, and the
+  // QoS of the contexts created from now on (xrt::hw_context keys, e.g.
+  // "priority", "latency", "gops", "fps"), context 0 included. Contexts are
+  // created on first lease, at most as many as the hardware has column
+  // partitions for.
+  static void configure_pool(const std::string &xclbin, size_t num_contexts,
+                             const xrt::hw_context::qos_type &qos = {}) {
+    std::lock_guard<std::mutex> guard(xrt_ctx_mutex_);
+    auto &pool = ctx_map_[xclbin];
+    pool.num_leased = std::max<size_t>(num_contexts, 1);
+    pool.qos = qos;
+  }
+
+  // Next context of the pool, round-robin, for users which run independent
+  // requests (e.g. one FusionRuntime per model). Ops keep using context 0
+  // since the instruction registry is shared.
+  static std::shared_ptr<xrt_context> lease(const std::string &xclbin) {
+    std::lock_guard<std::mutex> guard(xrt_ctx_mutex_);
+    auto &pool = ctx_map_[xclbin];
+    const size_t ctx_idx = pool.next_lease++ % pool.num_leased;
+    RYZENAI_LOG_TRACE("Leasing context " + std::to_string(ctx_idx) +
+                      " with xclbin: " + xclbin);
+    return get_pool_context(pool, xclbin, ctx_idx);
   }
 
   xrt::device &get_device() { return device_; }
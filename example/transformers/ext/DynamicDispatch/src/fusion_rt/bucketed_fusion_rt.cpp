@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <numeric>
+#include <op_fuser/bucketed_fusion_rt.hpp>
+
+#include <utils/logging.hpp>
+#include <utils/tfuncs.hpp>
+
+namespace OpsFusion {
+
+BucketedFusionRuntime::BucketedFusionRuntime(
+    const std::string &xclbin, const std::string &kernel_name_prefix)
+    : xrt_ctx_(ryzenai::dynamic_dispatch::xrt_context::get_instance(xclbin)),
+      ctx_(&xrt_ctx_->get_context()), kernel_name_prefix_(kernel_name_prefix) {}
+
+BucketedFusionRuntime::BucketedFusionRuntime(
+    xrt::hw_context *ctx, const std::string &kernel_name_prefix)
+    : ctx_(ctx), kernel_name_prefix_(kernel_name_prefix) {
+  DOD_ASSERT(ctx_ != nullptr, "BucketedFusionRuntime : hw_context is null");
+}
+
+static std::vector<std::string> get_dtypes(const Metadata &meta,
+                                           const std::string &label) {
+  std::vector<std::string> dtypes;
+  for (const auto &name : MAP_AT(meta.fused_tensors, label).packed_tensors) {
+    dtypes.push_back(MAP_AT(meta.tensor_map, name).dtype);
+  }
+  return dtypes;
+}
+
+void BucketedFusionRuntime::init(const std::vector<Metadata> &buckets,
+                                 const std::string &base_dir,
+                                 const DDConfig &cfg) {
+  std::lock_guard<std::mutex> guard(execute_mutex_);
+  DOD_ASSERT(!buckets.empty(), "BucketedFusionRuntime : no bucket given");
+  DDConfig bucket_cfg = cfg;
+  bucket_cfg.share_const_bo = true;
+
+  buckets_.clear();
+  for (const auto &meta : buckets) {
+    Bucket bucket;
+    bucket.rt = std::make_unique<FusionRuntime>(ctx_, kernel_name_prefix_);
+    bucket.rt->init(meta, base_dir, bucket_cfg);
+    const auto &rt_meta = bucket.rt->get_meta();
+    const auto &in_names = MAP_AT(rt_meta.fused_tensors, "in").packed_tensors;
+    for (const auto &name : in_names) {
+      bucket.input_shapes.push_back(MAP_AT(rt_meta.tensor_map, name).shape);
+    }
+    if (!buckets_.empty()) {
+      const auto &first_meta = buckets_.front().rt->get_meta();
+      DOD_ASSERT(get_dtypes(rt_meta, "in") == get_dtypes(first_meta, "in") &&
+                     get_dtypes(rt_meta, "out") ==
+                         get_dtypes(first_meta, "out"),
+                 OpsFusion::dod_format("Inputs/outputs of bucket {} don't "
+                                       "match with those of bucket 0",
+                                       buckets_.size()));
+    }
+    for (const auto &other : buckets_) {
+      DOD_ASSERT(other.input_shapes != bucket.input_shapes,
+                 OpsFusion::dod_format("Bucket {} has the input shapes of "
+                                       "another bucket",
+                                       buckets_.size()));
+    }
+    buckets_.push_back(std::move(bucket));
+  }
+
+  // Buckets run one at a time, all of them use the BOs of the largest one
+  auto io_size = [](const Bucket &bucket) {
+    return bucket.rt->get_input_buffer_size() +
+           bucket.rt->get_output_buffer_size();
+  };
+  auto &owner = *std::max_element(buckets_.begin(), buckets_.end(),
+                                  [&](const Bucket &a, const Bucket &b) {
+                                    return io_size(a) < io_size(b);
+                                  });
+  size_t num_shared = 0;
+  for (auto &bucket : buckets_) {
+    if (&bucket != &owner && bucket.rt->share_data_bos(*owner.rt)) {
+      num_shared++;
+    }
+  }
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "BucketedFusionRuntime : initialized {} buckets, {} of them share the "
+      "data bos of the largest one",
+      buckets_.size(), num_shared));
+}
+
+void BucketedFusionRuntime::execute(const std::vector<Tensor> &inputs,
+                                    const std::vector<Tensor> &outputs) {
+  std::lock_guard<std::mutex> guard(execute_mutex_);
+  for (auto &bucket : buckets_) {
+    if (bucket.input_shapes.size() != inputs.size()) {
+      continue;
+    }
+    bool match = true;
+    for (size_t i = 0; i < inputs.size() && match; ++i) {
+      match = inputs[i].shape == bucket.input_shapes[i];
+    }
+    if (match) {
+      bucket.rt->execute(inputs, outputs);
+      return;
+    }
+  }
+  DOD_THROW(OpsFusion::dod_format(
+      "BucketedFusionRuntime : no bucket for the shapes of the {} inputs",
+      inputs.size()));
+}
+
+size_t BucketedFusionRuntime::find_bucket(
+    const std::vector<std::vector<size_t>> &input_shapes) const {
+  size_t best_idx = buckets_.size();
+  size_t best_numel = 0;
+  for (size_t idx = 0; idx < buckets_.size(); ++idx) {
+    const auto &shapes = buckets_[idx].input_shapes;
+    if (shapes.size() != input_shapes.size()) {
+      continue;
+    }
+    bool fits = true;
+    size_t numel = 0;
+    for (size_t i = 0; i < shapes.size() && fits; ++i) {
+      fits = shapes[i].size() == input_shapes[i].size() &&
+             std::equal(input_shapes[i].begin(), input_shapes[i].end(),
+                        shapes[i].begin(), std::less_equal<size_t>());
+      numel += std::accumulate(shapes[i].begin(), shapes[i].end(), size_t{1},
+                               std::multiplies{});
+    }
+    if (fits && (best_idx == buckets_.size() || numel < best_numel)) {
+      best_idx = idx;
+      best_numel = numel;
+    }
+  }
+  DOD_ASSERT(best_idx < buckets_.size(),
+             OpsFusion::dod_format("BucketedFusionRuntime : no bucket fits "
+                                   "the shapes of the {} inputs",
+                                   input_shapes.size()));
+  return best_idx;
+}
+
+const std::vector<std::vector<size_t>> &
+BucketedFusionRuntime::get_input_shapes(size_t bucket_idx) const {
+  return buckets_.at(bucket_idx).input_shapes;
+}
+
+size_t BucketedFusionRuntime::get_num_buckets() const {
+  return buckets_.size();
+}
+
+FusionRuntime &BucketedFusionRuntime::get_runtime(size_t bucket_idx) {
+  return *buckets_.at(bucket_idx).rt;
+}
+
+} // namespace OpsFusion
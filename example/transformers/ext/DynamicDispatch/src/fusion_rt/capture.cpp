@@ -0,0 +1,168 @@
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+
+#include <nlohmann/json.hpp>
+
+#include <op_fuser/fusion_rt.hpp>
+#include <ops/op_builder.hpp>
+#include <utils/logging.hpp>
+#include <utils/tfuncs.hpp>
+#include <utils/utils.hpp>
+
+#include "fusion_rt/compiled_cache.hpp"
+
+// Replay bundle written by FusionRuntime::write_capture(), in capture_dir :
+//   dd_<hash>.ddcache  the compiled model, in the CompiledCache format
+//   capture.json       shapes/dtypes of the inputs & outputs, xclbin uuid,
+//                      profile level and latency stats of the captured
+//                      runtime
+//   input_<i>.bin      data of input i
+//   output_<i>.bin     data of output i
+
+using json = nlohmann::json;
+
+namespace OpsFusion {
+
+// The bundle holds a single model, the key only checks the file is one
+static const std::string CAPTURE_KEY = "dd_capture";
+static const std::string CAPTURE_RECORD_FILE = "capture.json";
+
+static std::string get_tensor_file(const std::string &prefix, size_t idx) {
+  return OpsFusion::dod_format("{}_{}.bin", prefix, idx);
+}
+
+static size_t get_tensor_size(const Tensor &tensor) {
+  return std::accumulate(tensor.shape.begin(), tensor.shape.end(), size_t{1},
+                         std::multiplies{}) *
+         Utils::get_size_of_type(tensor.dtype);
+}
+
+static json write_tensors(const std::filesystem::path &dir,
+                          const std::string &prefix,
+                          const std::vector<Tensor> &tensors) {
+  json tensors_js = json::array();
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    const auto &tensor = tensors[i];
+    const auto fname = get_tensor_file(prefix, i);
+    std::ofstream ofs(dir / fname, std::ios::binary);
+    ofs.write(static_cast<const char *>(tensor.data), get_tensor_size(tensor));
+    DOD_THROW_IF(!ofs, OpsFusion::dod_format("Failed to write {}", fname));
+    tensors_js.push_back(
+        {{"shape", tensor.shape}, {"dtype", tensor.dtype}, {"file", fname}});
+  }
+  return tensors_js;
+}
+
+static std::vector<CaptureRecord::TensorData>
+read_tensors(const std::filesystem::path &dir, const json &tensors_js) {
+  std::vector<CaptureRecord::TensorData> tensors;
+  for (const auto &tensor_js : tensors_js) {
+    CaptureRecord::TensorData tensor;
+    tensor.shape = tensor_js.at("shape").get<std::vector<size_t>>();
+    tensor.dtype = tensor_js.at("dtype").get<std::string>();
+    tensor.data.resize(get_tensor_size({nullptr, tensor.shape, tensor.dtype}));
+    const auto fname = tensor_js.at("file").get<std::string>();
+    std::ifstream ifs(dir / fname, std::ios::binary);
+    ifs.read(reinterpret_cast<char *>(tensor.data.data()), tensor.data.size());
+    DOD_THROW_IF(!ifs, OpsFusion::dod_format("Failed to read {}", fname));
+    tensors.push_back(std::move(tensor));
+  }
+  return tensors;
+}
+
+void FusionRuntime::write_capture(const std::vector<Tensor> &inputs,
+                                  const std::vector<Tensor> &outputs) {
+  const std::filesystem::path dir =
+      Utils::get_env_var("DD_CAPTURE_DIR", cfg_.capture_dir);
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "FusionRuntime : Capture to {} ...", dir.string()));
+  // best effort like the compiled cache, the execution itself succeeded
+  try {
+    std::filesystem::create_directories(dir);
+    CompiledCache cache(dir.string(), CAPTURE_KEY);
+    save_compiled_model(meta_, cache);
+    DOD_THROW_IF(!std::filesystem::exists(cache.get_path()),
+                 OpsFusion::dod_format("Failed to save the compiled model"));
+
+    json latency_js;
+    for (const auto &[name, stats] : get_latency_stats()) {
+      latency_js[name] = {{"count", stats.count},   {"min_ns", stats.min_ns},
+                          {"max_ns", stats.max_ns}, {"mean_ns", stats.mean_ns},
+                          {"p50_ns", stats.p50_ns}, {"p99_ns", stats.p99_ns},
+                          {"p999_ns", stats.p999_ns}};
+    }
+    const auto xclbin_uuid = ctx_.get_xclbin().get_uuid().to_string();
+    const json record_js = {{"xclbin", xclbin_uuid},
+                            {"profile", cfg_.profile},
+                            {"inputs", write_tensors(dir, "input", inputs)},
+                            {"outputs", write_tensors(dir, "output", outputs)},
+                            {"latency", latency_js}};
+    std::ofstream ofs(dir / CAPTURE_RECORD_FILE);
+    ofs << std::setw(2) << record_js << std::endl;
+    DOD_THROW_IF(!ofs, OpsFusion::dod_format("Failed to write {}",
+                                             CAPTURE_RECORD_FILE));
+  } catch (std::exception &e) {
+    RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+        "FusionRuntime : Failed to capture to {} : {}", dir.string(),
+        e.what()));
+    return;
+  }
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "FusionRuntime : Capture to {} ... DONE", dir.string()));
+}
+
+CaptureRecord FusionRuntime::init_capture(const std::string &capture_dir,
+                                          const DDConfig &cfg) {
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "FusionRuntime : Init from capture {} ...", capture_dir));
+  OpCacheScope op_cache;
+
+  const std::filesystem::path dir = capture_dir;
+  std::ifstream ifs(dir / CAPTURE_RECORD_FILE);
+  DOD_ASSERT(ifs.is_open(), OpsFusion::dod_format("No {} in {}",
+                                                  CAPTURE_RECORD_FILE,
+                                                  capture_dir));
+  const json record_js = json::parse(ifs);
+  const auto xclbin_uuid = ctx_.get_xclbin().get_uuid().to_string();
+  DOD_ASSERT(record_js.at("xclbin").get<std::string>() == xclbin_uuid,
+             OpsFusion::dod_format("{} was captured with another xclbin than "
+                                   "the one of this runtime ({})",
+                                   capture_dir, xclbin_uuid));
+  CaptureRecord record;
+  record.profile = record_js.at("profile").get<uint32_t>();
+  record.inputs = read_tensors(dir, record_js.at("inputs"));
+  record.outputs = read_tensors(dir, record_js.at("outputs"));
+  for (const auto &[name, stats_js] : record_js.at("latency").items()) {
+    auto &stats = record.latency[name];
+    stats.count = stats_js.at("count").get<uint64_t>();
+    stats.min_ns = stats_js.at("min_ns").get<int64_t>();
+    stats.max_ns = stats_js.at("max_ns").get<int64_t>();
+    stats.mean_ns = stats_js.at("mean_ns").get<double>();
+    stats.p50_ns = stats_js.at("p50_ns").get<int64_t>();
+    stats.p99_ns = stats_js.at("p99_ns").get<int64_t>();
+    stats.p999_ns = stats_js.at("p999_ns").get<int64_t>();
+  }
+
+  CompiledCache cache(capture_dir, CAPTURE_KEY);
+  CompiledModel model;
+  DOD_ASSERT(cache.load(model),
+             OpsFusion::dod_format("Invalid compiled model {}",
+                                   cache.get_path()));
+
+  reset_state(model.meta, cfg);
+  // the timers of the captured profile level are in the transactions
+  cfg_.profile = record.profile;
+  meta_ = std::move(model.meta);
+  fused_instr_vec_ = std::move(model.fused_instrs);
+  txns_ = std::move(model.txns);
+  init_bos(&model);
+  reset_latency_histograms(meta_);
+  capture_pending_ = false;
+
+  RYZENAI_LOG_TRACE("FusionRuntime : Init from capture ... DONE");
+  return record;
+}
+
+} // namespace OpsFusion
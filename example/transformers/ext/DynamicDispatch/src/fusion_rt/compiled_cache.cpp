@@ -0,0 +1,531 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string_view>
+#include <typeinfo>
+
+#include <nlohmann/json.hpp>
+
+#include <ops/op_interface.hpp>
+#include <utils/logging.hpp>
+#include <utils/tfuncs.hpp>
+#include <utils/utils.hpp>
+
+#include "fusion_rt/compiled_cache.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifndef DD_VERSION
+#define DD_VERSION "unknown"
+#endif
+
+using json = nlohmann::json;
+
+namespace OpsFusion {
+
+static constexpr char CACHE_MAGIC[8] = {'D', 'D', 'C', 'A', 'C', 'H', 'E', 0};
+// Bump this whenever the layout or the serialized metadata changes
+static constexpr uint32_t CACHE_FORMAT_VERSION = 3;
+static constexpr size_t CACHE_SECTION_ALIGNMENT = 4096; // Bytes
+
+enum class SectionKind : uint32_t {
+  KEY = 0,
+  META = 1,
+  INSTR = 2,
+  TXN = 3,
+  CONST_IMAGE = 4,
+  SUPER_INSTR_IMAGE = 5,
+};
+
+struct CacheHeader {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t num_sections;
+};
+
+struct SectionDesc {
+  uint32_t kind;
+  uint32_t index;
+  uint64_t offset;
+  uint64_t size;
+};
+
+static json attr_to_json(const std::string &name, const std::any &value) {
+  if (value.type() == typeid(std::vector<float>)) {
+    return {{"type", "float"},
+            {"value", std::any_cast<const std::vector<float> &>(value)}};
+  } else if (value.type() == typeid(std::vector<int>)) {
+    return {{"type", "int"},
+            {"value", std::any_cast<const std::vector<int> &>(value)}};
+  } else if (value.type() == typeid(std::vector<std::string>)) {
+    return {{"type", "str"},
+            {"value", std::any_cast<const std::vector<std::string> &>(value)}};
+  } else if (value.type() == typeid(std::string)) {
+    return {{"type", "string"},
+            {"value", std::any_cast<const std::string &>(value)}};
+  } else if (value.type() == typeid(uint32_t)) {
+    return {{"type", "uint32"}, {"value", std::any_cast<uint32_t>(value)}};
+  }
+  DOD_THROW(OpsFusion::dod_format(
+      "CompiledCache : Can't serialize attribute {} of type {}", name,
+      value.type().name()));
+}
+
+static std::any json_to_attr(const json &js) {
+  const auto dtype = js.at("type").get<std::string>();
+  const auto &value = js.at("value");
+  if (dtype == "float") {
+    return value.get<std::vector<float>>();
+  } else if (dtype == "int") {
+    return value.get<std::vector<int>>();
+  } else if (dtype == "str") {
+    return value.get<std::vector<std::string>>();
+  } else if (dtype == "string") {
+    return value.get<std::string>();
+  } else if (dtype == "uint32") {
+    return value.get<uint32_t>();
+  }
+  DOD_THROW(OpsFusion::dod_format(
+      "CompiledCache : Unknown attribute type in cache : {}", dtype));
+}
+
+static json tensors_to_json(const std::any &value) {
+  json js = json::object();
+  for (const auto &[name, tensor] :
+       std::any_cast<const std::map<std::string, Tensor> &>(value)) {
+    js[name] = {{"shape", tensor.shape}, {"dtype", tensor.dtype}};
+  }
+  return js;
+}
+
+static std::map<std::string, Tensor> json_to_tensors(const json &js) {
+  std::map<std::string, Tensor> tensors;
+  for (const auto &[name, tinfo] : js.items()) {
+    tensors[name] = {nullptr, tinfo.at("shape").get<std::vector<size_t>>(),
+                     tinfo.at("dtype").get<std::string>()};
+  }
+  return tensors;
+}
+
+static json span_map_to_json(const std::map<std::string, Metadata::Span> &m) {
+  json js = json::object();
+  for (const auto &[name, span] : m) {
+    js[name] = {span.offset, span.size};
+  }
+  return js;
+}
+
+static std::map<std::string, Metadata::Span>
+json_to_span_map(const json &js) {
+  std::map<std::string, Metadata::Span> m;
+  for (const auto &[name, span] : js.items()) {
+    m[name] = {span.at(0).get<size_t>(), span.at(1).get<size_t>()};
+  }
+  return m;
+}
+
+static json meta_to_json(const Metadata &meta) {
+  json js;
+  js["json_path"] = meta.json_path;
+
+  js["op_list"] = json::array();
+  for (const auto &op_info : meta.op_list) {
+    json attrs = json::object();
+    for (const auto &[name, value] : op_info.attr) {
+      attrs[name] = attr_to_json(name, value);
+    }
+    js["op_list"].push_back({{"name", op_info.name},
+                             {"type", op_info.type},
+                             {"args", op_info.args},
+                             {"attrs", std::move(attrs)},
+                             {"pdi_id", op_info.pdi_id}});
+  }
+
+  js["fused_tensors"] = json::object();
+  for (const auto &[name, tinfo] : meta.fused_tensors) {
+    js["fused_tensors"][name] = {{"size", tinfo.size},
+                                 {"arg_idx", tinfo.arg_idx},
+                                 {"packed_tensors", tinfo.packed_tensors}};
+  }
+
+  js["tensor_map"] = json::object();
+  for (const auto &[name, off_info] : meta.tensor_map) {
+    js["tensor_map"][name] = {{"parent_name", off_info.parent_name},
+                              {"offset", off_info.offset},
+                              {"arg_idx", off_info.arg_idx},
+                              {"dtype", off_info.dtype},
+                              {"shape", off_info.shape},
+                              {"size_in_bytes", off_info.size_in_bytes},
+                              {"file_name", off_info.file_name},
+                              {"file_size", off_info.file_size},
+                              {"file_offset", off_info.file_offset}};
+  }
+
+  js["tensor_views"] = json::object();
+  for (const auto &[name, view] : meta.tensor_views) {
+    js["tensor_views"][name] = {{"base_name", view.base_name},
+                                {"offset", view.offset}};
+  }
+
+  js["super_instr_map"] = span_map_to_json(meta.super_instr_map);
+  js["const_map"] = span_map_to_json(meta.const_map);
+  js["scratch_op_set"] = meta.scratch_op_set;
+  js["max_op_scratch_pad_size"] = meta.max_op_scratch_pad_size;
+  js["max_tensor_padding_sz"] = meta.max_tensor_padding_sz;
+
+  js["aux_info"] = json::object();
+  for (const auto &[name, value] : meta.aux_info) {
+    DOD_ASSERT(name == "original_outputs" || name == "original_inputs",
+               OpsFusion::dod_format(
+                   "CompiledCache : Can't serialize aux_info {}", name));
+    js["aux_info"][name] = tensors_to_json(value);
+  }
+
+  js["partitions"] = json::array();
+  for (const auto &partition : meta.partitions) {
+    js["partitions"].push_back({partition.op_range.first,
+                                partition.op_range.second, partition.pdi_id});
+  }
+
+  return js;
+}
+
+static Metadata json_to_meta(const json &js) {
+  Metadata meta;
+  meta.json_path = js.at("json_path").get<std::string>();
+
+  for (const auto &op_js : js.at("op_list")) {
+    Metadata::OpInfo op_info;
+    op_info.name = op_js.at("name").get<std::string>();
+    op_info.type = op_js.at("type").get<std::string>();
+    op_info.args = op_js.at("args").get<std::vector<std::string>>();
+    for (const auto &[name, attr_js] : op_js.at("attrs").items()) {
+      op_info.attr[name] = json_to_attr(attr_js);
+    }
+    op_info.pdi_id = op_js.at("pdi_id").get<uint8_t>();
+    meta.op_list.push_back(std::move(op_info));
+  }
+
+  for (const auto &[name, tinfo] : js.at("fused_tensors").items()) {
+    meta.fused_tensors[name] = {
+        tinfo.at("size").get<size_t>(), tinfo.at("arg_idx").get<size_t>(),
+        tinfo.at("packed_tensors").get<std::vector<std::string>>()};
+  }
+
+  for (const auto &[name, off_info] : js.at("tensor_map").items()) {
+    meta.tensor_map[name] = {
+        off_info.at("parent_name").get<std::string>(),
+        off_info.at("offset").get<size_t>(),
+        off_info.at("arg_idx").get<size_t>(),
+        off_info.at("dtype").get<std::string>(),
+        off_info.at("shape").get<std::vector<size_t>>(),
+        off_info.at("size_in_bytes").get<size_t>(),
+        off_info.at("file_name").get<std::string>(),
+        off_info.at("file_size").get<size_t>(),
+        off_info.at("file_offset").get<size_t>()};
+  }
+
+  for (const auto &[name, view] : js.at("tensor_views").items()) {
+    meta.tensor_views[name] = {view.at("base_name").get<std::string>(),
+                               view.at("offset").get<size_t>()};
+  }
+
+  meta.super_instr_map = json_to_span_map(js.at("super_instr_map"));
+  meta.const_map = json_to_span_map(js.at("const_map"));
+  meta.scratch_op_set =
+      js.at("scratch_op_set").get<std::set<std::string>>();
+  meta.max_op_scratch_pad_size =
+      js.at("max_op_scratch_pad_size").get<size_t>();
+  meta.max_tensor_padding_sz = js.at("max_tensor_padding_sz").get<size_t>();
+
+  for (const auto &[name, tensors_js] : js.at("aux_info").items()) {
+    meta.aux_info[name] = json_to_tensors(tensors_js);
+  }
+
+  for (const auto &partition_js : js.at("partitions")) {
+    Partition partition;
+    partition.op_range = {partition_js.at(0).get<size_t>(),
+                          partition_js.at(1).get<size_t>()};
+    partition.pdi_id = partition_js.at(2).get<uint8_t>();
+    meta.partitions.push_back(partition);
+  }
+
+  return meta;
+}
+
+std::string CompiledCache::get_key(const Metadata &meta,
+                                   const std::string &key_info) {
+  json meta_js = meta_to_json(meta);
+  // Derived by the passes, and not necessarily initialized yet
+  for (const auto &field :
+       {"tensor_views", "super_instr_map", "const_map", "scratch_op_set",
+        "max_op_scratch_pad_size", "max_tensor_padding_sz", "partitions"}) {
+    meta_js.erase(field);
+  }
+
+  // Consts are read from files, so any change to them should invalidate
+  // the cache as well.
+  json const_files = json::array();
+  std::set<std::string> stamped_files;
+  for (const auto &[name, off_info] : meta.tensor_map) {
+    // the consts of a packed archive share one file
+    if (off_info.file_name.empty() ||
+        !stamped_files.insert(off_info.file_name).second) {
+      continue;
+    }
+    std::error_code ec;
+    auto file_size = std::filesystem::file_size(off_info.file_name, ec);
+    auto mtime = std::filesystem::last_write_time(off_info.file_name, ec);
+    const_files.push_back({off_info.file_name, ec ? 0 : file_size,
+                           ec ? 0 : mtime.time_since_epoch().count()});
+  }
+
+  json key_js = {{"dd_version", DD_VERSION},
+                 {"format_version", CACHE_FORMAT_VERSION},
+                 {"info", key_info},
+                 {"meta", std::move(meta_js)},
+                 {"const_files", std::move(const_files)}};
+  return key_js.dump();
+}
+
+CompiledCache::CompiledCache(const std::string &cache_dir,
+                             const std::string &key)
+    : key_(key) {
+  const auto key_hash = std::hash<std::string>{}(key_);
+  path_ = (std::filesystem::path(cache_dir) /
+           OpsFusion::dod_format("dd_{}.ddcache", key_hash))
+              .string();
+}
+
+CompiledCache::~CompiledCache() { unmap(); }
+
+void CompiledCache::unmap() {
+  if (mapped_data_ == nullptr) {
+    return;
+  }
+#ifdef _WIN32
+  UnmapViewOfFile(mapped_data_);
+  CloseHandle(mapping_handle_);
+  CloseHandle(file_handle_);
+  mapping_handle_ = nullptr;
+  file_handle_ = nullptr;
+#else
+  munmap(const_cast<uint8_t *>(mapped_data_), mapped_size_);
+#endif
+  mapped_data_ = nullptr;
+  mapped_size_ = 0;
+}
+
+bool CompiledCache::load(CompiledModel &model) {
+  unmap();
+
+#ifdef _WIN32
+  HANDLE file =
+      CreateFileA(path_.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    return false;
+  }
+  void *ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (ptr == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+  file_handle_ = file;
+  mapping_handle_ = mapping;
+  mapped_size_ = static_cast<size_t>(file_size.QuadPart);
+#else
+  int fd = open(path_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    return false;
+  }
+  mapped_size_ = static_cast<size_t>(st.st_size);
+#endif
+  mapped_data_ = static_cast<const uint8_t *>(ptr);
+
+  RYZENAI_LOG_TRACE(
+      OpsFusion::dod_format("CompiledCache : Loading {} ...", path_));
+  try {
+    CacheHeader header;
+    DOD_THROW_IF(mapped_size_ < sizeof(header),
+                 OpsFusion::dod_format("Truncated header"));
+    memcpy(&header, mapped_data_, sizeof(header));
+    DOD_THROW_IF(memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0,
+                 OpsFusion::dod_format("Invalid magic"));
+    DOD_THROW_IF(header.format_version != CACHE_FORMAT_VERSION,
+                 OpsFusion::dod_format("Unsupported format version {}",
+                                       header.format_version));
+    DOD_THROW_IF(sizeof(header) + header.num_sections * sizeof(SectionDesc) >
+                     mapped_size_,
+                 OpsFusion::dod_format("Truncated section table"));
+
+    CompiledModel res;
+    bool key_match = false;
+    json meta_js;
+    for (uint32_t i = 0; i < header.num_sections; ++i) {
+      SectionDesc desc;
+      memcpy(&desc, mapped_data_ + sizeof(header) + i * sizeof(desc),
+             sizeof(desc));
+      DOD_THROW_IF(desc.offset > mapped_size_ ||
+                       desc.size > mapped_size_ - desc.offset,
+                   OpsFusion::dod_format("Section {} out of bounds", i));
+      const uint8_t *data = mapped_data_ + desc.offset;
+      switch (static_cast<SectionKind>(desc.kind)) {
+      case SectionKind::KEY:
+        key_match = std::string_view((const char *)data, desc.size) == key_;
+        break;
+      case SectionKind::META:
+        meta_js = json::from_cbor(data, data + desc.size);
+        break;
+      case SectionKind::INSTR:
+        DOD_ASSERT(desc.index == res.fused_instrs.size(),
+                   OpsFusion::dod_format("Unexpected instr index {}",
+                                         desc.index));
+        res.fused_instrs.emplace_back(data, data + desc.size);
+        break;
+      case SectionKind::TXN:
+        DOD_ASSERT(desc.index == res.txns.size(),
+                   OpsFusion::dod_format("Unexpected txn index {}",
+                                         desc.index));
+        res.txns.emplace_back(data, data + desc.size);
+        break;
+      case SectionKind::CONST_IMAGE:
+        res.const_image = data;
+        res.const_image_size = desc.size;
+        break;
+      case SectionKind::SUPER_INSTR_IMAGE:
+        res.super_instr_image = data;
+        res.super_instr_image_size = desc.size;
+        break;
+      default:
+        DOD_THROW(
+            OpsFusion::dod_format("Unknown section kind {}", desc.kind));
+      }
+    }
+    // Hash collision or stale file
+    DOD_THROW_IF(!key_match, OpsFusion::dod_format("Key mismatch"));
+    DOD_THROW_IF(meta_js.is_null(), OpsFusion::dod_format("No metadata"));
+    res.meta = json_to_meta(meta_js);
+    DOD_THROW_IF(res.fused_instrs.size() != res.meta.partitions.size(),
+                 OpsFusion::dod_format("Partition count mismatch"));
+    model = std::move(res);
+  } catch (std::exception &e) {
+    RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+        "CompiledCache : Ignoring invalid cache file {} : {}", path_,
+        e.what()));
+    unmap();
+    return false;
+  }
+
+  RYZENAI_LOG_TRACE(
+      OpsFusion::dod_format("CompiledCache : Loading {} ... DONE", path_));
+  return true;
+}
+
+void CompiledCache::save(const CompiledModel &model) const {
+  RYZENAI_LOG_TRACE(
+      OpsFusion::dod_format("CompiledCache : Saving {} ...", path_));
+  // Write to a temp file and rename, so that concurrent readers never see
+  // a partially written artifact.
+  const std::string tmp_path =
+      OpsFusion::dod_format("{}.{}.tmp", path_, _DD_GET_PID());
+  try {
+    const auto meta_cbor = json::to_cbor(meta_to_json(model.meta));
+
+    struct Section {
+      SectionKind kind;
+      uint32_t index;
+      const void *data;
+      size_t size;
+    };
+    std::vector<Section> sections;
+    sections.push_back({SectionKind::KEY, 0, key_.data(), key_.size()});
+    sections.push_back(
+        {SectionKind::META, 0, meta_cbor.data(), meta_cbor.size()});
+    for (size_t i = 0; i < model.fused_instrs.size(); ++i) {
+      sections.push_back({SectionKind::INSTR, static_cast<uint32_t>(i),
+                          model.fused_instrs[i].data(),
+                          model.fused_instrs[i].size()});
+    }
+    for (size_t i = 0; i < model.txns.size(); ++i) {
+      sections.push_back({SectionKind::TXN, static_cast<uint32_t>(i),
+                          model.txns[i].data(), model.txns[i].size()});
+    }
+    sections.push_back({SectionKind::CONST_IMAGE, 0, model.const_image,
+                        model.const_image_size});
+    sections.push_back({SectionKind::SUPER_INSTR_IMAGE, 0,
+                        model.super_instr_image,
+                        model.super_instr_image_size});
+
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.format_version = CACHE_FORMAT_VERSION;
+    header.num_sections = static_cast<uint32_t>(sections.size());
+
+    std::vector<SectionDesc> descs;
+    size_t offset = Utils::align_to_next(
+        sizeof(header) + sections.size() * sizeof(SectionDesc),
+        CACHE_SECTION_ALIGNMENT);
+    for (const auto &section : sections) {
+      descs.push_back({static_cast<uint32_t>(section.kind), section.index,
+                       offset, section.size});
+      offset = Utils::align_to_next(offset + section.size,
+                                    CACHE_SECTION_ALIGNMENT);
+    }
+
+    std::filesystem::create_directories(
+        std::filesystem::path(path_).parent_path());
+    {
+      std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+      DOD_THROW_IF(!ofs.is_open(), OpsFusion::dod_format(
+                                       "Couldn't open {} for writing",
+                                       tmp_path));
+      ofs.write((const char *)&header, sizeof(header));
+      ofs.write((const char *)descs.data(), descs.size() * sizeof(descs[0]));
+      for (size_t i = 0; i < sections.size(); ++i) {
+        ofs.seekp(descs[i].offset);
+        ofs.write((const char *)sections[i].data, sections[i].size);
+      }
+      DOD_THROW_IF(!ofs.good(),
+                   OpsFusion::dod_format("Failed writing {}", tmp_path));
+    }
+    std::filesystem::rename(tmp_path, path_);
+  } catch (std::exception &e) {
+    RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+        "CompiledCache : Failed to save {} : {}", path_, e.what()));
+    std::error_code ec;
+    std::filesystem::remove(tmp_path, ec);
+    return;
+  }
+  RYZENAI_LOG_TRACE(
+      OpsFusion::dod_format("CompiledCache : Saving {} ... DONE", path_));
+}
+
+} // namespace OpsFusion
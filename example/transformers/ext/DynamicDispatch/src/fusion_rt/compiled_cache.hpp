@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <op_fuser/fuse_types.hpp>
+
+namespace OpsFusion {
+
+// Everything FusionRuntime::init() produces that is independent of the
+// hw_context: post-pass metadata, fused transactions and the images of the
+// const and super instruction BOs.
+struct CompiledModel {
+  Metadata meta;
+  std::vector<std::vector<uint8_t>> fused_instrs;
+  std::vector<std::vector<uint8_t>> txns;
+  // On load(), these point into the mapped cache file and stay valid as long
+  // as the CompiledCache object is alive.
+  const uint8_t *const_image = nullptr;
+  size_t const_image_size = 0;
+  const uint8_t *super_instr_image = nullptr;
+  size_t super_instr_image_size = 0;
+};
+
+// On-disk cache of CompiledModel.
+// One file per key, laid out as a header, a section table and page aligned
+// sections, so that BO images can be copied straight from the mapped file.
+class CompiledCache {
+public:
+  CompiledCache(const std::string &cache_dir, const std::string &key);
+  ~CompiledCache();
+  CompiledCache(const CompiledCache &) = delete;
+  CompiledCache &operator=(const CompiledCache &) = delete;
+
+  // Returns false if there is no valid artifact for the key.
+  bool load(CompiledModel &model);
+  // Failures are logged and otherwise ignored, cache is best effort.
+  void save(const CompiledModel &model) const;
+  const std::string &get_path() const { return path_; }
+
+  /// @brief Build the cache key of a model. key_info should describe
+  /// everything else init() depends on, e.g. xclbin and DDConfig.
+  /// Throws if metadata contains attributes that can't be serialized.
+  static std::string get_key(const Metadata &meta, const std::string &key_info);
+
+private:
+  void unmap();
+
+  std::string key_;
+  std::string path_;
+
+  const uint8_t *mapped_data_ = nullptr;
+  size_t mapped_size_ = 0;
+#ifdef _WIN32
+  void *file_handle_ = nullptr;
+  void *mapping_handle_ = nullptr;
+#endif
+};
+
+} // namespace OpsFusion
@@ -1,5 +1,10 @@
 #include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
 #include <mutex>
+#include <set>
+#include <sstream>
 #include <op_fuser/fuse_ops.hpp>
 #include <op_fuser/fusion_rt.hpp>
 #include <ops/op_builder.hpp>
@@ -8,13 +13,16 @@
 #include <ps/op_init.hpp>
 #include <ps/op_types.h>
 
+#include <utils/event_tracer.hpp>
 #include <utils/logging.hpp>
 #include <utils/meta_utils.hpp>
 #include <utils/tfuncs.hpp>
 #include <utils/utils.hpp>
 
+#include "fusion_rt/compiled_cache.hpp"
 #include "passes/passes.hpp"
 #include "txn/txn_utils.hpp"
+#include "txn_helper/txn_helper.hpp"
 #include "utils/dpu_mdata.hpp"
 
 #include <experimental/xrt_error.h>
@@ -27,16 +35,25 @@ static constexpr uint32_t HOST_BO_GROUP_ID = 0;
 
 static constexpr size_t XRT_BO_MIN_SIZE = 4096; // Bytes
 static constexpr size_t XRT_BO_INIT_VALUE = 0;
+static constexpr size_t XRT_USER_PTR_ALIGNMENT = 4096; // Bytes
 
 static constexpr size_t INSTR_XRT_BO_MAX_SIZE = 48ULL * 1024ULL * 1024ULL;
-static constexpr size_t INSTR_XRT_BO_STACK_SIZE = 12ULL * 1024ULL * 1024ULL;
-static constexpr size_t NUM_STATIC_INSTR_BUFFERS = 2;
-static constexpr size_t INSTR_BUFFER_SIZE =
-    INSTR_XRT_BO_STACK_SIZE / NUM_STATIC_INSTR_BUFFERS;
-static constexpr size_t INSTR_XRT_BO_HEAP_SIZE =
-    INSTR_XRT_BO_MAX_SIZE - INSTR_XRT_BO_STACK_SIZE;
+// size of each static instr BO in the "stack" ring
+static constexpr size_t INSTR_BUFFER_SIZE = 6ULL * 1024ULL * 1024ULL;
+static constexpr size_t MIN_STATIC_INSTR_BUFFERS = 2;
+static constexpr size_t MAX_STATIC_INSTR_BUFFERS = 6;
 static constexpr size_t INSTR_XRT_BO_ALIGNMENT = 32ULL * 1024ULL;
 
+// Depth of the static instr BO ring. Deeper ring lets uploads run further
+// ahead of the NPU for graphs with many partitions, at the cost of heap size.
+static const size_t num_static_instr_buffers = std::clamp<size_t>(
+    std::stoul(Utils::get_env_var("DD_NUM_INSTR_BUFFERS", "2")),
+    MIN_STATIC_INSTR_BUFFERS, MAX_STATIC_INSTR_BUFFERS);
+static const size_t instr_xrt_bo_stack_size =
+    num_static_instr_buffers * INSTR_BUFFER_SIZE;
+static const size_t instr_xrt_bo_heap_size =
+    INSTR_XRT_BO_MAX_SIZE - instr_xrt_bo_stack_size;
+
 struct XRTBufferState {
   // how much memory is currently used by this context
   size_t heap_total_size = 0;
@@ -51,6 +68,48 @@ struct XRTBufferState {
 // NOTE: current access to this is NOT THREAD SAFE!!!
 static std::map<xrt_core::hwctx_handle *, XRTBufferState> xrt_instr_state;
 static std::mutex instr_state_mutex;
+// static instr BOs above, one slot per xrt hw context
+static ryzenai::dynamic_dispatch::npu_memory_account
+    static_instr_account("FusionRuntime static instr BOs");
+
+// const & super instr BOs shared between FusionRuntimes on the same xrt hw
+// context, keyed by hash of the BO contents. Entries expire with the last user.
+static std::map<xrt_core::hwctx_handle *,
+                std::multimap<size_t, std::weak_ptr<xrt::bo>>>
+    const_bo_pool;
+static std::mutex const_bo_pool_mutex;
+
+// Timers are always on, they feed the latency histograms
+static inline int64_t get_time_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Event names of the execute phases, see EventTracer
+struct TraceNames {
+  uint32_t execute;
+  uint32_t input_copy;
+  uint32_t input_sync;
+  uint32_t instr_upload;
+  uint32_t partition;
+  uint32_t output_sync;
+  uint32_t output_copy;
+};
+
+static const TraceNames &get_trace_names() {
+  static const TraceNames names = []() {
+    auto &tracer = OpsFusion::EventTracer::get_instance();
+    return TraceNames{tracer.get_name_id("execute"),
+                      tracer.get_name_id("input_copy"),
+                      tracer.get_name_id("input_sync"),
+                      tracer.get_name_id("instr_upload"),
+                      tracer.get_name_id("partition"),
+                      tracer.get_name_id("output_sync"),
+                      tracer.get_name_id("output_copy")};
+  }();
+  return names;
+}
 
 static bool enable_write_internal_bufs = static_cast<bool>(
     std::stol(Utils::get_env_var("DD_WRITE_INTERNAL_BUFS", "0")));
@@ -78,6 +137,12 @@ static std::string replace_characters(const std::string &name,
 
 namespace OpsFusion {
 
+static bool is_run_in_progress(const xrt::run &run) {
+  const auto state = run.state();
+  return state == ERT_CMD_STATE_NEW || state == ERT_CMD_STATE_QUEUED ||
+         state == ERT_CMD_STATE_SUBMITTED || state == ERT_CMD_STATE_RUNNING;
+}
+
 // Depad & Copy data from src to dst buffer.
 // So src is larger than
 static void copy_data(const Tensor &src_tensor, const Tensor &dst_tensor) {
@@ -119,7 +184,7 @@ template <typename T> static int sum_bo_int(xrt::bo &src) {
 
 FusionRuntime::FusionRuntime(const std::string &xclbin,
                              const std::string &kernel_name_prefix)
-    : ctx_(ryzenai::dynamic_dispatch::xrt_context::get_instance(xclbin)
+    : ctx_(ryzenai::dynamic_dispatch::xrt_context::lease(xclbin)
                ->get_context()) {
   std::vector<std::string> kernel_names;
 
@@ -157,14 +222,17 @@ FusionRuntime::FusionRuntime(const std::string &xclbin,
   std::lock_guard<std::mutex> guard(instr_state_mutex);
 
   if (xrt_instr_state.find(handle) == xrt_instr_state.end()) {
+    static_instr_account.reserve(
+        std::to_string(reinterpret_cast<std::uintptr_t>(handle)),
+        num_static_instr_buffers * INSTR_BUFFER_SIZE, num_static_instr_buffers);
     xrt_instr_state[handle] = XRTBufferState{};
-    for (size_t i = 0; i < NUM_STATIC_INSTR_BUFFERS; i++) {
+    for (size_t i = 0; i < num_static_instr_buffers; i++) {
       xrt_instr_state.at(handle).static_instr_bos.emplace_back(
           xrt::bo(ctx_, INSTR_BUFFER_SIZE, xrt::bo::flags::cacheable,
                   kernels_[0].group_id(1)));
       xrt_instr_state.at(handle).static_instr_sizes.push_back(0);
     }
-    xrt_instr_state.at(handle).num_instr_bos = 2;
+    xrt_instr_state.at(handle).num_instr_bos = num_static_instr_buffers;
   }
 }
 
@@ -207,18 +275,23 @@ FusionRuntime::FusionRuntime(xrt::hw_context *ctx,
   std::lock_guard<std::mutex> guard(instr_state_mutex);
 
   if (xrt_instr_state.find(handle) == xrt_instr_state.end()) {
+    static_instr_account.reserve(
+        std::to_string(reinterpret_cast<std::uintptr_t>(handle)),
+        num_static_instr_buffers * INSTR_BUFFER_SIZE, num_static_instr_buffers);
     xrt_instr_state[handle] = XRTBufferState{};
-    for (size_t i = 0; i < NUM_STATIC_INSTR_BUFFERS; i++) {
+    for (size_t i = 0; i < num_static_instr_buffers; i++) {
       xrt_instr_state.at(handle).static_instr_bos.emplace_back(
           xrt::bo(ctx_, INSTR_BUFFER_SIZE, xrt::bo::flags::cacheable,
                   kernels_[0].group_id(1)));
       xrt_instr_state.at(handle).static_instr_sizes.push_back(0);
     }
-    xrt_instr_state.at(handle).num_instr_bos = 2;
+    xrt_instr_state.at(handle).num_instr_bos = num_static_instr_buffers;
   }
 }
 
 FusionRuntime::~FusionRuntime() {
+  stop_async_worker();
+
   xrt_core::hwctx_handle *handle = static_cast<xrt_core::hwctx_handle *>(ctx_);
 
   // make book-keeping here thread safe
@@ -226,6 +299,9 @@ FusionRuntime::~FusionRuntime() {
   // use static instruction BO or not
   std::lock_guard<std::mutex> guard(instr_state_mutex);
   for (auto &instr_bo : instr_bos_) {
+    if (!instr_bo) {
+      continue; // host partition
+    }
     xrt_instr_state.at(handle).heap_total_size -=
         Utils::align_to_next(instr_bo.size(), INSTR_XRT_BO_ALIGNMENT);
   }
@@ -241,183 +317,842 @@ void FusionRuntime::execute(const std::vector<Tensor> &inputs,
   //  - For multiple partitions, which would need to be
   //    run together
   std::lock_guard<std::mutex> guard(execute_mutex_);
+  const auto exec_start = get_time_ns();
   const auto &meta = meta_;
   merge_inputs(inputs, meta);
 
   if (enable_write_internal_bufs) {
     unpack_internal_buffers("tmp/dd_bufs_pre_exec");
   }
+
+  run_partitions(meta, input_bo_, output_bo_);
+
+  if (enable_write_internal_bufs) {
+    unpack_internal_buffers("tmp/dd_bufs_post_exec");
+  }
+
+  split_outputs(outputs, meta);
+
+  auto hists = std::atomic_load(&latency_hists_);
+  hists->execute.record(get_time_ns() - exec_start);
+  hists->input_copy.record(input_copy_time_);
+  hists->input_sync.record(input_sync_time_);
+  hists->output_sync.record(output_sync_time_);
+  hists->output_copy.record(output_copy_time_);
+  EventTracer::get_instance().record(get_trace_names().execute, exec_start,
+                                     get_time_ns());
+
+  if (capture_pending_) {
+    capture_pending_ = false;
+    write_capture(inputs, outputs);
+  }
+}
+
+void FusionRuntime::throw_partition_error(size_t i, uint8_t pdi_id,
+                                          const std::exception &e) {
+#ifdef RYZENAI_DEBUG
+  std::cout << "Running under debug mode...  Hardware context handle = "
+            << ctx_.get_handle() << ", PID = " << _DD_GET_PID() << std::endl;
+  std::cout << "Will wait for user input." << std::endl;
+  std::cin.get();
+#endif
+
+  std::cerr << "ERROR: Kernel partition: " << i
+            << ", pdi_id: " << (std::uint32_t)pdi_id << " timed out!"
+            << std::endl;
+  std::cerr << "Details: " << e.what() << std::endl;
+
+  xrt::error err = xrt::error(ctx_.get_device(), XRT_ERROR_CLASS_AIE);
+  if (err.get_error_code()) {
+    std::string err_message = std::string("Error while executing pdi_id: ") +
+                              std::to_string((std::uint32_t)pdi_id) +
+                              ", partition: " + std::to_string(i) +
+                              ", info: " + err.to_string();
+    std::cerr << err_message << std::endl;
+    RYZENAI_LOG_TRACE(err_message);
+  }
+
+  DOD_THROW(OpsFusion::dod_format(
+      "Kernel partition: {} pdi_id: {} timeout (Detail : {})", i,
+      (std::uint32_t)pdi_id, e.what()));
+}
+
+// Eager mode : every partition has its own run object, so partitions are
+// queued ahead of the one being waited on. Runs on a hw context execute in
+// submission order, so the NPU goes from one op to the next without a host
+// round trip in between. At most eager_pipeline_depth runs are in flight.
+// A host partition waits for the runs before it.
+// Caller should hold execute_mutex_.
+void FusionRuntime::run_partitions_pipelined(const Metadata &meta,
+                                             xrt::bo &input_bo,
+                                             xrt::bo &output_bo) {
+  auto hists = std::atomic_load(&latency_hists_);
+  auto &tracer = EventTracer::get_instance();
+  const size_t num_partitions = meta.partitions.size();
+  const size_t depth = cfg_.eager_pipeline_depth;
+  std::vector<int64_t> start_times(num_partitions);
+  // started partitions, in submission order
+  std::deque<size_t> in_flight;
+  int64_t prev_end = 0;
+
+  auto drain_ignoring_errors = [&]() {
+    for (auto j : in_flight) {
+      try {
+        partition_runs_[j].wait2();
+      } catch (...) {
+      }
+    }
+    in_flight.clear();
+  };
+
+  auto wait_next = [&]() {
+    const size_t i = in_flight.front();
+    in_flight.pop_front();
+    try {
+      partition_runs_[i].wait2();
+    } catch (const std::exception &e) {
+      // let the queued runs drain before reporting
+      drain_ignoring_errors();
+      throw_partition_error(i, meta.partitions[i].pdi_id, e);
+    }
+    auto exec_end = get_time_ns();
+    // time on the NPU, the run only started after the previous one ended
+    auto exec_start = std::max(start_times[i], prev_end);
+    int64_t partition_exec_time = exec_end - exec_start;
+    xrt_exec_time_ += partition_exec_time;
+    hists->partitions.at(i)->record(partition_exec_time);
+    tracer.record(get_trace_names().partition, exec_start, exec_end,
+                  static_cast<uint32_t>(i));
+    prev_end = exec_end;
+  };
+
+  auto start_next = [&](size_t i) {
+    auto &run = partition_runs_[i];
+    try {
+      run.set_arg(3, input_bo.address() + DDR_AIE_ADDR_OFFSET);
+      run.set_arg(4, output_bo.address() + DDR_AIE_ADDR_OFFSET);
+      start_times[i] = get_time_ns();
+      run.start();
+      in_flight.push_back(i);
+    } catch (const std::exception &e) {
+      while (!in_flight.empty()) {
+        wait_next();
+      }
+      throw_partition_error(i, meta.partitions[i].pdi_id, e);
+    }
+  };
+
+  for (size_t i = 0; i < num_partitions; i++) {
+    if (is_host_partition(meta.partitions[i])) {
+      while (!in_flight.empty()) {
+        wait_next();
+      }
+      const bool overlap = host_partitions_.at(i).overlap_next;
+      if (overlap) {
+        start_next(i + 1);
+      }
+      try {
+        run_host_partition(i, input_bo, output_bo);
+      } catch (...) {
+        drain_ignoring_errors();
+        throw;
+      }
+      if (overlap) {
+        i++;
+      }
+      continue;
+    }
+    if (in_flight.size() >= depth) {
+      wait_next();
+    }
+    start_next(i);
+  }
+  while (!in_flight.empty()) {
+    wait_next();
+  }
+  hists->xrt_exec.record(xrt_exec_time_);
+}
+
+// Runs the ops of host partition i on the CPU. The tensors of the ops are
+// synced one by one, from the device before and to the device after the op.
+// Caller should hold execute_mutex_.
+void FusionRuntime::run_host_partition(size_t i, xrt::bo &input_bo,
+                                       xrt::bo &output_bo) {
+  auto hists = std::atomic_load(&latency_hists_);
+  auto get_bo = [&](const std::string &parent_name) -> xrt::bo & {
+    if (parent_name == "in") {
+      return input_bo;
+    }
+    if (parent_name == "out") {
+      return output_bo;
+    }
+    return scratch_bo_;
+  };
+
+  auto exec_start = get_time_ns();
+  for (auto &host_op : host_partitions_.at(i).ops) {
+    for (size_t j = 0; j < host_op.input_bufs.size(); j++) {
+      const auto &buf = host_op.input_bufs[j];
+      auto &bo = get_bo(buf.parent_name);
+      bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, buf.size, buf.offset);
+      host_op.inputs[j].data = bo.map<char *>() + buf.offset;
+    }
+    for (size_t j = 0; j < host_op.output_bufs.size(); j++) {
+      const auto &buf = host_op.output_bufs[j];
+      host_op.outputs[j].data =
+          get_bo(buf.parent_name).map<char *>() + buf.offset;
+    }
+    try {
+      host_op.op->execute(host_op.inputs, host_op.outputs);
+    } catch (const std::exception &e) {
+      DOD_THROW(OpsFusion::dod_format(
+          "Host op {} of partition {} failed (Detail : {})", host_op.name, i,
+          e.what()));
+    }
+    for (const auto &buf : host_op.output_bufs) {
+      get_bo(buf.parent_name)
+          .sync(XCL_BO_SYNC_BO_TO_DEVICE, buf.size, buf.offset);
+    }
+  }
+  auto exec_end = get_time_ns();
+  hists->partitions.at(i)->record(exec_end - exec_start);
+  EventTracer::get_instance().record(get_trace_names().partition, exec_start,
+                                     exec_end, static_cast<uint32_t>(i));
+}
+
+// Runs all the PDI partitions with the given input/output BOs.
+// Caller should hold execute_mutex_.
+void FusionRuntime::run_partitions(const Metadata &meta, xrt::bo &input_bo,
+                                   xrt::bo &output_bo) {
   xrt_exec_time_ = 0;
+  auto hists = std::atomic_load(&latency_hists_);
+  auto &tracer = EventTracer::get_instance();
 
   xrt_core::hwctx_handle *handle = static_cast<xrt_core::hwctx_handle *>(ctx_);
-  size_t cache_instr_idx = 0;
 
   if (use_instr_sw_cache_) {
     // NOTE: this writes to BO and does sync
     std::lock_guard<std::mutex> guard(instr_state_mutex);
-    write_to_bo(xrt_instr_state.at(handle).static_instr_bos[cache_instr_idx],
-                0, /*offset*/
-                fused_instr_vec_.at(0).data(), fused_instr_vec_.at(0).size());
-    xrt_instr_state.at(handle).static_instr_sizes[cache_instr_idx] =
-        fused_instr_vec_.at(0).size();
+    auto &instr_state = xrt_instr_state.at(handle);
+    const size_t num_slots = instr_state.static_instr_bos.size();
+    const size_t num_partitions = meta.partitions.size();
+    const size_t num_pages = instr_pages_.size();
+
+    // Page p uses ring slot p % num_slots & its slot run.
+    // Pages [0, num_uploaded) have been written to the ring, pages
+    // [num_done, num_started) are queued on the NPU. A slot is reused once
+    // the page in it is done.
+    size_t num_uploaded = 0;
+    size_t num_started = 0;
+    size_t num_done = 0;
+    auto page_run = [&](size_t p) -> xrt::run & {
+      auto pdi_id = meta.partitions[instr_pages_[p].partition].pdi_id;
+      return slot_runs_.at(pdi_id).at(p % num_slots);
+    };
+    auto can_upload = [&]() {
+      return num_uploaded < num_pages && num_uploaded < num_done + num_slots;
+    };
+    auto upload_next = [&]() {
+      const size_t slot = num_uploaded % num_slots;
+      const auto &page = instr_pages_.at(num_uploaded);
+      const auto &instr =
+          page.instr.empty() ? fused_instr_vec_.at(page.partition) : page.instr;
+      auto upload_start = get_time_ns();
+      write_to_bo(instr_state.static_instr_bos[slot], 0, /*offset*/
+                  instr.data(), instr.size());
+      instr_state.static_instr_sizes[slot] = instr.size();
+      auto upload_end = get_time_ns();
+      instr_prefetch_stats_.upload_time_ns += upload_end - upload_start;
+      tracer.record(get_trace_names().instr_upload, upload_start, upload_end,
+                    static_cast<uint32_t>(page.partition));
+      instr_prefetch_stats_.num_uploads++;
+      num_uploaded++;
+    };
+    auto drain_ignoring_errors = [&]() {
+      for (; num_done < num_started; num_done++) {
+        try {
+          page_run(num_done).wait2();
+        } catch (...) {
+        }
+      }
+    };
+    if (can_upload()) {
+      upload_next();
+    }
 
-    for (size_t i = 0; i < meta.partitions.size(); i++) {
+    for (size_t i = 0; i < num_partitions; i++) {
+      if (is_host_partition(meta.partitions[i])) {
+        if (can_upload()) {
+          upload_next();
+        }
+        run_host_partition(i, input_bo, output_bo);
+        continue;
+      }
       auto pdi_id = meta.partitions[i].pdi_id;
-      auto exec_start = GET_ELAPSED_TIME_NS();
-      size_t instr_idx = cache_instr_idx;
-      cache_instr_idx = (cache_instr_idx + 1) % NUM_STATIC_INSTR_BUFFERS;
-      bool prefetch_instr = (i != (meta.partitions.size() - 1));
+      auto exec_start = get_time_ns();
       try {
-        runs_[pdi_id].set_arg(
-            1, xrt_instr_state.at(handle).static_instr_bos[instr_idx]);
-        runs_[pdi_id].set_arg(
-            2, xrt_instr_state.at(handle).static_instr_sizes[instr_idx] /
-                   sizeof(int));
-        runs_[pdi_id].start();
-        // try to overlap instruction copying with AIE execution
-        if (prefetch_instr) {
-          write_to_bo(
-              xrt_instr_state.at(handle).static_instr_bos[cache_instr_idx],
-              0, /*offset*/
-              fused_instr_vec_.at(i + 1).data(),
-              fused_instr_vec_.at(i + 1).size());
-          xrt_instr_state.at(handle).static_instr_sizes[cache_instr_idx] =
-              fused_instr_vec_.at(i + 1).size();
+        // queue the pages of the partition back to back, a page is uploaded
+        // while the pages before it run
+        while (num_started < num_pages &&
+               instr_pages_[num_started].partition == i) {
+          if (num_uploaded == num_started) {
+            if (!can_upload()) {
+              page_run(num_done).wait2();
+              num_done++;
+            }
+            upload_next();
+            if (num_started > 0 &&
+                instr_pages_[num_started - 1].partition == i &&
+                !is_run_in_progress(page_run(num_started - 1))) {
+              // previous pages of the partition ran out before this one
+              instr_prefetch_stats_.num_page_stalls++;
+            }
+          }
+          const size_t slot = num_started % num_slots;
+          auto &run = page_run(num_started);
+          run.set_arg(3, input_bo.address() + DDR_AIE_ADDR_OFFSET);
+          run.set_arg(4, output_bo.address() + DDR_AIE_ADDR_OFFSET);
+          run.set_arg(1, instr_state.static_instr_bos[slot]);
+          run.set_arg(2, instr_state.static_instr_sizes[slot] / sizeof(int));
+          run.start();
+          num_started++;
         }
-        runs_[pdi_id].wait2();
-      } catch (const std::exception &e) {
-
-#ifdef RYZENAI_DEBUG
-        std::cout << "Running under debug mode...  Hardware context handle = "
-                  << ctx_.get_handle() << ", PID = " << _DD_GET_PID()
-                  << std::endl;
-        std::cout << "Will wait for user input." << std::endl;
-        std::cin.get();
-#endif
-
-        std::cerr << "ERROR: Kernel partition: " << i
-                  << ", pdi_id: " << (std::uint32_t)pdi_id << " timed out!"
-                  << std::endl;
-        std::cerr << "Details: " << e.what() << std::endl;
-
-        xrt::error err = xrt::error(ctx_.get_device(), XRT_ERROR_CLASS_AIE);
-        if (err.get_error_code()) {
-          std::string err_message =
-              std::string("Error while executing pdi_id: ") +
-              std::to_string((std::uint32_t)pdi_id) +
-              ", partition: " + std::to_string(i) +
-              ", info: " + err.to_string();
-          std::cerr << err_message << std::endl;
-          RYZENAI_LOG_TRACE(err_message);
+        // try to overlap instruction copying with AIE execution.
+        // Next page is always uploaded. Later ones are uploaded while this
+        // partition is still running, until the ring is full. The slots of
+        // the queued pages are not touched.
+        auto &last_run = page_run(num_started - 1);
+        if (num_uploaded == num_started && can_upload()) {
+          upload_next();
+          if (!is_run_in_progress(last_run)) {
+            // NPU went idle before the next partition was ready
+            instr_prefetch_stats_.num_stalls++;
+          }
         }
-
-        DOD_THROW(OpsFusion::dod_format(
-            "Kernel partition: {} pdi_id: {} timeout (Detail : {})", i,
-            (std::uint32_t)pdi_id, e.what()));
+        while (can_upload() && is_run_in_progress(last_run)) {
+          upload_next();
+        }
+        for (; num_done < num_started; num_done++) {
+          page_run(num_done).wait2();
+        }
+      } catch (const std::exception &e) {
+        drain_ignoring_errors();
+        throw_partition_error(i, pdi_id, e);
       }
-      auto exec_end = GET_ELAPSED_TIME_NS();
+      auto exec_end = get_time_ns();
       int64_t partition_exec_time = exec_end - exec_start;
       xrt_exec_time_ += partition_exec_time;
-      RYZENAI_LOG_INFO("PDI_Partition " + std::to_string(i) + " , " +
-                       std::to_string(partition_exec_time) + ", " +
-                       std::to_string(0) + ", " + std::to_string(0) + ", " +
-                       std::to_string(0) + ", " + std::to_string(0) + ", " +
-                       meta.json_path + "\n");
+      hists->partitions.at(i)->record(partition_exec_time);
+      tracer.record(get_trace_names().partition, exec_start, exec_end,
+                    static_cast<uint32_t>(i));
     }
+  } else if (!partition_runs_.empty()) {
+    run_partitions_pipelined(meta, input_bo, output_bo);
+    return;
   } else {
+    auto start_partition = [&](size_t i) {
+      auto pdi_id = meta.partitions[i].pdi_id;
+      runs_[pdi_id].set_arg(3, input_bo.address() + DDR_AIE_ADDR_OFFSET);
+      runs_[pdi_id].set_arg(4, output_bo.address() + DDR_AIE_ADDR_OFFSET);
+      runs_[pdi_id].set_arg(1, instr_bos_[i]);
+      runs_[pdi_id].set_arg(2, instr_bos_[i].size() / sizeof(int));
+      runs_[pdi_id].start();
+    };
+    auto record_partition = [&](size_t i, int64_t exec_start) {
+      auto exec_end = get_time_ns();
+      int64_t partition_exec_time = exec_end - exec_start;
+      xrt_exec_time_ += partition_exec_time;
+      hists->partitions.at(i)->record(partition_exec_time);
+      tracer.record(get_trace_names().partition, exec_start, exec_end,
+                    static_cast<uint32_t>(i));
+    };
+
     for (size_t i = 0; i < meta.partitions.size(); i++) {
+      if (is_host_partition(meta.partitions[i])) {
+        if (!host_partitions_.at(i).overlap_next) {
+          run_host_partition(i, input_bo, output_bo);
+          continue;
+        }
+        // the next partition runs on the NPU along with the host ops
+        const size_t next = i + 1;
+        auto pdi_id = meta.partitions[next].pdi_id;
+        auto exec_start = get_time_ns();
+        try {
+          start_partition(next);
+        } catch (const std::exception &e) {
+          throw_partition_error(next, pdi_id, e);
+        }
+        try {
+          run_host_partition(i, input_bo, output_bo);
+        } catch (...) {
+          try {
+            runs_[pdi_id].wait2();
+          } catch (...) {
+          }
+          throw;
+        }
+        try {
+          runs_[pdi_id].wait2();
+        } catch (const std::exception &e) {
+          throw_partition_error(next, pdi_id, e);
+        }
+        record_partition(next, exec_start);
+        i = next;
+        continue;
+      }
       auto pdi_id = meta.partitions[i].pdi_id;
-      auto exec_start = GET_ELAPSED_TIME_NS();
-      size_t instr_idx = i;
+      auto exec_start = get_time_ns();
       try {
-
-        runs_[pdi_id].set_arg(1, instr_bos_[instr_idx]);
-        runs_[pdi_id].set_arg(2, instr_bos_[instr_idx].size() / sizeof(int));
-
-        runs_[pdi_id].start();
+        start_partition(i);
         runs_[pdi_id].wait2();
       } catch (const std::exception &e) {
+        throw_partition_error(i, pdi_id, e);
+      }
+      record_partition(i, exec_start);
+    }
+  }
+  hists->xrt_exec.record(xrt_exec_time_);
+}
 
-#ifdef RYZENAI_DEBUG
-        std::cout << "Running under debug mode...  Hardware context handle = "
-                  << ctx_.get_handle() << ", PID = " << _DD_GET_PID()
-                  << std::endl;
-        std::cout << "Will wait for user input." << std::endl;
-        std::cin.get();
-#endif
+FusionRuntime::RequestHandle
+FusionRuntime::submit(const std::vector<Tensor> &inputs,
+                      const std::vector<Tensor> &outputs) {
+  size_t slot_idx = 0;
+  RequestHandle req_handle = 0;
+  {
+    std::unique_lock<std::mutex> lock(async_mutex_);
+    if (async_slots_.empty()) {
+      allocate_async_slots();
+    }
+    if (!async_worker_.joinable()) {
+      stop_async_worker_ = false;
+      async_worker_ = std::thread(&FusionRuntime::async_worker_loop, this);
+    }
 
-        std::cerr << "ERROR: Kernel partition: " << i
-                  << ", pdi_id: " << (std::uint32_t)pdi_id << " timed out!"
-                  << std::endl;
-        std::cerr << "Details: " << e.what() << std::endl;
-
-        xrt::error err = xrt::error(ctx_.get_device(), XRT_ERROR_CLASS_AIE);
-        if (err.get_error_code()) {
-          std::string err_message =
-              std::string("Error while executing pdi_id: ") +
-              std::to_string((std::uint32_t)pdi_id) +
-              ", partition: " + std::to_string(i) +
-              ", info: " + err.to_string();
-          std::cerr << err_message << std::endl;
-          RYZENAI_LOG_TRACE(err_message);
-        }
+    req_handle = next_handle_++;
+    slot_idx = req_handle % async_slots_.size();
+    auto &slot = async_slots_[slot_idx];
+    async_cv_.wait(lock, [&slot, req_handle]() {
+      return slot.state == AsyncSlot::State::FREE && slot.turn == req_handle;
+    });
+    slot.state = AsyncSlot::State::FILLING;
+    slot.outputs = outputs;
+    slot.error = nullptr;
+  }
 
-        DOD_THROW(OpsFusion::dod_format(
-            "Kernel partition: {} pdi_id: {} timeout (Detail : {})", i,
-            (std::uint32_t)pdi_id, e.what()));
-      }
-      auto exec_end = GET_ELAPSED_TIME_NS();
-      int64_t partition_exec_time = exec_end - exec_start;
-      xrt_exec_time_ += partition_exec_time;
-      RYZENAI_LOG_INFO("PDI_Partition " + std::to_string(i) + " , " +
-                       std::to_string(partition_exec_time) + ", " +
-                       std::to_string(0) + ", " + std::to_string(0) + ", " +
-                       std::to_string(0) + ", " + std::to_string(0) + ", " +
-                       meta.json_path + "\n");
+  auto &slot = async_slots_[slot_idx];
+  try {
+    DOD_ASSERT(outputs.size() == MetaUtils::get_num_outputs(meta_),
+               OpsFusion::dod_format(
+                   "Number of outputs ({}) doesn't match with number of "
+                   "metadata outputs ({})",
+                   outputs.size(), MetaUtils::get_num_outputs(meta_)));
+    // Copy inputs without holding execute_mutex_, so that it overlaps with
+    // execution of previously submitted requests.
+    write_inputs(inputs, meta_, slot.input_bo);
+    slot.input_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(async_mutex_);
+    slot.outputs.clear();
+    slot.state = AsyncSlot::State::FREE;
+    slot.turn += async_slots_.size();
+    async_cv_.notify_all();
+    throw;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(async_mutex_);
+    slot.state = AsyncSlot::State::QUEUED;
+    async_queue_.push_back(slot_idx);
+  }
+  async_cv_.notify_all();
+
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "FusionRuntime : submitted request {} to slot {}", req_handle, slot_idx));
+  return req_handle;
+}
+
+void FusionRuntime::wait(RequestHandle req_handle) {
+  std::unique_lock<std::mutex> lock(async_mutex_);
+  DOD_ASSERT(!async_slots_.empty(),
+             OpsFusion::dod_format("No request submitted to FusionRuntime"));
+  auto &slot = async_slots_[req_handle % async_slots_.size()];
+  DOD_ASSERT(slot.turn == req_handle && slot.state != AsyncSlot::State::FREE,
+             OpsFusion::dod_format(
+                 "Request {} is not in flight (already waited on?)",
+                 req_handle));
+  async_cv_.wait(lock,
+                 [&slot]() { return slot.state == AsyncSlot::State::DONE; });
+  lock.unlock();
+
+  // Slot is owned by this request until it is marked FREE,
+  // so copying outputs doesn't need the lock.
+  std::exception_ptr error = slot.error;
+  if (!error) {
+    try {
+      slot.output_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+      read_outputs(slot.outputs, meta_, slot.output_bo);
+    } catch (...) {
+      error = std::current_exception();
     }
   }
 
-  if (enable_write_internal_bufs) {
-    unpack_internal_buffers("tmp/dd_bufs_post_exec");
+  lock.lock();
+  slot.outputs.clear();
+  slot.error = nullptr;
+  slot.state = AsyncSlot::State::FREE;
+  slot.turn += async_slots_.size();
+  lock.unlock();
+  async_cv_.notify_all();
+
+  if (error) {
+    std::rethrow_exception(error);
   }
+}
 
-  split_outputs(outputs, meta);
+// Caller should hold async_mutex_
+void FusionRuntime::allocate_async_slots() {
+  DOD_ASSERT(cfg_.num_async_slots > 0,
+             OpsFusion::dod_format("DDConfig::num_async_slots should be > 0"));
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "FusionRuntime : Allocating {} async slots", cfg_.num_async_slots));
+
+  // input_bo_ could be modified by execute() in parallel
+  std::lock_guard<std::mutex> guard(execute_mutex_);
+  mem_account_.reserve("async_slots",
+                       cfg_.num_async_slots * (input_bo_sz_ + output_bo_sz_),
+                       2 * cfg_.num_async_slots);
+  async_slots_ = std::vector<AsyncSlot>(cfg_.num_async_slots);
+  for (size_t i = 0; i < async_slots_.size(); i++) {
+    auto &slot = async_slots_[i];
+    // first handle which maps to this slot
+    slot.turn = next_handle_ + (i + async_slots_.size() -
+                                next_handle_ % async_slots_.size()) %
+                                   async_slots_.size();
+    slot.input_bo = xrt::bo(ctx_, input_bo_sz_, xrt::bo::flags::host_only,
+                            kernels_[0].group_id(HOST_BO_GROUP_ID));
+    slot.output_bo = xrt::bo(ctx_, output_bo_sz_, xrt::bo::flags::host_only,
+                             kernels_[0].group_id(HOST_BO_GROUP_ID));
+    // input BO might have some data filled by initialize_inputs()
+    memcpy(slot.input_bo.map(), input_bo_.map(), input_bo_sz_);
+    slot.input_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    memset(slot.output_bo.map(), XRT_BO_INIT_VALUE, output_bo_sz_);
+    slot.output_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  }
+}
+
+void FusionRuntime::async_worker_loop() {
+  while (true) {
+    size_t slot_idx = 0;
+    {
+      std::unique_lock<std::mutex> lock(async_mutex_);
+      async_cv_.wait(lock, [this]() {
+        return stop_async_worker_ || !async_queue_.empty();
+      });
+      if (async_queue_.empty()) {
+        return;
+      }
+      slot_idx = async_queue_.front();
+      async_queue_.pop_front();
+    }
+
+    auto &slot = async_slots_[slot_idx];
+    try {
+      std::lock_guard<std::mutex> guard(execute_mutex_);
+      run_partitions(meta_, slot.input_bo, slot.output_bo);
+    } catch (...) {
+      slot.error = std::current_exception();
+    }
 
-  RYZENAI_LOG_INFO("Graph, " + std::to_string(xrt_exec_time_) + ", " +
-                   std::to_string(input_copy_time_) + ", " +
-                   std::to_string(input_sync_time_) + ", " +
-                   std::to_string(output_copy_time_) + ", " +
-                   std::to_string(output_sync_time_) + ", " + meta.json_path +
-                   "\n");
+    {
+      std::lock_guard<std::mutex> lock(async_mutex_);
+      slot.state = AsyncSlot::State::DONE;
+    }
+    async_cv_.notify_all();
+  }
+}
+
+void FusionRuntime::stop_async_worker() {
+  {
+    std::lock_guard<std::mutex> lock(async_mutex_);
+    stop_async_worker_ = true;
+  }
+  async_cv_.notify_all();
+  if (async_worker_.joinable()) {
+    async_worker_.join();
+  }
 }
 
 void FusionRuntime::init(const Metadata &meta, const std::string &base_dir,
                          const DDConfig &cfg) {
   // TODO : Need a way to compare if metadata is same as old, and if so skip.
   RYZENAI_LOG_TRACE("FusionRuntime : Init ...");
+  const auto init_start = get_time_ns();
+  // the passes and init phases below share the op instances. OpCacheScope is
+  // per thread, so the steps using ops run on this thread.
+  OpCacheScope op_cache;
+  reset_state(meta, cfg);
+
+  OpInterface::set_dod_base_dir(base_dir);
+
+  Metadata mdata = meta;
+
+  std::unique_ptr<CompiledCache> cache;
+  CompiledModel cached_model;
+  const CompiledModel *model = nullptr;
+  std::set<std::string> const_file_names;
+
+  Utils::TaskGraph graph;
+  auto load_cache = graph.add(
+      "load_cache",
+      [&]() {
+        cache = open_compiled_cache(meta, base_dir);
+        if (cache && cache->load(cached_model)) {
+          RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+              "FusionRuntime : Using compiled model from {}",
+              cache->get_path()));
+          meta_ = std::move(cached_model.meta);
+          fused_instr_vec_ = std::move(cached_model.fused_instrs);
+          txns_ = std::move(cached_model.txns);
+          model = &cached_model;
+          return;
+        }
+        for (const auto &[name, tinfo] : meta_.tensor_map) {
+          if (tinfo.parent_name == "const" && !tinfo.file_name.empty()) {
+            const_file_names.insert(tinfo.file_name);
+          }
+        }
+      },
+      {}, true);
+  // The const files are mapped & read ahead while the passes run. A file
+  // which can't be mapped is skipped, e.g. the const of an op removed by the
+  // passes, load_const() reports the ones still used.
+  auto map_consts = graph.add(
+      "map_consts",
+      [&]() {
+        for (const auto &file_name : const_file_names) {
+          try {
+            get_const_file(file_name);
+          } catch (...) {
+          }
+        }
+      },
+      {load_cache});
+  auto passes = graph.add(
+      "passes",
+      [&]() {
+        if (!model) {
+          run_passes();
+        }
+      },
+      {load_cache}, true);
+  auto bos_done = add_init_bos_tasks(graph, model, {passes}, {map_consts});
+  graph.add(
+      "save_cache",
+      [&]() {
+        if (cache && !model) {
+          save_compiled_model(meta_, *cache);
+        }
+      },
+      bos_done);
+
+  startup_start_ns_ = init_start;
+  startup_timeline_ = graph.run();
+
+  reset_latency_histograms(meta_);
+  capture_pending_ =
+      !Utils::get_env_var("DD_CAPTURE_DIR", cfg_.capture_dir).empty();
+
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format("FusionRuntime : Startup\n{}",
+                                          get_startup_report()));
+  RYZENAI_LOG_TRACE("FusionRuntime : Init ... DONE");
+}
+
+void FusionRuntime::reset_state(const Metadata &meta, const DDConfig &cfg) {
+  {
+    std::lock_guard<std::mutex> lock(async_mutex_);
+    bool in_flight = std::any_of(
+        async_slots_.begin(), async_slots_.end(), [](const AsyncSlot &slot) {
+          return slot.state != AsyncSlot::State::FREE;
+        });
+    DOD_ASSERT(!in_flight, OpsFusion::dod_format(
+                               "FusionRuntime::init() called while requests "
+                               "submitted with submit() are in flight"));
+    // BO sizes could change, slots are reallocated on next submit()
+    async_slots_.clear();
+    mem_account_.release("async_slots");
+  }
   meta_ = meta;
   cfg_ = cfg;
+  instr_prefetch_stats_ = {};
+  pass_steps_.clear();
+  const_overrides_.clear();
+  if (shared_const_bo_) {
+    // shared const BO is read-only, get a new one for this model
+    shared_const_bo_.reset();
+    const_bo_sz_ = 0;
+  }
+  if (shared_super_instr_bo_) {
+    shared_super_instr_bo_.reset();
+    super_instr_bo_sz_ = 0;
+  }
 
   // if env variables are set, update cfg_
   // check if profile option is enabled using env varaibles
   auto profile_level = Utils::get_env_var("DD_ENABLE_PROFILE");
   if (profile_level != "") {
     auto p_lvl = std::stoi(profile_level);
-    cfg_.profile = std::min(3, p_lvl);
+    cfg_.profile = std::min(4, p_lvl);
   }
 
   RYZENAI_LOG_TRACE(dod_format("Setting profile level to {}", cfg_.profile));
 
-  OpInterface::set_dod_base_dir(base_dir);
+  if (!cfg_.qos.empty()) {
+    RYZENAI_LOG_TRACE(
+        dod_format("Setting QoS of the hw context, {} keys", cfg_.qos.size()));
+    ctx_.update_qos(cfg_.qos);
+  }
+}
 
-  Metadata mdata = meta;
+void FusionRuntime::init_bos(const CompiledModel *model) {
+  Utils::TaskGraph graph;
+  add_init_bos_tasks(graph, model, {}, {});
+  startup_start_ns_ = get_time_ns();
+  startup_timeline_ = graph.run();
+}
 
+// The BO allocation & the writes of the instr BOs, which don't use the ops,
+// run on the workers of graph. The rest, including the partition split
+// which generates transactions, runs on the thread calling graph.run().
+std::vector<Utils::TaskGraph::TaskId> FusionRuntime::add_init_bos_tasks(
+    Utils::TaskGraph &graph, const CompiledModel *const &model,
+    const std::vector<Utils::TaskGraph::TaskId> &deps,
+    const std::vector<Utils::TaskGraph::TaskId> &const_deps) {
+  auto instr_bos = graph.add(
+      "instr_bos",
+      [this]() {
+        // this block determines if we should either use "heap" or "stack"
+        // for instruction BO since this a global state, add lock guard e.g.
+        // trying to read map but another thread does an insertion which
+        // cause reallocation
+        std::lock_guard<std::mutex> guard(instr_state_mutex);
+        bool repartition_instr =
+            check_context_instr_size(fused_instr_vec_, instr_xrt_bo_heap_size);
+
+        bool need_realloc = false;
+
+        do {
+          repartition_instr = repartition_instr || need_realloc;
+
+          use_instr_sw_cache_ = repartition_instr;
+          // with paging, partitions stay whole, see generate_instr_pages()
+          repartition_instr = repartition_instr && !cfg_.page_instrs;
+
+          while (repartition_instr) {
+            // this is to ensure current set of txn binaries fit into
+            // the static instr BO's
+            bool split = split_max_partition_pass(meta_, fused_instr_vec_,
+                                                  INSTR_BUFFER_SIZE);
+            DOD_THROW_IF(!split, OpsFusion::dod_format(
+                                     "Instruction partition failed!"));
+            fused_instr_vec_ = generate_fused_txns(meta_);
+            repartition_instr = check_partition_instr_size(fused_instr_vec_,
+                                                           INSTR_BUFFER_SIZE);
+          }
+
+          need_realloc = allocate_instr_bos(fused_instr_vec_);
+        } while (need_realloc);
+
+        instr_pages_.clear();
+        if (use_instr_sw_cache_) {
+          generate_instr_pages(meta_, INSTR_BUFFER_SIZE);
+        }
+      },
+      deps, true);
+
+  // this is no-op if using static instr BO - hence no guard
+  auto populate_instr = graph.add(
+      "populate_instr_bos", [this]() { populate_instr_bos(fused_instr_vec_); },
+      {instr_bos});
+
+  auto data_bos = graph.add(
+      "data_bos",
+      [this]() {
+        if (user_io_bufs_) {
+          // User buffers are sized for the old metadata, so drop them.
+          input_bo_sz_ = 0;
+          output_bo_sz_ = 0;
+          user_io_bufs_ = false;
+        }
+        if (linked_inputs_) {
+          // input_bo_ is memory of the producer
+          input_bo_sz_ = 0;
+          linked_inputs_ = false;
+        }
+        if (shared_data_bos_) {
+          // BOs of the owner, see share_data_bos()
+          input_bo_sz_ = 0;
+          output_bo_sz_ = 0;
+          scratch_bo_sz_ = 0;
+          shared_data_bos_ = false;
+        }
+        linked_outputs_.clear();
+        reallocate_data_bos(meta_);
+      },
+      {instr_bos});
+
+  auto inputs = graph.add(
+      "init_inputs", [this]() { initialize_inputs(meta_); }, {data_bos}, true);
+
+  auto consts_deps = const_deps;
+  consts_deps.push_back(data_bos);
+  auto consts = graph.add(
+      "consts",
+      [this, &model]() {
+        if (model) {
+          load_compiled_images(meta_, *model);
+        } else {
+          load_const(meta_);
+        }
+      },
+      consts_deps, true);
+
+  auto super_instr = graph.add(
+      "super_instr",
+      [this, &model]() {
+        if (!model) {
+          // compiled models have the super instr BO image, see consts
+          fill_super_instr(meta_);
+        }
+      },
+      {data_bos}, true);
+
+  auto xrt_runs = graph.add(
+      "xrt_runs",
+      [this]() {
+        const_files_.clear();
+        if (cfg_.share_const_bo) {
+          share_const_bo();
+        }
+        setup_xrt_run(meta_);
+      },
+      {populate_instr, inputs, consts, super_instr});
+
+  auto host_ops = graph.add(
+      "host_ops", [this]() { setup_host_ops(meta_); }, {instr_bos}, true);
+
+  return {xrt_runs, host_ops};
+}
+
+void FusionRuntime::run_passes() {
   // partition ops to PDIs
   OpPDIMap op_pdi_map = {{{{"Add", 0},
                            {"DQAdd", 0},
                            {"LayerNorm", 0},
                            {"QLayerNorm", 0},
+                           {"QAddLayerNorm", 0},
                            {"QGroupNorm", 0},
+                           {"QGroupNormSilu", 0},
                            {"MatMul", 0},
                            {"QMatMul", 0},
                            {"MatMulAdd", 0},
@@ -435,8 +1170,10 @@ void FusionRuntime::init(const Metadata &meta, const std::string &base_dir,
                            {"ELWMUL", 0},
                            {"MLADFADD", 0},
                            {"MLADFRMSNORM", 0},
+                           {"MLADFADDRMSNORM", 0},
                            {"MASKEDSOFTMAX", 0},
                            {"MLADFMHAROPE", 0},
+                           {"MLADFATTENTION", 0},
                            {"QConv", 1},
                            {"QConcateOPs", 0},
                            {"IConv", 0},
@@ -446,6 +1183,9 @@ void FusionRuntime::init(const Metadata &meta, const std::string &base_dir,
                            {"QMHA", 0},
                            {"QGlobalAvgPool", 1},
                            {"xcom-conv2d", 0},
+                           {"xcom-conv2d-relu", 0},
+                           {"xcom-conv2d-leakyrelu", 0},
+                           {"xcom-dwc-pw-conv2d", 0},
                            {"QConv2MatMul", 0},
                            {"QMatMulDynamic", 0},
                            {"QMulSoftmax", 0},
@@ -459,71 +1199,151 @@ void FusionRuntime::init(const Metadata &meta, const std::string &base_dir,
                            {"Mladfsoftmax", 0},
                            {"MLADFMATMULA16A16", 0},
                            {"MLADFMATMULA16W8", 0},
+                           {"MLADFMATMULA16W4", 0},
                            {"QLstm", 0},
                            {"Mladfelwadd", 0},
                            {"Mladfelwmul", 0}}},
                          {{{0, "DPU"}, {1, "DPU_1"}}}};
 
+  auto record_pass = [this](const std::string &pass) {
+    MemoryReport::PassStep step{pass, meta_.op_list.size(), {}};
+    for (const auto &[name, fused] : meta_.fused_tensors) {
+      step.buffer_sizes[name] = fused.size;
+    }
+    pass_steps_.push_back(std::move(step));
+  };
+  record_pass("initial");
+
   assign_pdi_id_pass(op_pdi_map, meta_);
 
+  if (cfg_.batch_size > 1) {
+    batch_graph_pass(meta_, cfg_.batch_size);
+    record_pass("batch_graph");
+  }
+
+  if (cfg_.fuse_op_patterns) {
+    fuse_op_patterns_pass(meta_);
+    record_pass("fuse_op_patterns");
+  }
+
+  if (cfg_.fold_qdq_pairs) {
+    fold_qdq_pairs_pass(meta_);
+    record_pass("fold_qdq_pairs");
+  }
+
+  if (cfg_.eliminate_dead_ops) {
+    eliminate_dead_ops_pass(meta_);
+    record_pass("eliminate_dead_ops");
+  }
+
+  if (cfg_.fold_view_ops) {
+    fold_view_ops_pass(meta_);
+    record_pass("fold_view_ops");
+  }
+
+  if (cfg_.reorder_ops) {
+    reorder_ops_pass(meta_, cfg_.pdi_switch_cost_us,
+                     cfg_.pm_swap ? cfg_.pm_swap_cost_us : 0);
+  }
+
   if (cfg_.pm_swap) {
     meta_ = insert_pm_swap_nodes(meta_);
+    record_pass("pm_swap");
   }
 
   generate_pdi_partitions_pass(meta_, cfg_.eager_mode);
   if (cfg_.profile) {
     meta_ = insert_record_timer_nodes(meta_, cfg_.profile);
     generate_pdi_partitions_pass(meta_, cfg_.eager_mode);
+    record_pass("record_timer");
   }
 
   analyze_buffer_reqs(meta_);
+  record_pass("analyze_buffer_reqs");
 
   if (cfg_.optimize_scratch) {
     optimize_scratch_buffer(meta_);
+    record_pass("optimize_scratch");
   }
 
   fused_instr_vec_ = generate_fused_txns(meta_);
-  {
-    // this block determines if we should either use "heap" or "stack" for
-    // instruction BO since this a global state, add lock guard e.g. trying to
-    // read map but another thread does an insertion which cause reallocation
-    std::lock_guard<std::mutex> guard(instr_state_mutex);
-    bool repartition_instr =
-        check_context_instr_size(fused_instr_vec_, INSTR_XRT_BO_HEAP_SIZE);
-
-    bool need_realloc = false;
-
-    do {
-      repartition_instr = repartition_instr || need_realloc;
-
-      use_instr_sw_cache_ = repartition_instr;
-
-      while (repartition_instr) {
-        // this is to ensure current set of txn binaries fit into
-        // the static instr BO's
-        bool split = split_max_partition_pass(meta_, fused_instr_vec_,
-                                              INSTR_BUFFER_SIZE);
-        DOD_THROW_IF(!split,
-                     OpsFusion::dod_format("Instruction partition failed!"));
-        fused_instr_vec_ = generate_fused_txns(meta_);
-        repartition_instr =
-            check_partition_instr_size(fused_instr_vec_, INSTR_BUFFER_SIZE);
-      }
+}
 
-      need_realloc = allocate_instr_bos(fused_instr_vec_);
-    } while (need_realloc);
+std::unique_ptr<CompiledCache>
+FusionRuntime::open_compiled_cache(const Metadata &meta,
+                                   const std::string &base_dir) {
+  const auto cache_dir = Utils::get_env_var("DD_CACHE_DIR", cfg_.cache_dir);
+  if (cache_dir.empty()) {
+    return nullptr;
+  }
+  if (cfg_.profile) {
+    // timer ops are numbered globally, artifacts can't be reused
+    RYZENAI_LOG_TRACE("FusionRuntime : Compiled cache disabled by profiling");
+    return nullptr;
   }
-  // this is no-op if using static instr BO - hence no guard
-  populate_instr_bos(fused_instr_vec_);
 
-  const auto &new_meta = meta_;
-  reallocate_data_bos(new_meta);
-  initialize_inputs(new_meta);
-  load_const(new_meta);
-  fill_super_instr(new_meta);
-  setup_xrt_run(new_meta);
+  std::vector<std::string> kernel_names;
+  for (const auto &kernel : kernels_) {
+    kernel_names.push_back(kernel.get_name());
+  }
+  const json key_info = {{"xclbin", ctx_.get_xclbin().get_uuid().to_string()},
+                         {"kernels", kernel_names},
+                         {"base_dir", base_dir},
+                         {"pm_swap", cfg_.pm_swap},
+                         {"optimize_scratch", cfg_.optimize_scratch},
+                         {"eager_mode", cfg_.eager_mode},
+                         {"reorder_ops", cfg_.reorder_ops},
+                         {"fold_view_ops", cfg_.fold_view_ops},
+                         {"fuse_op_patterns", cfg_.fuse_op_patterns},
+                         {"fold_qdq_pairs", cfg_.fold_qdq_pairs},
+                         {"eliminate_dead_ops", cfg_.eliminate_dead_ops},
+                         {"optimize_txns", cfg_.optimize_txns},
+                         {"page_instrs", cfg_.page_instrs},
+                         {"batch_size", cfg_.batch_size},
+                         {"pdi_switch_cost_us", cfg_.pdi_switch_cost_us},
+                         {"pm_swap_cost_us", cfg_.pm_swap_cost_us}};
+  try {
+    return std::make_unique<CompiledCache>(
+        cache_dir, CompiledCache::get_key(meta, key_info.dump()));
+  } catch (std::exception &e) {
+    RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+        "FusionRuntime : Compiled cache disabled : {}", e.what()));
+    return nullptr;
+  }
+}
 
-  RYZENAI_LOG_TRACE("FusionRuntime : Init ... DONE");
+void FusionRuntime::load_compiled_images(const Metadata &meta,
+                                         const CompiledModel &model) {
+  RYZENAI_LOG_TRACE("FusionRuntime : Load compiled BO images ...");
+  const size_t const_size = MAP_AT(meta.fused_tensors, "const").size;
+  const size_t super_instr_size =
+      MAP_AT(meta.fused_tensors, "super_instr").size;
+  DOD_ASSERT(model.const_image_size == const_size &&
+                 model.super_instr_image_size == super_instr_size,
+             OpsFusion::dod_format(
+                 "Compiled BO image sizes ({}, {}) don't match with metadata "
+                 "({}, {})",
+                 model.const_image_size, model.super_instr_image_size,
+                 const_size, super_instr_size));
+
+  memcpy(const_bo_.map(), model.const_image, const_size);
+  const_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  memcpy(super_instr_bo_.map(), model.super_instr_image, super_instr_size);
+  super_instr_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  RYZENAI_LOG_TRACE("FusionRuntime : Load compiled BO images ... DONE");
+}
+
+void FusionRuntime::save_compiled_model(const Metadata &meta,
+                                        const CompiledCache &cache) {
+  CompiledModel model;
+  model.meta = meta;
+  model.fused_instrs = fused_instr_vec_;
+  model.txns = txns_;
+  model.const_image = const_bo_.map<const uint8_t *>();
+  model.const_image_size = MAP_AT(meta.fused_tensors, "const").size;
+  model.super_instr_image = super_instr_bo_.map<const uint8_t *>();
+  model.super_instr_image_size = MAP_AT(meta.fused_tensors, "super_instr").size;
+  cache.save(model);
 }
 
 // For every Op, collect all the const data it has.
@@ -533,84 +1353,344 @@ void FusionRuntime::load_const(const Metadata &meta) {
   RYZENAI_LOG_TRACE("FusionRuntime : Load const ...");
   void *const_bo_ptr = const_bo_.map();
 
-  for (const auto &op_info : meta.op_list) {
-    // get all const buffers' name
-    std::vector<std::string> tensor_names;
-    for (const auto &buf_name : op_info.args) {
-      const auto &tensor_info = MAP_AT(meta.tensor_map, buf_name);
-      if (tensor_info.parent_name != "const") {
+  // Each op initializes its own span of the const BO, so the ops can be
+  // initialized in parallel once they all have one. They are created
+  // serially, as their constructors may share state.
+  const bool disjoint_spans =
+      std::all_of(meta.op_list.begin(), meta.op_list.end(),
+                  [&](const auto &op_info) {
+                    return meta.const_map.count(op_info.name) != 0;
+                  });
+  if (!disjoint_spans) {
+    for (const auto &op_info : meta.op_list) {
+      load_op_const(meta, op_info, const_bo_ptr);
+    }
+  } else {
+    // spans shared by several ops (see "const_key") are loaded once
+    std::set<size_t> loaded_offsets;
+    std::vector<const Metadata::OpInfo *> op_infos;
+    std::vector<std::shared_ptr<OpInterface>> ops;
+    ops.reserve(meta.op_list.size());
+    for (const auto &op_info : meta.op_list) {
+      const auto &span = MAP_AT(meta.const_map, op_info.name);
+      if (span.size > 0 && !loaded_offsets.insert(span.offset).second) {
         continue;
       }
-      tensor_names.push_back(buf_name);
-    }
-
-    // Load the const data from disk
-    std::vector<vector<char>> const_data;
-    std::vector<Tensor> const_tensors;
-    // Read const inputs from files only if tensor_names is not empty.
-    // initialize_const_params() is called regardless for each op later.
-    // This enabled operators to copy LUTs / other data to AIE. This is required
-    // for operators like bf16 Silu/Gelu when ONNX op does not have a constant
-    // input.
-    if (!tensor_names.empty()) {
-      for (const auto &name : tensor_names) {
-        const auto &tensor_info = meta.tensor_map.at(name);
-        std::vector<char> data = read_bin_file(tensor_info.file_name);
-        const_data.push_back(std::move(data));
-        const_tensors.push_back(
-            {const_data.back().data(), tensor_info.shape, tensor_info.dtype});
-      }
+      op_infos.push_back(&op_info);
+      ops.push_back(OpBuilder::get_or_create(op_info, meta.tensor_map));
     }
+    Utils::parallel_for(ops.size(), [&](size_t i) {
+      load_op_const(meta, *op_infos.at(i), ops.at(i).get(), const_bo_ptr);
+    });
+  }
+
+  const_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  RYZENAI_LOG_TRACE("FusionRuntime : Load const ... DONE");
+}
+
+void FusionRuntime::load_op_const(const Metadata &meta,
+                                  const Metadata::OpInfo &op_info,
+                                  void *const_bo_ptr) {
+  auto op = OpBuilder::get_or_create(op_info, meta.tensor_map);
+  load_op_const(meta, op_info, op.get(), const_bo_ptr);
+}
 
-    // Get the offset of this op's const buffer in const bo.
-    size_t offset = 0;
-    // if const_map is empty, call all initilize_const_params for constant
-    // initilization, if any.
-    if (meta.const_map.find(op_info.name) != meta.const_map.end()) {
-      const auto &tensor_info = meta.const_map.at(op_info.name);
-      offset = tensor_info.offset;
+void FusionRuntime::load_op_const(const Metadata &meta,
+                                  const Metadata::OpInfo &op_info,
+                                  OpInterface *op, void *const_bo_ptr) {
+  // Load the const data from disk, or from update_consts()
+  // Read const inputs only if op has any.
+  // initialize_const_params() is called regardless for each op later.
+  // This enabled operators to copy LUTs / other data to AIE. This is required
+  // for operators like bf16 Silu/Gelu when ONNX op does not have a constant
+  // input.
+  auto const_buf_ptrs = get_op_const_buffers(meta, op_info);
+
+  std::vector<Tensor> const_tensors;
+  for (const auto &buf_name : op_info.args) {
+    auto iter = const_buf_ptrs.find(buf_name);
+    if (iter == const_buf_ptrs.end()) {
+      continue;
     }
+    const auto &tensor_info = MAP_AT(meta.tensor_map, buf_name);
+    const_tensors.push_back(
+        {iter->second, tensor_info.shape, tensor_info.dtype});
+  }
 
-    auto op = OpBuilder::create(op_info.name, op_info, meta.tensor_map);
-    using signature = void(void *, const std::vector<Tensor> &,
-                           const std::map<std::string, std::any> &);
-    DD_INVOKE_OVERLOADED_OPMETHOD(initialize_const_params, signature, op.get(),
-                                  op_info, (char *)const_bo_ptr + offset,
-                                  const_tensors, op_info.attr);
+  // Get the offset of this op's const buffer in const bo.
+  size_t offset = 0;
+  // if const_map is empty, call all initilize_const_params for constant
+  // initilization, if any.
+  if (meta.const_map.find(op_info.name) != meta.const_map.end()) {
+    const auto &tensor_info = meta.const_map.at(op_info.name);
+    offset = tensor_info.offset;
   }
 
-  const_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  RYZENAI_LOG_TRACE("FusionRuntime : Load const ... DONE");
+  using signature = void(void *, const std::vector<Tensor> &,
+                         const std::map<std::string, std::any> &);
+  DD_INVOKE_OVERLOADED_OPMETHOD(initialize_const_params, signature, op,
+                                op_info, (char *)const_bo_ptr + offset,
+                                const_tensors, op_info.attr);
 }
 
 void FusionRuntime::fill_super_instr(const Metadata &meta) {
   RYZENAI_LOG_TRACE("FusionRuntime : Fill Super Instrns ... ");
   void *super_bo_ptr = super_instr_bo_.map();
+  // spans shared by several ops are filled once
+  std::set<size_t> filled_offsets;
   for (const auto &op_info : meta.op_list) {
-    auto op = OpBuilder::create(op_info.name, op_info, meta.tensor_map);
-    auto offset = MAP_AT(meta.super_instr_map, op_info.name).offset;
-    auto const_buffers = MetaUtils::load_op_const_buffers(meta, op_info);
-    std::map<std::string, void *> const_buf_ptrs;
-    for (auto &[name, buffer] : const_buffers) {
-      const_buf_ptrs[name] = buffer.data();
-    }
-    std::vector<Tensor> tensors =
-        MetaUtils::collect_op_tensors(meta, op_info, const_buf_ptrs);
-
-    auto super_instr =
-        DD_INVOKE_OPMETHOD(get_super_kernel_params, op.get(), op_info, tensors,
-                           tensors, op_info.attr);
-    RYZENAI_LOG_TRACE(
-        OpsFusion::dod_format("Copying super instr to bo : offset:{}, size:{}",
-                              offset, super_instr.size()));
-    memcpy((char *)super_bo_ptr + offset, super_instr.data(),
-           super_instr.size());
-
-    super_instr_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    const auto &span = MAP_AT(meta.super_instr_map, op_info.name);
+    if (span.size > 0 && !filled_offsets.insert(span.offset).second) {
+      continue;
+    }
+    fill_op_super_instr(meta, op_info, super_bo_ptr);
   }
+  super_instr_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
   RYZENAI_LOG_TRACE("FusionRuntime : Fill Super Instrns ... DONE");
 }
 
+void FusionRuntime::fill_op_super_instr(const Metadata &meta,
+                                        const Metadata::OpInfo &op_info,
+                                        void *super_bo_ptr) {
+  auto op = OpBuilder::get_or_create(op_info, meta.tensor_map);
+  auto offset = MAP_AT(meta.super_instr_map, op_info.name).offset;
+  auto const_buf_ptrs = get_op_const_buffers(meta, op_info);
+  std::vector<Tensor> tensors =
+      MetaUtils::collect_op_tensors(meta, op_info, const_buf_ptrs);
+
+  auto super_instr =
+      DD_INVOKE_OPMETHOD(get_super_kernel_params, op.get(), op_info, tensors,
+                         tensors, op_info.attr);
+  RYZENAI_LOG_TRACE(
+      OpsFusion::dod_format("Copying super instr to bo : offset:{}, size:{}",
+                            offset, super_instr.size()));
+  memcpy((char *)super_bo_ptr + offset, super_instr.data(),
+         super_instr.size());
+}
+
+// Maps of the const files are kept until the const loading is done, the
+// ops only read their const inputs.
+const Utils::MappedFile &
+FusionRuntime::get_const_file(const std::string &file_name) {
+  std::lock_guard<std::mutex> guard(const_files_mutex_);
+  auto &file = const_files_[file_name];
+  if (!file) {
+    file = std::make_unique<Utils::MappedFile>(file_name);
+    file->prefetch();
+  }
+  return *file;
+}
+
+// Const buffers of an op. Tensors updated by update_consts() are taken from
+// const_overrides_, rest are mapped from the const files.
+std::map<std::string, void *>
+FusionRuntime::get_op_const_buffers(const Metadata &meta,
+                                    const Metadata::OpInfo &op_info) {
+  std::map<std::string, void *> const_buf_ptrs;
+  for (const auto &tensor_name : op_info.args) {
+    const auto &tinfo = MAP_AT(meta.tensor_map, tensor_name);
+    if (tinfo.parent_name != "const") {
+      continue;
+    }
+
+    auto iter = const_overrides_.find(tensor_name);
+    if (iter != const_overrides_.end()) {
+      const_buf_ptrs[tensor_name] = iter->second.data();
+      continue;
+    }
+
+    DOD_ASSERT(!tinfo.file_name.empty(),
+               dod_format("Tensor:{} is mapped to constant, but no "
+                          "associated filename provided",
+                          tensor_name));
+    const auto &const_file = get_const_file(tinfo.file_name);
+    // a per tensor file holds exactly the tensor, an archive more
+    const size_t available = const_file.size() >= tinfo.file_offset
+                                 ? const_file.size() - tinfo.file_offset
+                                 : 0;
+    DOD_ASSERT(tinfo.file_offset == 0 ? available == tinfo.file_size
+                                      : available >= tinfo.file_size,
+               dod_format("Const tensor size doesn't match.\n  Tensor: "
+                          "{}\n  Size in JSON: {}\n  Size of file: {}",
+                          tensor_name, tinfo.file_size, available));
+    const_buf_ptrs[tensor_name] = const_file.data() + tinfo.file_offset;
+  }
+  return const_buf_ptrs;
+}
+
+// BO of the pool with the contents of bo, or bo itself once added to the
+// pool. found is set if another BO was found.
+static std::shared_ptr<xrt::bo> get_pooled_bo(xrt_core::hwctx_handle *handle,
+                                              xrt::bo &bo, bool &found) {
+  const size_t bo_size = bo.size();
+  const void *bo_ptr = bo.map();
+  const size_t hash = compute_hash(bo_ptr, bo_size);
+
+  std::lock_guard<std::mutex> guard(const_bo_pool_mutex);
+  auto &pool = const_bo_pool[handle];
+  auto range = pool.equal_range(hash);
+  for (auto iter = range.first; iter != range.second;) {
+    auto shared_bo = iter->second.lock();
+    if (!shared_bo) {
+      iter = pool.erase(iter);
+      continue;
+    }
+    if (shared_bo->size() == bo_size &&
+        memcmp(shared_bo->map(), bo_ptr, bo_size) == 0) {
+      RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+          "FusionRuntime : Sharing bo of size {}, users : {}", bo_size,
+          shared_bo.use_count()));
+      found = true;
+      return shared_bo;
+    }
+    ++iter;
+  }
+
+  auto shared_bo = std::make_shared<xrt::bo>(bo);
+  pool.emplace(hash, shared_bo);
+  found = false;
+  return shared_bo;
+}
+
+void FusionRuntime::share_const_bo() {
+  xrt_core::hwctx_handle *handle = static_cast<xrt_core::hwctx_handle *>(ctx_);
+  // private BOs are freed here, the shared ones are accounted to the
+  // runtime which created them
+  bool found = false;
+  shared_const_bo_ = get_pooled_bo(handle, const_bo_, found);
+  if (found) {
+    const_bo_ = *shared_const_bo_;
+    mem_account_.release("const_bo");
+  }
+  shared_super_instr_bo_ = get_pooled_bo(handle, super_instr_bo_, found);
+  if (found) {
+    super_instr_bo_ = *shared_super_instr_bo_;
+    mem_account_.release("super_instr_bo");
+  }
+}
+
+// Copy of bo in a new BO of this runtime.
+xrt::bo FusionRuntime::copy_bo(xrt::bo &bo, size_t size,
+                               const std::string &account_slot) {
+  mem_account_.reserve(account_slot, size);
+  xrt::bo private_bo(ctx_, size, xrt::bo::flags::host_only,
+                     kernels_[0].group_id(HOST_BO_GROUP_ID));
+  memcpy(private_bo.map(), bo.map(), size);
+  private_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  return private_bo;
+}
+
+// Switch to private copies of the shared const/super instr BOs, before
+// modifying them.
+void FusionRuntime::unshare_const_bo() {
+  if (shared_const_bo_) {
+    const_bo_ = copy_bo(const_bo_, const_bo_sz_, "const_bo");
+    shared_const_bo_.reset();
+  }
+  if (shared_super_instr_bo_) {
+    super_instr_bo_ =
+        copy_bo(super_instr_bo_, super_instr_bo_sz_, "super_instr_bo");
+    shared_super_instr_bo_.reset();
+  }
+}
+
+bool FusionRuntime::share_data_bos(FusionRuntime &owner) {
+  DOD_ASSERT(&owner != this,
+             OpsFusion::dod_format("A runtime can't share its own BOs"));
+  std::scoped_lock guard(execute_mutex_, owner.execute_mutex_);
+  // consumers linked to the outputs read the old output BO
+  bool outputs_linked = std::any_of(linked_outputs_.begin(),
+                                    linked_outputs_.end(),
+                                    [](bool linked) { return linked; });
+  if (user_io_bufs_ || linked_inputs_ || outputs_linked ||
+      ctx_.get_handle() != owner.ctx_.get_handle() ||
+      owner.input_bo_.size() < input_bo_sz_ ||
+      owner.output_bo_.size() < output_bo_sz_ ||
+      owner.scratch_bo_.size() < scratch_bo_sz_) {
+    return false;
+  }
+
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "FusionRuntime : Sharing data bos of sizes in:{}, out:{}, scratch:{}",
+      owner.input_bo_.size(), owner.output_bo_.size(),
+      owner.scratch_bo_.size()));
+  input_bo_ = owner.input_bo_;
+  output_bo_ = owner.output_bo_;
+  scratch_bo_ = owner.scratch_bo_;
+  mem_account_.release("input_bo");
+  mem_account_.release("output_bo");
+  mem_account_.release("scratch_bo");
+  shared_data_bos_ = true;
+  setup_xrt_run(meta_);
+  return true;
+}
+
+void FusionRuntime::update_consts(
+    const std::map<std::string, Tensor> &const_tensors) {
+  RYZENAI_LOG_TRACE("FusionRuntime : Update consts ...");
+  std::lock_guard<std::mutex> guard(execute_mutex_);
+  OpCacheScope op_cache;
+  const auto &meta = meta_;
+
+  for (const auto &[name, tensor] : const_tensors) {
+    const auto &tinfo = MAP_AT(meta.tensor_map, name);
+    DOD_ASSERT(tinfo.parent_name == "const",
+               OpsFusion::dod_format("Tensor {} is not a const", name));
+    DOD_ASSERT(tensor.shape == tinfo.shape && tensor.dtype == tinfo.dtype,
+               OpsFusion::dod_format(
+                   "Shape/dtype of new data for const {} doesn't match with "
+                   "the metadata",
+                   name));
+  }
+
+  if (shared_const_bo_ || shared_super_instr_bo_) {
+    unshare_const_bo();
+    setup_xrt_run(meta);
+  }
+
+  for (const auto &[name, tensor] : const_tensors) {
+    size_t sz = std::accumulate(tensor.shape.begin(), tensor.shape.end(),
+                                size_t{1}, std::multiplies{}) *
+                Utils::get_size_of_type(tensor.dtype);
+    const char *src = static_cast<const char *>(tensor.data);
+    const_overrides_[name] = std::vector<char>(src, src + sz);
+  }
+
+  // Partitions, transactions and buffer layout stay as they are, only
+  // the const and super instr spans of the affected ops are rewritten.
+  void *const_bo_ptr = const_bo_.map();
+  void *super_bo_ptr = super_instr_bo_.map();
+  size_t num_updated_ops = 0;
+  for (const auto &op_info : meta.op_list) {
+    bool affected = std::any_of(
+        op_info.args.begin(), op_info.args.end(),
+        [&](const auto &arg) { return const_tensors.count(arg) != 0; });
+    if (!affected) {
+      continue;
+    }
+
+    load_op_const(meta, op_info, const_bo_ptr);
+    fill_op_super_instr(meta, op_info, super_bo_ptr);
+
+    auto const_iter = meta.const_map.find(op_info.name);
+    if (const_iter != meta.const_map.end() && const_iter->second.size != 0) {
+      const_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE, const_iter->second.size,
+                     const_iter->second.offset);
+    }
+    const auto &super_span = MAP_AT(meta.super_instr_map, op_info.name);
+    if (super_span.size != 0) {
+      super_instr_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE, super_span.size,
+                           super_span.offset);
+    }
+    num_updated_ops++;
+  }
+  const_files_.clear();
+
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "FusionRuntime : Update consts ... DONE, updated {} ops",
+      num_updated_ops));
+}
+
 void FusionRuntime::setup_xrt_run(const Metadata &meta) {
   // IMPORTANT: this should only be called after instruction
   //            and data BO's have been allocated
@@ -629,9 +1709,164 @@ void FusionRuntime::setup_xrt_run(const Metadata &meta) {
     run.set_arg(7, super_instr_bo_.address() + DDR_AIE_ADDR_OFFSET);
   }
 
+  slot_runs_.clear();
+  if (use_instr_sw_cache_) {
+    // The instr BO & size of a slot run are set when its page is started
+    for (const auto &kernel : kernels_) {
+      auto &runs = slot_runs_.emplace_back();
+      for (size_t slot = 0; slot < num_static_instr_buffers; slot++) {
+        xrt::run run(kernel);
+        run.set_arg(0, OPCODE);
+        run.set_arg(5, scratch_bo_.address() + DDR_AIE_ADDR_OFFSET);
+        run.set_arg(6, const_bo_.address() + DDR_AIE_ADDR_OFFSET);
+        run.set_arg(7, super_instr_bo_.address() + DDR_AIE_ADDR_OFFSET);
+        runs.push_back(std::move(run));
+      }
+    }
+  }
+
+  partition_runs_.clear();
+  if (cfg_.eager_mode && cfg_.eager_pipeline_depth > 1 &&
+      !use_instr_sw_cache_) {
+    // The instr BO of each partition is fixed, so a run per partition
+    // only needs its input/output BOs updated on every execute
+    for (size_t i = 0; i < meta.partitions.size(); i++) {
+      if (is_host_partition(meta.partitions[i])) {
+        partition_runs_.emplace_back();
+        continue;
+      }
+      xrt::run run(kernels_.at(meta.partitions[i].pdi_id));
+      run.set_arg(0, OPCODE);
+      run.set_arg(1, instr_bos_[i]);
+      run.set_arg(2, instr_bos_[i].size() / sizeof(int));
+      run.set_arg(3, input_bo_.address() + DDR_AIE_ADDR_OFFSET);
+      run.set_arg(4, output_bo_.address() + DDR_AIE_ADDR_OFFSET);
+      run.set_arg(5, scratch_bo_.address() + DDR_AIE_ADDR_OFFSET);
+      run.set_arg(6, const_bo_.address() + DDR_AIE_ADDR_OFFSET);
+      run.set_arg(7, super_instr_bo_.address() + DDR_AIE_ADDR_OFFSET);
+      partition_runs_.push_back(std::move(run));
+    }
+  }
+
   RYZENAI_LOG_TRACE("FusionRuntime : Setup XRT Run objects ... DONE");
 }
 
+// Bytes of a BO, rounded out to whole cache lines: a sync of one range also
+// writes back or drops the rest of its first and last lines
+struct BufRange {
+  std::string parent_name;
+  size_t begin;
+  size_t end;
+};
+
+static constexpr size_t HOST_CACHE_LINE_SIZE = 64;
+
+static BufRange get_buf_range(const std::string &parent_name, size_t offset,
+                              size_t size) {
+  auto begin = offset / HOST_CACHE_LINE_SIZE * HOST_CACHE_LINE_SIZE;
+  auto end = Utils::align_to_next(offset + size, HOST_CACHE_LINE_SIZE);
+  return {parent_name, begin, end};
+}
+
+static bool overlaps(const std::vector<BufRange> &a,
+                     const std::vector<BufRange> &b) {
+  for (const auto &x : a) {
+    for (const auto &y : b) {
+      if (x.parent_name == y.parent_name && x.begin < y.end &&
+          y.begin < x.end) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Memory accessed by the ops of an NPU partition in the in/out/scratch BOs,
+// with the padding the ops may read before their tensors and the internal
+// scratch pad at the end of the scratch BO
+static std::vector<BufRange> get_partition_ranges(const Metadata &meta,
+                                                  const Partition &partition) {
+  std::vector<BufRange> ranges;
+  for (auto i = partition.op_range.first; i < partition.op_range.second; i++) {
+    const auto &op_info = meta.op_list.at(i);
+    for (const auto &arg : op_info.args) {
+      const auto &tinfo = MAP_AT(meta.tensor_map, arg);
+      if (tinfo.parent_name == "const") {
+        continue;
+      }
+      auto padding = std::min(tinfo.offset, meta.max_tensor_padding_sz);
+      ranges.push_back(get_buf_range(tinfo.parent_name,
+                                     tinfo.offset - padding,
+                                     tinfo.size_in_bytes + padding));
+    }
+    if (meta.scratch_op_set.count(op_info.name)) {
+      ranges.push_back(get_buf_range("scratch",
+                                     MAP_AT(meta.fused_tensors, "scratch").size,
+                                     meta.max_op_scratch_pad_size));
+    }
+  }
+  return ranges;
+}
+
+void FusionRuntime::setup_host_ops(const Metadata &meta) {
+  host_partitions_.clear();
+  host_partitions_.resize(meta.partitions.size());
+
+  for (size_t i = 0; i < meta.partitions.size(); i++) {
+    const auto &partition = meta.partitions[i];
+    if (!is_host_partition(partition)) {
+      continue;
+    }
+    auto &host_partition = host_partitions_[i];
+    std::vector<BufRange> host_ranges;
+    for (auto op_id = partition.op_range.first;
+         op_id < partition.op_range.second; op_id++) {
+      const auto &op_info = meta.op_list.at(op_id);
+      HostOp host_op;
+      host_op.name = op_info.name;
+      host_op.op = OpBuilder::create(op_info.name, op_info, meta.tensor_map);
+      auto tensors = MetaUtils::collect_op_tensors(meta, op_info);
+      auto buf_reqs = DD_INVOKE_OPMETHOD(get_buffer_reqs, host_op.op.get(),
+                                         op_info, tensors, tensors,
+                                         op_info.attr);
+      for (const auto &req : buf_reqs) {
+        const auto &tensor_name = ARRAY_AT(op_info.args, req.onnx_arg_idx);
+        const auto &tinfo = MAP_AT(meta.tensor_map, tensor_name);
+        DOD_ASSERT(tinfo.parent_name == "in" || tinfo.parent_name == "out" ||
+                       tinfo.parent_name == "scratch",
+                   OpsFusion::dod_format(
+                       "Host op {} arg {} is in the {} buffer, host ops only "
+                       "access the in/out/scratch buffers",
+                       op_info.name, tensor_name, tinfo.parent_name));
+        HostTensor buf{tinfo.parent_name, tinfo.offset, tinfo.size_in_bytes};
+        host_ranges.push_back(
+            get_buf_range(buf.parent_name, buf.offset, buf.size));
+        if (req.arg_type == OpArgMap::OpArgType::INPUT) {
+          host_op.input_bufs.push_back(buf);
+          host_op.inputs.push_back(ARRAY_AT(tensors, req.onnx_arg_idx));
+        } else if (req.arg_type == OpArgMap::OpArgType::OUTPUT) {
+          host_op.output_bufs.push_back(buf);
+          host_op.outputs.push_back(ARRAY_AT(tensors, req.onnx_arg_idx));
+        } else {
+          DOD_THROW(OpsFusion::dod_format(
+              "Host op {} can only have input and output args", op_info.name));
+        }
+      }
+      host_partition.ops.push_back(std::move(host_op));
+    }
+
+    const size_t next = i + 1;
+    host_partition.overlap_next =
+        next < meta.partitions.size() &&
+        !is_host_partition(meta.partitions[next]) &&
+        !overlaps(host_ranges,
+                  get_partition_ranges(meta, meta.partitions[next]));
+    RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+        "FusionRuntime : host partition {}, {} ops, overlap next : {}", i,
+        host_partition.ops.size(), host_partition.overlap_next));
+  }
+}
+
 std::vector<std::vector<uint8_t>>
 FusionRuntime::generate_fused_txns(const Metadata &meta) {
 
@@ -644,7 +1879,17 @@ FusionRuntime::generate_fused_txns(const Metadata &meta) {
   size_t partition_index = 0;
 
   for (const auto &partition : meta.partitions) {
+    if (is_host_partition(partition)) {
+      // run by run_host_partition(), no instructions
+      txns_.emplace_back();
+      fused_txns.emplace_back();
+      partition_index += 1;
+      continue;
+    }
     std::vector<uint8_t> txn_vec = generate_fused_ops(meta, partition.op_range);
+    if (cfg_.optimize_txns) {
+      txn_vec = ryzenai::optimize_txn(txn_vec);
+    }
     txns_.push_back(std::move(txn_vec));
     utils::txn_util txn = utils::txn_util(txns_.back());
     aiectrl::op_buf instr_buf;
@@ -706,6 +1951,51 @@ bool FusionRuntime::check_partition_instr_size(
   return repartition;
 }
 
+// Splits the NPU partitions in the pages of instructions run from the static
+// instr BOs. A partition whose instructions fit in page_limit is one page,
+// the fused transaction of the others is split on op boundaries, see
+// txn_util::split_txn(). Unlike split_max_partition_pass(), the partitions of
+// meta are unchanged : the pages of a partition are queued on the NPU back
+// to back and timed as one.
+void FusionRuntime::generate_instr_pages(const Metadata &meta,
+                                         size_t page_limit) {
+  for (size_t i = 0; i < meta.partitions.size(); i++) {
+    if (is_host_partition(meta.partitions.at(i))) {
+      continue;
+    }
+    const auto &instr = fused_instr_vec_.at(i);
+    if (instr.size() <= page_limit) {
+      instr_pages_.push_back({i, {}});
+      continue;
+    }
+    // instructions wrapping a transaction are the transaction & a header
+    const auto &txn = txns_.at(i);
+    DOD_ASSERT(instr.size() > txn.size(),
+               OpsFusion::dod_format(
+                   "Instructions of partition {} smaller than its "
+                   "transaction",
+                   i));
+    const size_t instr_hdr_size = instr.size() - txn.size();
+    DOD_ASSERT(page_limit > instr_hdr_size,
+               OpsFusion::dod_format("Instruction page of {} B too small",
+                                     page_limit));
+    auto page_txns =
+        utils::txn_util::split_txn(txn, page_limit - instr_hdr_size);
+    for (auto &page_txn : page_txns) {
+      aiectrl::op_buf instr_buf;
+      instr_buf.addOP(aiectrl::transaction_op(page_txn.data()));
+      DOD_ASSERT(instr_buf.ibuf_.size() <= page_limit,
+                 OpsFusion::dod_format(
+                     "Instruction page of partition {} is {} B, over {} B", i,
+                     instr_buf.ibuf_.size(), page_limit));
+      instr_pages_.push_back({i, std::move(instr_buf.ibuf_)});
+    }
+    RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+        "FusionRuntime : partition {}, {} B of instructions in {} pages", i,
+        instr.size(), page_txns.size()));
+  }
+}
+
 bool FusionRuntime::allocate_instr_bos(
     const std::vector<std::vector<uint8_t>> &fused_instr_vec) {
 
@@ -714,12 +2004,16 @@ bool FusionRuntime::allocate_instr_bos(
   xrt_core::hwctx_handle *handle = static_cast<xrt_core::hwctx_handle *>(ctx_);
 
   for (auto &instr_bo : instr_bos_) {
+    if (!instr_bo) {
+      continue; // host partition
+    }
     xrt_instr_state.at(handle).heap_total_size -=
         Utils::align_to_next(instr_bo.size(), INSTR_XRT_BO_ALIGNMENT);
   }
   xrt_instr_state.at(handle).num_instr_bos -= instr_bos_.size();
 
   instr_bos_.clear();
+  mem_account_.release("instr_bos");
 
   if (use_instr_sw_cache_) {
     RYZENAI_LOG_TRACE(
@@ -731,8 +2025,29 @@ bool FusionRuntime::allocate_instr_bos(
 
   bool alloc_failed = false;
 
+  size_t instr_bytes = 0;
+  for (const auto &instr : fused_instr_vec) {
+    instr_bytes += instr.size();
+  }
+  try {
+    mem_account_.reserve("instr_bos", instr_bytes, fused_instr_vec.size());
+  } catch (...) {
+    RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+        "FusionRuntime : instr BOs over npu memory budget! "
+        "Fallback to static buffers"));
+    alloc_failed = true;
+  }
+
   for (const auto &instr : fused_instr_vec) {
+    if (alloc_failed) {
+      break;
+    }
     size_t instr_size = instr.size();
+    if (instr.empty()) {
+      // host partition, nothing runs on the NPU
+      instr_bos_.emplace_back();
+      continue;
+    }
     RYZENAI_LOG_TRACE(OpsFusion::dod_format(
         "FusionRuntime : Reallocating instr_bo, new_size:{}", instr_size));
     try {
@@ -753,6 +2068,7 @@ bool FusionRuntime::allocate_instr_bos(
     // wiil either be all in "heap" or "stack"
     // in this case, fall back to using the "stack" instruction BOs
     instr_bos_.clear();
+    mem_account_.release("instr_bos");
     return true;
   }
 
@@ -781,9 +2097,11 @@ void FusionRuntime::populate_instr_bos(
 
   size_t instr_index = 0;
   for (const auto &instr : fused_instr_vec) {
-    write_to_bo(instr_bos_.at(instr_index), 0, /*offset*/
-                fused_instr_vec.at(instr_index).data(),
-                fused_instr_vec.at(instr_index).size());
+    if (!instr.empty()) {
+      write_to_bo(instr_bos_.at(instr_index), 0, /*offset*/
+                  fused_instr_vec.at(instr_index).data(),
+                  fused_instr_vec.at(instr_index).size());
+    }
 
     instr_index += 1;
   }
@@ -798,6 +2116,7 @@ void FusionRuntime::reallocate_data_bos(const Metadata &meta) {
     RYZENAI_LOG_TRACE(OpsFusion::dod_format(
         "FusionRuntime : Reallocating input bo, curr_size:{}, new_size:{}",
         super_instr_bo_sz_, new_size));
+    mem_account_.reserve("super_instr_bo", new_size);
     super_instr_bo_ = xrt::bo(ctx_, new_size, xrt::bo::flags::host_only,
                               kernels_[0].group_id(HOST_BO_GROUP_ID));
     memset(super_instr_bo_.map(), XRT_BO_INIT_VALUE, super_instr_bo_.size());
@@ -811,6 +2130,7 @@ void FusionRuntime::reallocate_data_bos(const Metadata &meta) {
     RYZENAI_LOG_TRACE(OpsFusion::dod_format(
         "FusionRuntime : Reallocating const bo, curr_size:{}, new_size:{}",
         const_bo_sz_, new_size));
+    mem_account_.reserve("const_bo", new_size);
     const_bo_ = xrt::bo(ctx_, new_size, xrt::bo::flags::host_only,
                         kernels_[0].group_id(HOST_BO_GROUP_ID));
     memset(const_bo_.map(), XRT_BO_INIT_VALUE, const_bo_.size());
@@ -823,6 +2143,7 @@ void FusionRuntime::reallocate_data_bos(const Metadata &meta) {
     RYZENAI_LOG_TRACE(OpsFusion::dod_format(
         "FusionRuntime : Reallocating input bo, curr_size:{}, new_size:{}",
         input_bo_sz_, new_size));
+    mem_account_.reserve("input_bo", new_size);
     input_bo_ = xrt::bo(ctx_, new_size, xrt::bo::flags::host_only,
                         kernels_[0].group_id(HOST_BO_GROUP_ID));
     memset(input_bo_.map(), XRT_BO_INIT_VALUE, input_bo_.size());
@@ -835,6 +2156,7 @@ void FusionRuntime::reallocate_data_bos(const Metadata &meta) {
     RYZENAI_LOG_TRACE(OpsFusion::dod_format(
         "FusionRuntime : Reallocating output bo, curr_size:{}, new_size:{}",
         output_bo_sz_, new_size));
+    mem_account_.reserve("output_bo", new_size);
     output_bo_ = xrt::bo(ctx_, new_size, xrt::bo::flags::host_only,
                          kernels_[0].group_id(HOST_BO_GROUP_ID));
     memset(output_bo_.map(), XRT_BO_INIT_VALUE, output_bo_.size());
@@ -849,6 +2171,7 @@ void FusionRuntime::reallocate_data_bos(const Metadata &meta) {
     RYZENAI_LOG_TRACE(OpsFusion::dod_format(
         "FusionRuntime : Reallocating scratch bo, curr_size:{}, new_size:{}",
         scratch_bo_sz_, new_size));
+    mem_account_.reserve("scratch_bo", new_size);
     scratch_bo_ = xrt::bo(ctx_, new_size, xrt::bo::flags::host_only,
                           kernels_[0].group_id(HOST_BO_GROUP_ID));
     memset(scratch_bo_.map(), XRT_BO_INIT_VALUE, scratch_bo_.size());
@@ -866,6 +2189,133 @@ void FusionRuntime::reallocate_data_bos(const Metadata &meta) {
 
 std::vector<std::vector<uint8_t>> FusionRuntime::get_txns() { return txns_; }
 
+void FusionRuntime::reset_latency_histograms(const Metadata &meta) {
+  auto hists = std::make_shared<LatencyHistograms>();
+  for (const auto &partition : meta.partitions) {
+    hists->partitions.push_back(std::make_unique<LatencyHistogram>());
+
+    // Partitions with a single op (e.g. in eager mode) give per op latency
+    std::string op_name;
+    size_t num_ops = 0;
+    for (size_t i = partition.op_range.first; i < partition.op_range.second;
+         i++) {
+      const auto &op_info = meta.op_list.at(i);
+      if (CONTROL_OPS.find(op_info.type) == CONTROL_OPS.end()) {
+        op_name = op_info.name;
+        num_ops++;
+      }
+    }
+    hists->partition_ops.push_back(num_ops == 1 ? op_name : "");
+  }
+  std::atomic_store(&latency_hists_, std::move(hists));
+}
+
+std::map<std::string, LatencyStats> FusionRuntime::get_latency_stats() const {
+  std::map<std::string, LatencyStats> stats;
+  auto hists = std::atomic_load(&latency_hists_);
+  stats["execute"] = hists->execute.get_stats();
+  stats["input_copy"] = hists->input_copy.get_stats();
+  stats["input_sync"] = hists->input_sync.get_stats();
+  stats["xrt_exec"] = hists->xrt_exec.get_stats();
+  stats["output_sync"] = hists->output_sync.get_stats();
+  stats["output_copy"] = hists->output_copy.get_stats();
+  for (size_t i = 0; i < hists->partitions.size(); i++) {
+    auto partition_stats = hists->partitions[i]->get_stats();
+    stats["pdi_partition_" + std::to_string(i)] = partition_stats;
+    if (!hists->partition_ops[i].empty()) {
+      stats["op/" + hists->partition_ops[i]] = partition_stats;
+    }
+  }
+  return stats;
+}
+
+void FusionRuntime::reset_latency_stats() {
+  auto hists = std::atomic_load(&latency_hists_);
+  for (auto *hist : {&hists->execute, &hists->input_copy, &hists->input_sync,
+                     &hists->xrt_exec, &hists->output_sync,
+                     &hists->output_copy}) {
+    hist->reset();
+  }
+  for (auto &hist : hists->partitions) {
+    hist->reset();
+  }
+}
+
+std::unique_ptr<FusionRuntime>
+FusionRuntime::create(const std::string &xclbin, const std::string &meta_file,
+                      const std::string &base_dir, const DDConfig &cfg,
+                      const std::string &kernel_name_prefix) {
+  const auto create_start = get_time_ns();
+  std::unique_ptr<FusionRuntime> rt;
+  Metadata meta;
+  Utils::TaskGraph graph;
+  graph.add("hw_context", [&]() {
+    rt = std::make_unique<FusionRuntime>(xclbin, kernel_name_prefix);
+  });
+  graph.add("load_meta", [&]() { meta = load_meta(meta_file); }, {}, true);
+  auto create_steps = graph.run();
+
+  rt->init(meta, base_dir, cfg);
+  create_steps.insert(create_steps.end(), rt->startup_timeline_.begin(),
+                      rt->startup_timeline_.end());
+  rt->startup_timeline_ = std::move(create_steps);
+  rt->startup_start_ns_ = create_start;
+  return rt;
+}
+
+std::vector<Utils::TaskTime> FusionRuntime::get_startup_timeline() const {
+  auto steps = startup_timeline_;
+  for (auto &step : steps) {
+    step.start_ns -= startup_start_ns_;
+    step.end_ns -= startup_start_ns_;
+  }
+  std::stable_sort(steps.begin(), steps.end(),
+                   [](const Utils::TaskTime &lhs, const Utils::TaskTime &rhs) {
+                     return lhs.start_ns < rhs.start_ns;
+                   });
+  return steps;
+}
+
+std::string FusionRuntime::get_startup_report(size_t width) const {
+  const auto steps = get_startup_timeline();
+  int64_t total_ns = 1;
+  size_t name_width = 8;
+  for (const auto &step : steps) {
+    total_ns = std::max(total_ns, step.end_ns);
+    name_width = std::max(name_width, step.name.size());
+  }
+  const int64_t num_cols = std::max<int64_t>(1, width);
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(2);
+  oss << "Startup timeline, " << total_ns / 1e6 << " ms\n";
+  oss << std::left << std::setw(name_width) << "step"
+      << " |" << std::string(num_cols, '-') << "| " << std::right
+      << std::setw(10) << "start ms" << std::setw(10) << "ms"
+      << std::setw(8) << "thread"
+      << "\n";
+  for (const auto &step : steps) {
+    // column c covers [c * total_ns / num_cols, (c+1) * ...)
+    std::string row(num_cols, ' ');
+    for (int64_t col = 0; col < num_cols; ++col) {
+      const int64_t begin = col * total_ns / num_cols;
+      const int64_t end = (col + 1) * total_ns / num_cols;
+      if (step.start_ns < end && begin <= step.end_ns) {
+        row[col] = '#';
+      }
+    }
+    oss << std::left << std::setw(name_width) << step.name << " |" << row
+        << "| " << std::right << std::setw(10) << step.start_ns / 1e6
+        << std::setw(10) << (step.end_ns - step.start_ns) / 1e6
+        << std::setw(8) << step.thread << "\n";
+  }
+  return oss.str();
+}
+
+InstrPrefetchStats FusionRuntime::get_instr_prefetch_stats() {
+  std::lock_guard<std::mutex> guard(execute_mutex_);
+  return instr_prefetch_stats_;
+}
+
 void FusionRuntime::initialize_inputs(const Metadata &meta) {
   uint8_t *in_ptr = input_bo_.map<uint8_t *>();
   uint8_t *out_ptr = output_bo_.map<uint8_t *>();
@@ -889,7 +2339,7 @@ void FusionRuntime::initialize_inputs(const Metadata &meta) {
       Tensor tensor = {ptr, tensor_info.shape, tensor_info.dtype};
       tensors.push_back(std::move(tensor));
     }
-    auto op = OpBuilder::create(op_info.name, op_info, meta.tensor_map);
+    auto op = OpBuilder::get_or_create(op_info, meta.tensor_map);
     DD_INVOKE_OPMETHOD(initialize_inputs, op.get(), op_info, tensors,
                        op_info.attr);
   }
@@ -901,6 +2351,40 @@ void FusionRuntime::initialize_inputs(const Metadata &meta) {
 void FusionRuntime::merge_inputs(const std::vector<Tensor> &inputs,
                                  const Metadata &meta) {
   RYZENAI_LOG_TRACE("Packing Inputs ... ");
+  if (linked_inputs_) {
+    // written in place on the device by the producer
+    auto views = get_input_views();
+    DOD_ASSERT(inputs.size() == views.size(),
+               OpsFusion::dod_format("Number of inputs ({}) doesn't match "
+                                     "with that of metadata ({})",
+                                     inputs.size(), views.size()));
+    for (size_t i = 0; i < inputs.size(); i++) {
+      DOD_ASSERT(inputs[i].data == views[i].data,
+                 OpsFusion::dod_format("Input {} of a linked runtime should "
+                                       "be its get_input_views() tensor",
+                                       i));
+    }
+    input_copy_time_ = 0;
+    input_sync_time_ = 0;
+    RYZENAI_LOG_TRACE("Packing Inputs ... DONE, linked");
+    return;
+  }
+  auto t1 = get_time_ns();
+  write_inputs(inputs, meta, input_bo_);
+  auto t2 = get_time_ns();
+  input_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  auto t3 = get_time_ns();
+
+  input_copy_time_ = t2 - t1;
+  input_sync_time_ = t3 - t2;
+  auto &tracer = EventTracer::get_instance();
+  tracer.record(get_trace_names().input_copy, t1, t2);
+  tracer.record(get_trace_names().input_sync, t2, t3);
+  RYZENAI_LOG_TRACE("Packing Inputs ... DONE");
+}
+
+void FusionRuntime::write_inputs(const std::vector<Tensor> &inputs,
+                                 const Metadata &meta, xrt::bo &input_bo) {
   size_t n_meta_inputs = MetaUtils::get_num_inputs(meta);
   DOD_ASSERT(
       inputs.size() == n_meta_inputs,
@@ -908,33 +2392,63 @@ void FusionRuntime::merge_inputs(const std::vector<Tensor> &inputs,
           "Number of inputs ({}) doesn't match with that of metadata ({})",
           inputs.size(), n_meta_inputs));
 
-  auto t1 = GET_ELAPSED_TIME_NS();
+  char *input_bo_ptr = input_bo.map<char *>();
   const auto &in_buf_names = MAP_AT(meta.fused_tensors, "in").packed_tensors;
   for (int i = 0; i < in_buf_names.size(); i++) {
+    const auto &tensor_info = MAP_AT(meta.tensor_map, in_buf_names[i]);
+    if (inputs[i].data == input_bo_ptr + tensor_info.offset) {
+      // Zero-copy view from get_input_views(), data is already in place
+      continue;
+    }
+
     size_t sz = std::accumulate(inputs[i].shape.begin(), inputs[i].shape.end(),
                                 size_t{1}, std::multiplies{}) *
                 Utils::get_size_of_type(inputs[i].dtype);
 
     // TODO : Check if input buffer size matches with metadata
-    const auto &tensor_info = MAP_AT(meta.tensor_map, in_buf_names[i]);
     RYZENAI_LOG_TRACE(OpsFusion::dod_format(
         "copying input:{} to input bo at offset:{} and size:{}",
         in_buf_names[i], tensor_info.offset, sz));
-    char *inp_ptr = (char *)inputs[i].data;
-    input_bo_.write(inputs[i].data, sz, tensor_info.offset);
+    input_bo.write(inputs[i].data, sz, tensor_info.offset);
   }
-  auto t2 = GET_ELAPSED_TIME_NS();
-  input_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  auto t3 = GET_ELAPSED_TIME_NS();
-
-  input_copy_time_ = t2 - t1;
-  input_sync_time_ = t3 - t2;
-  RYZENAI_LOG_TRACE("Packing Inputs ... DONE");
 }
 
 void FusionRuntime::split_outputs(const std::vector<Tensor> &outputs,
                                   const Metadata &meta) {
   RYZENAI_LOG_TRACE("Unpacking Outputs ...");
+  auto t1 = get_time_ns();
+  if (linked_outputs_.empty()) {
+    output_bo_.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+  } else {
+    // the views of the linked outputs are only read by the device
+    char *output_bo_ptr = output_bo_.map<char *>();
+    const auto &out_buf_names =
+        MAP_AT(meta.fused_tensors, "out").packed_tensors;
+    for (size_t i = 0; i < out_buf_names.size() && i < outputs.size(); i++) {
+      const auto &tensor_info = MAP_AT(meta.tensor_map, out_buf_names[i]);
+      if (linked_outputs_.at(i) &&
+          outputs[i].data == output_bo_ptr + tensor_info.offset) {
+        continue;
+      }
+      output_bo_.sync(XCL_BO_SYNC_BO_FROM_DEVICE, tensor_info.size_in_bytes,
+                      tensor_info.offset);
+    }
+  }
+  auto t2 = get_time_ns();
+  read_outputs(outputs, meta, output_bo_);
+  auto t3 = get_time_ns();
+
+  output_copy_time_ = t3 - t2;
+  output_sync_time_ = t2 - t1;
+  auto &tracer = EventTracer::get_instance();
+  tracer.record(get_trace_names().output_sync, t1, t2);
+  tracer.record(get_trace_names().output_copy, t2, t3);
+  RYZENAI_LOG_TRACE("Unpacking Outputs ... DONE");
+}
+
+// output_bo should be synced from device before calling this.
+void FusionRuntime::read_outputs(const std::vector<Tensor> &outputs,
+                                 const Metadata &meta, xrt::bo &output_bo) {
   size_t n_meta_outputs = MetaUtils::get_num_outputs(meta);
   DOD_ASSERT(outputs.size() == n_meta_outputs,
              OpsFusion::dod_format(
@@ -942,10 +2456,7 @@ void FusionRuntime::split_outputs(const std::vector<Tensor> &outputs,
                  "metadata outputs ({})",
                  outputs.size(), n_meta_outputs));
 
-  auto t1 = GET_ELAPSED_TIME_NS();
-  output_bo_.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
-  void *output_bo_ptr = output_bo_.map();
-  auto t2 = GET_ELAPSED_TIME_NS();
+  void *output_bo_ptr = output_bo.map();
 
   const auto &out_buf_names = meta.fused_tensors.at("out").packed_tensors;
   auto hwout_tensors = MetaUtils::get_output_tensors(meta);
@@ -967,26 +2478,233 @@ void FusionRuntime::split_outputs(const std::vector<Tensor> &outputs,
 
     // TODO : Do the depad here
     hwout_tensors[i].data = (char *)output_bo_ptr + tensor_info.offset;
+    if (outputs[i].data == hwout_tensors[i].data) {
+      // Zero-copy view from get_output_views()
+      continue;
+    }
 
     copy_data(hwout_tensors[i], outputs[i]);
-    // std::ofstream ofs("mat128_" + std::to_string(i) + ".bin");
-    // ofs.write((char *)hwout_tensors[i].data,
-    //           std::accumulate(hwout_tensors[i].shape.begin(),
-    //                           hwout_tensors[i].shape.end(), size_t{1},
-    //                           std::multiplies{}) *
-    //               Utils::get_size_of_type(hwout_tensors[i].dtype));
-    // ofs.close();
-    // output_bo_.read(outputs[i].data, sz, tensor_info.offset);
   }
-  auto t3 = GET_ELAPSED_TIME_NS();
+}
 
-  output_copy_time_ = t3 - t2;
-  output_sync_time_ = t2 - t1;
-  RYZENAI_LOG_TRACE("Unpacking Outputs ... DONE");
+std::vector<Tensor> FusionRuntime::get_input_views() {
+  auto tensors = MetaUtils::get_input_tensors(meta_);
+  const auto &in_buf_names = MAP_AT(meta_.fused_tensors, "in").packed_tensors;
+  char *input_bo_ptr = input_bo_.map<char *>();
+  for (size_t i = 0; i < in_buf_names.size(); i++) {
+    const auto &tensor_info = MAP_AT(meta_.tensor_map, in_buf_names[i]);
+    tensors[i].data = input_bo_ptr + tensor_info.offset;
+  }
+  return tensors;
+}
+
+std::vector<Tensor> FusionRuntime::get_output_views() {
+  auto tensors = MetaUtils::get_output_tensors(meta_);
+  const auto &out_buf_names = MAP_AT(meta_.fused_tensors, "out").packed_tensors;
+  char *output_bo_ptr = output_bo_.map<char *>();
+  for (size_t i = 0; i < out_buf_names.size(); i++) {
+    const auto &tensor_info = MAP_AT(meta_.tensor_map, out_buf_names[i]);
+    tensors[i].data = output_bo_ptr + tensor_info.offset;
+  }
+  return tensors;
+}
+
+size_t FusionRuntime::get_input_buffer_size() const { return input_bo_sz_; }
+
+size_t FusionRuntime::get_output_buffer_size() const { return output_bo_sz_; }
+
+void FusionRuntime::bind_io_buffers(void *input_buf, size_t input_size,
+                                    void *output_buf, size_t output_size) {
+  std::lock_guard<std::mutex> guard(execute_mutex_);
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "FusionRuntime : Binding user buffers, input:{} ({} B), output:{} ({} B)",
+      input_buf, input_size, output_buf, output_size));
+
+  auto check_user_buf = [](const void *buf, size_t size, size_t req_size,
+                           const std::string &name) {
+    DOD_ASSERT(buf != nullptr,
+               OpsFusion::dod_format("User {} buffer is null", name));
+    auto addr = reinterpret_cast<std::uintptr_t>(buf);
+    DOD_ASSERT(addr % XRT_USER_PTR_ALIGNMENT == 0,
+               OpsFusion::dod_format("User {} buffer should be aligned to {} B",
+                                     name, XRT_USER_PTR_ALIGNMENT));
+    DOD_ASSERT(size >= req_size,
+               OpsFusion::dod_format(
+                   "User {} buffer size ({}) is less than required size ({})",
+                   name, size, req_size));
+  };
+  check_user_buf(input_buf, input_size, input_bo_sz_, "input");
+  check_user_buf(output_buf, output_size, output_bo_sz_, "output");
+
+  // Keep the data filled by initialize_inputs()
+  memcpy(input_buf, input_bo_.map(), input_bo_sz_);
+  memset(output_buf, XRT_BO_INIT_VALUE, output_bo_sz_);
+
+  // user memory is pinned for the BOs
+  mem_account_.reserve("input_bo", input_bo_sz_);
+  mem_account_.reserve("output_bo", output_bo_sz_);
+  input_bo_ = xrt::bo(ctx_, input_buf, input_bo_sz_,
+                      kernels_[0].group_id(HOST_BO_GROUP_ID));
+  output_bo_ = xrt::bo(ctx_, output_buf, output_bo_sz_,
+                       kernels_[0].group_id(HOST_BO_GROUP_ID));
+  input_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  output_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  user_io_bufs_ = true;
+  linked_inputs_ = false;
+  linked_outputs_.clear();
+}
+
+bool FusionRuntime::link_inputs(FusionRuntime &producer,
+                                const std::vector<size_t> &output_idx) {
+  DOD_ASSERT(&producer != this,
+             OpsFusion::dod_format("A runtime can't be linked to itself"));
+  std::scoped_lock guard(execute_mutex_, producer.execute_mutex_);
+  const auto &in_names = MAP_AT(meta_.fused_tensors, "in").packed_tensors;
+  const auto &out_names =
+      MAP_AT(producer.meta_.fused_tensors, "out").packed_tensors;
+  DOD_ASSERT(output_idx.size() == in_names.size(),
+             OpsFusion::dod_format("{} producer outputs for {} inputs",
+                                   output_idx.size(), in_names.size()));
+  if (in_names.empty() || user_io_bufs_ ||
+      ctx_.get_handle() != producer.ctx_.get_handle()) {
+    return false;
+  }
+
+  // the input BO starts at delta in the output BO of producer
+  size_t delta = 0;
+  for (size_t i = 0; i < in_names.size(); i++) {
+    DOD_ASSERT(output_idx[i] < out_names.size(),
+               OpsFusion::dod_format("Producer has no output {}",
+                                     output_idx[i]));
+    const auto &in_info = MAP_AT(meta_.tensor_map, in_names[i]);
+    const auto &out_info =
+        MAP_AT(producer.meta_.tensor_map, out_names[output_idx[i]]);
+    if (in_info.shape != out_info.shape || in_info.dtype != out_info.dtype ||
+        out_info.offset < in_info.offset ||
+        (i > 0 && out_info.offset - in_info.offset != delta)) {
+      return false;
+    }
+    delta = out_info.offset - in_info.offset;
+  }
+  const size_t in_size = MAP_AT(meta_.fused_tensors, "in").size;
+  if (delta + in_size > producer.output_bo_sz_) {
+    return false;
+  }
+
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "FusionRuntime : Linking {} inputs to the output bo of the producer at "
+      "offset:{}",
+      in_names.size(), delta));
+  input_bo_ = xrt::bo(producer.output_bo_, in_size, delta);
+  input_bo_sz_ = in_size;
+  mem_account_.release("input_bo");
+  linked_inputs_ = true;
+  producer.linked_outputs_.resize(out_names.size(), false);
+  for (auto idx : output_idx) {
+    producer.linked_outputs_[idx] = true;
+  }
+  return true;
 }
 
 const Metadata &FusionRuntime::get_meta() const { return meta_; }
 
+MemoryReport FusionRuntime::get_memory_report() const {
+  auto report = MetaUtils::get_memory_report(meta_);
+  report.passes = pass_steps_;
+  return report;
+}
+
+std::vector<TimerRecord> read_timer_records(const std::string &file) {
+  std::ifstream ifs(file);
+  DOD_THROW_IF(!ifs.is_open(),
+               dod_format("Couldn't open timer records file {}", file));
+  std::vector<TimerRecord> records;
+  std::string line;
+  while (std::getline(ifs, line)) {
+    std::istringstream iss(line);
+    std::string id, cycles;
+    if (iss >> id >> cycles) {
+      records.push_back({static_cast<uint32_t>(std::stoul(id, nullptr, 0)),
+                         std::stoull(cycles, nullptr, 0)});
+    }
+  }
+  return records;
+}
+
+std::vector<DeviceOpTime> FusionRuntime::get_device_op_times(
+    const std::vector<TimerRecord> &records) const {
+  struct TimedEvent {
+    DeviceOpTime time;
+    uint64_t total_cycles = 0;
+    uint64_t start_cycles = 0;
+    bool started = false;
+  };
+  std::vector<TimedEvent> events;
+  // (name, type) --> index in events
+  std::map<std::pair<std::string, std::string>, size_t> event_indices;
+  // timer id --> (index in events, is start timer)
+  std::map<uint32_t, std::pair<size_t, bool>> timers;
+  for (const auto &op_info : meta_.op_list) {
+    if (op_info.type != "RECORD_TIMER" || !op_info.attr.count("timer_event")) {
+      continue;
+    }
+    const auto &attr = op_info.attr;
+    const auto &name = std::any_cast<const std::string &>(
+        MAP_AT(attr, "timer_event"));
+    const auto &type =
+        std::any_cast<const std::string &>(MAP_AT(attr, "timer_type"));
+    auto [iter, inserted] =
+        event_indices.emplace(std::make_pair(name, type), events.size());
+    if (inserted) {
+      TimedEvent event;
+      event.time.name = name;
+      event.time.type = type;
+      event.time.shape =
+          std::any_cast<const std::string &>(MAP_AT(attr, "timer_shape"));
+      event.time.dtype =
+          std::any_cast<const std::string &>(MAP_AT(attr, "timer_dtype"));
+      events.push_back(std::move(event));
+    }
+    timers[std::any_cast<uint32_t>(MAP_AT(attr, "timer_id"))] = {
+        iter->second, std::any_cast<bool>(MAP_AT(attr, "timer_start"))};
+  }
+
+  for (const auto &record : records) {
+    auto iter = timers.find(record.id);
+    if (iter == timers.end()) {
+      continue;
+    }
+    auto &event = events.at(iter->second.first);
+    if (iter->second.second) {
+      event.start_cycles = record.cycles;
+      event.started = true;
+      continue;
+    }
+    if (!event.started || record.cycles < event.start_cycles) {
+      continue;
+    }
+    const uint64_t cycles = record.cycles - event.start_cycles;
+    auto &time = event.time;
+    time.min_cycles =
+        time.num_runs ? std::min(time.min_cycles, cycles) : cycles;
+    time.max_cycles = std::max(time.max_cycles, cycles);
+    time.num_runs++;
+    event.total_cycles += cycles;
+    event.started = false;
+  }
+
+  std::vector<DeviceOpTime> op_times;
+  op_times.reserve(events.size());
+  for (auto &event : events) {
+    if (event.time.num_runs) {
+      event.time.mean_cycles =
+          static_cast<double>(event.total_cycles) / event.time.num_runs;
+    }
+    op_times.push_back(std::move(event.time));
+  }
+  return op_times;
+}
+
 std::map<std::string, std::vector<uint8_t>>
 FusionRuntime::unpack_internal_buffers(const std::string &dir) {
   std::map<std::string, std::vector<uint8_t>> res;
@@ -1062,9 +2780,11 @@ FusionRuntime::unpack_internal_buffers(const std::string &dir) {
     hash_fs << "super_kernel_bo, "
             << compute_hash(super_instr_bo_.map(), super_instr_bo_.size())
             << std::endl;
-    hash_fs << "instruction_bo, "
-            << compute_hash(instr_bos_[0].map(), instr_bos_[0].size())
-            << std::endl;
+    if (!instr_bos_.empty() && instr_bos_[0]) {
+      hash_fs << "instruction_bo, "
+              << compute_hash(instr_bos_[0].map(), instr_bos_[0].size())
+              << std::endl;
+    }
   }
 
   return res;
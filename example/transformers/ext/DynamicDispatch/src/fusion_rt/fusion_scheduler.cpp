@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <op_fuser/fusion_scheduler.hpp>
+
+#include <utils/logging.hpp>
+#include <utils/tfuncs.hpp>
+
+namespace OpsFusion {
+
+FusionScheduler::FusionScheduler(const std::string &xclbin,
+                                 const Metadata &meta,
+                                 const std::string &base_dir,
+                                 const DDConfig &dd_cfg,
+                                 const SchedulerConfig &sched_cfg,
+                                 const std::string &kernel_name_prefix)
+    : dd_cfg_(dd_cfg), sched_cfg_(sched_cfg) {
+  const size_t num_runtimes = std::max<uint32_t>(1, sched_cfg_.num_runtimes);
+  for (size_t i = 0; i < num_runtimes; ++i) {
+    runtimes_.push_back(
+        std::make_unique<FusionRuntime>(xclbin, kernel_name_prefix));
+  }
+  init_runtimes(meta, base_dir);
+  start_dispatchers();
+}
+
+FusionScheduler::FusionScheduler(const std::vector<xrt::hw_context *> &ctxs,
+                                 const Metadata &meta,
+                                 const std::string &base_dir,
+                                 const DDConfig &dd_cfg,
+                                 const SchedulerConfig &sched_cfg,
+                                 const std::string &kernel_name_prefix)
+    : dd_cfg_(dd_cfg), sched_cfg_(sched_cfg) {
+  DOD_ASSERT(!ctxs.empty(), "FusionScheduler : no hw_context given");
+  for (auto *ctx : ctxs) {
+    DOD_ASSERT(ctx != nullptr, "FusionScheduler : hw_context is null");
+    runtimes_.push_back(
+        std::make_unique<FusionRuntime>(ctx, kernel_name_prefix));
+  }
+  sched_cfg_.num_runtimes = static_cast<uint32_t>(runtimes_.size());
+  init_runtimes(meta, base_dir);
+  start_dispatchers();
+}
+
+FusionScheduler::~FusionScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stop_ = true;
+  }
+  queue_cv_.notify_all();
+  // Dispatchers drain the queue before exiting
+  for (auto &dispatcher : dispatchers_) {
+    if (dispatcher.joinable()) {
+      dispatcher.join();
+    }
+  }
+}
+
+void FusionScheduler::init_runtimes(const Metadata &meta,
+                                    const std::string &base_dir) {
+  for (auto &rt : runtimes_) {
+    rt->init(meta, base_dir, dd_cfg_);
+  }
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "FusionScheduler : initialized {} runtimes, max_batch_size : {}, "
+      "max_queue_delay(us) : {}",
+      runtimes_.size(), sched_cfg_.max_batch_size,
+      sched_cfg_.max_queue_delay.count()));
+}
+
+void FusionScheduler::start_dispatchers() {
+  for (size_t i = 0; i < runtimes_.size(); ++i) {
+    dispatchers_.emplace_back(&FusionScheduler::dispatcher_loop, this, i);
+  }
+}
+
+std::future<void>
+FusionScheduler::enqueue(const std::vector<Tensor> &inputs,
+                         const std::vector<Tensor> &outputs) {
+  Request req;
+  req.inputs = inputs;
+  req.outputs = outputs;
+  req.enqueue_time = std::chrono::steady_clock::now();
+  auto fut = req.done.get_future();
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    DOD_ASSERT(!stop_, "FusionScheduler : enqueue after shutdown");
+    queue_.push_back(std::move(req));
+  }
+  // wake up dispatchers waiting for a batch to fill up as well
+  queue_cv_.notify_all();
+  return fut;
+}
+
+void FusionScheduler::execute(const std::vector<Tensor> &inputs,
+                              const std::vector<Tensor> &outputs) {
+  enqueue(inputs, outputs).get();
+}
+
+size_t FusionScheduler::get_num_runtimes() const { return runtimes_.size(); }
+
+size_t FusionScheduler::get_queue_size() {
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  return queue_.size();
+}
+
+std::vector<FusionScheduler::Request> FusionScheduler::take_batch() {
+  const size_t max_batch = std::max<uint32_t>(1, sched_cfg_.max_batch_size);
+  std::vector<Request> batch;
+
+  std::unique_lock<std::mutex> lock(queue_mutex_);
+  while (true) {
+    queue_cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      // stop_ is set and nothing left to run
+      return batch;
+    }
+
+    // Give the batch a chance to fill up, bounded by the age of the oldest
+    // request. Skip the wait when shutting down.
+    if (!stop_ && queue_.size() < max_batch) {
+      const auto deadline =
+          queue_.front().enqueue_time + sched_cfg_.max_queue_delay;
+      queue_cv_.wait_until(lock, deadline, [this, max_batch]() {
+        return stop_ || queue_.empty() || queue_.size() >= max_batch;
+      });
+    }
+
+    // another dispatcher may have taken the requests meanwhile
+    if (!queue_.empty()) {
+      break;
+    }
+  }
+
+  const size_t batch_size = std::min(max_batch, queue_.size());
+  batch.reserve(batch_size);
+  for (size_t i = 0; i < batch_size; ++i) {
+    batch.push_back(std::move(queue_.front()));
+    queue_.pop_front();
+  }
+  return batch;
+}
+
+void FusionScheduler::run_batch(FusionRuntime &rt,
+                                std::vector<Request> &batch) {
+  // Keep at most num_async_slots requests in flight, to not block in submit()
+  const size_t depth = std::max<uint32_t>(1, dd_cfg_.num_async_slots);
+  std::deque<std::pair<FusionRuntime::RequestHandle, size_t>> in_flight;
+
+  auto retire = [&rt, &batch, &in_flight]() {
+    auto [handle, idx] = in_flight.front();
+    in_flight.pop_front();
+    try {
+      rt.wait(handle);
+      batch[idx].done.set_value();
+    } catch (...) {
+      batch[idx].done.set_exception(std::current_exception());
+    }
+  };
+
+  for (size_t i = 0; i < batch.size(); ++i) {
+    if (in_flight.size() == depth) {
+      retire();
+    }
+    try {
+      auto handle = rt.submit(batch[i].inputs, batch[i].outputs);
+      in_flight.emplace_back(handle, i);
+    } catch (...) {
+      batch[i].done.set_exception(std::current_exception());
+    }
+  }
+
+  while (!in_flight.empty()) {
+    retire();
+  }
+}
+
+void FusionScheduler::dispatcher_loop(size_t rt_idx) {
+  auto &rt = *runtimes_.at(rt_idx);
+  while (true) {
+    auto batch = take_batch();
+    if (batch.empty()) {
+      break;
+    }
+    RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+        "FusionScheduler : runtime {} dispatching batch of {}", rt_idx,
+        batch.size()));
+    run_batch(rt, batch);
+  }
+}
+
+} // namespace OpsFusion
@@ -1,5 +1,12 @@
+#include <algorithm>
+#include <iomanip>
+#include <limits>
 #include <sstream>
+
+#include <nlohmann/json.hpp>
+
 #include <utils/meta_utils.hpp>
+#include <utils/utils.hpp>
 
 namespace OpsFusion {
 
@@ -36,6 +43,162 @@ std::string MetaUtils::get_summary(const Metadata &meta) {
   return oss.str();
 }
 
+MemoryReport MetaUtils::get_memory_report(const Metadata &meta) {
+  MemoryReport report;
+  report.num_ops = meta.op_list.size();
+  report.op_scratch_pad_size = meta.max_op_scratch_pad_size;
+
+  // const & super_instr hold spans of the ops, not tensors
+  const std::map<std::string, const std::map<std::string, Metadata::Span> *>
+      op_spans = {{"const", &meta.const_map},
+                  {"super_instr", &meta.super_instr_map}};
+  for (const auto &[name, fused] : meta.fused_tensors) {
+    MemoryReport::Buffer buffer;
+    buffer.name = name;
+    buffer.size = fused.size;
+    auto spans = op_spans.find(name);
+    if (spans != op_spans.end()) {
+      buffer.num_tensors = spans->second->size();
+      for (const auto &[op_name, span] : *spans->second) {
+        buffer.tensor_size += span.size;
+      }
+    } else {
+      buffer.num_tensors = fused.packed_tensors.size();
+      for (const auto &tname : fused.packed_tensors) {
+        buffer.tensor_size += MAP_AT(meta.tensor_map, tname).size_in_bytes;
+      }
+      if (!fused.packed_tensors.empty()) {
+        buffer.padding_size = meta.max_tensor_padding_sz;
+      }
+    }
+    report.total_size += buffer.size;
+    report.padding_size += buffer.padding_size;
+    report.buffers.push_back(std::move(buffer));
+  }
+
+  // Live ranges like optimize_scratch_buffer(), the args of an op are its
+  // inputs & outputs and a view keeps its base live
+  auto iter = meta.fused_tensors.find("scratch");
+  if (iter == meta.fused_tensors.end()) {
+    return report;
+  }
+  std::map<std::string, MemoryReport::LiveRange> live_ranges;
+  for (const auto &tname : iter->second.packed_tensors) {
+    const auto &tinfo = MAP_AT(meta.tensor_map, tname);
+    auto &range = live_ranges[tname];
+    range.name = tname;
+    range.size = tinfo.size_in_bytes;
+    range.offset = tinfo.offset;
+    range.first_op = std::numeric_limits<size_t>::max();
+  }
+  for (size_t op_idx = 0; op_idx < meta.op_list.size(); ++op_idx) {
+    for (const auto &arg : meta.op_list[op_idx].args) {
+      auto range = live_ranges.find(resolve_tensor_view(meta, arg).first);
+      if (range == live_ranges.end()) {
+        continue;
+      }
+      range->second.first_op = std::min(range->second.first_op, op_idx);
+      range->second.last_op = std::max(range->second.last_op, op_idx);
+    }
+  }
+
+  // live size at each op, from the size deltas where ranges start & end
+  std::vector<int64_t> deltas(meta.op_list.size() + 2, 0);
+  for (auto &[tname, range] : live_ranges) {
+    if (range.first_op > range.last_op) {
+      // Not accessed by any op, live throughout
+      range.first_op = 0;
+      range.last_op = meta.op_list.size();
+    }
+    deltas[range.first_op] += range.size;
+    deltas[range.last_op + 1] -= range.size;
+    report.live_ranges.push_back(range);
+  }
+  int64_t live_size = 0;
+  for (size_t op_idx = 0; op_idx < deltas.size(); ++op_idx) {
+    live_size += deltas[op_idx];
+    if (static_cast<size_t>(live_size) > report.peak_live_size) {
+      report.peak_live_size = live_size;
+      report.peak_live_op = op_idx;
+    }
+  }
+  std::stable_sort(
+      report.live_ranges.begin(), report.live_ranges.end(),
+      [](const MemoryReport::LiveRange &a, const MemoryReport::LiveRange &b) {
+        return a.first_op < b.first_op;
+      });
+  return report;
+}
+
+std::string MetaUtils::get_live_range_chart(const MemoryReport &report,
+                                            size_t width) {
+  std::ostringstream oss;
+  const size_t num_ops = std::max(report.num_ops, size_t{1});
+  const size_t num_cols = std::max(size_t{1}, std::min(width, num_ops));
+  size_t name_width = 8;
+  for (const auto &range : report.live_ranges) {
+    name_width = std::max(name_width, range.name.size());
+  }
+  oss << "Live ranges of scratch tensors, " << report.num_ops << " ops\n";
+  oss << std::left << std::setw(name_width) << "tensor"
+      << " |" << std::string(num_cols, '-') << "| " << std::right
+      << std::setw(12) << "offset" << std::setw(12) << "size"
+      << "\n";
+  for (const auto &range : report.live_ranges) {
+    // column c covers the ops [c * num_ops / num_cols, (c+1) * ...)
+    std::string row(num_cols, ' ');
+    for (size_t col = 0; col < num_cols; ++col) {
+      const size_t begin = col * num_ops / num_cols;
+      const size_t end = (col + 1) * num_ops / num_cols;
+      if (range.first_op < end && begin <= range.last_op) {
+        row[col] = '#';
+      }
+    }
+    oss << std::left << std::setw(name_width) << range.name << " |" << row
+        << "| " << std::right << std::setw(12) << range.offset
+        << std::setw(12) << range.size << "\n";
+  }
+  oss << "Peak live size (B) : " << report.peak_live_size << " at op "
+      << report.peak_live_op << "\n";
+  return oss.str();
+}
+
+std::string MetaUtils::to_json(const MemoryReport &report) {
+  using json = nlohmann::json;
+  json buffers_js = json::array();
+  for (const auto &buffer : report.buffers) {
+    buffers_js.push_back({{"name", buffer.name},
+                          {"size", buffer.size},
+                          {"num_tensors", buffer.num_tensors},
+                          {"tensor_size", buffer.tensor_size},
+                          {"padding_size", buffer.padding_size}});
+  }
+  json ranges_js = json::array();
+  for (const auto &range : report.live_ranges) {
+    ranges_js.push_back({{"name", range.name},
+                         {"size", range.size},
+                         {"offset", range.offset},
+                         {"first_op", range.first_op},
+                         {"last_op", range.last_op}});
+  }
+  json passes_js = json::array();
+  for (const auto &step : report.passes) {
+    passes_js.push_back({{"pass", step.pass},
+                         {"num_ops", step.num_ops},
+                         {"buffer_sizes", step.buffer_sizes}});
+  }
+  const json report_js = {{"num_ops", report.num_ops},
+                          {"total_size", report.total_size},
+                          {"padding_size", report.padding_size},
+                          {"op_scratch_pad_size", report.op_scratch_pad_size},
+                          {"peak_live_size", report.peak_live_size},
+                          {"peak_live_op", report.peak_live_op},
+                          {"buffers", buffers_js},
+                          {"live_ranges", ranges_js},
+                          {"passes", passes_js}};
+  return report_js.dump(2);
+}
+
 size_t MetaUtils::get_num_inputs(const Metadata &meta) {
   return MetaUtils::get_num_tensors(meta, OpArgMap::OpArgType::INPUT);
 }
@@ -88,13 +251,24 @@ MetaUtils::load_op_const_buffers(const Metadata &meta,
                             "associated filename provided",
                             tensor_name));
 
-      auto const_buffer = read_bin_file(tinfo.file_name);
-      DOD_ASSERT(const_buffer.size() == tinfo.file_size,
-                 dod_format("Const tensor size doesn't match.\n  Tensor: "
-                            "{}\n  Size in JSON: {}\n  Size of file: {}",
-                            tensor_name, tinfo.file_size, const_buffer.size()));
+      if (tinfo.file_offset == 0) {
+        auto const_buffer = read_bin_file(tinfo.file_name);
+        DOD_ASSERT(const_buffer.size() == tinfo.file_size,
+                   dod_format("Const tensor size doesn't match.\n  Tensor: "
+                              "{}\n  Size in JSON: {}\n  Size of file: {}",
+                              tensor_name, tinfo.file_size,
+                              const_buffer.size()));
+        const_buffers[tensor_name] = std::move(const_buffer);
+        continue;
+      }
 
-      const_buffers[tensor_name] = std::move(const_buffer);
+      // const of a packed archive
+      Utils::MappedFile archive(tinfo.file_name);
+      DOD_ASSERT(archive.size() >= tinfo.file_offset + tinfo.file_size,
+                 dod_format("Const tensor {} is out of the archive {}",
+                            tensor_name, tinfo.file_name));
+      const char *src = archive.data() + tinfo.file_offset;
+      const_buffers[tensor_name] = std::vector<char>(src, src + tinfo.file_size);
     }
   }
   return const_buffers;
@@ -120,4 +294,31 @@ std::vector<Tensor> MetaUtils::collect_op_tensors(
   return tensors;
 }
 
+std::pair<std::string, size_t>
+MetaUtils::resolve_tensor_view(const Metadata &meta,
+                               const std::string &tensor_name) {
+  std::string name = tensor_name;
+  size_t offset = 0;
+  for (auto iter = meta.tensor_views.find(name);
+       iter != meta.tensor_views.end();
+       iter = meta.tensor_views.find(name)) {
+    name = iter->second.base_name;
+    offset += iter->second.offset;
+    DOD_ASSERT(name != tensor_name,
+               dod_format("Tensor view {} is a view of itself", tensor_name));
+  }
+  return {name, offset};
+}
+
+void MetaUtils::update_tensor_views(Metadata &meta) {
+  for (const auto &[name, view] : meta.tensor_views) {
+    auto [base_name, offset] = resolve_tensor_view(meta, name);
+    const auto base_info = MAP_AT(meta.tensor_map, base_name);
+    auto &tinfo = MAP_AT(meta.tensor_map, name);
+    tinfo.parent_name = base_info.parent_name;
+    tinfo.arg_idx = base_info.arg_idx;
+    tinfo.offset = base_info.offset + offset;
+  }
+}
+
 } // namespace OpsFusion
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <exception>
+#include <op_fuser/parallel_fusion_rt.hpp>
+
+#include <utils/logging.hpp>
+#include <utils/tfuncs.hpp>
+
+#include "passes/passes.hpp"
+
+namespace OpsFusion {
+
+ParallelFusionRuntime::ParallelFusionRuntime(
+    const std::string &xclbin, size_t num_contexts,
+    const std::string &kernel_name_prefix)
+    : kernel_name_prefix_(kernel_name_prefix) {
+  DOD_ASSERT(num_contexts > 0, "ParallelFusionRuntime : no hw_context given");
+  for (size_t i = 0; i < num_contexts; ++i) {
+    xrt_ctxs_.push_back(
+        ryzenai::dynamic_dispatch::xrt_context::get_instance(xclbin, i));
+    ctxs_.push_back(&xrt_ctxs_.back()->get_context());
+  }
+}
+
+ParallelFusionRuntime::ParallelFusionRuntime(
+    const std::vector<xrt::hw_context *> &ctxs,
+    const std::string &kernel_name_prefix)
+    : ctxs_(ctxs), kernel_name_prefix_(kernel_name_prefix) {
+  DOD_ASSERT(!ctxs_.empty(), "ParallelFusionRuntime : no hw_context given");
+  for (auto *ctx : ctxs_) {
+    DOD_ASSERT(ctx != nullptr, "ParallelFusionRuntime : hw_context is null");
+  }
+}
+
+static std::vector<size_t> get_tensor_ids(const Metadata &meta,
+                                          const Metadata &sub_meta,
+                                          const std::string &label) {
+  const auto &names = MAP_AT(meta.fused_tensors, label).packed_tensors;
+  std::vector<size_t> ids;
+  for (const auto &name : MAP_AT(sub_meta.fused_tensors, label).packed_tensors) {
+    ids.push_back(std::find(names.begin(), names.end(), name) - names.begin());
+  }
+  return ids;
+}
+
+void ParallelFusionRuntime::init(const Metadata &meta,
+                                 const std::string &base_dir,
+                                 const DDConfig &cfg) {
+  std::lock_guard<std::mutex> guard(execute_mutex_);
+  num_inputs_ = MAP_AT(meta.fused_tensors, "in").packed_tensors.size();
+  num_outputs_ = MAP_AT(meta.fused_tensors, "out").packed_tensors.size();
+
+  auto sub_metas = split_independent_subgraphs(meta, ctxs_.size());
+  subgraphs_.clear();
+  for (size_t i = 0; i < sub_metas.size(); ++i) {
+    Subgraph subgraph;
+    subgraph.rt =
+        std::make_unique<FusionRuntime>(ctxs_.at(i), kernel_name_prefix_);
+    subgraph.rt->init(sub_metas[i], base_dir, cfg);
+    subgraph.input_ids = get_tensor_ids(meta, sub_metas[i], "in");
+    subgraph.output_ids = get_tensor_ids(meta, sub_metas[i], "out");
+    subgraphs_.push_back(std::move(subgraph));
+  }
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "ParallelFusionRuntime : initialized {} subgraphs on {} hw contexts",
+      subgraphs_.size(), ctxs_.size()));
+}
+
+void ParallelFusionRuntime::execute(const std::vector<Tensor> &inputs,
+                                    const std::vector<Tensor> &outputs) {
+  std::lock_guard<std::mutex> guard(execute_mutex_);
+  DOD_ASSERT(inputs.size() == num_inputs_,
+             OpsFusion::dod_format("Number of inputs ({}) doesn't match with "
+                                   "that of metadata ({})",
+                                   inputs.size(), num_inputs_));
+  DOD_ASSERT(outputs.size() == num_outputs_,
+             OpsFusion::dod_format("Number of outputs ({}) doesn't match with "
+                                   "that of metadata ({})",
+                                   outputs.size(), num_outputs_));
+
+  // Each runtime executes its request on its own worker, so subgraphs run
+  // concurrently once they are all submitted.
+  std::vector<FusionRuntime::RequestHandle> handles;
+  std::exception_ptr error;
+  for (auto &subgraph : subgraphs_) {
+    std::vector<Tensor> sub_inputs;
+    for (auto idx : subgraph.input_ids) {
+      sub_inputs.push_back(inputs.at(idx));
+    }
+    std::vector<Tensor> sub_outputs;
+    for (auto idx : subgraph.output_ids) {
+      sub_outputs.push_back(outputs.at(idx));
+    }
+    try {
+      handles.push_back(subgraph.rt->submit(sub_inputs, sub_outputs));
+    } catch (...) {
+      error = std::current_exception();
+      break;
+    }
+  }
+
+  // Join all the submitted subgraphs, even if one of them failed
+  for (size_t i = 0; i < handles.size(); ++i) {
+    try {
+      subgraphs_[i].rt->wait(handles[i]);
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+size_t ParallelFusionRuntime::get_num_subgraphs() const {
+  return subgraphs_.size();
+}
+
+const FusionRuntime &
+ParallelFusionRuntime::get_runtime(size_t subgraph_idx) const {
+  return *subgraphs_.at(subgraph_idx).rt;
+}
+
+} // namespace OpsFusion
@@ -266,6 +266,42 @@ void bmm<InT, WtT, OutT>::initialize_const_params(
     const std::map<std::string, std::any> &attr) {
   RYZENAI_LOG_TRACE("bmm initialize_const_params ...");
 
+  // a [B, R, C] view into a larger buffer with its "strides", the weight
+  // shape is the one of set_params(), see write_strided()
+  if (attr.count("strides")) {
+    DOD_THROW_IF(
+        (const_params.size() != 1) ||
+            (const_params.at(0).shape.size() != 3),
+        OpsFusion::dod_format("Unsupported strided const spec for bmm\n") +
+            OpsFusion::dod_format("(Details : #const params == 1 ({}), Const "
+                                  "param dim == 3 ({})",
+                                  const_params.size(),
+                                  const_params.at(0).shape.size()));
+    const auto &view = const_params.at(0);
+    DOD_THROW_IF(view.shape[0] * view.shape[1] * view.shape[2] !=
+                     size_t(w_shape_[0] * w_shape_[1]),
+                 OpsFusion::dod_format(
+                     "bmm : view of {} elements for a {}x{} weight",
+                     view.shape[0] * view.shape[1] * view.shape[2],
+                     w_shape_[0], w_shape_[1]));
+    size_t cached_rows = 0;
+    if (attr.count("cached_rows")) {
+      cached_rows = std::any_cast<size_t>(attr.at("cached_rows"));
+    }
+    b_format_time_ = 0;
+    auto b_copy_start = GET_ELAPSED_TIME_NS();
+    write_strided(
+        b_bo_, view,
+        std::any_cast<const std::vector<size_t> &>(attr.at("strides")),
+        cached_rows);
+    auto b_copy_stop = GET_ELAPSED_TIME_NS();
+    // includes the sync
+    b_copy_time_ = b_copy_stop - b_copy_start;
+    b_sync_time_ = 0;
+    RYZENAI_LOG_TRACE("bmm initialize_const_params ... DONE");
+    return;
+  }
+
   DOD_THROW_IF(
       (const_params.size() != 1) || (const_params.at(0).shape.size() != 2),
       OpsFusion::dod_format("Unsupported const spec for bmm\n") +
@@ -360,6 +396,51 @@ void bmm<InT, WtT, OutT>::execute(std::vector<Tensor> &input,
   RYZENAI_LOG_TRACE("bmm execute ... DONE");
 }
 
+template <typename InT, typename WtT, typename OutT>
+void bmm<InT, WtT, OutT>::write_strided(xrt::bo &bo, const Tensor &view,
+                                        const std::vector<size_t> &strides,
+                                        size_t cached_rows) {
+  DOD_THROW_IF(view.shape.size() != 3 || strides.size() != 2,
+               OpsFusion::dod_format(
+                   "bmm : strided view should be [B, R, C] with 2 strides "
+                   "(shape dims : {}, strides : {})",
+                   view.shape.size(), strides.size()));
+  const size_t B = view.shape[0];
+  const size_t R = view.shape[1];
+  const size_t C = view.shape[2];
+  const size_t row_bytes = C * sizeof(WtT);
+  DOD_THROW_IF(B * R * row_bytes > bo.size() || cached_rows > R ||
+                   strides[1] < C,
+               OpsFusion::dod_format(
+                   "bmm : invalid strided view [{}, {}, {}], strides [{}, "
+                   "{}], cached rows {} for a BO of {} bytes",
+                   B, R, C, strides[0], strides[1], cached_rows, bo.size()));
+
+  const auto *src = static_cast<const WtT *>(view.data);
+  auto *dst = bo.map<WtT *>();
+  const size_t new_rows = R - cached_rows;
+  for (size_t b = 0; b < B; ++b) {
+    const WtT *src_rows = src + b * strides[0] + cached_rows * strides[1];
+    WtT *dst_rows = dst + (b * R + cached_rows) * C;
+    if (strides[1] == C) {
+      memcpy(dst_rows, src_rows, new_rows * row_bytes);
+    } else {
+      for (size_t r = 0; r < new_rows; ++r) {
+        memcpy(dst_rows + r * C, src_rows + r * strides[1], row_bytes);
+      }
+    }
+  }
+
+  if (cached_rows == 0) {
+    bo.sync(XCL_BO_SYNC_BO_TO_DEVICE, B * R * row_bytes, 0);
+  } else if (new_rows > 0) {
+    for (size_t b = 0; b < B; ++b) {
+      bo.sync(XCL_BO_SYNC_BO_TO_DEVICE, new_rows * row_bytes,
+              (b * R + cached_rows) * row_bytes);
+    }
+  }
+}
+
 template <typename InT, typename WtT, typename OutT>
 std::vector<xrt::bo> bmm<InT, WtT, OutT>::allocate_inputs() {
   size_t B_BO_SIZE = kernel_y_shape_[0] * kernel_y_shape_[1] * b_dtype_size_;
@@ -384,14 +465,20 @@ std::vector<xrt::bo> bmm<InT, WtT, OutT>::allocate_outputs() {
 template <typename InT, typename WtT, typename OutT>
 void bmm<InT, WtT, OutT>::execute(std::vector<xrt::bo> &input,
                                   std::vector<xrt::bo> &output) {
-  // launch the BMM kernel
-  run = kernel_(2, instr_bo, instr_bo_words,
-                input[0].address() + DDR_AIE_ADDR_OFFSET,
-                input[1].address() + DDR_AIE_ADDR_OFFSET,
-                output[0].address() + DDR_AIE_ADDR_OFFSET, 0, 0);
+  run = submit(input, output);
   run.wait2();
 }
 
+template <typename InT, typename WtT, typename OutT>
+xrt::run bmm<InT, WtT, OutT>::submit(std::vector<xrt::bo> &input,
+                                     std::vector<xrt::bo> &output) {
+  // launch the BMM kernel
+  return kernel_(2, instr_bo, instr_bo_words,
+                 input[0].address() + DDR_AIE_ADDR_OFFSET,
+                 input[1].address() + DDR_AIE_ADDR_OFFSET,
+                 output[0].address() + DDR_AIE_ADDR_OFFSET, 0, 0);
+}
+
 /*
  * method to set debug flag
  *
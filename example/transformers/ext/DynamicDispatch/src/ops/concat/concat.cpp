@@ -474,6 +474,30 @@ std::vector<OpArgMap> concat<InT, OutT>::get_buffer_reqs(
   return arg_map;
 }
 
+template <typename InT, typename OutT>
+std::vector<OpTensorView> concat<InT, OutT>::get_tensor_views(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  auto [MA, KA] = extract_MK(input.at(0));
+  auto [MB, KB] = extract_MK(input.at(1));
+  size_t N = input.size() - 2;
+  std::vector<size_t> input_shape = {MA, KA, MB, KB, N};
+  auto mapped_shape = map_padded_shape(input_shape);
+
+  // Each row is concatenated, only single unpadded rows are contiguous.
+  if (MA != 1 || MB != 1 ||
+      mapped_shape != std::vector<size_t>{MA, KA, MB, KB, N} ||
+      sizeof(InT) != sizeof(OutT)) {
+    return {};
+  }
+  size_t out_idx = input.size() - 1;
+  std::vector<OpTensorView> views{{out_idx, 0, 0}};
+  for (size_t n = 0; n < N; n++) {
+    views.push_back({out_idx, 1 + n, (KA + n * KB) * sizeof(InT)});
+  }
+  return views;
+}
+
 template class concat<uint16_t, uint16_t>;
 
 } // namespace ryzenai
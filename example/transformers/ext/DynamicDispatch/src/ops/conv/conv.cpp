@@ -2,6 +2,7 @@
  * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
  */
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -21,6 +22,7 @@
 #include <ops/ops_common/help_file.hpp>
 #include <utils/logging.hpp>
 #include <utils/tfuncs.hpp>
+#include <utils/utils.hpp>
 
 #include "txn_helper/txn_helper.hpp"
 #include "utils/dpu_mdata.hpp"
@@ -318,8 +320,7 @@ conv<InT, WtT, OutT>::conv(const std::string &ifmDtype,
   std::string lp_key = GetParamKey(convData_, zp_, inputShape_[0],
                                    outputShape_[0], weightShape_[0]) +
                        "_lp";
-  std::string lp_binary = txn_handler.get_txn_str(lp_key);
-  txn_handler.GetBinData(lp_binary, lp, false);
+  txn_handler.get_txn_bin(lp_key, lp);
   foldWts_ = lp[19];
 
   std::call_once(logger_flag_, []() {
@@ -375,69 +376,96 @@ void conv<InT, WtT, OutT>::dumpBinary(void *src, size_t length,
 }
 
 template <typename InT, typename WtT, typename OutT>
-int64_t conv<InT, WtT, OutT>::ConcatenateWeightParams(
-    void *dest, const std::vector<WtsListType> &wts_list,
-    const std::vector<std::vector<int32_t>> &qdq_list, /* uint8_t *lp,*/
-    int ifm_depth, int cstride, int ksize_x, int ksize_y) {
-
-  auto concatenateWeightParamsLength = 0;
-  uint8_t *dstWeightBuffer = (uint8_t *)dest;
-
-  for (size_t it = 0; it < wts_list.size(); ++it) {
-    std::vector<WtT> w_vals;
+size_t conv<InT, WtT, OutT>::TileWtsSize(const WtsTile &tile, int istride,
+                                         int ksize_x, int ksize_y) {
+  size_t num_o = (tile.Cout + 7) / 8 * 8;
+  size_t num_i = (tile.Cin + istride - 1) / istride;
+  return num_o * num_i * ksize_y * ksize_x;
+}
 
-    memcpy(dstWeightBuffer, lp.data(), 64 * sizeof(uint8_t));
-    concatenateWeightParamsLength += 64 * sizeof(uint8_t);
-    dstWeightBuffer += 64 * sizeof(uint8_t);
+template <typename InT, typename WtT, typename OutT>
+void conv<InT, WtT, OutT>::FormatWtsTiles(void *dest, const WtsTensor &wts,
+                                          const std::vector<WtsTile> &tiles,
+                                          int istride, int i_inner,
+                                          int ksize_x, int ksize_y) {
+  std::vector<std::pair<size_t, int64_t>> blocks;
+  for (size_t it = 0; it < tiles.size(); ++it) {
+    const auto &tile = tiles[it];
+    auto num_i = (tile.Cin + istride - 1) / istride;
+    DOD_ASSERT(num_i == 0 ||
+                   (tile.o_begin + (tile.Cout + 7) / 8 * 8 <= wts.Co &&
+                    tile.i_begin + (num_i - 1) * istride + i_inner <= wts.Ci &&
+                    ksize_y <= wts.Ky && ksize_x <= wts.Kx),
+               "Conv weight subvolume is out of the weight tensor");
+    for (int64_t o = 0; o < tile.Cout; o += 8) {
+      blocks.emplace_back(it, o);
+    }
+  }
 
-    int istride = std::min(ifm_depth, cstride);
-    int ostride = 8;
-    int Cout = wts_list[it].size();
-    int Cin = wts_list[it][0].size();
-
-    auto wtsListMember = wts_list[it];
-    for (int o = 0; o < Cout; o += ostride) {
-      for (int i = 0; i < Cin; i += istride) {
-        for (int y = 0; y < ksize_y; ++y) {
-          for (int x = 0; x < ksize_x; ++x) {
-            for (int i_idx = i; i_idx < i + istride; ++i_idx) {
-              for (int o_idx = 0; o_idx < 8; ++o_idx) {
-                auto w_val = wts_list[it][o + o_idx][i_idx][y][x];
-                w_vals.push_back(w_val);
-              }
+  // each block of 8 output channels is a contiguous run of the tile
+  Utils::parallel_for(blocks.size(), [&](size_t b) {
+    const auto &[it, o] = blocks[b];
+    const auto &tile = tiles[it];
+    auto num_i = (tile.Cin + istride - 1) / istride;
+    auto block_size = num_i * ksize_y * ksize_x * i_inner * 8;
+    WtT *dst = (WtT *)((uint8_t *)dest + tile.offset) + (o / 8) * block_size;
+    const auto o_stride = wts.Ci * wts.Ky * wts.Kx;
+    for (int64_t i = 0; i < tile.Cin; i += istride) {
+      for (int y = 0; y < ksize_y; ++y) {
+        for (int x = 0; x < ksize_x; ++x) {
+          for (int i_idx = 0; i_idx < i_inner; ++i_idx) {
+            const WtT *src =
+                &wts.at(tile.o_begin + o, tile.i_begin + i + i_idx, y, x);
+            for (int o_idx = 0; o_idx < 8; ++o_idx) {
+              *dst++ = src[o_idx * o_stride];
             }
           }
         }
       }
     }
+  });
+}
+
+template <typename InT, typename WtT, typename OutT>
+int64_t conv<InT, WtT, OutT>::ConcatenateWeightParams(
+    void *dest, const WtsTensor &wts, std::vector<WtsTile> &tiles,
+    int cstride) {
+
+  int64_t concatenateWeightParamsLength = 0;
+  uint8_t *dstWeightBuffer = (uint8_t *)dest;
+
+  int istride = std::min((int)wts.Ci, cstride);
+  for (auto &tile : tiles) {
+    memcpy(dstWeightBuffer, lp.data(), 64 * sizeof(uint8_t));
+    concatenateWeightParamsLength += 64 * sizeof(uint8_t);
+    dstWeightBuffer += 64 * sizeof(uint8_t);
 
-    memcpy(dstWeightBuffer, w_vals.data(), sizeof(WtT) * w_vals.size());
-    concatenateWeightParamsLength += sizeof(WtT) * w_vals.size();
-    dstWeightBuffer += sizeof(WtT) * w_vals.size();
+    tile.offset = concatenateWeightParamsLength;
+    auto wtsSize =
+        sizeof(WtT) * TileWtsSize(tile, istride, wts.Kx, wts.Ky) * istride;
+    concatenateWeightParamsLength += wtsSize;
+    dstWeightBuffer += wtsSize;
 
-    memcpy(dstWeightBuffer, qdq_list[it].data(),
-           sizeof(int32_t) * qdq_list[it].size());
-    concatenateWeightParamsLength += sizeof(int32_t) * qdq_list[it].size();
-    dstWeightBuffer += sizeof(int32_t) * qdq_list[it].size();
+    memcpy(dstWeightBuffer, tile.qdq.data(), sizeof(int32_t) * tile.qdq.size());
+    concatenateWeightParamsLength += sizeof(int32_t) * tile.qdq.size();
+    dstWeightBuffer += sizeof(int32_t) * tile.qdq.size();
   }
+
+  FormatWtsTiles(dest, wts, tiles, istride, istride, wts.Kx, wts.Ky);
   return concatenateWeightParamsLength;
 }
 
 /* Concat weight params for convA16W16 */
 template <typename InT, typename WtT, typename OutT>
 int64_t conv<InT, WtT, OutT>::ConcatenateWeightParams(
-    void *dest, const std::vector<WtsListType> &wts_list,
-    const std::vector<uint8_t> &conv_lp,
-    const std::vector<std::vector<int32_t>> &qdq_list,
-    /* uint8_t *lp,*/
-    int ifm_depth, int cstride, int ksize_x, int ksize_y) {
+    void *dest, const WtsTensor &wts, std::vector<WtsTile> &tiles,
+    const std::vector<uint8_t> &conv_lp, int cstride) {
 
-  auto concatenateWeightParamsLength = 0;
+  int64_t concatenateWeightParamsLength = 0;
   uint8_t *dstWeightBuffer = (uint8_t *)dest;
-  for (size_t it = 0; it < wts_list.size(); ++it) {
-    int id = 0;
-    std::vector<WtT> w_vals;
 
+  int istride = std::min((int)wts.Ci, cstride);
+  for (auto &tile : tiles) {
     // dd lp
     memcpy(dstWeightBuffer, lp.data(), 64 * sizeof(uint8_t));
     concatenateWeightParamsLength += 64 * sizeof(uint8_t);
@@ -449,36 +477,18 @@ int64_t conv<InT, WtT, OutT>::ConcatenateWeightParams(
     dstWeightBuffer += 64 * sizeof(uint8_t);
 
     // qdq
-    memcpy(dstWeightBuffer, qdq_list[it].data(),
-           sizeof(int32_t) * qdq_list[it].size());
-    concatenateWeightParamsLength += sizeof(int32_t) * qdq_list[it].size();
-    dstWeightBuffer += sizeof(int32_t) * qdq_list[it].size();
-
-    int istride = std::min(ifm_depth, cstride);
-    int ostride = 8;
-    int Cout = wts_list[it].size();
-    int Cin = wts_list[it][0].size();
-
-    auto wtsListMember = wts_list[it];
-    for (int o = 0; o < Cout; o += ostride) {
-      for (int i = 0; i < Cin; i += istride) {
-        for (int y = 0; y < ksize_y; ++y) {
-          for (int x = 0; x < ksize_x; ++x) {
-            for (int i_idx = i; i_idx < i + istride; ++i_idx) {
-              for (int o_idx = 0; o_idx < 8; ++o_idx) {
-                auto w_val = wts_list[it][o + o_idx][i_idx][y][x];
-                w_vals.push_back(w_val);
-              }
-            }
-          }
-        }
-      }
-    }
-
-    memcpy(dstWeightBuffer, w_vals.data(), sizeof(WtT) * w_vals.size());
-    concatenateWeightParamsLength += sizeof(WtT) * w_vals.size();
-    dstWeightBuffer += sizeof(WtT) * w_vals.size();
+    memcpy(dstWeightBuffer, tile.qdq.data(), sizeof(int32_t) * tile.qdq.size());
+    concatenateWeightParamsLength += sizeof(int32_t) * tile.qdq.size();
+    dstWeightBuffer += sizeof(int32_t) * tile.qdq.size();
+
+    tile.offset = concatenateWeightParamsLength;
+    auto wtsSize =
+        sizeof(WtT) * TileWtsSize(tile, istride, wts.Kx, wts.Ky) * istride;
+    concatenateWeightParamsLength += wtsSize;
+    dstWeightBuffer += wtsSize;
   }
+
+  FormatWtsTiles(dest, wts, tiles, istride, istride, wts.Kx, wts.Ky);
   return concatenateWeightParamsLength;
 }
 
@@ -526,47 +536,35 @@ conv<InT, WtT, OutT>::qdq_header(int64_t *qdq, int32_t ofm_height,
 
   return header;
 }
+template <typename InT, typename WtT, typename OutT>
+typename conv<InT, WtT, OutT>::WtsTensor
+conv<InT, WtT, OutT>::ReadWts(const Tensor &weights) {
+  const auto &shape = weights.shape;
+  WtsTensor wts(shape[0], shape[1], shape[2], shape[3]);
+  memcpy(wts.data.data(), weights.data, wts.data.size() * sizeof(WtT));
+  return wts;
+}
+
 /* Below is required for zero padding for 7x7 kernel with stride 4 only */
 template <typename InT, typename WtT, typename OutT>
-std::vector<std::vector<std::vector<std::vector<WtT>>>>
-conv<InT, WtT, OutT>::TransformWts(const WtsListType &wts, uint8_t ksize_x,
+typename conv<InT, WtT, OutT>::WtsTensor
+conv<InT, WtT, OutT>::TransformWts(const WtsTensor &wts, uint8_t ksize_x,
                                    uint8_t ksize_y, uint8_t wts_zp) {
-  WtsListType wt_pad(wts.size(),
-                     std::vector<std::vector<std::vector<WtT>>>(
-                         wts[0].size() + 1,
-                         std::vector<std::vector<WtT>>(
-                             ksize_y, std::vector<WtT>(ksize_x + 1, wts_zp))));
-
-  for (size_t i = 0; i < wts.size(); i++) {
-    for (size_t j = 0; j < 3; j++) {
-      for (size_t y = 0; y < ksize_y; y++) {
-        for (size_t x = 0; x < ksize_x; x++) {
-          wt_pad[i][j][y][x] = wts[i][j][y][x];
-        }
-      }
-    }
-  }
-
-  for (size_t i = 0; i < wts.size(); i++) {
-    for (size_t y = 0; y < ksize_y; y++) {
-      for (size_t x = 0; x < ksize_x; x++) {
-        wt_pad[i][3][y][x] = 0;
-      }
+  /* 3 channels of wts, a 4th one of zeros and one more column of zp */
+  auto wt_pad = [&](int64_t i, int64_t j, int64_t y, int64_t x) -> WtT {
+    if (x >= ksize_x) {
+      return wts_zp;
     }
-  }
-
-  WtsListType wt_new(wts.size(),
-                     std::vector<std::vector<std::vector<WtT>>>(
-                         (wts[0].size() + 1) * 2,
-                         std::vector<std::vector<WtT>>(
-                             ksize_y, std::vector<WtT>((ksize_x + 1) / 2, 0))));
-
-  for (size_t i = 0; i < wts.size(); i++) {
-    for (size_t k = 0; k < (ksize_x + 1) / 2; k++) {
-      for (size_t j = 0; j < 4; j++) {
-        for (size_t y = 0; y < ksize_y; y++) {
-          wt_new[i][j][y][k] = wt_pad[i][j][y][2 * k];
-          wt_new[i][j + 4][y][k] = wt_pad[i][j][y][2 * k + 1];
+    return (j < 3) ? wts.at(i, j, y, x) : 0;
+  };
+
+  WtsTensor wt_new(wts.Co, (wts.Ci + 1) * 2, ksize_y, (ksize_x + 1) / 2);
+  for (int64_t i = 0; i < wts.Co; i++) {
+    for (int64_t k = 0; k < (ksize_x + 1) / 2; k++) {
+      for (int64_t j = 0; j < 4; j++) {
+        for (int64_t y = 0; y < ksize_y; y++) {
+          wt_new.at(i, j, y, k) = wt_pad(i, j, y, 2 * k);
+          wt_new.at(i, j + 4, y, k) = wt_pad(i, j, y, 2 * k + 1);
         }
       }
     }
@@ -579,28 +577,18 @@ conv<InT, WtT, OutT>::TransformWts(const WtsListType &wts, uint8_t ksize_x,
  * than the ifm is zero padded. Accordingly the weights should be padded with zp
  * value in the layer parameter */
 template <typename InT, typename WtT, typename OutT>
-std::vector<std::vector<std::vector<std::vector<WtT>>>>
-conv<InT, WtT, OutT>::TransformWtsWithZp(const WtsListType &wtsOld) {
-  WtsListType wts(
-      kernelWeightShape_[0],
-      vector<vector<vector<WtT>>>(
-          64, vector<vector<WtT>>(kernelWeightShape_[2],
-                                  vector<WtT>(kernelWeightShape_[3]))));
+typename conv<InT, WtT, OutT>::WtsTensor
+conv<InT, WtT, OutT>::TransformWtsWithZp(const WtsTensor &wtsOld) {
+  auto wts_zp = lp[46];
+  WtsTensor wts(kernelWeightShape_[0], 64, kernelWeightShape_[2],
+                kernelWeightShape_[3], wts_zp);
 
   // Copy existing elements from 'wtsOld' to 'wts'
-  for (size_t i = 0; i < wtsOld.size(); ++i) {
-    for (size_t j = 0; j < wtsOld[i].size(); ++j) {
-      wts[i][j] = wtsOld[i][j];
-    }
-  }
-
-  auto wts_zp = lp[46];
-  // Initialize the new members with 'zp'
-  for (size_t i = 0; i < wts.size(); ++i) {
-    for (size_t j = wtsOld[i].size(); j < wts[i].size(); ++j) {
-      for (size_t k = 0; k < wts[i][j].size(); ++k) {
-        for (size_t l = 0; l < wts[i][j][k].size(); ++l) {
-          wts[i][j][k][l] = wts_zp;
+  for (int64_t i = 0; i < std::min(wtsOld.Co, wts.Co); ++i) {
+    for (int64_t j = 0; j < std::min(wtsOld.Ci, wts.Ci); ++j) {
+      for (int64_t k = 0; k < std::min(wtsOld.Ky, wts.Ky); ++k) {
+        for (int64_t l = 0; l < std::min(wtsOld.Kx, wts.Kx); ++l) {
+          wts.at(i, j, k, l) = wtsOld.at(i, j, k, l);
         }
       }
     }
@@ -646,30 +634,8 @@ void conv<InT, WtT, OutT>::initialize_const_params_conv(
   auto dp = int(ifm_depth_iters * ifm_sv_depth / ch_in_depth_split);
   auto cstride = (int)8;
 
-  auto wtsIn = (WtT *)const_params.at(0).data;
-  auto wtsInShape = const_params.at(0).shape;
   auto wtsInType = const_params.at(0).dtype;
-  WtsListType wts;
-
-  WtsListType wtsTensor(
-      wtsInShape[0],
-      vector<vector<vector<WtT>>>(
-          wtsInShape[1],
-          vector<vector<WtT>>(wtsInShape[2], vector<WtT>(wtsInShape[3]))));
-
-  for (int i = 0; i < wtsInShape[0]; ++i) {
-    for (int j = 0; j < wtsInShape[1]; ++j) {
-      for (int k = 0; k < wtsInShape[2]; ++k) {
-        for (int l = 0; l < wtsInShape[3]; ++l) {
-          wtsTensor[i][j][k][l] =
-              wtsIn[(i * wtsInShape[1] * wtsInShape[2] * wtsInShape[3]) +
-                    (j * wtsInShape[2] * wtsInShape[3]) + (k * wtsInShape[3]) +
-                    l];
-        }
-      }
-    }
-  }
-  wts = wtsTensor;
+  auto wts = ReadWts(const_params.at(0));
 
   /* Zero padding applicalbe for 7x7/s4*/
   if (foldWts_) {
@@ -688,8 +654,7 @@ void conv<InT, WtT, OutT>::initialize_const_params_conv(
   std::string qdq_key = GetParamKey(convData_, zp_, inputShape_[0],
                                     outputShape_[0], weightShape_[0]) +
                         "_qdq";
-  std::string qdq_binary = txn_handler.get_txn_str(qdq_key);
-  txn_handler.GetBinData(qdq_binary, qdq, false);
+  txn_handler.get_txn_bin(qdq_key, qdq);
 
   int qdqParamsSize = 3;
   std::vector<int32_t> qdqParams;
@@ -702,75 +667,53 @@ void conv<InT, WtT, OutT>::initialize_const_params_conv(
     std::string conv_lp_key = GetParamKey(convData_, zp_, inputShape_[0],
                                           outputShape_[0], weightShape_[0]) +
                               "_convlp";
-    std::string conv_lp_params_binary = txn_handler.get_txn_str(conv_lp_key);
-    txn_handler.GetBinData(conv_lp_params_binary, conv_lp, false);
+    txn_handler.get_txn_bin(conv_lp_key, conv_lp);
   } else {
     std::string qdq_key_params = GetParamKey(convData_, zp_, inputShape_[0],
                                              outputShape_[0], weightShape_[0]) +
                                  "_qdq_params";
-    std::string qdq_params_binary = txn_handler.get_txn_str(qdq_key_params);
-    txn_handler.GetBinData(qdq_params_binary, qdqParams, false);
+    txn_handler.get_txn_bin(qdq_key_params, qdqParams);
   }
 
-  std::vector<WtsListType> wts_list;
-  std::vector<std::vector<int32_t>> qdq_list;
-
+  std::vector<WtsTile> tiles;
   for (int32_t och_iter = 0; och_iter < ofm_depth_iters; och_iter++) {
-    auto start_och = och_iter * cout_per_ch_iter;
-    auto end_och = (och_iter + 1) * cout_per_ch_iter;
-    auto wt_och_iter =
-        WtsListType(wts.begin() + start_och, wts.begin() + end_och);
-
     for (int32_t kk = 0; kk < ch_in_depth_split; kk++) {
       for (int32_t wt_strms = 0; wt_strms < num_wt_streams; wt_strms++) {
-        auto start_wt_strms = wt_strms * cout_per_stream;
-        auto end_wt_strms = (wt_strms + 1) * cout_per_stream;
-        auto wt_strm_data = WtsListType(wt_och_iter.begin() + start_wt_strms,
-                                        wt_och_iter.begin() + end_wt_strms);
+        auto start_och =
+            och_iter * cout_per_ch_iter + wt_strms * cout_per_stream;
+        auto end_och = start_och + cout_per_stream;
 
         int start = 0;
         int end = static_cast<int>(
             ceil(ifm_depth_iters / static_cast<double>(ch_in_depth_split)));
 
         for (int32_t ich_iter = start; ich_iter < end; ich_iter++) {
+          WtsTile tile;
           if (wtsInType == "uint16") {
-            qdq_list.push_back(qdq_header(
-                qdq.data(), ofm_sv_height, ofm_sv_width,
-                och_iter * cout_per_ch_iter + wt_strms * cout_per_stream,
-                och_iter * cout_per_ch_iter + end_wt_strms));
+            tile.qdq = qdq_header(qdq.data(), ofm_sv_height, ofm_sv_width,
+                                  start_och, end_och);
           } else {
-            qdq_list.push_back(qdq_header(
-                qdq.data(), qdqParams.data(), ofm_sv_height, ofm_sv_width,
-                och_iter * cout_per_ch_iter + wt_strms * cout_per_stream,
-                och_iter * cout_per_ch_iter + end_wt_strms));
+            tile.qdq = qdq_header(qdq.data(), qdqParams.data(), ofm_sv_height,
+                                  ofm_sv_width, start_och, end_och);
           }
-
-          WtsListType sub_tensor;
-          for (const auto &o : wt_strm_data) {
-            std::vector<std::vector<std::vector<WtT>>> wts_o;
-            for (int i = kk * dp + ich_iter * ifm_sv_depth;
-                 i < kk * dp + (ich_iter + 1) * ifm_sv_depth &&
-                 i < static_cast<int>(o.size());
-                 i++) {
-              wts_o.push_back(o[i]);
-            }
-            sub_tensor.push_back(wts_o);
-          }
-          wts_list.push_back(sub_tensor);
+          tile.o_begin = start_och;
+          tile.Cout = cout_per_stream;
+          tile.i_begin = kk * dp + ich_iter * ifm_sv_depth;
+          tile.Cin = std::max<int64_t>(
+              std::min<int64_t>(ifm_sv_depth, wts.Ci - tile.i_begin), 0);
+          tiles.push_back(std::move(tile));
         }
       }
     }
   }
 
-  auto concatenateWeightParamsLength = 0;
+  int64_t concatenateWeightParamsLength = 0;
   if (wtsInType == "uint16") {
-    concatenateWeightParamsLength = ConcatenateWeightParams(
-        dest, wts_list, conv_lp, qdq_list, wts[0].size(), cstride,
-        wts[0][0][0].size(), wts[0][0].size());
+    concatenateWeightParamsLength =
+        ConcatenateWeightParams(dest, wts, tiles, conv_lp, cstride);
   } else {
     concatenateWeightParamsLength =
-        ConcatenateWeightParams(dest, wts_list, qdq_list, wts[0].size(),
-                                cstride, wts[0][0][0].size(), wts[0][0].size());
+        ConcatenateWeightParams(dest, wts, tiles, cstride);
   }
 
   if (debug_ == true) {
@@ -780,56 +723,37 @@ void conv<InT, WtT, OutT>::initialize_const_params_conv(
 
 template <typename InT, typename WtT, typename OutT>
 int64_t conv<InT, WtT, OutT>::ConcatenateWeightParams_dwc(
-    void *dest, const std::vector<WtsListType> &wts_list,
-    const std::vector<std::vector<int32_t>> &qdq_list, int ifm_depth,
-    int cstride, int ksize_x, int ksize_y) {
+    void *dest, const WtsTensor &wts, std::vector<WtsTile> &tiles,
+    int ifm_depth, int cstride, int ksize_x, int ksize_y) {
 
-  auto concatenateWeightParamsLength = 0;
+  int64_t concatenateWeightParamsLength = 0;
   WtT *dstWeightBuffer = (WtT *)dest;
-  for (size_t it = 0; it < wts_list.size(); ++it) {
-    std::vector<WtT> w_vals;
 
+  int istride = std::min(ifm_depth, cstride);
+  for (auto &tile : tiles) {
     memcpy(dstWeightBuffer, lp.data(), 64 * sizeof(WtT));
     concatenateWeightParamsLength += 64 * sizeof(WtT);
     dstWeightBuffer += 64 * sizeof(WtT);
 
-    int istride = std::min(ifm_depth, cstride);
-    int ostride = 8;
-    int Cout = wts_list[it].size();
-    int Cin = wts_list[it][0].size();
-
-    auto wtsListMember = wts_list[it];
-    for (int o = 0; o < Cout; o += ostride) {
-      for (int i = 0; i < Cin; i += istride) {
-        for (int y = 0; y < ksize_y; ++y) {
-          for (int x = 0; x < ksize_x; ++x) {
-            for (int o_idx = 0; o_idx < 8; ++o_idx) {
-              auto w_val = wts_list[it][o + o_idx][i][y][x];
-              w_vals.push_back(w_val);
-            }
-          }
-        }
-      }
-    }
-
-    int zeroPadForAlignmentLength = (64 - (w_vals.size() % 64));
+    tile.offset = (dstWeightBuffer - (WtT *)dest) * sizeof(WtT);
+    auto wtsSize = TileWtsSize(tile, istride, ksize_x, ksize_y);
+    int zeroPadForAlignmentLength = (64 - (wtsSize % 64));
 
-    memcpy(dstWeightBuffer, w_vals.data(), sizeof(WtT) * w_vals.size());
     concatenateWeightParamsLength +=
-        sizeof(WtT) * (w_vals.size() + zeroPadForAlignmentLength);
-    dstWeightBuffer +=
-        sizeof(WtT) * (w_vals.size() + zeroPadForAlignmentLength);
+        sizeof(WtT) * (wtsSize + zeroPadForAlignmentLength);
+    dstWeightBuffer += sizeof(WtT) * (wtsSize + zeroPadForAlignmentLength);
 
-    int qdqSizeInBytes = qdq_list[it].size() * sizeof(int32_t);
+    int qdqSizeInBytes = tile.qdq.size() * sizeof(int32_t);
     zeroPadForAlignmentLength = (64 - (qdqSizeInBytes % 64));
 
-    memcpy(dstWeightBuffer, qdq_list[it].data(),
-           sizeof(int32_t) * qdq_list[it].size());
+    memcpy(dstWeightBuffer, tile.qdq.data(), sizeof(int32_t) * tile.qdq.size());
     concatenateWeightParamsLength +=
-        sizeof(int32_t) * qdq_list[it].size() + zeroPadForAlignmentLength;
+        sizeof(int32_t) * tile.qdq.size() + zeroPadForAlignmentLength;
     dstWeightBuffer +=
-        sizeof(int32_t) * qdq_list[it].size() + zeroPadForAlignmentLength;
+        sizeof(int32_t) * tile.qdq.size() + zeroPadForAlignmentLength;
   }
+
+  FormatWtsTiles(dest, wts, tiles, istride, 1, ksize_x, ksize_y);
   return concatenateWeightParamsLength;
 }
 
@@ -867,29 +791,7 @@ void conv<InT, WtT, OutT>::initialize_const_params_dwc(
   auto rep_count = int(lp[8]);
   auto cstride = (int)8;
 
-  auto wtsIn = (WtT *)const_params.at(0).data;
-  auto wtsInShape = const_params.at(0).shape;
-  WtsListType wts;
-
-  WtsListType wtsTensor(
-      wtsInShape[0],
-      vector<vector<vector<WtT>>>(
-          wtsInShape[1],
-          vector<vector<WtT>>(wtsInShape[2], vector<WtT>(wtsInShape[3]))));
-
-  for (int i = 0; i < wtsInShape[0]; ++i) {
-    for (int j = 0; j < wtsInShape[1]; ++j) {
-      for (int k = 0; k < wtsInShape[2]; ++k) {
-        for (int l = 0; l < wtsInShape[3]; ++l) {
-          wtsTensor[i][j][k][l] =
-              wtsIn[(i * wtsInShape[1] * wtsInShape[2] * wtsInShape[3]) +
-                    (j * wtsInShape[2] * wtsInShape[3]) + (k * wtsInShape[3]) +
-                    l];
-        }
-      }
-    }
-  }
-  wts = wtsTensor;
+  auto wts = ReadWts(const_params.at(0));
 
   auto qdqSize = outputShape_[0];
   std::vector<int64_t> qdq;
@@ -897,8 +799,7 @@ void conv<InT, WtT, OutT>::initialize_const_params_dwc(
   std::string qdq_key = GetParamKey(convData_, zp_, inputShape_[0],
                                     outputShape_[0], weightShape_[0]) +
                         "_qdq";
-  std::string qdq_binary = txn_handler.get_txn_str(qdq_key);
-  txn_handler.GetBinData(qdq_binary, qdq, false);
+  txn_handler.get_txn_bin(qdq_key, qdq);
 
   int qdqParamsSize = 3;
   std::vector<int32_t> qdqParams;
@@ -906,25 +807,26 @@ void conv<InT, WtT, OutT>::initialize_const_params_dwc(
   std::string qdq_key_params = GetParamKey(convData_, zp_, inputShape_[0],
                                            outputShape_[0], weightShape_[0]) +
                                "_qdq_params";
-  std::string qdq_params_binary = txn_handler.get_txn_str(qdq_key_params);
-  txn_handler.GetBinData(qdq_params_binary, qdqParams, false);
+  txn_handler.get_txn_bin(qdq_key_params, qdqParams);
 
-  std::vector<WtsListType> wts_list;
-  std::vector<std::vector<int32_t>> qdq_list;
+  std::vector<WtsTile> tiles;
   for (int32_t rep = 0; rep < rep_count; rep++) {
     for (int32_t i = 0; i < ifm_depth_iters; i++) {
       auto start_och = i * ofm_sv_depth;
       auto end_och = (i + 1) * ofm_sv_depth;
-      auto wt_och_iter =
-          WtsListType(wts.begin() + start_och, wts.begin() + end_och);
-      wts_list.push_back(wt_och_iter);
-      qdq_list.push_back(qdq_header(qdq.data(), qdqParams.data(), ofm_sv_height,
-                                    ofm_sv_width, start_och, end_och));
+      WtsTile tile;
+      tile.o_begin = start_och;
+      tile.Cout = ofm_sv_depth;
+      tile.i_begin = 0;
+      tile.Cin = wts.Ci;
+      tile.qdq = qdq_header(qdq.data(), qdqParams.data(), ofm_sv_height,
+                            ofm_sv_width, start_och, end_och);
+      tiles.push_back(std::move(tile));
     }
   }
 
   auto concatenateWeightParamsLength = ConcatenateWeightParams_dwc(
-      dest, wts_list, qdq_list, ifm_depth, cstride, ksize_x, ksize_y);
+      dest, wts, tiles, ifm_depth, cstride, ksize_x, ksize_y);
   if (debug_ == true) {
     WriteToFile(dest, concatenateWeightParamsLength);
   }
@@ -721,6 +721,11 @@ const std::vector<uint8_t> elw_add<InT, WtT, OutT>::get_super_kernel_params(
   return data;
 }
 
+template <typename InT, typename WtT, typename OutT>
+size_t elw_add<InT, WtT, OutT>::get_const_params_bo_size() {
+  return matmul_matrix::QDQparam_size * sizeof(int32_t);
+}
+
 template <typename InT, typename WtT, typename OutT>
 std::vector<OpArgMap> elw_add<InT, WtT, OutT>::get_buffer_reqs(
     std::vector<Tensor> &input, std::vector<Tensor> &output,
@@ -729,7 +734,7 @@ std::vector<OpArgMap> elw_add<InT, WtT, OutT>::get_buffer_reqs(
 
   auto [Mo, No] = map_padded_shape(M, N);
 
-  size_t const_params_bo_size = matmul_matrix::QDQparam_size * sizeof(int32_t);
+  size_t const_params_bo_size = get_const_params_bo_size();
   size_t input_1_bo_size = (Mo * No * sizeof(InT));
   size_t input_2_bo_size = (Mo * No * sizeof(WtT));
   size_t output_bo_size = (Mo * No * sizeof(OutT));
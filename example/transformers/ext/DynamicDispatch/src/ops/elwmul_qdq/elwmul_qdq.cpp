@@ -33,6 +33,7 @@
 #include "xaiengine.h"
 
 #include "ops/ops_common/matmul_matrix.hpp"
+#include "ops/ops_common/qdq_fold.hpp"
 
 using namespace matmul_matrix;
 
@@ -327,6 +328,9 @@ void elwmul_qdq<InT, WtT, OutT>::initialize_const_params(
   qdq_params[5] = temp;
   auto qdq_params_size = matmul_matrix::QDQparam_size * sizeof(int32_t);
   memcpy((void *)dest, (void *)qdq_params, qdq_params_size);
+  // [6] : dequantize input a, [7] : quantize output
+  qdq_fold::clear_folded_flags(static_cast<int32_t *>(dest),
+                               qdq_fold::get_folded(attr), 6, 7);
 
   RYZENAI_LOG_TRACE("elwmul_qdq initialize_const_params(ptr) ... DONE");
 }
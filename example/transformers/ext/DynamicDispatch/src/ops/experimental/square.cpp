@@ -114,6 +114,7 @@ void square<InT, OutT>::initialize_const_params(
   output_bo_ =
       xrt::bo(xrt_ctx_->get_device(), 32 * sizeof(InT), XRT_BO_FLAGS_HOST_ONLY,
               xrt_ctx_->get_kernel().group_id(0));
+  pm_load(true).preload("square", "int32");
 }
 
 template <typename InT, typename OutT>
@@ -180,8 +180,7 @@ gap<InT, OutT>::gap(const std::string &ifmDtype, const std::string &ofmDtype,
   std::string lp_key = GetParamKey("gapData_layer", zp_, inputShape_[0],
                                    inputShape_[1], inputShape_[2]) +
                        "_lp";
-  std::string lp_binary = txn_handler.get_txn_str(lp_key);
-  txn_handler.GetBinData(lp_binary, lp, false);
+  txn_handler.get_txn_bin(lp_key, lp);
 
   std::call_once(logger_flag_, []() {
     std::string header = "gap_id (K Mi0 Mi1) Execute"
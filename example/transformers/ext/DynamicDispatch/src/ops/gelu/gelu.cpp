@@ -25,7 +25,7 @@
 #include <utils/txn_container.hpp>
 #include <xrt_context/xrt_context.hpp>
 
-#include "ops/ops_common/gelu_lut_bf16_512.h"
+#include "ops/ops_common/lut_store.hpp"
 #include "ops/ops_common/matmul_matrix.hpp"
 // #include "ops/ops_common/silu_lut_bf16_512.h"
 #include <ops/gelu/gelu.hpp>
@@ -152,11 +152,8 @@ std::vector<OpArgMap> gelu<InT, WtT, OutT>::get_buffer_reqs(
   auto [M, N] = extract_MK(input);
   auto [Mo, No] = map_padded_shape(M, N);
 
-  int const gelu_lut_ab_size = sizeof(lnr_lutab);
-  int const gelu_lut_cd_size = sizeof(lnr_lutcd);
-
   size_t const_params_bo_size =
-      (gelu_lut_ab_size + gelu_lut_cd_size +
+      (lut_store::gelu_bf16().size() +
        matmul_matrix::QDQparam_size * sizeof(int16_t));
   size_t input_bo_size = (Mo * No * sizeof(InT));
   size_t output_bo_size = (Mo * No * sizeof(OutT));
@@ -365,17 +362,10 @@ void gelu<InT, WtT, OutT>::initialize_const_params(
   auto w_dest = (WtT *)dest;
   auto qdq_params_size = matmul_matrix::QDQparam_size * sizeof(int16_t);
 
-  int const gelu_size_lutab = sizeof(lnr_lutab);
-  int const gelu_size_lutcd = sizeof(lnr_lutcd);
-
-  // int const gelu_offset = silu_size_lutab + silu_size_lutcd;
+  const auto &lut = lut_store::gelu_bf16();
+  memcpy(dest, lut.data(), lut.size());
 
-  memcpy((void *)(static_cast<int8_t *>(dest)), (void *)lnr_lutab,
-         gelu_size_lutab);
-  memcpy((void *)(static_cast<int8_t *>(dest) + gelu_size_lutab),
-         (void *)lnr_lutcd, gelu_size_lutcd);
-
-  auto offset = gelu_size_lutab + gelu_size_lutcd;
+  auto offset = lut.size();
   memcpy((void *)(static_cast<int8_t *>(dest) + offset), (void *)qdq_params,
          qdq_params_size);
 
@@ -391,10 +381,7 @@ void gelu<InT, WtT, OutT>::initialize_const_params(
     throw std::runtime_error("Gelu IPU Wrapper expect to have one constant.");
   }
 
-  int const gelu_lut_ab_size = sizeof(lnr_lutab);
-  int const gelu_lut_cd_size = sizeof(lnr_lutcd);
-
-  auto lut_size = gelu_lut_ab_size + gelu_lut_cd_size;
+  auto lut_size = lut_store::gelu_bf16().size();
 
   // Init the BO size
   kernel_x_shape_[0] = w_shape_[0];
@@ -127,6 +127,13 @@ const std::vector<uint8_t> groupnorm<InT, WtT, OutT>::get_transaction_bin(
   return txn_w_pad;
 }
 
+template <typename InT, typename WtT, typename OutT>
+size_t groupnorm<InT, WtT, OutT>::get_const_params_bo_size(size_t gamma_dim,
+                                                           size_t beta_dim) {
+  return (gamma_dim + beta_dim) * sizeof(WtT) * 8 +
+         lrn_matrix::QDQparam_size * sizeof(int32_t);
+}
+
 template <typename InT, typename WtT, typename OutT>
 const std::vector<uint8_t> groupnorm<InT, WtT, OutT>::get_super_kernel_params(
     std::vector<Tensor> &input, std::vector<Tensor> &output,
@@ -159,8 +166,7 @@ std::vector<OpArgMap> groupnorm<InT, WtT, OutT>::get_buffer_reqs(
   auto gamma_dim = input.at(1).shape.at(0);
   auto beta_dim = input.at(2).shape.at(0);
 
-  size_t const_params_bo_size = ((gamma_dim + beta_dim) * sizeof(WtT) * 8 +
-                                 lrn_matrix::QDQparam_size * sizeof(int32_t));
+  size_t const_params_bo_size = get_const_params_bo_size(gamma_dim, beta_dim);
   size_t input_bo_size = (Mo * No * sizeof(InT));
   size_t output_bo_size = (Mo * No * sizeof(OutT));
   size_t super_kernel_size = get_super_kernel_params(input, output).size();
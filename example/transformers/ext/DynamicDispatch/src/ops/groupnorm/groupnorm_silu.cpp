@@ -0,0 +1,187 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include <algorithm>
+#include <any>
+#include <map>
+#include <vector>
+
+#include <ops/groupnorm/groupnorm_silu.hpp>
+#include <ops/op_interface.hpp>
+#include <txn/txn_utils.hpp>
+#include <txn_helper/txn_helper.hpp>
+#include <utils/logging.hpp>
+#include <utils/tfuncs.hpp>
+
+namespace ryzenai {
+
+// onnx args of this op
+static constexpr size_t GPN_SILU_NUM_ARGS = 6;
+static constexpr size_t GPN_QDQ_INDEX = 3;
+static constexpr size_t SILU_QDQ_INDEX = 4;
+static constexpr size_t GPN_SILU_OUT_INDEX = 5;
+
+// xrt args of the groupnorm/silu txns, see their get_buffer_reqs()
+static constexpr uint32_t OUTPUT_XRT_ARG_IDX = 0;
+static constexpr uint32_t INPUT_XRT_ARG_IDX = 1;
+static constexpr uint32_t CONST_XRT_ARG_IDX = 2;
+static constexpr uint32_t SUPER_KERNEL_XRT_ARG_IDX = 3;
+static constexpr uint32_t SCRATCH_XRT_ARG_IDX = 4;
+
+template <typename InT, typename WtT, typename OutT>
+groupnorm_silu<InT, WtT, OutT>::groupnorm_silu(
+    const std::string &a_dtype, const std::string &c_dtype, bool load_xrt,
+    const std::map<std::string, std::any> &attr) {
+  // groupnorm output/silu input is bf16
+  gpn_ = std::make_unique<groupnorm<InT, WtT, uint16_t>>(
+      a_dtype, "bfloat16", "bfloat16", load_xrt, attr);
+  silu_ = std::make_unique<silu_qdq<uint16_t, uint16_t, OutT>>(
+      "bfloat16", "uint16", c_dtype, load_xrt, attr);
+}
+
+template <typename InT, typename WtT, typename OutT>
+Tensor groupnorm_silu<InT, WtT, OutT>::get_mid_tensor(
+    const std::vector<Tensor> &tensors) const {
+  return {nullptr, tensors.at(0).shape, "bfloat16"};
+}
+
+template <typename InT, typename WtT, typename OutT>
+std::vector<Tensor> groupnorm_silu<InT, WtT, OutT>::get_gpn_tensors(
+    const std::vector<Tensor> &tensors, const Tensor &mid) const {
+  std::vector<Tensor> gpn_tensors(tensors.begin(),
+                                  tensors.begin() + GPN_QDQ_INDEX + 1);
+  gpn_tensors.push_back(mid);
+  return gpn_tensors;
+}
+
+template <typename InT, typename WtT, typename OutT>
+std::vector<Tensor> groupnorm_silu<InT, WtT, OutT>::get_silu_tensors(
+    const std::vector<Tensor> &tensors, const Tensor &mid) const {
+  return {mid, tensors.at(SILU_QDQ_INDEX), tensors.at(GPN_SILU_OUT_INDEX)};
+}
+
+template <typename InT, typename WtT, typename OutT>
+typename groupnorm_silu<InT, WtT, OutT>::sub_op_reqs_t
+groupnorm_silu<InT, WtT, OutT>::get_sub_op_reqs(OpInterface &op,
+                                                std::vector<Tensor> &tensors) {
+  sub_op_reqs_t reqs;
+  for (const auto &req : op.get_buffer_reqs(tensors, tensors)) {
+    if (req.arg_type == OpArgMap::OpArgType::INPUT) {
+      reqs.input_size = req.size;
+    } else if (req.arg_type == OpArgMap::OpArgType::CONST_INPUT) {
+      reqs.const_size += req.size;
+    } else if (req.arg_type == OpArgMap::OpArgType::OUTPUT) {
+      reqs.output_size = req.size;
+    } else if (req.arg_type == OpArgMap::OpArgType::CONST_KERNEL_PARAM_INPUT) {
+      reqs.super_kernel_size = req.size;
+    } else {
+      DOD_THROW("GroupNormSilu : unexpected buffer req of sub op");
+    }
+  }
+  return reqs;
+}
+
+template <typename InT, typename WtT, typename OutT>
+const std::vector<uint8_t> groupnorm_silu<InT, WtT, OutT>::get_transaction_bin(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  auto mid = get_mid_tensor(input);
+  auto gpn_tensors = get_gpn_tensors(input, mid);
+  auto silu_tensors = get_silu_tensors(input, mid);
+  auto gpn_reqs = get_sub_op_reqs(*gpn_, gpn_tensors);
+
+  // groupnorm writes to the scratch pad, silu reads from it. The silu
+  // const/super kernel params follow the groupnorm ones.
+  const txn_arg_remap_t gpn_remap = {
+      {OUTPUT_XRT_ARG_IDX, {SCRATCH_XRT_ARG_IDX, 0}}};
+  const txn_arg_remap_t silu_remap = {
+      {INPUT_XRT_ARG_IDX, {SCRATCH_XRT_ARG_IDX, 0}},
+      {CONST_XRT_ARG_IDX, {CONST_XRT_ARG_IDX, gpn_reqs.const_size}},
+      {SUPER_KERNEL_XRT_ARG_IDX,
+       {SUPER_KERNEL_XRT_ARG_IDX, gpn_reqs.super_kernel_size}}};
+
+  auto gpn_txn = remap_txn_args(
+      gpn_->get_transaction_bin(gpn_tensors, gpn_tensors), gpn_remap);
+  auto silu_txn = remap_txn_args(
+      silu_->get_transaction_bin(silu_tensors, silu_tensors), silu_remap);
+
+  return ::utils::txn_util::fuse_txns({gpn_txn, silu_txn});
+}
+
+template <typename InT, typename WtT, typename OutT>
+const std::vector<uint8_t>
+groupnorm_silu<InT, WtT, OutT>::get_super_kernel_params(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  auto mid = get_mid_tensor(input);
+  auto gpn_tensors = get_gpn_tensors(input, mid);
+  auto silu_tensors = get_silu_tensors(input, mid);
+
+  auto data = gpn_->get_super_kernel_params(gpn_tensors, gpn_tensors);
+  auto silu_data = silu_->get_super_kernel_params(silu_tensors, silu_tensors);
+  data.insert(data.end(), silu_data.begin(), silu_data.end());
+  return data;
+}
+
+template <typename InT, typename WtT, typename OutT>
+std::vector<OpArgMap> groupnorm_silu<InT, WtT, OutT>::get_buffer_reqs(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  DOD_THROW_IF(input.size() != GPN_SILU_NUM_ARGS,
+               OpsFusion::dod_format("GroupNormSilu : expect {} args, got {}",
+                                     GPN_SILU_NUM_ARGS, input.size()));
+  auto mid = get_mid_tensor(input);
+  auto gpn_tensors = get_gpn_tensors(input, mid);
+  auto silu_tensors = get_silu_tensors(input, mid);
+  auto gpn_reqs = get_sub_op_reqs(*gpn_, gpn_tensors);
+  auto silu_reqs = get_sub_op_reqs(*silu_, silu_tensors);
+
+  size_t const_params_bo_size = gpn_reqs.const_size + silu_reqs.const_size;
+  size_t super_kernel_size =
+      gpn_reqs.super_kernel_size + silu_reqs.super_kernel_size;
+  size_t scratch_bo_size =
+      std::max(gpn_reqs.output_size, silu_reqs.input_size);
+
+  std::vector<OpArgMap> arg_map{
+      {OpArgMap::OpArgType::INPUT, INPUT_XRT_ARG_IDX, 0, 0,
+       gpn_reqs.input_size},
+      {OpArgMap::OpArgType::CONST_INPUT, CONST_XRT_ARG_IDX, 1, 0,
+       const_params_bo_size},
+      {OpArgMap::OpArgType::OUTPUT, OUTPUT_XRT_ARG_IDX, GPN_SILU_OUT_INDEX, 0,
+       silu_reqs.output_size},
+      {OpArgMap::OpArgType::CONST_KERNEL_PARAM_INPUT, SUPER_KERNEL_XRT_ARG_IDX,
+       0, 0, super_kernel_size},
+      {OpArgMap::OpArgType::SCRATCH_PAD, SCRATCH_XRT_ARG_IDX, 0, 0,
+       scratch_bo_size}};
+  return arg_map;
+}
+
+template <typename InT, typename WtT, typename OutT>
+void groupnorm_silu<InT, WtT, OutT>::initialize_const_params(
+    void *dest, const std::vector<Tensor> &const_params,
+    const std::map<std::string, std::any> &attr) {
+  RYZENAI_LOG_TRACE("GroupnormSilu initialize_const_params(ptr) ...");
+  // const_params --> [gamma, beta, groupnorm qdq_params, silu qdq_params]
+  DOD_THROW_IF(const_params.size() != GPN_SILU_NUM_ARGS - 2,
+               OpsFusion::dod_format("GroupNormSilu : expect {} consts, got {}",
+                                     GPN_SILU_NUM_ARGS - 2,
+                                     const_params.size()));
+  std::vector<Tensor> gpn_consts(const_params.begin(),
+                                 const_params.begin() + GPN_QDQ_INDEX);
+  std::vector<Tensor> silu_consts = {const_params.at(SILU_QDQ_INDEX - 1)};
+
+  const size_t gpn_const_size =
+      groupnorm<InT, WtT, uint16_t>::get_const_params_bo_size(
+          gpn_consts.at(0).shape.at(0), gpn_consts.at(1).shape.at(0));
+
+  gpn_->initialize_const_params(dest, gpn_consts);
+  silu_->initialize_const_params(static_cast<uint8_t *>(dest) +
+                                     gpn_const_size,
+                                 silu_consts);
+  RYZENAI_LOG_TRACE("GroupnormSilu initialize_const_params(ptr) ... DONE");
+}
+
+template class groupnorm_silu<int16_t, int16_t, uint16_t>;
+
+} // namespace ryzenai
@@ -0,0 +1,107 @@
+#include <any>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+#include <ops/host_op/host_op.hpp>
+#include <utils/utils.hpp>
+
+namespace ryzenai {
+
+static std::mutex &host_kernels_mutex() {
+  static std::mutex mtx;
+  return mtx;
+}
+
+static std::map<std::string, host_kernel_t> &host_kernels() {
+  static std::map<std::string, host_kernel_t> kernels;
+  return kernels;
+}
+
+void register_host_kernel(const std::string &name, host_kernel_t kernel) {
+  std::lock_guard<std::mutex> guard(host_kernels_mutex());
+  host_kernels()[name] = std::move(kernel);
+}
+
+bool is_host_kernel_registered(const std::string &name) {
+  std::lock_guard<std::mutex> guard(host_kernels_mutex());
+  return host_kernels().count(name) != 0;
+}
+
+// "kernel" is a string, or a list of one string from the meta json
+static std::string
+get_kernel_name(const std::map<std::string, std::any> &attr) {
+  auto iter = attr.find("kernel");
+  if (iter == attr.end()) {
+    throw std::runtime_error("Can't find kernel in attrs of HOST_OP");
+  }
+  if (iter->second.type() == typeid(std::string)) {
+    return std::any_cast<const std::string &>(iter->second);
+  }
+  const auto &names =
+      std::any_cast<const std::vector<std::string> &>(iter->second);
+  if (names.size() != 1) {
+    throw std::runtime_error("HOST_OP kernel attr should be a single name");
+  }
+  return names[0];
+}
+
+static size_t get_num_inputs(const std::map<std::string, std::any> &attr,
+                             size_t num_args) {
+  auto iter = attr.find("num_inputs");
+  if (iter == attr.end()) {
+    return num_args > 0 ? num_args - 1 : 0;
+  }
+  int num_inputs = 0;
+  if (iter->second.type() == typeid(int)) {
+    num_inputs = std::any_cast<int>(iter->second);
+  } else {
+    const auto &values = std::any_cast<const std::vector<int> &>(iter->second);
+    if (values.size() != 1) {
+      throw std::runtime_error("HOST_OP num_inputs attr should be one int");
+    }
+    num_inputs = values[0];
+  }
+  if (num_inputs < 0 || static_cast<size_t>(num_inputs) > num_args) {
+    throw std::runtime_error("HOST_OP num_inputs " +
+                             std::to_string(num_inputs) + " out of " +
+                             std::to_string(num_args) + " args");
+  }
+  return static_cast<size_t>(num_inputs);
+}
+
+host_op::host_op(const std::map<std::string, std::any> &attr) : attr_(attr) {
+  const auto name = get_kernel_name(attr);
+  std::lock_guard<std::mutex> guard(host_kernels_mutex());
+  auto iter = host_kernels().find(name);
+  if (iter == host_kernels().end()) {
+    throw std::runtime_error("No host kernel registered as " + name);
+  }
+  kernel_ = iter->second;
+}
+
+std::vector<OpArgMap>
+host_op::get_buffer_reqs(std::vector<Tensor> &input,
+                         std::vector<Tensor> &output,
+                         const std::map<std::string, std::any> &attr) {
+  // input and output are both all the args of the op
+  const size_t num_inputs = get_num_inputs(attr, input.size());
+  std::vector<OpArgMap> arg_map;
+  for (size_t i = 0; i < input.size(); i++) {
+    const auto &tensor = input[i];
+    size_t size = std::accumulate(tensor.shape.begin(), tensor.shape.end(),
+                                  size_t{1}, std::multiplies{}) *
+                  Utils::get_size_of_type(tensor.dtype);
+    auto arg_type = i < num_inputs ? OpArgMap::OpArgType::INPUT
+                                   : OpArgMap::OpArgType::OUTPUT;
+    arg_map.push_back({arg_type, 0, i, 0, size});
+  }
+  return arg_map;
+}
+
+void host_op::execute(std::vector<Tensor> &input,
+                      std::vector<Tensor> &output) {
+  kernel_(input, output, attr_);
+}
+
+} // namespace ryzenai
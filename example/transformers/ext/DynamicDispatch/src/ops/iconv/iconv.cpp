@@ -579,7 +579,8 @@ void iconv<InT, WtT, OutT>::initialize_const_params(
     iconv_matrix::DwcWgtTensor<WtT, C_IN_SPLIT_DWC> W(CO, KY, KX, w_dest);
     format_dwc_wgt(W, weights, qdq, qdq_params[qdq_c1_idx],
                    qdq_params[qdq_c2_idx], qdq_params[qdq_Stdm_idx],
-                   qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx]);
+                   qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx],
+                   Utils::parallel_for);
   } else if (strides_[0] == 1 || strides_[0] == 2) {      // CONV
     if (design_param_.find("4x4") != std::string::npos) { // PSR 4x4 design
 
@@ -596,7 +597,8 @@ void iconv<InT, WtT, OutT>::initialize_const_params(
                                                      KX, w_dest);
         format_conv_wgt(W, weights, CO, CI, qdq, qdq_params[qdq_c1_idx],
                         qdq_params[qdq_c2_idx], qdq_params[qdq_Stdm_idx],
-                        qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx]);
+                        qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx],
+                        Utils::parallel_for);
       } else if (split_mode == 1) {
         constexpr SUBV_T subv = get_subv(1);
         int constexpr Cis = subv[0];
@@ -607,7 +609,8 @@ void iconv<InT, WtT, OutT>::initialize_const_params(
 
         format_conv_wgt(W, weights, CO, CI, qdq, qdq_params[qdq_c1_idx],
                         qdq_params[qdq_c2_idx], qdq_params[qdq_Stdm_idx],
-                        qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx]);
+                        qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx],
+                        Utils::parallel_for);
       } else if (split_mode == 2) {
         constexpr SUBV_T subv = get_subv(2);
         int constexpr Cis = subv[0];
@@ -617,7 +620,8 @@ void iconv<InT, WtT, OutT>::initialize_const_params(
                                                      KX, w_dest);
         format_conv_wgt(W, weights, CO, CI, qdq, qdq_params[qdq_c1_idx],
                         qdq_params[qdq_c2_idx], qdq_params[qdq_Stdm_idx],
-                        qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx]);
+                        qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx],
+                        Utils::parallel_for);
       } else if (split_mode == 3) {
         constexpr SUBV_T subv = get_subv(3);
         int constexpr Cis = subv[0];
@@ -627,7 +631,8 @@ void iconv<InT, WtT, OutT>::initialize_const_params(
                                                      KX, w_dest);
         format_conv_wgt(W, weights, CO, CI, qdq, qdq_params[qdq_c1_idx],
                         qdq_params[qdq_c2_idx], qdq_params[qdq_Stdm_idx],
-                        qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx]);
+                        qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx],
+                        Utils::parallel_for);
       } else {
         std::cout << "ERROR: Unsupported split mode" << std::endl;
       }
@@ -638,7 +643,8 @@ void iconv<InT, WtT, OutT>::initialize_const_params(
               CO, CI, KY, KX, w_dest);
           format_conv_wgt(W, weights, CO, CI, qdq, qdq_params[qdq_c1_idx],
                           qdq_params[qdq_c2_idx], qdq_params[qdq_Stdm_idx],
-                          qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx]);
+                          qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx],
+                          Utils::parallel_for);
         } else {
           if (CO == 4) {
             CO_padded = 32;
@@ -652,14 +658,16 @@ void iconv<InT, WtT, OutT>::initialize_const_params(
           // uint32_t wgt_zp = qdq_params[qdq_wgt_zp_idx];
           format_conv_wgt(W, weights, CO, CI, qdq, qdq_params[qdq_c1_idx],
                           qdq_params[qdq_c2_idx], qdq_params[qdq_Stdm_idx],
-                          qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx]);
+                          qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx],
+                          Utils::parallel_for);
         }
       } else { // 3x3 stride2
         iconv_matrix::ConvWgtTensor<WtT, C_OUT_SPLIT_CONV, C_IN_SPLIT_CONV> W(
             CO, CI, KY, KX, w_dest);
         format_conv_wgt(W, weights, CO, CI, qdq, qdq_params[qdq_c1_idx],
                         qdq_params[qdq_c2_idx], qdq_params[qdq_Stdm_idx],
-                        qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx]);
+                        qdq_params[qdq_Sout_idx], qdq_params[qdq_wgt_zp_idx],
+                        Utils::parallel_for);
       }
     }
   } else { // CONV7
@@ -674,7 +682,7 @@ void iconv<InT, WtT, OutT>::initialize_const_params(
     iconv_matrix::ConvWgtTensor<WtT, C_OUT_SPLIT_CONV7, C_IN_SPLIT_CONV7> W(
         CO, CI, KY, KX, w_dest);
     fold_conv_wgt<WtT>(weights, wgt_zp, CO, Ci_no_fold, Ky_no_fold, Kx_no_fold,
-                       fold_factor, Ci_gran, W);
+                       fold_factor, Ci_gran, W, Utils::parallel_for);
 
     for (int c = 0; c < W.Co; ++c) {
       W.set_qdq_c0(c, qdq[c]);
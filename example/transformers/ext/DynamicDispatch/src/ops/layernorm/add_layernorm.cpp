@@ -0,0 +1,196 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include <algorithm>
+#include <any>
+#include <map>
+#include <vector>
+
+#include <ops/layernorm/add_layernorm.hpp>
+#include <ops/op_interface.hpp>
+#include <txn/txn_utils.hpp>
+#include <txn_helper/txn_helper.hpp>
+#include <utils/logging.hpp>
+#include <utils/tfuncs.hpp>
+
+namespace ryzenai {
+
+// onnx args of this op
+static constexpr size_t ADD_LRN_NUM_ARGS = 7;
+static constexpr size_t ADD_QDQ_INDEX = 2;
+static constexpr size_t LRN_GAMMA_INDEX = 3;
+static constexpr size_t LRN_QDQ_INDEX = 5;
+static constexpr size_t ADD_LRN_OUT_INDEX = 6;
+static constexpr size_t ADD_LRN_SUM_INDEX = 7;
+
+// xrt args of the elwadd/layernorm txns, see their get_buffer_reqs()
+static constexpr uint32_t OUTPUT_XRT_ARG_IDX = 0;
+static constexpr uint32_t INPUT_XRT_ARG_IDX = 1;
+static constexpr uint32_t CONST_XRT_ARG_IDX = 2;
+static constexpr uint32_t SUPER_KERNEL_XRT_ARG_IDX = 3;
+static constexpr uint32_t SUM_XRT_ARG_IDX = 4;
+
+template <typename InT, typename WtT, typename OutT>
+add_layernorm<InT, WtT, OutT>::add_layernorm(
+    const std::string &a_dtype, const std::string &c_dtype, bool load_xrt,
+    const std::map<std::string, std::any> &attr) {
+  // elwadd output/layernorm input is bf16
+  add_ = std::make_unique<elw_add<InT, WtT, uint16_t>>(
+      a_dtype, a_dtype, "bfloat16", load_xrt, attr);
+  lrn_ = std::make_unique<layernorm<int16_t, int16_t, OutT>>(
+      "bfloat16", "uint16", c_dtype, load_xrt, attr);
+}
+
+template <typename InT, typename WtT, typename OutT>
+Tensor add_layernorm<InT, WtT, OutT>::get_sum_tensor(
+    const std::vector<Tensor> &tensors) const {
+  if (tensors.size() > ADD_LRN_SUM_INDEX) {
+    return tensors.at(ADD_LRN_SUM_INDEX);
+  }
+  return {nullptr, tensors.at(0).shape, "bfloat16"};
+}
+
+template <typename InT, typename WtT, typename OutT>
+std::vector<Tensor> add_layernorm<InT, WtT, OutT>::get_add_tensors(
+    const std::vector<Tensor> &tensors, const Tensor &sum) const {
+  return {tensors.at(0), tensors.at(1), tensors.at(ADD_QDQ_INDEX), sum};
+}
+
+template <typename InT, typename WtT, typename OutT>
+std::vector<Tensor> add_layernorm<InT, WtT, OutT>::get_lrn_tensors(
+    const std::vector<Tensor> &tensors, const Tensor &sum) const {
+  std::vector<Tensor> lrn_tensors = {sum};
+  lrn_tensors.insert(lrn_tensors.end(), tensors.begin() + LRN_GAMMA_INDEX,
+                     tensors.begin() + LRN_QDQ_INDEX + 1);
+  lrn_tensors.push_back(tensors.at(ADD_LRN_OUT_INDEX));
+  return lrn_tensors;
+}
+
+template <typename InT, typename WtT, typename OutT>
+typename add_layernorm<InT, WtT, OutT>::sub_op_reqs_t
+add_layernorm<InT, WtT, OutT>::get_sub_op_reqs(OpInterface &op,
+                                               std::vector<Tensor> &tensors) {
+  sub_op_reqs_t reqs;
+  for (const auto &req : op.get_buffer_reqs(tensors, tensors)) {
+    if (req.arg_type == OpArgMap::OpArgType::INPUT) {
+      reqs.inputs.push_back(req);
+    } else if (req.arg_type == OpArgMap::OpArgType::CONST_INPUT) {
+      reqs.const_size += req.size;
+    } else if (req.arg_type == OpArgMap::OpArgType::OUTPUT) {
+      reqs.output_size = req.size;
+    } else if (req.arg_type == OpArgMap::OpArgType::CONST_KERNEL_PARAM_INPUT) {
+      reqs.super_kernel_size = req.size;
+    } else {
+      DOD_THROW("AddLayerNorm : unexpected buffer req of sub op");
+    }
+  }
+  return reqs;
+}
+
+template <typename InT, typename WtT, typename OutT>
+const std::vector<uint8_t> add_layernorm<InT, WtT, OutT>::get_transaction_bin(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  auto sum = get_sum_tensor(input);
+  auto add_tensors = get_add_tensors(input, sum);
+  auto lrn_tensors = get_lrn_tensors(input, sum);
+  auto add_reqs = get_sub_op_reqs(*add_, add_tensors);
+
+  // elwadd writes the sum, layernorm reads it. The layernorm const/super
+  // kernel params follow the elwadd ones.
+  const txn_arg_remap_t add_remap = {
+      {OUTPUT_XRT_ARG_IDX, {SUM_XRT_ARG_IDX, 0}}};
+  const txn_arg_remap_t lrn_remap = {
+      {INPUT_XRT_ARG_IDX, {SUM_XRT_ARG_IDX, 0}},
+      {CONST_XRT_ARG_IDX, {CONST_XRT_ARG_IDX, add_reqs.const_size}},
+      {SUPER_KERNEL_XRT_ARG_IDX,
+       {SUPER_KERNEL_XRT_ARG_IDX, add_reqs.super_kernel_size}}};
+
+  auto add_txn = remap_txn_args(
+      add_->get_transaction_bin(add_tensors, add_tensors), add_remap);
+  auto lrn_txn = remap_txn_args(
+      lrn_->get_transaction_bin(lrn_tensors, lrn_tensors), lrn_remap);
+
+  return ::utils::txn_util::fuse_txns({add_txn, lrn_txn});
+}
+
+template <typename InT, typename WtT, typename OutT>
+const std::vector<uint8_t>
+add_layernorm<InT, WtT, OutT>::get_super_kernel_params(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  auto sum = get_sum_tensor(input);
+  auto add_tensors = get_add_tensors(input, sum);
+  auto lrn_tensors = get_lrn_tensors(input, sum);
+
+  auto data = add_->get_super_kernel_params(add_tensors, add_tensors);
+  auto lrn_data = lrn_->get_super_kernel_params(lrn_tensors, lrn_tensors);
+  data.insert(data.end(), lrn_data.begin(), lrn_data.end());
+  return data;
+}
+
+template <typename InT, typename WtT, typename OutT>
+std::vector<OpArgMap> add_layernorm<InT, WtT, OutT>::get_buffer_reqs(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  DOD_THROW_IF(input.size() != ADD_LRN_NUM_ARGS &&
+                   input.size() != ADD_LRN_NUM_ARGS + 1,
+               OpsFusion::dod_format(
+                   "AddLayerNorm : expect {} or {} args, got {}",
+                   ADD_LRN_NUM_ARGS, ADD_LRN_NUM_ARGS + 1, input.size()));
+  const bool has_sum_output = input.size() > ADD_LRN_SUM_INDEX;
+  auto sum = get_sum_tensor(input);
+  auto add_tensors = get_add_tensors(input, sum);
+  auto lrn_tensors = get_lrn_tensors(input, sum);
+  auto add_reqs = get_sub_op_reqs(*add_, add_tensors);
+  auto lrn_reqs = get_sub_op_reqs(*lrn_, lrn_tensors);
+
+  size_t const_params_bo_size = add_reqs.const_size + lrn_reqs.const_size;
+  size_t super_kernel_size =
+      add_reqs.super_kernel_size + lrn_reqs.super_kernel_size;
+  size_t sum_bo_size =
+      std::max(add_reqs.output_size, lrn_reqs.inputs.at(0).size);
+
+  // elwadd inputs keep their onnx_arg_idx [0, 1] & offsets in xrt arg 1
+  std::vector<OpArgMap> arg_map = add_reqs.inputs;
+  arg_map.push_back({OpArgMap::OpArgType::CONST_INPUT, CONST_XRT_ARG_IDX,
+                     ADD_QDQ_INDEX, 0, const_params_bo_size});
+  arg_map.push_back({OpArgMap::OpArgType::OUTPUT, OUTPUT_XRT_ARG_IDX,
+                     ADD_LRN_OUT_INDEX, 0, lrn_reqs.output_size});
+  arg_map.push_back({OpArgMap::OpArgType::CONST_KERNEL_PARAM_INPUT,
+                     SUPER_KERNEL_XRT_ARG_IDX, 0, 0, super_kernel_size});
+  if (has_sum_output) {
+    arg_map.push_back({OpArgMap::OpArgType::OUTPUT, SUM_XRT_ARG_IDX,
+                       ADD_LRN_SUM_INDEX, 0, sum_bo_size});
+  } else {
+    arg_map.push_back({OpArgMap::OpArgType::SCRATCH_PAD, SUM_XRT_ARG_IDX, 0, 0,
+                       sum_bo_size});
+  }
+  return arg_map;
+}
+
+template <typename InT, typename WtT, typename OutT>
+void add_layernorm<InT, WtT, OutT>::initialize_const_params(
+    void *dest, const std::vector<Tensor> &const_params,
+    const std::map<std::string, std::any> &attr) {
+  RYZENAI_LOG_TRACE("AddLayernorm initialize_const_params(ptr) ...");
+  // const_params --> [add qdq_params, gamma, beta, layernorm qdq_params]
+  DOD_THROW_IF(const_params.size() != 4,
+               OpsFusion::dod_format("AddLayerNorm : expect 4 consts, got {}",
+                                     const_params.size()));
+  std::vector<Tensor> add_consts = {const_params.at(0)};
+  std::vector<Tensor> lrn_consts(const_params.begin() + 1, const_params.end());
+
+  add_->initialize_const_params(dest, add_consts);
+  lrn_->initialize_const_params(
+      static_cast<uint8_t *>(dest) +
+          elw_add<InT, WtT, uint16_t>::get_const_params_bo_size(),
+      lrn_consts);
+  RYZENAI_LOG_TRACE("AddLayernorm initialize_const_params(ptr) ... DONE");
+}
+
+template class add_layernorm<uint16_t, uint16_t, uint8_t>;
+template class add_layernorm<uint16_t, uint16_t, uint16_t>;
+
+} // namespace ryzenai
@@ -341,6 +341,108 @@ void lstm<InT, WtT, OutT>::execute(const std::vector<Tensor> &input,
   RYZENAI_LOG_TRACE("lstm execute ... DONE");
 }
 
+/*
+ * perform lstm on a sequence of chunks, each of the shape supported by the
+ * kernel. Each chunk is an independent lstm run, i.e. the kernel does not
+ * carry hidden/cell state from one chunk to the next.
+ *
+ * IFM and OFM are double buffered: while chunk i runs, chunk i + 1 is copied
+ * to the other IFM BO and, once chunk i + 1 is launched, the output of chunk
+ * i is read from its OFM BO.
+ *
+ * @param input activation of each chunk
+ * @param output to store the result of each chunk
+ *
+ * @return none
+ */
+template <typename InT, typename WtT, typename OutT>
+void lstm<InT, WtT, OutT>::execute_stream(const std::vector<Tensor> &input,
+                                          std::vector<Tensor> &output) {
+  RYZENAI_LOG_TRACE("lstm execute_stream ...");
+  DOD_THROW_IF(input.size() != output.size(),
+               OpsFusion::dod_format("lstm : #input chunks ({}) != #output "
+                                     "chunks ({})",
+                                     input.size(), output.size()));
+  if (input.empty()) {
+    return;
+  }
+
+  ifmCopyTime_ = 0;
+  ifmSyncTime_ = 0;
+  ofmCopyTime_ = 0;
+  ofmSyncTime_ = 0;
+  run_aie_time_ = 0;
+  num_run_aie_ = 0;
+
+  if (ifmBoNext_.size() != ifmBo_.size()) {
+    ifmBoNext_ =
+        xrt::bo(xrt_ctx_->get_device(), ifmBo_.size(), XRT_BO_FLAGS_HOST_ONLY,
+                xrt_ctx_->get_kernel().group_id(0));
+    ofmBoNext_ =
+        xrt::bo(xrt_ctx_->get_device(), ofmBo_.size(), XRT_BO_FLAGS_HOST_ONLY,
+                xrt_ctx_->get_kernel().group_id(0));
+  }
+  xrt::bo *ifm_bos[2] = {&ifmBo_, &ifmBoNext_};
+  xrt::bo *ofm_bos[2] = {&ofmBo_, &ofmBoNext_};
+
+  const auto &chunk_shape = input.at(0).shape;
+  inputShape_[0] = chunk_shape.at(0);
+  inputShape_[1] = chunk_shape.at(1);
+  inputShape_[2] = chunk_shape.at(2);
+
+  auto instr_bo_key = get_instr_key(txn_fname_prefix_, inputShape_[0],
+                                    inputShape_[1], inputShape_[2]);
+  xrt::bo instr_bo = instr_reg_.get_instr_bo(instr_bo_key).second;
+  int instr_bo_words = instr_bo.size() / sizeof(int);
+  auto kernel_ = xrt_ctx_->get_kernel();
+
+  auto upload = [&](size_t i) {
+    DOD_THROW_IF(input.at(i).shape != chunk_shape,
+                 OpsFusion::dod_format("lstm : chunk {} has a different shape "
+                                       "than chunk 0",
+                                       i));
+    int64_t a_copy_start = GET_ELAPSED_TIME_NS();
+    ifm_bos[i % 2]->write(input.at(i).data);
+    int64_t a_copy_stop = GET_ELAPSED_TIME_NS();
+    ifm_bos[i % 2]->sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    int64_t a_sync_stop = GET_ELAPSED_TIME_NS();
+    ifmCopyTime_ += a_copy_stop - a_copy_start;
+    ifmSyncTime_ += a_sync_stop - a_copy_stop;
+  };
+  auto launch = [&](size_t i) {
+    num_run_aie_++;
+    return kernel_(2, instr_bo, instr_bo_words,
+                   constBo_.address() + DDR_AIE_ADDR_OFFSET,
+                   ifm_bos[i % 2]->address() + DDR_AIE_ADDR_OFFSET,
+                   ofm_bos[i % 2]->address() + DDR_AIE_ADDR_OFFSET, 0, 0);
+  };
+
+  int64_t run_aie_start = GET_ELAPSED_TIME_NS();
+  upload(0);
+  xrt::run run = launch(0);
+  for (size_t i = 0; i < input.size(); i++) {
+    const bool has_next = i + 1 < input.size();
+    if (has_next) {
+      upload(i + 1);
+    }
+    run.wait2();
+    if (has_next) {
+      run = launch(i + 1);
+    }
+
+    int64_t c_sync_start = GET_ELAPSED_TIME_NS();
+    ofm_bos[i % 2]->sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+    int64_t c_sync_stop = GET_ELAPSED_TIME_NS();
+    ofm_bos[i % 2]->read(output.at(i).data);
+    int64_t c_copy_stop = GET_ELAPSED_TIME_NS();
+    ofmSyncTime_ += c_sync_stop - c_sync_start;
+    ofmCopyTime_ += c_copy_stop - c_sync_stop;
+  }
+  run_aie_time_ = GET_ELAPSED_TIME_NS() - run_aie_start;
+
+  RYZENAI_LOG_TRACE("lstm execute_stream ... DONE");
+}
+
 /*
  * method to set debug flag
  *
@@ -68,6 +68,34 @@ bool masked_softmax<LhsT, MaskT, OutT>::isSupportedShape(
   return false;
 }
 
+template <typename LhsT, typename MaskT, typename OutT>
+bool masked_softmax<LhsT, MaskT, OutT>::fitsKernelShape(const Tensor &operand) {
+  const auto [B, M, K] = extract_BMK(operand);
+  return B > 0 && M > 0 && K > 0 && B <= kernel_x_shape_[0] &&
+         M <= kernel_x_shape_[1] && K <= kernel_x_shape_[2];
+}
+
+template <typename LhsT, typename MaskT, typename OutT>
+void masked_softmax<LhsT, MaskT, OutT>::stage_mask(const MaskT *mask, int M,
+                                                   int K) {
+  const auto kernel_k = kernel_x_shape_[2];
+  MaskT *b_bo_map = b_bo_.map<MaskT *>();
+  for (int m = 0; m < M; m++) {
+    MaskT *dst = b_bo_map + m * kernel_k;
+    if (mask != nullptr) {
+      memcpy((void *)dst, (void *)(mask + m * K), K * sizeof(MaskT));
+    } else {
+      // causal, aligned to the last row so query m sees the keys up to
+      // m + K - M
+      for (int k = 0; k < K; k++) {
+        dst[k] = (k <= m + K - M) ? MaskT(0) : MASK_NEG_INF;
+      }
+    }
+    // columns past the sequence get no weight
+    std::fill(dst + K, dst + kernel_k, MASK_NEG_INF);
+  }
+}
+
 template <typename LhsT, typename MaskT, typename OutT>
 std::once_flag masked_softmax<LhsT, MaskT, OutT>::logger_flag_;
 
@@ -82,6 +110,12 @@ void masked_softmax<LhsT, MaskT, OutT>::debug(bool enable) {
   debug_ = enable;
 }
 
+template <typename LhsT, typename MaskT, typename OutT>
+OpExecTimes masked_softmax<LhsT, MaskT, OutT>::get_exec_times() const {
+  return {a_copy_time_ + b_copy_time_ + c_copy_time_,
+          a_sync_time_ + b_sync_time_ + c_sync_time_, run_aie_time_};
+}
+
 template <typename LhsT, typename MaskT, typename OutT>
 std::string masked_softmax<LhsT, MaskT, OutT>::get_instr_key(std::string prefix,
                                                              int batch, int m,
@@ -187,9 +221,10 @@ template <typename LhsT, typename MaskT, typename OutT>
 void masked_softmax<LhsT, MaskT, OutT>::execute(std::vector<Tensor> &input,
                                                 std::vector<Tensor> &output) {
 
-  // The first data is a and second data is b
+  // The first data is a and second data is the mask, without a mask the
+  // causal mask of the sequence is generated in the mask BO
   LhsT *a = (LhsT *)input.at(0).data;
-  MaskT *b = (MaskT *)input.at(1).data;
+  MaskT *b = input.size() > 1 ? (MaskT *)input.at(1).data : nullptr;
 
   a_copy_time_ = 0;
   a_sync_time_ = 0;
@@ -202,36 +237,79 @@ void masked_softmax<LhsT, MaskT, OutT>::execute(std::vector<Tensor> &input,
 
   int64_t exec_start = GET_ELAPSED_TIME_NS();
 
-  if (!isSupportedShape(input.at(0))) {
+  // A shorter sequence runs in the kernel shape: the rows and heads past it
+  // are not copied nor read back, its padding columns are masked out.
+  if (!fitsKernelShape(input.at(0))) {
     throw std::runtime_error("Unsupported shape for masked softmax");
   }
+  const auto shapeOperand = extract_BMK(input.at(0));
+  const auto [B, M, K] = shapeOperand;
+  if (b != nullptr) {
+    const auto shapeMask = extract_BMK(input.at(1));
+    if (std::get<0>(shapeMask) != 1 || std::get<1>(shapeMask) != M ||
+        std::get<2>(shapeMask) != K) {
+      throw std::runtime_error("Mismatched shape of mask and activation "
+                               "not supported for masked softmax");
+    }
+  }
+  const auto kernel_m = kernel_x_shape_[1];
+  const auto kernel_k = kernel_x_shape_[2];
+  const size_t head_size_in_bytes = kernel_m * kernel_k * sizeof(LhsT);
+  const size_t rows_size_in_bytes = M * kernel_k * sizeof(LhsT);
+  if (shapeOperand != staged_shape_) {
+    // keep the padding of the operand finite, -inf + inf is a nan
+    memset(a_bo_.map<LhsT *>(), 0, operand_size_in_bytes_);
+    a_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    if (M < kernel_m) {
+      memset(b_bo_.map<MaskT *>() + M * kernel_k, 0,
+             mask_size_in_bytes_ - M * kernel_k * sizeof(MaskT));
+      b_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    }
+    staged_shape_ = shapeOperand;
+    causal_mask_staged_ = false;
+  }
+
   // a_bo copy
   int64_t a_copy_start = GET_ELAPSED_TIME_NS();
   LhsT *a_bo_map = a_bo_.map<LhsT *>();
-  memcpy((void *)a_bo_map, (void *)a, operand_size_in_bytes_);
+  if (M == kernel_m && K == kernel_k) {
+    memcpy((void *)a_bo_map, (void *)a, B * head_size_in_bytes);
+  } else {
+    for (int batch = 0; batch < B; batch++) {
+      for (int m = 0; m < M; m++) {
+        memcpy((void *)(a_bo_map + (batch * kernel_m + m) * kernel_k),
+               (void *)(a + (batch * M + m) * K), K * sizeof(LhsT));
+      }
+    }
+  }
   int64_t a_copy_stop = GET_ELAPSED_TIME_NS();
 
   // a_bo sync
   int64_t a_sync_start = GET_ELAPSED_TIME_NS();
-  a_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  for (int batch = 0; batch < B; batch++) {
+    a_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE, rows_size_in_bytes,
+               batch * head_size_in_bytes);
+  }
   int64_t a_sync_stop = GET_ELAPSED_TIME_NS();
 
   a_copy_time_ = a_copy_stop - a_copy_start;
   a_sync_time_ = a_sync_stop - a_sync_start;
 
-  // b_bo copy
-  int64_t b_copy_start = GET_ELAPSED_TIME_NS();
-  MaskT *b_bo_map = b_bo_.map<MaskT *>();
-  memcpy((void *)b_bo_map, (void *)b, mask_size_in_bytes_);
-  int64_t b_copy_stop = GET_ELAPSED_TIME_NS();
+  // b_bo copy, a generated causal mask stays valid while the shape does
+  if (b != nullptr || !causal_mask_staged_) {
+    int64_t b_copy_start = GET_ELAPSED_TIME_NS();
+    stage_mask(b, M, K);
+    int64_t b_copy_stop = GET_ELAPSED_TIME_NS();
 
-  // b_bo sync
-  int64_t b_sync_start = GET_ELAPSED_TIME_NS();
-  b_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  int64_t b_sync_stop = GET_ELAPSED_TIME_NS();
+    // b_bo sync
+    int64_t b_sync_start = GET_ELAPSED_TIME_NS();
+    b_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE, M * kernel_k * sizeof(MaskT), 0);
+    int64_t b_sync_stop = GET_ELAPSED_TIME_NS();
 
-  b_copy_time_ = b_copy_stop - b_copy_start;
-  b_sync_time_ = b_sync_stop - b_sync_start;
+    b_copy_time_ = b_copy_stop - b_copy_start;
+    b_sync_time_ = b_sync_stop - b_sync_start;
+    causal_mask_staged_ = (b == nullptr);
+  }
   std::vector<xrt::bo> inputs = {a_bo_, b_bo_};
   std::vector<xrt::bo> outputs = {c_bo_};
   int64_t run_aie_start = GET_ELAPSED_TIME_NS();
@@ -243,7 +321,10 @@ void masked_softmax<LhsT, MaskT, OutT>::execute(std::vector<Tensor> &input,
 
   // sync output activation to host memory
   int64_t c_sync_start = GET_ELAPSED_TIME_NS();
-  c_bo_.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+  for (int batch = 0; batch < B; batch++) {
+    c_bo_.sync(XCL_BO_SYNC_BO_FROM_DEVICE, M * kernel_k * sizeof(OutT),
+               batch * kernel_m * kernel_k * sizeof(OutT));
+  }
   int64_t c_sync_stop = GET_ELAPSED_TIME_NS();
   c_sync_time_ += c_sync_stop - c_sync_start;
 
@@ -251,16 +332,25 @@ void masked_softmax<LhsT, MaskT, OutT>::execute(std::vector<Tensor> &input,
   auto aie_out = (OutT *)output.at(0).data;
   int64_t c_copy_start = GET_ELAPSED_TIME_NS();
   OutT *c_bo_map = c_bo_.map<OutT *>();
-  memcpy((void *)aie_out, (void *)c_bo_map, operand_size_in_bytes_);
+  if (M == kernel_m && K == kernel_k) {
+    memcpy((void *)aie_out, (void *)c_bo_map,
+           B * kernel_m * kernel_k * sizeof(OutT));
+  } else {
+    for (int batch = 0; batch < B; batch++) {
+      for (int m = 0; m < M; m++) {
+        memcpy((void *)(aie_out + (batch * M + m) * K),
+               (void *)(c_bo_map + (batch * kernel_m + m) * kernel_k),
+               K * sizeof(OutT));
+      }
+    }
+  }
   int64_t c_copy_stop = GET_ELAPSED_TIME_NS();
   c_copy_time_ = c_copy_stop - c_copy_start;
   int64_t exec_end = GET_ELAPSED_TIME_NS();
 
   RYZENAI_LOG_INFO(
-      std::to_string(masked_softmax_id_) + " " +
-      std::to_string(kernel_x_shape_[0]) + " " +
-      std::to_string(kernel_x_shape_[1]) + " " +
-      std::to_string(kernel_x_shape_[2]) + " " +
+      std::to_string(masked_softmax_id_) + " " + std::to_string(B) + " " +
+      std::to_string(M) + " " + std::to_string(K) + " " +
       std::to_string(exec_end - exec_start) + " " +
       std::to_string(num_run_aie_) + " " + std::to_string(run_aie_time_) + " " +
       std::to_string(a_copy_time_) + " " + std::to_string(a_sync_time_) + " " +
@@ -272,6 +362,13 @@ void masked_softmax<LhsT, MaskT, OutT>::execute(std::vector<Tensor> &input,
 template <typename LhsT, typename MaskT, typename OutT>
 void masked_softmax<LhsT, MaskT, OutT>::execute(std::vector<xrt::bo> &input,
                                                 std::vector<xrt::bo> &output) {
+  submit(input, output).wait2();
+}
+
+template <typename LhsT, typename MaskT, typename OutT>
+xrt::run
+masked_softmax<LhsT, MaskT, OutT>::submit(std::vector<xrt::bo> &input,
+                                          std::vector<xrt::bo> &output) {
   // prepare inst_bo and param_bo
   const auto instr_bo_key =
       get_instr_key(txn_fname_prefix_, kernel_x_shape_[0], kernel_x_shape_[1],
@@ -281,13 +378,11 @@ void masked_softmax<LhsT, MaskT, OutT>::execute(std::vector<xrt::bo> &input,
   int instr_bo_words = instr_bo.size() / sizeof(int);
   auto kernel_ = xrt_ctx_->get_kernel();
   // launch the kernel
-  xrt::run run;
   // do we really need to sync before? c_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  run = kernel_(2, instr_bo, instr_bo_words,
-                input[0].address() + DDR_AIE_ADDR_OFFSET,
-                input[1].address() + DDR_AIE_ADDR_OFFSET,
-                output[0].address() + DDR_AIE_ADDR_OFFSET, 0, 0);
-  run.wait2();
+  return kernel_(2, instr_bo, instr_bo_words,
+                 input[0].address() + DDR_AIE_ADDR_OFFSET,
+                 input[1].address() + DDR_AIE_ADDR_OFFSET,
+                 output[0].address() + DDR_AIE_ADDR_OFFSET, 0, 0);
 }
 template <typename LhsT, typename MaskT, typename OutT>
 std::vector<xrt::bo> masked_softmax<LhsT, MaskT, OutT>::get_inputs() {
@@ -1,9 +1,12 @@
 /*
  * Copyright © 2023 Advanced Micro Devices, Inc. All rights reserved.
  */
+#include <algorithm>
 #include <any>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <set>
 #include <sstream>
 #include <tuple>
 #include <utility>
@@ -64,34 +67,83 @@ extract_MKN(const std::vector<Tensor> &inputs) {
 template <typename InT, typename WtT, typename OutT>
 std::tuple<int, int, int> matmul<InT, WtT, OutT>::map_padded_shape(int M, int K,
                                                                    int N) {
-  auto iter = raw_shapes_.find(txn_fname_prefix_);
-  const std::vector<matrix_shapes> &supported_shapes = iter->second;
-  int Mo = M;
-  int Ko = K;
-  int No = N;
-  int fidx = 0;
-  int f_found = 0;
-  for (size_t i = 0; i < supported_shapes.size(); i++) {
-    auto mat = supported_shapes.at(i);
-    if (M == mat.M && K == mat.K && N == mat.N) {
-      fidx = i;
-      f_found = 1;
+  const std::array<int64_t, 3> shape{M, K, N};
+  auto iter = std::lower_bound(
+      raw_shape_lut_.begin(), raw_shape_lut_.end(), shape,
+      [](const auto &entry, const auto &key) { return entry.first < key; });
+  if (iter == raw_shape_lut_.end() || iter->first != shape) {
+    throw std::runtime_error("Can not find the shape");
+  }
+  const auto &mat = default_shapes_.at(txn_fname_prefix_).at(iter->second);
+  int Mo = (int)mat.M;
+  int Ko = (int)mat.K;
+  int No = (int)mat.N;
+  // std::cout << Mo << ' ' << No << std::endl;
+  return std::make_tuple(Mo, Ko, No);
+}
+
+/*
+ * Split M rows into a sequence of supported kernel M's, for the K x N
+ * (padded to Ko x No) of the weights. Kernel M's are limited to max_m, the
+ * capacity of the activation BO. Plan minimizes the number of padded rows
+ * and then the number of kernel runs, so that decoding with small M doesn't
+ * pay for the largest kernel.
+ */
+template <typename InT, typename WtT, typename OutT>
+std::tuple<int, int, std::vector<int>>
+matmul<InT, WtT, OutT>::get_m_tiles(int M, int K, int N, int max_m) {
+  const auto &raw_shapes = raw_shapes_.at(txn_fname_prefix_);
+  const auto &actual_shapes = default_shapes_.at(txn_fname_prefix_);
+  int Ko = -1;
+  int No = -1;
+  for (size_t i = 0; i < raw_shapes.size(); i++) {
+    if (raw_shapes.at(i).K == K && raw_shapes.at(i).N == N) {
+      Ko = (int)actual_shapes.at(i).K;
+      No = (int)actual_shapes.at(i).N;
       break;
     }
   }
+  if (Ko < 0) {
+    throw std::runtime_error("Can not find the shape");
+  }
 
-  if (f_found == 1) {
-    iter = default_shapes_.find(txn_fname_prefix_);
-    const std::vector<matrix_shapes> &actual_shapes = iter->second;
-    auto mat = actual_shapes.at(fidx);
-    Mo = (int)mat.M;
-    Ko = (int)mat.K;
-    No = (int)mat.N;
-  } else {
+  std::set<int> kernel_ms;
+  for (const auto &mat : actual_shapes) {
+    if (mat.K == Ko && mat.N == No && mat.M <= max_m) {
+      kernel_ms.insert((int)mat.M);
+    }
+  }
+  if (kernel_ms.empty()) {
     throw std::runtime_error("Can not find the shape");
   }
-  // std::cout << Mo << ' ' << No << std::endl;
-  return std::make_tuple(Mo, Ko, No);
+
+  // cost[m] = {padded rows, #runs} of the best plan covering m rows
+  constexpr int INF = std::numeric_limits<int>::max();
+  std::vector<std::pair<int, int>> cost(M + 1, {INF, INF});
+  std::vector<int> last_tile(M + 1, 0);
+  cost[0] = {0, 0};
+  for (int m = 1; m <= M; m++) {
+    for (auto kernel_m : kernel_ms) {
+      const int prev = std::max(0, m - kernel_m);
+      if (cost[prev].first == INF) {
+        continue;
+      }
+      std::pair<int, int> c = {cost[prev].first + kernel_m,
+                               cost[prev].second + 1};
+      if (c < cost[m]) {
+        cost[m] = c;
+        last_tile[m] = kernel_m;
+      }
+    }
+  }
+
+  std::vector<int> tiles;
+  for (int m = M; m > 0; m -= last_tile[m]) {
+    tiles.push_back(last_tile[m]);
+  }
+  // largest tiles first
+  std::sort(tiles.rbegin(), tiles.rend());
+  return std::make_tuple(Ko, No, tiles);
 }
 
 /*
@@ -128,16 +180,9 @@ template <typename InT, typename WtT, typename OutT>
 void matmul<InT, WtT, OutT>::setup_instr_registry() {
   std::vector<std::pair<std::string, bool>> instructions;
   std::vector<std::pair<std::string, bool>> layer_params;
-  std::vector<matrix_shapes> supported_shapes =
-      default_shapes_.find(txn_fname_prefix_)->second;
-  for (size_t i = 0; i < supported_shapes.size(); i++) {
-    auto mat = supported_shapes.at(i);
-    auto key = "gemm_" + get_instr_key(txn_fname_prefix_, mat.M, mat.K, mat.N);
-    auto param_key = "gemm_" +
-                     get_instr_key(param_fname_prefix_, mat.M, mat.K, mat.N) +
-                     "_param";
-    instructions.push_back(std::make_pair(key, false));
-    layer_params.push_back(std::make_pair(param_key, false));
+  for (const auto &kernel : kernel_lut_) {
+    instructions.push_back(std::make_pair(kernel.instr_key, false));
+    layer_params.push_back(std::make_pair(kernel.param_key, false));
   }
   instr_reg_.setup_hw_ctx(xrt_ctx_);
   instr_reg_.add_instructions(instructions);
@@ -150,6 +195,101 @@ std::string matmul<InT, WtT, OutT>::get_instr_key(std::string prefix, int m,
          std::to_string(n);
 }
 
+/*
+ * Sorted lookup tables of the shapes of txn_fname_prefix_, so that the shape
+ * mapping and the BO keys of a kernel don't need a linear search and string
+ * building on every execute.
+ */
+template <typename InT, typename WtT, typename OutT>
+void matmul<InT, WtT, OutT>::build_shape_luts() {
+  raw_shape_lut_.clear();
+  kernel_lut_.clear();
+  const auto raw_iter = raw_shapes_.find(txn_fname_prefix_);
+  if (raw_iter != raw_shapes_.end()) {
+    const auto &raw_shapes = raw_iter->second;
+    for (size_t i = 0; i < raw_shapes.size(); i++) {
+      const auto &mat = raw_shapes.at(i);
+      raw_shape_lut_.push_back({{mat.M, mat.K, mat.N}, i});
+    }
+    // stable, the first of duplicated shapes wins like in a linear search
+    std::stable_sort(
+        raw_shape_lut_.begin(), raw_shape_lut_.end(),
+        [](const auto &a, const auto &b) { return a.first < b.first; });
+  }
+
+  const auto iter = default_shapes_.find(txn_fname_prefix_);
+  if (iter == default_shapes_.end()) {
+    return;
+  }
+  for (const auto &mat : iter->second) {
+    kernel_lut_.push_back(
+        {{mat.M, mat.K, mat.N},
+         "gemm_" + get_instr_key(txn_fname_prefix_, mat.M, mat.K, mat.N),
+         "gemm_" + get_instr_key(param_fname_prefix_, mat.M, mat.K, mat.N) +
+             "_param"});
+  }
+  std::stable_sort(
+      kernel_lut_.begin(), kernel_lut_.end(),
+      [](const auto &a, const auto &b) { return a.shape < b.shape; });
+}
+
+template <typename InT, typename WtT, typename OutT>
+const typename matmul<InT, WtT, OutT>::kernel_entry &
+matmul<InT, WtT, OutT>::find_kernel(int64_t M, int64_t K, int64_t N) const {
+  const std::array<int64_t, 3> shape{M, K, N};
+  auto iter = std::lower_bound(
+      kernel_lut_.begin(), kernel_lut_.end(), shape,
+      [](const auto &entry, const auto &key) { return entry.shape < key; });
+  if (iter == kernel_lut_.end() || iter->shape != shape) {
+    throw std::runtime_error("Can not find the kernel for shape " +
+                             std::to_string(M) + "x" + std::to_string(K) +
+                             "x" + std::to_string(N));
+  }
+  return *iter;
+}
+
+template <typename InT, typename WtT, typename OutT>
+const std::vector<std::string> matmul<InT, WtT, OutT>::overlay_variants_ = {
+    "4x4", "4x2"};
+
+/*
+ * Select the widest overlay variant fitting in num_cols columns of the
+ * array. The column count of a variant is the one of its txns, so a wider
+ * overlay only needs its txns and shape table to be selected.
+ */
+template <typename InT, typename WtT, typename OutT>
+std::string matmul<InT, WtT, OutT>::select_overlay_variant(int num_cols) {
+  std::string selected;
+  int selected_cols = 0;
+  for (const auto &variant : overlay_variants_) {
+    auto prefix = "gemm_" + variant + "_" + txnbin_a_header.at(a_dtype_) +
+                  txnbin_b_header.at(b_dtype_) +
+                  txnbin_acc_header.at(c_dtype_);
+    auto iter = default_shapes_.find(prefix);
+    if (iter == default_shapes_.end() || iter->second.empty()) {
+      continue;
+    }
+    const auto &mat = iter->second.front();
+    std::vector<uint8_t> txn;
+    Transaction::getInstance().get_txn_bin(
+        "gemm_" + get_instr_key(prefix, mat.M, mat.K, mat.N), txn);
+    DOD_THROW_IF(txn.size() < sizeof(XAie_TxnHeader),
+                 OpsFusion::dod_format("Invalid txn for overlay {}", variant));
+    int variant_cols =
+        reinterpret_cast<const XAie_TxnHeader *>(txn.data())->NumCols;
+    RYZENAI_LOG_TRACE(OpsFusion::dod_format("overlay {} : {} cols", variant,
+                                            variant_cols));
+    if (variant_cols <= num_cols && variant_cols > selected_cols) {
+      selected = variant;
+      selected_cols = variant_cols;
+    }
+  }
+  DOD_THROW_IF(selected.empty(),
+               OpsFusion::dod_format("No Matmul overlay fits in {} cols",
+                                     num_cols));
+  return selected;
+}
+
 /*
  * matmul class constructor
  *
@@ -366,6 +506,18 @@ matmul<InT, WtT, OutT>::matmul(const std::string &a_dtype,
     }
     RYZENAI_LOG_TRACE("iConv: DesignFormat: " + design_param_);
   }
+  // Without an explicit design, run the widest overlay of the partition
+  if (design_param_.empty() && attr.count("overlay_num_cols") &&
+      attr.at("overlay_num_cols").type() == typeid(std::vector<int>)) {
+    const auto &num_cols_vector =
+        std::any_cast<const std::vector<int> &>(attr.at("overlay_num_cols"));
+    DOD_THROW_IF(num_cols_vector.size() != 1,
+                 OpsFusion::dod_format(
+                     "Matmul : expect 1 overlay_num_cols, got {}",
+                     num_cols_vector.size()));
+    design_param_ = select_overlay_variant(num_cols_vector[0]);
+    RYZENAI_LOG_TRACE("Matmul: selected overlay: " + design_param_);
+  }
   txn_fname_prefix_ = "gemm_4x2_" + txnbin_a_header.at(a_dtype_) +
                       txnbin_b_header.at(b_dtype_) +
                       txnbin_acc_header.at(c_dtype_);
@@ -414,6 +566,8 @@ matmul<InT, WtT, OutT>::matmul(const std::string &a_dtype,
   RYZENAI_LOG_TRACE(
       OpsFusion::dod_format("param_fname_prefix : {}", param_fname_prefix_));
 
+  build_shape_luts();
+
   if (load_xrt) {
     xrt_ctx_ = dynamic_dispatch::xrt_context::get_instance(XCLBIN_FNAME);
     std::call_once(instr_reg_flag_, [this]() { setup_instr_registry(); });
@@ -475,9 +629,17 @@ void matmul<InT, WtT, OutT>::set_params(const std::string &model_name,
     throw std::invalid_argument("model_name is not supported");
   }
 
-  auto [M, K, N] =
-      map_padded_shape(input_shape.at(0), input_shape.at(1), input_shape.at(2));
-  KERNEL_M_MAX = M;
+  if (design_param_.find("4x4") != std::string::npos) {
+    auto [M, K, N] = map_padded_shape(input_shape.at(0), input_shape.at(1),
+                                      input_shape.at(2));
+    KERNEL_M_MAX = M;
+  } else {
+    // M need not be in the shape table, size the BOs for its largest tile
+    auto [K, N, m_tiles] =
+        get_m_tiles(input_shape.at(0), input_shape.at(1), input_shape.at(2),
+                    std::numeric_limits<int>::max());
+    KERNEL_M_MAX = m_tiles.front();
+  }
 
   xrt_ctx_ = dynamic_dispatch::xrt_context::get_instance(XCLBIN_FNAME);
   std::call_once(instr_reg_flag_, [this]() { setup_instr_registry(); });
@@ -777,78 +939,87 @@ void matmul<InT, WtT, OutT>::execute(const std::vector<Tensor> &input,
   auto aie_out = (OutT *)output.at(0).data;
   auto a = (InT *)input.at(0).data;
 
-  auto [M, K, N] = map_padded_shape(a_shape_[0], a_shape_[1], c_shape_[1]);
-  kernel_x_rows = M;
-
-  int64_t a_copy_start = GET_ELAPSED_TIME_NS();
-  InT *a_bo_map = a_bo_.map<InT *>();
-  if (K == a_shape_[1]) {
-    memcpy((void *)a_bo_map, (void *)a,
-           (a_shape_[0] * a_shape_[1] * a_dtype_size_));
+  // Rows are run through one or more supported kernel M's, so padding is
+  // bounded by the smallest kernel M. Weight format of the 4x4 design depends
+  // on M, so it always runs the padded shape of the model.
+  int K, N;
+  std::vector<int> m_tiles;
+  if (design_param_.find("4x4") != std::string::npos) {
+    int M;
+    std::tie(M, K, N) =
+        map_padded_shape(a_shape_[0], a_shape_[1], c_shape_[1]);
+    m_tiles = {M};
   } else {
-    for (int i = 0; i < a_shape_[0]; i++) {
-      memcpy((void *)&a_bo_map[i * K], (void *)&a[i * a_shape_[1]],
-             (a_shape_[1] * a_dtype_size_));
-    }
+    std::tie(K, N, m_tiles) = get_m_tiles(a_shape_[0], a_shape_[1],
+                                          c_shape_[1], kernel_x_shape_[0]);
   }
-  int64_t a_copy_stop = GET_ELAPSED_TIME_NS();
-  int64_t a_sync_start = GET_ELAPSED_TIME_NS();
-  a_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  int64_t a_sync_stop = GET_ELAPSED_TIME_NS();
-  a_copy_time_ = a_copy_stop - a_copy_start;
-  a_sync_time_ = a_sync_stop - a_sync_start;
-
-  // INIT with zeros
-  auto instr_bo_key = "gemm_" + txn_fname_prefix_ + "_" +
-                      std::to_string(kernel_x_rows) + "_" +
-                      std::to_string(kernel_x_shape_[1]) + "_" +
-                      std::to_string(kernel_y_shape_[1]);
-  auto param_bo_key = "gemm_" + param_fname_prefix_ + "_" +
-                      std::to_string(kernel_x_rows) + "_" +
-                      std::to_string(kernel_x_shape_[1]) + "_" +
-                      std::to_string(kernel_y_shape_[1]) + "_param";
-  const xrt::bo &instr_bo = instr_reg_.get_instr_bo(instr_bo_key).second;
-  const xrt::bo &param_bo = instr_reg_.get_param_bo(param_bo_key).second;
-  int instr_bo_words = instr_bo.size() / sizeof(int);
   auto kernel_ = xrt_ctx_->get_kernel();
 
-  xrt::run run;
-  // launch the GEMM kernel
-  int64_t run_aie_start = GET_ELAPSED_TIME_NS();
-  // kernel call for GEMM that supports transaction binary flow
-  c_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  run = kernel_(2, instr_bo, instr_bo_words,
-                c_bo_.address() + DDR_AIE_ADDR_OFFSET,
-                a_bo_.address() + DDR_AIE_ADDR_OFFSET,
-                b_bo_.address() + DDR_AIE_ADDR_OFFSET,
-                param_bo.address() + DDR_AIE_ADDR_OFFSET, 0);
-  run.wait2();
-  int64_t run_aie_stop = GET_ELAPSED_TIME_NS();
-  num_run_aie_++;
-  // sync output activation to host memory
-  int64_t c_sync_start = GET_ELAPSED_TIME_NS();
-  c_bo_.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
-  OutT *c_bo_map = c_bo_.map<OutT *>();
-  int64_t c_sync_stop = GET_ELAPSED_TIME_NS();
-  c_sync_time_ += c_sync_stop - c_sync_start;
-  run_aie_time_ += run_aie_stop - run_aie_start;
-  if (0) {
-    std::map<std::string, std::any> attr;
-    attr["input_shape"] =
-        std::vector<int>{1, (int)a_shape_[0], (int)a_shape_[1]};
-    attr["orig_output_shape"] =
-        std::vector<int>{1, (int)c_shape_[0], (int)c_shape_[1]};
-    format_output(&output.at(0), c_bo_map, M * N * c_dtype_size_, 0, attr);
-  } else {
+  int64_t m_offset = 0;
+  for (auto tile_m : m_tiles) {
+    kernel_x_rows = tile_m;
+    const int64_t rows = std::min<int64_t>(tile_m, a_shape_[0] - m_offset);
+
+    int64_t a_copy_start = GET_ELAPSED_TIME_NS();
+    InT *a_bo_map = a_bo_.map<InT *>();
+    const InT *a_tile = a + m_offset * a_shape_[1];
+    if (K == a_shape_[1]) {
+      memcpy((void *)a_bo_map, (void *)a_tile,
+             (rows * a_shape_[1] * a_dtype_size_));
+    } else {
+      for (int i = 0; i < rows; i++) {
+        memcpy((void *)&a_bo_map[i * K], (void *)&a_tile[i * a_shape_[1]],
+               (a_shape_[1] * a_dtype_size_));
+      }
+    }
+    int64_t a_copy_stop = GET_ELAPSED_TIME_NS();
+    int64_t a_sync_start = GET_ELAPSED_TIME_NS();
+    a_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    int64_t a_sync_stop = GET_ELAPSED_TIME_NS();
+    a_copy_time_ += a_copy_stop - a_copy_start;
+    a_sync_time_ += a_sync_stop - a_sync_start;
+
+    // INIT with zeros
+    const auto &kernel =
+        find_kernel(kernel_x_rows, kernel_x_shape_[1], kernel_y_shape_[1]);
+    const xrt::bo &instr_bo =
+        instr_reg_.get_instr_bo(kernel.instr_key).second;
+    const xrt::bo &param_bo =
+        instr_reg_.get_param_bo(kernel.param_key).second;
+    int instr_bo_words = instr_bo.size() / sizeof(int);
+
+    xrt::run run;
+    // launch the GEMM kernel
+    int64_t run_aie_start = GET_ELAPSED_TIME_NS();
+    // kernel call for GEMM that supports transaction binary flow
+    c_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    run = kernel_(2, instr_bo, instr_bo_words,
+                  c_bo_.address() + DDR_AIE_ADDR_OFFSET,
+                  a_bo_.address() + DDR_AIE_ADDR_OFFSET,
+                  b_bo_.address() + DDR_AIE_ADDR_OFFSET,
+                  param_bo.address() + DDR_AIE_ADDR_OFFSET, 0);
+    run.wait2();
+    int64_t run_aie_stop = GET_ELAPSED_TIME_NS();
+    num_run_aie_++;
+    // sync output activation to host memory
+    int64_t c_sync_start = GET_ELAPSED_TIME_NS();
+    c_bo_.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+    OutT *c_bo_map = c_bo_.map<OutT *>();
+    int64_t c_sync_stop = GET_ELAPSED_TIME_NS();
+    c_sync_time_ += c_sync_stop - c_sync_start;
+    run_aie_time_ += run_aie_stop - run_aie_start;
+
+    OutT *c_tile = aie_out + m_offset * c_shape_[1];
     if (N == c_shape_[1]) {
-      memcpy((void *)aie_out, (void *)c_bo_map,
-             (c_shape_[0] * c_shape_[1] * c_dtype_size_));
+      memcpy((void *)c_tile, (void *)c_bo_map,
+             (rows * c_shape_[1] * c_dtype_size_));
     } else {
-      for (int i = 0; i < c_shape_[0]; i++) {
-        memcpy((void *)&aie_out[i * c_shape_[1]], (void *)&c_bo_map[i * N],
+      for (int i = 0; i < rows; i++) {
+        memcpy((void *)&c_tile[i * c_shape_[1]], (void *)&c_bo_map[i * N],
                (c_shape_[1] * c_dtype_size_));
       }
     }
+    m_offset += rows;
   }
 
   int64_t exec_end = GET_ELAPSED_TIME_NS();
@@ -882,13 +1053,19 @@ void matmul<InT, WtT, OutT>::debug(bool enable) {
   debug_ = enable;
 }
 
+template <typename InT, typename WtT, typename OutT>
+OpExecTimes matmul<InT, WtT, OutT>::get_exec_times() const {
+  return {a_copy_time_ + c_copy_time_, a_sync_time_ + c_sync_time_,
+          run_aie_time_};
+}
+
 template <typename InT, typename WtT, typename OutT>
 const std::vector<uint8_t> matmul<InT, WtT, OutT>::get_transaction_bin(
     std::vector<Tensor> &input, std::vector<Tensor> &output,
     const std::map<std::string, std::any> &attr) {
   auto [M, K, N] = extract_MKN(input);
   auto [Mo, Ko, No] = map_padded_shape(M, K, N);
-  std::string txn_key = "gemm_" + get_instr_key(txn_fname_prefix_, Mo, Ko, No);
+  const std::string &txn_key = find_kernel(Mo, Ko, No).instr_key;
   Transaction &txn = Transaction::getInstance();
   std::string txn_string = txn.get_txn_str(txn_key);
   std::istringstream txn_stream(txn_string, std::ios::binary);
@@ -905,8 +1082,7 @@ const std::vector<uint8_t> matmul<InT, WtT, OutT>::get_super_kernel_params(
   auto [M, K, N] = extract_MKN(input);
   auto [Mo, Ko, No] = map_padded_shape(M, K, N);
   // TODO: Add check to validate tensor shapes
-  std::string param_key =
-      "gemm_" + get_instr_key(param_fname_prefix_, Mo, Ko, No) + "_param";
+  const std::string &param_key = find_kernel(Mo, Ko, No).param_key;
   Transaction &txn = Transaction::getInstance();
   std::string param_string = txn.get_txn_str(param_key);
   std::istringstream params_stream(param_string, std::ios::binary);
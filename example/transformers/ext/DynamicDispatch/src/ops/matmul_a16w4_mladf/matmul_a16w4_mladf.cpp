@@ -0,0 +1,575 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include <any>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <tuple>
+#include <utility>
+
+// XRT headers
+#include "xrt/xrt_bo.h"
+#include "xrt/xrt_device.h"
+#include "xrt/xrt_kernel.h"
+
+// dpu kernel metadata
+#include <utils/dpu_mdata.hpp>
+
+#include <utils/instruction_registry.hpp>
+#include <utils/txn_container.hpp>
+#include <xrt_context/xrt_context.hpp>
+
+#include <ops/matmul_a16w4_mladf/matmul_a16w4_mladf.hpp>
+#include <ops/op_interface.hpp>
+#include <utils/logging.hpp>
+#include <utils/utils.hpp>
+
+// Headers for w4 matrix formatting
+#include "ops/ops_common/matmul_a16w4_mladf_matrix.hpp"
+namespace ryzenai {
+
+static std::tuple<int, int, int>
+extract_MKN(const std::vector<Tensor> &inputs) {
+  // inputs[0] --> input
+  // inputs[1] --> wts
+
+  int M;
+  if (inputs.at(0).shape.size() == 2) {
+    M = inputs.at(0).shape.at(0);
+  } else if (inputs.at(0).shape.size() == 3) { // has batch_dim
+    M = inputs.at(0).shape.at(0) * inputs.at(0).shape.at(1);
+  } else {
+    throw std::runtime_error("Input Shape is not supported");
+  }
+  int K = inputs.at(1).shape.at(0);
+  int N = inputs.at(1).shape.at(1);
+
+  return std::make_tuple(M, K, N);
+}
+
+template <typename InT, typename WtT, typename OutT>
+int matmul_a16w4_mladf<InT, WtT, OutT>::map_padded_shape(int M, int K,
+                                                         int N) {
+  const auto &supported_shapes = default_shapes_.at(txn_fname_prefix_);
+  int Mo = 0;
+  for (const auto &mat : supported_shapes) {
+    if (mat.K == K && mat.N == N && mat.M >= M && (Mo == 0 || mat.M < Mo)) {
+      Mo = (int)mat.M;
+    }
+  }
+  DOD_THROW_IF(Mo == 0, OpsFusion::dod_format(
+                            "MATMUL_MLADF_A16W4 : no kernel for M {} K {} N {}",
+                            M, K, N));
+  return Mo;
+}
+
+template <typename InT, typename WtT, typename OutT>
+size_t matmul_a16w4_mladf<InT, WtT, OutT>::get_wts_size(int K, int N,
+                                                        int group_size) {
+  size_t num_sv = (size_t(K) * N) / (matmul_a16w4_mladf_matrix::Ksubv *
+                                     matmul_a16w4_mladf_matrix::Nsubv);
+  return num_sv * matmul_a16w4_mladf_matrix::subv_size(group_size);
+}
+
+template <typename InT, typename WtT, typename OutT>
+std::once_flag matmul_a16w4_mladf<InT, WtT, OutT>::logger_flag_;
+
+template <typename InT, typename WtT, typename OutT>
+uint64_t matmul_a16w4_mladf<InT, WtT, OutT>::matmul_mladf_count = 0;
+
+template <typename InT, typename WtT, typename OutT>
+std::once_flag matmul_a16w4_mladf<InT, WtT, OutT>::instr_reg_flag_;
+
+template <typename InT, typename WtT, typename OutT>
+void matmul_a16w4_mladf<InT, WtT, OutT>::debug(bool enable) {
+  debug_ = enable;
+}
+
+template <typename InT, typename WtT, typename OutT>
+std::string
+matmul_a16w4_mladf<InT, WtT, OutT>::get_instr_key(std::string prefix, int m,
+                                                  int k, int n) {
+  auto instr_key = prefix + "_" + std::to_string(m) + "_" + std::to_string(k) +
+                   "_" + std::to_string(n);
+  return instr_key;
+}
+
+template <typename InT, typename WtT, typename OutT>
+void matmul_a16w4_mladf<InT, WtT, OutT>::setup_instr_registry() {
+
+  std::vector<std::pair<std::string, bool>> instructions;
+  std::vector<matrix_shapes> supported_shapes =
+      default_shapes_.find(txn_fname_prefix_)->second;
+
+  for (int i = 0; i < supported_shapes.size(); i++) {
+    auto mat = supported_shapes.at(i);
+
+    auto key =
+        "gemm_mladf_" + get_instr_key(txn_fname_prefix_, mat.M, mat.K, mat.N);
+    instructions.push_back(std::make_pair(key, false));
+  }
+  instr_reg_.setup_hw_ctx(xrt_ctx_);
+  instr_reg_.add_instructions(instructions);
+}
+
+template <typename InT, typename WtT, typename OutT>
+matmul_a16w4_mladf<InT, WtT, OutT>::matmul_a16w4_mladf(
+    const std::string &a_dtype, const std::string &b_dtype,
+    const std::string &c_dtype, bool load_xrt) {
+
+  txnbin_a_header = {{"uint16", "a16"}, {"int16", "a16"}};
+
+  txnbin_b_header = {{"uint4", "w4"}};
+
+  txnbin_acc_header = {{"uint16", "acc16"}, {"int16", "acc16"}};
+
+  // padded M x K x N of the kernels, the activation rows are padded to M
+  default_shapes_["gemm_mladf_a16w4acc16"] = std::vector<matrix_shapes>();
+  for (int64_t M : {1, 128, 2048}) {
+    default_shapes_["gemm_mladf_a16w4acc16"].emplace_back(M, 4096, 4096);
+    default_shapes_["gemm_mladf_a16w4acc16"].emplace_back(M, 4096, 11008);
+    default_shapes_["gemm_mladf_a16w4acc16"].emplace_back(M, 11008, 4096);
+  }
+
+  DPU_DIR = OpInterface::get_dod_base_dir() + "//transaction//" + "stx";
+
+  a_dtype_ = a_dtype;
+  b_dtype_ = b_dtype;
+  c_dtype_ = c_dtype;
+
+  param_dtype_size_ = sizeof(uint32_t);
+  a_dtype_size_ = sizeof(InT);
+  c_dtype_size_ = sizeof(OutT);
+  group_size_ = matmul_a16w4_mladf_matrix::Ksubv;
+
+  matmul_mladf_id_ = matmul_mladf_count++;
+
+  /*select xclbin based on the input/output types*/
+  std::string XCLBIN_FNAME = OpInterface::get_dod_base_dir() +
+                             ryzenai::MLADF_4x2_GEMM_A16W4_XCLBIN_PATH;
+
+  txn_fname_prefix_ = "gemm_mladf_" + txnbin_a_header.at(a_dtype_) +
+                      txnbin_b_header.at(b_dtype_) +
+                      txnbin_acc_header.at(c_dtype_);
+
+  if (load_xrt) {
+    xrt_ctx_ = dynamic_dispatch::xrt_context::get_instance(XCLBIN_FNAME);
+    std::call_once(instr_reg_flag_, [this]() { setup_instr_registry(); });
+  }
+  KERNEL_M_MAX = 2048;
+
+  a_copy_time_ = 0;
+  a_sync_time_ = 0;
+  b_copy_time_ = 0;
+  b_format_time_ = 0;
+  b_sync_time_ = 0;
+  c_copy_time_ = 0;
+  c_sync_time_ = 0;
+  run_aie_time_ = 0;
+  num_run_aie_ = 0;
+
+  std::call_once(logger_flag_, []() {
+    std::string header =
+        "matmul_mladf_id M K N kernel_m kernel_k kernel_n Execute"
+        "time(us) num_aie_runs run_aie_time(ns) "
+        "A_copy_time(ns) A_sync_time(ns) "
+        "C_copy_time(ns) C_sync_time(ns) "
+        "Avg_time_per_aie_run(ns) group_size\n";
+    RYZENAI_LOG_INFO(header);
+  });
+
+  RYZENAI_LOG_TRACE("[OP] ID: " + std::to_string(matmul_mladf_id_) +
+                    ", XCLBIN: " + XCLBIN_FNAME +
+                    ", (a_dtype, b_dtype, c_dtype): (" + a_dtype_ + ", " +
+                    b_dtype_ + ", " + c_dtype_ + ")");
+}
+
+template <typename InT, typename WtT, typename OutT>
+void matmul_a16w4_mladf<InT, WtT, OutT>::set_params(
+    const std::string &model_name, std::vector<size_t> input_shape) {
+  std::string XCLBIN_FNAME = OpInterface::get_dod_base_dir() +
+                             ryzenai::MLADF_4x2_GEMM_A16W4_XCLBIN_PATH;
+  // input_shape is the M x K of the activation, the largest M of the K
+  // sizes the activation BO
+  int M_max = 0;
+  for (const auto &mat : default_shapes_.at(txn_fname_prefix_)) {
+    if (mat.K == (int64_t)input_shape.at(1) && mat.M >= M_max) {
+      M_max = (int)mat.M;
+    }
+  }
+  DOD_THROW_IF(M_max < (int)input_shape.at(0),
+               OpsFusion::dod_format("MATMUL_MLADF_A16W4 : no kernel for M {} "
+                                     "K {} ({})",
+                                     input_shape.at(0), input_shape.at(1),
+                                     model_name));
+  KERNEL_M_MAX = M_max;
+
+  xrt_ctx_ = dynamic_dispatch::xrt_context::get_instance(XCLBIN_FNAME);
+  std::call_once(instr_reg_flag_, [this]() { setup_instr_registry(); });
+}
+
+template <typename InT, typename WtT, typename OutT>
+void matmul_a16w4_mladf<InT, WtT, OutT>::set_kernel_shapes() {
+  // Use largest M dimension as the default
+  //    NOTE: smaller M's are selected in execute
+  RYZENAI_LOG_TRACE("GEMM_MLADF_A16W4: w_shape0:" +
+                    std::to_string(w_shape_[0]) +
+                    " w_shape1:" + std::to_string(w_shape_[1]));
+  kernel_x_shape_[0] = KERNEL_M_MAX;
+  kernel_z_shape_[0] = KERNEL_M_MAX;
+
+  kernel_x_shape_[1] = w_shape_[0];
+  kernel_y_shape_[0] = w_shape_[0];
+  kernel_y_shape_[1] = w_shape_[1];
+  kernel_z_shape_[1] = w_shape_[1];
+}
+
+// const_params --> [weights, qdq_c0, group_c1, group_c2, ...]
+// weights is K x N with one uint4 value per byte, group_c1 and group_c2
+// are (K / group_size) x N
+template <typename InT, typename WtT, typename OutT>
+void matmul_a16w4_mladf<InT, WtT, OutT>::initialize_wts(
+    void *dest, const std::vector<Tensor> &const_params,
+    const std::map<std::string, std::any> &attr) {
+  RYZENAI_LOG_TRACE("matmul_a16w4_mladf initialize_const_params(ptr) ...");
+  DOD_THROW_IF(
+      (const_params.size() < 4) || (const_params.at(0).shape.size() != 2) ||
+          (const_params.at(1).shape.size() != 1) ||
+          (const_params.at(2).shape.size() != 2) ||
+          (const_params.at(2).shape != const_params.at(3).shape),
+      OpsFusion::dod_format("Unsupported const spec for Matmul Mladf A16W4\n") +
+          OpsFusion::dod_format(
+              "(Details : #const params >= 4 ({}), Const param1 dim == 2 "
+              "({}), Const param2 dim == 1 ({}), Const param3 dim == 2 ({})",
+              const_params.size(), const_params.at(0).shape.size(),
+              const_params.at(1).shape.size(),
+              const_params.at(2).shape.size()));
+
+  const int w_idx = 0, qdq_idx = 1, c1_idx = 2, c2_idx = 3;
+  // The first data is Weight
+  auto weights = (WtT *)const_params.at(w_idx).data;
+  std::vector<size_t> shape = const_params.at(w_idx).shape;
+  w_shape_[0] = shape[0];
+  w_shape_[1] = shape[1];
+  const auto &group_shape = const_params.at(c1_idx).shape;
+  DOD_THROW_IF(group_shape[1] != shape[1] || group_shape[0] == 0 ||
+                   shape[0] % group_shape[0] != 0,
+               OpsFusion::dod_format("MATMUL_MLADF_A16W4 : group coefficients "
+                                     "{}x{} do not match the weights {}x{}",
+                                     group_shape[0], group_shape[1], shape[0],
+                                     shape[1]));
+  group_size_ = (int)(shape[0] / group_shape[0]);
+  DOD_THROW_IF(
+      !matmul_a16w4_mladf_matrix::is_supported_group_size(group_size_),
+      OpsFusion::dod_format("MATMUL_MLADF_A16W4 : unsupported group size {}",
+                            group_size_));
+
+  set_kernel_shapes();
+
+  auto qdq = (int64_t *)const_params.at(qdq_idx).data;
+  auto c1 = (int32_t *)const_params.at(c1_idx).data;
+  auto c2 = (int32_t *)const_params.at(c2_idx).data;
+
+  std::vector<uint8_t> buf(
+      matmul_a16w4_mladf_matrix::WgtMatrix<
+          matmul_a16w4_mladf_matrix::Ksubv,
+          matmul_a16w4_mladf_matrix::Nsubv>::size(w_shape_[0], w_shape_[1]));
+  matmul_a16w4_mladf_matrix::WgtMatrix<matmul_a16w4_mladf_matrix::Ksubv,
+                                       matmul_a16w4_mladf_matrix::Nsubv>
+      W(w_shape_[0], w_shape_[1], buf.data());
+  for (int r = 0; r < w_shape_[0]; ++r) {
+    for (int c = 0; c < w_shape_[1]; ++c) {
+      W.set(r, c, weights[(r * w_shape_[1]) + c]);
+    }
+  }
+
+  const int Ksubv = matmul_a16w4_mladf_matrix::Ksubv;
+  const int Nsubv = matmul_a16w4_mladf_matrix::Nsubv;
+  const int groups_per_sv = Ksubv / group_size_;
+  auto wts_size = Ksubv * Nsubv / 2;
+  auto qdq_size = Nsubv * sizeof(int64_t);
+  auto coeffs_size = Nsubv * sizeof(int32_t);
+  int write_offset = 0;
+  //// WGT + QDQ
+  { // This section of the code interleaves the qdq coefficients with the
+    // weights: Nsubv of c0 and the c1, c2 of the groups of every K x N
+
+    for (int N_shard = 0; N_shard < (w_shape_[1]) / Nsubv; N_shard++) {
+      for (int K_shard = 0; K_shard < (w_shape_[0]) / Ksubv; K_shard++) {
+        // WTS
+        memcpy((void *)(reinterpret_cast<int8_t *>(dest) + write_offset),
+               (void *)&buf[((N_shard * w_shape_[0] * Nsubv) +
+                             (K_shard * Ksubv * Nsubv)) /
+                            2],
+               wts_size);
+        write_offset += wts_size;
+        // C0
+        memcpy((void *)(reinterpret_cast<int8_t *>(dest) + write_offset),
+               (void *)&qdq[N_shard * Nsubv], qdq_size);
+        write_offset += qdq_size;
+        // C1, C2 of the groups
+        for (auto *coeffs : {c1, c2}) {
+          for (int g = 0; g < groups_per_sv; g++) {
+            int group = K_shard * groups_per_sv + g;
+            memcpy((void *)(reinterpret_cast<int8_t *>(dest) + write_offset),
+                   (void *)&coeffs[group * w_shape_[1] + N_shard * Nsubv],
+                   coeffs_size);
+            write_offset += coeffs_size;
+          }
+        }
+      }
+    }
+  }
+  RYZENAI_LOG_TRACE("matmul_a16w4_mladf initialize_const_params(ptr) ... DONE");
+}
+
+template <typename InT, typename WtT, typename OutT>
+void matmul_a16w4_mladf<InT, WtT, OutT>::initialize_const_params(
+    void *dest, const std::vector<Tensor> &const_params,
+    const std::map<std::string, std::any> &attr) {
+  initialize_wts(dest, const_params);
+  const Tensor &kernel_params = const_params.at(4);
+  size_t params_bytes = kernel_params.shape[0] * sizeof(int32_t);
+  kernel_params_.assign((uint8_t *)kernel_params.data,
+                        (uint8_t *)kernel_params.data + params_bytes);
+}
+
+template <typename InT, typename WtT, typename OutT>
+const std::vector<uint8_t>
+matmul_a16w4_mladf<InT, WtT, OutT>::get_super_kernel_params(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  std::vector<uint8_t> params = kernel_params_;
+  params.resize(64);
+  return params;
+}
+
+// For MATMUL_Mladf_A16W4: weight + qdq_c0 + group_c1 + group_c2
+template <typename InT, typename WtT, typename OutT>
+void matmul_a16w4_mladf<InT, WtT, OutT>::initialize_const_params(
+    const std::vector<Tensor> &const_params,
+    const std::map<std::string, std::any> &attr) {
+  // Check the number of inputs
+  if (const_params.size() != 4) {
+    throw std::runtime_error(
+        "MATMUL_Mladf_A16W4 expect to have four constant.");
+  }
+  const int w_idx = 0, c1_idx = 2;
+  std::vector<size_t> shape = const_params.at(w_idx).shape;
+  w_shape_[0] = shape[0];
+  w_shape_[1] = shape[1];
+  int group_size = (int)(shape[0] / const_params.at(c1_idx).shape.at(0));
+  // Init the BO size
+  set_kernel_shapes();
+
+  // Create input/output BOs
+  const int PARAM_BO_SIZE = (16 * param_dtype_size_);
+  const int A_BO_SIZE =
+      (kernel_x_shape_[0] * kernel_x_shape_[1] * a_dtype_size_);
+  const int B_BO_SIZE = get_wts_size(w_shape_[0], w_shape_[1], group_size);
+  const int C_BO_SIZE =
+      (kernel_z_shape_[0] * kernel_z_shape_[1] * c_dtype_size_);
+  RYZENAI_LOG_TRACE("GEMM_MLADF_A16W4: A_BO_SIZE:" + std::to_string(A_BO_SIZE) +
+                    " B_BO_SIZE:" + std::to_string(B_BO_SIZE) +
+                    " C_BO_SIZE:" + std::to_string(C_BO_SIZE));
+  param_bo_ =
+      xrt::bo(xrt_ctx_->get_device(), PARAM_BO_SIZE, XRT_BO_FLAGS_HOST_ONLY,
+              xrt_ctx_->get_kernel().group_id(0));
+  a_bo_ = xrt::bo(xrt_ctx_->get_device(), A_BO_SIZE, XRT_BO_FLAGS_HOST_ONLY,
+                  xrt_ctx_->get_kernel().group_id(0));
+  b_bo_ = xrt::bo(xrt_ctx_->get_device(), B_BO_SIZE, XRT_BO_FLAGS_HOST_ONLY,
+                  xrt_ctx_->get_kernel().group_id(0));
+  c_bo_ = xrt::bo(xrt_ctx_->get_device(), C_BO_SIZE, XRT_BO_FLAGS_HOST_ONLY,
+                  xrt_ctx_->get_kernel().group_id(0));
+
+  // copy b_bo
+  b_copy_time_ = 0;
+  b_format_time_ = 0;
+  b_sync_time_ = 0;
+  auto b_copy_start = GET_ELAPSED_TIME_NS();
+  auto b_format_start = GET_ELAPSED_TIME_NS();
+  uint8_t *b_bo_map = b_bo_.map<uint8_t *>();
+  initialize_wts(b_bo_map, const_params);
+  auto b_format_stop = GET_ELAPSED_TIME_NS();
+  auto b_copy_stop = GET_ELAPSED_TIME_NS();
+  b_format_time_ += b_format_stop - b_format_start;
+  b_copy_time_ = b_copy_stop - b_copy_start;
+
+  // sync b_bo
+  auto b_sync_start = GET_ELAPSED_TIME_NS();
+  b_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  auto b_sync_stop = GET_ELAPSED_TIME_NS();
+  b_sync_time_ = b_sync_stop - b_sync_start;
+}
+
+// matmul mladf a16w4
+template <typename InT, typename WtT, typename OutT>
+void matmul_a16w4_mladf<InT, WtT, OutT>::execute(
+    const std::vector<Tensor> &input, std::vector<Tensor> &output) {
+  // Check the number of inputs
+  if (input.size() != 2) {
+    throw std::runtime_error("MATMUL_Mladf_A16W4 expect to have two input.");
+  }
+  const int param_idx = 0, a_idx = 1;
+  // The first data is a
+  InT *a = (InT *)input.at(a_idx).data;
+  uint32_t *param = (uint32_t *)input.at(param_idx).data;
+
+  param_copy_time_ = 0;
+  param_sync_time_ = 0;
+  a_copy_time_ = 0;
+  a_sync_time_ = 0;
+  b_copy_time_ = 0;
+  b_format_time_ = 0;
+  b_sync_time_ = 0;
+  c_copy_time_ = 0;
+  c_sync_time_ = 0;
+  run_aie_time_ = 0;
+
+  int64_t exec_start = GET_ELAPSED_TIME_NS();
+
+  param_shape_[0] = input.at(param_idx).shape.at(0);
+
+  a_shape_[0] = input.at(a_idx).shape.at(0);
+  a_shape_[1] = input.at(a_idx).shape.at(1);
+
+  c_shape_[0] = a_shape_[0];
+  c_shape_[1] = w_shape_[1];
+
+  kernel_x_rows = map_padded_shape(a_shape_[0], w_shape_[0], w_shape_[1]);
+
+  // param_bo copy
+  int64_t param_copy_start = GET_ELAPSED_TIME_NS();
+  uint32_t *param_bo_map = param_bo_.map<uint32_t *>();
+  int param_size = param_shape_[0] * sizeof(uint32_t);
+  memcpy((void *)param_bo_map, (void *)param, param_size);
+  int64_t param_copy_stop = GET_ELAPSED_TIME_NS();
+
+  // param_bo sync
+  int64_t param_sync_start = GET_ELAPSED_TIME_NS();
+  param_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  int64_t param_sync_stop = GET_ELAPSED_TIME_NS();
+
+  param_copy_time_ = param_copy_stop - param_copy_start;
+  param_sync_time_ = param_sync_stop - param_sync_start;
+
+  // a_bo copy, the padding rows only produce rows that are not copied back
+  int64_t a_copy_start = GET_ELAPSED_TIME_NS();
+  InT *a_bo_map = a_bo_.map<InT *>();
+  int a_size = a_shape_[0] * a_shape_[1] * sizeof(InT);
+  memcpy((void *)a_bo_map, (void *)a, a_size);
+  int64_t a_copy_stop = GET_ELAPSED_TIME_NS();
+
+  // a_bo sync
+  int64_t a_sync_start = GET_ELAPSED_TIME_NS();
+  a_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE,
+             kernel_x_rows * kernel_x_shape_[1] * sizeof(InT), 0);
+  int64_t a_sync_stop = GET_ELAPSED_TIME_NS();
+
+  a_copy_time_ = a_copy_stop - a_copy_start;
+  a_sync_time_ = a_sync_stop - a_sync_start;
+
+  // prepare inst_bo and param_bo
+  auto instr_bo_key =
+      "gemm_mladf_" + get_instr_key(txn_fname_prefix_, kernel_x_rows,
+                                    kernel_x_shape_[1], kernel_y_shape_[1]);
+  const xrt::bo &instr_bo = instr_reg_.get_instr_bo(instr_bo_key).second;
+  int instr_bo_words = instr_bo.size() / sizeof(int);
+  auto kernel_ = xrt_ctx_->get_kernel();
+  // launch the kernel
+  xrt::run run;
+  int64_t run_aie_start = GET_ELAPSED_TIME_NS();
+  run = kernel_(2, instr_bo, instr_bo_words,
+                param_bo_.address() + DDR_AIE_ADDR_OFFSET,
+                b_bo_.address() + DDR_AIE_ADDR_OFFSET,
+                a_bo_.address() + DDR_AIE_ADDR_OFFSET,
+                c_bo_.address() + DDR_AIE_ADDR_OFFSET, 0);
+  run.wait2();
+  int64_t run_aie_stop = GET_ELAPSED_TIME_NS();
+  run_aie_time_ += run_aie_stop - run_aie_start;
+  num_run_aie_++;
+
+  // sync output activation to host memory
+  int64_t c_sync_start = GET_ELAPSED_TIME_NS();
+  c_bo_.sync(XCL_BO_SYNC_BO_FROM_DEVICE,
+             c_shape_[0] * c_shape_[1] * sizeof(OutT), 0);
+  int64_t c_sync_stop = GET_ELAPSED_TIME_NS();
+  c_sync_time_ += c_sync_stop - c_sync_start;
+
+  // copy c_bo to host memory
+  auto aie_out = (OutT *)output.at(0).data;
+  int64_t c_copy_start = GET_ELAPSED_TIME_NS();
+  OutT *c_bo_map = c_bo_.map<OutT *>();
+  memcpy((void *)aie_out, (void *)c_bo_map,
+         c_shape_[0] * c_shape_[1] * sizeof(OutT));
+  int64_t c_copy_stop = GET_ELAPSED_TIME_NS();
+  c_copy_time_ = c_copy_stop - c_copy_start;
+  int64_t exec_end = GET_ELAPSED_TIME_NS();
+  RYZENAI_LOG_INFO(
+      std::to_string(matmul_mladf_id_) + " " + std::to_string(a_shape_[0]) +
+      " " + std::to_string(a_shape_[1]) + " " + std::to_string(w_shape_[1]) +
+      " " + std::to_string(kernel_x_rows) + " " +
+      std::to_string(kernel_x_shape_[1]) + " " +
+      std::to_string(kernel_y_shape_[1]) + " " +
+      std::to_string(exec_end - exec_start) + " " +
+      std::to_string(num_run_aie_) + " " + std::to_string(run_aie_time_) + " " +
+      std::to_string(a_copy_time_) + " " + std::to_string(a_sync_time_) + " " +
+      std::to_string(c_copy_time_) + " " + std::to_string(c_sync_time_) + " " +
+      std::to_string((double)run_aie_time_ / num_run_aie_) + " " +
+      std::to_string(group_size_) + "\n");
+}
+
+template <typename InT, typename WtT, typename OutT>
+const std::vector<uint8_t>
+matmul_a16w4_mladf<InT, WtT, OutT>::get_transaction_bin(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  auto [M, K, N] = extract_MKN(input);
+  auto Mo = map_padded_shape(M, K, N);
+  std::string txn_key =
+      "gemm_mladf_" + get_instr_key(txn_fname_prefix_, Mo, K, N);
+  Transaction &txn = Transaction::getInstance();
+  std::string txn_string = txn.get_txn_str(txn_key);
+  std::istringstream txn_stream(txn_string, std::ios::binary);
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(txn_stream)),
+                            std::istreambuf_iterator<char>());
+  return data;
+}
+
+template <typename InT, typename WtT, typename OutT>
+std::vector<OpArgMap> matmul_a16w4_mladf<InT, WtT, OutT>::get_buffer_reqs(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  // input --> [input, weights, qdq_c0, group_c1, group_c2, kernel_params,
+  // output]
+
+  if (input.size() != 7) {
+    throw std::runtime_error(
+        "MATMUL_MLADF_A16W4 : Incorrect number of tensors received");
+  }
+  auto [M, K, N] = extract_MKN(input);
+  auto Mo = map_padded_shape(M, K, N);
+  int group_size = K / (int)input.at(3).shape.at(0);
+  DOD_THROW_IF(
+      !matmul_a16w4_mladf_matrix::is_supported_group_size(group_size),
+      OpsFusion::dod_format("MATMUL_MLADF_A16W4 : unsupported group size {}",
+                            group_size));
+
+  size_t PARAM_BO_SIZE = (16 * sizeof(uint32_t));
+  size_t B_BO_SIZE = get_wts_size(K, N, group_size);
+  size_t A_BO_SIZE = (Mo * K * sizeof(InT));
+  size_t C_BO_SIZE = (Mo * N * sizeof(OutT));
+
+  std::vector<OpArgMap> arg_map{
+      {OpArgMap::OpArgType::CONST_KERNEL_PARAM_INPUT, 0, 5, 0, PARAM_BO_SIZE},
+      {OpArgMap::OpArgType::CONST_INPUT, 1, 1, 0, B_BO_SIZE},
+      {OpArgMap::OpArgType::INPUT, 2, 0, 0, A_BO_SIZE},
+      {OpArgMap::OpArgType::OUTPUT, 3, 6, 0, C_BO_SIZE}};
+  return arg_map;
+};
+
+template class matmul_a16w4_mladf<uint16_t, uint8_t, uint16_t>;
+
+} // namespace ryzenai
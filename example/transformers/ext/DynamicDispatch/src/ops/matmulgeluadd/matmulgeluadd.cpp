@@ -37,7 +37,7 @@
 #include "xaiengine.h"
 
 // Headers for BFP matrix formatting
-#include "ops/ops_common/gelu_lut_bf16_512.h"
+#include "ops/ops_common/lut_store.hpp"
 #include "ops/ops_common/matmul_matrix.hpp"
 using namespace matmul_matrix;
 namespace ryzenai {
@@ -327,9 +327,6 @@ void matmulgeluadd<InT, WtT, OutT>::initialize_const_params(
   auto qdq_params = (int32_t *)const_params.at(qdq_param_idx).data;
   auto gelu_qdq_params = (int32_t *)const_params.at(gelu_qdq_param_idx).data;
 
-  int const size_lutab = sizeof(lnr_lutab);
-  int const size_lutcd = sizeof(lnr_lutcd);
-
   if (a_dtype_ == "int8" || a_dtype_ == "uint8") {
     qdq_params[qdq_Mv_idx] = matmul_matrix::Msubv;
   } else {
@@ -380,10 +377,9 @@ void matmulgeluadd<InT, WtT, OutT>::initialize_const_params(
     write_offset += qdq_params_size;
   }
 
-  memcpy((void *)(static_cast<int8_t *>(dest) + write_offset),
-         (void *)lnr_lutab, size_lutab);
-  memcpy((void *)(static_cast<int8_t *>(dest) + write_offset + size_lutab),
-         (void *)lnr_lutcd, size_lutcd);
+  const auto &lut = lut_store::gelu_bf16();
+  memcpy((void *)(static_cast<int8_t *>(dest) + write_offset), lut.data(),
+         lut.size());
 
   RYZENAI_LOG_TRACE("Matmulgelu initialize_const_params(ptr) ... DONE");
 }
@@ -411,8 +407,7 @@ void matmulgeluadd<InT, WtT, OutT>::initialize_const_params(
       w_shape_[0] * w_shape_[1] / matmul_matrix::Ksubv * sizeof(int64_t);
   size_interleaved_qdq += 2 * matmul_matrix::QDQparam_size * sizeof(int32_t);
 
-  int const size_lutab = sizeof(lnr_lutab);
-  int const size_lutcd = sizeof(lnr_lutcd);
+  int const size_lut = lut_store::gelu_bf16().size();
 
   // Init the BO size
   set_kernel_shapes();
@@ -421,7 +416,7 @@ void matmulgeluadd<InT, WtT, OutT>::initialize_const_params(
   const int A_BO_SIZE =
       (kernel_x_shape_[0] * kernel_x_shape_[1] * a_dtype_size_);
   const int B_BO_SIZE =
-      size_weight + size_interleaved_qdq + size_lutab + size_lutcd;
+      size_weight + size_interleaved_qdq + size_lut;
   // (kernel_y_shape_[0] * kernel_y_shape_[1] * b_dtype_size_);
   const int C_BO_SIZE =
       (kernel_z_shape_[0] * kernel_z_shape_[1] * c_dtype_size_);
@@ -611,12 +606,8 @@ std::vector<OpArgMap> matmulgeluadd<InT, WtT, OutT>::get_buffer_reqs(
   int size_interleaved_qdq = Ko * N / matmul_matrix::Ksubv * sizeof(int64_t);
   size_interleaved_qdq += 2 * matmul_matrix::QDQparam_size * sizeof(int32_t);
 
-  int const size_lutab = sizeof(lnr_lutab);
-  int const size_lutcd = sizeof(lnr_lutcd);
-
-  size_t B_BO_SIZE =
-      (Ko * N * sizeof(WtT) + size_interleaved_qdq * sizeof(InT) + size_lutab +
-       size_lutcd);
+  size_t B_BO_SIZE = (Ko * N * sizeof(WtT) + size_interleaved_qdq * sizeof(InT) +
+                      lut_store::gelu_bf16().size());
   size_t A_BO_SIZE = (Mo * Ko * sizeof(InT));
   size_t C_BO_SIZE = (Mo * N * sizeof(OutT));
   size_t super_kernel_size = get_super_kernel_params(input, output).size();
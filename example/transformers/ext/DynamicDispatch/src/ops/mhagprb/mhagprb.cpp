@@ -37,7 +37,7 @@
 #include "xaiengine.h"
 
 #include "ops/ops_common/mhagprb_matrix.hpp"
-#include "ops/ops_common/sigmoid_lut_512.h"
+#include "ops/ops_common/lut_store.hpp"
 
 namespace ryzenai {
 
@@ -286,8 +286,7 @@ void mhagrpb<InT, WtT, OutT>::initialize_const_params(
   RYZENAI_LOG_TRACE("MHA: size_gprbparam:" + std::to_string(size_gprbparam) +
                     " size_bias:" + std::to_string(size_bias));
 
-  int const lnr_lut_ab_size = sizeof(lnr_lutab);
-  int const lnr_lut_cd_size = sizeof(lnr_lutcd);
+  const auto &lut = lut_store::sigmoid_bf16();
 
   void *b_bias =
       static_cast<void *>((reinterpret_cast<int8_t *>(dest)) + size_gprbparam);
@@ -327,10 +326,7 @@ void mhagrpb<InT, WtT, OutT>::initialize_const_params(
   }
   memcpy(
       (void *)(reinterpret_cast<int8_t *>(dest) + size_gprbparam + size_bias),
-      (void *)lnr_lutab, lnr_lut_ab_size);
-  memcpy((void *)(reinterpret_cast<int8_t *>(dest) + size_gprbparam +
-                  size_bias + lnr_lut_ab_size),
-         (void *)lnr_lutcd, lnr_lut_cd_size);
+      lut.data(), lut.size());
   int size_qdqparam = QDQparam_size * num_qdq_nodes * sizeof(int32_t);
   *(int64_t *)(&qdq_param[(16 * 0) + qdq_c0_idx]) =
       gprb_vec64[qk_qdq_c0_scalar_idx];
@@ -349,7 +345,7 @@ void mhagrpb<InT, WtT, OutT>::initialize_const_params(
   qdq_param[(16 * 1) + qdq_Nv_idx] = val_subv_cols;
 
   memcpy((void *)(reinterpret_cast<int8_t *>(dest) + size_gprbparam +
-                  size_bias + lnr_lut_ab_size + lnr_lut_cd_size),
+                  size_bias + lut.size()),
          (void *)qdq_param, size_qdqparam);
 
   RYZENAI_LOG_TRACE("MHAGRPB initialize_const_params(ptr) ... DONE");
@@ -374,8 +370,7 @@ void mhagrpb<InT, WtT, OutT>::initialize_const_params(
                                      std::multiplies{}) *
                      b_dtype_size_;
   int H = shape[0];
-  int size_lutab = sizeof(lnr_lutab);
-  int size_lutcd = sizeof(lnr_lutcd);
+  int size_lut = lut_store::sigmoid_bf16().size();
   // this is the weights + gprb_vec + gprb_qdq_params
   int size_mhaparam = GPRB_buf_size;
   int size_qdqparam = QDQparam_size * num_qdq_nodes * sizeof(int32_t);
@@ -395,7 +390,7 @@ void mhagrpb<InT, WtT, OutT>::initialize_const_params(
       (kernel_x_shape_[0] * kernel_x_shape_[1] * a_dtype_size_) + size_msk;
   const int B_BO_SIZE =
       (kernel_y_shape_[0] * kernel_y_shape_[1] * b_dtype_size_ + size_mhaparam +
-       size_lutab + size_lutcd + size_qdqparam);
+       size_lut + size_qdqparam);
   const int C_BO_SIZE =
       (kernel_z_shape_[0] * kernel_z_shape_[1] * c_dtype_size_);
 
@@ -404,8 +399,7 @@ void mhagrpb<InT, WtT, OutT>::initialize_const_params(
                     " C_BO_SIZE size:" + std::to_string(C_BO_SIZE));
   RYZENAI_LOG_TRACE("MHA: size_weight:" + std::to_string(size_weight) +
                     " size_bias:" + std::to_string(size_bias) +
-                    " size_lutab:" + std::to_string(size_lutab) +
-                    " size_lutcd:" + std::to_string(size_lutcd));
+                    " size_lut:" + std::to_string(size_lut));
 
   a_bo_ = xrt::bo(xrt_ctx_->get_device(), A_BO_SIZE, XRT_BO_FLAGS_HOST_ONLY,
                   xrt_ctx_->get_kernel().group_id(8));
@@ -631,8 +625,7 @@ std::vector<OpArgMap> mhagrpb<InT, WtT, OutT>::get_buffer_reqs(
   size_t out_size = (out_shape[0] * out_shape[1] * sizeof(OutT));
 
   size_t super_kernel_size = get_super_kernel_params(input, output).size();
-  int const lnr_lut_ab_size = sizeof(lnr_lutab);
-  int const lnr_lut_cd_size = sizeof(lnr_lutcd);
+  size_t const lut_size = lut_store::sigmoid_bf16().size();
 
   std::vector<OpArgMap> arg_map{
       {OpArgMap::OpArgType::INPUT, 1, 0, 0, Q_size},
@@ -640,8 +633,7 @@ std::vector<OpArgMap> mhagrpb<InT, WtT, OutT>::get_buffer_reqs(
       {OpArgMap::OpArgType::INPUT, 1, 2, Q_size + K_size, V_size},
       {OpArgMap::OpArgType::INPUT, 1, 3, Q_size + K_size + V_size, mask_size},
       {OpArgMap::OpArgType::CONST_INPUT, 2, 4, 0,
-       bias_size + size_mhaparam + lnr_lut_ab_size + lnr_lut_cd_size +
-           size_qdqparam},
+       bias_size + size_mhaparam + lut_size + size_qdqparam},
       {OpArgMap::OpArgType::OUTPUT, 0, 9, 0, out_size},
       {OpArgMap::OpArgType::CONST_KERNEL_PARAM_INPUT, 3, 0, 0,
        super_kernel_size}};
@@ -4,6 +4,7 @@
 
 #include <any>
 #include <array>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -50,6 +51,17 @@ static std::array<size_t, 3> extract_shape(const Tensor &tensor) {
   return res;
 }
 
+// Token of a side x side image at position pos of window win, after the
+// image is rolled by -shift on both axes and split into window x window
+// windows. The window reverse & roll back map the token to the same place.
+static size_t window_token(size_t side, size_t window, size_t shift,
+                           size_t win, size_t pos) {
+  const size_t grid = side / window;
+  const size_t y = (win / grid) * window + pos / window;
+  const size_t x = (win % grid) * window + pos % window;
+  return ((y + shift) % side) * side + (x + shift) % side;
+}
+
 template <typename InT, typename WtT, typename OutT>
 std::once_flag mhawindow<InT, WtT, OutT>::instr_reg_flag_;
 
@@ -236,6 +248,19 @@ void mhawindow<InT, WtT, OutT>::initialize_const_params(
              OpsFusion::dod_format("MHAWINDOW expects one constant. Got {}",
                                    const_params.size()));
 
+  if (attr.count("window_size")) {
+    window_size_ = std::any_cast<int>(attr.at("window_size"));
+    shift_size_ = attr.count("shift_size")
+                      ? std::any_cast<int>(attr.at("shift_size"))
+                      : 0;
+    DOD_THROW_IF(window_size_ * window_size_ != size_t(kernel_x_shape_[1]) ||
+                     shift_size_ >= window_size_,
+                 OpsFusion::dod_format("MHAWINDOW : window {} with shift {} "
+                                       "for windows of {} tokens",
+                                       window_size_, shift_size_,
+                                       kernel_x_shape_[1]));
+  }
+
   int size_qdqparam = QDQparam_size * num_qdq_nodes * sizeof(int32_t);
 
   // Create input/output BOs
@@ -305,6 +330,19 @@ void mhawindow<InT, WtT, OutT>::execute(const std::vector<Tensor> &input,
   K = input.at(qkv_idx).shape.at(1);
   N = input.at(qkv_idx).shape.at(2);
 
+  // image order input, [1, H * W, 3 * C] to [#windows, tokens, 3 * C]
+  size_t side = 0;
+  if (window_size_ != 0) {
+    const size_t tokens = M * K;
+    side = static_cast<size_t>(std::lround(std::sqrt(double(tokens))));
+    K = window_size_ * window_size_;
+    M = tokens / K;
+    DOD_THROW_IF(side * side != tokens || side % window_size_ != 0,
+                 OpsFusion::dod_format("MHAWINDOW : {} tokens are not a "
+                                       "square of {}x{} windows",
+                                       tokens, window_size_, window_size_));
+  }
+
   c_shape_[0] = M * K * N / 3;
 
   kernel_x_rows = N;
@@ -312,7 +350,17 @@ void mhawindow<InT, WtT, OutT>::execute(const std::vector<Tensor> &input,
   int64_t a_copy_start = GET_ELAPSED_TIME_NS();
   InT *a_bo_map = a_bo_.map<InT *>();
   int a_size = M * K * N * sizeof(InT);
-  memcpy((void *)a_bo_map, (void *)a, a_size);
+  if (window_size_ == 0) {
+    memcpy((void *)a_bo_map, (void *)a, a_size);
+  } else {
+    for (size_t win = 0; win < M; ++win) {
+      for (size_t pos = 0; pos < K; ++pos) {
+        auto token = window_token(side, window_size_, shift_size_, win, pos);
+        memcpy((void *)(a_bo_map + (win * K + pos) * N),
+               (void *)(a + token * N), N * sizeof(InT));
+      }
+    }
+  }
 
   int64_t a_copy_stop = GET_ELAPSED_TIME_NS();
 
@@ -361,7 +409,20 @@ void mhawindow<InT, WtT, OutT>::execute(const std::vector<Tensor> &input,
   auto aie_out = (OutT *)output.at(0).data;
   int64_t c_copy_start = GET_ELAPSED_TIME_NS();
   OutT *c_bo_map = c_bo_.map<OutT *>();
-  memcpy((void *)aie_out, (void *)c_bo_map, c_shape_[0] * sizeof(OutT));
+  if (window_size_ == 0) {
+    memcpy((void *)aie_out, (void *)c_bo_map, c_shape_[0] * sizeof(OutT));
+  } else {
+    // window reverse & roll back to image order
+    const size_t out_cols = N / 3;
+    for (size_t win = 0; win < M; ++win) {
+      for (size_t pos = 0; pos < K; ++pos) {
+        auto token = window_token(side, window_size_, shift_size_, win, pos);
+        memcpy((void *)(aie_out + token * out_cols),
+               (void *)(c_bo_map + (win * K + pos) * out_cols),
+               out_cols * sizeof(OutT));
+      }
+    }
+  }
   int64_t c_copy_stop = GET_ELAPSED_TIME_NS();
   c_copy_time_ = c_copy_stop - c_copy_start;
   int64_t exec_end = GET_ELAPSED_TIME_NS();
@@ -27,11 +27,13 @@
 #include <ops/mladfadd/mladfadd.hpp>
 #include <ops/op_interface.hpp>
 #include <utils/logging.hpp>
+#include <utils/tfuncs.hpp>
 #include <utils/utils.hpp>
 
 // AIE Driver header
 #include "xaiengine.h"
 
+#include "../ops_common/broadcast.hpp"
 #include "../ops_common/matmul_matrix.hpp"
 
 using namespace matmul_matrix;
@@ -101,6 +103,12 @@ void mladf_add<LhsT, RhsT, OutT>::debug(bool enable) {
   debug_ = enable;
 }
 
+template <typename LhsT, typename RhsT, typename OutT>
+OpExecTimes mladf_add<LhsT, RhsT, OutT>::get_exec_times() const {
+  return {a_copy_time_ + b_copy_time_ + c_copy_time_,
+          a_sync_time_ + b_sync_time_ + c_sync_time_, run_aie_time_};
+}
+
 template <typename LhsT, typename RhsT, typename OutT>
 std::string mladf_add<LhsT, RhsT, OutT>::get_instr_key(std::string prefix,
                                                        int m, int k) {
@@ -243,10 +251,19 @@ void mladf_add<LhsT, RhsT, OutT>::execute(const std::vector<Tensor> &input,
   a_copy_time_ = a_copy_stop - a_copy_start;
   a_sync_time_ = a_sync_stop - a_sync_start;
 
-  // b_bo copy
+  // b_bo copy, a broadcastable b is expanded in place, it is not
+  // materialized at full size on the host first
   int64_t b_copy_start = GET_ELAPSED_TIME_NS();
   RhsT *b_bo_map = b_bo_.map<RhsT *>();
-  memcpy((void *)b_bo_map, (void *)b, operand_size_in_bytes);
+  if (input.at(a_idx + 1).shape == input.at(a_idx).shape) {
+    memcpy((void *)b_bo_map, (void *)b, operand_size_in_bytes);
+  } else {
+    DOD_THROW_IF(!broadcast::is_broadcastable(input.at(a_idx + 1).shape,
+                                              input.at(a_idx).shape),
+                 "mladfadd: b is not broadcastable to a");
+    broadcast::broadcast_to(b_bo_map, b, input.at(a_idx + 1).shape,
+                            input.at(a_idx).shape);
+  }
   int64_t b_copy_stop = GET_ELAPSED_TIME_NS();
 
   // b_bo sync
@@ -331,27 +348,57 @@ std::vector<OpArgMap> mladf_add<LhsT, RhsT, OutT>::get_buffer_reqs(
     const std::map<std::string, std::any> &attr) {
   auto M1 = input.at(0).shape.at(1); // [1xMxN : 1x512x768]
   auto N1 = input.at(0).shape.at(2);
-  auto M2 = input.at(1).shape.at(1); // [1xMxN : 1x512x768]
-  auto N2 = input.at(1).shape.at(2);
   auto M3 = output.at(0).shape.at(1); // [1xMxN : 1x512x768]
   auto N3 = output.at(0).shape.at(2);
 
-  if ((M1 != M2) || (N1 != N2) || (N3 != N2) || (M3 != M1)) {
+  // scalar, per channel and per row RHS are expanded into a full size
+  // const buffer once, the graph only stores the small tensor
+  const bool broadcast_b = input.at(1).shape != input.at(0).shape;
+  if ((broadcast_b && !broadcast::is_broadcastable(input.at(1).shape,
+                                                   input.at(0).shape)) ||
+      (N3 != N1) || (M3 != M1)) {
     throw std::runtime_error(
-        "Dimensions of all tensors should be equal for eltwise mul op\n");
+        "Dimensions of all tensors should be equal or broadcastable for "
+        "eltwise op\n");
   }
   size_t input_1_bo_size = (M1 * N1 * sizeof(LhsT));
   size_t input_2_bo_size = (M1 * N1 * sizeof(RhsT));
   size_t output_bo_size = (M1 * N1 * sizeof(OutT));
+  bcast_shape_ = {M1, N1};
 
   std::vector<OpArgMap> arg_map{
       {OpArgMap::OpArgType::INPUT, 0, 0, 0, input_1_bo_size},
-      {OpArgMap::OpArgType::INPUT, 1, 1, 0, input_2_bo_size},
+      {broadcast_b ? OpArgMap::OpArgType::CONST_INPUT
+                   : OpArgMap::OpArgType::INPUT,
+       1, 1, 0, input_2_bo_size},
       {OpArgMap::OpArgType::OUTPUT, 2, 2, 0, output_bo_size},
   };
   return arg_map;
 }
 
+template <typename LhsT, typename RhsT, typename OutT>
+void mladf_add<LhsT, RhsT, OutT>::initialize_const_params(
+    void *dest, const std::vector<Tensor> &const_params,
+    const std::map<std::string, std::any> &attr) {
+  // Only a broadcast RHS has a const buffer, a full size one is an input
+  if (const_params.empty() ||
+      (!bcast_shape_.empty() &&
+       broadcast::numel(const_params.at(0).shape) ==
+           broadcast::numel(bcast_shape_))) {
+    return;
+  }
+  DOD_THROW_IF(
+      (const_params.size() != 1) || bcast_shape_.empty(),
+      OpsFusion::dod_format("Unsupported const spec for mladfadd\n") +
+          OpsFusion::dod_format(
+              "(Details : #const params == 1 ({}), get_buffer_reqs() "
+              "called before: {})",
+              const_params.size(), !bcast_shape_.empty()));
+  broadcast::broadcast_to(static_cast<RhsT *>(dest),
+                          static_cast<const RhsT *>(const_params.at(0).data),
+                          const_params.at(0).shape, bcast_shape_);
+}
+
 template class mladf_add<uint16_t, uint16_t, uint16_t>;
 
 } // namespace ryzenai
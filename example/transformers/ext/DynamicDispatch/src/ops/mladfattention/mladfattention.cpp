@@ -0,0 +1,302 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+
+// XRT headers
+#include "xrt/xrt_bo.h"
+#include "xrt/xrt_device.h"
+#include "xrt/xrt_kernel.h"
+
+#include <ops/mladfattention/mladfattention.hpp>
+#include <ops/op_interface.hpp>
+#include <utils/logging.hpp>
+#include <utils/utils.hpp>
+
+namespace ryzenai {
+
+namespace {
+std::tuple<size_t, size_t, size_t> extract_BME(const Tensor &input) {
+  if (input.shape.size() != 3) {
+    throw std::runtime_error(
+        "mladf_attention expects a rank 3 tensor [Batch,Rows,Cols]");
+  }
+  return std::make_tuple(input.shape.at(0), input.shape.at(1),
+                         input.shape.at(2));
+}
+
+// [M, H x D] --> [H, M, D]
+template <typename T>
+void split_heads(const T *src, T *dst, size_t M, size_t H, size_t D) {
+  for (size_t h = 0; h < H; ++h) {
+    for (size_t m = 0; m < M; ++m) {
+      memcpy(&dst[(h * M + m) * D], &src[(m * H + h) * D], D * sizeof(T));
+    }
+  }
+}
+
+// [H, M, D] --> [M, H x D]
+template <typename T>
+void merge_heads(const T *src, T *dst, size_t M, size_t H, size_t D) {
+  for (size_t h = 0; h < H; ++h) {
+    for (size_t m = 0; m < M; ++m) {
+      memcpy(&dst[(m * H + h) * D], &src[(h * M + m) * D], D * sizeof(T));
+    }
+  }
+}
+
+// [H, M, D] --> [H, D, M]
+template <typename T>
+void transpose_heads(const T *src, T *dst, size_t M, size_t H, size_t D) {
+  for (size_t h = 0; h < H; ++h) {
+    const T *src_h = &src[h * M * D];
+    T *dst_h = &dst[h * M * D];
+    for (size_t m = 0; m < M; ++m) {
+      for (size_t d = 0; d < D; ++d) {
+        dst_h[d * M + m] = src_h[m * D + d];
+      }
+    }
+  }
+}
+} // namespace
+
+template <typename InT, typename WtT, typename OutT>
+std::once_flag mladf_attention<InT, WtT, OutT>::logger_flag_;
+
+template <typename InT, typename WtT, typename OutT>
+uint64_t mladf_attention<InT, WtT, OutT>::mladf_attention_count = 0;
+
+template <typename InT, typename WtT, typename OutT>
+void mladf_attention<InT, WtT, OutT>::debug(bool enable) {
+  debug_ = enable;
+  q_proj_.debug(enable);
+  k_proj_.debug(enable);
+  v_proj_.debug(enable);
+  rope_.debug(enable);
+  bmm1_.debug(enable);
+  bmm2_.debug(enable);
+  softmax_.debug(enable);
+}
+
+template <typename InT, typename WtT, typename OutT>
+mladf_attention<InT, WtT, OutT>::mladf_attention(const std::string &a_dtype,
+                                                 const std::string &b_dtype,
+                                                 bool load_xrt)
+    : q_proj_(a_dtype, b_dtype, a_dtype, load_xrt),
+      k_proj_(a_dtype, b_dtype, a_dtype, load_xrt),
+      v_proj_(a_dtype, b_dtype, a_dtype, load_xrt), rope_(a_dtype, load_xrt),
+      bmm1_(a_dtype, a_dtype, a_dtype, load_xrt),
+      bmm2_(a_dtype, a_dtype, a_dtype, load_xrt), softmax_(a_dtype, load_xrt),
+      load_xrt_(load_xrt), a_dtype_(a_dtype) {
+  mladf_attention_id_ = mladf_attention_count++;
+
+  if (load_xrt) {
+    bmm1_.set_params("BMM1", {NUM_HEADS * SEQ_LEN, HEAD_DIM});
+    bmm2_.set_params("BMM2", {NUM_HEADS * SEQ_LEN, SEQ_LEN});
+    bmm1_inputs_ = bmm1_.allocate_inputs();
+    bmm1_outputs_ = bmm1_.allocate_outputs();
+    bmm2_inputs_ = bmm2_.allocate_inputs();
+    bmm2_outputs_ = bmm2_.allocate_outputs();
+  }
+
+  a_copy_time_ = 0;
+  host_reorder_time_ = 0;
+  c_copy_time_ = 0;
+  run_aie_time_ = 0;
+  num_run_aie_ = 0;
+
+  std::call_once(logger_flag_, []() {
+    std::string header = "mladf_attention_id M E Execute"
+                         "time(ns) num_aie_runs run_aie_time(ns) "
+                         "A_copy_time(ns) Host_reorder_time(ns) "
+                         "C_copy_time(ns) "
+                         "Avg_time_per_aie_run(ns)\n";
+    RYZENAI_LOG_INFO(header);
+  });
+
+  RYZENAI_LOG_TRACE("[mladf_attention] ID: " +
+                    std::to_string(mladf_attention_id_) +
+                    ", (a_dtype, b_dtype): (" + a_dtype + ", " + b_dtype + ")");
+}
+
+template <typename InT, typename WtT, typename OutT>
+void mladf_attention<InT, WtT, OutT>::initialize_const_params(
+    const std::vector<Tensor> &const_params,
+    const std::map<std::string, std::any> &attr) {
+  RYZENAI_LOG_TRACE("mladf_attention initialize_const_params ...");
+  DOD_THROW_IF(const_params.size() != 12,
+               OpsFusion::dod_format("mladf_attention expects 4 const params "
+                                     "for each of Q, K, V projections, got {}",
+                                     const_params.size()));
+  DOD_THROW_IF(!load_xrt_,
+               "mladf_attention needs XRT to initialize const params");
+
+  auto proj_params = [&const_params](size_t idx) {
+    return std::vector<Tensor>(const_params.begin() + 4 * idx,
+                               const_params.begin() + 4 * (idx + 1));
+  };
+  q_proj_.initialize_const_params(proj_params(0), attr);
+  k_proj_.initialize_const_params(proj_params(1), attr);
+  v_proj_.initialize_const_params(proj_params(2), attr);
+  rope_.initialize_const_params({}, attr);
+  softmax_.initialize_const_params({}, attr);
+  // get_inputs() allocates the BOs, keep the mask BO for every execute
+  mask_bo_ = softmax_.get_inputs().at(1);
+  RYZENAI_LOG_TRACE("mladf_attention initialize_const_params ... DONE");
+}
+
+// Projection reads the activation BO shared b/w Q, K & V.
+template <typename InT, typename WtT, typename OutT>
+void mladf_attention<InT, WtT, OutT>::run_projection(proj_t &proj,
+                                                     xrt::bo &x_bo,
+                                                     int64_t M) {
+  const int64_t E = NUM_HEADS * HEAD_DIM;
+  proj.set_shape({(int)M, (int)E});
+  std::vector<xrt::bo> inputs = {x_bo, proj.get_const().at(0)};
+  std::vector<xrt::bo> outputs = proj.get_outputs(M);
+  proj.execute(inputs, outputs);
+}
+
+template <typename InT, typename WtT, typename OutT>
+void mladf_attention<InT, WtT, OutT>::execute(std::vector<Tensor> &input,
+                                              std::vector<Tensor> &output) {
+  const auto [B, M, E] = extract_BME(input.at(0));
+  DOD_THROW_IF(B != 1 || M != SEQ_LEN || E != NUM_HEADS * HEAD_DIM,
+               OpsFusion::dod_format("Unsupported shape for mladf_attention : "
+                                     "{} x {} x {}",
+                                     B, M, E));
+  const size_t H = NUM_HEADS;
+  const size_t D = HEAD_DIM;
+
+  a_copy_time_ = 0;
+  host_reorder_time_ = 0;
+  c_copy_time_ = 0;
+  run_aie_time_ = 0;
+  num_run_aie_ = 0;
+
+  int64_t exec_start = GET_ELAPSED_TIME_NS();
+
+  // activation, trig & mask are the only host --> device copies
+  int64_t a_copy_start = GET_ELAPSED_TIME_NS();
+  xrt::bo x_bo = q_proj_.get_inputs(M).at(0);
+  memcpy(x_bo.map<InT *>(), input.at(0).data, M * E * sizeof(InT));
+  x_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+
+  auto rope_inputs = rope_.get_inputs();
+  auto rope_outputs = rope_.get_outputs();
+  memcpy(rope_inputs.at(1).map<uint16_t *>(), input.at(1).data,
+         2 * M * D * sizeof(uint16_t));
+  rope_inputs.at(1).sync(XCL_BO_SYNC_BO_TO_DEVICE);
+
+  memcpy(mask_bo_.map<uint16_t *>(), input.at(2).data,
+         M * M * sizeof(uint16_t));
+  mask_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  int64_t a_copy_stop = GET_ELAPSED_TIME_NS();
+  a_copy_time_ = a_copy_stop - a_copy_start;
+
+  int64_t run_aie_start = GET_ELAPSED_TIME_NS();
+  run_projection(q_proj_, x_bo, M);
+  run_projection(k_proj_, x_bo, M);
+  run_projection(v_proj_, x_bo, M);
+  num_run_aie_ += 3;
+  run_aie_time_ += GET_ELAPSED_TIME_NS() - run_aie_start;
+
+  xrt::bo q_bo = q_proj_.get_outputs(M).at(0);
+  xrt::bo k_bo = k_proj_.get_outputs(M).at(0);
+  xrt::bo v_bo = v_proj_.get_outputs(M).at(0);
+  q_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+  k_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+  v_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+
+  rope_.set_kernel_shape({H, M, D});
+
+  // Q : rope writes straight to the LHS of Q x K^T
+  int64_t reorder_start = GET_ELAPSED_TIME_NS();
+  split_heads(q_bo.map<uint16_t *>(), rope_inputs.at(0).map<uint16_t *>(), M,
+              H, D);
+  rope_inputs.at(0).sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  host_reorder_time_ += GET_ELAPSED_TIME_NS() - reorder_start;
+
+  run_aie_start = GET_ELAPSED_TIME_NS();
+  std::vector<xrt::bo> rope_q_outputs = {bmm1_inputs_.at(0)};
+  rope_.execute(rope_inputs, rope_q_outputs);
+  num_run_aie_++;
+  run_aie_time_ += GET_ELAPSED_TIME_NS() - run_aie_start;
+
+  // K : rope, then K^T to the RHS of Q x K^T
+  reorder_start = GET_ELAPSED_TIME_NS();
+  split_heads(k_bo.map<uint16_t *>(), rope_inputs.at(0).map<uint16_t *>(), M,
+              H, D);
+  rope_inputs.at(0).sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  host_reorder_time_ += GET_ELAPSED_TIME_NS() - reorder_start;
+
+  run_aie_start = GET_ELAPSED_TIME_NS();
+  rope_.execute(rope_inputs, rope_outputs);
+  num_run_aie_++;
+  run_aie_time_ += GET_ELAPSED_TIME_NS() - run_aie_start;
+
+  reorder_start = GET_ELAPSED_TIME_NS();
+  rope_outputs.at(0).sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+  transpose_heads(rope_outputs.at(0).map<uint16_t *>(),
+                  bmm1_inputs_.at(1).map<uint16_t *>(), M, H, D);
+  bmm1_inputs_.at(1).sync(XCL_BO_SYNC_BO_TO_DEVICE);
+
+  // V : RHS of P x V
+  split_heads(v_bo.map<uint16_t *>(), bmm2_inputs_.at(1).map<uint16_t *>(), M,
+              H, D);
+  bmm2_inputs_.at(1).sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  host_reorder_time_ += GET_ELAPSED_TIME_NS() - reorder_start;
+
+  // scores, probabilities and output stay on device
+  run_aie_start = GET_ELAPSED_TIME_NS();
+  bmm1_.execute(bmm1_inputs_, bmm1_outputs_);
+  std::vector<xrt::bo> softmax_inputs = {bmm1_outputs_.at(0), mask_bo_};
+  std::vector<xrt::bo> softmax_outputs = {bmm2_inputs_.at(0)};
+  softmax_.execute(softmax_inputs, softmax_outputs);
+  bmm2_.execute(bmm2_inputs_, bmm2_outputs_);
+  num_run_aie_ += 3;
+  run_aie_time_ += GET_ELAPSED_TIME_NS() - run_aie_start;
+
+  int64_t c_copy_start = GET_ELAPSED_TIME_NS();
+  bmm2_outputs_.at(0).sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+  merge_heads(bmm2_outputs_.at(0).map<uint16_t *>(),
+              (uint16_t *)output.at(0).data, M, H, D);
+  int64_t c_copy_stop = GET_ELAPSED_TIME_NS();
+  c_copy_time_ = c_copy_stop - c_copy_start;
+  int64_t exec_end = GET_ELAPSED_TIME_NS();
+
+  RYZENAI_LOG_INFO(
+      std::to_string(mladf_attention_id_) + " " + std::to_string(M) + " " +
+      std::to_string(E) + " " + std::to_string(exec_end - exec_start) + " " +
+      std::to_string(num_run_aie_) + " " + std::to_string(run_aie_time_) + " " +
+      std::to_string(a_copy_time_) + " " + std::to_string(host_reorder_time_) +
+      " " + std::to_string(c_copy_time_) + " " +
+      std::to_string((double)run_aie_time_ / num_run_aie_) + "\n");
+}
+
+template <typename InT, typename WtT, typename OutT>
+const std::vector<uint8_t>
+mladf_attention<InT, WtT, OutT>::get_transaction_bin(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  DOD_THROW("mladf_attention : no fused transaction exists yet, head "
+            "split b/w projection and attention layouts runs on host");
+  return {};
+}
+
+template <typename InT, typename WtT, typename OutT>
+std::vector<OpArgMap> mladf_attention<InT, WtT, OutT>::get_buffer_reqs(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  DOD_THROW("mladf_attention : no fused transaction exists yet, head "
+            "split b/w projection and attention layouts runs on host");
+  return {};
+}
+
+template class mladf_attention<int16_t, int8_t, int16_t>;
+
+} // namespace ryzenai
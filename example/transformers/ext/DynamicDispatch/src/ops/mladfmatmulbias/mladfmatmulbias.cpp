@@ -2,11 +2,15 @@
  * Copyright © 2023 Advanced Micro Devices, Inc. All rights reserved.
  */
 
+#include <algorithm>
 #include <any>
 #include <cassert>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <sstream>
+#include <string_view>
 #include <tuple>
 #include <utility>
 
@@ -37,6 +41,18 @@
 
 namespace ryzenai {
 
+namespace {
+// float_buffer_to_bfloat16 has an AVX-512 path on Windows builds only
+bool use_avx_bf16() {
+#ifdef _WIN32
+  static const bool supported = check_avx512_and_bf16_support();
+  return supported;
+#else
+  return false;
+#endif
+}
+} // namespace
+
 template <typename InT, typename WtT, typename AccT, typename OutT>
 void mladfmatmulbias<InT, WtT, AccT, OutT>::debug(bool enable) {
   debug_ = enable;
@@ -294,115 +310,213 @@ void mladfmatmulbias<InT, WtT, AccT, OutT>::initialize_const_params(
 
   w_padded_shape_[0] = Utils::ceil_for_me(w_shape_[0], kernel_y_shape_[0]);
   w_padded_shape_[1] = Utils::ceil_for_me(w_shape_[1], kernel_y_shape_[1]);
+  // Select the supported group_size
+  if (group_size >= 128) {
+    assert(group_size % 128 == 0 && "group_size should be div by 32 or 128");
+    grp_size_ = 128;
+  } else if (group_size >= 32) {
+    assert(group_size % 32 == 0 && "group_size should be div by 32 or 128");
+    grp_size_ = 32;
+  }
+
+  // BOs are created upfront, the tiles are then formatted in parallel
+  auto b_format_start = GET_ELAPSED_TIME_NS();
+  const int block_size = get_weight_block_size(group_size);
+  std::vector<std::tuple<int64_t, int64_t, WtT *>> tiles;
+  for (int64_t rb = 0; rb < w_padded_shape_[0]; rb += kernel_y_shape_[0]) {
+    for (int64_t cb = 0; cb < w_padded_shape_[1]; cb += kernel_y_shape_[1]) {
+      xrt::bo bo_ =
+          xrt::bo(xrt_ctx_->get_context(), block_size,
+                  xrt::bo::flags::host_only,
+                  xrt_ctx_->get_kernel().group_id(group_id));
+      tiles.emplace_back(rb, cb, bo_.map<WtT *>());
+      weights_bo_.push_back(bo_);
+    }
+  }
+
+  // Formatted tiles can be cached on disk with DD_CACHE_DIR env variable
+  const auto cache_path =
+      get_weight_cache_path(const_params, group_size, tiles.size());
+  if (cache_path.empty() || !load_weight_cache(cache_path, tiles, block_size)) {
+    Utils::parallel_for(tiles.size(), [&](size_t i) {
+      const auto &[rb, cb, bo_map] = tiles.at(i);
+      memset((void *)bo_map, 0, block_size);
+      format_weight_tile(bo_map, rb, cb, group_size, weights, zeros, scales,
+                         bias);
+    });
+    if (!cache_path.empty()) {
+      save_weight_cache(cache_path, tiles, block_size);
+    }
+  }
+  auto b_format_stop = GET_ELAPSED_TIME_NS();
+  b_format_time_ += b_format_stop - b_format_start;
+
+  auto b_sync_start = GET_ELAPSED_TIME_NS();
+  for (auto &bo_ : weights_bo_) {
+    bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  }
+  auto b_sync_stop = GET_ELAPSED_TIME_NS();
+  b_sync_time_ = b_sync_stop - b_sync_start;
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+int mladfmatmulbias<InT, WtT, AccT, OutT>::get_weight_block_size(
+    int group_size) const {
   // The bfp16 kernel uses a block size of 4 for any gemm shape.
   int blk_size = 4;
+  return (group_size < 128)
+             ? mladfQuantMatrix<64, 32, 32, 32>(
+                   kernel_y_shape_[0], kernel_y_shape_[1], blk_size)
+                   .data_size
+             : mladfQuantMatrix<64, 128, 32, 128>(
+                   kernel_y_shape_[0], kernel_y_shape_[1], blk_size)
+                   .data_size;
+}
 
+// Format the kernel shaped block (rb, cb) of the weight matrix into bo_map,
+// which is zero initialized. Only touches bo_map, safe to run concurrently.
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void mladfmatmulbias<InT, WtT, AccT, OutT>::format_weight_tile(
+    WtT *bo_map, int64_t rb, int64_t cb, int group_size,
+    const int8_t *weights, const int8_t *zeros, const float *scales,
+    const float *bias) const {
+  // The bfp16 kernel uses a block size of 4 for any gemm shape.
+  int blk_size = 4;
   mladfQuantMatrix<64, 32, 32, 32> buff_B1(kernel_y_shape_[0],
                                            kernel_y_shape_[1], blk_size);
   mladfQuantMatrix<64, 128, 32, 128> buff_B2(kernel_y_shape_[0],
                                              kernel_y_shape_[1], blk_size);
-  // iterate over kernel shaped blocks of the weight matrix
-  for (int64_t rb = 0; rb < w_padded_shape_[0]; rb += kernel_y_shape_[0]) {
-    for (int64_t cb = 0; cb < w_padded_shape_[1]; cb += kernel_y_shape_[1]) {
-      auto b_format_start = GET_ELAPSED_TIME_NS();
+  buff_B1.data = (mladfCoreSubv<32, 32, 32> *)bo_map;
+  buff_B2.data = (mladfCoreSubv<128, 32, 128> *)bo_map;
+
+  const int64_t num_cols = std::min(kernel_y_shape_[1], w_shape_[1] - cb);
+  // bf16 conversion of the contiguous bias/scales of a row, vectorized when
+  // the CPU supports it
+  std::vector<uint16_t> row_bf16(num_cols);
+  const auto to_bf16 = [&](const float *row) {
+    ryzenai::float_buffer_to_bfloat16(row, num_cols, row_bf16.data(),
+                                      use_avx_bf16());
+  };
 
-      int block_size =
-          (group_size < 128) ? buff_B1.data_size : buff_B2.data_size;
-      xrt::bo bo_;
-      bo_ = xrt::bo(xrt_ctx_->get_context(), block_size,
-                    xrt::bo::flags::host_only,
-                    xrt_ctx_->get_kernel().group_id(group_id));
-      auto bo_map = bo_.map<WtT *>();
-      memset((void *)bo_map, 0, block_size);
-      buff_B1.data = (mladfCoreSubv<32, 32, 32> *)bo_map;
-      buff_B2.data = (mladfCoreSubv<128, 32, 128> *)bo_map;
+  // first pack the bias (bf16)
+  if (rb == 0) {
+    to_bf16(bias + cb);
+    for (int c = 0; c < num_cols; ++c) {
+      (group_size < 128) ? buff_B1.bias(c) = row_bf16[c]
+                         : buff_B2.bias(c) = row_bf16[c];
+    }
+  }
+  // format quantized weights (int4/uint4)
+  const bool is_int4 = (b_dtype_ == "int4");
+  for (int r = 0; r < kernel_y_shape_[0] && rb + r < w_shape_[0]; ++r) {
+    const int8_t *row = &weights[((rb + r) * w_shape_[1]) + cb];
+    (group_size < 128) ? buff_B1.pack_quant_row(r, 0, row, num_cols)
+                       : buff_B2.pack_quant_row(r, 0, row, num_cols);
+  }
 
-      // first pack the bias (bf16)
-      for (int c = 0; c < kernel_y_shape_[1] && cb + c < w_shape_[1]; ++c) {
-        if (rb == 0) {
-          (group_size < 128)
-              ? buff_B1.bias(c) = ryzenai::float_to_bfloat16(bias[cb + c])
-              : buff_B2.bias(c) = ryzenai::float_to_bfloat16(bias[cb + c]);
-        }
-      }
-      // format quantized weights (int4/uint4)
-      for (int r = 0; r < kernel_y_shape_[0] && rb + r < w_shape_[0]; ++r) {
-        for (int c = 0; c < kernel_y_shape_[1] && cb + c < w_shape_[1];
-             c += 2) {
-          // NOTE: int8_t weights will be sign extended to int
-          int x = weights[((rb + r) * w_shape_[1]) + (cb + c)];
-          int y = weights[((rb + r) * w_shape_[1]) + (cb + c) + 1];
-          if (b_dtype_ == "int4") {
-            (group_size < 128)
-                ? buff_B1.quant(r, c) = ryzenai::pack_v2int4(x, y)
-                : buff_B2.quant(r, c) = ryzenai::pack_v2int4(x, y);
-          } else {
-            (group_size < 128)
-                ? buff_B1.quant(r, c) = ryzenai::pack_v2uint4(x, y)
-                : buff_B2.quant(r, c) = ryzenai::pack_v2uint4(x, y);
-          }
-        }
+  int repeat_count = group_size / grp_size_;
+  // format the scales (bf16)
+  for (int r = 0; r < kernel_y_shape_[0] && rb + r < w_shape_[0];
+       r += group_size) {
+    to_bf16(scales + ((rb + r) * w_shape_[1] / group_size) + cb);
+    for (int c = 0; c < num_cols; c++) {
+      for (int g = 0; g < repeat_count; g++) {
+        (group_size < 128)
+            ? buff_B1.scale(r + g * grp_size_, c) = row_bf16[c]
+            : buff_B2.scale(r + g * grp_size_, c) = row_bf16[c];
       }
+    }
+  }
 
-      // Select the supported group_size
-      if (group_size >= 128) {
-        assert(group_size % 128 == 0 &&
-               "group_size should be div by 32 or 128");
-        grp_size_ = 128;
-      } else if (group_size >= 32) {
-        assert(group_size % 32 == 0 && "group_size should be div by 32 or 128");
-        grp_size_ = 32;
-      }
-
-      int repeat_count = group_size / grp_size_;
-      // format the scales (bf16)
-      for (int r = 0; r < kernel_y_shape_[0] && rb + r < w_shape_[0];
-           r += group_size) {
-        for (int c = 0; c < kernel_y_shape_[1] && cb + c < w_shape_[1]; c++) {
-          for (int g = 0; g < repeat_count; g++) {
-            (group_size < 128)
-                ? buff_B1.scale(r + g * grp_size_, c) =
-                      ryzenai::float_to_bfloat16(scales[(
-                          ((rb + r) * w_shape_[1] / group_size) + (cb + c))])
-                : buff_B2.scale(r + g * grp_size_, c) =
-                      ryzenai::float_to_bfloat16(scales[(
-                          ((rb + r) * w_shape_[1] / group_size) + (cb + c))]);
-          }
-        }
+  // format the zeros (int4)
+  for (int r = 0; r < kernel_y_shape_[0] && rb + r < w_shape_[0];
+       r += group_size) {
+    for (int c = 0; c < num_cols; c += 2) {
+      int index = ((rb + r) * w_shape_[1] / (group_size)) + (cb + c);
+      int x = zeros[index];
+      int y = zeros[index + 1];
+      int8_t pack_zeros = is_int4 ? ryzenai::pack_v2int4(x, y)
+                                  : ryzenai::pack_v2uint4(x, y);
+      for (int g = 0; g < repeat_count; g++) {
+        (group_size < 128)
+            ? buff_B1.zero(r + g * grp_size_, c) = pack_zeros
+            : buff_B2.zero(r + g * grp_size_, c) = pack_zeros;
       }
+    }
+  }
+}
 
-      // format the zeros (int4)
-      for (int r = 0; r < kernel_y_shape_[0] && rb + r < w_shape_[0];
-           r += group_size) {
-        for (int c = 0; c < kernel_y_shape_[1] && cb + c < w_shape_[1];
-             c += 2) {
-          int index = ((rb + r) * w_shape_[1] / (group_size)) + (cb + c);
-          int x = zeros[index];
-          int y = zeros[index + 1];
-          int8_t pack_zeros;
-          if (b_dtype_ == "int4") {
-            pack_zeros = ryzenai::pack_v2int4(x, y);
-          } else {
-            pack_zeros = ryzenai::pack_v2uint4(x, y);
-          }
-          for (int g = 0; g < repeat_count; g++) {
-            (group_size < 128)
-                ? buff_B1.zero(r + g * grp_size_, c) = pack_zeros
-                : buff_B2.zero(r + g * grp_size_, c) = pack_zeros;
-          }
-        }
-      }
-      auto b_format_stop = GET_ELAPSED_TIME_NS();
-      b_format_time_ += b_format_stop - b_format_start;
+template <typename InT, typename WtT, typename AccT, typename OutT>
+std::string mladfmatmulbias<InT, WtT, AccT, OutT>::get_weight_cache_path(
+    const std::vector<Tensor> &const_params, int group_size,
+    size_t num_tiles) const {
+  const auto cache_dir = Utils::get_env_var("DD_CACHE_DIR");
+  if (cache_dir.empty()) {
+    return {};
+  }
+  // key on the raw const data and everything that changes the format
+  const size_t num_groups = w_shape_[0] * w_shape_[1] / group_size;
+  size_t key = std::hash<std::string>{}(OpsFusion::dod_format(
+      "{}_{}_{}_{}_{}_{}_{}", b_dtype_, w_shape_[0], w_shape_[1],
+      kernel_y_shape_[0], kernel_y_shape_[1], group_size, num_tiles));
+  for (const auto &[idx, size] :
+       std::vector<std::pair<int, size_t>>{{0, w_shape_[0] * w_shape_[1]},
+                                           {1, w_shape_[1] * sizeof(float)},
+                                           {2, num_groups * sizeof(float)},
+                                           {3, num_groups}}) {
+    const auto hash = std::hash<std::string_view>{}(std::string_view(
+        (const char *)const_params.at(idx).data, size));
+    key ^= hash + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2);
+  }
+  return (std::filesystem::path(cache_dir) /
+          OpsFusion::dod_format("dd_mladfmatmulbias_{:016x}.bin", key))
+      .string();
+}
 
-      auto b_sync_start = GET_ELAPSED_TIME_NS();
-      bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
-      auto b_sync_stop = GET_ELAPSED_TIME_NS();
-      b_sync_time_ = b_sync_stop - b_sync_start;
+template <typename InT, typename WtT, typename AccT, typename OutT>
+bool mladfmatmulbias<InT, WtT, AccT, OutT>::load_weight_cache(
+    const std::string &path,
+    const std::vector<std::tuple<int64_t, int64_t, WtT *>> &tiles,
+    int block_size) const {
+  std::ifstream ifs(path, std::ios::binary);
+  if (!ifs) {
+    return false;
+  }
+  ifs.seekg(0, std::ios::end);
+  if ((size_t)ifs.tellg() != tiles.size() * block_size) {
+    RYZENAI_LOG_TRACE("Stale mladfmatmulbias weight cache : " + path);
+    return false;
+  }
+  ifs.seekg(0, std::ios::beg);
+  for (const auto &[rb, cb, bo_map] : tiles) {
+    if (!ifs.read((char *)bo_map, block_size)) {
+      return false;
+    }
+  }
+  RYZENAI_LOG_TRACE("Loaded mladfmatmulbias weights from cache : " + path);
+  return true;
+}
 
-      weights_bo_.push_back(bo_);
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void mladfmatmulbias<InT, WtT, AccT, OutT>::save_weight_cache(
+    const std::string &path,
+    const std::vector<std::tuple<int64_t, int64_t, WtT *>> &tiles,
+    int block_size) const {
+  // write to a temp file first, so a partial file is never loaded
+  const auto tmp_path = path + ".tmp";
+  {
+    std::ofstream ofs(tmp_path, std::ios::binary);
+    for (const auto &[rb, cb, bo_map] : tiles) {
+      ofs.write((const char *)bo_map, block_size);
+    }
+    if (!ofs) {
+      RYZENAI_LOG_TRACE("Failed to write mladfmatmulbias weight cache : " +
+                        tmp_path);
+      return;
     }
   }
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, path, ec);
 }
 
 // specialization for ML-ADF, invoked in set_kernel_shapes_m if is_mladf_enabled
@@ -467,15 +581,22 @@ void mladfmatmulbias<InT, WtT, AccT, OutT>::run_aie(InT *a, xrt::bo &w_bo,
   const xrt::bo &instr_bo = instr_reg_.get_instr_bo(instr_bo_key).second;
 
   uint16_t *a_map = a_bo_run_aie.map<uint16_t *>();
-  memset((void *)a_map, 0, a_bo_run_aie.size());
-  uint16_t *a_u16 = reinterpret_cast<uint16_t *>(a);
-
-  auto a_sz = a_shape_[0] * a_shape_[1];
-
+  // only the ragged edge of the kernel_x_rows rows read by the kernel is
+  // zeroed, not the whole BO
+  const int64_t pad_cols = kernel_x_shape_[1] - input_shape[1];
   for (int i = 0; i < input_shape[0]; ++i) {
     // copy row from the source tile
     memcpy((void *)&a_map[i * kernel_x_shape_[1]], (void *)&a[i * a_shape_[1]],
            input_shape[1] * a_dtype_size_);
+    if (pad_cols > 0) {
+      memset((void *)&a_map[i * kernel_x_shape_[1] + input_shape[1]], 0,
+             pad_cols * a_dtype_size_);
+    }
+  }
+  if (input_shape[0] < kernel_x_rows) {
+    memset((void *)&a_map[input_shape[0] * kernel_x_shape_[1]], 0,
+           (kernel_x_rows - input_shape[0]) * kernel_x_shape_[1] *
+               a_dtype_size_);
   }
   //  append params at the end of A tensor
   /* auto dev_params = (ParamSubv *)&a_map[kernel_x_rows * kernel_x_shape_[1]];
@@ -807,22 +928,11 @@ void mladfmatmulbias<InT, WtT, AccT, OutT>::initialize_const_params(
         }
       }
       // format quantized weights (int4/uint4)
+      const int num_cols = std::min(kernel_y_shape_[1], w_shape_[1] - cb);
       for (int r = 0; r < kernel_y_shape_[0] && rb + r < w_shape_[0]; ++r) {
-        for (int c = 0; c < kernel_y_shape_[1] && cb + c < w_shape_[1];
-             c += 2) {
-          // NOTE: int8_t weights will be sign extended to int
-          int x = weights[((rb + r) * w_shape_[1]) + (cb + c)];
-          int y = weights[((rb + r) * w_shape_[1]) + (cb + c) + 1];
-          if (b_dtype_ == "int4") {
-            (group_size < 128)
-                ? buff_B1.quant(r, c) = ryzenai::pack_v2int4(x, y)
-                : buff_B2.quant(r, c) = ryzenai::pack_v2int4(x, y);
-          } else {
-            (group_size < 128)
-                ? buff_B1.quant(r, c) = ryzenai::pack_v2uint4(x, y)
-                : buff_B2.quant(r, c) = ryzenai::pack_v2uint4(x, y);
-          }
-        }
+        const int8_t *row = &weights[((rb + r) * w_shape_[1]) + cb];
+        (group_size < 128) ? buff_B1.pack_quant_row(r, 0, row, num_cols)
+                           : buff_B2.pack_quant_row(r, 0, row, num_cols);
       }
 
       // Select the supported group_size
@@ -1,8 +1,10 @@
 /*
  * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
  */
+#include <cmath>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <numeric>
 #include <sstream>
 #include <stdexcept>
@@ -23,6 +25,7 @@
 
 #include <ops/mladfmharope/mladfmharope.hpp>
 #include <ops/op_interface.hpp>
+#include <ops/ops_common/dtype_utils.h>
 #include <utils/logging.hpp>
 #include <utils/utils.hpp>
 
@@ -71,11 +74,25 @@ uint64_t mha_rope<LhsT, TrigT, OutT>::mha_rope_count = 0;
 template <typename LhsT, typename TrigT, typename OutT>
 std::once_flag mha_rope<LhsT, TrigT, OutT>::instr_reg_flag_;
 
+template <typename LhsT, typename TrigT, typename OutT>
+std::map<std::tuple<size_t, int64_t, float>,
+         typename mha_rope<LhsT, TrigT, OutT>::trig_table>
+    mha_rope<LhsT, TrigT, OutT>::trig_tables_;
+
+template <typename LhsT, typename TrigT, typename OutT>
+std::mutex mha_rope<LhsT, TrigT, OutT>::trig_tables_mutex_;
+
 template <typename LhsT, typename TrigT, typename OutT>
 void mha_rope<LhsT, TrigT, OutT>::debug(bool enable) {
   debug_ = enable;
 }
 
+template <typename LhsT, typename TrigT, typename OutT>
+OpExecTimes mha_rope<LhsT, TrigT, OutT>::get_exec_times() const {
+  return {a_copy_time_ + b_copy_time_ + c_copy_time_,
+          a_sync_time_ + b_sync_time_ + c_sync_time_, run_aie_time_};
+}
+
 template <typename LhsT, typename TrigT, typename OutT>
 std::string mha_rope<LhsT, TrigT, OutT>::get_instr_key(std::string prefix,
                                                        int batch, int m,
@@ -190,7 +207,6 @@ void mha_rope<LhsT, TrigT, OutT>::execute(const std::vector<Tensor> &input,
 
   // The first data is a and second data is b
   LhsT *a = (LhsT *)input.at(0).data;
-  TrigT *b = (TrigT *)input.at(1).data;
 
   a_copy_time_ = 0;
   a_sync_time_ = 0;
@@ -223,21 +239,29 @@ void mha_rope<LhsT, TrigT, OutT>::execute(const std::vector<Tensor> &input,
   a_copy_time_ = a_copy_stop - a_copy_start;
   a_sync_time_ = a_sync_stop - a_sync_start;
 
-  // b_bo copy
-  trig_size_in_bytes_ = utils::running_product_with_skips(input.at(1).shape) *
-                        operand_dtype_size_;
-  int64_t b_copy_start = GET_ELAPSED_TIME_NS();
-  TrigT *b_bo_map = b_bo_.map<TrigT *>();
-  memcpy((void *)b_bo_map, (void *)b, trig_size_in_bytes_);
-  int64_t b_copy_stop = GET_ELAPSED_TIME_NS();
-
-  // b_bo sync
-  int64_t b_sync_start = GET_ELAPSED_TIME_NS();
-  b_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  int64_t b_sync_stop = GET_ELAPSED_TIME_NS();
-
-  b_copy_time_ = b_copy_stop - b_copy_start;
-  b_sync_time_ = b_sync_stop - b_sync_start;
+  xrt::bo trig_bo = b_bo_;
+  if (trig_max_seq_len_ > 0) {
+    trig_bo = get_trig_bo(input.at(0).shape.at(1), input.at(0).shape.at(2),
+                          b_copy_time_, b_sync_time_);
+  } else {
+    // b_bo copy
+    TrigT *b = (TrigT *)input.at(1).data;
+    trig_size_in_bytes_ =
+        utils::running_product_with_skips(input.at(1).shape) *
+        operand_dtype_size_;
+    int64_t b_copy_start = GET_ELAPSED_TIME_NS();
+    TrigT *b_bo_map = b_bo_.map<TrigT *>();
+    memcpy((void *)b_bo_map, (void *)b, trig_size_in_bytes_);
+    int64_t b_copy_stop = GET_ELAPSED_TIME_NS();
+
+    // b_bo sync
+    int64_t b_sync_start = GET_ELAPSED_TIME_NS();
+    b_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    int64_t b_sync_stop = GET_ELAPSED_TIME_NS();
+
+    b_copy_time_ = b_copy_stop - b_copy_start;
+    b_sync_time_ = b_sync_stop - b_sync_start;
+  }
   // prepare inst_bo and param_bo
   const auto instr_bo_key =
       get_instr_key(txn_fname_prefix_, input.at(0).shape.at(0),
@@ -252,7 +276,7 @@ void mha_rope<LhsT, TrigT, OutT>::execute(const std::vector<Tensor> &input,
   // do we really need to sync before? c_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
   run = kernel_(2, instr_bo, instr_bo_words,
                 a_bo_.address() + DDR_AIE_ADDR_OFFSET,
-                b_bo_.address() + DDR_AIE_ADDR_OFFSET,
+                trig_bo.address() + DDR_AIE_ADDR_OFFSET,
                 c_bo_.address() + DDR_AIE_ADDR_OFFSET, 0, 0);
   run.wait2();
   int64_t run_aie_stop = GET_ELAPSED_TIME_NS();
@@ -286,6 +310,110 @@ void mha_rope<LhsT, TrigT, OutT>::execute(const std::vector<Tensor> &input,
       std::to_string((double)run_aie_time_ / num_run_aie_) + "\n");
 }
 
+template <typename LhsT, typename TrigT, typename OutT>
+void mha_rope<LhsT, TrigT, OutT>::set_kernel_shape(
+    const std::vector<size_t> &shape) {
+  kernel_x_shape_[0] = shape.at(0);
+  kernel_x_shape_[1] = shape.at(1);
+  kernel_x_shape_[2] = shape.at(2);
+}
+
+template <typename LhsT, typename TrigT, typename OutT>
+void mha_rope<LhsT, TrigT, OutT>::set_trig_table(size_t max_seq_len,
+                                                 float base) {
+  DOD_THROW_IF(max_seq_len == 0, "mharope : max_seq_len must be > 0");
+  trig_max_seq_len_ = max_seq_len;
+  trig_base_ = base;
+}
+
+template <typename LhsT, typename TrigT, typename OutT>
+void mha_rope<LhsT, TrigT, OutT>::set_position_offset(int64_t pos_offset) {
+  DOD_THROW_IF(pos_offset < 0, "mharope : negative position offset");
+  trig_pos_offset_ = pos_offset;
+}
+
+template <typename LhsT, typename TrigT, typename OutT>
+xrt::bo mha_rope<LhsT, TrigT, OutT>::get_trig_bo(int64_t M, int64_t K,
+                                                 int64_t &copy_time,
+                                                 int64_t &sync_time) {
+  std::lock_guard<std::mutex> guard(trig_tables_mutex_);
+  auto &table = trig_tables_[std::make_tuple(trig_max_seq_len_, K,
+                                              trig_base_)];
+  // cos/sin of pos * theta_i, both halves of a row use the same theta
+  // (rotate_half layout, the kernel has contiguous K/2 halves)
+  const size_t table_size = trig_max_seq_len_ * K;
+  if (table.host.empty()) {
+    table.host.resize(2 * table_size);
+    for (size_t pos = 0; pos < trig_max_seq_len_; ++pos) {
+      for (int64_t k = 0; k < K; ++k) {
+        const double theta =
+            std::pow((double)trig_base_, -2.0 * (k % (K / 2)) / K);
+        const float angle = (float)(pos * theta);
+        table.host[pos * K + k] = float_to_bfloat16(std::cos(angle));
+        table.host[table_size + pos * K + k] =
+            float_to_bfloat16(std::sin(angle));
+      }
+    }
+    RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+        "[mharope] trig table : max_seq_len {}, head_dim {}, base {}",
+        trig_max_seq_len_, K, trig_base_));
+  }
+
+  auto iter = table.kernel_bos.find(M);
+  if (iter == table.kernel_bos.end()) {
+    auto bo = xrt::bo(xrt_ctx_->get_device(), 2 * M * K * sizeof(TrigT),
+                      XRT_BO_FLAGS_HOST_ONLY,
+                      xrt_ctx_->get_kernel().group_id(0));
+    iter = table.kernel_bos.emplace(M, std::make_pair(bo, -1)).first;
+  }
+  auto &[bo, bo_pos_offset] = iter->second;
+  copy_time = 0;
+  sync_time = 0;
+  if (bo_pos_offset == trig_pos_offset_) {
+    return bo;
+  }
+
+  // rows past max_seq_len are padding, they are zeroed
+  int64_t copy_start = GET_ELAPSED_TIME_NS();
+  TrigT *bo_map = bo.template map<TrigT *>();
+  const int64_t rows = std::clamp<int64_t>(
+      (int64_t)trig_max_seq_len_ - trig_pos_offset_, 0, M);
+  for (size_t i = 0; i < 2; ++i) {
+    TrigT *dst = bo_map + i * M * K;
+    if (rows > 0) {
+      memcpy(dst, table.host.data() + i * table_size + trig_pos_offset_ * K,
+             rows * K * sizeof(TrigT));
+    }
+    memset(dst + rows * K, 0, (M - rows) * K * sizeof(TrigT));
+  }
+  int64_t copy_stop = GET_ELAPSED_TIME_NS();
+  bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  int64_t sync_stop = GET_ELAPSED_TIME_NS();
+  copy_time = copy_stop - copy_start;
+  sync_time = sync_stop - copy_stop;
+  bo_pos_offset = trig_pos_offset_;
+  return bo;
+}
+
+// Run on BOs already on device, shape is set by set_kernel_shape()
+template <typename LhsT, typename TrigT, typename OutT>
+void mha_rope<LhsT, TrigT, OutT>::execute(std::vector<xrt::bo> &input,
+                                          std::vector<xrt::bo> &output) {
+  const auto instr_bo_key =
+      get_instr_key(txn_fname_prefix_, kernel_x_shape_[0], kernel_x_shape_[1],
+                    kernel_x_shape_[2]);
+  const xrt::bo &instr_bo = instr_reg_.get_instr_bo(instr_bo_key).second;
+
+  int instr_bo_words = instr_bo.size() / sizeof(int);
+  auto kernel_ = xrt_ctx_->get_kernel();
+  xrt::run run;
+  run = kernel_(2, instr_bo, instr_bo_words,
+                input[0].address() + DDR_AIE_ADDR_OFFSET,
+                input[1].address() + DDR_AIE_ADDR_OFFSET,
+                output[0].address() + DDR_AIE_ADDR_OFFSET, 0, 0);
+  run.wait2();
+}
+
 template <typename LhsT, typename TrigT, typename OutT>
 const std::vector<uint8_t> mha_rope<LhsT, TrigT, OutT>::get_transaction_bin(
     std::vector<Tensor> &input, std::vector<Tensor> &output,
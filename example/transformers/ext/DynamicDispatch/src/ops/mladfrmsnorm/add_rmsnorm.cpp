@@ -0,0 +1,132 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include <algorithm>
+#include <any>
+#include <map>
+#include <vector>
+
+#include <ops/mladfrmsnorm/add_rmsnorm.hpp>
+#include <ops/op_interface.hpp>
+#include <txn/txn_utils.hpp>
+#include <txn_helper/txn_helper.hpp>
+#include <utils/logging.hpp>
+#include <utils/tfuncs.hpp>
+
+namespace ryzenai {
+
+// onnx args of this op
+static constexpr size_t ADD_RMS_NUM_ARGS = 4;
+static constexpr size_t ADD_RMS_WTS_INDEX = 2;
+static constexpr size_t ADD_RMS_OUT_INDEX = 3;
+static constexpr size_t ADD_RMS_SUM_INDEX = 4;
+
+// xrt args of the add/rmsnorm txns, see their get_buffer_reqs()
+static constexpr uint32_t OPERAND_XRT_ARG_IDX = 0;
+static constexpr uint32_t RHS_XRT_ARG_IDX = 1;
+static constexpr uint32_t OUTPUT_XRT_ARG_IDX = 2;
+// xrt args only used by this op
+static constexpr uint32_t WTS_XRT_ARG_IDX = 3;
+static constexpr uint32_t SUM_XRT_ARG_IDX = 4;
+
+template <typename LhsT, typename WtsT, typename OutT>
+add_rms_norm<LhsT, WtsT, OutT>::add_rms_norm(const std::string &operand_dtype,
+                                             bool load_xrt) {
+  add_ = std::make_unique<mladf_add<LhsT, LhsT, LhsT>>(operand_dtype, load_xrt);
+  rms_ = std::make_unique<rms_norm<LhsT, WtsT, OutT>>(operand_dtype, load_xrt);
+}
+
+template <typename LhsT, typename WtsT, typename OutT>
+Tensor add_rms_norm<LhsT, WtsT, OutT>::get_sum_tensor(
+    const std::vector<Tensor> &tensors) const {
+  if (tensors.size() > ADD_RMS_SUM_INDEX) {
+    return tensors.at(ADD_RMS_SUM_INDEX);
+  }
+  return {nullptr, tensors.at(0).shape, tensors.at(0).dtype};
+}
+
+template <typename LhsT, typename WtsT, typename OutT>
+std::vector<Tensor> add_rms_norm<LhsT, WtsT, OutT>::get_add_tensors(
+    const std::vector<Tensor> &tensors, const Tensor &sum) const {
+  return {tensors.at(0), tensors.at(1), sum};
+}
+
+template <typename LhsT, typename WtsT, typename OutT>
+std::vector<Tensor> add_rms_norm<LhsT, WtsT, OutT>::get_rms_tensors(
+    const std::vector<Tensor> &tensors, const Tensor &sum) const {
+  return {sum, tensors.at(ADD_RMS_WTS_INDEX), tensors.at(ADD_RMS_OUT_INDEX)};
+}
+
+template <typename LhsT, typename WtsT, typename OutT>
+const std::vector<uint8_t> add_rms_norm<LhsT, WtsT, OutT>::get_transaction_bin(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  auto sum = get_sum_tensor(input);
+  auto add_tensors = get_add_tensors(input, sum);
+  auto rms_tensors = get_rms_tensors(input, sum);
+
+  // add writes the sum, rmsnorm reads it
+  const txn_arg_remap_t add_remap = {
+      {OUTPUT_XRT_ARG_IDX, {SUM_XRT_ARG_IDX, 0}}};
+  const txn_arg_remap_t rms_remap = {
+      {OPERAND_XRT_ARG_IDX, {SUM_XRT_ARG_IDX, 0}},
+      {RHS_XRT_ARG_IDX, {WTS_XRT_ARG_IDX, 0}}};
+
+  auto add_txn = remap_txn_args(
+      add_->get_transaction_bin(add_tensors, add_tensors), add_remap);
+  auto rms_txn = remap_txn_args(
+      rms_->get_transaction_bin(rms_tensors, rms_tensors), rms_remap);
+
+  return ::utils::txn_util::fuse_txns({add_txn, rms_txn});
+}
+
+template <typename LhsT, typename WtsT, typename OutT>
+std::vector<OpArgMap> add_rms_norm<LhsT, WtsT, OutT>::get_buffer_reqs(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  DOD_THROW_IF(input.size() != ADD_RMS_NUM_ARGS &&
+                   input.size() != ADD_RMS_NUM_ARGS + 1,
+               OpsFusion::dod_format(
+                   "AddRMSNorm : expect {} or {} args, got {}",
+                   ADD_RMS_NUM_ARGS, ADD_RMS_NUM_ARGS + 1, input.size()));
+  const bool has_sum_output = input.size() > ADD_RMS_SUM_INDEX;
+  auto sum = get_sum_tensor(input);
+  auto add_tensors = get_add_tensors(input, sum);
+  auto rms_tensors = get_rms_tensors(input, sum);
+
+  std::vector<OpArgMap> arg_map;
+  size_t sum_bo_size = 0;
+  for (const auto &req : add_->get_buffer_reqs(add_tensors, add_tensors)) {
+    if (req.arg_type == OpArgMap::OpArgType::OUTPUT) {
+      sum_bo_size = std::max(sum_bo_size, req.size);
+    } else {
+      arg_map.push_back(req);
+    }
+  }
+  for (auto req : rms_->get_buffer_reqs(rms_tensors, rms_tensors)) {
+    if (req.xrt_arg_idx == OPERAND_XRT_ARG_IDX) {
+      sum_bo_size = std::max(sum_bo_size, req.size);
+    } else if (req.xrt_arg_idx == RHS_XRT_ARG_IDX) {
+      req.xrt_arg_idx = WTS_XRT_ARG_IDX;
+      req.onnx_arg_idx = ADD_RMS_WTS_INDEX;
+      arg_map.push_back(req);
+    } else {
+      req.onnx_arg_idx = ADD_RMS_OUT_INDEX;
+      arg_map.push_back(req);
+    }
+  }
+
+  if (has_sum_output) {
+    arg_map.push_back({OpArgMap::OpArgType::OUTPUT, SUM_XRT_ARG_IDX,
+                       ADD_RMS_SUM_INDEX, 0, sum_bo_size});
+  } else {
+    arg_map.push_back({OpArgMap::OpArgType::SCRATCH_PAD, SUM_XRT_ARG_IDX, 0, 0,
+                       sum_bo_size});
+  }
+  return arg_map;
+}
+
+template class add_rms_norm<uint16_t, uint16_t, uint16_t>;
+
+} // namespace ryzenai
@@ -74,6 +74,12 @@ void rms_norm<LhsT, WtsT, OutT>::debug(bool enable) {
   debug_ = enable;
 }
 
+template <typename LhsT, typename WtsT, typename OutT>
+OpExecTimes rms_norm<LhsT, WtsT, OutT>::get_exec_times() const {
+  return {a_copy_time_ + b_copy_time_ + c_copy_time_,
+          a_sync_time_ + b_sync_time_ + c_sync_time_, run_aie_time_};
+}
+
 template <typename LhsT, typename WtsT, typename OutT>
 std::string rms_norm<LhsT, WtsT, OutT>::get_instr_key(std::string prefix, int m,
                                                       int k) {
@@ -1,6 +1,7 @@
 /*
  * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
  */
+#include <algorithm>
 #include <any>
 #include <iostream>
 #include <map>
@@ -26,11 +27,25 @@
 
 #include <ops/nni_resize/nni_resize.hpp>
 #include <ops/op_interface.hpp>
+#include <txn/txn_utils.hpp>
+#include <txn_helper/txn_helper.hpp>
 #include <utils/logging.hpp>
 #include <utils/utils.hpp>
 
 namespace ryzenai {
 
+// onnx args of this op
+static constexpr size_t NNI_OUT_INDEX = 2;
+
+// xrt args of the nni_resize txn, see get_buffer_reqs()
+static constexpr uint32_t OUTPUT_XRT_ARG_IDX = 0;
+static constexpr uint32_t INPUT_XRT_ARG_IDX = 1;
+static constexpr uint32_t SUPER_KERNEL_XRT_ARG_IDX = 3;
+static constexpr uint32_t SCRATCH_XRT_ARG_IDX = 4;
+
+// scale of a single run of the kernel
+static constexpr int NNI_KERNEL_SCALE = 2;
+
 static std::tuple<int, int, int>
 extract_HWC(const std::vector<Tensor> &inputs) {
   int H = 0;
@@ -107,6 +122,82 @@ std::string nni_resize<InT, OutT>::get_instr_key(std::string prefix, int h,
          std::to_string(w) + "_" + std::to_string(c);
 }
 
+template <typename InT, typename OutT>
+std::tuple<int, int, int> nni_resize<InT, OutT>::find_kernel_tile(int H, int W,
+                                                                  int C) {
+  // pick the tallest supported shape whose rows match and which tiles H
+  const auto &supported_shapes = MAP_AT(raw_shapes_, txn_fname_prefix_);
+  int tile_h = 0;
+  for (const auto &mat : supported_shapes) {
+    const int kh = get<0>(mat);
+    if (W == get<1>(mat) && C == get<2>(mat) && H % kh == 0 && kh > tile_h) {
+      tile_h = kh;
+    }
+  }
+  DOD_THROW_IF(tile_h == 0,
+               OpsFusion::dod_format(
+                   "NNI_RESIZE : no kernel tile for H x W x C : {} x {} x {}",
+                   H, W, C));
+  return std::make_tuple(tile_h, W, C);
+}
+
+template <typename InT, typename OutT>
+std::vector<uint8_t>
+nni_resize<InT, OutT>::load_txn_str(const std::string &key) {
+  Transaction &txn = Transaction::getInstance();
+  std::string txn_string = txn.get_txn_str(key);
+  std::istringstream txn_stream(txn_string, std::ios::binary);
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(txn_stream)),
+                            std::istreambuf_iterator<char>());
+  return data;
+}
+
+template <typename InT, typename OutT>
+std::vector<typename nni_resize<InT, OutT>::resize_pass_t>
+nni_resize<InT, OutT>::get_resize_passes(const std::vector<Tensor> &tensors) {
+  auto [H, W, C] = extract_HWC(tensors);
+  // scale is computed from the output shape, 2x if it is not passed
+  int Ho = H * NNI_KERNEL_SCALE;
+  int Wo = W * NNI_KERNEL_SCALE;
+  int Co = C;
+  if (tensors.size() > NNI_OUT_INDEX) {
+    std::tie(Ho, Wo, Co) = extract_HWC({tensors.at(NNI_OUT_INDEX)});
+  }
+  DOD_THROW_IF(Co != C || H == 0 || W == 0 || Ho % H != 0 || Wo % W != 0 ||
+                   Ho / H != Wo / W,
+               OpsFusion::dod_format("NNI_RESIZE : unsupported resize {} x {} "
+                                     "x {} -> {} x {} x {}",
+                                     H, W, C, Ho, Wo, Co));
+  const int scale = Ho / H;
+  DOD_THROW_IF(scale < NNI_KERNEL_SCALE || (scale & (scale - 1)) != 0,
+               OpsFusion::dod_format(
+                   "NNI_RESIZE : scale {} is not a power of 2", scale));
+
+  std::vector<resize_pass_t> passes;
+  size_t param_offset = 0;
+  for (int h = H, w = W; h < Ho;
+       h *= NNI_KERNEL_SCALE, w *= NNI_KERNEL_SCALE) {
+    auto [kh, kw, kc] = find_kernel_tile(h, w, C);
+    auto kernel_shape = map_padded_shape(kh, kw, kc);
+    resize_pass_t pass;
+    pass.in_shape = std::make_tuple(h, w, C);
+    pass.kernel_shape = kernel_shape;
+    pass.num_tiles = h / kh;
+    pass.tile_in_size = size_t(kh) * w * C * sizeof(InT);
+    pass.tile_out_size = pass.tile_in_size / sizeof(InT) * NNI_KERNEL_SCALE *
+                         NNI_KERNEL_SCALE * sizeof(OutT);
+    pass.param_offset = param_offset;
+    param_offset += load_txn_str(get_instr_key(param_fname_prefix_,
+                                               get<0>(kernel_shape),
+                                               get<1>(kernel_shape),
+                                               get<2>(kernel_shape)) +
+                                 "_param")
+                        .size();
+    passes.push_back(pass);
+  }
+  return passes;
+}
+
 template <typename InT, typename OutT>
 void nni_resize<InT, OutT>::setup_instr_registry() {
 
@@ -182,6 +273,14 @@ nni_resize<InT, OutT>::nni_resize(const std::string &a_dtype,
     RYZENAI_LOG_TRACE("iConv: DesignFormat: " + design_param_);
   }
 
+  if (attr.count("mode") &&
+      attr.at("mode").type() == typeid(std::vector<string>)) {
+    const auto &mode =
+        std::any_cast<const std::vector<string> &>(attr.at("mode"));
+    DOD_THROW_IF(mode.size() != 1 || mode.at(0) != "nearest",
+                 "NNI_RESIZE : only nearest mode is supported");
+  }
+
   if (design_param_.find("4x4") != std::string::npos) { // 4x4 design
     txn_fname_prefix_ = "nni_resize_4x4_" + txnbin_a_header.at(a_dtype_) +
                         txnbin_c_header.at(c_dtype_);
@@ -348,34 +447,51 @@ template <typename InT, typename OutT>
 const std::vector<uint8_t> nni_resize<InT, OutT>::get_transaction_bin(
     std::vector<Tensor> &input, std::vector<Tensor> &output,
     const std::map<std::string, std::any> &attr) {
-  auto [H, W, C] = extract_HWC(input);
-  auto [Ho, Wo, Co] = map_padded_shape(H, W, C);
-  std::string txn_key = get_instr_key(txn_fname_prefix_, Ho, Wo, Co);
-  Transaction &txn = Transaction::getInstance();
-  std::string txn_string = txn.get_txn_str(txn_key);
-  std::istringstream txn_stream(txn_string, std::ios::binary);
-  std::vector<uint8_t> data((std::istreambuf_iterator<char>(txn_stream)),
-                            std::istreambuf_iterator<char>());
+  auto passes = get_resize_passes(input);
+  const size_t mid_bo_size = passes.back().tile_in_size *
+                             passes.back().num_tiles / sizeof(InT) *
+                             sizeof(OutT);
+
+  // intermediate passes ping-pong between the two halves of the scratch pad
+  std::vector<std::vector<uint8_t>> txns;
+  for (size_t p = 0; p < passes.size(); p++) {
+    const auto &pass = passes.at(p);
+    auto [Ho, Wo, Co] = pass.kernel_shape;
+    auto base_txn = load_txn_str(get_instr_key(txn_fname_prefix_, Ho, Wo, Co));
+    const bool first = p == 0;
+    const bool last = p + 1 == passes.size();
+    const uint32_t in_arg = first ? INPUT_XRT_ARG_IDX : SCRATCH_XRT_ARG_IDX;
+    const uint32_t out_arg = last ? OUTPUT_XRT_ARG_IDX : SCRATCH_XRT_ARG_IDX;
+    const uint64_t in_offset = first ? 0 : ((p - 1) % 2) * mid_bo_size;
+    const uint64_t out_offset = last ? 0 : (p % 2) * mid_bo_size;
+    for (int t = 0; t < pass.num_tiles; t++) {
+      const txn_arg_remap_t remap = {
+          {INPUT_XRT_ARG_IDX, {in_arg, in_offset + t * pass.tile_in_size}},
+          {OUTPUT_XRT_ARG_IDX, {out_arg, out_offset + t * pass.tile_out_size}},
+          {SUPER_KERNEL_XRT_ARG_IDX,
+           {SUPER_KERNEL_XRT_ARG_IDX, pass.param_offset}}};
+      txns.push_back(remap_txn_args(base_txn, remap));
+    }
+  }
 
-  return data;
+  if (txns.size() == 1) {
+    return txns.front();
+  }
+  return ::utils::txn_util::fuse_txns(txns);
 }
 
 template <typename InT, typename OutT>
 const std::vector<uint8_t> nni_resize<InT, OutT>::get_super_kernel_params(
     std::vector<Tensor> &input, std::vector<Tensor> &output,
     const std::map<std::string, std::any> &attr) {
-  auto [H, W, C] = extract_HWC(input);
-  auto [Ho, Wo, Co] = map_padded_shape(H, W, C);
-  // TODO: Add check to validate tensor shapes
-  std::string param_key =
-      get_instr_key(param_fname_prefix_, Ho, Wo, Co) + "_param";
-  // std::cout << "Super kernel params name : " << fname << std::endl;
-  Transaction &txn = Transaction::getInstance();
-  std::string param_string = txn.get_txn_str(param_key);
-  std::istringstream params_stream(param_string, std::ios::binary);
-  std::vector<uint8_t> data((std::istreambuf_iterator<char>(params_stream)),
-                            std::istreambuf_iterator<char>());
-
+  // layer params of each pass back to back, see resize_pass_t::param_offset
+  std::vector<uint8_t> data;
+  for (const auto &pass : get_resize_passes(input)) {
+    auto [Ho, Wo, Co] = pass.kernel_shape;
+    auto param_data =
+        load_txn_str(get_instr_key(param_fname_prefix_, Ho, Wo, Co) + "_param");
+    data.insert(data.end(), param_data.begin(), param_data.end());
+  }
   return data;
 }
 
@@ -383,23 +499,33 @@ template <typename InT, typename OutT>
 std::vector<OpArgMap> nni_resize<InT, OutT>::get_buffer_reqs(
     std::vector<Tensor> &input, std::vector<Tensor> &output,
     const std::map<std::string, std::any> &attr) {
-  auto [H, W, C] = extract_HWC(input);
+  auto passes = get_resize_passes(input);
+  const auto &first = passes.front();
+  const auto &last = passes.back();
 
-  auto [Ho, Wo, Co] = map_padded_shape(H, W, C);
-  auto out_shape = Ho * Wo * Co * 4;
   size_t const_params_bo_size = 16; // Dummy Buffer
-  size_t input_bo_size = (Ho * Wo * Co * sizeof(InT));
-  size_t output_bo_size = (out_shape * sizeof(OutT));
+  size_t input_bo_size = first.tile_in_size * first.num_tiles;
+  size_t output_bo_size = last.tile_out_size * last.num_tiles;
   size_t super_kernel_size = get_super_kernel_params(input, output).size();
 
   std::vector<OpArgMap> arg_map{
-      {OpArgMap::OpArgType::INPUT, 1, 0, 0, input_bo_size},
+      {OpArgMap::OpArgType::INPUT, INPUT_XRT_ARG_IDX, 0, 0, input_bo_size},
       {OpArgMap::OpArgType::CONST_INPUT, 2, 1, 0,
        const_params_bo_size}, // Dummy allocation
-      {OpArgMap::OpArgType::OUTPUT, 0, 2, 0, output_bo_size},
-      {OpArgMap::OpArgType::CONST_KERNEL_PARAM_INPUT, 3, 0, 0,
-       super_kernel_size}}; // TODO: This will be removed after the recent
-                            // changes from main are merged into computex
+      {OpArgMap::OpArgType::OUTPUT, OUTPUT_XRT_ARG_IDX, NNI_OUT_INDEX, 0,
+       output_bo_size},
+      {OpArgMap::OpArgType::CONST_KERNEL_PARAM_INPUT, SUPER_KERNEL_XRT_ARG_IDX,
+       0, 0, super_kernel_size}}; // TODO: This will be removed after the recent
+                                  // changes from main are merged into computex
+
+  // two buffers for the outputs of the intermediate passes
+  if (passes.size() > 1) {
+    const size_t mid_bo_size =
+        last.tile_in_size * last.num_tiles / sizeof(InT) * sizeof(OutT);
+    const size_t num_mid_bufs = std::min<size_t>(passes.size() - 1, 2);
+    arg_map.push_back({OpArgMap::OpArgType::SCRATCH_PAD, SCRATCH_XRT_ARG_IDX,
+                       0, 0, mid_bo_size * num_mid_bufs});
+  }
 
   return arg_map;
 }
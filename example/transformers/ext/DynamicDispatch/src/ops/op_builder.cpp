@@ -13,12 +13,16 @@
 #include <ops/gap/gap.hpp>
 #include <ops/gelu/gelu.cpp>
 #include <ops/groupnorm/groupnorm.hpp>
+#include <ops/groupnorm/groupnorm_silu.hpp>
+#include <ops/host_op/host_op.hpp>
 #include <ops/iconv/iconv.hpp>
+#include <ops/layernorm/add_layernorm.hpp>
 #include <ops/layernorm/layernorm.hpp>
 #include <ops/lstm/lstm.hpp>
 #include <ops/maskedsoftmax/maskedsoftmax.hpp>
 #include <ops/matmul/matmul.hpp>
 #include <ops/matmul_a16a16_mladf/matmul_a16a16_mladf.hpp>
+#include <ops/matmul_a16w4_mladf/matmul_a16w4_mladf.hpp>
 #include <ops/matmul_a16w8_mladf/matmul_a16w8_mladf.hpp>
 #include <ops/matmulbias/matmulbias.hpp>
 #include <ops/matmulgeluadd/matmulgeluadd.hpp>
@@ -29,14 +33,17 @@
 #include <ops/mhapsr/mhapsr.hpp>
 #include <ops/mhawindow/mhawindow.hpp>
 #include <ops/mladfadd/mladfadd.hpp>
+#include <ops/mladfattention/mladfattention.hpp>
 #include <ops/mladfelwadd/mladfelwadd.hpp>
 #include <ops/mladfelwmul/mladfelwmul.hpp>
 #include <ops/mladfmatmulbias/mladfmatmulbias.hpp>
 #include <ops/mladfmharope/mladfmharope.hpp>
+#include <ops/mladfrmsnorm/add_rmsnorm.hpp>
 #include <ops/mladfrmsnorm/mladfrmsnorm.hpp>
 #include <ops/mladfsoftmax/mladfsoftmax.hpp>
 #include <ops/nni_resize/nni_resize.hpp>
 #include <ops/op_builder.hpp>
+#include <ops/perf_counter/perf_counter.hpp>
 #include <ops/pm_load/pm_load.hpp>
 #include <ops/record_timer/record_timer.hpp>
 #include <ops/silu/silu.hpp>
@@ -45,6 +52,7 @@
 #include <ops/softmax_qdq/softmax_qdq.hpp>
 #include <ops/transpose/transpose.hpp>
 #include <ops/xcom/conv/conv.hpp>
+#include <ops/xcom/conv/dwc_pw_conv.hpp>
 
 using json = nlohmann::json;
 
@@ -218,6 +226,21 @@ create_impl(const std::string &op_type, const std::vector<std::string> &types,
       throw std::runtime_error(
           "Datatypes are not supported by current LRN Impl.");
     }
+  } else if (op_type == "QAddLayerNorm") {
+    const auto &a_type = ARRAY_AT(types, 0);
+    const auto &c_type = ARRAY_AT(types, 6);
+    if ((a_type == "uint16") && (c_type == "uint8")) {
+      return std::make_unique<
+          ryzenai::add_layernorm<uint16_t, uint16_t, uint8_t>>(a_type, c_type,
+                                                               false, attr);
+    } else if ((a_type == "uint16") && (c_type == "uint16")) {
+      return std::make_unique<
+          ryzenai::add_layernorm<uint16_t, uint16_t, uint16_t>>(
+          a_type, c_type, false, attr);
+    } else {
+      throw std::runtime_error(
+          "Datatypes are not supported by current QAddLayerNorm Impl.");
+    }
   } else if (op_type == "QGroupNorm") {
     const auto &a_type = "bfloat16";
     const auto &c_type = "bfloat16";
@@ -228,6 +251,17 @@ create_impl(const std::string &op_type, const std::vector<std::string> &types,
       throw std::runtime_error(
           "Datatypes are not supported by current QGroupNorm Impl.");
     }
+  } else if (op_type == "QGroupNormSilu") {
+    const auto &a_type = "bfloat16";
+    const auto &c_type = ARRAY_AT(types, 5);
+    if (c_type == "uint16") {
+      return std::make_unique<
+          ryzenai::groupnorm_silu<int16_t, int16_t, uint16_t>>(a_type, c_type,
+                                                               false, attr);
+    } else {
+      throw std::runtime_error(
+          "Datatypes are not supported by current QGroupNormSilu Impl.");
+    }
   } else if (op_type == "MatMulAdd" || op_type == "QMatMulAdd") {
     const auto &a_type = ARRAY_AT(types, 0);
     const auto &b_type = ARRAY_AT(types, 1);
@@ -492,6 +526,17 @@ create_impl(const std::string &op_type, const std::vector<std::string> &types,
       throw std::runtime_error(
           "Datatypes are not supported by current MHA Rope Impl.");
     }
+  } else if (op_type == "MLADFATTENTION") {
+    const auto &a_type = ARRAY_AT(types, 0);
+    // weights are int4 like MladfMatMul, b_type isn't used
+    if (a_type == "bfloat16") {
+      return std::make_unique<
+          ryzenai::mladf_attention<int16_t, int8_t, int16_t>>(a_type, "uint4",
+                                                              false);
+    } else {
+      throw std::runtime_error(
+          "Datatypes are not supported by current MLADFATTENTION Impl.");
+    }
   } else if (op_type == "MLADFRMSNORM") {
     const auto &a_type = ARRAY_AT(types, 0);
     const auto &b_type = ARRAY_AT(types, 1);
@@ -504,6 +549,18 @@ create_impl(const std::string &op_type, const std::vector<std::string> &types,
       throw std::runtime_error(
           "Datatypes are not supported by current RMS Norm Impl.");
     }
+  } else if (op_type == "MLADFADDRMSNORM") {
+    const auto &a_type = ARRAY_AT(types, 0);
+    const auto &b_type = ARRAY_AT(types, 2);
+    const auto &c_type = ARRAY_AT(types, 3);
+    if ((a_type == "bfloat16") && (b_type == "bfloat16") &&
+        (c_type == "bfloat16")) {
+      return std::make_unique<
+          ryzenai::add_rms_norm<uint16_t, uint16_t, uint16_t>>(a_type, false);
+    } else {
+      throw std::runtime_error(
+          "Datatypes are not supported by current Add RMS Norm Impl.");
+    }
   } else if (op_type == "MLADFMATMULA16A16") {
     const auto &a_type = ARRAY_AT(types, 0);
     const auto &b_type = ARRAY_AT(types, 1);
@@ -528,8 +585,26 @@ create_impl(const std::string &op_type, const std::vector<std::string> &types,
       throw std::runtime_error(
           "Datatypes are not supported by current MLADFMATMULA16W8 Impl.");
     }
+  } else if (op_type == "MLADFMATMULA16W4") {
+    const auto &a_type = ARRAY_AT(types, 0);
+    const auto &b_type = ARRAY_AT(types, 1);
+    const auto &c_type = ARRAY_AT(types, 6);
+    if ((a_type == "uint16") && (b_type == "uint4") && (c_type == "uint16")) {
+      return std::make_unique<
+          ryzenai::matmul_a16w4_mladf<uint16_t, uint8_t, uint16_t>>(
+          a_type, b_type, c_type, false);
+    } else {
+      throw std::runtime_error(
+          "Datatypes are not supported by current MLADFMATMULA16W4 Impl.");
+    }
   } else if (op_type == "RECORD_TIMER") {
     return std::make_unique<ryzenai::record_timer>();
+  } else if (op_type == "PERF_COUNTER_START") {
+    return std::make_unique<ryzenai::perf_counter>(true);
+  } else if (op_type == "PERF_COUNTER_READ") {
+    return std::make_unique<ryzenai::perf_counter>(false);
+  } else if (op_type == OpsFusion::HOST_OP_TYPE) {
+    return std::make_unique<ryzenai::host_op>(attr);
   } else if (op_type == "QConv") {
     const auto &a_type = ARRAY_AT(types, 0);
     const auto &b_type = ARRAY_AT(types, 1);
@@ -625,7 +700,8 @@ create_impl(const std::string &op_type, const std::vector<std::string> &types,
       throw std::runtime_error(
           "Datatypes are not supported by current IConv Impl.");
     }
-  } else if (op_type == "xcom-conv2d") {
+  } else if (op_type == "xcom-conv2d" || op_type == "xcom-conv2d-relu" ||
+             op_type == "xcom-conv2d-leakyrelu") {
     // order depends on onnx node
     constexpr std::uint32_t ACT_INDEX = 0;
     constexpr std::uint32_t WEIGHT_INDEX = 3;
@@ -636,7 +712,13 @@ create_impl(const std::string &op_type, const std::vector<std::string> &types,
     const auto &bias_type = ARRAY_AT(types, BIAS_INDEX);
     const auto &c_type = ARRAY_AT(types, OUT_INDEX);
     bool load_xrt = false;
-    if ((a_type == "int8") && (b_type == "int8") && (c_type == "int8")) {
+    // activation fused into the epilogue of the qdq conv
+    const std::string activation = (op_type == "xcom-conv2d-relu") ? "Relu"
+                                   : (op_type == "xcom-conv2d-leakyrelu")
+                                       ? "LeakyRelu"
+                                       : "";
+    if ((a_type == "int8") && (b_type == "int8") && (c_type == "int8") &&
+        activation.empty()) {
       return std::make_unique<ryzenai::xcom::conv2d<
           std::int8_t, std::int8_t, std::int8_t, std::int8_t, false>>(
           a_type, b_type, bias_type, c_type, load_xrt);
@@ -644,11 +726,35 @@ create_impl(const std::string &op_type, const std::vector<std::string> &types,
                (bias_type == "int32") && (c_type == "uint16")) {
       return std::make_unique<ryzenai::xcom::conv2d<
           std::uint16_t, std::uint8_t, std::int32_t, std::uint16_t, false>>(
-          a_type, b_type, bias_type, c_type, load_xrt);
+          a_type, b_type, bias_type, c_type, load_xrt, activation);
     } else {
       throw std::runtime_error(
           "Datatypes are not supported  by current XCOM::CONV2d Impl.");
     }
+  } else if (op_type == "xcom-dwc-pw-conv2d") {
+    // order depends on onnx node, see dwc_pw_conv.hpp
+    constexpr std::uint32_t ACT_INDEX = 0;
+    constexpr std::uint32_t WEIGHT_INDEX = 3;
+    constexpr std::uint32_t BIAS_INDEX = 6;
+    constexpr std::uint32_t OUT_INDEX = 19;
+    const auto &a_type = ARRAY_AT(types, ACT_INDEX);
+    const auto &b_type = ARRAY_AT(types, WEIGHT_INDEX);
+    const auto &bias_type = ARRAY_AT(types, BIAS_INDEX);
+    const auto &c_type = ARRAY_AT(types, OUT_INDEX);
+    bool load_xrt = false;
+    if ((a_type == "int8") && (b_type == "int8") && (c_type == "int8")) {
+      return std::make_unique<ryzenai::xcom::dwc_pw_conv2d<
+          std::int8_t, std::int8_t, std::int8_t, std::int8_t>>(
+          a_type, b_type, bias_type, c_type, load_xrt);
+    } else if ((a_type == "uint16") && (b_type == "uint8") &&
+               (bias_type == "int32") && (c_type == "uint16")) {
+      return std::make_unique<ryzenai::xcom::dwc_pw_conv2d<
+          std::uint16_t, std::uint8_t, std::int32_t, std::uint16_t>>(
+          a_type, b_type, bias_type, c_type, load_xrt);
+    } else {
+      throw std::runtime_error(
+          "Datatypes are not supported by current XCOM::DWC_PW_CONV2d Impl.");
+    }
   } else if (op_type == "PSRMHA") {
     const auto &a_type = ARRAY_AT(types, 0);
     const auto &c_type = ARRAY_AT(types, 4);
@@ -745,6 +851,35 @@ std::unique_ptr<OpInterface> OpBuilder::create(
   }
 }
 
+static thread_local OpCacheScope *op_cache_scope = nullptr;
+
+OpCacheScope::OpCacheScope() : prev_(op_cache_scope) { op_cache_scope = this; }
+
+OpCacheScope::~OpCacheScope() { op_cache_scope = prev_; }
+
+std::shared_ptr<OpInterface> OpBuilder::get_or_create(
+    const Metadata::OpInfo &op_info,
+    const std::map<std::string, Metadata::OffsetInfo> &tensor_map) {
+  if (op_cache_scope == nullptr) {
+    return create(op_info.name, op_info, tensor_map);
+  }
+
+  std::string signature = op_info.type;
+  for (const auto &dtype : extract_arg_dtypes(op_info, tensor_map)) {
+    signature += "," + dtype;
+  }
+  for (const auto &[name, value] : op_info.attr) {
+    signature += ";" + name;
+  }
+
+  auto &entry = op_cache_scope->ops_[op_info.name];
+  if (!entry.op || entry.signature != signature) {
+    entry.op = create(op_info.name, op_info, tensor_map);
+    entry.signature = std::move(signature);
+  }
+  return entry.op;
+}
+
 bool OpBuilder::is_supported(const std::string &op_type,
                              const std::vector<std::string> &types,
                              const std::map<std::string, std::any> &attr) {
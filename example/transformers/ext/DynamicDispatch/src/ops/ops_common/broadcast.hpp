@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+// Numpy style broadcast of an elementwise operand to the shape of the
+// other one, for the kernels that only run on operands of the same shape.
+namespace ryzenai {
+namespace broadcast {
+
+inline size_t numel(const std::vector<size_t> &shape) {
+  return std::accumulate(shape.begin(), shape.end(), size_t{1},
+                         std::multiplies{});
+}
+
+// src shape with leading 1s, so it has the rank of dst
+inline std::vector<size_t> align_rank(const std::vector<size_t> &src,
+                                      size_t rank) {
+  std::vector<size_t> aligned(rank > src.size() ? rank - src.size() : 0, 1);
+  aligned.insert(aligned.end(), src.begin(), src.end());
+  return aligned;
+}
+
+// True if every dim of src is 1 or the dim of dst, aligned from the right
+inline bool is_broadcastable(const std::vector<size_t> &src,
+                             const std::vector<size_t> &dst) {
+  if (src.size() > dst.size()) {
+    // leading 1s of src are fine, e.g. [1, 1, N] to [M, N]
+    for (size_t i = 0; i < src.size() - dst.size(); ++i) {
+      if (src[i] != 1) {
+        return false;
+      }
+    }
+  }
+  auto src_it = src.rbegin();
+  auto dst_it = dst.rbegin();
+  for (; src_it != src.rend() && dst_it != dst.rend(); ++src_it, ++dst_it) {
+    if (*src_it != 1 && *src_it != *dst_it) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Expands src of src_shape into the dst_shape elements at dst. The scalar,
+// per channel ([N] to [M, N]) and per row ([M, 1] to [M, N]) cases are
+// filled without index arithmetic.
+template <typename T>
+void broadcast_to(T *dst, const T *src, const std::vector<size_t> &src_shape,
+                  const std::vector<size_t> &dst_shape) {
+  const size_t dst_size = numel(dst_shape);
+  const size_t src_size = numel(src_shape);
+  if (dst_size == 0) {
+    return;
+  }
+  if (src_size == dst_size) {
+    std::memcpy(dst, src, dst_size * sizeof(T));
+    return;
+  }
+  if (src_size == 1) {
+    std::fill(dst, dst + dst_size, src[0]);
+    return;
+  }
+
+  const size_t rank = dst_shape.size();
+  auto shape = align_rank(src_shape, rank);
+  if (shape.size() > rank) {
+    shape.erase(shape.begin(), shape.begin() + (shape.size() - rank));
+  }
+  const size_t cols = dst_shape.back();
+  const size_t rows = dst_size / cols;
+
+  if (shape.back() == cols && src_size == cols) {
+    for (size_t r = 0; r < rows; ++r) {
+      std::memcpy(dst + r * cols, src, cols * sizeof(T));
+    }
+    return;
+  }
+  if (shape.back() == 1 && src_size == rows &&
+      std::equal(shape.begin(), shape.end() - 1, dst_shape.begin())) {
+    for (size_t r = 0; r < rows; ++r) {
+      std::fill(dst + r * cols, dst + (r + 1) * cols, src[r]);
+    }
+    return;
+  }
+
+  // general case, one dst row at a time
+  std::vector<size_t> src_strides(rank, 0);
+  size_t stride = 1;
+  for (size_t d = rank; d-- > 0;) {
+    src_strides[d] = (shape[d] == 1) ? 0 : stride;
+    stride *= shape[d];
+  }
+  std::vector<size_t> idx(rank, 0);
+  for (size_t r = 0; r < rows; ++r) {
+    size_t src_offset = 0;
+    size_t rem = r;
+    for (size_t d = rank - 1; d-- > 0;) {
+      idx[d] = rem % dst_shape[d];
+      rem /= dst_shape[d];
+      src_offset += idx[d] * src_strides[d];
+    }
+    T *dst_row = dst + r * cols;
+    if (shape.back() == 1) {
+      std::fill(dst_row, dst_row + cols, src[src_offset]);
+    } else {
+      std::memcpy(dst_row, src + src_offset, cols * sizeof(T));
+    }
+  }
+}
+
+} // namespace broadcast
+} // namespace ryzenai
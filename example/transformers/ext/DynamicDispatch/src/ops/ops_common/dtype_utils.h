@@ -171,6 +171,20 @@ static uint8_t pack_v2uint4(int x, int y) {
   return (x & 0xF) | ((y & 0xF) << 4);
 }
 
+/*
+ * pack count int4 or uint4 values into count / 2 bytes, pairwise like
+ * pack_v2int4, the packing is the same for both signs
+ * @param dst is the packed output
+ * @param src is the int8 input, count is even
+ */
+template <typename T>
+static inline void pack_v2int4_span(uint8_t *dst, const T *src, int count) {
+  for (int i = 0; i < count / 2; ++i) {
+    dst[i] = static_cast<uint8_t>((src[2 * i] & 0xF) |
+                                  ((src[2 * i + 1] & 0xF) << 4));
+  }
+}
+
 struct v2int {
   int x;
   int y;
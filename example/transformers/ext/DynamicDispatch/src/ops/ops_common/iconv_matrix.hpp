@@ -1,8 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <assert.h>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <stdint.h>
 #include <type_traits>
@@ -455,16 +457,32 @@ inline int fold_stride_x_dim(int Sx, int fold_factor) {
   return Sx_f;
 }
 
+// Runs fn(b) for b in [0, n). The weight formatters below call it over
+// blocks of 8 output channels, each block owns whole rows of the subvolume
+// (channel % 8 is innermost), so the blocks can be formatted in parallel,
+// e.g. with Utils::parallel_for.
+using ChannelBlockLoop =
+    std::function<void(size_t, const std::function<void(size_t)> &)>;
+
+inline void serial_for(size_t n, const std::function<void(size_t)> &fn) {
+  for (size_t b = 0; b < n; ++b) {
+    fn(b);
+  }
+}
+
 template <typename Tw, typename T>
 void format_dwc_wgt(Tw W, T *wgt_data, int64_t *qdq, int C1, int C2, int Stdm,
-                    int Sout, int Zp) {
-  for (int c = 0; c < W.C; ++c) {
-    for (int y = 0; y < W.Ky; ++y) {
-      for (int x = 0; x < W.Kx; ++x) {
-        W.at(c, y, x) = wgt_data[c * W.Ky * W.Kx + y * W.Kx + x];
+                    int Sout, int Zp,
+                    const ChannelBlockLoop &for_each_block = serial_for) {
+  for_each_block((W.C + 7) / 8, [&](size_t b) {
+    for (int c = b * 8; c < std::min<int>(b * 8 + 8, W.C); ++c) {
+      for (int y = 0; y < W.Ky; ++y) {
+        for (int x = 0; x < W.Kx; ++x) {
+          W.at(c, y, x) = wgt_data[c * W.Ky * W.Kx + y * W.Kx + x];
+        }
       }
     }
-  }
+  });
 
   for (int c = 0; c < W.C; ++c) {
     W.set_qdq_c0(c, qdq[c]);
@@ -478,24 +496,27 @@ void format_dwc_wgt(Tw W, T *wgt_data, int64_t *qdq, int C1, int C2, int Stdm,
 
 template <typename Tw, typename T>
 void format_conv_wgt(Tw W, T *wgt_data, int CO, int CI, int64_t *qdq, int C1,
-                     int C2, int Stdm, int Sout, int Zp) {
-  for (int o = 0; o < CO; ++o) {
-    for (int i = 0; i < CI; ++i) {
-      for (int y = 0; y < W.Ky; ++y) {
-        for (int x = 0; x < W.Kx; ++x) {
-          W.at(o, i, y, x) =
-              wgt_data[o * CI * W.Ky * W.Kx + i * W.Ky * W.Kx + y * W.Kx + x];
+                     int C2, int Stdm, int Sout, int Zp,
+                     const ChannelBlockLoop &for_each_block = serial_for) {
+  for_each_block((CO + 7) / 8, [&](size_t b) {
+    for (int o = b * 8; o < std::min<int>(b * 8 + 8, CO); ++o) {
+      for (int i = 0; i < CI; ++i) {
+        for (int y = 0; y < W.Ky; ++y) {
+          for (int x = 0; x < W.Kx; ++x) {
+            W.at(o, i, y, x) =
+                wgt_data[o * CI * W.Ky * W.Kx + i * W.Ky * W.Kx + y * W.Kx + x];
+          }
         }
       }
-    }
-    for (int i = CI; i < W.Ci; ++i) {
-      for (int y = 0; y < W.Ky; ++y) {
-        for (int x = 0; x < W.Kx; ++x) {
-          W.at(o, i, y, x) = (T)Zp;
+      for (int i = CI; i < W.Ci; ++i) {
+        for (int y = 0; y < W.Ky; ++y) {
+          for (int x = 0; x < W.Kx; ++x) {
+            W.at(o, i, y, x) = (T)Zp;
+          }
         }
       }
     }
-  }
+  });
 
   for (int c = 0; c < CO; ++c) {
     W.set_qdq_c0(c, qdq[c]);
@@ -528,7 +549,8 @@ void format_conv_wgt(Tw W, T *wgt_data, int CO, int CI, int64_t *qdq, int C1,
 template <typename T, int Cos, int Cis>
 void fold_conv_wgt(T *wgt_data, T wgt_zp, int Co, int Ci, int Ky, int Kx,
                    int fold_factor, int Ci_gran,
-                   ConvWgtTensor<T, Cos, Cis> wgt_fold) {
+                   ConvWgtTensor<T, Cos, Cis> wgt_fold,
+                   const ChannelBlockLoop &for_each_block = serial_for) {
   int Ci_p = ((Ci + Ci_gran - 1) / Ci_gran) * Ci_gran;
   int Ci_f = fold_channel_in_dim(Ci, fold_factor, Ci_gran);
   int Kx_f = fold_kernel_x_dim(Kx, fold_factor);
@@ -538,27 +560,30 @@ void fold_conv_wgt(T *wgt_data, T wgt_zp, int Co, int Ci, int Ky, int Kx,
   assert(wgt_fold.Ky == Ky);
   assert(wgt_fold.Kx == Kx_f);
 
-  for (int o = 0; o < Co; ++o) {
-    for (int f = 0; f < fold_factor; ++f) {
-      for (int i = 0; i < Ci_p; ++i) {
-        for (int y = 0; y < Ky; ++y) {
-          for (int x = 0; x < Kx_f; ++x) {
-            // NOTE: Here src_i or src_x may be out of bounds if we attempt
-            // to fold more pixels than exist in the weight matrix. This is
-            // when the zero-point padding will occur.
-            int dst_i = i + (f * Ci_p);
-            int src_i = i;
-            int dst_x = x;
-            int src_x = (x * fold_factor) + f;
-            int src_idx =
-                (o * Ci * Ky * Kx) + (src_i * Ky * Kx) + (y * Kx) + (src_x);
-            T val = ((src_i < Ci) && (src_x < Kx)) ? wgt_data[src_idx] : wgt_zp;
-            wgt_fold.at(o, dst_i, y, dst_x) = val;
+  for_each_block((Co + 7) / 8, [&](size_t b) {
+    for (int o = b * 8; o < std::min<int>(b * 8 + 8, Co); ++o) {
+      for (int f = 0; f < fold_factor; ++f) {
+        for (int i = 0; i < Ci_p; ++i) {
+          for (int y = 0; y < Ky; ++y) {
+            for (int x = 0; x < Kx_f; ++x) {
+              // NOTE: Here src_i or src_x may be out of bounds if we attempt
+              // to fold more pixels than exist in the weight matrix. This is
+              // when the zero-point padding will occur.
+              int dst_i = i + (f * Ci_p);
+              int src_i = i;
+              int dst_x = x;
+              int src_x = (x * fold_factor) + f;
+              int src_idx =
+                  (o * Ci * Ky * Kx) + (src_i * Ky * Kx) + (y * Kx) + (src_x);
+              T val =
+                  ((src_i < Ci) && (src_x < Kx)) ? wgt_data[src_idx] : wgt_zp;
+              wgt_fold.at(o, dst_i, y, dst_x) = val;
+            }
           }
         }
       }
     }
-  }
+  });
 }
 
 // This function will fold pixels from X dimension into
@@ -0,0 +1,51 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include <cstring>
+
+#include "ops/ops_common/lut_store.hpp"
+
+// The tables have the same names in the gelu & sigmoid headers
+namespace gelu_bf16_lut {
+#include "ops/ops_common/gelu_lut_bf16_512.h"
+}
+namespace sigmoid_bf16_lut {
+#include "ops/ops_common/sigmoid_lut_512.h"
+}
+namespace silu_bf16_lut {
+#include "ops/ops_common/silu_lut_bf16_512.h"
+}
+
+namespace ryzenai {
+namespace lut_store {
+
+template <size_t AB_SIZE, size_t CD_SIZE>
+static std::vector<uint8_t> concat_lut(const uint16_t (&lutab)[AB_SIZE],
+                                       const uint16_t (&lutcd)[CD_SIZE]) {
+  std::vector<uint8_t> lut(sizeof(lutab) + sizeof(lutcd));
+  std::memcpy(lut.data(), lutab, sizeof(lutab));
+  std::memcpy(lut.data() + sizeof(lutab), lutcd, sizeof(lutcd));
+  return lut;
+}
+
+const std::vector<uint8_t> &gelu_bf16() {
+  static const auto lut =
+      concat_lut(gelu_bf16_lut::lnr_lutab, gelu_bf16_lut::lnr_lutcd);
+  return lut;
+}
+
+const std::vector<uint8_t> &sigmoid_bf16() {
+  static const auto lut =
+      concat_lut(sigmoid_bf16_lut::lnr_lutab, sigmoid_bf16_lut::lnr_lutcd);
+  return lut;
+}
+
+const std::vector<uint8_t> &silu_bf16() {
+  static const auto lut =
+      concat_lut(silu_bf16_lut::silu_lutab, silu_bf16_lut::silu_lutcd);
+  return lut;
+}
+
+} // namespace lut_store
+} // namespace ryzenai
@@ -0,0 +1,22 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace ryzenai {
+namespace lut_store {
+
+// Linear approximation LUTs of the nonlinear kernels, as they are laid out
+// in the const buffer of an op : lutab followed by lutcd.
+// Each table is built once per process and shared read only by all the op
+// instances, which copy it into their const buffer.
+const std::vector<uint8_t> &gelu_bf16();
+const std::vector<uint8_t> &sigmoid_bf16();
+const std::vector<uint8_t> &silu_bf16();
+
+} // namespace lut_store
+} // namespace ryzenai
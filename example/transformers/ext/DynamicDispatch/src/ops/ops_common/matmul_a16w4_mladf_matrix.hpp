@@ -0,0 +1,114 @@
+#pragma once
+
+#include <assert.h>
+#include <cmath>
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+
+#include "ops/ops_common/matmul_a16w8_mladf_matrix.hpp"
+
+// Weight formatting of the a16w4 gemm: the subvolume tiling of a16w8 with
+// two uint4 weights per byte, and qdq coefficients per quantization group.
+namespace matmul_a16w4_mladf_matrix {
+using matmul_a16w8_mladf_matrix::check_result;
+using matmul_a16w8_mladf_matrix::col_major_index;
+using matmul_a16w8_mladf_matrix::init_random;
+using matmul_a16w8_mladf_matrix::RowMajorMatrix;
+using matmul_a16w8_mladf_matrix::srs_to_int16;
+using matmul_a16w8_mladf_matrix::srs_to_int32;
+using matmul_a16w8_mladf_matrix::w8_index;
+
+int constexpr Msubv = matmul_a16w8_mladf_matrix::Msubv;
+int constexpr Msubv_16 = matmul_a16w8_mladf_matrix::Msubv_16;
+int constexpr Ksubv = matmul_a16w8_mladf_matrix::Ksubv;
+int constexpr Nsubv = matmul_a16w8_mladf_matrix::Nsubv;
+
+// A group never spans two K subvolumes
+inline bool is_supported_group_size(int group_size) {
+  return group_size >= 32 && group_size <= Ksubv && Ksubv % group_size == 0;
+}
+
+// Bytes of a Ksubv x Nsubv subvolume in the weight BO:
+//   packed weights | c0 (int64) x Nsubv | c1, c2 (int32) x groups x Nsubv
+inline int subv_size(int group_size) {
+  int const groups = Ksubv / group_size;
+  return (Ksubv * Nsubv / 2) + (Nsubv * sizeof(int64_t)) +
+         (2 * groups * Nsubv * sizeof(int32_t));
+}
+
+// uint4 weights in the subvolume order of a16w8, element i of a subvolume
+// is the low nibble of byte i / 2 for even i, the high one for odd i
+template <int subv_rows, int subv_cols> struct WgtMatrix {
+  int const num_rows;
+  int const num_cols;
+  uint8_t *const data;
+
+  WgtMatrix(int num_rows, int num_cols, void *data)
+      : num_rows(num_rows), num_cols(num_cols),
+        data(static_cast<uint8_t *>(data)) {
+    assert(num_rows % subv_rows == 0);
+    assert(num_cols % subv_cols == 0);
+  }
+
+  int index(int row, int col) const {
+    assert(row < num_rows);
+    assert(col < num_cols);
+    int constexpr subv_size = subv_rows * subv_cols;
+    int const r = row % subv_rows;
+    int const c = col % subv_cols;
+    int const i = w8_index(r, c, subv_rows, subv_cols);
+    int const rr = row / subv_rows;
+    int const cc = col / subv_cols;
+    int const ii =
+        col_major_index(rr, cc, (num_rows / subv_rows), (num_cols / subv_cols));
+    return i + (ii * subv_size);
+  }
+
+  void set(int row, int col, uint8_t value) {
+    assert(value <= 15);
+    int const idx = index(row, col);
+    uint8_t &byte = data[idx / 2];
+    byte = (idx % 2) ? ((byte & 0x0F) | (value << 4))
+                     : ((byte & 0xF0) | (value & 0x0F));
+  }
+
+  uint8_t get(int row, int col) const {
+    int const idx = index(row, col);
+    return (idx % 2) ? (data[idx / 2] >> 4) : (data[idx / 2] & 0x0F);
+  }
+
+  static int size(int num_rows, int num_cols) {
+    return num_rows * num_cols / 2;
+  }
+};
+
+// Y = srs(sum_g (C2[g] * srs(X_g * W_g) + C1[g] * sum(X_g)) + C0)
+// C1 and C2 are K / group_size x N row major, for the asymmetric weights of
+// a group C1[g] is -zero_point[g] * C2[g]
+template <typename Tx, typename Tw, typename Ty>
+void cpu_qdq_matmul(Tx X, Tw W, Ty Y, const std::vector<int64_t> &C0,
+                    const std::vector<int32_t> &C1,
+                    const std::vector<int32_t> &C2, int group_size,
+                    int32_t shift_gemm_out, int32_t shift_qdq_out) {
+  int const num_groups = X.num_cols / group_size;
+  for (int r = 0; r < Y.num_rows; ++r) {
+    for (int c = 0; c < Y.num_cols; ++c) {
+      int64_t out = C0[c];
+      for (int g = 0; g < num_groups; ++g) {
+        int64_t acc = 0;
+        int64_t a_sum = 0;
+        for (int k = g * group_size; k < (g + 1) * group_size; ++k) {
+          acc += X.at(r, k) * W.at(k, c);
+          a_sum += X.at(r, k);
+        }
+        acc = srs_to_int32(acc, shift_gemm_out);
+        out += int64_t(C2[g * Y.num_cols + c]) * acc +
+               int64_t(C1[g * Y.num_cols + c]) * a_sum;
+      }
+      Y.at(r, c) = srs_to_int16(out, shift_qdq_out);
+    }
+  }
+}
+
+} // namespace matmul_a16w4_mladf_matrix
@@ -316,6 +316,27 @@ struct mladfQuantMatrix {
     return data[i0].wgts.quants[i1];
   }
 
+  /*
+   * pack count int4 weights of a row, from column col on, into the
+   * formatted tensor. In the wh_w8 order the 8 weights (4 bytes) of a row
+   * in a column group are contiguous, they are packed at once
+   * @param row is row index in original tensor
+   * @param col is the first column index in original tensor, even
+   * @param src is the weights of the row from col on
+   * @param count is the number of weights, even
+   */
+  template <typename T>
+  void pack_quant_row(int row, int col, const T *src, int count) {
+    int constexpr group = 8;
+    while (count > 0) {
+      int const span = std::min(count, group - (col % group));
+      pack_v2int4_span(&quant(row, col), src, span);
+      col += span;
+      src += span;
+      count -= span;
+    }
+  }
+
   /*
    * compute the index of zeros in formatted tensor
    * @param row is row index in original tensor
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <any>
+#include <map>
+#include <string>
+#include <vector>
+
+// Input dequantize / output quantize of the *_qdq ops, which
+// fold_qdq_pairs_pass() drops when the adjacent op undoes them.
+namespace ryzenai {
+namespace qdq_fold {
+
+// attr set by the pass, {input dq folded, output q folded}
+static constexpr const char *attr_name = "folded_qdq";
+
+struct Folded {
+  bool input_dq = false;
+  bool output_q = false;
+};
+
+inline Folded get_folded(const std::map<std::string, std::any> &attr) {
+  Folded folded;
+  auto iter = attr.find(attr_name);
+  if (iter != attr.end()) {
+    const auto &flags = std::any_cast<const std::vector<int> &>(iter->second);
+    folded.input_dq = flags.at(0) != 0;
+    folded.output_q = flags.at(1) != 0;
+  }
+  return folded;
+}
+
+inline void set_folded(std::map<std::string, std::any> &attr,
+                       const Folded &folded) {
+  attr[attr_name] =
+      std::vector<int>{int(folded.input_dq), int(folded.output_q)};
+}
+
+// Clears the enable flags of the folded steps in the qdq params of an op,
+// the tensor between the two ops is then kept in bfloat16
+template <typename T>
+void clear_folded_flags(T *qdq_params, const Folded &folded,
+                        size_t input_dq_idx, size_t output_q_idx) {
+  if (folded.input_dq) {
+    qdq_params[input_dq_idx] = 0;
+  }
+  if (folded.output_q) {
+    qdq_params[output_q_idx] = 0;
+  }
+}
+
+} // namespace qdq_fold
+} // namespace ryzenai
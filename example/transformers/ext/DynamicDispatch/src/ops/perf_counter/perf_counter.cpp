@@ -0,0 +1,167 @@
+#include <any>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include <ops/op_interface.hpp>
+#include <ops/perf_counter/perf_counter.hpp>
+#include <utils/ipu_hw_config.hpp>
+#include <utils/tfuncs.hpp>
+
+#include <ps/op_types.h>
+#include <xaiengine.h>
+
+namespace ryzenai {
+
+// Performance_Counter0 of the core/shim PL module, counters are 4 bytes apart
+static constexpr uint32_t CORE_PERF_COUNTER0_REG = 0x00031520;
+static constexpr uint32_t SHIM_PERF_COUNTER0_REG = 0x00031020;
+// Stall group events counted by FAL XAieStallCycles/XAieStallOccurrences
+static constexpr uint32_t CORE_STALL_GROUP_EVENTS = 0x19F;
+
+static uint64_t get_regoff(uint8_t col, uint8_t row, uint32_t reg) {
+  return (uint64_t(col) << XAIE_COL_SHIFT) | (uint64_t(row) << XAIE_ROW_SHIFT) |
+         reg;
+}
+
+static const char *get_core_counter_name(uint8_t counter) {
+  switch (static_cast<perf_counter::core_counter_type>(counter)) {
+  case perf_counter::core_counter_type::ACTIVE_CYCLES:
+    return "active_cycles";
+  case perf_counter::core_counter_type::STALL_CYCLES:
+    return "stall_cycles";
+  case perf_counter::core_counter_type::STALL_OCCURRENCES:
+    return "stall_occurrences";
+  }
+  DOD_THROW(OpsFusion::dod_format("Invalid core perf counter : {}", counter));
+}
+
+static const char *get_shim_counter_name(uint8_t counter) {
+  switch (static_cast<perf_counter::shim_counter_type>(counter)) {
+  case perf_counter::shim_counter_type::MM2S_ACTIVE_CYCLES:
+    return "mm2s_active_cycles";
+  case perf_counter::shim_counter_type::S2MM_ACTIVE_CYCLES:
+    return "s2mm_active_cycles";
+  }
+  DOD_THROW(OpsFusion::dod_format("Invalid shim perf counter : {}", counter));
+}
+
+std::vector<perf_counter::counter_reg_t> perf_counter::get_dumped_counters() {
+  std::vector<counter_reg_t> counters;
+  for (uint8_t col = 0; col < XAIE_NUM_COLS; col++) {
+    for (uint8_t row = XAIE_AIE_TILE_ROW_START;
+         row < XAIE_AIE_TILE_ROW_START + XAIE_AIE_TILE_NUM_ROWS; row++) {
+      for (uint8_t counter = 0; counter < NUM_CORE_COUNTERS; counter++) {
+        counters.push_back(
+            {col, row, get_core_counter_name(counter),
+             get_regoff(col, row,
+                        CORE_PERF_COUNTER0_REG + counter * sizeof(uint32_t))});
+      }
+    }
+  }
+  for (uint8_t col = 0; col < XAIE_NUM_COLS; col++) {
+    for (uint8_t counter = 0; counter < NUM_SHIM_COUNTERS; counter++) {
+      counters.push_back(
+          {col, XAIE_SHIM_ROW, get_shim_counter_name(counter),
+           get_regoff(col, XAIE_SHIM_ROW,
+                      SHIM_PERF_COUNTER0_REG + counter * sizeof(uint32_t))});
+    }
+  }
+  return counters;
+}
+
+perf_counter::perf_counter(bool start) : start_(start) {}
+
+static void start_core_counters(XAie_DevInst *DevInst, XAie_LocType loc) {
+  XAie_EventGroupControl(DevInst, loc, XAIE_CORE_MOD,
+                         XAIE_EVENT_GROUP_CORE_STALL_CORE,
+                         CORE_STALL_GROUP_EVENTS);
+  XAie_PerfCounterControlSet(
+      DevInst, loc, XAIE_CORE_MOD,
+      static_cast<uint8_t>(perf_counter::core_counter_type::ACTIVE_CYCLES),
+      XAIE_EVENT_ACTIVE_CORE, XAIE_EVENT_DISABLED_CORE);
+  XAie_PerfCounterControlSet(
+      DevInst, loc, XAIE_CORE_MOD,
+      static_cast<uint8_t>(perf_counter::core_counter_type::STALL_CYCLES),
+      XAIE_EVENT_GROUP_CORE_STALL_CORE,
+      XAIE_EVENT_GROUP_CORE_PROGRAM_FLOW_CORE);
+  XAie_PerfCounterControlSet(
+      DevInst, loc, XAIE_CORE_MOD,
+      static_cast<uint8_t>(perf_counter::core_counter_type::STALL_OCCURRENCES),
+      XAIE_EVENT_GROUP_CORE_STALL_CORE, XAIE_EVENT_GROUP_CORE_STALL_CORE);
+  for (uint8_t counter = 0; counter < perf_counter::NUM_CORE_COUNTERS;
+       counter++) {
+    XAie_PerfCounterReset(DevInst, loc, XAIE_CORE_MOD, counter);
+  }
+}
+
+static void start_shim_counters(XAie_DevInst *DevInst, XAie_LocType loc) {
+  XAie_PerfCounterControlSet(
+      DevInst, loc, XAIE_PL_MOD,
+      static_cast<uint8_t>(perf_counter::shim_counter_type::MM2S_ACTIVE_CYCLES),
+      XAIE_EVENT_DMA_MM2S_0_START_TASK_PL,
+      XAIE_EVENT_DMA_MM2S_0_FINISHED_TASK_PL);
+  XAie_PerfCounterControlSet(
+      DevInst, loc, XAIE_PL_MOD,
+      static_cast<uint8_t>(perf_counter::shim_counter_type::S2MM_ACTIVE_CYCLES),
+      XAIE_EVENT_DMA_S2MM_0_START_TASK_PL,
+      XAIE_EVENT_DMA_S2MM_0_FINISHED_TASK_PL);
+  for (uint8_t counter = 0; counter < perf_counter::NUM_SHIM_COUNTERS;
+       counter++) {
+    XAie_PerfCounterReset(DevInst, loc, XAIE_PL_MOD, counter);
+  }
+}
+
+const std::vector<uint8_t>
+perf_counter::get_transaction_bin(std::vector<Tensor> &input,
+                                  std::vector<Tensor> &output,
+                                  const std::map<std::string, std::any> &attr) {
+  // Initialize AIE Driver. Hardcode for STRIX for now
+  XAie_Config ConfigPtr{
+      XAIE_DEV_GEN_AIE2P,      XAIE_BASE_ADDR,          XAIE_COL_SHIFT,
+      XAIE_ROW_SHIFT,          XAIE_NUM_ROWS,           XAIE_NUM_COLS,
+      XAIE_SHIM_ROW,           XAIE_MEM_TILE_ROW_START, XAIE_MEM_TILE_NUM_ROWS,
+      XAIE_AIE_TILE_ROW_START, XAIE_AIE_TILE_NUM_ROWS,  {0}};
+
+  XAie_InstDeclare(DevInst, &ConfigPtr);
+  XAie_CfgInitialize(&(DevInst), &ConfigPtr);
+
+  XAie_StartTransaction(&DevInst, XAIE_TRANSACTION_DISABLE_AUTO_FLUSH);
+
+  if (start_) {
+    for (uint8_t col = 0; col < XAIE_NUM_COLS; col++) {
+      for (uint8_t row = XAIE_AIE_TILE_ROW_START;
+           row < XAIE_AIE_TILE_ROW_START + XAIE_AIE_TILE_NUM_ROWS; row++) {
+        start_core_counters(&DevInst, XAie_TileLoc(col, row));
+      }
+      start_shim_counters(&DevInst, XAie_TileLoc(col, XAIE_SHIM_ROW));
+    }
+  } else {
+    // read_register_op_t : count followed by the register addresses
+    auto counters = get_dumped_counters();
+    std::vector<uint8_t> read_op(offsetof(read_register_op_t, data) +
+                                 counters.size() * sizeof(register_data_t));
+    auto *op = reinterpret_cast<read_register_op_t *>(read_op.data());
+    op->count = static_cast<uint32_t>(counters.size());
+    for (size_t i = 0; i < counters.size(); i++) {
+      op->data[i].address = counters[i].regoff;
+    }
+    XAie_AddCustomTxnOp(&DevInst, XAIE_IO_CUSTOM_OP_READ_REGS, read_op.data(),
+                        read_op.size());
+  }
+
+  uint8_t *txn_ptr = XAie_ExportSerializedTransaction(&DevInst, 0, 0);
+  XAie_TxnHeader *Hdr = (XAie_TxnHeader *)txn_ptr;
+  auto size = Hdr->TxnSize;
+
+  std::vector<uint8_t> txn(size, 0);
+  memcpy((void *)txn.data(), (void *)txn_ptr, size);
+
+  // check if there is an API to free txn pointer
+  free(txn_ptr);
+  XAie_Finish(&DevInst);
+
+  return txn;
+}
+
+} // namespace ryzenai
@@ -1,5 +1,8 @@
 #include <any>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <tuple>
 #include <vector>
 
 #include <ops/op_interface.hpp>
@@ -74,16 +77,41 @@ pm_load::get_op_xclbin_meta(const std::string &op_name,
   return op_xclbin_meta_.at(op);
 }
 
-void pm_load::execute(std::string op_name, std::string dtype) {
+// PM images are read once per process, the PM_LOAD ops of all the graphs
+// share them
+static const std::vector<uint8_t> &read_pm_image(const std::string &pm_file) {
+  static std::mutex mutex;
+  static std::map<std::string, std::vector<uint8_t>> images;
+  std::lock_guard<std::mutex> guard(mutex);
+  auto iter = images.find(pm_file);
+  if (iter == images.end()) {
+    iter = images.emplace(pm_file, OpsFusion::read_bin_file<uint8_t>(pm_file))
+               .first;
+    RYZENAI_LOG_TRACE(OpsFusion::dod_format("Read PM image {}, size {}",
+                                            pm_file, iter->second.size()));
+  }
+  return iter->second;
+}
 
-  auto xclbin_meta = get_op_xclbin_meta(op_name, dtype);
-  std::string pm_file_name = xclbin_meta.pm_elf_fname;
-  std::string pm_file = OpInterface::get_dod_base_dir() +
-                        "\\xclbin\\stx\\aie_elf_ctrl_pkt\\" + pm_file_name;
+// BOs of the PM loads run by execute(), per hw context and op
+struct PmLoadBos {
+  xrt::bo pm_bo;
+  xrt::bo instr_bo;
+};
 
-  std::vector<uint8_t> pm_bin = OpsFusion::read_bin_file<uint8_t>(pm_file);
-  std::cout << "pm_bin_file_size  " << pm_bin.size() << std::endl;
+static std::mutex pm_load_bos_mutex;
+static std::map<std::tuple<const void *, std::string, std::string>, PmLoadBos>
+    pm_load_bos;
 
+void pm_load::preload(const std::string &op_name, const std::string &dtype) {
+  std::lock_guard<std::mutex> guard(pm_load_bos_mutex);
+  auto key = std::make_tuple(static_cast<const void *>(xrt_ctx_.get()),
+                             op_name, dtype);
+  if (pm_load_bos.count(key)) {
+    return;
+  }
+
+  const auto &pm_bin = get_pm_bin(op_name, dtype);
   auto pm_bo =
       xrt::bo(xrt_ctx_->get_device(), pm_bin.size(), XRT_BO_FLAGS_HOST_ONLY,
               xrt_ctx_->get_kernel().group_id(0));
@@ -99,16 +127,28 @@ void pm_load::execute(std::string op_name, std::string dtype) {
   aiectrl::op_buf instr_buf;
   instr_buf.addOP(aiectrl::transaction_op(txn_bin.data()));
   size_t instr_bo_size = instr_buf.ibuf_.size();
-  auto instr_bo_ =
+  auto instr_bo =
       xrt::bo(xrt_ctx_->get_context(), instr_bo_size, xrt::bo::flags::cacheable,
               xrt_ctx_->get_kernel().group_id(1));
-  instr_bo_.write(instr_buf.ibuf_.data());
-  instr_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  instr_bo.write(instr_buf.ibuf_.data());
+  instr_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+
+  pm_load_bos.emplace(key, PmLoadBos{std::move(pm_bo), std::move(instr_bo)});
+}
+
+void pm_load::execute(std::string op_name, std::string dtype) {
+  preload(op_name, dtype);
+  PmLoadBos bos;
+  {
+    std::lock_guard<std::mutex> guard(pm_load_bos_mutex);
+    bos = pm_load_bos.at(std::make_tuple(
+        static_cast<const void *>(xrt_ctx_.get()), op_name, dtype));
+  }
 
   // Execute kernel to load PM Bin
   auto kernel = xrt_ctx_->get_kernel();
-  auto run = kernel(2, instr_bo_, instr_bo_.size() / sizeof(int),
-                    pm_bo.address() + DDR_AIE_ADDR_OFFSET, 0, 0, 0, 0);
+  auto run = kernel(2, bos.instr_bo, bos.instr_bo.size() / sizeof(int),
+                    bos.pm_bo.address() + DDR_AIE_ADDR_OFFSET, 0, 0, 0, 0);
 
   run.wait2();
 }
@@ -136,7 +176,7 @@ pm_load::get_transaction_bin(std::vector<Tensor> &input,
   auto xclbin_meta = get_op_xclbin_meta(op_type, op_dtype);
   auto overlay_meta = get_overlay_meta(xclbin_meta.xclbin_name);
 
-  std::vector<uint8_t> pm_bin = get_pm_bin(attr);
+  const auto &pm_bin = get_pm_bin(attr);
 
   // Initialize AIE Driver. Hardcode for STRIX for now
   XAie_Config ConfigPtr{
@@ -241,7 +281,7 @@ pm_load::get_buffer_reqs(std::vector<Tensor> &input,
                          std::vector<Tensor> &output,
                          const std::map<std::string, std::any> &attr) {
 
-  auto pm_bin = get_pm_bin(attr);
+  const auto &pm_bin = get_pm_bin(attr);
   // Load PM in super_kernel_param_input
   std::vector<OpArgMap> arg_map{
       {OpArgMap::OpArgType::CONST_KERNEL_PARAM_INPUT, 0, 0, 0, pm_bin.size()}};
@@ -256,7 +296,7 @@ pm_load::get_super_kernel_params(std::vector<Tensor> &input,
   return get_pm_bin(attr);
 }
 
-const std::vector<uint8_t>
+const std::vector<uint8_t> &
 pm_load::get_pm_bin(const std::map<std::string, std::any> &attr) {
   // find op_name
   std::string op_type;
@@ -273,15 +313,18 @@ pm_load::get_pm_bin(const std::map<std::string, std::any> &attr) {
     throw std::runtime_error("Can't find op_dtype in attrs");
   }
 
-  auto xclbin_meta = get_op_xclbin_meta(op_type, op_dtype);
-  auto overlay_meta = get_overlay_meta(xclbin_meta.xclbin_name);
+  return get_pm_bin(op_type, op_dtype);
+}
+
+const std::vector<uint8_t> &pm_load::get_pm_bin(const std::string &op_name,
+                                                const std::string &dtype) {
+  auto xclbin_meta = get_op_xclbin_meta(op_name, dtype);
 
   std::string pm_file_name = xclbin_meta.pm_elf_fname;
   std::string pm_file = OpInterface::get_dod_base_dir() +
                         "\\xclbin\\stx\\aie_elf_ctrl_pkt\\" + pm_file_name;
 
-  std::vector<uint8_t> pm_bin = OpsFusion::read_bin_file<uint8_t>(pm_file);
-  return pm_bin;
+  return read_pm_image(pm_file);
 }
 
 } // namespace ryzenai
@@ -101,6 +101,12 @@ void silu<InT, OutT>::debug(bool enable) {
   debug_ = enable;
 }
 
+template <typename InT, typename OutT>
+OpExecTimes silu<InT, OutT>::get_exec_times() const {
+  return {a_copy_time_ + c_copy_time_, a_sync_time_ + c_sync_time_,
+          run_aie_time_};
+}
+
 template <typename InT, typename OutT>
 std::string silu<InT, OutT>::get_instr_key(std::string prefix, int m, int k) {
   // NOTE the need of that first "silu_" is weird....
@@ -26,7 +26,8 @@
 #include <xrt_context/xrt_context.hpp>
 
 #include "ops/ops_common/matmul_matrix.hpp"
-#include "ops/ops_common/silu_lut_bf16_512.h"
+#include "ops/ops_common/lut_store.hpp"
+#include "ops/ops_common/qdq_fold.hpp"
 #include <ops/op_interface.hpp>
 #include <ops/silu_qdq/silu_qdq.hpp>
 #include <utils/logging.hpp>
@@ -152,11 +153,8 @@ std::vector<OpArgMap> silu_qdq<InT, WtT, OutT>::get_buffer_reqs(
   auto [M, N] = extract_MK(input);
   auto [Mo, No] = map_padded_shape(M, N);
 
-  int const silu_qdq_lut_ab_size = sizeof(silu_lutab);
-  int const silu_qdq_lut_cd_size = sizeof(silu_lutcd);
-
   size_t const_params_bo_size =
-      (silu_qdq_lut_ab_size + silu_qdq_lut_cd_size +
+      (lut_store::silu_bf16().size() +
        matmul_matrix::QDQparam_size * sizeof(int16_t));
   size_t input_bo_size = (Mo * No * sizeof(InT));
   size_t output_bo_size = (Mo * No * sizeof(OutT));
@@ -442,17 +440,16 @@ void silu_qdq<InT, WtT, OutT>::initialize_const_params(
   auto w_dest = (WtT *)dest;
   auto qdq_params_size = matmul_matrix::QDQparam_size * sizeof(int16_t);
 
-  int const silu_qdq_size_lutab = sizeof(silu_lutab);
-  int const silu_qdq_size_lutcd = sizeof(silu_lutcd);
-
-  memcpy((void *)(static_cast<int8_t *>(dest)), (void *)silu_lutab,
-         silu_qdq_size_lutab);
-  memcpy((void *)(static_cast<int8_t *>(dest) + silu_qdq_size_lutab),
-         (void *)silu_lutcd, silu_qdq_size_lutcd);
+  const auto &lut = lut_store::silu_bf16();
+  memcpy(dest, lut.data(), lut.size());
 
-  auto offset = silu_qdq_size_lutab + silu_qdq_size_lutcd;
+  auto offset = lut.size();
   memcpy((void *)(static_cast<int8_t *>(dest) + offset), (void *)qdq_params,
          qdq_params_size);
+  // [2] : quantize output, [5] : dequantize input
+  qdq_fold::clear_folded_flags(
+      reinterpret_cast<int16_t *>(static_cast<int8_t *>(dest) + offset),
+      qdq_fold::get_folded(attr), 5, 2);
 
   RYZENAI_LOG_TRACE("Silu_qdq initialize_const_params(ptr) ... DONE");
 }
@@ -467,10 +464,7 @@ void silu_qdq<InT, WtT, OutT>::initialize_const_params(
         "Silu_qdq IPU Wrapper expect to have one constant.");
   }
 
-  int const silu_qdq_lut_ab_size = sizeof(silu_lutab);
-  int const silu_qdq_lut_cd_size = sizeof(silu_lutcd);
-
-  auto lut_size = silu_qdq_lut_ab_size + silu_qdq_lut_cd_size;
+  auto lut_size = lut_store::silu_bf16().size();
 
   // Init the BO size
   kernel_x_shape_[0] = w_shape_[0];
@@ -421,6 +421,21 @@ slice<InT, OutT>::get_buffer_reqs(std::vector<Tensor> &input,
   return arg_map;
 }
 
+template <typename InT, typename OutT>
+std::vector<OpTensorView> slice<InT, OutT>::get_tensor_views(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  auto [M, K] = extract_MK(input);
+  auto [Mo, Ko, So] = map_padded_shape(M, K, slice_idx_);
+
+  // Each row is sliced, only a single unpadded row is contiguous.
+  if (M != 1 || Mo != M || Ko != K || So != (int)slice_idx_ ||
+      sizeof(InT) != sizeof(OutT)) {
+    return {};
+  }
+  return {{/*base*/ 0, /*view*/ 2, slice_idx_ * (K / 2) * sizeof(InT)}};
+}
+
 template class slice<uint16_t, uint16_t>;
 
 } // namespace ryzenai
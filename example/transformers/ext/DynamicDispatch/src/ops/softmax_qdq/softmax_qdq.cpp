@@ -26,6 +26,7 @@
 #include <xrt_context/xrt_context.hpp>
 
 #include "ops/ops_common/lrn_matrix.hpp"
+#include "ops/ops_common/qdq_fold.hpp"
 #include <ops/op_interface.hpp>
 #include <ops/softmax_qdq/softmax_qdq.hpp>
 #include <utils/logging.hpp>
@@ -348,6 +349,9 @@ void softmax_qdq<InT, WtT, OutT>::initialize_const_params(
 
   memcpy((void *)(reinterpret_cast<int8_t *>(dest)), (void *)qdq_param,
          size_qdqparam);
+  // [2] : quantize output, [5] : dequantize input
+  qdq_fold::clear_folded_flags(static_cast<int32_t *>(dest),
+                               qdq_fold::get_folded(attr), 5, 2);
 
   RYZENAI_LOG_TRACE("mhapsr initialize_const_params(ptr) ... DONE");
 }
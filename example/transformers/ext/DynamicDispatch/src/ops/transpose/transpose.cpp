@@ -417,6 +417,20 @@ std::vector<OpArgMap> transpose<InT, WtT, OutT>::get_buffer_reqs(
   return arg_map;
 }
 
+template <typename InT, typename WtT, typename OutT>
+std::vector<OpTensorView> transpose<InT, WtT, OutT>::get_tensor_views(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  auto [H, M, K] = extract_HMK<size_t>(input);
+
+  // [P, Q, R, S] -> [P, R, Q, S] with P = R = sqrt(M) / 7, Q = 7 is a copy
+  // for a single 7x7 window.
+  if (H != 1 || M != 49 || sizeof(InT) != sizeof(OutT)) {
+    return {};
+  }
+  return {{/*base*/ 0, /*view*/ 2, 0}};
+}
+
 template class transpose<uint16_t, int8_t, uint16_t>;
 
 } // namespace ryzenai
@@ -45,6 +45,38 @@ uint64_t conv2d<InT, WtT, BiasT, OutT, DWC>::count_ = 0;
 template <typename InT, typename WtT, typename BiasT, typename OutT, bool DWC>
 std::once_flag conv2d<InT, WtT, BiasT, OutT, DWC>::instr_reg_flag_;
 
+// Program the activation into the prelu epilogue of the qdq kernel, i.e.
+// y = x > 0 ? x : x * prelu_in / 2^prelu_shift. Relu is a prelu with alpha 0.
+// The epilogue layout (C3 coefficients instead of C1/C2) is fixed when the
+// kernel is compiled, so the shape's params need to have is_prelu set.
+static void set_activation_params(WGTShuffleParam &param,
+                                  const std::string &activation,
+                                  const std::map<std::string, std::any> &attr) {
+  if (activation.empty()) {
+    return;
+  }
+  DOD_THROW_IF(!param.is_prelu,
+               OpsFusion::dod_format("XCOM::CONV2D: kernel for this shape has "
+                                     "no prelu epilogue for {}",
+                                     activation));
+
+  // LeakyRelu default alpha as per onnx spec
+  float alpha = 0.01f;
+  if (activation == "Relu") {
+    alpha = 0.0f;
+  } else if (attr.count("alpha")) {
+    alpha = std::any_cast<const std::vector<float> &>(attr.at("alpha")).at(0);
+  }
+
+  constexpr std::int32_t PRELU_SHIFT = 14;
+  DOD_THROW_IF(std::abs(alpha) > 1.0f,
+               OpsFusion::dod_format(
+                   "XCOM::CONV2D: LeakyRelu alpha {} out of range", alpha));
+  param.prelu_shift = PRELU_SHIFT;
+  param.prelu_in =
+      static_cast<std::int32_t>(std::round(alpha * (1 << PRELU_SHIFT)));
+}
+
 template <typename InT, typename WtT, typename BiasT, typename OutT, bool DWC>
 std::string conv2d<InT, WtT, BiasT, OutT, DWC>::get_instr_key(
     const std::string &prefix, const conv_shape_t &shape_info) const {
@@ -85,7 +117,8 @@ conv2d<InT, WtT, BiasT, OutT, DWC>::conv2d(const std::string &a_dtype,
                                            const std::string &b_dtype,
                                            const std::string &bias_dtype,
                                            const std::string &c_dtype,
-                                           bool load_xrt) {
+                                           bool load_xrt,
+                                           const std::string &activation) {
 
   // TO DO: expand based on supported types
   const std::map<std::string, std::string> txnbin_a_header = {
@@ -100,6 +133,12 @@ conv2d<InT, WtT, BiasT, OutT, DWC>::conv2d(const std::string &a_dtype,
   bias_dtype_ = bias_dtype;
   c_dtype_ = c_dtype;
 
+  DOD_THROW_IF(activation != "" && activation != "Relu" &&
+                   activation != "LeakyRelu",
+               OpsFusion::dod_format(
+                   "XCOM::CONV2D: unsupported activation {}", activation));
+  activation_ = activation;
+
   a_dtype_size_ = sizeof(InT);
   b_dtype_size_ = sizeof(WtT);
   bias_dtype_size_ = sizeof(BiasT);
@@ -505,6 +544,7 @@ void conv2d<InT, WtT, BiasT, OutT, DWC>::initialize_const_params(
     param.x_s = 1.0f / conv_qdq_params_p->act_scale;
     param.y_s = 1.0f / conv_qdq_params_p->out_scale;
     param.w_s = 1.0f / conv_qdq_params_p->weight_scale;
+    set_activation_params(param, activation_, attr);
 
     const Tensor &weight_tensor = const_params.at(WEIGHT_INDEX);
     const Tensor &bias_tensor = const_params.at(BIAS_INDEX);
@@ -932,6 +972,7 @@ std::vector<OpArgMap> conv2d<InT, WtT, BiasT, OutT, DWC>::get_buffer_reqs(
 
     WGTShuffleParam param;
     memcpy(&param, weight_shuffle_bvec.data(), sizeof(WGTShuffleParam));
+    set_activation_params(param, activation_, attr);
 
     constexpr std::uint32_t WEIGHT_INDEX = 3;
     constexpr std::uint32_t BIAS_INDEX = 6;
@@ -0,0 +1,236 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+#include <algorithm>
+#include <any>
+#include <map>
+#include <vector>
+
+#include <ops/op_interface.hpp>
+#include <ops/xcom/conv/dwc_pw_conv.hpp>
+#include <txn/txn_utils.hpp>
+#include <txn_helper/txn_helper.hpp>
+#include <utils/logging.hpp>
+#include <utils/tfuncs.hpp>
+
+namespace ryzenai {
+
+namespace xcom {
+
+// onnx args of this op, see dwc_pw_conv.hpp
+static constexpr size_t NUM_ARGS = 20;
+static constexpr size_t DWC_LAST_ARG_INDEX = 10;
+static constexpr size_t MID_SCALE_INDEX = 9;
+static constexpr size_t MID_ZP_INDEX = 10;
+static constexpr size_t PW_FIRST_ARG_INDEX = 11;
+static constexpr size_t PW_LAST_ARG_INDEX = 18;
+static constexpr size_t OUT_INDEX = 19;
+
+// xrt args of the conv2d txns, see conv2d::get_buffer_reqs()
+static constexpr uint32_t INPUT_XRT_ARG_IDX = 0;
+static constexpr uint32_t PARAM_XRT_ARG_IDX = 1;
+static constexpr uint32_t OUTPUT_XRT_ARG_IDX = 2;
+static constexpr uint32_t SCRATCH_XRT_ARG_IDX = 3;
+
+template <typename InT, typename WtT, typename BiasT, typename OutT>
+dwc_pw_conv2d<InT, WtT, BiasT, OutT>::dwc_pw_conv2d(
+    const std::string &a_dtype, const std::string &b_dtype,
+    const std::string &bias_dtype, const std::string &c_dtype, bool load_xrt)
+    : c_dtype_(c_dtype) {
+  // the depthwise output is the pointwise input, so both use the output dtype
+  dwc_ = std::make_unique<conv2d<InT, WtT, BiasT, OutT, true>>(
+      a_dtype, b_dtype, bias_dtype, c_dtype, load_xrt);
+  pw_ = std::make_unique<conv2d<InT, WtT, BiasT, OutT, false>>(
+      c_dtype, b_dtype, bias_dtype, c_dtype, load_xrt);
+}
+
+template <typename InT, typename WtT, typename BiasT, typename OutT>
+std::map<std::string, std::any>
+dwc_pw_conv2d<InT, WtT, BiasT, OutT>::get_dwc_attr(
+    const std::map<std::string, std::any> &attr) const {
+  std::map<std::string, std::any> dwc_attr;
+  dwc_attr["input_shape"] = MAP_AT(attr, "input_shape");
+  dwc_attr["output_shape"] = MAP_AT(attr, "dwc_output_shape");
+  dwc_attr["kernel_shape"] = MAP_AT(attr, "kernel_shape");
+  dwc_attr["strides"] = MAP_AT(attr, "strides");
+  return dwc_attr;
+}
+
+template <typename InT, typename WtT, typename BiasT, typename OutT>
+std::map<std::string, std::any>
+dwc_pw_conv2d<InT, WtT, BiasT, OutT>::get_pw_attr(
+    const std::map<std::string, std::any> &attr) const {
+  std::map<std::string, std::any> pw_attr;
+  pw_attr["input_shape"] = MAP_AT(attr, "dwc_output_shape");
+  pw_attr["output_shape"] = MAP_AT(attr, "output_shape");
+  pw_attr["kernel_shape"] = std::vector<int>{1, 1};
+  pw_attr["strides"] = std::vector<int>{1, 1};
+  return pw_attr;
+}
+
+template <typename InT, typename WtT, typename BiasT, typename OutT>
+Tensor dwc_pw_conv2d<InT, WtT, BiasT, OutT>::get_mid_tensor(
+    const std::map<std::string, std::any> &attr) const {
+  const auto &mid_shape = std::any_cast<const std::vector<int> &>(
+      MAP_AT(attr, "dwc_output_shape"));
+  return {nullptr, std::vector<size_t>(mid_shape.begin(), mid_shape.end()),
+          c_dtype_};
+}
+
+template <typename InT, typename WtT, typename BiasT, typename OutT>
+std::vector<Tensor> dwc_pw_conv2d<InT, WtT, BiasT, OutT>::get_dwc_tensors(
+    const std::vector<Tensor> &tensors, const Tensor &mid) const {
+  std::vector<Tensor> dwc_tensors(tensors.begin(),
+                                  tensors.begin() + DWC_LAST_ARG_INDEX + 1);
+  dwc_tensors.push_back(mid);
+  return dwc_tensors;
+}
+
+template <typename InT, typename WtT, typename BiasT, typename OutT>
+std::vector<Tensor> dwc_pw_conv2d<InT, WtT, BiasT, OutT>::get_pw_tensors(
+    const std::vector<Tensor> &tensors, const Tensor &mid) const {
+  std::vector<Tensor> pw_tensors = {mid, tensors.at(MID_SCALE_INDEX),
+                                    tensors.at(MID_ZP_INDEX)};
+  pw_tensors.insert(pw_tensors.end(), tensors.begin() + PW_FIRST_ARG_INDEX,
+                    tensors.begin() + PW_LAST_ARG_INDEX + 1);
+  pw_tensors.push_back(tensors.at(OUT_INDEX));
+  return pw_tensors;
+}
+
+template <typename InT, typename WtT, typename BiasT, typename OutT>
+typename dwc_pw_conv2d<InT, WtT, BiasT, OutT>::sub_op_reqs_t
+dwc_pw_conv2d<InT, WtT, BiasT, OutT>::get_sub_op_reqs(
+    OpInterface &op, std::vector<Tensor> &tensors,
+    const std::map<std::string, std::any> &attr) {
+  sub_op_reqs_t reqs{};
+  for (const auto &req : op.get_buffer_reqs(tensors, tensors, attr)) {
+    if (req.arg_type == OpArgMap::OpArgType::INPUT) {
+      reqs.input = req;
+    } else if (req.arg_type == OpArgMap::OpArgType::CONST_INPUT) {
+      reqs.const_size += req.size;
+    } else if (req.arg_type == OpArgMap::OpArgType::OUTPUT) {
+      reqs.output_size = req.size;
+    } else {
+      DOD_THROW("XCOM::DWC_PW_CONV2D: unexpected buffer req of conv2d");
+    }
+  }
+  return reqs;
+}
+
+template <typename InT, typename WtT, typename BiasT, typename OutT>
+size_t dwc_pw_conv2d<InT, WtT, BiasT, OutT>::get_mid_size(
+    const sub_op_reqs_t &dwc_reqs, const sub_op_reqs_t &pw_reqs) const {
+  return std::max(pw_reqs.input.size,
+                  pw_reqs.input.padding_offset + dwc_reqs.output_size);
+}
+
+template <typename InT, typename WtT, typename BiasT, typename OutT>
+std::vector<OpArgMap> dwc_pw_conv2d<InT, WtT, BiasT, OutT>::get_buffer_reqs(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  DOD_THROW_IF(input.size() != NUM_ARGS,
+               OpsFusion::dod_format(
+                   "XCOM::DWC_PW_CONV2D: expect {} args, got {}", NUM_ARGS,
+                   input.size()));
+  auto mid = get_mid_tensor(attr);
+  auto dwc_tensors = get_dwc_tensors(input, mid);
+  auto pw_tensors = get_pw_tensors(input, mid);
+  auto dwc_reqs = get_sub_op_reqs(*dwc_, dwc_tensors, get_dwc_attr(attr));
+  auto pw_reqs = get_sub_op_reqs(*pw_, pw_tensors, get_pw_attr(attr));
+
+  const size_t PARAM_BO_SIZE = dwc_reqs.const_size + pw_reqs.const_size;
+  const size_t SCRATCH_BO_SIZE = get_mid_size(dwc_reqs, pw_reqs);
+
+  RYZENAI_LOG_TRACE("XCOM::DWC_PW_CONV2D:get_buffer_reqs INPUT_BO_SIZE:" +
+                    std::to_string(dwc_reqs.input.size) +
+                    " PARAM_BO_SIZE:" + std::to_string(PARAM_BO_SIZE) +
+                    " SCRATCH_BO_SIZE:" + std::to_string(SCRATCH_BO_SIZE) +
+                    " OUTPUT_BO_SIZE:" + std::to_string(pw_reqs.output_size));
+
+  //[OpArgType,  xrt_arg_idx, onnx_arg_idx, offset_into_bo, size_in_bytes]
+  std::vector<OpArgMap> arg_map{
+      {OpArgMap::OpArgType::INPUT, INPUT_XRT_ARG_IDX, 0, 0,
+       dwc_reqs.input.size, dwc_reqs.input.padding_offset},
+      {OpArgMap::OpArgType::CONST_INPUT, PARAM_XRT_ARG_IDX, 3, 0,
+       PARAM_BO_SIZE},
+      {OpArgMap::OpArgType::OUTPUT, OUTPUT_XRT_ARG_IDX, OUT_INDEX, 0,
+       pw_reqs.output_size},
+      {OpArgMap::OpArgType::SCRATCH_PAD, SCRATCH_XRT_ARG_IDX, 0, 0,
+       SCRATCH_BO_SIZE}};
+  return arg_map;
+}
+
+template <typename InT, typename WtT, typename BiasT, typename OutT>
+void dwc_pw_conv2d<InT, WtT, BiasT, OutT>::initialize_const_params(
+    void *dest, const std::vector<Tensor> &const_params,
+    const std::map<std::string, std::any> &attr) {
+  RYZENAI_LOG_TRACE("DWC_PW_Conv2d initialize_const_params(ptr) ...");
+  // all args except activation and output are consts
+  DOD_THROW_IF(const_params.size() != NUM_ARGS - 2,
+               OpsFusion::dod_format(
+                   "XCOM::DWC_PW_CONV2D: expect {} consts, got {}",
+                   NUM_ARGS - 2, const_params.size()));
+  auto mid = get_mid_tensor(attr);
+  std::vector<Tensor> tensors = {mid};
+  tensors.insert(tensors.end(), const_params.begin(), const_params.end());
+  tensors.push_back(mid);
+
+  auto dwc_tensors = get_dwc_tensors(tensors, mid);
+  auto pw_tensors = get_pw_tensors(tensors, mid);
+  const auto dwc_attr = get_dwc_attr(attr);
+  const auto pw_attr = get_pw_attr(attr);
+  auto dwc_reqs = get_sub_op_reqs(*dwc_, dwc_tensors, dwc_attr);
+
+  // const buffer layout is [dwc params | pw params]
+  dwc_->initialize_const_params(
+      dest, {dwc_tensors.begin() + 1, dwc_tensors.end() - 1}, dwc_attr);
+  pw_->initialize_const_params(static_cast<uint8_t *>(dest) +
+                                   dwc_reqs.const_size,
+                               {pw_tensors.begin() + 1, pw_tensors.end() - 1},
+                               pw_attr);
+  RYZENAI_LOG_TRACE("DWC_PW_Conv2d initialize_const_params(ptr) ... DONE");
+}
+
+template <typename InT, typename WtT, typename BiasT, typename OutT>
+const std::vector<uint8_t>
+dwc_pw_conv2d<InT, WtT, BiasT, OutT>::get_transaction_bin(
+    std::vector<Tensor> &input, std::vector<Tensor> &output,
+    const std::map<std::string, std::any> &attr) {
+  auto mid = get_mid_tensor(attr);
+  auto dwc_tensors = get_dwc_tensors(input, mid);
+  auto pw_tensors = get_pw_tensors(input, mid);
+  const auto dwc_attr = get_dwc_attr(attr);
+  const auto pw_attr = get_pw_attr(attr);
+  auto dwc_reqs = get_sub_op_reqs(*dwc_, dwc_tensors, dwc_attr);
+  auto pw_reqs = get_sub_op_reqs(*pw_, pw_tensors, pw_attr);
+  const size_t mid_size = get_mid_size(dwc_reqs, pw_reqs);
+
+  // scratch pad is [padded dwc output | internal scratch of the convs]
+  // the dwc writes its output where the pw expects its data, i.e. after the
+  // padding in front of the pw input
+  const txn_arg_remap_t dwc_remap = {
+      {OUTPUT_XRT_ARG_IDX,
+       {SCRATCH_XRT_ARG_IDX, pw_reqs.input.padding_offset}},
+      {SCRATCH_XRT_ARG_IDX, {SCRATCH_XRT_ARG_IDX, mid_size}}};
+  const txn_arg_remap_t pw_remap = {
+      {INPUT_XRT_ARG_IDX, {SCRATCH_XRT_ARG_IDX, 0}},
+      {PARAM_XRT_ARG_IDX, {PARAM_XRT_ARG_IDX, dwc_reqs.const_size}},
+      {SCRATCH_XRT_ARG_IDX, {SCRATCH_XRT_ARG_IDX, mid_size}}};
+
+  auto dwc_txn = remap_txn_args(
+      dwc_->get_transaction_bin(dwc_tensors, dwc_tensors, dwc_attr),
+      dwc_remap);
+  auto pw_txn = remap_txn_args(
+      pw_->get_transaction_bin(pw_tensors, pw_tensors, pw_attr), pw_remap);
+
+  return ::utils::txn_util::fuse_txns({dwc_txn, pw_txn});
+}
+
+template class dwc_pw_conv2d<std::int8_t, std::int8_t, std::int8_t,
+                             std::int8_t>;
+template class dwc_pw_conv2d<std::uint16_t, std::uint8_t, std::int32_t,
+                             std::uint16_t>;
+
+} // namespace xcom
+
+} // namespace ryzenai
@@ -80,6 +80,30 @@ static void handle_io_tensors(const OpsFusion::Metadata::OpInfo &op_info,
   io_bufs[buf_name].second = std::max(io_bufs[buf_name].second, padding_offset);
 }
 
+// A tensor view is not allocated itself, but its base tensor has to hold it.
+// Once the op of the view is folded, the view can be the only access left to
+// its base.
+static void handle_tensor_views(const OpsFusion::Metadata &meta,
+                                std::map<std::string, IOBufferInfo> &io_bufs) {
+  for (const auto &[name, view] : meta.tensor_views) {
+    auto [base_name, offset] = MetaUtils::resolve_tensor_view(meta, name);
+    auto view_size = MAP_AT(meta.tensor_map, name).size_in_bytes;
+    auto base_size = MAP_AT(meta.tensor_map, base_name).size_in_bytes;
+    auto &base_buf =
+        io_bufs.try_emplace(base_name, base_size, 0).first->second;
+    base_buf.first = std::max(base_buf.first, offset + view_size);
+  }
+}
+
+// Graph inputs are passed by the user even if no op reads them anymore, e.g.
+// after eliminate_dead_ops_pass(). They keep their size in the model.
+static void handle_unused_inputs(const OpsFusion::Metadata &meta,
+                                 std::map<std::string, IOBufferInfo> &io_bufs) {
+  for (const auto &name : MAP_AT(meta.fused_tensors, "in").packed_tensors) {
+    io_bufs.try_emplace(name, MAP_AT(meta.tensor_map, name).size_in_bytes, 0);
+  }
+}
+
 static void
 update_io_buffers(OpsFusion::Metadata &meta,
                   const std::map<std::string, IOBufferInfo> &io_bufs) {
@@ -110,6 +134,7 @@ update_io_buffers(OpsFusion::Metadata &meta,
     }
     tensor_info.size = tensor_size;
   }
+  MetaUtils::update_tensor_views(meta);
 }
 
 static void
@@ -121,11 +146,31 @@ update_superkernel_buffers(OpsFusion::Metadata &meta,
                                    meta.op_list.size(),
                                    super_instr_bufs.size()));
   size_t tensor_size = 0;
+  // Ops with the same "super_instr_key" attr have the same super kernel
+  // params, e.g. the PM_LOADs of a PM, and share one span
+  std::map<std::string, Metadata::Span> shared_spans;
   for (size_t i = 0; i < meta.op_list.size(); ++i) {
     const auto &op_info = meta.op_list[i];
     auto op_size = super_instr_bufs[i];
+    std::string key;
+    auto key_iter = op_info.attr.find("super_instr_key");
+    if (key_iter != op_info.attr.end()) {
+      key = std::any_cast<const std::string &>(key_iter->second);
+      auto span_iter = shared_spans.find(key);
+      if (span_iter != shared_spans.end()) {
+        DOD_ASSERT(span_iter->second.size == op_size,
+                   OpsFusion::dod_format("Super kernel params of {} are not "
+                                         "the size of the ones shared as {}",
+                                         op_info.name, key));
+        meta.super_instr_map[op_info.name] = span_iter->second;
+        continue;
+      }
+    }
     meta.super_instr_map[op_info.name] = {/*offset*/ tensor_size,
                                           /*size*/ op_size};
+    if (!key.empty()) {
+      shared_spans[key] = meta.super_instr_map[op_info.name];
+    }
     tensor_size += op_size;
     tensor_size = Utils::align_to_next(tensor_size, TENSOR_PACK_ALIGNMENT);
   }
@@ -173,8 +218,25 @@ static void update_const_buffers(
     const std::vector<std::vector<std::pair<size_t, size_t>>> &const_bufs) {
   RYZENAI_LOG_TRACE("  Update Const buffer sizes and offsets");
   size_t const_tensor_size = 0;
+  // Ops with the same "const_key" attr read the same consts, e.g. the copies
+  // of batch_graph_pass(), and share one span
+  std::map<std::string, Metadata::Span> shared_spans;
   for (size_t i = 0; i < meta.op_list.size(); ++i) {
     const auto &op_info = meta.op_list[i];
+    std::string key;
+    auto key_iter = op_info.attr.find("const_key");
+    if (key_iter != op_info.attr.end() && const_bufs[i].size() == 1) {
+      key = std::any_cast<const std::string &>(key_iter->second);
+      auto span_iter = shared_spans.find(key);
+      if (span_iter != shared_spans.end()) {
+        DOD_ASSERT(span_iter->second.size == const_bufs[i].front().second,
+                   OpsFusion::dod_format("Consts of {} are not the size of "
+                                         "the ones shared as {}",
+                                         op_info.name, key));
+        meta.const_map[op_info.name] = span_iter->second;
+        continue;
+      }
+    }
     for (const auto &[xrt_arg_id, buf_size] : const_bufs[i]) {
       meta.const_map[op_info.name] = {/*offset*/ const_tensor_size,
                                       /*size*/ buf_size};
@@ -182,6 +244,9 @@ static void update_const_buffers(
       const_tensor_size =
           Utils::align_to_next(const_tensor_size, TENSOR_PACK_ALIGNMENT);
     }
+    if (!key.empty()) {
+      shared_spans[key] = meta.const_map[op_info.name];
+    }
   }
   meta.fused_tensors["const"].size = const_tensor_size;
 }
@@ -206,7 +271,7 @@ void analyze_buffer_reqs(Metadata &meta) {
     RYZENAI_LOG_TRACE(OpsFusion::dod_format(
         "    Analyze - OpName : {}, OpType : {}", op_info.name, op_info.type));
 
-    auto op = OpBuilder::create(op_info.name, op_info, meta.tensor_map);
+    auto op = OpBuilder::get_or_create(op_info, meta.tensor_map);
     auto tensors = MetaUtils::collect_op_tensors(meta, op_info);
     auto buf_reqs = DD_INVOKE_OPMETHOD(get_buffer_reqs, op.get(), op_info,
                                        tensors, tensors, op_info.attr);
@@ -247,6 +312,8 @@ void analyze_buffer_reqs(Metadata &meta) {
   meta.max_tensor_padding_sz =
       Utils::align_to_next(max_tensor_padding_sz, TENSOR_PACK_ALIGNMENT);
 
+  handle_tensor_views(meta, io_bufs);
+  handle_unused_inputs(meta, io_bufs);
   update_io_buffers(meta, io_bufs);
   update_superkernel_buffers(meta, super_instr_bufs);
   update_const_buffers(meta, const_bufs);
@@ -0,0 +1,112 @@
+#include <map>
+#include <string>
+
+#include <op_fuser/fuse_types.hpp>
+#include <ops/op_interface.hpp>
+#include <utils/tfuncs.hpp>
+
+#include "passes.hpp"
+
+/*
+Run the graph on batch_size input sets per execution, e.g. the conditional &
+unconditional passes of classifier-free guidance, instead of one execution per
+set.
+
+1. Each non const tensor gets a copy per extra set, "<name>_b<k>", packed in
+the same buffer after the original tensors. The inputs/outputs of execute()
+are then those of set 0, followed by those of set 1 etc.
+
+2. Each op is followed by its copies for the extra sets, so the copies run in
+the same PDI partition & dispatch as the op. A copy reads the same consts and
+has the same super kernel params: it shares the const & super instr spans of
+the op through the "const_key" & "super_instr_key" attrs, the weights are in
+the const BO once.
+
+3. This pass has to run before the passes rewriting ops, so that the copies
+are fused & folded like the original ops.
+*/
+
+namespace OpsFusion {
+
+static std::string batch_name(const std::string &name, size_t batch) {
+  return name + "_b" + std::to_string(batch);
+}
+
+void batch_graph_pass(Metadata &meta, size_t batch_size) {
+  if (batch_size <= 1) {
+    return;
+  }
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "Batching graph to {} input sets ... START", batch_size));
+
+  // non const tensors, they are copied per set
+  auto is_batched = [&meta](const std::string &name) {
+    auto iter = meta.tensor_map.find(name);
+    return iter != meta.tensor_map.end() &&
+           iter->second.parent_name != "const";
+  };
+
+  for (const auto &label : {"in", "out", "scratch"}) {
+    auto &packed = MAP_AT(meta.fused_tensors, label).packed_tensors;
+    const auto originals = packed;
+    for (size_t batch = 1; batch < batch_size; ++batch) {
+      for (const auto &name : originals) {
+        meta.tensor_map[batch_name(name, batch)] =
+            MAP_AT(meta.tensor_map, name);
+        packed.push_back(batch_name(name, batch));
+      }
+    }
+  }
+
+  std::map<std::string, Metadata::TensorView> views;
+  for (const auto &[name, view] : meta.tensor_views) {
+    views[name] = view;
+    for (size_t batch = 1; batch < batch_size; ++batch) {
+      meta.tensor_map[batch_name(name, batch)] = MAP_AT(meta.tensor_map, name);
+      views[batch_name(name, batch)] = {batch_name(view.base_name, batch),
+                                        view.offset};
+    }
+  }
+  meta.tensor_views = std::move(views);
+
+  for (const auto &key : {"original_inputs", "original_outputs"}) {
+    auto iter = meta.aux_info.find(key);
+    if (iter == meta.aux_info.end()) {
+      continue;
+    }
+    auto tensors =
+        std::any_cast<const std::map<std::string, Tensor> &>(iter->second);
+    const auto originals = tensors;
+    for (size_t batch = 1; batch < batch_size; ++batch) {
+      for (const auto &[name, tensor] : originals) {
+        tensors[batch_name(name, batch)] = tensor;
+      }
+    }
+    iter->second = std::move(tensors);
+  }
+
+  std::vector<Metadata::OpInfo> op_list;
+  op_list.reserve(meta.op_list.size() * batch_size);
+  for (auto &op_info : meta.op_list) {
+    op_info.attr.try_emplace("const_key", op_info.name);
+    op_info.attr.try_emplace("super_instr_key", op_info.name);
+    op_list.push_back(op_info);
+    for (size_t batch = 1; batch < batch_size; ++batch) {
+      auto copy = op_info;
+      copy.name = batch_name(op_info.name, batch);
+      for (auto &arg : copy.args) {
+        if (is_batched(arg)) {
+          arg = batch_name(arg, batch);
+        }
+      }
+      op_list.push_back(std::move(copy));
+    }
+  }
+  meta.op_list = std::move(op_list);
+
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "Batching graph to {} input sets ... END, {} ops", batch_size,
+      meta.op_list.size()));
+}
+
+} // namespace OpsFusion
@@ -64,7 +64,7 @@ private:
 
       // TODO : Accessing Op just to identify inputs/outputs is significant
       // overhead. This can be resolved by updating meta structure.
-      auto op = OpBuilder::create(op_info.name, op_info, meta_.tensor_map);
+      auto op = OpBuilder::get_or_create(op_info, meta_.tensor_map);
       auto tensors = MetaUtils::collect_op_tensors(meta_, op_info);
       auto args_map = DD_INVOKE_OPMETHOD(get_buffer_reqs, op.get(), op_info,
                                          tensors, tensors, op_info.attr);
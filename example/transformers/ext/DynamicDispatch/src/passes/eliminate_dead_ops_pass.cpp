@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <set>
+
+#include <op_fuser/fuse_types.hpp>
+#include <ops/op_builder.hpp>
+#include <utils/meta_utils.hpp>
+
+#include "passes.hpp"
+
+/*
+Remove the ops whose outputs are never consumed, e.g. branches of the
+original model whose outputs were dropped by vaip. They would still take a
+transaction, scratch memory & NPU time.
+
+1. An op is live if one of its outputs is a graph output ("out") or is the
+input of a live op. The liveness is propagated from the last op backwards.
+
+2. Ops without any output, like the control ops, are always kept.
+
+3. Scratch tensors no longer accessed by any op are dropped from "scratch",
+so analyze_buffer_reqs() doesn't allocate them. Graph inputs stay in "in",
+the user still passes them. The pass has to run before fold_view_ops_pass()
+and analyze_buffer_reqs().
+
+Ops whose inputs are all consts are reported in the trace, the ops have no
+host implementation to evaluate them at init.
+*/
+
+namespace OpsFusion {
+
+void eliminate_dead_ops_pass(Metadata &meta) {
+  RYZENAI_LOG_TRACE("Eliminate Dead Ops ... START");
+
+  const auto &out_list = MAP_AT(meta.fused_tensors, "out").packed_tensors;
+  std::set<std::string> live_tensors(out_list.begin(), out_list.end());
+
+  const size_t num_ops = meta.op_list.size();
+  std::vector<std::vector<std::string>> op_inputs(num_ops);
+  std::vector<std::vector<std::string>> op_outputs(num_ops);
+  for (size_t op_idx = 0; op_idx < num_ops; ++op_idx) {
+    const auto &op_info = meta.op_list[op_idx];
+    auto op = OpBuilder::get_or_create(op_info, meta.tensor_map);
+    auto tensors = MetaUtils::collect_op_tensors(meta, op_info);
+    auto buf_reqs = DD_INVOKE_OPMETHOD(get_buffer_reqs, op.get(), op_info,
+                                       tensors, tensors, op_info.attr);
+    for (const auto &req : buf_reqs) {
+      const auto &name = ARRAY_AT(op_info.args, req.onnx_arg_idx);
+      if (req.arg_type == OpArgMap::OpArgType::INPUT) {
+        op_inputs[op_idx].push_back(name);
+      } else if (req.arg_type == OpArgMap::OpArgType::OUTPUT) {
+        op_outputs[op_idx].push_back(name);
+      }
+    }
+    const bool const_only =
+        !op_outputs[op_idx].empty() &&
+        std::all_of(op_inputs[op_idx].begin(), op_inputs[op_idx].end(),
+                    [&meta](const std::string &name) {
+                      return MAP_AT(meta.tensor_map, name).parent_name ==
+                             "const";
+                    });
+    if (const_only) {
+      RYZENAI_LOG_TRACE(dod_format("  [WARNING] op:{}, type:{} only has "
+                                   "const inputs",
+                                   op_info.name, op_info.type));
+    }
+  }
+
+  std::vector<bool> live(num_ops, false);
+  for (size_t i = num_ops; i-- > 0;) {
+    const auto &outputs = op_outputs[i];
+    live[i] = outputs.empty() ||
+              std::any_of(outputs.begin(), outputs.end(),
+                          [&live_tensors](const std::string &name) {
+                            return live_tensors.count(name) != 0;
+                          });
+    if (live[i]) {
+      live_tensors.insert(op_inputs[i].begin(), op_inputs[i].end());
+    }
+  }
+
+  std::vector<Metadata::OpInfo> op_list;
+  std::set<std::string> used_tensors;
+  for (size_t op_idx = 0; op_idx < num_ops; ++op_idx) {
+    auto &op_info = meta.op_list[op_idx];
+    if (!live[op_idx]) {
+      RYZENAI_LOG_TRACE(dod_format("  Removed dead op:{}, type:{}",
+                                   op_info.name, op_info.type));
+      continue;
+    }
+    used_tensors.insert(op_info.args.begin(), op_info.args.end());
+    op_list.push_back(std::move(op_info));
+  }
+
+  auto &packed_tensors = MAP_AT(meta.fused_tensors, "scratch").packed_tensors;
+  packed_tensors.erase(std::remove_if(packed_tensors.begin(),
+                                      packed_tensors.end(),
+                                      [&used_tensors](const std::string &name) {
+                                        return used_tensors.count(name) == 0;
+                                      }),
+                       packed_tensors.end());
+
+  RYZENAI_LOG_TRACE(
+      dod_format("  #Ops removed : {}", num_ops - op_list.size()));
+  meta.op_list = std::move(op_list);
+
+  RYZENAI_LOG_TRACE("Eliminate Dead Ops ... END");
+}
+
+} // namespace OpsFusion
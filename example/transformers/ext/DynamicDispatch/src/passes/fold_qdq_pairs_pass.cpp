@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <set>
+
+#include <op_fuser/fuse_types.hpp>
+#include <ops/op_builder.hpp>
+#include <utils/meta_utils.hpp>
+
+#include "detail/meta_graph.hpp"
+#include "ops/ops_common/qdq_fold.hpp"
+#include "passes.hpp"
+
+/*
+Drop the output quantize of a *_qdq op & the input dequantize of the *_qdq
+ops reading its output, e.g. QSilu followed by QELWEMUL_qdq. In a QDQ model a
+tensor has a single scale & zero point, so the consumer dequantize undoes the
+producer quantize, except for its rounding.
+
+1. The enable flags of both steps are in the qdq params of the ops. The pass
+only records the folded steps in the "folded_qdq" attr of the ops, their
+initialize_const_params() clears the flags while copying the params to the
+const buffer.
+
+2. The tensor is then written & read in bfloat16, which has the size of the
+uint16 it replaces. Its dtype in the tensor_map is left as is, the ops pick
+their kernels by the dtypes of the model.
+
+3. Only a producer whose output is read by foldable inputs alone is folded,
+and not if the tensor is a graph output, read back by the user.
+
+act_act_matmul (QMatMulDynamic) has MHA style qdq coefficients without a
+dequantize step, so softmax_qdq -> act_act_matmul isn't folded.
+The pass has to run before the const buffers are initialized.
+*/
+
+namespace OpsFusion {
+
+// op type --> arg it reads in bfloat16 if its input dequantize is dropped,
+// all of them quantize their output
+static const std::map<std::string, size_t> &get_foldable_ops() {
+  static const std::map<std::string, size_t> foldable_ops = {
+      {"QMulSoftmax", 0},
+      {"QSilu", 0},
+      {"QELWEMUL_qdq", 0},
+  };
+  return foldable_ops;
+}
+
+void fold_qdq_pairs_pass(Metadata &meta) {
+  RYZENAI_LOG_TRACE("Fold QDQ Pairs ... START");
+
+  Pass::detail::MetaGraph graph(meta);
+  const auto &out_list = graph.get_output_tensors();
+  const std::set<std::string> graph_outputs(out_list.begin(), out_list.end());
+  const auto &foldable_ops = get_foldable_ops();
+
+  std::map<std::string, std::vector<size_t>> consumers;
+  for (size_t op_idx = 0; op_idx < meta.op_list.size(); ++op_idx) {
+    for (const auto &name :
+         graph.get_op_inputs(meta.op_list[op_idx].name)) {
+      consumers[name].push_back(op_idx);
+    }
+  }
+
+  auto reads_in_bf16 = [&](size_t op_idx, const std::string &tensor) {
+    const auto &op_info = meta.op_list[op_idx];
+    auto iter = foldable_ops.find(op_info.type);
+    return iter != foldable_ops.end() && op_info.args.size() > iter->second &&
+           op_info.args[iter->second] == tensor &&
+           std::count(op_info.args.begin(), op_info.args.end(), tensor) == 1;
+  };
+
+  std::vector<ryzenai::qdq_fold::Folded> folded(meta.op_list.size());
+  size_t num_folded = 0;
+  for (size_t op_idx = 0; op_idx < meta.op_list.size(); ++op_idx) {
+    const auto &producer = meta.op_list[op_idx];
+    if (!foldable_ops.count(producer.type)) {
+      continue;
+    }
+    const auto &outputs = graph.get_op_outputs(producer.name);
+    if (outputs.size() != 1 || graph_outputs.count(outputs[0]) ||
+        !consumers.count(outputs[0])) {
+      continue;
+    }
+    const auto &tensor = outputs[0];
+    const auto &readers = MAP_AT(consumers, tensor);
+    if (!std::all_of(readers.begin(), readers.end(), [&](size_t idx) {
+          return reads_in_bf16(idx, tensor);
+        })) {
+      continue;
+    }
+
+    folded[op_idx].output_q = true;
+    for (auto idx : readers) {
+      folded[idx].input_dq = true;
+    }
+    ++num_folded;
+    RYZENAI_LOG_TRACE(dod_format("  Folded Q/DQ of tensor:{}, op:{} --> {} "
+                                 "op(s)",
+                                 tensor, producer.name, readers.size()));
+  }
+
+  for (size_t op_idx = 0; op_idx < meta.op_list.size(); ++op_idx) {
+    if (folded[op_idx].input_dq || folded[op_idx].output_q) {
+      ryzenai::qdq_fold::set_folded(meta.op_list[op_idx].attr,
+                                    folded[op_idx]);
+    }
+  }
+
+  RYZENAI_LOG_TRACE(dod_format("  #Q/DQ pairs folded : {}", num_folded));
+  RYZENAI_LOG_TRACE("Fold QDQ Pairs ... END");
+}
+
+} // namespace OpsFusion
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <set>
+
+#include <op_fuser/fuse_types.hpp>
+#include <ops/op_builder.hpp>
+#include <utils/meta_utils.hpp>
+
+#include "passes.hpp"
+
+/*
+Remove the ops which only reshuffle the layout of their data, like a slice of
+a single row or a concat of single rows, when this reshuffle is just placing
+tensors next to each other. Such an op reports its inputs/outputs as views
+into one another through op->get_tensor_views(). The views are recorded in
+meta.tensor_views & the op is dropped, so the producers & consumers of the
+views directly access the base tensor at the view's offset.
+
+1. This pass has to run before analyze_buffer_reqs(), which places the base
+tensors & then the views at the offsets of their base.
+
+2. Only intermediate tensors, i.e. tensors in scratch, can become views. The
+"in" & "out" tensors are copied by the user, and consts are packed per op.
+
+3. An op is folded only if every other op accessing the view tensors asks for
+exactly their size in the model, without padding. Otherwise the op would
+access the bytes of the base next to its view.
+*/
+
+namespace OpsFusion {
+
+struct TensorAccess {
+  size_t op_idx;
+  OpArgMap req;
+};
+
+using TensorAccessMap = std::map<std::string, std::vector<TensorAccess>>;
+
+static bool can_fold(const Metadata &meta, size_t op_idx,
+                     const std::vector<OpTensorView> &views,
+                     const std::set<std::string> &scratch_tensors,
+                     const TensorAccessMap &accesses) {
+  const auto &op_info = meta.op_list.at(op_idx);
+  for (const auto &view : views) {
+    const auto &base_name = ARRAY_AT(op_info.args, view.base_arg_idx);
+    const auto &view_name = ARRAY_AT(op_info.args, view.view_arg_idx);
+
+    if (scratch_tensors.find(view_name) == scratch_tensors.end() ||
+        meta.tensor_views.find(view_name) != meta.tensor_views.end() ||
+        MetaUtils::resolve_tensor_view(meta, base_name).first == view_name ||
+        MAP_AT(meta.tensor_map, base_name).parent_name == "const") {
+      return false;
+    }
+
+    const auto view_size = MAP_AT(meta.tensor_map, view_name).size_in_bytes;
+    const auto base_size = MAP_AT(meta.tensor_map, base_name).size_in_bytes;
+    if (view.offset + view_size > base_size) {
+      return false;
+    }
+
+    auto iter = accesses.find(view_name);
+    if (iter == accesses.end()) {
+      continue;
+    }
+    for (const auto &access : iter->second) {
+      if (access.op_idx != op_idx &&
+          (access.req.size != view_size || access.req.padding_offset != 0)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void fold_view_ops_pass(Metadata &meta) {
+  RYZENAI_LOG_TRACE("Folding View Ops ... START");
+
+  const auto &scratch_list =
+      MAP_AT(meta.fused_tensors, "scratch").packed_tensors;
+  std::set<std::string> scratch_tensors(scratch_list.begin(),
+                                        scratch_list.end());
+
+  TensorAccessMap accesses;
+  std::vector<std::vector<OpTensorView>> op_views;
+  op_views.reserve(meta.op_list.size());
+  for (size_t op_idx = 0; op_idx < meta.op_list.size(); ++op_idx) {
+    const auto &op_info = meta.op_list[op_idx];
+    auto op = OpBuilder::get_or_create(op_info, meta.tensor_map);
+    auto tensors = MetaUtils::collect_op_tensors(meta, op_info);
+    auto buf_reqs = DD_INVOKE_OPMETHOD(get_buffer_reqs, op.get(), op_info,
+                                       tensors, tensors, op_info.attr);
+    for (const auto &req : buf_reqs) {
+      if (req.arg_type == OpArgMap::OpArgType::INPUT ||
+          req.arg_type == OpArgMap::OpArgType::OUTPUT) {
+        accesses[ARRAY_AT(op_info.args, req.onnx_arg_idx)].push_back(
+            {op_idx, req});
+      }
+    }
+    op_views.push_back(DD_INVOKE_OPMETHOD(get_tensor_views, op.get(), op_info,
+                                          tensors, tensors, op_info.attr));
+  }
+
+  std::vector<Metadata::OpInfo> op_list;
+  std::set<std::string> view_tensors;
+  for (size_t op_idx = 0; op_idx < meta.op_list.size(); ++op_idx) {
+    auto &op_info = meta.op_list[op_idx];
+    const auto &views = op_views[op_idx];
+    if (views.empty() ||
+        !can_fold(meta, op_idx, views, scratch_tensors, accesses)) {
+      op_list.push_back(std::move(op_info));
+      continue;
+    }
+
+    for (const auto &view : views) {
+      const auto &base_name = ARRAY_AT(op_info.args, view.base_arg_idx);
+      const auto &view_name = ARRAY_AT(op_info.args, view.view_arg_idx);
+      meta.tensor_views[view_name] = {base_name, view.offset};
+      view_tensors.insert(view_name);
+      RYZENAI_LOG_TRACE(dod_format("  tensor:{} --> view of {} at offset {}",
+                                   view_name, base_name, view.offset));
+    }
+    RYZENAI_LOG_TRACE(dod_format("  Folded op:{}, type:{}", op_info.name,
+                                 op_info.type));
+  }
+
+  auto &packed_tensors = MAP_AT(meta.fused_tensors, "scratch").packed_tensors;
+  packed_tensors.erase(std::remove_if(packed_tensors.begin(),
+                                      packed_tensors.end(),
+                                      [&view_tensors](const std::string &name) {
+                                        return view_tensors.count(name) != 0;
+                                      }),
+                       packed_tensors.end());
+
+  RYZENAI_LOG_TRACE(dod_format("  #Ops folded : {}",
+                               meta.op_list.size() - op_list.size()));
+  meta.op_list = std::move(op_list);
+
+  RYZENAI_LOG_TRACE("Folding View Ops ... END");
+}
+
+} // namespace OpsFusion
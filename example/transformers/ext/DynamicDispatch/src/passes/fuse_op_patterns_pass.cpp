@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <functional>
+#include <set>
+
+#include <op_fuser/fuse_types.hpp>
+#include <ops/op_builder.hpp>
+#include <utils/meta_utils.hpp>
+
+#include "detail/meta_graph.hpp"
+#include "passes.hpp"
+
+/*
+Rewrite op sequences into the fused ops of DD, so the fused kernels are used
+even if the frontend didn't select them by name.
+
+1. A pattern is a producer op followed by a consumer op, whose only activation
+input is the single output of the producer. Both ops have to be on the same
+PDI & have the same "design_param", if any.
+
+2. The fused op takes the place of the producer. The other inputs of the
+consumer are consts, so they are available there too.
+
+3. If the intermediate tensor is also a graph output or read by another op, it
+is passed to the fused op as its optional sum output. Otherwise it is dropped
+from "scratch".
+
+4. The fused op is created & its buffer reqs are queried before the rewrite,
+dtypes or shapes it doesn't support leave the ops as they are.
+
+MatMul based patterns (MatMul->Add->GELU etc.) aren't matched, the fused
+matmuls expect the bias folded into the const qdq params at export.
+The pass has to run before fold_view_ops_pass() and analyze_buffer_reqs().
+*/
+
+namespace OpsFusion {
+
+using OpInfo = Metadata::OpInfo;
+
+struct FusionPattern {
+  std::set<std::string> producer_types;
+  std::set<std::string> consumer_types;
+  std::string fused_type;
+  size_t num_producer_args;
+  size_t num_consumer_args;
+  // args of the fused op without the optional sum output
+  std::function<std::vector<std::string>(const OpInfo &, const OpInfo &)>
+      get_fused_args;
+};
+
+static const std::vector<FusionPattern> &get_fusion_patterns() {
+  static const std::vector<FusionPattern> patterns = {
+      // [a, b, qdq, sum] + [sum, gamma, beta, qdq, out]
+      {{"ADD", "Add", "DQAdd", "QEltWiseAdd"},
+       {"LayerNorm", "QLayerNorm"},
+       "QAddLayerNorm",
+       4,
+       5,
+       [](const OpInfo &add, const OpInfo &lrn) {
+         return std::vector<std::string>{add.args[0], add.args[1],
+                                         add.args[2], lrn.args[1],
+                                         lrn.args[2], lrn.args[3],
+                                         lrn.args[4]};
+       }},
+      // [a, b, sum] + [sum, gamma, out]
+      {{"MLADFADD"},
+       {"MLADFRMSNORM"},
+       "MLADFADDRMSNORM",
+       3,
+       3,
+       [](const OpInfo &add, const OpInfo &rms) {
+         return std::vector<std::string>{add.args[0], add.args[1], rms.args[1],
+                                         rms.args[2]};
+       }},
+  };
+  return patterns;
+}
+
+static const std::vector<std::string> *
+get_design_param(const OpInfo &op_info) {
+  auto iter = op_info.attr.find("design_param");
+  if (iter == op_info.attr.end()) {
+    return nullptr;
+  }
+  return std::any_cast<std::vector<std::string>>(&iter->second);
+}
+
+static bool have_same_design(const OpInfo &producer, const OpInfo &consumer) {
+  const auto *producer_param = get_design_param(producer);
+  const auto *consumer_param = get_design_param(consumer);
+  if (!producer_param || !consumer_param) {
+    return producer_param == consumer_param;
+  }
+  return *producer_param == *consumer_param;
+}
+
+static bool is_supported(const Metadata &meta, const OpInfo &op_info) {
+  try {
+    auto op = OpBuilder::create(op_info.name, op_info, meta.tensor_map);
+    auto tensors = MetaUtils::collect_op_tensors(meta, op_info);
+    op->get_buffer_reqs(tensors, tensors, op_info.attr);
+  } catch (const std::exception &e) {
+    RYZENAI_LOG_TRACE(dod_format("  Skipped {} : {}", op_info.name, e.what()));
+    return false;
+  }
+  return true;
+}
+
+void fuse_op_patterns_pass(Metadata &meta) {
+  RYZENAI_LOG_TRACE("Fuse Op Patterns ... START");
+
+  Pass::detail::MetaGraph graph(meta);
+  const auto &out_list = graph.get_output_tensors();
+  const std::set<std::string> graph_outputs(out_list.begin(), out_list.end());
+
+  std::map<std::string, std::vector<size_t>> consumers;
+  for (size_t op_idx = 0; op_idx < meta.op_list.size(); ++op_idx) {
+    for (const auto &name :
+         graph.get_op_inputs(meta.op_list[op_idx].name)) {
+      consumers[name].push_back(op_idx);
+    }
+  }
+
+  const size_t num_ops = meta.op_list.size();
+  std::vector<bool> fused(num_ops, false);
+  std::set<std::string> dropped_tensors;
+  std::vector<OpInfo> op_list;
+  for (size_t op_idx = 0; op_idx < num_ops; ++op_idx) {
+    if (fused[op_idx]) {
+      continue;
+    }
+    auto &producer = meta.op_list[op_idx];
+    const auto &producer_outputs = graph.get_op_outputs(producer.name);
+    if (producer_outputs.size() != 1 || !consumers.count(producer_outputs[0])) {
+      op_list.push_back(std::move(producer));
+      continue;
+    }
+    const auto &sum = producer_outputs[0];
+    const auto &sum_consumers = MAP_AT(consumers, sum);
+
+    bool is_fused = false;
+    for (const auto &pattern : get_fusion_patterns()) {
+      if (!pattern.producer_types.count(producer.type) ||
+          producer.args.size() != pattern.num_producer_args ||
+          producer.args.back() != sum) {
+        continue;
+      }
+      auto consumer_iter = std::find_if(
+          sum_consumers.begin(), sum_consumers.end(), [&](size_t idx) {
+            const auto &op_info = meta.op_list[idx];
+            return !fused[idx] && pattern.consumer_types.count(op_info.type) &&
+                   op_info.args.size() == pattern.num_consumer_args &&
+                   op_info.args[0] == sum && op_info.pdi_id == producer.pdi_id &&
+                   graph.get_op_inputs(op_info.name).size() == 1 &&
+                   have_same_design(producer, op_info);
+          });
+      if (consumer_iter == sum_consumers.end()) {
+        continue;
+      }
+      const auto &consumer = meta.op_list[*consumer_iter];
+
+      OpInfo fused_op{producer.name + "_" + consumer.name, pattern.fused_type,
+                      pattern.get_fused_args(producer, consumer),
+                      consumer.attr, producer.pdi_id};
+      fused_op.attr.insert(producer.attr.begin(), producer.attr.end());
+      const bool keep_sum =
+          sum_consumers.size() > 1 || graph_outputs.count(sum) != 0;
+      if (keep_sum) {
+        fused_op.args.push_back(sum);
+      }
+      if (!is_supported(meta, fused_op)) {
+        continue;
+      }
+
+      RYZENAI_LOG_TRACE(dod_format("  Fused op:{}, type:{} & op:{}, type:{} "
+                                   "into {}",
+                                   producer.name, producer.type, consumer.name,
+                                   consumer.type, pattern.fused_type));
+      if (!keep_sum) {
+        dropped_tensors.insert(sum);
+      }
+      fused[*consumer_iter] = true;
+      op_list.push_back(std::move(fused_op));
+      is_fused = true;
+      break;
+    }
+    if (!is_fused) {
+      op_list.push_back(std::move(producer));
+    }
+  }
+
+  auto &packed_tensors = MAP_AT(meta.fused_tensors, "scratch").packed_tensors;
+  packed_tensors.erase(
+      std::remove_if(packed_tensors.begin(), packed_tensors.end(),
+                     [&dropped_tensors](const std::string &name) {
+                       return dropped_tensors.count(name) != 0;
+                     }),
+      packed_tensors.end());
+
+  RYZENAI_LOG_TRACE(
+      dod_format("  #Ops fused : {}", num_ops - op_list.size()));
+  meta.op_list = std::move(op_list);
+
+  RYZENAI_LOG_TRACE("Fuse Op Patterns ... END");
+}
+
+} // namespace OpsFusion
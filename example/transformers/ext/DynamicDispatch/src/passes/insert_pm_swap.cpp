@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <iostream>
+#include <list>
 
 #include <op_fuser/fuse_types.hpp>
 #include <ops/op_builder.hpp>
@@ -9,41 +11,82 @@
 
 namespace OpsFusion {
 
+// PM images resident on the cores, least recently used first. A PDI switch
+// reconfigures the cores, no PM survives it.
+class PmResidency {
+public:
+  explicit PmResidency(size_t num_slots) : num_slots_(num_slots) {}
+
+  // Returns true if the PM has to be loaded before the op
+  bool use(const std::string &pm_id, std::uint8_t pdi_id) {
+    if (pdi_id != pdi_id_) {
+      resident_.clear();
+      pdi_id_ = pdi_id;
+    }
+    auto iter = std::find(resident_.begin(), resident_.end(), pm_id);
+    if (iter != resident_.end()) {
+      resident_.splice(resident_.end(), resident_, iter);
+      return false;
+    }
+    if (resident_.size() >= num_slots_) {
+      resident_.pop_front();
+    }
+    resident_.push_back(pm_id);
+    return true;
+  }
+
+private:
+  size_t num_slots_;
+  int pdi_id_ = -1;
+  std::list<std::string> resident_;
+};
+
 Metadata insert_pm_swap_nodes(const Metadata &meta) {
   Metadata pm_swap_meta = meta;
   // clear op_list and rebuild the list by iterating through meta.
   pm_swap_meta.op_list.clear();
-  std::string curr_pm_id = "";
   constexpr bool load_xrt = false;
   ryzenai::pm_load pm_op(load_xrt);
+  std::unique_ptr<PmResidency> residency;
+  size_t num_pm_loads = 0;
   for (size_t i = 0; i < meta.op_list.size(); ++i) {
     const auto &op = meta.op_list.at(i);
+    if (op.type == HOST_OP_TYPE) {
+      // runs on the CPU, no PM
+      pm_swap_meta.op_list.emplace_back(op);
+      continue;
+    }
     const auto &args = op.args;
     auto &op_type = op.type;
     auto &op_dtype = meta.tensor_map.at(args[0]).dtype;
     auto &xclbin_mdata = pm_op.get_op_xclbin_meta(op_type, op_dtype);
-    if (xclbin_mdata.pm_elf_fname != curr_pm_id) {
-      RYZENAI_LOG_TRACE(
-          OpsFusion::dod_format("OP: {}, PM ID change from {} to {}", op.type,
-                                curr_pm_id, xclbin_mdata.pm_elf_fname));
-      curr_pm_id = xclbin_mdata.pm_elf_fname;
+    if (!residency) {
+      const auto &overlay_meta =
+          pm_op.get_overlay_meta(xclbin_mdata.xclbin_name);
+      residency = std::make_unique<PmResidency>(
+          std::max<size_t>(overlay_meta.num_pm_slots, 1));
+    }
+    if (residency->use(xclbin_mdata.pm_elf_fname, op.pdi_id)) {
+      RYZENAI_LOG_TRACE(OpsFusion::dod_format("OP: {}, load PM {}", op.type,
+                                              xclbin_mdata.pm_elf_fname));
 
       std::map<std::string, std::any> attr;
       attr["op_type"] = op_type;
       attr["op_dtype"] = op_dtype;
+      // all the loads of a PM read one copy of it in the super kernel BO
+      attr["super_instr_key"] = xclbin_mdata.pm_elf_fname;
       Metadata::OpInfo pm_op_info = {
           "pm_load_" + op.name, "PM_LOAD", {}, attr, op.pdi_id};
       pm_swap_meta.op_list.emplace_back(pm_op_info);
+      num_pm_loads++;
     }
-    RYZENAI_LOG_INFO(
-        OpsFusion::dod_format("OP: {}, PM ID: {}", op.type, curr_pm_id));
+    RYZENAI_LOG_INFO(OpsFusion::dod_format("OP: {}, PM ID: {}", op.type,
+                                           xclbin_mdata.pm_elf_fname));
     pm_swap_meta.op_list.emplace_back(op);
   }
 
-  std::cout << "Meta after pass" << std::endl;
-  for (auto &op_info : pm_swap_meta.op_list) {
-    std::cout << op_info.name << std::endl;
-  }
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "Inserted {} PM loads for {} ops", num_pm_loads, meta.op_list.size()));
 
   return pm_swap_meta;
 }
@@ -5,8 +5,10 @@
 
 #include <op_fuser/fuse_types.hpp>
 #include <ops/op_builder.hpp>
+#include <ops/perf_counter/perf_counter.hpp>
 #include <ops/record_timer/record_timer.hpp>
 #include <utils/meta_utils.hpp>
+#include <utils/tfuncs.hpp>
 
 #include "passes.hpp"
 
@@ -16,7 +18,8 @@ namespace OpsFusion {
 
 namespace profile_ids {
 static uint32_t timer_id = 0;
-}
+static uint32_t perf_counter_id = 0;
+} // namespace profile_ids
 
 static inline std::string shape_to_string(const std::vector<size_t> &shape) {
   std::string shape_str = "";
@@ -73,17 +76,70 @@ static json get_op_prop(const Metadata &meta, const Metadata::OpInfo &op) {
   return op_prop;
 }
 
+// The timer_* attrs describe what is timed, FusionRuntime decodes the
+// timestamps with them, see FusionRuntime::get_device_op_times()
 static void insert_timer_op_in_meta(Metadata &meta, const std::string &op_name,
-                                    uint8_t pdi_id, uint32_t timer_id) {
+                                    uint8_t pdi_id, uint32_t timer_id,
+                                    const std::string &event_name,
+                                    const std::string &event_type, bool start,
+                                    const std::string &shape = "",
+                                    const std::string &dtype = "") {
 
   std::map<std::string, std::any> attr;
   attr["timer_id"] = profile_ids::timer_id;
   attr["op_name"] = op_name;
+  attr["timer_event"] = event_name;
+  attr["timer_type"] = event_type;
+  attr["timer_start"] = start;
+  attr["timer_shape"] = shape;
+  attr["timer_dtype"] = dtype;
   Metadata::OpInfo timer_info = {
-      "timer_id_" + profile_ids::timer_id, "RECORD_TIMER", {}, attr, pdi_id};
+      "timer_id_" + std::to_string(profile_ids::timer_id),
+      "RECORD_TIMER",
+      {},
+      attr,
+      pdi_id};
   meta.op_list.emplace_back(timer_info);
 }
 
+static void insert_perf_counter_op_in_meta(Metadata &meta,
+                                           const std::string &op_name,
+                                           uint8_t pdi_id, bool start) {
+  std::map<std::string, std::any> attr;
+  attr["perf_counter_id"] = profile_ids::perf_counter_id;
+  attr["op_name"] = op_name;
+  Metadata::OpInfo counter_info = {
+      (start ? "perf_counter_start_" : "perf_counter_read_") +
+          std::to_string(profile_ids::perf_counter_id),
+      start ? "PERF_COUNTER_START" : "PERF_COUNTER_READ",
+      {},
+      attr,
+      pdi_id};
+  meta.op_list.emplace_back(counter_info);
+}
+
+// Registers in the order they are dumped by each PERF_COUNTER_READ
+static json get_perf_counter_regs() {
+  json regs = json::array();
+  for (const auto &counter : ryzenai::perf_counter::get_dumped_counters()) {
+    regs.push_back({{"col", counter.col},
+                    {"row", counter.row},
+                    {"counter", counter.name},
+                    {"address", counter.regoff}});
+  }
+  return regs;
+}
+
+// Bytes of all tensors of the op, moved through the shim DMAs at least once
+static size_t get_op_tensor_bytes(const Metadata &meta,
+                                  const Metadata::OpInfo &op) {
+  size_t bytes = 0;
+  for (const auto &arg : op.args) {
+    bytes += MAP_AT(meta.tensor_map, arg).size_in_bytes;
+  }
+  return bytes;
+}
+
 static void insert_timer_info_in_dd_json(json &dd_ts, const json &op_prop,
                                          const Metadata::OpInfo &op,
                                          uint32_t timer_id, bool start,
@@ -105,8 +161,10 @@ Metadata insert_record_timer_nodes(const Metadata &meta,
   const std::string dd_timestamp_fname = "dd_timestamp_info.json";
   Metadata record_timer_meta = meta;
   record_timer_meta.op_list.clear();
+  const std::string dd_perf_counter_fname = "dd_perf_counter_info.json";
   ryzenai::record_timer timer_op();
   json dd_ts;
+  json dd_pc;
 
   // if timer_id != 0, create new dd_json, else append to the existing file
   if (profile_ids::timer_id != 0) {
@@ -115,12 +173,22 @@ Metadata insert_record_timer_nodes(const Metadata &meta,
   } else {
     dd_ts["events"] = json::array();
   }
+  if (profile_level >= 4) {
+    if (profile_ids::perf_counter_id != 0) {
+      std::ifstream ifs(dd_perf_counter_fname);
+      dd_pc = json::parse(ifs);
+    } else {
+      dd_pc["registers"] = get_perf_counter_regs();
+      dd_pc["events"] = json::array();
+    }
+  }
 
   // insert subgraph timer start
   if (profile_level >= 1) {
     insert_timer_op_in_meta(record_timer_meta,
                             "subgraph_" + meta.json_path + "__start", 0x0,
-                            profile_ids::timer_id);
+                            profile_ids::timer_id, meta.json_path, "subgraph",
+                            true);
     dd_ts["events"].push_back({{"id", profile_ids::timer_id},
                                {"name", meta.json_path},
                                {"op_type", "subgraph"},
@@ -132,13 +200,23 @@ Metadata insert_record_timer_nodes(const Metadata &meta,
 
   // iterate over pdi partitions and insert profile points
   for (size_t part = 0; part < meta.partitions.size(); part++) {
+    if (is_host_partition(meta.partitions.at(part))) {
+      // timers run on the NPU, the host ops are timed by FusionRuntime
+      for (size_t i = meta.partitions.at(part).op_range.first;
+           i < meta.partitions.at(part).op_range.second; ++i) {
+        record_timer_meta.op_list.emplace_back(meta.op_list.at(i));
+      }
+      continue;
+    }
     auto pdi_parent_timer_id = profile_ids::timer_id;
     if (profile_level >= 2) {
 
       // insert pdi_subgraph_start
       insert_timer_op_in_meta(record_timer_meta,
                               "pdi_partition_" + std::to_string(part), part,
-                              profile_ids::timer_id);
+                              profile_ids::timer_id,
+                              "pdi_partition_" + std::to_string(part),
+                              "pdi_partition", true);
       dd_ts["events"].push_back(
           {{"id", profile_ids::timer_id},
            {"name", "pdi_partition_" + std::to_string(part)},
@@ -153,10 +231,18 @@ Metadata insert_record_timer_nodes(const Metadata &meta,
          i < meta.partitions.at(part).op_range.second; ++i) {
       const auto &op = meta.op_list.at(i);
       json op_prop = get_op_prop(meta, op);
+      auto [op_shape, op_dtype, num_args] = get_dtype_shape_from_op(meta, op);
+      // Reset core perf counters, before the start timer so that programming
+      // them isn't part of the op latency
+      if (profile_level >= 4) {
+        insert_perf_counter_op_in_meta(record_timer_meta, op.name, op.pdi_id,
+                                       true);
+      }
       // Add start timer
       if (profile_level >= 3) {
         insert_timer_op_in_meta(record_timer_meta, op.name + "__start",
-                                op.pdi_id, profile_ids::timer_id);
+                                op.pdi_id, profile_ids::timer_id, op.name,
+                                op.type, true, op_shape, op_dtype);
         insert_timer_info_in_dd_json(dd_ts, op_prop, op, profile_ids::timer_id,
                                      true, pdi_parent_timer_id);
         profile_ids::timer_id++;
@@ -165,18 +251,35 @@ Metadata insert_record_timer_nodes(const Metadata &meta,
       // Add end timer
       if (profile_level >= 3) {
         insert_timer_op_in_meta(record_timer_meta, op.name + "__end", op.pdi_id,
-                                profile_ids::timer_id);
+                                profile_ids::timer_id, op.name, op.type, false,
+                                op_shape, op_dtype);
         insert_timer_info_in_dd_json(dd_ts, op_prop, op, profile_ids::timer_id,
                                      false, pdi_parent_timer_id);
         profile_ids::timer_id++;
       }
+      // Dump core perf counters, in the order of the events in dd_pc
+      if (profile_level >= 4) {
+        insert_perf_counter_op_in_meta(record_timer_meta, op.name, op.pdi_id,
+                                       false);
+        dd_pc["events"].push_back({{"id", profile_ids::perf_counter_id},
+                                   {"name", op.name},
+                                   {"op_type", op.type},
+                                   {"tensor_bytes",
+                                    get_op_tensor_bytes(meta, op)},
+                                   {"parent", "pdi_partition_" +
+                                                  std::to_string(op.pdi_id)},
+                                   {"subgraph", meta.json_path}});
+        profile_ids::perf_counter_id++;
+      }
     }
 
     if (profile_level >= 2) {
       // insert pdi_subgraph_end
       insert_timer_op_in_meta(record_timer_meta,
                               "pdi_partition_" + std::to_string(part), part,
-                              profile_ids::timer_id);
+                              profile_ids::timer_id,
+                              "pdi_partition_" + std::to_string(part),
+                              "pdi_partition", false);
       dd_ts["events"].push_back(
           {{"id", profile_ids::timer_id},
            {"name", "pdi_partition_" + std::to_string(part)},
@@ -192,7 +295,8 @@ Metadata insert_record_timer_nodes(const Metadata &meta,
     // insert subgraph timer end
     insert_timer_op_in_meta(record_timer_meta,
                             "subgraph_" + meta.json_path + "__end", 0x0,
-                            profile_ids::timer_id);
+                            profile_ids::timer_id, meta.json_path, "subgraph",
+                            false);
     dd_ts["events"].push_back({{"id", profile_ids::timer_id},
                                {"name", meta.json_path},
                                {"op_type", "subgraph"},
@@ -206,6 +310,14 @@ Metadata insert_record_timer_nodes(const Metadata &meta,
   std::ofstream jsonf(ai_analyzer_metafile);
   jsonf << std::setw(4) << dd_ts << std::endl;
 
+  if (profile_level >= 4) {
+    std::ofstream pc_jsonf(dd_perf_counter_fname);
+    pc_jsonf << std::setw(4) << dd_pc << std::endl;
+    RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+        "Inserted {} perf counter dumps, perf_counter_meta_file: {}",
+        profile_ids::perf_counter_id, dd_perf_counter_fname));
+  }
+
   RYZENAI_LOG_TRACE(
       OpsFusion::dod_format("Inserted {} timers, ai_analyzer_meta_file: {}",
                             profile_ids::timer_id, ai_analyzer_metafile));
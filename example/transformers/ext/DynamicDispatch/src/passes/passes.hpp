@@ -1,6 +1,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include <op_fuser/fuse_types.hpp>
 
 namespace OpsFusion {
@@ -9,9 +11,18 @@ void assign_pdi_id_pass(const OpPDIMap &op_pdi_map, Metadata &meta);
 Metadata insert_pm_swap_nodes(const Metadata &meta);
 Metadata insert_record_timer_nodes(const Metadata &meta,
                                    uint32_t profile_level);
+void batch_graph_pass(Metadata &meta, size_t batch_size);
+void reorder_ops_pass(Metadata &meta, double pdi_switch_cost,
+                      double pm_swap_cost);
+void fuse_op_patterns_pass(Metadata &meta);
+void fold_qdq_pairs_pass(Metadata &meta);
+void eliminate_dead_ops_pass(Metadata &meta);
+void fold_view_ops_pass(Metadata &meta);
 void generate_pdi_partitions_pass(Metadata &meta, bool eager_mode);
 void analyze_buffer_reqs(Metadata &meta);
 void optimize_scratch_buffer(Metadata &meta);
+std::vector<Metadata> split_independent_subgraphs(const Metadata &meta,
+                                                  size_t max_subgraphs);
 bool split_max_partition_pass(
     Metadata &meta, const std::vector<std::vector<uint8_t>> fused_instr_vec,
     size_t limit);
@@ -0,0 +1,200 @@
+#include <limits>
+#include <set>
+#include <unordered_map>
+
+#include <op_fuser/fuse_types.hpp>
+#include <ops/pm_load/pm_load.hpp>
+#include <utils/meta_utils.hpp>
+
+#include "detail/meta_graph.hpp"
+#include "passes.hpp"
+
+/*
+Reorder independent ops so that ops running on the same PDI (and PM, if PM
+swap is enabled) are grouped together. Every change of PDI b/w consecutive ops
+starts a new partition, and every change of PM inserts a PM_LOAD op later.
+
+Dependencies b/w ops are derived from the tensors they read & write, as
+identified by op->get_buffer_reqs(). Ops are list-scheduled: at each step, out
+of the ops whose dependencies are done, the one with the least switch cost
+from the previous op is picked. Ties are broken by the original position, so
+a graph which can't be improved keeps its order.
+*/
+
+using namespace OpsFusion::Pass::detail;
+
+namespace OpsFusion {
+
+struct OpScheduleKey {
+  std::uint8_t pdi_id = 0;
+  // PM elf of the op, empty if PM swap cost is not considered
+  std::string pm_id;
+};
+
+static std::vector<OpScheduleKey> get_op_keys(const Metadata &meta,
+                                              bool use_pm_id) {
+  std::vector<OpScheduleKey> keys;
+  keys.reserve(meta.op_list.size());
+
+  constexpr bool load_xrt = false;
+  std::unique_ptr<ryzenai::pm_load> pm_op;
+  if (use_pm_id) {
+    pm_op = std::make_unique<ryzenai::pm_load>(load_xrt);
+  }
+
+  for (const auto &op_info : meta.op_list) {
+    OpScheduleKey key;
+    key.pdi_id = op_info.pdi_id;
+    if (pm_op && op_info.type != HOST_OP_TYPE) {
+      const auto &op_dtype =
+          MAP_AT(meta.tensor_map, ARRAY_AT(op_info.args, 0)).dtype;
+      key.pm_id =
+          pm_op->get_op_xclbin_meta(op_info.type, op_dtype).pm_elf_fname;
+    }
+    keys.push_back(std::move(key));
+  }
+  return keys;
+}
+
+// For each op, the ops which have to run before it.
+// RAW, WAR & WAW hazards w.r.t. the original order are all kept.
+static std::vector<std::set<size_t>> get_op_deps(const Metadata &meta) {
+  MetaGraph meta_graph(meta);
+
+  std::vector<std::set<size_t>> deps(meta.op_list.size());
+  std::unordered_map<std::string, size_t> last_writer;
+  std::unordered_map<std::string, std::vector<size_t>> readers;
+  for (size_t op_idx = 0; op_idx < meta.op_list.size(); ++op_idx) {
+    const auto &op_name = meta.op_list[op_idx].name;
+    for (const auto &tname : meta_graph.get_op_inputs(op_name)) {
+      auto iter = last_writer.find(tname);
+      if (iter != last_writer.end()) {
+        deps[op_idx].insert(iter->second);
+      }
+      readers[tname].push_back(op_idx);
+    }
+    for (const auto &tname : meta_graph.get_op_outputs(op_name)) {
+      auto iter = last_writer.find(tname);
+      if (iter != last_writer.end()) {
+        deps[op_idx].insert(iter->second);
+      }
+      for (auto reader : readers[tname]) {
+        if (reader != op_idx) {
+          deps[op_idx].insert(reader);
+        }
+      }
+      readers[tname].clear();
+      last_writer[tname] = op_idx;
+    }
+  }
+  return deps;
+}
+
+static double get_switch_cost(const OpScheduleKey &from,
+                              const OpScheduleKey &to, double pdi_switch_cost,
+                              double pm_swap_cost) {
+  double cost = 0;
+  if (from.pdi_id != to.pdi_id) {
+    cost += pdi_switch_cost;
+  }
+  if (from.pm_id != to.pm_id) {
+    cost += pm_swap_cost;
+  }
+  return cost;
+}
+
+static double get_schedule_cost(const std::vector<OpScheduleKey> &keys,
+                                const std::vector<size_t> &order,
+                                double pdi_switch_cost, double pm_swap_cost) {
+  double cost = 0;
+  for (size_t i = 1; i < order.size(); ++i) {
+    cost += get_switch_cost(keys[order[i - 1]], keys[order[i]],
+                            pdi_switch_cost, pm_swap_cost);
+  }
+  return cost;
+}
+
+void reorder_ops_pass(Metadata &meta, double pdi_switch_cost,
+                      double pm_swap_cost) {
+  const size_t num_ops = meta.op_list.size();
+  if (num_ops < 2) {
+    return;
+  }
+
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "Reorder Ops Pass, pdi_switch_cost : {}, pm_swap_cost : {}",
+      pdi_switch_cost, pm_swap_cost));
+
+  const auto keys = get_op_keys(meta, pm_swap_cost > 0);
+  const auto deps = get_op_deps(meta);
+
+  std::vector<size_t> num_pending_deps(num_ops);
+  std::vector<std::vector<size_t>> dependents(num_ops);
+  std::set<size_t> ready_ops;
+  for (size_t op_idx = 0; op_idx < num_ops; ++op_idx) {
+    num_pending_deps[op_idx] = deps[op_idx].size();
+    for (auto dep : deps[op_idx]) {
+      dependents[dep].push_back(op_idx);
+    }
+    if (deps[op_idx].empty()) {
+      ready_ops.insert(op_idx);
+    }
+  }
+
+  std::vector<size_t> new_order;
+  new_order.reserve(num_ops);
+  while (!ready_ops.empty()) {
+    auto best_op = *ready_ops.begin();
+    if (!new_order.empty()) {
+      const auto &prev_key = keys[new_order.back()];
+      double best_cost = std::numeric_limits<double>::max();
+      for (auto op_idx : ready_ops) {
+        auto cost = get_switch_cost(prev_key, keys[op_idx], pdi_switch_cost,
+                                    pm_swap_cost);
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_op = op_idx;
+        }
+      }
+    }
+
+    ready_ops.erase(best_op);
+    new_order.push_back(best_op);
+    for (auto dependent : dependents[best_op]) {
+      if (--num_pending_deps[dependent] == 0) {
+        ready_ops.insert(dependent);
+      }
+    }
+  }
+
+  DOD_ASSERT(new_order.size() == num_ops,
+             OpsFusion::dod_format("Reorder Ops Pass : scheduled {} of {} ops",
+                                   new_order.size(), num_ops));
+
+  std::vector<size_t> orig_order(num_ops);
+  for (size_t op_idx = 0; op_idx < num_ops; ++op_idx) {
+    orig_order[op_idx] = op_idx;
+  }
+  auto orig_cost =
+      get_schedule_cost(keys, orig_order, pdi_switch_cost, pm_swap_cost);
+  auto new_cost =
+      get_schedule_cost(keys, new_order, pdi_switch_cost, pm_swap_cost);
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "Reorder Ops Pass : switch cost {} --> {}", orig_cost, new_cost));
+
+  // Greedy choice isn't guaranteed to be better, keep the original then.
+  if (new_cost >= orig_cost) {
+    RYZENAI_LOG_TRACE("Reorder Ops Pass : keeping original order");
+    return;
+  }
+
+  std::vector<Metadata::OpInfo> new_op_list;
+  new_op_list.reserve(num_ops);
+  for (auto op_idx : new_order) {
+    new_op_list.push_back(std::move(meta.op_list[op_idx]));
+  }
+  meta.op_list = std::move(new_op_list);
+  RYZENAI_LOG_TRACE("Reorder Ops Pass : DONE");
+}
+
+} // namespace OpsFusion
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <numeric>
+#include <set>
+
+#include <op_fuser/fuse_types.hpp>
+#include <utils/meta_utils.hpp>
+
+#include "passes.hpp"
+
+/*
+Split the graph into subgraphs which share no tensor other than graph inputs,
+so that they can run concurrently, e.g. on hw contexts of different column
+sets.
+
+1. Two ops are in the same subgraph if they access a common tensor which is
+not a graph input or a const. Each subgraph gets its own copy of the graph
+inputs it reads, so sharing those is fine.
+
+2. Branches which merge back into a common op access the same tensors as this
+op, so they end up in one subgraph and stay serial.
+
+3. If there are more subgraphs than max_subgraphs, they are grouped together,
+largest first into the group with the fewest ops. Ops within a group keep
+their original order.
+
+4. This pass runs before all the other passes. Each returned Metadata is a
+standalone model with its own in/out/scratch/const tensors.
+*/
+
+namespace OpsFusion {
+
+static size_t find_root(std::vector<size_t> &parent, size_t idx) {
+  while (parent[idx] != idx) {
+    parent[idx] = parent[parent[idx]];
+    idx = parent[idx];
+  }
+  return idx;
+}
+
+static Metadata make_subgraph(const Metadata &meta,
+                              const std::vector<size_t> &op_ids) {
+  Metadata sub;
+  sub.json_path = meta.json_path;
+
+  std::set<std::string> tensors;
+  for (auto op_idx : op_ids) {
+    const auto &op_info = meta.op_list.at(op_idx);
+    tensors.insert(op_info.args.begin(), op_info.args.end());
+    sub.op_list.push_back(op_info);
+  }
+
+  for (const auto &[name, tinfo] : meta.fused_tensors) {
+    auto &sub_tinfo = sub.fused_tensors[name];
+    sub_tinfo.size = tinfo.size;
+    sub_tinfo.arg_idx = tinfo.arg_idx;
+    for (const auto &tname : tinfo.packed_tensors) {
+      if (tensors.find(tname) != tensors.end()) {
+        sub_tinfo.packed_tensors.push_back(tname);
+      }
+    }
+  }
+
+  for (const auto &tname : tensors) {
+    sub.tensor_map[tname] = MAP_AT(meta.tensor_map, tname);
+  }
+  return sub;
+}
+
+std::vector<Metadata> split_independent_subgraphs(const Metadata &meta,
+                                                  size_t max_subgraphs) {
+  RYZENAI_LOG_TRACE("Splitting independent subgraphs ... START");
+  const size_t num_ops = meta.op_list.size();
+
+  std::set<std::string> shared_tensors;
+  for (const auto &label : {"in", "const"}) {
+    auto iter = meta.fused_tensors.find(label);
+    if (iter != meta.fused_tensors.end()) {
+      shared_tensors.insert(iter->second.packed_tensors.begin(),
+                            iter->second.packed_tensors.end());
+    }
+  }
+
+  std::vector<size_t> parent(num_ops);
+  std::iota(parent.begin(), parent.end(), size_t{0});
+  std::map<std::string, size_t> tensor_owner;
+  for (size_t op_idx = 0; op_idx < num_ops; ++op_idx) {
+    for (const auto &tname : meta.op_list[op_idx].args) {
+      if (shared_tensors.find(tname) != shared_tensors.end()) {
+        continue;
+      }
+      auto [iter, inserted] = tensor_owner.emplace(tname, op_idx);
+      if (!inserted) {
+        parent[find_root(parent, op_idx)] = find_root(parent, iter->second);
+      }
+    }
+  }
+
+  std::map<size_t, std::vector<size_t>> components;
+  for (size_t op_idx = 0; op_idx < num_ops; ++op_idx) {
+    components[find_root(parent, op_idx)].push_back(op_idx);
+  }
+
+  const size_t num_groups =
+      std::max<size_t>(1, std::min(max_subgraphs, components.size()));
+  RYZENAI_LOG_TRACE(dod_format("  #independent subgraphs : {}, #groups : {}",
+                               components.size(), num_groups));
+  if (num_groups == 1) {
+    RYZENAI_LOG_TRACE("Splitting independent subgraphs ... END");
+    return {meta};
+  }
+
+  std::vector<const std::vector<size_t> *> order;
+  for (const auto &[root, op_ids] : components) {
+    order.push_back(&op_ids);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [](const std::vector<size_t> *a,
+                      const std::vector<size_t> *b) {
+                     return a->size() > b->size();
+                   });
+
+  std::vector<std::vector<size_t>> groups(num_groups);
+  for (const auto *op_ids : order) {
+    auto &group = *std::min_element(
+        groups.begin(), groups.end(),
+        [](const std::vector<size_t> &a, const std::vector<size_t> &b) {
+          return a.size() < b.size();
+        });
+    group.insert(group.end(), op_ids->begin(), op_ids->end());
+  }
+
+  std::vector<Metadata> subgraphs;
+  for (auto &group : groups) {
+    std::sort(group.begin(), group.end());
+    RYZENAI_LOG_TRACE(dod_format("  subgraph {} : #ops {}", subgraphs.size(),
+                                 group.size()));
+    subgraphs.push_back(make_subgraph(meta, group));
+  }
+
+  RYZENAI_LOG_TRACE("Splitting independent subgraphs ... END");
+  return subgraphs;
+}
+
+} // namespace OpsFusion
@@ -10,9 +10,13 @@
 #include <nanobind/stl/string.h>
 #include <nanobind/stl/vector.h>
 
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace nb = nanobind;
@@ -23,6 +27,20 @@ public:
   // Constructor just forwards args to base class
   FusionRuntime(const std::string &xclbin) : OpsFusion::FusionRuntime(xclbin) {}
 
+  ~FusionRuntime() {
+    // Called with the GIL held, completion_loop() needs it to resolve the
+    // futures still in flight
+    nb::gil_scoped_release release;
+    {
+      std::lock_guard<std::mutex> lock(completion_mutex_);
+      stop_completion_ = true;
+    }
+    completion_cv_.notify_all();
+    if (completion_thread_.joinable()) {
+      completion_thread_.join();
+    }
+  }
+
   void
   execute_ndarrays(const vector<nb::ndarray<nb::c_contig>> &input_ndarrays,
                    const vector<nb::ndarray<nb::c_contig>> &output_ndarrays) {
@@ -38,11 +56,106 @@ public:
       outputs.push_back(ndarray_to_tensor(output_ndarray));
     }
 
-    // Base class accepts Tensor structs
+    // Base class accepts Tensor structs. The ndarrays are kept alive by the
+    // caller, so other Python threads can run meanwhile.
+    nb::gil_scoped_release release;
     execute(inputs, outputs);
   }
 
+  // Submits the request and returns a concurrent.futures.Future, resolved
+  // once the outputs are written. Use asyncio.wrap_future() to await it.
+  // The inputs are copied before returning, the outputs must not be touched
+  // until the future is done.
+  nb::object
+  execute_async_ndarrays(const nb::list &input_ndarrays,
+                         const nb::list &output_ndarrays) {
+    std::vector<Tensor> inputs;
+    std::vector<Tensor> outputs;
+
+    for (const auto &input_ndarray : input_ndarrays) {
+      inputs.push_back(
+          ndarray_to_tensor(nb::cast<nb::ndarray<nb::c_contig>>(input_ndarray)));
+    }
+
+    for (const auto &output_ndarray : output_ndarrays) {
+      outputs.push_back(ndarray_to_tensor(
+          nb::cast<nb::ndarray<nb::c_contig>>(output_ndarray)));
+    }
+
+    nb::object future =
+        nb::module_::import_("concurrent.futures").attr("Future")();
+    RequestHandle handle = 0;
+    {
+      // submit() blocks while all the async slots are in flight
+      nb::gil_scoped_release release;
+      handle = submit(inputs, outputs);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(completion_mutex_);
+      if (!completion_thread_.joinable()) {
+        completion_thread_ =
+            std::thread(&FusionRuntime::completion_loop, this);
+      }
+      completions_.push_back({handle, future, output_ndarrays});
+    }
+    completion_cv_.notify_one();
+    return future;
+  }
+
 private:
+  static constexpr nb::dlpack::dtype BF16_DTYPE{
+      static_cast<uint8_t>(nb::dlpack::dtype_code::Bfloat), 16, 1};
+
+  struct Completion {
+    RequestHandle handle;
+    nb::object future;
+    // keeps the output buffers alive until the request is done
+    nb::object outputs;
+  };
+
+  // Waits on the submitted requests in order and resolves their futures
+  void completion_loop() {
+    while (true) {
+      std::unique_lock<std::mutex> lock(completion_mutex_);
+      completion_cv_.wait(lock, [this]() {
+        return stop_completion_ || !completions_.empty();
+      });
+      if (completions_.empty()) {
+        return;
+      }
+      // Moving the objects out doesn't touch their refcounts, no GIL needed.
+      // Taking the GIL while holding completion_mutex_ would deadlock with
+      // execute_async_ndarrays().
+      Completion completion = std::move(completions_.front());
+      completions_.pop_front();
+      lock.unlock();
+
+      std::string error;
+      try {
+        wait(completion.handle);
+      } catch (std::exception &e) {
+        error = e.what();
+      }
+
+      nb::gil_scoped_acquire acquire;
+      // destroyed before the GIL is released
+      Completion done = std::move(completion);
+      if (error.empty()) {
+        done.future.attr("set_result")(nb::none());
+      } else {
+        done.future.attr("set_exception")(
+            nb::module_::import_("builtins").attr("RuntimeError")(error));
+      }
+    }
+  }
+
+  std::mutex completion_mutex_;
+  std::condition_variable completion_cv_;
+  std::deque<Completion> completions_;
+  std::thread completion_thread_;
+  bool stop_completion_ = false;
+
   // Utility function to convert ndarray to Tensor
   static Tensor ndarray_to_tensor(const nb::ndarray<nb::c_contig> &ndarray) {
     void *data = const_cast<void *>(
@@ -54,8 +167,14 @@ private:
       shape.push_back(ndarray.shape(i));
     }
 
-    if (ndarray.dtype() == nb::dtype<int16_t>()) {
+    // numpy has no bfloat16, int16 arrays are taken as bfloat16 too
+    if (ndarray.dtype() == nb::dtype<int16_t>() ||
+        ndarray.dtype() == BF16_DTYPE) {
       dtype = "bfloat16";
+    } else if (ndarray.dtype() == nb::dtype<uint16_t>()) {
+      dtype = "uint16";
+    } else if (ndarray.dtype() == nb::dtype<int32_t>()) {
+      dtype = "int32";
     } else if (ndarray.dtype() == nb::dtype<uint8_t>()) {
       dtype = "uint8";
     } else if (ndarray.dtype() == nb::dtype<int8_t>()) {
@@ -93,15 +212,21 @@ NB_MODULE(_DynamicDispatch, m) {
       .def_rw("shape", &OpsFusion::Metadata::OffsetInfo::shape)
       .def_rw("size_in_bytes", &OpsFusion::Metadata::OffsetInfo::size_in_bytes)
       .def_rw("file_name", &OpsFusion::Metadata::OffsetInfo::file_name)
-      .def_rw("file_size", &OpsFusion::Metadata::OffsetInfo::file_size);
+      .def_rw("file_size", &OpsFusion::Metadata::OffsetInfo::file_size)
+      .def_rw("file_offset", &OpsFusion::Metadata::OffsetInfo::file_offset);
 
   nb::class_<OpsFusion::Metadata::Span>(metadata, "Span")
       .def_rw("offset", &OpsFusion::Metadata::Span::offset)
       .def_rw("size", &OpsFusion::Metadata::Span::size);
 
+  nb::class_<OpsFusion::Metadata::TensorView>(metadata, "TensorView")
+      .def_rw("base_name", &OpsFusion::Metadata::TensorView::base_name)
+      .def_rw("offset", &OpsFusion::Metadata::TensorView::offset);
+
   metadata.def_rw("op_list", &OpsFusion::Metadata::op_list);
   metadata.def_rw("fused_tensors", &OpsFusion::Metadata::fused_tensors);
   metadata.def_rw("tensor_map", &OpsFusion::Metadata::tensor_map);
+  metadata.def_rw("tensor_views", &OpsFusion::Metadata::tensor_views);
   metadata.def_rw("super_instr_map", &OpsFusion::Metadata::super_instr_map);
   metadata.def_rw("const_map", &OpsFusion::Metadata::const_map);
 
@@ -109,6 +234,34 @@ NB_MODULE(_DynamicDispatch, m) {
   opBuilder.def_static("is_supported", &OpsFusion::OpBuilder::is_supported);
 
   m.def("load_meta_json", OpsFusion::load_meta_json);
+  m.def("load_meta_bin", OpsFusion::load_meta_bin);
+  m.def("load_meta", OpsFusion::load_meta);
+  m.def("save_meta_bin", OpsFusion::save_meta_bin);
+
+  nb::class_<OpsFusion::LatencyStats>(m, "LatencyStats")
+      .def_ro("count", &OpsFusion::LatencyStats::count)
+      .def_ro("min_ns", &OpsFusion::LatencyStats::min_ns)
+      .def_ro("max_ns", &OpsFusion::LatencyStats::max_ns)
+      .def_ro("mean_ns", &OpsFusion::LatencyStats::mean_ns)
+      .def_ro("p50_ns", &OpsFusion::LatencyStats::p50_ns)
+      .def_ro("p99_ns", &OpsFusion::LatencyStats::p99_ns)
+      .def_ro("p999_ns", &OpsFusion::LatencyStats::p999_ns);
+
+  nb::class_<OpsFusion::TimerRecord>(m, "TimerRecord")
+      .def_ro("id", &OpsFusion::TimerRecord::id)
+      .def_ro("cycles", &OpsFusion::TimerRecord::cycles);
+
+  nb::class_<OpsFusion::DeviceOpTime>(m, "DeviceOpTime")
+      .def_ro("name", &OpsFusion::DeviceOpTime::name)
+      .def_ro("type", &OpsFusion::DeviceOpTime::type)
+      .def_ro("shape", &OpsFusion::DeviceOpTime::shape)
+      .def_ro("dtype", &OpsFusion::DeviceOpTime::dtype)
+      .def_ro("num_runs", &OpsFusion::DeviceOpTime::num_runs)
+      .def_ro("mean_cycles", &OpsFusion::DeviceOpTime::mean_cycles)
+      .def_ro("min_cycles", &OpsFusion::DeviceOpTime::min_cycles)
+      .def_ro("max_cycles", &OpsFusion::DeviceOpTime::max_cycles);
+
+  m.def("read_timer_records", OpsFusion::read_timer_records);
 
   nb::class_<FusionRuntime>(m, "FusionRuntime")
       .def(nb::init<const std::string &>())
@@ -119,5 +272,17 @@ NB_MODULE(_DynamicDispatch, m) {
           },
           "Function to configure the fusion runtime.")
       .def("execute", &FusionRuntime::execute_ndarrays,
-           "Function to initiate inference.");
+           "Function to initiate inference.")
+      .def("execute_async", &FusionRuntime::execute_async_ndarrays,
+           "Submits an inference, returns a concurrent.futures.Future.")
+      .def("get_latency_stats", &FusionRuntime::get_latency_stats,
+           "Latency histogram summaries per phase and PDI partition.")
+      .def("reset_latency_stats", &FusionRuntime::reset_latency_stats,
+           "Clear the latency histograms.")
+      .def("get_device_op_times", &FusionRuntime::get_device_op_times,
+           "Per op device cycles of the RECORD_TIMER records.")
+      .def(
+          "get_startup_report",
+          [](FusionRuntime &self) { return self.get_startup_report(); },
+          "Text chart of the steps of the last init().");
 }
@@ -498,4 +498,72 @@ txn_util::fuse_txns(const std::vector<std::vector<uint8_t>> &txns) {
   return fused_txn;
 }
 
+std::vector<std::vector<uint8_t>>
+txn_util::split_txn(const std::vector<uint8_t> &txn, size_t max_size) {
+  const XAie_TxnHeader *txn_hdr = (const XAie_TxnHeader *)txn.data();
+  DOD_ASSERT(txn.size() == txn_hdr->TxnSize,
+             OpsFusion::dod_format(
+                 "Size of transaction {} doesn't match the size in its "
+                 "header {}",
+                 txn.size(), txn_hdr->TxnSize));
+
+  std::vector<std::vector<uint8_t>> txns;
+  // ops of the current transaction are [begin, ptr)
+  const uint8_t *begin = txn.data() + sizeof(XAie_TxnHeader);
+  const uint8_t *ptr = begin;
+  size_t num_ops = 0;
+  // end of the last sync op of the current transaction, the DMAs started
+  // before it are done there
+  const uint8_t *sync_end = nullptr;
+  size_t num_sync_ops = 0;
+
+  auto add_txn = [&](const uint8_t *end, size_t txn_ops) {
+    const size_t ops_size = end - begin;
+    std::vector<uint8_t> res(sizeof(XAie_TxnHeader) + ops_size);
+    std::memcpy(res.data(), txn_hdr, sizeof(XAie_TxnHeader));
+    std::memcpy(res.data() + sizeof(XAie_TxnHeader), begin, ops_size);
+    XAie_TxnHeader *res_hdr = (XAie_TxnHeader *)res.data();
+    res_hdr->NumOps = static_cast<uint32_t>(txn_ops);
+    res_hdr->TxnSize = static_cast<uint32_t>(res.size());
+    txns.push_back(std::move(res));
+    begin = end;
+    num_ops -= txn_ops;
+    sync_end = nullptr;
+    num_sync_ops = 0;
+  };
+
+  for (uint32_t i = 0; i < txn_hdr->NumOps; i++) {
+    const uint8_t *op = ptr;
+    const auto op_code = ((const XAie_OpHdr *)op)->Op;
+    uint8_t *next = const_cast<uint8_t *>(op);
+    pass_through(&next);
+    while (sizeof(XAie_TxnHeader) + (next - begin) > max_size) {
+      DOD_ASSERT(num_ops > 0, OpsFusion::dod_format(
+                                  "Transaction op of {} B at offset {} "
+                                  "doesn't fit in {} B",
+                                  next - op, op - txn.data(), max_size));
+      if (sync_end) {
+        add_txn(sync_end, num_sync_ops);
+      } else {
+        add_txn(op, num_ops);
+      }
+    }
+    num_ops++;
+    if (op_code == XAIE_IO_CUSTOM_OP_BEGIN ||
+        op_code == XAIE_IO_CUSTOM_OP_BEGIN + 4) {
+      // TCT & merge sync ops
+      sync_end = next;
+      num_sync_ops = num_ops;
+    }
+    ptr = next;
+  }
+  if (num_ops > 0 || txns.empty()) {
+    add_txn(ptr, num_ops);
+  }
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "Split transaction of {} B into {} transactions", txn.size(),
+      txns.size()));
+  return txns;
+}
+
 } // namespace utils
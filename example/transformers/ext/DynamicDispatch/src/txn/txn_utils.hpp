@@ -30,6 +30,11 @@ public:
   std::vector<uint8_t> to_vector();
   static std::vector<uint8_t>
   fuse_txns(const std::vector<std::vector<uint8_t>> &txns);
+  // Splits txn on op boundaries into transactions of at most max_size bytes,
+  // run one after the other they do the same as txn. A transaction ends
+  // after its last sync op if it has one.
+  static std::vector<std::vector<uint8_t>>
+  split_txn(const std::vector<uint8_t> &txn, size_t max_size);
   static void pass_through(uint8_t **ptr);
   uint8_t *txn_ptr_ = nullptr;
   uint8_t *fused_txn_ptr_ = nullptr;
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
 #include <utils/ipu_hw_config.hpp>
@@ -119,4 +123,270 @@ prepend_mtile_const_pad_txn(const std::vector<uint8_t> &base_txn,
   return t_util.fuse_txns({txn, base_txn});
 }
 
+/**
+ * @brief Move the buffer args of a transaction, so that the txns of ops
+ * composed into a single op can address slices of the composite op's
+ * buffers, e.g. the output of one sub-op in the internal scratch pad.
+ * Patch ops on an arg with no entry in arg_remap are left as is.
+ *
+ * @param base_txn
+ * @param arg_remap xrt arg idx -> {new xrt arg idx, offset added to argplus}
+ * @return std::vector<uint8_t> txn bin with remapped patch ops
+ */
+std::vector<uint8_t> remap_txn_args(const std::vector<uint8_t> &base_txn,
+                                    const txn_arg_remap_t &arg_remap) {
+  std::vector<uint8_t> txn = base_txn;
+  XAie_TxnHeader *Hdr = (XAie_TxnHeader *)txn.data();
+  auto num_ops = Hdr->NumOps;
+  uint8_t *ptr = txn.data() + sizeof(*Hdr);
+
+  for (int n = 0; n < num_ops; n++) {
+    auto op_hdr = (XAie_OpHdr *)ptr;
+    switch (op_hdr->Op) {
+    case XAIE_IO_CUSTOM_OP_BEGIN + 1: {
+      XAie_CustomOpHdr *hdr = (XAie_CustomOpHdr *)(ptr);
+      patch_op_t *op = (patch_op_t *)((ptr) + sizeof(*hdr));
+      auto iter = arg_remap.find(static_cast<uint32_t>(op->argidx));
+      if (iter != arg_remap.end()) {
+        RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+            "Remapped : [{}:{}] -> [{}:{}]", op->argidx, op->argplus,
+            iter->second.first, op->argplus + iter->second.second));
+        op->argidx = iter->second.first;
+        op->argplus += iter->second.second;
+      }
+      ptr = ptr + hdr->Size;
+      break;
+    }
+    default: {
+      utils::txn_util::pass_through(&ptr);
+      break;
+    }
+    }
+  }
+
+  return txn;
+}
+
+// DMA buffer descriptor registers of each tile type, [start, end)
+static constexpr uint32_t SHIM_DMA_BD_REG_START = 0x0001D000;
+static constexpr uint32_t SHIM_DMA_BD_REG_END = 0x0001D200;
+static constexpr uint32_t MEM_TILE_DMA_BD_REG_START = 0x000A0000;
+static constexpr uint32_t MEM_TILE_DMA_BD_REG_END = 0x000A0600;
+static constexpr uint32_t CORE_DMA_BD_REG_START = 0x0001D000;
+static constexpr uint32_t CORE_DMA_BD_REG_END = 0x0001D200;
+
+static bool is_dma_bd_reg(uint64_t regoff) {
+  auto [col, row, reg] = decode_regoff(regoff);
+  if (row == XAIE_SHIM_ROW) {
+    return reg >= SHIM_DMA_BD_REG_START && reg < SHIM_DMA_BD_REG_END;
+  }
+  if (row >= XAIE_MEM_TILE_ROW_START &&
+      row < XAIE_MEM_TILE_ROW_START + XAIE_MEM_TILE_NUM_ROWS) {
+    return reg >= MEM_TILE_DMA_BD_REG_START && reg < MEM_TILE_DMA_BD_REG_END;
+  }
+  return reg >= CORE_DMA_BD_REG_START && reg < CORE_DMA_BD_REG_END;
+}
+
+namespace {
+
+// Writes to BD registers of a txn, with the values the registers have after
+// each write. BD registers only change when the txn or a patch op writes
+// them, unlike e.g. lock or DMA queue registers, so a write of the value a
+// BD register already has is a no-op.
+class bd_write_coalescer {
+public:
+  bd_write_coalescer(std::vector<uint8_t> &ops) : ops_(ops) {}
+
+  size_t num_dropped_words = 0;
+  size_t num_ops = 0;
+
+  // Returns false if all words are already in the registers
+  bool write(uint64_t regoff, const uint32_t *words, size_t num_words) {
+    size_t first = num_words;
+    size_t last = 0;
+    for (size_t i = 0; i < num_words; i++) {
+      auto iter = regs_.find(regoff + i * sizeof(uint32_t));
+      if (iter == regs_.end() || iter->second != words[i]) {
+        first = std::min(first, i);
+        last = i;
+      }
+    }
+    if (first == num_words) {
+      num_dropped_words += num_words;
+      return false;
+    }
+    // trim the words at the ends which are already in the registers
+    num_dropped_words += first + (num_words - 1 - last);
+    const uint64_t start = regoff + first * sizeof(uint32_t);
+    if (pending_.empty() ||
+        start != pending_start_ + pending_.size() * sizeof(uint32_t)) {
+      flush();
+      pending_start_ = start;
+    }
+    for (size_t i = first; i <= last; i++) {
+      regs_[regoff + i * sizeof(uint32_t)] = words[i];
+      pending_.push_back(words[i]);
+    }
+    return true;
+  }
+
+  void forget(uint64_t regoff) { regs_.erase(regoff); }
+
+  std::optional<uint32_t> get(uint64_t regoff) const {
+    auto iter = regs_.find(regoff);
+    if (iter == regs_.end()) {
+      return std::nullopt;
+    }
+    return iter->second;
+  }
+
+  // Copy an op which isn't coalesced, after the pending writes
+  void emit(const uint8_t *op, size_t size) {
+    flush();
+    ops_.insert(ops_.end(), op, op + size);
+    num_ops++;
+  }
+
+  void flush() {
+    if (pending_.empty()) {
+      return;
+    }
+    auto [col, row, reg] = decode_regoff(pending_start_);
+    if (pending_.size() == 1) {
+      XAie_Write32Hdr hdr{};
+      hdr.OpHdr.Op = XAIE_IO_WRITE;
+      hdr.RegOff = pending_start_;
+      hdr.Value = pending_.front();
+      hdr.Size = sizeof(hdr);
+      append(&hdr, sizeof(hdr));
+    } else {
+      XAie_BlockWrite32Hdr hdr{};
+      hdr.OpHdr.Op = XAIE_IO_BLOCKWRITE;
+      hdr.Col = static_cast<uint8_t>(col);
+      hdr.Row = static_cast<uint8_t>(row);
+      hdr.RegOff = static_cast<uint32_t>(pending_start_);
+      hdr.Size =
+          static_cast<uint32_t>(sizeof(hdr) + pending_.size() * sizeof(uint32_t));
+      append(&hdr, sizeof(hdr));
+      append(pending_.data(), pending_.size() * sizeof(uint32_t));
+    }
+    num_ops++;
+    pending_.clear();
+  }
+
+private:
+  void append(const void *data, size_t size) {
+    auto *bytes = static_cast<const uint8_t *>(data);
+    ops_.insert(ops_.end(), bytes, bytes + size);
+  }
+
+  std::vector<uint8_t> &ops_;
+  std::unordered_map<uint64_t, uint32_t> regs_;
+  uint64_t pending_start_ = 0;
+  std::vector<uint32_t> pending_;
+};
+
+} // namespace
+
+/**
+ * @brief Remove redundant DMA BD reprogramming from a transaction, e.g. when
+ * fused ops program the same BDs with identical values. Only BD register
+ * writes are coalesced, all other ops are kept in the same order, so the
+ * resulting txn programs the same state.
+ *
+ * @param base_txn
+ * @return std::vector<uint8_t> optimized txn bin
+ */
+std::vector<uint8_t> optimize_txn(const std::vector<uint8_t> &base_txn) {
+  const XAie_TxnHeader *Hdr = (const XAie_TxnHeader *)base_txn.data();
+  auto num_ops = Hdr->NumOps;
+  uint8_t *ptr = const_cast<uint8_t *>(base_txn.data()) + sizeof(*Hdr);
+
+  std::vector<uint8_t> ops;
+  ops.reserve(base_txn.size());
+  bd_write_coalescer bd_writes(ops);
+
+  for (uint32_t n = 0; n < num_ops; n++) {
+    auto op_hdr = (XAie_OpHdr *)ptr;
+    uint8_t *op_ptr = ptr;
+    switch (op_hdr->Op) {
+    case XAIE_IO_WRITE: {
+      auto *w_hdr = (XAie_Write32Hdr *)(ptr);
+      if (is_dma_bd_reg(w_hdr->RegOff)) {
+        bd_writes.write(w_hdr->RegOff, &w_hdr->Value, 1);
+      } else {
+        bd_writes.emit(op_ptr, w_hdr->Size);
+      }
+      ptr = ptr + w_hdr->Size;
+      break;
+    }
+    case XAIE_IO_BLOCKWRITE: {
+      auto *bw_hdr = (XAie_BlockWrite32Hdr *)(ptr);
+      const size_t num_words =
+          (bw_hdr->Size - sizeof(*bw_hdr)) / sizeof(uint32_t);
+      const uint64_t last_reg =
+          bw_hdr->RegOff + (num_words - 1) * sizeof(uint32_t);
+      if (num_words > 0 && is_dma_bd_reg(bw_hdr->RegOff) &&
+          is_dma_bd_reg(last_reg)) {
+        std::vector<uint32_t> words(num_words);
+        std::memcpy(words.data(), ptr + sizeof(*bw_hdr),
+                    num_words * sizeof(uint32_t));
+        bd_writes.write(bw_hdr->RegOff, words.data(), num_words);
+      } else {
+        bd_writes.emit(op_ptr, bw_hdr->Size);
+      }
+      ptr = ptr + bw_hdr->Size;
+      break;
+    }
+    case XAIE_IO_MASKWRITE: {
+      auto *mw_hdr = (XAie_MaskWrite32Hdr *)(ptr);
+      if (is_dma_bd_reg(mw_hdr->RegOff)) {
+        auto value = bd_writes.get(mw_hdr->RegOff);
+        if (value.has_value()) {
+          // known register : becomes a plain write of the new value
+          const uint32_t new_value =
+              (*value & ~mw_hdr->Mask) | (mw_hdr->Value & mw_hdr->Mask);
+          bd_writes.write(mw_hdr->RegOff, &new_value, 1);
+        } else {
+          bd_writes.emit(op_ptr, mw_hdr->Size);
+        }
+      } else {
+        bd_writes.emit(op_ptr, mw_hdr->Size);
+      }
+      ptr = ptr + mw_hdr->Size;
+      break;
+    }
+    case XAIE_IO_CUSTOM_OP_BEGIN + 1: {
+      // patch op writes the 2 address words of a BD at runtime
+      XAie_CustomOpHdr *hdr = (XAie_CustomOpHdr *)(ptr);
+      patch_op_t *op = (patch_op_t *)((ptr) + sizeof(*hdr));
+      bd_writes.forget(op->regaddr);
+      bd_writes.forget(op->regaddr + sizeof(uint32_t));
+      bd_writes.emit(op_ptr, hdr->Size);
+      ptr = ptr + hdr->Size;
+      break;
+    }
+    default: {
+      utils::txn_util::pass_through(&ptr);
+      bd_writes.emit(op_ptr, ptr - op_ptr);
+      break;
+    }
+    }
+  }
+  bd_writes.flush();
+
+  XAie_TxnHeader new_hdr = *Hdr;
+  new_hdr.NumOps = static_cast<uint32_t>(bd_writes.num_ops);
+  new_hdr.TxnSize = static_cast<uint32_t>(sizeof(new_hdr) + ops.size());
+  std::vector<uint8_t> txn(sizeof(new_hdr));
+  std::memcpy(txn.data(), &new_hdr, sizeof(new_hdr));
+  txn.insert(txn.end(), ops.begin(), ops.end());
+
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "Optimized txn : ops {} -> {}, size {} -> {}, dropped BD words {}",
+      num_ops, new_hdr.NumOps, base_txn.size(), txn.size(),
+      bd_writes.num_dropped_words));
+  return txn;
+}
+
 } // namespace ryzenai
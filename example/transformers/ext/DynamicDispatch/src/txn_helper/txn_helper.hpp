@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
+#include <utility>
 #include <vector>
 
 namespace ryzenai {
@@ -9,4 +11,14 @@ prepend_mtile_const_pad_txn(const std::vector<uint8_t> &base_txn,
                             const uint32_t pad_value, uint8_t num_channels,
                             uint8_t num_cols);
 
+// Maps each xrt arg idx of an op's txn to a new {xrt arg idx, offset}.
+using txn_arg_remap_t = std::map<uint32_t, std::pair<uint32_t, uint64_t>>;
+
+std::vector<uint8_t> remap_txn_args(const std::vector<uint8_t> &base_txn,
+                                    const txn_arg_remap_t &arg_remap);
+
+// Drop DMA BD register writes which rewrite the value a BD already has, and
+// merge consecutive writes to contiguous BD registers into block writes.
+std::vector<uint8_t> optimize_txn(const std::vector<uint8_t> &base_txn);
+
 } // namespace ryzenai
@@ -0,0 +1,192 @@
+// Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+
+#include <utils/event_tracer.hpp>
+#include <utils/tfuncs.hpp>
+#include <utils/utils.hpp>
+
+namespace OpsFusion {
+
+static constexpr auto DRAIN_PERIOD = std::chrono::milliseconds(50);
+
+static uint64_t get_thread_id() {
+  static std::atomic<uint64_t> next_id{1};
+  thread_local const uint64_t id =
+      next_id.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+
+static std::string escape_json(const std::string &s) {
+  std::string res;
+  res.reserve(s.size());
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      res.push_back('\\');
+      res.push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+      res += buf;
+    } else {
+      res.push_back(c);
+    }
+  }
+  return res;
+}
+
+EventTracer &EventTracer::get_instance() {
+  static EventTracer tracer;
+  return tracer;
+}
+
+EventTracer::EventTracer() {
+  auto trace_file = Utils::get_env_var("DD_TRACE_FILE");
+  if (!trace_file.empty()) {
+    enable(trace_file);
+  }
+}
+
+EventTracer::~EventTracer() {
+  disable();
+  stop_drain_thread();
+}
+
+uint32_t EventTracer::get_name_id(const std::string &name) {
+  std::lock_guard<std::mutex> lock(names_mutex_);
+  for (size_t i = 0; i < names_.size(); ++i) {
+    if (names_[i] == name) {
+      return static_cast<uint32_t>(i);
+    }
+  }
+  names_.push_back(name);
+  return static_cast<uint32_t>(names_.size() - 1);
+}
+
+void EventTracer::push(uint32_t name_id, int64_t start_ns, int64_t end_ns,
+                       uint32_t arg) {
+  const uint64_t pos = head_.fetch_add(1, std::memory_order_relaxed);
+  auto &slot = ring_[pos % RING_SIZE];
+  // seqlock : the drain thread drops the slot if seq changes while it reads
+  slot.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.start_ns.store(start_ns, std::memory_order_relaxed);
+  slot.dur_ns.store(end_ns - start_ns, std::memory_order_relaxed);
+  slot.id_arg.store(static_cast<uint64_t>(name_id) << 32 | arg,
+                    std::memory_order_relaxed);
+  slot.tid.store(get_thread_id(), std::memory_order_relaxed);
+  slot.seq.store(pos + 1, std::memory_order_release);
+}
+
+void EventTracer::enable(const std::string &trace_file) {
+  {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    if (file_.is_open()) {
+      drain();
+      file_ << "\n]\n";
+      file_.close();
+    }
+    file_.open(trace_file, std::ios::trunc);
+    DOD_THROW_IF(!file_.is_open(),
+                 OpsFusion::dod_format("Couldn't open trace file {}",
+                                       trace_file));
+    // steady_clock timestamps in us need more than the default precision
+    file_ << std::fixed << std::setprecision(3) << "[\n";
+    first_event_ = true;
+    tail_ = head_.load(std::memory_order_acquire);
+    enabled_.store(true, std::memory_order_relaxed);
+  }
+
+  std::lock_guard<std::mutex> lock(drain_mutex_);
+  if (!drain_thread_.joinable()) {
+    stop_drain_ = false;
+    drain_thread_ = std::thread(&EventTracer::drain_loop, this);
+  }
+}
+
+void EventTracer::disable() {
+  enabled_.store(false, std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(file_mutex_);
+  if (!file_.is_open()) {
+    return;
+  }
+  drain();
+  file_ << "\n]\n";
+  file_.close();
+}
+
+void EventTracer::stop_drain_thread() {
+  {
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    stop_drain_ = true;
+  }
+  drain_cv_.notify_all();
+  if (drain_thread_.joinable()) {
+    drain_thread_.join();
+  }
+}
+
+void EventTracer::drain_loop() {
+  std::unique_lock<std::mutex> lock(drain_mutex_);
+  while (!stop_drain_) {
+    drain_cv_.wait_for(lock, DRAIN_PERIOD);
+    lock.unlock();
+    {
+      std::lock_guard<std::mutex> file_lock(file_mutex_);
+      if (file_.is_open()) {
+        drain();
+        file_.flush();
+      }
+    }
+    lock.lock();
+  }
+}
+
+void EventTracer::drain() {
+  const uint64_t head = head_.load(std::memory_order_acquire);
+  if (head - tail_ > RING_SIZE) {
+    num_dropped_.fetch_add(head - tail_ - RING_SIZE,
+                           std::memory_order_relaxed);
+    tail_ = head - RING_SIZE;
+  }
+
+  const auto pid = _DD_GET_PID();
+  std::vector<std::string> names;
+  {
+    std::lock_guard<std::mutex> lock(names_mutex_);
+    names = names_;
+  }
+
+  for (; tail_ < head; ++tail_) {
+    const auto &slot = ring_[tail_ % RING_SIZE];
+    if (slot.seq.load(std::memory_order_acquire) != tail_ + 1) {
+      // still being written, next drain picks it up
+      break;
+    }
+    const auto start_ns = slot.start_ns.load(std::memory_order_relaxed);
+    const auto dur_ns = slot.dur_ns.load(std::memory_order_relaxed);
+    const auto id_arg = slot.id_arg.load(std::memory_order_relaxed);
+    const auto tid = slot.tid.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != tail_ + 1) {
+      // overwritten by a writer which wrapped around the ring
+      num_dropped_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+
+    const auto name_id = static_cast<uint32_t>(id_arg >> 32);
+    const auto arg = static_cast<uint32_t>(id_arg);
+    const std::string name =
+        name_id < names.size() ? escape_json(names[name_id]) : "unknown";
+    file_ << (first_event_ ? "" : ",\n") << "{\"name\":\"" << name
+          << "\",\"ph\":\"X\",\"pid\":" << pid
+          << ",\"tid\":" << tid << ",\"ts\":" << start_ns / 1000.0
+          << ",\"dur\":" << dur_ns / 1000.0 << ",\"args\":{\"arg\":" << arg
+          << "}}";
+    first_event_ = false;
+  }
+}
+
+} // namespace OpsFusion
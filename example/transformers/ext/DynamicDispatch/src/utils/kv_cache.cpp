@@ -0,0 +1,165 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include <cstring>
+
+#include <utils/kv_cache.hpp>
+#include <utils/logging.hpp>
+#include <utils/tfuncs.hpp>
+
+namespace ryzenai {
+namespace dynamic_dispatch {
+
+kv_cache::kv_cache(std::shared_ptr<xrt_context> ctx,
+                   const kv_cache_config &cfg)
+    : ctx_(std::move(ctx)), cfg_(cfg),
+      block_bytes_(cfg.num_heads * cfg.block_tokens * cfg.head_dim *
+                   cfg.dtype_size),
+      allocator_(cfg.block_tokens, cfg.max_blocks), bos_(cfg.num_layers) {
+  DOD_THROW_IF(ctx_ == nullptr, "kv cache : xrt context is null");
+  DOD_THROW_IF(cfg_.num_layers == 0 || cfg_.blocks_per_bo == 0 ||
+                   block_bytes_ == 0,
+               "kv cache : invalid config");
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "kv cache : layers {}, block bytes {}, max blocks {}", cfg_.num_layers,
+      block_bytes_, cfg_.max_blocks));
+}
+
+// Back the blocks handed out by the allocator with BOs, one chunk of
+// blocks_per_bo blocks per layer at a time.
+void kv_cache::grow_bos() {
+  const size_t num_blocks = allocator_.get_num_allocated_blocks();
+  const size_t bo_bytes = 2 * block_bytes_ * cfg_.blocks_per_bo;
+  while (bos_.front().size() * cfg_.blocks_per_bo < num_blocks) {
+    const size_t num_bos = bos_.size() * (bos_.front().size() + 1);
+    mem_account_.reserve("layer_bos", num_bos * bo_bytes, num_bos);
+    for (auto &layer_bos : bos_) {
+      layer_bos.emplace_back(ctx_->get_context(), bo_bytes,
+                             xrt::bo::flags::host_only,
+                             ctx_->get_kernel().group_id(0));
+    }
+    RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+        "kv cache : {} BOs of {} bytes per layer", bos_.front().size(),
+        bo_bytes));
+  }
+}
+
+size_t kv_cache::append_tokens(uint64_t seq_id, size_t num_tokens) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  const size_t pos = allocator_.get_num_tokens(seq_id);
+  allocator_.append(seq_id, num_tokens);
+  grow_bos();
+  return pos;
+}
+
+void kv_cache::write(uint64_t seq_id, size_t layer, size_t pos,
+                     size_t num_tokens, const void *k, const void *v) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  DOD_THROW_IF(layer >= cfg_.num_layers,
+               OpsFusion::dod_format("kv cache : invalid layer {}", layer));
+  const auto spans = allocator_.get_spans(seq_id, pos, num_tokens);
+  const size_t head_stride = get_head_bytes(cfg_.block_tokens);
+  const size_t src_head_stride = get_head_bytes(num_tokens);
+
+  size_t src_token = 0;
+  for (const auto &span : spans) {
+    auto bo = get_bo(layer, span.block_id);
+    auto *dst = bo.map<uint8_t *>();
+    const size_t span_bytes = get_head_bytes(span.num_tokens);
+    for (size_t kv = 0; kv < 2; ++kv) {
+      const auto *src = static_cast<const uint8_t *>(kv == 0 ? k : v);
+      const size_t base = get_bo_offset(span.block_id) + kv * block_bytes_;
+      for (size_t h = 0; h < cfg_.num_heads; ++h) {
+        const size_t dst_offset =
+            base + h * head_stride + get_head_bytes(span.slot);
+        memcpy(dst + dst_offset,
+               src + h * src_head_stride + get_head_bytes(src_token),
+               span_bytes);
+        bo.sync(XCL_BO_SYNC_BO_TO_DEVICE, span_bytes, dst_offset);
+      }
+    }
+    src_token += span.num_tokens;
+  }
+}
+
+void kv_cache::release(uint64_t seq_id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  allocator_.release(seq_id);
+}
+
+void kv_cache::truncate(uint64_t seq_id, size_t num_tokens) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  allocator_.truncate(seq_id, num_tokens);
+}
+
+size_t kv_cache::evict_oldest_blocks(uint64_t seq_id, size_t num_blocks) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return allocator_.evict_oldest_blocks(seq_id, num_blocks);
+}
+
+size_t kv_cache::get_num_tokens(uint64_t seq_id) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return allocator_.get_num_tokens(seq_id);
+}
+
+size_t kv_cache::get_num_free_blocks() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return allocator_.get_num_free_blocks();
+}
+
+std::vector<size_t> kv_cache::get_block_table(uint64_t seq_id) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return allocator_.get_block_table(seq_id);
+}
+
+uint64_t kv_cache::get_block_address(size_t layer, size_t block_id,
+                                     bool value) const {
+  return get_bo(layer, block_id).address() + get_bo_offset(block_id) +
+         (value ? block_bytes_ : 0);
+}
+
+std::vector<uint64_t> kv_cache::get_block_addresses(uint64_t seq_id,
+                                                    size_t layer,
+                                                    bool value) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  const auto &table = allocator_.get_block_table(seq_id);
+  std::vector<uint64_t> addresses;
+  addresses.reserve(table.size());
+  for (auto block_id : table) {
+    addresses.push_back(get_block_address(layer, block_id, value));
+  }
+  return addresses;
+}
+
+void kv_cache::gather(uint64_t seq_id, size_t layer, xrt::bo &k_dst,
+                      xrt::bo &v_dst, size_t dst_offset) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  const size_t num_tokens = allocator_.get_num_tokens(seq_id);
+  const auto spans = allocator_.get_spans(seq_id, 0, num_tokens);
+  const size_t head_stride = get_head_bytes(cfg_.block_tokens);
+  const size_t dst_head_stride = get_head_bytes(num_tokens);
+  DOD_THROW_IF(k_dst.size() < dst_offset + cfg_.num_heads * dst_head_stride ||
+                   v_dst.size() < dst_offset + cfg_.num_heads * dst_head_stride,
+               "kv cache : gather destination is too small");
+
+  size_t dst_token = 0;
+  for (const auto &span : spans) {
+    const auto &src = get_bo(layer, span.block_id);
+    const size_t span_bytes = get_head_bytes(span.num_tokens);
+    for (size_t kv = 0; kv < 2; ++kv) {
+      auto &dst = kv == 0 ? k_dst : v_dst;
+      const size_t base = get_bo_offset(span.block_id) + kv * block_bytes_;
+      for (size_t h = 0; h < cfg_.num_heads; ++h) {
+        dst.copy(src, span_bytes,
+                 base + h * head_stride + get_head_bytes(span.slot),
+                 dst_offset + h * dst_head_stride +
+                     get_head_bytes(dst_token));
+      }
+    }
+    dst_token += span.num_tokens;
+  }
+}
+
+} // namespace dynamic_dispatch
+} // namespace ryzenai
@@ -12,6 +12,18 @@ public:
   /// consumption etc.
   static std::string get_summary(const Metadata &meta);
 
+  /// @brief Get the sizes of the fused tensors, their padding and the live
+  /// ranges of the scratch tensors. MemoryReport::passes is left empty.
+  static MemoryReport get_memory_report(const Metadata &meta);
+
+  /// @brief Get a text chart of the live ranges of a memory report, one row
+  /// per scratch tensor, one column per width-th of the ops.
+  static std::string get_live_range_chart(const MemoryReport &report,
+                                          size_t width = 64);
+
+  /// @brief Serialize a memory report to JSON
+  static std::string to_json(const MemoryReport &report);
+
   /// @brief Get the input tensors of the metadata
   static std::vector<Tensor> get_input_tensors(const Metadata &meta);
 
@@ -40,6 +52,15 @@ public:
       const Metadata &meta, const Metadata::OpInfo &op_info,
       const std::map<std::string, void *> &const_buffer_ptrs = {});
 
+  /// @brief Get the tensor holding the data of a tensor and its offset in it.
+  /// For a tensor which is not a view, this is the tensor itself at offset 0.
+  static std::pair<std::string, size_t>
+  resolve_tensor_view(const Metadata &meta, const std::string &tensor_name);
+
+  /// @brief Place all the tensor views in meta.tensor_map at the offsets of
+  /// their base tensors. Called once the base tensors are placed.
+  static void update_tensor_views(Metadata &meta);
+
 private:
   static std::vector<Tensor> get_tensors(const Metadata &meta,
                                          OpArgMap::OpArgType arg_type);
@@ -0,0 +1,173 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include <utils/logging.hpp>
+#include <utils/npu_memory.hpp>
+#include <utils/tfuncs.hpp>
+#include <utils/utils.hpp>
+
+namespace ryzenai {
+namespace dynamic_dispatch {
+
+namespace {
+
+struct slot_info {
+  size_t num_bos = 0;
+  size_t bytes = 0;
+};
+
+struct account_info {
+  std::string owner;
+  std::map<std::string, slot_info> slots;
+  size_t num_bos = 0;
+  size_t bytes = 0;
+};
+
+struct npu_memory_state {
+  std::mutex mutex;
+  size_t budget = static_cast<size_t>(std::stoull(
+                      Utils::get_env_var("DD_NPU_MEMORY_BUDGET_MB", "0"))) *
+                  1024 * 1024;
+  size_t total_bytes = 0;
+  uint64_t next_id = 0;
+  std::unordered_map<uint64_t, account_info> accounts;
+};
+
+// Never destroyed : accounts of static objects are released at exit
+npu_memory_state &get_state() {
+  static npu_memory_state *state = new npu_memory_state();
+  return *state;
+}
+
+// Caller should hold the mutex
+std::vector<npu_memory_usage> collect_usage(const npu_memory_state &state) {
+  std::vector<npu_memory_usage> usage;
+  usage.reserve(state.accounts.size());
+  for (const auto &[id, account] : state.accounts) {
+    usage.push_back({id, account.owner, account.num_bos, account.bytes});
+  }
+  std::sort(usage.begin(), usage.end(),
+            [](const npu_memory_usage &a, const npu_memory_usage &b) {
+              return a.bytes != b.bytes ? a.bytes > b.bytes : a.id < b.id;
+            });
+  return usage;
+}
+
+std::string format_usage(const std::vector<npu_memory_usage> &usage,
+                         size_t max_accounts) {
+  std::ostringstream oss;
+  for (size_t i = 0; i < usage.size() && i < max_accounts; ++i) {
+    oss << "\n  " << usage[i].owner << "#" << usage[i].id << " : "
+        << usage[i].bytes << " B in " << usage[i].num_bos << " BOs";
+  }
+  if (usage.size() > max_accounts) {
+    oss << "\n  ... " << usage.size() - max_accounts << " more";
+  }
+  return oss.str();
+}
+
+} // namespace
+
+void npu_memory::set_budget(size_t bytes) {
+  auto &state = get_state();
+  std::lock_guard<std::mutex> guard(state.mutex);
+  state.budget = bytes;
+}
+
+size_t npu_memory::get_budget() {
+  auto &state = get_state();
+  std::lock_guard<std::mutex> guard(state.mutex);
+  return state.budget;
+}
+
+size_t npu_memory::get_total_bytes() {
+  auto &state = get_state();
+  std::lock_guard<std::mutex> guard(state.mutex);
+  return state.total_bytes;
+}
+
+std::vector<npu_memory_usage> npu_memory::get_usage() {
+  auto &state = get_state();
+  std::lock_guard<std::mutex> guard(state.mutex);
+  return collect_usage(state);
+}
+
+std::string npu_memory::get_report(size_t max_accounts) {
+  auto &state = get_state();
+  std::lock_guard<std::mutex> guard(state.mutex);
+  return OpsFusion::dod_format("npu memory : {} B in use, budget {} B",
+                               state.total_bytes, state.budget) +
+         format_usage(collect_usage(state), max_accounts);
+}
+
+npu_memory_account::npu_memory_account(const std::string &owner) {
+  auto &state = get_state();
+  std::lock_guard<std::mutex> guard(state.mutex);
+  id_ = state.next_id++;
+  state.accounts[id_].owner = owner;
+}
+
+npu_memory_account::~npu_memory_account() {
+  auto &state = get_state();
+  std::lock_guard<std::mutex> guard(state.mutex);
+  state.total_bytes -= state.accounts.at(id_).bytes;
+  state.accounts.erase(id_);
+}
+
+void npu_memory_account::reserve(const std::string &slot, size_t bytes,
+                                 size_t num_bos) {
+  auto &state = get_state();
+  std::lock_guard<std::mutex> guard(state.mutex);
+  auto &account = state.accounts.at(id_);
+  auto &info = account.slots[slot];
+  const size_t new_total = state.total_bytes - info.bytes + bytes;
+  if (state.budget != 0 && bytes > info.bytes && new_total > state.budget) {
+    if (info.num_bos == 0) {
+      account.slots.erase(slot);
+    }
+    DOD_THROW(OpsFusion::dod_format(
+                  "npu memory : {}#{} needs {} B for {}, {} B in use, budget "
+                  "{} B",
+                  account.owner, id_, bytes, slot, state.total_bytes,
+                  state.budget) +
+              format_usage(collect_usage(state), 8));
+  }
+  account.bytes = account.bytes - info.bytes + bytes;
+  account.num_bos = account.num_bos - info.num_bos + num_bos;
+  state.total_bytes = new_total;
+  info = {num_bos, bytes};
+  RYZENAI_LOG_TRACE(OpsFusion::dod_format(
+      "npu memory : {}#{} {} : {} B in {} BOs, total {} B", account.owner,
+      id_, slot, bytes, num_bos, state.total_bytes));
+}
+
+void npu_memory_account::release(const std::string &slot) {
+  auto &state = get_state();
+  std::lock_guard<std::mutex> guard(state.mutex);
+  auto &account = state.accounts.at(id_);
+  auto iter = account.slots.find(slot);
+  if (iter == account.slots.end()) {
+    return;
+  }
+  account.bytes -= iter->second.bytes;
+  account.num_bos -= iter->second.num_bos;
+  state.total_bytes -= iter->second.bytes;
+  account.slots.erase(iter);
+}
+
+npu_memory_usage npu_memory_account::get_usage() const {
+  auto &state = get_state();
+  std::lock_guard<std::mutex> guard(state.mutex);
+  const auto &account = state.accounts.at(id_);
+  return {id_, account.owner, account.num_bos, account.bytes};
+}
+
+} // namespace dynamic_dispatch
+} // namespace ryzenai
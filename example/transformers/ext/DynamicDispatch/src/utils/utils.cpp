@@ -3,8 +3,22 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 #include <unordered_map>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include <utils/utils.hpp>
 
 namespace Utils {
@@ -73,4 +87,267 @@ std::string remove_whitespaces(std::string x) {
   return x;
 }
 
+size_t get_num_threads() {
+  static const size_t num_threads = [] {
+    const auto env = get_env_var("DD_NUM_THREADS");
+    if (!env.empty()) {
+      return std::max<size_t>(1, std::stoull(env));
+    }
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+  }();
+  return num_threads;
+}
+
+// set on the workers of parallel_for, nested calls don't spawn threads
+static thread_local bool in_parallel_for = false;
+
+void parallel_for(size_t n, const std::function<void(size_t)> &fn) {
+  const size_t num_threads =
+      in_parallel_for ? 1 : std::min(get_num_threads(), n);
+  if (num_threads <= 1) {
+    for (size_t i = 0; i < n; ++i) {
+      fn(i);
+    }
+    return;
+  }
+
+  // work items are picked dynamically, their cost may vary
+  std::atomic<size_t> next{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto worker = [&]() {
+    in_parallel_for = true;
+    for (size_t i = next++; i < n; i = next++) {
+      try {
+        fn(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next = n;
+      }
+    }
+    in_parallel_for = false;
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < num_threads; ++t) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto &t : workers) {
+    t.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+static int64_t get_steady_time_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+TaskGraph::TaskId TaskGraph::add(const std::string &name,
+                                 std::function<void()> fn,
+                                 const std::vector<TaskId> &deps,
+                                 bool on_caller) {
+  const TaskId id = tasks_.size();
+  for (auto dep : deps) {
+    if (dep >= id) {
+      throw std::runtime_error("Task " + name +
+                               " depends on a task added after it");
+    }
+  }
+  tasks_.push_back({name, std::move(fn), deps, on_caller});
+  return id;
+}
+
+std::vector<TaskTime> TaskGraph::run() {
+  const size_t num_tasks = tasks_.size();
+  std::vector<TaskTime> times(num_tasks);
+  std::vector<size_t> num_pending(num_tasks);
+  std::vector<std::vector<TaskId>> dependents(num_tasks);
+  // ready tasks, the caller thread takes from both queues
+  std::deque<TaskId> caller_queue;
+  std::deque<TaskId> worker_queue;
+  size_t num_worker_tasks = 0;
+  for (TaskId id = 0; id < num_tasks; id++) {
+    const auto &task = tasks_[id];
+    times[id].name = task.name;
+    num_pending[id] = task.deps.size();
+    for (auto dep : task.deps) {
+      dependents[dep].push_back(id);
+    }
+    if (num_pending[id] == 0) {
+      (task.on_caller ? caller_queue : worker_queue).push_back(id);
+    }
+    num_worker_tasks += task.on_caller ? 0 : 1;
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  size_t num_finished = 0;
+  size_t num_running = 0;
+  std::exception_ptr error;
+  auto done = [&]() {
+    return error ? num_running == 0 : num_finished == num_tasks;
+  };
+
+  // Caller should hold lock, it is released while the task runs
+  auto run_task = [&](std::deque<TaskId> &queue, size_t thread,
+                      std::unique_lock<std::mutex> &lock) {
+    const TaskId id = queue.front();
+    queue.pop_front();
+    num_running++;
+    lock.unlock();
+    std::exception_ptr task_error;
+    times[id].thread = thread;
+    times[id].start_ns = get_steady_time_ns();
+    try {
+      tasks_[id].fn();
+    } catch (...) {
+      task_error = std::current_exception();
+    }
+    times[id].end_ns = get_steady_time_ns();
+    lock.lock();
+    num_running--;
+    num_finished++;
+    if (task_error && !error) {
+      error = task_error;
+    }
+    for (auto dependent : dependents[id]) {
+      if (--num_pending[dependent] == 0) {
+        (tasks_[dependent].on_caller ? caller_queue : worker_queue)
+            .push_back(dependent);
+      }
+    }
+    cv.notify_all();
+  };
+
+  auto worker = [&](size_t thread) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      cv.wait(lock, [&]() {
+        return done() || (!error && !worker_queue.empty());
+      });
+      if (done()) {
+        return;
+      }
+      run_task(worker_queue, thread, lock);
+    }
+  };
+
+  const size_t num_workers =
+      std::min(get_num_threads() - 1, num_worker_tasks);
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t <= num_workers; ++t) {
+    workers.emplace_back(worker, t);
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      cv.wait(lock, [&]() {
+        return done() ||
+               (!error && (!caller_queue.empty() || !worker_queue.empty()));
+      });
+      if (done()) {
+        break;
+      }
+      run_task(caller_queue.empty() ? worker_queue : caller_queue, 0, lock);
+    }
+  }
+  for (auto &t : workers) {
+    t.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return times;
+}
+
+MappedFile::MappedFile(const std::string &filename) {
+#ifdef _WIN32
+  file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("Couldn't open file for reading : " + filename);
+  }
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file_, &file_size)) {
+    CloseHandle(file_);
+    throw std::runtime_error("Couldn't get the size of file : " + filename);
+  }
+  size_ = static_cast<size_t>(file_size.QuadPart);
+  if (size_ == 0) {
+    return;
+  }
+  mapping_ = CreateFileMappingA(file_, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  void *ptr = mapping_ != nullptr
+                  ? MapViewOfFile(mapping_, FILE_MAP_COPY, 0, 0, 0)
+                  : nullptr;
+  if (ptr == nullptr) {
+    if (mapping_ != nullptr) {
+      CloseHandle(mapping_);
+    }
+    CloseHandle(file_);
+    throw std::runtime_error("Couldn't map file : " + filename);
+  }
+#else
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Couldn't open file for reading : " + filename);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("Couldn't get the size of file : " + filename);
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ == 0) {
+    close(fd);
+    return;
+  }
+  void *ptr =
+      mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    throw std::runtime_error("Couldn't map file : " + filename);
+  }
+#endif
+  data_ = static_cast<char *>(ptr);
+}
+
+void MappedFile::prefetch() const {
+  if (data_ == nullptr) {
+    return;
+  }
+#ifdef _WIN32
+  WIN32_MEMORY_RANGE_ENTRY range{data_, size_};
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+  madvise(data_, size_, MADV_WILLNEED);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(mapping_);
+  }
+  if (file_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(file_);
+  }
+#else
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+#endif
+}
+
 } // namespace Utils
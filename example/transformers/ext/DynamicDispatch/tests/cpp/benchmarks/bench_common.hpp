@@ -0,0 +1,68 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <ops/op_interface.hpp>
+
+namespace dd_bench {
+
+// Untimed runs before the measurement, the first execute() of an op loads
+// its instructions & maps its BOs
+constexpr int WARMUP_ITERS = 5;
+
+// nearest-rank percentile of sorted samples
+inline double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  auto rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+  return sorted.at(std::max<size_t>(rank, 1) - 1);
+}
+
+// Times op.execute() on each iteration of state. Besides the mean reported
+// by google benchmark, adds these counters, all in us :
+//   p50/p99     : percentiles of the execute() latency
+//   copy/sync/run_aie : mean breakdown from op.get_exec_times()
+// Register the benchmark with UseManualTime().
+template <typename Op>
+void run_op(benchmark::State &state, Op &op, std::vector<Tensor> &inputs,
+            std::vector<Tensor> &outputs) {
+  for (int i = 0; i < WARMUP_ITERS; ++i) {
+    op.execute(inputs, outputs);
+  }
+
+  std::vector<double> latencies;
+  latencies.reserve(state.max_iterations);
+  OpExecTimes total;
+  for (auto _ : state) {
+    auto start = std::chrono::steady_clock::now();
+    op.execute(inputs, outputs);
+    auto end = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(end - start).count();
+    state.SetIterationTime(elapsed);
+    latencies.push_back(elapsed * 1e6);
+
+    const auto times = op.get_exec_times();
+    total.copy += times.copy;
+    total.sync += times.sync;
+    total.run_aie += times.run_aie;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  const double num_iters = std::max<double>(latencies.size(), 1);
+  state.counters["p50_us"] = percentile(latencies, 0.50);
+  state.counters["p99_us"] = percentile(latencies, 0.99);
+  state.counters["copy_us"] = total.copy / num_iters / 1e3;
+  state.counters["sync_us"] = total.sync / num_iters / 1e3;
+  state.counters["run_aie_us"] = total.run_aie / num_iters / 1e3;
+}
+
+} // namespace dd_bench
@@ -0,0 +1,309 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+// End-to-end latency of one Llama2-7B decoder layer built from the DD ops,
+// for the prefill & the decode phase at each context length. Reports the
+// tokens/sec of a model of --layers such layers & the time per op class :
+//   qlinear_2 : w4abf16 projections (QKV, O, gate, up, down)
+//   rmsnorm   : input & post attention norms
+//   rope      : RoPE of Q & K
+//   mha       : Q.K^T, masked softmax & scores.V, including the upload of
+//               the K/V cache done at each step
+//   silu, elw : SiLU, gate * up & the residual adds
+// Ops without a kernel for a shape are reported as skipped & left out of
+// the totals, e.g. the attention kernels only cover a context of 2048.
+//
+// Usage : dd_decoder_bench [--ctx=128,2048] [--iters=10] [--layers=32]
+//         [--json=<file>]
+// Inputs & weights are zero filled, the timings don't depend on the values.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <ops/bmm/bmm.hpp>
+#include <ops/elwmul/elwmul.hpp>
+#include <ops/maskedsoftmax/maskedsoftmax.hpp>
+#include <ops/mladfadd/mladfadd.hpp>
+#include <ops/mladfmatmulbias/mladfmatmulbias.hpp>
+#include <ops/mladfmharope/mladfmharope.hpp>
+#include <ops/mladfrmsnorm/mladfrmsnorm.hpp>
+#include <ops/silu/silu.hpp>
+
+using json = nlohmann::json;
+
+using MatMulBias = ryzenai::mladfmatmulbias<int16_t, int8_t, int16_t, int16_t>;
+using RmsNorm = ryzenai::rms_norm<uint16_t, uint16_t, uint16_t>;
+using MhaRope = ryzenai::mha_rope<uint16_t, uint16_t, uint16_t>;
+using Bmm = ryzenai::bmm<uint16_t, uint16_t, uint16_t>;
+using MaskedSoftmax = ryzenai::masked_softmax<uint16_t, uint16_t, uint16_t>;
+using MladfAdd = ryzenai::mladf_add<uint16_t, uint16_t, uint16_t>;
+using ElwMul = ryzenai::elw_mul<uint16_t, uint16_t, uint16_t>;
+using Silu = ryzenai::silu<uint16_t, uint16_t>;
+
+// Llama2-7B
+constexpr size_t HIDDEN = 4096;
+constexpr size_t NUM_HEADS = 32;
+constexpr size_t HEAD_DIM = 128;
+constexpr size_t FFN = 11008;
+constexpr size_t GROUP_SIZE = 128;
+
+constexpr size_t WARMUP_ITERS = 2;
+
+struct LayerOp {
+  std::string op_class;
+  std::string name;
+  std::function<void()> run;
+};
+
+// Ops of one decoder layer for M tokens attending to ctx_len tokens
+struct DecoderLayer {
+  std::vector<std::vector<uint8_t>> buffers;
+  std::vector<LayerOp> ops;
+  // name & reason of the ops without a kernel for their shape
+  std::vector<std::pair<std::string, std::string>> skipped;
+
+  template <typename T> T *alloc(size_t num_elems) {
+    buffers.emplace_back(num_elems * sizeof(T));
+    return reinterpret_cast<T *>(buffers.back().data());
+  }
+
+  // build() creates the op & returns its execute, unsupported shapes throw
+  // from the op constructor, its const init or its first run
+  void add(const std::string &op_class, const std::string &name,
+           const std::function<std::function<void()>()> &build) {
+    try {
+      auto run = build();
+      run();
+      ops.push_back({op_class, name, std::move(run)});
+    } catch (const std::exception &e) {
+      skipped.emplace_back(name, e.what());
+    }
+  }
+
+  void add_qlinear(const std::string &name, size_t M, size_t K, size_t N) {
+    add("qlinear_2", name, [this, M, K, N]() -> std::function<void()> {
+      auto op = std::make_shared<MatMulBias>("bfloat16", "uint4", "bfloat16",
+                                             true);
+      std::vector<size_t> w_shape = {K, N};
+      std::vector<size_t> size_shape = {GROUP_SIZE, 0};
+      std::vector<Tensor> const_tensors = {
+          {alloc<int8_t>(K * N), w_shape, "uint4"},
+          {alloc<float>(N), size_shape, "bfloat16"},
+          {alloc<float>(K * N / GROUP_SIZE), size_shape, "bfloat16"},
+          {alloc<int8_t>(K * N / GROUP_SIZE), w_shape, "uint4"}};
+      op->initialize_const_params(const_tensors);
+      std::vector<Tensor> inputs = {
+          {alloc<uint16_t>(M * K), {M, K}, "bfloat16"}};
+      std::vector<Tensor> outputs = {
+          {alloc<uint16_t>(M * N), {M, N}, "bfloat16"}};
+      return [op, inputs, outputs]() mutable { op->execute(inputs, outputs); };
+    });
+  }
+
+  // bf16 ops whose output has the shape of their first input
+  template <typename Op>
+  void add_bf16_op(const std::string &op_class, const std::string &name,
+                   const std::vector<std::vector<size_t>> &shapes) {
+    add(op_class, name, [this, shapes]() -> std::function<void()> {
+      const std::string dtype = "bfloat16";
+      auto op = std::make_shared<Op>(dtype, true);
+      std::vector<Tensor> inputs;
+      for (const auto &shape : shapes) {
+        inputs.push_back({alloc<uint16_t>(num_elems(shape)), shape, dtype});
+      }
+      std::vector<Tensor> outputs = {
+          {alloc<uint16_t>(num_elems(shapes.at(0))), shapes.at(0), dtype}};
+      return [op, inputs, outputs]() mutable { op->execute(inputs, outputs); };
+    });
+  }
+
+  // [NUM_HEADS * M, K] x [NUM_HEADS * K, N], the rhs is the K/V cache, so
+  // it is uploaded on every run
+  void add_bmm(const std::string &name, size_t M, size_t K, size_t N) {
+    add("mha", name, [this, M, K, N]() -> std::function<void()> {
+      const std::string dtype = "uint16_t";
+      auto op = std::make_shared<Bmm>(dtype, dtype, dtype, false);
+      op->set_params("BMM", {NUM_HEADS * M, K});
+      std::vector<Tensor> const_tensors = {
+          {alloc<uint16_t>(NUM_HEADS * K * N), {NUM_HEADS * K, N}, dtype}};
+      std::vector<Tensor> inputs = {
+          {alloc<uint16_t>(NUM_HEADS * M * K), {NUM_HEADS * M, K}, dtype}};
+      std::vector<Tensor> outputs = {
+          {alloc<uint16_t>(NUM_HEADS * M * N), {NUM_HEADS * M, N}, dtype}};
+      return [op, const_tensors, inputs, outputs]() mutable {
+        op->initialize_const_params(const_tensors);
+        op->execute(inputs, outputs);
+      };
+    });
+  }
+
+  DecoderLayer(size_t M, size_t ctx_len) {
+    add_bf16_op<RmsNorm>("rmsnorm", "input_norm", {{M, HIDDEN}, {HIDDEN}});
+    add_qlinear("qkv_proj", M, HIDDEN, 3 * HIDDEN);
+    for (const auto *name : {"q_rope", "k_rope"}) {
+      add_bf16_op<MhaRope>("rope", name,
+                           {{NUM_HEADS, M, HEAD_DIM}, {2, M, HEAD_DIM}});
+    }
+    add_bmm("qk_bmm", M, HEAD_DIM, ctx_len);
+    add_bf16_op<MaskedSoftmax>("mha", "softmax",
+                               {{NUM_HEADS, M, ctx_len}, {1, M, ctx_len}});
+    add_bmm("sv_bmm", M, ctx_len, HEAD_DIM);
+    add_qlinear("o_proj", M, HIDDEN, HIDDEN);
+    add_bf16_op<MladfAdd>("elw", "attn_residual", {{M, HIDDEN}, {M, HIDDEN}});
+    add_bf16_op<RmsNorm>("rmsnorm", "post_attn_norm", {{M, HIDDEN}, {HIDDEN}});
+    add_qlinear("gate_proj", M, HIDDEN, FFN);
+    add_qlinear("up_proj", M, HIDDEN, FFN);
+    add_bf16_op<Silu>("silu", "silu", {{M, FFN}});
+    add_bf16_op<ElwMul>("elw", "gate_mul", {{M, FFN}, {M, FFN}});
+    add_qlinear("down_proj", M, FFN, HIDDEN);
+    add_bf16_op<MladfAdd>("elw", "mlp_residual", {{M, HIDDEN}, {M, HIDDEN}});
+  }
+
+  static size_t num_elems(const std::vector<size_t> &shape) {
+    return std::accumulate(shape.begin(), shape.end(), size_t{1},
+                           std::multiplies<size_t>());
+  }
+};
+
+struct PhaseResult {
+  std::string phase;
+  size_t ctx_len = 0;
+  size_t num_tokens = 0;
+  // mean ms per layer run
+  double layer_ms = 0;
+  double tokens_per_sec = 0;
+  std::map<std::string, double> class_ms;
+  std::vector<std::pair<std::string, std::string>> skipped;
+};
+
+static PhaseResult run_phase(const std::string &phase, size_t M,
+                             size_t ctx_len, size_t n_iters,
+                             size_t num_layers) {
+  DecoderLayer layer(M, ctx_len);
+  for (size_t i = 0; i < WARMUP_ITERS; ++i) {
+    for (auto &op : layer.ops) {
+      op.run();
+    }
+  }
+
+  PhaseResult result;
+  result.phase = phase;
+  result.ctx_len = ctx_len;
+  result.num_tokens = M;
+  for (size_t i = 0; i < n_iters; ++i) {
+    for (auto &op : layer.ops) {
+      auto start = std::chrono::steady_clock::now();
+      op.run();
+      auto end = std::chrono::steady_clock::now();
+      result.class_ms[op.op_class] +=
+          std::chrono::duration<double, std::milli>(end - start).count();
+    }
+  }
+  for (auto &[op_class, ms] : result.class_ms) {
+    ms /= n_iters;
+    result.layer_ms += ms;
+  }
+  if (result.layer_ms > 0) {
+    result.tokens_per_sec = M * 1e3 / (result.layer_ms * num_layers);
+  }
+  result.skipped = std::move(layer.skipped);
+  return result;
+}
+
+static std::vector<size_t> parse_list(const std::string &arg) {
+  std::vector<size_t> values;
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    values.push_back(std::max(1LL, std::atoll(item.c_str())));
+  }
+  return values;
+}
+
+static void print_result(const PhaseResult &result) {
+  std::cout << result.phase << " ctx=" << result.ctx_len
+            << " tokens=" << result.num_tokens
+            << " layer(ms)=" << result.layer_ms
+            << " tokens/s=" << result.tokens_per_sec << "\n";
+  for (const auto &[op_class, ms] : result.class_ms) {
+    std::cout << "  " << std::left << std::setw(10) << op_class << std::right
+              << std::setw(10) << ms << " ms " << std::setw(6)
+              << 100.0 * ms / result.layer_ms << " %\n";
+  }
+  for (const auto &[name, reason] : result.skipped) {
+    std::cout << "  [skipped] " << name << " : " << reason << "\n";
+  }
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<size_t> ctx_lens = {128, 2048};
+  size_t n_iters = 10;
+  size_t num_layers = 32;
+  std::string json_file;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto value = arg.substr(arg.find('=') + 1);
+    if (arg.rfind("--ctx=", 0) == 0) {
+      ctx_lens = parse_list(value);
+    } else if (arg.rfind("--iters=", 0) == 0) {
+      n_iters = std::max(1LL, std::atoll(value.c_str()));
+    } else if (arg.rfind("--layers=", 0) == 0) {
+      num_layers = std::max(1LL, std::atoll(value.c_str()));
+    } else if (arg.rfind("--json=", 0) == 0) {
+      json_file = value;
+    } else {
+      std::cout << "Usage : dd_decoder_bench [--ctx=128,2048] [--iters=10] "
+                   "[--layers=32] [--json=<file>]"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  json report = json::array();
+  std::cout << std::fixed << std::setprecision(2);
+  try {
+    for (auto ctx_len : ctx_lens) {
+      for (const auto &phase : {"prefill", "decode"}) {
+        const size_t M = std::string(phase) == "prefill" ? ctx_len : 1;
+        auto result = run_phase(phase, M, ctx_len, n_iters, num_layers);
+        print_result(result);
+
+        json skipped = json::array();
+        for (const auto &[name, reason] : result.skipped) {
+          skipped.push_back({{"op", name}, {"reason", reason}});
+        }
+        report.push_back({{"phase", result.phase},
+                          {"ctx_len", result.ctx_len},
+                          {"tokens", result.num_tokens},
+                          {"layers", num_layers},
+                          {"layer_ms", result.layer_ms},
+                          {"tokens_per_sec", result.tokens_per_sec},
+                          {"op_class_ms", result.class_ms},
+                          {"skipped", skipped}});
+      }
+    }
+  } catch (std::exception &e) {
+    std::cout << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!json_file.empty()) {
+    std::ofstream ofs(json_file);
+    ofs << std::setw(2) << report << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ops/ops_common/matmul_matrix.hpp"
+#include <ops/elwmul/elwmul.hpp>
+#include <ops/maskedsoftmax/maskedsoftmax.hpp>
+#include <ops/matmul/matmul.hpp>
+#include <ops/mladfadd/mladfadd.hpp>
+#include <ops/mladfmharope/mladfmharope.hpp>
+#include <ops/mladfrmsnorm/mladfrmsnorm.hpp>
+#include <ops/silu/silu.hpp>
+
+#include "bench_common.hpp"
+
+// Shapes are the ones of the unit tests of each op.
+// Use --benchmark_out=<file> --benchmark_out_format=json for the json report
+// & --benchmark_repetitions=<n> for the variance over runs.
+
+#define DD_BENCHMARK_CAPTURE(func, name, ...)                                  \
+  BENCHMARK_CAPTURE(func, name, __VA_ARGS__)                                   \
+      ->UseManualTime()                                                        \
+      ->Unit(benchmark::kMicrosecond)
+
+using MladfAdd = ryzenai::mladf_add<uint16_t, uint16_t, uint16_t>;
+using RmsNorm = ryzenai::rms_norm<uint16_t, uint16_t, uint16_t>;
+using ElwMul = ryzenai::elw_mul<uint16_t, uint16_t, uint16_t>;
+using Silu = ryzenai::silu<uint16_t, uint16_t>;
+using MaskedSoftmax = ryzenai::masked_softmax<uint16_t, uint16_t, uint16_t>;
+using MhaRope = ryzenai::mha_rope<uint16_t, uint16_t, uint16_t>;
+using MatMulA16W8 = ryzenai::matmul<uint16_t, uint8_t, uint16_t>;
+
+static size_t num_elems(const std::vector<size_t> &shape) {
+  size_t n = 1;
+  for (auto dim : shape) {
+    n *= dim;
+  }
+  return n;
+}
+
+// bf16 ops whose output has the shape of their first input
+template <typename Op>
+static void bench_bf16_op(benchmark::State &state,
+                          const std::vector<std::vector<size_t>> &shapes) {
+  const std::string dtype = "bfloat16";
+  std::vector<std::vector<uint16_t>> buffers;
+  for (const auto &shape : shapes) {
+    buffers.emplace_back(num_elems(shape));
+  }
+  std::vector<uint16_t> out(num_elems(shapes.at(0)));
+
+  std::vector<Tensor> inputs;
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    inputs.push_back({buffers[i].data(), shapes[i], dtype});
+  }
+  std::vector<Tensor> outputs = {{out.data(), shapes.at(0), dtype}};
+
+  Op op(dtype, true);
+  dd_bench::run_op(state, op, inputs, outputs);
+}
+
+static void BM_MladfAdd(benchmark::State &state, size_t M, size_t K) {
+  bench_bf16_op<MladfAdd>(state, {{M, K}, {M, K}});
+}
+
+static void BM_MladfRmsNorm(benchmark::State &state, size_t M, size_t K) {
+  bench_bf16_op<RmsNorm>(state, {{M, K}, {K}});
+}
+
+static void BM_ElwMul(benchmark::State &state, size_t M, size_t K) {
+  bench_bf16_op<ElwMul>(state, {{M, K}, {M, K}});
+}
+
+static void BM_Silu(benchmark::State &state, size_t M, size_t K) {
+  bench_bf16_op<Silu>(state, {{M, K}});
+}
+
+static void BM_MaskedSoftmax(benchmark::State &state, size_t B, size_t M,
+                             size_t K) {
+  bench_bf16_op<MaskedSoftmax>(state, {{B, M, K}, {1, M, K}});
+}
+
+static void BM_MladfMhaRope(benchmark::State &state, size_t B, size_t M,
+                            size_t K) {
+  bench_bf16_op<MhaRope>(state, {{B, M, K}, {2, M, K}});
+}
+
+static void BM_MatMulA16W8(benchmark::State &state, const std::string &model,
+                           size_t M, size_t K, size_t N) {
+  using namespace matmul_matrix;
+  std::vector<uint16_t> a(M * K);
+  std::vector<uint8_t> b(K * N);
+  std::vector<int64_t> qdq(N);
+  std::vector<int32_t> qdq_params(QDQparam_size);
+  std::vector<uint16_t> out(M * N);
+  qdq_params[qdq_isint16_idx] = 1;
+
+  MatMulA16W8 op("uint16", "uint8", "uint16", false);
+  op.set_params(model, {M, K, N});
+  std::vector<Tensor> const_tensors = {
+      {b.data(), {K, N}, "uint8"},
+      {qdq.data(), {N}, "int64"},
+      {qdq_params.data(), {static_cast<size_t>(QDQparam_size)}, "int32"}};
+  op.initialize_const_params(const_tensors);
+
+  std::vector<Tensor> inputs = {{a.data(), {M, K}, "uint16"}};
+  std::vector<Tensor> outputs = {{out.data(), {M, N}, "uint16"}};
+  dd_bench::run_op(state, op, inputs, outputs);
+}
+
+DD_BENCHMARK_CAPTURE(BM_MladfAdd, 4096x4096, 4096, 4096);
+
+DD_BENCHMARK_CAPTURE(BM_MladfRmsNorm, 2048x4096, 2048, 4096);
+
+DD_BENCHMARK_CAPTURE(BM_ElwMul, 1x11008, 1, 11008);
+DD_BENCHMARK_CAPTURE(BM_ElwMul, 128x11008, 128, 11008);
+DD_BENCHMARK_CAPTURE(BM_ElwMul, 256x11008, 256, 11008);
+DD_BENCHMARK_CAPTURE(BM_ElwMul, 512x11008, 512, 11008);
+DD_BENCHMARK_CAPTURE(BM_ElwMul, 1024x11008, 1024, 11008);
+DD_BENCHMARK_CAPTURE(BM_ElwMul, 2048x11008, 2048, 11008);
+
+DD_BENCHMARK_CAPTURE(BM_Silu, 1x11008, 1, 11008);
+DD_BENCHMARK_CAPTURE(BM_Silu, 128x11008, 128, 11008);
+DD_BENCHMARK_CAPTURE(BM_Silu, 256x11008, 256, 11008);
+DD_BENCHMARK_CAPTURE(BM_Silu, 512x11008, 512, 11008);
+DD_BENCHMARK_CAPTURE(BM_Silu, 1024x11008, 1024, 11008);
+DD_BENCHMARK_CAPTURE(BM_Silu, 2048x11008, 2048, 11008);
+
+DD_BENCHMARK_CAPTURE(BM_MaskedSoftmax, 32x2048x2048, 32, 2048, 2048);
+
+DD_BENCHMARK_CAPTURE(BM_MladfMhaRope, 32x128x128, 32, 128, 128);
+DD_BENCHMARK_CAPTURE(BM_MladfMhaRope, 32x4096x128, 32, 4096, 128);
+
+DD_BENCHMARK_CAPTURE(BM_MatMulA16W8, PSJ_128x1152x1152, "PSJ", 128, 1152,
+                     1152);
+DD_BENCHMARK_CAPTURE(BM_MatMulA16W8, PSJ_128x768x1152, "PSJ", 128, 768, 1152);
+DD_BENCHMARK_CAPTURE(BM_MatMulA16W8, PSJ_128x512x1152, "PSJ", 128, 512, 1152);
+DD_BENCHMARK_CAPTURE(BM_MatMulA16W8, PSJ_128x768x768, "PSJ", 128, 768, 768);
+DD_BENCHMARK_CAPTURE(BM_MatMulA16W8, PSJ_128x3072x768, "PSJ", 128, 3072, 768);
+DD_BENCHMARK_CAPTURE(BM_MatMulA16W8, PSJ_128x768x128, "PSJ", 128, 768, 128);
+DD_BENCHMARK_CAPTURE(BM_MatMulA16W8, PSJ_128x768x3072, "PSJ", 128, 768, 3072);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,243 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+// Throughput scaling of concurrent FusionRuntime::execute().
+// Sweeps threads x runtimes x hw contexts for each graph and reports the
+// aggregate inferences/sec & client latency percentiles. Thread t runs on
+// runtime t % runtimes, runtimes lease their hw context round-robin from a
+// pool of the given size.
+// "lock_wait" is the mean client latency minus the mean of the runtime's
+// "execute" histogram, which starts once execute_mutex_ is held. It is the
+// time threads spent queued on the runtime.
+//
+// Usage : dd_scaling_bench <xclbin> <meta.json>... [--threads=1,2,4]
+//         [--runtimes=1,2] [--contexts=1,2] [--iters=100] [--json=<file>]
+// Graphs are the meta jsons generated by the model.py of the fusion tests,
+// e.g. matmul6, single_mha, xcom_conv2d. Inputs are zero filled.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <op_fuser/fusion_rt.hpp>
+#include <utils/meta_utils.hpp>
+#include <utils/utils.hpp>
+#include <xrt_context/xrt_context.hpp>
+
+#include "bench_common.hpp"
+
+using json = nlohmann::json;
+
+constexpr size_t WARMUP_ITERS = 5;
+
+struct ScalingConfig {
+  size_t num_threads;
+  size_t num_runtimes;
+  size_t num_contexts;
+};
+
+struct ScalingResult {
+  double inferences_per_sec = 0;
+  double p50_us = 0;
+  double p99_us = 0;
+  double p999_us = 0;
+  double mean_us = 0;
+  double lock_wait_us = 0;
+};
+
+// Owned buffers for the inputs/outputs of a graph, one set per thread
+struct IOBuffers {
+  std::vector<std::vector<uint8_t>> data;
+  std::vector<Tensor> inputs;
+  std::vector<Tensor> outputs;
+
+  explicit IOBuffers(const OpsFusion::Metadata &meta) {
+    inputs = OpsFusion::MetaUtils::get_input_tensors(meta);
+    outputs = OpsFusion::MetaUtils::get_output_tensors(meta);
+    data.reserve(inputs.size() + outputs.size());
+    for (auto *tensors : {&inputs, &outputs}) {
+      for (auto &tensor : *tensors) {
+        const size_t num_elems =
+            std::accumulate(tensor.shape.begin(), tensor.shape.end(),
+                            size_t{1}, std::multiplies<size_t>());
+        data.emplace_back(num_elems * Utils::get_size_of_type(tensor.dtype));
+        tensor.data = data.back().data();
+      }
+    }
+  }
+};
+
+static std::vector<size_t> parse_list(const std::string &arg) {
+  std::vector<size_t> values;
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    values.push_back(std::max(1LL, std::atoll(item.c_str())));
+  }
+  return values;
+}
+
+static ScalingResult run_config(const std::string &xclbin,
+                                const OpsFusion::Metadata &meta,
+                                const ScalingConfig &config, size_t n_iters) {
+  ryzenai::dynamic_dispatch::xrt_context::configure_pool(xclbin,
+                                                         config.num_contexts);
+  std::vector<std::unique_ptr<OpsFusion::FusionRuntime>> runtimes;
+  for (size_t i = 0; i < config.num_runtimes; ++i) {
+    runtimes.push_back(std::make_unique<OpsFusion::FusionRuntime>(xclbin));
+    runtimes.back()->init(meta);
+  }
+
+  std::vector<IOBuffers> buffers;
+  buffers.reserve(config.num_threads);
+  for (size_t i = 0; i < config.num_threads; ++i) {
+    buffers.emplace_back(meta);
+  }
+  for (auto &rt : runtimes) {
+    for (size_t i = 0; i < WARMUP_ITERS; ++i) {
+      rt->execute(buffers[0].inputs, buffers[0].outputs);
+    }
+    rt->reset_latency_stats();
+  }
+
+  std::vector<std::vector<double>> latencies(config.num_threads);
+  std::vector<std::thread> workers;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < config.num_threads; ++t) {
+    workers.emplace_back([&, t]() {
+      auto &rt = *runtimes.at(t % runtimes.size());
+      auto &thread_latencies = latencies[t];
+      thread_latencies.reserve(n_iters);
+      for (size_t i = 0; i < n_iters; ++i) {
+        auto req_start = std::chrono::steady_clock::now();
+        rt.execute(buffers[t].inputs, buffers[t].outputs);
+        auto req_end = std::chrono::steady_clock::now();
+        thread_latencies.push_back(
+            std::chrono::duration<double, std::micro>(req_end - req_start)
+                .count());
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  std::vector<double> all_latencies;
+  for (const auto &thread_latencies : latencies) {
+    all_latencies.insert(all_latencies.end(), thread_latencies.begin(),
+                         thread_latencies.end());
+  }
+  std::sort(all_latencies.begin(), all_latencies.end());
+
+  ScalingResult result;
+  const double elapsed = std::chrono::duration<double>(end - start).count();
+  result.inferences_per_sec = all_latencies.size() / elapsed;
+  result.p50_us = dd_bench::percentile(all_latencies, 0.50);
+  result.p99_us = dd_bench::percentile(all_latencies, 0.99);
+  result.p999_us = dd_bench::percentile(all_latencies, 0.999);
+  result.mean_us =
+      std::accumulate(all_latencies.begin(), all_latencies.end(), 0.0) /
+      std::max<size_t>(all_latencies.size(), 1);
+
+  double exec_ns = 0;
+  uint64_t exec_count = 0;
+  for (const auto &rt : runtimes) {
+    const auto stats = rt->get_latency_stats().at("execute");
+    exec_ns += stats.mean_ns * stats.count;
+    exec_count += stats.count;
+  }
+  const double exec_mean_us = exec_ns / std::max<uint64_t>(exec_count, 1) / 1e3;
+  result.lock_wait_us = std::max(0.0, result.mean_us - exec_mean_us);
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<std::string> positional;
+  std::vector<size_t> thread_counts = {1, 2, 4};
+  std::vector<size_t> runtime_counts = {1, 2};
+  std::vector<size_t> context_counts = {1, 2};
+  size_t n_iters = 100;
+  std::string json_file;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto value = arg.substr(arg.find('=') + 1);
+    if (arg.rfind("--threads=", 0) == 0) {
+      thread_counts = parse_list(value);
+    } else if (arg.rfind("--runtimes=", 0) == 0) {
+      runtime_counts = parse_list(value);
+    } else if (arg.rfind("--contexts=", 0) == 0) {
+      context_counts = parse_list(value);
+    } else if (arg.rfind("--iters=", 0) == 0) {
+      n_iters = std::max(1LL, std::atoll(value.c_str()));
+    } else if (arg.rfind("--json=", 0) == 0) {
+      json_file = value;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.size() < 2) {
+    std::cout << "Usage : dd_scaling_bench <xclbin> <meta.json>... "
+                 "[--threads=1,2,4] [--runtimes=1,2] [--contexts=1,2] "
+                 "[--iters=100] [--json=<file>]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const auto &xclbin = positional[0];
+  json report = json::array();
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "graph threads runtimes contexts inf/s p50(us) p99(us) "
+               "p999(us) lock_wait(us)\n";
+  try {
+    for (size_t g = 1; g < positional.size(); ++g) {
+      const auto &meta_json = positional[g];
+      auto meta = OpsFusion::load_meta_json(meta_json);
+      for (auto num_contexts : context_counts) {
+        for (auto num_runtimes : runtime_counts) {
+          for (auto num_threads : thread_counts) {
+            const ScalingConfig config{num_threads, num_runtimes,
+                                       num_contexts};
+            auto result = run_config(xclbin, meta, config, n_iters);
+            std::cout << meta_json << " " << num_threads << " "
+                      << num_runtimes << " " << num_contexts << " "
+                      << result.inferences_per_sec << " " << result.p50_us
+                      << " " << result.p99_us << " " << result.p999_us << " "
+                      << result.lock_wait_us << std::endl;
+            report.push_back({{"graph", meta_json},
+                              {"threads", num_threads},
+                              {"runtimes", num_runtimes},
+                              {"contexts", num_contexts},
+                              {"inferences_per_sec", result.inferences_per_sec},
+                              {"p50_us", result.p50_us},
+                              {"p99_us", result.p99_us},
+                              {"p999_us", result.p999_us},
+                              {"mean_us", result.mean_us},
+                              {"lock_wait_us", result.lock_wait_us}});
+          }
+        }
+      }
+    }
+  } catch (std::exception &e) {
+    std::cout << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!json_file.empty()) {
+    std::ofstream ofs(json_file);
+    ofs << std::setw(2) << report << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
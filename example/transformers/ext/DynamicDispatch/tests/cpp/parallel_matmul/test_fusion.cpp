@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <iostream>
 #include <op_fuser/fusion_rt.hpp>
+#include <op_fuser/parallel_fusion_rt.hpp>
 #include <utils/meta_utils.hpp>
 #include <utils/utils.hpp>
 
@@ -254,6 +255,23 @@ static int test_matmul(const std::string &meta_json, size_t M, size_t K,
   std::cout << "err_count second matmul: " << err_count << std::endl;
 #endif
 
+  // Run the two matmuls concurrently, on a hw context each
+  OpsFusion::ParallelFusionRuntime parallel_rt(xclbin_fname, 2);
+  parallel_rt.init(meta);
+  std::cout << "parallel subgraphs: " << parallel_rt.get_num_subgraphs()
+            << std::endl;
+
+  std::fill(c.begin(), c.end(), garbage_value);
+  std::fill(f.begin(), f.end(), garbage_value);
+  parallel_rt.execute(input_Tensors, output_Tensors);
+
+  err_count += check_result(abc_cpu_Y_qdq, abc_aie_Y);
+  std::cout << "err_count parallel first matmul: " << err_count << std::endl;
+#ifndef ONE_MATMUL
+  err_count += check_result(def_cpu_Y_qdq, def_aie_Y);
+  std::cout << "err_count parallel second matmul: " << err_count << std::endl;
+#endif
+
   return err_count;
 }
 
@@ -0,0 +1,190 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+// Runs an execution captured with DDConfig::capture_dir (or DD_CAPTURE_DIR)
+// standalone, in a loop, to triage a perf regression without the
+// application. Reports the latency stats of the loop next to the captured
+// ones, and checks the outputs of the first run against the captured
+// outputs. With --timers, the RECORD_TIMER dump of the runs of a bundle
+// captured at profile level >= 1 is mapped back to the graph. --dump writes
+// the internal buffers after the first run, see unpack_internal_buffers().
+//
+// Usage : dd_replay --capture=<dir> --xclbin=<file> [--kernel=DPU]
+//         [--iters=100] [--warmup=5] [--timers=<file>] [--dump=<dir>]
+//         [--json=<file>]
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <op_fuser/fusion_rt.hpp>
+
+using json = nlohmann::json;
+
+static json to_json(const OpsFusion::LatencyStats &stats) {
+  return {{"count", stats.count},     {"min_ns", stats.min_ns},
+          {"max_ns", stats.max_ns},   {"mean_ns", stats.mean_ns},
+          {"p50_ns", stats.p50_ns},   {"p99_ns", stats.p99_ns},
+          {"p999_ns", stats.p999_ns}};
+}
+
+static void
+print_latency(const std::map<std::string, OpsFusion::LatencyStats> &captured,
+              const std::map<std::string, OpsFusion::LatencyStats> &replayed) {
+  std::cout << std::left << std::setw(32) << "latency (us)" << std::right
+            << std::setw(14) << "captured mean" << std::setw(12) << "mean"
+            << std::setw(12) << "p50" << std::setw(12) << "p99" << "\n";
+  for (const auto &[name, stats] : replayed) {
+    auto iter = captured.find(name);
+    std::cout << std::left << std::setw(32) << name << std::right
+              << std::setw(14)
+              << (iter != captured.end() ? iter->second.mean_ns / 1e3 : 0.0)
+              << std::setw(12) << stats.mean_ns / 1e3 << std::setw(12)
+              << stats.p50_ns / 1e3 << std::setw(12) << stats.p99_ns / 1e3
+              << "\n";
+  }
+}
+
+int main(int argc, char *argv[]) {
+  std::string capture_dir;
+  std::string xclbin;
+  std::string kernel_prefix = "DPU";
+  std::string timers_file;
+  std::string dump_dir;
+  std::string json_file;
+  size_t n_iters = 100;
+  size_t n_warmup = 5;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto value = arg.substr(arg.find('=') + 1);
+    if (arg.rfind("--capture=", 0) == 0) {
+      capture_dir = value;
+    } else if (arg.rfind("--xclbin=", 0) == 0) {
+      xclbin = value;
+    } else if (arg.rfind("--kernel=", 0) == 0) {
+      kernel_prefix = value;
+    } else if (arg.rfind("--iters=", 0) == 0) {
+      n_iters = std::max(1LL, std::atoll(value.c_str()));
+    } else if (arg.rfind("--warmup=", 0) == 0) {
+      n_warmup = std::max(0LL, std::atoll(value.c_str()));
+    } else if (arg.rfind("--timers=", 0) == 0) {
+      timers_file = value;
+    } else if (arg.rfind("--dump=", 0) == 0) {
+      dump_dir = value;
+    } else if (arg.rfind("--json=", 0) == 0) {
+      json_file = value;
+    } else {
+      capture_dir.clear();
+      break;
+    }
+  }
+  if (capture_dir.empty() || xclbin.empty()) {
+    std::cout << "Usage : dd_replay --capture=<dir> --xclbin=<file> "
+                 "[--kernel=DPU] [--iters=100] [--warmup=5] "
+                 "[--timers=<file>] [--dump=<dir>] [--json=<file>]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  json report;
+  std::cout << std::fixed << std::setprecision(2);
+  try {
+    OpsFusion::FusionRuntime rt(xclbin, kernel_prefix);
+    auto record = rt.init_capture(capture_dir);
+
+    std::vector<Tensor> inputs;
+    for (auto &input : record.inputs) {
+      inputs.push_back({input.data.data(), input.shape, input.dtype});
+    }
+    std::vector<std::vector<uint8_t>> output_data;
+    std::vector<Tensor> outputs;
+    for (const auto &output : record.outputs) {
+      output_data.emplace_back(output.data.size());
+      outputs.push_back(
+          {output_data.back().data(), output.shape, output.dtype});
+    }
+
+    rt.execute(inputs, outputs);
+    if (!dump_dir.empty()) {
+      rt.unpack_internal_buffers(dump_dir);
+    }
+    size_t n_mismatch = 0;
+    for (size_t i = 0; i < outputs.size(); ++i) {
+      if (output_data[i] != record.outputs[i].data) {
+        std::cout << "Output " << i << " differs from the captured one"
+                  << std::endl;
+        n_mismatch++;
+      }
+    }
+
+    for (size_t i = 0; i < n_warmup; ++i) {
+      rt.execute(inputs, outputs);
+    }
+    rt.reset_latency_stats();
+    for (size_t i = 0; i < n_iters; ++i) {
+      rt.execute(inputs, outputs);
+    }
+    const auto latency = rt.get_latency_stats();
+    std::cout << "Replayed " << capture_dir << " " << n_iters
+              << " times, profile level " << record.profile << "\n";
+    print_latency(record.latency, latency);
+
+    json device_js = json::array();
+    if (!timers_file.empty()) {
+      const auto records = OpsFusion::read_timer_records(timers_file);
+      std::cout << std::left << std::setw(48) << "device (cycles)"
+                << std::right << std::setw(8) << "runs" << std::setw(14)
+                << "mean" << std::setw(12) << "min" << std::setw(12) << "max"
+                << "\n";
+      for (const auto &time : rt.get_device_op_times(records)) {
+        std::cout << std::left << std::setw(48) << time.name << std::right
+                  << std::setw(8) << time.num_runs << std::setw(14)
+                  << time.mean_cycles << std::setw(12) << time.min_cycles
+                  << std::setw(12) << time.max_cycles << "\n";
+        device_js.push_back({{"name", time.name},
+                             {"type", time.type},
+                             {"shape", time.shape},
+                             {"dtype", time.dtype},
+                             {"num_runs", time.num_runs},
+                             {"mean_cycles", time.mean_cycles},
+                             {"min_cycles", time.min_cycles},
+                             {"max_cycles", time.max_cycles}});
+      }
+    }
+
+    json captured_js, replayed_js;
+    for (const auto &[name, stats] : record.latency) {
+      captured_js[name] = to_json(stats);
+    }
+    for (const auto &[name, stats] : latency) {
+      replayed_js[name] = to_json(stats);
+    }
+    report = {{"capture", capture_dir},
+              {"iters", n_iters},
+              {"output_mismatches", n_mismatch},
+              {"captured_latency", captured_js},
+              {"latency", replayed_js},
+              {"device", device_js}};
+    if (n_mismatch != 0) {
+      std::cout << n_mismatch << " outputs differ from the captured ones"
+                << std::endl;
+    }
+  } catch (std::exception &e) {
+    std::cout << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!json_file.empty()) {
+    std::ofstream ofs(json_file);
+    ofs << std::setw(2) << report << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
@@ -118,6 +118,16 @@ int test_elwadd(const std::string &meta_json, size_t M, size_t K,
 
   err_count = check_add_result_bfloat16<OuT>(cpu_out, aie_out, b_shape);
 
+  // Run again, writing inputs directly into the runtime's buffers
+  auto input_views = rt.get_input_views();
+  auto output_views = rt.get_output_views();
+  memcpy(input_views[0].data, a.data(), a.size() * sizeof(InT));
+  memcpy(input_views[1].data, b.data(), b.size() * sizeof(InT));
+  rt.execute(input_views, output_views);
+  memcpy(aie_out.data(), output_views[0].data, aie_out.size() * sizeof(OuT));
+
+  err_count += check_add_result_bfloat16<OuT>(cpu_out, aie_out, b_shape);
+
   size_t my_cnt = 0;
   float max_error = 0;
   for (int i = 0; i < cpu_out.size(); ++i) {
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <iostream>
 #include <op_fuser/fusion_rt.hpp>
+#include <op_fuser/fusion_scheduler.hpp>
 #include <utils/meta_utils.hpp>
 #include <utils/utils.hpp>
 
@@ -141,6 +142,134 @@ static int test_matmul(const std::string &meta_json, size_t M, size_t K,
 
   err_count = check_result(cpu_Y_qdq, aie_Y);
 
+  // The memory report accounts for the BOs of the model
+  {
+    const auto report = rt.get_memory_report();
+    size_t total_size = 0;
+    for (const auto &buffer : report.buffers) {
+      total_size += MAP_AT(rt.get_meta().fused_tensors, buffer.name).size;
+      // scratch tensors share space, only the live ones have to fit
+      const size_t used = buffer.name == "scratch" ? report.peak_live_size
+                                                   : buffer.tensor_size;
+      if (used + buffer.padding_size > buffer.size) {
+        std::cout << "Memory report : " << buffer.name << " holds " << used
+                  << " B in " << buffer.size << " B" << std::endl;
+        err_count++;
+      }
+    }
+    if (total_size != report.total_size || report.passes.empty() ||
+        report.passes.back().num_ops != report.num_ops) {
+      std::cout << "Memory report doesn't match the metadata\n"
+                << OpsFusion::MetaUtils::to_json(report) << std::endl;
+      err_count++;
+    }
+  }
+
+  // Run the same inference through the async API
+  std::fill(aie_out.begin(), aie_out.end(), garbage_value);
+  auto req = rt.submit(input_Tensor, output_Tensor);
+  rt.wait(req);
+
+  err_count += check_result(cpu_Y_qdq, aie_Y);
+
+  // Re-upload the weights through update_consts() and run again
+  {
+    std::map<std::string, Tensor> new_consts;
+    for (const auto &[name, tinfo] : meta.tensor_map) {
+      const std::string wts_suffix = "/0.const";
+      if (tinfo.parent_name == "const" &&
+          tinfo.file_name.size() >= wts_suffix.size() &&
+          tinfo.file_name.compare(tinfo.file_name.size() - wts_suffix.size(),
+                                  wts_suffix.size(), wts_suffix) == 0) {
+        new_consts[name] = {b.data(), tinfo.shape, tinfo.dtype};
+      }
+    }
+    rt.update_consts(new_consts);
+    std::fill(aie_out.begin(), aie_out.end(), garbage_value);
+    rt.execute(input_Tensor, output_Tensor);
+    err_count += check_result(cpu_Y_qdq, aie_Y);
+  }
+
+  // Run a few concurrent requests through the scheduler
+  {
+    constexpr size_t n_reqs = 4;
+    OpsFusion::SchedulerConfig sched_cfg;
+    sched_cfg.num_runtimes = 2;
+    sched_cfg.max_batch_size = 2;
+    sched_cfg.max_queue_delay = std::chrono::microseconds(500);
+    OpsFusion::FusionScheduler scheduler(xclbin_fname, meta, "", {},
+                                         sched_cfg);
+
+    std::vector<std::vector<OuT>> sched_outs(
+        n_reqs, std::vector<OuT>(M * N, garbage_value));
+    std::vector<std::future<void>> futs;
+    for (auto &sched_out : sched_outs) {
+      futs.push_back(scheduler.enqueue(
+          input_Tensor, {{sched_out.data(), aie_out_shape, c_dtype}}));
+    }
+    for (size_t i = 0; i < n_reqs; i++) {
+      futs[i].get();
+      RowMajorMatrix<OuT> sched_Y(M, N, sched_outs[i].data());
+      err_count += check_result(cpu_Y_qdq, sched_Y);
+    }
+  }
+
+  // Init through the compiled model cache, 1st init populates it and 2nd
+  // init loads from it
+  {
+    OpsFusion::DDConfig cache_cfg;
+    cache_cfg.cache_dir = "test_single_matmul_cache";
+    for (int i = 0; i < 2; i++) {
+      OpsFusion::FusionRuntime cached_rt(xclbin_fname);
+      cached_rt.init(meta, "", cache_cfg);
+      std::fill(aie_out.begin(), aie_out.end(), garbage_value);
+      cached_rt.execute(input_Tensor, output_Tensor);
+      err_count += check_result(cpu_Y_qdq, aie_Y);
+    }
+  }
+
+  // Capture an execution and replay it from the bundle alone
+  {
+    OpsFusion::DDConfig capture_cfg;
+    capture_cfg.capture_dir = "test_single_matmul_capture";
+    OpsFusion::FusionRuntime capture_rt(xclbin_fname);
+    capture_rt.init(meta, "", capture_cfg);
+    capture_rt.execute(input_Tensor, output_Tensor);
+
+    OpsFusion::FusionRuntime replay_rt(xclbin_fname);
+    auto record = replay_rt.init_capture(capture_cfg.capture_dir);
+    std::vector<Tensor> replay_inputs;
+    for (auto &input : record.inputs) {
+      replay_inputs.push_back({input.data.data(), input.shape, input.dtype});
+    }
+    std::fill(aie_out.begin(), aie_out.end(), garbage_value);
+    replay_rt.execute(replay_inputs, output_Tensor);
+    err_count += check_result(cpu_Y_qdq, aie_Y);
+  }
+
+  // Create the runtime while the metadata is parsed, every step of the
+  // startup is in its timeline
+  {
+    auto created_rt = OpsFusion::FusionRuntime::create(xclbin_fname, meta_json);
+    std::fill(aie_out.begin(), aie_out.end(), garbage_value);
+    created_rt->execute(input_Tensor, output_Tensor);
+    err_count += check_result(cpu_Y_qdq, aie_Y);
+
+    const auto steps = created_rt->get_startup_timeline();
+    for (const std::string name : {"hw_context", "load_meta", "passes",
+                                   "consts", "xrt_runs"}) {
+      auto iter = std::find_if(
+          steps.begin(), steps.end(),
+          [&](const Utils::TaskTime &step) { return step.name == name; });
+      if (iter == steps.end() || iter->start_ns < 0 ||
+          iter->end_ns < iter->start_ns) {
+        std::cout << "Startup step " << name << " missing\n"
+                  << created_rt->get_startup_report() << std::endl;
+        err_count++;
+      }
+    }
+  }
+
   return err_count;
 }
 
@@ -114,6 +114,57 @@ int test_bmm(int M, int K, int N, int B = 32, bool debug = false,
   return err_count;
 }
 
+// The weight is a [B, R, C] view into a cache of max_rows rows per batch,
+// read in place through the "strides" attr
+template <typename InT = uint16_t, typename WgT = uint16_t,
+          typename OuT = uint16_t>
+int test_bmm_strided(int M, int K, int N, int B, int max_rows,
+                     bool trans = true,
+                     const std::string &model_name = "BMM") {
+  int BM = M * B;
+  size_t R = trans ? N : K;
+  size_t C = trans ? K : N;
+  std::vector<size_t> a_shape = {size_t(BM), size_t(K)};
+  std::vector<size_t> view_shape = {size_t(B), R, C};
+  std::vector<size_t> strides = {max_rows * C, C};
+  std::vector<size_t> aie_out_shape = {size_t(BM), size_t(N)};
+  std::vector<InT> a(BM * K);
+  std::vector<WgT> cache(B * max_rows * C);
+  std::vector<WgT> b(B * K * N);
+  std::vector<uint16_t> cpu_out(BM * N);
+  std::vector<OuT> aie_out(BM * N, garbage_value);
+
+  srand(0xABCD);
+  dd::initialize_random_bfloat16(a, 1.5);
+  dd::initialize_random_bfloat16(cache, 1.5);
+  for (int i = 0; i < B; i++) {
+    memcpy(b.data() + i * R * C, cache.data() + i * strides[0],
+           R * C * sizeof(WgT));
+  }
+
+  ryzenai::bmm bmm_ =
+      ryzenai::bmm<InT, WgT, OuT>("uint16_t", "uint16_t", "uint16_t", false);
+  bmm_.set_params(model_name, a_shape);
+  std::vector<Tensor> const_Tensor = {
+      {cache.data(), view_shape, "uint16_t"}};
+  std::map<std::string, std::any> attr = {{"strides", strides}};
+  bmm_.initialize_const_params(const_Tensor, attr);
+  std::vector<Tensor> input_Tensor = {{a.data(), a_shape, "uint16_t"}};
+  std::vector<Tensor> output_Tensor = {
+      {aie_out.data(), aie_out_shape, "uint16_t"}};
+  bmm_.execute(input_Tensor, output_Tensor);
+
+  for (int i = 0; i < B; i++) {
+    RowMajorMatrix<InT> XX(M, K, a.data() + i * M * K);
+    RowMajorMatrix<WgT> WW(R, C, b.data() + i * K * N);
+    RowMajorMatrix<uint16_t> cpu_YY(M, N, cpu_out.data() + i * M * N);
+    cpu_bmm<RowMajorMatrix<InT>, RowMajorMatrix<WgT>, RowMajorMatrix<OuT>>(
+        XX, WW, cpu_YY, trans);
+  }
+  return check_add_result_bfloat16<OuT>(cpu_out, aie_out, aie_out_shape,
+                                        0.75);
+}
+
 // BMM a16w16
 TEST(BMM_Testa16w16_2048_128_2048A, Kernel1) {
   int err_count = test_bmm<uint16_t, uint16_t, uint16_t>(
@@ -145,3 +196,17 @@ TEST(BMM_Testa16w16_2048_2048_128B, Kernel4) {
       false);
   EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
 }
+
+// BMM a16w16, K^T read from a 4096 row cache
+TEST(BMM_Testa16w16_2048_128_2048_Strided, Kernel1) {
+  int err_count = test_bmm_strided<uint16_t, uint16_t, uint16_t>(
+      2048, 128, 2048, 32, 4096, true, "BMM");
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
+
+// BMM a16w16, V read from a 4096 row cache
+TEST(BMM_Testa16w16_2048_2048_128_Strided, Kernel3) {
+  int err_count = test_bmm_strided<uint16_t, uint16_t, uint16_t>(
+      2048, 2048, 128, 32, 4096, false, "BMM");
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
@@ -22,16 +22,22 @@ int test_elwmul(size_t M, size_t K, bool debug = false,
                 const std::string &a_dtype = "bfloat16",
                 const std::string &b_dtype = "bfloat16",
                 const std::string &c_dtype = "bfloat16",
-                const std::string &model_name = "LLAMA2") {
+                const std::string &model_name = "LLAMA2",
+                std::vector<size_t> b_shape = {}) {
   int err_count = 0;
   size_t Ms = static_cast<size_t>(M);
   size_t Ks = static_cast<size_t>(K);
 
   std::vector<size_t> a_shape = {Ms, Ks};
-  std::vector<size_t> b_shape = {Ms, Ks};
+  // b of [1, K], [M, 1] or [1, 1] is broadcast to a
+  if (b_shape.empty()) {
+    b_shape = a_shape;
+  }
+  const size_t b_rows = b_shape.at(0);
+  const size_t b_cols = b_shape.at(1);
 
   std::vector<LhsT> a(M * K);
-  std::vector<LhsT> b(M * K);
+  std::vector<LhsT> b(b_rows * b_cols);
   std::vector<float> cpu_out(M * K);
   std::vector<OuT> aie_out(M * K, garbage_value);
 
@@ -42,7 +48,8 @@ int test_elwmul(size_t M, size_t K, bool debug = false,
   for (int r = 0; r < M; r++) {
     for (int c = 0; c < K; c++) {
       cpu_out.at(r * K + c) = bfloat16_to_float(a.at(r * K + c)) *
-                              bfloat16_to_float(b.at(r * K + c));
+                              bfloat16_to_float(b.at((r % b_rows) * b_cols +
+                                                     (c % b_cols)));
     }
   }
   ryzenai::elw_mul elwmul_ = ryzenai::elw_mul<LhsT, RhsT, OuT>(a_dtype, true);
@@ -51,7 +58,7 @@ int test_elwmul(size_t M, size_t K, bool debug = false,
   std::vector<Tensor> input_Tensor;
 
   struct Tensor a_T = {a.data(), a_shape, a_dtype};
-  struct Tensor b_T = {b.data(), a_shape, a_dtype};
+  struct Tensor b_T = {b.data(), b_shape, a_dtype};
   struct Tensor c_T = {aie_out.data(), a_shape, c_dtype};
   input_Tensor.push_back(a_T);
   input_Tensor.push_back(b_T);
@@ -104,3 +111,20 @@ TEST(LLAMA2_ELWMUL_Testa16, Kernel1x11008) {
       1, 11008, false, "bfloat16", "bfloat16", "bfloat16", "LLAMA2");
   EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
 }
+TEST(LLAMA2_ELWMUL_Testa16, Kernel128x11008PerChannel) {
+  int err_count = test_elwmul<uint16_t, uint16_t, uint16_t>(
+      128, 11008, false, "bfloat16", "bfloat16", "bfloat16", "LLAMA2",
+      {1, 11008});
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
+TEST(LLAMA2_ELWMUL_Testa16, Kernel128x11008PerRow) {
+  int err_count = test_elwmul<uint16_t, uint16_t, uint16_t>(
+      128, 11008, false, "bfloat16", "bfloat16", "bfloat16", "LLAMA2",
+      {128, 1});
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
+TEST(LLAMA2_ELWMUL_Testa16, Kernel128x11008Scalar) {
+  int err_count = test_elwmul<uint16_t, uint16_t, uint16_t>(
+      128, 11008, false, "bfloat16", "bfloat16", "bfloat16", "LLAMA2", {1, 1});
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
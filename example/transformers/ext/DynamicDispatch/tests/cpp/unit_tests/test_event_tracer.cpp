@@ -0,0 +1,80 @@
+// Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <utils/event_tracer.hpp>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+static json read_trace(const std::string &path) {
+  std::ifstream ifs(path);
+  return json::parse(ifs);
+}
+
+TEST(EventTracer, WritesChromeTrace) {
+  auto path = (fs::temp_directory_path() / "dd_test_trace.json").string();
+  auto &tracer = OpsFusion::EventTracer::get_instance();
+  const auto exec_id = tracer.get_name_id("test_execute");
+  const auto part_id = tracer.get_name_id("test_partition");
+  EXPECT_EQ(tracer.get_name_id("test_execute"), exec_id);
+
+  tracer.enable(path);
+  ASSERT_TRUE(tracer.enabled());
+  tracer.record(exec_id, 1000000, 3500000);
+  std::thread worker([&]() { tracer.record(part_id, 2000000, 2500000, 7); });
+  worker.join();
+  tracer.disable();
+  EXPECT_FALSE(tracer.enabled());
+
+  auto events = read_trace(path);
+  fs::remove(path);
+  ASSERT_EQ(events.size(), 2);
+  EXPECT_EQ(events[0].at("name"), "test_execute");
+  EXPECT_EQ(events[0].at("ph"), "X");
+  EXPECT_DOUBLE_EQ(events[0].at("ts").get<double>(), 1000.0);
+  EXPECT_DOUBLE_EQ(events[0].at("dur").get<double>(), 2500.0);
+  EXPECT_EQ(events[1].at("name"), "test_partition");
+  EXPECT_EQ(events[1].at("args").at("arg"), 7);
+  EXPECT_NE(events[0].at("tid"), events[1].at("tid"));
+}
+
+TEST(EventTracer, IgnoresEventsWhenDisabled) {
+  auto path = (fs::temp_directory_path() / "dd_test_trace_off.json").string();
+  auto &tracer = OpsFusion::EventTracer::get_instance();
+  const auto id = tracer.get_name_id("test_event");
+  tracer.record(id, 0, 10);
+
+  tracer.enable(path);
+  tracer.disable();
+  tracer.record(id, 0, 10);
+
+  EXPECT_TRUE(read_trace(path).empty());
+  fs::remove(path);
+}
+
+TEST(EventTracer, DropsOldestEventsOnOverflow) {
+  auto path = (fs::temp_directory_path() / "dd_test_trace_drop.json").string();
+  auto &tracer = OpsFusion::EventTracer::get_instance();
+  const auto id = tracer.get_name_id("test_event");
+  const auto dropped = tracer.get_num_dropped();
+  const size_t num_events = 3 * OpsFusion::EventTracer::RING_SIZE;
+
+  tracer.enable(path);
+  for (size_t i = 0; i < num_events; ++i) {
+    tracer.record(id, i * 1000, i * 1000 + 1);
+  }
+  tracer.disable();
+
+  auto events = read_trace(path);
+  fs::remove(path);
+  // drain thread might have written some events before the ring wrapped
+  EXPECT_GE(events.size(), OpsFusion::EventTracer::RING_SIZE);
+  EXPECT_EQ(events.size() + tracer.get_num_dropped() - dropped, num_events);
+}
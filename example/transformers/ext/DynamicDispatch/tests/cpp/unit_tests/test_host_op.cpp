@@ -0,0 +1,66 @@
+// Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "ops/host_op/host_op.hpp"
+#include "ops/op_builder.hpp"
+
+static void add_kernel(const std::vector<Tensor> &inputs,
+                       std::vector<Tensor> &outputs,
+                       const std::map<std::string, std::any> &attr) {
+  const auto *a = static_cast<const float *>(inputs.at(0).data);
+  const auto *b = static_cast<const float *>(inputs.at(1).data);
+  auto *c = static_cast<float *>(outputs.at(0).data);
+  for (size_t i = 0; i < outputs.at(0).shape.at(0); i++) {
+    c[i] = a[i] + b[i];
+  }
+}
+
+TEST(HostOp, IsSupportedOnceRegistered) {
+  std::map<std::string, std::any> attr{
+      {"kernel", std::vector<std::string>{"test_unregistered"}}};
+  EXPECT_FALSE(OpsFusion::OpBuilder::is_supported(OpsFusion::HOST_OP_TYPE,
+                                                  {"float32"}, attr));
+  ryzenai::register_host_kernel("test_unregistered", add_kernel);
+  EXPECT_TRUE(ryzenai::is_host_kernel_registered("test_unregistered"));
+  EXPECT_TRUE(OpsFusion::OpBuilder::is_supported(OpsFusion::HOST_OP_TYPE,
+                                                 {"float32"}, attr));
+}
+
+TEST(HostOp, BufferReqs) {
+  ryzenai::register_host_kernel("test_add", add_kernel);
+  ryzenai::host_op op({{"kernel", std::string("test_add")}});
+  std::vector<Tensor> tensors{{nullptr, {4, 8}, "bfloat16"},
+                              {nullptr, {4, 8}, "bfloat16"},
+                              {nullptr, {4}, "float32"}};
+  auto reqs = op.get_buffer_reqs(tensors, tensors, op.get_attr());
+  ASSERT_EQ(reqs.size(), 3);
+  EXPECT_EQ(reqs[0].arg_type, OpArgMap::OpArgType::INPUT);
+  EXPECT_EQ(reqs[1].arg_type, OpArgMap::OpArgType::INPUT);
+  EXPECT_EQ(reqs[2].arg_type, OpArgMap::OpArgType::OUTPUT);
+  EXPECT_EQ(reqs[0].size, 64);
+  EXPECT_EQ(reqs[2].size, 16);
+  EXPECT_EQ(reqs[2].onnx_arg_idx, 2);
+
+  std::map<std::string, std::any> attr{
+      {"kernel", std::string("test_add")},
+      {"num_inputs", std::vector<int>{1}}};
+  reqs = op.get_buffer_reqs(tensors, tensors, attr);
+  EXPECT_EQ(reqs[1].arg_type, OpArgMap::OpArgType::OUTPUT);
+
+  attr["num_inputs"] = std::vector<int>{4};
+  EXPECT_THROW(op.get_buffer_reqs(tensors, tensors, attr), std::runtime_error);
+}
+
+TEST(HostOp, Execute) {
+  ryzenai::register_host_kernel("test_add", add_kernel);
+  ryzenai::host_op op({{"kernel", std::string("test_add")}});
+  std::vector<float> a{1, 2, 3}, b{10, 20, 30}, c(3);
+  std::vector<Tensor> inputs{{a.data(), {3}, "float32"},
+                             {b.data(), {3}, "float32"}};
+  std::vector<Tensor> outputs{{c.data(), {3}, "float32"}};
+  op.execute(inputs, outputs);
+  EXPECT_EQ(c, (std::vector<float>{11, 22, 33}));
+}
@@ -0,0 +1,86 @@
+// Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include <utils/kv_cache.hpp>
+
+using ryzenai::dynamic_dispatch::kv_block_allocator;
+
+TEST(KVBlockAllocator, AppendSpansBlocks) {
+  kv_block_allocator alloc(4, 8);
+  auto spans = alloc.append(0, 6);
+  ASSERT_EQ(spans.size(), 2);
+  EXPECT_EQ(spans[0].slot, 0);
+  EXPECT_EQ(spans[0].num_tokens, 4);
+  EXPECT_EQ(spans[1].slot, 0);
+  EXPECT_EQ(spans[1].num_tokens, 2);
+  EXPECT_EQ(alloc.get_num_tokens(0), 6);
+  EXPECT_EQ(alloc.get_block_table(0).size(), 2);
+  EXPECT_EQ(alloc.get_num_free_blocks(), 6);
+
+  // decode step fills the partial block before taking a new one
+  spans = alloc.append(0, 1);
+  ASSERT_EQ(spans.size(), 1);
+  EXPECT_EQ(spans[0].block_id, alloc.get_block_table(0).at(1));
+  EXPECT_EQ(spans[0].slot, 2);
+  EXPECT_EQ(alloc.get_block_table(0).size(), 2);
+}
+
+TEST(KVBlockAllocator, ReleaseReusesBlocks) {
+  kv_block_allocator alloc(4, 4);
+  alloc.append(0, 8);
+  alloc.append(1, 8);
+  EXPECT_EQ(alloc.get_num_free_blocks(), 0);
+  EXPECT_THROW(alloc.append(2, 1), std::runtime_error);
+  EXPECT_EQ(alloc.get_num_tokens(2), 0);
+
+  alloc.release(0);
+  EXPECT_EQ(alloc.get_num_free_blocks(), 2);
+  alloc.append(2, 5);
+  EXPECT_EQ(alloc.get_num_allocated_blocks(), 4);
+  EXPECT_EQ(alloc.get_num_free_blocks(), 0);
+}
+
+TEST(KVBlockAllocator, FailedAppendKeepsSequence) {
+  kv_block_allocator alloc(4, 2);
+  alloc.append(0, 3);
+  EXPECT_THROW(alloc.append(0, 8), std::runtime_error);
+  EXPECT_EQ(alloc.get_num_tokens(0), 3);
+  EXPECT_EQ(alloc.get_block_table(0).size(), 1);
+}
+
+TEST(KVBlockAllocator, Truncate) {
+  kv_block_allocator alloc(4, 8);
+  alloc.append(0, 10);
+  alloc.truncate(0, 5);
+  EXPECT_EQ(alloc.get_num_tokens(0), 5);
+  EXPECT_EQ(alloc.get_block_table(0).size(), 2);
+  EXPECT_EQ(alloc.get_num_free_blocks(), 6);
+  alloc.truncate(0, 0);
+  EXPECT_EQ(alloc.get_block_table(0).size(), 0);
+  EXPECT_EQ(alloc.get_num_free_blocks(), 8);
+}
+
+TEST(KVBlockAllocator, EvictOldestBlocks) {
+  kv_block_allocator alloc(4, 8);
+  alloc.append(0, 10);
+  auto table = alloc.get_block_table(0);
+  EXPECT_EQ(alloc.evict_oldest_blocks(0, 1), 4);
+  EXPECT_EQ(alloc.get_num_tokens(0), 6);
+  ASSERT_EQ(alloc.get_block_table(0).size(), 2);
+  EXPECT_EQ(alloc.get_block_table(0).at(0), table.at(1));
+
+  auto spans = alloc.get_spans(0, 0, 6);
+  ASSERT_EQ(spans.size(), 2);
+  EXPECT_EQ(spans[1].block_id, table.at(2));
+  EXPECT_EQ(spans[1].num_tokens, 2);
+}
+
+TEST(KVBlockAllocator, Errors) {
+  EXPECT_THROW(kv_block_allocator(0, 8), std::invalid_argument);
+  kv_block_allocator alloc(4, 8);
+  EXPECT_THROW(alloc.get_block_table(3), std::out_of_range);
+  alloc.append(3, 2);
+  EXPECT_THROW(alloc.get_spans(3, 1, 2), std::out_of_range);
+}
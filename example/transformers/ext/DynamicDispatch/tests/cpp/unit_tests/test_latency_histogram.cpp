@@ -0,0 +1,68 @@
+// Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include <utils/latency_histogram.hpp>
+
+using OpsFusion::LatencyHistogram;
+
+TEST(LatencyHistogram, Empty) {
+  LatencyHistogram hist;
+  auto stats = hist.get_stats();
+  EXPECT_EQ(stats.count, 0);
+  EXPECT_EQ(stats.p50_ns, 0);
+  EXPECT_EQ(stats.p999_ns, 0);
+}
+
+TEST(LatencyHistogram, SmallValuesAreExact) {
+  LatencyHistogram hist;
+  for (int64_t i = 1; i <= 10; i++) {
+    hist.record(i);
+  }
+  auto stats = hist.get_stats();
+  EXPECT_EQ(stats.count, 10);
+  EXPECT_EQ(stats.min_ns, 1);
+  EXPECT_EQ(stats.max_ns, 10);
+  EXPECT_DOUBLE_EQ(stats.mean_ns, 5.5);
+  EXPECT_EQ(stats.p50_ns, 5);
+  EXPECT_EQ(stats.p99_ns, 10);
+}
+
+TEST(LatencyHistogram, PercentilesWithinPrecision) {
+  LatencyHistogram hist;
+  for (int64_t i = 1; i <= 100000; i++) {
+    hist.record(i * 1000);
+  }
+  auto stats = hist.get_stats();
+  EXPECT_EQ(stats.count, 100000);
+  EXPECT_NEAR(stats.p50_ns, 50000000, 50000000 / 16);
+  EXPECT_NEAR(stats.p99_ns, 99000000, 99000000 / 16);
+  EXPECT_NEAR(stats.p999_ns, 99900000, 99900000 / 16);
+  EXPECT_LE(stats.p999_ns, stats.max_ns);
+}
+
+TEST(LatencyHistogram, ConcurrentRecord) {
+  LatencyHistogram hist;
+  constexpr int n_threads = 4;
+  constexpr int n_iters = 10000;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < n_threads; t++) {
+    workers.emplace_back([&hist]() {
+      for (int i = 0; i < n_iters; i++) {
+        hist.record(100);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  auto stats = hist.get_stats();
+  EXPECT_EQ(stats.count, n_threads * n_iters);
+  EXPECT_EQ(stats.min_ns, 100);
+  EXPECT_EQ(stats.max_ns, 100);
+
+  hist.reset();
+  EXPECT_EQ(hist.get_stats().count, 0);
+}
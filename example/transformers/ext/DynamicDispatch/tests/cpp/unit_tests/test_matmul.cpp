@@ -327,6 +327,13 @@ TEST(PSJ_GEMM_Testa16w8, Kernel7) {
   EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
 }
 
+// M not in the shape table, tiled over the supported kernel M's
+TEST(PSJ_GEMM_Testa16w8, DynamicM) {
+  int err_count = test_matmul<uint16_t, uint8_t, uint16_t>(
+      200, 768, 1152, 0, false, "uint16", "uint8", "uint16", "PSJ");
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
+
 // PSH
 TEST(PSH_GEMM_Testa16w8, Kernel11) {
   int err_count = test_matmul<uint16_t, uint8_t, uint16_t>(
@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iostream>
+
+#include "enable_perf.hpp"
+#include "ops/ops_common/help_file.hpp"
+#include "ops/ops_common/matmul_a16w4_mladf_matrix.hpp"
+#include <ops/matmul_a16w4_mladf/matmul_a16w4_mladf.hpp>
+
+#include "test_common.hpp"
+using namespace matmul_a16w4_mladf_matrix;
+
+template <typename InT = uint16_t, typename WgT = uint8_t,
+          typename OuT = uint16_t>
+int test_matmul_a16w4_mladf(int M, int K, int N, int group_size,
+                            const uint32_t sv_M, const uint32_t sv_K,
+                            const uint32_t sv_N, const int32_t shift_gemm_out,
+                            const int32_t shift_qdq_out, bool debug = false,
+                            const std::string &a_dtype = "uint16",
+                            const std::string &b_dtype = "uint4",
+                            const std::string &c_dtype = "uint16",
+                            const std::string &model_name = "LLAMA2") {
+  int err_count = 0;
+  const std::string rtp_dtype = "uint32";
+  size_t Ms = static_cast<size_t>(M);
+  size_t Ks = static_cast<size_t>(K);
+  size_t Ns = static_cast<size_t>(N);
+  size_t Gs = static_cast<size_t>(K / group_size);
+  std::vector<size_t> a_shape = {Ms, Ks};
+  std::vector<size_t> b_shape = {Ks, Ns};
+  std::vector<size_t> rtp_shape = {16};
+  std::vector<size_t> qdq_shape = {Ns};
+  std::vector<size_t> group_shape = {Gs, Ns};
+  std::vector<size_t> aie_out_shape = {Ms, Ns};
+
+  std::vector<InT> a(M * K);
+  std::vector<WgT> b(K * N);
+  std::vector<uint32_t> rtp(16);
+  std::vector<int64_t> qdq(N); // c0
+  std::vector<int32_t> c1(Gs * N);
+  std::vector<int32_t> c2(Gs * N);
+  std::vector<OuT> cpu_out(M * N);
+  std::vector<OuT> aie_out(M * N, garbage_value);
+
+  RowMajorMatrix<InT> X(M, K, a.data());
+  RowMajorMatrix<WgT> W(K, N, b.data());
+  RowMajorMatrix<OuT> cpu_Y(M, N, cpu_out.data());
+  RowMajorMatrix<OuT> aie_Y(M, N, aie_out.data());
+
+  srand(0xABCD);
+  init_random(X, 0, 4);
+  // uint4 weights, one per byte
+  init_random(W, 0, 16);
+  // c0 offsets the c1 terms, so the output stays positive
+  initialize_random<int64_t>(qdq, N, 6 * K + 64, 6 * K);
+  // per group scale and zero point, c1 = -zero_point * c2
+  for (size_t i = 0; i < c2.size(); i++) {
+    int32_t zero_point = rand() % 2;
+    c2[i] = 1 + rand() % 2;
+    c1[i] = -zero_point * c2[i];
+  }
+
+  rtp = {sv_M,
+         sv_K,
+         sv_N,
+         0x2000,
+         0x6000,
+         0x3800,
+         static_cast<uint32_t>(K / sv_K),
+         static_cast<uint32_t>(shift_qdq_out),
+         static_cast<uint32_t>(shift_gemm_out),
+         static_cast<uint32_t>(group_size),
+         0,
+         0,
+         0,
+         0,
+         0,
+         0};
+
+  cpu_qdq_matmul(X, W, cpu_Y, qdq, c1, c2, group_size, shift_gemm_out,
+                 shift_qdq_out);
+
+  ryzenai::matmul_a16w4_mladf matmul_a16w4_mladf_ =
+      ryzenai::matmul_a16w4_mladf<InT, WgT, OuT>(a_dtype, b_dtype, c_dtype,
+                                                 false);
+  matmul_a16w4_mladf_.debug(debug);
+  matmul_a16w4_mladf_.set_params(model_name, a_shape);
+  std::vector<Tensor> const_Tensor;
+  const_Tensor = {{b.data(), b_shape, b_dtype},
+                  {qdq.data(), qdq_shape, "int64"},
+                  {c1.data(), group_shape, "int32"},
+                  {c2.data(), group_shape, "int32"}};
+  matmul_a16w4_mladf_.initialize_const_params(const_Tensor);
+
+  std::vector<Tensor> input_Tensor;
+  input_Tensor = {{rtp.data(), rtp_shape, rtp_dtype},
+                  {a.data(), a_shape, a_dtype}};
+
+  std::vector<Tensor> output_Tensor;
+  output_Tensor = {{aie_out.data(), aie_out_shape, c_dtype}};
+
+#ifdef UNIT_TEST_PERF
+  LOG_THIS("M = " << M << ", K = " << K << ", N = " << N
+                  << ", group_size = " << group_size);
+  PROFILE_THIS(matmul_a16w4_mladf_.execute(input_Tensor, output_Tensor));
+#else
+  matmul_a16w4_mladf_.execute(input_Tensor, output_Tensor);
+#endif
+
+  err_count = check_result(cpu_Y, aie_Y);
+
+  return err_count;
+}
+
+// LLAMA2 a16w4
+TEST(LLAMA2_GEMM_Testa16w4, Kernel1x4096x4096) {
+  int err_count = test_matmul_a16w4_mladf<uint16_t, uint8_t, uint16_t>(
+      1, 4096, 4096, 128, 16, 128, 16, 0, 8, false, "uint16", "uint4",
+      "uint16", "LLAMA2");
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
+
+TEST(LLAMA2_GEMM_Testa16w4, Kernel128x4096x11008) {
+  int err_count = test_matmul_a16w4_mladf<uint16_t, uint8_t, uint16_t>(
+      128, 4096, 11008, 128, 16, 128, 16, 0, 8, false, "uint16", "uint4",
+      "uint16", "LLAMA2");
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
+
+TEST(LLAMA2_GEMM_Testa16w4, Kernel100x11008x4096Grp32) {
+  int err_count = test_matmul_a16w4_mladf<uint16_t, uint8_t, uint16_t>(
+      100, 11008, 4096, 32, 16, 128, 16, 0, 8, false, "uint16", "uint4",
+      "uint16", "LLAMA2");
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
@@ -0,0 +1,87 @@
+// Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <op_fuser/meta_bin.hpp>
+
+namespace fs = std::filesystem;
+
+static OpsFusion::Metadata make_meta() {
+  OpsFusion::Metadata meta;
+  OpsFusion::Metadata::OpInfo op_info;
+  op_info.name = "matmul_0";
+  op_info.type = "MatMul";
+  op_info.args = {"in", "wts", "out"};
+  op_info.attr["input_shape"] = std::any(std::vector<int>{1, 64, -3});
+  op_info.attr["scale"] = std::any(std::vector<float>{0.5f, 1.25f});
+  op_info.attr["design_param"] = std::any(std::vector<std::string>{"4x4"});
+  meta.op_list.push_back(op_info);
+
+  meta.fused_tensors["in"] = {128, 0, {"in"}};
+  meta.fused_tensors["const"] = {4096, 2, {"wts"}};
+  meta.tensor_map["in"] = {"in", 0, 0, "uint16", {1, 64}, 128, "", 0, 0};
+  meta.tensor_map["wts"] = {"const", 64, 2,      "uint8", {64, 64},
+                            4096,    "wts.bin", 4096, 256};
+
+  std::map<std::string, Tensor> outputs;
+  outputs["out"] = {nullptr, {1, 64}, "uint16"};
+  meta.aux_info["original_outputs"] = std::any(outputs);
+  return meta;
+}
+
+TEST(MetaBin, RoundTrip) {
+  auto path = (fs::temp_directory_path() / "dd_test_meta.bin").string();
+  OpsFusion::save_meta_bin(make_meta(), path);
+  ASSERT_TRUE(OpsFusion::is_meta_bin(path));
+  auto meta = OpsFusion::load_meta_bin(path);
+  fs::remove(path);
+
+  ASSERT_EQ(meta.op_list.size(), 1);
+  const auto &op_info = meta.op_list[0];
+  EXPECT_EQ(op_info.name, "matmul_0");
+  EXPECT_EQ(op_info.type, "MatMul");
+  EXPECT_EQ(op_info.args, (std::vector<std::string>{"in", "wts", "out"}));
+  EXPECT_EQ(std::any_cast<std::vector<int>>(op_info.attr.at("input_shape")),
+            (std::vector<int>{1, 64, -3}));
+  EXPECT_EQ(std::any_cast<std::vector<float>>(op_info.attr.at("scale")),
+            (std::vector<float>{0.5f, 1.25f}));
+  EXPECT_EQ(std::any_cast<std::vector<std::string>>(
+                op_info.attr.at("design_param")),
+            (std::vector<std::string>{"4x4"}));
+
+  EXPECT_EQ(meta.fused_tensors.at("const").size, 4096);
+  EXPECT_EQ(meta.fused_tensors.at("const").arg_idx, 2);
+  const auto &wts = meta.tensor_map.at("wts");
+  EXPECT_EQ(wts.parent_name, "const");
+  EXPECT_EQ(wts.offset, 64);
+  EXPECT_EQ(wts.shape, (std::vector<size_t>{64, 64}));
+  EXPECT_EQ(wts.file_name, "wts.bin");
+  EXPECT_EQ(wts.file_offset, 256);
+
+  const auto &outputs = std::any_cast<
+      const std::map<std::string, Tensor> &>(
+      meta.aux_info.at("original_outputs"));
+  EXPECT_EQ(outputs.at("out").shape, (std::vector<size_t>{1, 64}));
+  EXPECT_EQ(outputs.at("out").dtype, "uint16");
+  EXPECT_EQ(meta.json_path, path);
+}
+
+TEST(MetaBin, RejectsTruncatedFile) {
+  auto path = (fs::temp_directory_path() / "dd_test_meta_trunc.bin").string();
+  OpsFusion::save_meta_bin(make_meta(), path);
+  fs::resize_file(path, fs::file_size(path) - 5);
+  EXPECT_ANY_THROW(OpsFusion::load_meta_bin(path));
+  fs::remove(path);
+}
+
+TEST(MetaBin, DetectsJson) {
+  auto path = (fs::temp_directory_path() / "dd_test_meta.json").string();
+  std::ofstream(path) << "{\"op_list\": []}";
+  EXPECT_FALSE(OpsFusion::is_meta_bin(path));
+  fs::remove(path);
+}
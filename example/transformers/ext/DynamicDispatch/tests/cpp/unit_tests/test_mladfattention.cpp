@@ -0,0 +1,73 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include <cmath>
+#include <gtest/gtest.h>
+#include <iostream>
+
+#include <ops/mladfattention/mladfattention.hpp>
+
+#include "enable_perf.hpp"
+
+#include "test_common.hpp"
+
+using attention_t = ryzenai::mladf_attention<int16_t, int8_t, int16_t>;
+
+// Q/K/V weights are zero, so the scores are uniform and every output row is
+// the mean of V rows, i.e. the V bias.
+int test_mladfattention(size_t M, float v_bias, bool debug = false,
+                        const std::string &a_dtype = "bfloat16",
+                        const std::string &b_dtype = "uint4",
+                        int group_size = 128) {
+  const size_t E = attention_t::NUM_HEADS * attention_t::HEAD_DIM;
+  const size_t D = attention_t::HEAD_DIM;
+
+  std::vector<uint16_t> x(M * E, dd::float_to_bfloat16(1.0f));
+  std::vector<uint16_t> trig(2 * M * D, dd::float_to_bfloat16(1.0f));
+  std::vector<uint16_t> mask(M * M, dd::float_to_bfloat16(0.0f));
+
+  std::vector<int8_t> wts(E * E, 0);
+  std::vector<int8_t> zeros(E * E / group_size, 0);
+  std::vector<float> scales(E * E / group_size, 1.0f);
+  std::vector<float> qk_bias(E, 0.0f);
+  std::vector<float> v_bias_vec(E, v_bias);
+
+  std::vector<size_t> w_shape = {E, E};
+  std::vector<size_t> size_shape = {static_cast<size_t>(group_size), 0};
+  std::vector<Tensor> const_Tensor;
+  for (auto *bias : {&qk_bias, &qk_bias, &v_bias_vec}) {
+    const_Tensor.push_back({wts.data(), w_shape, b_dtype});
+    const_Tensor.push_back({bias->data(), size_shape, a_dtype});
+    const_Tensor.push_back({scales.data(), size_shape, a_dtype});
+    const_Tensor.push_back({zeros.data(), w_shape, b_dtype});
+  }
+
+  std::vector<uint16_t> aie_out(M * E, garbage_value);
+  std::vector<float> cpu_float(M * E, v_bias);
+
+  std::vector<size_t> x_shape = {1, M, E};
+  std::vector<Tensor> input_Tensor = {{x.data(), x_shape, a_dtype},
+                                      {trig.data(), {2, M, D}, a_dtype},
+                                      {mask.data(), {1, M, M}, a_dtype}};
+  std::vector<Tensor> output_Tensor = {{aie_out.data(), x_shape, a_dtype}};
+
+  attention_t attention_(a_dtype, b_dtype, true);
+  attention_.debug(debug);
+  attention_.initialize_const_params(const_Tensor);
+#ifdef UNIT_TEST_PERF
+  LOG_THIS("M = " << M << ", E = " << E);
+  PROFILE_THIS(attention_.execute(input_Tensor, output_Tensor));
+#else
+  attention_.execute(input_Tensor, output_Tensor);
+#endif
+
+  return dd::count_errors_floatvsbfloat16(cpu_float, aie_out, x_shape,
+                                          0.0625f);
+}
+
+// MLADFATTENTION
+TEST(LLAMA2_MLADFATTENTION_Testa16w4, Kernel2048x4096) {
+  int err_count = test_mladfattention(attention_t::SEQ_LEN, 1.0f);
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
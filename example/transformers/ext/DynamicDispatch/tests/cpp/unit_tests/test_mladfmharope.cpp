@@ -77,6 +77,47 @@ int test_mladfmharope(size_t B, size_t M, size_t K, bool debug = false,
   return err_count;
 }
 
+// ifm = all ones, trig matrices generated by the op
+// ==> Rope = cos - sin for the first half, cos + sin for the second half
+int test_mladfmharope_trig_table(size_t B, size_t M, size_t K,
+                                 size_t max_seq_len, int64_t pos_offset,
+                                 const std::string &a_dtype = "bfloat16") {
+  const float base = 10000.0f;
+  std::vector<size_t> a_shape = {B, M, K};
+  std::vector<uint16_t> a(B * M * K, dd::float_to_bfloat16(1.0f));
+  std::vector<float> cpu_float(B * M * K, 0.0f);
+  for (size_t b = 0; b < B; ++b) {
+    for (size_t m = 0; m < M; ++m) {
+      const size_t pos = pos_offset + m;
+      for (size_t k = 0; k < K; ++k) {
+        if (pos >= max_seq_len) {
+          continue;
+        }
+        const double theta = std::pow((double)base, -2.0 * (k % (K / 2)) / K);
+        const float angle = (float)(pos * theta);
+        cpu_float.at((b * M + m) * K + k) =
+            k < K / 2 ? std::cos(angle) - std::sin(angle)
+                      : std::cos(angle) + std::sin(angle);
+      }
+    }
+  }
+
+  std::vector<uint16_t> aie_out(B * M * K, garbage_value);
+  ryzenai::mha_rope mladfmharope_ =
+      ryzenai::mha_rope<uint16_t, uint16_t, uint16_t>(a_dtype, true);
+  std::vector<Tensor> const_Tensor;
+  std::vector<Tensor> input_Tensor = {{a.data(), a_shape, a_dtype}};
+  std::vector<Tensor> output_Tensor = {{aie_out.data(), a_shape, a_dtype}};
+
+  mladfmharope_.initialize_const_params(const_Tensor);
+  mladfmharope_.set_trig_table(max_seq_len, base);
+  mladfmharope_.set_position_offset(pos_offset);
+  mladfmharope_.execute(input_Tensor, output_Tensor);
+
+  return dd::count_errors_floatvsbfloat16(cpu_float, aie_out, a_shape,
+                                          0.0625f);
+}
+
 // MLADFMHAROPE
 TEST(LLAMA2_MLADFMHAROPE_Testa16, Kernel32x4096x128) {
   int err_count = test_mladfmharope<uint16_t, uint16_t, uint16_t>(
@@ -88,3 +129,11 @@ TEST(LLAMA2_MLADFMHAROPE_Testa16, Kernel32x128x128) {
       32, 128, 128, false, "bfloat16", "bfloat16", "bfloat16", "LLAMA2");
   EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
 }
+TEST(LLAMA2_MLADFMHAROPE_Testa16, TrigTable32x128x128) {
+  int err_count = test_mladfmharope_trig_table(32, 128, 128, 4096, 0);
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
+TEST(LLAMA2_MLADFMHAROPE_Testa16, TrigTableOffset32x128x128) {
+  int err_count = test_mladfmharope_trig_table(32, 128, 128, 1024, 960);
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
@@ -87,3 +87,50 @@ TEST(C4PSR_NNI_RESIZE_a16acc16, Kernel3) {
       16, 16, 1280, false, "uint16", "uint16", "4x4PSR");
   EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
 }
+
+static std::vector<OpArgMap>
+get_nni_resize_reqs(const std::vector<size_t> &a_shape,
+                    const std::vector<size_t> &c_shape) {
+  std::map<std::string, std::any> attr;
+  attr["design_param"] = std::vector<string>{"4x4"};
+  ryzenai::nni_resize<uint16_t, uint16_t> nni_resize_("uint16", "uint16", false,
+                                                      attr);
+  std::vector<Tensor> tensors = {{nullptr, a_shape, "uint16"},
+                                 {nullptr, {16}, "uint16"},
+                                 {nullptr, c_shape, "uint16"}};
+  return nni_resize_.get_buffer_reqs(tensors, tensors);
+}
+
+static size_t get_req_size(const std::vector<OpArgMap> &reqs,
+                           OpArgMap::OpArgType arg_type) {
+  for (const auto &req : reqs) {
+    if (req.arg_type == arg_type) {
+      return req.size;
+    }
+  }
+  return 0;
+}
+
+// H is tiled in row slabs of the 8x8x1280 kernel
+TEST(C4PSR_NNI_RESIZE_a16acc16, TiledRows) {
+  auto reqs = get_nni_resize_reqs({24, 8, 1280}, {48, 16, 1280});
+  EXPECT_EQ(get_req_size(reqs, OpArgMap::OpArgType::INPUT),
+            24 * 8 * 1280 * sizeof(uint16_t));
+  EXPECT_EQ(get_req_size(reqs, OpArgMap::OpArgType::OUTPUT),
+            48 * 16 * 1280 * sizeof(uint16_t));
+  EXPECT_EQ(get_req_size(reqs, OpArgMap::OpArgType::SCRATCH_PAD), size_t(0));
+}
+
+// 4x runs the 8x8x1280 and 16x16x1280 kernels through the scratch pad
+TEST(C4PSR_NNI_RESIZE_a16acc16, Scale4) {
+  auto reqs = get_nni_resize_reqs({8, 8, 1280}, {32, 32, 1280});
+  EXPECT_EQ(get_req_size(reqs, OpArgMap::OpArgType::OUTPUT),
+            32 * 32 * 1280 * sizeof(uint16_t));
+  EXPECT_EQ(get_req_size(reqs, OpArgMap::OpArgType::SCRATCH_PAD),
+            16 * 16 * 1280 * sizeof(uint16_t));
+}
+
+TEST(C4PSR_NNI_RESIZE_a16acc16, UnsupportedScale) {
+  EXPECT_ANY_THROW(get_nni_resize_reqs({8, 8, 1280}, {24, 24, 1280}));
+  EXPECT_ANY_THROW(get_nni_resize_reqs({8, 8, 1280}, {16, 8, 1280}));
+}
@@ -0,0 +1,54 @@
+// Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+#include <gtest/gtest.h>
+
+#include <utils/npu_memory.hpp>
+
+using ryzenai::dynamic_dispatch::npu_memory;
+using ryzenai::dynamic_dispatch::npu_memory_account;
+
+TEST(NpuMemory, ReserveReplacesSlot) {
+  const size_t base = npu_memory::get_total_bytes();
+  {
+    npu_memory_account account("test");
+    account.reserve("input_bo", 4096);
+    account.reserve("output_bo", 1024);
+    EXPECT_EQ(account.get_usage().bytes, 5120);
+    EXPECT_EQ(account.get_usage().num_bos, 2);
+
+    // reallocation with a new size is counted once
+    account.reserve("input_bo", 8192);
+    EXPECT_EQ(account.get_usage().bytes, 9216);
+    EXPECT_EQ(npu_memory::get_total_bytes(), base + 9216);
+
+    account.release("output_bo");
+    EXPECT_EQ(account.get_usage().bytes, 8192);
+    EXPECT_EQ(account.get_usage().num_bos, 1);
+  }
+  EXPECT_EQ(npu_memory::get_total_bytes(), base);
+}
+
+TEST(NpuMemory, BudgetRejectsGrowth) {
+  const size_t old_budget = npu_memory::get_budget();
+  const size_t base = npu_memory::get_total_bytes();
+  npu_memory::set_budget(base + 16384);
+  {
+    npu_memory_account a("model_a");
+    npu_memory_account b("model_b");
+    a.reserve("const_bo", 12288);
+    EXPECT_THROW(b.reserve("const_bo", 8192), std::runtime_error);
+    EXPECT_EQ(b.get_usage().bytes, 0);
+
+    // slot keeps its previous size, shrinking always succeeds
+    b.reserve("const_bo", 4096);
+    EXPECT_THROW(b.reserve("const_bo", 8192), std::runtime_error);
+    EXPECT_EQ(b.get_usage().bytes, 4096);
+    a.reserve("const_bo", 4096);
+    b.reserve("const_bo", 8192);
+
+    const auto usage = npu_memory::get_usage();
+    ASSERT_GE(usage.size(), 2);
+    EXPECT_EQ(usage.front().owner, "model_b");
+  }
+  npu_memory::set_budget(old_budget);
+}
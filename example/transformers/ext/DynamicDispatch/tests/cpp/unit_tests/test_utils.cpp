@@ -0,0 +1,110 @@
+// Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <utils/utils.hpp>
+
+namespace fs = std::filesystem;
+
+static std::string write_temp_file(const std::string &name,
+                                   const std::string &contents) {
+  auto path = (fs::temp_directory_path() / name).string();
+  std::ofstream ofs(path, std::ios::binary);
+  ofs.write(contents.data(), contents.size());
+  return path;
+}
+
+TEST(MappedFile, MapsContents) {
+  const std::string contents = "dd const file\n\x00\x01\x02";
+  auto path = write_temp_file("dd_test_mapped_file.bin", contents);
+  {
+    Utils::MappedFile file(path);
+    file.prefetch();
+    ASSERT_EQ(file.size(), contents.size());
+    EXPECT_EQ(std::string(file.data(), file.size()), contents);
+  }
+  fs::remove(path);
+}
+
+TEST(MappedFile, WritesArePrivate) {
+  const std::string contents = "abcd";
+  auto path = write_temp_file("dd_test_mapped_file_cow.bin", contents);
+  {
+    Utils::MappedFile file(path);
+    file.data()[0] = 'x';
+    EXPECT_EQ(file.data()[0], 'x');
+    Utils::MappedFile other(path);
+    EXPECT_EQ(std::string(other.data(), other.size()), contents);
+  }
+  std::ifstream ifs(path, std::ios::binary);
+  std::string on_disk((std::istreambuf_iterator<char>(ifs)),
+                      std::istreambuf_iterator<char>());
+  ifs.close();
+  EXPECT_EQ(on_disk, contents);
+  fs::remove(path);
+}
+
+TEST(MappedFile, EmptyFile) {
+  auto path = write_temp_file("dd_test_mapped_file_empty.bin", "");
+  {
+    Utils::MappedFile file(path);
+    EXPECT_EQ(file.size(), 0);
+    EXPECT_EQ(file.data(), nullptr);
+  }
+  fs::remove(path);
+}
+
+TEST(MappedFile, MissingFileThrows) {
+  EXPECT_THROW(Utils::MappedFile("dd_test_no_such_file.bin"),
+               std::runtime_error);
+}
+
+TEST(ParallelFor, NestedCallsVisitAll) {
+  constexpr size_t N = 64;
+  std::vector<std::atomic<int>> visits(N * N);
+  Utils::parallel_for(N, [&](size_t i) {
+    Utils::parallel_for(N, [&](size_t j) { visits[i * N + j]++; });
+  });
+  for (const auto &v : visits) {
+    EXPECT_EQ(v, 1);
+  }
+}
+
+TEST(TaskGraph, RunsAfterDeps) {
+  Utils::TaskGraph graph;
+  std::atomic<int> a_done{0};
+  std::atomic<int> b_done{0};
+  std::atomic<int> deps_done_at_c{0};
+  auto a = graph.add("a", [&]() { a_done = 1; });
+  auto b = graph.add("b", [&]() { b_done = 1; }, {}, true);
+  graph.add("c", [&]() { deps_done_at_c = a_done + b_done; }, {a, b}, true);
+  auto times = graph.run();
+  ASSERT_EQ(times.size(), 3);
+  EXPECT_EQ(deps_done_at_c, 2);
+  EXPECT_EQ(times[1].name, "b");
+  EXPECT_EQ(times[1].thread, 0);
+  EXPECT_EQ(times[2].thread, 0);
+  EXPECT_GE(times[2].start_ns, times[0].end_ns);
+  EXPECT_GE(times[2].start_ns, times[1].end_ns);
+}
+
+TEST(TaskGraph, ErrorSkipsDependents) {
+  Utils::TaskGraph graph;
+  std::atomic<int> dependent_runs{0};
+  auto a = graph.add("a", []() { throw std::runtime_error("task a"); });
+  graph.add("b", [&]() { dependent_runs++; }, {a});
+  EXPECT_THROW(graph.run(), std::runtime_error);
+  EXPECT_EQ(dependent_runs, 0);
+}
+
+TEST(TaskGraph, DepsAddedBefore) {
+  Utils::TaskGraph graph;
+  EXPECT_THROW(graph.add("a", []() {}, {0}), std::runtime_error);
+}
@@ -0,0 +1,132 @@
+# Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+"""Pack the const files of a DD meta.json into a single const archive.
+
+Each const tensor of the tensor_map of the meta.json references its own
+.bin file. The archive stores all of them as aligned blobs behind an index,
+and the meta.json written with --out-meta points the tensors to the archive
+with their "file_offset". FusionRuntime then maps the archive once and
+prefetches it, instead of opening thousands of small files.
+
+Layout, little endian :
+    header : magic "DDCONST\\0", version u32, num entries u32
+    entries: name offset u64, name size u32, pad u32, data offset u64,
+             data size u64
+    names
+    blobs, each aligned to --alignment bytes
+Const files referenced by several tensors are stored once.
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+
+MAGIC = b"DDCONST\0"
+VERSION = 1
+
+HEADER_FMT = "<8sII"
+ENTRY_FMT = "<QIIQQ"
+
+
+def align(n, alignment):
+    return (n + alignment - 1) // alignment * alignment
+
+
+def collect_const_files(meta):
+    """Return the sorted const file names of the tensor_map."""
+    files = set()
+    for name, tinfo in meta["tensor_map"].items():
+        file_name = tinfo.get("file_name", "")
+        if not file_name:
+            continue
+        size = os.path.getsize(file_name)
+        if size != tinfo.get("file_size", size):
+            sys.exit(
+                "Size of {} doesn't match tensor {} : {} vs {}".format(
+                    file_name, name, size, tinfo["file_size"]
+                )
+            )
+        files.add(file_name)
+    return sorted(files)
+
+
+def write_archive(const_files, out_file, alignment):
+    """Write the archive, return {file name : data offset} & its size."""
+    header_size = struct.calcsize(HEADER_FMT)
+    entry_size = struct.calcsize(ENTRY_FMT)
+    names = b""
+    name_offsets = []
+    names_offset = header_size + entry_size * len(const_files)
+    for file_name in const_files:
+        name_offsets.append(names_offset + len(names))
+        names += file_name.encode()
+
+    data_offset = align(names_offset + len(names), alignment)
+    offsets = {}
+    entries = b""
+    for file_name, name_offset in zip(const_files, name_offsets):
+        size = os.path.getsize(file_name)
+        offsets[file_name] = data_offset
+        entries += struct.pack(
+            ENTRY_FMT, name_offset, len(file_name.encode()), 0, data_offset, size
+        )
+        data_offset = align(data_offset + size, alignment)
+
+    with open(out_file, "wb") as f:
+        f.write(struct.pack(HEADER_FMT, MAGIC, VERSION, len(const_files)))
+        f.write(entries)
+        f.write(names)
+        for file_name in const_files:
+            f.seek(offsets[file_name])
+            with open(file_name, "rb") as src:
+                f.write(src.read())
+        f.truncate(data_offset)
+    return offsets, data_offset
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--meta", required=True, help="input meta.json")
+    parser.add_argument("--out", required=True, help="output const archive")
+    parser.add_argument(
+        "--out-meta", required=True, help="meta.json referencing the archive"
+    )
+    parser.add_argument(
+        "--archive-path",
+        help="path of the archive written to --out-meta, as FusionRuntime "
+        "opens it (default: --out)",
+    )
+    parser.add_argument(
+        "--alignment", type=int, default=64, help="alignment of the blobs"
+    )
+    args = parser.parse_args()
+
+    with open(args.meta) as f:
+        meta = json.load(f)
+    const_files = collect_const_files(meta)
+    if not const_files:
+        sys.exit("No const file in {}".format(args.meta))
+    offsets, archive_size = write_archive(const_files, args.out, args.alignment)
+
+    archive_path = args.archive_path or args.out
+    num_tensors = 0
+    for tinfo in meta["tensor_map"].values():
+        file_name = tinfo.get("file_name", "")
+        if file_name:
+            tinfo["file_name"] = archive_path
+            tinfo["file_offset"] = offsets[file_name]
+            num_tensors += 1
+    with open(args.out_meta, "w") as f:
+        json.dump(meta, f, indent=2)
+
+    print(
+        "Packed {} const files of {} tensors, {} bytes : {}".format(
+            len(const_files), num_tensors, archive_size, args.out
+        )
+    )
+
+
+if __name__ == "__main__":
+    main()
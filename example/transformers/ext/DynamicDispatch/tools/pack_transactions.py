@@ -0,0 +1,179 @@
+# Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+"""Pack transaction/param binaries into a single indexed package.
+
+The package is memory mapped by the transaction library when DD_TXN_PACKAGE
+env variable points to it, see transaction/txn_package.cpp for the layout.
+The key of a binary is its file name without the extension, e.g.
+gemm_a8w8_64_768_1152.bin --> gemm_a8w8_64_768_1152.
+
+Binaries of the same size which differ only in a few 32-bit words, e.g. the
+txns of one kernel for different shapes, are stored as patches of one of
+them instead of as full copies.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = b"DDTXNPK\0"
+VERSION = 2
+COMPRESSION_NONE = 0
+COMPRESSION_ZLIB = 1
+COMPRESSION_PATCH = 2
+
+HEADER_FMT = "<8sII"
+ENTRY_FMT = "<QIIQQQ"
+PATCH_HEADER_FMT = "<II"
+PATCH_WORD_FMT = "<II"
+
+
+def collect_binaries(input_dirs, extension):
+    binaries = {}
+    for input_dir in input_dirs:
+        for root, _, files in os.walk(input_dir):
+            for fname in files:
+                if not fname.endswith(extension):
+                    continue
+                key = fname[: -len(extension)]
+                path = os.path.join(root, fname)
+                if key in binaries:
+                    sys.exit(
+                        "Duplicate key {} : {}, {}".format(key, binaries[key], path)
+                    )
+                binaries[key] = path
+    return binaries
+
+
+def diff_words(base, raw, max_words):
+    """Return [(word_offset, value)] changing base into raw, None if the
+    binaries differ in more than max_words words."""
+    num_words = len(raw) // 4
+    base_words = struct.unpack("<{}I".format(num_words), base)
+    raw_words = struct.unpack("<{}I".format(num_words), raw)
+    patch = []
+    for i, (b, r) in enumerate(zip(base_words, raw_words)):
+        if b != r:
+            patch.append((i, r))
+            if len(patch) > max_words:
+                return None
+    return patch
+
+
+def find_patch(bases, raw, max_patch_ratio):
+    """Pick the base entry with the smallest patch for raw."""
+    if max_patch_ratio <= 0 or len(raw) % 4 != 0:
+        return None
+    best = None
+    max_words = int(len(raw) // 4 * max_patch_ratio)
+    for base_idx, base in bases.get(len(raw), []):
+        patch = diff_words(base, raw, max_words)
+        if patch is not None and (best is None or len(patch) < len(best[1])):
+            best = (base_idx, patch)
+            max_words = len(patch)
+    return best
+
+
+def write_package(binaries, out_file, level, max_patch_ratio):
+    keys = sorted(binaries.keys(), key=lambda k: k.encode())
+    names = b""
+    blobs = []
+    # raw size -> [(entry idx, raw)] of the entries usable as patch base
+    bases = {}
+    for idx, key in enumerate(keys):
+        with open(binaries[key], "rb") as f:
+            raw = f.read()
+        stored = zlib.compress(raw, level) if level > 0 else raw
+        patch = find_patch(bases, raw, max_patch_ratio)
+        patch_size = (
+            struct.calcsize(PATCH_HEADER_FMT)
+            + len(patch[1]) * struct.calcsize(PATCH_WORD_FMT)
+            if patch is not None
+            else None
+        )
+        if patch is not None and patch_size < min(len(stored), len(raw)):
+            base_idx, words = patch
+            blob = struct.pack(PATCH_HEADER_FMT, base_idx, len(words))
+            blob += b"".join(struct.pack(PATCH_WORD_FMT, *w) for w in words)
+            blobs.append((COMPRESSION_PATCH, blob, len(raw)))
+            continue
+        bases.setdefault(len(raw), []).append((idx, raw))
+        # keep small/incompressible binaries raw, they are just copied
+        if len(stored) >= len(raw):
+            blobs.append((COMPRESSION_NONE, raw, len(raw)))
+        else:
+            blobs.append((COMPRESSION_ZLIB, stored, len(raw)))
+
+    header_size = struct.calcsize(HEADER_FMT)
+    entry_size = struct.calcsize(ENTRY_FMT)
+    names_offset = header_size + entry_size * len(keys)
+    name_offsets = []
+    for key in keys:
+        name_offsets.append(names_offset + len(names))
+        names += key.encode()
+
+    data_offset = names_offset + len(names)
+    entries = b""
+    for key, name_offset, (compression, stored, raw_size) in zip(
+        keys, name_offsets, blobs
+    ):
+        entries += struct.pack(
+            ENTRY_FMT,
+            name_offset,
+            len(key.encode()),
+            compression,
+            data_offset,
+            len(stored),
+            raw_size,
+        )
+        data_offset += len(stored)
+
+    with open(out_file, "wb") as f:
+        f.write(struct.pack(HEADER_FMT, MAGIC, VERSION, len(keys)))
+        f.write(entries)
+        f.write(names)
+        for _, stored, _ in blobs:
+            f.write(stored)
+
+    raw_total = sum(raw_size for _, _, raw_size in blobs)
+    num_patched = sum(1 for c, _, _ in blobs if c == COMPRESSION_PATCH)
+    return len(keys), num_patched, raw_total, data_offset
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument(
+        "--input-dir",
+        action="append",
+        required=True,
+        help="directory with binaries, searched recursively. Can be repeated",
+    )
+    parser.add_argument("--out", required=True, help="output package file")
+    parser.add_argument("--extension", default=".bin", help="binary extension")
+    parser.add_argument(
+        "--level", type=int, default=9, help="zlib level, 0 to store raw"
+    )
+    parser.add_argument(
+        "--max-patch-ratio",
+        type=float,
+        default=0.05,
+        help="max fraction of words a binary may differ from its patch base, "
+        "0 to disable patches",
+    )
+    args = parser.parse_args()
+
+    binaries = collect_binaries(args.input_dir, args.extension)
+    num, num_patched, raw_total, pkg_size = write_package(
+        binaries, args.out, args.level, args.max_patch_ratio
+    )
+    print(
+        "Packed {} binaries ({} as patches), {} bytes --> {} bytes : {}".format(
+            num, num_patched, raw_total, pkg_size, args.out
+        )
+    )
+
+
+if __name__ == "__main__":
+    main()
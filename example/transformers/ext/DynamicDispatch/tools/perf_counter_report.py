@@ -0,0 +1,92 @@
+# Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+"""Per-op report of the AIE perf counters dumped at DD profile level 4.
+
+--info is the dd_perf_counter_info.json written by DynamicDispatch, --dumps
+has one line per PERF_COUNTER_READ register dump, in execution order, with
+the values of the registers listed in the info file, e.g.
+    0x1f00 0x0a00 0x0012 ...
+Achieved DDR bandwidth of an op is the bytes of its tensors over the time
+its busiest shim DMA channel had a task running.
+"""
+
+import argparse
+import json
+import sys
+
+
+def parse_dumps(dumps_file):
+    dumps = []
+    with open(dumps_file) as f:
+        for line in f:
+            line = line.strip()
+            if line:
+                dumps.append([int(v, 0) for v in line.split()])
+    return dumps
+
+
+def get_op_stats(registers, values, clock_mhz):
+    counters = {}
+    for reg, value in zip(registers, values):
+        counters.setdefault(reg["counter"], []).append(value)
+    active = sum(counters.get("active_cycles", [0]))
+    stall = sum(counters.get("stall_cycles", [0]))
+    core_cycles = max(counters.get("active_cycles", [0]))
+    dma_cycles = max(
+        max(counters.get("mm2s_active_cycles", [0])),
+        max(counters.get("s2mm_active_cycles", [0])),
+    )
+    return {
+        "core_us": core_cycles / clock_mhz,
+        "stall_pct": 100.0 * stall / active if active else 0.0,
+        "dma_us": dma_cycles / clock_mhz,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--info", required=True, help="dd_perf_counter_info.json")
+    parser.add_argument("--dumps", required=True, help="register dumps")
+    parser.add_argument(
+        "--aie-clock-mhz", type=float, required=True, help="AIE array clock"
+    )
+    parser.add_argument(
+        "--peak-gbps", type=float, required=True, help="peak DDR bandwidth"
+    )
+    args = parser.parse_args()
+
+    with open(args.info) as f:
+        info = json.load(f)
+    registers = info["registers"]
+    events = info["events"]
+    dumps = parse_dumps(args.dumps)
+    if len(dumps) != len(events):
+        sys.exit("{} dumps for {} ops".format(len(dumps), len(events)))
+
+    print(
+        "{:<48} {:<20} {:>10} {:>8} {:>10} {:>8} {:>7} {}".format(
+            "op", "type", "core(us)", "stall%", "dma(us)", "GB/s", "peak%", "bound"
+        )
+    )
+    for event, values in zip(events, dumps):
+        if len(values) != len(registers):
+            sys.exit("Dump of {} has {} values".format(event["name"], len(values)))
+        stats = get_op_stats(registers, values, args.aie_clock_mhz)
+        gbps = event["tensor_bytes"] / stats["dma_us"] / 1e3 if stats["dma_us"] else 0
+        bound = "dma" if stats["dma_us"] > stats["core_us"] else "compute"
+        print(
+            "{:<48} {:<20} {:>10.2f} {:>8.1f} {:>10.2f} {:>8.2f} {:>7.1f} {}".format(
+                event["name"][:48],
+                event["op_type"][:20],
+                stats["core_us"],
+                stats["stall_pct"],
+                stats["dma_us"],
+                gbps,
+                100.0 * gbps / args.peak_gbps,
+                bound,
+            )
+        )
+
+
+if __name__ == "__main__":
+    main()
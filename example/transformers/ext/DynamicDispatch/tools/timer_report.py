@@ -0,0 +1,106 @@
+# Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+"""Per-op cycles of the record timers inserted at DD profile level >= 3.
+
+--info is the dd_timestamp_info.json written by DynamicDispatch, --timestamps
+has one line per executed RECORD_TIMER op, e.g. the
+aiesimulator_output/record_timer.txt written when the txns run under aiesim
+    <timer id> <cycles>
+Ops executed several times are averaged. With --baseline, a report saved
+earlier with --save, ops slower than the baseline by more than --tolerance
+are listed and the script exits with an error, to catch per-op perf
+regressions in CI.
+"""
+
+import argparse
+import json
+import sys
+
+
+def parse_timestamps(timestamps_file):
+    timestamps = {}
+    with open(timestamps_file) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) == 2:
+                timestamps.setdefault(int(fields[0], 0), []).append(int(fields[1], 0))
+    return timestamps
+
+
+def get_op_cycles(events, timestamps):
+    starts = {}
+    op_cycles = []
+    for event in events:
+        if event["type"] != "layer":
+            continue
+        if event["start"]:
+            starts[event["name"]] = event
+            continue
+        start = starts.pop(event["name"], None)
+        if start is None:
+            continue
+        begin = timestamps.get(start["id"], [])
+        end = timestamps.get(event["id"], [])
+        runs = min(len(begin), len(end))
+        if runs == 0:
+            continue
+        cycles = sum(e - b for b, e in zip(begin, end)) / runs
+        op_cycles.append((event["name"], event["op_type"], cycles, runs))
+    return op_cycles
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--info", required=True, help="dd_timestamp_info.json")
+    parser.add_argument("--timestamps", required=True, help="record timer values")
+    parser.add_argument("--aie-clock-mhz", type=float, help="AIE array clock")
+    parser.add_argument("--save", help="save the per-op cycles to this json")
+    parser.add_argument("--baseline", help="per-op cycles saved with --save")
+    parser.add_argument(
+        "--tolerance", type=float, default=5.0, help="allowed slowdown in %%"
+    )
+    args = parser.parse_args()
+
+    with open(args.info) as f:
+        events = json.load(f)["events"]
+    op_cycles = get_op_cycles(events, parse_timestamps(args.timestamps))
+    if not op_cycles:
+        sys.exit("No op with both start & end timestamps")
+
+    baseline = {}
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    print(
+        "{:<48} {:<20} {:>12} {:>10} {:>6} {:>8}".format(
+            "op", "type", "cycles", "us", "runs", "vs base"
+        )
+    )
+    regressions = []
+    for name, op_type, cycles, runs in op_cycles:
+        us = cycles / args.aie_clock_mhz if args.aie_clock_mhz else 0
+        delta = ""
+        if name in baseline and baseline[name] > 0:
+            pct = 100.0 * (cycles - baseline[name]) / baseline[name]
+            delta = "{:+.1f}%".format(pct)
+            if pct > args.tolerance:
+                regressions.append((name, pct))
+        print(
+            "{:<48} {:<20} {:>12.0f} {:>10.2f} {:>6} {:>8}".format(
+                name[:48], op_type[:20], cycles, us, runs, delta
+            )
+        )
+
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump({name: cycles for name, _, cycles, _ in op_cycles}, f, indent=2)
+
+    if regressions:
+        for name, pct in regressions:
+            print("REGRESSION {} : {:+.1f}%".format(name, pct))
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
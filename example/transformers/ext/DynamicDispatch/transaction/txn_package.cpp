@@ -0,0 +1,313 @@
+// Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <zlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <utils/txn_container.hpp>
+
+// Transaction package, written by tools/pack_transactions.py.
+// Layout :
+//   TxnPackageHeader
+//   TxnPackageEntry[num_entries], sorted by name
+//   names
+//   blobs, stored raw, as zlib streams or as patches of another entry
+// All integers are little endian.
+//
+// The txns of one kernel for different shapes mostly differ only in a few
+// BD lengths/addresses/repeat counts. A PATCH entry stores such a txn as the
+// 32-bit words it changes in a base entry of the same size :
+//   TxnPatchHeader
+//   TxnPatchWord[num_words]
+// The base entry is stored raw or as a zlib stream, never as a patch.
+
+namespace {
+
+constexpr char TXN_PACKAGE_MAGIC[8] = {'D', 'D', 'T', 'X', 'N', 'P', 'K', 0};
+constexpr uint32_t TXN_PACKAGE_VERSION = 2;
+
+enum class TxnCompression : uint32_t { NONE = 0, ZLIB = 1, PATCH = 2 };
+
+struct TxnPackageHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_entries;
+};
+
+struct TxnPackageEntry {
+  uint64_t name_offset;
+  uint32_t name_size;
+  uint32_t compression;
+  uint64_t data_offset;
+  uint64_t stored_size;
+  uint64_t raw_size;
+};
+
+struct TxnPatchHeader {
+  uint32_t base_entry;
+  uint32_t num_words;
+};
+
+struct TxnPatchWord {
+  uint32_t word_offset;
+  uint32_t value;
+};
+
+class TxnPackage {
+public:
+  // Returns nullptr if the file doesn't exist or isn't a valid package
+  static std::unique_ptr<TxnPackage> open(const std::string &path) {
+    auto pkg = std::unique_ptr<TxnPackage>(new TxnPackage());
+    if (!pkg->map(path) || !pkg->validate()) {
+      return nullptr;
+    }
+    return pkg;
+  }
+
+  ~TxnPackage() { unmap(); }
+  TxnPackage(const TxnPackage &) = delete;
+  TxnPackage &operator=(const TxnPackage &) = delete;
+
+  const TxnPackageEntry *find(const std::string &key) const {
+    auto *first = entries_;
+    auto *last = entries_ + num_entries_;
+    auto name_less = [this](const TxnPackageEntry &e, const std::string &k) {
+      return get_name(e) < k;
+    };
+    auto *iter = std::lower_bound(first, last, key, name_less);
+    if (iter == last || get_name(*iter) != key) {
+      return nullptr;
+    }
+    return iter;
+  }
+
+  // Decompress the entry straight into dst, which has room for raw_size
+  void read(const TxnPackageEntry &entry, void *dst, size_t size) const {
+    const uint8_t *src = data_ + entry.data_offset;
+    if (entry.compression == static_cast<uint32_t>(TxnCompression::PATCH)) {
+      TxnPatchHeader hdr;
+      std::memcpy(&hdr, src, sizeof(hdr));
+      read(entries_[hdr.base_entry], dst, size);
+      auto *words = static_cast<uint8_t *>(dst);
+      for (uint32_t i = 0; i < hdr.num_words; ++i) {
+        TxnPatchWord word;
+        std::memcpy(&word, src + sizeof(hdr) + i * sizeof(word), sizeof(word));
+        std::memcpy(words + size_t{word.word_offset} * sizeof(word.value),
+                    &word.value, sizeof(word.value));
+      }
+      return;
+    }
+    if (entry.compression == static_cast<uint32_t>(TxnCompression::NONE)) {
+      std::memcpy(dst, src, size);
+      return;
+    }
+
+    z_stream zs{};
+    if (inflateInit(&zs) != Z_OK) {
+      throw std::runtime_error("Txn package : inflateInit failed");
+    }
+    zs.next_in = const_cast<Bytef *>(src);
+    zs.avail_in = static_cast<uInt>(entry.stored_size);
+    zs.next_out = static_cast<Bytef *>(dst);
+    zs.avail_out = static_cast<uInt>(size);
+    int ret = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+    if (ret != Z_STREAM_END || zs.avail_out != 0) {
+      throw std::runtime_error("Txn package : failed to decompress " +
+                               std::string(get_name(entry)));
+    }
+  }
+
+private:
+  TxnPackage() = default;
+
+  std::string_view get_name(const TxnPackageEntry &entry) const {
+    return std::string_view(reinterpret_cast<const char *>(data_) +
+                                entry.name_offset,
+                            entry.name_size);
+  }
+
+  bool map(const std::string &path) {
+#ifdef _WIN32
+    HANDLE file =
+        CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+      CloseHandle(file);
+      return false;
+    }
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+      CloseHandle(file);
+      return false;
+    }
+    void *ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (ptr == nullptr) {
+      CloseHandle(mapping);
+      CloseHandle(file);
+      return false;
+    }
+    file_handle_ = file;
+    mapping_handle_ = mapping;
+    size_ = static_cast<size_t>(file_size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      close(fd);
+      return false;
+    }
+    void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+      return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+#endif
+    data_ = static_cast<const uint8_t *>(ptr);
+    return true;
+  }
+
+  void unmap() {
+    if (data_ == nullptr) {
+      return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_handle_);
+    CloseHandle(file_handle_);
+#else
+    munmap(const_cast<uint8_t *>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  bool validate() {
+    if (size_ < sizeof(TxnPackageHeader)) {
+      return false;
+    }
+    const auto *hdr = reinterpret_cast<const TxnPackageHeader *>(data_);
+    if (std::memcmp(hdr->magic, TXN_PACKAGE_MAGIC, sizeof(hdr->magic)) != 0 ||
+        hdr->version < 1 || hdr->version > TXN_PACKAGE_VERSION) {
+      return false;
+    }
+    const size_t table_end = sizeof(TxnPackageHeader) +
+                             size_t{hdr->num_entries} * sizeof(TxnPackageEntry);
+    if (table_end > size_) {
+      return false;
+    }
+    entries_ = reinterpret_cast<const TxnPackageEntry *>(data_ +
+                                                         sizeof(*hdr));
+    num_entries_ = hdr->num_entries;
+    for (size_t i = 0; i < num_entries_; ++i) {
+      const auto &e = entries_[i];
+      if (e.name_offset + e.name_size > size_ ||
+          e.data_offset + e.stored_size > size_ ||
+          e.compression > static_cast<uint32_t>(TxnCompression::PATCH) ||
+          (e.compression == static_cast<uint32_t>(TxnCompression::NONE) &&
+           e.stored_size != e.raw_size) ||
+          (e.compression == static_cast<uint32_t>(TxnCompression::PATCH) &&
+           !validate_patch(e))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool validate_patch(const TxnPackageEntry &e) const {
+    TxnPatchHeader hdr;
+    if (e.stored_size < sizeof(hdr)) {
+      return false;
+    }
+    std::memcpy(&hdr, data_ + e.data_offset, sizeof(hdr));
+    if (hdr.base_entry >= num_entries_ ||
+        e.stored_size !=
+            sizeof(hdr) + size_t{hdr.num_words} * sizeof(TxnPatchWord)) {
+      return false;
+    }
+    const auto &base = entries_[hdr.base_entry];
+    if (base.compression == static_cast<uint32_t>(TxnCompression::PATCH) ||
+        base.raw_size != e.raw_size) {
+      return false;
+    }
+    for (uint32_t i = 0; i < hdr.num_words; ++i) {
+      TxnPatchWord word;
+      std::memcpy(&word,
+                  data_ + e.data_offset + sizeof(hdr) + i * sizeof(word),
+                  sizeof(word));
+      if ((size_t{word.word_offset} + 1) * sizeof(word.value) > e.raw_size) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  const TxnPackageEntry *entries_ = nullptr;
+  size_t num_entries_ = 0;
+#ifdef _WIN32
+  HANDLE file_handle_ = nullptr;
+  HANDLE mapping_handle_ = nullptr;
+#endif
+};
+
+// Package given by DD_TXN_PACKAGE env variable, nullptr if not set/invalid.
+const TxnPackage *get_txn_package() {
+  static const std::unique_ptr<TxnPackage> pkg = []() {
+    const char *path = std::getenv("DD_TXN_PACKAGE");
+    if (path == nullptr || *path == '\0') {
+      return std::unique_ptr<TxnPackage>();
+    }
+    auto res = TxnPackage::open(path);
+    if (res == nullptr) {
+      throw std::runtime_error(
+          std::string("Invalid transaction package DD_TXN_PACKAGE=") + path);
+    }
+    return res;
+  }();
+  return pkg.get();
+}
+
+} // namespace
+
+void Transaction::read_txn(const std::string &key,
+                           const std::function<void *(size_t)> &get_dst) {
+  if (const auto *pkg = get_txn_package()) {
+    if (const auto *entry = pkg->find(key)) {
+      const auto size = static_cast<size_t>(entry->raw_size);
+      pkg->read(*entry, get_dst(size), size);
+      return;
+    }
+  }
+  const auto txn_string = get_txn_str(key);
+  std::memcpy(get_dst(txn_string.size()), txn_string.data(),
+              txn_string.size());
+}
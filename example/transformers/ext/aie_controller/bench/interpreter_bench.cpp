@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+/*
+ * Host cost of the transaction interpreter per op type.
+ *
+ * Builds transactions made of a single op type (plus a DD like mix) and runs
+ * them through RunDPUInstTransaction on a simulated DevInst, whose BaseAddr
+ * points to a host buffer standing in for the AIE register space.
+ *   tile  : all ops hit the register space of one tile (cache resident)
+ *   array : ops are spread over the rows/cols of the array like real txns
+ *
+ * usage : interpreter_bench [num_ops] [iters]
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "interpreter.h"
+
+namespace {
+
+constexpr uint32_t NUM_COLS = 4;
+constexpr uint32_t NUM_ROWS = 6;
+constexpr uint32_t COL_SHIFT = 25;
+constexpr uint32_t ROW_SHIFT = 20;
+constexpr uint32_t TILE_REG_SPACE = 1u << ROW_SHIFT;
+constexpr uint32_t BLOCK_WRITE_WORDS = 8;
+constexpr uint32_t NUM_ARGS = 5;
+
+enum class bench_op { write, block_write, mask_write, patch, mixed };
+
+struct backend_t {
+  const char *name;
+  bool spread;
+  size_t size;
+};
+
+class txn_builder {
+public:
+  txn_builder(bool spread) : spread_(spread), lcg_(12345) {
+    buf_.resize(sizeof(transaction_op_t) + sizeof(XAie_TxnHeader));
+  }
+
+  void write() {
+    num_ops_++;
+    XAie_Write32Hdr hdr{};
+    hdr.OpHdr.Op = XAIE_IO_WRITE;
+    hdr.RegOff = next_regoff();
+    hdr.Value = next();
+    hdr.Size = sizeof(hdr);
+    append(&hdr, sizeof(hdr));
+  }
+
+  void block_write() {
+    num_ops_++;
+    XAie_BlockWrite32Hdr hdr{};
+    hdr.OpHdr.Op = XAIE_IO_BLOCKWRITE;
+    hdr.RegOff = next_regoff();
+    hdr.Size = sizeof(hdr) + BLOCK_WRITE_WORDS * sizeof(uint32_t);
+    append(&hdr, sizeof(hdr));
+    for (uint32_t i = 0; i < BLOCK_WRITE_WORDS; i++) {
+      uint32_t word = next();
+      append(&word, sizeof(word));
+    }
+  }
+
+  void mask_write() {
+    num_ops_++;
+    XAie_MaskWrite32Hdr hdr{};
+    hdr.OpHdr.Op = XAIE_IO_MASKWRITE;
+    hdr.RegOff = next_regoff();
+    hdr.Value = next();
+    hdr.Mask = 0x0000FFFF;
+    hdr.Size = sizeof(hdr);
+    append(&hdr, sizeof(hdr));
+  }
+
+  void patch() {
+    num_ops_++;
+    XAie_CustomOpHdr hdr{};
+    hdr.OpHdr.Op = XAIE_IO_CUSTOM_OP_BEGIN + 1;
+    hdr.Size = sizeof(hdr) + sizeof(patch_op_t);
+    patch_op_t op{};
+    op.regaddr = next_regoff();
+    op.argidx = next() % NUM_ARGS;
+    op.argplus = next() & 0xFFF0;
+    append(&hdr, sizeof(hdr));
+    append(&op, sizeof(op));
+  }
+
+  std::vector<uint8_t> finish() {
+    auto *txn_op = reinterpret_cast<transaction_op_t *>(buf_.data());
+    txn_op->b.type = e_TRANSACTION_OP;
+    txn_op->b.size_in_bytes = static_cast<unsigned int>(buf_.size());
+    auto *hdr =
+        reinterpret_cast<XAie_TxnHeader *>(buf_.data() + sizeof(*txn_op));
+    std::memset(hdr, 0, sizeof(*hdr));
+    hdr->Major = 0;
+    hdr->Minor = 1;
+    hdr->NumRows = NUM_ROWS;
+    hdr->NumCols = NUM_COLS;
+    hdr->NumMemTileRows = 1;
+    hdr->NumOps = num_ops_;
+    hdr->TxnSize = static_cast<uint32_t>(buf_.size() - sizeof(*txn_op));
+    return buf_;
+  }
+
+private:
+  uint32_t next() {
+    lcg_ = lcg_ * 1664525u + 1013904223u;
+    return lcg_;
+  }
+
+  // word aligned & 2 words of headroom for the upper half of a patch
+  uint64_t next_regoff() {
+    uint64_t reg = next() % (TILE_REG_SPACE - 8) & ~3ull;
+    if (!spread_) {
+      return reg;
+    }
+    uint64_t col = next() % NUM_COLS;
+    uint64_t row = next() % NUM_ROWS;
+    return (col << COL_SHIFT) | (row << ROW_SHIFT) | reg;
+  }
+
+  void append(const void *data, size_t size) {
+    auto *bytes = static_cast<const uint8_t *>(data);
+    buf_.insert(buf_.end(), bytes, bytes + size);
+  }
+
+  bool spread_;
+  uint32_t lcg_;
+  uint32_t num_ops_ = 0;
+  std::vector<uint8_t> buf_;
+};
+
+std::vector<uint8_t> build_txn(bench_op op, uint32_t num_ops, bool spread) {
+  txn_builder b(spread);
+  for (uint32_t i = 0; i < num_ops; i++) {
+    switch (op) {
+    case bench_op::write:
+      b.write();
+      break;
+    case bench_op::block_write:
+      b.block_write();
+      break;
+    case bench_op::mask_write:
+      b.mask_write();
+      break;
+    case bench_op::patch:
+      b.patch();
+      break;
+    case bench_op::mixed:
+      // runs of BD/lock writes between a block write & its patches, the
+      // shape of most DD generated txns
+      if (i % 16 == 0) {
+        b.block_write();
+      } else if (i % 16 == 1) {
+        b.patch();
+      } else if (i % 16 == 2) {
+        b.mask_write();
+      } else {
+        b.write();
+      }
+      break;
+    }
+  }
+  return b.finish();
+}
+
+const char *op_name(bench_op op) {
+  switch (op) {
+  case bench_op::write:
+    return "write";
+  case bench_op::block_write:
+    return "block_write";
+  case bench_op::mask_write:
+    return "mask_write";
+  case bench_op::patch:
+    return "patch";
+  case bench_op::mixed:
+    return "mixed";
+  }
+  return "unknown";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const uint32_t num_ops = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const uint32_t iters = argc > 2 ? std::atoi(argv[2]) : 200;
+
+  const backend_t backends[] = {
+      {"tile", false, TILE_REG_SPACE},
+      {"array", true, static_cast<size_t>(NUM_COLS) << COL_SHIFT}};
+  const bench_op ops[] = {bench_op::write, bench_op::block_write,
+                          bench_op::mask_write, bench_op::patch,
+                          bench_op::mixed};
+
+#ifdef AIE_CONTROLLER_NO_BATCHED_DISPATCH
+  std::printf("dispatch : per op\n");
+#else
+  std::printf("dispatch : batched\n");
+#endif
+  std::printf("%-8s %-12s %10s %10s\n", "backend", "op", "ns/op", "ns/txn");
+
+  for (const auto &backend : backends) {
+    std::vector<uint8_t> regs(backend.size + 8, 0);
+    XAie_DevInst dev_inst{};
+    dev_inst.BaseAddr = reinterpret_cast<uint64_t>(regs.data());
+    uint64_t args[NUM_ARGS] = {0x1000, 0x2000, 0x3000, 0x4000, 0x5000};
+
+    for (auto op : ops) {
+      auto txn = build_txn(op, num_ops, backend.spread);
+      // warmup, touches all the pages of the register space used
+      if (RunDPUInstTransaction(&dev_inst, txn.data(),
+                                static_cast<unsigned>(txn.size()), 0,
+                                reinterpret_cast<const u8 *>(args)) != 0) {
+        std::fprintf(stderr, "%s : txn failed\n", op_name(op));
+        return 1;
+      }
+      auto start = std::chrono::steady_clock::now();
+      for (uint32_t it = 0; it < iters; it++) {
+        RunDPUInstTransaction(&dev_inst, txn.data(),
+                              static_cast<unsigned>(txn.size()), 0,
+                              reinterpret_cast<const u8 *>(args));
+      }
+      auto stop = std::chrono::steady_clock::now();
+      double ns =
+          std::chrono::duration<double, std::nano>(stop - start).count();
+      std::printf("%-8s %-12s %10.2f %10.0f\n", backend.name, op_name(op),
+                  ns / (static_cast<double>(iters) * num_ops), ns / iters);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#ifndef __BENCH_PROFILE_IMPL_H__
+#define __BENCH_PROFILE_IMPL_H__
+
+/*
+ * Host stand-in for the firmware profile_impl.h, so the silicon path of the
+ * interpreter can be built and timed on x86. Profiling ops & TCT syncs are
+ * no-ops, there is no NPU to dump from or to wait on.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define AIE_TCT_MAX_ACTORID 16
+#define BENCH_NUM_COLS 8
+#define BENCH_NUM_ROWS 6
+
+struct aie_tct {
+    uint32_t valid;
+    uint32_t tct;
+};
+
+static struct aie_tct expected_tcts[16];
+static uint32_t tct_count[BENCH_NUM_COLS] = {0};
+static const uint32_t TCT_COUNT_ARR_SIZE = sizeof(tct_count)/sizeof(tct_count[0]);
+static uint8_t tct_map[BENCH_NUM_COLS*BENCH_NUM_ROWS*AIE_TCT_MAX_ACTORID] = { 0 };
+static const uint32_t MAP_SIZE = sizeof(tct_map)/sizeof(tct_map[0]);
+
+static inline struct aie_tct aie_tct_create(uint8_t actor_id, uint8_t src_row, uint8_t src_col)
+{
+    struct aie_tct tct;
+    tct.valid = 1;
+    tct.tct = ((uint32_t)src_col << 16) | ((uint32_t)src_row << 8) | actor_id;
+    return tct;
+}
+
+static inline int aie_tct_map_wait(uint8_t *map, uint32_t fifo_id, struct aie_tct *tcts, uint32_t num_tct)
+{
+    (void)map;
+    (void)fifo_id;
+    (void)tcts;
+    (void)num_tct;
+    return 0;
+}
+
+static inline void DumpRegistersImpl(const uint64_t base_addr, uint32_t count, const uint64_t *addrs)
+{
+    (void)base_addr;
+    (void)count;
+    (void)addrs;
+}
+
+static inline void RecordTimestampImpl(const uint64_t base_addr, uint32_t id)
+{
+    (void)base_addr;
+    (void)id;
+}
+
+#endif
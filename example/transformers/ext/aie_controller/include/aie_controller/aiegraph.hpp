@@ -5,6 +5,7 @@
 #ifndef __AIEGRAPH_HPP__
 #define __AIEGRAPH_HPP__
 
+#include <algorithm>
 #include <fstream>
 #include <ucode_gen.hpp>
 #include <assert.h>
@@ -221,6 +222,46 @@ public:
         return shimtile_enqueuebd( getShimTilePort(gmio_name) , address, buffer_descriptors, bd_ids, repeat_count, enable_task_complete_token, ext_buffer_idx);
     }
 
+    /// Transfer num_rows rows of row_words words, row_stride words apart, through
+    /// the gmio ports, e.g. the 2 MM2S or S2MM channels of a shim tile. The
+    /// rows are split into one contiguous block per port and each block into BDs
+    /// of at most SHIM_BD_MAX_WRAP rows, chained with next_bd into a single task
+    /// per port, so the channels stream in parallel without a TCT/enqueue per BD.
+    /// BDs are taken in order from bd_ids, which must hold one id per BD.
+    err_code gmio_enqueue_chained(const std::vector<std::string>& gmio_names, const void* address, uint32_t num_rows, uint32_t row_words, uint32_t row_stride, const std::vector<uint32_t>& bd_ids, bool enable_task_complete_token = false, int32_t ext_buffer_idx=-1)
+    {
+        if (gmio_names.empty() || num_rows == 0 || row_words == 0 || row_stride < row_words)
+            return errorMsg(err_code::user_error, "ERROR: gmio_enqueue_chained: invalid transfer shape");
+        const bool contiguous = row_stride == row_words;
+        if (!contiguous && row_words > SHIM_BD_MAX_WRAP)
+            return errorMsg(err_code::user_error, "ERROR: gmio_enqueue_chained: row_words " + std::to_string(row_words) + " exceeds the BD D0 wrap");
+
+        const uint32_t num_ports = std::min<uint32_t>(gmio_names.size(), num_rows);
+        const uint32_t rows_per_port = (num_rows + num_ports - 1) / num_ports;
+        size_t next_bd_id = 0;
+        for (uint32_t p = 0; p < num_ports; p++) {
+            const uint32_t row_begin = p * rows_per_port;
+            const uint32_t row_end = std::min(num_rows, row_begin + rows_per_port);
+            if (row_begin >= row_end)
+                break;
+
+            auto bds = split_chained_bds(row_begin, row_end, row_words, row_stride, contiguous);
+            if (next_bd_id + bds.size() > bd_ids.size())
+                return errorMsg(err_code::resource_unavailable, "ERROR: gmio_enqueue_chained: need more than " + std::to_string(bd_ids.size()) + " BDs");
+            std::vector<uint32_t> port_bd_ids(bd_ids.begin() + next_bd_id, bd_ids.begin() + next_bd_id + bds.size());
+            next_bd_id += bds.size();
+            for (size_t b = 0; b + 1 < bds.size(); b++) {
+                bds[b].use_next_bd = true;
+                bds[b].next_bd = port_bd_ids[b + 1];
+            }
+
+            err_code r = shimtile_enqueue_chain(getShimTilePort(gmio_names[p]), address, bds, port_bd_ids, enable_task_complete_token, ext_buffer_idx);
+            if (r != err_code::ok)
+                return r;
+        }
+        return err_code::ok;
+    }
+
     err_code memtile_enqueuebd(const std::string& dmaPortName, const std::vector<dma_buffer_descriptor>& buffer_descriptors, const std::vector<uint32_t>& bd_ids, uint32_t repeat_count = 1, bool enable_task_complete_token = false)
     {
         if (memtile_ports_.find(dmaPortName) == memtile_ports_.end()) 
@@ -442,6 +483,58 @@ private:
         return r;
     }
 
+    /// D0/D1 wraps of a shim BD are 10 bits
+    static constexpr uint32_t SHIM_BD_MAX_WRAP = 1023;
+
+    std::vector<dma_buffer_descriptor> split_chained_bds(uint32_t row_begin, uint32_t row_end, uint32_t row_words, uint32_t row_stride, bool contiguous)
+    {
+        // a contiguous block is a single 1d BD, only strided rows hit the D1 wrap
+        const uint32_t rows_per_bd = contiguous ? row_end - row_begin : SHIM_BD_MAX_WRAP;
+        std::vector<dma_buffer_descriptor> bds;
+        for (uint32_t row = row_begin; row < row_end; row += rows_per_bd) {
+            const uint32_t rows = std::min(rows_per_bd, row_end - row);
+            dma_buffer_descriptor bd;
+            bd.address = static_cast<uint64_t>(row) * row_stride;
+            bd.length = rows * row_words;
+            if (!contiguous) {
+                bd.stepsize = {1, row_stride};
+                bd.wrap = {row_words};
+            }
+            bds.push_back(bd);
+        }
+        return bds;
+    }
+
+    err_code shimtile_enqueue_chain(std::shared_ptr<shimTileHandle> tileHandle, const void* address, const std::vector<dma_buffer_descriptor>& buffer_descriptors, const std::vector<uint32_t>& bd_ids, bool enable_task_complete_token, int32_t ext_buffer_idx)
+    {
+        startTransaction();
+        err_code r = tileHandle->program_only(address, buffer_descriptors, bd_ids, 1, enable_task_complete_token);
+        for (size_t b = 0; r == err_code::ok && ext_buffer_idx != -1 && b < bd_ids.size(); b++) {
+          // every BD of the chain points into the ext buffer at its own offset
+          auto [regAddr, pr] = tileHandle->compute_patch_regaddr(bd_ids[b]);
+          r = pr;
+          if (r == err_code::ok) {
+            patch_op_t op;
+            op.action = 0; // patch shim
+            op.regaddr = regAddr;
+            op.argidx = ext_buffer_idx;
+            op.argplus = reinterpret_cast<u64>(address) + buffer_descriptors[b].address * sizeof(uint32_t);
+
+            XAie_AddCustomTxnOp(&devInst_val, patch_op_code_,
+              (void*)&op, sizeof(op));
+          }
+        }
+        if (r == err_code::ok) {
+          r = tileHandle->enqueuetask_only(bd_ids[0], 1, enable_task_complete_token);
+        }
+        if (r != err_code::ok) {
+          throw std::invalid_argument("shimtile_enqueue_chain transaction logging failure");
+        }
+        if (fw_dbg_) this->dump_transaction();
+        addTransaction();
+        return r;
+    }
+
     void* getTransaction(bool clear_txn = true) { 
         void* txn = XAie_ExportSerializedTransaction(&devInst_val, 1, 0); 
         if(clear_txn) {
@@ -27,7 +27,9 @@ int32_t RunDPUInstTransaction(XAie_DevInst *DevInst, u8 *instr_pc, unsigned sz,
       return ERR_TXN_FW_UNKNOWN_FW_OP_CODE;
     }
 
-    op_TRANSACTION_OP_func( DevInst, ibuf, start_col_idx, args );
+    if (op_TRANSACTION_OP_func( DevInst, ibuf, start_col_idx, args ) != 0) {
+      return ERR_TXN_FW_UNKNOWN_FW_OP_CODE;
+    }
     instr_pc += ibuf->size_in_bytes;
   }
 
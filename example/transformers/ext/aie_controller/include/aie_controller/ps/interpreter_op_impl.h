@@ -17,6 +17,29 @@ static const uint32_t TCT_COUNT_ARR_SIZE = sizeof(tct_count)/sizeof(tct_count[0]
 static uint8_t tct_map[XAIE_NUM_COLS*XAIE_NUM_ROWS*AIE_TCT_MAX_ACTORID] = { 0 };
 static const uint32_t MAP_SIZE = sizeof(tct_map)/sizeof(tct_map[0]);
 
+/*
+ * The record timer & dump registers ops append to the files read by the
+ * DynamicDispatch profiling tools, so that per op cycles can be collected
+ * without an NPU. Timestamps are taken from the shim tile timer of the
+ * start column.
+ */
+#define AIESIM_TIMER_LOW_REGOFF  0x000340F8U
+#define AIESIM_TIMER_HIGH_REGOFF 0x000340FCU
+static const char *AIESIM_TIMESTAMP_FILE = "./aiesimulator_output/record_timer.txt";
+static const char *AIESIM_REG_DUMP_FILE = "./aiesimulator_output/register_dumps.txt";
+
+static u64 AiesimReadTimer(XAie_DevInst* dev_inst, const uint8_t start_col_idx)
+{
+    u64 tile_addr = dev_inst->BaseAddr + ((u64)start_col_idx << dev_inst->DevProp.ColShift);
+    u32 high, low;
+    // Re-read if the low word wrapped in between
+    do {
+        high = ess_Read32(tile_addr + AIESIM_TIMER_HIGH_REGOFF);
+        low = ess_Read32(tile_addr + AIESIM_TIMER_LOW_REGOFF);
+    } while (high != ess_Read32(tile_addr + AIESIM_TIMER_HIGH_REGOFF));
+    return ((u64)high << 32) | low;
+}
+
 int SubmitSerializedTransaction(XAie_DevInst* dev_inst, uint8_t *ptr, const uint8_t start_col_idx, uint8_t *args)
 {
     XAie_TxnHeader txn_header = *((XAie_TxnHeader *)ptr);
@@ -168,8 +191,34 @@ int SubmitSerializedTransaction(XAie_DevInst* dev_inst, uint8_t *ptr, const uint
                 break;
             }
             case XAIE_IO_CUSTOM_OP_BEGIN+2: {
-                // Dump Registers opcode
-                // Do nothing in sim
+                XAie_CustomOpHdr *hdr = (XAie_CustomOpHdr *)ptr;
+                read_register_op_t *op = (read_register_op_t *)(ptr + sizeof(*hdr));
+                FILE *fp = fopen(AIESIM_REG_DUMP_FILE, "a");
+                if (fp != NULL) {
+                    for (uint32_t i = 0; i < op->count; i++) {
+                        u32 regval = ess_Read32(op->data[i].address + dev_inst->BaseAddr);
+                        fprintf(fp, "%s0x%x", i == 0 ? "" : " ", regval);
+                    }
+                    fprintf(fp, "\n");
+                    fclose(fp);
+                }
+                printf("CustomOp DumpRegisters count %u\n", op->count);
+                ptr += hdr->Size;
+                break;
+            }
+            case XAIE_IO_CUSTOM_OP_BEGIN+3: {
+                XAie_CustomOpHdr *hdr = (XAie_CustomOpHdr *)ptr;
+                if (hdr->Size - sizeof(*hdr) == sizeof(record_timer_op_t)) {
+                    record_timer_op_t *op = (record_timer_op_t *)(ptr + sizeof(*hdr));
+                    u64 cycles = AiesimReadTimer(dev_inst, start_col_idx);
+                    FILE *fp = fopen(AIESIM_TIMESTAMP_FILE, "a");
+                    if (fp != NULL) {
+                        fprintf(fp, "%u %llu\n", op->id, (unsigned long long)cycles);
+                        fclose(fp);
+                    }
+                    printf("CustomOp RecordTimer id %u cycles %llu\n", op->id, (unsigned long long)cycles);
+                }
+                ptr += hdr->Size;
                 break;
             }
             default:
@@ -197,7 +246,7 @@ static void Write32Transaction(uint8_t **ptr, const uint64_t base_addr) {
 
 static void BlockWrite32Transaction(uint8_t **ptr, const uint64_t base_addr) {
     XAie_BlockWrite32Hdr* bw_header = (XAie_BlockWrite32Hdr *)(*ptr);
-    u32 reg_addr = bw_header->RegOff + base_addr;
+    uint64_t reg_addr = bw_header->RegOff + base_addr;
     u32 bw_size = bw_header->Size;
     u32 Size = (bw_size - sizeof(*bw_header)) / 4;
     u32 *Payload =(u32 *) ((*ptr) + sizeof(*bw_header));
@@ -208,6 +257,31 @@ static void BlockWrite32Transaction(uint8_t **ptr, const uint64_t base_addr) {
     *ptr = *ptr + bw_size;
 }
 
+#ifndef AIE_CONTROLLER_NO_BATCHED_DISPATCH
+/*
+ * Register writes come in long runs (BD/lock/stream switch config), so run
+ * consecutive ops of the same type in a tight loop instead of going back
+ * through the opcode switch for each one. Returns the number of ops consumed.
+ */
+static uint32_t Write32Run(uint8_t **ptr, const uint64_t base_addr, const uint32_t max_ops) {
+    uint32_t n = 0;
+    do {
+        Write32Transaction(ptr, base_addr);
+        n++;
+    } while (n < max_ops && ((XAie_OpHdr *)(*ptr))->Op == XAIE_IO_WRITE);
+    return n;
+}
+
+static uint32_t BlockWrite32Run(uint8_t **ptr, const uint64_t base_addr, const uint32_t max_ops) {
+    uint32_t n = 0;
+    do {
+        BlockWrite32Transaction(ptr, base_addr);
+        n++;
+    } while (n < max_ops && ((XAie_OpHdr *)(*ptr))->Op == XAIE_IO_BLOCKWRITE);
+    return n;
+}
+#endif // AIE_CONTROLLER_NO_BATCHED_DISPATCH
+
 static void MaskWriteTransaction(uint8_t **ptr, const uint64_t base_addr) {
     XAie_MaskWrite32Hdr* mw_header = (XAie_MaskWrite32Hdr *)(*ptr);
     volatile u32* reg = (volatile u32*)(mw_header->RegOff + base_addr);
@@ -242,7 +316,9 @@ static void SyncTaskCompleteToken(uint8_t **ptr, const uint64_t base_addr, const
     printf("SyncTaskCompleteToken: {col, row, chl, dir} = {%d+%d, %d+%d, %d, %d}\n", Col,
            ColNum, Row, RowNum, ChNum, Dir);
     *ptr = *ptr + co_header->Size;
+#ifndef AIE_CONTROLLER_NO_DEBUGPRINT
 #define DEBUGPRINT 1
+#endif
     for (u8 c = 0; c < ColNum; c++) {
         u8 nCol = Col + ColNum - 1 - c;
         uint32_t num_tct = 0;
@@ -364,12 +440,21 @@ int __attribute__((section(".app_critical_text"))) SubmitSerializedTransaction(X
     for(uint32_t i = 0; i < NumOps; i++) {
         op_header = (XAie_OpHdr*)ptr;
         switch(op_header->Op) {
+#ifndef AIE_CONTROLLER_NO_BATCHED_DISPATCH
+            case XAIE_IO_WRITE:
+                i += Write32Run(&ptr, base_addr, NumOps - i) - 1;
+                break;
+            case XAIE_IO_BLOCKWRITE:
+                i += BlockWrite32Run(&ptr, base_addr, NumOps - i) - 1;
+                break;
+#else
             case XAIE_IO_WRITE:
                 Write32Transaction(&ptr, base_addr);
                 break;
             case XAIE_IO_BLOCKWRITE:
                 BlockWrite32Transaction(&ptr, base_addr);
                 break;
+#endif // AIE_CONTROLLER_NO_BATCHED_DISPATCH
             case XAIE_IO_MASKWRITE:
                 MaskWriteTransaction(&ptr, base_addr);
                 break;
@@ -0,0 +1,330 @@
+#ifndef BD_LAYOUT_H
+#define BD_LAYOUT_H
+
+#include <adf/adf_api/AIERuntimeControl.h>
+
+#include "config.h"
+#include "subv_formatting.h"
+
+//
+// Compile time generator of the memtile BD/lock config of the 4x4 GEMM for
+// the token phase (Mgemm == 1, ifm & params share shim MM2S channel 0).
+// The layout is derived from config.h/subv_formatting.h, so it can't drift
+// from the core buffers, and reproduces the bd_config.h generated by the
+// python DMA compiler call for call.
+//
+// Memtile L2 layout of each column (bytes, from the local base):
+//   params   : CORE_IN1_SIZE, s2mm_0 -> mm2s_0 (broadcast to the 4 rows)
+//   ifm      : Mgemm * Kgemm * 2, s2mm_0 -> mm2s_0
+//   wgts     : 2 ping & 2 pong buffers of 2 subvs, s2mm_0/1 -> mm2s_1..4
+//   ofm      : ping & pong of NUM_ROWS core outputs, s2mm_2..5 -> mm2s_5
+//
+
+namespace bd_layout
+{
+
+static int const MEMTILE_LOCAL_ADDR = 0x80000;
+static int const MEMTILE_LOCAL_LOCK = 64;
+static int const MEMTILE_SIZE = 1 << 19;
+// BDs 0-23 serve the even channels, BDs 24-47 the odd ones
+static int const MEMTILE_BDS_PER_POOL = 24;
+// The task queue repeat count is 8 bits
+static int const MAX_TASK_REPEAT = 256;
+// The ifm is read in 4 chained BDs, as the python DMA compiler does
+static int const IFM_MM2S_BDS = 4;
+// Each wgt s2mm channel feeds 2 core rows
+static int const WGT_READERS = 2;
+
+template <int Mgemm, int Kgemm, int Ngemm>
+struct GemmLayout
+{
+    static int const OUTER_N_LOOP = Ngemm / (NUM_ROWS * NUM_COLS * N_SUBV);
+    static int const INNER_LOOP = Kgemm / K_SUBV;
+
+    // Word sizes of the transfers
+    static int const PRM_WORDS = (Mgemm * K_SUBV * 2) / sizeof(uint32_t);
+    static int const IFM_WORDS = (Mgemm * Kgemm * 2) / sizeof(uint32_t);
+    static int const IFM_SUBV_WORDS = (K_SUBV * 2) / sizeof(uint32_t);
+    static int const IFM_SUBVS_PER_BD = INNER_LOOP / IFM_MM2S_BDS;
+    static int const WGT_SUBV_WORDS = sizeof(CoreSubv) / sizeof(uint32_t);
+    static int const OFM_CORE_WORDS = CORE_OUT_SIZE / sizeof(uint32_t);
+
+    // Byte offsets of the buffers from the memtile local base
+    static int const PRM_ADDR = 0;
+    static int const IFM_ADDR = PRM_ADDR + CORE_IN1_SIZE;
+    static int const WGT_BUF_SIZE = WGT_READERS * sizeof(CoreSubv);
+    static int const WGT_ADDR = IFM_ADDR + IFM_WORDS * sizeof(uint32_t);
+    static int const OFM_BUF_SIZE = NUM_ROWS * CORE_OUT_SIZE;
+    static int const OFM_ADDR = WGT_ADDR + 4 * WGT_BUF_SIZE;
+    static int const L2_SIZE = OFM_ADDR + 2 * OFM_BUF_SIZE;
+
+    // Task repeat counts, the bias is sent as one more wgt subv per N loop and
+    // wgt/ofm tasks cover a ping & a pong each
+    static int const IFM_REPEAT = OUTER_N_LOOP;
+    static int const WGT_REPEAT = (OUTER_N_LOOP * (INNER_LOOP + 1)) / 2;
+    static int const OFM_REPEAT = OUTER_N_LOOP / 2;
+
+    static bool const supported =
+        Mgemm == 1 &&
+        Kgemm % (K_SUBV * IFM_MM2S_BDS) == 0 &&
+        Ngemm % (NUM_ROWS * NUM_COLS * N_SUBV * 2) == 0 &&
+        (OUTER_N_LOOP * (INNER_LOOP + 1)) % 2 == 0 &&
+        WGT_REPEAT <= MAX_TASK_REPEAT &&
+        IFM_REPEAT <= MAX_TASK_REPEAT &&
+        L2_SIZE <= MEMTILE_SIZE;
+};
+
+struct Lock
+{
+    int id;
+    int value;
+};
+
+static Lock const NO_LOCK = {0, 0};
+
+// Hands out the BD ids in the order the python DMA compiler does
+struct BdAllocator
+{
+    int next[2] = {0, MEMTILE_BDS_PER_POOL};
+
+    int alloc(int channel) { return next[channel % 2]++; }
+};
+
+inline void configure_bd(int col, int bd_id, int addr, int offset_words, int length,
+                         std::vector<uint32_t> stepsize, std::vector<uint32_t> wrap,
+                         Lock acq, Lock rel, int next_bd = -1)
+{
+    adf::dma_buffer_descriptor bd;
+    bd.address = offset_words + ((MEMTILE_LOCAL_ADDR + addr) / sizeof(uint32_t));
+    bd.length = length;
+    bd.stepsize = stepsize;
+    bd.wrap = wrap;
+    bd.padding = {};
+    bd.lock_acq_enable = acq.value != 0 || rel.value != 0;
+    bd.lock_acq_value = acq.value;
+    bd.lock_acq_id = MEMTILE_LOCAL_LOCK + acq.id;
+    bd.lock_rel_value = rel.value;
+    bd.lock_rel_id = MEMTILE_LOCAL_LOCK + rel.id;
+    bd.use_next_bd = next_bd >= 0;
+    bd.next_bd = next_bd >= 0 ? next_bd : 0;
+    adf::configureBufferDescriptor(adf::memory_tile, col, 0, bd_id, bd);
+}
+
+// Zero length BD that only releases a lock, e.g. to multicast a lock release
+inline void configure_release_bd(int col, int bd_id, Lock rel, int next_bd = -1)
+{
+    configure_bd(col, bd_id, 0, 0, 0, {1}, {}, NO_LOCK, rel, next_bd);
+}
+
+template <int Mgemm, int Kgemm, int Ngemm>
+class MemtileConfig
+{
+    typedef GemmLayout<Mgemm, Kgemm, Ngemm> L;
+
+    // Lock ids of each column
+    static int const PRM_FREE = 1, PRM_FULL = 2;
+    static int const IFM_FREE = 3, IFM_FULL = 4;
+    static int wgt_free(int c, int p) { return 5 + 6 * c + 3 * p; }
+    static int wgt_full(int c, int p, int r) { return wgt_free(c, p) + 1 + r; }
+    static int ofm_free(int p, int r) { return 17 + 5 * p + r; }
+    static int ofm_full(int p) { return 17 + 5 * p + NUM_ROWS; }
+
+    // BD ids, identical for each column
+    struct WgtBds
+    {
+        int write[2], release[2], read[WGT_READERS][2];
+    };
+    int prm_s2mm, prm_mm2s, ifm_s2mm, ifm_mm2s[IFM_MM2S_BDS];
+    WgtBds wgt[2];
+    int ofm_s2mm[NUM_ROWS][2], ofm_mm2s[2][NUM_ROWS];
+
+    static int wgt_s2mm_ch(int c) { return c; }
+    static int wgt_mm2s_ch(int c, int r) { return 1 + WGT_READERS * c + r; }
+    static int const OFM_MM2S_CH = 5;
+
+public:
+    MemtileConfig()
+    {
+        BdAllocator a;
+        prm_s2mm = a.alloc(0);
+        prm_mm2s = a.alloc(0);
+        ifm_s2mm = a.alloc(0);
+        for (int b = 0; b < IFM_MM2S_BDS; ++b) ifm_mm2s[b] = a.alloc(0);
+        for (int c = 0; c < 2; ++c) {
+            for (int p = 0; p < 2; ++p) {
+                wgt[c].write[p] = a.alloc(wgt_s2mm_ch(c));
+                wgt[c].release[p] = a.alloc(wgt_s2mm_ch(c));
+                for (int r = 0; r < WGT_READERS; ++r) wgt[c].read[r][p] = a.alloc(wgt_mm2s_ch(c, r));
+            }
+        }
+        for (int p = 0; p < 2; ++p) {
+            for (int r = 0; r < NUM_ROWS; ++r) ofm_s2mm[r][p] = a.alloc(2 + r);
+            for (int r = 0; r < NUM_ROWS; ++r) ofm_mm2s[p][r] = a.alloc(OFM_MM2S_CH);
+        }
+    }
+
+    void configure_prm(int col) const
+    {
+        configure_bd(col, prm_s2mm, L::PRM_ADDR, 0, L::PRM_WORDS, {1}, {},
+                     {PRM_FREE, -1}, {PRM_FULL, +1});
+        configure_bd(col, prm_mm2s, L::PRM_ADDR, 0, CORE_IN1_SIZE / sizeof(uint32_t), {1}, {},
+                     {PRM_FULL, -1}, {PRM_FREE, +1});
+        adf::initializeLock(adf::memory_tile, col, 0, PRM_FREE, +1);
+        adf::initializeLock(adf::memory_tile, col, 0, PRM_FULL, +0);
+    }
+
+    void configure_ifm(int col) const
+    {
+        configure_bd(col, ifm_s2mm, L::IFM_ADDR, 0, L::IFM_WORDS, {1}, {},
+                     {IFM_FREE, -L::IFM_REPEAT}, {IFM_FULL, +L::IFM_REPEAT});
+        for (int b = 0; b < IFM_MM2S_BDS; ++b) {
+            // each core input message is a full CORE_IN1_SIZE window starting at the subv
+            configure_bd(col, ifm_mm2s[b], L::IFM_ADDR, b * L::IFM_SUBVS_PER_BD * L::IFM_SUBV_WORDS,
+                         L::IFM_SUBVS_PER_BD * (CORE_IN1_SIZE / sizeof(uint32_t)),
+                         {1, (uint32_t)L::IFM_SUBV_WORDS}, {CORE_IN1_SIZE / sizeof(uint32_t)},
+                         b == 0 ? Lock{IFM_FULL, -1} : NO_LOCK,
+                         b == IFM_MM2S_BDS - 1 ? Lock{IFM_FREE, +1} : NO_LOCK,
+                         b == IFM_MM2S_BDS - 1 ? -1 : ifm_mm2s[b + 1]);
+        }
+        adf::initializeLock(adf::memory_tile, col, 0, IFM_FREE, +L::IFM_REPEAT);
+        adf::initializeLock(adf::memory_tile, col, 0, IFM_FULL, +0);
+    }
+
+    void configure_wgt(int col, int c) const
+    {
+        WgtBds const& bds = wgt[c];
+        for (int p = 0; p < 2; ++p) {
+            int const addr = L::WGT_ADDR + (2 * p + c) * L::WGT_BUF_SIZE;
+            configure_bd(col, bds.write[p], addr, 0, WGT_READERS * L::WGT_SUBV_WORDS, {1}, {},
+                         {wgt_free(c, p), -WGT_READERS}, {wgt_full(c, p, 0), +1}, bds.release[p]);
+            configure_release_bd(col, bds.release[p], {wgt_full(c, p, 1), +1},
+                                 p == 0 ? bds.write[1] : -1);
+            for (int r = 0; r < WGT_READERS; ++r) {
+                // the core reads a full CORE_IN2_SIZE window starting at its subv
+                configure_bd(col, bds.read[r][p], addr, r * L::WGT_SUBV_WORDS,
+                             CORE_IN2_SIZE / sizeof(uint32_t), {1}, {},
+                             {wgt_full(c, p, r), -1}, {wgt_free(c, p), +1},
+                             p == 0 ? bds.read[r][1] : -1);
+            }
+        }
+        for (int p = 0; p < 2; ++p) {
+            adf::initializeLock(adf::memory_tile, col, 0, wgt_free(c, p), +WGT_READERS);
+            for (int r = 0; r < WGT_READERS; ++r)
+                adf::initializeLock(adf::memory_tile, col, 0, wgt_full(c, p, r), +0);
+        }
+    }
+
+    void configure_ofm(int col) const
+    {
+        for (int p = 0; p < 2; ++p) {
+            int const addr = L::OFM_ADDR + p * L::OFM_BUF_SIZE;
+            for (int r = 0; r < NUM_ROWS; ++r) {
+                configure_bd(col, ofm_s2mm[r][p], addr, r * L::OFM_CORE_WORDS, L::OFM_CORE_WORDS,
+                             {1}, {}, {ofm_free(p, r), -1}, {ofm_full(p), +1},
+                             p == 0 ? ofm_s2mm[r][1] : -1);
+            }
+            configure_bd(col, ofm_mm2s[p][0], addr, 0, Mgemm * N_SUBV * NUM_ROWS,
+                         {1, N_SUBV, (uint32_t)L::OFM_CORE_WORDS}, {N_SUBV, Mgemm},
+                         {ofm_full(p), -NUM_ROWS}, {ofm_free(p, 0), +1}, ofm_mm2s[p][1]);
+            for (int r = 1; r < NUM_ROWS; ++r) {
+                int const next = r + 1 < NUM_ROWS ? ofm_mm2s[p][r + 1] : (p == 0 ? ofm_mm2s[1][0] : -1);
+                configure_release_bd(col, ofm_mm2s[p][r], {ofm_free(p, r), +1}, next);
+            }
+        }
+        for (int p = 0; p < 2; ++p) {
+            for (int r = 0; r < NUM_ROWS; ++r)
+                adf::initializeLock(adf::memory_tile, col, 0, ofm_free(p, r), +1);
+            adf::initializeLock(adf::memory_tile, col, 0, ofm_full(p), +0);
+        }
+    }
+
+    void enqueue(int col, int set) const
+    {
+        switch (set) {
+        case 0:
+            adf::enqueueTask(adf::memory_tile, col, 0, adf::dma_s2mm, 0, prm_s2mm, 1, false);
+            adf::enqueueTask(adf::memory_tile, col, 0, adf::dma_mm2s, 0, prm_mm2s, 1, false);
+            break;
+        case 1:
+            adf::enqueueTask(adf::memory_tile, col, 0, adf::dma_s2mm, 0, ifm_s2mm, 1, false);
+            adf::enqueueTask(adf::memory_tile, col, 0, adf::dma_mm2s, 0, ifm_mm2s[0], L::IFM_REPEAT, false);
+            break;
+        case 2:
+        case 3: {
+            int const c = set - 2;
+            adf::enqueueTask(adf::memory_tile, col, 0, adf::dma_s2mm, wgt_s2mm_ch(c), wgt[c].write[0], L::WGT_REPEAT, false);
+            for (int r = 0; r < WGT_READERS; ++r)
+                adf::enqueueTask(adf::memory_tile, col, 0, adf::dma_mm2s, wgt_mm2s_ch(c, r), wgt[c].read[r][0], L::WGT_REPEAT, false);
+            break;
+        }
+        case 4:
+            for (int r = 0; r < NUM_ROWS; ++r)
+                adf::enqueueTask(adf::memory_tile, col, 0, adf::dma_s2mm, 2 + r, ofm_s2mm[r][0], L::OFM_REPEAT, false);
+            adf::enqueueTask(adf::memory_tile, col, 0, adf::dma_mm2s, OFM_MM2S_CH, ofm_mm2s[0][0], L::OFM_REPEAT, false);
+            break;
+        }
+    }
+
+    // The params & ifm share channel 0, so its channels are only waited on once
+    void wait(int col, int set) const
+    {
+        switch (set) {
+        case 0:
+            adf::waitDMAChannelDone(adf::memory_tile, col, 0, adf::dma_s2mm, 0);
+            adf::waitDMAChannelDone(adf::memory_tile, col, 0, adf::dma_mm2s, 0);
+            break;
+        case 2:
+        case 3: {
+            int const c = set - 2;
+            if (wgt_s2mm_ch(c) != 0)
+                adf::waitDMAChannelDone(adf::memory_tile, col, 0, adf::dma_s2mm, wgt_s2mm_ch(c));
+            for (int r = 0; r < WGT_READERS; ++r)
+                adf::waitDMAChannelDone(adf::memory_tile, col, 0, adf::dma_mm2s, wgt_mm2s_ch(c, r));
+            break;
+        }
+        case 4:
+            for (int r = 0; r < NUM_ROWS; ++r)
+                adf::waitDMAChannelDone(adf::memory_tile, col, 0, adf::dma_s2mm, 2 + r);
+            adf::waitDMAChannelDone(adf::memory_tile, col, 0, adf::dma_mm2s, OFM_MM2S_CH);
+            break;
+        }
+    }
+
+    void run() const
+    {
+        int const NUM_SETS = 5;
+        for (int col = 0; col < NUM_COLS; ++col) configure_prm(col);
+        for (int col = 0; col < NUM_COLS; ++col) configure_ifm(col);
+        for (int c = 0; c < 2; ++c)
+            for (int col = 0; col < NUM_COLS; ++col) configure_wgt(col, c);
+        for (int col = 0; col < NUM_COLS; ++col) configure_ofm(col);
+
+        for (int col = 0; col < NUM_COLS; ++col)
+            adf::initializeLock(adf::memory_tile, col, 0, 0, +0);
+        for (int col = 0; col < NUM_COLS; ++col)
+            adf::initializeLock(adf::shim_tile, col, 0, 0, +0);
+
+        for (int set = 0; set < NUM_SETS; ++set)
+            for (int col = 0; col < NUM_COLS; ++col) enqueue(col, set);
+        for (int set = 0; set < NUM_SETS; ++set)
+            for (int col = 0; col < NUM_COLS; ++col) wait(col, set);
+    }
+};
+
+//
+// Memtile BD/lock config & task enqueue of a Mgemm x Kgemm x Ngemm GEMM, the
+// drop-in for the run_host_bd_config() of a generated bd_config.h.
+//
+template <int Mgemm, int Kgemm, int Ngemm>
+void run_host_bd_config()
+{
+    typedef GemmLayout<Mgemm, Kgemm, Ngemm> L;
+    static_assert(L::supported, "GEMM shape not supported by the memtile BD layout generator!");
+    static_assert(sizeof(CoreSubv) % sizeof(uint32_t) == 0, "Invalid core subvolume format!");
+    static_assert(CORE_IN2_SIZE >= (int)sizeof(CoreSubv), "Core in2 buffer smaller than a subvolume!");
+    MemtileConfig<Mgemm, Kgemm, Ngemm>().run();
+}
+
+} // namespace bd_layout
+
+#endif // BD_LAYOUT_H
@@ -6,6 +6,7 @@
 
 #include "graph.h"
 #include "bd_config.h"
+#include "bd_layout.h"
 #include "config.h"
 #include "subv_formatting.h"
 #include "data_helpers.h"
@@ -565,7 +566,13 @@ int main(void)
         ddr_range  << "inter_size " << 0 << std::endl;
         ddr_range.close();
     }
-    run_host_bd_config();
+    // Token phase shapes get their memtile config from the layout generator,
+    // the other shapes from the bd_config.h of the python DMA compiler
+    if constexpr (bd_layout::GemmLayout<Mgemm, Kgemm, Ngemm>::supported) {
+        bd_layout::run_host_bd_config<Mgemm, Kgemm, Ngemm>();
+    } else {
+        run_host_bd_config();
+    }
     #if TXN_FLOW == 1
         #ifdef __AIESIM__
             for (int col = 0; col < NUM_COLS; ++col) {
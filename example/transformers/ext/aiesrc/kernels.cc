@@ -133,7 +133,12 @@ void gemm_MxK_Kx128_bf16(
 // where q is a vector of int4 quantized weights, z is
 // an int4 zero point, and s is a bfloat16 scaling factor.
 // The same zero point and scaling factor are shared across
-// groups of 32 weights.
+// groups of 32 weights. The int4 quants/zeros are signed if sign
+// is set, unsigned otherwise.
+//
+// Since q - z is exact in int8 and both products are exact in fp32,
+// this is computed as w = q * s + (-z * s), with -z * s computed once
+// per subvolume. This leaves a single MAC per vector of weights.
 //
 // Group vectors are stored into dst1 and dst2. They are interleaved
 // so that every even group is stored in dst1 and every odd group
@@ -166,13 +171,17 @@ void dequant_weights_Kx128(int8_t* src, int8_t* dst1, int8_t* dst2, int sign)
     v64bfloat16 s0 = scales[0];
     v64bfloat16 s1 = scales[1];
 
+    v64int8     nz0 = sub(aie::zeros<int8, 64>(), z0);
+    v64int8     nz1 = sub(aie::zeros<int8, 64>(), z1);
+    v64accfloat zs0 = mul_elem_64(aie::to_float<bfloat16>(aie::vector<int8, 64>(nz0)), s0);
+    v64accfloat zs1 = mul_elem_64(aie::to_float<bfloat16>(aie::vector<int8, 64>(nz1)), s1);
+
     for (int i = 0; i < Kt; ++i) {
         // Compute first 64 elements of row
         {
             v64int8     quant = unpack(*quants++, sign);
-            v64int8     diff  = sub(quant, z0);
-            v64bfloat16 bf    = aie::to_float<bfloat16>(aie::vector<int8, 64>(diff));
-            v64accfloat wgt   = mul_elem_64(bf, s0);
+            v64bfloat16 bf    = aie::to_float<bfloat16>(aie::vector<int8, 64>(quant));
+            v64accfloat wgt   = mac_elem_64(bf, s0, zs0);
             *wgts1++ = srs_to_v32bfloat16(extract_v32accfloat(wgt, 0));
             *wgts2++ = srs_to_v32bfloat16(extract_v32accfloat(wgt, 1));
         }
@@ -180,9 +189,8 @@ void dequant_weights_Kx128(int8_t* src, int8_t* dst1, int8_t* dst2, int sign)
         // Compute next 64 elements of row
         {
             v64int8     quant = unpack(*quants++, sign);
-            v64int8     diff  = sub(quant, z1);
-            v64bfloat16 bf    = aie::to_float<bfloat16>(aie::vector<int8, 64>(diff));
-            v64accfloat wgt   = mul_elem_64(bf, s1);
+            v64bfloat16 bf    = aie::to_float<bfloat16>(aie::vector<int8, 64>(quant));
+            v64accfloat wgt   = mac_elem_64(bf, s1, zs1);
             *wgts1++ = srs_to_v32bfloat16(extract_v32accfloat(wgt, 0));
             *wgts2++ = srs_to_v32bfloat16(extract_v32accfloat(wgt, 1));
         }
@@ -269,13 +277,16 @@ void gemm_wrapper(
             buf_in2.acquire();
             start = get_cycles();
             dequant_weights(buf_in2.data(), buf_wgt1, buf_wgt2, sign);
+            // The quantized subvolume is consumed once dequantized, so hand
+            // its buffer back to the DMA now. The next but one subvolume is
+            // transferred during the GeMM instead of after it.
+            buf_in2.release();
             gemm(buf_in1.data(),
                  buf_wgt1,
                  buf_wgt2,
                  buf_out_p,
                  kernel_rows);
             end = get_cycles();
-            buf_in2.release();
             buf_in1.release();
         }
         {
@@ -11,6 +11,7 @@
 #include <fstream>
 #include <iterator>
 #include <iostream>
+#include <numeric>
 #include <regex>
 #include <sstream>
 #include <string>
@@ -687,6 +688,10 @@ bool gpt_params_find_arg(int argc, char ** argv, const std::string & arg, gpt_pa
         params.n_draft = std::stoi(argv[i]);
         return true;
     }
+    if (arg == "--draft-pipeline") {
+        params.draft_pipeline = true;
+        return true;
+    }
     if (arg == "--chunks") {
         if (++i >= argc) {
             invalid_param = true;
@@ -856,6 +861,10 @@ bool gpt_params_find_arg(int argc, char ** argv, const std::string & arg, gpt_pa
         params.embedding = true;
         return true;
     }
+    if (arg == "--embd-pack") {
+        params.embd_pack = true;
+        return true;
+    }
     if (arg == "--interactive-first") {
         params.interactive_first = true;
         return true;
@@ -1458,6 +1467,7 @@ void gpt_print_usage(int /*argc*/, char ** argv, const gpt_params & params) {
     printf("  --yarn-beta-fast N    YaRN: low correction dim or beta (default: %.1f)\n", params.yarn_beta_fast);
     printf("  --pooling {none,mean,cls}\n");
     printf("                        pooling type for embeddings, use model default if unspecified\n");
+    printf("  --embd-pack           pack the embedding inputs into full batches, longest first (default: disabled)\n");
     printf("  -dt N, --defrag-thold N\n");
     printf("                        KV cache defragmentation threshold (default: %.1f, < 0 - disabled)\n", params.defrag_thold);
     printf("  --ignore-eos          ignore end of stream token and continue generating (implies --logit-bias 2-inf)\n");
@@ -1473,6 +1483,7 @@ void gpt_print_usage(int /*argc*/, char ** argv, const gpt_params & params) {
     printf("  --kl-divergence       computes KL-divergence to logits provided via --kl-divergence-base\n");
     printf("  --keep N              number of tokens to keep from the initial prompt (default: %d, -1 = all)\n", params.n_keep);
     printf("  --draft N             number of tokens to draft for speculative decoding (default: %d)\n", params.n_draft);
+    printf("  --draft-pipeline      run the draft and target models concurrently, e.g. on different backends (default: disabled)\n");
     printf("  --chunks N            max number of chunks to process (default: %d, -1 = all)\n", params.n_chunks);
     printf("  -np N, --parallel N   number of parallel sequences to decode (default: %d)\n", params.n_parallel);
     printf("  -ns N, --sequences N  number of sequences to decode (default: %d)\n", params.n_sequences);
@@ -2791,6 +2802,28 @@ float llama_embd_similarity_cos(const float * embd1, const float * embd2, int n)
     return sum / (sqrt(sum1) * sqrt(sum2));
 }
 
+std::vector<std::vector<int>> llama_embd_pack_batches(const std::vector<size_t> & n_tokens, size_t n_batch) {
+    std::vector<int> order(n_tokens.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return n_tokens[a] > n_tokens[b]; });
+
+    std::vector<std::vector<int>> batches;
+    std::vector<size_t> batch_tokens;
+    for (int i : order) {
+        size_t b = 0;
+        while (b < batches.size() && batch_tokens[b] + n_tokens[i] > n_batch) {
+            b++;
+        }
+        if (b == batches.size()) {
+            batches.emplace_back();
+            batch_tokens.push_back(0);
+        }
+        batches[b].push_back(i);
+        batch_tokens[b] += n_tokens[i];
+    }
+    return batches;
+}
+
 //
 // Control vector utils
 //
@@ -143,11 +143,13 @@ struct gpt_params {
     bool prompt_cache_ro   = false; // open the prompt cache read-only and do not update it
 
     bool embedding         = false; // get only sentence embedding
+    bool embd_pack         = false; // pack the embedding inputs into full batches, longest first
     bool escape            = false; // escape "\n", "\r", "\t", "\'", "\"", and "\\"
     bool interactive_first = false; // wait for user input immediately
     bool multiline_input   = false; // reverse the usage of `\`
     bool simple_io         = false; // improves compatibility with subprocesses and limited consoles
     bool cont_batching     = true;  // insert new sequences for decoding on-the-fly
+    bool draft_pipeline    = false; // overlap the draft and target model evals of speculative decoding
 
     bool input_prefix_bos  = false; // prefix BOS to user inputs, preceding input_prefix
     bool ignore_eos        = false; // ignore generated EOS tokens
@@ -295,6 +297,10 @@ void llama_embd_normalize(const float * inp, float * out, int n);
 
 float llama_embd_similarity_cos(const float * embd1, const float * embd2, int n);
 
+// Group sequences of n_tokens[i] tokens into batches of at most n_batch tokens, longest first, each
+// sequence going to the first batch it fits in. Returns the sequence indices of each batch.
+std::vector<std::vector<int>> llama_embd_pack_batches(const std::vector<size_t> & n_tokens, size_t n_batch);
+
 //
 // Control vector utils
 //
@@ -1,7 +1,12 @@
 #include "common.h"
 #include "llama.h"
+#ifdef GGML_USE_RYZENAI
+#include "ggml-ryzenai.h"
+#endif
 
+#include <algorithm>
 #include <ctime>
+#include <numeric>
 
 #if defined(_MSC_VER)
 #pragma warning(disable: 4244 4267) // possible loss of data
@@ -151,32 +156,69 @@ int main(int argc, char ** argv) {
     std::vector<float> embeddings(n_prompts * n_embd, 0);
     float * emb = embeddings.data();
 
-    // break into batches
-    int p = 0; // number of prompts processed already
-    int s = 0; // number of prompts in current batch
-    for (int k = 0; k < n_prompts; k++) {
-        // clamp to n_batch tokens
-        auto & inp = inputs[k];
+    if (params.embd_pack && !inputs.empty()) {
+        // fill batches of the size the NPU kernels run without padding rows,
+        // the prompts reordered longest first
+        std::vector<size_t> n_tokens;
+        for (const auto & inp : inputs) {
+            n_tokens.push_back(inp.size());
+        }
+        size_t n_tile = n_batch;
+#ifdef GGML_USE_RYZENAI
+        n_tile = ggml_ryzenai_align_rows(n_batch);
+#endif
+        n_tile = std::max(n_tile, *std::max_element(n_tokens.begin(), n_tokens.end()));
 
-        const uint64_t n_toks = inp.size();
+        const auto batches = llama_embd_pack_batches(n_tokens, n_tile);
+        std::vector<float> batch_emb;
 
-        // encode if at capacity
-        if (batch.n_tokens + n_toks > n_batch) {
-            float * out = emb + p * n_embd;
-            batch_decode(ctx, batch, out, s, n_embd);
+        const int64_t t_start = ggml_time_us();
+        for (const auto & seqs : batches) {
             llama_batch_clear(batch);
-            p += s;
-            s = 0;
+            for (size_t s = 0; s < seqs.size(); s++) {
+                batch_add_seq(batch, inputs[seqs[s]], s);
+            }
+            batch_emb.assign(seqs.size() * n_embd, 0);
+            batch_decode(ctx, batch, batch_emb.data(), seqs.size(), n_embd);
+            for (size_t s = 0; s < seqs.size(); s++) {
+                std::copy_n(batch_emb.data() + s * n_embd, n_embd, emb + seqs[s] * n_embd);
+            }
         }
+        const double t_s = (ggml_time_us() - t_start) / 1e6;
+
+        const size_t n_total = std::accumulate(n_tokens.begin(), n_tokens.end(), size_t(0));
+        fprintf(stderr, "%s: packed %d prompts into %zu batches of %zu tokens, %.1f%% full\n", __func__,
+                n_prompts, batches.size(), n_tile, 100.0 * n_total / (batches.size() * n_tile));
+        fprintf(stderr, "%s: %.3f s, %.2f sequences/s, %.2f tokens/s\n", __func__,
+                t_s, n_prompts / t_s, n_total / t_s);
+    } else {
+        // break into batches
+        int p = 0; // number of prompts processed already
+        int s = 0; // number of prompts in current batch
+        for (int k = 0; k < n_prompts; k++) {
+            // clamp to n_batch tokens
+            auto & inp = inputs[k];
+
+            const uint64_t n_toks = inp.size();
+
+            // encode if at capacity
+            if (batch.n_tokens + n_toks > n_batch) {
+                float * out = emb + p * n_embd;
+                batch_decode(ctx, batch, out, s, n_embd);
+                llama_batch_clear(batch);
+                p += s;
+                s = 0;
+            }
 
-        // add to batch
-        batch_add_seq(batch, inp, s);
-        s += 1;
-    }
+            // add to batch
+            batch_add_seq(batch, inp, s);
+            s += 1;
+        }
 
-    // final batch
-    float * out = emb + p * n_embd;
-    batch_decode(ctx, batch, out, s, n_embd);
+        // final batch
+        float * out = emb + p * n_embd;
+        batch_decode(ctx, batch, out, s, n_embd);
+    }
 
     // print the first part of the embeddings or for a single prompt, the full embedding
     fprintf(stdout, "\n");
@@ -22,6 +22,9 @@
 #include "common.h"
 #include "ggml-cuda.h"
 #include "ggml-sycl.h"
+#ifdef GGML_USE_RYZENAI
+#include "ggml-ryzenai.h"
+#endif
 
 // utils
 static uint64_t get_time_ns() {
@@ -618,6 +621,7 @@ struct test {
     static const bool sycl;
     static const bool gpu_blas;
     static const bool blas;
+    static const bool ryzenai;
     static const std::string cpu_info;
     static const std::string gpu_info;
     std::string model_filename;
@@ -640,6 +644,14 @@ struct test {
     int n_gen;
     std::string test_time;
     std::vector<uint64_t> samples_ns;
+    // RyzenAI time split, averaged over the reps. weight_init is the NPU
+    // weight preparation of the model, at load and during the warmup.
+    int64_t npu_calls = 0;
+    int64_t npu_dispatches = 0;
+    uint64_t npu_ns = 0;
+    uint64_t npu_convert_ns = 0;
+    uint64_t npu_host_ns = 0;
+    uint64_t npu_weight_init_ns = 0;
 
     test(const cmd_params_instance & inst, const llama_model * lmodel, const llama_context * ctx) {
         model_filename = inst.model;
@@ -712,6 +724,9 @@ struct test {
         if (sycl) {
             return GGML_SYCL_NAME;
         }
+        if (ryzenai) {
+            return "RyzenAI";
+        }
         if (gpu_blas) {
             return "GPU BLAS";
         }
@@ -725,7 +740,7 @@ struct test {
     static const std::vector<std::string> & get_fields() {
         static const std::vector<std::string> fields = {
             "build_commit", "build_number",
-            "cuda", "opencl", "vulkan", "kompute", "metal", "sycl", "gpu_blas", "blas",
+            "cuda", "opencl", "vulkan", "kompute", "metal", "sycl", "gpu_blas", "blas", "ryzenai",
             "cpu_info", "gpu_info",
             "model_filename", "model_type", "model_size", "model_n_params",
             "n_batch", "n_ubatch",
@@ -735,7 +750,9 @@ struct test {
             "tensor_split", "use_mmap", "embeddings",
             "n_prompt", "n_gen", "test_time",
             "avg_ns", "stddev_ns",
-            "avg_ts", "stddev_ts"
+            "avg_ts", "stddev_ts",
+            "npu_calls", "npu_dispatches", "npu_ns", "npu_convert_ns", "npu_host_ns",
+            "npu_weight_init_ns"
         };
         return fields;
     }
@@ -748,11 +765,13 @@ struct test {
             field == "model_size" || field == "model_n_params" ||
             field == "n_gpu_layers" || field == "main_gpu" ||
             field == "n_prompt" || field == "n_gen" ||
-            field == "avg_ns" || field == "stddev_ns") {
+            field == "avg_ns" || field == "stddev_ns" ||
+            field == "npu_calls" || field == "npu_dispatches" || field == "npu_ns" ||
+            field == "npu_convert_ns" || field == "npu_host_ns" || field == "npu_weight_init_ns") {
             return INT;
         }
         if (field == "cuda" || field == "opencl"  || field == "vulkan" || field == "kompute" || field == "metal" ||
-            field == "gpu_blas" || field == "blas" || field == "sycl" ||field == "f16_kv" || field == "no_kv_offload" ||
+            field == "gpu_blas" || field == "blas" || field == "sycl" || field == "ryzenai" || field == "f16_kv" || field == "no_kv_offload" ||
             field == "use_mmap" || field == "embeddings") {
             return BOOL;
         }
@@ -782,6 +801,7 @@ struct test {
             build_commit, std::to_string(build_number),
             std::to_string(cuda), std::to_string(opencl), std::to_string(vulkan), std::to_string(vulkan),
             std::to_string(metal), std::to_string(sycl), std::to_string(gpu_blas), std::to_string(blas),
+            std::to_string(ryzenai),
             cpu_info, gpu_info,
             model_filename, model_type, std::to_string(model_size), std::to_string(model_n_params),
             std::to_string(n_batch), std::to_string(n_ubatch),
@@ -791,7 +811,10 @@ struct test {
             tensor_split_str, std::to_string(use_mmap), std::to_string(embeddings),
             std::to_string(n_prompt), std::to_string(n_gen), test_time,
             std::to_string(avg_ns()), std::to_string(stdev_ns()),
-            std::to_string(avg_ts()), std::to_string(stdev_ts())
+            std::to_string(avg_ts()), std::to_string(stdev_ts()),
+            std::to_string(npu_calls), std::to_string(npu_dispatches), std::to_string(npu_ns),
+            std::to_string(npu_convert_ns), std::to_string(npu_host_ns),
+            std::to_string(npu_weight_init_ns)
         };
         return values;
     }
@@ -816,6 +839,7 @@ const bool        test::metal        = !!ggml_cpu_has_metal();
 const bool        test::gpu_blas     = !!ggml_cpu_has_gpublas();
 const bool        test::blas         = !!ggml_cpu_has_blas();
 const bool        test::sycl         = !!ggml_cpu_has_sycl();
+const bool        test::ryzenai      = !!ggml_cpu_has_ryzenai();
 const std::string test::cpu_info     = get_cpu_info();
 const std::string test::gpu_info     = get_gpu_info();
 
@@ -973,7 +997,7 @@ struct markdown_printer : public printer {
         fields.emplace_back("size");
         fields.emplace_back("params");
         fields.emplace_back("backend");
-        bool is_cpu_backend = test::get_backend() == "CPU" || test::get_backend() == "BLAS";
+        bool is_cpu_backend = test::get_backend() == "CPU" || test::get_backend() == "BLAS" || test::get_backend() == "RyzenAI";
         if (!is_cpu_backend) {
             fields.emplace_back("n_gpu_layers");
         }
@@ -1218,6 +1242,10 @@ int main(int argc, char ** argv) {
 
     llama_model * lmodel = nullptr;
     const cmd_params_instance * prev_inst = nullptr;
+#ifdef GGML_USE_RYZENAI
+    // NPU weight preparation of the current model
+    uint64_t npu_weight_init_ns = 0;
+#endif
 
     for (const auto & inst : params_instances) {
         // keep the same model between tests when possible
@@ -1226,6 +1254,10 @@ int main(int argc, char ** argv) {
                 llama_free_model(lmodel);
             }
 
+#ifdef GGML_USE_RYZENAI
+            ggml_ryzenai_reset_stats();
+            npu_weight_init_ns = 0;
+#endif
             lmodel = llama_load_model_from_file(inst.model.c_str(), inst.to_llama_mparams());
             if (lmodel == NULL) {
                 fprintf(stderr, "%s: error: failed to load model '%s'\n", __func__, inst.model.c_str());
@@ -1254,6 +1286,15 @@ int main(int argc, char ** argv) {
             test_gen(ctx, 1, 0, t.n_threads);
         }
 
+#ifdef GGML_USE_RYZENAI
+        // weights not prepared at load are prepared by the warmup
+        ggml_ryzenai_stats npu_stats;
+        ggml_ryzenai_get_stats(&npu_stats);
+        npu_weight_init_ns += npu_stats.weight_init_ns;
+        t.npu_weight_init_ns = npu_weight_init_ns;
+        ggml_ryzenai_reset_stats();
+#endif
+
         for (int i = 0; i < params.reps; i++) {
             llama_kv_cache_clear(ctx);
 
@@ -1269,6 +1310,19 @@ int main(int argc, char ** argv) {
             t.samples_ns.push_back(t_ns);
         }
 
+#ifdef GGML_USE_RYZENAI
+        ggml_ryzenai_get_stats(&npu_stats);
+        if (params.reps > 0) {
+            t.npu_calls = npu_stats.n_calls / params.reps;
+            t.npu_dispatches = npu_stats.n_dispatch / params.reps;
+            t.npu_ns = npu_stats.npu_ns / params.reps;
+            t.npu_convert_ns = npu_stats.convert_ns / params.reps;
+            t.npu_host_ns = npu_stats.host_ns / params.reps;
+        }
+        npu_weight_init_ns += npu_stats.weight_init_ns;
+        ggml_ryzenai_reset_stats();
+#endif
+
         p->print_test(t);
 
         llama_print_timings(ctx);
@@ -2,7 +2,11 @@
 #include "llama.h"
 #include "common.h"
 #include "ngram-cache.h"
+#ifdef GGML_USE_RYZENAI
+#include "ggml-ryzenai.h"
+#endif
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
@@ -19,7 +23,7 @@ int main(int argc, char ** argv){
     }
 
     // max. number of additional tokens to draft if match is found
-    const int n_draft = params.n_draft;
+    int n_draft = params.n_draft;
 
     const bool dump_kv_cache = params.dump_kv_cache;
 
@@ -41,6 +45,13 @@ int main(int argc, char ** argv){
     llama_set_rng_seed(ctx, params.seed);
     GGML_ASSERT(llama_n_vocab(model) < (1 << 16));
 
+#ifdef GGML_USE_RYZENAI
+    // the NPU computes the verification batch padded to the rows of its
+    // kernels, the drafts which fit in the padding are verified for free
+    n_draft = std::max(n_draft, ggml_ryzenai_padded_rows(n_draft + 1) - 1);
+    LOG_TEE("%s: n_draft = %d, sized to the NPU kernel rows\n", __func__, n_draft);
+#endif
+
     // tokenize the prompt
     std::vector<llama_token> inp;
     inp = ::llama_tokenize(ctx, params.prompt, true, true);
@@ -102,6 +113,7 @@ int main(int argc, char ** argv){
     int n_predict = 0;
     int n_drafted = 0;
     int n_accept  = 0;
+    int n_verify  = 0; // target evals of the drafts
 
     int n_past = inp.size();
 
@@ -216,6 +228,7 @@ int main(int argc, char ** argv){
 
         llama_decode(ctx, batch_tgt);
         ++n_past;
+        ++n_verify;
 
         draft.erase(draft.begin());
     }
@@ -240,6 +253,9 @@ int main(int argc, char ** argv){
             t_draft_us*1e-3, 1.0f*t_draft_us/n_drafted, n_drafted/(1e-6*t_draft_us));
     LOG_TEE("n_accept     = %d\n", n_accept);
     LOG_TEE("accept       = %.3f%%\n", 100.0f * n_accept / n_drafted);
+    // a verification costs about a single token eval as long as the drafts
+    // fit in the padded rows of the NPU kernels
+    LOG_TEE("n_verify     = %d, %.3f tokens per target eval\n", n_verify, 1.0f * n_predict / std::max(n_verify, 1));
 
     LOG_TEE("\ntarget:\n");
     llama_print_timings(ctx);
@@ -4,6 +4,9 @@
 #include "json-schema-to-grammar.h"
 #include "llama.h"
 #include "grammar-parser.h"
+#ifdef GGML_USE_RYZENAI
+#include "ggml-ryzenai.h"
+#endif
 
 #ifndef NDEBUG
 // crash the server in debug mode, otherwise send an http 500 error
@@ -35,6 +38,23 @@ using json = nlohmann::ordered_json;
 bool server_verbose = false;
 bool server_log_json = true;
 
+// Max tokens of a batch cutting a prompt : the NPU pads the rows of its
+// matmuls to the m of its kernels, so the last ubatch of the batch is cut
+// where it needs no padding. Bucketing the prompt chunks this way moves the
+// cut tokens to the next batch instead of computing padded rows.
+static int32_t server_prompt_batch_cap(int32_t n_batch, int32_t n_ubatch) {
+#ifdef GGML_USE_RYZENAI
+    const int32_t n_last = n_batch % n_ubatch;
+    const int32_t cap    = n_batch - n_last + (n_last > 0 ? ggml_ryzenai_align_rows(n_last) : 0);
+    // kernels with a large m, keep the batches full
+    if (cap >= n_batch / 2) {
+        return cap;
+    }
+#endif
+    GGML_UNUSED(n_ubatch);
+    return n_batch;
+}
+
 enum stop_type {
     STOP_TYPE_FULL,
     STOP_TYPE_PARTIAL,
@@ -1880,6 +1900,8 @@ struct server_context {
         int32_t n_batch  = llama_n_batch(ctx);
         int32_t n_ubatch = llama_n_ubatch(ctx);
 
+        const int32_t n_batch_prompt = server_prompt_batch_cap(n_batch, n_ubatch);
+
         // next, batch any pending prompts without exceeding n_batch
         if (params.cont_batching || batch.n_tokens == 0) {
             for (auto & slot : slots) {
@@ -2077,7 +2099,7 @@ struct server_context {
 
                     // add prompt tokens for processing in the current batch
                     // TODO: the self-extend stuff here is a mess - simplify and/or abstract it somehow
-                    for (; slot.n_past < slot.n_prompt_tokens && batch.n_tokens < n_batch; ++slot.n_past) {
+                    for (; slot.n_past < slot.n_prompt_tokens && batch.n_tokens < n_batch_prompt; ++slot.n_past) {
                         if (slot.ga_n != 1) {
                             while (slot_npast >= ga_i + ga_w) {
                                 const int bd = (ga_w/ga_n)*(ga_n - 1);
@@ -2126,7 +2148,7 @@ struct server_context {
                     }
                 }
 
-                if (batch.n_tokens >= n_batch) {
+                if (batch.n_tokens >= n_batch_prompt) {
                     break;
                 }
             }
@@ -4,6 +4,7 @@
 #include <cmath>
 #include <cstdio>
 #include <string>
+#include <thread>
 #include <vector>
 #include <set>
 
@@ -151,9 +152,23 @@ int main(int argc, char ** argv) {
     const auto t_enc_start = ggml_time_us();
 
     // eval the prompt with both models
-    llama_decode(ctx_tgt, llama_batch_get_one( inp.data(), n_input - 1, 0,           0));
-    llama_decode(ctx_tgt, llama_batch_get_one(&inp.back(),           1, n_input - 1, 0));
-    llama_decode(ctx_dft, llama_batch_get_one( inp.data(), n_input,     0,           0));
+    // with --draft-pipeline the two models run concurrently, e.g. the draft on the NPU (-ngld) and the target on the CPU
+    {
+        auto eval_tgt = [&]() {
+            llama_decode(ctx_tgt, llama_batch_get_one( inp.data(), n_input - 1, 0,           0));
+            llama_decode(ctx_tgt, llama_batch_get_one(&inp.back(),           1, n_input - 1, 0));
+        };
+        std::thread thread_tgt;
+        if (params.draft_pipeline) {
+            thread_tgt = std::thread(eval_tgt);
+        } else {
+            eval_tgt();
+        }
+        llama_decode(ctx_dft, llama_batch_get_one( inp.data(), n_input,     0,           0));
+        if (thread_tgt.joinable()) {
+            thread_tgt.join();
+        }
+    }
 
     const auto t_enc_end = ggml_time_us();
 
@@ -444,6 +459,18 @@ int main(int argc, char ** argv) {
         llama_batch_clear(batch_tgt);
         llama_batch_add  (batch_tgt, drafts[0].tokens[0], n_past_tgt, { 0 }, true);
 
+        // the target batch is complete once the last draft token is sampled
+        auto eval_tgt = [&]() {
+            llama_kv_cache_seq_keep(ctx_tgt, 0);
+            for (int s = 1; s < n_seq_dft; ++s) {
+                llama_kv_cache_seq_cp(ctx_tgt, 0, s, -1, -1);
+            }
+
+            // LOG("target batch: %s\n", LOG_BATCH_TOSTR_PRETTY(ctx_tgt, batch_tgt).c_str());
+            llama_decode(ctx_tgt, batch_tgt);
+        };
+        bool tgt_done = false;
+
         // sample n_draft tokens from the draft model using tree-based sampling
         for (int i = 0; i < n_draft; ++i) {
             batch_dft.n_tokens = 0;
@@ -540,27 +567,34 @@ int main(int argc, char ** argv) {
                 break;
             }
 
+            const bool last = i == n_draft - 1 || batch_tgt.n_tokens > n_draft;
+
+            // the last draft eval only fills the draft KV cache of the drafted tokens, verify them meanwhile
+            std::thread thread_tgt;
+            if (last && params.draft_pipeline) {
+                thread_tgt = std::thread(eval_tgt);
+                tgt_done = true;
+            }
+
             // evaluate the drafted tokens on the draft model
             llama_decode(ctx_dft, batch_dft);
             ++n_past_cur;
             ++n_drafted;
 
+            if (thread_tgt.joinable()) {
+                thread_tgt.join();
+            }
+
             if (batch_tgt.n_tokens > n_draft) {
                 break;
             }
         }
 
         // evaluate the target model on the drafted tokens
-        {
-            llama_kv_cache_seq_keep(ctx_tgt, 0);
-            for (int s = 1; s < n_seq_dft; ++s) {
-                llama_kv_cache_seq_cp(ctx_tgt, 0, s, -1, -1);
-            }
-
-            // LOG("target batch: %s\n", LOG_BATCH_TOSTR_PRETTY(ctx_tgt, batch_tgt).c_str());
-            llama_decode(ctx_tgt, batch_tgt);
-            ++n_past_tgt;
+        if (!tgt_done) {
+            eval_tgt();
         }
+        ++n_past_tgt;
 
         // the first token is always proposed by the target model before the speculation loop so we erase it here
         for (int s = 0; s < n_seq_dft; ++s) {
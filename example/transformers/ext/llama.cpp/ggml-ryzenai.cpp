@@ -1,16 +1,39 @@
 
+#include <algorithm>
 #include <assert.h>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <deque>
 #include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <mutex>
-#include <string_view>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <tuple>
 #include <unordered_map>
 #include <vector>
 
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include "common/log.h"
 #include "ggml-backend-impl.h"
 #include "ggml-impl.h"
@@ -22,7 +45,13 @@
 #ifndef RYZENAI_EMULATION
 // #include <ryzenai/ryzenai.hpp>
 #include <ryzenai/ops/qlinear_2/qlinear_2.hpp>
-#include <ryzenai/utils/dtype_utils.h>
+#ifdef GGML_RYZENAI_ATTENTION
+#if __has_include(<ryzenai/dynamic_dispatch/ops/bmm/bmm.hpp>)
+#include <ryzenai/dynamic_dispatch/ops/bmm/bmm.hpp>
+#else
+#include <ops/bmm/bmm.hpp>
+#endif
+#endif
 #endif
 
 // Macro for wrapping function calls in try catch
@@ -39,39 +68,27 @@
 
 namespace {
 
-// Transpose inner most dimensions of a vector interpreted as a 4D tensor
-template <typename T>
-std::vector<T> transpose(const std::vector<T> &tensor,
-                         const std::tuple<int, int, int, int> &shapes) {
-
-  const auto &[ne00, ne01, ne02, ne03] = shapes;
+// Group size of the int4 weights handed to qlinear_2
+constexpr int RYZENAI_GROUP_SIZE = 32;
 
-  std::vector<T> transposed_tensor(ne00 * ne01 * ne02 * ne03);
-
-  int64_t s3 = ne00 * ne01 * ne02;
-  int64_t s2 = ne00 * ne01;
-
-  // Transpose the two innermost dimensions
-  for (int64_t b3 = 0; b3 < ne03; ++b3) {
-    for (int64_t b2 = 0; b2 < ne02; ++b2) {
-
-      for (int64_t i = 0; i < ne01; ++i) {
-        for (int64_t j = 0; j < ne00; ++j) {
-          transposed_tensor[b3 * s3 + b2 * s2 + j * ne01 + i] =
-              tensor[b3 * s3 + b2 * s2 + i * ne00 + j];
-        }
-      }
-    }
-  }
-
-  return transposed_tensor;
-}
+// Shapes of the DynamicDispatch bmm kernels of the attention : 32 heads of
+// up to 2048 tokens, attending up to 2048 keys of 128 dims
+constexpr int64_t RYZENAI_BMM_HEADS = 32;
+constexpr int64_t RYZENAI_BMM_ROWS = 2048;
+constexpr int64_t RYZENAI_BMM_HEAD_DIM = 128;
+// The kernels always compute the padded shapes, the attention of smaller
+// batches of tokens (e.g. decode) stays on the CPU
+constexpr int64_t RYZENAI_BMM_MIN_ROWS = 256;
 
 // A quantized ggml tensor will have its weights and scales packed contiguously
 // i.e. two int4 packed into int8
 // We need to unpack the parameters into vectors to make them easier to use
+// Each group of 32 weights dequantizes to scale * (w - zero) + min, the
+// kernel computes the scale * (w - zero) part and the mins are added on the
+// host (see ryzenai_add_mins)
 void unpack_row_q4_0(const char *xx, int k, std::vector<int8_t> &weights,
-                     std::vector<int8_t> &zeros, std::vector<float> &scales) {
+                     std::vector<int8_t> &zeros, std::vector<float> &scales,
+                     std::vector<float> &mins) {
 
   const auto *x = reinterpret_cast<const block_q4_0 *>(xx);
 
@@ -90,7 +107,8 @@ void unpack_row_q4_0(const char *xx, int k, std::vector<int8_t> &weights,
     const float d = GGML_FP16_TO_FP32(x[i].d);
 
     scales.push_back(d);
-    //zeros.push_back(8);
+    zeros.push_back(8);
+    mins.push_back(0.0f);
 
     for (int j = 0; j < qk / 2; ++j) {
       weights.push_back(x[i].qs[j] & 0xF);
@@ -101,8 +119,197 @@ void unpack_row_q4_0(const char *xx, int k, std::vector<int8_t> &weights,
   }
 }
 
+// Q4_1 : d * q + m
+void unpack_row_q4_1(const char *xx, int k, std::vector<int8_t> &weights,
+                     std::vector<int8_t> &zeros, std::vector<float> &scales,
+                     std::vector<float> &mins) {
+
+  const auto *x = reinterpret_cast<const block_q4_1 *>(xx);
+
+  static const int qk = QK4_1;
+  GGML_ASSERT(k % qk == 0);
+
+  const int nb = k / qk;
+
+  for (int i = 0; i < nb; i++) {
+    scales.push_back(GGML_FP16_TO_FP32(x[i].d));
+    zeros.push_back(0);
+    mins.push_back(GGML_FP16_TO_FP32(x[i].m));
+
+    for (int j = 0; j < qk / 2; ++j) {
+      weights.push_back(x[i].qs[j] & 0xF);
+    }
+    for (int j = 0; j < qk / 2; ++j) {
+      weights.push_back(x[i].qs[j] >> 4);
+    }
+  }
+}
+
+#ifndef GGML_QKK_64
+// 6 bit scale and min of sub-block j, as in ggml-quants.c
+void get_scale_min_k4(int j, const uint8_t *q, uint8_t *d, uint8_t *m) {
+  if (j < 4) {
+    *d = q[j] & 63;
+    *m = q[j + 4] & 63;
+  } else {
+    *d = (q[j + 4] & 0xF) | ((q[j - 4] >> 6) << 4);
+    *m = (q[j + 4] >> 4) | ((q[j - 0] >> 6) << 4);
+  }
+}
+
+// Q4_K : super-blocks of 8 sub-blocks of 32, d * sc * q - dmin * m
+void unpack_row_q4_K(const char *xx, int k, std::vector<int8_t> &weights,
+                     std::vector<int8_t> &zeros, std::vector<float> &scales,
+                     std::vector<float> &mins) {
+
+  const auto *x = reinterpret_cast<const block_q4_K *>(xx);
+  GGML_ASSERT(k % QK_K == 0);
+
+  const int nb = k / QK_K;
+
+  for (int i = 0; i < nb; i++) {
+    const float d = GGML_FP16_TO_FP32(x[i].d);
+    const float dmin = GGML_FP16_TO_FP32(x[i].dmin);
+    const uint8_t *q = x[i].qs;
+
+    // 64 weights per 32 bytes of quants : low nibbles, then high nibbles
+    for (int is = 0; is < QK_K / 32; is += 2, q += 32) {
+      uint8_t sc, m;
+      get_scale_min_k4(is + 0, x[i].scales, &sc, &m);
+      scales.push_back(d * sc);
+      zeros.push_back(0);
+      mins.push_back(-dmin * m);
+      for (int l = 0; l < 32; ++l) {
+        weights.push_back(q[l] & 0xF);
+      }
+      get_scale_min_k4(is + 1, x[i].scales, &sc, &m);
+      scales.push_back(d * sc);
+      zeros.push_back(0);
+      mins.push_back(-dmin * m);
+      for (int l = 0; l < 32; ++l) {
+        weights.push_back(q[l] >> 4);
+      }
+    }
+  }
+}
+#endif
+
+// Other weight types are dequantized and requantized to uint4, with one
+// scale and integer zero point per group. This is lossy.
+void unpack_row_requant(const char *xx, enum ggml_type type, int k,
+                        std::vector<int8_t> &weights,
+                        std::vector<int8_t> &zeros, std::vector<float> &scales,
+                        std::vector<float> &mins) {
+
+  static const int qk = RYZENAI_GROUP_SIZE;
+
+  std::vector<float> row(k);
+  ggml_internal_get_type_traits(type).to_float(xx, row.data(), k);
+
+  for (int i = 0; i < k; i += qk) {
+    const auto [min_it, max_it] =
+        std::minmax_element(row.begin() + i, row.begin() + i + qk);
+    // the range has to contain 0 for the zero point to be in [0, 15]
+    const float min = std::min(*min_it, 0.0f);
+    const float max = std::max(*max_it, 0.0f);
+    // smallest scale covering [min, max] with an integer zero point
+    float d = 0.0f;
+    int zero = 8;
+    for (int z = 0; z <= 15; ++z) {
+      if ((z == 0 && min < 0.0f) || (z == 15 && max > 0.0f)) {
+        continue;
+      }
+      const float dz = std::max(z > 0 ? -min / z : 0.0f,
+                                z < 15 ? max / (15 - z) : 0.0f);
+      if (d == 0.0f || dz < d) {
+        d = dz;
+        zero = z;
+      }
+    }
+    if (d == 0.0f) {
+      d = 1.0f;
+    }
+
+    scales.push_back(d);
+    zeros.push_back(zero);
+    mins.push_back(0.0f);
+    for (int j = 0; j < qk; ++j) {
+      const int q = (int)std::round(row[i + j] / d) + zero;
+      weights.push_back(std::clamp(q, 0, 15));
+    }
+  }
+}
+
+// Unpack a row of k weights of src0 into uint4 weights, zeros, scales and
+// mins, one of each per group of RYZENAI_GROUP_SIZE weights
+void unpack_row(const char *xx, enum ggml_type type, int k,
+                std::vector<int8_t> &weights, std::vector<int8_t> &zeros,
+                std::vector<float> &scales, std::vector<float> &mins) {
+  switch (type) {
+  case GGML_TYPE_Q4_0:
+    unpack_row_q4_0(xx, k, weights, zeros, scales, mins);
+    break;
+  case GGML_TYPE_Q4_1:
+    unpack_row_q4_1(xx, k, weights, zeros, scales, mins);
+    break;
+#ifndef GGML_QKK_64
+  case GGML_TYPE_Q4_K:
+    unpack_row_q4_K(xx, k, weights, zeros, scales, mins);
+    break;
+#endif
+  default:
+    unpack_row_requant(xx, type, k, weights, zeros, scales, mins);
+    break;
+  }
+}
+
+// Add the mins of the weights to the kernel output :
+// dst[m, n] += sum_g (sum of src[m, group g]) * mins[g, n]
+// src is [M, K], dst is [M, N], mins is [K / RYZENAI_GROUP_SIZE, N]
+void ryzenai_add_mins(const float *src, float *dst, int64_t M, int64_t K,
+                      int64_t N, const std::vector<float> &mins) {
+  const int64_t num_groups = K / RYZENAI_GROUP_SIZE;
+  for (int64_t m = 0; m < M; ++m) {
+    float *dst_row = dst + m * N;
+    for (int64_t g = 0; g < num_groups; ++g) {
+      const float *x = src + m * K + g * RYZENAI_GROUP_SIZE;
+      float x_sum = 0.0f;
+      for (int j = 0; j < RYZENAI_GROUP_SIZE; ++j) {
+        x_sum += x[j];
+      }
+      const float *min_row = mins.data() + g * N;
+      for (int64_t n = 0; n < N; ++n) {
+        dst_row[n] += x_sum * min_row[n];
+      }
+    }
+  }
+}
+
 } // Anonymous namespace
 
+// Weight types the NPU path accepts. Q8_0 would lose half of its precision
+// in the 4 bit kernels, so it is only offloaded with
+// GGML_RYZENAI_REQUANT_Q8_0=1.
+static bool ggml_ryzenai_supports_type(enum ggml_type type) {
+  switch (type) {
+  case GGML_TYPE_Q4_0:
+  case GGML_TYPE_Q4_1:
+#ifndef GGML_QKK_64
+  case GGML_TYPE_Q4_K:
+#endif
+    return true;
+  case GGML_TYPE_Q8_0: {
+    static const bool requant_q8_0 = [] {
+      const char *env = std::getenv("GGML_RYZENAI_REQUANT_Q8_0");
+      return env != NULL && std::string(env) == "1";
+    }();
+    return requant_q8_0;
+  }
+  default:
+    return false;
+  }
+}
+
 #ifndef RYZENAI_EMULATION
 
 // Currently matrix multiplication depends on qlinear_2 as the primary op
@@ -110,12 +317,16 @@ using op_t = ryzenai::qlinear_2<int16_t, int8_t, float, float>;
 
 // Lockable Singleton
 // Owns our qlinear_2 ops
+// The map is read-mostly : lookups only take the lock shared, so threads
+// running different weights issue their NPU matmuls concurrently. Each op
+// owns its BOs, so the calls on the same weight are serialized by the mutex
+// of its entry instead.
 class RyzenAIContext {
 
   RyzenAIContext() = default;
   RyzenAIContext(const RyzenAIContext &) = delete;
   RyzenAIContext &operator=(const RyzenAIContext &) = delete;
-  std::mutex mtx_;
+  std::shared_mutex mtx_;
 
 public:
   // Get the singleton instance
@@ -127,42 +338,444 @@ public:
   void lock() { mtx_.lock(); }
   void unlock() { mtx_.unlock(); }
 
-  std::unordered_map<std::string_view, op_t> map;
+  // Drop the ops of the weights which live in buffer, called when the
+  // buffer is freed
+  void release(ggml_backend_buffer_t buffer) {
+    std::lock_guard<std::shared_mutex> guard(mtx_);
+    for (auto it = map.begin(); it != map.end();) {
+      if (it->second.buffer == buffer) {
+        it = map.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  struct entry {
+    ggml_backend_buffer_t buffer;
+    std::unique_ptr<std::mutex> mtx = std::make_unique<std::mutex>();
+    // One op per 2D slice of the weights, i02 + i03 * ne02
+    std::vector<std::unique_ptr<op_t>> ops;
+    // Mins of the weight groups of each slice, [K / 32, N], added on the
+    // host. Empty when the weight type has none.
+    std::vector<std::vector<float>> mins;
+  };
+  // Entry of a weight, NULL when it has no ops yet. Entries stay valid
+  // until the buffer of their weight is released.
+  entry *find(const ggml_tensor *tensor) {
+    std::shared_lock<std::shared_mutex> guard(mtx_);
+    auto it = map.find(tensor);
+    return it == map.end() ? nullptr : &it->second;
+  }
+
+  // Executors of each weight tensor, only modified with the lock held
+  std::unordered_map<const ggml_tensor *, entry> map;
+};
+
+// Counters of ggml_ryzenai_get_stats, in ns. Atomics since the mul_mats of
+// different weights run concurrently.
+struct RyzenAIStats {
+  std::atomic<int64_t> n_calls{0};
+  std::atomic<int64_t> n_dispatch{0};
+  std::atomic<int64_t> npu_ns{0};
+  std::atomic<int64_t> convert_ns{0};
+  std::atomic<int64_t> host_ns{0};
+  std::atomic<int64_t> n_weight_init{0};
+  std::atomic<int64_t> weight_init_ns{0};
+
+  static RyzenAIStats &getInstance() {
+    static RyzenAIStats instance;
+    return instance;
+  }
 };
+
+static int64_t ryzenai_elapsed_ns(
+    const std::chrono::steady_clock::time_point &start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+#ifdef GGML_RYZENAI_ATTENTION
+static uint16_t ryzenai_fp32_to_bf16(float f) {
+  uint32_t u;
+  std::memcpy(&u, &f, sizeof(u));
+  // round to nearest even, the inputs are finite
+  u += 0x7fff + ((u >> 16) & 1);
+  return (uint16_t)(u >> 16);
+}
+
+static float ryzenai_bf16_to_fp32(uint16_t h) {
+  const uint32_t u = (uint32_t)h << 16;
+  float f;
+  std::memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+// One of the two bmm kernels of the attention, KQ (q . k^T) or KQV
+// (kq . v), with its padded bf16 operands. The op owns its BOs, the calls
+// are serialized by the mutex. The operand descriptions of the op are built
+// once with the buffers, a call allocates nothing.
+struct RyzenAIBmm {
+  using op_t = ryzenai::bmm<uint16_t, uint16_t, uint16_t>;
+  std::mutex mtx;
+  std::unique_ptr<op_t> op;
+  // [heads][rows][k], [heads][keys][dims], [heads][rows][n]
+  std::vector<uint16_t> a, b, c;
+  std::vector<Tensor> consts, inputs, outputs;
+};
+
+static RyzenAIBmm &ryzenai_bmm(bool kq) {
+  static RyzenAIBmm bmm_kq;
+  static RyzenAIBmm bmm_kqv;
+  return kq ? bmm_kq : bmm_kqv;
+}
+
+// dst[i0, i1, h] = sum_k src0[k, i0, h / r2] * src1[k, i1, h] on the bmm
+// kernels, src0 being a view of the KV cache :
+//   KQ  : src0 is k [dims, keys, heads], k = dims and n = keys. The K cache
+//         is F16 or Q8_0 (-ctk q8_0), whose rows are dequantized to bf16.
+//   KQV : src0 is v^T [keys, dims, heads], k = keys and n = dims, F16
+// Both kernels take k and v as [heads][keys][dims]. The padded rows of A
+// and columns of C are never read back, the padded keys of v are zeroed.
+static void ggml_ryzenai_mul_mat_bmm(const struct ggml_tensor *src0,
+                                     const struct ggml_tensor *src1,
+                                     struct ggml_tensor *dst) {
+  GGML_TENSOR_BINARY_OP_LOCALS
+
+  const bool kq = ne00 == RYZENAI_BMM_HEAD_DIM;
+  const int64_t K = kq ? RYZENAI_BMM_HEAD_DIM : RYZENAI_BMM_ROWS;
+  const int64_t N = kq ? RYZENAI_BMM_ROWS : RYZENAI_BMM_HEAD_DIM;
+  const int64_t r2 = ne12 / ne02;
+
+  auto &bmm = ryzenai_bmm(kq);
+  std::lock_guard<std::mutex> guard(bmm.mtx);
+  if (!bmm.op) {
+    TRY_CATCH(bmm.op = std::make_unique<RyzenAIBmm::op_t>(
+                  "bfloat16", "bfloat16", "bfloat16", false);
+              bmm.op->set_params("BMM", {(size_t)(RYZENAI_BMM_HEADS *
+                                                  RYZENAI_BMM_ROWS),
+                                         (size_t)K}););
+    bmm.a.assign(RYZENAI_BMM_HEADS * RYZENAI_BMM_ROWS * K, 0);
+    bmm.b.assign(RYZENAI_BMM_HEADS * RYZENAI_BMM_ROWS * RYZENAI_BMM_HEAD_DIM,
+                 0);
+    bmm.c.resize(RYZENAI_BMM_HEADS * RYZENAI_BMM_ROWS * N);
+    bmm.consts = {{bmm.b.data(),
+                   {(size_t)(RYZENAI_BMM_HEADS * K), (size_t)N},
+                   "bfloat16"}};
+    bmm.inputs = {{bmm.a.data(),
+                   {(size_t)(RYZENAI_BMM_HEADS * RYZENAI_BMM_ROWS), (size_t)K},
+                   "bfloat16"}};
+    bmm.outputs = {{bmm.c.data(),
+                    {(size_t)(RYZENAI_BMM_HEADS * RYZENAI_BMM_ROWS), (size_t)N},
+                    "bfloat16"}};
+  }
+
+  const auto to_float = ggml_internal_get_type_traits(src0->type).to_float;
+  float k_row[RYZENAI_BMM_HEAD_DIM];
+
+  const auto convert_start = std::chrono::steady_clock::now();
+  for (int64_t h = 0; h < ne12; ++h) {
+    // A[h][i1][k] = src1[k, i1, h]
+    for (int64_t i1 = 0; i1 < ne11; ++i1) {
+      const char *row = (const char *)src1->data + i1 * nb11 + h * nb12;
+      uint16_t *a = bmm.a.data() + (h * RYZENAI_BMM_ROWS + i1) * K;
+      for (int64_t k = 0; k < ne10; ++k) {
+        a[k] = ryzenai_fp32_to_bf16(*(const float *)(row + k * nb10));
+      }
+      std::fill(a + ne10, a + K, 0);
+    }
+    // B[h][key][dim], src0[dim, key] for KQ, src0[key, dim] for KQV
+    const char *s0 = (const char *)src0->data + (h / r2) * nb02;
+    uint16_t *b = bmm.b.data() + h * RYZENAI_BMM_ROWS * RYZENAI_BMM_HEAD_DIM;
+    const int64_t n_keys = kq ? ne01 : ne00;
+    if (kq) {
+      // the rows of k are contiguous, whatever its type
+      for (int64_t key = 0; key < n_keys; ++key) {
+        to_float(s0 + key * nb01, k_row, RYZENAI_BMM_HEAD_DIM);
+        for (int64_t dim = 0; dim < RYZENAI_BMM_HEAD_DIM; ++dim) {
+          b[key * RYZENAI_BMM_HEAD_DIM + dim] =
+              ryzenai_fp32_to_bf16(k_row[dim]);
+        }
+      }
+    } else {
+      for (int64_t key = 0; key < n_keys; ++key) {
+        for (int64_t dim = 0; dim < RYZENAI_BMM_HEAD_DIM; ++dim) {
+          const char *x = s0 + key * nb00 + dim * nb01;
+          b[key * RYZENAI_BMM_HEAD_DIM + dim] = ryzenai_fp32_to_bf16(
+              ggml_fp16_to_fp32(*(const ggml_fp16_t *)x));
+        }
+      }
+    }
+    if (!kq) {
+      std::fill(b + n_keys * RYZENAI_BMM_HEAD_DIM,
+                b + RYZENAI_BMM_ROWS * RYZENAI_BMM_HEAD_DIM, 0);
+    }
+  }
+  int64_t convert_ns = ryzenai_elapsed_ns(convert_start);
+
+  const auto npu_start = std::chrono::steady_clock::now();
+  TRY_CATCH(bmm.op->initialize_const_params(bmm.consts);
+            bmm.op->execute(bmm.inputs, bmm.outputs););
+  const int64_t npu_ns = ryzenai_elapsed_ns(npu_start);
+
+  // dst[i0, i1, h] = C[h][i1][i0]
+  const auto scatter_start = std::chrono::steady_clock::now();
+  for (int64_t h = 0; h < ne12; ++h) {
+    for (int64_t i1 = 0; i1 < ne11; ++i1) {
+      const uint16_t *c = bmm.c.data() + (h * RYZENAI_BMM_ROWS + i1) * N;
+      float *d = (float *)((char *)dst->data + i1 * nb1 + h * nb2);
+      for (int64_t i0 = 0; i0 < ne0; ++i0) {
+        d[i0] = ryzenai_bf16_to_fp32(c[i0]);
+      }
+    }
+  }
+  convert_ns += ryzenai_elapsed_ns(scatter_start);
+
+  auto &stats = RyzenAIStats::getInstance();
+  stats.n_calls++;
+  stats.n_dispatch++;
+  stats.npu_ns += npu_ns;
+  stats.convert_ns += convert_ns;
+}
 #endif
 
-// We can add our own device specific initialization here at startup time
-// Today, we do all init on the fly
-void ggml_ryzenai_init(void) {
-  static bool initialized = false;
-  if (initialized) {
-    return;
+static std::string ryzenai_weight_fname(const std::string &cache_prefix,
+                                        int64_t slice) {
+  return cache_prefix + "." + std::to_string(slice) + ".bin";
+}
+
+static std::string ryzenai_mins_fname(const std::string &cache_prefix,
+                                      int64_t slice) {
+  return cache_prefix + "." + std::to_string(slice) + ".mins";
+}
+
+// Stream the NPU weights from their cache files instead of keeping them all
+// in BOs, see ggml_backend_ryzenai_set_stream_weights
+static bool &ryzenai_stream_weights() {
+  static bool stream = [] {
+    const char *env = std::getenv("GGML_RYZENAI_STREAM_WEIGHTS");
+    return env != NULL && std::string(env) == "1";
+  }();
+  return stream;
+}
+
+// Create the qlinear_2 ops of a weight tensor : the NPU weight files of the
+// cache are loaded (or streamed) when present, otherwise the weights are
+// unpacked, transposed and formatted, then written to the cache.
+// An empty cache_prefix disables the cache, and the streaming with it.
+static void ryzenai_prepare_weights(const struct ggml_tensor *src0,
+                                    RyzenAIContext::entry &entry,
+                                    const std::string &cache_prefix) {
+  GGML_TENSOR_LOCALS(int64_t, ne0, src0, ne)
+  GGML_TENSOR_LOCALS(size_t, nb0, src0, nb)
+
+  entry.buffer = src0->buffer;
+
+  if (!cache_prefix.empty() &&
+      std::filesystem::exists(ryzenai_weight_fname(cache_prefix, 0))) {
+    try {
+      for (int64_t slice = 0; slice < ne02 * ne03; ++slice) {
+        entry.ops.push_back(
+            std::make_unique<op_t>("bfloat16", "uint4", "float32"));
+        if (ryzenai_stream_weights()) {
+          entry.ops.back()->initialize_weights_streamed(
+              ryzenai_weight_fname(cache_prefix, slice));
+        } else {
+          entry.ops.back()->initialize_weights_from_file(
+              ryzenai_weight_fname(cache_prefix, slice));
+        }
+
+        const auto mins_fname = ryzenai_mins_fname(cache_prefix, slice);
+        if (std::filesystem::exists(mins_fname)) {
+          std::vector<float> mins(ne00 / RYZENAI_GROUP_SIZE * ne01);
+          std::ifstream ifs(mins_fname, std::ios::binary);
+          ifs.read((char *)mins.data(), mins.size() * sizeof(float));
+          if (!ifs) {
+            throw std::runtime_error("failed to read " + mins_fname);
+          }
+          entry.mins.resize(ne02 * ne03);
+          entry.mins[slice] = std::move(mins);
+        }
+      }
+      return;
+    } catch (const std::exception &e) {
+      // stale or partial cache, convert the weights again
+      std::cerr << "Ignoring the cached weights of " << src0->name << " : "
+                << e.what() << std::endl;
+      entry.ops.clear();
+      entry.mins.clear();
+    }
   }
-  initialized = true;
+
+  // Need to transpose the weights and scales
+  // Why you ask?
+  // GGML's matmul does A * B^T = C^T // B is already assumed transposed
+  // This is for maximal cache hit efficiency
+  // qlinear_2 does A * B = C where B must be the weights
+  // Here we see that the weights are presented as A, so we need to swap A and
+  // B I make use of the matrix multiplication transpose property B^T * A^T =
+  // C^T So if we transpose the weights, and feed the input directly in,
+  // qlinear_2 will compute C^T as ggml expects.
+  // The rows are unpacked straight into the K x N slices, a block of rows
+  // at a time so that each column of the block is written contiguously.
+  const int64_t num_groups = ne00 / RYZENAI_GROUP_SIZE;
+  std::vector<int8_t> transposed_weights(ggml_nelements(src0)); // int4 weights
+  std::vector<int8_t> transposed_zeros( // 8s for Q4_0 quantization scheme
+      ggml_nelements(src0) / RYZENAI_GROUP_SIZE);
+  std::vector<float> transposed_scales(transposed_zeros.size());
+  std::vector<float> transposed_mins(transposed_zeros.size());
+  std::vector<float> bias(ne01, 0); // Vector of zeros, should have size N in MxK * K*N
+
+  constexpr int64_t ROW_BLOCK = 16;
+  std::vector<int8_t> weights; // unpacked rows of the block
+  std::vector<int8_t> zeros;
+  std::vector<float> scales;
+  std::vector<float> mins;
+  weights.reserve(ROW_BLOCK * ne00);
+  zeros.reserve(ROW_BLOCK * num_groups);
+  scales.reserve(ROW_BLOCK * num_groups);
+  mins.reserve(ROW_BLOCK * num_groups);
+
+  const void *w = src0->data;
+  for (int64_t i03 = 0; i03 < ne03; ++i03) {
+    for (int64_t i02 = 0; i02 < ne02; ++i02) {
+      const int64_t slice = i02 + i03 * ne02;
+      int8_t *tw = transposed_weights.data() + slice * ne00 * ne01;
+      const int64_t group_offset = slice * num_groups * ne01;
+      for (int64_t r0 = 0; r0 < ne01; r0 += ROW_BLOCK) {
+        const int64_t rows = std::min(ROW_BLOCK, ne01 - r0);
+        weights.clear();
+        zeros.clear();
+        scales.clear();
+        mins.clear();
+        for (int64_t r = 0; r < rows; ++r) {
+          unpack_row((const char *)w + (r0 + r) * nb01 + i02 * nb02 +
+                         i03 * nb03,
+                     src0->type, ne00, weights, zeros, scales, mins);
+        }
+        for (int64_t j = 0; j < ne00; ++j) {
+          for (int64_t r = 0; r < rows; ++r) {
+            tw[j * ne01 + r0 + r] = weights[r * ne00 + j];
+          }
+        }
+        for (int64_t g = 0; g < num_groups; ++g) {
+          const int64_t dst = group_offset + g * ne01 + r0;
+          for (int64_t r = 0; r < rows; ++r) {
+            transposed_zeros[dst + r] = zeros[r * num_groups + g];
+            transposed_scales[dst + r] = scales[r * num_groups + g];
+            transposed_mins[dst + r] = mins[r * num_groups + g];
+          }
+        }
+      }
+    }
+  }
+
+  auto w_shape = make_tuple(
+      ne00, ne01); // qlinear_2 expects KxN = w_shape[0] x w_shape[1]
+
+  // The transposed slices are still contiguous, one op per slice
+  const int64_t slice_size = ne00 * ne01;
+  for (int64_t slice = 0; slice < ne02 * ne03; ++slice) {
+    TRY_CATCH(entry.ops.push_back(
+        std::make_unique<op_t>("bfloat16", "uint4", "float32")););
+    TRY_CATCH(entry.ops.back()->initialize_weights_int4(
+        transposed_weights.data() + slice * slice_size,
+        transposed_zeros.data() + slice * slice_size / 32,
+        transposed_scales.data() + slice * slice_size / 32, bias.data(),
+        w_shape););
+  }
+
+  if (std::any_of(transposed_mins.begin(), transposed_mins.end(),
+                  [](float m) { return m != 0.0f; })) {
+    for (int64_t slice = 0; slice < ne02 * ne03; ++slice) {
+      const auto *slice_mins = transposed_mins.data() + slice * slice_size / 32;
+      entry.mins.emplace_back(slice_mins, slice_mins + slice_size / 32);
+    }
+  }
+
+  // Cache the formatted weights for the next model load
+  if (!cache_prefix.empty()) {
+    for (int64_t slice = 0; slice < ne02 * ne03; ++slice) {
+      const auto fname = ryzenai_weight_fname(cache_prefix, slice);
+      try {
+        entry.ops[slice]->save_weights(fname);
+        if (ryzenai_stream_weights()) {
+          // drop the BOs of the formatted weights, they are streamed from
+          // the file now
+          auto op = std::make_unique<op_t>("bfloat16", "uint4", "float32");
+          op->initialize_weights_streamed(fname);
+          entry.ops[slice] = std::move(op);
+        }
+        if (!entry.mins.empty()) {
+          const auto &mins = entry.mins[slice];
+          std::ofstream ofs(ryzenai_mins_fname(cache_prefix, slice),
+                            std::ios::binary);
+          ofs.write((const char *)mins.data(), mins.size() * sizeof(float));
+        }
+      } catch (const std::exception &e) {
+        std::cerr << "Couldn't cache the weights of " << src0->name << " : "
+                  << e.what() << std::endl;
+      }
+    }
+  }
+}
+#endif
+
+// KQ and KQV matmuls of the attention the bmm kernels support, see
+// ggml_ryzenai_mul_mat_bmm
+static bool ggml_ryzenai_is_attention_mul_mat(const struct ggml_tensor *src0,
+                                              const struct ggml_tensor *src1,
+                                              const struct ggml_tensor *dst) {
+#if !defined(RYZENAI_EMULATION) && defined(GGML_RYZENAI_ATTENTION)
+  // only views of the KV cache, the K cache may be Q8_0
+  const bool kq = src0->ne[0] == RYZENAI_BMM_HEAD_DIM;
+  if (src0->view_src == NULL ||
+      !(src0->type == GGML_TYPE_F16 ||
+        (kq && src0->type == GGML_TYPE_Q8_0)) ||
+      src1->type != GGML_TYPE_F32 ||
+      dst->type != GGML_TYPE_F32 || !ggml_is_contiguous(dst) ||
+      src0->ne[3] != 1 || src1->ne[3] != 1 ||
+      src1->ne[2] != RYZENAI_BMM_HEADS || src1->ne[2] % src0->ne[2] != 0 ||
+      src1->ne[1] < RYZENAI_BMM_MIN_ROWS || src1->ne[1] > RYZENAI_BMM_ROWS) {
+    return false;
+  }
+  return (kq && src0->ne[1] <= RYZENAI_BMM_ROWS) ||
+         (src0->ne[1] == RYZENAI_BMM_HEAD_DIM &&
+          src0->ne[0] <= RYZENAI_BMM_ROWS);
+#else
+  GGML_UNUSED(src0);
+  GGML_UNUSED(src1);
+  GGML_UNUSED(dst);
+  return false;
+#endif
 }
 
 // This function is used to check if RyzenAI can offload the specific matrix
 // multiplication It considers that we only want to accelerate large mmult, and
-// we only support Q4_0 quantization scheme
+// we only support the 4 bit group quantization schemes, see
+// ggml_ryzenai_supports_type
 bool ggml_ryzenai_can_mul_mat(const struct ggml_tensor *src0,
                               const struct ggml_tensor *src1,
                               const struct ggml_tensor *dst) {
 
-  const int64_t ne3 = dst->ne[3];
-  const int64_t ne2 = dst->ne[2];
-  const int64_t ne1 = dst->ne[1];
   const int64_t ne0 = dst->ne[0];
 
-  // TODO: find the optimal values for these
-  if (src0->type == GGML_TYPE_Q4_0 && // Check this
-      ggml_is_contiguous(src1) && src1->type == GGML_TYPE_F32 &&
-      dst->type == GGML_TYPE_F32 &&
-      ne3 == 1 && // Not currently supporting batched matrix multiplication
-      ne2 == 1 && ((ne0 >= 4096))) {
+  // Batched matrix multiplication is supported, slices of src0 being
+  // broadcast over dims 2 and 3 of src1 the way ggml does
+  // The size threshold selects the weights which get NPU ops, whether a
+  // given matmul actually runs on the NPU is then up to RyzenAIRouting
+  // The views of the KV cache (e.g. a Q8_0 K cache) are never weights
+  if (ggml_ryzenai_supports_type(src0->type) && src0->view_src == NULL &&
+      src0->ne[0] % RYZENAI_GROUP_SIZE == 0 && ggml_is_contiguous(src1) &&
+      src1->type == GGML_TYPE_F32 && dst->type == GGML_TYPE_F32 &&
+      ggml_is_contiguous(dst) &&
+      src1->ne[2] % src0->ne[2] == 0 && src1->ne[3] % src0->ne[3] == 0 &&
+      ((ne0 >= 4096))) {
     return true;
   }
 
-  return false;
+  return ggml_ryzenai_is_attention_mul_mat(src0, src1, dst);
 }
 
 void ggml_ryzenai_mul_mat_emu(const struct ggml_tensor *src0,
@@ -174,7 +787,7 @@ void ggml_ryzenai_mul_mat_ryz(const struct ggml_tensor *src0,
                               struct ggml_tensor *dst, void *wdata,
                               size_t wsize);
 
-// Entry point from ggml cpu backend into RyzenAI backend
+// Entry point from the RyzenAI backend graph compute
 void ggml_ryzenai_mul_mat(const struct ggml_tensor *src0,
                           const struct ggml_tensor *src1,
                           struct ggml_tensor *dst, void *wdata, size_t wsize) {
@@ -243,8 +856,8 @@ void ggml_ryzenai_mul_mat_emu(const struct ggml_tensor *src0,
   for (int64_t i03 = 0; i03 < ne03; ++i03) {
     for (int64_t i02 = 0; i02 < ne02; ++i02) {
       for (int64_t i01 = 0; i01 < ne01; ++i01) {
-        unpack_row_q4_0((const char *)w + i01 * nb01 + i02 * nb02 + i03 * nb03,
-                        ne00, weights, zeros, scales);
+        unpack_row((const char *)w + i01 * nb01 + i02 * nb02 + i03 * nb03,
+                   src0->type, ne00, weights, zeros, scales, mins);
       }
     }
   }
@@ -254,7 +867,7 @@ void ggml_ryzenai_mul_mat_emu(const struct ggml_tensor *src0,
   std::vector<float> A(ggml_nelements(src0));
   int64_t sidx = 0;
   for (int64_t i = 0; i < weights.size(); ++i) {
-    A[i] = scales[sidx] * (weights[i] - zeros[sidx]);
+    A[i] = scales[sidx] * (weights[i] - zeros[sidx]) + mins[sidx];
     if ((i + 1) % 32 == 0) {
       ++sidx;
     }
@@ -266,6 +879,10 @@ void ggml_ryzenai_mul_mat_emu(const struct ggml_tensor *src0,
 
   float *cptr = (float *)(dst->data);
 
+  // broadcast factors of A over the batch dims of B
+  const int64_t r2 = ne12 / ne02;
+  const int64_t r3 = ne13 / ne03;
+
   // Compute C^T
   // The input matricies A and B have the same width for cache performance
   // For some reason, the result of the computation is C^T
@@ -276,8 +893,8 @@ void ggml_ryzenai_mul_mat_emu(const struct ggml_tensor *src0,
           cptr[i3 * ne2 * ne1 * ne0 + i2 * ne1 * ne0 + i1 * ne0 + i0] = 0;
           for (int k = 0; k < ne10; ++k) { // Shared dimension
             cptr[i3 * ne2 * ne1 * ne0 + i2 * ne1 * ne0 + i1 * ne0 + i0] +=
-                aptr[i3 * ne02 * ne01 * ne00 + i2 * ne01 * ne00 + i0 * ne00 +
-                     k] *
+                aptr[(i3 / r3) * ne02 * ne01 * ne00 +
+                     (i2 / r2) * ne01 * ne00 + i0 * ne00 + k] *
                 bptr[i3 * ne12 * ne11 * ne10 + i2 * ne11 * ne10 + i1 * ne10 +
                      k];
           }
@@ -302,6 +919,13 @@ void ggml_ryzenai_mul_mat_ryz(const struct ggml_tensor *src0,
 
 #ifndef RYZENAI_EMULATION
 
+#ifdef GGML_RYZENAI_ATTENTION
+  if (ggml_ryzenai_is_attention_mul_mat(src0, src1, dst)) {
+    ggml_ryzenai_mul_mat_bmm(src0, src1, dst);
+    return;
+  }
+#endif
+
   auto &ctx = RyzenAIContext::getInstance();
 
   // Assume src0 is always the weight tensor
@@ -310,71 +934,1086 @@ void ggml_ryzenai_mul_mat_ryz(const struct ggml_tensor *src0,
   // However, this assumption may not be globally safe, probably should check
 
   // Check if we need to create executor (qlinear_2 object) for this weight
-  // tensor
-  auto key = std::string_view(src0->name);
+  // tensor, i.e. ggml_backend_ryzenai_prepare_weights wasn't called for it
+  auto *entry = ctx.find(src0);
+  if (entry == nullptr) { // No executor
+    std::lock_guard<RyzenAIContext> guard(ctx);
+    if (ctx.map.count(src0) == 0) {
+      const auto init_start = std::chrono::steady_clock::now();
+      RyzenAIContext::entry new_entry;
+      ryzenai_prepare_weights(src0, new_entry, "");
+      ctx.map[src0] = std::move(new_entry);
+      auto &stats = RyzenAIStats::getInstance();
+      stats.n_weight_init++;
+      stats.weight_init_ns += ryzenai_elapsed_ns(init_start);
+    }
+    entry = &ctx.map.at(src0);
+  }
+  auto &ops = entry->ops;
+  auto &mins = entry->mins;
+  std::lock_guard<std::mutex> entry_guard(*entry->mtx);
+  auto &stats = RyzenAIStats::getInstance();
+
+  // broadcast factors
+  const int64_t r2 = ne12 / ne02;
+  const int64_t r3 = ne13 / ne03;
+
+  // src1 and dst are contiguous, so the r2 slices of src1 which share a
+  // slice of src0 are consecutive rows : one execute for all of them, and a
+  // single one for the whole batch when src0 is 2D. qlinear_2 then runs the
+  // rows back to back on the NPU.
+  const int64_t rows_per_call = (ne02 == 1 && ne03 == 1) ? ne11 * ne12 * ne13
+                                                         : ne11 * r2;
+  const int64_t num_calls = (ne02 == 1 && ne03 == 1) ? 1 : ne13 * ne02;
+  for (int64_t call = 0; call < num_calls; ++call) {
+    const int64_t i13 = call / ne02;
+    const int64_t i02 = call % ne02;
+    const int64_t i03 = i13 / r3;
+    // first row of this call, in rows of ne10 (ne0) elements
+    const int64_t row = call * rows_per_call;
+
+    const int64_t slice = i02 + i03 * ne02;
+    // Kernel can only accept bfloat16 : the F32 inputs are converted by
+    // qlinear_2 while they are copied to its input BO
+    const auto call_start = std::chrono::steady_clock::now();
+    TRY_CATCH(ops[slice]->execute(
+        (const float *)src1->data + row * ne10,
+        std::make_tuple((int)rows_per_call, (int)ne10),
+        (float *)(dst->data) + row * ne0););
+    if (!mins.empty()) {
+      ryzenai_add_mins((const float *)src1->data + row * ne10,
+                       (float *)dst->data + row * ne0, rows_per_call, ne10,
+                       ne0, mins[slice]);
+    }
+    // whatever is not NPU run time or input conversion is host overhead :
+    // BO syncs, output copies, host accumulation & mins
+    const int64_t call_ns = ryzenai_elapsed_ns(call_start);
+    const auto times = ops[slice]->get_exec_times();
+    stats.n_calls++;
+    stats.n_dispatch += times.num_run_aie;
+    stats.npu_ns += times.run_aie;
+    stats.convert_ns += times.a_copy;
+    stats.host_ns += std::max<int64_t>(0, call_ns - times.run_aie - times.a_copy);
+  }
+#endif
+}
+
+#ifndef RYZENAI_EMULATION
+// Root directory of the NPU weight caches set by
+// ggml_backend_ryzenai_set_weight_cache_dir, empty for the GGUF sidecars
+static std::string &ryzenai_weight_cache_root() {
+  static std::string root = [] {
+    const char *env = std::getenv("GGML_RYZENAI_WEIGHT_CACHE_DIR");
+    return std::string(env != NULL ? env : "");
+  }();
+  return root;
+}
+
+// FNV-1a of the first and last MiB of the model : the header holds the
+// tensor types & shapes, and the hash survives copies of the file, unlike
+// its write time. Hashing the whole multi GB model would cost more than
+// formatting the weights again.
+static bool ryzenai_model_hash(const std::filesystem::path &model,
+                               uintmax_t size, uint64_t &hash) {
+  constexpr uintmax_t chunk = 1 << 20;
+  std::ifstream ifs(model, std::ios::binary);
+  std::vector<char> buf(std::min(size, chunk));
+  hash = 0xcbf29ce484222325ull;
+  for (const uintmax_t offset : {uintmax_t(0), size - buf.size()}) {
+    ifs.seekg(offset);
+    ifs.read(buf.data(), buf.size());
+    if (!ifs) {
+      return false;
+    }
+    for (const char c : buf) {
+      hash = (hash ^ (uint8_t)c) * 0x100000001b3ull;
+    }
+  }
+  return true;
+}
+
+// Directory of the NPU weight files of a model, next to the GGUF or under
+// the cache root. It is wiped when the model or the NPU design the tiles
+// were formatted for changes.
+static std::string ryzenai_weight_cache_dir(const char *model_path) {
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  const fs::path model(model_path);
+  const auto size = fs::file_size(model, ec);
+  if (ec) {
+    return "";
+  }
+  uint64_t hash;
+  if (!ryzenai_model_hash(model, size, hash)) {
+    return "";
+  }
+  char hash_str[17];
+  snprintf(hash_str, sizeof(hash_str), "%016llx", (unsigned long long)hash);
+  auto env = [](const char *name) {
+    const char *value = std::getenv(name);
+    return std::string(value != NULL ? value : "");
+  };
+  // the tiling of qlinear_2 depends on the device and design. A kernel shape
+  // tuned later (RYZENAI_AUTOTUNE) makes qlinear_2 reject the files of the
+  // shape, ryzenai_prepare_weights then formats them again.
+  const std::string stamp = std::to_string(size) + " " + hash_str + " " +
+                            env("DEVICE") + " " + env("MLADF");
+
+  fs::path dir;
+  const auto &root = ryzenai_weight_cache_root();
+  if (root.empty()) {
+    dir = model;
+    dir += ".ryzenai";
+  } else {
+    dir = fs::path(root) /
+          (model.stem().string() + "-" + std::string(hash_str, 8) + ".ryzenai");
+  }
+  const fs::path stamp_path = dir / "stamp";
+  std::string cached_stamp;
+  std::getline(std::ifstream(stamp_path), cached_stamp);
+  if (cached_stamp != stamp) {
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir, ec);
+    std::ofstream(stamp_path) << stamp << std::endl;
+    if (ec || !fs::exists(stamp_path)) {
+      return "";
+    }
+  }
+  return dir.string();
+}
+
+// The NPU weights of the matrix multiplications ggml_ryzenai_can_mul_mat
+// accepts : weights of the ryzenai buffer type, with rows >= 4096
+static bool ggml_ryzenai_is_npu_weight(const struct ggml_tensor *tensor) {
+  return ggml_ryzenai_supports_type(tensor->type) &&
+         tensor->ne[0] % RYZENAI_GROUP_SIZE == 0 && tensor->ne[1] >= 4096 &&
+         tensor->buffer != NULL &&
+         ggml_backend_buffer_get_type(tensor->buffer) ==
+             ggml_backend_ryzenai_buffer_type();
+}
+#endif
+
+// CPU / NPU routing of the matrix multiplications ggml_ryzenai_can_mul_mat
+// accepts, per weight type, shape and power of two bucket of the rows of
+// src1 : small decode matmuls can be faster on the CPU. With
+// GGML_RYZENAI_CALIBRATE=1 the keys missing from the table are timed on both
+// at their first use, the table is saved next to the NPU weight cache and
+// loaded again with it. Keys missing from the table go to the NPU.
+class RyzenAIRouting {
+
+  RyzenAIRouting() = default;
+  RyzenAIRouting(const RyzenAIRouting &) = delete;
+  RyzenAIRouting &operator=(const RyzenAIRouting &) = delete;
+  std::mutex mtx_;
+  std::map<std::tuple<int, int64_t, int64_t, int64_t>, bool> table_;
+  std::string fname_;
+
+public:
+  using key_t = std::tuple<int, int64_t, int64_t, int64_t>;
+  enum route_t { ROUTE_UNKNOWN = -1, ROUTE_CPU = 0, ROUTE_NPU = 1 };
+
+  static RyzenAIRouting &getInstance() {
+    static RyzenAIRouting instance;
+    return instance;
+  }
+
+  static bool calibrate() {
+    static const bool calibrate = [] {
+      const char *env = std::getenv("GGML_RYZENAI_CALIBRATE");
+      return env != NULL && std::string(env) == "1";
+    }();
+    return calibrate;
+  }
+
+  static key_t key(const struct ggml_tensor *node) {
+    const struct ggml_tensor *src0 = node->src[0];
+    int64_t rows = 1;
+    while (rows < ggml_nrows(node->src[1])) {
+      rows *= 2;
+    }
+    return key_t{src0->type, src0->ne[0], src0->ne[1], rows};
+  }
+
+  route_t lookup(const key_t &key) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    auto it = table_.find(key);
+    if (it == table_.end()) {
+      return ROUTE_UNKNOWN;
+    }
+    return it->second ? ROUTE_NPU : ROUTE_CPU;
+  }
+
+  // Read the table of a previous run from fname, and append the keys timed
+  // from now on to it
+  void load(const std::string &fname) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    fname_ = fname;
+    std::ifstream ifs(fname);
+    int type, npu;
+    int64_t k, n, rows, cpu_us, npu_us;
+    while (ifs >> type >> k >> n >> rows >> npu >> cpu_us >> npu_us) {
+      table_[key_t{type, k, n, rows}] = npu != 0;
+    }
+  }
+
+  // A row bucket of the weight type & shape is routed to the CPU
+  bool any_cpu(int type, int64_t k, int64_t n) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    for (auto it = table_.lower_bound(key_t{type, k, n, 0});
+         it != table_.end() && std::get<0>(it->first) == type &&
+         std::get<1>(it->first) == k && std::get<2>(it->first) == n;
+         ++it) {
+      if (!it->second) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void record(const key_t &key, int64_t cpu_us, int64_t npu_us) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    const bool npu = npu_us < cpu_us;
+    table_[key] = npu;
+    if (!fname_.empty()) {
+      std::ofstream(fname_, std::ios::app)
+          << std::get<0>(key) << " " << std::get<1>(key) << " "
+          << std::get<2>(key) << " " << std::get<3>(key) << " " << npu << " "
+          << cpu_us << " " << npu_us << std::endl;
+    }
+  }
+};
+
+#ifndef RYZENAI_EMULATION
+// Host copies of the NPU weights given back to the OS once their ops are
+// created, see ggml_backend_ryzenai_set_release_host_weights. A released
+// tensor is read again from the GGUF before the CPU uses it, e.g. for a
+// matmul routed to the CPU, and then stays resident.
+class RyzenAIHostWeights {
+
+  RyzenAIHostWeights() = default;
+  RyzenAIHostWeights(const RyzenAIHostWeights &) = delete;
+  RyzenAIHostWeights &operator=(const RyzenAIHostWeights &) = delete;
+
+  struct source {
+    ggml_backend_buffer_t buffer;
+    std::string fname;
+    size_t offset;
+  };
+  std::mutex mtx_;
+  std::unordered_map<const ggml_tensor *, source> released_;
+  // lock free check of the CPU paths when nothing is released
+  std::atomic<size_t> n_released_{0};
+
+  // Give the pages fully inside [data, data + size) back to the OS, their
+  // contents are undefined until written again. Returns the bytes released.
+  static size_t release_pages(void *data, size_t size) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const uintptr_t page = info.dwPageSize;
+#else
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+#endif
+    const uintptr_t begin =
+        (reinterpret_cast<uintptr_t>(data) + page - 1) / page * page;
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(data) + size) / page *
+                          page;
+    if (end <= begin) {
+      return 0;
+    }
+#ifdef _WIN32
+    if (VirtualAlloc(reinterpret_cast<void *>(begin), end - begin, MEM_RESET,
+                     PAGE_READWRITE) == NULL) {
+      return 0;
+    }
+#else
+    if (madvise(reinterpret_cast<void *>(begin), end - begin,
+                MADV_DONTNEED) != 0) {
+      return 0;
+    }
+#endif
+    return end - begin;
+  }
+
+public:
+  static RyzenAIHostWeights &getInstance() {
+    static RyzenAIHostWeights instance;
+    return instance;
+  }
+
+  static bool &enabled() {
+    static bool enabled = [] {
+      const char *env = std::getenv("GGML_RYZENAI_RELEASE_HOST_WEIGHTS");
+      return env != NULL && std::string(env) == "1";
+    }();
+    return enabled;
+  }
+
+  // Release the host copies of the weights of the GGUF fname, the data of
+  // each tensor being at its offset in the file. Returns the bytes released.
+  size_t release(const std::vector<const ggml_tensor *> &weights,
+                 const std::string &fname) {
+    struct gguf_init_params params = {/* .no_alloc = */ true,
+                                      /* .ctx      = */ NULL};
+    struct gguf_context *gguf = gguf_init_from_file(fname.c_str(), params);
+    if (gguf == NULL) {
+      return 0;
+    }
+    size_t n_bytes = 0;
+    std::lock_guard<std::mutex> guard(mtx_);
+    for (const auto *weight : weights) {
+      // e.g. a tensor of another split of the model
+      const int idx = gguf_find_tensor(gguf, weight->name);
+      if (idx < 0 || released_.count(weight) != 0) {
+        continue;
+      }
+      const size_t offset =
+          gguf_get_data_offset(gguf) + gguf_get_tensor_offset(gguf, idx);
+      n_bytes += release_pages(weight->data, ggml_nbytes(weight));
+      released_[weight] = source{weight->buffer, fname, offset};
+    }
+    n_released_ = released_.size();
+    gguf_free(gguf);
+    return n_bytes;
+  }
+
+  // Read tensor back from its GGUF if its host copy was released
+  void ensure_resident(const ggml_tensor *tensor) {
+    if (n_released_ == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> guard(mtx_);
+    auto it = released_.find(tensor);
+    if (it == released_.end()) {
+      return;
+    }
+    std::ifstream ifs(it->second.fname, std::ios::binary);
+    ifs.seekg(static_cast<std::streamoff>(it->second.offset));
+    ifs.read(static_cast<char *>(tensor->data),
+             static_cast<std::streamsize>(ggml_nbytes(tensor)));
+    GGML_ASSERT(ifs && "failed to reload a released NPU weight");
+    released_.erase(it);
+    n_released_ = released_.size();
+  }
+
+  // Forget the tensors of buffer, called when the buffer is freed
+  void forget(ggml_backend_buffer_t buffer) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    for (auto it = released_.begin(); it != released_.end();) {
+      if (it->second.buffer == buffer) {
+        it = released_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    n_released_ = released_.size();
+  }
+};
+#endif
+
+void ggml_backend_ryzenai_prepare_weights(struct ggml_tensor **tensors,
+                                          int n_tensors,
+                                          const char *model_path) {
+#ifndef RYZENAI_EMULATION
+  const auto init_start = std::chrono::steady_clock::now();
+  std::vector<const struct ggml_tensor *> weights;
+  for (int i = 0; i < n_tensors; ++i) {
+    if (ggml_ryzenai_is_npu_weight(tensors[i])) {
+      weights.push_back(tensors[i]);
+    }
+  }
+
+  std::string cache_dir;
+  const char *no_cache = std::getenv("GGML_RYZENAI_NO_WEIGHT_CACHE");
+  if (model_path != NULL &&
+      (no_cache == NULL || std::string(no_cache) == "0")) {
+    cache_dir = ryzenai_weight_cache_dir(model_path);
+  }
+  if (!cache_dir.empty()) {
+    RyzenAIRouting::getInstance().load(cache_dir + "/routing");
+  }
+
+  // Each worker prepares whole tensors, the context is only locked to
+  // publish them
+  auto &ctx = RyzenAIContext::getInstance();
+  std::atomic<size_t> next{0};
+  std::mutex error_mtx;
+  std::exception_ptr error;
+  auto worker = [&]() {
+    for (size_t i = next++; i < weights.size(); i = next++) {
+      const auto *weight = weights[i];
+      RyzenAIContext::entry entry;
+      try {
+        ryzenai_prepare_weights(
+            weight, entry,
+            cache_dir.empty() ? "" : cache_dir + "/" + weight->name);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(error_mtx);
+        if (!error) {
+          error = std::current_exception();
+        }
+        return;
+      }
+      ctx.lock();
+      ctx.map[weight] = std::move(entry);
+      ctx.unlock();
+    }
+  };
+
+  const size_t n_threads = std::min<size_t>(
+      std::max(1u, std::thread::hardware_concurrency()), weights.size());
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < n_threads; ++t) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  // wall time, the weights are prepared in parallel
+  auto &stats = RyzenAIStats::getInstance();
+  stats.n_weight_init += weights.size();
+  stats.weight_init_ns += ryzenai_elapsed_ns(init_start);
+
+  // Weights a matmul may run on the CPU with keep their host copy
+  if (RyzenAIHostWeights::enabled() && model_path != NULL &&
+      !RyzenAIRouting::calibrate()) {
+    auto &routing = RyzenAIRouting::getInstance();
+    std::vector<const struct ggml_tensor *> npu_only;
+    for (const auto *weight : weights) {
+      if (!routing.any_cpu(weight->type, weight->ne[0], weight->ne[1])) {
+        npu_only.push_back(weight);
+      }
+    }
+    const size_t n_bytes =
+        RyzenAIHostWeights::getInstance().release(npu_only, model_path);
+    fprintf(stderr, "%s: released %zu MiB of host weights run on the NPU\n",
+            __func__, n_bytes >> 20);
+  }
+#else
+  (void)tensors;
+  (void)n_tensors;
+  (void)model_path;
+#endif
+}
+
+#ifndef RYZENAI_EMULATION
+// Any of the NPU ops, they all share the activation type thus the kernels
+static const op_t *ryzenai_any_op() {
+  auto &ctx = RyzenAIContext::getInstance();
+  const op_t *op = nullptr;
   ctx.lock();
-  if (ctx.map.count(key) == 0) { // No executor
-
-    TRY_CATCH(ctx.map.emplace(
-        std::piecewise_construct, std::forward_as_tuple(key),
-        std::forward_as_tuple("bfloat16", "uint4", "float32")););
-
-    std::vector<int8_t> weights; // int4 weights
-    weights.reserve(ggml_nelements(src0));
-    std::vector<int8_t> zeros(ggml_nelements(src0)/32, 8); // Will be a vector of 8s for Q4_0 quantization scheme
-    std::vector<float> scales;
-    scales.reserve(ggml_nelements(src0)/32);
-    std::vector<float> bias(ne01, 0); // Vector of zeros, should have size N in MxK * K*N
-
-    // Unpack weights, zeros, scales
-    void *w = src0->data;
-    for (int64_t i03 = 0; i03 < ne03; ++i03) {
-      for (int64_t i02 = 0; i02 < ne02; ++i02) {
-        for (int64_t i01 = 0; i01 < ne01; ++i01) {
-          unpack_row_q4_0((const char *)w + i01 * nb01 + i02 * nb02 +
-                              i03 * nb03,
-                          ne00, weights, zeros, scales);
+  for (const auto &it : ctx.map) {
+    if (!it.second.ops.empty()) {
+      op = it.second.ops.front().get();
+      break;
+    }
+  }
+  ctx.unlock();
+  return op;
+}
+#endif
+
+int ggml_ryzenai_align_rows(int n_rows) {
+#ifndef RYZENAI_EMULATION
+  const op_t *op = ryzenai_any_op();
+  if (op == nullptr) {
+    return n_rows;
+  }
+  for (int rows = n_rows; rows > 0; --rows) {
+    if (op->get_padded_rows(rows) == rows) {
+      return rows;
+    }
+  }
+#endif
+  return n_rows;
+}
+
+int ggml_ryzenai_padded_rows(int n_rows) {
+#ifndef RYZENAI_EMULATION
+  const op_t *op = ryzenai_any_op();
+  if (op != nullptr && n_rows > 0) {
+    return static_cast<int>(op->get_padded_rows(n_rows));
+  }
+#endif
+  return n_rows;
+}
+
+void ggml_backend_ryzenai_set_weight_cache_dir(const char *cache_dir) {
+#ifndef RYZENAI_EMULATION
+  ryzenai_weight_cache_root() = cache_dir != NULL ? cache_dir : "";
+#else
+  (void)cache_dir;
+#endif
+}
+
+#ifndef RYZENAI_EMULATION
+// set by ggml_backend_ryzenai_set_qos(), which overrides $GGML_RYZENAI_QOS
+static std::atomic<bool> ryzenai_qos_set{false};
+
+// "key=value,..." of $GGML_RYZENAI_QOS, malformed entries are skipped
+static void ryzenai_env_qos() {
+  const char *env = std::getenv("GGML_RYZENAI_QOS");
+  if (env == NULL || ryzenai_qos_set) {
+    return;
+  }
+  xrt::hw_context::qos_type qos;
+  std::stringstream ss(env);
+  std::string entry;
+  while (std::getline(ss, entry, ',')) {
+    const size_t eq = entry.find('=');
+    if (eq == std::string::npos) {
+      continue;
+    }
+    char *end = NULL;
+    const unsigned long value = std::strtoul(entry.c_str() + eq + 1, &end, 0);
+    if (end != entry.c_str() + eq + 1 && *end == '\0') {
+      qos[entry.substr(0, eq)] = static_cast<uint32_t>(value);
+    }
+  }
+  ryzenai::xrt_context::set_qos(qos);
+}
+#endif
+
+void ggml_backend_ryzenai_set_qos(const struct ggml_ryzenai_qos *qos) {
+#ifndef RYZENAI_EMULATION
+  xrt::hw_context::qos_type cfg;
+  if (qos != NULL) {
+    const std::pair<const char *, uint32_t> keys[] = {
+        {"gops", qos->gops},
+        {"fps", qos->fps},
+        {"latency", qos->latency},
+        {"priority", qos->priority}};
+    for (const auto &[key, value] : keys) {
+      if (value != 0) {
+        cfg[key] = value;
+      }
+    }
+  }
+  ryzenai_qos_set = true;
+  ryzenai::xrt_context::set_qos(cfg);
+#else
+  (void)qos;
+#endif
+}
+
+void ggml_backend_ryzenai_set_release_host_weights(bool release) {
+#ifndef RYZENAI_EMULATION
+  RyzenAIHostWeights::enabled() = release;
+#else
+  (void)release;
+#endif
+}
+
+void ggml_backend_ryzenai_set_stream_weights(bool stream) {
+#ifndef RYZENAI_EMULATION
+  ryzenai_stream_weights() = stream;
+#else
+  (void)stream;
+#endif
+}
+
+void ggml_ryzenai_get_stats(struct ggml_ryzenai_stats *stats) {
+  *stats = {};
+#ifndef RYZENAI_EMULATION
+  const auto &s = RyzenAIStats::getInstance();
+  stats->n_calls = s.n_calls;
+  stats->n_dispatch = s.n_dispatch;
+  stats->npu_ns = s.npu_ns;
+  stats->convert_ns = s.convert_ns;
+  stats->host_ns = s.host_ns;
+  stats->n_weight_init = s.n_weight_init;
+  stats->weight_init_ns = s.weight_init_ns;
+#endif
+}
+
+void ggml_ryzenai_reset_stats(void) {
+#ifndef RYZENAI_EMULATION
+  auto &s = RyzenAIStats::getInstance();
+  s.n_calls = 0;
+  s.n_dispatch = 0;
+  s.npu_ns = 0;
+  s.convert_ns = 0;
+  s.host_ns = 0;
+  s.n_weight_init = 0;
+  s.weight_init_ns = 0;
+#endif
+}
+
+//
+// backend interface
+//
+
+// Host memory buffer : qlinear_2 reads the weights and activations from host
+// memory, so tensors of this buffer type are usable by the CPU backend too.
+// The buffer wraps a CPU buffer, and releases the ops created for its
+// weights when freed.
+
+GGML_CALL static const char *
+ggml_backend_ryzenai_buffer_get_name(ggml_backend_buffer_t buffer) {
+  return "RyzenAI";
+
+  GGML_UNUSED(buffer);
+}
+
+GGML_CALL static void
+ggml_backend_ryzenai_buffer_free_buffer(ggml_backend_buffer_t buffer) {
+#ifndef RYZENAI_EMULATION
+  RyzenAIContext::getInstance().release(buffer);
+  RyzenAIHostWeights::getInstance().forget(buffer);
+#endif
+  ggml_backend_buffer_free((ggml_backend_buffer_t)buffer->context);
+}
+
+GGML_CALL static void *
+ggml_backend_ryzenai_buffer_get_base(ggml_backend_buffer_t buffer) {
+  return ggml_backend_buffer_get_base((ggml_backend_buffer_t)buffer->context);
+}
+
+GGML_CALL static void
+ggml_backend_ryzenai_buffer_set_tensor(ggml_backend_buffer_t buffer,
+                                       struct ggml_tensor *tensor,
+                                       const void *data, size_t offset,
+                                       size_t size) {
+  memcpy((char *)tensor->data + offset, data, size);
+
+  GGML_UNUSED(buffer);
+}
+
+GGML_CALL static void
+ggml_backend_ryzenai_buffer_get_tensor(ggml_backend_buffer_t buffer,
+                                       const struct ggml_tensor *tensor,
+                                       void *data, size_t offset,
+                                       size_t size) {
+#ifndef RYZENAI_EMULATION
+  RyzenAIHostWeights::getInstance().ensure_resident(tensor);
+#endif
+  memcpy(data, (const char *)tensor->data + offset, size);
+
+  GGML_UNUSED(buffer);
+}
+
+GGML_CALL static bool
+ggml_backend_ryzenai_buffer_cpy_tensor(ggml_backend_buffer_t buffer,
+                                       const struct ggml_tensor *src,
+                                       struct ggml_tensor *dst) {
+  if (ggml_backend_buffer_is_host(src->buffer)) {
+    memcpy(dst->data, src->data, ggml_nbytes(src));
+    return true;
+  }
+  return false;
+
+  GGML_UNUSED(buffer);
+}
+
+GGML_CALL static void
+ggml_backend_ryzenai_buffer_clear(ggml_backend_buffer_t buffer,
+                                  uint8_t value) {
+  ggml_backend_buffer_clear((ggml_backend_buffer_t)buffer->context, value);
+}
+
+static struct ggml_backend_buffer_i ggml_backend_ryzenai_buffer_interface = {
+    /* .get_name        = */ ggml_backend_ryzenai_buffer_get_name,
+    /* .free_buffer     = */ ggml_backend_ryzenai_buffer_free_buffer,
+    /* .get_base        = */ ggml_backend_ryzenai_buffer_get_base,
+    /* .init_tensor     = */ NULL, // no initialization required
+    /* .set_tensor      = */ ggml_backend_ryzenai_buffer_set_tensor,
+    /* .get_tensor      = */ ggml_backend_ryzenai_buffer_get_tensor,
+    /* .cpy_tensor      = */ ggml_backend_ryzenai_buffer_cpy_tensor,
+    /* .clear           = */ ggml_backend_ryzenai_buffer_clear,
+    /* .reset           = */ NULL,
+};
+
+GGML_CALL static const char *
+ggml_backend_ryzenai_buffer_type_get_name(ggml_backend_buffer_type_t buft) {
+  return "RyzenAI";
+
+  GGML_UNUSED(buft);
+}
+
+GGML_CALL static ggml_backend_buffer_t
+ggml_backend_ryzenai_buffer_type_alloc_buffer(ggml_backend_buffer_type_t buft,
+                                              size_t size) {
+  ggml_backend_buffer_t cpu_buffer =
+      ggml_backend_buft_alloc_buffer(ggml_backend_cpu_buffer_type(), size);
+  if (cpu_buffer == NULL) {
+    return NULL;
+  }
+  return ggml_backend_buffer_init(buft, ggml_backend_ryzenai_buffer_interface,
+                                  cpu_buffer, size);
+}
+
+GGML_CALL static size_t
+ggml_backend_ryzenai_buffer_type_get_alignment(
+    ggml_backend_buffer_type_t buft) {
+  return ggml_backend_buft_get_alignment(ggml_backend_cpu_buffer_type());
+
+  GGML_UNUSED(buft);
+}
+
+GGML_CALL static bool
+ggml_backend_ryzenai_buffer_type_supports_backend(
+    ggml_backend_buffer_type_t buft, ggml_backend_t backend) {
+  return ggml_backend_is_ryzenai(backend) || ggml_backend_is_cpu(backend);
+
+  GGML_UNUSED(buft);
+}
+
+GGML_CALL static bool
+ggml_backend_ryzenai_buffer_type_is_host(ggml_backend_buffer_type_t buft) {
+  return true;
+
+  GGML_UNUSED(buft);
+}
+
+GGML_CALL ggml_backend_buffer_type_t ggml_backend_ryzenai_buffer_type(void) {
+  static struct ggml_backend_buffer_type ggml_backend_ryzenai_buffer_type = {
+      /* .iface = */ {
+          /* .get_name         = */ ggml_backend_ryzenai_buffer_type_get_name,
+          /* .alloc_buffer     = */
+          ggml_backend_ryzenai_buffer_type_alloc_buffer,
+          /* .get_alignment    = */
+          ggml_backend_ryzenai_buffer_type_get_alignment,
+          /* .get_max_size     = */ NULL, // defaults to SIZE_MAX
+          /* .get_alloc_size   = */ NULL, // defaults to ggml_nbytes
+          /* .supports_backend = */
+          ggml_backend_ryzenai_buffer_type_supports_backend,
+          /* .is_host          = */ ggml_backend_ryzenai_buffer_type_is_host,
+      },
+      /* .context = */ NULL,
+  };
+
+  return &ggml_backend_ryzenai_buffer_type;
+}
+
+// The NPU only runs the matrix multiplications ggml_ryzenai_can_mul_mat
+// accepts, the other nodes of a graph split are run by a CPU backend owned
+// by this backend, so that the scheduler can keep whole layers here.
+//
+// During prompt processing the NPU matmuls are queued to a worker thread,
+// and the graph compute keeps running the following CPU nodes which don't
+// touch the memory of a queued matmul, e.g. the rope of Q while K and V
+// are computed.
+class RyzenAINpuQueue {
+public:
+  RyzenAINpuQueue() : thread_([this] { run(); }) {}
+  ~RyzenAINpuQueue() {
+    {
+      std::lock_guard<std::mutex> guard(mtx_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+  }
+  RyzenAINpuQueue(const RyzenAINpuQueue &) = delete;
+  RyzenAINpuQueue &operator=(const RyzenAINpuQueue &) = delete;
+
+  // Matmuls run in the order they are pushed
+  void push(struct ggml_tensor *node) {
+    {
+      std::lock_guard<std::mutex> guard(mtx_);
+      jobs_.push_back(node);
+    }
+    cv_.notify_all();
+  }
+
+  // Whether node reads the output, or writes the inputs or the output, of a
+  // matmul still queued or running. ggml-alloc reuses the memory of src1
+  // once its last consumer was scheduled, hence the writes.
+  bool conflicts(const struct ggml_tensor *node) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    for (const auto *job : jobs_) {
+      if (overlaps(node, job) || overlaps(node, job->src[1])) {
+        return true;
+      }
+      for (int j = 0; j < GGML_MAX_SRC; ++j) {
+        if (node->src[j] != NULL && overlaps(node->src[j], job)) {
+          return true;
         }
       }
     }
+    return false;
+  }
 
-    // Need to transpose the weights and scales
-    // Why you ask?
-    // GGML's matmul does A * B^T = C^T // B is already assumed transposed
-    // This is for maximal cache hit efficiency
-    // qlinear_2 does A * B = C where B must be the weights
-    // Here we see that the weights are presented as A, so we need to swap A and
-    // B I make use of the matrix multiplication transpose property B^T * A^T =
-    // C^T So if we transpose the weights, and feed the input directly in,
-    // qlinear_2 will compute C^T as ggml expects.
-    auto transposed_weights =
-        transpose(weights, std::make_tuple(ne00, ne01, ne02, ne03));
+  // Wait for all the queued matmuls, and rethrow the error of a failed one
+  void wait() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [this] { return jobs_.empty(); });
+    if (error_) {
+      auto error = error_;
+      error_ = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
 
-    auto transposed_scales = transpose(
-        scales, std::make_tuple(ne00 / 32, ne01, ne02,
-                                ne03)); // 1 scale for every 32 elements
+private:
+  static bool overlaps(const struct ggml_tensor *a,
+                       const struct ggml_tensor *b) {
+    if (a->data == NULL || b->data == NULL) {
+      return false;
+    }
+    const char *a0 = (const char *)a->data;
+    const char *b0 = (const char *)b->data;
+    return a0 < b0 + ggml_nbytes(b) && b0 < a0 + ggml_nbytes(a);
+  }
 
-    auto w_shape = make_tuple(
-        ne00, ne01); // qlinear_2 expects KxN = w_shape[0] x w_shape[1]
+  void run() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true) {
+      cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        return;
+      }
+      // the job stays in jobs_ while it runs, for conflicts
+      struct ggml_tensor *node = jobs_.front();
+      lock.unlock();
+      std::exception_ptr error;
+      try {
+        if (error_ == nullptr) {
+          ggml_ryzenai_mul_mat(node->src[0], node->src[1], node, NULL, 0);
+        }
+      } catch (...) {
+        error = std::current_exception();
+      }
+      lock.lock();
+      if (error && !error_) {
+        error_ = error;
+      }
+      jobs_.pop_front();
+      cv_.notify_all();
+    }
+  }
+
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::deque<struct ggml_tensor *> jobs_;
+  std::exception_ptr error_;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+struct ggml_backend_ryzenai_context {
+  ggml_backend_t backend_cpu;
+  std::unique_ptr<RyzenAINpuQueue> npu_queue;
+};
+
+GGML_CALL static const char *ggml_backend_ryzenai_name(ggml_backend_t backend) {
+  return "RyzenAI";
+
+  GGML_UNUSED(backend);
+}
+
+GGML_CALL static void ggml_backend_ryzenai_free(ggml_backend_t backend) {
+  auto *ctx = (ggml_backend_ryzenai_context *)backend->context;
+  ggml_backend_free(ctx->backend_cpu);
+  delete ctx;
+  delete backend;
+}
+
+GGML_CALL static ggml_backend_buffer_type_t
+ggml_backend_ryzenai_get_default_buffer_type(ggml_backend_t backend) {
+  return ggml_backend_ryzenai_buffer_type();
+
+  GGML_UNUSED(backend);
+}
 
-    TRY_CATCH(ctx.map.at(key).initialize_weights_int4(
-        transposed_weights.data(), zeros.data(), transposed_scales.data(),
-        bias.data(), w_shape););
+static bool ggml_backend_ryzenai_is_npu_node(const struct ggml_tensor *node) {
+  return node->op == GGML_OP_MUL_MAT &&
+         ggml_ryzenai_can_mul_mat(node->src[0], node->src[1], node);
+}
+
+GGML_CALL static enum ggml_status
+ggml_backend_ryzenai_graph_compute(ggml_backend_t backend,
+                                   struct ggml_cgraph *cgraph) {
+  auto *ctx = (ggml_backend_ryzenai_context *)backend->context;
+
+  // Run the nodes [i0, i1) on the CPU backend
+  auto compute_cpu = [&](int i0, int i1) {
+    if (i0 == i1) {
+      return GGML_STATUS_SUCCESS;
+    }
+#ifndef RYZENAI_EMULATION
+    auto &host_weights = RyzenAIHostWeights::getInstance();
+    for (int i = i0; i < i1; i++) {
+      for (int j = 0; j < GGML_MAX_SRC && cgraph->nodes[i]->src[j]; j++) {
+        host_weights.ensure_resident(cgraph->nodes[i]->src[j]);
+      }
+    }
+#endif
+    struct ggml_cgraph view = ggml_graph_view(cgraph, i0, i1);
+    return ggml_backend_graph_compute(ctx->backend_cpu, &view);
+  };
+
+  auto &routing = RyzenAIRouting::getInstance();
+  auto &npu_queue = *ctx->npu_queue;
+  int i0 = 0;
+  for (int i = 0; i < cgraph->n_nodes; i++) {
+    struct ggml_tensor *node = cgraph->nodes[i];
+    auto route = RyzenAIRouting::ROUTE_CPU;
+    RyzenAIRouting::key_t key;
+    if (ggml_backend_ryzenai_is_npu_node(node)) {
+      key = RyzenAIRouting::key(node);
+      route = routing.lookup(key);
+    }
+    if (route == RyzenAIRouting::ROUTE_CPU) {
+      // CPU node : wait for the queued matmuls only when it depends on them
+      if (npu_queue.conflicts(node)) {
+        enum ggml_status status = compute_cpu(i0, i);
+        if (status != GGML_STATUS_SUCCESS) {
+          npu_queue.wait();
+          return status;
+        }
+        npu_queue.wait();
+        i0 = i;
+      }
+      continue;
+    }
+    // The CPU nodes before this one overlap with the queued matmuls
+    enum ggml_status status = compute_cpu(i0, i);
+    if (status != GGML_STATUS_SUCCESS) {
+      npu_queue.wait();
+      return status;
+    }
+    i0 = i + 1;
+
+    const bool calibrating =
+        route == RyzenAIRouting::ROUTE_UNKNOWN && RyzenAIRouting::calibrate();
+    // Only prefill matmuls are worth the hand-off to the worker
+    if (!calibrating && ggml_nrows(node->src[1]) > 1) {
+      npu_queue.push(node);
+      continue;
+    }
+    npu_queue.wait();
+
+    if (calibrating) {
+      // Best of a few runs on each, both write the same dst
+      using clock = std::chrono::steady_clock;
+      auto time_us = [](auto &&run) {
+        int64_t best = INT64_MAX;
+        for (int rep = 0; rep < 3; ++rep) {
+          const auto start = clock::now();
+          run();
+          const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                              clock::now() - start)
+                              .count();
+          best = std::min<int64_t>(best, us);
+        }
+        return best;
+      };
+      status = GGML_STATUS_SUCCESS;
+      const int64_t cpu_us = time_us([&] {
+        if (status == GGML_STATUS_SUCCESS) {
+          status = compute_cpu(i, i + 1);
+        }
+      });
+      if (status != GGML_STATUS_SUCCESS) {
+        return status;
+      }
+      const int64_t npu_us = time_us([&] {
+        ggml_ryzenai_mul_mat(node->src[0], node->src[1], node, NULL, 0);
+      });
+      routing.record(key, cpu_us, npu_us);
+      continue;
+    }
+    ggml_ryzenai_mul_mat(node->src[0], node->src[1], node, NULL, 0);
   }
-  ctx.unlock();
+  enum ggml_status status = compute_cpu(i0, cgraph->n_nodes);
+  npu_queue.wait();
+  return status;
+}
+
+GGML_CALL static bool
+ggml_backend_ryzenai_supports_op(ggml_backend_t backend,
+                                 const struct ggml_tensor *op) {
+  auto *ctx = (ggml_backend_ryzenai_context *)backend->context;
+  return ggml_backend_ryzenai_is_npu_node(op) ||
+         ggml_backend_supports_op(ctx->backend_cpu, op);
+}
+
+static struct ggml_backend_i ggml_backend_ryzenai_i = {
+    /* .get_name                = */ ggml_backend_ryzenai_name,
+    /* .free                    = */ ggml_backend_ryzenai_free,
+    /* .get_default_buffer_type = */
+    ggml_backend_ryzenai_get_default_buffer_type,
+    /* .set_tensor_async        = */ NULL,
+    /* .get_tensor_async        = */ NULL,
+    /* .cpy_tensor_async        = */ NULL,
+    /* .synchronize             = */ NULL,
+    /* .graph_plan_create       = */ NULL,
+    /* .graph_plan_free         = */ NULL,
+    /* .graph_plan_compute      = */ NULL,
+    /* .graph_compute           = */ ggml_backend_ryzenai_graph_compute,
+    /* .supports_op             = */ ggml_backend_ryzenai_supports_op,
+    /* .offload_op              = */ NULL,
+    /* .event_new               = */ NULL,
+    /* .event_free              = */ NULL,
+    /* .event_record            = */ NULL,
+    /* .event_wait              = */ NULL,
+    /* .event_synchronize       = */ NULL,
+};
 
-  // Kernel can only accept bfloat16
-  // Need to convert inputs from F32 to bfloat16
-  const static bool use_avx = ryzenai::check_avx512_and_bf16_support();
-  vector<int16_t> bfloatInputs(ggml_nelements(src1));
-  ryzenai::float_buffer_to_bfloat16((float *)(src1->data), ggml_nelements(src1),
-                                    (uint16_t *)bfloatInputs.data(), use_avx);
+static ggml_guid_t ggml_backend_ryzenai_guid() {
+  static ggml_guid guid = {0x5e, 0x1b, 0x6a, 0x0c, 0x93, 0x2f, 0x4d, 0x7e,
+                           0xa1, 0x08, 0xc4, 0x52, 0x6b, 0xe9, 0x37, 0xd0};
+  return &guid;
+}
 
-  // TODO
-  // Add loops to support 4D tensor with batched matrix multiplication
-  // Do I need to acquire some lock while executing?
-  TRY_CATCH(ctx.map.at(key).execute(bfloatInputs.data(),
-                                    std::make_tuple((int)ne11, (int)ne10),
-                                    (float *)(dst->data)););
+ggml_backend_t ggml_backend_ryzenai_init(void) {
+  ggml_backend_t backend_cpu = ggml_backend_cpu_init();
+  if (backend_cpu == NULL) {
+    return NULL;
+  }
+#ifndef RYZENAI_EMULATION
+  ryzenai_env_qos();
 #endif
+
+  auto *ctx = new ggml_backend_ryzenai_context{
+      backend_cpu, std::make_unique<RyzenAINpuQueue>()};
+  ggml_backend_t backend = new ggml_backend{
+      /* .guid      = */ ggml_backend_ryzenai_guid(),
+      /* .interface = */ ggml_backend_ryzenai_i,
+      /* .context   = */ ctx,
+  };
+  return backend;
+}
+
+bool ggml_backend_is_ryzenai(ggml_backend_t backend) {
+  return backend != NULL &&
+         ggml_guid_matches(backend->guid, ggml_backend_ryzenai_guid());
+}
+
+void ggml_backend_ryzenai_set_n_threads(ggml_backend_t backend,
+                                        int n_threads) {
+  GGML_ASSERT(ggml_backend_is_ryzenai(backend));
+
+  auto *ctx = (ggml_backend_ryzenai_context *)backend->context;
+  ggml_backend_cpu_set_n_threads(ctx->backend_cpu, n_threads);
+}
+
+void ggml_backend_ryzenai_set_abort_callback(ggml_backend_t backend,
+                                             ggml_abort_callback abort_callback,
+                                             void *abort_callback_data) {
+  GGML_ASSERT(ggml_backend_is_ryzenai(backend));
+
+  auto *ctx = (ggml_backend_ryzenai_context *)backend->context;
+  ggml_backend_cpu_set_abort_callback(ctx->backend_cpu, abort_callback,
+                                      abort_callback_data);
+}
+
+static ggml_backend_t ggml_backend_reg_ryzenai_init(const char *params,
+                                                    void *user_data) {
+  return ggml_backend_ryzenai_init();
+
+  GGML_UNUSED(params);
+  GGML_UNUSED(user_data);
+}
+
+extern "C" GGML_CALL void ggml_backend_ryzenai_reg_devices(void);
+
+GGML_CALL void ggml_backend_ryzenai_reg_devices(void) {
+  ggml_backend_register("RyzenAI", ggml_backend_reg_ryzenai_init,
+                        ggml_backend_ryzenai_buffer_type(), NULL);
 }
@@ -7,11 +7,91 @@
 extern "C" {
 #endif
 
-GGML_API void ggml_ryzenai_init(void);
-
 GGML_API bool   ggml_ryzenai_can_mul_mat(const struct ggml_tensor * src0, const struct ggml_tensor * src1, const struct ggml_tensor * dst);
 GGML_API void   ggml_ryzenai_mul_mat(const struct ggml_tensor * src0, const struct ggml_tensor * src1, struct ggml_tensor * dst, void * wdata, size_t wsize);
 
+//
+// backend API
+//
+
+GGML_API ggml_backend_t ggml_backend_ryzenai_init(void);
+
+GGML_API bool ggml_backend_is_ryzenai(ggml_backend_t backend);
+
+// threads of the CPU backend running the nodes the NPU does not support
+GGML_API void ggml_backend_ryzenai_set_n_threads(ggml_backend_t backend, int n_threads);
+GGML_API void ggml_backend_ryzenai_set_abort_callback(ggml_backend_t backend, ggml_abort_callback abort_callback, void * abort_callback_data);
+
+GGML_API GGML_CALL ggml_backend_buffer_type_t ggml_backend_ryzenai_buffer_type(void);
+
+// Create the NPU ops of the weights in ryzenai buffers at model load,
+// instead of on their first use. When model_path is not NULL, the formatted
+// weights are cached in <model_path>.ryzenai/ for the next load.
+// GGML_RYZENAI_NO_WEIGHT_CACHE=1 disables the cache.
+GGML_API void ggml_backend_ryzenai_prepare_weights(struct ggml_tensor ** tensors, int n_tensors, const char * model_path);
+
+// Keep the NPU weight caches in cache_dir/<model>-<hash>.ryzenai/ rather
+// than next to the GGUF, e.g. when the models are read-only. NULL goes back
+// to the sidecar directories. Defaults to $GGML_RYZENAI_WEIGHT_CACHE_DIR.
+GGML_API void ggml_backend_ryzenai_set_weight_cache_dir(const char * cache_dir);
+
+// Give the host copies of the NPU weights back to the OS once
+// ggml_backend_ryzenai_prepare_weights created their ops, so that these
+// weights are only in memory once. A weight the CPU reads again (routed to
+// the CPU, or read with ggml_backend_tensor_get) is reloaded from the GGUF
+// first. Weights the routing table sends to the CPU for some batch sizes are
+// kept, nothing is released while calibrating. Call it before the model is
+// loaded. Defaults to $GGML_RYZENAI_RELEASE_HOST_WEIGHTS=1.
+GGML_API void ggml_backend_ryzenai_set_release_host_weights(bool release);
+
+// Keep the NPU weights in the files of the weight cache rather than in NPU
+// buffers : the tiles of a matmul are uploaded to a few rotating buffers
+// before it runs, those of the next matmuls while it runs, for models whose
+// weights don't all fit. $RYZENAI_WEIGHT_STREAM_DEPTH (default 2) matmuls
+// have their weights in buffers at a time. Needs the weight cache, call it
+// before the model is loaded. Defaults to $GGML_RYZENAI_STREAM_WEIGHTS=1.
+GGML_API void ggml_backend_ryzenai_set_stream_weights(bool stream);
+
+// QoS of the NPU hw context the matmuls run on, so that e.g. an interactive
+// chat is scheduled ahead of background workloads of other apps sharing the
+// NPU. 0 leaves a key unset, the values are those of the XRT hw context
+// QoS. Applied to the context when it is created, or right away once it is.
+// Defaults to $GGML_RYZENAI_QOS, e.g. "priority=384,latency=1".
+struct ggml_ryzenai_qos {
+    uint32_t gops;
+    uint32_t fps;
+    uint32_t latency;
+    uint32_t priority;
+};
+
+GGML_API void ggml_backend_ryzenai_set_qos(const struct ggml_ryzenai_qos * qos);
+
+// Largest row count <= n_rows the NPU kernels run without padding rows,
+// n_rows when no NPU op is created yet. Callers batching tokens can cut
+// their batches at it.
+GGML_API int ggml_ryzenai_align_rows(int n_rows);
+
+// Rows the NPU kernels compute for n_rows, n_rows when no NPU op is created
+// yet. Tokens added to a batch up to it run at no extra NPU cost.
+GGML_API int ggml_ryzenai_padded_rows(int n_rows);
+
+// Time split of the NPU matmuls since the last reset, in ns.
+// convert_ns is the F32 to bf16 conversion of the inputs, host_ns the rest
+// of the host side (BO syncs, output copies, mins), weight_init_ns the
+// creation of the NPU ops, at load or on first use.
+struct ggml_ryzenai_stats {
+    int64_t n_calls;       // qlinear_2 executes
+    int64_t n_dispatch;    // NPU kernel runs
+    int64_t npu_ns;
+    int64_t convert_ns;
+    int64_t host_ns;
+    int64_t n_weight_init; // weight tensors prepared
+    int64_t weight_init_ns;
+};
+
+GGML_API void ggml_ryzenai_get_stats(struct ggml_ryzenai_stats * stats);
+GGML_API void ggml_ryzenai_reset_stats(void);
+
 #ifdef  __cplusplus
 }
 #endif
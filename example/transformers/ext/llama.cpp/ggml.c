@@ -292,8 +292,6 @@ inline static void * ggml_calloc(size_t num, size_t size) {
 #endif
 #elif defined(GGML_USE_CLBLAST)
 #include "ggml-opencl.h"
-#elif defined(GGML_USE_RYZENAI)
-#include "ggml-ryzenai.h"
 #endif
 
 // floating point type used to accumulate sums
@@ -2720,8 +2718,6 @@ struct ggml_context * ggml_init(struct ggml_init_params params) {
 
 #if defined(GGML_USE_CLBLAST)
         ggml_cl_init();
-#elif defined(GGML_USE_RYZENAI)
-        ggml_ryzenai_init();
 #endif
 
         ggml_setup_op_has_task_pass();
@@ -10759,13 +10755,6 @@ static void ggml_compute_forward_mul_mat(
         }
         return;
     }
-#elif defined(GGML_USE_RYZENAI)
-    if (ggml_ryzenai_can_mul_mat(src0, src1, dst)) {
-        if (params->ith == 0 && params->type == GGML_TASK_TYPE_COMPUTE) {
-            ggml_ryzenai_mul_mat(src0, src1, dst, params->wdata, params->wsize);
-        }
-        return;
-    }
 #endif
 
 #if defined(GGML_USE_ACCELERATE) || defined(GGML_USE_OPENBLAS)
@@ -19,6 +19,15 @@
 #   include "ggml-kompute.h"
 #endif
 
+// the RyzenAI backend only runs the matmuls, it can be combined with the GPU
+// backends of the APU
+#ifdef GGML_USE_RYZENAI
+#   include "ggml-ryzenai.h"
+#   if defined(GGML_USE_VULKAN) || defined(GGML_USE_KOMPUTE)
+#       define LLAMA_RYZENAI_HYBRID
+#   endif
+#endif
+
 #ifdef GGML_USE_METAL
 #  include "ggml-metal.h"
 #endif
@@ -1661,6 +1670,8 @@ static ggml_backend_buffer_type_t llama_default_buffer_type_offload(int gpu) {
     if (buft == nullptr) {
         LLAMA_LOG_WARN("%s: cannot use GPU %d, check `vulkaninfo --summary`\n", __func__, gpu);
     }
+#elif defined(GGML_USE_RYZENAI)
+    buft = ggml_backend_ryzenai_buffer_type();
 #endif
 
     if (buft == nullptr) {
@@ -1671,6 +1682,17 @@ static ggml_backend_buffer_type_t llama_default_buffer_type_offload(int gpu) {
     GGML_UNUSED(gpu);
 }
 
+// buffer type of the matrices of the offloaded layers, with both an iGPU and
+// the NPU the matmuls go to the NPU while the rest of the layer (attention,
+// norms, elementwise ops, KV cache) stays on the iGPU
+static ggml_backend_buffer_type_t llama_default_buffer_type_offload_matrix(int gpu) {
+#ifdef LLAMA_RYZENAI_HYBRID
+    return ggml_backend_ryzenai_buffer_type();
+#else
+    return llama_default_buffer_type_offload(gpu);
+#endif
+}
+
 static ggml_backend_buffer_type_t llama_default_buffer_type_split(int fallback_gpu, const float * tensor_split) {
     ggml_backend_buffer_type_t buft = nullptr;
 
@@ -4606,12 +4628,18 @@ static bool llm_load_tensors(
         int act_gpu_layers = std::min(n_gpu_layers, (int)n_layer + 1);
         for (int64_t i = i_gpu_start; i < n_layer; ++i) {
             int layer_gpu = std::upper_bound(splits.begin(), splits.begin() + device_count, float(i - i_gpu_start)/act_gpu_layers) - splits.begin();
-            model.buft_layer[i] = llama_default_buffer_type_offload(layer_gpu);
+            model.buft_layer[i] = {
+                llama_default_buffer_type_offload_matrix(layer_gpu),
+                llama_default_buffer_type_offload(layer_gpu)
+            };
         }
         // assign the output layer
         if (n_gpu_layers > n_layer) {
             int layer_gpu = std::upper_bound(splits.begin(), splits.begin() + device_count, float(act_gpu_layers - 1)/act_gpu_layers) - splits.begin();
-            model.buft_output = llama_default_buffer_type_offload(layer_gpu);
+            model.buft_output = {
+                llama_default_buffer_type_offload_matrix(layer_gpu),
+                llama_default_buffer_type_offload(layer_gpu)
+            };
         } else {
             model.buft_output = llama_default_buffer_type_cpu(true);
         }
@@ -4621,7 +4649,7 @@ static bool llm_load_tensors(
             split_buft = llama_default_buffer_type_split(main_gpu, tensor_split);
         } else {
             // LLAMA_SPLIT_MODE_NONE or LLAMA_SPLIT_MODE_LAYER in backends where it is not supported
-            split_buft = llama_default_buffer_type_offload(main_gpu);
+            split_buft = llama_default_buffer_type_offload_matrix(main_gpu);
         }
         // assign the repeating layers
         for (int64_t i = i_gpu_start; i < n_layer; ++i) {
@@ -5973,6 +6001,15 @@ static int llama_model_load(const std::string & fname, llama_model & model, llam
         )) {
             return -2;
         }
+
+#ifdef GGML_USE_RYZENAI
+        // format the NPU weights now rather than on the first eval
+        std::vector<ggml_tensor *> tensors;
+        for (auto & it : model.tensors_by_name) {
+            tensors.push_back(it.second);
+        }
+        ggml_backend_ryzenai_prepare_weights(tensors.data(), (int) tensors.size(), fname.c_str());
+#endif
     } catch (const std::exception & err) {
         LLAMA_LOG_ERROR("%s: error loading model: %s\n", __func__, err.what());
         return -1;
@@ -10886,6 +10923,15 @@ static void llama_graph_compute(
         ggml_backend_cpu_set_abort_callback(lctx.backend_cpu, lctx.abort_callback, lctx.abort_callback_data);
     }
 
+#ifdef GGML_USE_RYZENAI
+    for (auto * backend : lctx.backends) {
+        if (ggml_backend_is_ryzenai(backend)) {
+            ggml_backend_ryzenai_set_n_threads(backend, n_threads);
+            ggml_backend_ryzenai_set_abort_callback(backend, lctx.abort_callback, lctx.abort_callback_data);
+        }
+    }
+#endif
+
     ggml_backend_sched_graph_compute_async(lctx.sched, gf);
 
     // fprintf(stderr, "splits: %d\n", ggml_backend_sched_get_n_splits(lctx.sched));
@@ -14916,7 +14962,7 @@ bool llama_supports_mlock(void) {
 
 bool llama_supports_gpu_offload(void) {
 #if defined(GGML_USE_CUDA) || defined(GGML_USE_CLBLAST) || defined(GGML_USE_METAL) || defined(GGML_USE_VULKAN) || \
-    defined(GGML_USE_SYCL) || defined(GGML_USE_KOMPUTE)
+    defined(GGML_USE_SYCL) || defined(GGML_USE_KOMPUTE) || defined(GGML_USE_RYZENAI)
     // Defined when llama.cpp is compiled with support for offloading model layers to GPU.
     return true;
 #else
@@ -15203,6 +15249,17 @@ struct llama_context * llama_new_context_with_model(
             }
             ctx->backends.push_back(backend);
         }
+#endif
+#ifdef GGML_USE_RYZENAI
+        if (model->n_gpu_layers > 0) {
+            auto * backend = ggml_backend_ryzenai_init();
+            if (backend == nullptr) {
+                LLAMA_LOG_ERROR("%s: failed to initialize RyzenAI backend\n", __func__);
+                llama_free(ctx);
+                return nullptr;
+            }
+            ctx->backends.push_back(backend);
+        }
 #endif
         ctx->backend_cpu = ggml_backend_cpu_init();
         if (ctx->backend_cpu == nullptr) {
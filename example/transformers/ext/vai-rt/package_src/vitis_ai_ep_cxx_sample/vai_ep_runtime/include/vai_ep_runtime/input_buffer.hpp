@@ -0,0 +1,66 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "input_quant.hpp"
+#include "runner.hpp"
+
+namespace vai_ep {
+
+// An input tensor in the element type the model takes it: float, or int8 /
+// uint8 for a quantized input. The preprocessing writes it through visit(),
+// which passes the data of the tensor and the conversion of the float
+// values, so a quantized input is filled without a float copy and the EP
+// skips its input quantize.
+class InputBuffer {
+public:
+  InputBuffer() = default;
+  InputBuffer(const std::optional<InputQuant> &quant, size_t size)
+      : quant_(quant) {
+    resize(size);
+  }
+  // the buffer of input i of the session
+  InputBuffer(const Session &session, size_t i, size_t size)
+      : InputBuffer(session.input_quant(i), size) {}
+
+  void resize(size_t size) {
+    if (!quant_) {
+      f32_.resize(size);
+    } else if (quant_->type == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8) {
+      i8_.resize(size);
+    } else {
+      u8_.resize(size);
+    }
+    size_ = size;
+  }
+  size_t size() const { return size_; }
+  bool quantized() const { return quant_.has_value(); }
+
+  // fn(T *data, convert) with convert(float) -> T
+  template <typename F> void visit(F &&fn) {
+    if (!quant_) {
+      fn(f32_.data(), FloatConvert{});
+    } else if (quant_->type == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8) {
+      fn(i8_.data(), QuantConvert<int8_t>(*quant_));
+    } else {
+      fn(u8_.data(), QuantConvert<uint8_t>(*quant_));
+    }
+  }
+
+  void bind(Runner &runner, size_t i, const std::vector<int64_t> &shape) {
+    visit([&](auto *data, auto) { runner.bind_input(i, data, size_, shape); });
+  }
+
+private:
+  std::optional<InputQuant> quant_;
+  std::vector<float> f32_;
+  std::vector<int8_t> i8_;
+  std::vector<uint8_t> u8_;
+  size_t size_ = 0;
+};
+
+} // namespace vai_ep
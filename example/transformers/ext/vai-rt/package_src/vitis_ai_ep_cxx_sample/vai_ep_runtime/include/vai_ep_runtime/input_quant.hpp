@@ -0,0 +1,339 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+#pragma once
+#include <onnxruntime_cxx_api.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace vai_ep {
+
+// Quantization of a model input: the input is fed as type (int8 or uint8),
+// q = round(v / scale) + zero_point
+struct InputQuant {
+  ONNXTensorElementDataType type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
+  float scale = 1.0f;
+  int zero_point = 0;
+};
+
+// Converts the float values of the preprocessing to the element type of the
+// input tensor
+struct FloatConvert {
+  float operator()(float v) const { return v; }
+};
+
+template <typename T> struct QuantConvert {
+  explicit QuantConvert(const InputQuant &quant)
+      : inv_scale(1.0f / quant.scale), zero_point(float(quant.zero_point)) {}
+  T operator()(float v) const {
+    auto q = std::nearbyint(v * inv_scale) + zero_point;
+    q = std::min(std::max(q, float(std::numeric_limits<T>::min())),
+                 float(std::numeric_limits<T>::max()));
+    return T(q);
+  }
+  float inv_scale;
+  float zero_point;
+};
+
+namespace detail {
+
+// Just enough of the protobuf wire format to read the nodes and the
+// initializers of an ONNX graph
+class ProtoReader {
+public:
+  ProtoReader(const uint8_t *begin, const uint8_t *end)
+      : pos_(begin), end_(end) {}
+
+  // the next field, false at the end or on a malformed message
+  bool next(uint32_t &field, uint32_t &wire) {
+    if (pos_ >= end_) {
+      return false;
+    }
+    uint64_t key = 0;
+    if (!varint(key)) {
+      return false;
+    }
+    field = uint32_t(key >> 3);
+    wire = uint32_t(key & 7);
+    return true;
+  }
+  bool varint(uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos_ < end_; shift += 7) {
+      auto byte = *pos_++;
+      value |= uint64_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  bool bytes(const uint8_t *&data, size_t &size) {
+    uint64_t len = 0;
+    if (!varint(len) || len > uint64_t(end_ - pos_)) {
+      return false;
+    }
+    data = pos_;
+    size = size_t(len);
+    pos_ += len;
+    return true;
+  }
+  bool fixed32(void *value) {
+    if (size_t(end_ - pos_) < 4) {
+      return false;
+    }
+    std::memcpy(value, pos_, 4);
+    pos_ += 4;
+    return true;
+  }
+  bool skip(uint32_t wire) {
+    uint64_t value = 0;
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    switch (wire) {
+    case 0:
+      return varint(value);
+    case 1:
+      return advance(8);
+    case 2:
+      return bytes(data, size);
+    case 5:
+      return advance(4);
+    default:
+      return false;
+    }
+  }
+
+private:
+  bool advance(size_t n) {
+    if (size_t(end_ - pos_) < n) {
+      return false;
+    }
+    pos_ += n;
+    return true;
+  }
+
+  const uint8_t *pos_;
+  const uint8_t *end_;
+};
+
+struct QuantNode {
+  std::string op_type;
+  std::vector<std::string> inputs;
+};
+
+// the first value of a scalar scale or zero point initializer
+struct Scalar {
+  int32_t data_type = 0;
+  std::vector<uint8_t> raw;
+  std::vector<float> floats;
+  std::vector<int64_t> ints;
+
+  bool value(double &v) const {
+    if (!floats.empty()) {
+      v = floats[0];
+    } else if (!ints.empty()) {
+      v = double(ints[0]);
+    } else if (data_type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT &&
+               raw.size() >= 4) {
+      float f;
+      std::memcpy(&f, raw.data(), 4);
+      v = f;
+    } else if (data_type == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8 && !raw.empty()) {
+      v = int8_t(raw[0]);
+    } else if (data_type == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8 &&
+               !raw.empty()) {
+      v = raw[0];
+    } else {
+      return false;
+    }
+    return true;
+  }
+};
+
+inline std::string to_string(const uint8_t *data, size_t size) {
+  return std::string(reinterpret_cast<const char *>(data), size);
+}
+
+inline bool read_node(const uint8_t *data, size_t size, QuantNode &node) {
+  ProtoReader reader(data, data + size);
+  uint32_t field, wire;
+  while (reader.next(field, wire)) {
+    const uint8_t *p = nullptr;
+    size_t n = 0;
+    if (wire == 2 && (field == 1 || field == 4)) {
+      if (!reader.bytes(p, n)) {
+        return false;
+      }
+      if (field == 1) {
+        node.inputs.push_back(to_string(p, n));
+      } else {
+        node.op_type = to_string(p, n);
+      }
+    } else if (!reader.skip(wire)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool read_tensor(const uint8_t *data, size_t size, std::string &name,
+                        Scalar &scalar) {
+  ProtoReader reader(data, data + size);
+  uint32_t field, wire;
+  while (reader.next(field, wire)) {
+    const uint8_t *p = nullptr;
+    size_t n = 0;
+    uint64_t value = 0;
+    if (field == 2 && wire == 0) {
+      if (!reader.varint(value)) {
+        return false;
+      }
+      scalar.data_type = int32_t(value);
+    } else if (field == 4 && wire == 2) { // packed float_data
+      if (!reader.bytes(p, n)) {
+        return false;
+      }
+      for (size_t i = 0; i + 4 <= n; i += 4) {
+        float f;
+        std::memcpy(&f, p + i, 4);
+        scalar.floats.push_back(f);
+      }
+    } else if (field == 4 && wire == 5) { // unpacked float_data
+      float f;
+      if (!reader.fixed32(&f)) {
+        return false;
+      }
+      scalar.floats.push_back(f);
+    } else if (field == 5 && wire == 2) { // packed int32_data
+      if (!reader.bytes(p, n)) {
+        return false;
+      }
+      ProtoReader ints(p, p + n);
+      while (ints.varint(value)) {
+        scalar.ints.push_back(int64_t(int32_t(value)));
+      }
+    } else if (field == 5 && wire == 0) {
+      if (!reader.varint(value)) {
+        return false;
+      }
+      scalar.ints.push_back(int64_t(int32_t(value)));
+    } else if (field == 8 && wire == 2) {
+      if (!reader.bytes(p, n)) {
+        return false;
+      }
+      name = to_string(p, n);
+    } else if (field == 9 && wire == 2) {
+      if (!reader.bytes(p, n)) {
+        return false;
+      }
+      scalar.raw.assign(p, p + n);
+    } else if (!reader.skip(wire)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace detail
+
+// Quantization params of the graph input input_name of a QDQ model: those of
+// the DequantizeLinear reading a quantized input, or of the QuantizeLinear
+// reading a float one. The type is the one of the quantized values. nullopt
+// if the input is not read by a Q/DQ node with scalar initializer params.
+inline std::optional<InputQuant> read_input_quant(const std::string &model,
+                                                  const std::string &input_name) {
+  std::ifstream f{model, std::ios::binary};
+  if (!f) {
+    return std::nullopt;
+  }
+  std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(f)),
+                             std::istreambuf_iterator<char>());
+
+  // ModelProto.graph
+  detail::ProtoReader model_reader(bytes.data(), bytes.data() + bytes.size());
+  const uint8_t *graph = nullptr;
+  size_t graph_size = 0;
+  uint32_t field, wire;
+  while (model_reader.next(field, wire)) {
+    if (field == 7 && wire == 2) {
+      if (!model_reader.bytes(graph, graph_size)) {
+        return std::nullopt;
+      }
+    } else if (!model_reader.skip(wire)) {
+      return std::nullopt;
+    }
+  }
+  if (!graph) {
+    return std::nullopt;
+  }
+
+  // GraphProto.node & GraphProto.initializer
+  std::optional<detail::QuantNode> quant_node;
+  std::map<std::string, detail::Scalar> initializers;
+  detail::ProtoReader graph_reader(graph, graph + graph_size);
+  while (graph_reader.next(field, wire)) {
+    const uint8_t *p = nullptr;
+    size_t n = 0;
+    if (wire == 2 && (field == 1 || field == 5)) {
+      if (!graph_reader.bytes(p, n)) {
+        return std::nullopt;
+      }
+      if (field == 1) {
+        detail::QuantNode node;
+        if (!quant_node && detail::read_node(p, n, node) &&
+            (node.op_type == "QuantizeLinear" ||
+             node.op_type == "DequantizeLinear") &&
+            node.inputs.size() >= 2 && node.inputs[0] == input_name) {
+          quant_node = node;
+        }
+      } else {
+        std::string name;
+        detail::Scalar scalar;
+        if (detail::read_tensor(p, n, name, scalar)) {
+          initializers.emplace(name, std::move(scalar));
+        }
+      }
+    } else if (!graph_reader.skip(wire)) {
+      return std::nullopt;
+    }
+  }
+  if (!quant_node) {
+    return std::nullopt;
+  }
+  // without a zero point, the values are uint8 with a zero point of 0
+  InputQuant quant;
+  quant.type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8;
+  auto scale = initializers.find(quant_node->inputs[1]);
+  double scale_value = 0.0, zero_point_value = 0.0;
+  if (scale == initializers.end() || !scale->second.value(scale_value) ||
+      scale_value <= 0.0) {
+    return std::nullopt;
+  }
+  if (quant_node->inputs.size() > 2 && !quant_node->inputs[2].empty()) {
+    auto zero_point = initializers.find(quant_node->inputs[2]);
+    if (zero_point == initializers.end() ||
+        !zero_point->second.value(zero_point_value)) {
+      return std::nullopt;
+    }
+    quant.type = ONNXTensorElementDataType(zero_point->second.data_type);
+  }
+  quant.scale = float(scale_value);
+  quant.zero_point = int(zero_point_value);
+  if (quant.type != ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8 &&
+      quant.type != ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8) {
+    return std::nullopt;
+  }
+  return quant;
+}
+
+} // namespace vai_ep
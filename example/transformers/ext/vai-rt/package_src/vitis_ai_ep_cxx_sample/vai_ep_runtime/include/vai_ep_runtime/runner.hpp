@@ -0,0 +1,154 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "session.hpp"
+
+namespace vai_ep {
+
+// Times of the runs of a Runner, in microseconds
+struct RunTimes {
+  int64_t last = 0;
+  int64_t total = 0;
+  uint64_t count = 0;
+  double mean() const { return count ? double(total) / count : 0.0; }
+};
+
+// Runs a session through an Ort::IoBinding. The inputs are bound to buffers
+// of the caller and bound again only when a buffer or its shape changes.
+// The outputs are bound to buffers owned by the runner once the batch is
+// known, so a run writes them in place and allocates nothing; outputs with
+// other dynamic dimensions are allocated by ORT at every run.
+//
+// A runner is used by one thread at a time, several runners may share a
+// session.
+class Runner {
+public:
+  explicit Runner(Session &session)
+      : session_(session), io_binding_(session.get()),
+        bound_inputs_(session.input_names().size()) {}
+  Runner(const Runner &) = delete;
+  Runner &operator=(const Runner &) = delete;
+
+  Session &session() { return session_; }
+
+  template <typename T>
+  void bind_input(size_t i, T *data, size_t size,
+                  const std::vector<int64_t> &shape) {
+    auto &bound = bound_inputs_.at(i);
+    if (bound.data == data && bound.size == size && bound.shape == shape) {
+      return;
+    }
+    auto tensor = Ort::Value::CreateTensor<T>(memory_info_, data, size,
+                                              shape.data(), shape.size());
+    io_binding_.BindInput(session_.input_names()[i], tensor);
+    bound.data = data;
+    bound.size = size;
+    bound.shape = shape;
+  }
+  template <typename T>
+  void bind_input(size_t i, std::vector<T> &values,
+                  const std::vector<int64_t> &shape) {
+    bind_input(i, values.data(), values.size(), shape);
+  }
+
+  // The batch replaces the dimension 0 of the output shapes, the outputs are
+  // float
+  void bind_outputs(int64_t batch) {
+    if (bound_batch_ == batch) {
+      return;
+    }
+    auto count = session_.output_names().size();
+    output_values_.resize(count);
+    output_shapes_.resize(count);
+    output_preallocated_.assign(count, false);
+    for (size_t i = 0; i < count; ++i) {
+      auto shape = session_.output_shapes()[i];
+      if (!shape.empty()) {
+        shape[0] = batch;
+      }
+      auto known = std::all_of(shape.begin(), shape.end(),
+                               [](int64_t d) { return d >= 0; });
+      if (!known) {
+        io_binding_.BindOutput(session_.output_names()[i], memory_info_);
+        continue;
+      }
+      output_values_[i].resize(shape_size(shape));
+      auto tensor = Ort::Value::CreateTensor<float>(
+          memory_info_, output_values_[i].data(), output_values_[i].size(),
+          shape.data(), shape.size());
+      io_binding_.BindOutput(session_.output_names()[i], tensor);
+      output_shapes_[i] = shape;
+      output_preallocated_[i] = true;
+    }
+    bound_batch_ = batch;
+  }
+
+  void run() {
+    if (bound_batch_ < 0) {
+      throw std::runtime_error("vai_ep_runtime : run before bind_outputs");
+    }
+    auto start = std::chrono::steady_clock::now();
+    session_.get().Run(Ort::RunOptions{nullptr}, io_binding_);
+    times_.last = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    times_.total += times_.last;
+    times_.count++;
+  }
+
+  // the output i of the last run and its shape
+  float *output(size_t i) {
+    if (output_preallocated_.at(i)) {
+      return output_values_[i].data();
+    }
+    fetch_dynamic_outputs();
+    return dynamic_outputs_[i].GetTensorMutableData<float>();
+  }
+  const std::vector<int64_t> &output_shape(size_t i) {
+    if (!output_preallocated_.at(i)) {
+      fetch_dynamic_outputs();
+      output_shapes_[i] =
+          dynamic_outputs_[i].GetTensorTypeAndShapeInfo().GetShape();
+    }
+    return output_shapes_[i];
+  }
+
+  const RunTimes &times() const { return times_; }
+  Ort::IoBinding &io_binding() { return io_binding_; }
+
+private:
+  struct BoundInput {
+    const void *data = nullptr;
+    size_t size = 0;
+    std::vector<int64_t> shape;
+  };
+
+  void fetch_dynamic_outputs() {
+    if (dynamic_outputs_run_ != times_.count) {
+      dynamic_outputs_ = io_binding_.GetOutputValues();
+      dynamic_outputs_run_ = times_.count;
+    }
+  }
+
+  Session &session_;
+  Ort::MemoryInfo memory_info_ =
+      Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+  Ort::IoBinding io_binding_;
+  std::vector<BoundInput> bound_inputs_;
+  int64_t bound_batch_ = -1;
+  std::vector<std::vector<float>> output_values_;
+  std::vector<std::vector<int64_t>> output_shapes_;
+  std::vector<bool> output_preallocated_;
+  std::vector<Ort::Value> dynamic_outputs_;
+  uint64_t dynamic_outputs_run_ = ~uint64_t{0};
+  RunTimes times_;
+};
+
+} // namespace vai_ep
@@ -0,0 +1,238 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+#pragma once
+#include <onnxruntime_cxx_api.h>
+#include <onnxruntime_session_options_config_keys.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "input_quant.hpp"
+
+namespace vai_ep {
+
+// pretty prints a shape dimension vector
+inline std::string print_shape(const std::vector<int64_t> &shape) {
+  std::stringstream ss;
+  for (size_t i = 0; i < shape.size(); i++) {
+    ss << (i ? "x" : "") << shape[i];
+  }
+  return ss.str();
+}
+
+inline int64_t shape_size(const std::vector<int64_t> &shape) {
+  return std::accumulate(shape.begin(), shape.end(), int64_t{1},
+                         std::multiplies<int64_t>());
+}
+
+// One env for all the sessions of the process, creating an env per session
+// also creates its logging and global state again
+inline Ort::Env &env() {
+  static Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "vai_ep_runtime");
+  return env;
+}
+
+struct SessionConfig {
+  std::string model;
+  // "npu" for the VitisAI EP, "cpu" for the CPU EP alone
+  std::string ep = "npu";
+  std::string config_file = "vaip_config.json";
+  // Compiled EP artifacts are kept in <cache_dir>/<cache_key>. No cache dir
+  // compiles the model on every run. An empty key is derived from the
+  // contents of the model & config, see cache_key().
+  std::string cache_dir;
+  std::string cache_key;
+  // <= 0 keeps the ORT default
+  int intra_op_threads = 0;
+  int inter_op_threads = 0;
+  bool disable_spinning = false;
+  bool disable_spinning_between_run = false;
+  std::string intra_op_thread_affinities;
+};
+
+// <model file stem>_<16 hex digits> of a FNV-1a hash of the model, the
+// config and the ORT version, so a stale cache of a changed model or of a
+// shared fixed key is never picked up
+inline std::string cache_key(const SessionConfig &config) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  auto add = [&hash](const char *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      hash ^= uint8_t(data[i]);
+      hash *= 0x100000001b3ull;
+    }
+  };
+  for (const auto &file : {config.model, config.config_file}) {
+    std::ifstream f{file, std::ios::binary};
+    if (!f) {
+      throw std::runtime_error("vai_ep_runtime : cannot read " + file);
+    }
+    std::vector<char> buffer(1 << 20);
+    while (f) {
+      f.read(buffer.data(), buffer.size());
+      add(buffer.data(), size_t(f.gcount()));
+    }
+    // separator, "ab" + "c" differs from "a" + "bc"
+    add("", 1);
+  }
+  std::string version = Ort::GetVersionString();
+  add(version.data(), version.size());
+  std::stringstream ss;
+  ss << std::filesystem::path{config.model}.stem().string() << "_" << std::hex
+     << std::setw(16) << std::setfill('0') << hash;
+  return ss.str();
+}
+
+// The EP writes the artifacts of a key in <cache_dir>/<key>
+inline bool is_cache_warm(const std::string &cache_dir,
+                          const std::string &cache_key) {
+  auto dir = std::filesystem::path{cache_dir} / cache_key;
+  return std::filesystem::is_directory(dir) &&
+         !std::filesystem::is_empty(dir);
+}
+
+inline Ort::SessionOptions make_session_options(const SessionConfig &config) {
+  Ort::SessionOptions options;
+  if (config.ep == "npu") {
+    auto ep_options = std::unordered_map<std::string, std::string>{
+        {"config_file", config.config_file}};
+    if (!config.cache_dir.empty()) {
+      std::filesystem::create_directories(config.cache_dir);
+      ep_options["cacheDir"] = config.cache_dir;
+      ep_options["cacheKey"] =
+          config.cache_key.empty() ? cache_key(config) : config.cache_key;
+    }
+    options.AppendExecutionProvider_VitisAI(ep_options);
+  } else if (config.ep != "cpu") {
+    throw std::runtime_error("vai_ep_runtime : unknown ep " + config.ep +
+                             ", choose from npu, cpu");
+  }
+  if (config.intra_op_threads > 0) {
+    options.SetIntraOpNumThreads(config.intra_op_threads);
+  }
+  if (config.inter_op_threads > 0) {
+    options.SetInterOpNumThreads(config.inter_op_threads);
+  }
+  if (config.disable_spinning) {
+    options.AddConfigEntry(kOrtSessionOptionsConfigAllowIntraOpSpinning, "0");
+  }
+  if (config.disable_spinning_between_run) {
+    options.AddConfigEntry(kOrtSessionOptionsConfigForceSpinningStop, "1");
+  }
+  if (!config.intra_op_thread_affinities.empty()) {
+    options.AddConfigEntry(kOrtSessionOptionsConfigIntraOpThreadAffinities,
+                           config.intra_op_thread_affinities.c_str());
+  }
+  return options;
+}
+
+// An ORT session with the names & shapes of its inputs and outputs. A batch
+// dimension of -1 is reported by dynamic_batch(), the shapes keep the -1.
+// Run is thread safe, the threads of a session each run with their own
+// Runner.
+class Session {
+public:
+  explicit Session(const SessionConfig &config)
+      : config_(config), options_(make_session_options(config)),
+        session_(env(), std::filesystem::path{config.model}.c_str(),
+                 options_) {
+    Ort::AllocatorWithDefaultOptions allocator;
+    for (size_t i = 0; i < session_.GetInputCount(); i++) {
+      input_names_ptr_.push_back(session_.GetInputNameAllocated(i, allocator));
+      input_names_.push_back(input_names_ptr_.back().get());
+      auto info = session_.GetInputTypeInfo(i).GetTensorTypeAndShapeInfo();
+      input_shapes_.push_back(info.GetShape());
+      input_types_.push_back(info.GetElementType());
+      input_quants_.push_back(std::nullopt);
+      if (input_types_.back() == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8 ||
+          input_types_.back() == ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8) {
+        input_quants_.back() =
+            read_input_quant(config.model, input_names_.back());
+        if (!input_quants_.back() ||
+            input_quants_.back()->type != input_types_.back()) {
+          throw std::runtime_error(
+              "vai_ep_runtime : no quantization params of input " +
+              std::string(input_names_.back()) + " in " + config.model);
+        }
+      }
+    }
+    for (size_t i = 0; i < session_.GetOutputCount(); i++) {
+      output_names_ptr_.push_back(
+          session_.GetOutputNameAllocated(i, allocator));
+      output_names_.push_back(output_names_ptr_.back().get());
+      output_shapes_.push_back(session_.GetOutputTypeInfo(i)
+                                   .GetTensorTypeAndShapeInfo()
+                                   .GetShape());
+    }
+  }
+  Session(const Session &) = delete;
+  Session &operator=(const Session &) = delete;
+
+  Ort::Session &get() { return session_; }
+  const SessionConfig &config() const { return config_; }
+
+  const std::vector<const char *> &input_names() const { return input_names_; }
+  const std::vector<const char *> &output_names() const {
+    return output_names_;
+  }
+  const std::vector<std::vector<int64_t>> &input_shapes() const {
+    return input_shapes_;
+  }
+  const std::vector<std::vector<int64_t>> &output_shapes() const {
+    return output_shapes_;
+  }
+  ONNXTensorElementDataType input_type(size_t i) const {
+    return input_types_.at(i);
+  }
+  // The params of an input the model takes quantized (int8 or uint8), read
+  // from the DequantizeLinear of the input. Its float preprocessing is then
+  // quantized straight into the input tensor, see InputBuffer. nullopt for
+  // a float input.
+  const std::optional<InputQuant> &input_quant(size_t i) const {
+    return input_quants_.at(i);
+  }
+  bool dynamic_batch() const {
+    return !input_shapes_.empty() && !input_shapes_[0].empty() &&
+           input_shapes_[0][0] == -1;
+  }
+
+  std::string to_string() const {
+    std::stringstream ss;
+    ss << "Input Node Name/Shape (" << input_names_.size() << "):\n";
+    for (size_t i = 0; i < input_names_.size(); i++) {
+      ss << "\t" << input_names_[i] << " : " << print_shape(input_shapes_[i])
+         << "\n";
+    }
+    ss << "Output Node Name/Shape (" << output_names_.size() << "):\n";
+    for (size_t i = 0; i < output_names_.size(); i++) {
+      ss << "\t" << output_names_[i] << " : "
+         << print_shape(output_shapes_[i]) << "\n";
+    }
+    return ss.str();
+  }
+
+private:
+  SessionConfig config_;
+  Ort::SessionOptions options_;
+  Ort::Session session_;
+  std::vector<Ort::AllocatedStringPtr> input_names_ptr_;
+  std::vector<Ort::AllocatedStringPtr> output_names_ptr_;
+  std::vector<const char *> input_names_;
+  std::vector<const char *> output_names_;
+  std::vector<std::vector<int64_t>> input_shapes_;
+  std::vector<std::vector<int64_t>> output_shapes_;
+  std::vector<ONNXTensorElementDataType> input_types_;
+  std::vector<std::optional<InputQuant>> input_quants_;
+};
+
+} // namespace vai_ep
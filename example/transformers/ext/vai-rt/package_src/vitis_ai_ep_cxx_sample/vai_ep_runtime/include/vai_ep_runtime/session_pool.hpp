@@ -0,0 +1,95 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+#pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "runner.hpp"
+
+namespace vai_ep {
+
+// Sessions of one model shared by the threads of a sample. Every session
+// has runners_per_session runners; acquire() lends a free runner and blocks
+// while all of them are busy, so any number of threads can share a fixed
+// number of sessions. The sessions are created up front: the first one
+// compiles the model into the EP cache, the others load it from there.
+class SessionPool {
+public:
+  class Lease {
+  public:
+    Lease(SessionPool &pool, Runner &runner) : pool_(&pool), runner_(&runner) {}
+    Lease(Lease &&other) noexcept
+        : pool_(other.pool_), runner_(other.runner_) {
+      other.pool_ = nullptr;
+    }
+    Lease(const Lease &) = delete;
+    Lease &operator=(const Lease &) = delete;
+    ~Lease() {
+      if (pool_) {
+        pool_->release(*runner_);
+      }
+    }
+    Runner &operator*() const { return *runner_; }
+    Runner *operator->() const { return runner_; }
+
+  private:
+    SessionPool *pool_;
+    Runner *runner_;
+  };
+
+  SessionPool(const SessionConfig &config, size_t num_sessions,
+              size_t runners_per_session = 1) {
+    for (size_t i = 0; i < std::max<size_t>(1u, num_sessions); i++) {
+      sessions_.push_back(std::make_unique<Session>(config));
+      for (size_t j = 0; j < std::max<size_t>(1u, runners_per_session); j++) {
+        runners_.push_back(std::make_unique<Runner>(*sessions_.back()));
+        free_.push_back(runners_.back().get());
+      }
+    }
+  }
+  SessionPool(const SessionPool &) = delete;
+  SessionPool &operator=(const SessionPool &) = delete;
+
+  Lease acquire() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [this] { return !free_.empty(); });
+    auto runner = free_.back();
+    free_.pop_back();
+    return Lease(*this, *runner);
+  }
+
+  // names & shapes are the same for all the sessions
+  const Session &session() const { return *sessions_[0]; }
+  size_t size() const { return runners_.size(); }
+
+  // the run times of all the runners
+  RunTimes times() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    RunTimes times;
+    for (const auto &runner : runners_) {
+      times.total += runner->times().total;
+      times.count += runner->times().count;
+    }
+    return times;
+  }
+
+private:
+  void release(Runner &runner) {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      free_.push_back(&runner);
+    }
+    cv_.notify_one();
+  }
+
+  std::vector<std::unique_ptr<Session>> sessions_;
+  std::vector<std::unique_ptr<Runner>> runners_;
+  mutable std::mutex mtx_;
+  std::condition_variable cv_;
+  std::vector<Runner *> free_;
+};
+
+} // namespace vai_ep
@@ -0,0 +1,254 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include "matmul.h"
+
+#include <chrono>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+// qlinear_2 headers
+#include "qlinear_2.hpp"
+#include "threadpool.h"
+
+namespace {
+
+using qlinear_int8_t = ryzenai::qlinear_2<int8_t, int8_t, int32_t>;
+using qlinear_int4_t = ryzenai::qlinear_2<int16_t, int8_t, float>;
+
+std::string &last_error() {
+  thread_local std::string error;
+  return error;
+}
+
+template <typename F> int guarded(F &&fn) {
+  try {
+    fn();
+    return 0;
+  } catch (const std::exception &e) {
+    last_error() = e.what();
+    return -1;
+  }
+}
+
+// The matmuls run on these workers, so submit() returns right away. With
+// two, one matmul copies its tiles while the NPU runs the other one.
+ThreadPool &dispatch_pool() {
+  static ThreadPool pool(2);
+  return pool;
+}
+
+} // namespace
+
+struct iree_plugins_matmul {
+  size_t K;
+  size_t N;
+  std::unique_ptr<qlinear_int8_t> int8;
+  std::unique_ptr<qlinear_int4_t> int4;
+
+  struct job_t {
+    const void *a;
+    size_t M;
+    void *c;
+    std::promise<void> done;
+  };
+
+  // qlinear_2 reuses its BOs, the jobs of a matmul run one after the other
+  // in submission order, drained by a single pool task at a time
+  std::mutex queue_mutex;
+  std::deque<std::unique_ptr<job_t>> queue;
+  bool draining = false;
+
+  std::shared_future<void> submit(const void *a, size_t M, void *c) {
+    auto job = std::make_unique<job_t>(job_t{a, M, c, {}});
+    std::shared_future<void> done = job->done.get_future().share();
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    queue.push_back(std::move(job));
+    if (!draining) {
+      draining = true;
+      dispatch_pool().enqueue([this]() { drain(); });
+    }
+    return done;
+  }
+
+  void drain() {
+    while (true) {
+      std::unique_ptr<job_t> job;
+      {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (queue.empty()) {
+          draining = false;
+          return;
+        }
+        job = std::move(queue.front());
+        queue.pop_front();
+      }
+      try {
+        run(job->a, job->M, job->c);
+        job->done.set_value();
+      } catch (...) {
+        job->done.set_exception(std::current_exception());
+      }
+    }
+  }
+
+  void run(const void *a, size_t M, void *c) {
+    const std::tuple<int, int> a_shape = {static_cast<int>(M),
+                                          static_cast<int>(K)};
+    if (int8) {
+      int8->execute(const_cast<int8_t *>(static_cast<const int8_t *>(a)),
+                    a_shape, static_cast<int32_t *>(c));
+    } else {
+      int4->execute(static_cast<const float *>(a), a_shape,
+                    static_cast<float *>(c));
+    }
+  }
+};
+
+namespace {
+
+struct matmul_cache_t {
+  std::mutex mutex;
+  std::map<const void *, std::unique_ptr<iree_plugins_matmul>> matmuls;
+};
+
+matmul_cache_t &matmul_cache() {
+  static matmul_cache_t cache;
+  return cache;
+}
+
+template <typename Init>
+iree_plugins_matmul *get_matmul(const void *w, size_t K, size_t N,
+                                Init &&init) {
+  auto &cache = matmul_cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  auto iter = cache.matmuls.find(w);
+  if (iter != cache.matmuls.end()) {
+    if (iter->second->K != K || iter->second->N != N) {
+      throw std::runtime_error("iree_plugins_matmul : weights at the same "
+                               "address with another shape");
+    }
+    return iter->second.get();
+  }
+  auto matmul = std::make_unique<iree_plugins_matmul>();
+  matmul->K = K;
+  matmul->N = N;
+  init(*matmul);
+  return cache.matmuls.emplace(w, std::move(matmul)).first->second.get();
+}
+
+struct fence_table_t {
+  std::mutex mutex;
+  iree_plugins_fence_t next = 1;
+  std::map<iree_plugins_fence_t, std::shared_future<void>> fences;
+};
+
+fence_table_t &fence_table() {
+  static fence_table_t table;
+  return table;
+}
+
+std::shared_future<void> find_fence(iree_plugins_fence_t fence) {
+  auto &table = fence_table();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  auto iter = table.fences.find(fence);
+  if (iter == table.fences.end()) {
+    throw std::runtime_error("iree_plugins_matmul : unknown fence " +
+                             std::to_string(fence));
+  }
+  return iter->second;
+}
+
+} // namespace
+
+extern "C" {
+
+int iree_plugins_matmul_get_int8(const int8_t *w, size_t K, size_t N,
+                                 iree_plugins_matmul_t **out_matmul) {
+  return guarded([&]() {
+    *out_matmul = get_matmul(w, K, N, [&](iree_plugins_matmul &matmul) {
+      matmul.int8 = std::make_unique<qlinear_int8_t>("int8", "int8", "int32");
+      std::tuple<int, int> w_shape = {static_cast<int>(K),
+                                      static_cast<int>(N)};
+      matmul.int8->initialize_weights(const_cast<int8_t *>(w), w_shape);
+    });
+  });
+}
+
+int iree_plugins_matmul_get_int4(const int8_t *w, const int8_t *zeros,
+                                 const float *scales, const float *bias,
+                                 size_t K, size_t N, size_t group_size,
+                                 iree_plugins_matmul_t **out_matmul) {
+  return guarded([&]() {
+    *out_matmul = get_matmul(w, K, N, [&](iree_plugins_matmul &matmul) {
+      matmul.int4 =
+          std::make_unique<qlinear_int4_t>("bfloat16", "int4", "float32");
+      std::tuple<int, int> w_shape = {static_cast<int>(K),
+                                      static_cast<int>(N)};
+      matmul.int4->initialize_weights_int4(
+          const_cast<int8_t *>(w), const_cast<int8_t *>(zeros),
+          const_cast<float *>(scales), const_cast<float *>(bias), w_shape,
+          static_cast<int>(group_size));
+    });
+  });
+}
+
+void iree_plugins_matmul_release_all(void) {
+  auto &cache = matmul_cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.matmuls.clear();
+}
+
+int iree_plugins_matmul_submit(iree_plugins_matmul_t *matmul, const void *a,
+                               size_t M, void *c,
+                               iree_plugins_fence_t *out_fence) {
+  return guarded([&]() {
+    auto done = matmul->submit(a, M, c);
+    auto &table = fence_table();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    *out_fence = table.next++;
+    table.fences.emplace(*out_fence, std::move(done));
+  });
+}
+
+int iree_plugins_fence_wait(iree_plugins_fence_t fence) {
+  return guarded([&]() {
+    auto done = find_fence(fence);
+    {
+      auto &table = fence_table();
+      std::lock_guard<std::mutex> lock(table.mutex);
+      table.fences.erase(fence);
+    }
+    // rethrows the error of the matmul
+    done.get();
+  });
+}
+
+int iree_plugins_fence_is_signaled(iree_plugins_fence_t fence) {
+  int signaled = 0;
+  int status = guarded([&]() {
+    auto done = find_fence(fence);
+    signaled = done.wait_for(std::chrono::seconds(0)) ==
+               std::future_status::ready;
+  });
+  return status == 0 ? signaled : status;
+}
+
+int iree_plugins_matmul_execute(iree_plugins_matmul_t *matmul, const void *a,
+                                size_t M, void *c) {
+  // queued behind the matmuls already submitted with the same weights
+  return guarded([&]() { matmul->submit(a, M, c).get(); });
+}
+
+const char *iree_plugins_matmul_last_error(void) {
+  return last_error().c_str();
+}
+
+} // extern "C"
@@ -0,0 +1,66 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+/*
+ * NPU matmuls of the IREE system plugin, on top of ops/cpp/qlinear_2.
+ *
+ * c[M, N] = a[M, K] * w[K, N] with the weights formatted once per weight
+ * buffer : IREE passes the constant weights of a model at the same address
+ * on every dispatch, so the formatted weights are cached by that address.
+ *
+ *   int8 : a, w int8, c int32 (w8a8)
+ *   int4 : a, c float, w int4 stored in int8, group quantized with zeros,
+ *          scales and bias (w4abf16)
+ *
+ * submit() returns a fence without waiting for the NPU, the host can keep
+ * working until it waits on the fence. Matmuls of the same weights run in
+ * submission order, those of different weights overlap.
+ *
+ * All functions return 0 on success, errors are reported by
+ * iree_plugins_matmul_last_error().
+ */
+
+#ifndef IREE_PLUGINS_MATMUL_H
+#define IREE_PLUGINS_MATMUL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct iree_plugins_matmul iree_plugins_matmul_t;
+typedef uint64_t iree_plugins_fence_t;
+
+// Formatted weights cached by the address of w, the cache keeps them alive
+// until iree_plugins_matmul_release_all()
+int iree_plugins_matmul_get_int8(const int8_t *w, size_t K, size_t N,
+                                 iree_plugins_matmul_t **out_matmul);
+int iree_plugins_matmul_get_int4(const int8_t *w, const int8_t *zeros,
+                                 const float *scales, const float *bias,
+                                 size_t K, size_t N, size_t group_size,
+                                 iree_plugins_matmul_t **out_matmul);
+void iree_plugins_matmul_release_all(void);
+
+// a and c have to stay valid until the fence is waited on
+int iree_plugins_matmul_submit(iree_plugins_matmul_t *matmul, const void *a,
+                               size_t M, void *c,
+                               iree_plugins_fence_t *out_fence);
+// blocks until the matmul of fence is done & releases the fence
+int iree_plugins_fence_wait(iree_plugins_fence_t fence);
+// 1 if the matmul of fence is done, the fence still has to be waited on
+int iree_plugins_fence_is_signaled(iree_plugins_fence_t fence);
+
+// submit & wait
+int iree_plugins_matmul_execute(iree_plugins_matmul_t *matmul, const void *a,
+                                size_t M, void *c);
+
+const char *iree_plugins_matmul_last_error(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // IREE_PLUGINS_MATMUL_H
@@ -0,0 +1,94 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "matmul.h"
+
+namespace {
+
+std::vector<int8_t> random_int8(size_t size, int lo, int hi) {
+  std::mt19937 gen(0xABCD);
+  std::uniform_int_distribution<int> dist(lo, hi);
+  std::vector<int8_t> data(size);
+  for (auto &value : data) {
+    value = static_cast<int8_t>(dist(gen));
+  }
+  return data;
+}
+
+std::vector<int32_t> cpu_matmul(const std::vector<int8_t> &a,
+                                const std::vector<int8_t> &w, size_t M,
+                                size_t K, size_t N) {
+  std::vector<int32_t> c(M * N, 0);
+  for (size_t m = 0; m < M; ++m) {
+    for (size_t k = 0; k < K; ++k) {
+      for (size_t n = 0; n < N; ++n) {
+        c[m * N + n] += int32_t(a[m * K + k]) * int32_t(w[k * N + n]);
+      }
+    }
+  }
+  return c;
+}
+
+} // namespace
+
+TEST(IreePluginsMatmul, Int8Execute) {
+  const size_t M = 8, K = 2048, N = 2048;
+  auto a = random_int8(M * K, -8, 8);
+  auto w = random_int8(K * N, -8, 8);
+  std::vector<int32_t> c(M * N);
+
+  iree_plugins_matmul_t *matmul = nullptr;
+  ASSERT_EQ(iree_plugins_matmul_get_int8(w.data(), K, N, &matmul), 0)
+      << iree_plugins_matmul_last_error();
+  ASSERT_EQ(iree_plugins_matmul_execute(matmul, a.data(), M, c.data()), 0)
+      << iree_plugins_matmul_last_error();
+  EXPECT_EQ(c, cpu_matmul(a, w, M, K, N));
+  iree_plugins_matmul_release_all();
+}
+
+TEST(IreePluginsMatmul, Int8SubmitWait) {
+  const size_t M = 8, K = 2048, N = 2048;
+  auto w = random_int8(K * N, -8, 8);
+  auto a0 = random_int8(M * K, -8, 8);
+  auto a1 = random_int8(M * K, 0, 8);
+  std::vector<int32_t> c0(M * N), c1(M * N);
+
+  iree_plugins_matmul_t *matmul = nullptr;
+  ASSERT_EQ(iree_plugins_matmul_get_int8(w.data(), K, N, &matmul), 0)
+      << iree_plugins_matmul_last_error();
+  // the same weights are formatted once
+  iree_plugins_matmul_t *cached = nullptr;
+  ASSERT_EQ(iree_plugins_matmul_get_int8(w.data(), K, N, &cached), 0);
+  EXPECT_EQ(matmul, cached);
+
+  iree_plugins_fence_t fence0 = 0, fence1 = 0;
+  ASSERT_EQ(iree_plugins_matmul_submit(matmul, a0.data(), M, c0.data(),
+                                       &fence0),
+            0);
+  ASSERT_EQ(iree_plugins_matmul_submit(matmul, a1.data(), M, c1.data(),
+                                       &fence1),
+            0);
+  EXPECT_NE(fence0, fence1);
+  // waited out of submission order
+  ASSERT_EQ(iree_plugins_fence_wait(fence1), 0)
+      << iree_plugins_matmul_last_error();
+  EXPECT_EQ(iree_plugins_fence_is_signaled(fence0), 1);
+  ASSERT_EQ(iree_plugins_fence_wait(fence0), 0)
+      << iree_plugins_matmul_last_error();
+
+  EXPECT_EQ(c0, cpu_matmul(a0, w, M, K, N));
+  EXPECT_EQ(c1, cpu_matmul(a1, w, M, K, N));
+  iree_plugins_matmul_release_all();
+}
+
+TEST(IreePluginsMatmul, UnknownFence) {
+  EXPECT_NE(iree_plugins_fence_wait(12345678), 0);
+  EXPECT_NE(iree_plugins_fence_is_signaled(12345678), 1);
+}
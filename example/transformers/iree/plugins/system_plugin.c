@@ -0,0 +1,263 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+/*
+ * IREE system executable plugin offloading the matmuls of a model to the
+ * NPU, see matmul.h. The dispatches of the compiled model call the imports
+ * below with their bindings : a binding is a base pointer followed by an
+ * element offset, then come the dims.
+ *
+ *   ryzenai_matmul_i8(a, w, c, M, K, N)
+ *   ryzenai_matmul_i4(a, w, zeros, scales, bias, c, M, K, N, group_size)
+ *     run the matmul and return when c is written
+ *   ryzenai_matmul_i8_submit / ryzenai_matmul_i4_submit(..., fence)
+ *     same bindings & dims followed by a uint64 fence binding, return once
+ *     the matmul is queued
+ *   ryzenai_fence_wait(fence)
+ *     return when the matmul of fence has written c
+ *
+ * The submit imports let the model do host work between the submit and the
+ * wait of a matmul, the a & c buffers have to stay live until the wait. The
+ * blocking ones are kept for models compiled without the split.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "iree/hal/local/executable_plugin.h"
+#include "matmul.h"
+
+#if defined(_MSC_VER)
+#define RESTRICT __restrict
+#else
+#define RESTRICT restrict
+#endif
+
+typedef struct {
+  iree_hal_executable_plugin_allocator_t host_allocator;
+} system_plugin_t;
+
+typedef struct {
+  const int8_t *RESTRICT a;
+  size_t a_offset;
+  const int8_t *RESTRICT w;
+  size_t w_offset;
+  int32_t *RESTRICT c;
+  size_t c_offset;
+  size_t M;
+  size_t K;
+  size_t N;
+} matmul_i8_params_t;
+
+typedef struct {
+  const float *RESTRICT a;
+  size_t a_offset;
+  const int8_t *RESTRICT w;
+  size_t w_offset;
+  const int8_t *RESTRICT zeros;
+  size_t zeros_offset;
+  const float *RESTRICT scales;
+  size_t scales_offset;
+  const float *RESTRICT bias;
+  size_t bias_offset;
+  float *RESTRICT c;
+  size_t c_offset;
+  size_t M;
+  size_t K;
+  size_t N;
+  size_t group_size;
+} matmul_i4_params_t;
+
+typedef struct {
+  matmul_i8_params_t matmul;
+  uint64_t *RESTRICT fence;
+  size_t fence_offset;
+} matmul_i8_submit_params_t;
+
+typedef struct {
+  matmul_i4_params_t matmul;
+  uint64_t *RESTRICT fence;
+  size_t fence_offset;
+} matmul_i4_submit_params_t;
+
+typedef struct {
+  const uint64_t *RESTRICT fence;
+  size_t fence_offset;
+} fence_wait_params_t;
+
+static iree_plugins_matmul_t *get_matmul_i8(const matmul_i8_params_t *params) {
+  iree_plugins_matmul_t *matmul = NULL;
+  if (iree_plugins_matmul_get_int8(params->w + params->w_offset, params->K,
+                                   params->N, &matmul) != 0) {
+    return NULL;
+  }
+  return matmul;
+}
+
+static iree_plugins_matmul_t *get_matmul_i4(const matmul_i4_params_t *params) {
+  iree_plugins_matmul_t *matmul = NULL;
+  if (iree_plugins_matmul_get_int4(
+          params->w + params->w_offset, params->zeros + params->zeros_offset,
+          params->scales + params->scales_offset,
+          params->bias + params->bias_offset, params->K, params->N,
+          params->group_size, &matmul) != 0) {
+    return NULL;
+  }
+  return matmul;
+}
+
+static int ryzenai_matmul_i8(void *params_ptr, void *context, void *reserved) {
+  const matmul_i8_params_t *params = (const matmul_i8_params_t *)params_ptr;
+  iree_plugins_matmul_t *matmul = get_matmul_i8(params);
+  if (!matmul) {
+    return -1;
+  }
+  return iree_plugins_matmul_execute(matmul, params->a + params->a_offset,
+                                     params->M, params->c + params->c_offset);
+}
+
+static int ryzenai_matmul_i4(void *params_ptr, void *context, void *reserved) {
+  const matmul_i4_params_t *params = (const matmul_i4_params_t *)params_ptr;
+  iree_plugins_matmul_t *matmul = get_matmul_i4(params);
+  if (!matmul) {
+    return -1;
+  }
+  return iree_plugins_matmul_execute(matmul, params->a + params->a_offset,
+                                     params->M, params->c + params->c_offset);
+}
+
+static int ryzenai_matmul_i8_submit(void *params_ptr, void *context,
+                                    void *reserved) {
+  const matmul_i8_submit_params_t *params =
+      (const matmul_i8_submit_params_t *)params_ptr;
+  iree_plugins_matmul_t *matmul = get_matmul_i8(&params->matmul);
+  if (!matmul) {
+    return -1;
+  }
+  return iree_plugins_matmul_submit(
+      matmul, params->matmul.a + params->matmul.a_offset, params->matmul.M,
+      params->matmul.c + params->matmul.c_offset,
+      params->fence + params->fence_offset);
+}
+
+static int ryzenai_matmul_i4_submit(void *params_ptr, void *context,
+                                    void *reserved) {
+  const matmul_i4_submit_params_t *params =
+      (const matmul_i4_submit_params_t *)params_ptr;
+  iree_plugins_matmul_t *matmul = get_matmul_i4(&params->matmul);
+  if (!matmul) {
+    return -1;
+  }
+  return iree_plugins_matmul_submit(
+      matmul, params->matmul.a + params->matmul.a_offset, params->matmul.M,
+      params->matmul.c + params->matmul.c_offset,
+      params->fence + params->fence_offset);
+}
+
+static int ryzenai_fence_wait(void *params_ptr, void *context,
+                              void *reserved) {
+  const fence_wait_params_t *params = (const fence_wait_params_t *)params_ptr;
+  return iree_plugins_fence_wait(params->fence[params->fence_offset]);
+}
+
+static iree_hal_executable_plugin_status_t system_plugin_load(
+    const iree_hal_executable_plugin_environment_v0_t *environment,
+    size_t param_count, const iree_hal_executable_plugin_string_pair_t *params,
+    void **out_self) {
+  system_plugin_t *plugin = NULL;
+  iree_hal_executable_plugin_status_t status =
+      iree_hal_executable_plugin_allocator_malloc(
+          environment->host_allocator, sizeof(*plugin), (void **)&plugin);
+  if (status) {
+    return status;
+  }
+  plugin->host_allocator = environment->host_allocator;
+  *out_self = plugin;
+  return iree_hal_executable_plugin_ok_status();
+}
+
+static void system_plugin_unload(void *self) {
+  system_plugin_t *plugin = (system_plugin_t *)self;
+  iree_hal_executable_plugin_allocator_t host_allocator =
+      plugin->host_allocator;
+  // the formatted weights are owned by the plugin, the model is gone
+  iree_plugins_matmul_release_all();
+  iree_hal_executable_plugin_allocator_free(host_allocator, plugin);
+}
+
+typedef struct {
+  const char *name;
+  int (*fn)(void *, void *, void *);
+} import_t;
+
+static const import_t imports[] = {
+    {"ryzenai_matmul_i8", ryzenai_matmul_i8},
+    {"ryzenai_matmul_i4", ryzenai_matmul_i4},
+    {"ryzenai_matmul_i8_submit", ryzenai_matmul_i8_submit},
+    {"ryzenai_matmul_i4_submit", ryzenai_matmul_i4_submit},
+    {"ryzenai_fence_wait", ryzenai_fence_wait},
+};
+
+static iree_hal_executable_plugin_status_t system_plugin_resolve(
+    void *self, const iree_hal_executable_plugin_resolve_params_v0_t *params,
+    iree_hal_executable_plugin_resolution_t *out_resolution) {
+  system_plugin_t *plugin = (system_plugin_t *)self;
+  *out_resolution = 0;
+  bool any_required_not_found = false;
+  for (size_t i = 0; i < params->count; ++i) {
+    if (params->out_fn_ptrs[i]) {
+      continue;
+    }
+    const char *symbol_name = params->symbol_names[i];
+    bool is_optional =
+        iree_hal_executable_plugin_import_is_optional(symbol_name);
+    if (is_optional) {
+      ++symbol_name;
+    }
+    bool found = false;
+    for (size_t j = 0; j < sizeof(imports) / sizeof(imports[0]); ++j) {
+      if (iree_hal_executable_plugin_strcmp(symbol_name, imports[j].name) ==
+          0) {
+        params->out_fn_ptrs[i] = imports[j].fn;
+        params->out_fn_contexts[i] = plugin;
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      if (is_optional) {
+        *out_resolution |=
+            IREE_HAL_EXECUTABLE_PLUGIN_RESOLUTION_MISSING_OPTIONAL;
+      } else {
+        any_required_not_found = true;
+      }
+    }
+  }
+  return any_required_not_found
+             ? iree_hal_executable_plugin_status_from_code(
+                   IREE_HAL_EXECUTABLE_PLUGIN_STATUS_NOT_FOUND)
+             : iree_hal_executable_plugin_ok_status();
+}
+
+IREE_HAL_EXECUTABLE_PLUGIN_EXPORT const iree_hal_executable_plugin_header_t **
+iree_hal_executable_plugin_query(
+    iree_hal_executable_plugin_version_t max_version, void *reserved) {
+  static const iree_hal_executable_plugin_header_t header = {
+      .version = IREE_HAL_EXECUTABLE_PLUGIN_VERSION_LATEST,
+      .name = "ryzenai_matmul",
+      .description = "NPU matmuls on qlinear_2",
+      .features = 0,
+      .sanitizer = IREE_HAL_EXECUTABLE_PLUGIN_SANITIZER_KIND,
+  };
+  static const iree_hal_executable_plugin_v0_t plugin = {
+      .header = &header,
+      .load = system_plugin_load,
+      .unload = system_plugin_unload,
+      .resolve = system_plugin_resolve,
+  };
+  return max_version <= IREE_HAL_EXECUTABLE_PLUGIN_VERSION_LATEST
+             ? (const iree_hal_executable_plugin_header_t **)&plugin
+             : NULL;
+}
@@ -7,6 +7,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <tuple>
 
 // XRT headers
@@ -27,6 +28,7 @@
 #include "xaiengine.h"
 
 #include "logging.h"
+#include "scratch_arena.h"
 #include "utils.h"
 
 using bfloat16 = int16_t;
@@ -42,10 +44,10 @@ private:
   int64_t w_shape_[2];
   int64_t w_padded_shape_[2];
   xrt_context *xrt_ctx_;
-  xrt::bo a_bo_;
-  xrt::bo c_bo_;
-  bfloat16 *a_map_;
-  std::vector<bfloat16> c_tmp_buf;
+  // two BO sets, so that the next tile is copied and dispatched while the
+  // output of the current one is accumulated
+  xrt::bo a_bo_[2];
+  xrt::bo c_bo_[2];
   std::vector<xrt::bo> weights_bo_;
   xrt::bo instr_bo_;
   int64_t a_copy_time_;
@@ -56,8 +58,9 @@ private:
   int64_t cpu_acc_time_;
   int64_t num_run_aie_;
 
-  void linear::run_aie(bfloat16 *a, xrt::bo &w_bo, bfloat16 *c,
-                       int64_t *a_shape);
+  xrt::run linear::run_aie_submit(bfloat16 *a, xrt::bo &w_bo,
+                                  int64_t *a_shape, int slot);
+  void linear::run_aie_wait(xrt::run &run, int slot);
   void linear::initialize_instructions(std::string &txn_fname);
   void linear::execute_tiled(bfloat16 *a, float *c, int64_t *a_shape);
 
@@ -166,15 +169,16 @@ linear::linear(const std::tuple<int, int> &kernel_x_shape,
   auto device_ = xrt_ctx_->get_device();
   auto kernel_ = xrt_ctx_->get_kernel();
 
-  a_bo_ = xrt::bo(xrt_ctx_->get_context(),
-                  kernel_x_shape_[0] * kernel_x_shape_[1] * sizeof(bfloat16),
-                  xrt::bo::flags::host_only, kernel_.group_id(0));
-  c_bo_ = xrt::bo(xrt_ctx_->get_context(),
-                  kernel_z_shape_[0] * kernel_z_shape_[1] * sizeof(bfloat16),
-                  xrt::bo::flags::host_only, kernel_.group_id(0));
-  a_map_ = a_bo_.map<bfloat16 *>();
-
-  c_tmp_buf = std::vector<bfloat16>(kernel_x_shape_[0] * kernel_y_shape_[1]);
+  for (int slot = 0; slot < 2; ++slot) {
+    a_bo_[slot] =
+        xrt::bo(xrt_ctx_->get_context(),
+                kernel_x_shape_[0] * kernel_x_shape_[1] * sizeof(bfloat16),
+                xrt::bo::flags::host_only, kernel_.group_id(0));
+    c_bo_[slot] =
+        xrt::bo(xrt_ctx_->get_context(),
+                kernel_z_shape_[0] * kernel_z_shape_[1] * sizeof(bfloat16),
+                xrt::bo::flags::host_only, kernel_.group_id(0));
+  }
 
   initialize_instructions(txn_bin);
 
@@ -209,41 +213,51 @@ void _cpu_acc(float *acc, T *in, int64_t *tile_shape, int64_t *acc_stride) {
   }
 }
 
-// run with strided copy support
-void linear::run_aie(bfloat16 *a, xrt::bo &w_bo, bfloat16 *c,
-                     int64_t *a_shape) {
+// copy the strided A tile to the BO set of slot and start the kernel, without
+// waiting for it
+xrt::run linear::run_aie_submit(bfloat16 *a, xrt::bo &w_bo, int64_t *a_shape,
+                                int slot) {
+  auto &a_bo = a_bo_[slot];
+  auto &c_bo = c_bo_[slot];
+
   int64_t a_copy_start = GET_ELAPSED_TIME_NS();
-  Utils::_copy_tile<bfloat16>(a, a_map_, &kernel_x_shape_[0], &a_shape[1]);
+  Utils::_copy_tile<bfloat16>(a, a_bo.map<bfloat16 *>(), &kernel_x_shape_[0],
+                              &a_shape[1]);
   int64_t a_copy_stop = GET_ELAPSED_TIME_NS();
 
   int64_t a_sync_start = GET_ELAPSED_TIME_NS();
-  a_bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  a_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
   int64_t a_sync_stop = GET_ELAPSED_TIME_NS();
 
   int64_t run_aie_start = GET_ELAPSED_TIME_NS();
   std::vector<u64> kargv(5, 0);
   auto kernel_ = xrt_ctx_->get_kernel();
   auto run = kernel_(OPCODE, instr_bo_, instr_bo_.size() / sizeof(int),
-                     c_bo_.address() + DDR_AIE_ADDR_OFFSET,
-                     a_bo_.address() + DDR_AIE_ADDR_OFFSET,
+                     c_bo.address() + DDR_AIE_ADDR_OFFSET,
+                     a_bo.address() + DDR_AIE_ADDR_OFFSET,
                      w_bo.address() + DDR_AIE_ADDR_OFFSET, kargv[3], kargv[4]);
+  int64_t run_aie_stop = GET_ELAPSED_TIME_NS();
+
+  a_copy_time_ += a_copy_stop - a_copy_start;
+  a_sync_time_ += a_sync_stop - a_sync_start;
+  run_aie_time_ += run_aie_stop - run_aie_start;
+  num_run_aie_++;
+  return run;
+}
+
+// wait for a run started by run_aie_submit, its output is then in the C BO of
+// slot
+void linear::run_aie_wait(xrt::run &run, int slot) {
+  int64_t run_aie_start = GET_ELAPSED_TIME_NS();
   run.wait();
   int64_t run_aie_stop = GET_ELAPSED_TIME_NS();
 
   int64_t c_sync_start = GET_ELAPSED_TIME_NS();
-  c_bo_.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+  c_bo_[slot].sync(XCL_BO_SYNC_BO_FROM_DEVICE);
   int64_t c_sync_stop = GET_ELAPSED_TIME_NS();
 
-  int64_t c_copy_start = GET_ELAPSED_TIME_NS();
-  c_bo_.read(c);
-  int64_t c_copy_stop = GET_ELAPSED_TIME_NS();
-
-  a_copy_time_ += a_copy_stop - a_copy_start;
-  a_sync_time_ += a_sync_stop - a_sync_start;
-  c_copy_time_ += c_copy_stop - c_copy_start;
   c_sync_time_ += c_sync_stop - c_sync_start;
   run_aie_time_ += run_aie_stop - run_aie_start;
-  num_run_aie_++;
 }
 
 void linear::execute(bfloat16 *a, const std::tuple<int, int> &a_shape,
@@ -266,26 +280,24 @@ void linear::execute(bfloat16 *a, const std::tuple<int, int> &a_shape,
   float *c_result = c_ptr;
   bool a_pad = false, c_pad = false;
 
-  std::vector<bfloat16> a_copy(a_new_shape[0] * a_new_shape[1]);
-  std::vector<float> c_copy(c_new_shape[0] * c_new_shape[1]);
+  // scratch buffers come from the arena of the thread only when padding is
+  // needed, only the ragged edge of the A copy is zeroed
+  Utils::ScratchArena::Scope scratch;
 
   int64_t a_pad_start = GET_ELAPSED_TIME_NS();
   if ((a_new_shape[0] != a_shape_[0]) || (a_new_shape[1] != a_shape_[1])) {
     // padding is required for A
-    memset(a_copy.data(), 0,
-           sizeof(bfloat16) * a_new_shape[0] * a_new_shape[1]);
-    Utils::_copy_pad_data<bfloat16>(a_ptr, a_copy.data(), &a_shape_[0],
-                                    &a_new_shape[0]);
-    a_compute = a_copy.data();
+    a_compute = scratch.alloc<bfloat16>(a_new_shape[0] * a_new_shape[1]);
+    Utils::_copy_pad_data_zero_edge<bfloat16>(a_ptr, a_compute, &a_shape_[0],
+                                              &a_new_shape[0]);
     a_pad = true;
   }
   int64_t a_pad_stop = GET_ELAPSED_TIME_NS();
 
   int64_t c_pad_start = GET_ELAPSED_TIME_NS();
   if ((c_new_shape[0] != c_shape_[0]) || (c_new_shape[1] != c_shape_[1])) {
-    // padding is required for C
-    memset(c_copy.data(), 0, sizeof(float) * c_new_shape[0] * c_new_shape[1]);
-    c_result = c_copy.data();
+    // padding is required for C, the tiles accumulate into it
+    c_result = scratch.zeros<float>(c_new_shape[0] * c_new_shape[1]);
     c_pad = true;
   }
   int64_t c_pad_stop = GET_ELAPSED_TIME_NS();
@@ -320,28 +332,48 @@ void linear::execute(bfloat16 *a, const std::tuple<int, int> &a_shape,
 }
 
 void linear::execute_tiled(bfloat16 *a, float *c, int64_t *a_shape) {
+  struct tile_job_t {
+    int64_t a_offset;
+    int64_t c_offset;
+    int64_t b_tile_idx;
+  };
+  std::vector<tile_job_t> jobs;
+  auto num_b_tiled_cols = w_padded_shape_[1] / kernel_y_shape_[1];
   for (int64_t ra = 0; ra < a_shape[0]; ra += kernel_x_shape_[0]) {
     for (int64_t cb = 0; cb < w_padded_shape_[1]; cb += kernel_y_shape_[1]) {
       for (int64_t ca = 0; ca < a_shape[1]; ca += kernel_x_shape_[1]) {
         auto rb = ca;
-        auto num_b_tiled_cols = w_padded_shape_[1] / kernel_y_shape_[1];
         auto cb_num = cb / kernel_y_shape_[1];
         auto rb_num = rb / kernel_y_shape_[0];
-        auto b_tile_idx = cb_num + rb_num * num_b_tiled_cols;
-        auto c_offset = ra * w_padded_shape_[1] + cb;
-        auto a_offset = ra * a_shape[1] + ca;
-
-        run_aie(a + a_offset, weights_bo_.data()[b_tile_idx], c_tmp_buf.data(),
-                a_shape);
-
-        int64_t cpu_accum_start = GET_ELAPSED_TIME_NS();
-        _cpu_acc(c + c_offset, c_tmp_buf.data(), &kernel_z_shape_[0],
-                 &w_padded_shape_[1]);
-        int64_t cpu_accum_stop = GET_ELAPSED_TIME_NS();
-        cpu_acc_time_ += cpu_accum_stop - cpu_accum_start;
+        jobs.push_back({ra * a_shape[1] + ca, ra * w_padded_shape_[1] + cb,
+                        cb_num + rb_num * num_b_tiled_cols});
       }
     }
   }
+
+  // Software pipeline over the two BO sets : tile i + 1 is copied and started
+  // before the output of tile i is accumulated on the host.
+  xrt::run runs[2];
+  auto submit = [&](size_t i) {
+    runs[i % 2] = run_aie_submit(a + jobs[i].a_offset,
+                                 weights_bo_[jobs[i].b_tile_idx], a_shape,
+                                 (int)(i % 2));
+  };
+  if (!jobs.empty()) {
+    submit(0);
+  }
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    if (i + 1 < jobs.size()) {
+      submit(i + 1);
+    }
+    run_aie_wait(runs[i % 2], (int)(i % 2));
+
+    int64_t cpu_accum_start = GET_ELAPSED_TIME_NS();
+    _cpu_acc(c + jobs[i].c_offset, c_bo_[i % 2].map<bfloat16 *>(),
+             &kernel_z_shape_[0], &w_padded_shape_[1]);
+    int64_t cpu_accum_stop = GET_ELAPSED_TIME_NS();
+    cpu_acc_time_ += cpu_accum_stop - cpu_accum_start;
+  }
 }
 
 } // namespace ryzenai
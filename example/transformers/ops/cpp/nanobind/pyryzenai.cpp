@@ -20,14 +20,27 @@ NB_MODULE(_RyzenAI, m) {
                     const std::string &>())
       .def("execute",
            &ryzenai::py_qlinear_2<int8_t, int8_t, int32_t>::py_execute,
-           "Function to execute matmul on aie with cpu tiling")
+           "Function to execute matmul on aie with cpu tiling",
+           nb::arg("a"), nb::arg("c"),
+           nb::call_guard<nb::gil_scoped_release>())
       .def("debug", &ryzenai::py_qlinear_2<int8_t, int8_t, int32_t>::py_debug,
            "Function to enable debug flag that writes matrices to files")
       .def("initialize_weights",
            &ryzenai::py_qlinear_2<int8_t, int8_t,
                                   int32_t>::py_initialize_weights,
            "Register weights from numpy array", nb::arg("wts"),
-           nb::arg("group_size") = nb::none());
+           nb::arg("group_size") = nb::none())
+      .def("save_weights",
+           &ryzenai::py_qlinear_2<int8_t, int8_t, int32_t>::py_save_weights,
+           "Write the formatted weights to an NPU-native weight file")
+      .def("initialize_weights_from_file",
+           &ryzenai::py_qlinear_2<int8_t, int8_t,
+                                  int32_t>::py_initialize_weights_from_file,
+           "Load weights from an NPU-native weight file")
+      .def("initialize_weights_streamed",
+           &ryzenai::py_qlinear_2<int8_t, int8_t,
+                                  int32_t>::py_initialize_weights_streamed,
+           "Stream weights from an NPU-native weight file");
 
   nb::class_<ryzenai::py_qlinear_2<int16_t, int8_t, int64_t>>(
       m, "qlinear_2_a16w8acc64")
@@ -35,14 +48,27 @@ NB_MODULE(_RyzenAI, m) {
                     const std::string &>())
       .def("execute",
            &ryzenai::py_qlinear_2<int16_t, int8_t, int64_t>::py_execute,
-           "Function to execute matmul on aie with cpu tiling")
+           "Function to execute matmul on aie with cpu tiling",
+           nb::arg("a"), nb::arg("c"),
+           nb::call_guard<nb::gil_scoped_release>())
       .def("debug", &ryzenai::py_qlinear_2<int16_t, int8_t, int64_t>::py_debug,
            "Function to enable debug flag that writes matrices to files")
       .def("initialize_weights",
            &ryzenai::py_qlinear_2<int16_t, int8_t,
                                   int64_t>::py_initialize_weights,
            "Register weights from numpy array", nb::arg("wts"),
-           nb::arg("group_size") = nb::none());
+           nb::arg("group_size") = nb::none())
+      .def("save_weights",
+           &ryzenai::py_qlinear_2<int16_t, int8_t, int64_t>::py_save_weights,
+           "Write the formatted weights to an NPU-native weight file")
+      .def("initialize_weights_from_file",
+           &ryzenai::py_qlinear_2<int16_t, int8_t,
+                                  int64_t>::py_initialize_weights_from_file,
+           "Load weights from an NPU-native weight file")
+      .def("initialize_weights_streamed",
+           &ryzenai::py_qlinear_2<int16_t, int8_t,
+                                  int64_t>::py_initialize_weights_streamed,
+           "Stream weights from an NPU-native weight file");
 
   nb::class_<ryzenai::py_qlinear_2<int16_t, int8_t, float>>(
       m, "qlinear_2_a16fw4acc32f")
@@ -50,13 +76,33 @@ NB_MODULE(_RyzenAI, m) {
                     const std::string &>())
       .def("execute",
            &ryzenai::py_qlinear_2<int16_t, int8_t, float>::py_execute,
-           "Function to execute matmul on aie with cpu tiling")
+           "Function to execute matmul on aie with cpu tiling",
+           nb::arg("a"), nb::arg("c"),
+           nb::call_guard<nb::gil_scoped_release>())
       .def("debug", &ryzenai::py_qlinear_2<int16_t, int8_t, float>::py_debug,
            "Function to enable debug flag that writes matrices to files")
       .def("initialize_weights",
            &ryzenai::py_qlinear_2<int16_t, int8_t,
                                   float>::py_initialize_weights_int4,
-           "Register weights from numpy array");
+           "Register weights from numpy array")
+      .def("save_weights",
+           &ryzenai::py_qlinear_2<int16_t, int8_t, float>::py_save_weights,
+           "Write the formatted weights to an NPU-native weight file")
+      .def("initialize_weights_from_file",
+           &ryzenai::py_qlinear_2<int16_t, int8_t,
+                                  float>::py_initialize_weights_from_file,
+           "Load weights from an NPU-native weight file")
+      .def("initialize_weights_streamed",
+           &ryzenai::py_qlinear_2<int16_t, int8_t,
+                                  float>::py_initialize_weights_streamed,
+           "Stream weights from an NPU-native weight file")
+      .def("set_lora",
+           &ryzenai::py_qlinear_2<int16_t, int8_t, float>::py_set_lora,
+           "Add a bfloat16 low-rank adapter scale * (a * A) * B to the output",
+           nb::arg("lora_a"), nb::arg("lora_b"), nb::arg("scale") = 1.0f)
+      .def("clear_lora",
+           &ryzenai::py_qlinear_2<int16_t, int8_t, float>::py_clear_lora,
+           "Remove the low-rank adapter set with set_lora");
 
   nb::class_<ryzenai::py_qlinear_2<int16_t, int8_t, float, int16_t>>(
       m, "qlinear_2_a16fw4acc32fo16f")
@@ -64,14 +110,36 @@ NB_MODULE(_RyzenAI, m) {
                     const std::string &>())
       .def("execute",
            &ryzenai::py_qlinear_2<int16_t, int8_t, float, int16_t>::py_execute,
-           "Function to execute matmul on aie with cpu tiling")
+           "Function to execute matmul on aie with cpu tiling",
+           nb::arg("a"), nb::arg("c"),
+           nb::call_guard<nb::gil_scoped_release>())
       .def("debug",
            &ryzenai::py_qlinear_2<int16_t, int8_t, float, int16_t>::py_debug,
            "Function to enable debug flag that writes matrices to files")
       .def("initialize_weights",
            &ryzenai::py_qlinear_2<int16_t, int8_t, float,
                                   int16_t>::py_initialize_weights_int4,
-           "Register weights from numpy array");
+           "Register weights from numpy array")
+      .def("save_weights",
+           &ryzenai::py_qlinear_2<int16_t, int8_t, float,
+                                  int16_t>::py_save_weights,
+           "Write the formatted weights to an NPU-native weight file")
+      .def("initialize_weights_from_file",
+           &ryzenai::py_qlinear_2<int16_t, int8_t, float,
+                                  int16_t>::py_initialize_weights_from_file,
+           "Load weights from an NPU-native weight file")
+      .def("initialize_weights_streamed",
+           &ryzenai::py_qlinear_2<int16_t, int8_t, float,
+                                  int16_t>::py_initialize_weights_streamed,
+           "Stream weights from an NPU-native weight file")
+      .def("set_lora",
+           &ryzenai::py_qlinear_2<int16_t, int8_t, float, int16_t>::py_set_lora,
+           "Add a bfloat16 low-rank adapter scale * (a * A) * B to the output",
+           nb::arg("lora_a"), nb::arg("lora_b"), nb::arg("scale") = 1.0f)
+      .def("clear_lora",
+           &ryzenai::py_qlinear_2<int16_t, int8_t, float,
+                                  int16_t>::py_clear_lora,
+           "Remove the low-rank adapter set with set_lora");
 
   nb::class_<ryzenai::py_qlinear_2<int16_t, int8_t, int16_t>>(
       m, "qlinear_2_a16fw4acc16f")
@@ -79,13 +147,33 @@ NB_MODULE(_RyzenAI, m) {
                     const std::string &>())
       .def("execute",
            &ryzenai::py_qlinear_2<int16_t, int8_t, int16_t>::py_execute,
-           "Function to execute matmul on aie with cpu tiling")
+           "Function to execute matmul on aie with cpu tiling",
+           nb::arg("a"), nb::arg("c"),
+           nb::call_guard<nb::gil_scoped_release>())
       .def("debug", &ryzenai::py_qlinear_2<int16_t, int8_t, int16_t>::py_debug,
            "Function to enable debug flag that writes matrices to files")
       .def("initialize_weights",
            &ryzenai::py_qlinear_2<int16_t, int8_t,
                                   int16_t>::py_initialize_weights_int4_mladf,
-           "Register weights from numpy array");
+           "Register weights from numpy array")
+      .def("save_weights",
+           &ryzenai::py_qlinear_2<int16_t, int8_t, int16_t>::py_save_weights,
+           "Write the formatted weights to an NPU-native weight file")
+      .def("initialize_weights_from_file",
+           &ryzenai::py_qlinear_2<int16_t, int8_t,
+                                  int16_t>::py_initialize_weights_from_file,
+           "Load weights from an NPU-native weight file")
+      .def("initialize_weights_streamed",
+           &ryzenai::py_qlinear_2<int16_t, int8_t,
+                                  int16_t>::py_initialize_weights_streamed,
+           "Stream weights from an NPU-native weight file")
+      .def("set_lora",
+           &ryzenai::py_qlinear_2<int16_t, int8_t, int16_t>::py_set_lora,
+           "Add a bfloat16 low-rank adapter scale * (a * A) * B to the output",
+           nb::arg("lora_a"), nb::arg("lora_b"), nb::arg("scale") = 1.0f)
+      .def("clear_lora",
+           &ryzenai::py_qlinear_2<int16_t, int8_t, int16_t>::py_clear_lora,
+           "Remove the low-rank adapter set with set_lora");
 
   nb::class_<ryzenai::stats::MemInfo>(m, "MemInfo")
       .def_rw("commit_memory", &ryzenai::stats::MemInfo::commit_memory);
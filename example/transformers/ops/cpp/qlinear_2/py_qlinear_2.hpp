@@ -9,6 +9,7 @@
 #include <nanobind/nanobind.h>
 #include <nanobind/ndarray.h>
 #include <optional>
+#include <stdexcept>
 namespace nb = nanobind;
 
 #include "qlinear_2.hpp"
@@ -17,10 +18,16 @@ namespace ryzenai {
 template <typename InT, typename WtT, typename AccT, typename OutT = AccT>
 class py_qlinear_2 : private qlinear_2<InT, WtT, AccT, OutT> {
 public:
+  // 2D C-contiguous host arrays, the data pointers are passed to execute
+  // as is, and c is written in place
+  using a_array_t =
+      nb::ndarray<InT, nb::ndim<2>, nb::c_contig, nb::device::cpu>;
+  using c_array_t =
+      nb::ndarray<OutT, nb::ndim<2>, nb::c_contig, nb::device::cpu>;
+
   py_qlinear_2(const std::string &a_dtype, const std::string &b_dtype,
                const std::string &c_dtype);
-  void py_execute(nb::ndarray<InT, nb::c_contig> &a,
-                  nb::ndarray<OutT, nb::c_contig> &c);
+  void py_execute(a_array_t &a, c_array_t &c);
   void py_initialize_weights(nb::ndarray<WtT, nb::c_contig> &wts,
                              std::optional<int> group_size);
   void py_qlinear_2<InT, WtT, AccT, OutT>::py_initialize_weights_int4(
@@ -34,6 +41,13 @@ public:
       nb::ndarray<float, nb::c_contig> &scales,
       nb::ndarray<float, nb::c_contig> &bias, int group_size);
   void py_qlinear_2<InT, WtT, AccT, OutT>::py_debug(bool enable);
+  void py_save_weights(const std::string &fname);
+  void py_initialize_weights_from_file(const std::string &fname);
+  void py_initialize_weights_streamed(const std::string &fname);
+  // bfloat16 A (K x rank) and B (rank x N) of the adapter added to the
+  // output, see set_lora
+  void py_set_lora(a_array_t &lora_a, a_array_t &lora_b, float scale);
+  void py_clear_lora();
 };
 
 template <typename InT, typename WtT, typename AccT, typename OutT>
@@ -92,8 +106,53 @@ void py_qlinear_2<InT, WtT, AccT, OutT>::py_debug(bool enable) {
 }
 
 template <typename InT, typename WtT, typename AccT, typename OutT>
-void py_qlinear_2<InT, WtT, AccT, OutT>::py_execute(
-    nb::ndarray<InT, nb::c_contig> &a, nb::ndarray<OutT, nb::c_contig> &c) {
+void py_qlinear_2<InT, WtT, AccT, OutT>::py_save_weights(
+    const std::string &fname) {
+  save_weights(fname);
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void py_qlinear_2<InT, WtT, AccT, OutT>::py_initialize_weights_from_file(
+    const std::string &fname) {
+  initialize_weights_from_file(fname);
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void py_qlinear_2<InT, WtT, AccT, OutT>::py_initialize_weights_streamed(
+    const std::string &fname) {
+  initialize_weights_streamed(fname);
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void py_qlinear_2<InT, WtT, AccT, OutT>::py_set_lora(a_array_t &lora_a,
+                                                     a_array_t &lora_b,
+                                                     float scale) {
+  static_assert(sizeof(InT) == sizeof(uint16_t),
+                "LoRA adapters are in bfloat16");
+  if (lora_a.shape(1) != lora_b.shape(0)) {
+    throw std::runtime_error("qlinear_2 set_lora : A has rank " +
+                             std::to_string(lora_a.shape(1)) + ", B has " +
+                             std::to_string(lora_b.shape(0)));
+  }
+  set_lora(std::make_shared<lora_adapter>(
+      reinterpret_cast<const uint16_t *>(lora_a.data()),
+      reinterpret_cast<const uint16_t *>(lora_b.data()), lora_a.shape(0),
+      lora_b.shape(1), lora_a.shape(1), scale));
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void py_qlinear_2<InT, WtT, AccT, OutT>::py_clear_lora() {
+  set_lora(nullptr);
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void py_qlinear_2<InT, WtT, AccT, OutT>::py_execute(a_array_t &a,
+                                                    c_array_t &c) {
+  if (c.shape(0) != a.shape(0)) {
+    throw std::runtime_error("qlinear_2 execute : output has " +
+                             std::to_string(c.shape(0)) + " rows, expected " +
+                             std::to_string(a.shape(0)));
+  }
   std::tuple<int, int> a_shape = {a.shape(0), a.shape(1)};
   auto a_ptr = static_cast<InT *>(a.data());
   auto c_ptr = static_cast<OutT *>(c.data());
@@ -5,9 +5,13 @@
 #ifndef __QLINEAR_2_H__
 #define __QLINEAR_2_H__
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <limits>
+#include <memory>
 #include <tuple>
 #include <utility>
 
@@ -40,7 +44,12 @@
 #include "wgt_matrix.h"
 
 #include "logging.h"
+#include "npu_weight_file.h"
+#include "scratch_arena.h"
+#include "threadpool.h"
+#include "tuning_db.h"
 #include "utils.h"
+#include "weight_stream.h"
 
 #include <type_traits>
 
@@ -56,6 +65,34 @@ struct matrix_shapes {
       : M(M), K(K), N(N), Gs(Gs) {}
 };
 
+/*
+ * low-rank adapter (LoRA) of a qlinear_2 : c += scale * (a * A) * B with A of
+ * K x rank and B of rank x N in bfloat16. The adapter is kept apart from the
+ * formatted weights, switching adapters doesn't repack or upload weights, and
+ * one adapter can be shared by several objects.
+ */
+struct lora_adapter {
+  lora_adapter(const uint16_t *a, const uint16_t *b, int64_t k, int64_t n,
+               int64_t rank, float scale)
+      : k(k), n(n), rank(rank), a(k * rank), b(rank * n) {
+    if (k <= 0 || n <= 0 || rank <= 0) {
+      throw std::runtime_error("lora_adapter : invalid shape");
+    }
+    std::transform(a, a + k * rank, this->a.begin(), bfloat16_to_float);
+    // scale is folded into B
+    std::transform(b, b + rank * n, this->b.begin(), [scale](uint16_t x) {
+      return scale * bfloat16_to_float(x);
+    });
+  }
+  int64_t k;
+  int64_t n;
+  int64_t rank;
+  /* K x rank */
+  std::vector<float> a;
+  /* rank x N, scaled */
+  std::vector<float> b;
+};
+
 /*
  * qlinear_2 is an experimental class to offload int8_t * int8_t matrix
  * multiplications to AIE. this class uses lite runtime stack to interface
@@ -77,6 +114,8 @@ private:
   static const std::map<std::string, std::vector<matrix_shapes>>
       default_shapes_;
   static const bool use_avx;
+  /* elements per task of the CPU loops run on the thread pool */
+  static constexpr int64_t CPU_TASK_ELEMENTS = 64 * 1024;
 
   /* M x K dimension of base matmul being offloaded to AIE */
   int64_t kernel_x_shape_[2];
@@ -110,8 +149,18 @@ private:
   xrt::bo a_bo_token_;
   /* XRT BO for tiled output matrix */
   xrt::bo c_bo_token_;
+  /* second set of activation/output BOs, consecutive tiles alternate b/w the
+   * two sets so that a tile is prepared while the previous one runs */
+  xrt::bo a_bo_pp_;
+  xrt::bo c_bo_pp_;
+  xrt::bo a_bo_token_pp_;
+  xrt::bo c_bo_token_pp_;
   /* vector of XRT BOs for tiled and reformtted weight matrix */
   std::vector<xrt::bo> weights_bo_;
+  /* weight_stream layer of streamed weights, weights_bo_ is empty then */
+  weight_stream::layer_handle weight_stream_layer_;
+  /* adapter run alongside the AIE runs, see set_lora */
+  std::shared_ptr<const lora_adapter> lora_;
   /* size for activation dtype */
   int a_dtype_size_;
 
@@ -129,6 +178,7 @@ private:
   int64_t c_sync_time_;
   int64_t run_aie_time_;
   int64_t cpu_acc_time_;
+  int64_t lora_time_ = 0;
   int64_t num_run_aie_;
   uint64_t num_execute_ = 0;
   static std::once_flag logger_flag_;
@@ -145,9 +195,16 @@ private:
   int is_mladf_enabled_ = 0;
   enum MLADF_E { NOT_MLADF = 0, M4x4 = 1, M2x4x4 = 2 };
   std::map<std::string, MLADF_E> mladf_map{{"4x4", M4x4}, {"2x4x4", M2x4x4}};
-
-  /* Temporary CPU buffer to hold accumulation */
-  std::vector<AccT> c_acc_vec_;
+  /* layout of weights_bo_, depends on the initialize_weights* used */
+  enum WEIGHT_FORMAT_E { WFMT_INT8 = 0, WFMT_INT4 = 1, WFMT_INT4_MLADF = 2 };
+  WEIGHT_FORMAT_E weight_format_ = WFMT_INT8;
+  /* group_size passed to initialize_weights* */
+  int w_group_size_ = 0;
+  /* kernel K x N the weights are formatted for while autotuning */
+  bool tuning_ = false;
+  std::pair<int64_t, int64_t> tuning_kn_;
+  /* executes timed per kernel shape and m while autotuning */
+  static constexpr int TUNING_RUNS = 3;
 
   /*
    * run matrix multiplication on AIE
@@ -164,6 +221,32 @@ private:
    */
   void run_aie(InT *a, xrt::bo &w_bo, int64_t *input_shape);
 
+  /*
+   * copy an activation tile to its BO; only the padding of the region read
+   * by the kernel is zeroed, instead of the whole BO. float tiles are
+   * converted to bfloat16 on the way.
+   */
+  template <typename T, typename SrcT>
+  void copy_padded_tile(T *a_map, const SrcT *a, int64_t *input_shape);
+
+  /* AIE run of one tile in flight */
+  struct aie_run_t {
+    xrt::run run;
+    xrt::bo c_bo;
+    int64_t rows = 0;
+  };
+
+  /*
+   * split run_aie : copy and sync the activation tile to the BO set selected
+   * by slot (0 or 1) and start the kernel without waiting for it
+   */
+  template <typename SrcT>
+  aie_run_t run_aie_submit(const SrcT *a, xrt::bo &w_bo, int64_t *input_shape,
+                           int slot);
+
+  /* wait for a run started by run_aie_submit and sync its output to host */
+  void run_aie_wait(aie_run_t &aie_run);
+
   /* Utility function to set the kernel shape based on the weights dimensions
    * Pick kernel shape using weight matrix size
    * Select OPT shapes when a_type is int8
@@ -171,17 +254,53 @@ private:
    * Need to fix this to pick shapes independent of the datatype*/
   void set_kernel_shapes_kn();
 
+  /* rows x rank product of the activation and lora_->a, see set_lora */
+  template <typename SrcT>
+  void lora_down(const SrcT *a, int64_t rows, float *lora_t);
+
+  /* add the product of lora_t and lora_->b to a tile of the output */
+  void lora_up(const float *lora_t, AccT *c, int64_t rows, int64_t cb,
+               int64_t cols);
+
+  /* execute for InT or float activations, see execute */
+  template <typename SrcT>
+  void execute_tiles(const SrcT *a, const std::tuple<int, int> &a_shape,
+                     OutT *c);
+
   // Specialization of set_kernel_shapes_kn for MLADF.
   void set_kernel_shapes_kn_mladf();
 
+  void set_kernel_shape_kn(int64_t k, int64_t n);
+
+  /* kernel K x N the weights can be formatted for, see tuning_db */
+  std::vector<std::pair<int64_t, int64_t>>
+  get_kernel_shapes_kn(WEIGHT_FORMAT_E format, int group_size) const;
+
+  std::string get_tuning_key(WEIGHT_FORMAT_E format, int group_size) const;
+
+  /* use the kernel K x N of the tuning database, false if not tuned */
+  bool set_tuned_kernel_shapes_kn(WEIGHT_FORMAT_E format, int group_size);
+
+  /*
+   * override the kernel K x N set_kernel_shapes_kn* selected with the tuned
+   * one. With autotuning, an untuned shape first has the weights formatted
+   * with init and timed for each kernel K x N, the fastest being recorded.
+   */
+  template <typename InitFn>
+  void tune_kernel_shapes_kn(WEIGHT_FORMAT_E format, int group_size,
+                             InitFn init);
+
   /* Utility function to set the m dimension of the kernel based on the
    * activations.
    * Select OPT shapes when a_type is int8
    * Select Llamav2 shapes when a_type is int16*/
   void set_kernel_shapes_m(int64_t input_m);
 
-  // Specialization of set_kernel_shapes_m and for MLADF.
-  void set_kernel_shapes_m_mladf(int64_t input_m);
+  // m dimension of the kernel set_kernel_shapes_m selects for input_m rows
+  int64_t get_kernel_rows(int64_t input_m) const;
+
+  // Specialization of get_kernel_rows for MLADF.
+  int64_t get_kernel_rows_mladf(int64_t input_m) const;
 
   /*
    * Utility function that setups the instruction registry with transaction
@@ -189,6 +308,19 @@ private:
    */
   void setup_instr_registry();
 
+  /*
+   * Utility function that creates the activation and output BOs for the
+   * kernel shapes and weight_format_ selected by initialize_weights*.
+   */
+  void create_io_bos();
+
+  /*
+   * Utility function that checks the header of an NPU-native weight file and
+   * sets the shapes and BOs of this instantiation from it, for the
+   * initialize_weights_* methods reading weight files.
+   */
+  void init_from_weight_file(const npu_weight_file &file);
+
   std::string get_instr_key(std::string prefix, int m, int k, int n,
                             int grp_size);
 
@@ -268,6 +400,47 @@ public:
                                      const std::tuple<int, int> &w_shape,
                                      int group_size = 32);
 
+  /*
+   * write the formatted weight BOs to an NPU-native weight file
+   *
+   * the file holds the tiles exactly as they are laid out in the BOs, with a
+   * header describing the shapes and format. It has to be called after one
+   * of the initialize_weights* methods.
+   *
+   * @param fname path of the weight file
+   *
+   * @return none
+   */
+  void save_weights(const std::string &fname);
+
+  /*
+   * load weights from an NPU-native weight file written by save_weights
+   *
+   * the file is memory mapped and each tile is copied into its BO as is, no
+   * formatting is done on the host. Throws if the file was written for
+   * another kernel shape or design.
+   *
+   * @param fname path of the weight file
+   *
+   * @return none
+   */
+  void initialize_weights_from_file(const std::string &fname);
+
+  /*
+   * stream weights from an NPU-native weight file written by save_weights
+   *
+   * the tiles stay in the memory mapped file, they are uploaded to BOs of the
+   * weight_stream before each execute, the next layers being prefetched while
+   * this one runs. For models whose weights don't all fit in BOs, at the
+   * cost of an upload per execute. Ops streaming their weights have to be
+   * executed one at a time.
+   *
+   * @param fname path of the weight file
+   *
+   * @return none
+   */
+  void initialize_weights_streamed(const std::string &fname);
+
   /*
    * execute matrix multiplication c = a * w
    *
@@ -283,6 +456,60 @@ public:
    */
   void execute(InT *a, const std::tuple<int, int> &a_shape, OutT *c);
 
+  /*
+   * execute for float activations with a bfloat16 kernel : each tile is
+   * converted while it is copied to the input BO, so the caller needs no
+   * bfloat16 copy of the whole activation
+   */
+  void execute(const float *a, const std::tuple<int, int> &a_shape, OutT *c);
+
+  /*
+   * set the low-rank adapter added to the output of the next executes
+   *
+   * a * A is computed on the CPU while the first AIE run is in flight, its
+   * product with B is then added to each output tile as the tile is copied
+   * from its BO, before the conversion to OutT. Requires bfloat16
+   * activations and a float or bfloat16 accumulation.
+   *
+   * @param adapter adapter of K x N, nullptr to run the base weights only
+   *
+   * @return none
+   */
+  void set_lora(std::shared_ptr<const lora_adapter> adapter);
+
+  /*
+   * number of rows the AIE runs of an execute on input_m rows compute,
+   * input_m included. The kernels of each tile pad it to their m dimension.
+   * It has to be called after one of the initialize_weights* methods.
+   *
+   * @param input_m rows of the activation matrix
+   *
+   * @return padded rows
+   */
+  int64_t get_padded_rows(int64_t input_m) const;
+
+  /*
+   * host timers of the last execute, in ns
+   *
+   * run_aie spans the submit to the wait of the AIE runs, a_copy includes
+   * the float to bfloat16 conversion of the activation tiles, lora the CPU
+   * time of the adapter.
+   */
+  struct exec_times_t {
+    int64_t run_aie;
+    int64_t a_copy;
+    int64_t a_sync;
+    int64_t c_copy;
+    int64_t c_sync;
+    int64_t cpu_acc;
+    int64_t num_run_aie;
+    int64_t lora;
+  };
+  exec_times_t get_exec_times() const {
+    return {run_aie_time_, a_copy_time_,  a_sync_time_, c_copy_time_,
+            c_sync_time_,  cpu_acc_time_, num_run_aie_, lora_time_};
+  }
+
   /*
    * method to set debug flag
    *
@@ -821,6 +1048,134 @@ void qlinear_2<InT, WtT, AccT, OutT>::set_kernel_shapes_kn_mladf() {
   }
 }
 
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void qlinear_2<InT, WtT, AccT, OutT>::set_kernel_shape_kn(int64_t k,
+                                                          int64_t n) {
+  kernel_x_shape_[1] = k;
+  kernel_y_shape_[0] = k;
+  kernel_y_shape_[1] = n;
+  kernel_z_shape_[1] = n;
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+std::vector<std::pair<int64_t, int64_t>>
+qlinear_2<InT, WtT, AccT, OutT>::get_kernel_shapes_kn(WEIGHT_FORMAT_E format,
+                                                      int group_size) const {
+  // group size of the instructions, see run_aie
+  const int64_t gs =
+      (format == WFMT_INT8) ? 0 : ((group_size >= 128) ? 128 : 32);
+  const int64_t m_min = get_kernel_rows(1);
+  const int64_t m_max = get_kernel_rows(KERNEL_M_MAX);
+  std::map<std::pair<int64_t, int64_t>, int> num_rows;
+  for (const auto &mat : default_shapes_.at(txn_fname_prefix_)) {
+    // MLADF kernels don't accumulate over K on the host
+    if (mat.Gs != gs || (is_mladf_enabled_ && mat.K < w_shape_[0])) {
+      continue;
+    }
+    if (mat.M == m_min || mat.M == m_max) {
+      num_rows[{mat.K, mat.N}] += (m_min == m_max) ? 2 : 1;
+    }
+  }
+  std::vector<std::pair<int64_t, int64_t>> shapes;
+  for (const auto &[kn, count] : num_rows) {
+    if (count >= 2) {
+      shapes.push_back(kn);
+    }
+  }
+  return shapes;
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+std::string
+qlinear_2<InT, WtT, AccT, OutT>::get_tuning_key(WEIGHT_FORMAT_E format,
+                                                int group_size) const {
+  return "qlinear_2_" + txn_fname_prefix_ + "_" + std::to_string(format) +
+         "_" + std::to_string(w_shape_[0]) + "_" +
+         std::to_string(w_shape_[1]) + "_" + std::to_string(group_size);
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+bool qlinear_2<InT, WtT, AccT, OutT>::set_tuned_kernel_shapes_kn(
+    WEIGHT_FORMAT_E format, int group_size) {
+  std::string value;
+  if (!tuning_db::get_instance().lookup(get_tuning_key(format, group_size),
+                                        value)) {
+    return false;
+  }
+  std::pair<int64_t, int64_t> kn;
+  std::istringstream iss(value);
+  const auto shapes = get_kernel_shapes_kn(format, group_size);
+  if (!(iss >> kn.first >> kn.second) ||
+      std::find(shapes.begin(), shapes.end(), kn) == shapes.end()) {
+    // recorded for other instructions, keep the default
+    return false;
+  }
+  set_kernel_shape_kn(kn.first, kn.second);
+  return true;
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+template <typename InitFn>
+void qlinear_2<InT, WtT, AccT, OutT>::tune_kernel_shapes_kn(
+    WEIGHT_FORMAT_E format, int group_size, InitFn init) {
+  if (tuning_) {
+    set_kernel_shape_kn(tuning_kn_.first, tuning_kn_.second);
+    return;
+  }
+  if (set_tuned_kernel_shapes_kn(format, group_size) ||
+      !tuning_db::autotune()) {
+    return;
+  }
+  const auto shapes = get_kernel_shapes_kn(format, group_size);
+  std::pair<int64_t, int64_t> best = {kernel_y_shape_[0], kernel_y_shape_[1]};
+  if (shapes.size() < 2) {
+    return;
+  }
+
+  // token & largest m kernels, on zero activations
+  const int64_t m_max = KERNEL_M_MAX;
+  std::vector<InT> a(m_max * w_shape_[0], 0);
+  std::vector<OutT> c(m_max * w_shape_[1]);
+  int64_t best_ns = std::numeric_limits<int64_t>::max();
+  tuning_ = true;
+  for (const auto &kn : shapes) {
+    tuning_kn_ = kn;
+    int64_t ns = 0;
+    try {
+      weights_bo_.clear();
+      init();
+      for (int64_t rows : {int64_t{1}, m_max}) {
+        int64_t best_run = std::numeric_limits<int64_t>::max();
+        for (int i = 0; i < TUNING_RUNS; ++i) {
+          int64_t start = GET_ELAPSED_TIME_NS();
+          execute(a.data(), {(int)rows, (int)w_shape_[0]}, c.data());
+          best_run = std::min(best_run, GET_ELAPSED_TIME_NS() - start);
+        }
+        ns += best_run;
+      }
+    } catch (const std::exception &e) {
+      RYZENAI_LOG_TRACE("qlinear_2 : skipping kernel " +
+                        std::to_string(kn.first) + "x" +
+                        std::to_string(kn.second) + " : " + e.what());
+      continue;
+    }
+    if (ns < best_ns) {
+      best_ns = ns;
+      best = kn;
+    }
+  }
+  tuning_ = false;
+  weights_bo_.clear();
+
+  if (best_ns != std::numeric_limits<int64_t>::max()) {
+    tuning_db::get_instance().record(
+        get_tuning_key(format, group_size),
+        std::to_string(best.first) + " " + std::to_string(best.second) + " " +
+            std::to_string(best_ns / 1000));
+  }
+  set_kernel_shape_kn(best.first, best.second);
+}
+
 template <typename InT, typename WtT, typename AccT, typename OutT>
 void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights_int4(
     int8_t *weights, int8_t *zeros, float *scales, float *bias,
@@ -829,31 +1184,18 @@ void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights_int4(
   w_shape_[1] = std::get<1>(w_shape);
 
   set_kernel_shapes_kn();
+  tune_kernel_shapes_kn(WFMT_INT4, group_size, [&]() {
+    initialize_weights_int4(weights, zeros, scales, bias, w_shape, group_size);
+  });
   // Use largest M dimension as the default. This has to correspond
   // to one of the available kernel sizes.
   //    NOTE: smaller M's can be selected in run_aie if needed
   kernel_x_shape_[0] = KERNEL_M_MAX;
   kernel_z_shape_[0] = KERNEL_M_MAX;
 
-  /* Create input/output BOs */
-  const int A_BO_SIZE =
-      (kernel_x_shape_[0] * kernel_x_shape_[1] * a_dtype_size_) + params_bytes;
-  const int C_BO_SIZE =
-      (kernel_z_shape_[0] * kernel_z_shape_[1] * sizeof(AccT));
-  a_bo_ = xrt::bo(xrt_ctx_->get_context(), A_BO_SIZE, xrt::bo::flags::host_only,
-                  xrt_ctx_->get_kernel().group_id(8));
-  c_bo_ = xrt::bo(xrt_ctx_->get_context(), C_BO_SIZE, xrt::bo::flags::host_only,
-                  xrt_ctx_->get_kernel().group_id(8));
-
-  const int A_BO_SIZE_TOKEN =
-      (1 * kernel_x_shape_[1] * a_dtype_size_) + params_bytes;
-  const int C_BO_SIZE_TOKEN = 1 * kernel_z_shape_[1] * sizeof(AccT);
-  a_bo_token_ =
-      xrt::bo(xrt_ctx_->get_context(), A_BO_SIZE_TOKEN,
-              xrt::bo::flags::host_only, xrt_ctx_->get_kernel().group_id(8));
-  c_bo_token_ =
-      xrt::bo(xrt_ctx_->get_context(), C_BO_SIZE_TOKEN,
-              xrt::bo::flags::host_only, xrt_ctx_->get_kernel().group_id(8));
+  weight_format_ = WFMT_INT4;
+  w_group_size_ = group_size;
+  create_io_bos();
 
   /* Create weight BOs */
   // Create a BO for weight block and initialize to zero
@@ -871,11 +1213,33 @@ void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights_int4(
 
   w_padded_shape_[0] = Utils::ceil_for_me(w_shape_[0], kernel_y_shape_[0]);
   w_padded_shape_[1] = Utils::ceil_for_me(w_shape_[1], kernel_y_shape_[1]);
-  QuantMatrix<8, 32, 128, 32> buff_B1(kernel_y_shape_[0], kernel_y_shape_[1]);
-  QuantMatrix<8, 128, 128, 128> buff_B2(kernel_y_shape_[0], kernel_y_shape_[1]);
-  // iterate over kernel shaped blocks of the weight matrix
-  for (int64_t rb = 0; rb < w_padded_shape_[0]; rb += kernel_y_shape_[0]) {
-    for (int64_t cb = 0; cb < w_padded_shape_[1]; cb += kernel_y_shape_[1]) {
+  // Select the supported group_size
+  if (group_size >= 128) {
+    assert(group_size % 128 == 0, "group_size should be div by 32 or 128");
+    grp_size_ = 128;
+  } else if (group_size >= 32) {
+    assert(group_size % 32 == 0, "group_size should be div by 32 or 128");
+    grp_size_ = 32;
+  }
+  // kernel shaped blocks of the weight matrix are formatted in parallel,
+  // weights_bo_ keeps them in row major block order
+  const int64_t tile_pitch = w_padded_shape_[1] / kernel_y_shape_[1];
+  const int64_t num_tiles =
+      (w_padded_shape_[0] / kernel_y_shape_[0]) * tile_pitch;
+  const size_t tile_base = weights_bo_.size();
+  weights_bo_.resize(tile_base + num_tiles);
+  std::atomic<int64_t> b_format_time = 0;
+  std::atomic<int64_t> b_sync_time = 0;
+  auto &pool = ThreadPoolSingleton::getInstance().pool;
+  pool.parallel_for(0, num_tiles, 1, [&](int64_t tile_lo, int64_t tile_hi) {
+    for (int64_t tile = tile_lo; tile < tile_hi; ++tile) {
+      const int64_t rb = (tile / tile_pitch) * kernel_y_shape_[0];
+      const int64_t cb = (tile % tile_pitch) * kernel_y_shape_[1];
+      // views into the BO of this block
+      QuantMatrix<8, 32, 128, 32> buff_B1(kernel_y_shape_[0],
+                                          kernel_y_shape_[1]);
+      QuantMatrix<8, 128, 128, 128> buff_B2(kernel_y_shape_[0],
+                                            kernel_y_shape_[1]);
       xrt::bo bo_;
       auto b_format_start = GET_ELAPSED_TIME_NS();
 
@@ -897,31 +1261,13 @@ void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights_int4(
               : buff_B2.bias(c) = ryzenai::float_to_bfloat16(bias[cb + c]);
         }
       }
-      // format quantized weights (int4/uint4)
+      // format quantized weights (int4/uint4), a row of a subvolume is
+      // contiguous in the BO
+      const int num_cols = std::min(kernel_y_shape_[1], w_shape_[1] - cb);
       for (int r = 0; r < kernel_y_shape_[0] && rb + r < w_shape_[0]; ++r) {
-        for (int c = 0; c < kernel_y_shape_[1] && cb + c < w_shape_[1];
-             c += 2) {
-          // NOTE: int8_t weights will be sign extended to int
-          int x = weights[((rb + r) * w_shape_[1]) + (cb + c)];
-          int y = weights[((rb + r) * w_shape_[1]) + (cb + c) + 1];
-          if (b_dtype_ == "int4") {
-            (group_size < 128)
-                ? buff_B1.quant(r, c) = ryzenai::pack_v2int4(x, y)
-                : buff_B2.quant(r, c) = ryzenai::pack_v2int4(x, y);
-          } else {
-            (group_size < 128)
-                ? buff_B1.quant(r, c) = ryzenai::pack_v2uint4(x, y)
-                : buff_B2.quant(r, c) = ryzenai::pack_v2uint4(x, y);
-          }
-        }
-      }
-      // Select the supported group_size
-      if (group_size >= 128) {
-        assert(group_size % 128 == 0, "group_size should be div by 32 or 128");
-        grp_size_ = 128;
-      } else if (group_size >= 32) {
-        assert(group_size % 32 == 0, "group_size should be div by 32 or 128");
-        grp_size_ = 32;
+        const int8_t *row = &weights[((rb + r) * w_shape_[1]) + cb];
+        (group_size < 128) ? buff_B1.pack_quant_row(r, 0, row, num_cols)
+                           : buff_B2.pack_quant_row(r, 0, row, num_cols);
       }
 
       int repeat_count = group_size / grp_size_;
@@ -962,16 +1308,18 @@ void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights_int4(
         }
       }
       auto b_format_stop = GET_ELAPSED_TIME_NS();
-      b_format_time_ += b_format_stop - b_format_start;
+      b_format_time += b_format_stop - b_format_start;
 
       auto b_sync_start = GET_ELAPSED_TIME_NS();
       bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
       auto b_sync_stop = GET_ELAPSED_TIME_NS();
-      b_sync_time_ = b_sync_stop - b_sync_start;
+      b_sync_time += b_sync_stop - b_sync_start;
 
-      weights_bo_.push_back(bo_);
+      weights_bo_[tile_base + tile] = bo_;
     }
-  }
+  });
+  b_format_time_ += b_format_time;
+  b_sync_time_ = b_sync_time;
 }
 
 template <typename InT, typename WtT, typename AccT, typename OutT>
@@ -983,36 +1331,19 @@ void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights_int4_mladf(
   w_shape_[0] = std::get<0>(w_shape);
   w_shape_[1] = std::get<1>(w_shape);
   set_kernel_shapes_kn_mladf();
+  tune_kernel_shapes_kn(WFMT_INT4_MLADF, group_size, [&]() {
+    initialize_weights_int4_mladf(weights, zeros, scales, bias, w_shape,
+                                  group_size);
+  });
   // Use largest M dimension as the default. This has to correspond
   // to one of the available kernel sizes.
   //    NOTE: smaller M's can be selected in run_aie if needed
   kernel_x_shape_[0] = KERNEL_M_MAX;
   kernel_z_shape_[0] = KERNEL_M_MAX;
 
-  /* Create input/output BOs */
-  const int A_BO_SIZE =
-      (kernel_x_shape_[0] * kernel_x_shape_[1] * a_dtype_size_);
-  // Reserve double the size of C for the intermediate result computed in case
-  // of K=11k and 2x4x4 overlay.
-  const int C_BO_SIZE =
-      (kernel_x_shape_[1] != 11008)
-          ? (kernel_z_shape_[0] * kernel_z_shape_[1] * sizeof(OutT))
-          : (kernel_z_shape_[0] * kernel_z_shape_[1] * sizeof(OutT) * 2);
-  a_bo_ = xrt::bo(xrt_ctx_->get_context(), A_BO_SIZE, xrt::bo::flags::host_only,
-                  xrt_ctx_->get_kernel().group_id(group_id));
-  c_bo_ = xrt::bo(xrt_ctx_->get_context(), C_BO_SIZE, xrt::bo::flags::host_only,
-                  xrt_ctx_->get_kernel().group_id(group_id));
-
-  const int A_BO_SIZE_TOKEN = (1 * kernel_x_shape_[1] * a_dtype_size_);
-  const int C_BO_SIZE_TOKEN = (kernel_x_shape_[1] != 11008)
-                                  ? 1 * kernel_z_shape_[1] * sizeof(OutT)
-                                  : 1 * kernel_z_shape_[1] * sizeof(OutT) * 2;
-  a_bo_token_ = xrt::bo(xrt_ctx_->get_context(), A_BO_SIZE_TOKEN,
-                        xrt::bo::flags::host_only,
-                        xrt_ctx_->get_kernel().group_id(group_id));
-  c_bo_token_ = xrt::bo(xrt_ctx_->get_context(), C_BO_SIZE_TOKEN,
-                        xrt::bo::flags::host_only,
-                        xrt_ctx_->get_kernel().group_id(group_id));
+  weight_format_ = WFMT_INT4_MLADF;
+  w_group_size_ = group_size;
+  create_io_bos();
 
   /* Create weight BOs */
   // Create a BO for weight block and initialize to zero
@@ -1033,13 +1364,33 @@ void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights_int4_mladf(
   // The bfp16 kernel uses a block size of 4 for any gemm shape.
   int blk_size = 4;
   // The used L1 subvolume sizes are identical for the 2x4x4 and 1x4x4 overlay.
-  mladfQuantMatrix<64, 32, 32, 32> buff_B1(kernel_y_shape_[0],
-                                           kernel_y_shape_[1], blk_size);
-  mladfQuantMatrix<64, 128, 32, 128> buff_B2(kernel_y_shape_[0],
-                                             kernel_y_shape_[1], blk_size);
-  // iterate over kernel shaped blocks of the weight matrix
-  for (int64_t rb = 0; rb < w_padded_shape_[0]; rb += kernel_y_shape_[0]) {
-    for (int64_t cb = 0; cb < w_padded_shape_[1]; cb += kernel_y_shape_[1]) {
+  // Select the supported group_size
+  if (group_size >= 128) {
+    assert(group_size % 128 == 0, "group_size should be div by 32 or 128");
+    grp_size_ = 128;
+  } else if (group_size >= 32) {
+    assert(group_size % 32 == 0, "group_size should be div by 32 or 128");
+    grp_size_ = 32;
+  }
+  // kernel shaped blocks of the weight matrix are formatted in parallel,
+  // weights_bo_ keeps them in row major block order
+  const int64_t tile_pitch = w_padded_shape_[1] / kernel_y_shape_[1];
+  const int64_t num_tiles =
+      (w_padded_shape_[0] / kernel_y_shape_[0]) * tile_pitch;
+  const size_t tile_base = weights_bo_.size();
+  weights_bo_.resize(tile_base + num_tiles);
+  std::atomic<int64_t> b_format_time = 0;
+  std::atomic<int64_t> b_sync_time = 0;
+  auto &pool = ThreadPoolSingleton::getInstance().pool;
+  pool.parallel_for(0, num_tiles, 1, [&](int64_t tile_lo, int64_t tile_hi) {
+    for (int64_t tile = tile_lo; tile < tile_hi; ++tile) {
+      const int64_t rb = (tile / tile_pitch) * kernel_y_shape_[0];
+      const int64_t cb = (tile % tile_pitch) * kernel_y_shape_[1];
+      // views into the BO of this block
+      mladfQuantMatrix<64, 32, 32, 32> buff_B1(kernel_y_shape_[0],
+                                               kernel_y_shape_[1], blk_size);
+      mladfQuantMatrix<64, 128, 32, 128> buff_B2(kernel_y_shape_[0],
+                                                 kernel_y_shape_[1], blk_size);
       xrt::bo bo_;
       auto b_format_start = GET_ELAPSED_TIME_NS();
 
@@ -1080,15 +1431,6 @@ void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights_int4_mladf(
         }
       }
 
-      // Select the supported group_size
-      if (group_size >= 128) {
-        assert(group_size % 128 == 0, "group_size should be div by 32 or 128");
-        grp_size_ = 128;
-      } else if (group_size >= 32) {
-        assert(group_size % 32 == 0, "group_size should be div by 32 or 128");
-        grp_size_ = 32;
-      }
-
       int repeat_count = group_size / grp_size_;
       // format the scales (bf16)
       for (int r = 0; r < kernel_y_shape_[0] && rb + r < w_shape_[0];
@@ -1128,16 +1470,18 @@ void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights_int4_mladf(
         }
       }
       auto b_format_stop = GET_ELAPSED_TIME_NS();
-      b_format_time_ += b_format_stop - b_format_start;
+      b_format_time += b_format_stop - b_format_start;
 
       auto b_sync_start = GET_ELAPSED_TIME_NS();
       bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
       auto b_sync_stop = GET_ELAPSED_TIME_NS();
-      b_sync_time_ = b_sync_stop - b_sync_start;
+      b_sync_time += b_sync_stop - b_sync_start;
 
-      weights_bo_.push_back(bo_);
+      weights_bo_[tile_base + tile] = bo_;
     }
-  }
+  });
+  b_format_time_ += b_format_time;
+  b_sync_time_ = b_sync_time;
 }
 
 template <typename InT, typename WtT, typename AccT, typename OutT>
@@ -1150,33 +1494,20 @@ void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights(
   w_shape_[1] = std::get<1>(w_shape);
 
   weights_bo_.clear();
+  weight_stream_layer_.reset();
   set_kernel_shapes_kn();
+  tune_kernel_shapes_kn(WFMT_INT8, group_size, [&]() {
+    initialize_weights(weights, w_shape, group_size);
+  });
 
   // Use largest M dimension as the default
   //    NOTE: smaller M's can be selected in run_aie if needed
   kernel_x_shape_[0] = KERNEL_M_MAX;
   kernel_z_shape_[0] = KERNEL_M_MAX;
 
-  /* Create input/output BOs */
-  const int A_BO_SIZE =
-      (kernel_x_shape_[0] * kernel_x_shape_[1] * a_dtype_size_) + params_bytes;
-  const int C_BO_SIZE =
-      (kernel_z_shape_[0] * kernel_z_shape_[1] * sizeof(AccT));
-
-  a_bo_ = xrt::bo(xrt_ctx_->get_context(), A_BO_SIZE, xrt::bo::flags::host_only,
-                  xrt_ctx_->get_kernel().group_id(group_id));
-  c_bo_ = xrt::bo(xrt_ctx_->get_context(), C_BO_SIZE, xrt::bo::flags::host_only,
-                  xrt_ctx_->get_kernel().group_id(group_id));
-
-  const int A_BO_SIZE_TOKEN =
-      (1 * kernel_x_shape_[1] * a_dtype_size_) + params_bytes;
-  const int C_BO_SIZE_TOKEN = 1 * kernel_z_shape_[1] * sizeof(AccT);
-  a_bo_token_ = xrt::bo(xrt_ctx_->get_context(), A_BO_SIZE_TOKEN,
-                        xrt::bo::flags::host_only,
-                        xrt_ctx_->get_kernel().group_id(group_id));
-  c_bo_token_ = xrt::bo(xrt_ctx_->get_context(), C_BO_SIZE_TOKEN,
-                        xrt::bo::flags::host_only,
-                        xrt_ctx_->get_kernel().group_id(group_id));
+  weight_format_ = WFMT_INT8;
+  w_group_size_ = group_size;
+  create_io_bos();
 
   /* Create weight BOs */
 
@@ -1189,9 +1520,20 @@ void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights(
 
   w_padded_shape_[0] = Utils::ceil_for_me(w_shape_[0], kernel_y_shape_[0]);
   w_padded_shape_[1] = Utils::ceil_for_me(w_shape_[1], kernel_y_shape_[1]);
-  // iterate over kernel shaped blocks of the weight matrix
-  for (int64_t rb = 0; rb < w_padded_shape_[0]; rb += kernel_y_shape_[0]) {
-    for (int64_t cb = 0; cb < w_padded_shape_[1]; cb += kernel_y_shape_[1]) {
+  // kernel shaped blocks of the weight matrix are formatted in parallel,
+  // weights_bo_ keeps them in row major block order
+  const int64_t tile_pitch = w_padded_shape_[1] / kernel_y_shape_[1];
+  const int64_t num_tiles =
+      (w_padded_shape_[0] / kernel_y_shape_[0]) * tile_pitch;
+  const size_t tile_base = weights_bo_.size();
+  weights_bo_.resize(tile_base + num_tiles);
+  std::atomic<int64_t> b_format_time = 0;
+  std::atomic<int64_t> b_sync_time = 0;
+  auto &pool = ThreadPoolSingleton::getInstance().pool;
+  pool.parallel_for(0, num_tiles, 1, [&](int64_t tile_lo, int64_t tile_hi) {
+    for (int64_t tile = tile_lo; tile < tile_hi; ++tile) {
+      const int64_t rb = (tile / tile_pitch) * kernel_y_shape_[0];
+      const int64_t cb = (tile % tile_pitch) * kernel_y_shape_[1];
 
       // Create a BO for weight block and initialize to zero
       //    NOTE: We must initialize to zero here because the weight matrix
@@ -1228,62 +1570,283 @@ void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights(
       }
 
       auto b_format_stop = GET_ELAPSED_TIME_NS();
-      b_format_time_ += b_format_stop - b_format_start;
+      b_format_time += b_format_stop - b_format_start;
 
       auto b_sync_start = GET_ELAPSED_TIME_NS();
       bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
       auto b_sync_stop = GET_ELAPSED_TIME_NS();
-      b_sync_time_ = b_sync_stop - b_sync_start;
+      b_sync_time += b_sync_stop - b_sync_start;
 
-      weights_bo_.push_back(bo_);
+      weights_bo_[tile_base + tile] = bo_;
     }
+  });
+  b_format_time_ += b_format_time;
+  b_sync_time_ = b_sync_time;
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void qlinear_2<InT, WtT, AccT, OutT>::create_io_bos() {
+  // Note: for mladf int8 gemm we had to change group id to 0
+  const int group_id =
+      (weight_format_ != WFMT_INT4 && is_mladf_enabled_) ? 0 : 8;
+  const int a_params_bytes =
+      (weight_format_ == WFMT_INT4_MLADF) ? 0 : params_bytes;
+  const int c_dtype_size =
+      (weight_format_ == WFMT_INT4_MLADF) ? sizeof(OutT) : sizeof(AccT);
+  // Reserve double the size of C for the intermediate result computed in case
+  // of K=11k and 2x4x4 overlay.
+  const int c_factor =
+      (weight_format_ == WFMT_INT4_MLADF && kernel_x_shape_[1] == 11008) ? 2
+                                                                         : 1;
+
+  /* Create input/output BOs */
+  const int A_BO_SIZE =
+      (kernel_x_shape_[0] * kernel_x_shape_[1] * a_dtype_size_) +
+      a_params_bytes;
+  const int C_BO_SIZE =
+      kernel_z_shape_[0] * kernel_z_shape_[1] * c_dtype_size * c_factor;
+  a_bo_ = xrt::bo(xrt_ctx_->get_context(), A_BO_SIZE, xrt::bo::flags::host_only,
+                  xrt_ctx_->get_kernel().group_id(group_id));
+  c_bo_ = xrt::bo(xrt_ctx_->get_context(), C_BO_SIZE, xrt::bo::flags::host_only,
+                  xrt_ctx_->get_kernel().group_id(group_id));
+
+  const int A_BO_SIZE_TOKEN =
+      (1 * kernel_x_shape_[1] * a_dtype_size_) + a_params_bytes;
+  const int C_BO_SIZE_TOKEN =
+      1 * kernel_z_shape_[1] * c_dtype_size * c_factor;
+  a_bo_token_ = xrt::bo(xrt_ctx_->get_context(), A_BO_SIZE_TOKEN,
+                        xrt::bo::flags::host_only,
+                        xrt_ctx_->get_kernel().group_id(group_id));
+  c_bo_token_ = xrt::bo(xrt_ctx_->get_context(), C_BO_SIZE_TOKEN,
+                        xrt::bo::flags::host_only,
+                        xrt_ctx_->get_kernel().group_id(group_id));
+
+  a_bo_pp_ =
+      xrt::bo(xrt_ctx_->get_context(), A_BO_SIZE, xrt::bo::flags::host_only,
+              xrt_ctx_->get_kernel().group_id(group_id));
+  c_bo_pp_ =
+      xrt::bo(xrt_ctx_->get_context(), C_BO_SIZE, xrt::bo::flags::host_only,
+              xrt_ctx_->get_kernel().group_id(group_id));
+  a_bo_token_pp_ = xrt::bo(xrt_ctx_->get_context(), A_BO_SIZE_TOKEN,
+                           xrt::bo::flags::host_only,
+                           xrt_ctx_->get_kernel().group_id(group_id));
+  c_bo_token_pp_ = xrt::bo(xrt_ctx_->get_context(), C_BO_SIZE_TOKEN,
+                           xrt::bo::flags::host_only,
+                           xrt_ctx_->get_kernel().group_id(group_id));
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void qlinear_2<InT, WtT, AccT, OutT>::save_weights(const std::string &fname) {
+  if (weights_bo_.empty()) {
+    throw std::runtime_error(
+        "qlinear_2 : save_weights called before initialize_weights");
+  }
+  npu_weight_file_header header = {};
+  header.format = weight_format_;
+  header.design = is_mladf_enabled_;
+  header.group_size = w_group_size_;
+  header.w_shape[0] = w_shape_[0];
+  header.w_shape[1] = w_shape_[1];
+  header.kernel_y_shape[0] = kernel_y_shape_[0];
+  header.kernel_y_shape[1] = kernel_y_shape_[1];
+  header.tile_bytes = weights_bo_.front().size();
+
+  std::vector<const void *> tiles;
+  for (auto &bo : weights_bo_) {
+    tiles.push_back(bo.map<WtT *>());
   }
+  write_npu_weight_file(fname, header, tiles);
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void qlinear_2<InT, WtT, AccT, OutT>::init_from_weight_file(
+    const npu_weight_file &file) {
+  const auto &header = file.header();
+  const auto &fname = file.name();
+
+  weight_format_ = static_cast<WEIGHT_FORMAT_E>(header.format);
+  w_group_size_ = header.group_size;
+  w_shape_[0] = header.w_shape[0];
+  w_shape_[1] = header.w_shape[1];
+  if (header.design != is_mladf_enabled_) {
+    throw std::runtime_error("qlinear_2 : " + fname +
+                             " was written for another design");
+  }
+  (weight_format_ == WFMT_INT4_MLADF) ? set_kernel_shapes_kn_mladf()
+                                      : set_kernel_shapes_kn();
+  // a file formatted before the shape was tuned is formatted again
+  set_tuned_kernel_shapes_kn(weight_format_, w_group_size_);
+  if (header.kernel_y_shape[0] != kernel_y_shape_[0] ||
+      header.kernel_y_shape[1] != kernel_y_shape_[1]) {
+    throw std::runtime_error("qlinear_2 : " + fname +
+                             " was written for another kernel shape");
+  }
+  // same group size selection as initialize_weights*
+  if (weight_format_ == WFMT_INT8) {
+    grp_size_ = w_group_size_;
+  } else {
+    grp_size_ = (w_group_size_ >= 128) ? 128 : 32;
+  }
+
+  // Use largest M dimension as the default. This has to correspond
+  // to one of the available kernel sizes.
+  //    NOTE: smaller M's can be selected in run_aie if needed
+  kernel_x_shape_[0] = KERNEL_M_MAX;
+  kernel_z_shape_[0] = KERNEL_M_MAX;
+  create_io_bos();
+
+  w_padded_shape_[0] = Utils::ceil_for_me(w_shape_[0], kernel_y_shape_[0]);
+  w_padded_shape_[1] = Utils::ceil_for_me(w_shape_[1], kernel_y_shape_[1]);
+  const uint64_t num_tiles = (w_padded_shape_[0] / kernel_y_shape_[0]) *
+                             (w_padded_shape_[1] / kernel_y_shape_[1]);
+  if (header.num_tiles != num_tiles) {
+    throw std::runtime_error("qlinear_2 : " + fname +
+                             " has an unexpected number of tiles");
+  }
+  weights_bo_.clear();
+  weight_stream_layer_.reset();
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights_from_file(
+    const std::string &fname) {
+  npu_weight_file file(fname);
+  init_from_weight_file(file);
+  const auto &header = file.header();
+  const uint64_t num_tiles = header.num_tiles;
+
+  const int group_id =
+      (weight_format_ != WFMT_INT4 && is_mladf_enabled_) ? 0 : 8;
+  for (uint64_t i = 0; i < num_tiles; ++i) {
+    auto b_copy_start = GET_ELAPSED_TIME_NS();
+    xrt::bo bo_ = xrt::bo(xrt_ctx_->get_context(), header.tile_bytes,
+                          xrt::bo::flags::host_only,
+                          xrt_ctx_->get_kernel().group_id(group_id));
+    memcpy(bo_.map<WtT *>(), file.tile(i), header.tile_bytes);
+    auto b_copy_stop = GET_ELAPSED_TIME_NS();
+    b_copy_time_ += b_copy_stop - b_copy_start;
+
+    auto b_sync_start = GET_ELAPSED_TIME_NS();
+    bo_.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    auto b_sync_stop = GET_ELAPSED_TIME_NS();
+    b_sync_time_ = b_sync_stop - b_sync_start;
+
+    weights_bo_.push_back(bo_);
+  }
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void qlinear_2<InT, WtT, AccT, OutT>::initialize_weights_streamed(
+    const std::string &fname) {
+  auto file = std::make_shared<npu_weight_file>(fname);
+  init_from_weight_file(*file);
+
+  const int group_id =
+      (weight_format_ != WFMT_INT4 && is_mladf_enabled_) ? 0 : 8;
+  weight_stream_layer_ = weight_stream::get_instance().add_layer(
+      std::move(file), xrt_ctx_->get_context(),
+      xrt_ctx_->get_kernel().group_id(group_id));
 }
 
 template <typename InT, typename WtT, typename AccT, typename OutT>
 void qlinear_2<InT, WtT, AccT, OutT>::set_kernel_shapes_m(int64_t input_m) {
+  kernel_x_rows = get_kernel_rows(input_m);
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+int64_t
+qlinear_2<InT, WtT, AccT, OutT>::get_kernel_rows(int64_t input_m) const {
   // NOTE: kernel_x_rows has to be at least as large as input_m,
   // since the whole input has to be covered in one AIE run.
   if (is_mladf_enabled_)
-    set_kernel_shapes_m_mladf(input_m);
+    return get_kernel_rows_mladf(input_m);
   else if (input_m == 1)
-    kernel_x_rows = 1;
+    return 1;
   else if (input_m <= 8)
-    kernel_x_rows = 8;
+    return 8;
   else if (input_m <= 16 && a_dtype_ == "int8")
-    kernel_x_rows = 16;
+    return 16;
   else if (a_dtype_ == "bfloat16" || input_m <= 32)
-    kernel_x_rows = 32;
+    return 32;
   else if (a_dtype_ == "int16" || a_dtype_ == "int8")
-    kernel_x_rows = 64;
+    return 64;
   else
     throw std::runtime_error(
         "No Kernel exists for the chosen activation shape and data type");
 }
 
 template <typename InT, typename WtT, typename AccT, typename OutT>
-void qlinear_2<InT, WtT, AccT, OutT>::set_kernel_shapes_m_mladf(
-    int64_t input_m) {
+int64_t qlinear_2<InT, WtT, AccT, OutT>::get_kernel_rows_mladf(
+    int64_t input_m) const {
   if (a_dtype_ == "int8") {
     if (input_m <= 16)
-      kernel_x_rows = 16;
+      return 16;
     else
-      kernel_x_rows = 32;
+      return 32;
   } else if (a_dtype_ == "bfloat16") {
     if (input_m == 1)
-      kernel_x_rows = 1;
+      return 1;
     else if (input_m < 2048)
-      kernel_x_rows = 128;
+      return 128;
     else
-      kernel_x_rows = 2048;
+      return 2048;
   } else
     throw std::runtime_error(
         "No Kernel exists for the chosen activation shape and data type");
 }
 
+template <typename InT, typename WtT, typename AccT, typename OutT>
+int64_t
+qlinear_2<InT, WtT, AccT, OutT>::get_padded_rows(int64_t input_m) const {
+  // same tiling of the rows as execute_tiles
+  int64_t rows = 0;
+  for (int64_t ra = 0; ra < input_m; ra += kernel_x_shape_[0]) {
+    rows += get_kernel_rows(std::min(input_m - ra, kernel_x_shape_[0]));
+  }
+  return rows;
+}
+
 template <typename InT, typename WtT, typename AccT, typename OutT>
 void qlinear_2<InT, WtT, AccT, OutT>::run_aie(InT *a, xrt::bo &w_bo,
                                               int64_t *input_shape) {
+  auto aie_run = run_aie_submit(a, w_bo, input_shape, 0);
+  run_aie_wait(aie_run);
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+template <typename T, typename SrcT>
+void qlinear_2<InT, WtT, AccT, OutT>::copy_padded_tile(T *a_map,
+                                                       const SrcT *a,
+                                                       int64_t *input_shape) {
+  const int64_t row_bytes = kernel_x_shape_[1] * a_dtype_size_;
+  const int64_t copy_bytes = input_shape[1] * a_dtype_size_;
+  uint8_t *dst = reinterpret_cast<uint8_t *>(a_map);
+  for (int i = 0; i < input_shape[0]; ++i) {
+    // copy row from the source tile
+    if constexpr (std::is_same_v<SrcT, float>) {
+      float_buffer_to_bfloat16(&a[i * a_shape_[1]], input_shape[1],
+                               (uint16_t *)&dst[i * row_bytes], use_avx);
+    } else {
+      memcpy((void *)&dst[i * row_bytes], (const void *)&a[i * a_shape_[1]],
+             copy_bytes);
+    }
+    if (copy_bytes < row_bytes) {
+      memset((void *)&dst[i * row_bytes + copy_bytes], 0,
+             row_bytes - copy_bytes);
+    }
+  }
+  if (input_shape[0] < kernel_x_rows) {
+    memset((void *)&dst[input_shape[0] * row_bytes], 0,
+           (kernel_x_rows - input_shape[0]) * row_bytes);
+  }
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+template <typename SrcT>
+typename qlinear_2<InT, WtT, AccT, OutT>::aie_run_t
+qlinear_2<InT, WtT, AccT, OutT>::run_aie_submit(const SrcT *a, xrt::bo &w_bo,
+                                                int64_t *input_shape,
+                                                int slot) {
   // NOTE: Here we select the DPU sequence to use based on the
   //       number of rows in the input. This allows us to optimize
   //       kernels for both prefill and token generation phases
@@ -1293,11 +1856,11 @@ void qlinear_2<InT, WtT, AccT, OutT>::run_aie(InT *a, xrt::bo &w_bo,
   //
   xrt::bo *instr_bo = nullptr;
 
-  auto a_bo_run_aie = a_bo_;
-  auto c_bo_run_aie = c_bo_;
+  auto a_bo_run_aie = (slot == 0) ? a_bo_ : a_bo_pp_;
+  auto c_bo_run_aie = (slot == 0) ? c_bo_ : c_bo_pp_;
   if (input_shape[0] == 1) {
-    a_bo_run_aie = a_bo_token_;
-    c_bo_run_aie = c_bo_token_;
+    a_bo_run_aie = (slot == 0) ? a_bo_token_ : a_bo_token_pp_;
+    c_bo_run_aie = (slot == 0) ? c_bo_token_ : c_bo_token_pp_;
   }
 
   set_kernel_shapes_m(input_shape[0]);
@@ -1326,16 +1889,7 @@ void qlinear_2<InT, WtT, AccT, OutT>::run_aie(InT *a, xrt::bo &w_bo,
                     .second;
 
     uint16_t *a_map = a_bo_run_aie.map<uint16_t *>();
-    memset((void *)a_map, 0, a_bo_run_aie.size());
-    uint16_t *a_u16 = reinterpret_cast<uint16_t *>(a);
-
-    auto a_sz = a_shape_[0] * a_shape_[1];
-
-    for (int i = 0; i < input_shape[0]; ++i) {
-      // copy row from the source tile
-      memcpy((void *)&a_map[i * kernel_x_shape_[1]],
-             (void *)&a[i * a_shape_[1]], input_shape[1] * a_dtype_size_);
-    }
+    copy_padded_tile(a_map, a, input_shape);
     //  append params at the end of A tensor
     if (!is_mladf_enabled_) {
       auto dev_params = (ParamSubv *)&a_map[kernel_x_rows * kernel_x_shape_[1]];
@@ -1348,13 +1902,7 @@ void qlinear_2<InT, WtT, AccT, OutT>::run_aie(InT *a, xrt::bo &w_bo,
   else {
     instr_bo = &instr_reg_.get_instr_bo(instr_bo_key + ".bin").second;
     InT *a_map = a_bo_run_aie.map<InT *>();
-    memset((void *)a_map, 0, a_bo_run_aie.size());
-
-    for (int i = 0; i < input_shape[0]; ++i) {
-      // copy row from the source tile
-      memcpy((void *)&a_map[i * kernel_x_shape_[1]],
-             (void *)&a[i * a_shape_[1]], input_shape[1] * a_dtype_size_);
-    }
+    copy_padded_tile(a_map, a, input_shape);
     // Initialize the superkernel instruction sequence
     // NOTE: the superkernel instruction sequence is initialized at the
     //       offset after the IFM tensor with size params_bytes
@@ -1407,29 +1955,138 @@ void qlinear_2<InT, WtT, AccT, OutT>::run_aie(InT *a, xrt::bo &w_bo,
                   a_bo_run_aie.address() + DDR_AIE_ADDR_OFFSET,
                   w_bo.address() + DDR_AIE_ADDR_OFFSET, 0, 0);
   }
-  run.wait2();
+  int64_t run_aie_stop = GET_ELAPSED_TIME_NS();
   num_run_aie_++;
+
+  a_copy_time_ += a_copy_stop - a_copy_start;
+  a_sync_time_ += a_sync_stop - a_sync_start;
+  run_aie_time_ += run_aie_stop - run_aie_start;
+  return {run, c_bo_run_aie, kernel_x_rows};
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void qlinear_2<InT, WtT, AccT, OutT>::run_aie_wait(aie_run_t &aie_run) {
+  int64_t run_aie_start = GET_ELAPSED_TIME_NS();
+  aie_run.run.wait2();
   int64_t run_aie_stop = GET_ELAPSED_TIME_NS();
   // sync output activation to host memory
   int64_t c_sync_start = GET_ELAPSED_TIME_NS();
   if (is_mladf_enabled_) {
-    c_bo_run_aie.sync(XCL_BO_SYNC_BO_FROM_DEVICE,
-                      kernel_x_rows * kernel_z_shape_[1] * sizeof(OutT), 0);
+    aie_run.c_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE,
+                      aie_run.rows * kernel_z_shape_[1] * sizeof(OutT), 0);
   } else {
-    c_bo_run_aie.sync(XCL_BO_SYNC_BO_FROM_DEVICE,
-                      kernel_x_rows * kernel_z_shape_[1] * sizeof(AccT), 0);
+    aie_run.c_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE,
+                      aie_run.rows * kernel_z_shape_[1] * sizeof(AccT), 0);
   }
   int64_t c_sync_stop = GET_ELAPSED_TIME_NS();
 
-  a_copy_time_ += a_copy_stop - a_copy_start;
-  a_sync_time_ += a_sync_stop - a_sync_start;
   c_sync_time_ += c_sync_stop - c_sync_start;
   run_aie_time_ += run_aie_stop - run_aie_start;
 }
 
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void qlinear_2<InT, WtT, AccT, OutT>::set_lora(
+    std::shared_ptr<const lora_adapter> adapter) {
+  if (adapter) {
+    if (a_dtype_ != "bfloat16" ||
+        !(std::is_same_v<AccT, float> || sizeof(AccT) == sizeof(uint16_t))) {
+      throw std::runtime_error("qlinear_2 : LoRA adapters require bfloat16 "
+                               "activations and float or bfloat16 "
+                               "accumulation");
+    }
+    if (adapter->k != w_shape_[0] || adapter->n != w_shape_[1]) {
+      throw std::runtime_error(
+          "qlinear_2 : LoRA adapter of " + std::to_string(adapter->k) + "x" +
+          std::to_string(adapter->n) + ", weights of " +
+          std::to_string(w_shape_[0]) + "x" + std::to_string(w_shape_[1]));
+    }
+  }
+  lora_ = std::move(adapter);
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+template <typename SrcT>
+void qlinear_2<InT, WtT, AccT, OutT>::lora_down(const SrcT *a, int64_t rows,
+                                                float *lora_t) {
+  const int64_t K = lora_->k;
+  const int64_t rank = lora_->rank;
+  const float *lora_a = lora_->a.data();
+  const int64_t grain = std::max<int64_t>(1, CPU_TASK_ELEMENTS / (K * rank));
+  ThreadPoolSingleton::getInstance().pool.parallel_for(
+      0, rows, grain, [&](int64_t r_lo, int64_t r_hi) {
+        for (int64_t r = r_lo; r < r_hi; ++r) {
+          float *t = &lora_t[r * rank];
+          std::fill(t, t + rank, 0.0f);
+          for (int64_t k = 0; k < K; ++k) {
+            float x;
+            if constexpr (std::is_same_v<SrcT, float>) {
+              x = a[r * K + k];
+            } else {
+              x = bfloat16_to_float(static_cast<uint16_t>(a[r * K + k]));
+            }
+            const float *a_row = &lora_a[k * rank];
+            for (int64_t q = 0; q < rank; ++q) {
+              t[q] += x * a_row[q];
+            }
+          }
+        }
+      });
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void qlinear_2<InT, WtT, AccT, OutT>::lora_up(const float *lora_t, AccT *c,
+                                              int64_t rows, int64_t cb,
+                                              int64_t cols) {
+  const int64_t N = lora_->n;
+  const int64_t rank = lora_->rank;
+  const float *lora_b = lora_->b.data();
+  const int64_t grain = std::max<int64_t>(1, CPU_TASK_ELEMENTS / (cols * rank));
+  ThreadPoolSingleton::getInstance().pool.parallel_for(
+      0, rows, grain, [&](int64_t r_lo, int64_t r_hi) {
+        std::vector<float> acc(cols);
+        for (int64_t r = r_lo; r < r_hi; ++r) {
+          const float *t = &lora_t[r * rank];
+          std::fill(acc.begin(), acc.end(), 0.0f);
+          for (int64_t q = 0; q < rank; ++q) {
+            const float *b_row = &lora_b[q * N + cb];
+            for (int64_t j = 0; j < cols; ++j) {
+              acc[j] += t[q] * b_row[j];
+            }
+          }
+          AccT *c_row = &c[r * c_shape_[1] + cb];
+          for (int64_t j = 0; j < cols; ++j) {
+            if constexpr (std::is_same_v<AccT, float>) {
+              c_row[j] += acc[j];
+            } else {
+              c_row[j] = static_cast<AccT>(float_to_bfloat16(
+                  bfloat16_to_float(static_cast<uint16_t>(c_row[j])) +
+                  acc[j]));
+            }
+          }
+        }
+      });
+}
+
 template <typename InT, typename WtT, typename AccT, typename OutT>
 void qlinear_2<InT, WtT, AccT, OutT>::execute(
     InT *a, const std::tuple<int, int> &a_shape, OutT *c) {
+  execute_tiles(a, a_shape, c);
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+void qlinear_2<InT, WtT, AccT, OutT>::execute(
+    const float *a, const std::tuple<int, int> &a_shape, OutT *c) {
+  if (a_dtype_ != "bfloat16") {
+    throw std::runtime_error(
+        "float activations are only supported with a bfloat16 kernel");
+  }
+  execute_tiles(a, a_shape, c);
+}
+
+template <typename InT, typename WtT, typename AccT, typename OutT>
+template <typename SrcT>
+void qlinear_2<InT, WtT, AccT, OutT>::execute_tiles(
+    const SrcT *a, const std::tuple<int, int> &a_shape, OutT *c) {
   int64_t exec_start = GET_ELAPSED_TIME_NS();
   a_sync_time_ = 0;
   c_sync_time_ = 0;
@@ -1442,6 +2099,7 @@ void qlinear_2<InT, WtT, AccT, OutT>::execute(
   c_sync_time_ = 0;
   run_aie_time_ = 0;
   cpu_acc_time_ = 0;
+  lora_time_ = 0;
   num_run_aie_ = 0;
 
   a_shape_[0] = std::get<0>(a_shape);
@@ -1449,14 +2107,15 @@ void qlinear_2<InT, WtT, AccT, OutT>::execute(
   c_shape_[0] = std::get<0>(a_shape);
   c_shape_[1] = w_shape_[1];
 
+  // the accumulation buffer and the tile jobs come from the arena of the
+  // thread, shared by all the ops instead of a buffer per op
+  Utils::ScratchArena::Scope scratch;
+  const int64_t c_size = c_shape_[0] * c_shape_[1];
   AccT *c_acc;
   if constexpr (std::is_same_v<AccT, OutT>) {
     c_acc = reinterpret_cast<AccT *>(c);
   } else {
-    if (c_acc_vec_.size() != (c_shape_[0] * c_shape_[1])) {
-      c_acc_vec_.resize(c_shape_[0] * c_shape_[1]);
-    }
-    c_acc = c_acc_vec_.data();
+    c_acc = scratch.alloc<AccT>(c_size);
   }
   // for MLADF case, leave result as bf16 and do not allow accumulation
   // along K over several AIE calls
@@ -1470,68 +2129,118 @@ void qlinear_2<InT, WtT, AccT, OutT>::execute(
                                "and out type must be identical.");
   }
 
+  if (is_mladf_enabled_ && kernel_x_shape_[1] < a_shape_[1]) {
+    throw std::runtime_error("mladf Kernel doesn't support host accumulation.");
+  }
+
+  // one AIE run per (output tile, K tile), K innermost
+  struct tile_job_t {
+    int64_t ra;
+    int64_t cb;
+    int64_t k;
+    int64_t tile_idx;
+    int64_t input_shape[2];
+  };
+  auto num_tiles = [](int64_t x, int64_t y) { return size_t((x + y - 1) / y); };
+  const size_t max_jobs = num_tiles(a_shape_[0], kernel_x_shape_[0]) *
+                          num_tiles(w_shape_[1], kernel_y_shape_[1]) *
+                          num_tiles(a_shape_[1], kernel_x_shape_[1]);
+  tile_job_t *jobs = scratch.alloc<tile_job_t>(max_jobs);
+  size_t num_jobs = 0;
+  // compute row major tile index for weight BOs
+  const int64_t tile_pitch = w_padded_shape_[1] / kernel_y_shape_[1];
   for (int64_t ra = 0; ra < a_shape_[0]; ra += kernel_x_shape_[0]) {
     for (int64_t cb = 0; cb < w_shape_[1]; cb += kernel_y_shape_[1]) {
+      for (int64_t k = 0; k < a_shape_[1]; k += kernel_x_shape_[1]) {
+        tile_job_t job;
+        job.ra = ra;
+        job.cb = cb;
+        job.k = k;
+        job.tile_idx = (k / kernel_y_shape_[0]) * tile_pitch +
+                       (cb / kernel_y_shape_[1]);
+        // compute shape of current input tile
+        job.input_shape[0] = std::min(a_shape_[0] - ra, kernel_x_shape_[0]);
+        job.input_shape[1] = std::min(a_shape_[1] - k, kernel_x_shape_[1]);
+        jobs[num_jobs++] = job;
+      }
+    }
+  }
 
-      int k = 0;
-      // compute row major tile index for weight BOs
-      int64_t tile_pitch = w_padded_shape_[1] / kernel_y_shape_[1];
-      int64_t tile_row = k / kernel_y_shape_[0];
-      int64_t tile_col = cb / kernel_y_shape_[1];
-      int64_t tile_idx = tile_row * tile_pitch + tile_col;
-      // compute shape of current input tile
-      int64_t input_shape[2];
-      input_shape[0] = std::min(a_shape_[0] - ra, kernel_x_shape_[0]);
-      input_shape[1] = std::min(a_shape_[1] - k, kernel_x_shape_[1]);
-
-      run_aie(&a[ra * a_shape_[1] + k], weights_bo_[tile_idx], input_shape);
-
-      // compute shape of current output tile
-      int64_t output_shape[2];
-      output_shape[0] = std::min(c_shape_[0] - ra, kernel_z_shape_[0]);
-      output_shape[1] = std::min(c_shape_[1] - cb, kernel_z_shape_[1]);
+  auto &pool = ThreadPoolSingleton::getInstance().pool;
+
+  // Software pipeline over two BO sets : tile i + 1 is copied and started
+  // before the output of tile i is read back and accumulated on the host.
+  auto &weights_bo = weight_stream_layer_
+                        ? weight_stream::get_instance().acquire(
+                              *weight_stream_layer_)
+                        : weights_bo_;
+  aie_run_t runs[2];
+  auto submit = [&](size_t i) {
+    auto &job = jobs[i];
+    runs[i % 2] =
+        run_aie_submit(&a[job.ra * a_shape_[1] + job.k],
+                       weights_bo[job.tile_idx], job.input_shape, i % 2);
+  };
+  if (num_jobs > 0) {
+    submit(0);
+  }
+  // a * A is shared by all the output tiles, computed while the first AIE
+  // run is in flight
+  float *lora_t = nullptr;
+  if (lora_) {
+    int64_t lora_start = GET_ELAPSED_TIME_NS();
+    lora_t = scratch.alloc<float>(a_shape_[0] * lora_->rank);
+    lora_down(a, a_shape_[0], lora_t);
+    lora_time_ += GET_ELAPSED_TIME_NS() - lora_start;
+  }
+  for (size_t i = 0; i < num_jobs; ++i) {
+    if (i + 1 < num_jobs) {
+      submit(i + 1);
+    }
+    run_aie_wait(runs[i % 2]);
 
-      int64_t c_copy_start = GET_ELAPSED_TIME_NS();
+    const auto &job = jobs[i];
+    // compute shape of current output tile
+    int64_t output_shape[2];
+    output_shape[0] = std::min(c_shape_[0] - job.ra, kernel_z_shape_[0]);
+    output_shape[1] = std::min(c_shape_[1] - job.cb, kernel_z_shape_[1]);
+    auto c_map = runs[i % 2].c_bo.template map<AccT *>();
 
+    if (job.k == 0) {
       // initialize the output tile
-      auto c_map = c_bo_.map<AccT *>();
-      if (output_shape[0] == 1) {
-        c_map = c_bo_token_.map<AccT *>();
-      } else {
-        c_map = c_bo_.map<AccT *>();
-      }
-
-      for (int i = 0; i < output_shape[0]; ++i) {
-        memcpy((void *)&c_acc[(ra + i) * c_shape_[1] + cb],
-               (void *)&c_map[i * kernel_z_shape_[1]],
+      int64_t c_copy_start = GET_ELAPSED_TIME_NS();
+      for (int r = 0; r < output_shape[0]; ++r) {
+        memcpy((void *)&c_acc[(job.ra + r) * c_shape_[1] + job.cb],
+               (void *)&c_map[r * kernel_z_shape_[1]],
                output_shape[1] * sizeof(AccT));
       }
       int64_t c_copy_stop = GET_ELAPSED_TIME_NS();
       c_copy_time_ += (c_copy_stop - c_copy_start);
-
-      // accumulate over inner dimension
-      for (k = kernel_x_shape_[1]; k < a_shape_[1]; k += kernel_x_shape_[1]) {
-        tile_row = k / kernel_y_shape_[0];
-        tile_idx = tile_row * tile_pitch + tile_col;
-        input_shape[1] = std::min(a_shape_[1] - k, kernel_x_shape_[1]);
-        run_aie(&a[ra * a_shape_[1] + k], weights_bo_[tile_idx], input_shape);
-
-        int64_t cpu_acc_start = GET_ELAPSED_TIME_NS();
-        if (is_mladf_enabled_) {
-          throw std::runtime_error(
-              "mladf Kernel doesn't support host accumulation.");
-        } else {
-          for (int i = 0; i < output_shape[0]; ++i) {
-            for (int j = 0; j < output_shape[1]; ++j) {
-              c_acc[(ra + i) * c_shape_[1] + (cb + j)] +=
-                  c_map[i * kernel_z_shape_[1] + j];
-            }
-          }
-        }
-
-        int64_t cpu_acc_stop = GET_ELAPSED_TIME_NS();
-        cpu_acc_time_ += cpu_acc_stop - cpu_acc_start;
+      if (lora_) {
+        // fused with the copy of the tile, before any K accumulation
+        int64_t lora_start = GET_ELAPSED_TIME_NS();
+        lora_up(&lora_t[job.ra * lora_->rank], &c_acc[job.ra * c_shape_[1]],
+                output_shape[0], job.cb, output_shape[1]);
+        lora_time_ += GET_ELAPSED_TIME_NS() - lora_start;
       }
+    } else {
+      // accumulate over inner dimension
+      int64_t cpu_acc_start = GET_ELAPSED_TIME_NS();
+      // rows are split over the pool for large tiles, a single row (token
+      // generation) stays on this thread
+      const int64_t acc_grain =
+          std::max<int64_t>(1, CPU_TASK_ELEMENTS / output_shape[1]);
+      pool.parallel_for(0, output_shape[0], acc_grain,
+                        [&](int64_t r_lo, int64_t r_hi) {
+                          for (int64_t r = r_lo; r < r_hi; ++r) {
+                            accumulate_buffer(
+                                &c_acc[(job.ra + r) * c_shape_[1] + job.cb],
+                                &c_map[r * kernel_z_shape_[1]],
+                                output_shape[1], use_avx);
+                          }
+                        });
+      int64_t cpu_acc_stop = GET_ELAPSED_TIME_NS();
+      cpu_acc_time_ += cpu_acc_stop - cpu_acc_start;
     }
   }
 
@@ -1541,8 +2250,12 @@ void qlinear_2<InT, WtT, AccT, OutT>::execute(
       // template being int16_t
       static_assert(std::is_same_v<AccT, float>, "AccT must be float");
       static_assert(std::is_same_v<OutT, int16_t>, "OutT must be int16_t");
-      float_buffer_to_bfloat16(c_acc, c_acc_vec_.size(), (uint16_t *)c,
-                               use_avx);
+      pool.parallel_for(0, c_size, CPU_TASK_ELEMENTS,
+                        [&](int64_t lo, int64_t hi) {
+                          float_buffer_to_bfloat16(c_acc + lo, hi - lo,
+                                                   (uint16_t *)c + lo,
+                                                   use_avx);
+                        });
     }
 
   int64_t exec_end = GET_ELAPSED_TIME_NS();
@@ -17,6 +17,7 @@
 
 #include <algorithm>
 #include <array>
+#include <type_traits>
 
 namespace ryzenai {
 
@@ -110,6 +111,47 @@ static inline void float_buffer_to_bfloat16(const float *in,
   }
 }
 
+/*
+ * accumulate a buffer into another one : dst[i] += src[i]
+ * @param dst is the accumulator buffer
+ * @param src is the buffer to add
+ * @param num_elements is the number of elements of both buffers
+ * @param use_avx selects the AVX-512 path for int32, int64 and float
+ */
+template <typename T>
+static inline void accumulate_buffer(T *dst, const T *src,
+                                     std::size_t num_elements,
+                                     const bool use_avx) {
+  constexpr bool has_avx_path = std::is_same_v<T, int32_t> ||
+                                std::is_same_v<T, int64_t> ||
+                                std::is_same_v<T, float>;
+  std::size_t i = 0;
+  if constexpr (has_avx_path) {
+    if (use_avx) {
+      constexpr std::size_t ELEMS_PER_VECTOR = (512 / 8) / sizeof(T);
+      for (; i + ELEMS_PER_VECTOR <= num_elements; i += ELEMS_PER_VECTOR) {
+        if constexpr (std::is_same_v<T, float>) {
+          __m512 acc = _mm512_loadu_ps(dst + i);
+          acc = _mm512_add_ps(acc, _mm512_loadu_ps(src + i));
+          _mm512_storeu_ps(dst + i, acc);
+        } else {
+          __m512i acc = _mm512_loadu_si512((const void *)(dst + i));
+          __m512i val = _mm512_loadu_si512((const void *)(src + i));
+          if constexpr (std::is_same_v<T, int32_t>) {
+            acc = _mm512_add_epi32(acc, val);
+          } else {
+            acc = _mm512_add_epi64(acc, val);
+          }
+          _mm512_storeu_si512((void *)(dst + i), acc);
+        }
+      }
+    }
+  }
+  for (; i < num_elements; ++i) {
+    dst[i] += src[i];
+  }
+}
+
 /*
  * converts bfloat16 value to float value by zeropadding the last 16 bits
  * @param x is a bfloat16 value in uint16_t var
@@ -166,6 +208,20 @@ static uint8_t pack_v2uint4(int x, int y) {
   return (x & 0xF) | ((y & 0xF) << 4);
 }
 
+/*
+ * pack count int4 or uint4 values into count / 2 bytes, pairwise like
+ * pack_v2int4, the packing is the same for both signs
+ * @param dst is the packed output
+ * @param src is the int8 input, count is even
+ */
+template <typename T>
+static inline void pack_v2int4_span(uint8_t *dst, const T *src, int count) {
+  for (int i = 0; i < count / 2; ++i) {
+    dst[i] = static_cast<uint8_t>((src[2 * i] & 0xF) |
+                                  ((src[2 * i + 1] & 0xF) << 4));
+  }
+}
+
 struct v2int {
   int x;
   int y;
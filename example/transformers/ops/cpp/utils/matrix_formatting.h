@@ -179,6 +179,31 @@ struct QuantMatrix {
     return data[i0].wgts.quants[i1];
   }
 
+  /*
+   * pack count int4 weights of a row, from column col on, into the
+   * formatted tensor. A subvolume row is Nsubv / 2 contiguous bytes, whole
+   * ones are packed with a compile time count
+   * @param row is row index in original tensor
+   * @param col is the first column index in original tensor, even
+   * @param src is the weights of the row from col on
+   * @param count is the number of weights, even
+   */
+  template <typename T>
+  void pack_quant_row(int row, int col, const T *src, int count) {
+    while (count > 0) {
+      int const span = std::min(count, Nsubv - (col % Nsubv));
+      uint8_t *dst = &quant(row, col);
+      if (span == Nsubv) {
+        pack_v2int4_span(dst, src, Nsubv);
+      } else {
+        pack_v2int4_span(dst, src, span);
+      }
+      col += span;
+      src += span;
+      count -= span;
+    }
+  }
+
   /*
    * compute the index of zeros in formatted tensor
    * @param row is row index in original tensor
@@ -0,0 +1,198 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#ifndef __NPU_WEIGHT_FILE_H_
+#define __NPU_WEIGHT_FILE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ryzenai {
+
+/*
+ * NPU-native weight file : the weight BOs of an operator, already padded,
+ * tiled and formatted for the kernel, so that loading them is one memcpy per
+ * tile.
+ *
+ * Layout :
+ *   npu_weight_file_header
+ *   padding up to NPU_WEIGHT_FILE_ALIGNMENT
+ *   num_tiles x tile_bytes, tile i holds weights_bo_[i]
+ */
+static constexpr char NPU_WEIGHT_FILE_MAGIC[8] = {'N', 'P', 'U', 'W',
+                                                  'G', 'T', '\0', '\0'};
+static constexpr uint32_t NPU_WEIGHT_FILE_VERSION = 1;
+/* tiles start page aligned in the mapped file */
+static constexpr uint64_t NPU_WEIGHT_FILE_ALIGNMENT = 4096;
+
+struct npu_weight_file_header {
+  char magic[8];
+  uint32_t version;
+  /* operator specific format of the tiles, e.g. int8 or int4 weights */
+  uint32_t format;
+  /* overlay the tiles are formatted for, 0 for the default one */
+  uint32_t design;
+  int32_t group_size;
+  int64_t w_shape[2];
+  int64_t kernel_y_shape[2];
+  uint64_t num_tiles;
+  uint64_t tile_bytes;
+  uint64_t data_offset;
+};
+
+/*
+ * Write the header followed by the tiles, to a temp file first so that a
+ * partially written file is never picked up.
+ */
+static inline void
+write_npu_weight_file(const std::string &fname, npu_weight_file_header header,
+                      const std::vector<const void *> &tiles) {
+  memcpy(header.magic, NPU_WEIGHT_FILE_MAGIC, sizeof(header.magic));
+  header.version = NPU_WEIGHT_FILE_VERSION;
+  header.num_tiles = tiles.size();
+  header.data_offset = NPU_WEIGHT_FILE_ALIGNMENT;
+
+  const std::string tmp_fname = fname + ".tmp";
+  {
+    std::ofstream ofs(tmp_fname, std::ios::binary);
+    if (!ofs) {
+      throw std::runtime_error("Couldn't open file for writing : " +
+                               tmp_fname);
+    }
+    std::vector<char> header_page(header.data_offset, 0);
+    memcpy(header_page.data(), &header, sizeof(header));
+    ofs.write(header_page.data(), header_page.size());
+    for (const auto *tile : tiles) {
+      ofs.write((const char *)tile, header.tile_bytes);
+    }
+    if (!ofs) {
+      throw std::runtime_error("Failed to write : " + tmp_fname);
+    }
+  }
+  std::remove(fname.c_str());
+  if (std::rename(tmp_fname.c_str(), fname.c_str()) != 0) {
+    throw std::runtime_error("Failed to rename " + tmp_fname + " to " + fname);
+  }
+}
+
+/* Read-only memory map of an NPU-native weight file */
+class npu_weight_file {
+public:
+  npu_weight_file(const std::string &fname) : fname_(fname) {
+#ifdef _WIN32
+    file_ = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+      throw std::runtime_error("Couldn't open file for reading : " + fname);
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_, &file_size)) {
+      CloseHandle(file_);
+      throw std::runtime_error("Couldn't get the size of : " + fname);
+    }
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void *ptr = (mapping_ == nullptr)
+                    ? nullptr
+                    : MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    if (ptr == nullptr) {
+      if (mapping_ != nullptr) {
+        CloseHandle(mapping_);
+      }
+      CloseHandle(file_);
+      throw std::runtime_error("Couldn't map file : " + fname);
+    }
+#else
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Couldn't open file for reading : " + fname);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw std::runtime_error("Couldn't get the size of : " + fname);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void *ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+      throw std::runtime_error("Couldn't map file : " + fname);
+    }
+#endif
+    data_ = static_cast<const uint8_t *>(ptr);
+
+    if (size_ < sizeof(header_)) {
+      unmap();
+      throw std::runtime_error("Truncated weight file : " + fname);
+    }
+    memcpy(&header_, data_, sizeof(header_));
+    if (memcmp(header_.magic, NPU_WEIGHT_FILE_MAGIC, sizeof(header_.magic)) !=
+        0) {
+      unmap();
+      throw std::runtime_error("Not an NPU weight file : " + fname);
+    }
+    if (header_.version != NPU_WEIGHT_FILE_VERSION) {
+      unmap();
+      throw std::runtime_error("Unsupported NPU weight file version " +
+                               std::to_string(header_.version) + " : " +
+                               fname);
+    }
+    if (header_.data_offset + header_.num_tiles * header_.tile_bytes >
+        size_) {
+      unmap();
+      throw std::runtime_error("Truncated weight file : " + fname);
+    }
+  }
+  ~npu_weight_file() { unmap(); }
+  npu_weight_file(const npu_weight_file &) = delete;
+  npu_weight_file &operator=(const npu_weight_file &) = delete;
+
+  const npu_weight_file_header &header() const { return header_; }
+  const void *tile(size_t i) const {
+    return data_ + header_.data_offset + i * header_.tile_bytes;
+  }
+  const std::string &name() const { return fname_; }
+
+private:
+  void unmap() {
+    if (data_ == nullptr) {
+      return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    CloseHandle(file_);
+#else
+    munmap(const_cast<uint8_t *>(data_), size_);
+#endif
+    data_ = nullptr;
+  }
+
+  std::string fname_;
+  npu_weight_file_header header_;
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  HANDLE file_ = nullptr;
+  HANDLE mapping_ = nullptr;
+#endif
+};
+
+} // namespace ryzenai
+
+#endif // __NPU_WEIGHT_FILE_H_
@@ -0,0 +1,164 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+/*
+ * Per thread scratch memory for the temporaries of an op call.
+ *
+ * A call opens a ScratchArena::Scope, bump allocates its temporaries from the
+ * arena of its thread and gives them all back when the scope ends. Scopes
+ * nest, an op called by another one only releases its own allocations. When
+ * a call needed more than the current block, the blocks are merged into one
+ * of the high water size once the outermost scope ends, so that after the
+ * first calls of a given shape no call allocates from the heap.
+ *
+ * The memory is raw : no constructor or destructor is run, only trivial types
+ * are allocated.
+ */
+
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace Utils {
+
+class ScratchArena {
+public:
+  static constexpr size_t ALIGNMENT = 64;
+  static constexpr size_t MIN_BLOCK_SIZE = 1 << 16;
+
+  // arena of the calling thread
+  static ScratchArena &get() {
+    static thread_local ScratchArena arena;
+    return arena;
+  }
+
+  class Scope {
+  public:
+    Scope() : Scope(ScratchArena::get()) {}
+    explicit Scope(ScratchArena &arena)
+        : arena_(arena), block_(arena.block_), offset_(arena.offset_) {
+      arena_.depth_++;
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+    ~Scope() { arena_.release(block_, offset_); }
+
+    // n uninitialized elements, aligned to ALIGNMENT
+    template <typename T> T *alloc(size_t n) { return arena_.alloc<T>(n); }
+    // n elements set to 0
+    template <typename T> T *zeros(size_t n) {
+      T *p = alloc<T>(n);
+      std::fill(p, p + n, T(0));
+      return p;
+    }
+
+  private:
+    ScratchArena &arena_;
+    size_t block_;
+    size_t offset_;
+  };
+
+  // bytes held by the arena
+  size_t capacity() const {
+    size_t total = 0;
+    for (const auto &block : blocks_) {
+      total += block.size;
+    }
+    return total;
+  }
+  // number of heap allocations made by the arena since it was created
+  size_t num_heap_allocs() const { return num_heap_allocs_; }
+
+private:
+  struct Block {
+    std::unique_ptr<char[]> storage;
+    // storage aligned to ALIGNMENT
+    char *data = nullptr;
+    size_t size = 0;
+  };
+
+  ScratchArena() = default;
+
+  template <typename T> T *alloc(size_t n) {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "ScratchArena only holds trivial types");
+    static_assert(alignof(T) <= ALIGNMENT, "over aligned type");
+    return reinterpret_cast<T *>(alloc_bytes(n * sizeof(T)));
+  }
+
+  void *alloc_bytes(size_t bytes) {
+    bytes = std::max<size_t>(round_up(bytes), ALIGNMENT);
+    while (block_ < blocks_.size()) {
+      auto &block = blocks_[block_];
+      if (offset_ + bytes <= block.size) {
+        void *p = block.data + offset_;
+        offset_ += bytes;
+        used_ += bytes;
+        high_water_ = std::max(high_water_, used_);
+        return p;
+      }
+      // the rest of the block is wasted until the scope ends
+      used_ += block.size - offset_;
+      block_++;
+      offset_ = 0;
+    }
+    add_block(std::max(bytes, std::max(MIN_BLOCK_SIZE, capacity())));
+    return alloc_bytes(bytes);
+  }
+
+  void add_block(size_t size) {
+    Block block;
+    // one extra alignment so that the start of the block can be aligned
+    block.storage.reset(new char[size + ALIGNMENT]);
+    auto address = reinterpret_cast<uintptr_t>(block.storage.get());
+    block.data = block.storage.get() + (round_up(address) - address);
+    block.size = size;
+    num_heap_allocs_++;
+    blocks_.push_back(std::move(block));
+  }
+
+  void release(size_t block, size_t offset) {
+    depth_--;
+    block_ = block;
+    offset_ = offset;
+    used_ = 0;
+    for (size_t i = 0; i < block_; ++i) {
+      used_ += blocks_[i].size;
+    }
+    used_ += offset_;
+    if (depth_ == 0 && blocks_.size() > 1) {
+      // nothing is live, keep a single block that fits the largest call
+      const size_t size = round_up(high_water_);
+      blocks_.clear();
+      add_block(size);
+      block_ = 0;
+      offset_ = 0;
+      used_ = 0;
+    }
+  }
+
+  // the offsets are multiples of ALIGNMENT from an aligned block start
+  static size_t round_up(size_t bytes) {
+    return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  }
+
+  std::vector<Block> blocks_;
+  size_t block_ = 0;
+  size_t offset_ = 0;
+  size_t used_ = 0;
+  size_t high_water_ = 0;
+  int depth_ = 0;
+  size_t num_heap_allocs_ = 0;
+};
+
+} // namespace Utils
+
+#endif
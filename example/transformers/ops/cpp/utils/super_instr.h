@@ -6,6 +6,10 @@
 #define SUPER_INSTR_H
 
 #include "ml_params.h"
+#include <array>
+#include <cstring>
+#include <map>
+#include <mutex>
 #include <stdint.h>
 namespace ryzenai {
 // NOTE: DO NOT RE-ORDER THE FIELDS OF THESE STRUCTS.
@@ -84,24 +88,15 @@ static_assert(sizeof(GemmPadding) % 4 == 0);
 // here to make sure this property is maintained.
 static_assert(std::is_trivially_copyable_v<GemmSeq>);
 
-// initialize instr_ddr to encode a multiple subvolume GEMM operation
-// using the super kernel instruction format
-static inline void
-init_gemm_instr_ddr(int8_t *instr_ddr, int M, int K, int N,
-                    // Subvolume dimensions
-                    int Msubv, int Ksubv = 128, int Nsubv = 64,
-                    // Block granularity (default is for OLOH kernel type)
-                    int Mgran = 8, int Kgran = 8, int Ngran = 16,
-                    // AIE array size
-                    int aie_rows = 4, int aie_cols = 4) {
+// encode a multiple subvolume GEMM operation using the super kernel
+// instruction format, M is already a multiple of Msubv
+static inline GemmSeq make_gemm_seq(int M, int K, int N, int Msubv, int Ksubv,
+                                    int Nsubv, int Mgran, int Kgran, int Ngran,
+                                    int aie_rows, int aie_cols) {
   // Generate kernel parameters
   MLKernelParams params;
   params.update_params(Msubv, Ksubv, Nsubv, Mgran, Kgran, Ngran);
   params.ctrl.parts.out_64 = 1;
-  // Round M up to nearest multiple of Msubv
-  // NOTE: this is included to account for special cases where
-  //       the input to a core is zero-padded by the BDs
-  M = ((M + (Msubv - 1)) / Msubv) * Msubv;
 
   // Compute repeat counts as follows:
   //     OUTER_REPEAT
@@ -116,7 +111,8 @@ init_gemm_instr_ddr(int8_t *instr_ddr, int M, int K, int N,
   const int OUTER_REPEAT = (M / Msubv) * (N / (aie_cols * Nsubv));
   const int INNER_REPEAT = (K / (aie_rows * Ksubv)) - 2;
 
-  GemmSeq *seq = (GemmSeq *)instr_ddr;
+  GemmSeq seq_buf{};
+  GemmSeq *seq = &seq_buf;
 
   // header
   seq->total_size = TOTAL_SIZE;
@@ -157,6 +153,50 @@ init_gemm_instr_ddr(int8_t *instr_ddr, int M, int K, int N,
   seq->instr[2].subinstr_size = SUBINSTR_SIZE + PADDING_BYTES;
   seq->instr[2].opcode_config = 0x02010e01;
   seq->instr[2].data.params = params;
+  return seq_buf;
+}
+
+// Sequences already encoded, keyed by shape, subvolume, granularity and
+// array size. Layers sharing a shape reuse the same sequence.
+static inline const GemmSeq &get_gemm_seq(int M, int K, int N, int Msubv,
+                                          int Ksubv, int Nsubv, int Mgran,
+                                          int Kgran, int Ngran, int aie_rows,
+                                          int aie_cols) {
+  using key_t = std::array<int, 11>;
+  static std::mutex cache_mutex;
+  static std::map<key_t, GemmSeq> cache;
+
+  const key_t key = {M,     K,     N,     Msubv,    Ksubv,   Nsubv,
+                     Mgran, Kgran, Ngran, aie_rows, aie_cols};
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  auto it = cache.find(key);
+  if (it == cache.end()) {
+    it = cache
+             .emplace(key, make_gemm_seq(M, K, N, Msubv, Ksubv, Nsubv, Mgran,
+                                         Kgran, Ngran, aie_rows, aie_cols))
+             .first;
+  }
+  return it->second;
+}
+
+// initialize instr_ddr to encode a multiple subvolume GEMM operation
+// using the super kernel instruction format
+static inline void
+init_gemm_instr_ddr(int8_t *instr_ddr, int M, int K, int N,
+                    // Subvolume dimensions
+                    int Msubv, int Ksubv = 128, int Nsubv = 64,
+                    // Block granularity (default is for OLOH kernel type)
+                    int Mgran = 8, int Kgran = 8, int Ngran = 16,
+                    // AIE array size
+                    int aie_rows = 4, int aie_cols = 4) {
+  // Round M up to nearest multiple of Msubv
+  // NOTE: this is included to account for special cases where
+  //       the input to a core is zero-padded by the BDs
+  M = ((M + (Msubv - 1)) / Msubv) * Msubv;
+
+  const GemmSeq &seq = get_gemm_seq(M, K, N, Msubv, Ksubv, Nsubv, Mgran, Kgran,
+                                    Ngran, aie_rows, aie_cols);
+  std::memcpy(instr_ddr, &seq, sizeof(GemmSeq));
 }
 } // namespace ryzenai
 #endif // SUPER_INSTR_H
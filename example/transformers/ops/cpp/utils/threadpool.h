@@ -2,104 +2,370 @@
  * Copyright © 2023 Advanced Micro Devices, Inc. All rights reserved.
  */
 
-/* Based on :
- * https://raw.githubusercontent.com/progschj/ThreadPool/master/ThreadPool.h */
+/*
+ * Work-stealing thread pool.
+ *
+ * Each worker owns a lock-free Chase-Lev deque : it pushes and pops tasks at
+ * the bottom, idle workers steal from the top. Tasks submitted from outside
+ * the pool go to the inbox of a worker, which is stolen from as well, so no
+ * queue backs up while other cores are idle.
+ *
+ *   Chase, Lev, "Dynamic Circular Work-Stealing Deque", SPAA 2005
+ *   Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models",
+ *   PPoPP 2013
+ */
 
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <stdexcept>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 #include "utils.h"
 
+namespace threadpool_detail {
+
+// Type erased task, the callable is stored in the task itself so that a task
+// is a single allocation
+struct Task {
+  virtual ~Task() = default;
+  virtual void run() = 0;
+};
+
+template <class F> struct TaskImpl : Task {
+  F f;
+  template <class G> explicit TaskImpl(G &&g) : f(std::forward<G>(g)) {}
+  void run() override { f(); }
+};
+
+template <class F> Task *make_task(F &&f) {
+  return new TaskImpl<std::decay_t<F>>(std::forward<F>(f));
+}
+
+// Bounded Chase-Lev deque of tasks. push() and pop() are only called by the
+// owner thread, steal() by any thread.
+class WorkStealingDeque {
+public:
+  static constexpr int64_t CAPACITY = 1024;
+
+  // false when full, the caller then queues the task elsewhere
+  bool push(Task *task) {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_acquire);
+    if (b - t >= CAPACITY) {
+      return false;
+    }
+    buffer_[b & (CAPACITY - 1)].store(task, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  Task *pop() {
+    const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    Task *task = buffer_[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (t == b) {
+      // last task, race with the thieves for it
+      if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        task = nullptr;
+      }
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+  }
+
+  Task *steal() {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+      return nullptr;
+    }
+    Task *task = buffer_[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return task;
+  }
+
+private:
+  alignas(64) std::atomic<int64_t> top_{0};
+  alignas(64) std::atomic<int64_t> bottom_{0};
+  std::atomic<Task *> buffer_[CAPACITY] = {};
+};
+
+// Tasks submitted by threads outside of the pool
+struct Inbox {
+  std::mutex mutex;
+  std::deque<Task *> tasks;
+
+  void push(Task *task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(task);
+  }
+  Task *pop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tasks.empty()) {
+      return nullptr;
+    }
+    Task *task = tasks.front();
+    tasks.pop_front();
+    return task;
+  }
+};
+
+} // namespace threadpool_detail
+
 class ThreadPool {
 public:
   ThreadPool(size_t);
+  ~ThreadPool();
+
+  size_t num_threads() const { return workers.size(); }
+
+  // add new work item to the pool
+  template <class F, class... Args>
+  auto enqueue(F &&f, Args &&...args)
+      -> std::future<std::invoke_result_t<F, Args...>>;
+  // same, tid selects the worker the task is queued to before it can be
+  // stolen by another one
   template <class F, class... Args>
   auto enqueue(int tid, F &&f, Args &&...args)
-      -> std::future<typename std::result_of<F(Args...)>::type>;
-  ~ThreadPool();
+      -> std::future<std::invoke_result_t<F, Args...>>;
+
+  // fn(lo, hi) for consecutive chunks [lo, hi) of [begin, end) of at most
+  // grain iterations, run by the calling thread and the idle workers. Returns
+  // when all chunks are done, rethrows the first exception of fn.
+  template <class F>
+  void parallel_for(int64_t begin, int64_t end, int64_t grain, F &&fn);
 
 private:
+  using Task = threadpool_detail::Task;
+
+  void push(size_t tid, Task *task);
+  Task *find_task(size_t i);
+  void worker_loop(size_t i);
+
   // need to keep track of threads so we can join them
   std::vector<std::thread> workers;
-  // the task queue
-  // N task queues, each one for each worker
-  std::vector<std::queue<std::function<void()>>> tasks;
-
-  // synchronization
-  std::vector<std::mutex> queue_mutex;
-  std::vector<std::condition_variable> condition;
-  bool stop;
+  std::vector<std::unique_ptr<threadpool_detail::WorkStealingDeque>> deques;
+  std::vector<std::unique_ptr<threadpool_detail::Inbox>> inboxes;
+  std::atomic<size_t> next_inbox{0};
+
+  // queued tasks not yet taken by a worker
+  std::atomic<int64_t> pending{0};
+  // idle workers sleep on the condition variable
+  std::atomic<int> sleepers{0};
+  std::mutex sleep_mutex;
+  std::condition_variable condition;
+  std::atomic<bool> stop{false};
+
+  // index of the calling thread in the pool it belongs to
+  static size_t &worker_index() {
+    static thread_local size_t index = 0;
+    return index;
+  }
+  static ThreadPool *&worker_pool() {
+    static thread_local ThreadPool *pool = nullptr;
+    return pool;
+  }
 };
 
 // the constructor just launches some amount of workers
-inline ThreadPool::ThreadPool(size_t threads)
-    : tasks(threads), queue_mutex(threads), condition(threads), stop(false) {
+inline ThreadPool::ThreadPool(size_t threads) {
+  threads = std::max<size_t>(threads, 1);
+  for (size_t i = 0; i < threads; ++i) {
+    deques.push_back(std::make_unique<threadpool_detail::WorkStealingDeque>());
+    inboxes.push_back(std::make_unique<threadpool_detail::Inbox>());
+  }
   workers.reserve(threads);
-  for (size_t i = 0; i < threads; ++i)
-    workers.emplace_back([this, i] {
-      for (;;) {
-        auto &task_queue = this->tasks.at(i);
-        std::function<void()> task;
-
-        {
-          std::unique_lock<std::mutex> lock(this->queue_mutex.at(i));
-          this->condition.at(i).wait(lock, [this, i] {
-            return this->stop || !this->tasks.at(i).empty();
-          });
-          if (this->stop && this->tasks.at(i).empty())
-            return;
-          task = std::move(this->tasks.at(i).front());
-          this->tasks.at(i).pop();
-        }
-        task();
-      }
+  for (size_t i = 0; i < threads; ++i) {
+    workers.emplace_back([this, i] { worker_loop(i); });
+  }
+}
+
+inline void ThreadPool::push(size_t tid, Task *task) {
+  if (worker_pool() == this) {
+    // a worker queues to its own deque, the inbox takes the overflow
+    const size_t i = worker_index();
+    if (!deques[i]->push(task)) {
+      inboxes[i]->push(task);
+    }
+  } else {
+    // don't allow enqueueing after stopping the pool
+    if (stop.load(std::memory_order_relaxed)) {
+      delete task;
+      throw std::runtime_error("enqueue on stopped ThreadPool");
+    }
+    inboxes[tid % inboxes.size()]->push(task);
+  }
+  pending.fetch_add(1, std::memory_order_seq_cst);
+  if (sleepers.load(std::memory_order_seq_cst) > 0) {
+    // taking the lock orders the wake up after the predicate check of a
+    // worker going to sleep
+    { std::lock_guard<std::mutex> lock(sleep_mutex); }
+    condition.notify_one();
+  }
+}
+
+inline threadpool_detail::Task *ThreadPool::find_task(size_t i) {
+  if (Task *task = deques[i]->pop()) {
+    return task;
+  }
+  if (Task *task = inboxes[i]->pop()) {
+    return task;
+  }
+  const size_t n = deques.size();
+  for (size_t k = 1; k < n; ++k) {
+    const size_t victim = (i + k) % n;
+    if (Task *task = deques[victim]->steal()) {
+      return task;
+    }
+    if (Task *task = inboxes[victim]->pop()) {
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+inline void ThreadPool::worker_loop(size_t i) {
+  worker_pool() = this;
+  worker_index() = i;
+  constexpr int SPIN_COUNT = 64;
+  int spins = 0;
+  for (;;) {
+    if (Task *task = find_task(i)) {
+      pending.fetch_sub(1, std::memory_order_relaxed);
+      task->run();
+      delete task;
+      spins = 0;
+      continue;
+    }
+    if (++spins < SPIN_COUNT) {
+      std::this_thread::yield();
+      continue;
+    }
+    spins = 0;
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    sleepers.fetch_add(1, std::memory_order_seq_cst);
+    condition.wait(lock, [this] {
+      return stop.load() || pending.load(std::memory_order_seq_cst) > 0;
     });
+    sleepers.fetch_sub(1, std::memory_order_relaxed);
+    if (stop.load() && pending.load(std::memory_order_seq_cst) == 0) {
+      return;
+    }
+  }
+}
+
+template <class F, class... Args>
+auto ThreadPool::enqueue(F &&f, Args &&...args)
+    -> std::future<std::invoke_result_t<F, Args...>> {
+  return enqueue((int)next_inbox.fetch_add(1, std::memory_order_relaxed),
+                 std::forward<F>(f), std::forward<Args>(args)...);
 }
 
-// add new work item to the pool
 template <class F, class... Args>
 auto ThreadPool::enqueue(int tid, F &&f, Args &&...args)
-    -> std::future<typename std::result_of<F(Args...)>::type> {
-  using return_type = typename std::result_of<F(Args...)>::type;
+    -> std::future<std::invoke_result_t<F, Args...>> {
+  using return_type = std::invoke_result_t<F, Args...>;
 
-  auto task = std::make_shared<std::packaged_task<return_type()>>(
+  std::packaged_task<return_type()> task(
       std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+  std::future<return_type> res = task.get_future();
+  push((size_t)tid,
+       threadpool_detail::make_task([task = std::move(task)]() mutable {
+         task();
+       }));
+  return res;
+}
 
-  std::future<return_type> res = task->get_future();
-  {
-    std::unique_lock<std::mutex> lock(queue_mutex.at(tid));
+template <class F>
+void ThreadPool::parallel_for(int64_t begin, int64_t end, int64_t grain,
+                              F &&fn) {
+  if (end <= begin) {
+    return;
+  }
+  grain = std::max<int64_t>(grain, 1);
+  const int64_t num_chunks = (end - begin + grain - 1) / grain;
+  if (num_chunks == 1) {
+    fn(begin, end);
+    return;
+  }
 
-    // don't allow enqueueing after stopping the pool
-    if (stop)
-      throw std::runtime_error("enqueue on stopped ThreadPool");
+  // Chunks are claimed from a shared counter : no task per chunk, and
+  // helpers that start late find nothing left and return. Helpers may outlive
+  // this call, they only touch the shared state then.
+  struct state_t {
+    std::atomic<int64_t> next{0};
+    std::atomic<int64_t> done{0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+  };
+  auto state = std::make_shared<state_t>();
+  auto *fn_ptr = &fn;
+  auto run_chunks = [state, fn_ptr, begin, end, grain, num_chunks]() {
+    for (;;) {
+      const int64_t chunk = state->next.fetch_add(1, std::memory_order_relaxed);
+      if (chunk >= num_chunks) {
+        return;
+      }
+      const int64_t lo = begin + chunk * grain;
+      try {
+        (*fn_ptr)(lo, std::min(lo + grain, end));
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(state->error_mutex);
+        if (!state->error) {
+          state->error = std::current_exception();
+        }
+      }
+      state->done.fetch_add(1, std::memory_order_release);
+    }
+  };
 
-    tasks.at(tid).emplace([task]() { (*task)(); });
+  const size_t num_helpers =
+      std::min<size_t>(workers.size(), (size_t)num_chunks - 1);
+  for (size_t k = 0; k < num_helpers; ++k) {
+    push(next_inbox.fetch_add(1, std::memory_order_relaxed),
+         threadpool_detail::make_task(run_chunks));
+  }
+  run_chunks();
+  while (state->done.load(std::memory_order_acquire) < num_chunks) {
+    std::this_thread::yield();
+  }
+  if (state->error) {
+    std::rethrow_exception(state->error);
   }
-  condition.at(tid).notify_one();
-  return res;
 }
 
 // the destructor joins all threads
 inline ThreadPool::~ThreadPool() {
   {
-    // Acquire all locks before "STOP"ing.
-    std::vector<std::unique_lock<std::mutex>> ulocks;
-    for (int i = 0; i < workers.size(); ++i)
-      ulocks.emplace_back(queue_mutex.at(i));
-    stop = true;
-  }
-  for (int i = 0; i < workers.size(); ++i)
-    condition.at(i).notify_all();
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    stop.store(true);
+  }
+  condition.notify_all();
   for (std::thread &worker : workers)
     worker.join();
 }
@@ -0,0 +1,88 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#ifndef __TUNING_DB_H_
+#define __TUNING_DB_H_
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include "utils.h"
+
+namespace ryzenai {
+
+/*
+ * Kernel variants picked by the autotuning of the operators, per device.
+ *
+ * An operator looks its key (operator, design, weight shape ...) up before
+ * formatting its weights. With RYZENAI_AUTOTUNE=1, a key missing from the
+ * database is tuned : the operator times each eligible variant on its first
+ * use and records the fastest one. Keys missing from the database otherwise
+ * get the default variant of the operator.
+ *
+ * The database is the text file RYZENAI_TUNING_DB, ryzenai_tuning_<DEVICE>.txt
+ * by default, one "key value" line per tuned key. The keys tuned from now on
+ * are appended to it, a later line overrides an earlier one.
+ */
+class tuning_db {
+public:
+  static tuning_db &get_instance() {
+    static tuning_db db;
+    return db;
+  }
+  tuning_db(const tuning_db &) = delete;
+  tuning_db &operator=(const tuning_db &) = delete;
+
+  static bool autotune() {
+    static const bool autotune =
+        Utils::get_env_var("RYZENAI_AUTOTUNE", "0") == "1";
+    return autotune;
+  }
+
+  /* value recorded for key, false if the key wasn't tuned */
+  bool lookup(const std::string &key, std::string &value) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = table_.find(key);
+    if (it == table_.end()) {
+      return false;
+    }
+    value = it->second;
+    return true;
+  }
+
+  void record(const std::string &key, const std::string &value) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    table_[key] = value;
+    std::ofstream(fname_, std::ios::app) << key << " " << value << std::endl;
+  }
+
+private:
+  tuning_db() {
+    const auto device = Utils::get_env_var("DEVICE");
+    fname_ = Utils::get_env_var("RYZENAI_TUNING_DB",
+                                device.empty()
+                                    ? std::string("ryzenai_tuning.txt")
+                                    : "ryzenai_tuning_" + device + ".txt");
+    std::ifstream ifs(fname_);
+    std::string line;
+    while (std::getline(ifs, line)) {
+      std::istringstream iss(line);
+      std::string key, value;
+      if (iss >> key && std::getline(iss >> std::ws, value)) {
+        table_[key] = value;
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::map<std::string, std::string> table_;
+  std::string fname_;
+};
+
+} // namespace ryzenai
+
+#endif // __TUNING_DB_H_
@@ -134,6 +134,27 @@ static inline void _copy_pad_data(T *src, T *dest, int64_t *src_shape,
   }
 }
 
+// Same as _copy_pad_data for a dest that is not zero initialized, only the
+// padding columns of each row and the padding rows are zeroed
+template <typename T>
+static inline void _copy_pad_data_zero_edge(T *src, T *dest,
+                                            int64_t *src_shape,
+                                            int64_t *dest_shape) {
+  const int64_t pad_cols = dest_shape[1] - src_shape[1];
+  for (int i = 0; i < src_shape[0]; i++) {
+    memcpy((void *)&dest[i * dest_shape[1]], (void *)&src[i * src_shape[1]],
+           sizeof(T) * src_shape[1]);
+    if (pad_cols > 0) {
+      memset((void *)&dest[i * dest_shape[1] + src_shape[1]], 0,
+             sizeof(T) * pad_cols);
+    }
+  }
+  if (src_shape[0] < dest_shape[0]) {
+    memset((void *)&dest[src_shape[0] * dest_shape[1]], 0,
+           sizeof(T) * (dest_shape[0] - src_shape[0]) * dest_shape[1]);
+  }
+}
+
 template <typename T>
 static inline void _copy_depad_data(T *src, T *dest, int64_t *src_shape,
                                     int64_t *dest_shape) {
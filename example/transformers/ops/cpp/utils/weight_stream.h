@@ -0,0 +1,213 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#ifndef __WEIGHT_STREAM_H_
+#define __WEIGHT_STREAM_H_
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// XRT headers
+#include "xrt/xrt_bo.h"
+#include "xrt/xrt_hw_context.h"
+
+#include "npu_weight_file.h"
+#include "threadpool.h"
+#include "utils.h"
+
+namespace ryzenai {
+
+/*
+ * Weight streaming : the weights of the streamed operators stay in their
+ * NPU-native weight files (memory mapped, see npu_weight_file), only
+ * RYZENAI_WEIGHT_STREAM_DEPTH layers have their tiles in BOs at a time.
+ *
+ * Layers are uploaded to a rotating set of BO slots. The order the layers are
+ * acquired in is recorded on the first pass, e.g. the first token of an LLM,
+ * later acquires then upload the following depth - 1 layers on the thread
+ * pool while the acquired one runs. The BOs returned by acquire() stay valid
+ * until depth more layers have been acquired, so the streamed operators have
+ * to be executed one at a time.
+ */
+class weight_stream {
+public:
+  static weight_stream &get_instance() { return *get_shared(); }
+  weight_stream(const weight_stream &) = delete;
+  weight_stream &operator=(const weight_stream &) = delete;
+
+  size_t get_depth() const { return slots_.size(); }
+
+  /* id of a registered layer, the layer is removed with the last copy */
+  using layer_handle = std::shared_ptr<const int>;
+
+  /*
+   * register the weight file of a layer, the tiles are uploaded to BOs of
+   * the given context and memory group
+   *
+   * @return handle of the layer to acquire it with
+   */
+  layer_handle add_layer(std::shared_ptr<npu_weight_file> file,
+                         const xrt::hw_context &ctx, int memory_group) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    layers_.push_back({std::move(file), ctx, memory_group});
+    // the handle keeps the stream alive, ops may outlive the static instance
+    return layer_handle(new int(static_cast<int>(layers_.size()) - 1),
+                        [stream = get_shared()](const int *id) {
+                          stream->remove_layer(*id);
+                          delete id;
+                        });
+  }
+
+  /*
+   * BOs holding the tiles of the layer, uploaded now if they weren't
+   * prefetched. Starts the prefetch of the layers following this one.
+   */
+  std::vector<xrt::bo> &acquire(int id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (last_ >= 0 && last_ != id && layers_.at(last_).next < 0) {
+      layers_[last_].next = id;
+    }
+    last_ = id;
+
+    auto &layer = layers_.at(id);
+    if (layer.slot < 0) {
+      load(id, id);
+    }
+    auto &slot = slots_[layer.slot];
+    auto ready = slot.ready;
+
+    // prefetch the next layers of the recorded order
+    int next = layer.next;
+    for (size_t i = 1; i < slots_.size() && next >= 0 && next != id; ++i) {
+      if (layers_[next].slot < 0) {
+        load(next, id);
+      }
+      next = layers_[next].next;
+    }
+    lock.unlock();
+
+    ready.get();
+    return slot.bos;
+  }
+
+private:
+  struct layer_t {
+    std::shared_ptr<npu_weight_file> file;
+    xrt::hw_context ctx;
+    int memory_group;
+    int slot = -1;
+    /* layer acquired after this one on the first pass */
+    int next = -1;
+  };
+  struct slot_t {
+    int layer = -1;
+    std::vector<xrt::bo> bos;
+    /* context and memory group the bos were created for */
+    xrt::hw_context ctx;
+    int memory_group = 0;
+    /* upload of the tiles of layer */
+    std::shared_future<void> ready;
+  };
+
+  static const std::shared_ptr<weight_stream> &get_shared() {
+    static std::shared_ptr<weight_stream> stream(new weight_stream());
+    return stream;
+  }
+
+  weight_stream() {
+    const int depth = std::max(
+        1, std::stoi(Utils::get_env_var("RYZENAI_WEIGHT_STREAM_DEPTH", "2")));
+    slots_.resize(depth);
+  }
+
+  void remove_layer(int id) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &layer = layers_.at(id);
+    if (layer.slot >= 0) {
+      auto &slot = slots_[layer.slot];
+      if (slot.ready.valid()) {
+        slot.ready.wait();
+      }
+      slot.layer = -1;
+      layer.slot = -1;
+    }
+    for (auto &other : layers_) {
+      if (other.next == id) {
+        other.next = layer.next;
+      }
+    }
+    if (last_ == id) {
+      last_ = -1;
+    }
+    layer.file.reset();
+    layer.next = -1;
+  }
+
+  /* upload layer id to the next slot that doesn't hold layer keep */
+  void load(int id, int keep) {
+    size_t s = next_slot_++ % slots_.size();
+    if (slots_.size() > 1 && slots_[s].layer == keep) {
+      s = next_slot_++ % slots_.size();
+    }
+    auto &slot = slots_[s];
+    if (slot.ready.valid()) {
+      slot.ready.wait();
+    }
+    if (slot.layer >= 0) {
+      layers_[slot.layer].slot = -1;
+    }
+
+    auto &layer = layers_[id];
+    const auto &header = layer.file->header();
+    // BOs of the slot are reused as long as they fit the layer
+    if (slot.bos.size() < header.num_tiles ||
+        (!slot.bos.empty() &&
+         (slot.bos.front().size() != header.tile_bytes ||
+          slot.ctx.get_handle() != layer.ctx.get_handle() ||
+          slot.memory_group != layer.memory_group))) {
+      slot.bos.clear();
+      for (uint64_t i = 0; i < header.num_tiles; ++i) {
+        slot.bos.emplace_back(layer.ctx, header.tile_bytes,
+                              xrt::bo::flags::host_only, layer.memory_group);
+      }
+      slot.ctx = layer.ctx;
+      slot.memory_group = layer.memory_group;
+    }
+    slot.layer = id;
+    layer.slot = static_cast<int>(s);
+
+    auto upload = [file = layer.file, &bos = slot.bos]() {
+      const auto &header = file->header();
+      for (uint64_t i = 0; i < header.num_tiles; ++i) {
+        memcpy(bos[i].map<uint8_t *>(), file->tile(i), header.tile_bytes);
+        bos[i].sync(XCL_BO_SYNC_BO_TO_DEVICE);
+      }
+    };
+    if (id == keep) {
+      // acquired layer, nothing to overlap with
+      upload();
+      std::promise<void> done;
+      done.set_value();
+      slot.ready = done.get_future().share();
+    } else {
+      slot.ready =
+          ThreadPoolSingleton::getInstance().pool.enqueue(upload).share();
+    }
+  }
+
+  std::mutex mutex_;
+  std::vector<layer_t> layers_;
+  std::vector<slot_t> slots_;
+  size_t next_slot_ = 0;
+  int last_ = -1;
+};
+
+} // namespace ryzenai
+
+#endif // __WEIGHT_STREAM_H_
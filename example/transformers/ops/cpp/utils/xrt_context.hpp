@@ -28,16 +28,38 @@ protected:
     xclbin_ = xrt::xclbin(xclbin_fname);
 
     device_.register_xclbin(xclbin_);
-    context_ = xrt::hw_context(device_, xclbin_.get_uuid());
+    const auto &qos = get_qos();
+    context_ = qos.empty() ? xrt::hw_context(device_, xclbin_.get_uuid())
+                           : xrt::hw_context(device_, xclbin_.get_uuid(), qos);
     kernel_ = xrt::kernel(context_, KERNEL_NAME);
   }
 
+  static xrt::hw_context::qos_type &get_qos() {
+    static xrt::hw_context::qos_type qos;
+    return qos;
+  }
+  static xrt_context *&get_created() {
+    static xrt_context *created = nullptr;
+    return created;
+  }
+
 public:
   static xrt_context &get_instance(const std::string &xclbin) {
     static xrt_context ctx_(xclbin);
+    get_created() = &ctx_;
     return ctx_;
   }
 
+  // QoS of the hw context (xrt::hw_context keys, e.g. "priority", "latency",
+  // "gops", "fps"), applied when the context is created, or to the context
+  // once it is. Call it before running ops from other threads.
+  static void set_qos(const xrt::hw_context::qos_type &qos) {
+    get_qos() = qos;
+    if (get_created() != nullptr && !qos.empty()) {
+      get_created()->context_.update_qos(qos);
+    }
+  }
+
   xrt_context(const xrt_context &) = delete;
   xrt_context(const xrt_context &&) = delete;
   xrt_context &operator=(const xrt_context &) = delete;
@@ -18,13 +18,16 @@ private:
       ryzenai::bmm<uint16_t, uint16_t, uint16_t>("bfloat16", "bfloat16",
                                                  "bfloat16", false);
 
-  void run_bmm(uint16_t *aInput, uint16_t *bInput, uint16_t *aie_out, int M,
-               int K, int N, int B);
+  void run_bmm(uint16_t *aInput, const torch::Tensor &y, uint16_t *aie_out,
+               int M, int K, int N, int B, size_t cached_len);
 
 public:
   bmm_torch(bool tr);
   ~bmm_torch();
-  torch::Tensor execute(torch::Tensor x, torch::Tensor y);
+  // y can be a view into a larger KV cache, its first cached_len rows of
+  // every batch are the ones of the previous call and are not copied again
+  torch::Tensor execute(torch::Tensor x, torch::Tensor y,
+                        int64_t cached_len = 0);
 };
 } // namespace aie
 #endif
@@ -2,6 +2,8 @@
 #include <torch/extension.h>
 #include <torch/torch.h>
 
+#include "xrt_tensor.hpp"
+
 namespace aie {
 class elemw_add_torch {
 private:
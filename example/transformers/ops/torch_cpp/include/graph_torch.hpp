@@ -0,0 +1,63 @@
+#include <ATen/Functions.h>
+#include <torch/extension.h>
+#include <torch/torch.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if __has_include(<ryzenai/dynamic_dispatch/op_fuser/fusion_rt.hpp>)
+#include <ryzenai/dynamic_dispatch/op_fuser/fusion_rt.hpp>
+#else
+#include <op_fuser/fusion_rt.hpp>
+#endif
+
+namespace aie {
+// Capture / replay of a sequence of NPU ops, e.g. a decoder layer.
+// The ops are recorded once with the shapes of the tensors, lowered to a
+// DynamicDispatch subgraph whose intermediate tensors stay in the scratch
+// buffer, and each execute() is then a single FusionRuntime dispatch.
+//
+//   g.add_input("x", x); g.add_const("w", w);
+//   g.add_op("MLADFRMSNORM", {"x", "w"}, "h", h_shape);
+//   g.add_op("SILU", {"h"}, "y", h_shape);
+//   g.add_output("y"); g.compile();
+//   y = g.execute({x})[0];
+class graph_torch {
+  struct tensor_info {
+    std::vector<size_t> shape;
+    std::string dtype;
+    size_t size;
+  };
+  std::vector<OpsFusion::Metadata::OpInfo> ops_;
+  std::map<std::string, tensor_info> tensors_;
+  std::vector<std::string> inputs_;
+  std::vector<std::string> outputs_;
+  // const tensor --> file it is read from by FusionRuntime::init
+  std::map<std::string, std::string> const_files_;
+  std::unique_ptr<OpsFusion::FusionRuntime> runtime_;
+
+  void add_tensor(const std::string &name, std::vector<size_t> shape,
+                  const std::string &dtype);
+  OpsFusion::Metadata build_meta() const;
+
+public:
+  graph_torch();
+  ~graph_torch();
+  // activation given to execute(), t is only used for its shape and dtype
+  void add_input(const std::string &name, torch::Tensor t);
+  // weights, captured by value
+  void add_const(const std::string &name, torch::Tensor t);
+  // DynamicDispatch op `type` (e.g. SILU, ELWMUL, MLADFADD, MLADFRMSNORM,
+  // BMM) reading the tensors `inputs` and writing `output`
+  void add_op(const std::string &type, const std::vector<std::string> &inputs,
+              const std::string &output, std::vector<int64_t> output_shape,
+              const std::string &output_dtype = "bfloat16");
+  // result of execute(), the other op outputs are intermediate tensors
+  void add_output(const std::string &name);
+  void compile();
+  // inputs in the order of add_input(), outputs in the order of add_output()
+  std::vector<torch::Tensor> execute(const std::vector<torch::Tensor> &inputs);
+};
+} // namespace aie
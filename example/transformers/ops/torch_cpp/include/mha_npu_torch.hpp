@@ -4,6 +4,7 @@
 
 #include "../include/bmm_torch.hpp"
 #include "../include/softmax_torch.hpp"
+#include "../include/xrt_tensor.hpp"
 
 #define HEAD_DIM 128
 
@@ -2,23 +2,26 @@
 #include <torch/extension.h>
 #include <torch/torch.h>
 
-#if __has_include(<ryzenai/dynamic_dispatch/ops/elwmul/elwmul.hpp>)
-#include <ryzenai/dynamic_dispatch/ops/elwmul/elwmul.hpp>
-#else
-#include <ops/elwmul/elwmul.hpp>
-#endif
-#if __has_include(<ryzenai/dynamic_dispatch/ops/silu/silu.hpp>)
-#include <ryzenai/dynamic_dispatch/ops/silu/silu.hpp>
+#include <map>
+#include <memory>
+#include <utility>
+
+#if __has_include(<ryzenai/dynamic_dispatch/op_fuser/fusion_rt.hpp>)
+#include <ryzenai/dynamic_dispatch/op_fuser/fusion_rt.hpp>
 #else
-#include <ops/silu/silu.hpp>
+#include <op_fuser/fusion_rt.hpp>
 #endif
 
 namespace aie {
+// silu(x) * y as one DynamicDispatch subgraph : the SILU output stays in the
+// scratch buffer of the NPU and is read from there by ELWMUL.
 class mlp_npu_torch {
-  ryzenai::elw_mul<uint16_t, uint16_t, uint16_t> mulKernel =
-      ryzenai::elw_mul<uint16_t, uint16_t, uint16_t>("bfloat16", true);
-  ryzenai::silu<uint16_t, uint16_t> siluKernel =
-      ryzenai::silu<uint16_t, uint16_t>("bfloat16", true);
+  // One runtime per activation shape (rows, N)
+  std::map<std::pair<size_t, size_t>,
+           std::unique_ptr<OpsFusion::FusionRuntime>>
+      runtimes_;
+
+  OpsFusion::FusionRuntime &get_runtime(size_t M, size_t N);
 
 public:
   torch::Tensor bmm_scale;
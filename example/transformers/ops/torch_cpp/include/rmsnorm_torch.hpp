@@ -2,11 +2,21 @@
 #include <torch/extension.h>
 #include <torch/torch.h>
 
+#if __has_include(<ryzenai/dynamic_dispatch/ops/mladfrmsnorm/mladfrmsnorm.hpp>)
+#include <ryzenai/dynamic_dispatch/ops/mladfrmsnorm/mladfrmsnorm.hpp>
+#else
+#include <ops/mladfrmsnorm/mladfrmsnorm.hpp>
+#endif
+
 namespace aie {
 class rmsnorm_torch {
+  ryzenai::rms_norm<uint16_t, uint16_t, uint16_t> rmsnormKernel =
+      ryzenai::rms_norm<uint16_t, uint16_t, uint16_t>("bfloat16", true);
+
 public:
   rmsnorm_torch();
   ~rmsnorm_torch();
-  torch::Tensor execute(torch::Tensor x);
+  // x : [..., hidden], weight : [hidden], both bfloat16
+  torch::Tensor execute(torch::Tensor x, torch::Tensor weight);
 };
 } // namespace aie
@@ -2,11 +2,25 @@
 #include <torch/extension.h>
 #include <torch/torch.h>
 
+#if __has_include(<ryzenai/dynamic_dispatch/ops/mladfmharope/mladfmharope.hpp>)
+#include <ryzenai/dynamic_dispatch/ops/mladfmharope/mladfmharope.hpp>
+#else
+#include <ops/mladfmharope/mladfmharope.hpp>
+#endif
+
 namespace aie {
 class rope_torch {
+  ryzenai::mha_rope<uint16_t, uint16_t, uint16_t> ropeKernel =
+      ryzenai::mha_rope<uint16_t, uint16_t, uint16_t>("bfloat16", true);
+
 public:
+  // cos / sin are generated once by the op for these positions
+  static constexpr size_t MAX_SEQ_LEN = 4096;
+  static constexpr float ROPE_BASE = 10000.0f;
   rope_torch();
   ~rope_torch();
-  torch::Tensor execute(torch::Tensor x);
+  // x : [heads, tokens, head_dim] bfloat16, the first token is at
+  // position_offset
+  torch::Tensor execute(torch::Tensor x, int64_t position_offset);
 };
 } // namespace aie
@@ -7,6 +7,8 @@
 #include "xrt/xrt_device.h"
 #include "xrt/xrt_kernel.h"
 
+#include "xrt_tensor.hpp"
+
 #if __has_include(<ryzenai/dynamic_dispatch/ops/silu/silu.hpp>)
 #include <ryzenai/dynamic_dispatch/ops/silu/silu.hpp>
 #else
@@ -0,0 +1,29 @@
+#ifndef __XRT__TENSOR__
+#define __XRT__TENSOR__
+#include <ATen/Functions.h>
+#include <torch/extension.h>
+#include <torch/torch.h>
+
+#include <optional>
+
+// XRT headers
+#include "xrt/xrt_bo.h"
+
+namespace aie {
+// torch tensors stored in host-only XRT BOs of the MLADF overlay, the one of
+// the torch_cpp NPU ops. The BO of such a tensor can be handed to an op as
+// is, so chained ops pass tensors without copying them, and the BO lives as
+// long as the tensor does instead of being owned by an op.
+class xrt_tensor {
+public:
+  // uninitialized tensor stored in a new BO
+  static torch::Tensor empty(at::IntArrayRef sizes,
+                             at::ScalarType dtype = torch::kBFloat16);
+  // BO holding the data of t, a sub-buffer for views into a larger tensor,
+  // or nothing if t is not stored in a BO or not contiguous
+  static std::optional<xrt::bo> bo(const torch::Tensor &t);
+  // t if it is stored in a BO, a copy in a new BO otherwise
+  static torch::Tensor to_xrt(const torch::Tensor &t);
+};
+} // namespace aie
+#endif
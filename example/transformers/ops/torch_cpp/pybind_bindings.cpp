@@ -2,6 +2,7 @@
 #include "./include/elemw_add_torch.hpp"
 #include "./include/elemw_mul_torch.hpp"
 #include "./include/gemm_torch.hpp"
+#include "./include/graph_torch.hpp"
 #include "./include/linear.hpp"
 #include "./include/mha.hpp"
 #include "./include/mha_npu_torch.hpp"
@@ -13,6 +14,7 @@
 #include "./include/silu_torch.hpp"
 #include "./include/softmax_torch.hpp"
 #include "./include/torch_linear.hpp"
+#include "./include/xrt_tensor.hpp"
 
 PYBIND11_MODULE(_ryzenai_torch_cpp, m) {
   py::class_<cpu::qlinear>(m, "cpu_qlinear")
@@ -55,7 +57,8 @@ PYBIND11_MODULE(_ryzenai_torch_cpp, m) {
 
   py::class_<aie::bmm_torch>(m, "aie_bmm_torch")
       .def(py::init<bool>())
-      .def("execute", &aie::bmm_torch::execute, "AIE bfloat16 execute");
+      .def("execute", &aie::bmm_torch::execute, "AIE bfloat16 execute",
+           py::arg("x"), py::arg("y"), py::arg("cached_len") = 0);
 
   py::class_<aie::elemw_add_torch>(m, "aie_elemw_add_torch")
       .def(py::init<>())
@@ -77,15 +80,41 @@ PYBIND11_MODULE(_ryzenai_torch_cpp, m) {
 
   py::class_<aie::rope_torch>(m, "aie_rope_torch")
       .def(py::init<>())
-      .def("execute", &aie::rope_torch::execute, "AIE bfloat16 execute");
+      .def("execute", &aie::rope_torch::execute, "AIE bfloat16 execute",
+           py::arg("x"), py::arg("position_offset") = 0);
 
   py::class_<aie::rmsnorm_torch>(m, "aie_rmsnorm_torch")
       .def(py::init<>())
-      .def("execute", &aie::rmsnorm_torch::execute, "AIE bfloat16 execute");
+      .def("execute", &aie::rmsnorm_torch::execute, "AIE bfloat16 execute",
+           py::arg("x"), py::arg("weight"));
 
   py::class_<aie::gemm_torch>(m, "aie_gemm_torch")
       .def(py::init<int, int, int, bool>())
       .def("initialize_params", &aie::gemm_torch::initialize_params,
            "Set weights, scales, bias, zeros for this layer")
       .def("execute", &aie::gemm_torch::execute, "AIE bfloat16 execute");
+
+  py::class_<aie::graph_torch>(m, "aie_graph_torch")
+      .def(py::init<>())
+      .def("add_input", &aie::graph_torch::add_input,
+           "Capture an activation given to execute")
+      .def("add_const", &aie::graph_torch::add_const, "Capture a weight")
+      .def("add_op", &aie::graph_torch::add_op, "Capture a DynamicDispatch op",
+           py::arg("type"), py::arg("inputs"), py::arg("output"),
+           py::arg("output_shape"), py::arg("output_dtype") = "bfloat16")
+      .def("add_output", &aie::graph_torch::add_output,
+           "Capture a result of execute")
+      .def("compile", &aie::graph_torch::compile,
+           "Lower the captured ops to a subgraph")
+      .def("execute", &aie::graph_torch::execute, "Replay the subgraph");
+
+  py::class_<aie::xrt_tensor>(m, "aie_xrt_tensor")
+      .def_static(
+          "empty",
+          [](std::vector<int64_t> sizes) {
+            return aie::xrt_tensor::empty(sizes);
+          },
+          "bfloat16 tensor stored in an XRT BO")
+      .def_static("to_xrt", &aie::xrt_tensor::to_xrt,
+                  "Tensor stored in an XRT BO, copied if needed");
 }
@@ -27,8 +27,9 @@ aie::bmm_torch::bmm_torch(bool tr) {
 
 aie::bmm_torch::~bmm_torch() {}
 
-void aie::bmm_torch::run_bmm(uint16_t *aInput, uint16_t *bInput,
-                             uint16_t *aie_out, int M, int K, int N, int B) {
+void aie::bmm_torch::run_bmm(uint16_t *aInput, const torch::Tensor &y,
+                             uint16_t *aie_out, int M, int K, int N, int B,
+                             size_t cached_len) {
   int BM = B * M;
   size_t BMs = static_cast<size_t>(BM);
   size_t Ks = static_cast<size_t>(K);
@@ -38,8 +39,20 @@ void aie::bmm_torch::run_bmm(uint16_t *aInput, uint16_t *bInput,
   std::vector<size_t> b_shape = {BKs, Ns};
   std::vector<size_t> aie_out_shape = {BMs, Ns};
   std::vector<Tensor> const_Tensor;
-  const_Tensor = {{bInput, b_shape, "bfloat16"}};
-  aie::bmm_torch::bmmKernel.initialize_const_params(const_Tensor);
+  if (y.stride(2) == 1) {
+    // read the [B, rows, cols] view of y in place, whatever its strides
+    std::vector<size_t> y_shape = {(size_t)y.size(0), (size_t)y.size(1),
+                                   (size_t)y.size(2)};
+    std::vector<size_t> y_strides = {(size_t)y.stride(0),
+                                     (size_t)y.stride(1)};
+    const_Tensor = {{y.data_ptr(), y_shape, "bfloat16"}};
+    aie::bmm_torch::bmmKernel.initialize_const_params(
+        const_Tensor, {{"strides", y_strides}, {"cached_rows", cached_len}});
+  } else {
+    auto y_contiguous = y.contiguous();
+    const_Tensor = {{y_contiguous.data_ptr(), b_shape, "bfloat16"}};
+    aie::bmm_torch::bmmKernel.initialize_const_params(const_Tensor);
+  }
   std::vector<Tensor> input_Tensor;
   input_Tensor = {{aInput, a_shape, "bfloat16"}};
   std::vector<Tensor> output_Tensor;
@@ -47,7 +60,8 @@ void aie::bmm_torch::run_bmm(uint16_t *aInput, uint16_t *bInput,
   aie::bmm_torch::bmmKernel.execute(input_Tensor, output_Tensor);
 }
 
-torch::Tensor aie::bmm_torch::execute(torch::Tensor x, torch::Tensor y) {
+torch::Tensor aie::bmm_torch::execute(torch::Tensor x, torch::Tensor y,
+                                      int64_t cached_len) {
   int B = x.sizes()[0];
   int M = x.sizes()[1];
   int K = x.sizes()[2];
@@ -57,8 +71,7 @@ torch::Tensor aie::bmm_torch::execute(torch::Tensor x, torch::Tensor y) {
   }
   auto z = torch::empty({B, M, N}).to(torch::kBFloat16);
   auto xCasted = static_cast<uint16_t *>(x.data_ptr());
-  auto yCasted = static_cast<uint16_t *>(y.data_ptr());
   auto zCasted = static_cast<uint16_t *>(z.data_ptr());
-  run_bmm(xCasted, yCasted, zCasted, M, K, N, B);
+  run_bmm(xCasted, y, zCasted, M, K, N, B, (size_t)cached_len);
   return z;
 }
@@ -17,18 +17,16 @@ aie::elemw_add_torch::elemw_add_torch() {}
 aie::elemw_add_torch::~elemw_add_torch() {}
 
 template <typename InOutT = int16_t>
-InOutT *run_mladfadd(InOutT *aInput, InOutT *bInput, size_t M, size_t K,
-                     bool debug = false,
-                     const std::string &a_dtype = "bfloat16",
-                     const std::string &b_dtype = "bfloat16",
-                     const std::string &c_dtype = "bfloat16") {
+void run_mladfadd(InOutT *aInput, InOutT *bInput, InOutT *aie_out, size_t M,
+                  size_t K, bool debug = false,
+                  const std::string &a_dtype = "bfloat16",
+                  const std::string &b_dtype = "bfloat16",
+                  const std::string &c_dtype = "bfloat16") {
 
   std::vector<size_t> a_shape = {M, K};
   std::vector<size_t> b_shape = a_shape;
   std::vector<size_t> aie_out_shape = a_shape;
 
-  InOutT *aie_out = new InOutT[M * K];
-
   ryzenai::mladf_add mladfaddKernel =
       ryzenai::mladf_add<InOutT, InOutT, InOutT>(a_dtype, true);
 
@@ -37,7 +35,6 @@ InOutT *run_mladfadd(InOutT *aInput, InOutT *bInput, size_t M, size_t K,
   std::vector<Tensor> output_Tensor;
   output_Tensor = {{aie_out, aie_out_shape, c_dtype}};
   mladfaddKernel.execute(input_Tensor, output_Tensor);
-  return aie_out;
 }
 
 torch::Tensor aie::elemw_add_torch::execute(torch::Tensor x, torch::Tensor y) {
@@ -54,14 +51,14 @@ torch::Tensor aie::elemw_add_torch::execute(torch::Tensor x, torch::Tensor y) {
 
   auto xCasted = static_cast<uint16_t *>(x.data_ptr());
   auto yCasted = static_cast<uint16_t *>(y.data_ptr());
-  uint16_t *c;
+  // owned by the tensor, and stored in a BO so that the sum can be passed
+  // on to another NPU op without a copy
+  torch::Tensor out = xrt_tensor::empty({x.sizes()[0], x.sizes()[1]});
+  auto outCasted = static_cast<uint16_t *>(out.data_ptr());
 
   if (std::string((Utils::get_env_var("DEVICE"))) == "stx") {
-    c = run_mladfadd<uint16_t>(xCasted, yCasted, M, K, false, "bfloat16",
-                               "bfloat16", "bfloat16");
+    run_mladfadd<uint16_t>(xCasted, yCasted, outCasted, M, K, false,
+                           "bfloat16", "bfloat16", "bfloat16");
   }
-
-  torch::Tensor out =
-      torch::from_blob(c, {x.sizes()[0], x.sizes()[1]}, torch::kBFloat16);
   return out;
 }
@@ -0,0 +1,241 @@
+#include "../include/graph_torch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#if __has_include(<ryzenai/dynamic_dispatch/ops/ops_common.hpp>)
+#include <ryzenai/dynamic_dispatch/ops/ops_common.hpp>
+#else
+#include <ops/ops_common.hpp>
+#endif
+
+namespace {
+std::string dtype_name(at::ScalarType type) {
+  switch (type) {
+  case torch::kBFloat16:
+    return "bfloat16";
+  case torch::kFloat:
+    return "float";
+  case torch::kInt8:
+    return "int8";
+  case torch::kUInt8:
+    return "uint8";
+  // torch has no uint16, the a16 ops take their activations as int16
+  case torch::kInt16:
+    return "uint16";
+  case torch::kInt32:
+    return "int32";
+  default:
+    throw std::runtime_error("graph_torch : unsupported dtype " +
+                             std::string(c10::toString(type)));
+  }
+}
+
+at::ScalarType scalar_type(const std::string &dtype) {
+  if (dtype == "bfloat16") {
+    return torch::kBFloat16;
+  }
+  if (dtype == "float") {
+    return torch::kFloat;
+  }
+  if (dtype == "int32") {
+    return torch::kInt32;
+  }
+  if (dtype == "uint16" || dtype == "int16") {
+    return torch::kInt16;
+  }
+  return (dtype == "int8") ? torch::kInt8 : torch::kUInt8;
+}
+
+size_t dtype_size(const std::string &dtype) {
+  if (dtype == "float" || dtype == "int32") {
+    return 4;
+  }
+  if (dtype == "bfloat16" || dtype == "uint16" || dtype == "int16") {
+    return 2;
+  }
+  return 1;
+}
+
+std::vector<size_t> to_shape(at::IntArrayRef sizes) {
+  return std::vector<size_t>(sizes.begin(), sizes.end());
+}
+
+std::atomic<uint64_t> graph_count = 0;
+} // namespace
+
+aie::graph_torch::graph_torch() {}
+
+aie::graph_torch::~graph_torch() {
+  std::error_code ec;
+  for (const auto &[name, fname] : const_files_) {
+    std::filesystem::remove(fname, ec);
+  }
+}
+
+void aie::graph_torch::add_tensor(const std::string &name,
+                                  std::vector<size_t> shape,
+                                  const std::string &dtype) {
+  if (runtime_ != nullptr) {
+    throw std::runtime_error("graph_torch : graph is already compiled");
+  }
+  if (tensors_.find(name) != tensors_.end()) {
+    throw std::runtime_error("graph_torch : tensor " + name +
+                             " is already defined");
+  }
+  size_t size = dtype_size(dtype);
+  for (auto dim : shape) {
+    size *= dim;
+  }
+  tensors_[name] = {std::move(shape), dtype, size};
+}
+
+void aie::graph_torch::add_input(const std::string &name, torch::Tensor t) {
+  add_tensor(name, to_shape(t.sizes()), dtype_name(t.scalar_type()));
+  inputs_.push_back(name);
+}
+
+void aie::graph_torch::add_const(const std::string &name, torch::Tensor t) {
+  add_tensor(name, to_shape(t.sizes()), dtype_name(t.scalar_type()));
+  // FusionRuntime reads the consts from files when it is initialized
+  static const auto dir =
+      std::filesystem::temp_directory_path() / "ryzenai_graph_torch";
+  std::filesystem::create_directories(dir);
+  const auto fname =
+      (dir / (std::to_string(graph_count++) + "_" + name + ".bin")).string();
+  auto data = t.contiguous();
+  std::ofstream ofs(fname, std::ios::binary);
+  ofs.write((const char *)data.data_ptr(), data.nbytes());
+  if (!ofs) {
+    throw std::runtime_error("graph_torch : failed to write " + fname);
+  }
+  const_files_[name] = fname;
+}
+
+void aie::graph_torch::add_op(const std::string &type,
+                              const std::vector<std::string> &inputs,
+                              const std::string &output,
+                              std::vector<int64_t> output_shape,
+                              const std::string &output_dtype) {
+  for (const auto &input : inputs) {
+    if (tensors_.find(input) == tensors_.end()) {
+      throw std::runtime_error("graph_torch : " + type + " reads tensor " +
+                               input + " before it is defined");
+    }
+  }
+  add_tensor(output,
+             std::vector<size_t>(output_shape.begin(), output_shape.end()),
+             output_dtype);
+  std::vector<std::string> args = inputs;
+  args.push_back(output);
+  ops_.push_back({type + "_" + std::to_string(ops_.size()), type, args, {}});
+}
+
+void aie::graph_torch::add_output(const std::string &name) {
+  if (tensors_.find(name) == tensors_.end() ||
+      std::find(inputs_.begin(), inputs_.end(), name) != inputs_.end() ||
+      const_files_.count(name)) {
+    throw std::runtime_error("graph_torch : " + name +
+                             " is not the output of an op");
+  }
+  outputs_.push_back(name);
+}
+
+// Inputs are packed by the order of add_input(), outputs by the order of
+// add_output() and the other tensors written by the ops go to the scratch
+// buffer. The buffer sizes and offsets are fixed up by the passes of
+// FusionRuntime::init.
+OpsFusion::Metadata aie::graph_torch::build_meta() const {
+  OpsFusion::Metadata meta;
+  meta.op_list = ops_;
+  meta.fused_tensors = {{"in", {0, 0, inputs_}},
+                        {"out", {0, 1, outputs_}},
+                        {"scratch", {0, 2, {}}},
+                        {"const", {0, 3, {}}},
+                        {"super_instr", {0, 4, {}}}};
+  auto add = [&](const std::string &name, const std::string &parent) {
+    const auto &tinfo = tensors_.at(name);
+    auto &fused = meta.fused_tensors.at(parent);
+    auto &info = meta.tensor_map[name];
+    info.parent_name = parent;
+    info.arg_idx = fused.arg_idx;
+    info.dtype = tinfo.dtype;
+    info.shape = tinfo.shape;
+    info.size_in_bytes = tinfo.size;
+    info.offset = 0;
+    info.file_size = 0;
+    if (parent == "const") {
+      info.file_name = const_files_.at(name);
+      info.file_size = tinfo.size;
+    } else {
+      info.offset = fused.size;
+      fused.size += tinfo.size;
+    }
+  };
+  for (const auto &name : inputs_) {
+    add(name, "in");
+  }
+  for (const auto &name : outputs_) {
+    add(name, "out");
+  }
+  for (const auto &[name, fname] : const_files_) {
+    meta.fused_tensors.at("const").packed_tensors.push_back(name);
+    add(name, "const");
+  }
+  for (const auto &op : ops_) {
+    const auto &name = op.args.back();
+    if (meta.tensor_map.find(name) == meta.tensor_map.end()) {
+      meta.fused_tensors.at("scratch").packed_tensors.push_back(name);
+      add(name, "scratch");
+    }
+  }
+  return meta;
+}
+
+void aie::graph_torch::compile() {
+  if (ops_.empty() || outputs_.empty()) {
+    throw std::runtime_error("graph_torch : nothing to compile");
+  }
+  using namespace ryzenai;
+  runtime_ = std::make_unique<OpsFusion::FusionRuntime>(
+      OpInterface::get_dod_base_dir() +
+      LLAMA2_MLADF_2x4x4_GEMMBFP16_SILU_MUL_MHA_RMS_ROPE_XCLBIN_PATH);
+  runtime_->init(build_meta());
+}
+
+std::vector<torch::Tensor>
+aie::graph_torch::execute(const std::vector<torch::Tensor> &inputs) {
+  if (runtime_ == nullptr) {
+    compile();
+  }
+  if (inputs.size() != inputs_.size()) {
+    throw std::runtime_error("graph_torch : expected " +
+                             std::to_string(inputs_.size()) + " inputs");
+  }
+  // the subgraph is specialized for the captured shapes
+  std::vector<torch::Tensor> args;
+  std::vector<Tensor> in_tensors;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    const auto &tinfo = tensors_.at(inputs_[i]);
+    if (to_shape(inputs[i].sizes()) != tinfo.shape) {
+      throw std::runtime_error("graph_torch : shape of input " + inputs_[i] +
+                               " differs from the captured one");
+    }
+    args.push_back(inputs[i].contiguous());
+    in_tensors.push_back({args.back().data_ptr(), tinfo.shape, tinfo.dtype});
+  }
+  std::vector<torch::Tensor> outputs;
+  std::vector<Tensor> out_tensors;
+  for (const auto &name : outputs_) {
+    const auto &tinfo = tensors_.at(name);
+    std::vector<int64_t> sizes(tinfo.shape.begin(), tinfo.shape.end());
+    outputs.push_back(torch::empty(sizes, scalar_type(tinfo.dtype)));
+    out_tensors.push_back({outputs.back().data_ptr(), tinfo.shape,
+                           tinfo.dtype});
+  }
+  runtime_->execute(in_tensors, out_tensors);
+  return outputs;
+}
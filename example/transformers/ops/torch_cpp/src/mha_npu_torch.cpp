@@ -1,6 +1,7 @@
 ﻿#include "../include/mha_npu_torch.hpp"
 
 #include "logging.h"
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <tuple>
@@ -10,11 +11,35 @@
 using namespace ryzenai;
 #endif
 
+namespace {
+// The BO of t when it is an xrt_tensor at least as large as the kernel
+// operand, no copy is then needed. Otherwise t is copied to the op BO.
+xrt::bo input_bo(const torch::Tensor &t, xrt::bo &op_bo) {
+  // a [B, rows, cols] view into a larger buffer, e.g. a KV cache slice, is
+  // gathered into the op BO without a contiguous copy first
+  if (!t.is_contiguous() && t.dim() == 3 && t.stride(2) == 1) {
+    std::vector<size_t> shape = {(size_t)t.size(0), (size_t)t.size(1),
+                                 (size_t)t.size(2)};
+    std::vector<size_t> strides = {(size_t)t.stride(0), (size_t)t.stride(1)};
+    ryzenai::bmm<uint16_t, uint16_t, uint16_t>::write_strided(
+        op_bo, {t.data_ptr(), shape, "bfloat16"}, strides);
+    return op_bo;
+  }
+  auto bo = aie::xrt_tensor::bo(t);
+  if (!bo.has_value() || bo->size() < op_bo.size()) {
+    memcpy(op_bo.map<void *>(), t.data_ptr(), t.nbytes());
+    bo = op_bo;
+  }
+  bo->sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  return *bo;
+}
+} // namespace
+
 aie::mha_npu_torch::mha_npu_torch() {
-  const float sc[] = {(float)HEAD_DIM};
-  bmm_scale = torch::from_blob((void *)sc, {1, 1});
-  bmm_scale = 1 / torch::sqrt(bmm_scale);
-  bmm_scale = bmm_scale.to(torch::kBFloat16);
+  // 1 / sqrt(HEAD_DIM), the same for all the instances
+  static const torch::Tensor scale =
+      torch::full({1, 1}, 1 / std::sqrt((float)HEAD_DIM), torch::kBFloat16);
+  bmm_scale = scale;
 
   bmm1.debug(false);
   bmm2.debug(false);
@@ -38,66 +63,59 @@ torch::Tensor aie::mha_npu_torch::execute(torch::Tensor query_states,
                                           torch::Tensor key_states,
                                           torch::Tensor value_states,
                                           torch::Tensor attention_mask) {
-  int64_t exec_start = 0, exec_end = 0, time0 = 0, time1 = 0, time2 = 0,
-          time3 = 0;
+  int64_t exec_start = 0, exec_end = 0, time0 = 0, time1 = 0, time2 = 0;
   int B = query_states.sizes()[0];
   int M = query_states.sizes()[1];
   int K = query_states.sizes()[2];
-  int N = key_states.sizes()[1];
   exec_start = GET_ELAPSED_TIME_NS();
 
-  auto xCasted = static_cast<uint16_t *>(query_states.data_ptr());
-  auto yCasted = static_cast<uint16_t *>(key_states.data_ptr());
-  auto mCasted = static_cast<uint16_t *>(attention_mask.data_ptr());
-  auto y2Casted = static_cast<uint16_t *>(value_states.data_ptr());
-  uint16_t *a_bo_map = bmm1_inputs[0].map<uint16_t *>();
-  memcpy((void *)a_bo_map, (void *)xCasted, B * M * K * sizeof(uint16_t));
-  uint16_t *b_bo_map = bmm1_inputs[1].map<uint16_t *>();
-  memcpy((void *)b_bo_map, (void *)yCasted, B * K * N * sizeof(uint16_t));
+  xrt::bo q_bo = input_bo(query_states, bmm1_inputs[0]);
+  xrt::bo k_bo = input_bo(key_states, bmm1_inputs[1]);
+  xrt::bo mask_bo = input_bo(attention_mask, softmax_mask);
+  xrt::bo v_bo = input_bo(value_states, bmm2_inputs[1]);
 
-  uint16_t *out = bmm2_outputs[0].map<uint16_t *>();
-
-  bmm1_inputs[0].sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  bmm1_inputs[1].sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  bmm1_outputs[0].sync(XCL_BO_SYNC_BO_TO_DEVICE);
+  // the output is written in place unless it is smaller than the kernel one
+  auto bmm2_out = xrt_tensor::empty({B, M, K});
+  xrt::bo out_bo = *xrt_tensor::bo(bmm2_out);
+  const bool in_place = out_bo.size() >= bmm2_outputs[0].size();
+  if (!in_place) {
+    out_bo = bmm2_outputs[0];
+  }
 
   exec_end = GET_ELAPSED_TIME_NS();
   time0 = exec_end - exec_start;
 
+  // QK^T, softmax and the product with V are chained through their BOs and
+  // submitted back to back : the scores and probabilities stay on device
+  // and there is a single wait
   exec_start = GET_ELAPSED_TIME_NS();
-  bmm1.execute(bmm1_inputs, bmm1_outputs);
+  std::vector<xrt::bo> bmm1_in = {q_bo, k_bo};
+  std::vector<xrt::bo> softmax_in = {bmm1_outputs[0], mask_bo};
+  std::vector<xrt::bo> softmax_out = {bmm2_inputs[0]};
+  std::vector<xrt::bo> bmm2_in = {bmm2_inputs[0], v_bo};
+  std::vector<xrt::bo> bmm2_out_bo = {out_bo};
+  auto bmm1_run = bmm1.submit(bmm1_in, bmm1_outputs);
+  auto softmax_run = softmax.submit(softmax_in, softmax_out);
+  auto bmm2_run = bmm2.submit(bmm2_in, bmm2_out_bo);
+  bmm1_run.wait2();
+  softmax_run.wait2();
+  bmm2_run.wait2();
 
   exec_end = GET_ELAPSED_TIME_NS();
   time1 = exec_end - exec_start;
 
   exec_start = GET_ELAPSED_TIME_NS();
-  uint16_t *mask_bo_map = softmax_mask.map<uint16_t *>();
-  memcpy((void *)mask_bo_map, (void *)mCasted, M * N * sizeof(uint16_t));
-  softmax_mask.sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  bmm2_inputs[1].sync(XCL_BO_SYNC_BO_TO_DEVICE);
-
-  std::vector<xrt::bo> inputs = {bmm1_outputs[0], softmax_mask};
-  std::vector<xrt::bo> outputs = {bmm2_inputs[0]};
-  softmax.execute(inputs, outputs);
+  out_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+  if (!in_place) {
+    memcpy(bmm2_out.data_ptr(), out_bo.map<void *>(),
+           B * M * K * sizeof(uint16_t));
+  }
 
   exec_end = GET_ELAPSED_TIME_NS();
   time2 = exec_end - exec_start;
-
-  exec_start = GET_ELAPSED_TIME_NS();
-  uint16_t *value_bo_map = bmm2_inputs[1].map<uint16_t *>();
-  memcpy((void *)value_bo_map, (void *)y2Casted, B * N * K * sizeof(uint16_t));
-  bmm2_inputs[1].sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  bmm2_outputs[0].sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  bmm2.execute(bmm2_inputs, bmm2_outputs);
-  bmm2_outputs[0].sync(XCL_BO_SYNC_BO_FROM_DEVICE);
-
-  exec_end = GET_ELAPSED_TIME_NS();
-  time3 = exec_end - exec_start;
-  auto bmm2_out = torch::from_blob((void *)out, {B, M, K}, torch::kBFloat16);
-  RYZENAI_LOG_INFO(
-      std::string("aie::mha_npu_torch::execute  bmm1 ") +
-      std::string(" prepare ") + std::to_string(time0) std::to_string(time1) +
-      std::string(" softmax ") + std::to_string(time2) std::string(" bmm2 ") +
-      std::to_string(time3) + std::string("\n"));
+  RYZENAI_LOG_INFO(std::string("aie::mha_npu_torch::execute prepare ") +
+                   std::to_string(time0) + std::string(" attention ") +
+                   std::to_string(time1) + std::string(" output ") +
+                   std::to_string(time2) + std::string("\n"));
   return bmm2_out;
 }
@@ -6,19 +6,63 @@
 #include <tuple>
 #include <vector>
 
+#if __has_include(<ryzenai/dynamic_dispatch/ops/ops_common.hpp>)
+#include <ryzenai/dynamic_dispatch/ops/ops_common.hpp>
+#else
+#include <ops/ops_common.hpp>
+#endif
+
 #ifdef RYZENAI_PERF
 using namespace ryzenai;
 #endif
 
-aie::mlp_npu_torch::mlp_npu_torch() {
-  siluKernel.debug(false);
-  mulKernel.debug(false);
+namespace {
+// Metadata of y * silu(x), all tensors being [1, M, N] bfloat16.
+// Only the packing of the tensors is given, the buffer sizes and offsets
+// are computed by the passes of FusionRuntime::init.
+OpsFusion::Metadata silu_mul_meta(size_t M, size_t N) {
+  const std::vector<size_t> shape = {1, M, N};
+  const size_t size = M * N * sizeof(uint16_t);
+
+  OpsFusion::Metadata meta;
+  meta.op_list = {{"silu", "SILU", {"x", "silu_out"}, {}},
+                  {"mul", "ELWMUL", {"silu_out", "y", "out"}, {}}};
+  // xrt arg ids of the packed buffers
+  meta.fused_tensors = {{"in", {2 * size, 0, {"x", "y"}}},
+                        {"out", {size, 1, {"out"}}},
+                        {"scratch", {size, 2, {"silu_out"}}},
+                        {"const", {0, 3, {}}},
+                        {"super_instr", {0, 4, {}}}};
+  meta.tensor_map = {
+      {"x", {"in", 0, 0, "bfloat16", shape, size, "", 0}},
+      {"y", {"in", size, 0, "bfloat16", shape, size, "", 0}},
+      {"silu_out", {"scratch", 0, 2, "bfloat16", shape, size, "", 0}},
+      {"out", {"out", 0, 1, "bfloat16", shape, size, "", 0}}};
+  meta.max_op_scratch_pad_size = 0;
+  meta.max_tensor_padding_sz = 0;
+  return meta;
 }
+} // namespace
+
+aie::mlp_npu_torch::mlp_npu_torch() {}
 
 aie::mlp_npu_torch::~mlp_npu_torch() {}
 
 void aie::mlp_npu_torch::initialize_weights(torch::Tensor data) {}
 
+OpsFusion::FusionRuntime &aie::mlp_npu_torch::get_runtime(size_t M,
+                                                          size_t N) {
+  auto &rt = runtimes_[{M, N}];
+  if (rt == nullptr) {
+    using namespace ryzenai;
+    rt = std::make_unique<OpsFusion::FusionRuntime>(
+        OpInterface::get_dod_base_dir() +
+        LLAMA2_MLADF_2x4x4_GEMMBFP16_SILU_MUL_MHA_RMS_ROPE_XCLBIN_PATH);
+    rt->init(silu_mul_meta(M, N));
+  }
+  return *rt;
+}
+
 torch::Tensor aie::mlp_npu_torch::execute(torch::Tensor x, torch::Tensor y) {
 
   int K = 1;
@@ -34,37 +78,17 @@ torch::Tensor aie::mlp_npu_torch::execute(torch::Tensor x, torch::Tensor y) {
     N = x.sizes()[2];
   }
 
-  auto xCasted = static_cast<uint16_t *>(x.data_ptr());
-  auto yCasted = static_cast<uint16_t *>(y.data_ptr());
-  std::vector<size_t> a_shape = {static_cast<size_t>(K * M),
-                                 static_cast<size_t>(N)};
+  x = x.contiguous();
+  y = y.contiguous();
+  auto out = torch::empty(x.sizes(), x.options());
 
-  torch::Tensor out;
-  size_t Ms = static_cast<size_t>(M);
+  size_t Ms = static_cast<size_t>(K * M);
   size_t Ns = static_cast<size_t>(N);
-  std::vector<size_t> a_shape_silu = {Ms, Ns};
-  siluKernel.set_kernel_shape(a_shape_silu);
-  auto inputs = siluKernel.get_inputs();
-  auto outputs = siluKernel.get_outputs();
-  uint16_t *a_bo_map = inputs[0].map<uint16_t *>();
-  memcpy((void *)a_bo_map, (void *)xCasted, Ms * Ns * sizeof(uint16_t));
-  inputs[0].sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  outputs[0].sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  siluKernel.execute(inputs, outputs);
-
-  auto inputs_mul = mulKernel.get_inputs();
-  auto outputs_mul = mulKernel.get_outputs();
-  mulKernel.set_kernel_shape(a_shape);
-  uint16_t *b_bo_map = inputs_mul[1].map<uint16_t *>();
-  memcpy((void *)b_bo_map, (void *)yCasted, M * K * N * sizeof(uint16_t));
-  inputs_mul[1].sync(XCL_BO_SYNC_BO_TO_DEVICE);
-
-  outputs_mul[0].sync(XCL_BO_SYNC_BO_TO_DEVICE);
-  std::vector<xrt::bo> inputs_2 = {outputs[0], inputs_mul[1]};
-  mulKernel.execute(inputs_2, outputs_mul);
-  uint16_t *c_bo_map = outputs_mul[0].map<uint16_t *>();
-
-  out = torch::from_blob((void *)c_bo_map, x.sizes(), torch::kBFloat16);
+  std::vector<size_t> shape = {1, Ms, Ns};
+  std::vector<Tensor> inputs = {{x.data_ptr(), shape, "bfloat16"},
+                                {y.data_ptr(), shape, "bfloat16"}};
+  std::vector<Tensor> outputs = {{out.data_ptr(), shape, "bfloat16"}};
+  get_runtime(Ms, Ns).execute(inputs, outputs);
 
   return out;
 }
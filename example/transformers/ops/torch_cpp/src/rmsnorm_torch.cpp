@@ -1,10 +1,61 @@
 #include "../include/rmsnorm_torch.hpp"
 
-aie::rmsnorm_torch::rmsnorm_torch() {}
+#include <algorithm>
+#include <vector>
+
+namespace {
+// rows of the rmsnorm kernels : powers of 2 in [128, 2048]
+constexpr int64_t MIN_ROWS = 128;
+constexpr int64_t MAX_ROWS = 2048;
+
+int64_t kernel_rows(int64_t rows) {
+  int64_t M = MIN_ROWS;
+  while (M < rows) {
+    M *= 2;
+  }
+  return M;
+}
+} // namespace
+
+aie::rmsnorm_torch::rmsnorm_torch() {
+  rmsnormKernel.debug(false);
+  std::vector<Tensor> const_params;
+  rmsnormKernel.initialize_const_params(const_params);
+}
 aie::rmsnorm_torch::~rmsnorm_torch() {}
 
-torch::Tensor aie::rmsnorm_torch::execute(torch::Tensor x) {
+torch::Tensor aie::rmsnorm_torch::execute(torch::Tensor x,
+                                          torch::Tensor weight) {
+  // no copies for contiguous bfloat16 inputs : the kernel reads the rows of
+  // x and writes the rows of z in place
+  auto sizes = x.sizes().vec();
+  const int64_t K = sizes.back();
+  auto x2d = x.to(torch::kBFloat16).contiguous().view({-1, K});
+  auto w = weight.to(torch::kBFloat16).contiguous();
+  const int64_t rows = x2d.size(0);
+  auto z = torch::empty({rows, K}, torch::kBFloat16);
 
-  // to be implemented
-  return x;
+  std::vector<size_t> w_shape = {(size_t)K};
+  for (int64_t r = 0; r < rows; r += MAX_ROWS) {
+    const int64_t n = std::min(MAX_ROWS, rows - r);
+    const int64_t M = kernel_rows(n);
+    auto in = x2d.narrow(0, r, n);
+    auto out = z.narrow(0, r, n);
+    // rows are normalized independently, zero rows pad to the kernel shape
+    if (M != n) {
+      in = torch::zeros({M, K}, torch::kBFloat16);
+      in.narrow(0, 0, n).copy_(x2d.narrow(0, r, n));
+      out = torch::empty({M, K}, torch::kBFloat16);
+    }
+    std::vector<size_t> a_shape = {(size_t)M, (size_t)K};
+    std::vector<Tensor> input_Tensor = {{in.data_ptr(), a_shape, "bfloat16"},
+                                        {w.data_ptr(), w_shape, "bfloat16"}};
+    std::vector<Tensor> output_Tensor = {
+        {out.data_ptr(), a_shape, "bfloat16"}};
+    rmsnormKernel.execute(input_Tensor, output_Tensor);
+    if (M != n) {
+      z.narrow(0, r, n).copy_(out.narrow(0, 0, n));
+    }
+  }
+  return z.view(sizes);
 }
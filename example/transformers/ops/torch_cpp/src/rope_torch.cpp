@@ -1,10 +1,61 @@
 #include "../include/rope_torch.hpp"
 
-aie::rope_torch::rope_torch() {}
+#include <algorithm>
+#include <vector>
+
+namespace {
+// tokens of the mharope kernels : powers of 2 in [128, 4096]
+constexpr int64_t MIN_ROWS = 128;
+constexpr int64_t MAX_ROWS = 4096;
+
+int64_t kernel_rows(int64_t rows) {
+  int64_t M = MIN_ROWS;
+  while (M < rows) {
+    M *= 2;
+  }
+  return M;
+}
+} // namespace
+
+aie::rope_torch::rope_torch() {
+  ropeKernel.debug(false);
+  std::vector<Tensor> const_params;
+  ropeKernel.initialize_const_params(const_params);
+  ropeKernel.set_trig_table(MAX_SEQ_LEN, ROPE_BASE);
+}
 aie::rope_torch::~rope_torch() {}
 
-torch::Tensor aie::rope_torch::execute(torch::Tensor x) {
+torch::Tensor aie::rope_torch::execute(torch::Tensor x,
+                                       int64_t position_offset) {
+  // no copies for contiguous bfloat16 inputs whose token count is a kernel
+  // shape, the trig matrices come from the tables cached by the op
+  auto sizes = x.sizes().vec();
+  const int64_t K = sizes.back();
+  const int64_t T = sizes.at(sizes.size() - 2);
+  auto x3d = x.to(torch::kBFloat16).contiguous().view({-1, T, K});
+  const int64_t B = x3d.size(0);
+  auto z = torch::empty({B, T, K}, torch::kBFloat16);
 
-  // to be implemented
-  return x;
+  for (int64_t t = 0; t < T; t += MAX_ROWS) {
+    const int64_t n = std::min(MAX_ROWS, T - t);
+    const int64_t M = kernel_rows(n);
+    auto in = x3d;
+    auto out = z;
+    // the rotation is per token, padding tokens are dropped on the way back
+    if (M != T) {
+      in = torch::zeros({B, M, K}, torch::kBFloat16);
+      in.narrow(1, 0, n).copy_(x3d.narrow(1, t, n));
+      out = torch::empty({B, M, K}, torch::kBFloat16);
+    }
+    std::vector<size_t> a_shape = {(size_t)B, (size_t)M, (size_t)K};
+    std::vector<Tensor> input_Tensor = {{in.data_ptr(), a_shape, "bfloat16"}};
+    std::vector<Tensor> output_Tensor = {
+        {out.data_ptr(), a_shape, "bfloat16"}};
+    ropeKernel.set_position_offset(position_offset + t);
+    ropeKernel.execute(input_Tensor, output_Tensor);
+    if (M != T) {
+      z.narrow(1, t, n).copy_(out.narrow(1, 0, n));
+    }
+  }
+  return z.view(sizes);
 }
@@ -44,24 +44,34 @@ torch::Tensor aie::silu_torch::execute(torch::Tensor x) {
   int K = 1;
   int M = 1;
   int N = 11008;
-  torch::Tensor z;
   if (x.dim() == 2) {
     M = x.sizes()[0];
     N = x.sizes()[1];
-    z = torch::empty({M, N}).to(torch::kBFloat16);
   }
   if (x.dim() == 3) {
     K = x.sizes()[0];
     M = x.sizes()[1];
     N = x.sizes()[2];
-    z = torch::empty({K, M, N}).to(torch::kBFloat16);
+  }
+  torch::Tensor z = xrt_tensor::empty(x.sizes());
+  if (std::string((Utils::get_env_var("DEVICE"))) != "stx") {
+    return z;
+  }
+  // an operand stored in a BO is read by the kernel as is and z is written
+  // in place, e.g. when x is the output of another NPU op
+  auto x_bo = xrt_tensor::bo(x);
+  if (x_bo.has_value()) {
+    std::vector<xrt::bo> inputs = {*x_bo};
+    std::vector<xrt::bo> outputs = {*xrt_tensor::bo(z)};
+    inputs[0].sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    siluKernel.set_kernel_shape({(size_t)(K * M), (size_t)N});
+    siluKernel.execute(inputs, outputs);
+    outputs[0].sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+    return z;
   }
   auto xCasted = static_cast<uint16_t *>(x.data_ptr());
-
   auto zCasted = static_cast<uint16_t *>(z.data_ptr());
-  if (std::string((Utils::get_env_var("DEVICE"))) == "stx") {
-    run_silu<uint16_t>(xCasted, zCasted, K * M, N, false, "bfloat16",
-                       "bfloat16");
-  }
+  run_silu<uint16_t>(xCasted, zCasted, K * M, N, false, "bfloat16",
+                     "bfloat16");
   return z;
 }
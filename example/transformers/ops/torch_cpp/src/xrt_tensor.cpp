@@ -0,0 +1,84 @@
+#include "../include/xrt_tensor.hpp"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+#if __has_include(<ryzenai/dynamic_dispatch/ops/ops_common.hpp>)
+#include <ryzenai/dynamic_dispatch/ops/ops_common.hpp>
+#include <ryzenai/dynamic_dispatch/xrt_context/xrt_context.hpp>
+#else
+#include <ops/ops_common.hpp>
+#include <xrt_context/xrt_context.hpp>
+#endif
+
+namespace {
+// storage pointer --> BO, for the storages allocated by xrt_tensor::empty
+std::map<const void *, xrt::bo> bo_registry;
+std::mutex bo_registry_mutex;
+
+std::shared_ptr<dynamic_dispatch::xrt_context> get_xrt_context() {
+  using namespace ryzenai;
+  static auto ctx = dynamic_dispatch::xrt_context::get_instance(
+      OpInterface::get_dod_base_dir() +
+      LLAMA2_MLADF_2x4x4_GEMMBFP16_SILU_MUL_MHA_RMS_ROPE_XCLBIN_PATH);
+  return ctx;
+}
+} // namespace
+
+torch::Tensor aie::xrt_tensor::empty(at::IntArrayRef sizes,
+                                     at::ScalarType dtype) {
+  int64_t numel = 1;
+  for (auto size : sizes) {
+    numel *= size;
+  }
+  // XRT does not allocate empty BOs
+  const size_t nbytes =
+      std::max<size_t>(numel * c10::elementSize(dtype), sizeof(uint32_t));
+  auto ctx = get_xrt_context();
+  xrt::bo bo(ctx->get_device(), nbytes, XRT_BO_FLAGS_HOST_ONLY,
+             ctx->get_kernel().group_id(0));
+  void *data = bo.map();
+  {
+    std::lock_guard<std::mutex> guard(bo_registry_mutex);
+    bo_registry.emplace(data, bo);
+  }
+  // the BO is released with the storage of the tensor
+  auto deleter = [](void *data) {
+    std::lock_guard<std::mutex> guard(bo_registry_mutex);
+    bo_registry.erase(data);
+  };
+  return torch::from_blob(data, sizes, deleter,
+                          torch::TensorOptions().dtype(dtype));
+}
+
+std::optional<xrt::bo> aie::xrt_tensor::bo(const torch::Tensor &t) {
+  if (!t.defined() || !t.is_contiguous() || !t.has_storage()) {
+    return std::nullopt;
+  }
+  const void *storage = t.storage().data();
+  xrt::bo base;
+  {
+    std::lock_guard<std::mutex> guard(bo_registry_mutex);
+    auto iter = bo_registry.find(storage);
+    if (iter == bo_registry.end()) {
+      return std::nullopt;
+    }
+    base = iter->second;
+  }
+  const size_t offset = (const char *)t.data_ptr() - (const char *)storage;
+  const size_t nbytes = t.nbytes();
+  if (offset == 0 && nbytes == base.size()) {
+    return base;
+  }
+  return xrt::bo(base, nbytes, offset);
+}
+
+torch::Tensor aie::xrt_tensor::to_xrt(const torch::Tensor &t) {
+  if (bo(t).has_value()) {
+    return t;
+  }
+  auto xt = empty(t.sizes(), t.scalar_type());
+  xt.copy_(t);
+  return xt;
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "perf_baseline.hpp"
+#include "utils.h"
+
+#ifndef PERF_GOLDEN_DIR
+#define PERF_GOLDEN_DIR "."
+#endif
+
+namespace perf_baseline {
+
+using ShapeKey = std::tuple<int, int, int, int>;
+
+struct GoldenEntry {
+  double exec_ns;
+  double tolerance;
+};
+
+struct Record {
+  std::string test_name;
+  std::string variant;
+  ShapeKey shape;
+  double exec_ns;
+  double golden_ns;
+  // (golden - new) / golden in %, negative is a regression
+  double improvement;
+};
+
+static std::vector<Record> &get_records() {
+  static std::vector<Record> records;
+  return records;
+}
+
+// Phoenix baselines were measured on Hawk Point, of the phx family
+static std::string get_device_suffix() {
+  auto device = Utils::get_env_var("DEVICE");
+  return device == "phx" ? "hpt" : device;
+}
+
+// "Qlinear_2Testw3a16" -> "w3a16"
+static std::string get_variant(const std::string &suite_name) {
+  auto pos = suite_name.rfind("Test");
+  return pos == std::string::npos ? suite_name : suite_name.substr(pos + 4);
+}
+
+static std::map<ShapeKey, GoldenEntry> load_golden(const std::string &fname,
+                                                   double default_tolerance) {
+  std::map<ShapeKey, GoldenEntry> golden;
+  std::ifstream ifs(fname);
+  std::string line;
+  if (!std::getline(ifs, line)) {
+    return golden;
+  }
+
+  std::map<std::string, size_t> columns;
+  std::stringstream header(line);
+  std::string cell;
+  for (size_t i = 0; std::getline(header, cell, ','); ++i) {
+    columns[cell] = i;
+  }
+  for (const auto *name : {"M", "K", "N", "group_size", "Executetime(ns)"}) {
+    if (!columns.count(name)) {
+      throw std::runtime_error(fname + " has no " + name + " column");
+    }
+  }
+  auto tolerance_col = columns.find("tolerance(%)");
+
+  while (std::getline(ifs, line)) {
+    std::vector<std::string> cells;
+    std::stringstream row(line);
+    while (std::getline(row, cell, ',')) {
+      cells.push_back(cell);
+    }
+    if (cells.size() < columns.size()) {
+      continue;
+    }
+    ShapeKey key{std::stoi(cells.at(columns["M"])),
+                 std::stoi(cells.at(columns["K"])),
+                 std::stoi(cells.at(columns["N"])),
+                 std::stoi(cells.at(columns["group_size"]))};
+    double tolerance = default_tolerance;
+    if (tolerance_col != columns.end() &&
+        !cells.at(tolerance_col->second).empty()) {
+      tolerance = std::stod(cells.at(tolerance_col->second));
+    }
+    // first row of a shape wins, like perf_compare.py
+    golden.emplace(key, GoldenEntry{
+                            std::stod(cells.at(columns["Executetime(ns)"])),
+                            tolerance});
+  }
+  return golden;
+}
+
+static const std::map<ShapeKey, GoldenEntry> &
+get_golden(const std::string &variant) {
+  static std::map<std::string, std::map<ShapeKey, GoldenEntry>> cache;
+  auto iter = cache.find(variant);
+  if (iter == cache.end()) {
+    auto dir = Utils::get_env_var("PERF_GOLDEN_DIR", PERF_GOLDEN_DIR);
+    auto fname =
+        dir + "/golden_" + variant + "_" + get_device_suffix() + ".csv";
+    auto tolerance = std::stod(Utils::get_env_var("PERF_TOLERANCE", "1.0"));
+    iter = cache.emplace(variant, load_golden(fname, tolerance)).first;
+  }
+  return iter->second;
+}
+
+::testing::AssertionResult measure(int M, int K, int N, int group_size,
+                                   int n_iters,
+                                   const std::function<void()> &run) {
+  std::vector<double> latencies;
+  for (int i = 0; i < n_iters; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    auto end = std::chrono::steady_clock::now();
+    latencies.push_back(
+        std::chrono::duration<double, std::nano>(end - start).count());
+  }
+  // The first run loads the instructions, it is left out if there are more
+  if (latencies.size() > 1) {
+    latencies.erase(latencies.begin());
+  }
+  if (latencies.empty()) {
+    return ::testing::AssertionSuccess();
+  }
+  std::sort(latencies.begin(), latencies.end());
+  const double median = latencies[latencies.size() / 2];
+
+  const auto *test_info =
+      ::testing::UnitTest::GetInstance()->current_test_info();
+  Record record{std::string(test_info->test_suite_name()) + "." +
+                    test_info->name(),
+                get_variant(test_info->test_suite_name()),
+                ShapeKey{M, K, N, group_size},
+                median,
+                0,
+                0};
+
+  if (Utils::get_env_var("PERF_CHECK") != "1") {
+    get_records().push_back(record);
+    return ::testing::AssertionSuccess();
+  }
+
+  const auto &golden = get_golden(record.variant);
+  auto iter = golden.find(record.shape);
+  if (iter == golden.end()) {
+    get_records().push_back(record);
+    return ::testing::AssertionSuccess();
+  }
+  const auto &entry = iter->second;
+  record.golden_ns = entry.exec_ns;
+  record.improvement = (entry.exec_ns - median) / entry.exec_ns * 100;
+  get_records().push_back(record);
+  if (record.improvement < -entry.tolerance) {
+    return ::testing::AssertionFailure()
+           << "Execute time regressed by " << -record.improvement
+           << "% (tolerance " << entry.tolerance << "%) : " << median
+           << " ns vs golden " << entry.exec_ns << " ns for M=" << M
+           << " K=" << K << " N=" << N << " group_size=" << group_size;
+  }
+  return ::testing::AssertionSuccess();
+}
+
+class PerfRecordsEnvironment : public ::testing::Environment {
+public:
+  void TearDown() override {
+    const auto &records = get_records();
+    if (records.empty()) {
+      return;
+    }
+    auto fname = Utils::get_env_var("PERF_RECORDS_FILE", "cpp_tests_perf.csv");
+    std::ofstream ofs(fname);
+    ofs << "M,K,N,group_size,Executetime(ns),variant,test,golden(ns),"
+           "perf_improvement(%)\n";
+    for (const auto &record : records) {
+      const auto &[M, K, N, group_size] = record.shape;
+      ofs << M << "," << K << "," << N << "," << group_size << ","
+          << record.exec_ns << "," << record.variant << ","
+          << record.test_name << ",";
+      if (record.golden_ns > 0) {
+        ofs << record.golden_ns << "," << record.improvement;
+      } else {
+        ofs << ",";
+      }
+      ofs << "\n";
+    }
+  }
+};
+
+static auto *const perf_records_env =
+    ::testing::AddGlobalTestEnvironment(new PerfRecordsEnvironment);
+
+} // namespace perf_baseline
@@ -0,0 +1,35 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#ifndef __PERF_BASELINE_H__
+#define __PERF_BASELINE_H__
+
+#include <functional>
+
+#include <gtest/gtest.h>
+
+/*
+ * Execute latency records of the qlinear_2 tests
+ *
+ * measure() times the runs of a test and records the median. The records of
+ * all tests are written to PERF_RECORDS_FILE (default cpp_tests_perf.csv)
+ * at the end of the run, in the columns of summarize_perf.py.
+ *
+ * With PERF_CHECK=1 the median is compared to the Executetime(ns) of the
+ * same M, K, N, group_size in golden_<variant>_<device>.csv, e.g.
+ * golden_w3a16_stx.csv for the Qlinear_2Testw3a16 tests on DEVICE=stx. A
+ * regression beyond PERF_TOLERANCE percent (default 1), or beyond the
+ * "tolerance(%)" column of the golden row if there is one, fails the test.
+ * Tests without a golden file or shape are only recorded. Golden files are
+ * looked up in PERF_GOLDEN_DIR, default the source dir of the tests.
+ */
+namespace perf_baseline {
+
+::testing::AssertionResult measure(int M, int K, int N, int group_size,
+                                   int n_iters,
+                                   const std::function<void()> &run);
+
+} // namespace perf_baseline
+
+#endif /* __PERF_BASELINE_H__ */
@@ -6,8 +6,10 @@
 #include <fstream>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <memory>
 
 #include "matrix_formatting.h"
+#include "perf_baseline.hpp"
 #include <qlinear_2.hpp>
 
 template <typename T>
@@ -133,8 +135,9 @@ int test_matmul(int M, int K, int N, bool debug = false,
         ryzenai::qlinear_2<InT, WgT, OuT>(a_dtype, b_dtype, c_dtype);
     qlin.debug(debug);
     qlin.initialize_weights(b.data(), b_shape, group_size);
-    for (int i = 0; i < stoi(NUM_EXECUTE_ITERATIONS_); i++)
-      qlin.execute(a.data(), a_shape, c.data());
+    EXPECT_TRUE(perf_baseline::measure(
+        M, K, N, group_size, stoi(NUM_EXECUTE_ITERATIONS_),
+        [&]() { qlin.execute(a.data(), a_shape, c.data()); }));
 
     int err_count = 0;
     for (int i = 0; i < c.size(); i++) {
@@ -186,8 +189,9 @@ int test_matmul(int M, int K, int N, bool debug = false,
     qlin.debug(debug);
     qlin.initialize_weights_int4(b.data(), zeros.data(), (float *)scales.data(),
                                  (float *)bias.data(), b_shape, group_size);
-    for (int i = 0; i < stoi(NUM_EXECUTE_ITERATIONS_); i++)
-      qlin.execute(a.data(), a_shape, c.data());
+    EXPECT_TRUE(perf_baseline::measure(
+        M, K, N, group_size, stoi(NUM_EXECUTE_ITERATIONS_),
+        [&]() { qlin.execute(a.data(), a_shape, c.data()); }));
     float const EPSILON = 1.0;
     int err_count = 0;
     float err_max = 0;
@@ -252,8 +256,9 @@ int test_matmul_mladf(int M, int K, int N, bool debug = false,
     qlin.initialize_weights_int4_mladf(
         b.data(), zeros.data(), (float *)scales.data(), (float *)bias.data(),
         b_shape, group_size);
-    for (int i = 0; i < stoi(NUM_EXECUTE_ITERATIONS_); i++)
-      qlin.execute(a.data(), a_shape, c.data());
+    EXPECT_TRUE(perf_baseline::measure(
+        M, K, N, group_size, stoi(NUM_EXECUTE_ITERATIONS_),
+        [&]() { qlin.execute(a.data(), a_shape, c.data()); }));
     float const EPSILON_MAX =
         4.0; // this is the tolerated max error, normalized by sqrt(K)
     float const EPSILON_MEAN =
@@ -375,8 +380,9 @@ int test_matmul_output_bfloat16(int M, int K, int N, bool debug = false,
     qlin.initialize_weights_int4(b.data(), zeros.data(), (float *)scales.data(),
                                  (float *)bias.data(), b_shape, group_size);
 
-    for (int i = 0; i < stoi(NUM_EXECUTE_ITERATIONS_); i++)
-      qlin.execute(a.data(), a_shape, c.data());
+    EXPECT_TRUE(perf_baseline::measure(
+        M, K, N, group_size, stoi(NUM_EXECUTE_ITERATIONS_),
+        [&]() { qlin.execute(a.data(), a_shape, c.data()); }));
 
     for (size_t i = 0; i < c.size(); ++i) {
       c_float[i] = ryzenai::bfloat16_to_float(c[i]);
@@ -746,6 +752,59 @@ TEST(Qlinear_2Testw8a16, KernelTiling1) {
   }
 }
 
+/*
+ * NPU-native weight file round trip : an object loading the weights from the
+ * file saved by another one has to produce the same output.
+ */
+template <typename InT = uint16_t, typename WgT = int8_t, typename OuT = float>
+int test_matmul_weight_file(int M, int K, int N,
+                            const std::string &a_dtype = "bfloat16",
+                            const std::string &b_dtype = "uint4",
+                            const std::string &c_dtype = "float32",
+                            int group_size = 128) {
+  std::tuple<int, int> a_shape = {M, K};
+  std::tuple<int, int> b_shape = {K, N};
+
+  std::vector<InT> a(M * K);
+  std::vector<float> bias(N);
+  std::vector<float> scales(K * N / group_size);
+  std::vector<WgT> b(K * N);
+  std::vector<WgT> zeros(K * N / group_size);
+  srand(42);
+  initialize_random<InT>(a, M * K, 42, "bfloat16");
+  initialize_random<WgT>(b, K * N, 7, b_dtype);
+  initialize_random<WgT>(zeros, K * N / group_size, 7, b_dtype);
+  initialize_random<float>(bias, N, 1);
+  initialize_random<float>(scales, K * N / group_size, 1);
+
+  const std::string fname = "qlinear_2_weights_" + std::to_string(K) + "x" +
+                            std::to_string(N) + ".npuw";
+  std::vector<OuT> c_golden(M * N);
+  {
+    ryzenai::qlinear_2 qlin =
+        ryzenai::qlinear_2<InT, WgT, OuT>(a_dtype, b_dtype, c_dtype);
+    qlin.initialize_weights_int4(b.data(), zeros.data(), scales.data(),
+                                 bias.data(), b_shape, group_size);
+    qlin.save_weights(fname);
+    qlin.execute(a.data(), a_shape, c_golden.data());
+  }
+
+  std::vector<OuT> c(M * N);
+  ryzenai::qlinear_2 qlin =
+      ryzenai::qlinear_2<InT, WgT, OuT>(a_dtype, b_dtype, c_dtype);
+  qlin.initialize_weights_from_file(fname);
+  qlin.execute(a.data(), a_shape, c.data());
+  std::remove(fname.c_str());
+
+  int err_count = 0;
+  for (int i = 0; i < c.size(); i++) {
+    if (c[i] != c_golden[i]) {
+      err_count++;
+    }
+  }
+  return err_count;
+}
+
 TEST(Qlinear_2Testw4a16, Kernel1) {
   int err_count = test_matmul<uint16_t, int8_t, float>(
       32, 4096, 4096, false, "bfloat16", "uint4", "float32");
@@ -758,6 +817,168 @@ TEST(Qlinear_2Testw4a16, Kernel1p) {
   EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
 }
 
+TEST(Qlinear_2Testw4a16, WeightFile1p) {
+  int err_count = test_matmul_weight_file<uint16_t, int8_t, float>(
+      32, 4096, 4096, "bfloat16", "uint4", "float32", 128);
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
+
+/*
+ * Weight streaming : more layers than the weight_stream has slots, run
+ * twice so that the second pass prefetches the uploads of the next layers.
+ * Each layer has to produce the output of an object loading its weights.
+ */
+template <typename InT = uint16_t, typename WgT = int8_t, typename OuT = float>
+int test_matmul_weight_stream(int M, int K, int N, int num_layers,
+                              const std::string &a_dtype = "bfloat16",
+                              const std::string &b_dtype = "uint4",
+                              const std::string &c_dtype = "float32",
+                              int group_size = 128) {
+  std::tuple<int, int> a_shape = {M, K};
+  std::tuple<int, int> b_shape = {K, N};
+
+  std::vector<InT> a(M * K);
+  srand(42);
+  initialize_random<InT>(a, M * K, 42, "bfloat16");
+
+  std::vector<std::string> fnames;
+  std::vector<std::vector<OuT>> c_golden;
+  for (int layer = 0; layer < num_layers; ++layer) {
+    std::vector<float> bias(N);
+    std::vector<float> scales(K * N / group_size);
+    std::vector<WgT> b(K * N);
+    std::vector<WgT> zeros(K * N / group_size);
+    initialize_random<WgT>(b, K * N, 7, b_dtype);
+    initialize_random<WgT>(zeros, K * N / group_size, 7, b_dtype);
+    initialize_random<float>(bias, N, 1);
+    initialize_random<float>(scales, K * N / group_size, 1);
+
+    fnames.push_back("qlinear_2_stream_" + std::to_string(layer) + ".npuw");
+    c_golden.emplace_back(M * N);
+    ryzenai::qlinear_2 qlin =
+        ryzenai::qlinear_2<InT, WgT, OuT>(a_dtype, b_dtype, c_dtype);
+    qlin.initialize_weights_int4(b.data(), zeros.data(), scales.data(),
+                                 bias.data(), b_shape, group_size);
+    qlin.save_weights(fnames.back());
+    qlin.execute(a.data(), a_shape, c_golden.back().data());
+  }
+
+  std::vector<std::unique_ptr<ryzenai::qlinear_2<InT, WgT, OuT>>> layers;
+  for (const auto &fname : fnames) {
+    layers.push_back(std::make_unique<ryzenai::qlinear_2<InT, WgT, OuT>>(
+        a_dtype, b_dtype, c_dtype));
+    layers.back()->initialize_weights_streamed(fname);
+  }
+
+  int err_count = 0;
+  std::vector<OuT> c(M * N);
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int layer = 0; layer < num_layers; ++layer) {
+      layers[layer]->execute(a.data(), a_shape, c.data());
+      for (int i = 0; i < c.size(); i++) {
+        if (c[i] != c_golden[layer][i]) {
+          err_count++;
+        }
+      }
+    }
+  }
+  layers.clear();
+  for (const auto &fname : fnames) {
+    std::remove(fname.c_str());
+  }
+  return err_count;
+}
+
+TEST(Qlinear_2Testw4a16, WeightStream1p) {
+  int err_count = test_matmul_weight_stream<uint16_t, int8_t, float>(
+      1, 4096, 4096, 4, "bfloat16", "uint4", "float32", 128);
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
+
+/*
+ * LoRA side path : the output with an adapter has to be the base output plus
+ * scale * (a * A) * B, and removing the adapter has to give the base output
+ * back.
+ */
+template <typename InT = uint16_t, typename WgT = int8_t, typename OuT = float>
+int test_matmul_lora(int M, int K, int N, int rank,
+                     const std::string &a_dtype = "bfloat16",
+                     const std::string &b_dtype = "uint4",
+                     const std::string &c_dtype = "float32",
+                     int group_size = 128) {
+  std::tuple<int, int> a_shape = {M, K};
+  std::tuple<int, int> b_shape = {K, N};
+
+  std::vector<InT> a(M * K);
+  std::vector<float> bias(N);
+  std::vector<float> scales(K * N / group_size);
+  std::vector<WgT> b(K * N);
+  std::vector<WgT> zeros(K * N / group_size);
+  std::vector<InT> lora_a(K * rank);
+  std::vector<InT> lora_b(rank * N);
+  srand(42);
+  initialize_random<InT>(a, M * K, 42, "bfloat16");
+  initialize_random<WgT>(b, K * N, 7, b_dtype);
+  initialize_random<WgT>(zeros, K * N / group_size, 7, b_dtype);
+  initialize_random<float>(bias, N, 1);
+  initialize_random<float>(scales, K * N / group_size, 1);
+  initialize_random<InT>(lora_a, K * rank, 1, "bfloat16");
+  initialize_random<InT>(lora_b, rank * N, 1, "bfloat16");
+  const float scale = 0.5f;
+
+  ryzenai::qlinear_2 qlin =
+      ryzenai::qlinear_2<InT, WgT, OuT>(a_dtype, b_dtype, c_dtype);
+  qlin.initialize_weights_int4(b.data(), zeros.data(), scales.data(),
+                               bias.data(), b_shape, group_size);
+  std::vector<OuT> c_base(M * N);
+  qlin.execute(a.data(), a_shape, c_base.data());
+
+  std::vector<OuT> c_golden(c_base);
+  for (int m = 0; m < M; ++m) {
+    for (int q = 0; q < rank; ++q) {
+      float t = 0;
+      for (int k = 0; k < K; ++k) {
+        t += ryzenai::bfloat16_to_float(a[m * K + k]) *
+             ryzenai::bfloat16_to_float(lora_a[k * rank + q]);
+      }
+      for (int n = 0; n < N; ++n) {
+        c_golden[m * N + n] +=
+            scale * t * ryzenai::bfloat16_to_float(lora_b[q * N + n]);
+      }
+    }
+  }
+
+  qlin.set_lora(std::make_shared<ryzenai::lora_adapter>(
+      (const uint16_t *)lora_a.data(), (const uint16_t *)lora_b.data(), K, N,
+      rank, scale));
+  std::vector<OuT> c(M * N);
+  qlin.execute(a.data(), a_shape, c.data());
+
+  float const EPSILON = 1e-3;
+  int err_count = 0;
+  for (int i = 0; i < c.size(); i++) {
+    if (std::abs(c[i] - c_golden[i]) >
+        EPSILON * std::max(1.0f, std::abs(c_golden[i]))) {
+      err_count++;
+    }
+  }
+
+  qlin.set_lora(nullptr);
+  qlin.execute(a.data(), a_shape, c.data());
+  for (int i = 0; i < c.size(); i++) {
+    if (c[i] != c_base[i]) {
+      err_count++;
+    }
+  }
+  return err_count;
+}
+
+TEST(Qlinear_2Testw4a16, Lora1p) {
+  int err_count = test_matmul_lora<uint16_t, int8_t, float>(
+      32, 4096, 4096, 16, "bfloat16", "uint4", "float32", 128);
+  EXPECT_TRUE(err_count == 0) << "Error Count = " << err_count;
+}
+
 TEST(Qlinear_2Testw4a16, Kernel2) {
   int err_count = test_matmul<uint16_t, int8_t, float>(
       32, 4096, 12288, false, "bfloat16", "uint4", "float32");
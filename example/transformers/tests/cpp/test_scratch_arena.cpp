@@ -0,0 +1,70 @@
+/*
+ * Copyright © 2024 Advanced Micro Devices, Inc. All rights reserved.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+
+#include <scratch_arena.h>
+
+using Utils::ScratchArena;
+
+static bool is_aligned(const void *p) {
+  return reinterpret_cast<uintptr_t>(p) % ScratchArena::ALIGNMENT == 0;
+}
+
+TEST(ScratchArena, Aligned) {
+  ScratchArena::Scope scratch;
+  auto *a = scratch.alloc<char>(3);
+  auto *b = scratch.alloc<float>(5);
+  auto *c = scratch.zeros<int16_t>(7);
+  EXPECT_TRUE(is_aligned(a));
+  EXPECT_TRUE(is_aligned(b));
+  EXPECT_TRUE(is_aligned(c));
+  EXPECT_NE((void *)a, (void *)b);
+  for (int i = 0; i < 7; ++i) {
+    EXPECT_EQ(c[i], 0);
+  }
+}
+
+TEST(ScratchArena, NestedScopes) {
+  ScratchArena::Scope outer;
+  auto *a = outer.alloc<float>(16);
+  float *inner_ptr = nullptr;
+  {
+    ScratchArena::Scope inner;
+    inner_ptr = inner.alloc<float>(16);
+    EXPECT_NE(inner_ptr, a);
+  }
+  // the inner allocations are given back, the outer ones are kept
+  auto *b = outer.alloc<float>(16);
+  EXPECT_EQ(b, inner_ptr);
+}
+
+TEST(ScratchArena, SteadyStateNoHeapAllocs) {
+  // in a fresh thread, so that the arena starts empty
+  std::thread([] {
+    auto &arena = ScratchArena::get();
+    auto call = [] {
+      ScratchArena::Scope scratch;
+      auto *a = scratch.alloc<float>(1 << 18);
+      {
+        ScratchArena::Scope nested;
+        auto *b = nested.zeros<int16_t>(1 << 19);
+        b[(1 << 19) - 1] = 1;
+      }
+      auto *c = scratch.alloc<char>(1 << 20);
+      a[0] = c[0] = 1;
+    };
+    call();
+    const auto allocs = arena.num_heap_allocs();
+    const auto capacity = arena.capacity();
+    for (int i = 0; i < 10; ++i) {
+      call();
+    }
+    EXPECT_EQ(arena.num_heap_allocs(), allocs);
+    EXPECT_EQ(arena.capacity(), capacity);
+  }).join();
+}
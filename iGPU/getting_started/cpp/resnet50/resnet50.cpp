@@ -13,11 +13,16 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include <onnxruntime_cxx_api.h>
 #include <dml_provider_factory.h>
 #include <algorithm> // std::generate
+#include <atomic>
+#include <chrono>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <numeric>
 #include <sstream>
+#include <thread>
 #include <vector>
 #if _WIN32
 extern "C" {
@@ -38,39 +43,25 @@ std::wstring_convert<convert_t, wchar_t> strconverter;
 using namespace std;
 
 
-static cv::Mat read_image(const std::string files);
+static cv::UMat read_image(const std::string files);
 static cv::Mat croppedImage(const cv::Mat& image, int height, int width);
 static cv::Mat preprocess_image(const cv::Mat& image, cv::Size size);
-static void set_input_image(const cv::Mat& image, Ort::Float16_t* data);
-static std::vector<float> softmax(float* data, int64_t size);
-static std::vector<std::pair<int, float>> topk(const std::vector<float>& score,
-    int K);
+static void set_input_image(const cv::UMat& image, Ort::Float16_t* data);
+static std::vector<std::pair<int, float>> topk_softmax(
+    const Ort::Float16_t* logits, int64_t size, int K);
 static void print_topk(const std::vector<std::pair<int, float>>& topk);
 static const char* lookup(int index);
 
-std::vector<float> convertToFloat32(const Ort::Float16_t* input, size_t size) {
-    std::vector<float> output(size);
-    for (size_t i = 0; i < size; ++i) {
-        output[i] = static_cast<float>(input[i]);
-    }
-    return output;
-}
-
-// preprocess
-static void preprocess_resnet(const string file,
-    std::vector<Ort::Float16_t>& input_tensor_values,
-    std::vector<int64_t>& input_shape) {
-    auto channel = input_shape[1];
+// preprocess, writes the image into the bound input tensor
+static void preprocess_resnet(const string file, Ort::Float16_t* input_data,
+    const std::vector<int64_t>& input_shape) {
     auto height = input_shape[2];
     auto width = input_shape[3];
-    auto size = cv::Size((int)width, (int)height);
     auto image = read_image(file);
-    cv::Mat resized_image;
-    cv::resize(image, image,
-        cv::Size(224, 224));
+    cv::resize(image, image, cv::Size((int)width, (int)height));
     try
     {
-        set_input_image(image, input_tensor_values.data());
+        set_input_image(image, input_data);
     }
     catch (const std::exception& exception) {
         cout << "ERROR running set_input_image: " << exception.what() << endl;
@@ -79,15 +70,10 @@ static void preprocess_resnet(const string file,
 
 }
 
-// postprocess
-static string postprocess_resnet(const string file,
-    Ort::Value& output_tensor) {
-    auto output_shape = output_tensor.GetTensorTypeAndShapeInfo().GetShape();
-    auto channel = output_shape[1];
-    auto output_tensor_ptr = output_tensor.GetTensorMutableData<Ort::Float16_t>();
-    std::vector<float> float_output_tensor = convertToFloat32(output_tensor_ptr, channel);
-    auto softmax_output = softmax(float_output_tensor.data(), channel);
-    auto tb_top5 = topk(softmax_output, 5);
+// postprocess, reads the float16 logits of one image in place
+static string postprocess_resnet(const Ort::Float16_t* logits,
+    int64_t channel) {
+    auto tb_top5 = topk_softmax(logits, channel, 5);
     //print_topk(tb_top5);
     auto top1 = tb_top5[0];
     auto cls = std::string("") + lookup(top1.first) + " prob. " +
@@ -119,25 +105,23 @@ static int calculate_product(const std::vector<int64_t>& v) {
 }
 
 static void usage() {
-    std::cout << "usage: resnet50 <path to onnx model> <provider> <path to image>"<< std::endl;
+    std::cout << "usage: resnet50 [-b <batch sizes, e.g. 1,2,4,8>] [-s <streams>] [-n <batches per stream>] <path to onnx model> <provider> <path to image>..." << std::endl;
+    std::cout << "  with -b, images/sec is reported for each batch size, <streams> sessions run concurrently" << std::endl;
 }
 
-int main(int argc, char* argv[]) {
+static std::vector<int64_t> parse_list(const std::string& arg) {
+    std::vector<int64_t> values;
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        values.push_back(std::max<int64_t>(1, std::atoll(item.c_str())));
+    }
+    return values;
+}
 
-    vector<pair<string, string>> results;
-    int opt = 0;
-    int64_t batch_number = 1;
-    auto model_name = strconverter.from_bytes(std::string(argv[optind]));
-    cout << "model name:" << std::string(argv[optind]) << endl;
-    auto ep = std::string(argv[optind + 1]);
-    auto curr_file = std::string(argv[optind + 2]);
-    cout << "ep:" << ep << endl;
-    Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "resnet50");
+static Ort::Session create_session(Ort::Env& env, const std::wstring& model_name,
+    const std::string& ep) {
     auto session_options = Ort::SessionOptions();
-
-    auto config_key = std::string{ "config_file" };
-    auto cache_dir = std::filesystem::current_path().string();
-
     if (ep == "dml")
     {
         OrtApi const& ortApi = Ort::GetApi();
@@ -150,10 +134,156 @@ int main(int argc, char* argv[]) {
         int deviceIndex = 0;
 
         ortDmlApi->SessionOptionsAppendExecutionProvider_DML(session_options, deviceIndex);
-        cout << "Finished appending DML session options" << endl;
+    }
+    return Ort::Session(env, model_name.data(), session_options);
+}
 
+// Input/output tensors of one batch, allocated and bound once. Each batch
+// is preprocessed into the same input buffer and Run() reuses the binding
+// instead of creating the tensors and output values on every frame.
+struct BoundBatch {
+    std::vector<int64_t> input_shape;
+    std::vector<int64_t> output_shape;
+    std::vector<Ort::Float16_t> input_values;
+    std::vector<Ort::Float16_t> output_values;
+    Ort::Value input_tensor{ nullptr };
+    Ort::Value output_tensor{ nullptr };
+    Ort::IoBinding binding;
+
+    BoundBatch(Ort::Session& session, const std::vector<const char*>& input_names,
+        const std::vector<const char*>& output_names,
+        std::vector<int64_t> in_shape, std::vector<int64_t> out_shape,
+        int64_t batch)
+        : input_shape(std::move(in_shape)), output_shape(std::move(out_shape)),
+        binding(session) {
+        input_shape[0] = batch;
+        output_shape[0] = batch;
+        Ort::MemoryInfo info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        input_values.resize(calculate_product(input_shape));
+        output_values.resize(calculate_product(output_shape));
+        input_tensor = Ort::Value::CreateTensor<Ort::Float16_t>(
+            info, input_values.data(), input_values.size(),
+            input_shape.data(), input_shape.size());
+        output_tensor = Ort::Value::CreateTensor<Ort::Float16_t>(
+            info, output_values.data(), output_values.size(),
+            output_shape.data(), output_shape.size());
+        binding.BindInput(input_names[0], input_tensor);
+        binding.BindOutput(output_names[0], output_tensor);
+        for (size_t i = 1; i < output_names.size(); i++) {
+            binding.BindOutput(output_names[i], info);
+        }
     }
-    auto session = Ort::Session(env, model_name.data(), session_options);
+
+    int64_t image_size() const { return input_values.size() / input_shape[0]; }
+    int64_t num_classes() const { return output_shape[1]; }
+};
+
+// Decodes and preprocesses batch images, starting at the first_image-th of
+// files, into the input buffer of batch
+static void fill_batch(BoundBatch& batch, const std::vector<std::string>& files,
+    size_t first_image) {
+    for (int64_t b = 0; b < batch.input_shape[0]; b++) {
+        const auto& file = files[(first_image + b) % files.size()];
+        preprocess_resnet(file, batch.input_values.data() + b * batch.image_size(),
+            batch.input_shape);
+    }
+}
+
+// Each stream has its own session and two bound batches. A CPU thread
+// decodes and preprocesses the next batch while the current one runs, so
+// image decode overlaps the DML execution.
+static double run_throughput(Ort::Env& env, const std::wstring& model_name,
+    const std::string& ep, const std::vector<std::string>& files,
+    const std::vector<int64_t>& input_shape,
+    const std::vector<int64_t>& output_shape,
+    const std::vector<const char*>& input_names,
+    const std::vector<const char*>& output_names, int64_t batch_size,
+    int num_streams, int num_batches) {
+    std::vector<Ort::Session> sessions;
+    std::vector<std::unique_ptr<BoundBatch>> batches;
+    sessions.reserve(num_streams);
+    for (int s = 0; s < num_streams; s++) {
+        sessions.push_back(create_session(env, model_name, ep));
+        for (int slot = 0; slot < 2; slot++) {
+            batches.push_back(std::make_unique<BoundBatch>(sessions.back(),
+                input_names, output_names, input_shape, output_shape, batch_size));
+            fill_batch(*batches.back(), files, 0);
+            // warmup, the first Run() compiles the DML graph
+            sessions.back().Run(Ort::RunOptions(), batches.back()->binding);
+        }
+    }
+
+    std::atomic<size_t> num_images{ 0 };
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> streams;
+    for (int s = 0; s < num_streams; s++) {
+        streams.emplace_back([&, s]() {
+            auto& session = sessions[s];
+            BoundBatch* slots[2] = { batches[2 * s].get(), batches[2 * s + 1].get() };
+            size_t next_image = s * num_batches * batch_size;
+            auto pending = std::async(std::launch::async, fill_batch,
+                std::ref(*slots[0]), std::cref(files), next_image);
+            for (int i = 0; i < num_batches; i++) {
+                auto& current = *slots[i % 2];
+                pending.get();
+                next_image += batch_size;
+                if (i + 1 < num_batches) {
+                    pending = std::async(std::launch::async, fill_batch,
+                        std::ref(*slots[(i + 1) % 2]), std::cref(files), next_image);
+                }
+                session.Run(Ort::RunOptions(), current.binding);
+                for (int64_t b = 0; b < batch_size; b++) {
+                    postprocess_resnet(current.output_values.data() + b * current.num_classes(),
+                        current.num_classes());
+                }
+                num_images += batch_size;
+            }
+        });
+    }
+    for (auto& stream : streams) {
+        stream.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return num_images / std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+
+    int opt = 0;
+    int64_t batch_number = 1;
+    std::vector<int64_t> batch_sizes;
+    int num_streams = 2;
+    int num_batches = 50;
+    while ((opt = getopt(argc, argv, "b:s:n:")) != -1) {
+        switch (opt) {
+        case 'b':
+            batch_sizes = parse_list(optarg);
+            break;
+        case 's':
+            num_streams = std::max(1, atoi(optarg));
+            break;
+        case 'n':
+            num_batches = std::max(1, atoi(optarg));
+            break;
+        default:
+            usage();
+            exit(1);
+        }
+    }
+    if (argc - optind < 3) {
+        usage();
+        exit(1);
+    }
+    auto model_name = strconverter.from_bytes(std::string(argv[optind]));
+    cout << "model name:" << std::string(argv[optind]) << endl;
+    auto ep = std::string(argv[optind + 1]);
+    cout << "ep:" << ep << endl;
+    auto files = std::vector<std::string>(argv + optind + 2, argv + argc);
+    Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "resnet50");
+
+    auto cache_dir = std::filesystem::current_path().string();
+
+    auto session = create_session(env, model_name, ep);
     // print name/shape of inputs and outputs
     Ort::AllocatorWithDefaultOptions allocator;
     auto input_count = session.GetInputCount();
@@ -190,40 +320,44 @@ int main(int argc, char* argv[]) {
         output_names_ptr.push_back(std::move(name));
         std::cout << "\t" << output_names[i] << " : " << print_shape(output_shapes[i]) << std::endl;
     }
-    for (int i = 0; i < 1; i++)
-    {
-        auto input_shape = input_shapes[0];
-        if (input_shape[0] == -1) {
-            input_shape[0] = batch_number;
-        }
-        int total_number_elements = calculate_product(input_shape);
-        std::vector<Ort::Float16_t> input_tensor_values(total_number_elements);
-        try
-        {
-            preprocess_resnet(curr_file, input_tensor_values, input_shape);
-        }
-        catch (const Ort::Exception& exception) {
-            cout << "ERROR running preprocess: " << exception.what() << endl;
-            exit(-1);
+
+    if (!batch_sizes.empty()) {
+        const bool dynamic_batch = input_shapes[0][0] == -1;
+        std::cout << "streams: " << num_streams << ", batches per stream: " << num_batches << std::endl;
+        for (auto batch_size : batch_sizes) {
+            if (!dynamic_batch && batch_size != input_shapes[0][0]) {
+                std::cout << "batch " << batch_size << " : skipped, the model batch is fixed to " << input_shapes[0][0] << std::endl;
+                continue;
+            }
+            try {
+                auto images_per_sec = run_throughput(env, model_name, ep, files,
+                    input_shapes[0], output_shapes[0], input_names, output_names,
+                    batch_size, num_streams, num_batches);
+                std::cout << "batch " << batch_size << " : " << std::fixed << std::setprecision(1)
+                    << images_per_sec << " images/sec" << std::endl;
+            }
+            catch (const Ort::Exception& exception) {
+                cout << "ERROR running model inference: " << exception.what() << endl;
+                exit(-1);
+            }
         }
-        std::vector<Ort::Value> input_tensors;
-        Ort::MemoryInfo info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-        input_tensors.push_back(Ort::Value::CreateTensor<Ort::Float16_t>(
-            info, input_tensor_values.data(), input_tensor_values.size(),
-            input_shape.data(), input_shape.size()));
-
-        // double-check the dimensions of the input tensor
-        assert(input_tensors[0].IsTensor() &&
-            input_tensors[0].GetTensorTypeAndShapeInfo().GetShape() ==
-            input_shape);
+        return 0;
+    }
+
+    auto input_shape = input_shapes[0];
+    if (input_shape[0] == -1) {
+        input_shape[0] = batch_number;
+    }
+    BoundBatch batch(session, input_names, output_names, input_shape,
+        output_shapes[0], input_shape[0]);
+    for (const auto& curr_file : files)
+    {
+        fill_batch(batch, { curr_file }, 0);
         try {
-            auto output_tensors = session.Run(Ort::RunOptions(), input_names.data(), input_tensors.data(), input_count, output_names.data(), output_count);
-            assert(output_tensors.size() == session.GetOutputNames().size() &&
-                output_tensors[0].IsTensor());
-            auto output_shape =
-                output_tensors[0].GetTensorTypeAndShapeInfo().GetShape();
-            string predicted = postprocess_resnet(curr_file, output_tensors[0]);
-            cout << "Finished inference. output label: " << predicted << endl;
+            session.Run(Ort::RunOptions(), batch.binding);
+            string predicted = postprocess_resnet(batch.output_values.data(),
+                batch.num_classes());
+            cout << curr_file << " : Finished inference. output label: " << predicted << endl;
         }
         catch (const Ort::Exception& exception) {
             cout << "ERROR running model inference: " << exception.what() << endl;
@@ -234,9 +368,11 @@ int main(int argc, char* argv[]) {
     return 0;
 }
 
-static cv::Mat read_image(const string file) {
-    cv::Mat image;
-    image = cv::imread(file);
+// cv::UMat, so the preprocessing runs through OpenCL on the iGPU when
+// OpenCV has an OpenCL device, and on the CPU otherwise
+static cv::UMat read_image(const string file) {
+    cv::UMat image;
+    cv::imread(file).copyTo(image);
     return image;
 }
 
@@ -259,43 +395,44 @@ static cv::Mat preprocess_image(const cv::Mat& image, cv::Size size) {
     return croppedImage(resized_image, size.height, size.width);
 }
 
-//(image_data - mean) * scale, BRG2RGB and hwc2chw
-static void set_input_image(const cv::Mat& image, Ort::Float16_t* data) {
-    float mean[3] = { 0.0f, 0.0f, 0.0f };
-    float scales[3] = { 1.0f, 1.0f, 1.0f };
+// image_data / 255, BRG2RGB and hwc2chw, only the float16 planes are read
+// back, straight into the input tensor
+static void set_input_image(const cv::UMat& image, Ort::Float16_t* data) {
+    cv::UMat rgb, normalized, half;
+    cv::cvtColor(image, rgb, cv::COLOR_BGR2RGB);
+    rgb.convertTo(normalized, CV_32F, 1.0 / 255);
+    normalized.convertTo(half, CV_16F);
+    std::vector<cv::UMat> planes;
+    cv::split(half, planes);
     for (int c = 0; c < 3; c++) {
-        for (int h = 0; h < image.rows; h++) {
-            for (int w = 0; w < image.cols; w++) {
-                auto c_t = abs(c - 2); // BRG to RGB
-                auto image_data =
-                    ((image.at<cv::Vec3b>(h, w)[c_t] - mean[c_t]) * scales[c_t]) / 255;
-                data[c * image.rows * image.cols + h * image.cols + w] =
-                    (Ort::Float16_t)image_data;
-            }
-        }
+        cv::Mat plane(image.rows, image.cols, CV_16F,
+            data + c * image.rows * image.cols);
+        planes[c].copyTo(plane);
     }
 }
 
-static std::vector<float> softmax(float* data, int64_t size) {
-    auto output = std::vector<float>(size);
-    std::transform(data, data + size, output.begin(), expf);
-    auto sum =
-        std::accumulate(output.begin(), output.end(), 0.0f, std::plus<float>());
-    std::transform(output.begin(), output.end(), output.begin(),
-        [sum](float v) { return v / sum; });
-    return output;
-}
-
-static std::vector<std::pair<int, float>> topk(const std::vector<float>& score,
-    int K) {
-    auto indices = std::vector<int>(score.size());
+// top-K of the softmax of the logits, the softmax is only evaluated for the
+// K results
+static std::vector<std::pair<int, float>> topk_softmax(
+    const Ort::Float16_t* logits, int64_t size, int K) {
+    auto indices = std::vector<int>(size);
     std::iota(indices.begin(), indices.end(), 0);
     std::partial_sort(indices.begin(), indices.begin() + K, indices.end(),
-        [&score](int a, int b) { return score[a] > score[b]; });
+        [logits](int a, int b) {
+            return static_cast<float>(logits[a]) > static_cast<float>(logits[b]);
+        });
+    auto max_logit = static_cast<float>(logits[indices[0]]);
+    auto sum = 0.0f;
+    for (int64_t i = 0; i < size; i++) {
+        sum += expf(static_cast<float>(logits[i]) - max_logit);
+    }
     auto ret = std::vector<std::pair<int, float>>(K);
     std::transform(
         indices.begin(), indices.begin() + K, ret.begin(),
-        [&score](int index) { return std::make_pair(index, score[index]); });
+        [logits, max_logit, sum](int index) {
+            return std::make_pair(index,
+                expf(static_cast<float>(logits[index]) - max_logit) / sum);
+        });
     return ret;
 }
 
@@ -0,0 +1,342 @@
+//
+// Copyright (C) 2023, Advanced Micro Devices, Inc. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+// Microbenchmarks of the custom op kernels, called directly, without a
+// session. Every benchmark reports bytes_per_second over the bytes the
+// kernel has to read and write once, and "roofline", that rate over the
+// copy bandwidth of the machine (shown as a rate, it is a fraction): a
+// single threaded memcpy past the caches on the CPU, a device to device
+// cudaMemcpy on CUDA. The CPU benchmarks take the tensor size and the
+// number of threads, 0 for all of them.
+//
+//   cmake -DBUILD_BENCHMARK=ON .. && ./vai_custom_op_bench
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "bfp/cpu/parallel_for.h"
+#include "quantize_linear.h"
+#ifdef USE_CUDA
+#include <cuda_runtime.h>
+#include "bfp/cuda/bfp_kernel.h"
+#include "bfp/cuda/nndct_fix_kernels.h"
+#else
+#include "bfp/cpu/bfp_kernel.h"
+#include "bfp/cpu/nndct_fix_kernels_cpu.h"
+#endif
+
+namespace vai_q {
+QUANTIZE_LINEAR_APPLY(float)
+DEQUANTIZE_LINEAR_APPLY(float)
+}  // namespace vai_q
+
+namespace {
+
+// The defaults of BFPFixNeuron.
+constexpr int kBitWidth = 15;
+constexpr int kBlockSize = 16;
+constexpr int kSubBlockSize = 2;
+constexpr int kSubBlockShiftBits = 1;
+// Channels of the per-axis benchmarks.
+constexpr int64_t kChannels = 64;
+
+std::vector<float> RandomFloats(int64_t n) {
+  std::mt19937 gen(0);
+  std::normal_distribution<float> dist(0.0f, 4.0f);
+  std::vector<float> v(n);
+  for (auto& x : v) {
+    x = dist(gen);
+  }
+  return v;
+}
+
+// Bytes per second of a copy between two buffers larger than the caches.
+double CpuCopyBandwidth() {
+  static const double bandwidth = [] {
+    const size_t bytes = size_t(1) << 28;
+    std::vector<char> src(bytes, 1), dst(bytes);
+    double best = 0.0;
+    for (int i = 0; i < 5; i++) {
+      auto start = std::chrono::steady_clock::now();
+      std::memcpy(dst.data(), src.data(), bytes);
+      benchmark::DoNotOptimize(dst.data());
+      std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+      best = std::max(best, 2.0 * bytes / t.count());
+    }
+    return best;
+  }();
+  return bandwidth;
+}
+
+void ReportBytes(benchmark::State& state, int64_t bytes, double peak) {
+  state.SetBytesProcessed(state.iterations() * bytes);
+  state.counters["roofline"] = benchmark::Counter(
+      static_cast<double>(state.iterations()) * bytes / peak,
+      benchmark::Counter::kIsRate);
+}
+
+// Runs fn with the thread count of the benchmark arguments.
+template <typename Fn>
+void RunCpu(benchmark::State& state, int64_t bytes, Fn fn) {
+  SetParallelForThreads(static_cast<int>(state.range(1)));
+  for (auto _ : state) {
+    fn();
+    benchmark::ClobberMemory();
+  }
+  SetParallelForThreads(0);
+  ReportBytes(state, bytes, CpuCopyBandwidth());
+}
+
+void CpuArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"n", "threads"});
+  for (int64_t n : {int64_t(1) << 16, int64_t(1) << 20, int64_t(1) << 24}) {
+    for (int64_t threads : {1, 2, 4, 0}) {
+      b->Args({n, threads});
+    }
+  }
+  b->UseRealTime();
+}
+
+void BM_Memcpy(benchmark::State& state) {
+  const int64_t n = state.range(0);
+  auto input = RandomFloats(n);
+  std::vector<float> output(n);
+  RunCpu(state, 8 * n, [&] {
+    std::memcpy(output.data(), input.data(), 4 * n);
+  });
+}
+BENCHMARK(BM_Memcpy)->Apply(CpuArgs);
+
+template <typename T>
+void QuantizeLinear(benchmark::State& state, int64_t broadcast_dim, bool last_axis) {
+  const int64_t n = state.range(0);
+  auto input = RandomFloats(n);
+  std::vector<T> output(n), zero_point(broadcast_dim, T(1));
+  std::vector<float> scale(broadcast_dim, 0.05f);
+  // [N, broadcast_dim, block_size], the channels last or in the middle.
+  const int64_t block_size = last_axis ? 1 : n / broadcast_dim;
+  const int64_t N = n / broadcast_dim / block_size;
+  RunCpu(state, (4 + sizeof(T)) * n, [&] {
+    vai_q::QuantizeLinearApply<T>().op(N, broadcast_dim, block_size, input.data(),
+                                       scale.data(), output.data(), zero_point.data());
+  });
+}
+
+void BM_QuantizeLinearS8(benchmark::State& state, int64_t broadcast_dim, bool last_axis) {
+  QuantizeLinear<int8_t>(state, broadcast_dim, last_axis);
+}
+BENCHMARK_CAPTURE(BM_QuantizeLinearS8, per_tensor, 1, false)->Apply(CpuArgs);
+BENCHMARK_CAPTURE(BM_QuantizeLinearS8, per_axis, kChannels, false)->Apply(CpuArgs);
+BENCHMARK_CAPTURE(BM_QuantizeLinearS8, last_axis, kChannels, true)->Apply(CpuArgs);
+
+void BM_QuantizeLinearU16(benchmark::State& state, int64_t broadcast_dim, bool last_axis) {
+  QuantizeLinear<uint16_t>(state, broadcast_dim, last_axis);
+}
+BENCHMARK_CAPTURE(BM_QuantizeLinearU16, per_tensor, 1, false)->Apply(CpuArgs);
+
+template <typename T>
+void DequantizeLinear(benchmark::State& state, int64_t broadcast_dim, bool last_axis) {
+  const int64_t n = state.range(0);
+  std::vector<T> input(n), zero_point(broadcast_dim, T(1));
+  std::mt19937 gen(0);
+  for (auto& x : input) {
+    x = static_cast<T>(gen());
+  }
+  std::vector<float> output(n), scale(broadcast_dim, 0.05f);
+  const int64_t block_size = last_axis ? 1 : n / broadcast_dim;
+  const int64_t N = n / broadcast_dim / block_size;
+  RunCpu(state, (4 + sizeof(T)) * n, [&] {
+    vai_q::DequantizeLinearApply<T>().op(N, broadcast_dim, block_size, input.data(),
+                                         scale.data(), output.data(), zero_point.data());
+  });
+}
+
+void BM_DequantizeLinearS8(benchmark::State& state, int64_t broadcast_dim, bool last_axis) {
+  DequantizeLinear<int8_t>(state, broadcast_dim, last_axis);
+}
+BENCHMARK_CAPTURE(BM_DequantizeLinearS8, per_tensor, 1, false)->Apply(CpuArgs);
+BENCHMARK_CAPTURE(BM_DequantizeLinearS8, per_axis, kChannels, false)->Apply(CpuArgs);
+BENCHMARK_CAPTURE(BM_DequantizeLinearS8, last_axis, kChannels, true)->Apply(CpuArgs);
+
+void BM_ClipCastToFloat16(benchmark::State& state) {
+  const int64_t n = state.range(0);
+  auto input = RandomFloats(n);
+  std::vector<uint16_t> output(n);
+  RunCpu(state, 6 * n, [&] {
+    vai_q::ClipCastToFloat16Bits(input.data(), output.data(), n, -65504.0f, 65504.0f);
+  });
+}
+// Single threaded, as in the op.
+BENCHMARK(BM_ClipCastToFloat16)
+    ->ArgNames({"n", "threads"})
+    ->Args({int64_t(1) << 16, 1})
+    ->Args({int64_t(1) << 20, 1})
+    ->Args({int64_t(1) << 24, 1})
+    ->UseRealTime();
+
+#ifndef USE_CUDA
+void BM_BFP(benchmark::State& state) {
+  const int64_t n = state.range(0);
+  auto input = RandomFloats(n);
+  std::vector<float> output(n);
+  RunCpu(state, 8 * n, [&] {
+    LaunchBFPCPUKernel(input.data(), output.data(), n, kBitWidth, kBlockSize, 0);
+  });
+}
+BENCHMARK(BM_BFP)->Apply(CpuArgs);
+
+void BM_BFPV2(benchmark::State& state) {
+  const int64_t n = state.range(0);
+  auto input = RandomFloats(n);
+  std::vector<float> output(n);
+  RunCpu(state, 8 * n, [&] {
+    LaunchBFPCPUKernelV2(input.data(), output.data(), n, kBitWidth, kBlockSize, 0);
+  });
+}
+BENCHMARK(BM_BFPV2)->Apply(CpuArgs);
+
+// Blocks along the channels of a [1, channels, n / channels] tensor, as
+// BFPFixNeuron quantizes an activation.
+void BM_BFPV2Axis(benchmark::State& state) {
+  const int64_t n = state.range(0);
+  auto input = RandomFloats(n);
+  std::vector<float> output(n);
+  RunCpu(state, 8 * n, [&] {
+    LaunchBFPCPUKernelV2Axis(input.data(), output.data(), 1, kChannels, n / kChannels,
+                             kBitWidth, kBlockSize, 0);
+  });
+}
+BENCHMARK(BM_BFPV2Axis)->Apply(CpuArgs);
+
+void BM_BFPPrime(benchmark::State& state) {
+  const int64_t n = state.range(0);
+  auto input = RandomFloats(n);
+  std::vector<float> output(n);
+  RunCpu(state, 8 * n, [&] {
+    LaunchBFPPrimeCPUKernel(input.data(), output.data(), n, kBitWidth, kBlockSize,
+                            kSubBlockSize, kSubBlockShiftBits, 0);
+  });
+}
+BENCHMARK(BM_BFPPrime)->Apply(CpuArgs);
+
+void BM_FixNeuronV2(benchmark::State& state) {
+  const int64_t n = state.range(0);
+  auto input = RandomFloats(n);
+  std::vector<float> output(n);
+  RunCpu(state, 8 * n, [&] {
+    cpu_fix_neuron_v2<float>(n, input.data(), output.data(), -128, 127, 16.0f, 0, 1, 2);
+  });
+}
+BENCHMARK(BM_FixNeuronV2)->Apply(CpuArgs);
+#else
+// Device buffers of n floats, the input filled with RandomFloats.
+struct DeviceBuffers {
+  explicit DeviceBuffers(int64_t n) {
+    auto host = RandomFloats(n);
+    cudaMalloc(&input, 4 * n);
+    cudaMalloc(&output, 4 * n);
+    cudaMemcpy(input, host.data(), 4 * n, cudaMemcpyHostToDevice);
+  }
+  ~DeviceBuffers() {
+    cudaFree(input);
+    cudaFree(output);
+  }
+  float* input = nullptr;
+  float* output = nullptr;
+};
+
+double CudaCopyBandwidth() {
+  static const double bandwidth = [] {
+    const int64_t n = int64_t(1) << 26;
+    DeviceBuffers buffers(n);
+    cudaEvent_t start, stop;
+    cudaEventCreate(&start);
+    cudaEventCreate(&stop);
+    float best_ms = 1e30f;
+    for (int i = 0; i < 5; i++) {
+      cudaEventRecord(start);
+      cudaMemcpy(buffers.output, buffers.input, 4 * n, cudaMemcpyDeviceToDevice);
+      cudaEventRecord(stop);
+      cudaEventSynchronize(stop);
+      float ms;
+      cudaEventElapsedTime(&ms, start, stop);
+      best_ms = std::min(best_ms, ms);
+    }
+    cudaEventDestroy(start);
+    cudaEventDestroy(stop);
+    return 8.0 * n / (best_ms * 1e-3);
+  }();
+  return bandwidth;
+}
+
+// Times fn(input, output) with CUDA events.
+template <typename Fn>
+void RunCuda(benchmark::State& state, Fn fn) {
+  const int64_t n = state.range(0);
+  DeviceBuffers buffers(n);
+  cudaEvent_t start, stop;
+  cudaEventCreate(&start);
+  cudaEventCreate(&stop);
+  for (auto _ : state) {
+    cudaEventRecord(start);
+    fn(n, buffers.input, buffers.output);
+    cudaEventRecord(stop);
+    cudaEventSynchronize(stop);
+    float ms;
+    cudaEventElapsedTime(&ms, start, stop);
+    state.SetIterationTime(ms * 1e-3);
+  }
+  cudaEventDestroy(start);
+  cudaEventDestroy(stop);
+  ReportBytes(state, 8 * n, CudaCopyBandwidth());
+}
+
+void CudaArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"n"});
+  for (int64_t n : {int64_t(1) << 16, int64_t(1) << 20, int64_t(1) << 24}) {
+    b->Args({n});
+  }
+  b->UseManualTime();
+}
+
+void BM_CudaBFP(benchmark::State& state) {
+  RunCuda(state, [](int64_t n, const float* input, float* output) {
+    LaunchBFPCUDAKernel(input, output, n, kBitWidth, kBlockSize);
+  });
+}
+BENCHMARK(BM_CudaBFP)->Apply(CudaArgs);
+
+void BM_CudaBFPV2(benchmark::State& state) {
+  RunCuda(state, [](int64_t n, const float* input, float* output) {
+    LaunchBFPCUDAKernelV2(input, output, n, n, kBitWidth, kBlockSize, 0);
+  });
+}
+BENCHMARK(BM_CudaBFPV2)->Apply(CudaArgs);
+
+void BM_CudaBFPPrime(benchmark::State& state) {
+  RunCuda(state, [](int64_t n, const float* input, float* output) {
+    LaunchBFPPrimeCUDAKernel(input, output, n, n, kBitWidth, kBlockSize,
+                             kSubBlockSize, kSubBlockShiftBits, 0);
+  });
+}
+BENCHMARK(BM_CudaBFPPrime)->Apply(CudaArgs);
+
+void BM_CudaFixNeuronV2(benchmark::State& state) {
+  RunCuda(state, [](int64_t n, const float* input, float* output) {
+    cuda_fix_neuron_v2<float>(n, input, output, -128, 127, 16.0f, 0, 1, 2);
+  });
+}
+BENCHMARK(BM_CudaFixNeuronV2)->Apply(CudaArgs);
+#endif
+
+}  // namespace
+
+BENCHMARK_MAIN();
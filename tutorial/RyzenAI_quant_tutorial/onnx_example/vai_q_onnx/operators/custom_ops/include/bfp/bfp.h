@@ -26,3 +26,29 @@ void to_bfp_prime_shared(const Ort::Value& tensor,
                                    int64_t sub_block_shift_bits,
                                    int64_t rounding_mode,
                                    Ort::Value& out);
+
+// Quantizes in blocks along axis, as the functions above do on the tensor
+// transposed to put axis last and zero padded to a multiple of block_size,
+// without building that copy. CPU only.
+void to_bfp_axis(const Ort::Value& tensor,
+                 int64_t axis,
+                 int64_t bit_width,
+                 int64_t block_size,
+                 int64_t rounding_mode,
+                 Ort::UnownedValue& out);
+
+void to_bfp_v2_axis(const Ort::Value& tensor,
+                    int64_t axis,
+                    int64_t bit_width,
+                    int64_t block_size,
+                    int64_t rounding_mode,
+                    Ort::UnownedValue& out);
+
+void to_bfp_prime_shared_axis(const Ort::Value& tensor,
+                              int64_t axis,
+                              int64_t bit_width,
+                              int64_t block_size,
+                              int64_t sub_block_size,
+                              int64_t sub_block_shift_bits,
+                              int64_t rounding_mode,
+                              Ort::UnownedValue& out);
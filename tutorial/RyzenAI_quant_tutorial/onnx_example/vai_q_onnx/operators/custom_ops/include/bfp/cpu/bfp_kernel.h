@@ -39,4 +39,40 @@ void LaunchBFPPrimeCPUKernel(const float* input,
                              const int sub_block_shift_bits,
                              const int rounding_mode);
 
+// The kernels below quantize a tensor of shape [outer, channels, inner] in
+// blocks along the channel axis without materializing it transposed and
+// padded: every element is read and written in place, in the layout of the
+// input, with the same blocks as the kernels above would see on the
+// channels-last, zero padded copy. last is the size of the last axis of
+// the input, which the channel axis was swapped with.
+void LaunchBFPCPUKernelAxis(const float* input,
+                            float* output,
+                            const int outer,
+                            const int channels,
+                            const int inner,
+                            const int last,
+                            const int bit_width,
+                            const int block_size,
+                            const int rounding_mode);
+
+void LaunchBFPCPUKernelV2Axis(const float* input,
+                              float* output,
+                              const int outer,
+                              const int channels,
+                              const int inner,
+                              const int bit_width,
+                              const int block_size,
+                              const int rounding_mode);
+
+void LaunchBFPPrimeCPUKernelAxis(const float* input,
+                                 float* output,
+                                 const int outer,
+                                 const int channels,
+                                 const int inner,
+                                 const int bit_width,
+                                 const int block_size,
+                                 const int sub_block_size,
+                                 const int sub_block_shift_bits,
+                                 const int rounding_mode);
+
 #endif // _INCLUDE_CPU_BFP_H_
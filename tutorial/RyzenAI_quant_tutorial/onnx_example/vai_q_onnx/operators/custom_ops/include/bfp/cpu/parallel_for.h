@@ -0,0 +1,23 @@
+//
+// Copyright (C) 2023, Advanced Micro Devices, Inc. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef _INCLUDE_CPU_PARALLEL_FOR_H_
+#define _INCLUDE_CPU_PARALLEL_FOR_H_
+
+#include <cstdint>
+#include <functional>
+
+// Runs fn(begin, end) over [0, n) split in ranges of at least grain, on the
+// calling thread and a pool of worker threads shared by all the kernels.
+// Returns once every range is done. Calls from a worker run inline.
+void ParallelFor(int64_t n,
+                 int64_t grain,
+                 const std::function<void(int64_t, int64_t)>& fn);
+
+// Caps the threads of the ParallelFor calls that follow, the caller
+// included, to measure the scaling of the kernels. 0 lifts the cap.
+void SetParallelForThreads(int num_threads);
+
+#endif // _INCLUDE_CPU_PARALLEL_FOR_H_
@@ -53,3 +53,78 @@ void to_bfp_prime_shared(const Ort::Value& tensor,
   LaunchBFPPrimeCPUKernel(input, output, element_count, bit_width,
         block_size, sub_block_size, sub_block_shift_bits, rounding_mode);
 }
+
+namespace {
+// The sizes of the dimensions before, at and after axis, and of the last
+// dimension axis is swapped with.
+struct AxisView {
+  int outer = 1;
+  int channels = 1;
+  int inner = 1;
+  int last = 1;
+};
+
+AxisView get_axis_view(const Ort::Value& tensor, int64_t axis) {
+  auto shape = tensor.GetTensorTypeAndShapeInfo().GetShape();
+  AxisView view;
+  for (int64_t i = 0; i < static_cast<int64_t>(shape.size()); i++) {
+    if (i < axis) {
+      view.outer *= shape[i];
+    } else if (i == axis) {
+      view.channels = shape[i];
+    } else {
+      view.inner *= shape[i];
+    }
+  }
+  if (axis + 1 < static_cast<int64_t>(shape.size())) {
+    view.last = shape.back();
+  }
+  return view;
+}
+}  // namespace
+
+void to_bfp_axis(const Ort::Value& tensor,
+                 int64_t axis,
+                 int64_t bit_width,
+                 int64_t block_size,
+                 int64_t rounding_mode,
+                 Ort::UnownedValue& out) {
+  const float* input = tensor.GetTensorData<float>();
+  float* output = out.GetTensorMutableData<float>();
+  auto view = get_axis_view(tensor, axis);
+
+  LaunchBFPCPUKernelAxis(input, output, view.outer, view.channels,
+                         view.inner, view.last, bit_width, block_size,
+                         rounding_mode);
+}
+
+void to_bfp_v2_axis(const Ort::Value& tensor,
+                    int64_t axis,
+                    int64_t bit_width,
+                    int64_t block_size,
+                    int64_t rounding_mode,
+                    Ort::UnownedValue& out) {
+  const float* input = tensor.GetTensorData<float>();
+  float* output = out.GetTensorMutableData<float>();
+  auto view = get_axis_view(tensor, axis);
+
+  LaunchBFPCPUKernelV2Axis(input, output, view.outer, view.channels,
+                           view.inner, bit_width, block_size, rounding_mode);
+}
+
+void to_bfp_prime_shared_axis(const Ort::Value& tensor,
+                              int64_t axis,
+                              int64_t bit_width,
+                              int64_t block_size,
+                              int64_t sub_block_size,
+                              int64_t sub_block_shift_bits,
+                              int64_t rounding_mode,
+                              Ort::UnownedValue& out) {
+  const float* input = tensor.GetTensorData<float>();
+  float* output = out.GetTensorMutableData<float>();
+  auto view = get_axis_view(tensor, axis);
+
+  LaunchBFPPrimeCPUKernelAxis(input, output, view.outer, view.channels,
+        view.inner, bit_width, block_size, sub_block_size,
+        sub_block_shift_bits, rounding_mode);
+}
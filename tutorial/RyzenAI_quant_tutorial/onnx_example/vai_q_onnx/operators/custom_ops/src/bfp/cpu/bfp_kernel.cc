@@ -6,7 +6,18 @@
 #include <algorithm>
 #include <cstdint>
 #include <cmath>
+#include <vector>
 #include "bfp/cpu/bfp_kernel.h"
+#include "bfp/cpu/parallel_for.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef __GNUC__
+#include <cpuid.h>
+#else
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
 
 uint32_t __float_as_uint(float x) {
   return *reinterpret_cast<uint32_t*>(&x);
@@ -32,6 +43,246 @@ uint32_t GetMaxExponentCPU(const float* input, int n) {
   return max_exp;
 }
 
+// The vector kernels below give bit-identical results to the scalar code:
+// scales are powers of two, so dividing by one, rounding and multiplying
+// back rounds once, in float as it does in double.
+namespace {
+
+uint32_t MaskedExponent(float v) {
+  uint32_t exp = GetExponentCPU(v);
+  // +-Inf/NaN don't take part in the shared exponent.
+  return exp == 0xff ? 0 : exp;
+}
+
+// shared[i] = max(shared[i], exponent of input[i]), +-Inf/NaN ignored.
+void UpdateMaxExponentScalar(uint32_t* shared, const float* input, int n) {
+  for (int i = 0; i < n; i++) {
+    shared[i] = std::max(shared[i], MaskedExponent(input[i]));
+  }
+}
+
+// Max exponent of input[0, n), +-Inf/NaN ignored or not.
+uint32_t MaxExponentScalar(const float* input, int n, bool ignore_nan_inf) {
+  uint32_t max_exp = 0;
+  for (int i = 0; i < n; i++) {
+    max_exp = std::max(max_exp, ignore_nan_inf ? MaskedExponent(input[i])
+                                               : GetExponentCPU(input[i]));
+  }
+  return max_exp;
+}
+
+// Round half to even to a multiple of scale and clamp to +-max_v, +-Inf/NaN
+// as is. scale and max_v are per element, or one for all with stride 0.
+void QuantizeScalar(const float* input,
+                    float* output,
+                    int n,
+                    const float* scale,
+                    const float* max_v,
+                    int stride) {
+  for (int i = 0; i < n; i++) {
+    float s = scale[i * stride];
+    float m = max_v[i * stride];
+    if (GetExponentCPU(input[i]) == 0xff) {
+      output[i] = input[i];
+    } else {
+      float x = std::nearbyintf(input[i] / s) * s;
+      output[i] = std::max(-m, std::min(x, m));
+    }
+  }
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef __GNUC__
+#define BFP_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BFP_TARGET(isa)
+#endif
+
+BFP_TARGET("avx2")
+__m256i ExponentAVX2(__m256 v) {
+  return _mm256_and_si256(_mm256_srli_epi32(_mm256_castps_si256(v), 23),
+                          _mm256_set1_epi32(0xff));
+}
+
+BFP_TARGET("avx2")
+void UpdateMaxExponentAVX2(uint32_t* shared, const float* input, int n) {
+  const __m256i nan_inf = _mm256_set1_epi32(0xff);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i exp = ExponentAVX2(_mm256_loadu_ps(input + i));
+    exp = _mm256_andnot_si256(_mm256_cmpeq_epi32(exp, nan_inf), exp);
+    __m256i* dst = reinterpret_cast<__m256i*>(shared + i);
+    _mm256_storeu_si256(dst, _mm256_max_epu32(_mm256_loadu_si256(dst), exp));
+  }
+  UpdateMaxExponentScalar(shared + i, input + i, n - i);
+}
+
+BFP_TARGET("avx2")
+uint32_t MaxExponentAVX2(const float* input, int n, bool ignore_nan_inf) {
+  const __m256i nan_inf = _mm256_set1_epi32(ignore_nan_inf ? 0xff : -1);
+  __m256i max_exp = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i exp = ExponentAVX2(_mm256_loadu_ps(input + i));
+    exp = _mm256_andnot_si256(_mm256_cmpeq_epi32(exp, nan_inf), exp);
+    max_exp = _mm256_max_epu32(max_exp, exp);
+  }
+  uint32_t lanes[8];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), max_exp);
+  uint32_t result = MaxExponentScalar(input + i, n - i, ignore_nan_inf);
+  for (auto lane : lanes) {
+    result = std::max(result, lane);
+  }
+  return result;
+}
+
+BFP_TARGET("avx2")
+void QuantizeAVX2(const float* input,
+                  float* output,
+                  int n,
+                  const float* scale,
+                  const float* max_v,
+                  int stride) {
+  const __m256i nan_inf = _mm256_set1_epi32(0xff);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 x = _mm256_loadu_ps(input + i);
+    __m256 s = stride ? _mm256_loadu_ps(scale + i) : _mm256_set1_ps(*scale);
+    __m256 m = stride ? _mm256_loadu_ps(max_v + i) : _mm256_set1_ps(*max_v);
+    __m256 q = _mm256_round_ps(_mm256_div_ps(x, s),
+                               _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    q = _mm256_mul_ps(q, s);
+    // Operands in the order of std::min/std::max for the same signed zeros.
+    q = _mm256_max_ps(_mm256_min_ps(m, q),
+                      _mm256_sub_ps(_mm256_setzero_ps(), m));
+    __m256 keep = _mm256_castsi256_ps(
+        _mm256_cmpeq_epi32(ExponentAVX2(x), nan_inf));
+    _mm256_storeu_ps(output + i, _mm256_blendv_ps(q, x, keep));
+  }
+  QuantizeScalar(input + i, output + i, n - i, scale + i * stride,
+                 max_v + i * stride, stride);
+}
+
+BFP_TARGET("avx512f")
+__m512i ExponentAVX512(__m512 v) {
+  return _mm512_and_si512(_mm512_srli_epi32(_mm512_castps_si512(v), 23),
+                          _mm512_set1_epi32(0xff));
+}
+
+BFP_TARGET("avx512f")
+void UpdateMaxExponentAVX512(uint32_t* shared, const float* input, int n) {
+  const __m512i nan_inf = _mm512_set1_epi32(0xff);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512i exp = ExponentAVX512(_mm512_loadu_ps(input + i));
+    exp = _mm512_maskz_mov_epi32(_mm512_cmpneq_epi32_mask(exp, nan_inf), exp);
+    __m512i max_exp = _mm512_max_epu32(_mm512_loadu_si512(shared + i), exp);
+    _mm512_storeu_si512(shared + i, max_exp);
+  }
+  UpdateMaxExponentScalar(shared + i, input + i, n - i);
+}
+
+BFP_TARGET("avx512f")
+uint32_t MaxExponentAVX512(const float* input, int n, bool ignore_nan_inf) {
+  const __m512i nan_inf = _mm512_set1_epi32(ignore_nan_inf ? 0xff : -1);
+  __m512i max_exp = _mm512_setzero_si512();
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512i exp = ExponentAVX512(_mm512_loadu_ps(input + i));
+    exp = _mm512_maskz_mov_epi32(_mm512_cmpneq_epi32_mask(exp, nan_inf), exp);
+    max_exp = _mm512_max_epu32(max_exp, exp);
+  }
+  return std::max<uint32_t>(_mm512_reduce_max_epu32(max_exp),
+      MaxExponentScalar(input + i, n - i, ignore_nan_inf));
+}
+
+BFP_TARGET("avx512f")
+void QuantizeAVX512(const float* input,
+                    float* output,
+                    int n,
+                    const float* scale,
+                    const float* max_v,
+                    int stride) {
+  const __m512i nan_inf = _mm512_set1_epi32(0xff);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512 x = _mm512_loadu_ps(input + i);
+    __m512 s = stride ? _mm512_loadu_ps(scale + i) : _mm512_set1_ps(*scale);
+    __m512 m = stride ? _mm512_loadu_ps(max_v + i) : _mm512_set1_ps(*max_v);
+    __m512 q = _mm512_roundscale_ps(_mm512_div_ps(x, s),
+        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    q = _mm512_mul_ps(q, s);
+    // Operands in the order of std::min/std::max for the same signed zeros.
+    q = _mm512_max_ps(_mm512_min_ps(m, q),
+                      _mm512_sub_ps(_mm512_setzero_ps(), m));
+    __mmask16 keep = _mm512_cmpeq_epi32_mask(ExponentAVX512(x), nan_inf);
+    _mm512_storeu_ps(output + i, _mm512_mask_blend_ps(keep, q, x));
+  }
+  QuantizeScalar(input + i, output + i, n - i, scale + i * stride,
+                 max_v + i * stride, stride);
+}
+#endif
+
+struct BFPKernels {
+  void (*update_max_exponent)(uint32_t*, const float*, int);
+  uint32_t (*max_exponent)(const float*, int, bool);
+  void (*quantize)(const float*, float*, int, const float*, const float*,
+                   int);
+};
+
+// Picks the widest kernels the CPU supports, once.
+const BFPKernels& GetBFPKernels() {
+  static const BFPKernels kernels = [] {
+    BFPKernels k{UpdateMaxExponentScalar, MaxExponentScalar, QuantizeScalar};
+#if defined(__x86_64__) || defined(_M_X64)
+    int info[4] = {0, 0, 0, 0};
+#ifdef __GNUC__
+    __cpuid_count(0, 0, info[0], info[1], info[2], info[3]);
+    int max_leaf = info[0];
+    info[1] = 0;
+    if (max_leaf >= 7) {
+      __cpuid_count(7, 0, info[0], info[1], info[2], info[3]);
+    }
+#else
+    __cpuidex(info, 0, 0);
+    int max_leaf = info[0];
+    info[1] = 0;
+    if (max_leaf >= 7) {
+      __cpuidex(info, 7, 0);
+    }
+#endif
+    bool avx2 = (info[1] & (1 << 5)) != 0;      // AVX2: EBX[5]
+    bool avx512f = (info[1] & (1 << 16)) != 0;  // AVX-512F: EBX[16]
+    if (avx512f) {
+      k = {UpdateMaxExponentAVX512, MaxExponentAVX512, QuantizeAVX512};
+    } else if (avx2) {
+      k = {UpdateMaxExponentAVX2, MaxExponentAVX2, QuantizeAVX2};
+    }
+#endif
+    return k;
+  }();
+  return kernels;
+}
+
+// The elements a parallel range should cover at least.
+const int64_t kGrain = 1 << 14;
+
+// The scale and the clamp bound of a block with this shared exponent.
+void GetBFPScale(uint32_t shared_exp, int bit_width, float* scale,
+                 float* max_v) {
+  // Minus 127 to get unbiased value.
+  int shared_exp_value = static_cast<int>(shared_exp) - 127;
+  // 1 sign bit, 8 exp bits.
+  int m_bits = bit_width - 9;
+  double block_scale = std::ldexp(1.0, shared_exp_value - (m_bits - 1));
+  // Both are exact in float, 2^(e + 1) alone may not be.
+  *scale = static_cast<float>(block_scale);
+  *max_v = static_cast<float>(std::ldexp(1.0, shared_exp_value + 1) -
+                              block_scale);
+}
+
+}  // namespace
+
 void BFPCPUKernel(const float* input,
                   float* output,
                   int n,
@@ -78,9 +329,31 @@ void LaunchBFPCPUKernel(const float* input,
                         int block_size,
                         int rounding_mode) {
   int num_blocks = n / block_size;
-  for (int index = 0; index < num_blocks; index++) {
-    BFPCPUKernel(input, output, n, index, num_blocks, bit_width, rounding_mode);
+  if (num_blocks == 0) {
+    return;
   }
+  // Block index holds the elements index + k * num_blocks, the column index
+  // of rows of num_blocks elements: walk the rows, not the columns, and
+  // split the columns between the threads.
+  const auto& kernels = GetBFPKernels();
+  std::vector<uint32_t> shared_exp(num_blocks, 0);
+  std::vector<float> scale(num_blocks);
+  std::vector<float> max_v(num_blocks);
+  ParallelFor(num_blocks, kGrain / block_size, [&](int64_t begin, int64_t end) {
+    int width = static_cast<int>(end - begin);
+    for (int row = 0; row + begin < n; row += num_blocks) {
+      kernels.update_max_exponent(shared_exp.data() + begin,
+          input + row + begin, std::min<int64_t>(width, n - row - begin));
+    }
+    for (int64_t index = begin; index < end; index++) {
+      GetBFPScale(shared_exp[index], bit_width, &scale[index], &max_v[index]);
+    }
+    for (int row = 0; row + begin < n; row += num_blocks) {
+      kernels.quantize(input + row + begin, output + row + begin,
+          std::min<int64_t>(width, n - row - begin), scale.data() + begin,
+          max_v.data() + begin, 1);
+    }
+  });
 }
 
 void BFPCPUKernelV2(const float* input,
@@ -129,11 +402,18 @@ void LaunchBFPCPUKernelV2(const float* input,
                           int bit_width,
                           int block_size,
                           int rounding_mode) {
+  const auto& kernels = GetBFPKernels();
   int num_blocks = n / block_size;
-  for (int index = 0; index < num_blocks; index++) {
-    BFPCPUKernel(input, output, index * block_size + block_size,
-                 index * block_size, 1, bit_width, rounding_mode);
-  }
+  ParallelFor(num_blocks, kGrain / block_size, [&](int64_t begin, int64_t end) {
+    for (int64_t index = begin; index < end; index++) {
+      int64_t offset = index * block_size;
+      float scale, max_v;
+      GetBFPScale(kernels.max_exponent(input + offset, block_size, true),
+                  bit_width, &scale, &max_v);
+      kernels.quantize(input + offset, output + offset, block_size, &scale,
+                       &max_v, 0);
+    }
+  });
 }
 
 void LaunchBFPPrimeCPUKernel(const float* input,
@@ -146,11 +426,13 @@ void LaunchBFPPrimeCPUKernel(const float* input,
                              const int rounding_mode) {
 
   int num_blocks = n / block_size;
-  for (int index = 0; index < num_blocks; index++) {
-    BFPPrimeCPUKernel(input, output, n, index * block_size/*offset*/, 1/*stride*/,
-        bit_width, block_size, sub_block_size, sub_block_shift_bits,
-        rounding_mode);
-  }
+  ParallelFor(num_blocks, kGrain / block_size, [&](int64_t begin, int64_t end) {
+    for (int64_t index = begin; index < end; index++) {
+      BFPPrimeCPUKernel(input, output, n, index * block_size/*offset*/,
+          1/*stride*/, bit_width, block_size, sub_block_size, sub_block_shift_bits,
+          rounding_mode);
+    }
+  });
 }
 
 // Notable things:
@@ -174,11 +456,13 @@ void BFPPrimeCPUKernel(const float* input,
   const uint32_t m_bfp = bit_width - 9;
   const uint32_t exp_bias = 127;
 
-  uint32_t shared_exp = GetMaxExponentCPU(input + offset, block_size);
+  const auto& kernels = GetBFPKernels();
+  uint32_t shared_exp =
+      kernels.max_exponent(input + offset, block_size, false);
 
   for (int i = 0; i < block_size / sub_block_size; i++) {
-    uint32_t max_sub_exp = GetMaxExponentCPU(
-        input + offset + i * sub_block_size, sub_block_size);
+    uint32_t max_sub_exp = kernels.max_exponent(
+        input + offset + i * sub_block_size, sub_block_size, false);
 
     // Compute sub-block shifts. Each sub-block shift is the difference between
     // the shared exponent and the maximum exponent in the sub-block,
@@ -190,6 +474,9 @@ void BFPPrimeCPUKernel(const float* input,
     } else {
       shift = shared_exp - max_sub_exp;
     }
+    // 2^(E - bias) * 2^(-D) * 2^(1-m), the same for the whole sub-block.
+    double sub_block_scale = std::pow(2.0,
+        static_cast<int>(shared_exp - exp_bias - shift + 1 - m_bfp));
 
     for (int j = 0; j < sub_block_size; j++) {
       auto idx = offset + i * sub_block_size + j;
@@ -222,9 +509,145 @@ void BFPPrimeCPUKernel(const float* input,
         output[idx] = __uint_as_float(0x7fffffff);
       } else {
         // v = (−1)^s * 2^(E - bias) * 2^(-D) * 2^(1-m) * M
-        output[idx] = sign * std::pow(2.0,
-            static_cast<int>(shared_exp - exp_bias - shift + 1 - m_bfp)) * static_cast<int>(mantissa);
+        output[idx] = sign * sub_block_scale * static_cast<int>(mantissa);
       }
     }
   }
 }
+
+void LaunchBFPCPUKernelAxis(const float* input,
+                            float* output,
+                            const int outer,
+                            const int channels,
+                            const int inner,
+                            const int last,
+                            const int bit_width,
+                            const int block_size,
+                            const int rounding_mode) {
+  // The blocks of LaunchBFPCPUKernel interleave over the whole padded copy,
+  // so find where each element would be in it: the copy is laid out as
+  // [outer, last, inner / last, padded].
+  const int64_t padded = (channels + block_size - 1) / block_size * block_size;
+  const int64_t num_blocks = outer * inner * padded / block_size;
+  const int mid = inner / last;
+  std::vector<uint32_t> shared_exp(num_blocks, 0);
+  auto for_each = [&](int64_t o_begin, int64_t o_end, auto&& f) {
+    int64_t i = o_begin * channels * inner;
+    for (int64_t o = o_begin; o < o_end; o++) {
+      for (int64_t c = 0; c < channels; c++) {
+        for (int64_t s = 0; s < inner; s++, i++) {
+          int64_t pos = o * inner + (s % last) * mid + s / last;
+          f(i, (pos * padded + c) % num_blocks);
+        }
+      }
+    }
+  };
+  // The padding is zeros, which never raise the shared exponent. Blocks
+  // span outer indices, so only the quantization runs in parallel.
+  for_each(0, outer, [&](int64_t i, int64_t block) {
+    uint32_t exp = GetExponentCPU(input[i]);
+    if (exp != 0xff && exp > shared_exp[block]) {
+      shared_exp[block] = exp;
+    }
+  });
+  // 1 sign bit, 8 exp bits.
+  int m_bits = bit_width - 9;
+  std::vector<double> scale(num_blocks);
+  std::vector<double> max_v(num_blocks);
+  for (int64_t b = 0; b < num_blocks; b++) {
+    int shared_exp_value = static_cast<int>(shared_exp[b]) - 127;
+    scale[b] = std::pow(2.0, shared_exp_value - (m_bits - 1));
+    max_v[b] = std::pow(2.0, shared_exp_value + 1) - scale[b];
+  }
+  ParallelFor(outer, kGrain / (channels * inner),
+              [&](int64_t begin, int64_t end) {
+    for_each(begin, end, [&](int64_t i, int64_t block) {
+      if (GetExponentCPU(input[i]) == 0xff) {
+        output[i] = input[i];
+      } else {
+        auto x = std::nearbyintf(input[i] / scale[block]) * scale[block];
+        output[i] = std::max(-max_v[block], std::min(x, max_v[block]));
+      }
+    });
+  });
+}
+
+void LaunchBFPCPUKernelV2Axis(const float* input,
+                              float* output,
+                              const int outer,
+                              const int channels,
+                              const int inner,
+                              const int bit_width,
+                              const int block_size,
+                              const int rounding_mode) {
+  // A block is block_size channels at one inner position, a column of
+  // rows of inner elements: walk the rows. The tail block is short, its
+  // padding would be zeros, which neither raise the shared exponent nor
+  // reach the output.
+  const auto& kernels = GetBFPKernels();
+  const int channel_blocks = (channels + block_size - 1) / block_size;
+  ParallelFor(static_cast<int64_t>(outer) * channel_blocks,
+              kGrain / (static_cast<int64_t>(block_size) * inner),
+              [&](int64_t begin, int64_t end) {
+    std::vector<uint32_t> shared_exp(inner);
+    std::vector<float> scale(inner);
+    std::vector<float> max_v(inner);
+    for (int64_t unit = begin; unit < end; unit++) {
+      int64_t o = unit / channel_blocks;
+      int c = static_cast<int>(unit % channel_blocks) * block_size;
+      int rows = std::min(block_size, channels - c);
+      int64_t offset = (o * channels + c) * inner;
+      std::fill(shared_exp.begin(), shared_exp.end(), 0);
+      for (int r = 0; r < rows; r++) {
+        kernels.update_max_exponent(shared_exp.data(),
+                                    input + offset + r * inner, inner);
+      }
+      for (int s = 0; s < inner; s++) {
+        GetBFPScale(shared_exp[s], bit_width, &scale[s], &max_v[s]);
+      }
+      for (int r = 0; r < rows; r++) {
+        kernels.quantize(input + offset + r * inner,
+                         output + offset + r * inner, inner, scale.data(),
+                         max_v.data(), 1);
+      }
+    }
+  });
+}
+
+void LaunchBFPPrimeCPUKernelAxis(const float* input,
+                                 float* output,
+                                 const int outer,
+                                 const int channels,
+                                 const int inner,
+                                 const int bit_width,
+                                 const int block_size,
+                                 const int sub_block_size,
+                                 const int sub_block_shift_bits,
+                                 const int rounding_mode) {
+  // The sub-blocks need a contiguous block, gather it zero padded.
+  const int channel_blocks = (channels + block_size - 1) / block_size;
+  ParallelFor(static_cast<int64_t>(outer) * channel_blocks,
+              kGrain / (static_cast<int64_t>(block_size) * inner),
+              [&](int64_t begin, int64_t end) {
+    std::vector<float> block(block_size);
+    std::vector<float> quantized(block_size);
+    for (int64_t unit = begin; unit < end; unit++) {
+      int64_t o = unit / channel_blocks;
+      int c = static_cast<int>(unit % channel_blocks) * block_size;
+      int rows = std::min(block_size, channels - c);
+      int64_t offset = (o * channels + c) * inner;
+      for (int s = 0; s < inner; s++) {
+        std::fill(block.begin() + rows, block.end(), 0.0f);
+        for (int r = 0; r < rows; r++) {
+          block[r] = input[offset + r * inner + s];
+        }
+        BFPPrimeCPUKernel(block.data(), quantized.data(), block_size, 0, 1,
+                          bit_width, block_size, sub_block_size,
+                          sub_block_shift_bits, rounding_mode);
+        for (int r = 0; r < rows; r++) {
+          output[offset + r * inner + s] = quantized[r];
+        }
+      }
+    }
+  });
+}
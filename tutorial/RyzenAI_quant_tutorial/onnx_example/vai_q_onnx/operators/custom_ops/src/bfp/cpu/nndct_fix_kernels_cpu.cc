@@ -12,17 +12,24 @@
 //#include <bitset>
 #include "bfp/cpu/nndct_fix_kernels_cpu.h"
 #include "bfp/cpu/nndct_cpu_math.h"
+#include "bfp/cpu/parallel_for.h"
+
+// The elements a parallel range should cover at least. The loops keep
+// the global index as the seed, the results don't depend on the split.
+static const int64_t kFixGrain = 1 << 14;
 
 template<typename Dtype>
 static void _cpu_vai_round(const int N, 
                            const Dtype* src, 
                            Dtype* dst, 
                            int method){
-  for(int index=0; index < N; index ++){
+  ParallelFor(N, kFixGrain, [&](int64_t begin, int64_t end){
+  for(int index=begin; index < end; index ++){
     int result_ = 0;
     _vai_round_cpu(src[index], result_, method, index);
     dst[index] = result_;
   }
+  });
 }
 
 template<typename Dtype>
@@ -58,7 +65,8 @@ static void _fix_neuron_v1(const int N,
                            int keep_scale, 
                            int method){
   //NNDCT_KERNEL_LOOP(index, N)
-  for(int index=0; index < N; index ++){
+  ParallelFor(N, kFixGrain, [&](int64_t begin, int64_t end){
+  for(int index=begin; index < end; index ++){
     //method:
     //1: dummy
     //2: for CNN feature map
@@ -79,6 +87,7 @@ static void _fix_neuron_v1(const int N,
     else
       dst[index] = result_;
   }
+  });
 }
 
 template<typename Dtype>
@@ -92,7 +101,8 @@ static void _fix_neuron_v2(const int N,
                            int keep_scale, 
                            int method){
   //NNDCT_KERNEL_LOOP(index, N){
-  for(int index=0; index < N; index ++){
+  ParallelFor(N, kFixGrain, [&](int64_t begin, int64_t end){
+  for(int index=begin; index < end; index ++){
     //method: 
     //1: dummy
     //2: for CNN feature map
@@ -112,6 +122,7 @@ static void _fix_neuron_v2(const int N,
     else
       dst[index] = result_;
   }
+  });
 }
 
 template<typename Dtype>
@@ -126,7 +137,8 @@ static void _fix_neuron_v2_2d(const int N_row,
                               int keep_scale, 
                               int method){
   //NNDCT_KERNEL_LOOP(index, N){
-  for(int i=0; i < N_row*N_col; i ++){
+  ParallelFor(int64_t(N_row)*N_col, kFixGrain, [&](int64_t begin, int64_t end){
+  for(int i=begin; i < end; i ++){
     //method: 
     //1: dummy
     //2: for CNN feature map
@@ -148,6 +160,7 @@ static void _fix_neuron_v2_2d(const int N_row,
     else
       dst[i] = result_;
   }
+  });
 }
 
 template<typename Dtype>
@@ -324,8 +337,11 @@ void cpu_diff_S(const int N,
                       0,
                       1,
                       method);
-    cpu_sub(N, src, buffer);
-    cpu_pow(N, buffer, Dtype(2));
+    ParallelFor(N, kFixGrain, [&](int64_t begin, int64_t end){
+      cpu_sub(end - begin, src + begin, buffer + begin);
+      cpu_pow(end - begin, buffer + begin, Dtype(2));
+    });
+    // Summed in order, the same as on one thread.
     Dtype fixed_diff;
     cpu_sum(N, buffer, fixed_diff);
     if (fixed_diff < fixed_diff_min) {
@@ -0,0 +1,110 @@
+//
+// Copyright (C) 2023, Advanced Micro Devices, Inc. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "bfp/cpu/parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+thread_local bool in_worker = false;
+std::atomic<int> max_threads{0};
+
+class ThreadPool {
+ public:
+  explicit ThreadPool(int num_workers) : num_workers_(num_workers) {
+    for (int i = 0; i < num_workers; i++) {
+      // Detached and never joined: the pool lives until the process exits,
+      // joining from a static destructor can hang a DLL unload.
+      std::thread([this] {
+        in_worker = true;
+        for (;;) {
+          std::function<void()> task;
+          {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [this] { return !tasks_.empty(); });
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+          }
+          task();
+        }
+      }).detach();
+    }
+  }
+
+  int num_workers() const { return num_workers_; }
+
+  void post(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+  }
+
+ private:
+  int num_workers_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> tasks_;
+};
+
+ThreadPool& GetThreadPool() {
+  // The caller of ParallelFor takes a range too.
+  static ThreadPool* pool = new ThreadPool(
+      std::max(1u, std::thread::hardware_concurrency()) - 1);
+  return *pool;
+}
+
+}  // namespace
+
+void ParallelFor(int64_t n,
+                 int64_t grain,
+                 const std::function<void(int64_t, int64_t)>& fn) {
+  if (n <= 0) {
+    return;
+  }
+  grain = std::max<int64_t>(grain, 1);
+  int64_t num_ranges = (n + grain - 1) / grain;
+  if (num_ranges > 1 && !in_worker) {
+    num_ranges = std::min<int64_t>(num_ranges,
+                                   GetThreadPool().num_workers() + 1);
+    int cap = max_threads.load(std::memory_order_relaxed);
+    if (cap > 0) {
+      num_ranges = std::min<int64_t>(num_ranges, cap);
+    }
+  }
+  if (num_ranges <= 1 || in_worker) {
+    fn(0, n);
+    return;
+  }
+  int64_t range = (n + num_ranges - 1) / num_ranges;
+  std::mutex mtx;
+  std::condition_variable cv;
+  int64_t pending = (n + range - 1) / range - 1;
+  for (int64_t begin = range; begin < n; begin += range) {
+    int64_t end = std::min(begin + range, n);
+    GetThreadPool().post([&, begin, end] {
+      fn(begin, end);
+      std::lock_guard<std::mutex> lock(mtx);
+      if (--pending == 0) {
+        cv.notify_one();
+      }
+    });
+  }
+  fn(0, std::min(range, n));
+  std::unique_lock<std::mutex> lock(mtx);
+  cv.wait(lock, [&] { return pending == 0; });
+}
+
+void SetParallelForThreads(int num_threads) {
+  max_threads.store(std::max(num_threads, 0), std::memory_order_relaxed);
+}
@@ -54,14 +54,43 @@ __device__ float StochsticRound(float v, int seed) {
   //return __float2int_rd(v + RandUniform(seed));
 }
 
+// Lanes of a warp cooperating on one BFP block: the block itself when its
+// size is a power of two up to a warp, so every lane loads one element, a
+// whole warp striding over it otherwise. The groups stay aligned to the
+// warp as the thread blocks are a multiple of 32 threads.
+static int GetBlockLanes(int block_size) {
+  if (block_size <= 32 && (block_size & (block_size - 1)) == 0) {
+    return block_size;
+  }
+  return 32;
+}
+
+// Max over the `lanes` (a power of two up to 32) aligned lanes around this
+// one. Every lane of the warp has to get here.
+__device__ uint32_t GroupMax(uint32_t v, int lanes) {
+  for (int offset = lanes / 2; offset > 0; offset /= 2) {
+#ifdef __HIP_PLATFORM_AMD__
+    v = max(v, static_cast<uint32_t>(__shfl_xor(static_cast<int>(v), offset)));
+#else
+    v = max(v, __shfl_xor_sync(0xffffffff, v, offset));
+#endif
+  }
+  return v;
+}
+
+// One thread per block. The elements of a block are `columns` apart, so
+// neighbouring threads read neighbouring addresses.
 __global__ void BFPCUDAKernel(int bit_width,
                               int n,
+                              int columns,
                               const float* input,
                               float* output) {
   int index = blockIdx.x * blockDim.x + threadIdx.x;
-  int stride = gridDim.x * blockDim.x;
+  if (index >= columns) {
+    return;
+  }
   uint32_t shared_exp = 0;
-  for (int i = index; i < n; i += stride) {
+  for (int i = index; i < n; i += columns) {
     uint32_t exp = GetExponent(input[i]);
     if (exp == 0xff) {
       exp = 0;
@@ -78,7 +107,7 @@ __global__ void BFPCUDAKernel(int bit_width,
   int m_bits = bit_width - 9;
   auto scale = std::pow(2.0, shared_exp_value - (m_bits - 1));
   auto max_v = std::pow(2.0, shared_exp_value + 1) - scale;
-  for (int i = index; i < n; i += stride) {
+  for (int i = index; i < n; i += columns) {
     // Output +-0/NaN/Inf as is.
     auto exp = GetExponent(input[i]);
     if (exp == 0xff) {
@@ -97,49 +126,55 @@ void LaunchBFPCUDAKernel(const float* input,
                          int n,
                          int bit_width,
                          int block_size) {
-  BFPCUDAKernel<<<n / block_size, 1>>>(bit_width, n, input, output);
+  const int columns = n / block_size;
+  if (columns == 0) {
+    return;
+  }
+  int threads_per_block = 256;
+  int blocks = (columns + threads_per_block - 1) / threads_per_block;
+  BFPCUDAKernel<<<blocks, threads_per_block>>>(
+      bit_width, n, columns, input, output);
 }
 
+// A group of `lanes` threads per block, see GetBlockLanes. The axis is
+// padded to whole blocks, so block b starts at b * block_size.
 __global__ void BFPCUDAKernelV2(const float* input,
                                 float* output,
-                                const int num_threads,
-                                const int axis_size,
+                                const int num_blocks,
                                 const int bit_width,
                                 const int block_size,
+                                const int lanes,
                                 const int rounding_mode) {
   int index = blockDim.x * blockIdx.x + threadIdx.x;
-  if (index >= num_threads) {
-    return;
-  }
+  const int block = index / lanes;
+  const int lane = index % lanes;
+  const bool valid = block < num_blocks;
+  const int offset = block * block_size;
 
-  const int axis_blocks = axis_size / block_size;
-  const int block_index = index % axis_blocks;
-  const int axis_index = index / axis_blocks;
-  //if (threadIdx.x >= 1) {
-  //  printf("index=%d, axis_blocks=%d, block_index=%d, axis_index=%d\n",
-  //      index, axis_blocks, block_index, axis_index);
-  //}
-
-  int offset = axis_index * axis_size + block_index * block_size;
-  // Loop over bounding box to find shared exponent
   uint32_t shared_exp = 0;
-  for (int i = 0; i < block_size; i++) {
-    uint32_t exp = GetExponent(input[offset + i]);
-    if (exp == 0xff) {
-      exp = 0;
-    }
-    if (exp > shared_exp) {
-      shared_exp = exp;
+  if (valid) {
+    for (int i = lane; i < block_size; i += lanes) {
+      uint32_t exp = GetExponent(input[offset + i]);
+      if (exp == 0xff) {
+        exp = 0;
+      }
+      if (exp > shared_exp) {
+        shared_exp = exp;
+      }
     }
   }
-  
+  shared_exp = GroupMax(shared_exp, lanes);
+  if (!valid) {
+    return;
+  }
+
   // Minus 127 to get unbiased value.
   int shared_exp_value = static_cast<int>(shared_exp) - 127;
   // 1 sign bit, 8 exp bits.
   int m_bits = bit_width - 9;
   auto scale = pow(2.0, shared_exp_value - (m_bits - 1));
   auto max_v = pow(2.0, shared_exp_value + 1) - scale;
-  for (int i = 0; i < block_size; i++) {
+  for (int i = lane; i < block_size; i += lanes) {
     // Output +-0/NaN/Inf as is.
     auto index = offset + i;
     auto exp = GetExponent(input[index]);
@@ -154,7 +189,6 @@ __global__ void BFPCUDAKernelV2(const float* input,
         rounded_scaled_x = nearbyintf(scaled_x);
       } else if (rounding_mode == 1) {
         rounded_scaled_x = StochsticRound(scaled_x, index);
-        //printf("index=%d, scaled_x=%f, rounded_scaled_x=%f, nearbyintf=%f\n", index, scaled_x, rounded_scaled_x, nearbyintf(scaled_x));
       }
       // Clamp(x, min_v, max_v)
       output[index] = max(-max_v, min(rounded_scaled_x * scale, max_v));
@@ -171,122 +205,149 @@ void LaunchBFPCUDAKernelV2(
     const int block_size,
     const int rounding_mode) {
   
-  const int threads = n / block_size;
-  
+  const int num_blocks = n / block_size;
+  const int lanes = GetBlockLanes(block_size);
+  const int threads = num_blocks * lanes;
+  if (threads == 0) {
+    return;
+  }
+
   int threads_per_block = 256;
-  int blocks = static_cast<int>(
-      ceil(static_cast<float>(threads) / threads_per_block));
+  int blocks = (threads + threads_per_block - 1) / threads_per_block;
   BFPCUDAKernelV2<<<blocks, threads_per_block>>>(
     input,
     output,
-    threads,
-    axis_size,
+    num_blocks,
     bit_width,
     block_size,
+    lanes,
     rounding_mode
   );
 }
 
+__device__ float BFPPrimeValue(float x,
+                               uint32_t shared_exp,
+                               uint32_t shift,
+                               uint32_t m_bfp,
+                               int rounding_mode,
+                               int idx) {
+  // Mantissa bits of float32.
+  const uint32_t m_float = 23;
+  const uint32_t exp_bias = 127;
+
+  uint32_t input_x = __float_as_uint(x);
+  uint32_t exp = (input_x & 0x7f800000) >> m_float;
+  uint32_t mantissa;
+  if (exp == 0) {
+    // Subnormals are flushed to zero.
+    mantissa = 0;
+  } else {
+    // Add leading 1.
+    mantissa = (input_x & 0x7fffff) | (1 << m_float);
+  }
+  // Right shift mantissa by the exponent difference + the mantissa bitwidth difference
+  uint32_t num_bits_shifting = shared_exp - shift - exp + m_float - m_bfp;
+  if (num_bits_shifting >= 32) {
+    // Shift a number of bits equal or greater than the bit width is undefined behavior.
+    num_bits_shifting = 31;
+  }
+  mantissa >>= num_bits_shifting;
+  // Do not round up if mantissa is all 1s.
+  if (rounding_mode != 0 && mantissa != ((1 << (m_bfp + 1)) - 1)) {
+    // 0: Round toward zero
+    // 1: Round half away from zero
+    // 2: Stochstic rounding
+    if (rounding_mode == 1) {
+      mantissa += 1;
+    } else if (rounding_mode == 2) {
+      if (num_bits_shifting < 1 + m_float) {
+        uint32_t mask = (1 << (num_bits_shifting + 1)) - 1;
+        uint32_t p = Rand(idx);
+        if ((p & mask) < (input_x & mask)) {
+          mantissa += 2;
+        }
+      }
+    }
+  }
+
+  // Truncate the last bit
+  mantissa >>= 1;
+  int sign = input_x & 0x80000000 ? -1 : 1;
+  // If any number in a block is +-Inf/NaN,
+  // then every number in the output is a NaN.
+  if (shared_exp == 0xff) {
+    return __uint_as_float(0x7fffffff);
+  }
+  // v = (−1)^s * 2^(E - bias) * 2^(-D) * 2^(1-m) * M
+  return sign * std::pow(2.0,
+      static_cast<int>(shared_exp - exp_bias - shift + 1 - m_bfp)) * mantissa;
+}
+
 // Notable things:
 // 1. +-INF are converted to NaNs
 // 2. All subnormal numbers are flushed to zeros.
 // 3. When the shared exponent is 2^w - 1, all k values in a block are NaNs
+//
+// Laid out as BFPCUDAKernelV2. The lanes walk the block in steps of a full
+// group so the shuffles see every lane, and a sub-block whose size is a
+// power of two fitting in the group reduces its max exponent over the lanes
+// too, any other sub-block is read again by each of its threads.
 __global__ void BFPPrimeCUDAKernel(const float* input,
                                    float* output,
-                                   const int num_threads,
-                                   const int axis_size,
+                                   const int num_blocks,
                                    const int bit_width,
                                    const int block_size,
+                                   const int lanes,
                                    const int sub_block_size,
                                    const int sub_block_shift_bits,
                                    const int rounding_mode) {
   int index = blockDim.x * blockIdx.x + threadIdx.x;
-  if (index >= num_threads) {
-    return;
-  }
+  const int block = index / lanes;
+  const int lane = index % lanes;
+  const bool valid = block < num_blocks;
+  const int offset = block * block_size;
+  // Elements past the last whole sub-block are left alone.
+  const int covered = block_size / sub_block_size * sub_block_size;
+  const bool sub_block_lanes = sub_block_size <= lanes &&
+      (sub_block_size & (sub_block_size - 1)) == 0;
 
-  const int axis_blocks = axis_size / block_size;
-  const int block_index = index % axis_blocks;
-  const int axis_index = index / axis_blocks;
-
-  //if (threadIdx.x >= 1) {
-  //  printf("index=%d, axis_blocks=%d, block_index=%d, axis_index=%d\n",
-  //      index, axis_blocks, block_index, axis_index);
-  //}
-
-  // Mantissa bits of float32.
-  const uint32_t m_float = 23;
   // Mantissa bits of bfp, sign: 1 bit, exponent: 8 bits.
   const uint32_t m_bfp = bit_width - 9;
-  const uint32_t exp_bias = 127;
-
-  int offset = axis_index * axis_size + block_index * block_size;
-  uint32_t shared_exp = GetMaxExponent(input + offset, block_size);
 
-  for (int i = 0; i < block_size / sub_block_size; i++) {
-    uint32_t max_sub_exp = GetMaxExponent(
-        input + offset + i * sub_block_size, sub_block_size);
+  uint32_t shared_exp = 0;
+  if (valid) {
+    for (int i = lane; i < block_size; i += lanes) {
+      shared_exp = max(shared_exp, GetExponent(input[offset + i]));
+    }
+  }
+  shared_exp = GroupMax(shared_exp, lanes);
 
-    // Sub-block shift is the difference between the shared exponent and
-    // the maximum exponent in the sub-block, upper bounded by 2^d - 1.
+  // Sub-block shift is the difference between the shared exponent and
+  // the maximum exponent in the sub-block, upper bounded by 2^d - 1.
+  const uint32_t shift_upper_bound = (1 << sub_block_shift_bits) - 1;
+  for (int base = 0; base < covered; base += lanes) {
+    const int i = base + lane;
+    const bool active = valid && i < covered;
+    const float x = active ? input[offset + i] : 0.0f;
+    uint32_t max_sub_exp = 0;
+    if (sub_block_lanes) {
+      max_sub_exp = GroupMax(active ? GetExponent(x) : 0, sub_block_size);
+    } else if (active) {
+      max_sub_exp = GetMaxExponent(
+          input + offset + i / sub_block_size * sub_block_size,
+          sub_block_size);
+    }
+    if (!active) {
+      continue;
+    }
     uint32_t shift;
-    uint32_t shift_upper_bound = (1 << sub_block_shift_bits) - 1;
     if (shared_exp - max_sub_exp > shift_upper_bound) {
       shift = shift_upper_bound;
     } else {
       shift = shared_exp - max_sub_exp;
     }
-
-    for (int j = 0; j < sub_block_size; j++) {
-      auto idx = offset + i * sub_block_size + j;
-      uint32_t input_x = __float_as_uint(input[idx]);
-      uint32_t exp = (input_x & 0x7f800000) >> m_float;
-      uint32_t mantissa;
-      if (exp == 0) {
-        // Subnormals are flushed to zero.
-        mantissa = 0;
-      } else {
-        // Add leading 1.
-        mantissa = (input_x & 0x7fffff) | (1 << m_float);
-      }
-      // Right shift mantissa by the exponent difference + the mantissa bitwidth difference
-      uint32_t num_bits_shifting = shared_exp - shift - exp + m_float - m_bfp;
-      if (num_bits_shifting >= 32) {
-        // Shift a number of bits equal or greater than the bit width is undefined behavior.
-        num_bits_shifting = 31;
-      }
-      mantissa >>= num_bits_shifting;
-      // Do not round up if mantissa is all 1s.
-      if (rounding_mode != 0 && mantissa != ((1 << (m_bfp + 1)) - 1)) {
-        // 0: Round toward zero
-        // 1: Round half away from zero
-        // 2: Stochstic rounding
-        if (rounding_mode == 1) {
-          mantissa += 1;
-        } else if (rounding_mode == 2) {
-          if (num_bits_shifting < 1 + m_float) {
-            uint32_t mask = (1 << (num_bits_shifting + 1)) - 1;
-            uint32_t p = Rand(idx);
-            if ((p & mask) < (input_x & mask)) {
-              mantissa += 2;
-            }
-          }
-        }
-      }
-
-      // Truncate the last bit
-      mantissa >>= 1;
-      int sign = input_x & 0x80000000 ? -1 : 1;
-      // If any number in a block is +-Inf/NaN,
-      // then every number in the output is a NaN.
-      if (shared_exp == 0xff) {
-        output[idx] = __uint_as_float(0x7fffffff);
-      } else {
-        // v = (−1)^s * 2^(E - bias) * 2^(-D) * 2^(1-m) * M
-        output[idx] = sign * std::pow(2.0,
-            static_cast<int>(shared_exp - exp_bias - shift + 1 - m_bfp)) * mantissa;
-      }
-    }
+    output[offset + i] = BFPPrimeValue(
+        x, shared_exp, shift, m_bfp, rounding_mode, offset + i);
   }
 }
 
@@ -301,19 +362,23 @@ void LaunchBFPPrimeCUDAKernel(
     const int sub_block_shift_bits,
     const int rounding_mode) {
 
-  const int threads = n / block_size;
+  const int num_blocks = n / block_size;
+  const int lanes = GetBlockLanes(block_size);
+  const int threads = num_blocks * lanes;
+  if (threads == 0) {
+    return;
+  }
 
   int threads_per_block = 256;
-  int blocks = static_cast<int>(
-      ceil(static_cast<float>(threads) / threads_per_block));
+  int blocks = (threads + threads_per_block - 1) / threads_per_block;
 
   BFPPrimeCUDAKernel<<<blocks, threads_per_block>>>(
     input,
     output,
-    threads,
-    axis_size,
+    num_blocks,
     bit_width,
     block_size,
+    lanes,
     sub_block_size,
     sub_block_shift_bits,
     rounding_mode
@@ -49,7 +49,11 @@ Ort::Value BFPFixNeuronKernel::do_bfp(Ort::Value &input) {
   tmp_buffers_.push_back(b);
   auto output = Ort::Value::CreateTensor<float>(
     input.GetTensorMemoryInfo(), (float*)b.get_data_ptr(), element_count, dimensions.data(), dimensions.size());
-  
+  do_bfp(input, output);
+  return output;
+}
+
+void BFPFixNeuronKernel::do_bfp(Ort::Value &input, Ort::Value &output) {
   if (bfp_method_ == "to_bfp") {
     to_bfp(input, bit_width_, block_size_, rounding_mode_, output);
   } else if (bfp_method_ == "to_bfp_v2") {
@@ -63,7 +67,22 @@ Ort::Value BFPFixNeuronKernel::do_bfp(Ort::Value &input) {
     throw std::invalid_argument(
       "Invalid bfp_method, valid bfp_method should be one of [\"to_bfp\", \"to_bfp_v2\", \"to_bfp_prime_shared\"], current bfp_method is " + bfp_method_);
   }
-  return output;
+}
+
+void BFPFixNeuronKernel::do_bfp_axis(Ort::Value &input, int64_t axis, Ort::UnownedValue &output) {
+  if (bfp_method_ == "to_bfp") {
+    to_bfp_axis(input, axis, bit_width_, block_size_, rounding_mode_, output);
+  } else if (bfp_method_ == "to_bfp_v2") {
+    to_bfp_v2_axis(input, axis, bit_width_, block_size_, rounding_mode_, output);
+  } else if (bfp_method_ == "to_bfp_prime_shared") {
+    to_bfp_prime_shared_axis(
+      input, axis, bit_width_, block_size_, 
+      sub_block_size_, sub_block_shift_bits_, 
+      rounding_mode_, output);
+  } else {
+    throw std::invalid_argument(
+      "Invalid bfp_method, valid bfp_method should be one of [\"to_bfp\", \"to_bfp_v2\", \"to_bfp_prime_shared\"], current bfp_method is " + bfp_method_);
+  }
 }
 
 void BFPFixNeuronKernel::Compute(OrtKernelContext* context) {
@@ -76,28 +95,45 @@ void BFPFixNeuronKernel::Compute(OrtKernelContext* context) {
     input_value.GetTensorTypeAndShapeInfo().GetElementCount(), 
     dimensions.data(), dimensions.size());
 
-  Ort::Value ret{nullptr};
-  if (dimensions.size() == 1) {
-    auto padded_tensor = pad(context, input_tensor, block_size_);
-    auto bfp_tensor = do_bfp(padded_tensor);
-    ret = slice(context, bfp_tensor, dimensions[0]);
+#ifndef USE_CUDA
+  // On CPU, quantize straight from the input into the output along the
+  // blocking axis, no transposed and padded copies.
+  auto output = ctx.GetOutput(0, dimensions);
+  do_bfp_axis(input_tensor, dimensions.size() == 1 ? 0 : 1, output);
+#else
+  // The last step writes straight into the output, which keeps the shape
+  // of the input, and a blocking axis made of whole blocks needs no pad and
+  // slice.
+  auto output = ctx.GetOutput(0, dimensions);
+  auto output_tensor = Ort::Value::CreateTensor<float>(
+    output.GetTensorMemoryInfo(), output.GetTensorMutableData<float>(),
+    output.GetTensorTypeAndShapeInfo().GetElementCount(),
+    dimensions.data(), dimensions.size());
+  size_t last = dimensions.size() - 1;
+  size_t axis = dimensions.size() == 1 ? 0 : 1;
+  auto bfp_last_axis = [&](Ort::Value &tensor, Ort::Value &out) {
+    if (dimensions[axis] % block_size_ == 0) {
+      do_bfp(tensor, out);
+    } else {
+      auto padded_tensor = pad(context, tensor, block_size_);
+      auto bfp_tensor = do_bfp(padded_tensor);
+      slice(context, bfp_tensor, dimensions[axis], out);
+    }
+  };
+  if (axis == last) {
+    bfp_last_axis(input_tensor, output_tensor);
   } else {
-    auto transposed_tensor = transpose(context, input_tensor, 1, dimensions.size() - 1);
-    auto padded_tensor = pad(context, transposed_tensor, block_size_);
-    auto bfp_tensor = do_bfp(padded_tensor);
-    // auto bfp_tensor = std::move(padded_tensor);
-    auto sliced_tensor = slice(context, bfp_tensor, dimensions[1]);
-    ret = transpose(context, sliced_tensor, 1, dimensions.size() - 1);
+    auto transposed_tensor = transpose(context, input_tensor, axis, last);
+    std::vector<int64_t> transposed_dimensions = transposed_tensor.GetTensorTypeAndShapeInfo().GetShape();
+    size_t element_count = transposed_tensor.GetTensorTypeAndShapeInfo().GetElementCount();
+    Buffer b(element_count * 4);
+    tmp_buffers_.push_back(b);
+    auto bfp_tensor = Ort::Value::CreateTensor<float>(
+      transposed_tensor.GetTensorMemoryInfo(), (float*)b.get_data_ptr(), element_count,
+      transposed_dimensions.data(), transposed_dimensions.size());
+    bfp_last_axis(transposed_tensor, bfp_tensor);
+    transpose(context, bfp_tensor, axis, last, output_tensor);
   }
-  auto output = ctx.GetOutput(0, ret.GetTensorTypeAndShapeInfo().GetShape());
-
-#ifdef USE_CUDA
-  cudaMemcpy(
-    output.GetTensorMutableRawData(), ret.GetTensorMutableRawData(), 
-    output.GetTensorTypeAndShapeInfo().GetElementCount() * 4, cudaMemcpyKind::cudaMemcpyDeviceToDevice);
-#else
-  memcpy(output.GetTensorMutableRawData(), ret.GetTensorMutableRawData(), 
-    output.GetTensorTypeAndShapeInfo().GetElementCount() * 4);
 #endif
 
   for (Buffer b : tmp_buffers_) {
@@ -194,11 +230,17 @@ Ort::Value BFPFixNeuronKernel::transpose(OrtKernelContext* context, Ort::Value &
 
   auto output = Ort::Value::CreateTensor<float>(
     input.GetTensorMemoryInfo(), (float*)b.get_data_ptr(), element_count, dimensions.data(), dimensions.size());
+  transpose(context, input, from, to, output);
+  return output;
+}
 
+void BFPFixNeuronKernel::transpose(OrtKernelContext* context, Ort::Value &input, int from, int to, Ort::Value &output) {
+  if (!op_transpose_init_) {
+    create_transpose_op(input.GetTensorTypeAndShapeInfo().GetShape().size(), from, to);
+  }
   const OrtValue* inputs[1] = {input};
   OrtValue* outputs[1] = {output};
   op_transpose_.Invoke(context, inputs, 1, outputs, 1);
-  return output;
 }
 
 void BFPFixNeuronKernel::create_slice_op() {
@@ -217,6 +259,23 @@ void BFPFixNeuronKernel::create_slice_op() {
 }
 
 Ort::Value BFPFixNeuronKernel::slice(OrtKernelContext* context, Ort::Value &input, size_t last_dim) {
+  std::vector<int64_t> dimensions = input.GetTensorTypeAndShapeInfo().GetShape();
+  dimensions[dimensions.size() - 1] = last_dim;
+
+  size_t element_count = 1;
+  for (auto i : dimensions) {
+    element_count *= i;
+  }
+  Buffer b(element_count * 4);
+  tmp_buffers_.push_back(b);
+
+  auto output = Ort::Value::CreateTensor<float>(
+    input.GetTensorMemoryInfo(), (float*)b.get_data_ptr(), element_count, dimensions.data(), dimensions.size());
+  slice(context, input, last_dim, output);
+  return output;
+}
+
+void BFPFixNeuronKernel::slice(OrtKernelContext* context, Ort::Value &input, size_t last_dim, Ort::Value &output) {
   if (!op_slice_init_) {
     create_slice_op();
   }
@@ -240,19 +299,8 @@ Ort::Value BFPFixNeuronKernel::slice(OrtKernelContext* context, Ort::Value &inpu
     input.GetTensorMemoryInfo(), &axes[0], num_dims, &num_dims, 1);
   auto steps_tensor = Ort::Value::CreateTensor<int64_t>(
     input.GetTensorMemoryInfo(), &steps[0], num_dims, &num_dims, 1);
-  
-  size_t element_count = 1;
-  for (auto i : dimensions) {
-    element_count *= i;
-  }
-  Buffer b(element_count * 4);
-  tmp_buffers_.push_back(b);
-
-  auto output = Ort::Value::CreateTensor<float>(
-    input.GetTensorMemoryInfo(), (float*)b.get_data_ptr(), element_count, dimensions.data(), dimensions.size());
 
   const OrtValue* inputs[] = {input, start_tensor, end_tensor, axes_tensor, steps_tensor};
   OrtValue* outputs[] = {output};
   op_slice_.Invoke(context, inputs, 5, outputs, 1);
-  return output;
 }
@@ -54,6 +54,8 @@ struct BFPFixNeuronKernel {
 
   Ort::Value transpose(OrtKernelContext* context, Ort::Value &input, int from, int to);
 
+  void transpose(OrtKernelContext* context, Ort::Value &input, int from, int to, Ort::Value &output);
+
   void create_transpose_op(size_t num_dims, int from, int to);
 
   Ort::Value pad(OrtKernelContext* context, Ort::Value &input, int block_size);
@@ -62,10 +64,16 @@ struct BFPFixNeuronKernel {
 
   Ort::Value slice(OrtKernelContext* context, Ort::Value &input, size_t last_dim);
 
+  void slice(OrtKernelContext* context, Ort::Value &input, size_t last_dim, Ort::Value &output);
+
   void create_slice_op();
 
   Ort::Value do_bfp(Ort::Value &input);
 
+  void do_bfp(Ort::Value &input, Ort::Value &output);
+
+  void do_bfp_axis(Ort::Value &input, int64_t axis, Ort::UnownedValue &output);
+
  private:
 
   const OrtApi& ort_;
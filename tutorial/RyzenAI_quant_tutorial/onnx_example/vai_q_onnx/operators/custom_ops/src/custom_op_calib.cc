@@ -0,0 +1,153 @@
+//
+// Copyright (C) 2023, Advanced Micro Devices, Inc. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#define ORT_API_MANUAL_INIT
+#include "core/session/onnxruntime_cxx_api.h"
+#undef ORT_API_MANUAL_INIT
+#include "custom_op_calib.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bfp/cpu/parallel_for.h"
+
+namespace {
+
+// Elements per ParallelFor range, each range fills a local histogram.
+constexpr int64_t kCalibGrain = 1 << 16;
+
+void AtomicMin(std::atomic<float>& a, float v) {
+  float cur = a.load(std::memory_order_relaxed);
+  while (v < cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {
+  }
+}
+
+void AtomicMax(std::atomic<float>& a, float v) {
+  float cur = a.load(std::memory_order_relaxed);
+  while (v > cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+CalibCollectorKernel::CalibCollectorKernel(const OrtApi& ort_api,
+                                           const OrtKernelInfo* /*info*/,
+                                           int64_t num_bins)
+    : ort_(ort_api), num_bins_(num_bins) {
+  if (num_bins_ < 2) {
+    throw std::invalid_argument(
+      "Invalid num_bins, num_bins should be at least 2, current num_bins is " + std::to_string(num_bins_));
+  }
+  // Folding pairs of bins needs an even count.
+  num_bins_ += num_bins_ % 2;
+  histogram_.reset(new std::atomic<int64_t>[num_bins_]);
+  for (int64_t b = 0; b < num_bins_; b++) {
+    histogram_[b].store(0, std::memory_order_relaxed);
+  }
+}
+
+void CalibCollectorKernel::grow(float abs_max) {
+  if (abs_max <= threshold_) {
+    return;
+  }
+  if (threshold_ == 0.0f) {
+    // 0 is the left edge of the middle bin.
+    threshold_ = abs_max;
+    histogram_[num_bins_ / 2].fetch_add(pending_zeros_, std::memory_order_relaxed);
+    pending_zeros_ = 0;
+    return;
+  }
+  std::vector<int64_t> merged(num_bins_);
+  while (threshold_ < abs_max && threshold_ <= FLT_MAX / 2) {
+    // Over [-2t, 2t] old bin i starts num_bins / 2 + i old widths from the
+    // left edge, half as many new widths.
+    std::fill(merged.begin(), merged.end(), 0);
+    for (int64_t b = 0; b < num_bins_; b++) {
+      merged[(num_bins_ / 2 + b) / 2] += histogram_[b].load(std::memory_order_relaxed);
+    }
+    for (int64_t b = 0; b < num_bins_; b++) {
+      histogram_[b].store(merged[b], std::memory_order_relaxed);
+    }
+    threshold_ *= 2;
+  }
+}
+
+void CalibCollectorKernel::Compute(OrtKernelContext* context) {
+  Ort::KernelContext ctx(context);
+  auto input = ctx.GetInput(0);
+  const float* data = input.GetTensorData<float>();
+  const int64_t n = input.GetTensorTypeAndShapeInfo().GetElementCount();
+
+  // Range of this run, which does not touch the state.
+  std::atomic<float> run_min(INFINITY);
+  std::atomic<float> run_max(-INFINITY);
+  std::atomic<int64_t> run_count(0);
+  ParallelFor(n, kCalibGrain, [&](int64_t begin, int64_t end) {
+    float lo = INFINITY;
+    float hi = -INFINITY;
+    int64_t count = 0;
+    for (int64_t i = begin; i < end; i++) {
+      if (std::isfinite(data[i])) {
+        lo = std::min(lo, data[i]);
+        hi = std::max(hi, data[i]);
+        count++;
+      }
+    }
+    AtomicMin(run_min, lo);
+    AtomicMax(run_max, hi);
+    run_count.fetch_add(count, std::memory_order_relaxed);
+  });
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (run_count.load() > 0) {
+    float lo = run_min.load();
+    float hi = run_max.load();
+    min_ = empty_ ? lo : std::min(min_, lo);
+    max_ = empty_ ? hi : std::max(max_, hi);
+    empty_ = false;
+    grow(std::max(-lo, hi));
+
+    if (threshold_ == 0.0f) {
+      pending_zeros_ += run_count.load();
+    } else {
+      const float threshold = threshold_;
+      const float bins_per_unit = num_bins_ / (2 * threshold);
+      ParallelFor(n, kCalibGrain, [&](int64_t begin, int64_t end) {
+        std::vector<int64_t> local(num_bins_, 0);
+        for (int64_t i = begin; i < end; i++) {
+          if (!std::isfinite(data[i])) {
+            continue;
+          }
+          // The right edge goes to the last bin, as with np.histogram.
+          auto bin = static_cast<int64_t>((data[i] + threshold) * bins_per_unit);
+          local[std::min(std::max<int64_t>(bin, 0), num_bins_ - 1)]++;
+        }
+        for (int64_t b = 0; b < num_bins_; b++) {
+          if (local[b] != 0) {
+            histogram_[b].fetch_add(local[b], std::memory_order_relaxed);
+          }
+        }
+      });
+    }
+  }
+
+  auto range = ctx.GetOutput(0, {2});
+  float* range_data = range.GetTensorMutableData<float>();
+  range_data[0] = min_;
+  range_data[1] = max_;
+
+  auto histogram = ctx.GetOutput(1, {num_bins_});
+  int64_t* histogram_data = histogram.GetTensorMutableData<int64_t>();
+  for (int64_t b = 0; b < num_bins_; b++) {
+    histogram_data[b] = histogram_[b].load(std::memory_order_relaxed);
+  }
+  histogram_data[num_bins_ / 2] += pending_zeros_;
+
+  auto threshold = ctx.GetOutput(2, {1});
+  threshold.GetTensorMutableData<float>()[0] = threshold_;
+}
@@ -0,0 +1,79 @@
+//
+// Copyright (C) 2023, Advanced Micro Devices, Inc. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "core/session/onnxruntime_cxx_api.h"
+#include "core/session/onnxruntime_c_api.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+// Accumulates the calibration statistics of its input over all the runs of
+// a session, so a calibration pass streams the activations instead of
+// keeping them: the min/max and a histogram of num_bins bins over
+// [-threshold, threshold]. The histogram keeps its size, when a run goes past
+// the threshold the range doubles and neighbouring bins are merged, which
+// leaves every past count in the bin that holds its value. Non finite values
+// are not counted.
+//
+// Outputs the statistics so far on every run: range [min, max] (float),
+// histogram [num_bins] (int64) and threshold [1] (float), enough for the
+// min/max, percentile and entropy calibrators.
+struct CalibCollectorKernel {
+  CalibCollectorKernel(const OrtApi& ort_api, const OrtKernelInfo* info,
+                       int64_t num_bins);
+  void Compute(OrtKernelContext* context);
+
+ private:
+  // Doubles threshold_ until it covers abs_max.
+  void grow(float abs_max);
+
+  const OrtApi& ort_;
+  int64_t num_bins_;
+
+  // One node is one tensor, concurrent runs of the session update it in
+  // turn. Within a run the input is counted in parallel in local histograms,
+  // added to histogram_ without a lock.
+  std::mutex mtx_;
+  std::unique_ptr<std::atomic<int64_t>[]> histogram_;
+  float min_ = 0.0f;
+  float max_ = 0.0f;
+  float threshold_ = 0.0f;
+  bool empty_ = true;
+  // Zeros seen while every value so far was zero, binned once there is a
+  // threshold.
+  int64_t pending_zeros_ = 0;
+};
+
+struct CalibCollector : Ort::CustomOpBase<CalibCollector, CalibCollectorKernel> {
+  explicit CalibCollector() {}
+
+  void* CreateKernel(const OrtApi& api, const OrtKernelInfo* info) const {
+    Ort::InitApi(&api);
+
+    int64_t num_bins;
+    auto status = api.KernelInfoGetAttribute_int64(info, "num_bins", &num_bins);
+    if (status != nullptr) num_bins = 2048;
+
+    return new CalibCollectorKernel(api, info, num_bins);
+  };
+  const char* GetName() const { return "VitisCalibCollector"; };
+
+  // The statistics are gathered on the host whatever the provider of the
+  // model, ORT copies the input over.
+  const char* GetExecutionProviderType() const { return "CPUExecutionProvider"; };
+
+  size_t GetInputTypeCount() const { return 1; };
+  ONNXTensorElementDataType GetInputType(size_t /*index*/) const {
+    return ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+  };
+
+  size_t GetOutputTypeCount() const { return 3; };
+  ONNXTensorElementDataType GetOutputType(size_t index) const {
+    if (index == 1)
+      return ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64;
+    return ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+  };
+};
@@ -15,6 +15,7 @@
 
 #include "custom_op_qdq.h"
 #include "custom_op_bfp.h"
+#include "custom_op_calib.h"
 
 #define ORT_TRY try
 #define ORT_CATCH(x) catch (x)
@@ -116,6 +117,7 @@ OrtStatus* ORT_API_CALL RegisterCustomOps(OrtSessionOptions* options, const OrtA
   static const CustomQuantizeLinear c_CustomOpOne;
   static const CustomDequantizeLinear c_CustomOpTwo;
   static const BFPFixNeuron c_BFPFixNeuron;
+  static const CalibCollector c_CalibCollector;
 
   OrtStatus* result = nullptr;
 
@@ -124,6 +126,7 @@ OrtStatus* ORT_API_CALL RegisterCustomOps(OrtSessionOptions* options, const OrtA
     domain.Add(&c_CustomOpOne);
     domain.Add(&c_CustomOpTwo);
     domain.Add(&c_BFPFixNeuron);
+    domain.Add(&c_CalibCollector);
 
     Ort::UnownedSessionOptions session_options(options);
     session_options.Add(domain);
@@ -8,6 +8,8 @@
 
 #include <vector>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
 
 
 #include "core/framework/float16.h"
@@ -148,39 +150,19 @@ Ort::Op NativeCastOpCreate(Ort::KernelInfo& info,
                          &attr, 1, 1, 1);
 }
 
-void NativeCastOpInvokeToFloat16(OrtKernelContext* context, Ort::Op& op) {
+/*
+* Clip to the float16 range, to avoid overflow, and convert, in one pass
+* from the input to the output tensor.
+*/
+void ClipCastToFloat16(OrtKernelContext* context) {
   Ort::KernelContext ctx(context);
 
   auto input = ctx.GetInput(0);
-
-  // clip input to avoid overflow
-  float* clipped_input = (float*)malloc(input.GetTensorTypeAndShapeInfo().GetElementCount() * sizeof(float));
-  memcpy(clipped_input, input.GetTensorData<float>(), input.GetTensorTypeAndShapeInfo().GetElementCount() * sizeof(float));
-  for (size_t k = 0; k < input.GetTensorTypeAndShapeInfo().GetElementCount(); k ++) {
-      if (clipped_input[k] < -65504) clipped_input[k] = -65504;
-      if (clipped_input[k] > 65504) clipped_input[k] = 65504;
-  }
-
   std::vector<int64_t> dimensions = input.GetTensorTypeAndShapeInfo().GetShape();
-  auto input_value = Ort::Value::CreateTensor(input.GetTensorMemoryInfo(),
-                     //(void*)input.GetTensorData<float>(),
-                     (void*)clipped_input,
-                     input.GetTensorTypeAndShapeInfo().GetElementCount() * sizeof(float),
-                     dimensions.data(), dimensions.size(), ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
-
   auto output = ctx.GetOutput(0, dimensions);
-  auto output_value = Ort::Value::CreateTensor(input.GetTensorMemoryInfo(),
-                      (void*)output.GetTensorMutableData<onnxruntime::MLFloat16>(),
-                      input.GetTensorTypeAndShapeInfo().GetElementCount() * sizeof(onnxruntime::MLFloat16),
-                      dimensions.data(), dimensions.size(), ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16);
-
-  op.Invoke(context, &input_value, 1, &output_value, 1);
-
-  // free memory
-  if (clipped_input) {
-    free(clipped_input);
-    clipped_input = 0;
-  }
+  ClipCastToFloat16Bits(input.GetTensorData<float>(),
+                        reinterpret_cast<uint16_t*>(output.GetTensorMutableData<onnxruntime::MLFloat16>()),
+                        input.GetTensorTypeAndShapeInfo().GetElementCount(), -65504.0f, 65504.0f);
 }
 
 void NativeCastOpInvokeFromFloat16(OrtKernelContext* context, Ort::Op& op) {
@@ -275,7 +257,7 @@ void KernelCustomQuantizeLinear::ComputeBase(OrtKernelContext* context) {
     }
 #ifdef USE_NATIVE_OP_CAST
     case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16: {
-      NativeCastOpInvokeToFloat16(context, cast_to_float16_);
+      ClipCastToFloat16(context);
       break;
     }
 #else
@@ -411,11 +393,6 @@ KernelCustomQuantizeLinear::KernelCustomQuantizeLinear(const OrtApi& api,
 
   auto status = api_.KernelInfoGetAttribute_int64(info_, "axis", &axis_);
   if (status != nullptr) axis_ = 1;
-
-#ifdef USE_NATIVE_OP_CAST
-  cast_to_float16_ = NativeCastOpCreate(info_, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT,
-		                               ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16);
-#endif
 };
 
 KernelCustomQuantizeLinear::~KernelCustomQuantizeLinear() {
@@ -31,10 +31,6 @@ struct KernelCustomQuantizeLinear {
     Ort::KernelInfo info_{nullptr};
 
     int64_t axis_ = 1;
-
-#ifdef USE_NATIVE_OP_CAST
-    Ort::Op cast_to_float16_{nullptr};
-#endif
 };
 
 struct KernelCustomDequantizeLinear {
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "onnxruntime_c_api.h"
+#include "quantize_linear_kernels.h"
 
 namespace vai_q {
 
@@ -18,18 +19,14 @@ namespace vai_q {
   struct QuantizeLinearApply {                                                            \
     void op(int64_t N, int64_t broadcast_dim, int64_t block_size,                         \
      		    const InT* input, const InT* scale, T* output, const T* zero_point) { \
-      for (size_t n = 0; n < static_cast<size_t>(N); n++) {                               \
-        for (size_t bd = 0; bd < static_cast<size_t>(broadcast_dim); bd++) {              \
-          auto sc = static_cast<float>(scale[bd]);                                        \
-          int64_t zp = zero_point ? static_cast<int64_t>(zero_point[bd]) : 0;             \
-          for (size_t bs = 0; bs < static_cast<size_t>(block_size); bs++) {               \
-            int64_t temp = static_cast<int64_t>(std::nearbyint(static_cast<float>(*input++) / sc)) + zp; \
-            if (temp < std::numeric_limits<T>::lowest()) temp = std::numeric_limits<T>::lowest();        \
-            if (temp > std::numeric_limits<T>::max()) temp = std::numeric_limits<T>::max();              \
-            *output++ = static_cast<T>(temp);                                                            \
-          }                                                                               \
-        }                                                                                 \
-      }                                                                                   \
+      ForEachQdqRange(N, broadcast_dim, block_size,                                       \
+          [&](int64_t i, int64_t count, int64_t bd, bool per_element) {                   \
+        const T* zp = zero_point ? zero_point + bd : nullptr;                             \
+        if (per_element)                                                                  \
+          QuantizeLinearRange<T, true>(input + i, output + i, count, scale + bd, zp);     \
+        else                                                                              \
+          QuantizeLinearRange<T, false>(input + i, output + i, count, scale + bd, zp);    \
+      });                                                                                 \
     }                                                                                     \
   };                                                                                      \
 
@@ -58,16 +55,14 @@ namespace vai_q {
   struct QuantizeLinearApplyFp16 {                                                   \
     void op(int64_t N, int64_t broadcast_dim, int64_t block_size,                    \
          const InT* input, const InT* scale, T* output, const T* zero_point) {       \
-      for (size_t n = 0; n < static_cast<size_t>(N); n++) {                          \
-        for (size_t bd = 0; bd < static_cast<size_t>(broadcast_dim); bd++) {         \
-          auto sc = static_cast<float>(scale[bd]);                                   \
-          T zp = zero_point ? zero_point[bd] : T(0);                                 \
-          for (size_t bs = 0; bs < static_cast<size_t>(block_size); bs++)          { \
-            float temp = static_cast<float>(*input++) / sc + zp.ToFloat();           \
-            *output++ = T(temp);                                                     \
-          }                                                                          \
-        }                                                                            \
-      }                                                                              \
+      ForEachQdqRange(N, broadcast_dim, block_size,                                  \
+          [&](int64_t i, int64_t count, int64_t bd, bool per_element) {              \
+        const T* zp = zero_point ? zero_point + bd : nullptr;                        \
+        if (per_element)                                                             \
+          QuantizeLinearRangeFp16<T, true>(input + i, output + i, count, scale + bd, zp);  \
+        else                                                                         \
+          QuantizeLinearRangeFp16<T, false>(input + i, output + i, count, scale + bd, zp); \
+      });                                                                            \
     }                                                                                \
   };                                                                                 \
 
@@ -79,15 +74,14 @@ namespace vai_q {
   struct DequantizeLinearApply {                                                                         \
     void op(int64_t N, int64_t broadcast_dim, int64_t block_size,                                        \
   		    const T* input, const OutT* scale, OutT* output, const T* zero_point) {              \
-      for (size_t n = 0; n < static_cast<size_t>(N); n++) {                                              \
-        for (size_t bd = 0; bd < static_cast<size_t>(broadcast_dim); bd++) {                             \
-          auto sc = static_cast<float>(scale[bd]);                                                       \
-          int64_t zp = zero_point ? static_cast<int64_t>(zero_point[bd]) : 0;                            \
-          for (size_t bs = 0; bs < static_cast<size_t>(block_size); bs++) {                              \
-            *output++ = static_cast<OutT>(static_cast<float>(static_cast<int64_t>(*input++) - zp) * sc); \
-          }                                                                                              \
-        }                                                                                                \
-      }                                                                                                  \
+      ForEachQdqRange(N, broadcast_dim, block_size,                                                      \
+          [&](int64_t i, int64_t count, int64_t bd, bool per_element) {                                  \
+        const T* zp = zero_point ? zero_point + bd : nullptr;                                            \
+        if (per_element)                                                                                 \
+          DequantizeLinearRange<T, true>(input + i, output + i, count, scale + bd, zp);                  \
+        else                                                                                             \
+          DequantizeLinearRange<T, false>(input + i, output + i, count, scale + bd, zp);                 \
+      });                                                                                                \
     }                                                                                                    \
   };                                                                                                     \
 
@@ -116,15 +110,14 @@ namespace vai_q {
   struct DequantizeLinearApplyFp16 {                                                 \
     void op(int64_t N, int64_t broadcast_dim, int64_t block_size,                    \
          const T* input, const OutT* scale, OutT* output, const T* zero_point) {     \
-      for (size_t n = 0; n < static_cast<size_t>(N); n++) {                          \
-        for (size_t bd = 0; bd < static_cast<size_t>(broadcast_dim); bd++) {         \
-          auto sc = static_cast<float>(scale[bd]);                                   \
-          T zp = zero_point ? zero_point[bd] : T(0);                                 \
-          for (size_t bs = 0; bs < static_cast<size_t>(block_size); bs++, input++) { \
-            *output++ = static_cast<OutT>((input->ToFloat() - zp.ToFloat()) * sc);   \
-          }                                                                          \
-        }                                                                            \
-      }                                                                              \
+      ForEachQdqRange(N, broadcast_dim, block_size,                                  \
+          [&](int64_t i, int64_t count, int64_t bd, bool per_element) {              \
+        const T* zp = zero_point ? zero_point + bd : nullptr;                        \
+        if (per_element)                                                             \
+          DequantizeLinearRangeFp16<T, true>(input + i, output + i, count, scale + bd, zp);  \
+        else                                                                         \
+          DequantizeLinearRangeFp16<T, false>(input + i, output + i, count, scale + bd, zp); \
+      });                                                                            \
     }                                                                                \
   };                                                                                 \
 
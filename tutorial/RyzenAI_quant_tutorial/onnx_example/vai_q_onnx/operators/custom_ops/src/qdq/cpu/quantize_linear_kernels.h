@@ -0,0 +1,499 @@
+//
+// Copyright (C) 2023, Advanced Micro Devices, Inc. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "core/framework/float16.h"
+#include "bfp/cpu/parallel_for.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define VAI_Q_X86
+#ifdef __GNUC__
+#include <cpuid.h>
+#define QDQ_TARGET(isa) __attribute__((target(isa)))
+#else
+#include <intrin.h>
+#define QDQ_TARGET(isa)
+#endif
+#include <immintrin.h>
+#endif
+
+namespace vai_q {
+
+// The elements a parallel range should cover at least.
+static const int64_t kQdqGrain = 1 << 14;
+
+enum class QdqIsa { kScalar, kAvx2, kAvx512 };
+
+/*
+* Return the widest vector kernels the CPU supports, AVX2 counts with F16C.
+*/
+inline QdqIsa GetQdqIsa() {
+  static const QdqIsa isa = [] {
+#ifdef VAI_Q_X86
+    int info[4] = {0, 0, 0, 0};
+    int leaf7_ebx = 0;
+#ifdef __GNUC__
+    __cpuid_count(0, 0, info[0], info[1], info[2], info[3]);
+    int max_leaf = info[0];
+    __cpuid_count(1, 0, info[0], info[1], info[2], info[3]);
+    int leaf1_ecx = info[2];
+    if (max_leaf >= 7) {
+      __cpuid_count(7, 0, info[0], info[1], info[2], info[3]);
+      leaf7_ebx = info[1];
+    }
+#else
+    __cpuidex(info, 0, 0);
+    int max_leaf = info[0];
+    __cpuidex(info, 1, 0);
+    int leaf1_ecx = info[2];
+    if (max_leaf >= 7) {
+      __cpuidex(info, 7, 0);
+      leaf7_ebx = info[1];
+    }
+#endif
+    if (leaf7_ebx & (1 << 16))  // AVX-512F: EBX[16]
+      return QdqIsa::kAvx512;
+    if ((leaf7_ebx & (1 << 5)) && (leaf1_ecx & (1 << 29)))  // AVX2: EBX[5], F16C: ECX[29]
+      return QdqIsa::kAvx2;
+#endif
+    return QdqIsa::kScalar;
+  }();
+  return isa;
+}
+
+// The integer types with vector kernels, int32/uint32 don't fit a float.
+template <typename T>
+struct QdqHasSimd
+    : std::integral_constant<bool, std::is_same<T, int8_t>::value || std::is_same<T, uint8_t>::value ||
+                                   std::is_same<T, int16_t>::value || std::is_same<T, uint16_t>::value> {};
+
+/*
+* Scalar forms of Y = X / Scale + ZeroPoint and Y = (X - ZeroPoint) * Scale,
+* the vector kernels give the same results.
+*/
+template <typename T>
+inline T QuantizeValue(float x, float sc, int64_t zp) {
+  int64_t temp = static_cast<int64_t>(std::nearbyint(x / sc)) + zp;
+  if (temp < std::numeric_limits<T>::lowest()) temp = std::numeric_limits<T>::lowest();
+  if (temp > std::numeric_limits<T>::max()) temp = std::numeric_limits<T>::max();
+  return static_cast<T>(temp);
+}
+
+template <typename T>
+inline float DequantizeValue(T x, float sc, int64_t zp) {
+  return static_cast<float>(static_cast<int64_t>(x) - zp) * sc;
+}
+
+#ifdef VAI_Q_X86
+QDQ_TARGET("avx2") inline __m256i LoadWidenAVX2(const int8_t* p) {
+  return _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+}
+QDQ_TARGET("avx2") inline __m256i LoadWidenAVX2(const uint8_t* p) {
+  return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+}
+QDQ_TARGET("avx2") inline __m256i LoadWidenAVX2(const int16_t* p) {
+  return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+QDQ_TARGET("avx2") inline __m256i LoadWidenAVX2(const uint16_t* p) {
+  return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+// The lanes are already in the range of the type, the packs don't saturate.
+QDQ_TARGET("avx2") inline void StoreNarrowAVX2(int8_t* p, __m256i v) {
+  __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(v, v), v);
+  packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+}
+QDQ_TARGET("avx2") inline void StoreNarrowAVX2(uint8_t* p, __m256i v) {
+  __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(v, v), v);
+  packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+}
+QDQ_TARGET("avx2") inline void StoreNarrowAVX2(int16_t* p, __m256i v) {
+  __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(v, v), 0x08);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+}
+QDQ_TARGET("avx2") inline void StoreNarrowAVX2(uint16_t* p, __m256i v) {
+  __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+}
+
+QDQ_TARGET("avx512f") inline __m512i LoadWidenAVX512(const int8_t* p) {
+  return _mm512_cvtepi8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+QDQ_TARGET("avx512f") inline __m512i LoadWidenAVX512(const uint8_t* p) {
+  return _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+QDQ_TARGET("avx512f") inline __m512i LoadWidenAVX512(const int16_t* p) {
+  return _mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+}
+QDQ_TARGET("avx512f") inline __m512i LoadWidenAVX512(const uint16_t* p) {
+  return _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+}
+
+QDQ_TARGET("avx512f") inline void StoreNarrowAVX512(int8_t* p, __m512i v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm512_cvtepi32_epi8(v));
+}
+QDQ_TARGET("avx512f") inline void StoreNarrowAVX512(uint8_t* p, __m512i v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm512_cvtepi32_epi8(v));
+}
+QDQ_TARGET("avx512f") inline void StoreNarrowAVX512(int16_t* p, __m512i v) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_cvtepi32_epi16(v));
+}
+QDQ_TARGET("avx512f") inline void StoreNarrowAVX512(uint16_t* p, __m512i v) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_cvtepi32_epi16(v));
+}
+
+/*
+* Quantize count elements, with one scale and zero point, or one per element
+* when kPerElement. Returns the number done, the caller finishes the tail.
+* Rounding, then clamping in float before adding the zero point, is exact:
+* the bounds and zero points are small integers. The clamp bound goes second
+* so NaN becomes lowest, as with the cast in the scalar form.
+*/
+template <typename T, bool kPerElement>
+QDQ_TARGET("avx2")
+int64_t QuantizeLinearAVX2(const float* input, T* output, int64_t count,
+                           const float* scale, const T* zero_point) {
+  const __m256 lo = _mm256_set1_ps(static_cast<float>(std::numeric_limits<T>::lowest()));
+  const __m256 hi = _mm256_set1_ps(static_cast<float>(std::numeric_limits<T>::max()));
+  __m256 sc = _mm256_set1_ps(scale[0]);
+  __m256 zp = _mm256_set1_ps(zero_point ? static_cast<float>(zero_point[0]) : 0.0f);
+  int64_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    if (kPerElement) {
+      sc = _mm256_loadu_ps(scale + i);
+      if (zero_point) zp = _mm256_cvtepi32_ps(LoadWidenAVX2(zero_point + i));
+    }
+    __m256 q = _mm256_round_ps(_mm256_div_ps(_mm256_loadu_ps(input + i), sc),
+                               _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    q = _mm256_min_ps(_mm256_max_ps(q, _mm256_sub_ps(lo, zp)), _mm256_sub_ps(hi, zp));
+    StoreNarrowAVX2(output + i, _mm256_cvtps_epi32(_mm256_add_ps(q, zp)));
+  }
+  return i;
+}
+
+template <typename T, bool kPerElement>
+QDQ_TARGET("avx2")
+int64_t DequantizeLinearAVX2(const T* input, float* output, int64_t count,
+                             const float* scale, const T* zero_point) {
+  __m256 sc = _mm256_set1_ps(scale[0]);
+  __m256i zp = _mm256_set1_epi32(zero_point ? static_cast<int32_t>(zero_point[0]) : 0);
+  int64_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    if (kPerElement) {
+      sc = _mm256_loadu_ps(scale + i);
+      if (zero_point) zp = LoadWidenAVX2(zero_point + i);
+    }
+    __m256i x = _mm256_sub_epi32(LoadWidenAVX2(input + i), zp);
+    _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), sc));
+  }
+  return i;
+}
+
+template <typename T, bool kPerElement>
+QDQ_TARGET("avx512f")
+int64_t QuantizeLinearAVX512(const float* input, T* output, int64_t count,
+                             const float* scale, const T* zero_point) {
+  const __m512 lo = _mm512_set1_ps(static_cast<float>(std::numeric_limits<T>::lowest()));
+  const __m512 hi = _mm512_set1_ps(static_cast<float>(std::numeric_limits<T>::max()));
+  __m512 sc = _mm512_set1_ps(scale[0]);
+  __m512 zp = _mm512_set1_ps(zero_point ? static_cast<float>(zero_point[0]) : 0.0f);
+  int64_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    if (kPerElement) {
+      sc = _mm512_loadu_ps(scale + i);
+      if (zero_point) zp = _mm512_cvtepi32_ps(LoadWidenAVX512(zero_point + i));
+    }
+    __m512 q = _mm512_roundscale_ps(_mm512_div_ps(_mm512_loadu_ps(input + i), sc),
+                                    _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    q = _mm512_min_ps(_mm512_max_ps(q, _mm512_sub_ps(lo, zp)), _mm512_sub_ps(hi, zp));
+    StoreNarrowAVX512(output + i, _mm512_cvtps_epi32(_mm512_add_ps(q, zp)));
+  }
+  return i;
+}
+
+template <typename T, bool kPerElement>
+QDQ_TARGET("avx512f")
+int64_t DequantizeLinearAVX512(const T* input, float* output, int64_t count,
+                               const float* scale, const T* zero_point) {
+  __m512 sc = _mm512_set1_ps(scale[0]);
+  __m512i zp = _mm512_set1_epi32(zero_point ? static_cast<int32_t>(zero_point[0]) : 0);
+  int64_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    if (kPerElement) {
+      sc = _mm512_loadu_ps(scale + i);
+      if (zero_point) zp = LoadWidenAVX512(zero_point + i);
+    }
+    __m512i x = _mm512_sub_epi32(LoadWidenAVX512(input + i), zp);
+    _mm512_storeu_ps(output + i, _mm512_mul_ps(_mm512_cvtepi32_ps(x), sc));
+  }
+  return i;
+}
+
+// BFloat16 is the top half of a float, ORT converts by truncation.
+template <bool kPerElement>
+QDQ_TARGET("avx2")
+int64_t QuantizeLinearBf16AVX2(const float* input, onnxruntime::BFloat16* output, int64_t count,
+                               const float* scale, const onnxruntime::BFloat16* zero_point) {
+  __m256 sc = _mm256_set1_ps(scale[0]);
+  __m256 zp = _mm256_set1_ps(zero_point ? zero_point[0].ToFloat() : 0.0f);
+  int64_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    if (kPerElement) {
+      sc = _mm256_loadu_ps(scale + i);
+      if (zero_point)
+        zp = _mm256_castsi256_ps(_mm256_slli_epi32(
+            LoadWidenAVX2(reinterpret_cast<const uint16_t*>(zero_point + i)), 16));
+    }
+    __m256 y = _mm256_add_ps(_mm256_div_ps(_mm256_loadu_ps(input + i), sc), zp);
+    StoreNarrowAVX2(reinterpret_cast<uint16_t*>(output + i),
+                    _mm256_srli_epi32(_mm256_castps_si256(y), 16));
+  }
+  return i;
+}
+
+template <bool kPerElement>
+QDQ_TARGET("avx2")
+int64_t DequantizeLinearBf16AVX2(const onnxruntime::BFloat16* input, float* output, int64_t count,
+                                 const float* scale, const onnxruntime::BFloat16* zero_point) {
+  __m256 sc = _mm256_set1_ps(scale[0]);
+  __m256 zp = _mm256_set1_ps(zero_point ? zero_point[0].ToFloat() : 0.0f);
+  int64_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    if (kPerElement) {
+      sc = _mm256_loadu_ps(scale + i);
+      if (zero_point)
+        zp = _mm256_castsi256_ps(_mm256_slli_epi32(
+            LoadWidenAVX2(reinterpret_cast<const uint16_t*>(zero_point + i)), 16));
+    }
+    __m256 x = _mm256_castsi256_ps(_mm256_slli_epi32(
+        LoadWidenAVX2(reinterpret_cast<const uint16_t*>(input + i)), 16));
+    _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_sub_ps(x, zp), sc));
+  }
+  return i;
+}
+#endif
+
+template <typename T, bool kPerElement>
+int64_t QuantizeLinearSimd(const float* input, T* output, int64_t count,
+                           const float* scale, const T* zero_point, std::true_type) {
+#ifdef VAI_Q_X86
+  switch (GetQdqIsa()) {
+    case QdqIsa::kAvx512:
+      return QuantizeLinearAVX512<T, kPerElement>(input, output, count, scale, zero_point);
+    case QdqIsa::kAvx2:
+      return QuantizeLinearAVX2<T, kPerElement>(input, output, count, scale, zero_point);
+    default:
+      break;
+  }
+#endif
+  return 0;
+}
+
+template <typename T, bool kPerElement>
+int64_t QuantizeLinearSimd(const float*, T*, int64_t, const float*, const T*, std::false_type) {
+  return 0;
+}
+
+template <typename T, bool kPerElement>
+int64_t DequantizeLinearSimd(const T* input, float* output, int64_t count,
+                             const float* scale, const T* zero_point, std::true_type) {
+#ifdef VAI_Q_X86
+  switch (GetQdqIsa()) {
+    case QdqIsa::kAvx512:
+      return DequantizeLinearAVX512<T, kPerElement>(input, output, count, scale, zero_point);
+    case QdqIsa::kAvx2:
+      return DequantizeLinearAVX2<T, kPerElement>(input, output, count, scale, zero_point);
+    default:
+      break;
+  }
+#endif
+  return 0;
+}
+
+template <typename T, bool kPerElement>
+int64_t DequantizeLinearSimd(const T*, float*, int64_t, const float*, const T*, std::false_type) {
+  return 0;
+}
+
+/*
+* Quantize or dequantize count contiguous elements, with the scale and zero
+* point of the block, or of each element when kPerElement.
+*/
+template <typename T, bool kPerElement>
+void QuantizeLinearRange(const float* input, T* output, int64_t count,
+                         const float* scale, const T* zero_point) {
+  int64_t i = QuantizeLinearSimd<T, kPerElement>(input, output, count, scale, zero_point,
+                                                 QdqHasSimd<T>());
+  for (; i < count; i++) {
+    int64_t k = kPerElement ? i : 0;
+    int64_t zp = zero_point ? static_cast<int64_t>(zero_point[k]) : 0;
+    output[i] = QuantizeValue<T>(input[i], scale[k], zp);
+  }
+}
+
+template <typename T, bool kPerElement>
+void DequantizeLinearRange(const T* input, float* output, int64_t count,
+                           const float* scale, const T* zero_point) {
+  int64_t i = DequantizeLinearSimd<T, kPerElement>(input, output, count, scale, zero_point,
+                                                   QdqHasSimd<T>());
+  for (; i < count; i++) {
+    int64_t k = kPerElement ? i : 0;
+    int64_t zp = zero_point ? static_cast<int64_t>(zero_point[k]) : 0;
+    output[i] = DequantizeValue<T>(input[i], scale[k], zp);
+  }
+}
+
+template <typename T, bool kPerElement>
+void QuantizeLinearRangeFp16(const float* input, T* output, int64_t count,
+                             const float* scale, const T* zero_point) {
+  int64_t i = 0;
+#ifdef VAI_Q_X86
+  if (std::is_same<T, onnxruntime::BFloat16>::value && GetQdqIsa() != QdqIsa::kScalar)
+    i = QuantizeLinearBf16AVX2<kPerElement>(
+        input, reinterpret_cast<onnxruntime::BFloat16*>(output), count, scale,
+        reinterpret_cast<const onnxruntime::BFloat16*>(zero_point));
+#endif
+  for (; i < count; i++) {
+    int64_t k = kPerElement ? i : 0;
+    T zp = zero_point ? zero_point[k] : T(0);
+    output[i] = T(input[i] / scale[k] + zp.ToFloat());
+  }
+}
+
+template <typename T, bool kPerElement>
+void DequantizeLinearRangeFp16(const T* input, float* output, int64_t count,
+                               const float* scale, const T* zero_point) {
+  int64_t i = 0;
+#ifdef VAI_Q_X86
+  if (std::is_same<T, onnxruntime::BFloat16>::value && GetQdqIsa() != QdqIsa::kScalar)
+    i = DequantizeLinearBf16AVX2<kPerElement>(
+        reinterpret_cast<const onnxruntime::BFloat16*>(input), output, count, scale,
+        reinterpret_cast<const onnxruntime::BFloat16*>(zero_point));
+#endif
+  for (; i < count; i++) {
+    int64_t k = kPerElement ? i : 0;
+    T zp = zero_point ? zero_point[k] : T(0);
+    output[i] = (input[i].ToFloat() - zp.ToFloat()) * scale[k];
+  }
+}
+
+/*
+* Convert a float to the bits of a float16, rounding to nearest even, as
+* the Cast op does. NaNs stay NaNs, out of range values become +-Inf.
+*/
+inline uint16_t FloatToFloat16Bits(float value) {
+  uint32_t x;
+  memcpy(&x, &value, sizeof(x));
+  uint16_t sign = static_cast<uint16_t>((x >> 16) & 0x8000);
+  x &= 0x7fffffff;
+  if (x > 0x7f800000)   // NaN, quiet it and keep the top payload bits
+    return sign | 0x7e00 | static_cast<uint16_t>((x >> 13) & 0x3ff);
+  if (x >= 0x477ff000)  // rounds past 65504
+    return sign | 0x7c00;
+  if (x < 0x38800000) { // float16 subnormals, let the float adder round
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    f += 0.5f;
+    memcpy(&x, &f, sizeof(x));
+    return sign | static_cast<uint16_t>(x - 0x3f000000);
+  }
+  x += 0xc8000fff + ((x >> 13) & 1);  // rebias the exponent and round
+  return sign | static_cast<uint16_t>(x >> 13);
+}
+
+#ifdef VAI_Q_X86
+QDQ_TARGET("avx,f16c")
+inline void ClipCastToFloat16F16C(const float* input, uint16_t* output, size_t n,
+                                  float lo, float hi) {
+  const __m256 vlo = _mm256_set1_ps(lo);
+  const __m256 vhi = _mm256_set1_ps(hi);
+  size_t k = 0;
+  for (; k + 8 <= n; k += 8) {
+    // min/max with the bound first let NaNs through, as the scalar clip does
+    __m256 x = _mm256_max_ps(vlo, _mm256_min_ps(vhi, _mm256_loadu_ps(input + k)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + k),
+                     _mm256_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT));
+  }
+  for (; k < n; k++)
+    output[k] = FloatToFloat16Bits(std::max(std::min(input[k], hi), lo));
+}
+
+QDQ_TARGET("avx512f")
+inline void ClipCastToFloat16AVX512(const float* input, uint16_t* output, size_t n,
+                                    float lo, float hi) {
+  const __m512 vlo = _mm512_set1_ps(lo);
+  const __m512 vhi = _mm512_set1_ps(hi);
+  size_t k = 0;
+  for (; k + 16 <= n; k += 16) {
+    __m512 x = _mm512_max_ps(vlo, _mm512_min_ps(vhi, _mm512_loadu_ps(input + k)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + k),
+                        _mm512_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT));
+  }
+  for (; k < n; k++)
+    output[k] = FloatToFloat16Bits(std::max(std::min(input[k], hi), lo));
+}
+#endif
+
+inline void ClipCastToFloat16Scalar(const float* input, uint16_t* output, size_t n,
+                                    float lo, float hi) {
+  for (size_t k = 0; k < n; k++)
+    output[k] = FloatToFloat16Bits(std::max(std::min(input[k], hi), lo));
+}
+
+/*
+* Clip to [lo, hi] and convert to the bits of float16s, with the widest
+* instruction set the CPU has.
+*/
+inline void ClipCastToFloat16Bits(const float* input, uint16_t* output, size_t n,
+                                  float lo, float hi) {
+  using ClipCastFn = void (*)(const float*, uint16_t*, size_t, float, float);
+  static const ClipCastFn clip_cast = [] {
+#ifdef VAI_Q_X86
+    if (GetQdqIsa() == QdqIsa::kAvx512)
+      return static_cast<ClipCastFn>(ClipCastToFloat16AVX512);
+    if (GetQdqIsa() == QdqIsa::kAvx2)
+      return static_cast<ClipCastFn>(ClipCastToFloat16F16C);
+#endif
+    return static_cast<ClipCastFn>(ClipCastToFloat16Scalar);
+  }();
+  clip_cast(input, output, n, lo, hi);
+}
+
+/*
+* Split N x broadcast_dim x block_size elements between the threads and run
+* range_fn(offset, count, channel, per_element) on the contiguous runs of
+* one channel. When the axis is the last one, block_size is 1 and range_fn
+* gets whole rows of broadcast_dim channels instead, per_element set.
+*/
+template <typename RangeFn>
+void ForEachQdqRange(int64_t N, int64_t broadcast_dim, int64_t block_size, RangeFn range_fn) {
+  if (block_size == 1 && broadcast_dim > 1) {
+    ParallelFor(N, kQdqGrain / broadcast_dim, [&](int64_t begin, int64_t end) {
+      for (int64_t n = begin; n < end; n++)
+        range_fn(n * broadcast_dim, broadcast_dim, int64_t(0), true);
+    });
+    return;
+  }
+  ParallelFor(N * broadcast_dim * block_size, kQdqGrain, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end;) {
+      int64_t row = i / block_size;
+      int64_t row_end = std::min(end, (row + 1) * block_size);
+      range_fn(i, row_end - i, row % broadcast_dim, false);
+      i = row_end;
+    }
+  });
+}
+
+}  // namespace vai_q
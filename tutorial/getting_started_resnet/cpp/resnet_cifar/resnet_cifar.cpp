@@ -11,13 +11,18 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
  ************************************************************************************/
 #include <assert.h>
 #include <onnxruntime_cxx_api.h>
+#include <vai_ep_runtime/input_buffer.hpp>
 
 #include <algorithm> // std::generate
+#include <chrono>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <numeric>
 #include <sstream>
+#include <thread>
 #include <vector>
 #if _WIN32
 extern "C" {
@@ -38,9 +43,11 @@ std::wstring_convert<convert_t, wchar_t> strconverter;
 using namespace std;
 
 static cv::Mat read_image(const std::string files);
+static cv::Mat decode_cifar_image(const unsigned char* data);
 static cv::Mat croppedImage(const cv::Mat& image, int height, int width);
 static cv::Mat preprocess_image(const cv::Mat& image, cv::Size size);
-static void set_input_image(const cv::Mat& image, float* data);
+template <typename T, typename Convert>
+static void set_input_image(const cv::Mat& image, T* data, Convert convert);
 static std::vector<float> softmax(float* data, int64_t size);
 static std::vector<std::pair<int, float>> topk(const std::vector<float>& score,
     int K);
@@ -53,6 +60,7 @@ const int CIFAR_IMAGE_HEIGHT = 32;
 const int CIFAR_IMAGE_AREA = CIFAR_IMAGE_WIDTH * CIFAR_IMAGE_HEIGHT;
 const int CIFAR_LABEL_SIZE = 1;
 const int CIFAR_IMAGE_SIZE = CIFAR_IMAGE_DEPTH * CIFAR_IMAGE_AREA; // 3072 = 3 * 32 * 32
+const int CIFAR_RECORD_SIZE = CIFAR_LABEL_SIZE + CIFAR_IMAGE_SIZE;
 
 vector<pair<cv::Mat, int>> ReadFirstTenCIFAR10Images(const std::string& filename)
 {
@@ -73,16 +81,7 @@ vector<pair<cv::Mat, int>> ReadFirstTenCIFAR10Images(const std::string& filename
                 std::cerr << "Error reading image data." << std::endl;
                 break;
             }
-            cv::Mat channels[3];
-            for (int i = 0; i < 3; ++i) {
-                channels[i] = cv::Mat(CIFAR_IMAGE_HEIGHT, CIFAR_IMAGE_WIDTH, CV_8UC1, &data[i * CIFAR_IMAGE_AREA]);
-            }
-
-            // Merge the separate channels into a single BGR image
-            cv::Mat img;
-            cv::merge(channels, 3, img);
-            cv::cvtColor(img, img, cv::COLOR_RGB2BGR);
-
+            cv::Mat img = decode_cifar_image(data);
             labeled_images.emplace_back(img, static_cast<int>(label));
             count += 1;
         }
@@ -94,32 +93,24 @@ vector<pair<cv::Mat, int>> ReadFirstTenCIFAR10Images(const std::string& filename
     }
     return labeled_images;
 }
-// preprocess
-static void preprocess_resnet(const string file,
-    std::vector<float>& input_tensor_values,
-    std::vector<int64_t>& input_shape) {
-    auto channel = input_shape[1];
-    auto height = input_shape[2];
-    auto width = input_shape[3];
-    auto size = cv::Size((int)width, (int)height);
-    auto image = read_image(file);
-    set_input_image(image, input_tensor_values.data());
-
-}
-
-// postprocess
-static string postprocess_resnet(const string file,
-    Ort::Value& output_tensor) {
-    auto output_shape = output_tensor.GetTensorTypeAndShapeInfo().GetShape();
-    auto channel = output_shape[1];
-    auto output_tensor_ptr = output_tensor.GetTensorMutableData<float>();
-    auto softmax_output = softmax(output_tensor_ptr, channel);
-    auto tb_top5 = topk(softmax_output, 5);
-    //print_topk(tb_top5);
-    auto top1 = tb_top5[0];
-    auto cls = std::string("") + lookup(top1.first) + " prob. " +
-        std::to_string(top1.second);
-    return lookup(top1.first);
+// label byte followed by the image of each record, decoded by the evaluation
+// workers
+static vector<unsigned char> ReadCIFAR10Records(const std::string& filename, int max_images)
+{
+    vector<unsigned char> records;
+    ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open the file: " << filename << std::endl;
+        return records;
+    }
+    auto num_images = (int)(file.tellg() / CIFAR_RECORD_SIZE);
+    if (max_images > 0) {
+        num_images = std::min(num_images, max_images);
+    }
+    records.resize((size_t)num_images * CIFAR_RECORD_SIZE);
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(records.data()), records.size());
+    return records;
 }
 
 #define CHECK_STATUS_OK(expr)                                                  \
@@ -129,25 +120,12 @@ static string postprocess_resnet(const string file,
   } while (0)
 
 
-// pretty prints a shape dimension vector
-static std::string print_shape(const std::vector<int64_t>& v) {
-    std::stringstream ss("");
-    for (size_t i = 0; i < v.size() - 1; i++)
-        ss << v[i] << "x";
-    ss << v[v.size() - 1];
-    return ss.str();
-}
-
-static int calculate_product(const std::vector<int64_t>& v) {
-    int total = 1;
-    for (auto& i : v)
-        total *= (int)i;
-    return total;
-}
-
 static void usage() {
-    std::cout << "usage: resnet_cifar <onnx model> <json_config> "
-        " <img_url> [img_url]... \n"
+    std::cout << "usage: resnet_cifar [-n num_images] [-b batch] [-j num_workers] "
+        "<onnx model> <ep> <json_config>\n"
+        "  -n  images of the test batch to evaluate, 0 for all of them (default 10)\n"
+        "  -b  batch size of a model with a dynamic batch (default 1)\n"
+        "  -j  threads decoding & preprocessing the images (default all cores)\n"
         << std::endl;
 }
 
@@ -161,12 +139,151 @@ bool isValidEP(const std::string& option) {
     return false;
 }
 
+// one batch of the evaluation, its runner binds the tensors once to the
+// buffers. The input is int8/uint8 for a model taking it quantized.
+struct EvalSlot {
+    vai_ep::InputBuffer input;
+    std::unique_ptr<vai_ep::Runner> runner;
+    std::vector<int> labels;
+    std::future<void> ready;
+};
+
+// decode & preprocess the images [first, first + count) of the records into
+// the input of the slot, spread over num_workers threads
+static void fill_slot(EvalSlot& slot, const vector<unsigned char>& records,
+    int first, int count, int num_workers) {
+    slot.labels.resize(count);
+    slot.input.visit([&](auto* data, auto convert) {
+        // padding of a partial last batch
+        std::fill(data + (size_t)count * CIFAR_IMAGE_SIZE, data + slot.input.size(), convert(0.0f));
+        auto work = [&](int worker) {
+            for (int i = worker; i < count; i += num_workers) {
+                const unsigned char* record = records.data() + (size_t)(first + i) * CIFAR_RECORD_SIZE;
+                slot.labels[i] = record[0];
+                set_input_image(decode_cifar_image(record + CIFAR_LABEL_SIZE),
+                    data + (size_t)i * CIFAR_IMAGE_SIZE, convert);
+            }
+        };
+        std::vector<std::future<void>> others;
+        for (int worker = 1; worker < std::min(num_workers, count); ++worker) {
+            others.push_back(std::async(std::launch::async, work, worker));
+        }
+        work(0);
+        for (auto& other : others) {
+            other.get();
+        }
+    });
+}
+
+// Top-1 accuracy over the records. The workers preprocess the next batch
+// while the session runs the current one.
+static void evaluate_cifar(vai_ep::Session& session,
+    const vector<unsigned char>& records, int64_t batch_number, int num_workers) {
+    auto input_shape = session.input_shapes()[0];
+    if (session.dynamic_batch()) {
+        input_shape[0] = batch_number;
+    }
+    if (vai_ep::shape_size(input_shape) != input_shape[0] * CIFAR_IMAGE_SIZE) {
+        std::cerr << "Error: model input " << vai_ep::print_shape(input_shape)
+            << " is not a batch of CIFAR-10 images" << std::endl;
+        exit(-1);
+    }
+    const int batch = (int)input_shape[0];
+    const int num_classes = (int)session.output_shapes()[0][1];
+    const int num_images = (int)(records.size() / CIFAR_RECORD_SIZE);
+    const int num_batches = (num_images + batch - 1) / batch;
+
+    EvalSlot slots[2];
+    for (auto& slot : slots) {
+        slot.input = vai_ep::InputBuffer(session, 0, (size_t)batch * CIFAR_IMAGE_SIZE);
+        slot.runner = std::make_unique<vai_ep::Runner>(session);
+        slot.input.bind(*slot.runner, 0, input_shape);
+        slot.runner->bind_outputs(batch);
+    }
+    auto prepare = [&](int b) {
+        auto first = b * batch;
+        auto count = std::min(batch, num_images - first);
+        slots[b % 2].ready = std::async(std::launch::async, fill_slot,
+            std::ref(slots[b % 2]), std::cref(records), first, count, num_workers);
+    };
+
+    vector<pair<string, string>> results;
+    int num_correct = 0;
+    auto start = std::chrono::steady_clock::now();
+    if (num_batches > 0) {
+        prepare(0);
+    }
+    for (int b = 0; b < num_batches; b++)
+    {
+        auto& slot = slots[b % 2];
+        slot.ready.get();
+        if (b + 1 < num_batches) {
+            prepare(b + 1);
+        }
+        try {
+            slot.runner->run();
+        }
+        catch (const Ort::Exception& exception) {
+            cout << "ERROR running model inference: " << exception.what() << endl;
+            exit(-1);
+        }
+        const float* output = slot.runner->output(0);
+        for (int i = 0; i < (int)slot.labels.size(); i++)
+        {
+            const float* scores = output + (size_t)i * num_classes;
+            auto predicted = (int)(std::max_element(scores, scores + num_classes) - scores);
+            num_correct += predicted == slot.labels[i];
+            if (b * batch + i < 10) {
+                results.push_back(std::make_pair(lookup(predicted), lookup(slot.labels[i])));
+            }
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    cout << "Final results:" << endl;
+    for (size_t n = 0; n < results.size(); n++)
+    {
+        cout << "Predicted label is " << results[n].first << " and actual label is " << results[n].second << endl;
+    }
+    if (num_images > 0) {
+        cout << "Accuracy: " << num_correct << "/" << num_images << " = "
+            << std::fixed << std::setprecision(2) << 100.0 * num_correct / num_images << "%" << endl;
+        cout << "Throughput: " << num_images / elapsed.count() << " images/sec (batch "
+            << batch << ", " << num_workers << " workers)" << endl;
+    }
+}
+
 int main(int argc, char* argv[]) {
 
     const char* env_val = getenv("CONDA_PREFIX");
     const char* env_name = "PYTHONHOME";
     _putenv_s(env_name, env_val);
 
+    int opt = 0;
+    int max_images = 10;
+    int64_t batch_number = 1;
+    int num_workers = std::max(1, (int)std::thread::hardware_concurrency());
+    while ((opt = getopt(argc, argv, "n:b:j:")) != -1) {
+        switch (opt) {
+        case 'n':
+            max_images = std::atoi(optarg);
+            break;
+        case 'b':
+            batch_number = std::max(1, std::atoi(optarg));
+            break;
+        case 'j':
+            num_workers = std::max(1, std::atoi(optarg));
+            break;
+        default:
+            usage();
+            return 0;
+        }
+    }
+    if (argc - optind < 3) {
+        usage();
+        return 0;
+    }
+
     const string data_dir = "./data/cifar-10-batches-bin/test_batch.bin";
     const string output_folder = "images/";
     std::filesystem::create_directory(output_folder);
@@ -175,11 +292,8 @@ int main(int argc, char* argv[]) {
         string output_path = output_folder + "cifar_image_" + std::to_string(i) + ".png";
         cv::imwrite(output_path, labeled_images[i].first);
     }
-    vector<pair<string, string>> results;
-    int opt = 0;
-    int64_t batch_number = 1;
-    auto model_name = strconverter.from_bytes(std::string(argv[optind]));
-    cout << "model name:" << std::string(argv[optind]) << endl;
+    auto model_name = std::string(argv[optind]);
+    cout << "model name:" << model_name << endl;
     auto json_config = std::string(argv[optind + 2]);
     auto ep = std::string(argv[optind + 1]);
     if (!isValidEP(ep)) {
@@ -187,118 +301,31 @@ int main(int argc, char* argv[]) {
         return 0;
     }
     cout << "ep:" << ep << endl;
-    Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "resnet_cifar");
-    auto session_options = Ort::SessionOptions();
-
-    auto config_key = std::string{ "config_file" };
-    auto cache_dir = std::filesystem::current_path().string();
 
-    if (ep == "npu")
-    {
-        auto options =
-            std::unordered_map<std::string, std::string>{ {config_key, json_config}, {"cacheDir", cache_dir}, {"cacheKey", "modelcachekey"} };
-        try {
-            session_options.AppendExecutionProvider_VitisAI(options);
-        }
-        catch (const std::exception& e) {
-            std::cerr << "Exception occurred in appending execution provider: " << e.what() << std::endl;
-        }
+    vai_ep::SessionConfig config;
+    config.model = model_name;
+    config.ep = ep;
+    config.config_file = json_config;
+    // the compiled model is cached under a key of the model & config
+    config.cache_dir = std::filesystem::current_path().string();
+    std::unique_ptr<vai_ep::Session> session;
+    try {
+        session = std::make_unique<vai_ep::Session>(config);
     }
-
-    auto session = Ort::Session(env, model_name.data(), session_options);
-    // print name/shape of inputs and outputs
-    Ort::AllocatorWithDefaultOptions allocator;
-    auto input_count = session.GetInputCount();
-    auto input_names = std::vector<const char*>();
-    auto input_names_ptr = std::vector<Ort::AllocatedStringPtr>();
-    auto input_shapes = std::vector<std::vector<int64_t>>();
-    input_shapes.reserve(input_count);
-    input_names_ptr.reserve(input_count);
-    input_names.reserve(input_count);
-    std::cout << "Input Node Name/Shape (" << input_count << "):" << std::endl;
-    for (size_t i = 0; i < input_count; i++)
-    {
-        input_shapes.push_back(session.GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape());
-        auto name = session.GetInputNameAllocated(i, allocator);
-        input_names.push_back(name.get());
-        input_names_ptr.push_back(std::move(name));
-        std::cout << "\t" << input_names[i] << " : " << print_shape(input_shapes[i]) << std::endl;
+    catch (const std::exception& e) {
+        std::cerr << "Exception occurred in creating the session: " << e.what() << std::endl;
+        return -1;
     }
-
-    auto output_count = session.GetOutputCount();
-    auto output_shapes = std::vector<std::vector<int64_t>>();
-    auto output_names_ptr = std::vector<Ort::AllocatedStringPtr>();
-    auto output_names = std::vector<const char*>();
-    output_shapes.reserve(output_count);
-    output_names_ptr.reserve(output_count);
-    output_names.reserve(output_count);
-
-    for (size_t i = 0; i < output_count; i++)
-    {
-        auto shape = session.GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
-        output_shapes.push_back(shape);
-        auto name = session.GetOutputNameAllocated(i, allocator);
-        output_names.push_back(name.get());
-        output_names_ptr.push_back(std::move(name));
-        std::cout << "\t" << output_names[i] << " : " << print_shape(output_shapes[i]) << std::endl;
+    // print name/shape of inputs and outputs
+    std::cout << session->to_string();
+    if (session->input_quant(0)) {
+        std::cout << "Input fed quantized, scale " << session->input_quant(0)->scale
+            << " zero point " << session->input_quant(0)->zero_point << std::endl;
     }
     // Assume model has 1 input node and 1 output node.
     //assert(input_names.size() == 1 && output_names.size() == 1);
-    for (int i = 0; i < 10; i++)
-    {
-        const std::string curr_file = "./images/cifar_image_" + std::to_string(i) + ".png";
-        //cout << "curr file: " << curr_file << endl; 
-        auto input_shape = input_shapes[0];
-        if (input_shape[0] == -1) {
-            input_shape[0] = batch_number;
-        }
-        int total_number_elements = calculate_product(input_shape);
-        std::vector<float> input_tensor_values(total_number_elements);
-        preprocess_resnet(curr_file, input_tensor_values, input_shape);
-
-        std::vector<Ort::Value> input_tensors;
-        Ort::MemoryInfo info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-        input_tensors.push_back(Ort::Value::CreateTensor<float>(
-            info, input_tensor_values.data(), input_tensor_values.size(),
-            input_shape.data(), input_shape.size()));
-
-        // double-check the dimensions of the input tensor
-        assert(input_tensors[0].IsTensor() &&
-            input_tensors[0].GetTensorTypeAndShapeInfo().GetShape() ==
-            input_shape);
-        /*cout << "\ninput_tensor shape: "
-            << print_shape(input_tensors[0].GetTensorTypeAndShapeInfo().GetShape())
-            << endl;*/
-
-
-            // pass data through model
-        //cout << "Running model...";
-        try {
-            auto output_tensors = session.Run(Ort::RunOptions(), input_names.data(), input_tensors.data(), input_count, output_names.data(), output_count);
-            //cout << "done" << endl;
-
-            // double-check the dimensions of the output tensors
-            // NOTE: the number of output tensors is equal to the number of output nodes
-            // specifed in the Run() call
-            assert(output_tensors.size() == session.GetOutputNames().size() &&
-                output_tensors[0].IsTensor());
-            auto output_shape =
-                output_tensors[0].GetTensorTypeAndShapeInfo().GetShape();
-            //cout << "output_tensor_shape: " << print_shape(output_shape) << endl;
-            string predicted = postprocess_resnet(curr_file, output_tensors[0]);
-            int lab = labeled_images[i].second;
-            results.push_back(std::make_pair(predicted, lookup(lab)));
-        }
-        catch (const Ort::Exception& exception) {
-            cout << "ERROR running model inference: " << exception.what() << endl;
-            exit(-1);
-        }
-    }
-    cout << "Final results:" << endl;
-    for (auto n = 0; n < results.size(); n++)
-    {
-        cout << "Predicted label is " << results[n].first << " and actual label is " << results[n].second << endl;
-    }
+    auto records = ReadCIFAR10Records(data_dir, max_images);
+    evaluate_cifar(*session, records, batch_number, num_workers);
 
     const char* temp = "";
     _putenv_s(env_name, temp);
@@ -312,6 +339,21 @@ static cv::Mat read_image(const string file) {
     return image;
 }
 
+// CIFAR-10 stores the planes R, G & B of an image one after the other
+static cv::Mat decode_cifar_image(const unsigned char* data) {
+    cv::Mat channels[3];
+    for (int i = 0; i < 3; ++i) {
+        channels[i] = cv::Mat(CIFAR_IMAGE_HEIGHT, CIFAR_IMAGE_WIDTH, CV_8UC1,
+            const_cast<unsigned char*>(&data[i * CIFAR_IMAGE_AREA]));
+    }
+
+    // Merge the separate channels into a single BGR image
+    cv::Mat img;
+    cv::merge(channels, 3, img);
+    cv::cvtColor(img, img, cv::COLOR_RGB2BGR);
+    return img;
+}
+
 static cv::Mat croppedImage(const cv::Mat& image, int height, int width) {
     cv::Mat cropped_img;
     int offset_h = (image.rows - height) / 2;
@@ -331,8 +373,10 @@ static cv::Mat preprocess_image(const cv::Mat& image, cv::Size size) {
     return croppedImage(resized_image, size.height, size.width);
 }
 
-//(image_data - mean) * scale, BRG2RGB and hwc2chw
-static void set_input_image(const cv::Mat& image, float* data) {
+//(image_data - mean) * scale, BRG2RGB and hwc2chw, converted to the input
+// type by convert
+template <typename T, typename Convert>
+static void set_input_image(const cv::Mat& image, T* data, Convert convert) {
     float mean[3] = { 0.0f, 0.0f, 0.0f };
     float scales[3] = { 1.0f, 1.0f, 1.0f };
     for (int c = 0; c < 3; c++) {
@@ -342,7 +386,7 @@ static void set_input_image(const cv::Mat& image, float* data) {
                 auto image_data =
                     ((image.at<cv::Vec3b>(h, w)[c_t] - mean[c_t]) * scales[c_t]) / 255;
                 data[c * image.rows * image.cols + h * image.cols + w] =
-                    (float)image_data;
+                    convert((float)image_data);
             }
         }
     }
@@ -0,0 +1,255 @@
+/*
+ * Copyright 2022-2023 Advanced Micro Devices Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#if _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace vitis {
+namespace ai {
+// A physical core, its logical processors (SMT siblings) and the id of the
+// L3 cache it shares, which is the CCX on Zen
+struct CpuCore {
+  int ccx;
+  std::vector<int> cpus;
+};
+
+#if _WIN32
+inline std::vector<CpuCore> detect_cpu_cores() {
+  std::vector<CpuCore> cores;
+  DWORD length = 0;
+  GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+  std::vector<char> buffer(length);
+  auto info =
+      reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data());
+  if (length == 0 ||
+      !GetLogicalProcessorInformationEx(RelationAll, info, &length)) {
+    return cores;
+  }
+  // only group 0, which is what SetThreadAffinityMask can pin to
+  std::vector<KAFFINITY> l3_masks;
+  for (DWORD offset = 0; offset < length;) {
+    auto item = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(
+        buffer.data() + offset);
+    if (item->Relationship == RelationProcessorCore &&
+        item->Processor.GroupMask[0].Group == 0) {
+      CpuCore core{-1, {}};
+      for (int bit = 0; bit < (int)sizeof(KAFFINITY) * 8; ++bit) {
+        if (item->Processor.GroupMask[0].Mask & ((KAFFINITY)1 << bit)) {
+          core.cpus.push_back(bit);
+        }
+      }
+      cores.push_back(core);
+    } else if (item->Relationship == RelationCache &&
+               item->Cache.Level == 3 && item->Cache.GroupMask.Group == 0) {
+      l3_masks.push_back(item->Cache.GroupMask.Mask);
+    }
+    offset += item->Size;
+  }
+  for (auto& core : cores) {
+    for (size_t i = 0; i < l3_masks.size(); ++i) {
+      if (l3_masks[i] & ((KAFFINITY)1 << core.cpus[0])) {
+        core.ccx = (int)i;
+      }
+    }
+  }
+  return cores;
+}
+
+inline bool pin_current_thread(const std::vector<int>& cpus) {
+  DWORD_PTR mask = 0;
+  for (auto cpu : cpus) {
+    mask |= (DWORD_PTR)1 << cpu;
+  }
+  return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+}
+#else
+// parses a sysfs cpu list, e.g. 0-3,8-11
+inline std::vector<int> parse_cpu_list(const std::string& list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    auto dash = range.find('-');
+    auto first = std::stoi(range.substr(0, dash));
+    auto last = dash == std::string::npos ? first
+                                          : std::stoi(range.substr(dash + 1));
+    for (auto cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+inline std::vector<CpuCore> detect_cpu_cores() {
+  std::vector<CpuCore> cores;
+  std::map<std::string, int> l3_ids;
+  std::vector<bool> seen;
+  for (int cpu = 0;; ++cpu) {
+    auto dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    std::ifstream siblings(dir + "/topology/thread_siblings_list");
+    std::string siblings_list;
+    if (!std::getline(siblings, siblings_list)) {
+      break;
+    }
+    if ((int)seen.size() > cpu && seen[cpu]) {
+      continue;
+    }
+    CpuCore core{-1, parse_cpu_list(siblings_list)};
+    for (auto sibling : core.cpus) {
+      if ((int)seen.size() <= sibling) {
+        seen.resize(sibling + 1, false);
+      }
+      seen[sibling] = true;
+    }
+    std::ifstream l3(dir + "/cache/index3/shared_cpu_list");
+    std::string l3_list;
+    if (std::getline(l3, l3_list)) {
+      auto it = l3_ids.emplace(l3_list, (int)l3_ids.size()).first;
+      core.ccx = it->second;
+    }
+    cores.push_back(core);
+  }
+  return cores;
+}
+
+inline bool pin_current_thread(const std::vector<int>& cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  return !cpus.empty() &&
+         pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+#endif
+
+/**
+ * Where the demo threads run: the ORT intra-op threads get a core each on
+ * one CCX, and the decode and GUI threads are kept off those cores, on
+ * another CCX when there is one, so they don't land on spinning cores.
+ */
+struct AffinityPlan {
+  // the cores of the ORT intra-op threads, the first one is for the
+  // thread calling Run(), which is part of the pool
+  std::vector<std::vector<int>> ort_cores;
+  std::vector<int> model_cpus;
+  std::vector<int> decode_cpus;
+  std::vector<int> gui_cpus;
+
+  // for kOrtSessionOptionsConfigIntraOpThreadAffinities, one entry per
+  // pool thread but the caller, with 1 based logical processor ids
+  std::string ort_affinities() const {
+    std::stringstream ss;
+    for (size_t i = 1; i < ort_cores.size(); ++i) {
+      ss << (i > 1 ? ";" : "");
+      for (size_t j = 0; j < ort_cores[i].size(); ++j) {
+        ss << (j ? "," : "") << ort_cores[i][j] + 1;
+      }
+    }
+    return ss.str();
+  }
+
+  std::string to_string() const {
+    auto print = [](std::stringstream& ss, const std::vector<int>& cpus) {
+      for (size_t i = 0; i < cpus.size(); ++i) {
+        ss << (i ? "," : "") << cpus[i];
+      }
+    };
+    std::stringstream ss;
+    ss << "model threads on cpus ";
+    print(ss, model_cpus);
+    ss << ", ort intra-op threads on \"" << ort_affinities() << "\"";
+    ss << ", decode threads on cpus ";
+    print(ss, decode_cpus);
+    ss << ", gui thread on cpus ";
+    print(ss, gui_cpus);
+    return ss.str();
+  }
+};
+
+// Plans for intra_op_threads ORT threads, 0 takes every core left after the
+// decode and GUI cores of a single CCX machine.
+inline AffinityPlan plan_affinity(const std::vector<CpuCore>& detected,
+                                  int intra_op_threads) {
+  auto cores = detected;
+  if (cores.empty()) {
+    auto n = (int)std::max(std::thread::hardware_concurrency(), 1u);
+    for (int cpu = 0; cpu < n; ++cpu) {
+      cores.push_back(CpuCore{0, {cpu}});
+    }
+  }
+  std::stable_sort(
+      cores.begin(), cores.end(),
+      [](const CpuCore& a, const CpuCore& b) { return a.ccx < b.ccx; });
+  auto multi_ccx = cores.front().ccx != cores.back().ccx;
+  AffinityPlan plan;
+  // the IO threads get the whole last CCX if there is more than one, the
+  // last core otherwise
+  std::vector<CpuCore> io_cores;
+  if (multi_ccx) {
+    auto last_ccx = cores.back().ccx;
+    while (cores.back().ccx == last_ccx) {
+      io_cores.insert(io_cores.begin(), cores.back());
+      cores.pop_back();
+    }
+  } else if (cores.size() > 1) {
+    io_cores.push_back(cores.back());
+    cores.pop_back();
+  } else {
+    io_cores = cores;
+  }
+  auto ort_count = cores.size();
+  if (intra_op_threads > 0) {
+    ort_count = std::min<size_t>(intra_op_threads, cores.size());
+  } else if (multi_ccx) {
+    // keep the ORT pool on the first CCX, the CCXs don't share a L3
+    auto first_ccx = cores.front().ccx;
+    ort_count = std::count_if(
+        cores.begin(), cores.end(),
+        [first_ccx](const CpuCore& c) { return c.ccx == first_ccx; });
+  }
+  for (size_t i = 0; i < ort_count; ++i) {
+    plan.ort_cores.push_back(cores[i].cpus);
+    plan.model_cpus.insert(plan.model_cpus.end(), cores[i].cpus.begin(),
+                           cores[i].cpus.end());
+  }
+  // the GUI thread gets a core of its own when there are several IO cores
+  if (io_cores.size() > 1) {
+    plan.gui_cpus = io_cores.back().cpus;
+    io_cores.pop_back();
+  }
+  for (const auto& core : io_cores) {
+    plan.decode_cpus.insert(plan.decode_cpus.end(), core.cpus.begin(),
+                            core.cpus.end());
+  }
+  if (plan.gui_cpus.empty()) {
+    plan.gui_cpus = plan.decode_cpus;
+  }
+  return plan;
+}
+}  // namespace ai
+}  // namespace vitis
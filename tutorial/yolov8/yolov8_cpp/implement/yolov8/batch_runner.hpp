@@ -0,0 +1,104 @@
+/*
+ * Copyright 2022-2023 Advanced Micro Devices Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <utility>
+#include <vector>
+
+namespace vitis {
+namespace ai {
+/**
+ * Shares one task between threads and gathers their frames into batched
+ * session runs.
+ *
+ * A caller of run() queues its frame. When no run is in flight, it becomes
+ * the leader: it waits up to the timeout for max_batch frames, runs the
+ * task once on what was gathered and hands every result back to the caller
+ * of its frame. The other callers wait for their result, or lead the next
+ * batch.
+ */
+template <typename Task>
+class BatchRunner {
+ public:
+  using result_t =
+      decltype(std::declval<Task&>().run(std::declval<const cv::Mat&>()));
+
+  BatchRunner(std::unique_ptr<Task>&& task, size_t max_batch,
+              std::chrono::microseconds timeout)
+      : task_{std::move(task)},
+        max_batch_{std::max<size_t>(max_batch, 1)},
+        timeout_{timeout} {}
+
+  size_t getInputWidth() const { return task_->getInputWidth(); }
+  size_t getInputHeight() const { return task_->getInputHeight(); }
+
+  result_t run(const cv::Mat& image) {
+    Request request{&image};
+    std::unique_lock<std::mutex> lock(mtx_);
+    pending_.push_back(&request);
+    cv_.notify_all();
+    while (!request.done) {
+      if (running_) {
+        cv_.wait(lock);
+        continue;
+      }
+      running_ = true;
+      cv_.wait_for(lock, timeout_,
+                   [this] { return pending_.size() >= max_batch_; });
+      auto size = std::min(pending_.size(), max_batch_);
+      std::vector<Request*> batch(pending_.begin(), pending_.begin() + size);
+      pending_.erase(pending_.begin(), pending_.begin() + size);
+      lock.unlock();
+      std::vector<cv::Mat> images;
+      images.reserve(batch.size());
+      for (auto r : batch) {
+        images.push_back(*r->image);
+      }
+      auto results = task_->run(images);
+      lock.lock();
+      for (size_t i = 0; i < batch.size(); ++i) {
+        batch[i]->result = std::move(results[i]);
+        batch[i]->done = true;
+      }
+      running_ = false;
+      cv_.notify_all();
+    }
+    return std::move(request.result);
+  }
+
+ private:
+  struct Request {
+    const cv::Mat* image;
+    result_t result{};
+    bool done{false};
+  };
+
+  std::unique_ptr<Task> task_;
+  size_t max_batch_;
+  std::chrono::microseconds timeout_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::deque<Request*> pending_;
+  bool running_{false};
+};
+}  // namespace ai
+}  // namespace vitis
@@ -42,50 +42,114 @@ struct BenchMarkResult {
   long ret;
   StatSamples e2eSamples;
   StatSamples dpuSamples;
+  StatSamples preprocessSamples;
+  StatSamples runSamples;
+  StatSamples postprocessSamples;
 };
 
 std::mutex g_mtx;
 int g_num_of_threads = 1;
 int g_num_of_seconds = 30;
+int g_num_of_warmup_seconds = 0;
+// requests per second of all the threads, 0 runs them back to back
+double g_arrival_rate = 0.0;
 std::string g_list_name = "image.list";
 std::string g_report_file_name = "";
+std::string g_json_file_name = "";
+// images decoded ahead of the threads, 0 keeps the whole list resident
+size_t g_prefetch = 0;
+// memory mapped file of the resized images, streamed when set
+std::string g_cache_file_name = "";
+// the image loading & the preprocess stage are left out of the e2e latency
+bool g_exclude_preprocess = false;
 long g_total = 0;
 double g_e2e_mean = 0.0;
 double g_dpu_mean = 0.0;
 bool g_stop = false;
+// samples are only kept once the warmup is over
+std::atomic<bool> g_measuring(false);
+std::chrono::steady_clock::time_point g_start_time;
 std::atomic<int> _counter(0);
 long act_time = 30000000;
 
-template <typename T>
-inline BenchMarkResult thread_main_for_performance(const ImageList* image_list,
-                                                   std::unique_ptr<T>&& model) {
+inline cv::Mat next_image(const ImageList& image_list, long& i) {
+  return image_list[i++];
+}
+
+inline cv::Mat next_image(const StreamingImageList& image_list, long&) {
+  return image_list.next();
+}
+
+template <typename T, typename List>
+inline BenchMarkResult thread_main_for_performance(const List* image_list,
+                                                   std::unique_ptr<T>&& model,
+                                                   int thread_index) {
   std::unique_lock<std::mutex> lock_t(g_mtx);
   lock_t.unlock();
   long ret = 0;
+  long next_image_index = 0;
+  long request = 0;
   StatSamples e2e_stat_samples(10000);
   StatSamples dpu_stat_samples(10000);
+  StatSamples preprocess_stat_samples(10000);
+  StatSamples run_stat_samples(10000);
+  StatSamples postprocess_stat_samples(10000);
+  auto to_us = [](std::chrono::steady_clock::duration d) {
+    return int(
+        std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+  };
   while (!g_stop) {
     vitis::ai::TimeMeasure::getThreadLocalForDpu().reset();
     auto start = std::chrono::steady_clock::now();
+    if (g_arrival_rate > 0.0) {
+      // open loop: the threads take the arrivals in turn and the latency
+      // counts from the arrival, so a late start is part of it
+      auto arrival = g_start_time +
+                     std::chrono::duration_cast<
+                         std::chrono::steady_clock::duration>(
+                         std::chrono::duration<double>(
+                             (request++ * g_num_of_threads + thread_index) /
+                             g_arrival_rate));
+      if (arrival > start) {
+        std::this_thread::sleep_until(arrival);
+      }
+      start = arrival;
+    }
     auto batch = model->get_input_batch();
     std::vector<cv::Mat> imgs;
     imgs.reserve(batch);
     for (auto n = 0u; n < batch; n++) {
-      imgs.push_back((*image_list)[ret++]);
+      imgs.push_back(next_image(*image_list, next_image_index));
+    }
+    if (g_exclude_preprocess) {
+      start = std::max(start, std::chrono::steady_clock::now());
     }
     model->run(imgs);
     auto end = std::chrono::steady_clock::now();
-    auto end2endtime =
-        int(std::chrono::duration_cast<std::chrono::microseconds>(end - start)
-                .count());
+    if (!g_measuring) {
+      continue;
+    }
+    ret += batch;
+    const auto& stage_times = model->get_stage_times();
+    auto end2endtime = to_us(end - start);
+    if (g_exclude_preprocess) {
+      end2endtime -= stage_times.preprocess;
+    }
     auto dputime = vitis::ai::TimeMeasure::getThreadLocalForDpu().get();
 
     e2e_stat_samples.addSample(end2endtime);
     dpu_stat_samples.addSample(dputime);
+    preprocess_stat_samples.addSample(stage_times.preprocess);
+    run_stat_samples.addSample(stage_times.run);
+    postprocess_stat_samples.addSample(stage_times.postprocess);
     _counter += batch;
   }
-  return BenchMarkResult{ret, std::move(e2e_stat_samples),
-                         std::move(dpu_stat_samples)};
+  return BenchMarkResult{ret,
+                         std::move(e2e_stat_samples),
+                         std::move(dpu_stat_samples),
+                         std::move(preprocess_stat_samples),
+                         std::move(run_stat_samples),
+                         std::move(postprocess_stat_samples)};
 }
 
 static void signal_handler(int signal) { g_stop = true; }
@@ -94,13 +158,19 @@ static void usage() {
                " -l <log_file_name> \n"
                " -t <num_of_threads> \n"
                " -s <num_of_seconds> \n"
+               " -w <num_of_warmup_seconds> \n"
+               " -r <requests_per_second, open loop when set> \n"
+               " -j <json_report_file_name> \n"
+               " -p <num_of_prefetched_images, streams the list when set> \n"
+               " -c <image_cache_file, streams the list from it when set> \n"
+               " -x exclude image loading & preprocess from the e2e latency \n"
                " <image list file> \n"
             << std::endl;
 }
 inline void parse_opt(int argc, char* argv[]) {
   int opt = 0;
 
-  while ((opt = getopt(argc, argv, "t:s:l:")) != -1) {
+  while ((opt = getopt(argc, argv, "t:s:l:w:r:j:p:c:x")) != -1) {
     switch (opt) {
       case 't':
         g_num_of_threads = std::stoi(optarg);
@@ -111,6 +181,24 @@ inline void parse_opt(int argc, char* argv[]) {
       case 'l':
         g_report_file_name = optarg;
         break;
+      case 'w':
+        g_num_of_warmup_seconds = std::stoi(optarg);
+        break;
+      case 'r':
+        g_arrival_rate = std::stod(optarg);
+        break;
+      case 'j':
+        g_json_file_name = optarg;
+        break;
+      case 'p':
+        g_prefetch = std::stoul(optarg);
+        break;
+      case 'c':
+        g_cache_file_name = optarg;
+        break;
+      case 'x':
+        g_exclude_preprocess = true;
+        break;
       default:
         usage();
         exit(1);
@@ -124,6 +212,53 @@ inline void parse_opt(int argc, char* argv[]) {
   return;
 }
 
+struct LatencyReport {
+  double mean;
+  int p50;
+  int p90;
+  int p99;
+  int max;
+};
+
+static LatencyReport latency_report(StatSamples& samples) {
+  return LatencyReport{samples.size() ? samples.getMean() : 0.0,
+                       samples.getPercentile(50), samples.getPercentile(90),
+                       samples.getPercentile(99), samples.getMax()};
+}
+
+static void report_latency(std::ostream& out, const std::string& name,
+                           const LatencyReport& r) {
+  auto key = name;
+  std::transform(key.begin(), key.end(), key.begin(), ::toupper);
+  out << key << "_MEAN=" << r.mean << "\n"
+      << key << "_P50=" << r.p50 << "\n"
+      << key << "_P90=" << r.p90 << "\n"
+      << key << "_P99=" << r.p99 << "\n"
+      << key << "_MAX=" << r.max << "\n";
+}
+
+static void report_json(std::ostream& out,
+                        const std::vector<std::pair<std::string,
+                                                    LatencyReport>>& stages) {
+  float sec = (float)act_time / 1000000.0;
+  out << "{\n"
+      << "  \"threads\": " << g_num_of_threads << ",\n"
+      << "  \"seconds\": " << sec << ",\n"
+      << "  \"warmup_seconds\": " << g_num_of_warmup_seconds << ",\n"
+      << "  \"arrival_rate\": " << g_arrival_rate << ",\n"
+      << "  \"frames\": " << g_total << ",\n"
+      << "  \"fps\": " << ((float)g_total) / sec << ",\n"
+      << "  \"latency_us\": {";
+  for (size_t i = 0; i < stages.size(); ++i) {
+    const auto& r = stages[i].second;
+    out << (i ? "," : "") << "\n    \"" << stages[i].first << "\": {"
+        << "\"mean\": " << r.mean << ", \"p50\": " << r.p50
+        << ", \"p90\": " << r.p90 << ", \"p99\": " << r.p99
+        << ", \"max\": " << r.max << "}";
+  }
+  out << "\n  }\n}\n" << std::flush;
+}
+
 static void report(std::ostream* p_out) {
   std::ostream& out = *p_out;
   float sec = (float)act_time / 1000000.0;
@@ -159,19 +294,32 @@ template <typename T>
 inline int main_for_performance(int argc, char* argv[], const T& factory_method) {
   parse_opt(argc, argv);
   ENV_PARAM(DEEPHI_DPU_CONSUMING_TIME) = 1;
-  auto lazy_load_image = false;
-  auto image_list =
-      std::unique_ptr<ImageList>(new ImageList(g_list_name, lazy_load_image));
-  if (image_list->empty()) {
-    LOG(FATAL) << "[UNILOG][FATAL][VAILIB_BENCHMARK_LIST_EMPTY][Can not found "
-                  "images. List of images are empty. "
-               << image_list->to_string();
-  }
   auto model = factory_method();
   using model_t = typename decltype(model)::element_type;
   auto width = model->getInputWidth();
   auto height = model->getInputHeight();
-  image_list->resize_images(width, height);
+  auto image_list = std::unique_ptr<ImageList>{};
+  auto stream_list = std::unique_ptr<StreamingImageList>{};
+  if (g_prefetch > 0 || !g_cache_file_name.empty()) {
+    stream_list = std::unique_ptr<StreamingImageList>(new StreamingImageList(
+        g_list_name, width, height, g_prefetch, g_cache_file_name));
+    if (stream_list->empty()) {
+      LOG(FATAL) << "[UNILOG][FATAL][VAILIB_BENCHMARK_LIST_EMPTY][Can not "
+                    "found images. List of images are empty. "
+                 << stream_list->to_string();
+    }
+    LOG(INFO) << "streaming " << stream_list->to_string();
+  } else {
+    auto lazy_load_image = false;
+    image_list = std::unique_ptr<ImageList>(
+        new ImageList(g_list_name, lazy_load_image));
+    if (image_list->empty()) {
+      LOG(FATAL) << "[UNILOG][FATAL][VAILIB_BENCHMARK_LIST_EMPTY][Can not "
+                    "found images. List of images are empty. "
+                 << image_list->to_string();
+    }
+    image_list->resize_images(width, height);
+  }
   //
   std::vector<std::future<BenchMarkResult>> results;
   results.reserve(g_num_of_threads);
@@ -200,16 +348,31 @@ inline int main_for_performance(int argc, char* argv[], const T& factory_method)
 
   std::unique_lock<std::mutex> lock_main(g_mtx);
   for (int i = 0; i < g_num_of_threads; ++i) {
-    results.emplace_back(std::async(std::launch::async,
-                                    thread_main_for_performance<model_t>,  //
-                                    image_list.get(),                      //
-                                    std::move(models[i])));
+    if (stream_list) {
+      results.emplace_back(std::async(
+          std::launch::async,
+          thread_main_for_performance<model_t, StreamingImageList>,  //
+          stream_list.get(),                                         //
+          std::move(models[i]), i));
+    } else {
+      results.emplace_back(std::async(
+          std::launch::async,
+          thread_main_for_performance<model_t, ImageList>,  //
+          image_list.get(),                                 //
+          std::move(models[i]), i));
+    }
   }
   signal(SIGALRM, signal_handler);
-  alarm(g_num_of_seconds);
+  alarm(g_num_of_warmup_seconds + g_num_of_seconds);
 
-  auto exe_start = std::chrono::system_clock::now();
+  g_start_time = std::chrono::steady_clock::now();
   lock_main.unlock();
+  if (g_num_of_warmup_seconds > 0) {
+    LOG(INFO) << "warming up for " << g_num_of_warmup_seconds << " seconds";
+    std::this_thread::sleep_for(std::chrono::seconds(g_num_of_warmup_seconds));
+  }
+  g_measuring = true;
+  auto exe_start = std::chrono::system_clock::now();
   for (int i = 0; i < g_num_of_seconds; i = i + step) {
     LOG(INFO) << "waiting for " << i << "/" << g_num_of_seconds << " seconds, "
               << g_num_of_threads << " threads running";
@@ -224,11 +387,17 @@ inline int main_for_performance(int argc, char* argv[], const T& factory_method)
 
   StatSamples e2eStatSamples(0);
   StatSamples dpuStatSamples(0);
+  StatSamples preprocessStatSamples(0);
+  StatSamples runStatSamples(0);
+  StatSamples postprocessStatSamples(0);
   for (auto& r : results) {
     auto result = r.get();
     total = total + result.ret;
     e2eStatSamples.merge(result.e2eSamples);
     dpuStatSamples.merge(result.dpuSamples);
+    preprocessStatSamples.merge(result.preprocessSamples);
+    runStatSamples.merge(result.runSamples);
+    postprocessStatSamples.merge(result.postprocessSamples);
   }
 
   act_time = std::chrono::duration_cast<std::chrono::microseconds>(
@@ -253,6 +422,20 @@ inline int main_for_performance(int argc, char* argv[], const T& factory_method)
   } else {
     report_for_mt(report_fs);
   }
+  auto stages = std::vector<std::pair<std::string, LatencyReport>>{
+      {"e2e", latency_report(e2eStatSamples)},
+      {"preprocess", latency_report(preprocessStatSamples)},
+      {"run", latency_report(runStatSamples)},
+      {"postprocess", latency_report(postprocessStatSamples)}};
+  for (const auto& stage : stages) {
+    report_latency(*report_fs, stage.first, stage.second);
+  }
+  *report_fs << std::flush;
+  if (!g_json_file_name.empty()) {
+    LOG(INFO) << "writing json report to " << g_json_file_name;
+    std::ofstream json_fs(g_json_file_name.c_str(), std::ofstream::out);
+    report_json(json_fs, stages);
+  }
   return 0;
 }
 
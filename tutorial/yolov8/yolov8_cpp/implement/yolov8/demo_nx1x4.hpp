@@ -31,8 +31,11 @@
 #include <stack>
 #include <thread>
 #include <type_traits>
+#include "affinity_planner.hpp"
+#include "batch_runner.hpp"
 #include "vitis/ai/bounded_queue.hpp"
 #include "vitis/ai/env_config.hpp"
+#include "vitis/ai/frame_pool.hpp"
 
 DEF_ENV_PARAM(DEBUG_DEMO, "0")
 
@@ -149,6 +152,9 @@ struct MyThread {
   void main() {
     LOG_IF(INFO, ENV_PARAM(DEBUG_DEMO))
         << "thread [" << name() << "] is started";
+    if (!affinity_.empty() && !pin_current_thread(affinity_)) {
+      LOG(WARNING) << "cannot pin thread [" << name() << "]";
+    }
     while (!stop_) {
       auto run_ret = run();
       if (!stop_) {
@@ -193,9 +199,12 @@ struct MyThread {
     }
   }
   bool is_stopped() { return stop_; }
+  // the logical processors to run on, set before start()
+  void set_affinity(const std::vector<int>& cpus) { affinity_ = cpus; }
 
   bool stop_;
   std::unique_ptr<std::thread> thread_;
+  std::vector<int> affinity_;
 };
 
 // std::vector<MyThread *> MyThread::all_threads_;
@@ -218,8 +227,14 @@ struct DecodeThread : public MyThread {
   virtual ~DecodeThread() {}
 
   virtual int run() override {
+    auto buffer = pool_.acquire();
+    if (buffer == nullptr) {
+      // all the frames are in flight
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      return 0;
+    }
     auto& cap = *video_stream_.get();
-    cv::Mat image;
+    cv::Mat& image = *buffer;
     cap >> image;
     auto video_ended = image.empty();
     if (video_ended) {
@@ -228,10 +243,9 @@ struct DecodeThread : public MyThread {
       return 0;
     }
     LOG_IF(INFO, ENV_PARAM(DEBUG_DEMO))
-        << "decode queue size " << queue_->size();
-    if (queue_->size() > 0 && is_camera_ == true) {
-      return 0;
-    }
+        << "decode queue size " << queue_->size()
+        << " dropped " << queue_->dropped();
+    // a camera queue drops the oldest frame instead of blocking
     while (!queue_->push(FrameInfo{channel_id_, ++frame_id_, image},
                          std::chrono::milliseconds(500))) {
       if (is_stopped()) {
@@ -245,9 +259,13 @@ struct DecodeThread : public MyThread {
     return std::string{"DedodeThread-"} + std::to_string(channel_id_);
   }
 
+  static bool is_camera(const std::string& video_file) {
+    return video_file.size() == 1 && video_file[0] >= '0' &&
+           video_file[0] <= '9';
+  }
+
   void open_stream() {
-    is_camera_ = video_file_.size() == 1 && video_file_[0] >= '0' &&
-                 video_file_[0] <= '9';
+    is_camera_ = is_camera(video_file_);
     video_stream_ = std::unique_ptr<cv::VideoCapture>(
         is_camera_ ? new cv::VideoCapture(std::stoi(video_file_))
                    : new cv::VideoCapture(video_file_));
@@ -264,6 +282,8 @@ struct DecodeThread : public MyThread {
   std::string video_file_;
   unsigned long frame_id_;
   std::unique_ptr<cv::VideoCapture> video_stream_;
+  // the frames in flight at most
+  FramePool pool_{64};
   queue_t* queue_;
   bool is_camera_;
 };
@@ -370,10 +390,11 @@ struct Filter {
   virtual cv::Mat run(cv::Mat& input) = 0;
 };
 
-// Execute each lib run function and processor your implement
+// Execute each lib run function and processor your implement, the model
+// may be shared by the filters of several threads
 template <typename dpu_model_type_t, typename ProcessResult>
 struct DpuFilter : public Filter {
-  DpuFilter(std::unique_ptr<dpu_model_type_t>&& dpu_model,
+  DpuFilter(std::shared_ptr<dpu_model_type_t> dpu_model,
             const ProcessResult& processor)
       : Filter{}, dpu_model_{std::move(dpu_model)}, processor_{processor} {
     LOG(INFO) << "DPU model size=" << dpu_model_->getInputWidth() << "x"
@@ -384,7 +405,7 @@ struct DpuFilter : public Filter {
     auto result = dpu_model_->run(image);
     return processor_(image, result, false);
   }
-  std::unique_ptr<dpu_model_type_t> dpu_model_;
+  std::shared_ptr<dpu_model_type_t> dpu_model_;
   const ProcessResult& processor_;
 };
 template <typename FactoryMethod, typename ProcessResult>
@@ -394,6 +415,14 @@ std::unique_ptr<Filter> create_dpu_filter(const FactoryMethod& factory_method,
   return std::unique_ptr<Filter>(new DpuFilter<dpu_model_type_t, ProcessResult>(
       factory_method(), process_result));
 }
+// The filters of all the threads feed one model through a BatchRunner
+template <typename Task, typename ProcessResult>
+std::unique_ptr<Filter> create_batch_dpu_filter(
+    const std::shared_ptr<BatchRunner<Task>>& runner,
+    const ProcessResult& process_result) {
+  return std::unique_ptr<Filter>(
+      new DpuFilter<BatchRunner<Task>, ProcessResult>(runner, process_result));
+}
 
 // Execute dpu filter
 struct DpuThread : public MyThread {
@@ -517,6 +546,8 @@ inline void usage_video(const char* progname) {
             << "      -T [Set intra op thread affinities]: Specify intra op thread affinity string.\n         [Example]: -T 1,2;3,4;5,6 or -T 1-2;3-4;5-6\n         Use semicolon to separate configuration between threads.\n         E.g. 1,2;3,4;5,6 specifies affinities for three threads, the first thread will be attached to the first and second logical processor.\n"
             << "      -R [Set camera resolution]: Specify the camera resolution by string.\n         [Example]: -R 1280x720\n         Default:1920x1080.\n"
             << "      -r [Set Display resolution]: Specify the display resolution by string.\n         [Example]: -r 1280x720\n         Default:1920x1080.\n"
+            << "      -b [batch size]: Gathers the frames of the parallel runs into batches of up to this size on one shared model. Default:1.\n"
+            << "      -A [Automatic thread placement]: Pins the ORT intra-op, model, decode and GUI threads on separate cores, and CCXs when there are several, and prints the plan. An explicit -T is kept.\n"
             << "      -L Print detection log when turning on.\n"
             << "      -h: help\n"
             << std::endl;
@@ -527,19 +558,27 @@ inline void usage_video(const char* progname) {
  */
 static std::vector<int> g_num_of_threads;
 static std::vector<std::string> g_avi_file;
+static int g_batch_size = 1;
+static bool g_auto_affinity = false;
+// how long the first frame of a batch waits for the others
+static std::chrono::microseconds g_batch_timeout{2000};
 
 inline void parse_opt(int argc, char* argv[], int start_pos = 1) {
   int opt = 0;
   optind = start_pos;
   std::vector<std::string> sp;
   std::vector<std::string> spd;
-  while ((opt = getopt(argc, argv, "s:y:x:c:T:R:r:DhLZ")) != -1) {
+  while ((opt = getopt(argc, argv, "s:y:x:c:b:T:R:r:ADhLZ")) != -1) {
     // LOG(INFO) << *argv;
     switch (opt) {
       case 'c':
         LOG(INFO) << "Setting parallelism to " << std::stoi(optarg);
         g_num_of_threads.emplace_back(std::stoi(optarg));
         break;
+      case 'b':
+        LOG(INFO) << "Setting batch size to " << std::stoi(optarg);
+        g_batch_size = std::stoi(optarg);
+        break;
       case 'x':
         LOG(INFO) << "Setting intra_op_num_threads to " << std::stoi(optarg);
         onnx_x = std::stoi(optarg);
@@ -548,6 +587,10 @@ inline void parse_opt(int argc, char* argv[], int start_pos = 1) {
         LOG(INFO) << "Setting inter_op_num_threads to " << std::stoi(optarg);
         onnx_y = std::stoi(optarg);
         break;
+      case 'A':
+        g_auto_affinity = true;
+        LOG(INFO) << "[Automatic thread placement]";
+        break;
       case 'D':
         onnx_disable_spinning = true;
         LOG(INFO) << "[Disable thread spinning]";
@@ -609,9 +652,26 @@ int main_for_video_demo(int argc, char* argv[],
                         const ProcessResult& process_result) {
   signal(SIGINT, MyThread::signal_handler);
   parse_opt(argc, argv);
+  AffinityPlan plan;
+  if (g_auto_affinity) {
+    plan = plan_affinity(detect_cpu_cores(), onnx_x);
+    if (onnx_x <= 0) {
+      onnx_x = (int)plan.ort_cores.size();
+    }
+    if (intra_op_thread_affinities.empty()) {
+      intra_op_thread_affinities = plan.ort_affinities();
+    }
+    LOG(INFO) << "[Affinity plan]: " << plan.to_string();
+  }
   {
     auto channel_id = 0;
-    auto decode_queue = std::unique_ptr<queue_t>{new queue_t{5}};
+    // a live camera keeps one frame per model thread at most, so the
+    // latency stays bounded when the model falls behind
+    auto decode_queue = std::unique_ptr<queue_t>{
+        DecodeThread::is_camera(g_avi_file[0])
+            ? new queue_t{(size_t)g_num_of_threads[0],
+                          QueuePolicy::DROP_OLDEST}
+            : new queue_t{5}};
     auto decode_thread = std::unique_ptr<DecodeThread>(
         new DecodeThread{channel_id, g_avi_file[0], decode_queue.get()});
     auto dpu_thread = std::vector<std::unique_ptr<DpuThread>>{};
@@ -619,18 +679,37 @@ int main_for_video_demo(int argc, char* argv[],
         std::unique_ptr<queue_t>(new queue_t(5 * g_num_of_threads[0]));
     auto gui_thread = GuiThread::instance();
     auto gui_queue = gui_thread->getQueue();
+    using dpu_model_type_t = typename decltype(factory_method())::element_type;
+    auto runner = std::shared_ptr<BatchRunner<dpu_model_type_t>>{};
+    if (g_batch_size > 1) {
+      runner = std::make_shared<BatchRunner<dpu_model_type_t>>(
+          factory_method(), g_batch_size, g_batch_timeout);
+    }
     for (int i = 0; i < g_num_of_threads[0]; ++i) {
-      dpu_thread.emplace_back(new DpuThread(
-          create_dpu_filter(factory_method, process_result), decode_queue.get(),
-          sorting_queue.get(), std::to_string(i)));
+      auto filter = runner ? create_batch_dpu_filter(runner, process_result)
+                           : create_dpu_filter(factory_method, process_result);
+      dpu_thread.emplace_back(new DpuThread(std::move(filter),
+                                            decode_queue.get(),
+                                            sorting_queue.get(),
+                                            std::to_string(i)));
     }
     auto sorting_thread = std::unique_ptr<SortingThread>(
         new SortingThread(sorting_queue.get(), gui_queue, std::to_string(0)));
+    if (g_auto_affinity) {
+      decode_thread->set_affinity(plan.decode_cpus);
+      sorting_thread->set_affinity(plan.decode_cpus);
+      gui_thread->set_affinity(plan.gui_cpus);
+      for (auto& th : dpu_thread) {
+        th->set_affinity(plan.model_cpus);
+      }
+    }
     // start everything
     MyThread::start_all();
     gui_thread->wait();
     MyThread::stop_all();
     MyThread::wait_all();
+    LOG_IF(INFO, decode_queue->dropped() > 0)
+        << "dropped " << decode_queue->dropped() << " camera frames";
   }
   LOG_IF(INFO, ENV_PARAM(DEBUG_DEMO)) << "BYEBYE";
   return 0;
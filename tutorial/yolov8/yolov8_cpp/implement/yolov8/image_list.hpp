@@ -16,9 +16,21 @@
 #pragma once
 #include <glog/logging.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <mutex>
 #include <opencv2/opencv.hpp>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace vitis {
@@ -114,5 +126,198 @@ inline void ImageList::resize_images(int w, int h) {
   }
 }
 
+/**
+ * The images of a list streamed from disk, for lists too large to be
+ * resident. Images are resized to width x height by decoder threads
+ * which keep at most `prefetch` of them ready, next() hands them out in
+ * turn to any thread.
+ *
+ * With a cache file, the resized images are written once to it and it is
+ * memory mapped by the next runs, next() then returns images over the
+ * mapping without decoding anything. A cache of another list size or
+ * image size is rebuilt.
+ */
+class StreamingImageList {
+ public:
+  StreamingImageList(const std::string &filename, int width, int height,
+                     size_t prefetch, const std::string &cache_file = "");
+  StreamingImageList(const StreamingImageList &) = delete;
+  StreamingImageList &operator=(const StreamingImageList &other) = delete;
+  virtual ~StreamingImageList();
+
+ public:
+  cv::Mat next() const;
+
+  std::string to_string();
+  bool empty() const { return names_.empty(); }
+  size_t size() const { return names_.size(); }
+  bool cached() const { return map_ != nullptr; }
+
+ private:
+  struct CacheHeader {
+    char magic[8];
+    int32_t width;
+    int32_t height;
+    int64_t count;
+  };
+
+  size_t image_bytes() const { return size_t(width_) * height_ * 3; }
+  cv::Mat load(size_t i) const;
+  bool map_cache(const std::string &cache_file);
+  void build_cache(const std::string &cache_file);
+  void decoder_main();
+
+ private:
+  std::vector<std::string> names_;
+  int width_;
+  int height_;
+  size_t capacity_;
+  mutable std::atomic<size_t> next_{0u};
+  // decoded images, filled by decoders_
+  mutable std::mutex mtx_;
+  mutable std::condition_variable not_empty_;
+  mutable std::condition_variable not_full_;
+  mutable std::deque<cv::Mat> ready_;
+  std::vector<std::thread> decoders_;
+  bool stop_ = false;
+  // the cache file mapping
+  void *map_ = nullptr;
+  size_t map_size_ = 0;
+};
+
+inline StreamingImageList::StreamingImageList(const std::string &filename,
+                                              int width, int height,
+                                              size_t prefetch,
+                                              const std::string &cache_file)
+    : width_{width},
+      height_{height},
+      capacity_{std::max<size_t>(1u, prefetch)} {
+  for (const auto &image : get_list(filename, true)) {
+    names_.push_back(image.name);
+  }
+  if (names_.empty()) {
+    return;
+  }
+  if (!cache_file.empty()) {
+    if (!map_cache(cache_file)) {
+      build_cache(cache_file);
+      CHECK(map_cache(cache_file)) << "cannot map image cache " << cache_file;
+    }
+    return;
+  }
+  auto num_decoders = std::min<size_t>(
+      capacity_, std::max(1u, std::thread::hardware_concurrency()));
+  for (auto i = 0u; i < num_decoders; ++i) {
+    decoders_.emplace_back(&StreamingImageList::decoder_main, this);
+  }
+}
+
+inline StreamingImageList::~StreamingImageList() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  not_full_.notify_all();
+  for (auto &t : decoders_) {
+    t.join();
+  }
+  if (map_) {
+    munmap(map_, map_size_);
+  }
+}
+
+inline std::string StreamingImageList::to_string() {
+  std::ostringstream str;
+  str << names_.size() << " images of " << cv::Size{width_, height_}
+      << (cached() ? ", cached" : ", streamed");
+  return str.str();
+}
+
+inline cv::Mat StreamingImageList::next() const {
+  if (cached()) {
+    auto i = next_++ % names_.size();
+    auto data = static_cast<uint8_t *>(map_) + sizeof(CacheHeader) +
+                i * image_bytes();
+    return cv::Mat(height_, width_, CV_8UC3, data);
+  }
+  std::unique_lock<std::mutex> lock(mtx_);
+  not_empty_.wait(lock, [this] { return !ready_.empty(); });
+  auto image = std::move(ready_.front());
+  ready_.pop_front();
+  lock.unlock();
+  not_full_.notify_one();
+  return image;
+}
+
+inline cv::Mat StreamingImageList::load(size_t i) const {
+  auto image = cv::imread(names_[i]);
+  if (image.empty()) {
+    LOG(WARNING) << "cannot read image: " << names_[i];
+    return cv::Mat(height_, width_, CV_8UC3, cv::Scalar{0, 0, 0});
+  }
+  auto resized = cv::Mat{};
+  cv::resize(image, resized, cv::Size{width_, height_});
+  return resized;
+}
+
+inline void StreamingImageList::decoder_main() {
+  while (true) {
+    auto image = load(next_++ % names_.size());
+    std::unique_lock<std::mutex> lock(mtx_);
+    not_full_.wait(lock,
+                   [this] { return stop_ || ready_.size() < capacity_; });
+    if (stop_) {
+      return;
+    }
+    ready_.push_back(std::move(image));
+    lock.unlock();
+    not_empty_.notify_one();
+  }
+}
+
+inline bool StreamingImageList::map_cache(const std::string &cache_file) {
+  auto fd = open(cache_file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  auto expected = sizeof(CacheHeader) + names_.size() * image_bytes();
+  CacheHeader header;
+  auto ok = fstat(fd, &st) == 0 && size_t(st.st_size) == expected &&
+            read(fd, &header, sizeof(header)) == ssize_t(sizeof(header)) &&
+            std::memcmp(header.magic, "VAIIMGC", 8) == 0 &&
+            header.width == width_ && header.height == height_ &&
+            header.count == int64_t(names_.size());
+  if (ok) {
+    map_ = mmap(nullptr, expected, PROT_READ, MAP_SHARED, fd, 0);
+    if (map_ == MAP_FAILED) {
+      map_ = nullptr;
+      ok = false;
+    } else {
+      map_size_ = expected;
+    }
+  }
+  close(fd);
+  if (!ok) {
+    LOG(INFO) << "image cache " << cache_file << " is missing or stale";
+  }
+  return ok;
+}
+
+inline void StreamingImageList::build_cache(const std::string &cache_file) {
+  LOG(INFO) << "writing image cache " << cache_file << " for "
+            << names_.size() << " images";
+  std::ofstream fs(cache_file.c_str(), std::ios::binary | std::ios::trunc);
+  CHECK(fs) << "cannot write image cache " << cache_file;
+  CacheHeader header{"VAIIMGC", width_, height_, int64_t(names_.size())};
+  fs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (auto i = 0u; i < names_.size(); ++i) {
+    auto image = load(i);
+    CHECK(image.isContinuous());
+    fs.write(reinterpret_cast<const char *>(image.data), image_bytes());
+  }
+  CHECK(fs) << "cannot write image cache " << cache_file;
+}
+
 }  // namespace ai
 }  // namespace vitis
@@ -16,9 +16,12 @@
 #pragma once
 #include <onnxruntime_cxx_api.h>
 
+#include <algorithm>
+#include <functional>
+#include <numeric>
 #include <sstream>
 
-#include <onnxruntime_session_options_config_keys.h>
+#include <vai_ep_runtime/input_buffer.hpp>
 #include "vitis/ai/env_config.hpp"
 #include "vitis/ai/profiling.hpp"
 #if _WIN32
@@ -51,141 +54,36 @@ static void CheckStatus(OrtStatus* status) {
   }
 }
 #endif
-// pretty prints a shape dimension vector
-static std::string print_shape(const std::vector<int64_t> &v)
+// the time of each stage of the last run, in microseconds
+struct StageTimes
 {
-  std::stringstream ss("");
-  for (size_t i = 0; i < v.size() - 1; i++)
-    ss << v[i] << "x";
-  ss << v[v.size() - 1];
-  return ss.str();
-}
-
-std::vector<std::vector<int64_t>> get_input_shapes(Ort::Session *session)
-{
-  std::vector<std::vector<int64_t>> input_shapes;
-  const size_t num_input_nodes = session->GetInputCount();
-  input_shapes.resize(num_input_nodes);
-  for (size_t i = 0; i < num_input_nodes; i++)
-  {
-    auto type_info = session->GetInputTypeInfo(i);
-    auto tensor_info = type_info.GetTensorTypeAndShapeInfo();
-    input_shapes[i] = tensor_info.GetShape();
-  }
-  return input_shapes;
-}
-std::vector<std::vector<int64_t>> get_output_shapes(Ort::Session *session)
-{
-  std::vector<std::vector<int64_t>> output_shapes;
-  const size_t num_output_nodes = session->GetOutputCount();
-  output_shapes.resize(num_output_nodes);
-  for (size_t i = 0; i < num_output_nodes; i++)
-  {
-    auto type_info = session->GetOutputTypeInfo(i);
-    auto tensor_info = type_info.GetTensorTypeAndShapeInfo();
-    output_shapes[i] = tensor_info.GetShape();
-  }
-  return output_shapes;
-}
-void get_input_names(Ort::Session *session,
-                     std::vector<Ort::AllocatedStringPtr> &input_names_ptr,
-                     std::vector<const char *> &input_node_names)
-{
-  const size_t num_input_nodes = session->GetInputCount();
-  input_names_ptr.reserve(num_input_nodes);
-  input_node_names.reserve(num_input_nodes);
-  Ort::AllocatorWithDefaultOptions allocator;
-  for (size_t i = 0; i < num_input_nodes; i++)
-  {
-    auto input_name = session->GetInputNameAllocated(i, allocator);
-    input_node_names.push_back(input_name.get());
-    input_names_ptr.push_back(std::move(input_name));
-  }
-}
-void get_output_names(Ort::Session *session,
-                      std::vector<Ort::AllocatedStringPtr> &output_names_ptr,
-                      std::vector<const char *> &output_node_names)
-{
-  const size_t num_output_nodes = session->GetOutputCount();
-  output_names_ptr.reserve(num_output_nodes);
-  output_node_names.reserve(num_output_nodes);
-  Ort::AllocatorWithDefaultOptions allocator;
-  for (size_t i = 0; i < num_output_nodes; i++)
-  {
-    auto output_name = session->GetOutputNameAllocated(i, allocator);
-    output_node_names.push_back(output_name.get());
-    output_names_ptr.push_back(std::move(output_name));
-  }
-}
+  int preprocess = 0;
+  int run = 0;
+  int postprocess = 0;
+};
 
+// A yolov8 model task on the shared VitisAI EP runtime, which sets up the
+// session and runs it through an IoBinding
 class OnnxTask
 {
 public:
   explicit OnnxTask(const std::string &model_name)
-      : model_name_(model_name),
-        env_(ORT_LOGGING_LEVEL_WARNING, model_name_.c_str()),
-        session_options_(Ort::SessionOptions())
+      : model_name_(model_name), session_(session_config(model_name)),
+        runner_(session_)
   {
-    auto options = std::unordered_map<std::string, std::string>({});
-    options["config_file"] = "../bin/vaip_config.json";
-    // optional, eg: cache path and cache key: /tmp/my_cache/abcdefg
-    // options["CacheDir"] = "/tmp/my_cache";
-    // options["CacheKey"] = "abcdefg";
-
-    session_options_.AppendExecutionProvider_VitisAI(options);
-
-    if (onnx_x > 0)
-    {
-      fprintf(stdout, "Setting intra_op_num_threads to %d\n", onnx_x);
-      session_options_.SetIntraOpNumThreads(onnx_x);
-    }
-
-    if (onnx_y > 0)
-    {
-      fprintf(stdout, "Setting inter_op_num_threads to %d\n", onnx_y);
-      session_options_.SetInterOpNumThreads(onnx_y);
-    }
-
-    if (onnx_disable_spinning)
-    {
-      fprintf(stdout, "Disabling intra-op thread spinning entirely\n");
-      session_options_.AddConfigEntry(
-          kOrtSessionOptionsConfigAllowIntraOpSpinning, "0");
-    }
-
-    if (onnx_disable_spinning_between_run)
-    {
-      fprintf(stdout, "Disabling intra-op thread spinning between runs\n");
-      session_options_.AddConfigEntry(kOrtSessionOptionsConfigForceSpinningStop,
-                                      "1");
-    }
-
-    if (!intra_op_thread_affinities.empty())
-    {
-      fprintf(stdout, "Setting intra op thread affinity as %s\n",
-              intra_op_thread_affinities.c_str());
-      session_options_.AddConfigEntry(
-          kOrtSessionOptionsConfigIntraOpThreadAffinities,
-          intra_op_thread_affinities.c_str());
-    }
-
-    auto model_name_basic = strconverter.from_bytes(model_name_);
-
-    session_.reset(new Ort::Session(env_, model_name_basic.c_str(), session_options_));
-    input_shapes_ = ::get_input_shapes(session_.get());
-    output_shapes_ = ::get_output_shapes(session_.get());
-    if (input_shapes_[0][0] == -1)
+    input_shapes_ = session_.input_shapes();
+    output_shapes_ = session_.output_shapes();
+    if (session_.dynamic_batch())
     {
+      dynamic_batch_ = true;
       input_shapes_[0][0] = 1;
       output_shapes_[0][0] = 1;
     }
-    ::get_input_names(session_.get(), input_names_ptr_, input_node_names_);
-    ::get_output_names(session_.get(), output_names_ptr_, output_node_names_);
-    for (auto name : input_node_names_)
+    for (auto name : session_.input_names())
     {
       input_names_.push_back(name);
     }
-    for (auto name : output_node_names_)
+    for (auto name : session_.output_names())
     {
       output_names_.push_back(name);
     }
@@ -198,6 +96,9 @@ public:
   size_t getInputWidth() const { return input_shapes_[0][3]; };
   size_t getInputHeight() const { return input_shapes_[0][2]; };
   size_t get_input_batch() const { return input_shapes_[0][0]; }
+  // the batch dimension of the model is -1, any batch size can run
+  bool is_dynamic_batch() const { return dynamic_batch_; }
+  const StageTimes &get_stage_times() const { return stage_times_; }
 
   std::vector<std::vector<int64_t>> get_input_shapes() { return input_shapes_; }
 
@@ -210,21 +111,29 @@ public:
     return output_shapes_;
   }
 
-  void set_input_image_rgb(const cv::Mat &image, float *data,
+  // convert maps the float values to the element type of the tensor, see
+  // vai_ep::InputBuffer
+  template <typename T, typename Convert = vai_ep::FloatConvert>
+  void set_input_image_rgb(const cv::Mat &image, T *data,
                            const std::vector<float> &mean,
-                           const std::vector<float> &scale)
+                           const std::vector<float> &scale,
+                           Convert convert = {})
   {
-    return set_input_image_internal(image, data, mean, scale, true);
+    return set_input_image_internal(image, data, mean, scale, true, convert);
   }
-  void set_input_image_bgr(const cv::Mat &image, float *data,
+  template <typename T, typename Convert = vai_ep::FloatConvert>
+  void set_input_image_bgr(const cv::Mat &image, T *data,
                            const std::vector<float> &mean,
-                           const std::vector<float> &scale)
+                           const std::vector<float> &scale,
+                           Convert convert = {})
   {
-    return set_input_image_internal(image, data, mean, scale, false);
+    return set_input_image_internal(image, data, mean, scale, false, convert);
   }
-  void set_input_image_internal(const cv::Mat &image, float *data,
+  template <typename T, typename Convert>
+  void set_input_image_internal(const cv::Mat &image, T *data,
                                 const std::vector<float> &mean,
-                                const std::vector<float> &scale, bool btrans)
+                                const std::vector<float> &scale, bool btrans,
+                                Convert convert)
   {
     // BGR->RGB (maybe) and HWC->CHW
     for (int c = 0; c < 3; c++)
@@ -237,70 +146,95 @@ public:
           auto image_data =
               (image.at<cv::Vec3b>(h, w)[c_t] - mean[c_t]) * scale[c_t];
           data[c * image.rows * image.cols + h * image.cols + w] =
-              (float)image_data;
+              convert((float)image_data);
         }
       }
     }
   }
-  std::vector<Ort::Value> convert_input(
-      std::vector<float> &input_values, size_t size,
-      const std::vector<int64_t> input_tensor_shape)
+
+  // run with the tensors bound beforehand, the outputs are written in place
+  void run_task()
   {
-    std::vector<Ort::Value> input_tensors;
-    Ort::MemoryInfo info =
-        Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-    input_tensors.push_back(Ort::Value::CreateTensor<float>(
-        info, input_values.data(), size, input_tensor_shape.data(),
-        input_tensor_shape.size()));
-    return input_tensors;
+    print_io_debug();
+    runner_.run();
   }
 
-  void run_task(const std::vector<Ort::Value> &input_tensors,
-                std::vector<Ort::Value> &output_tensors)
+  // Binds values as the input 0, again only when its buffer or its shape
+  // changed since the last run
+  void bind_input(vai_ep::InputBuffer &values,
+                  const std::vector<int64_t> &shape)
   {
-    auto &input_names = input_names_;
-    if (ENV_PARAM(DEBUG_ONNX_TASK))
+    values.bind(runner_, 0, shape);
+  }
+
+  // Binds a buffer owned by the runner to each output whose shape is known
+  // once the batch is, so the runs write in place and allocate nothing;
+  // the outputs with other dynamic dimensions are allocated by ORT
+  void bind_outputs(int64_t batch) { runner_.bind_outputs(batch); }
+
+  Ort::IoBinding &io_binding() { return runner_.io_binding(); }
+
+  // the output i of the last bound run and its shape
+  float *get_bound_output(size_t i) { return runner_.output(i); }
+  const std::vector<int64_t> &get_bound_output_shape(size_t i)
+  {
+    return runner_.output_shape(i);
+  }
+
+protected:
+  // the demo options of the ORT threads
+  static vai_ep::SessionConfig session_config(const std::string &model_name)
+  {
+    vai_ep::SessionConfig config;
+    config.model = model_name;
+    config.config_file = "../bin/vaip_config.json";
+    // optional, eg: cache path and cache key: /tmp/my_cache/abcdefg
+    // config.cache_dir = "/tmp/my_cache";
+    // config.cache_key = "abcdefg";
+    config.intra_op_threads = onnx_x;
+    config.inter_op_threads = onnx_y;
+    config.disable_spinning = onnx_disable_spinning;
+    config.disable_spinning_between_run = onnx_disable_spinning_between_run;
+    config.intra_op_thread_affinities = intra_op_thread_affinities;
+    if (onnx_x > 0)
     {
-      auto input_shapes = get_input_shapes();
-      std::cout << "Input Node Name/Shape (" << input_names.size()
-                << "):" << std::endl;
-      for (size_t i = 0; i < input_names.size(); i++)
-      {
-        std::cout << "\t" << input_names[i] << " : "
-                  << print_shape(input_shapes[i]) << std::endl;
-      }
+      fprintf(stdout, "Setting intra_op_num_threads to %d\n", onnx_x);
+    }
+    if (onnx_y > 0)
+    {
+      fprintf(stdout, "Setting inter_op_num_threads to %d\n", onnx_y);
+    }
+    if (onnx_disable_spinning)
+    {
+      fprintf(stdout, "Disabling intra-op thread spinning entirely\n");
+    }
+    if (onnx_disable_spinning_between_run)
+    {
+      fprintf(stdout, "Disabling intra-op thread spinning between runs\n");
     }
-    auto &output_names = output_names_;
+    if (!intra_op_thread_affinities.empty())
+    {
+      fprintf(stdout, "Setting intra op thread affinity as %s\n",
+              intra_op_thread_affinities.c_str());
+    }
+    return config;
+  }
+
+  void print_io_debug()
+  {
     if (ENV_PARAM(DEBUG_ONNX_TASK))
     {
-      auto output_shapes = get_output_shapes();
-      std::cout << "Output Node Name/Shape (" << output_names.size()
-                << "):" << std::endl;
-      for (size_t i = 0; i < output_names.size(); i++)
-      {
-        std::cout << "\t" << output_names[i] << " : "
-                  << print_shape(output_shapes[i]) << std::endl;
-      }
+      std::cout << session_.to_string();
     }
-    output_tensors =
-        session_->Run(Ort::RunOptions{nullptr}, input_node_names_.data(),
-                      input_tensors.data(), input_tensors.size(),
-                      output_node_names_.data(), output_node_names_.size());
   }
 
-protected:
   std::string model_name_;
-  Ort::Env env_;
-  Ort::SessionOptions session_options_;
-  std::unique_ptr<Ort::Session> session_;
+  vai_ep::Session session_;
+  vai_ep::Runner runner_;
   std::vector<std::vector<int64_t>> input_shapes_;
   std::vector<std::vector<int64_t>> output_shapes_;
+  bool dynamic_batch_ = false;
+  StageTimes stage_times_;
   std::vector<std::string> input_names_;
   std::vector<std::string> output_names_;
-  // std::vector<Ort::Value> input_tensors_;
-  // std::vector<Ort::Value> output_tensors_;
-  std::vector<Ort::AllocatedStringPtr> input_names_ptr_;
-  std::vector<const char *> input_node_names_;
-  std::vector<Ort::AllocatedStringPtr> output_names_ptr_;
-  std::vector<const char *> output_node_names_;
 };
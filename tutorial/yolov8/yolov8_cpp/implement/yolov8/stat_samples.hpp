@@ -37,6 +37,10 @@ class StatSamples {
  public:
   double getMean();
   double getStdVar(const double mean);
+  // p in [0, 100], the nearest rank value
+  int getPercentile(double p);
+  int getMax();
+  size_t size() const { return store_.size(); }
   void merge(StatSamples &statSamples);
 
  private:
@@ -58,6 +62,24 @@ inline double StatSamples::getStdVar(const double mean) {
   return std::sqrt(accum / store_.size());
 }
 
+inline int StatSamples::getPercentile(double p) {
+  if (store_.empty()) {
+    return 0;
+  }
+  auto rank = (size_t)std::ceil(p / 100.0 * store_.size());
+  rank = std::min(std::max<size_t>(rank, 1), store_.size());
+  auto nth = store_.begin() + (rank - 1);
+  std::nth_element(store_.begin(), nth, store_.end());
+  return *nth;
+}
+
+inline int StatSamples::getMax() {
+  if (store_.empty()) {
+    return 0;
+  }
+  return *std::max_element(store_.begin(), store_.end());
+}
+
 inline void StatSamples::merge(StatSamples &statSamples) {
   store_.insert(store_.end(), statSamples.store_.begin(),
                 statSamples.store_.end());
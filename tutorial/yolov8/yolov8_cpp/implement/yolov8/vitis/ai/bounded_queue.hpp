@@ -20,26 +20,51 @@
 
 namespace vitis {
 namespace ai {
+/**
+ * What a push does when the queue is full.
+ * BLOCK waits for room, DROP_OLDEST removes the first element to make room
+ * and DROP_NEWEST discards the pushed value. The dropping policies never
+ * block, so a live source keeps the queue at most capacity old.
+ */
+enum class QueuePolicy { BLOCK, DROP_OLDEST, DROP_NEWEST };
+
 /**
  * A thread safe queue with a size limit.
- * It will block on push if full, and on pop if empty.
+ * It will block on push if full, unless the policy drops, and on pop if
+ * empty.
  */
 template <typename T>
 class BoundedQueue : public SharedQueue<T> {
  public:
-  explicit BoundedQueue(std::size_t capacity) : capacity_(capacity) {}
+  explicit BoundedQueue(std::size_t capacity,
+                        QueuePolicy policy = QueuePolicy::BLOCK)
+      : capacity_(capacity), policy_(policy), dropped_(0) {}
 
   /**
    * Return the maxium size of the queue.
    */
   std::size_t capacity() const { return this->capacity_; }
 
+  QueuePolicy policy() const { return this->policy_; }
+
+  /**
+   * Return the number of values dropped by the policy so far.
+   */
+  std::size_t dropped() const {
+    std::lock_guard<std::mutex> lock(this->mtx_);
+    return this->dropped_;
+  }
+
   /**
    * Copy the value to the end of this queue.
-   * This is blocking.
+   * This is blocking, unless the policy drops.
    */
   void push(const T& new_value) override {
     std::unique_lock<std::mutex> lock(this->mtx_);
+    if (this->policy_ != QueuePolicy::BLOCK) {
+      this->drop_push(new_value);
+      return;
+    }
     this->cond_not_full_.wait(
         lock, [this]() { return this->internal_size() < this->capacity_; });
     this->internal_push(new_value);
@@ -49,9 +74,14 @@ class BoundedQueue : public SharedQueue<T> {
   /**
    * Copy the value to the end of this queue.
    * This will fail and return false if blocked for more than rel_time.
+   * With a dropping policy it never fails, the value is taken or dropped.
    */
   bool push(const T& new_value, const std::chrono::milliseconds& rel_time) {
     std::unique_lock<std::mutex> lock(this->mtx_);
+    if (this->policy_ != QueuePolicy::BLOCK) {
+      this->drop_push(new_value);
+      return true;
+    }
     if (this->cond_not_full_.wait_for(lock, rel_time, [this]() {
           return this->internal_size() < this->capacity_;
         }) == false) {
@@ -158,7 +188,23 @@ class BoundedQueue : public SharedQueue<T> {
   }
 
  protected:
+  // push of a dropping policy, the lock is held
+  void drop_push(const T& new_value) {
+    if (this->internal_size() >= this->capacity_) {
+      this->dropped_++;
+      if (this->policy_ == QueuePolicy::DROP_NEWEST) {
+        return;
+      }
+      T oldest;
+      this->internal_pop(oldest);
+    }
+    this->internal_push(new_value);
+    this->cond_not_empty_.notify_one();
+  }
+
   std::size_t capacity_;
+  QueuePolicy policy_;
+  std::size_t dropped_;
 
   std::condition_variable cond_not_full_;
 };
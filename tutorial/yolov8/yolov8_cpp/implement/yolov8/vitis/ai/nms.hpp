@@ -0,0 +1,207 @@
+/*
+ * Copyright 2022-2023 Advanced Micro Devices Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vitis {
+namespace ai {
+/**
+ * The boxes of a frame, struct of arrays with the corners in pixels.
+ */
+struct NmsBoxes {
+  std::vector<float> x1;
+  std::vector<float> y1;
+  std::vector<float> x2;
+  std::vector<float> y2;
+  std::vector<float> score;
+  std::vector<int> label;
+
+  std::size_t size() const { return score.size(); }
+  bool empty() const { return score.empty(); }
+
+  void clear() {
+    x1.clear();
+    y1.clear();
+    x2.clear();
+    y2.clear();
+    score.clear();
+    label.clear();
+  }
+
+  void reserve(std::size_t n) {
+    x1.reserve(n);
+    y1.reserve(n);
+    x2.reserve(n);
+    y2.reserve(n);
+    score.reserve(n);
+    label.reserve(n);
+  }
+
+  void push_back(float box_x1, float box_y1, float box_x2, float box_y2,
+                 int box_label, float box_score) {
+    x1.push_back(box_x1);
+    y1.push_back(box_y1);
+    x2.push_back(box_x2);
+    y2.push_back(box_y2);
+    label.push_back(box_label);
+    score.push_back(box_score);
+  }
+};
+
+/**
+ * Greedy per class non maximum suppression.
+ *
+ * All the classes go through a single pass, the boxes of a class are moved
+ * by label * span so they never overlap the boxes of another class. The
+ * IoU of a kept box against the remaining ones is a branch free loop over
+ * contiguous arrays that the compiler vectorizes, and the pass stops once
+ * max_out boxes are kept. A box is suppressed when its IoU with a kept box
+ * of the same class is >= iou_thresh.
+ *
+ * The work arrays are members, so reuse one Nms per thread.
+ */
+class Nms {
+ public:
+  /**
+   * Writes to keep the indices into boxes that survive, by descending
+   * score.
+   */
+  void run(const NmsBoxes& boxes, float iou_thresh, std::size_t max_out,
+           std::vector<std::size_t>& keep) {
+    frames_.assign(1, &boxes);
+    keeps_.resize(1);
+    suppress(iou_thresh, max_out);
+    keep.swap(keeps_[0]);
+  }
+
+  /**
+   * The same as run() for the frames of a batch in one pass, the frames
+   * are moved apart like the classes. max_out applies to each frame.
+   */
+  void run_batch(const std::vector<const NmsBoxes*>& frames, float iou_thresh,
+                 std::size_t max_out,
+                 std::vector<std::vector<std::size_t>>& keeps) {
+    frames_ = frames;
+    keeps_.resize(frames_.size());
+    suppress(iou_thresh, max_out);
+    keeps.resize(frames_.size());
+    for (std::size_t f = 0; f < frames_.size(); ++f) {
+      keeps[f].swap(keeps_[f]);
+    }
+  }
+
+ private:
+  struct Entry {
+    float score;
+    int frame;
+    std::size_t index;
+  };
+
+  void suppress(float iou_thresh, std::size_t max_out) {
+    for (auto& keep : keeps_) {
+      keep.clear();
+    }
+    entries_.clear();
+    float min_coord = 0.0f;
+    float max_coord = 0.0f;
+    int labels = 1;
+    for (std::size_t f = 0; f < frames_.size(); ++f) {
+      const auto& boxes = *frames_[f];
+      for (std::size_t i = 0; i < boxes.size(); ++i) {
+        entries_.push_back(Entry{boxes.score[i], (int)f, i});
+        min_coord = std::min({min_coord, boxes.x1[i], boxes.y1[i]});
+        max_coord = std::max({max_coord, boxes.x2[i], boxes.y2[i]});
+        labels = std::max(labels, boxes.label[i] + 1);
+      }
+    }
+    if (entries_.empty() || max_out == 0) {
+      return;
+    }
+    std::stable_sort(entries_.begin(), entries_.end(),
+                     [](const Entry& lhs, const Entry& rhs) {
+                       return lhs.score > rhs.score;
+                     });
+
+    auto n = entries_.size();
+    x1_.resize(n);
+    y1_.resize(n);
+    x2_.resize(n);
+    y2_.resize(n);
+    area_.resize(n);
+    removed_.assign(n, 0);
+    auto span = max_coord - min_coord + 1.0f;
+    for (std::size_t k = 0; k < n; ++k) {
+      const auto& e = entries_[k];
+      const auto& boxes = *frames_[e.frame];
+      auto offset = (float)(e.frame * labels + boxes.label[e.index]) * span;
+      x1_[k] = boxes.x1[e.index] + offset;
+      y1_[k] = boxes.y1[e.index] + offset;
+      x2_[k] = boxes.x2[e.index] + offset;
+      y2_[k] = boxes.y2[e.index] + offset;
+      area_[k] = (x2_[k] - x1_[k]) * (y2_[k] - y1_[k]);
+    }
+
+    std::size_t full = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      if (removed_[i]) {
+        continue;
+      }
+      auto& keep = keeps_[entries_[i].frame];
+      if (keep.size() >= max_out) {
+        continue;
+      }
+      keep.push_back(entries_[i].index);
+      if (keep.size() == max_out && ++full == frames_.size()) {
+        break;
+      }
+      const auto ix1 = x1_[i];
+      const auto iy1 = y1_[i];
+      const auto ix2 = x2_[i];
+      const auto iy2 = y2_[i];
+      const auto iarea = area_[i];
+      const float* x1 = x1_.data();
+      const float* y1 = y1_.data();
+      const float* x2 = x2_.data();
+      const float* y2 = y2_.data();
+      const float* area = area_.data();
+      std::uint8_t* removed = removed_.data();
+      for (std::size_t j = i + 1; j < n; ++j) {
+        auto w = std::max(0.0f, std::min(ix2, x2[j]) - std::max(ix1, x1[j]));
+        auto h = std::max(0.0f, std::min(iy2, y2[j]) - std::max(iy1, y1[j]));
+        auto inter = w * h;
+        auto overlapped = (inter > 0.0f) &
+                          (inter >= iou_thresh * (iarea + area[j] - inter));
+        removed[j] |= (std::uint8_t)overlapped;
+      }
+    }
+  }
+
+  std::vector<const NmsBoxes*> frames_;
+  std::vector<std::vector<std::size_t>> keeps_;
+  std::vector<Entry> entries_;
+  std::vector<float> x1_;
+  std::vector<float> y1_;
+  std::vector<float> x2_;
+  std::vector<float> y2_;
+  std::vector<float> area_;
+  std::vector<std::uint8_t> removed_;
+};
+}  // namespace ai
+}  // namespace vitis
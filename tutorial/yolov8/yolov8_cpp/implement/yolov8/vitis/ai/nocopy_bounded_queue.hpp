@@ -20,28 +20,47 @@
 #include <memory>
 #include <mutex>
 
+#include "bounded_queue.hpp"
+
 namespace vitis {
 namespace ai {
 /**
  * A thread safe, bounded queue that stores std::unique_ptr.
  * This saves the work to copy object at push/pop.
+ * The policy works like the one of BoundedQueue.
  */
 template <typename T>
 class NoCopyBoundedQueue {
  public:
-  explicit NoCopyBoundedQueue(std::size_t capacity) : capacity_(capacity) {}
+  explicit NoCopyBoundedQueue(std::size_t capacity,
+                              QueuePolicy policy = QueuePolicy::BLOCK)
+      : capacity_(capacity), policy_(policy), dropped_(0) {}
 
   /**
    * Return the maxium size of the queue.
    */
   std::size_t capacity() const { return this->capacity_; }
 
+  QueuePolicy policy() const { return this->policy_; }
+
+  /**
+   * Return the number of values dropped by the policy so far.
+   */
+  std::size_t dropped() const {
+    std::lock_guard<std::mutex> lock(this->mtx_);
+    return this->dropped_;
+  }
+
   /**
    * Move the value to the end of this queue.
-   * This is blocking.
+   * This is blocking, unless the policy drops.
    */
   void push(std::unique_ptr<T> new_value) {
     std::unique_lock<std::mutex> lock(this->mtx_);
+    if (this->policy_ != QueuePolicy::BLOCK) {
+      this->drop_push(std::move(new_value));
+      return;
+    }
     this->cond_not_full_.wait(
         lock, [this]() { return this->internal_size() < this->capacity_; });
     this->internal_push(std::move(new_value));
@@ -51,10 +70,15 @@ class NoCopyBoundedQueue {
   /**
    * Move the value to the end of this queue.
    * This will fail and return false if blocked for more than rel_time.
+   * With a dropping policy it never fails, the value is taken or dropped.
    */
   bool push(std::unique_ptr<T> new_value,
             const std::chrono::milliseconds& rel_time) {
     std::unique_lock<std::mutex> lock(this->mtx_);
+    if (this->policy_ != QueuePolicy::BLOCK) {
+      this->drop_push(std::move(new_value));
+      return true;
+    }
     if (this->cond_not_full_.wait_for(lock, rel_time, [this]() {
           return this->internal_size() < this->capacity_;
         }) == false) {
@@ -162,6 +186,19 @@ class NoCopyBoundedQueue {
   }
 
  protected:
+  // push of a dropping policy, the lock is held
+  void drop_push(std::unique_ptr<T> new_value) {
+    if (this->internal_size() >= this->capacity_) {
+      this->dropped_++;
+      if (this->policy_ == QueuePolicy::DROP_NEWEST) {
+        return;
+      }
+      this->internal_pop();
+    }
+    this->internal_push(std::move(new_value));
+    this->cond_not_empty_.notify_one();
+  }
+
   inline virtual std::size_t internal_size() const {
     return this->internal_.size();
   }
@@ -176,6 +213,8 @@ class NoCopyBoundedQueue {
   }
   mutable std::mutex mtx_;
   std::size_t capacity_;
+  QueuePolicy policy_;
+  std::size_t dropped_;
   std::deque<std::unique_ptr<T>> internal_;
 
   mutable std::condition_variable cond_not_empty_;
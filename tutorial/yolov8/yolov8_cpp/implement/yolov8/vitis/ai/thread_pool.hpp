@@ -15,18 +15,38 @@
  * limitations under the License.
  */
 
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <functional>
 #include <future>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
-#include "./erl_msg_box.hpp"
 namespace vitis {
 namespace ai {
+/**
+ * A work stealing thread pool.
+ *
+ * Every worker owns a deque of tasks. A task submitted from a worker goes to
+ * its own deque, others are dealt round robin. A worker runs the tasks of its
+ * deque in submission order and steals from the back of the other deques when
+ * it runs out. Tasks are stored in place in the deques, which only allocate
+ * when they grow, so a task costs no allocation besides the shared state of
+ * its future.
+ */
 class ThreadPool {
  public:
-  static std::unique_ptr<ThreadPool> create(size_t num_of_threads);
+  static std::unique_ptr<ThreadPool> create(size_t num_of_threads) {
+    return std::unique_ptr<ThreadPool>(new ThreadPool(num_of_threads));
+  }
 #if __cplusplus > 201700
   template <class Function, class... Args>
   using result_t =
@@ -44,33 +64,216 @@ class ThreadPool {
     std::packaged_task<result_t<Function, Args...>()> task(
         std::bind(std::forward<Function>(f), std::forward<Args>(args)...));
     std::future<result_t<Function, Args...>> ret = task.get_future();
-    queue_.emplace_send(std::move(task));
+    push(Task(std::move(task)));
     return ret;
   }
-  ~ThreadPool();
 
- private:
-  explicit ThreadPool(size_t num_of_thread);
+  /// waits for the queued tasks, their futures stay valid
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleep_mtx_);
+      running_ = false;
+    }
+    wake_.notify_all();
+    for (auto& t : pool_) {
+      t.join();
+    }
+  }
 
  private:
-  static void thread_main(ThreadPool* self);
+  /// a packaged_task<R()> of any R, stored in place
+  class Task {
+   public:
+    Task() = default;
+    template <class R>
+    explicit Task(std::packaged_task<R()>&& task) {
+      using task_t = std::packaged_task<R()>;
+      static_assert(sizeof(task_t) <= sizeof(storage_) &&
+                        alignof(task_t) <= alignof(storage_t),
+                    "packaged_task does not fit the task storage");
+      new (&storage_) task_t(std::move(task));
+      ops_ = ops_of<task_t>();
+    }
+    Task(Task&& other) noexcept { move_from(other); }
+    Task& operator=(Task&& other) noexcept {
+      if (this != &other) {
+        reset();
+        move_from(other);
+      }
+      return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { reset(); }
 
- private:
-  std::vector<std::thread> pool_;
-  vitis::ai::ErlMsgBox<std::packaged_task<void()>> queue_;
-  int running_;
+    void operator()() { ops_->run(&storage_); }
 
- private:
-  /// thanks akk
-  /// https://stackoverflow.com/questions/20843271/passing-a-non-copyable-closure-object-to-stdfunction-parameter
-  template <class F>
-  auto make_copyable_function(F&& f) {
-    using dF = std::decay_t<F>;
-    auto spf = std::make_shared<dF>(std::forward<F>(f));
-    return [spf](auto&&... args) -> decltype(auto) {
-      return (*spf)(decltype(args)(args)...);
+   private:
+    struct Ops {
+      void (*run)(void*);
+      void (*move)(void* dst, void* src);
+      void (*destroy)(void*);
     };
+    template <class T>
+    static void run_of(void* p) {
+      (*static_cast<T*>(p))();
+    }
+    template <class T>
+    static void move_of(void* dst, void* src) {
+      new (dst) T(std::move(*static_cast<T*>(src)));
+    }
+    template <class T>
+    static void destroy_of(void* p) {
+      static_cast<T*>(p)->~T();
+    }
+    template <class T>
+    static const Ops* ops_of() {
+      static const Ops ops = {&run_of<T>, &move_of<T>, &destroy_of<T>};
+      return &ops;
+    }
+
+    void move_from(Task& other) noexcept {
+      ops_ = other.ops_;
+      if (ops_) {
+        ops_->move(&storage_, &other.storage_);
+        other.reset();
+      }
+    }
+    void reset() noexcept {
+      if (ops_) {
+        ops_->destroy(&storage_);
+        ops_ = nullptr;
+      }
+    }
+
+    using storage_t = std::aligned_storage_t<64, alignof(std::max_align_t)>;
+    storage_t storage_;
+    const Ops* ops_ = nullptr;
+  };
+
+  /// ring buffer of tasks, grows by doubling and never shrinks
+  class WorkQueue {
+   public:
+    void push_back(Task&& task) {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (size_ == ring_.size()) {
+        grow();
+      }
+      ring_[(head_ + size_) & (ring_.size() - 1)] = std::move(task);
+      ++size_;
+    }
+    bool pop_front(Task& task) {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (size_ == 0) {
+        return false;
+      }
+      task = std::move(ring_[head_]);
+      head_ = (head_ + 1) & (ring_.size() - 1);
+      --size_;
+      return true;
+    }
+    bool steal_back(Task& task) {
+      std::unique_lock<std::mutex> lock(mtx_, std::try_to_lock);
+      if (!lock.owns_lock() || size_ == 0) {
+        return false;
+      }
+      --size_;
+      task = std::move(ring_[(head_ + size_) & (ring_.size() - 1)]);
+      return true;
+    }
+
+   private:
+    void grow() {
+      std::vector<Task> ring(std::max<size_t>(16u, ring_.size() * 2));
+      for (size_t i = 0; i < size_; ++i) {
+        ring[i] = std::move(ring_[(head_ + i) & (ring_.size() - 1)]);
+      }
+      ring_.swap(ring);
+      head_ = 0;
+    }
+
+    std::mutex mtx_;
+    std::vector<Task> ring_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+  };
+
+  explicit ThreadPool(size_t num_of_thread)
+      : queues_(std::max<size_t>(1u, num_of_thread)) {
+    pool_.reserve(queues_.size());
+    for (size_t i = 0; i < queues_.size(); ++i) {
+      pool_.emplace_back(&ThreadPool::thread_main, this, i);
+    }
+  }
+
+  /// the pool & the index of the worker running on this thread
+  static std::pair<const ThreadPool*, size_t>& current_worker() {
+    thread_local std::pair<const ThreadPool*, size_t> worker{nullptr, 0u};
+    return worker;
+  }
+
+  void push(Task&& task) {
+    const auto& worker = current_worker();
+    size_t index = worker.first == this
+                       ? worker.second
+                       : next_.fetch_add(1, std::memory_order_relaxed) %
+                             queues_.size();
+    queues_[index].push_back(std::move(task));
+    pending_.fetch_add(1, std::memory_order_release);
+    {
+      // a worker checks pending_ & goes to sleep under the lock
+      std::lock_guard<std::mutex> lock(sleep_mtx_);
+    }
+    wake_.notify_one();
+  }
+
+  bool pop(size_t index, Task& task) {
+    if (queues_[index].pop_front(task)) {
+      return true;
+    }
+    for (size_t i = 1; i < queues_.size(); ++i) {
+      if (queues_[(index + i) % queues_.size()].steal_back(task)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static void thread_main(ThreadPool* self, size_t index) {
+    current_worker() = {self, index};
+    Task task;
+    while (true) {
+      if (self->pop(index, task)) {
+        self->pending_.fetch_sub(1, std::memory_order_relaxed);
+        task();
+        task = Task();
+        continue;
+      }
+      if (self->pending_.load(std::memory_order_acquire) != 0) {
+        // queued but not yet visible, or a steal lost a try_lock
+        std::this_thread::yield();
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(self->sleep_mtx_);
+      self->wake_.wait(lock, [self] {
+        return self->pending_.load(std::memory_order_acquire) != 0 ||
+               !self->running_;
+      });
+      if (!self->running_ &&
+          self->pending_.load(std::memory_order_acquire) == 0) {
+        return;
+      }
+    }
   }
+
+ private:
+  std::vector<WorkQueue> queues_;
+  std::vector<std::thread> pool_;
+  std::atomic<size_t> next_{0u};
+  std::atomic<size_t> pending_{0u};
+  std::mutex sleep_mtx_;
+  std::condition_variable wake_;
+  bool running_ = true;
 };
 }  // namespace ai
 }  // namespace vitis
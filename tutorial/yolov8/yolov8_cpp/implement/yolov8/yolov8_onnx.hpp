@@ -20,6 +20,7 @@
 #include <opencv2/imgproc/imgproc_c.h>
 
 #include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <numeric> //accumulate
@@ -28,171 +29,138 @@
 #include <vector>
 
 #include "onnx_task.hpp"
+#include "vitis/ai/nms.hpp"
 #include "vitis/ai/profiling.hpp"
 
 DEF_ENV_PARAM(ENABLE_YOLO_DEBUG, "0");
+// defaults of set_tiling()
+DEF_ENV_PARAM(YOLOV8_TILING, "0");
+DEF_ENV_PARAM(YOLOV8_TILE_OVERLAP, "64");
+DEF_ENV_PARAM(YOLOV8_TILE_SKIP_DIFF, "0");
 
 using namespace std;
 using namespace cv;
 
-static float overlap(float x1, float w1, float x2, float w2)
+// Letterbox the BGR image into the RGB CHW tensor in one pass: the
+// bilinear resize (half pixel centers like cv::INTER_LINEAR), the gray
+// padding, the BGR->RGB swap and the /255 are all done per output pixel.
+// convert maps the float pixels to the element type of the tensor, it
+// quantizes them for a model taking an int8/uint8 input.
+template <typename T, typename Convert>
+static void letterbox_to_tensor(const cv::Mat &input_image, T *data,
+                                Convert convert, const int height,
+                                const int width, float &scale, int &left,
+                                int &top)
 {
-  float left = max(x1 - w1 / 2.0, x2 - w2 / 2.0);
-  float right = min(x1 + w1 / 2.0, x2 + w2 / 2.0);
-  return right - left;
-}
-
-static float cal_iou(vector<float> box, vector<float> truth)
-{
-  float w = overlap(box[0], box[2], truth[0], truth[2]);
-  float h = overlap(box[1], box[3], truth[1], truth[3]);
-  if (w < 0 || h < 0)
-    return 0;
-
-  float inter_area = w * h;
-  float union_area = box[2] * box[3] + truth[2] * truth[3] - inter_area;
-  return inter_area * 1.0 / union_area;
-}
-
-static void applyNMS(const vector<vector<float>> &boxes,
-                     const vector<float> &scores, const float nms,
-                     const float conf, vector<size_t> &res)
-{
-  const size_t count = boxes.size();
-  vector<pair<float, size_t>> order;
-  for (size_t i = 0; i < count; ++i)
-  {
-    order.push_back({scores[i], i});
-  }
-  stable_sort(order.begin(), order.end(),
-              [](const pair<float, size_t> &ls, const pair<float, size_t> &rs)
-              {
-                return ls.first > rs.first;
-              });
-  vector<size_t> ordered;
-  transform(order.begin(), order.end(), back_inserter(ordered),
-            [](auto &km)
-            { return km.second; });
-  vector<bool> exist_box(count, true);
-
-  for (size_t _i = 0; _i < count; ++_i)
-  {
-    size_t i = ordered[_i];
-    if (!exist_box[i])
-      continue;
-    if (scores[i] < conf)
-    {
-      exist_box[i] = false;
-      continue;
-    }
-    /* add a box as result */
-    res.push_back(i);
-    // cout << "nms push "<< i<<endl;
-    for (size_t _j = _i + 1; _j < count; ++_j)
-    {
-      size_t j = ordered[_j];
-      if (!exist_box[j])
-        continue;
-      float ovr = 0.0;
-      ovr = cal_iou(boxes[j], boxes[i]);
-      if (ovr >= nms)
-        exist_box[j] = false;
-    }
-  }
-}
-
-static void letterbox(const cv::Mat input_image, cv::Mat &output_image,
-                      const int height, const int width, float &scale,
-                      int &left, int &top)
-{
-  cv::Mat image_tmp;
-
   scale = std::min(float(width) / input_image.cols,
                    float(height) / input_image.rows);
   scale = std::min(scale, 1.0f);
   int unpad_w = round(input_image.cols * scale);
   int unpad_h = round(input_image.rows * scale);
-  image_tmp = input_image.clone();
-
-  if (input_image.size() != cv::Size(unpad_w, unpad_h))
-  {
-    cv::resize(input_image, image_tmp, cv::Size(unpad_w, unpad_h),
-               cv::INTER_LINEAR);
-  }
 
   float dw = (width - unpad_w) / 2.0f;
   float dh = (height - unpad_h) / 2.0f;
-
   top = round(dh - 0.1);
-  int bottom = round(dh + 0.1);
   left = round(dw - 0.1);
-  int right = round(dw + 0.1);
-
-  cv::copyMakeBorder(image_tmp, output_image, top, bottom, left, right,
-                     cv::BORDER_CONSTANT, cv::Scalar(114, 114, 114));
-  return;
-}
 
-static vector<float> softmax(const std::vector<float> &input)
-{
-  auto output = std::vector<float>(input.size());
-  std::transform(input.begin(), input.end(), output.begin(), expf);
-  auto sum = accumulate(output.begin(), output.end(), 0.0f, std::plus<float>());
-  std::transform(output.begin(), output.end(), output.begin(),
-                 [sum](float v)
-                 { return v / sum; });
-  return output;
-}
+  const float norm = 1.0f / 255.0f;
+  const T pad = convert(114.0f * norm);
+  const int plane = height * width;
+  T *planes[3] = {data, data + plane, data + 2 * plane};
+  for (int c = 0; c < 3; c++)
+  {
+    std::fill(planes[c], planes[c] + plane, pad);
+  }
 
-static vector<float> conv(const vector<vector<float>> &input)
-{
-  // input size is 4 x 16
-  // kernel is 16 x 1, value is 0,1,...,15
-  vector<float> output(4, 0.0f);
+  // source columns and weights of the output columns, reused by the rows
+  thread_local std::vector<int> x0s;
+  thread_local std::vector<int> x1s;
+  thread_local std::vector<float> fxs;
+  x0s.resize(unpad_w);
+  x1s.resize(unpad_w);
+  fxs.resize(unpad_w);
+  float inv_x = float(input_image.cols) / unpad_w;
+  float inv_y = float(input_image.rows) / unpad_h;
+  for (int x = 0; x < unpad_w; x++)
+  {
+    float sx = std::max((x + 0.5f) * inv_x - 0.5f, 0.0f);
+    int x0 = std::min((int)sx, input_image.cols - 1);
+    x0s[x] = x0 * 3;
+    x1s[x] = std::min(x0 + 1, input_image.cols - 1) * 3;
+    fxs[x] = std::min(sx - x0, 1.0f);
+  }
 
-  for (int row = 0; row < 4; row++)
+  for (int y = 0; y < unpad_h; y++)
   {
-    for (int col = 0; col < 16; col++)
+    float sy = std::max((y + 0.5f) * inv_y - 0.5f, 0.0f);
+    int y0 = std::min((int)sy, input_image.rows - 1);
+    int y1 = std::min(y0 + 1, input_image.rows - 1);
+    float fy = std::min(sy - y0, 1.0f);
+    const uchar *row0 = input_image.ptr<uchar>(y0);
+    const uchar *row1 = input_image.ptr<uchar>(y1);
+    int offset = (y + top) * width + left;
+    for (int x = 0; x < unpad_w; x++)
     {
-      output[row] += input[row][col] * col;
+      const uchar *p00 = row0 + x0s[x];
+      const uchar *p01 = row0 + x1s[x];
+      const uchar *p10 = row1 + x0s[x];
+      const uchar *p11 = row1 + x1s[x];
+      float fx = fxs[x];
+      for (int c = 0; c < 3; c++)
+      {
+        float v0 = p00[c] + (p01[c] - p00[c]) * fx;
+        float v1 = p10[c] + (p11[c] - p10[c]) * fx;
+        // BGR->RGB
+        planes[2 - c][offset + x] = convert((v0 + (v1 - v0) * fy) * norm);
+      }
     }
   }
-  return output;
 }
 
-static vector<vector<float>> make_anchors(int w, int h)
+// Origins of the tiles of size tile covering [0, len), overlapping by at
+// least overlap, spread evenly with the last one on the end
+static std::vector<int> tile_origins(int len, int tile, int overlap)
 {
-  vector<vector<float>> anchor_points;
-  anchor_points.reserve(w * h);
-  for (int i = 0; i < w; ++i)
+  if (len <= tile)
   {
-    float sy = i + 0.5f;
-    for (int j = 0; j < h; ++j)
-    {
-      float sx = j + 0.5f;
-      vector<float> anchor(2);
-      anchor[0] = sx;
-      anchor[1] = sy;
-      anchor_points.emplace_back(anchor);
-    }
+    return {0};
   }
-  return anchor_points;
+  int step = std::max(tile - overlap, 1);
+  int n = (len - overlap + step - 1) / step;
+  n = std::max(n, 2);
+  std::vector<int> origins(n);
+  for (int i = 0; i < n; i++)
+  {
+    origins[i] = (int)((int64_t)i * (len - tile) / (n - 1));
+  }
+  return origins;
+}
+
+// Mean absolute difference of two 8 bit images of the same size
+static float mean_abs_diff(const cv::Mat &a, const cv::Mat &b)
+{
+  auto sum = cv::norm(a, b, cv::NORM_L1);
+  return (float)(sum / std::max<size_t>(a.total() * a.channels(), 1));
 }
 
-static vector<float> dist2bbox(const vector<float> &distance,
-                               const vector<float> &point, const float stride)
+// Expected value of the softmax over the 16 DFL bins of a box side, the
+// bins of a cell are plane apart in the output tensor
+static float dfl_distance(const float *bins, int plane)
 {
-  vector<float> box;
-  box.resize(4);
-  float x1 = point[0] - distance[0];
-  float y1 = point[1] - distance[1];
-  float x2 = point[0] + distance[2];
-  float y2 = point[1] + distance[3];
-  box[0] = (x1 + x2) / 2.0f * stride; // x_c
-  box[1] = (y1 + y2) / 2.0f * stride; // y_c
-  box[2] = (x2 - x1) * stride;        // width
-  box[3] = (y2 - y1) * stride;        // height
-  return box;
+  float max_value = bins[0];
+  for (int k = 1; k < 16; k++)
+  {
+    max_value = std::max(max_value, bins[k * plane]);
+  }
+  float sum = 0.0f;
+  float acc = 0.0f;
+  for (int k = 0; k < 16; k++)
+  {
+    float e = expf(bins[k * plane] - max_value);
+    sum += e;
+    acc += e * k;
+  }
+  return acc / sum;
 }
 
 // return value
@@ -237,7 +205,21 @@ public:
   virtual std::vector<Yolov8OnnxResult> run(const std::vector<cv::Mat> &mats);
   virtual Yolov8OnnxResult run(const cv::Mat &mats);
 
+  // Tiled inference of the frames larger than the model input, instead of
+  // letterboxing them down to it. A frame is split into tiles of the input
+  // size at full resolution, overlapping by at least overlap pixels, plus
+  // the letterboxed frame for the objects larger than a tile. The tiles of
+  // all the frames of run() are batched into the same session runs and the
+  // detections of the tiles of a frame are merged by NMS.
+  // With skip_diff > 0, a tile whose mean absolute difference to the same
+  // tile the last time it ran is below skip_diff (in gray levels) is not
+  // run again, its detections are reused. The frames at index i of the
+  // runs are compared, i.e. index i should be the same camera or video.
+  void set_tiling(bool enable, int overlap = 64, int skip_diff = 0);
+
 private:
+  std::vector<Yolov8OnnxResult> run_untiled(const std::vector<cv::Mat> &mats);
+  std::vector<Yolov8OnnxResult> run_tiled(const std::vector<cv::Mat> &mats);
   std::vector<Yolov8OnnxResult> postprocess();
   Yolov8OnnxResult postprocess(int idx);
   void preprocess(const cv::Mat &image, int idx, float &scale, int &left,
@@ -245,9 +227,8 @@ private:
   void preprocess(const std::vector<cv::Mat> &mats);
 
 private:
-  std::vector<float> input_tensor_values;
-  std::vector<Ort::Value> input_tensors;
-  std::vector<Ort::Value> output_tensors;
+  // float, or int8/uint8 for a quantized input
+  vai_ep::InputBuffer input_tensor_values;
 
   int real_batch;
   int batch_size;
@@ -262,28 +243,58 @@ private:
   float nms_thresh = 0.7f;
   int num_classes = 80;
   int max_nms_num = 300;
-  int max_boxes_num = 30000;
 
   vector<float> scales;
   vector<int> left;
   vector<int> top;
+
+  // reused by the frames
+  vector<float> max_scores;
+  vitis::ai::NmsBoxes candidates;
+  vitis::ai::Nms nms;
+  vector<size_t> kept;
+
+  bool tiling = false;
+  int tile_overlap = 64;
+  int tile_skip_diff = 0;
+  // the tiles of the frames at an index of run(), with the detections and
+  // a quarter scale copy of the pixels of their last run
+  struct Tile
+  {
+    cv::Rect rect;
+    cv::Mat thumb;
+    vector<Yolov8OnnxResult::BoundingBox> bboxes;
+  };
+  vector<vector<Tile>> channel_tiles;
 };
 
+static int calculate_product(const std::vector<int64_t> &v)
+{
+  int total = 1;
+  for (auto &i : v)
+    total *= (int)i;
+  return total;
+}
+
 void Yolov8Onnx::preprocess(const cv::Mat &image, int idx, float &scale,
                             int &left, int &top)
 {
-  cv::Mat resized_image;
-  letterbox(image, resized_image, sHeight, sWidth, scale, left, top);
-  set_input_image_rgb(resized_image,
-                      input_tensor_values.data() + batch_size * idx,
-                      std::vector<float>{0, 0, 0},
-                      std::vector<float>{0.00392157, 0.00392157, 0.00392157});
+  input_tensor_values.visit([&](auto *data, auto convert)
+                            { letterbox_to_tensor(image,
+                                                  data + batch_size * idx,
+                                                  convert, sHeight, sWidth,
+                                                  scale, left, top); });
   return;
 }
 
 // preprocess
 void Yolov8Onnx::preprocess(const std::vector<cv::Mat> &mats)
 {
+  if (dynamic_batch_)
+  {
+    input_shapes_[0][0] = (int64_t)mats.size();
+    input_tensor_values.resize(calculate_product(input_shapes_[0]));
+  }
   real_batch = std::min((int)input_shapes_[0][0], (int)mats.size());
   scales.resize(real_batch);
   left.resize(real_batch);
@@ -299,141 +310,90 @@ void Yolov8Onnx::preprocess(const std::vector<cv::Mat> &mats)
 inline float sigmoid(float src) { return (1.0f / (1.0f + exp(-src))); }
 
 // postprocess
+//
+// The max class score of each cell is found first, with loops over the
+// contiguous class planes, and the DFL box is only decoded for the cells
+// above the threshold.
 Yolov8OnnxResult Yolov8Onnx::postprocess(int idx)
 {
-  vector<vector<float>> boxes;
-  int count = 0;
-  vector<vector<vector<float>>> pre_output;
+  candidates.clear();
+  auto conf_desigmoid = -logf(1.0f / conf_thresh - 1.0f);
   __TIC__(DECODE)
   for (int i = 1; i < output_tensor_size; i++)
   {
-    int ca = output_shapes_[i][1];
-    int ha = output_shapes_[i][2];
-    int wa = output_shapes_[i][3];
+    const auto &output_shape = get_bound_output_shape(i);
+    int ca = output_shape[1];
+    int ha = output_shape[2];
+    int wa = output_shape[3];
     if (ENV_PARAM(ENABLE_YOLO_DEBUG))
     {
       LOG(INFO) << "channel=" << ca << ", height=" << ha << ", width=" << wa
                 << ", stride=" << stride[i] << ", conf=" << conf_thresh
                 << ", idx=" << idx << endl;
     }
-    auto anchor_points = make_anchors(wa, ha);
-    int sizeOut = wa * ha;
-
-    boxes.reserve(boxes.size() + sizeOut);
-    auto conf_desigmoid = -logf(1.0f / conf_thresh - 1.0f);
-    pre_output.reserve(pre_output.size() + sizeOut);
-#define POS(C) ((C) * ha * wa + h * wa + w)
-    for (int h = 0; h < ha; ++h)
+    int plane = ha * wa;
+    const float *base = output_tensor_ptr[i] + idx * ca * plane;
+    const float *cls = base + 64 * plane;
+    max_scores.assign(cls, cls + plane);
+    for (int m = 1; m < num_classes; ++m)
     {
-      for (int w = 0; w < wa; ++w)
+      const float *score = cls + m * plane;
+      for (int p = 0; p < plane; ++p)
       {
-        vector<vector<float>> pre_output_unit;
-        pre_output_unit.resize(4);
-
-        for (auto t = 0; t < 4; t++)
-        {
-          vector<float> softmax_;
-          softmax_.reserve(16);
-          for (auto m = 0; m < 16; m++)
-          {
-            float value =
-                output_tensor_ptr[i][POS(t * 16 + m) + idx * ca * wa * ha];
-            softmax_.emplace_back(value);
-          }
-          pre_output_unit[t] = softmax(softmax_);
-        }
-        auto distance = conv(pre_output_unit);
-        auto dbox = dist2bbox(distance, anchor_points[h * wa + w], stride[i]);
-        for (auto m = 0; m < num_classes; ++m)
+        max_scores[p] = std::max(max_scores[p], score[p]);
+      }
+    }
+    for (int p = 0; p < plane; ++p)
+    {
+      if (max_scores[p] <= conf_desigmoid)
+        continue;
+      float distance[4];
+      for (int t = 0; t < 4; t++)
+      {
+        distance[t] = dfl_distance(base + t * 16 * plane + p, plane);
+      }
+      // anchor at the center of the cell
+      float sx = p % wa + 0.5f;
+      float sy = p / wa + 0.5f;
+      float x1 = sx - distance[0];
+      float y1 = sy - distance[1];
+      float x2 = sx + distance[2];
+      float y2 = sy + distance[3];
+      for (int m = 0; m < num_classes; ++m)
+      {
+        auto score = cls[m * plane + p];
+        if (score > conf_desigmoid)
         {
-          auto score = output_tensor_ptr[i][POS(64 + m) + idx * ca * wa * ha];
-          if (score > conf_desigmoid)
-          {
-            count++;
-            vector<float> box(6);
-            for (int j = 0; j < 4; j++)
-            {
-              box[j] = dbox[j];
-            }
-            float cls_score = 1.0 / (1 + exp(-1.0f * score));
-            box[4] = m;
-            box[5] = cls_score;
-            boxes.emplace_back(box);
-          }
+          candidates.push_back(x1 * stride[i], y1 * stride[i], x2 * stride[i],
+                               y2 * stride[i], m, sigmoid(score));
         }
       }
     }
   }
   __TOC__(DECODE)
-  auto compare = [=](vector<float> &lhs, vector<float> &rhs)
-  {
-    return lhs[5] > rhs[5];
-  };
   if (ENV_PARAM(ENABLE_YOLO_DEBUG))
   {
-    LOG(INFO) << "boxes_total_size=" << boxes.size();
-  }
-  if (static_cast<int>(boxes.size()) > max_boxes_num)
-  {
-    std::partial_sort(boxes.begin(), boxes.begin() + max_boxes_num, boxes.end(),
-                      compare);
-    boxes.resize(max_boxes_num);
-  }
-  else
-  {
-    std::sort(boxes.begin(), boxes.end(), compare);
-  }
-
-  /* Apply the computation for NMS */
-  vector<vector<vector<float>>> boxes_for_nms(num_classes);
-  vector<vector<float>> scores(num_classes);
-
-  for (const auto &box : boxes)
-  {
-    boxes_for_nms[box[4]].push_back(box);
-    scores[box[4]].push_back(box[5]);
+    LOG(INFO) << "boxes_total_size=" << candidates.size();
   }
 
+  /* Apply the computation for NMS, the kept boxes are sorted by score */
   __TIC__(NMS)
-  vector<vector<float>> res;
-  for (auto i = 0; i < num_classes; i++)
-  {
-    vector<size_t> result_k;
-    applyNMS(boxes_for_nms[i], scores[i], nms_thresh, 0, result_k);
-    res.reserve(res.size() + result_k.size());
-    transform(result_k.begin(), result_k.end(), back_inserter(res),
-              [&](auto &k)
-              { return boxes_for_nms[i][k]; });
-  }
+  nms.run(candidates, nms_thresh, max_nms_num, kept);
   __TOC__(NMS)
 
-  if (static_cast<int>(res.size()) > max_nms_num)
-  {
-    __TIC__(PSORT)
-    std::partial_sort(res.begin(), res.begin() + max_nms_num, res.end(),
-                      compare);
-    __TOC__(PSORT)
-    res.resize(max_nms_num);
-  }
-  else
-  {
-    __TIC__(SORT)
-    std::sort(res.begin(), res.end(), compare);
-    __TOC__(SORT)
-  }
-
   __TIC__(BBOX)
   vector<Yolov8OnnxResult::BoundingBox> results;
-  for (const auto &r : res)
+  results.reserve(kept.size());
+  for (auto k : kept)
   {
     Yolov8OnnxResult::BoundingBox result;
-    result.score = r[5];
-    result.label = r[4];
+    result.score = candidates.score[k];
+    result.label = candidates.label[k];
     result.box.resize(4);
-    result.box[0] = (r[0] - r[2] / 2.0f - left[idx]) / scales[idx];
-    result.box[1] = (r[1] - r[3] / 2.0f - top[idx]) / scales[idx];
-    result.box[2] = result.box[0] + r[2] / scales[idx];
-    result.box[3] = result.box[1] + r[3] / scales[idx];
+    result.box[0] = (candidates.x1[k] - left[idx]) / scales[idx];
+    result.box[1] = (candidates.y1[k] - top[idx]) / scales[idx];
+    result.box[2] = (candidates.x2[k] - left[idx]) / scales[idx];
+    result.box[3] = (candidates.y2[k] - top[idx]) / scales[idx];
     results.push_back(result);
   }
   __TOC__(BBOX)
@@ -451,21 +411,19 @@ std::vector<Yolov8OnnxResult> Yolov8Onnx::postprocess()
   return ret;
 }
 
-static int calculate_product(const std::vector<int64_t> &v)
-{
-  int total = 1;
-  for (auto &i : v)
-    total *= (int)i;
-  return total;
-}
-
 Yolov8Onnx::Yolov8Onnx(const std::string &model_name, const float conf_thresh_)
     : OnnxTask(model_name)
 {
   int total_number_elements = calculate_product(input_shapes_[0]);
   // cout << total_number_elements << endl;
-  std::vector<float> input_tensor_values_(total_number_elements);
-  input_tensor_values_.swap(input_tensor_values);
+  input_tensor_values =
+      vai_ep::InputBuffer(session_, 0, total_number_elements);
+  if (input_tensor_values.quantized())
+  {
+    const auto &quant = *session_.input_quant(0);
+    LOG(INFO) << "quantized input, scale=" << quant.scale
+              << ", zero_point=" << quant.zero_point;
+  }
 
   channel = input_shapes_[0][1];
   sHeight = input_shapes_[0][2];
@@ -479,6 +437,16 @@ Yolov8Onnx::Yolov8Onnx(const std::string &model_name, const float conf_thresh_)
   input_tensor_ptr.resize(1);
   output_tensor_ptr.resize(output_tensor_size);
   conf_thresh = conf_thresh_;
+  set_tiling(ENV_PARAM(YOLOV8_TILING), ENV_PARAM(YOLOV8_TILE_OVERLAP),
+             ENV_PARAM(YOLOV8_TILE_SKIP_DIFF));
+}
+
+void Yolov8Onnx::set_tiling(bool enable, int overlap, int skip_diff)
+{
+  tiling = enable;
+  tile_overlap = std::max(0, std::min(overlap, std::min(sWidth, sHeight) / 2));
+  tile_skip_diff = std::max(0, skip_diff);
+  channel_tiles.clear();
 }
 
 Yolov8OnnxResult Yolov8Onnx::run(const cv::Mat &mats)
@@ -488,39 +456,178 @@ Yolov8OnnxResult Yolov8Onnx::run(const cv::Mat &mats)
 std::vector<Yolov8OnnxResult> Yolov8Onnx::run(
     const std::vector<cv::Mat> &mats)
 {
-  __TIC__(total)
-  __TIC__(preprocess)
-  preprocess(mats);
-  if (input_tensors.size())
+  if (tiling)
+  {
+    return run_tiled(mats);
+  }
+  return run_untiled(mats);
+}
+
+std::vector<Yolov8OnnxResult> Yolov8Onnx::run_tiled(
+    const std::vector<cv::Mat> &mats)
+{
+  channel_tiles.resize(std::max(channel_tiles.size(), mats.size()));
+  // the tiles to run, with their frame and tile index
+  std::vector<cv::Mat> tile_mats;
+  std::vector<std::pair<size_t, size_t>> tile_ids;
+  for (size_t i = 0; i < mats.size(); i++)
+  {
+    const auto &mat = mats[i];
+    std::vector<cv::Rect> rects{cv::Rect(0, 0, mat.cols, mat.rows)};
+    if (mat.cols > sWidth || mat.rows > sHeight)
+    {
+      for (int y : tile_origins(mat.rows, sHeight, tile_overlap))
+      {
+        for (int x : tile_origins(mat.cols, sWidth, tile_overlap))
+        {
+          rects.emplace_back(x, y, std::min(sWidth, mat.cols),
+                             std::min(sHeight, mat.rows));
+        }
+      }
+    }
+    auto &tiles = channel_tiles[i];
+    bool same_layout = tiles.size() == rects.size();
+    for (size_t t = 0; same_layout && t < rects.size(); t++)
+    {
+      same_layout = tiles[t].rect == rects[t];
+    }
+    if (!same_layout)
+    {
+      tiles.assign(rects.size(), Tile{});
+      for (size_t t = 0; t < rects.size(); t++)
+      {
+        tiles[t].rect = rects[t];
+      }
+    }
+    cv::Mat thumb;
+    if (tile_skip_diff > 0)
+    {
+      cv::resize(mat, thumb, cv::Size(), 0.25, 0.25, cv::INTER_AREA);
+    }
+    for (size_t t = 0; t < tiles.size(); t++)
+    {
+      auto &tile = tiles[t];
+      if (tile_skip_diff > 0)
+      {
+        cv::Rect r(tile.rect.x / 4, tile.rect.y / 4, tile.rect.width / 4,
+                   tile.rect.height / 4);
+        r &= cv::Rect(0, 0, thumb.cols, thumb.rows);
+        cv::Mat tile_thumb = thumb(r);
+        if (!tile.thumb.empty() &&
+            mean_abs_diff(tile_thumb, tile.thumb) < tile_skip_diff)
+        {
+          continue;
+        }
+        tile.thumb = tile_thumb.clone();
+      }
+      tile_mats.push_back(mat(tile.rect));
+      tile_ids.emplace_back(i, t);
+    }
+  }
+  if (ENV_PARAM(ENABLE_YOLO_DEBUG))
+  {
+    LOG(INFO) << "running " << tile_mats.size() << " tiles of "
+              << mats.size() << " frames";
+  }
+
+  if (!tile_mats.empty())
+  {
+    auto tile_results = run_untiled(tile_mats);
+    for (size_t k = 0; k < tile_ids.size(); k++)
+    {
+      auto &tile = channel_tiles[tile_ids[k].first][tile_ids[k].second];
+      tile.bboxes = std::move(tile_results[k].bboxes);
+      for (auto &bbox : tile.bboxes)
+      {
+        bbox.box[0] += tile.rect.x;
+        bbox.box[1] += tile.rect.y;
+        bbox.box[2] += tile.rect.x;
+        bbox.box[3] += tile.rect.y;
+      }
+    }
+  }
+
+  // the objects seen by several tiles are merged across the tiles
+  __TIC__(TILE_NMS)
+  std::vector<Yolov8OnnxResult> ret(mats.size());
+  for (size_t i = 0; i < mats.size(); i++)
   {
-    Ort::MemoryInfo info =
-        Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-    input_tensors[0] = Ort::Value::CreateTensor<float>(info,
-                                                       input_tensor_values.data(), input_tensor_values.size(),
-                                                       input_shapes_[0].data(), input_shapes_[0].size());
+    candidates.clear();
+    std::vector<const Yolov8OnnxResult::BoundingBox *> bboxes;
+    for (const auto &tile : channel_tiles[i])
+    {
+      for (const auto &bbox : tile.bboxes)
+      {
+        candidates.push_back(bbox.box[0], bbox.box[1], bbox.box[2],
+                             bbox.box[3], bbox.label, bbox.score);
+        bboxes.push_back(&bbox);
+      }
+    }
+    nms.run(candidates, nms_thresh, max_nms_num, kept);
+    ret[i].bboxes.reserve(kept.size());
+    for (auto k : kept)
+    {
+      ret[i].bboxes.push_back(*bboxes[k]);
+    }
   }
-  else
+  __TOC__(TILE_NMS)
+  return ret;
+}
+
+std::vector<Yolov8OnnxResult> Yolov8Onnx::run_untiled(
+    const std::vector<cv::Mat> &mats)
+{
+  // a static batch model runs the frames in chunks of its batch size
+  auto max_batch = (size_t)input_shapes_[0][0];
+  if (!dynamic_batch_ && mats.size() > max_batch)
   {
-    Ort::MemoryInfo info =
-        Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-    input_tensors.push_back(Ort::Value::CreateTensor<float>(info,
-                                                            input_tensor_values.data(), input_tensor_values.size(),
-                                                            input_shapes_[0].data(), input_shapes_[0].size()));
+    std::vector<Yolov8OnnxResult> ret;
+    ret.reserve(mats.size());
+    StageTimes total_times;
+    for (size_t start = 0; start < mats.size(); start += max_batch)
+    {
+      auto end = std::min(start + max_batch, mats.size());
+      auto results = run_untiled(std::vector<cv::Mat>(
+          mats.begin() + start, mats.begin() + end));
+      ret.insert(ret.end(), results.begin(), results.end());
+      total_times.preprocess += stage_times_.preprocess;
+      total_times.run += stage_times_.run;
+      total_times.postprocess += stage_times_.postprocess;
+    }
+    stage_times_ = total_times;
+    return ret;
   }
+  auto to_us = [](std::chrono::steady_clock::duration d)
+  {
+    return (int)std::chrono::duration_cast<std::chrono::microseconds>(d)
+        .count();
+  };
+  __TIC__(total)
+  __TIC__(preprocess)
+  auto t_start = std::chrono::steady_clock::now();
+  preprocess(mats);
+  bind_input(input_tensor_values, input_shapes_[0]);
+  bind_outputs(input_shapes_[0][0]);
 
   __TOC__(preprocess)
+  auto t_preprocess = std::chrono::steady_clock::now();
 
   __TIC__(session_run)
-  run_task(input_tensors, output_tensors);
+  run_task();
   for (int i = 1; i < output_tensor_size; i++)
   {
-    output_tensor_ptr[i] = output_tensors[i].GetTensorMutableData<float>();
+    output_tensor_ptr[i] = get_bound_output(i);
   }
   __TOC__(session_run)
+  auto t_run = std::chrono::steady_clock::now();
 
   __TIC__(postprocess)
   std::vector<Yolov8OnnxResult> ret = postprocess();
   __TOC__(postprocess)
   __TOC__(total)
+  auto t_postprocess = std::chrono::steady_clock::now();
+  stage_times_.preprocess = to_us(t_preprocess - t_start);
+  stage_times_.run = to_us(t_run - t_preprocess);
+  stage_times_.postprocess = to_us(t_postprocess - t_run);
   return ret;
 }